@@ -0,0 +1,124 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef sw_BinaryStream_hpp
+#define sw_BinaryStream_hpp
+
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <string.h>
+
+namespace sw
+{
+	// Plain byte streams for data only ever read back by the same build, like program
+	// binaries. Trivially copyable values are stored as their raw bytes.
+	class BinaryWriter
+	{
+	public:
+		void write(const void *data, size_t size)
+		{
+			const unsigned char *bytes = static_cast<const unsigned char*>(data);
+			buffer.insert(buffer.end(), bytes, bytes + size);
+		}
+
+		template<class T>
+		void write(const T &value)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable values can be stored as raw bytes");
+			write(&value, sizeof(T));
+		}
+
+		void write(const std::string &string)
+		{
+			write((unsigned int)string.size());
+			write(string.data(), string.size());
+		}
+
+		const std::vector<unsigned char> &data() const
+		{
+			return buffer;
+		}
+
+	private:
+		std::vector<unsigned char> buffer;
+	};
+
+	// Reads fail, and keep failing, once the end of the data is passed
+	class BinaryReader
+	{
+	public:
+		BinaryReader(const void *data, size_t size) : position(static_cast<const unsigned char*>(data)), end(position + size)
+		{
+		}
+
+		bool read(void *data, size_t size)
+		{
+			if(!position || size > (size_t)(end - position))
+			{
+				position = nullptr;
+				memset(data, 0, size);
+
+				return false;
+			}
+
+			memcpy(data, position, size);
+			position += size;
+
+			return true;
+		}
+
+		template<class T>
+		bool read(T &value)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable values can be stored as raw bytes");
+			return read(&value, sizeof(T));
+		}
+
+		bool read(std::string &string)
+		{
+			unsigned int size = 0;
+
+			if(!read(size) || size > (size_t)(end - position))
+			{
+				position = nullptr;
+				string.clear();
+
+				return false;
+			}
+
+			string.assign(reinterpret_cast<const char*>(position), size);
+			position += size;
+
+			return true;
+		}
+
+		bool failed() const
+		{
+			return !position;
+		}
+
+		bool atEnd() const
+		{
+			return position == end;
+		}
+
+	private:
+		const unsigned char *position;
+		const unsigned char *const end;
+	};
+}
+
+#endif   // sw_BinaryStream_hpp
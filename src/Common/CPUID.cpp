@@ -25,6 +25,7 @@
 	#include <unistd.h>
 	#include <sched.h>
 	#include <sys/types.h>
+	#include <stdio.h>
 #endif
 
 namespace sw
@@ -36,6 +37,9 @@ namespace sw
 	bool CPUID::SSE3 = detectSSE3();
 	bool CPUID::SSSE3 = detectSSSE3();
 	bool CPUID::SSE4_1 = detectSSE4_1();
+	bool CPUID::AVX = detectAVX();
+	bool CPUID::AVX2 = detectAVX2();
+	bool CPUID::F16C = detectF16C();
 	int CPUID::cores = detectCoreCount();
 	int CPUID::affinity = detectAffinity();
 
@@ -46,6 +50,8 @@ namespace sw
 	bool CPUID::enableSSE3 = true;
 	bool CPUID::enableSSSE3 = true;
 	bool CPUID::enableSSE4_1 = true;
+	bool CPUID::enableAVX = true;
+	bool CPUID::enableAVX2 = true;
 
 	void CPUID::setEnableMMX(bool enable)
 	{
@@ -58,6 +64,8 @@ namespace sw
 			enableSSE3 = false;
 			enableSSSE3 = false;
 			enableSSE4_1 = false;
+			enableAVX = false;
+			enableAVX2 = false;
 		}
 	}
 
@@ -72,6 +80,8 @@ namespace sw
 			enableSSE3 = false;
 			enableSSSE3 = false;
 			enableSSE4_1 = false;
+			enableAVX = false;
+			enableAVX2 = false;
 		}
 	}
 
@@ -90,6 +100,8 @@ namespace sw
 			enableSSE3 = false;
 			enableSSSE3 = false;
 			enableSSE4_1 = false;
+			enableAVX = false;
+			enableAVX2 = false;
 		}
 	}
 
@@ -108,6 +120,8 @@ namespace sw
 			enableSSE3 = false;
 			enableSSSE3 = false;
 			enableSSE4_1 = false;
+			enableAVX = false;
+			enableAVX2 = false;
 		}
 	}
 
@@ -126,6 +140,8 @@ namespace sw
 		{
 			enableSSSE3 = false;
 			enableSSE4_1 = false;
+			enableAVX = false;
+			enableAVX2 = false;
 		}
 	}
 
@@ -144,6 +160,8 @@ namespace sw
 		else
 		{
 			enableSSE4_1 = false;
+			enableAVX = false;
+			enableAVX2 = false;
 		}
 	}
 
@@ -160,6 +178,35 @@ namespace sw
 			enableSSE3 = true;
 			enableSSSE3 = true;
 		}
+		else
+		{
+			enableAVX = false;
+			enableAVX2 = false;
+		}
+	}
+
+	void CPUID::setEnableAVX(bool enable)
+	{
+		enableAVX = enable;
+
+		if(enableAVX)
+		{
+			setEnableSSE4_1(true);
+		}
+		else
+		{
+			enableAVX2 = false;
+		}
+	}
+
+	void CPUID::setEnableAVX2(bool enable)
+	{
+		enableAVX2 = enable;
+
+		if(enableAVX2)
+		{
+			setEnableAVX(true);
+		}
 	}
 
 	static void cpuid(int registers[4], int info)
@@ -178,6 +225,22 @@ namespace sw
 		#endif
 	}
 
+	static void cpuidex(int registers[4], int info, int subleaf)
+	{
+		#if defined(__i386__) || defined(__x86_64__)
+			#if defined(_WIN32)
+				__cpuidex(registers, info, subleaf);
+			#else
+				__asm volatile("cpuid": "=a" (registers[0]), "=b" (registers[1]), "=c" (registers[2]), "=d" (registers[3]): "a" (info), "c" (subleaf));
+			#endif
+		#else
+			registers[0] = 0;
+			registers[1] = 0;
+			registers[2] = 0;
+			registers[3] = 0;
+		#endif
+	}
+
 	bool CPUID::detectMMX()
 	{
 		int registers[4];
@@ -227,6 +290,60 @@ namespace sw
 		return SSE4_1 = (registers[2] & 0x00080000) != 0;
 	}
 
+	// Returns true if the OS saves and restores the XMM and YMM registers on context switches.
+	static bool osSupportsYMM()
+	{
+		int registers[4];
+		cpuid(registers, 1);
+
+		if((registers[2] & 0x08000000) == 0)   // OSXSAVE
+		{
+			return false;
+		}
+
+		#if defined(__i386__) || defined(__x86_64__)
+			#if defined(_WIN32)
+				unsigned long long xcr0 = _xgetbv(0);
+			#else
+				unsigned int eax, edx;
+				__asm volatile("xgetbv" : "=a" (eax), "=d" (edx) : "c" (0));
+				unsigned long long xcr0 = ((unsigned long long)edx << 32) | eax;
+			#endif
+
+			return (xcr0 & 0x6) == 0x6;
+		#else
+			return false;
+		#endif
+	}
+
+	bool CPUID::detectAVX()
+	{
+		int registers[4];
+		cpuid(registers, 1);
+		return AVX = (registers[2] & 0x10000000) != 0 && osSupportsYMM();
+	}
+
+	bool CPUID::detectAVX2()
+	{
+		int registers[4];
+		cpuid(registers, 0);
+
+		if(registers[0] < 7)
+		{
+			return AVX2 = false;
+		}
+
+		cpuidex(registers, 7, 0);
+		return AVX2 = (registers[1] & 0x00000020) != 0 && detectAVX();
+	}
+
+	bool CPUID::detectF16C()
+	{
+		int registers[4];
+		cpuid(registers, 1);
+		return F16C = (registers[2] & 0x20000000) != 0 && detectAVX();
+	}
+
 	int CPUID::detectCoreCount()
 	{
 		int cores = 0;
@@ -251,7 +368,6 @@ namespace sw
 		#endif
 
 		if(cores < 1)  cores = 1;
-		if(cores > 16) cores = 16;
 
 		return cores;   // FIXME: Number of physical cores
 	}
@@ -275,16 +391,118 @@ namespace sw
 
 				processAffinityMask >>= 1;
 			}
+		#elif defined(__linux__)
+			cpu_set_t cpuSet;
+			CPU_ZERO(&cpuSet);
+
+			if(sched_getaffinity(0, sizeof(cpu_set_t), &cpuSet) == 0)
+			{
+				cores = CPU_COUNT(&cpuSet);
+			}
+			else
+			{
+				return detectCoreCount();
+			}
 		#else
 			return detectCoreCount();   // FIXME: Assumes no affinity limitation
 		#endif
 
 		if(cores < 1)  cores = 1;
-		if(cores > 16) cores = 16;
 
 		return cores;
 	}
 
+	void CPUID::processorSet(std::vector<int> &processors, int numaNode)
+	{
+		processors.clear();
+
+		#if defined(_WIN32)
+			DWORD_PTR processAffinityMask = 1;
+			DWORD_PTR systemAffinityMask = 1;
+
+			GetProcessAffinityMask(GetCurrentProcess(), &processAffinityMask, &systemAffinityMask);
+
+			ULONGLONG nodeMask = ~0ull;
+
+			if(numaNode >= 0 && !GetNumaNodeProcessorMask((UCHAR)numaNode, &nodeMask))
+			{
+				nodeMask = ~0ull;
+			}
+
+			for(int i = 0; i < (int)(8 * sizeof(DWORD_PTR)); i++)
+			{
+				if((processAffinityMask >> i) & (nodeMask >> i) & 1)
+				{
+					processors.push_back(i);
+				}
+			}
+		#elif defined(__linux__)
+			cpu_set_t cpuSet;
+			CPU_ZERO(&cpuSet);
+
+			if(sched_getaffinity(0, sizeof(cpu_set_t), &cpuSet) != 0)
+			{
+				for(int i = 0; i < detectCoreCount() && i < CPU_SETSIZE; i++)
+				{
+					CPU_SET(i, &cpuSet);
+				}
+			}
+
+			if(numaNode >= 0)
+			{
+				// The node's processors are listed as comma-separated ranges, e.g. "0-3,8-11"
+				char path[64];
+				snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", numaNode);
+				FILE *file = fopen(path, "r");
+
+				if(file)
+				{
+					cpu_set_t nodeSet;
+					CPU_ZERO(&nodeSet);
+
+					int first = 0;
+					int last = 0;
+					int count = 0;
+
+					while((count = fscanf(file, "%d-%d", &first, &last)) >= 1)
+					{
+						if(count == 1)
+						{
+							last = first;
+						}
+
+						for(int i = first; i <= last && i < CPU_SETSIZE; i++)
+						{
+							CPU_SET(i, &nodeSet);
+						}
+
+						if(fgetc(file) != ',')
+						{
+							break;
+						}
+					}
+
+					fclose(file);
+
+					CPU_AND(&cpuSet, &cpuSet, &nodeSet);
+				}
+			}
+
+			for(int i = 0; i < CPU_SETSIZE; i++)
+			{
+				if(CPU_ISSET(i, &cpuSet))
+				{
+					processors.push_back(i);
+				}
+			}
+		#else
+			for(int i = 0; i < detectCoreCount(); i++)   // FIXME: Assumes no affinity limitation
+			{
+				processors.push_back(i);
+			}
+		#endif
+	}
+
 	void CPUID::setFlushToZero(bool enable)
 	{
 		#if defined(_MSC_VER)
@@ -15,6 +15,8 @@
 #ifndef sw_CPUID_hpp
 #define sw_CPUID_hpp
 
+#include <vector>
+
 namespace sw
 {
 	#if !defined(__i386__) && defined(_M_IX86)
@@ -36,8 +38,12 @@ namespace sw
 		static bool supportsSSE3();
 		static bool supportsSSSE3();
 		static bool supportsSSE4_1();
+		static bool supportsAVX();    // Also requires the OS to preserve the upper halves of the YMM registers
+		static bool supportsAVX2();
+		static bool supportsF16C();   // Half-precision conversion instructions, usable only when the OS saves AVX state
 		static int coreCount();
 		static int processAffinity();
+		static void processorSet(std::vector<int> &processors, int numaNode = -1);   // Processors this process may run on, optionally limited to one NUMA node
 
 		static void setEnableMMX(bool enable);
 		static void setEnableCMOV(bool enable);
@@ -46,6 +52,8 @@ namespace sw
 		static void setEnableSSE3(bool enable);
 		static void setEnableSSSE3(bool enable);
 		static void setEnableSSE4_1(bool enable);
+		static void setEnableAVX(bool enable);
+		static void setEnableAVX2(bool enable);
 
 		static void setFlushToZero(bool enable);        // Denormal results are written as zero
 		static void setDenormalsAreZero(bool enable);   // Denormal inputs are read as zero
@@ -58,6 +66,9 @@ namespace sw
 		static bool SSE3;
 		static bool SSSE3;
 		static bool SSE4_1;
+		static bool AVX;
+		static bool AVX2;
+		static bool F16C;
 		static int cores;
 		static int affinity;
 
@@ -68,6 +79,8 @@ namespace sw
 		static bool enableSSE3;
 		static bool enableSSSE3;
 		static bool enableSSE4_1;
+		static bool enableAVX;
+		static bool enableAVX2;
 
 		static bool detectMMX();
 		static bool detectCMOV();
@@ -76,6 +89,9 @@ namespace sw
 		static bool detectSSE3();
 		static bool detectSSSE3();
 		static bool detectSSE4_1();
+		static bool detectAVX();
+		static bool detectAVX2();
+		static bool detectF16C();
 		static int detectCoreCount();
 		static int detectAffinity();
 	};
@@ -123,6 +139,21 @@ namespace sw
 		return SSE4_1 && enableSSE4_1;
 	}
 
+	inline bool CPUID::supportsAVX()
+	{
+		return AVX && enableAVX;
+	}
+
+	inline bool CPUID::supportsAVX2()
+	{
+		return AVX2 && enableAVX2;
+	}
+
+	inline bool CPUID::supportsF16C()
+	{
+		return F16C;
+	}
+
 	inline int CPUID::coreCount()
 	{
 		return cores;
@@ -0,0 +1,113 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef sw_CompletionSignal_hpp
+#define sw_CompletionSignal_hpp
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdint.h>
+
+namespace sw
+{
+	// Monotonically advancing completion counter. Polling whether a sequence
+	// number has been reached is a single atomic load, and the mutex is only
+	// taken by the producer when a consumer is actually blocked waiting.
+	// Sequence numbers may wrap around, comparisons are done modulo 2^32.
+	class CompletionSignal
+	{
+	public:
+		explicit CompletionSignal(unsigned int initial = 0) : completed(initial), waiters(0)
+		{
+		}
+
+		unsigned int get() const
+		{
+			return completed.load(std::memory_order_acquire);
+		}
+
+		bool reached(unsigned int sequence) const
+		{
+			return (int)(get() - sequence) >= 0;
+		}
+
+		// Raises the completed sequence to at least 'sequence'. Never moves it backwards.
+		void advance(unsigned int sequence)
+		{
+			unsigned int current = completed.load(std::memory_order_relaxed);
+
+			do
+			{
+				if((int)(sequence - current) <= 0)
+				{
+					return;
+				}
+			}
+			while(!completed.compare_exchange_weak(current, sequence, std::memory_order_seq_cst));
+
+			if(waiters.load(std::memory_order_seq_cst) > 0)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				condition.notify_all();
+			}
+		}
+
+		void wait(unsigned int sequence)
+		{
+			if(reached(sequence))
+			{
+				return;
+			}
+
+			std::unique_lock<std::mutex> lock(mutex);
+			waiters.fetch_add(1, std::memory_order_seq_cst);
+			condition.wait(lock, [&]() { return reached(sequence); });
+			waiters.fetch_sub(1, std::memory_order_relaxed);
+		}
+
+		// Returns false if 'sequence' wasn't reached within 'timeout' nanoseconds
+		bool wait(unsigned int sequence, uint64_t timeout)
+		{
+			if(reached(sequence))
+			{
+				return true;
+			}
+
+			if(timeout >= INFINITE_TIMEOUT)
+			{
+				wait(sequence);
+				return true;
+			}
+
+			std::unique_lock<std::mutex> lock(mutex);
+			waiters.fetch_add(1, std::memory_order_seq_cst);
+			bool signaled = condition.wait_for(lock, std::chrono::nanoseconds(timeout), [&]() { return reached(sequence); });
+			waiters.fetch_sub(1, std::memory_order_relaxed);
+
+			return signaled;
+		}
+
+		static constexpr uint64_t INFINITE_TIMEOUT = 1ull << 62;   // Longer timeouts would overflow the clock
+
+	private:
+		std::atomic<unsigned int> completed;
+		std::atomic<int> waiters;
+		std::mutex mutex;
+		std::condition_variable condition;
+	};
+}
+
+#endif   // sw_CompletionSignal_hpp
@@ -14,6 +14,19 @@
 
 #include "Half.hpp"
 
+#include "CPUID.hpp"
+
+#if defined(__i386__) || defined(__x86_64__)
+	#include <emmintrin.h>
+	#include <immintrin.h>
+
+	#if defined(_MSC_VER)
+		#define F16C_FUNCTION
+	#else
+		#define F16C_FUNCTION __attribute__((target("f16c")))
+	#endif
+#endif
+
 namespace sw
 {
 	half::half(float fp32)
@@ -99,4 +112,142 @@ namespace sw
 
 		return *this;
 	}
+
+	#if defined(__i386__) || defined(__x86_64__)
+		// Halves with the maximum exponent are finite, unlike IEEE infinity and NaN
+		static inline __m128i halfToFloatSSE2(__m128i h)
+		{
+			__m128i sign = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x8000)), 16);
+			__m128i abs = _mm_and_si128(h, _mm_set1_epi32(0x7FFF));
+			__m128i normal = _mm_add_epi32(_mm_slli_epi32(abs, 13), _mm_set1_epi32(112 << 23));
+			__m128 denormal = _mm_mul_ps(_mm_cvtepi32_ps(abs), _mm_set1_ps(1.0f / (1 << 24)));   // Exact, also for zero
+			__m128i isDenormal = _mm_cmplt_epi32(abs, _mm_set1_epi32(0x0400));
+
+			return _mm_or_si128(sign, _mm_or_si128(_mm_and_si128(isDenormal, _mm_castps_si128(denormal)), _mm_andnot_si128(isDenormal, normal)));
+		}
+
+		// Lanes which become normal halves below the maximum exponent, for which rounding to nearest even is all there is to it
+		static inline bool normalHalfRange(__m128i f)
+		{
+			__m128i abs = _mm_and_si128(f, _mm_set1_epi32(0x7FFFFFFF));
+			__m128i inRange = _mm_and_si128(_mm_cmpgt_epi32(abs, _mm_set1_epi32(0x387FFFFF)), _mm_cmplt_epi32(abs, _mm_set1_epi32(0x477FF000)));
+
+			return _mm_movemask_epi8(inRange) == 0xFFFF;
+		}
+
+		static inline __m128i floatToHalfSSE2(__m128i f)
+		{
+			__m128i abs = _mm_and_si128(f, _mm_set1_epi32(0x7FFFFFFF));
+			__m128i odd = _mm_and_si128(_mm_srli_epi32(abs, 13), _mm_set1_epi32(1));
+			__m128i h = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(abs, _mm_set1_epi32(0xC8000FFF)), odd), 13);
+			h = _mm_or_si128(h, _mm_srli_epi32(_mm_and_si128(f, _mm_set1_epi32(0x80000000)), 16));
+
+			// Sign extend, so the saturating pack keeps all 16 bits
+			h = _mm_srai_epi32(_mm_slli_epi32(h, 16), 16);
+
+			return _mm_packs_epi32(h, h);
+		}
+
+		F16C_FUNCTION static void halfToFloatF16C(float *destination, const half *source, size_t count)
+		{
+			for(size_t i = 0; i < count; i += 4)
+			{
+				__m128i h = _mm_loadl_epi64((const __m128i*)(source + i));
+				__m128i h32 = _mm_unpacklo_epi16(h, _mm_setzero_si128());
+				__m128 f = _mm_cvtph_ps(h);
+
+				__m128i isMaxExponent = _mm_cmpeq_epi32(_mm_and_si128(h32, _mm_set1_epi32(0x7C00)), _mm_set1_epi32(0x7C00));
+				__m128 f32 = _mm_castsi128_ps(halfToFloatSSE2(h32));
+
+				_mm_storeu_ps(destination + i, _mm_or_ps(_mm_and_ps(_mm_castsi128_ps(isMaxExponent), f32), _mm_andnot_ps(_mm_castsi128_ps(isMaxExponent), f)));
+			}
+		}
+
+		F16C_FUNCTION static void floatToHalfF16C(half *destination, const float *source, size_t count)
+		{
+			for(size_t i = 0; i < count; i += 4)
+			{
+				__m128i f = _mm_loadu_si128((const __m128i*)(source + i));
+
+				if(normalHalfRange(f))
+				{
+					_mm_storel_epi64((__m128i*)(destination + i), _mm_cvtps_ph(_mm_castsi128_ps(f), 0));   // Round to nearest even
+				}
+				else
+				{
+					for(size_t j = i; j < i + 4; j++)
+					{
+						destination[j] = half(source[j]);
+					}
+				}
+			}
+		}
+	#endif
+
+	void halfToFloat(float *destination, const half *source, size_t count)
+	{
+		size_t i = 0;
+
+		#if defined(__i386__) || defined(__x86_64__)
+			size_t vectorCount = count & ~(size_t)3;
+
+			if(CPUID::supportsF16C())
+			{
+				halfToFloatF16C(destination, source, vectorCount);
+				i = vectorCount;
+			}
+			else if(CPUID::supportsSSE2())
+			{
+				for(; i < vectorCount; i += 4)
+				{
+					__m128i h = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)(source + i)), _mm_setzero_si128());
+					_mm_storeu_si128((__m128i*)(destination + i), halfToFloatSSE2(h));
+				}
+			}
+		#endif
+
+		for(; i < count; i++)
+		{
+			destination[i] = source[i];
+		}
+	}
+
+	void floatToHalf(half *destination, const float *source, size_t count)
+	{
+		size_t i = 0;
+
+		#if defined(__i386__) || defined(__x86_64__)
+			size_t vectorCount = count & ~(size_t)3;
+
+			if(CPUID::supportsF16C())
+			{
+				floatToHalfF16C(destination, source, vectorCount);
+				i = vectorCount;
+			}
+			else if(CPUID::supportsSSE2())
+			{
+				for(; i < vectorCount; i += 4)
+				{
+					__m128i f = _mm_loadu_si128((const __m128i*)(source + i));
+
+					if(normalHalfRange(f))
+					{
+						_mm_storel_epi64((__m128i*)(destination + i), floatToHalfSSE2(f));
+					}
+					else
+					{
+						for(size_t j = i; j < i + 4; j++)
+						{
+							destination[j] = half(source[j]);
+						}
+					}
+				}
+			}
+		#endif
+
+		for(; i < count; i++)
+		{
+			destination[i] = half(source[i]);
+		}
+	}
 }
@@ -15,6 +15,8 @@
 #ifndef sw_Half_hpp
 #define sw_Half_hpp
 
+#include <stddef.h>
+
 namespace sw
 {
 	class half
@@ -32,6 +34,10 @@ namespace sw
 		unsigned short fp16i;
 	};
 
+	// Batch conversions with the same results as the scalar ones, vectorized with SSE2 or F16C
+	void halfToFloat(float *destination, const half *source, size_t count);
+	void floatToHalf(half *destination, const float *source, size_t count);
+
 	inline half shortAsHalf(short s)
 	{
 		union
@@ -30,6 +30,7 @@
 	#include <unistd.h>
 #endif
 
+#include <atomic>
 #include <memory.h>
 
 #undef allocate
@@ -45,38 +46,140 @@ namespace
 {
 struct Allocation
 {
-//	size_t bytes;
+	size_t bytes;
 	unsigned char *block;
+	size_t length;   // Of the page mapping, 0 when allocated from the heap
+	MemoryCategory category;
 };
 
-void *allocateRaw(size_t bytes, size_t alignment)
+std::atomic<size_t> usage[MEMORY_CATEGORY_COUNT];
+
+// Allocations this large get pages of their own, which the system zero-fills
+// on first touch. Untouched pages, e.g. of render targets which never get
+// written in full, don't take up physical memory.
+const size_t mappedAllocationSize = 256 * 1024;
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+	// Data of mappings at least this large starts at a huge page boundary, so
+	// transparent huge pages can back it. Fewer TLB misses when sampling large
+	// textures, and less page table overhead for big render targets.
+	const size_t hugePageSize = 2 * 1024 * 1024;
+#endif
+
+// Returns a mapping of length bytes, of which the data starts one page in
+void *allocatePages(size_t length)
+{
+	#if defined(_WIN32)
+		return VirtualAlloc(nullptr, length, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	#else
+		#if defined(__linux__) && defined(MADV_HUGEPAGE)
+			size_t pageSize = memoryPageSize();
+
+			if(length - pageSize >= hugePageSize)
+			{
+				// Over-allocate, so the data can be aligned by unmapping the excess
+				size_t extended = length + hugePageSize;
+				void *mapping = mmap(nullptr, extended, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+				if(mapping == MAP_FAILED)
+				{
+					return nullptr;
+				}
+
+				unsigned char *start = (unsigned char*)mapping;
+				unsigned char *data = (unsigned char*)(((uintptr_t)start + pageSize + hugePageSize - 1) & ~(uintptr_t)(hugePageSize - 1));
+				unsigned char *block = data - pageSize;
+
+				if(block != start)
+				{
+					munmap(start, block - start);
+				}
+
+				if(block + length != start + extended)
+				{
+					munmap(block + length, (start + extended) - (block + length));
+				}
+
+				madvise(data, length - pageSize, MADV_HUGEPAGE);   // Only a hint, fine to fail
+
+				return block;
+			}
+		#endif
+
+		void *mapping = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		return (mapping != MAP_FAILED) ? mapping : nullptr;
+	#endif
+}
+
+void freePages(void *block, size_t length)
+{
+	#if defined(_WIN32)
+		VirtualFree(block, 0, MEM_RELEASE);
+	#else
+		munmap(block, length);
+	#endif
+}
+
+void *allocateRaw(size_t bytes, size_t alignment, MemoryCategory category, bool &zeroed)
 {
 	ASSERT((alignment & (alignment - 1)) == 0);   // Power of 2 alignment.
 
-	#if defined(LINUX_ENABLE_NAMED_MMAP)
-		void *allocation;
-		int result = posix_memalign(&allocation, alignment, bytes);
-		if(result != 0)
+	size_t pageSize = memoryPageSize();
+	unsigned char *block = nullptr;
+	unsigned char *aligned = nullptr;
+	size_t length = 0;
+
+	if(bytes >= mappedAllocationSize && alignment <= pageSize)
+	{
+		// The header takes the end of the first page, so the data starts page aligned
+		length = pageSize + ((bytes + pageSize - 1) & ~(pageSize - 1));
+		block = (unsigned char*)allocatePages(length);
+
+		if(!block)
 		{
-			errno = result;
-			allocation = nullptr;
+			return nullptr;
 		}
-		return allocation;
-	#else
-		unsigned char *block = new unsigned char[bytes + sizeof(Allocation) + alignment];
-		unsigned char *aligned = nullptr;
 
-		if(block)
-		{
+		aligned = block + pageSize;
+	}
+	else
+	{
+		#if defined(LINUX_ENABLE_NAMED_MMAP)
+			// The header takes a whole multiple of the alignment
+			size_t header = (sizeof(Allocation) + alignment - 1) & ~(alignment - 1);
+			void *allocation;
+			int result = posix_memalign(&allocation, alignment, bytes + header);
+			if(result != 0)
+			{
+				errno = result;
+				return nullptr;
+			}
+			block = (unsigned char*)allocation;
+			aligned = block + header;
+		#else
+			block = new unsigned char[bytes + sizeof(Allocation) + alignment];
+
+			if(!block)
+			{
+				return nullptr;
+			}
+
 			aligned = (unsigned char*)((uintptr_t)(block + sizeof(Allocation) + alignment - 1) & -(intptr_t)alignment);
-			Allocation *allocation = (Allocation*)(aligned - sizeof(Allocation));
+		#endif
+	}
 
-		//	allocation->bytes = bytes;
-			allocation->block = block;
-		}
+	Allocation *allocation = (Allocation*)(aligned - sizeof(Allocation));
 
-		return aligned;
-	#endif
+	allocation->bytes = bytes;
+	allocation->block = block;
+	allocation->length = length;
+	allocation->category = category;
+
+	zeroed = (length != 0);
+
+	usage[category].fetch_add(bytes, std::memory_order_relaxed);
+
+	return aligned;
 }
 }  // anonymous namespace
 
@@ -98,11 +201,12 @@ size_t memoryPageSize()
 	return pageSize;
 }
 
-void *allocate(size_t bytes, size_t alignment)
+void *allocate(size_t bytes, size_t alignment, MemoryCategory category)
 {
-	void *memory = allocateRaw(bytes, alignment);
+	bool zeroed = false;
+	void *memory = allocateRaw(bytes, alignment, category, zeroed);
 
-	if(memory)
+	if(memory && !zeroed)
 	{
 		memset(memory, 0, bytes);
 	}
@@ -112,17 +216,30 @@ void *allocate(size_t bytes, size_t alignment)
 
 void deallocate(void *memory)
 {
-	#if defined(LINUX_ENABLE_NAMED_MMAP)
-		free(memory);
-	#else
-		if(memory)
+	if(memory)
+	{
+		unsigned char *aligned = (unsigned char*)memory;
+		Allocation *allocation = (Allocation*)(aligned - sizeof(Allocation));
+
+		usage[allocation->category].fetch_sub(allocation->bytes, std::memory_order_relaxed);
+
+		if(allocation->length != 0)
 		{
-			unsigned char *aligned = (unsigned char*)memory;
-			Allocation *allocation = (Allocation*)(aligned - sizeof(Allocation));
+			freePages(allocation->block, allocation->length);
+			return;
+		}
 
+		#if defined(LINUX_ENABLE_NAMED_MMAP)
+			free(allocation->block);
+		#else
 			delete[] allocation->block;
-		}
-	#endif
+		#endif
+	}
+}
+
+size_t memoryUsage(MemoryCategory category)
+{
+	return usage[category].load(std::memory_order_relaxed);
 }
 
 void clear(uint16_t *memory, uint16_t element, size_t count)
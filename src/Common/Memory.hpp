@@ -20,11 +20,23 @@
 
 namespace sw
 {
+enum MemoryCategory
+{
+	MEMORY_OTHER,
+	MEMORY_SURFACE,    // Surface internal, external and stencil buffers
+	MEMORY_RESOURCE,   // Resource buffers, e.g. vertex and index data
+	MEMORY_DRAW,       // Draw call state
+
+	MEMORY_CATEGORY_COUNT
+};
+
 size_t memoryPageSize();
 
-void *allocate(size_t bytes, size_t alignment = 16);
+void *allocate(size_t bytes, size_t alignment = 16, MemoryCategory category = MEMORY_OTHER);
 void deallocate(void *memory);
 
+size_t memoryUsage(MemoryCategory category);   // Bytes currently allocated in the category
+
 void clear(uint16_t *memory, uint16_t element, size_t count);
 void clear(uint32_t *memory, uint32_t element, size_t count);
 }
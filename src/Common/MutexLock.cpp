@@ -0,0 +1,84 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "MutexLock.hpp"
+
+#include <mutex>
+#include <stdlib.h>
+#include <string.h>
+
+namespace sw
+{
+	namespace
+	{
+		const int MAX_LOCK_NAMES = 32;
+
+		// Never destroyed, locks may outlive static destructors
+		LockCounters lockCounters[MAX_LOCK_NAMES];
+		std::atomic<int> lockNameCount(0);
+
+		std::mutex &registryMutex()
+		{
+			static std::mutex *mutex = new std::mutex();
+			return *mutex;
+		}
+
+		bool lockStatisticsEnabled()
+		{
+			static const bool enabled = getenv("SWIFTSHADER_LOCK_STATISTICS") != nullptr;
+			return enabled;
+		}
+	}
+
+	LockCounters *getLockCounters(const char *name)
+	{
+		if(!name || !lockStatisticsEnabled())
+		{
+			return nullptr;
+		}
+
+		std::lock_guard<std::mutex> guard(registryMutex());
+
+		int count = lockNameCount.load(std::memory_order_relaxed);
+
+		for(int i = 0; i < count; i++)
+		{
+			if(strcmp(lockCounters[i].name, name) == 0)
+			{
+				return &lockCounters[i];
+			}
+		}
+
+		if(count == MAX_LOCK_NAMES)
+		{
+			return nullptr;
+		}
+
+		lockCounters[count].name = name;   // Lock names are string literals
+		lockNameCount.store(count + 1, std::memory_order_release);
+
+		return &lockCounters[count];
+	}
+
+	const LockCounters *getLockCounters(int index)
+	{
+		if(index < 0 || index >= lockNameCount.load(std::memory_order_acquire))
+		{
+			return nullptr;
+		}
+
+		return &lockCounters[index];
+	}
+}
@@ -17,6 +17,43 @@
 
 #include "Thread.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+
+namespace sw
+{
+	// Contention counters shared by all locks constructed with the same name.
+	// Only collected when the SWIFTSHADER_LOCK_STATISTICS environment variable
+	// is set, so unnamed locks and regular runs don't pay for them.
+	struct LockCounters
+	{
+		const char *name;
+		std::atomic<uint64_t> acquisitions;
+		std::atomic<uint64_t> contendedAcquisitions;   // Acquisitions which had to wait for another thread
+		std::atomic<uint64_t> waitNanoseconds;         // Time spent waiting in contended acquisitions
+
+		static uint64_t now()
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		void countAcquisition()
+		{
+			acquisitions.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		void countContention(uint64_t start)
+		{
+			contendedAcquisitions.fetch_add(1, std::memory_order_relaxed);
+			waitNanoseconds.fetch_add(now() - start, std::memory_order_relaxed);
+		}
+	};
+
+	LockCounters *getLockCounters(const char *name);   // Null for unnamed locks, or when statistics are disabled
+	const LockCounters *getLockCounters(int index);    // Null past the last named lock
+}
+
 #if defined(__linux__)
 // Use a pthread mutex on Linux. Since many processes may use SwiftShader
 // at the same time it's best to just have the scheduler overhead.
@@ -27,7 +64,7 @@ namespace sw
 	class MutexLock
 	{
 	public:
-		MutexLock()
+		explicit MutexLock(const char *name = nullptr) : counters(getLockCounters(name))
 		{
 			pthread_mutex_init(&mutex, NULL);
 		}
@@ -44,7 +81,20 @@ namespace sw
 
 		void lock()
 		{
-			pthread_mutex_lock(&mutex);
+			if(!counters)
+			{
+				pthread_mutex_lock(&mutex);
+				return;
+			}
+
+			if(!attemptLock())
+			{
+				uint64_t start = LockCounters::now();
+				pthread_mutex_lock(&mutex);
+				counters->countContention(start);
+			}
+
+			counters->countAcquisition();
 		}
 
 		void unlock()
@@ -54,19 +104,18 @@ namespace sw
 
 	private:
 		pthread_mutex_t mutex;
+		LockCounters *const counters;
 	};
 }
 
 #else   // !__linux__
 
-#include <atomic>
-
 namespace sw
 {
 	class BackoffLock
 	{
 	public:
-		BackoffLock()
+		explicit BackoffLock(const char *name = nullptr) : counters(getLockCounters(name))
 		{
 			mutex = 0;
 		}
@@ -85,6 +134,35 @@ namespace sw
 		}
 
 		void lock()
+		{
+			if(!counters)
+			{
+				spin();
+				return;
+			}
+
+			if(!attemptLock())
+			{
+				uint64_t start = LockCounters::now();
+				spin();
+				counters->countContention(start);
+			}
+
+			counters->countAcquisition();
+		}
+
+		void unlock()
+		{
+			mutex.store(false, std::memory_order_release);
+		}
+
+		bool isLocked()
+		{
+			return mutex.load(std::memory_order_acquire);
+		}
+
+	private:
+		void spin()
 		{
 			int backoff = 1;
 
@@ -148,17 +226,6 @@ namespace sw
 			};
 		}
 
-		void unlock()
-		{
-			mutex.store(false, std::memory_order_release);
-		}
-
-		bool isLocked()
-		{
-			return mutex.load(std::memory_order_acquire);
-		}
-
-	private:
 		struct
 		{
 			// Ensure that the mutex variable is on its own 64-byte cache line to avoid false sharing
@@ -167,6 +234,8 @@ namespace sw
 			std::atomic<bool> mutex;
 			volatile int padding2[15];
 		};
+
+		LockCounters *const counters;
 	};
 
 	using MutexLock = BackoffLock;
@@ -15,19 +15,37 @@
 #include "Resource.hpp"
 
 #include "Memory.hpp"
+#include "Timer.hpp"
+#include "Trace.hpp"
 #include "Debug.hpp"
 
 namespace sw
 {
-	Resource::Resource(size_t bytes) : size(bytes)
+	static std::atomic<int64_t> lockWaitTime(0);   // In Timer::counter() units
+
+	static inline unsigned int lockState(int count, Accessor accessor)
+	{
+		return (count << 2) | accessor;
+	}
+
+	static inline int lockCount(unsigned int state)
+	{
+		return state >> 2;
+	}
+
+	static inline Accessor lockAccessor(unsigned int state)
+	{
+		return (Accessor)(state & 3);
+	}
+
+	Resource::Resource(size_t bytes) : size(bytes), criticalSection("resource")
 	{
 		blocked = 0;
 
-		accessor = PUBLIC;
-		count = 0;
+		state = lockState(0, PUBLIC);
 		orphaned = false;
 
-		buffer = allocate(bytes);
+		buffer = allocate(bytes, 16, MEMORY_RESOURCE);
 	}
 
 	Resource::~Resource()
@@ -37,21 +55,20 @@ namespace sw
 
 	void *Resource::lock(Accessor claimer)
 	{
-		criticalSection.lock();
+		// Readers sharing the resource, or claiming it while unlocked, don't contend for the critical section
+		unsigned int current = state.load(std::memory_order_relaxed);
 
-		while(count > 0 && accessor != claimer)
+		while(lockCount(current) == 0 || lockAccessor(current) == claimer)
 		{
-			blocked++;
-			criticalSection.unlock();
-
-			unblock.wait();
-
-			criticalSection.lock();
-			blocked--;
+			if(state.compare_exchange_weak(current, lockState(lockCount(current) + 1, claimer), std::memory_order_acquire))
+			{
+				return buffer;
+			}
 		}
 
-		accessor = claimer;
-		count++;
+		criticalSection.lock();
+
+		acquire(claimer);
 
 		criticalSection.unlock();
 
@@ -63,61 +80,69 @@ namespace sw
 		criticalSection.lock();
 
 		// Release
-		while(count > 0 && accessor == relinquisher)
+		while(lockCount(state) > 0 && lockAccessor(state) == relinquisher)
 		{
-			count--;
-
-			if(count == 0)
+			if(release())
 			{
-				if(blocked)
-				{
-					unblock.signal();
-				}
-				else if(orphaned)
-				{
-					criticalSection.unlock();
+				criticalSection.unlock();
 
-					delete this;
+				delete this;
 
-					return 0;
-				}
+				return 0;
 			}
 		}
 
 		// Acquire
-		while(count > 0 && accessor != claimer)
+		acquire(claimer);
+
+		criticalSection.unlock();
+
+		return buffer;
+	}
+
+	bool Resource::tryLock(Accessor claimer)
+	{
+		unsigned int current = state.load(std::memory_order_relaxed);
+
+		return lockCount(current) == 0 && !orphaned &&
+		       state.compare_exchange_strong(current, lockState(1, claimer), std::memory_order_acquire);
+	}
+
+	void Resource::unlock()
+	{
+		// Only the last unlock has to wake up blocked claimers or delete an orphaned resource
+		unsigned int current = state.load(std::memory_order_relaxed);
+
+		while(lockCount(current) > 1)
+		{
+			if(state.compare_exchange_weak(current, lockState(lockCount(current) - 1, lockAccessor(current)), std::memory_order_release))
+			{
+				return;
+			}
+		}
+
+		criticalSection.lock();
+
+		if(release())
 		{
-			blocked++;
 			criticalSection.unlock();
 
-			unblock.wait();
+			delete this;
 
-			criticalSection.lock();
-			blocked--;
+			return;
 		}
 
-		accessor = claimer;
-		count++;
-
 		criticalSection.unlock();
-
-		return buffer;
 	}
 
-	void Resource::unlock()
+	void Resource::unlock(Accessor relinquisher)
 	{
 		criticalSection.lock();
-		ASSERT(count > 0);
+		ASSERT(lockCount(state) > 0);
 
-		count--;
-
-		if(count == 0)
+		while(lockCount(state) > 0 && lockAccessor(state) == relinquisher)
 		{
-			if(blocked)
-			{
-				unblock.signal();
-			}
-			else if(orphaned)
+			if(release())
 			{
 				criticalSection.unlock();
 
@@ -130,40 +155,68 @@ namespace sw
 		criticalSection.unlock();
 	}
 
-	void Resource::unlock(Accessor relinquisher)
+	void Resource::acquire(Accessor claimer)
 	{
-		criticalSection.lock();
-		ASSERT(count > 0);
+		// Called within the critical section
+		unsigned int current = state.load(std::memory_order_relaxed);
 
-		while(count > 0 && accessor == relinquisher)
+		while(true)
 		{
-			count--;
-
-			if(count == 0)
+			if(lockCount(current) > 0 && lockAccessor(current) != claimer)
 			{
-				if(blocked)
+				blocked++;
+				criticalSection.unlock();
+
 				{
-					unblock.signal();
+					TraceScope scope("Resource lock wait", claimer);
+					int64_t start = Timer::counter();
+					unblock.wait();
+					lockWaitTime += Timer::counter() - start;
 				}
-				else if(orphaned)
-				{
-					criticalSection.unlock();
 
-					delete this;
+				criticalSection.lock();
+				blocked--;
 
-					return;
-				}
+				current = state.load(std::memory_order_relaxed);
+			}
+			else if(state.compare_exchange_weak(current, lockState(lockCount(current) + 1, claimer), std::memory_order_acquire))
+			{
+				return;
 			}
 		}
+	}
 
-		criticalSection.unlock();
+	double Resource::lockWaitSeconds()
+	{
+		return (double)lockWaitTime / (double)Timer::frequency();
+	}
+
+	bool Resource::release()
+	{
+		// Called within the critical section, returns true when the orphaned resource must be deleted
+		unsigned int previous = state.fetch_sub(1 << 2, std::memory_order_release);   // Decrement the count, keep the accessor
+		ASSERT(lockCount(previous) > 0);
+
+		if(lockCount(previous) == 1)
+		{
+			if(blocked)
+			{
+				unblock.signal();
+			}
+			else if(orphaned)
+			{
+				return true;
+			}
+		}
+
+		return false;
 	}
 
 	void Resource::destruct()
 	{
 		criticalSection.lock();
 
-		if(count == 0 && !blocked)
+		if(lockCount(state) == 0 && !blocked)
 		{
 			criticalSection.unlock();
 
@@ -181,4 +234,57 @@ namespace sw
 	{
 		return buffer;
 	}
+
+	ResourcePool::ResourcePool(size_t bytes) : bytes(bytes)
+	{
+	}
+
+	ResourcePool::~ResourcePool()
+	{
+		resize(0);
+	}
+
+	Resource *ResourcePool::acquire()
+	{
+		for(size_t i = 0; i < retired.size(); i++)
+		{
+			Resource *resource = retired[i];
+
+			// Draws still reading the resource hold a lock on it. No new ones can start,
+			// so it stays unlocked once the lock has been observed to be free.
+			if(resource->tryLock(PUBLIC))
+			{
+				resource->unlock();
+				retired.erase(retired.begin() + i);
+
+				return resource;
+			}
+		}
+
+		return new Resource(bytes);
+	}
+
+	void ResourcePool::retire(Resource *resource)
+	{
+		const size_t maxRetired = 3;   // Enough for the draws in flight, without hoarding memory
+
+		if(retired.size() == maxRetired)
+		{
+			retired.front()->destruct();
+			retired.erase(retired.begin());
+		}
+
+		retired.push_back(resource);
+	}
+
+	void ResourcePool::resize(size_t bytes)
+	{
+		for(Resource *resource : retired)
+		{
+			resource->destruct();
+		}
+
+		retired.clear();
+		this->bytes = bytes;
+	}
 }
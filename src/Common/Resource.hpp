@@ -17,6 +17,9 @@
 
 #include "MutexLock.hpp"
 
+#include <atomic>
+#include <vector>
+
 namespace sw
 {
 	enum Accessor
@@ -36,25 +39,50 @@ namespace sw
 
 		void *lock(Accessor claimer);
 		void *lock(Accessor relinquisher, Accessor claimer);
+		bool tryLock(Accessor claimer);   // Only succeeds when unlocked, never blocks
 		void unlock();
 		void unlock(Accessor relinquisher);
 
 		const void *data() const;
 		const size_t size;
 
+		static double lockWaitSeconds();   // Total time threads spent blocked on locks held by another accessor
+
 	private:
 		~Resource();   // Always call destruct() instead
 
+		void acquire(Accessor claimer);
+		bool release();
+
 		MutexLock criticalSection;
 		Event unblock;
 		volatile int blocked;
 
-		volatile Accessor accessor;
-		volatile int count;
+		// Lock count and accessor packed together, so locks sharing the
+		// current accessor can be taken without the critical section
+		std::atomic<unsigned int> state;
 		bool orphaned;
 
 		void *buffer;
 	};
+
+	// Recycles equally sized resources once the renderer stops reading them, so
+	// streaming buffers don't get freed and reallocated each time they fill up.
+	class ResourcePool
+	{
+	public:
+		explicit ResourcePool(size_t bytes);
+
+		~ResourcePool();
+
+		Resource *acquire();   // A retired resource which is no longer locked, or a new one
+		void retire(Resource *resource);
+		void resize(size_t bytes);   // Destructs the retired resources of the old size
+
+	private:
+		size_t bytes;
+		std::vector<Resource*> retired;   // Oldest first
+	};
 }
 
 #endif   // sw_Resource_hpp
@@ -50,6 +50,43 @@ namespace sw
 		}
 	}
 
+	bool Thread::setAffinity(const std::vector<int> &processors)
+	{
+		if(processors.empty())
+		{
+			return false;
+		}
+
+		#if defined(_WIN32)
+			DWORD_PTR mask = 0;
+
+			for(int processor : processors)
+			{
+				if(processor < (int)(8 * sizeof(DWORD_PTR)))
+				{
+					mask |= (DWORD_PTR)1 << processor;
+				}
+			}
+
+			return mask && SetThreadAffinityMask(handle, mask) != 0;
+		#elif defined(__linux__)
+			cpu_set_t cpuSet;
+			CPU_ZERO(&cpuSet);
+
+			for(int processor : processors)
+			{
+				if(processor < CPU_SETSIZE)
+				{
+					CPU_SET(processor, &cpuSet);
+				}
+			}
+
+			return pthread_setaffinity_np(handle, sizeof(cpu_set_t), &cpuSet) == 0;
+		#else
+			return false;   // Affinity can't be set on this platform
+		#endif
+	}
+
 	#if defined(_WIN32)
 		unsigned long __stdcall Thread::startFunction(void *parameters)
 		{
@@ -70,6 +107,8 @@ namespace sw
 
 	Event::Event()
 	{
+		spinLimit = 0x7FFFFFFF;
+
 		#if defined(_WIN32)
 			handle = CreateEvent(NULL, FALSE, FALSE, NULL);
 		#else
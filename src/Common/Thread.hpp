@@ -24,11 +24,13 @@
 #else
 	#include <pthread.h>
 	#include <sched.h>
+	#include <time.h>
 	#include <unistd.h>
 	#define TLS_OUT_OF_INDEXES (pthread_key_t)(~0)
 #endif
 
 #include <stdlib.h>
+#include <vector>
 
 #if defined(__clang__)
 #if __has_include(<atomic>) // clang has an explicit check for the availability of atomic
@@ -55,6 +57,7 @@ namespace sw
 		~Thread();
 
 		void join();
+		bool setAffinity(const std::vector<int> &processors);   // Restricts the thread to run on the given processors
 
 		static void yield();
 		static void sleep(int milliseconds);
@@ -101,8 +104,11 @@ namespace sw
 
 		void signal();
 		void wait();
+		void wait(int spinCount);   // Spins for up to this many iterations before blocking
+		bool wait(double seconds);  // Returns false if the event wasn't signaled in time
 
 	private:
+		int spinLimit;   // Adapts to whether spinning caught recent signals
 		#if defined(_WIN32)
 			HANDLE handle;
 		#else
@@ -234,6 +240,80 @@ namespace sw
 		#endif
 	}
 
+	inline void Event::wait(int spinCount)
+	{
+		if(spinLimit > spinCount)
+		{
+			spinLimit = spinCount;
+		}
+
+		// Poll with exponential backoff, so signals arriving shortly don't cost blocking in the kernel
+		int spun = 0;
+
+		for(int pause = 1; spun < spinLimit; pause = (pause < 64) ? 2 * pause : 64)
+		{
+			#if defined(_WIN32)
+				if(WaitForSingleObject(handle, 0) == WAIT_OBJECT_0)
+				{
+					spinLimit = (spinLimit < spinCount / 2) ? 2 * spinLimit : spinCount;
+					return;
+				}
+			#else
+				if(signaled)
+				{
+					break;
+				}
+			#endif
+
+			for(int i = 0; i < pause; i++)
+			{
+				nop();
+			}
+
+			spun += pause;
+		}
+
+		// Spin less after missing the signal, and more after catching it
+		if(spun < spinLimit)
+		{
+			spinLimit = (spinLimit < spinCount / 2) ? 2 * spinLimit : spinCount;
+		}
+		else
+		{
+			spinLimit = (spinLimit + 1) / 2;
+		}
+
+		wait();
+	}
+
+	inline bool Event::wait(double seconds)
+	{
+		if(seconds > 3600.0)
+		{
+			seconds = 3600.0;   // Waiting longer is left to the caller's loop, so the deadline can't overflow
+		}
+
+		#if defined(_WIN32)
+			DWORD milliseconds = (DWORD)(seconds * 1000.0 + 0.999);
+			return WaitForSingleObject(handle, milliseconds) == WAIT_OBJECT_0;
+		#else
+			timespec deadline;
+			clock_gettime(CLOCK_REALTIME, &deadline);
+			long nanoseconds = deadline.tv_nsec + (long)((seconds - (long)seconds) * 1.0e9);
+			deadline.tv_sec += (time_t)seconds + nanoseconds / 1000000000;
+			deadline.tv_nsec = nanoseconds % 1000000000;
+
+			pthread_mutex_lock(&mutex);
+			int result = 0;
+			while(!signaled && result == 0) result = pthread_cond_timedwait(&handle, &mutex, &deadline);
+			bool wasSignaled = signaled;
+			signaled = false;
+			pthread_mutex_unlock(&mutex);
+
+			return wasSignaled;
+		#endif
+	}
+
 	#if PERF_PROFILE
 	inline int64_t atomicExchange(volatile int64_t *target, int64_t value)
 	{
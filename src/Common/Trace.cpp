@@ -0,0 +1,179 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Trace.hpp"
+
+#include "Timer.hpp"
+
+#include <mutex>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace
+{
+	struct Event
+	{
+		const char *name;
+		int64_t start;
+		int64_t duration;
+		int id;
+		char phase;   // 'X' complete, 'b'/'e' async begin/end, 'M' thread name
+	};
+
+	struct ThreadEvents
+	{
+		std::mutex mutex;   // Only contended when the trace gets written
+		std::vector<Event> events;
+		int tid;
+	};
+
+	const size_t maxEventsPerThread = 1 << 22;   // Bounds the memory use of long traces
+
+	// Buffers are kept until the trace is written, also those of exited threads
+	class Recorder
+	{
+	public:
+		~Recorder()
+		{
+			write();
+
+			for(ThreadEvents *thread : threads)
+			{
+				delete thread;
+			}
+		}
+
+		ThreadEvents *registerThread()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			ThreadEvents *thread = new ThreadEvents();
+			thread->tid = (int)threads.size() + 1;
+			threads.push_back(thread);
+
+			return thread;
+		}
+
+	private:
+		void write()
+		{
+			const char *path = getenv("SWIFTSHADER_TRACE_FILE");
+			FILE *file = path ? fopen(path, "w") : nullptr;
+
+			if(!file)
+			{
+				return;
+			}
+
+			std::lock_guard<std::mutex> lock(mutex);
+
+			double scale = 1.0e6 / (double)sw::Timer::frequency();   // Events are timed in microseconds
+			const char *separator = "";
+
+			fprintf(file, "{\"traceEvents\":[\n");
+
+			for(ThreadEvents *thread : threads)
+			{
+				std::lock_guard<std::mutex> threadLock(thread->mutex);
+
+				for(const Event &event : thread->events)
+				{
+					switch(event.phase)
+					{
+					case 'X':
+						fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+						        separator, event.name, thread->tid, event.start * scale, event.duration * scale);
+						break;
+					case 'b':
+					case 'e':
+						fprintf(file, "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"id\":%d",
+						        separator, event.name, event.name, event.phase, thread->tid, event.start * scale, event.id);
+						break;
+					case 'M':
+						fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s %d\"}}",
+						        separator, thread->tid, event.name, event.id);
+						separator = ",\n";
+						continue;
+					default:
+						continue;
+					}
+
+					if(event.id >= 0 && event.phase == 'X')
+					{
+						fprintf(file, ",\"args\":{\"id\":%d}", event.id);
+					}
+
+					fprintf(file, "}");
+					separator = ",\n";
+				}
+			}
+
+			fprintf(file, "\n]}\n");
+			fclose(file);
+		}
+
+		std::mutex mutex;
+		std::vector<ThreadEvents*> threads;
+	};
+
+	Recorder recorder;
+
+	void record(const Event &event)
+	{
+		static thread_local ThreadEvents *thread = nullptr;
+
+		if(!thread)
+		{
+			thread = recorder.registerThread();
+		}
+
+		std::lock_guard<std::mutex> lock(thread->mutex);
+
+		if(thread->events.size() < maxEventsPerThread)
+		{
+			thread->events.push_back(event);
+		}
+	}
+}
+
+namespace sw
+{
+	const bool Trace::active = getenv("SWIFTSHADER_TRACE_FILE") != nullptr;
+
+	int64_t Trace::now()
+	{
+		return Timer::counter();
+	}
+
+	void Trace::span(const char *name, int64_t start, int64_t end, int id)
+	{
+		record({name, start, end - start, id, 'X'});
+	}
+
+	void Trace::beginAsync(const char *name, int id)
+	{
+		record({name, now(), 0, id, 'b'});
+	}
+
+	void Trace::endAsync(const char *name, int id)
+	{
+		record({name, now(), 0, id, 'e'});
+	}
+
+	void Trace::threadName(const char *name, int index)
+	{
+		record({name, 0, 0, index, 'M'});
+	}
+}
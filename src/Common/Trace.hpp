@@ -0,0 +1,68 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef sw_Trace_hpp
+#define sw_Trace_hpp
+
+#include "Types.hpp"
+
+namespace sw
+{
+	// Timeline tracing in the Chrome Trace Event format, for chrome://tracing
+	// or ui.perfetto.dev. Enabled by setting SWIFTSHADER_TRACE_FILE to the path
+	// of the JSON file, which gets written when the library is unloaded.
+	// Event names must be string literals, only their pointers are recorded.
+	class Trace
+	{
+	public:
+		static bool enabled()
+		{
+			return active;
+		}
+
+		static int64_t now();
+
+		static void span(const char *name, int64_t start, int64_t end, int id = -1);   // Complete event on the calling thread
+		static void beginAsync(const char *name, int id);   // Spans started and finished on different threads
+		static void endAsync(const char *name, int id);
+		static void threadName(const char *name, int index);   // Labels the calling thread "name index"
+
+	private:
+		static const bool active;
+	};
+
+	// Records the lifetime of the scope as a span on the calling thread
+	class TraceScope
+	{
+	public:
+		TraceScope(const char *name, int id = -1) : name(name), id(id), start(Trace::enabled() ? Trace::now() : 0)
+		{
+		}
+
+		~TraceScope()
+		{
+			if(Trace::enabled())
+			{
+				Trace::span(name, start, Trace::now(), id);
+			}
+		}
+
+	private:
+		const char *const name;
+		const int id;
+		const int64_t start;
+	};
+}
+
+#endif   // sw_Trace_hpp
@@ -78,6 +78,20 @@ namespace D3D9
 
 		cursor = 0;
 
+		memset(renderStateDirty, 0, sizeof(renderStateDirty));
+		memset(samplerStateDirty, 0, sizeof(samplerStateDirty));
+		memset(textureStageStateDirty, 0, sizeof(textureStageStateDirty));
+		dirtyRenderStateCount = 0;
+		dirtySamplerStateCount = 0;
+		dirtyTextureStageStateCount = 0;
+
+		userVertexBuffer = 0;
+		userIndexBuffer = 0;
+		userVertexBufferSize = 0;
+		userIndexBufferSize = 0;
+		userVertexOffset = 0;
+		userIndexOffset = 0;
+
 		Reset(presentParameters);
 
 		pixelShader = 0;
@@ -246,6 +260,18 @@ namespace D3D9
 			indexData = 0;
 		}
 
+		if(userVertexBuffer)
+		{
+			userVertexBuffer->unbind();
+			userVertexBuffer = 0;
+		}
+
+		if(userIndexBuffer)
+		{
+			userIndexBuffer->unbind();
+			userIndexBuffer = 0;
+		}
+
 		if(pixelShader)
 		{
 			pixelShader->unbind();
@@ -1074,14 +1100,8 @@ namespace D3D9
 
 		int length = (minIndex + numVertices) * vertexStreamZeroStride;
 
-		Direct3DVertexBuffer9 *vertexBuffer = new Direct3DVertexBuffer9(this, length, 0, 0, D3DPOOL_DEFAULT);
-
-		void *data;
-		vertexBuffer->Lock(0, 0, &data, 0);
-		memcpy(data, vertexStreamZeroData, length);
-		vertexBuffer->Unlock();
-
-		SetStreamSource(0, vertexBuffer, 0, vertexStreamZeroStride);
+		unsigned int vertexOffset = streamUserVertices(vertexStreamZeroData, length);
+		SetStreamSource(0, userVertexBuffer, vertexOffset, vertexStreamZeroStride);
 
 		switch(type)
 		{
@@ -1097,17 +1117,13 @@ namespace D3D9
 
 		length *= indexDataFormat == D3DFMT_INDEX32 ? 4 : 2;
 
-		Direct3DIndexBuffer9 *indexBuffer = new Direct3DIndexBuffer9(this, length, 0, indexDataFormat, D3DPOOL_DEFAULT);
-
-		indexBuffer->Lock(0, 0, &data, 0);
-		memcpy(data, indexData, length);
-		indexBuffer->Unlock();
-
-		SetIndices(indexBuffer);
+		unsigned int indexOffset = streamUserIndices(indexData, length);
+		SetIndices(userIndexBuffer);
 
-		if(!bindResources(indexBuffer) || !primitiveCount)
+		if(!bindResources(userIndexBuffer) || !primitiveCount)
 		{
-			vertexBuffer->Release();
+			SetStreamSource(0, 0, 0, 0);
+			SetIndices(0);
 
 			return D3D_OK;
 		}
@@ -1144,7 +1160,7 @@ namespace D3D9
 		}
 
 		bindVertexStreams(0, false, 0);
-		renderer->draw(drawType, 0, primitiveCount);
+		renderer->draw(drawType, indexOffset, primitiveCount);
 
 		SetStreamSource(0, 0, 0, 0);
 		SetIndices(0);
@@ -1194,7 +1210,6 @@ namespace D3D9
 			return INVALIDCALL();
 		}
 
-		IDirect3DVertexBuffer9 *vertexBuffer = 0;
 		int length = 0;
 
 		switch(primitiveType)
@@ -1211,18 +1226,12 @@ namespace D3D9
 
 		length *= vertexStreamZeroStride;
 
-		CreateVertexBuffer(length, 0, 0, D3DPOOL_DEFAULT, &vertexBuffer, 0);
-
-		void *data;
-		vertexBuffer->Lock(0, 0, &data, 0);
-		memcpy(data, vertexStreamZeroData, length);
-		vertexBuffer->Unlock();
-
-		SetStreamSource(0, vertexBuffer, 0, vertexStreamZeroStride);
+		unsigned int vertexOffset = streamUserVertices(vertexStreamZeroData, length);
+		SetStreamSource(0, userVertexBuffer, vertexOffset, vertexStreamZeroStride);
 
 		if(!bindResources(0) || !primitiveCount)
 		{
-			vertexBuffer->Release();
+			SetStreamSource(0, 0, 0, 0);
 
 			return D3D_OK;
 		}
@@ -1245,7 +1254,6 @@ namespace D3D9
 		renderer->draw(drawType, 0, primitiveCount);
 
 		SetStreamSource(0, 0, 0, 0);
-		vertexBuffer->Release();
 
 		return D3D_OK;
 	}
@@ -1309,6 +1317,8 @@ namespace D3D9
 			return INVALIDCALL();
 		}
 
+		stateRecorder->compile();
+
 		*stateBlock = stateRecorder;
 		stateRecorder->AddRef();
 		stateRecorder->unbind();
@@ -1829,7 +1839,7 @@ namespace D3D9
 			void *sourceBuffer = source->lockExternal(0, 0, 0, sw::LOCK_READONLY, sw::PUBLIC);
 			void *destBuffer = dest->lockExternal(0, 0, 0, sw::LOCK_WRITEONLY, sw::PUBLIC);
 
-			static void (__cdecl *blitFunction)(void *dst, void *src);
+			static void (__cdecl *blitFunction)(void *dst, void *src, void *cursor, sw::Rect *region);
 			static sw::Routine *blitRoutine;
 			static sw::BlitState blitState = {};
 
@@ -1849,10 +1859,11 @@ namespace D3D9
 				delete blitRoutine;
 
 				blitRoutine = sw::FrameBuffer::copyRoutine(blitState);
-				blitFunction = (void(__cdecl*)(void*, void*))blitRoutine->getEntry();
+				blitFunction = (void(__cdecl*)(void*, void*, void*, sw::Rect*))blitRoutine->getEntry();
 			}
 
-			blitFunction(destBuffer, sourceBuffer);
+			sw::Rect region(0, 0, update.width, update.height);
+			blitFunction(destBuffer, sourceBuffer, nullptr, &region);
 
 			dest->unlockExternal();
 			source->unlockExternal();
@@ -3032,2672 +3043,2705 @@ namespace D3D9
 
 		if(!stateRecorder)
 		{
-			if(!init && renderState[state] == value)
+			updateRenderState(state, value);
+		}
+		else   // stateRecorder
+		{
+			stateRecorder->setRenderState(state, value);
+		}
+
+		return D3D_OK;
+	}
+
+	long Direct3DDevice9::SetRenderTarget(unsigned long index, IDirect3DSurface9 *iRenderTarget)
+	{
+		CriticalSection cs(this);
+
+		TRACE("unsigned long index = %d, IDirect3DSurface9 *newRenderTarget = 0x%0.8p", index, iRenderTarget);
+
+		// FIXME: Check for D3DUSAGE_RENDERTARGET
+
+		if(index >= 4 || (index == 0 && !iRenderTarget))
+		{
+			return INVALIDCALL();
+		}
+
+		Direct3DSurface9 *renderTarget = static_cast<Direct3DSurface9*>(iRenderTarget);
+
+		if(renderTarget)
+		{
+			renderTarget->bind();
+		}
+
+		if(this->renderTarget[index])
+		{
+			this->renderTarget[index]->unbind();
+		}
+
+		this->renderTarget[index] = renderTarget;
+
+		if(renderTarget && index == 0)
+		{
+			D3DSURFACE_DESC renderTargetDesc;
+			renderTarget->GetDesc(&renderTargetDesc);
+
+			// Reset viewport to size of current render target
+			viewport.X = 0;
+			viewport.Y = 0;
+			viewport.Width = renderTargetDesc.Width;
+			viewport.Height = renderTargetDesc.Height;
+			viewport.MinZ = 0;
+			viewport.MaxZ = 1;
+
+			// Reset scissor rectangle to size of current render target
+			scissorRect.left = 0;
+			scissorRect.top = 0;
+			scissorRect.right = renderTargetDesc.Width;
+			scissorRect.bottom = renderTargetDesc.Height;
+
+			// Set the multi-sample mask, if maskable
+			if(renderTargetDesc.MultiSampleType != D3DMULTISAMPLE_NONE &&
+			   renderTargetDesc.MultiSampleType != D3DMULTISAMPLE_NONMASKABLE)
+			{
+				renderer->setMultiSampleMask(renderState[D3DRS_MULTISAMPLEMASK]);
+			}
+			else
+			{
+				renderer->setMultiSampleMask(0xFFFFFFFF);
+			}
+		}
+
+		renderer->setRenderTarget(index, renderTarget);
+
+		return D3D_OK;
+	}
+
+	long Direct3DDevice9::SetSamplerState(unsigned long sampler, D3DSAMPLERSTATETYPE state, unsigned long value)
+	{
+		CriticalSection cs(this);
+
+		TRACE("unsigned long sampler = %d, D3DSAMPLERSTATETYPE state = %d, unsigned long value = %d", sampler, state, value);
+
+		if(state < D3DSAMP_ADDRESSU || state > D3DSAMP_DMAPOFFSET)
+		{
+			return INVALIDCALL();
+		}
+
+		if((sampler >= 16 && sampler <= D3DDMAPSAMPLER) || sampler > D3DVERTEXTEXTURESAMPLER3)
+		{
+			return INVALIDCALL();
+		}
+
+		if(sampler >= D3DVERTEXTEXTURESAMPLER0)
+		{
+			sampler = 16 + (sampler - D3DVERTEXTEXTURESAMPLER0);
+		}
+
+		if((state == D3DSAMP_MAGFILTER || state == D3DSAMP_MINFILTER || state == D3DSAMP_MIPFILTER) && value > D3DTEXF_GAUSSIANQUAD)
+		{
+			return INVALIDCALL();
+		}
+
+		if(!stateRecorder)
+		{
+			updateSamplerState(sampler, state, value);
+		}
+		else   // stateRecorder
+		{
+			stateRecorder->setSamplerState(sampler, state, value);
+		}
+
+		return D3D_OK;
+	}
+
+	long Direct3DDevice9::SetScissorRect(const RECT *rect)
+	{
+		CriticalSection cs(this);
+
+		TRACE("const RECT *rect = 0x%0.8p", rect);
+
+		if(!rect)
+		{
+			return INVALIDCALL();
+		}
+
+		if(!stateRecorder)
+		{
+			scissorRect = *rect;
+		}
+		else
+		{
+			stateRecorder->setScissorRect(rect);
+		}
+
+		return D3D_OK;
+	}
+
+	long Direct3DDevice9::SetSoftwareVertexProcessing(int software)
+	{
+		CriticalSection cs(this);
+
+		TRACE("int software = %d", software);
+
+		if(behaviourFlags & D3DCREATE_SOFTWARE_VERTEXPROCESSING && software == FALSE)
+		{
+			return INVALIDCALL();
+		}
+
+		if(behaviourFlags & D3DCREATE_HARDWARE_VERTEXPROCESSING && software == TRUE)
+		{
+			return INVALIDCALL();
+		}
+
+		softwareVertexProcessing = (software != FALSE);
+
+		return D3D_OK;
+	}
+
+	long Direct3DDevice9::SetStreamSource(unsigned int stream, IDirect3DVertexBuffer9 *iVertexBuffer, unsigned int offset, unsigned int stride)
+	{
+		CriticalSection cs(this);
+
+		TRACE("unsigned int stream = %d, IDirect3DVertexBuffer9 *data = 0x%0.8p, unsigned int offset = %d, unsigned int stride = %d", stream, iVertexBuffer, offset, stride);
+
+		Direct3DVertexBuffer9 *vertexBuffer = static_cast<Direct3DVertexBuffer9*>(iVertexBuffer);
+
+		if(!stateRecorder)
+		{
+			if(dataStream[stream] == vertexBuffer && streamOffset[stream] == offset && streamStride[stream] == stride)
 			{
 				return D3D_OK;
 			}
 
-			renderState[state] = value;
+			if(vertexBuffer)
+			{
+				vertexBuffer->bind();
+			}
 
-			switch(state)
+			if(dataStream[stream])
 			{
-			case D3DRS_ZENABLE:
-				switch(value)
-				{
-				case D3DZB_TRUE:
-				case D3DZB_USEW:
-					renderer->setDepthBufferEnable(true);
-					break;
-				case D3DZB_FALSE:
-					renderer->setDepthBufferEnable(false);
-					break;
-				default:
-					ASSERT(false);
-				}
-				break;
-			case D3DRS_FILLMODE:
-				switch(value)
-				{
-				case D3DFILL_POINT:
-					renderer->setFillMode(sw::FILL_VERTEX);
-					break;
-				case D3DFILL_WIREFRAME:
-					renderer->setFillMode(sw::FILL_WIREFRAME);
-					break;
-				case D3DFILL_SOLID:
-					renderer->setFillMode(sw::FILL_SOLID);
-					break;
-				default:
-					ASSERT(false);
-				}
-				break;
-			case D3DRS_SHADEMODE:
-				switch(value)
-				{
-				case D3DSHADE_FLAT:
-					renderer->setShadingMode(sw::SHADING_FLAT);
-					break;
-				case D3DSHADE_GOURAUD:
-					renderer->setShadingMode(sw::SHADING_GOURAUD);
-					break;
-				case D3DSHADE_PHONG:
-					break;
-				default:
-					ASSERT(false);
-				}
-				break;
-			case D3DRS_ZWRITEENABLE:
-				renderer->setDepthWriteEnable(value != FALSE);
-				break;
-			case D3DRS_ALPHATESTENABLE:
-				renderer->setAlphaTestEnable(value != FALSE);
-				break;
-			case D3DRS_LASTPIXEL:
-			//	if(!init) UNIMPLEMENTED();   // FIXME
-				break;
-			case D3DRS_SRCBLEND:
-				switch(value)
-				{
-				case D3DBLEND_ZERO:
-					renderer->setSourceBlendFactor(sw::BLEND_ZERO);
-					break;
-				case D3DBLEND_ONE:
-					renderer->setSourceBlendFactor(sw::BLEND_ONE);
-					break;
-				case D3DBLEND_SRCCOLOR:
-					renderer->setSourceBlendFactor(sw::BLEND_SOURCE);
-					break;
-				case D3DBLEND_INVSRCCOLOR:
-					renderer->setSourceBlendFactor(sw::BLEND_INVSOURCE);
-					break;
-				case D3DBLEND_SRCALPHA:
-					renderer->setSourceBlendFactor(sw::BLEND_SOURCEALPHA);
-					break;
-				case D3DBLEND_INVSRCALPHA:
-					renderer->setSourceBlendFactor(sw::BLEND_INVSOURCEALPHA);
-					break;
-				case D3DBLEND_DESTALPHA:
-					renderer->setSourceBlendFactor(sw::BLEND_DESTALPHA);
-					break;
-				case D3DBLEND_INVDESTALPHA:
-					renderer->setSourceBlendFactor(sw::BLEND_INVDESTALPHA);
-					break;
-				case D3DBLEND_DESTCOLOR:
-					renderer->setSourceBlendFactor(sw::BLEND_DEST);
-					break;
-				case D3DBLEND_INVDESTCOLOR:
-					renderer->setSourceBlendFactor(sw::BLEND_INVDEST);
-					break;
-				case D3DBLEND_SRCALPHASAT:
-					renderer->setSourceBlendFactor(sw::BLEND_SRCALPHASAT);
-					break;
-				case D3DBLEND_BOTHSRCALPHA:
-					renderer->setSourceBlendFactor(sw::BLEND_SOURCEALPHA);
-					renderer->setDestBlendFactor(sw::BLEND_INVSOURCEALPHA);
-					break;
-				case D3DBLEND_BOTHINVSRCALPHA:
-					renderer->setSourceBlendFactor(sw::BLEND_INVSOURCEALPHA);
-					renderer->setDestBlendFactor(sw::BLEND_SOURCEALPHA);
-					break;
-				case D3DBLEND_BLENDFACTOR:
-					renderer->setSourceBlendFactor(sw::BLEND_CONSTANT);
-					break;
-				case D3DBLEND_INVBLENDFACTOR:
-					renderer->setSourceBlendFactor(sw::BLEND_INVCONSTANT);
-					break;
-				default:
-					ASSERT(false);
-				}
-				break;
-			case D3DRS_DESTBLEND:
-				switch(value)
-				{
-				case D3DBLEND_ZERO:
-					renderer->setDestBlendFactor(sw::BLEND_ZERO);
-					break;
-				case D3DBLEND_ONE:
-					renderer->setDestBlendFactor(sw::BLEND_ONE);
-					break;
-				case D3DBLEND_SRCCOLOR:
-					renderer->setDestBlendFactor(sw::BLEND_SOURCE);
-					break;
-				case D3DBLEND_INVSRCCOLOR:
-					renderer->setDestBlendFactor(sw::BLEND_INVSOURCE);
-					break;
-				case D3DBLEND_SRCALPHA:
-					renderer->setDestBlendFactor(sw::BLEND_SOURCEALPHA);
-					break;
-				case D3DBLEND_INVSRCALPHA:
-					renderer->setDestBlendFactor(sw::BLEND_INVSOURCEALPHA);
-					break;
-				case D3DBLEND_DESTALPHA:
-					renderer->setDestBlendFactor(sw::BLEND_DESTALPHA);
-					break;
-				case D3DBLEND_INVDESTALPHA:
-					renderer->setDestBlendFactor(sw::BLEND_INVDESTALPHA);
-					break;
-				case D3DBLEND_DESTCOLOR:
-					renderer->setDestBlendFactor(sw::BLEND_DEST);
-					break;
-				case D3DBLEND_INVDESTCOLOR:
-					renderer->setDestBlendFactor(sw::BLEND_INVDEST);
-					break;
-				case D3DBLEND_SRCALPHASAT:
-					renderer->setDestBlendFactor(sw::BLEND_SRCALPHASAT);
-					break;
-				case D3DBLEND_BOTHSRCALPHA:
-					renderer->setSourceBlendFactor(sw::BLEND_SOURCEALPHA);
-					renderer->setDestBlendFactor(sw::BLEND_INVSOURCEALPHA);
-					break;
-				case D3DBLEND_BOTHINVSRCALPHA:
-					renderer->setSourceBlendFactor(sw::BLEND_INVSOURCEALPHA);
-					renderer->setDestBlendFactor(sw::BLEND_SOURCEALPHA);
-					break;
-				case D3DBLEND_BLENDFACTOR:
-					renderer->setDestBlendFactor(sw::BLEND_CONSTANT);
-					break;
-				case D3DBLEND_INVBLENDFACTOR:
-					renderer->setDestBlendFactor(sw::BLEND_INVCONSTANT);
-					break;
-				default:
-					ASSERT(false);
-				}
-				break;
-			case D3DRS_CULLMODE:
-				switch(value)
-				{
-				case D3DCULL_NONE:
-					renderer->setCullMode(sw::CULL_NONE, true);
-					break;
-				case D3DCULL_CCW:
-					renderer->setCullMode(sw::CULL_COUNTERCLOCKWISE, true);
-					break;
-				case D3DCULL_CW:
-					renderer->setCullMode(sw::CULL_CLOCKWISE, true);
-					break;
-				default:
-					ASSERT(false);
-				}
-				break;
-			case D3DRS_ZFUNC:
-				switch(value)
-				{
-				case D3DCMP_NEVER:
-					renderer->setDepthCompare(sw::DEPTH_NEVER);
-					break;
-				case D3DCMP_LESS:
-					renderer->setDepthCompare(sw::DEPTH_LESS);
-					break;
-				case D3DCMP_EQUAL:
-					renderer->setDepthCompare(sw::DEPTH_EQUAL);
-					break;
-				case D3DCMP_LESSEQUAL:
-					renderer->setDepthCompare(sw::DEPTH_LESSEQUAL);
-					break;
-				case D3DCMP_GREATER:
-					renderer->setDepthCompare(sw::DEPTH_GREATER);
-					break;
-				case D3DCMP_NOTEQUAL:
-					renderer->setDepthCompare(sw::DEPTH_NOTEQUAL);
-					break;
-				case D3DCMP_GREATEREQUAL:
-					renderer->setDepthCompare(sw::DEPTH_GREATEREQUAL);
-					break;
-				case D3DCMP_ALWAYS:
-					renderer->setDepthCompare(sw::DEPTH_ALWAYS);
-					break;
-				default:
-					ASSERT(false);
-				}
-				break;
-			case D3DRS_ALPHAREF:
-				renderer->setAlphaReference(value & 0x000000FF);
-				break;
-			case D3DRS_ALPHAFUNC:
-				switch(value)
-				{
-				case D3DCMP_NEVER:
-					renderer->setAlphaCompare(sw::ALPHA_NEVER);
-					break;
-				case D3DCMP_LESS:
-					renderer->setAlphaCompare(sw::ALPHA_LESS);
-					break;
-				case D3DCMP_EQUAL:
-					renderer->setAlphaCompare(sw::ALPHA_EQUAL);
-					break;
-				case D3DCMP_LESSEQUAL:
-					renderer->setAlphaCompare(sw::ALPHA_LESSEQUAL);
-					break;
-				case D3DCMP_GREATER:
-					renderer->setAlphaCompare(sw::ALPHA_GREATER);
-					break;
-				case D3DCMP_NOTEQUAL:
-					renderer->setAlphaCompare(sw::ALPHA_NOTEQUAL);
-					break;
-				case D3DCMP_GREATEREQUAL:
-					renderer->setAlphaCompare(sw::ALPHA_GREATEREQUAL);
-					break;
-				case D3DCMP_ALWAYS:
-					renderer->setAlphaCompare(sw::ALPHA_ALWAYS);
-					break;
-				default:
-					ASSERT(false);
-				}
-				break;
-			case D3DRS_DITHERENABLE:
-			//	if(!init) UNIMPLEMENTED();
-				break;
-			case D3DRS_ALPHABLENDENABLE:
-				renderer->setAlphaBlendEnable(value != FALSE);
-				break;
-			case D3DRS_FOGENABLE:
-				renderer->setFogEnable(value != FALSE);
-				break;
-			case D3DRS_FOGCOLOR:
-				renderer->setFogColor(value);
+				dataStream[stream]->unbind();
+			}
+
+			dataStream[stream] = vertexBuffer;
+			streamOffset[stream] = offset;
+			streamStride[stream] = stride;
+		}
+		else
+		{
+			stateRecorder->setStreamSource(stream, vertexBuffer, offset, stride);
+		}
+
+		return D3D_OK;
+	}
+
+	long Direct3DDevice9::SetStreamSourceFreq(unsigned int streamNumber, unsigned int divider)
+	{
+		CriticalSection cs(this);
+
+		TRACE("unsigned int streamNumber = %d, unsigned int divider = %d", streamNumber, divider);
+
+		if(!instancingEnabled)
+		{
+			return INVALIDCALL();
+		}
+
+		if(!stateRecorder)
+		{
+			streamSourceFreq[streamNumber] = divider;
+		}
+		else
+		{
+			stateRecorder->setStreamSourceFreq(streamNumber, divider);
+		}
+
+		return D3D_OK;
+	}
+
+	long Direct3DDevice9::SetTexture(unsigned long sampler, IDirect3DBaseTexture9 *iBaseTexture)
+	{
+		CriticalSection cs(this);
+
+		TRACE("unsigned long sampler = %d, IDirect3DBaseTexture9 *texture = 0x%0.8p", sampler, iBaseTexture);
+
+		if((sampler >= 16 && sampler <= D3DDMAPSAMPLER) || sampler > D3DVERTEXTEXTURESAMPLER3)
+		{
+			return INVALIDCALL();
+		}
+
+		if(sampler >= D3DVERTEXTEXTURESAMPLER0)
+		{
+			sampler = 16 + (sampler - D3DVERTEXTEXTURESAMPLER0);
+		}
+
+		Direct3DBaseTexture9 *baseTexture = dynamic_cast<Direct3DBaseTexture9*>(iBaseTexture);
+
+		if(!stateRecorder)
+		{
+			if(texture[sampler] == baseTexture)
+			{
+				return D3D_OK;
+			}
+
+			if(baseTexture)
+			{
+				baseTexture->bind();   // FIXME: Bind individual sub-surfaces?
+			}
+
+			if(texture[sampler])
+			{
+				texture[sampler]->unbind();
+			}
+
+			texture[sampler] = baseTexture;
+		}
+		else
+		{
+			stateRecorder->setTexture(sampler, baseTexture);
+		}
+
+		return D3D_OK;
+	}
+
+	long Direct3DDevice9::SetTextureStageState(unsigned long stage, D3DTEXTURESTAGESTATETYPE type, unsigned long value)
+	{
+		CriticalSection cs(this);
+
+		TRACE("unsigned long stage = %d, D3DTEXTURESTAGESTATETYPE type = %d, unsigned long value = %d", stage, type, value);
+
+		if(stage < 0 || stage >= 8 || type < D3DTSS_COLOROP || type > D3DTSS_CONSTANT)
+		{
+			return INVALIDCALL();
+		}
+
+		if(!stateRecorder)
+		{
+			updateTextureStageState(stage, type, value);
+		}
+		else   // stateRecorder
+		{
+			stateRecorder->setTextureStageState(stage, type, value);
+		}
+
+		return D3D_OK;
+	}
+
+	long Direct3DDevice9::SetTransform(D3DTRANSFORMSTATETYPE state, const D3DMATRIX *matrix)
+	{
+		CriticalSection cs(this);
+
+		TRACE("D3DTRANSFORMSTATETYPE state = %d, const D3DMATRIX *matrix = 0x%0.8p", state, matrix);
+
+		if(!matrix)
+		{
+			return INVALIDCALL();
+		}
+
+		if(!stateRecorder)
+		{
+			this->matrix[state] = *matrix;
+
+			sw::Matrix M(matrix->_11, matrix->_21, matrix->_31, matrix->_41,
+			             matrix->_12, matrix->_22, matrix->_32, matrix->_42,
+			             matrix->_13, matrix->_23, matrix->_33, matrix->_43,
+			             matrix->_14, matrix->_24, matrix->_34, matrix->_44);
+
+			switch(state)
+			{
+			case D3DTS_WORLD:
+				renderer->setModelMatrix(M);
 				break;
-			case D3DRS_FOGTABLEMODE:
-				switch(value)
-				{
-				case D3DFOG_NONE:
-					renderer->setPixelFogMode(sw::FOG_NONE);
-					break;
-				case D3DFOG_LINEAR:
-					renderer->setPixelFogMode(sw::FOG_LINEAR);
-					break;
-				case D3DFOG_EXP:
-					renderer->setPixelFogMode(sw::FOG_EXP);
-					break;
-				case D3DFOG_EXP2:
-					renderer->setPixelFogMode(sw::FOG_EXP2);
-					break;
-				default:
-					ASSERT(false);
-				}
+			case D3DTS_VIEW:
+				renderer->setViewMatrix(M);
 				break;
-			case D3DRS_FOGSTART:
-				renderer->setFogStart((float&)value);
+			case D3DTS_PROJECTION:
+				renderer->setProjectionMatrix(M);
 				break;
-			case D3DRS_FOGEND:
-				renderer->setFogEnd((float&)value);
+			case D3DTS_TEXTURE0:
+				renderer->setTextureMatrix(0, M);
 				break;
-			case D3DRS_FOGDENSITY:
-				renderer->setFogDensity((float&)value);
+			case D3DTS_TEXTURE1:
+				renderer->setTextureMatrix(1, M);
 				break;
-			case D3DRS_RANGEFOGENABLE:
-				renderer->setRangeFogEnable(value != FALSE);
+			case D3DTS_TEXTURE2:
+				renderer->setTextureMatrix(2, M);
 				break;
-			case D3DRS_SPECULARENABLE:
-				renderer->setSpecularEnable(value != FALSE);
+			case D3DTS_TEXTURE3:
+				renderer->setTextureMatrix(3, M);
 				break;
-			case D3DRS_STENCILENABLE:
-				renderer->setStencilEnable(value != FALSE);
+			case D3DTS_TEXTURE4:
+				renderer->setTextureMatrix(4, M);
 				break;
-			case D3DRS_STENCILFAIL:
-				switch(value)
-				{
-				case D3DSTENCILOP_KEEP:
-					renderer->setStencilFailOperation(sw::OPERATION_KEEP);
-					break;
-				case D3DSTENCILOP_ZERO:
-					renderer->setStencilFailOperation(sw::OPERATION_ZERO);
-					break;
-				case D3DSTENCILOP_REPLACE:
-					renderer->setStencilFailOperation(sw::OPERATION_REPLACE);
-					break;
-				case D3DSTENCILOP_INCRSAT:
-					renderer->setStencilFailOperation(sw::OPERATION_INCRSAT);
-					break;
-				case D3DSTENCILOP_DECRSAT:
-					renderer->setStencilFailOperation(sw::OPERATION_DECRSAT);
-					break;
-				case D3DSTENCILOP_INVERT:
-					renderer->setStencilFailOperation(sw::OPERATION_INVERT);
-					break;
-				case D3DSTENCILOP_INCR:
-					renderer->setStencilFailOperation(sw::OPERATION_INCR);
-					break;
-				case D3DSTENCILOP_DECR:
-					renderer->setStencilFailOperation(sw::OPERATION_DECR);
-					break;
-				default:
-					ASSERT(false);
-				}
+			case D3DTS_TEXTURE5:
+				renderer->setTextureMatrix(5, M);
 				break;
-			case D3DRS_STENCILZFAIL:
-				switch(value)
-				{
-				case D3DSTENCILOP_KEEP:
-					renderer->setStencilZFailOperation(sw::OPERATION_KEEP);
-					break;
-				case D3DSTENCILOP_ZERO:
-					renderer->setStencilZFailOperation(sw::OPERATION_ZERO);
-					break;
-				case D3DSTENCILOP_REPLACE:
-					renderer->setStencilZFailOperation(sw::OPERATION_REPLACE);
-					break;
-				case D3DSTENCILOP_INCRSAT:
-					renderer->setStencilZFailOperation(sw::OPERATION_INCRSAT);
-					break;
-				case D3DSTENCILOP_DECRSAT:
-					renderer->setStencilZFailOperation(sw::OPERATION_DECRSAT);
-					break;
-				case D3DSTENCILOP_INVERT:
-					renderer->setStencilZFailOperation(sw::OPERATION_INVERT);
-					break;
-				case D3DSTENCILOP_INCR:
-					renderer->setStencilZFailOperation(sw::OPERATION_INCR);
-					break;
-				case D3DSTENCILOP_DECR:
-					renderer->setStencilZFailOperation(sw::OPERATION_DECR);
-					break;
-				default:
-					ASSERT(false);
-				}
+			case D3DTS_TEXTURE6:
+				renderer->setTextureMatrix(6, M);
 				break;
-			case D3DRS_STENCILPASS:
-				switch(value)
-				{
-				case D3DSTENCILOP_KEEP:
-					renderer->setStencilPassOperation(sw::OPERATION_KEEP);
-					break;
-				case D3DSTENCILOP_ZERO:
-					renderer->setStencilPassOperation(sw::OPERATION_ZERO);
-					break;
-				case D3DSTENCILOP_REPLACE:
-					renderer->setStencilPassOperation(sw::OPERATION_REPLACE);
-					break;
-				case D3DSTENCILOP_INCRSAT:
-					renderer->setStencilPassOperation(sw::OPERATION_INCRSAT);
-					break;
-				case D3DSTENCILOP_DECRSAT:
-					renderer->setStencilPassOperation(sw::OPERATION_DECRSAT);
-					break;
-				case D3DSTENCILOP_INVERT:
-					renderer->setStencilPassOperation(sw::OPERATION_INVERT);
-					break;
-				case D3DSTENCILOP_INCR:
-					renderer->setStencilPassOperation(sw::OPERATION_INCR);
-					break;
-				case D3DSTENCILOP_DECR:
-					renderer->setStencilPassOperation(sw::OPERATION_DECR);
-					break;
-				default:
-					ASSERT(false);
-				}
+			case D3DTS_TEXTURE7:
+				renderer->setTextureMatrix(7, M);
 				break;
-			case D3DRS_STENCILFUNC:
-				switch(value)
+			default:
+				if(state > 256 && state < 512)
 				{
-				case D3DCMP_NEVER:
-					renderer->setStencilCompare(sw::STENCIL_NEVER);
-					break;
-				case D3DCMP_LESS:
-					renderer->setStencilCompare(sw::STENCIL_LESS);
-					break;
-				case D3DCMP_EQUAL:
-					renderer->setStencilCompare(sw::STENCIL_EQUAL);
-					break;
-				case D3DCMP_LESSEQUAL:
-					renderer->setStencilCompare(sw::STENCIL_LESSEQUAL);
-					break;
-				case D3DCMP_GREATER:
-					renderer->setStencilCompare(sw::STENCIL_GREATER);
-					break;
-				case D3DCMP_NOTEQUAL:
-					renderer->setStencilCompare(sw::STENCIL_NOTEQUAL);
-					break;
-				case D3DCMP_GREATEREQUAL:
-					renderer->setStencilCompare(sw::STENCIL_GREATEREQUAL);
-					break;
-				case D3DCMP_ALWAYS:
-					renderer->setStencilCompare(sw::STENCIL_ALWAYS);
-					break;
-				default:
-					ASSERT(false);
+					renderer->setModelMatrix(M, state - 256);
 				}
-				break;
-			case D3DRS_STENCILREF:
-				renderer->setStencilReference(value);
-				renderer->setStencilReferenceCCW(value);
-				break;
-			case D3DRS_STENCILMASK:
-				renderer->setStencilMask(value);
-				renderer->setStencilMaskCCW(value);
-				break;
-			case D3DRS_STENCILWRITEMASK:
-				renderer->setStencilWriteMask(value);
-				renderer->setStencilWriteMaskCCW(value);
-				break;
-			case D3DRS_TEXTUREFACTOR:
-				renderer->setTextureFactor(value);
-				break;
-			case D3DRS_WRAP0:
-				renderer->setTextureWrap(0, value);
-				break;
-			case D3DRS_WRAP1:
-				renderer->setTextureWrap(1, value);
-				break;
-			case D3DRS_WRAP2:
-				renderer->setTextureWrap(2, value);
-				break;
-			case D3DRS_WRAP3:
-				renderer->setTextureWrap(3, value);
-				break;
-			case D3DRS_WRAP4:
-				renderer->setTextureWrap(4, value);
-				break;
-			case D3DRS_WRAP5:
-				renderer->setTextureWrap(5, value);
-				break;
-			case D3DRS_WRAP6:
-				renderer->setTextureWrap(6, value);
-				break;
-			case D3DRS_WRAP7:
-				renderer->setTextureWrap(7, value);
-				break;
-			case D3DRS_CLIPPING:
-				// Ignored, clipping is always performed
-				break;
-			case D3DRS_LIGHTING:
-				renderer->setLightingEnable(value != FALSE);
-				break;
-			case D3DRS_AMBIENT:
-				renderer->setGlobalAmbient(value);
-				break;
-			case D3DRS_FOGVERTEXMODE:
-				switch(value)
-				{
-				case D3DFOG_NONE:
-					renderer->setVertexFogMode(sw::FOG_NONE);
-					break;
-				case D3DFOG_LINEAR:
-					renderer->setVertexFogMode(sw::FOG_LINEAR);
-					break;
-				case D3DFOG_EXP:
-					renderer->setVertexFogMode(sw::FOG_EXP);
-					break;
-				case D3DFOG_EXP2:
-					renderer->setVertexFogMode(sw::FOG_EXP2);
-					break;
-				default:
-					ASSERT(false);
-				}
-				break;
-			case D3DRS_COLORVERTEX:
-				renderer->setColorVertexEnable(value != FALSE);
-				break;
-			case D3DRS_LOCALVIEWER:
-				renderer->setLocalViewer(value != FALSE);
-				break;
-			case D3DRS_NORMALIZENORMALS:
-				renderer->setNormalizeNormals(value != FALSE);
-				break;
-			case D3DRS_DIFFUSEMATERIALSOURCE:
-				switch(value)
-				{
-				case D3DMCS_MATERIAL:
-					renderer->setDiffuseMaterialSource(sw::MATERIAL_MATERIAL);
-					break;
-				case D3DMCS_COLOR1:
-					renderer->setDiffuseMaterialSource(sw::MATERIAL_COLOR1);
-					break;
-				case D3DMCS_COLOR2:
-					renderer->setDiffuseMaterialSource(sw::MATERIAL_COLOR2);
-					break;
-				default:
-					ASSERT(false);
-				}
-				break;
-			case D3DRS_SPECULARMATERIALSOURCE:
-				switch(value)
-				{
-				case D3DMCS_MATERIAL:
-					renderer->setSpecularMaterialSource(sw::MATERIAL_MATERIAL);
-					break;
-				case D3DMCS_COLOR1:
-					renderer->setSpecularMaterialSource(sw::MATERIAL_COLOR1);
-					break;
-				case D3DMCS_COLOR2:
-					renderer->setSpecularMaterialSource(sw::MATERIAL_COLOR2);
-					break;
-				default:
-					ASSERT(false);
-				}
-				break;
-			case D3DRS_AMBIENTMATERIALSOURCE:
-				switch(value)
-				{
-				case D3DMCS_MATERIAL:
-					renderer->setAmbientMaterialSource(sw::MATERIAL_MATERIAL);
-					break;
-				case D3DMCS_COLOR1:
-					renderer->setAmbientMaterialSource(sw::MATERIAL_COLOR1);
-					break;
-				case D3DMCS_COLOR2:
-					renderer->setAmbientMaterialSource(sw::MATERIAL_COLOR2);
-					break;
-				default:
-					ASSERT(false);
-				}
-				break;
-			case D3DRS_EMISSIVEMATERIALSOURCE:
-				switch(value)
-				{
-				case D3DMCS_MATERIAL:
-					renderer->setEmissiveMaterialSource(sw::MATERIAL_MATERIAL);
-					break;
-				case D3DMCS_COLOR1:
-					renderer->setEmissiveMaterialSource(sw::MATERIAL_COLOR1);
-					break;
-				case D3DMCS_COLOR2:
-					renderer->setEmissiveMaterialSource(sw::MATERIAL_COLOR2);
-					break;
-				default:
-					ASSERT(false);
-				}
-				break;
-			case D3DRS_VERTEXBLEND:
-				switch(value)
-				{
-				case D3DVBF_DISABLE:
-					renderer->setVertexBlendMatrixCount(0);
-					break;
-				case D3DVBF_1WEIGHTS:
-					renderer->setVertexBlendMatrixCount(2);
-					break;
-				case D3DVBF_2WEIGHTS:
-					renderer->setVertexBlendMatrixCount(3);
-					break;
-				case D3DVBF_3WEIGHTS:
-					renderer->setVertexBlendMatrixCount(4);
-					break;
-				case D3DVBF_TWEENING:
-					UNIMPLEMENTED();
-					break;
-				case D3DVBF_0WEIGHTS:
-					renderer->setVertexBlendMatrixCount(1);
-					break;
-				default:
-					ASSERT(false);
-				}
-				break;
-			case D3DRS_CLIPPLANEENABLE:
-				renderer->setClipFlags(value);
-				break;
-			case D3DRS_POINTSIZE:
-				if(value == D3DFMT_INST && pixelShaderVersionX >= D3DPS_VERSION(2, 0))   // ATI hack to enable instancing on SM 2.0 hardware
-				{
-					instancingEnabled = true;
-				}
-				else if(value == D3DFMT_A2M1)   // ATI hack to enable transparency anti-aliasing
-				{
-					renderer->setTransparencyAntialiasing(sw::TRANSPARENCY_ALPHA_TO_COVERAGE);
-					renderer->setAlphaTestEnable(true);
-				}
-				else if(value == D3DFMT_A2M0)   // ATI hack to disable transparency anti-aliasing
-				{
-					renderer->setTransparencyAntialiasing(sw::TRANSPARENCY_NONE);
-					renderer->setAlphaTestEnable(false);
-				}
-				else
-				{
-					renderer->setPointSize((float&)value);
-				}
-				break;
-			case D3DRS_POINTSIZE_MIN:
-				renderer->setPointSizeMin((float&)value);
-				break;
-			case D3DRS_POINTSPRITEENABLE:
-				renderer->setPointSpriteEnable(value != FALSE);
-				break;
-			case D3DRS_POINTSCALEENABLE:
-				renderer->setPointScaleEnable(value != FALSE);
-				break;
-			case D3DRS_POINTSCALE_A:
-				renderer->setPointScaleA((float&)value);
-				break;
-			case D3DRS_POINTSCALE_B:
-				renderer->setPointScaleB((float&)value);
-				break;
-			case D3DRS_POINTSCALE_C:
-				renderer->setPointScaleC((float&)value);
-				break;
-			case D3DRS_MULTISAMPLEANTIALIAS:
-			//	if(!init) UNIMPLEMENTED();
-				break;
-			case D3DRS_MULTISAMPLEMASK:
-				SetRenderTarget(0, renderTarget[0]);   // Sets the multi-sample mask, if maskable
-				break;
-			case D3DRS_PATCHEDGESTYLE:
-				if(!init) if(value != D3DPATCHEDGE_DISCRETE) UNIMPLEMENTED();
-				break;
-			case D3DRS_DEBUGMONITORTOKEN:
-				if(!init) UNIMPLEMENTED();
-				break;
-			case D3DRS_POINTSIZE_MAX:
-				renderer->setPointSizeMax((float&)value);
-				break;
-			case D3DRS_INDEXEDVERTEXBLENDENABLE:
-				renderer->setIndexedVertexBlendEnable(value != FALSE);
-				break;
-			case D3DRS_COLORWRITEENABLE:
-				renderer->setColorWriteMask(0, value & 0x0000000F);
-				break;
-			case D3DRS_TWEENFACTOR:
-				if(!init) UNIMPLEMENTED();
-				break;
-			case D3DRS_BLENDOP:
-				switch(value)
-				{
-				case D3DBLENDOP_ADD:
-					renderer->setBlendOperation(sw::BLENDOP_ADD);
-					break;
-				case D3DBLENDOP_SUBTRACT:
-					renderer->setBlendOperation(sw::BLENDOP_SUB);
-					break;
-				case D3DBLENDOP_REVSUBTRACT:
-					renderer->setBlendOperation(sw::BLENDOP_INVSUB);
-					break;
-				case D3DBLENDOP_MIN:
-					renderer->setBlendOperation(sw::BLENDOP_MIN);
-					break;
-				case D3DBLENDOP_MAX:
-					renderer->setBlendOperation(sw::BLENDOP_MAX);
-					break;
-				default:
-					ASSERT(false);
-				}
-				break;
-			case D3DRS_POSITIONDEGREE:
-				if(!init) UNIMPLEMENTED();
-				break;
-			case D3DRS_NORMALDEGREE:
-				if(!init) UNIMPLEMENTED();
-				break;
-			case D3DRS_SCISSORTESTENABLE:
-				scissorEnable = (value != FALSE);
-				break;
-			case D3DRS_SLOPESCALEDEPTHBIAS:
-				renderer->setSlopeDepthBias((float&)value);
-				break;
-			case D3DRS_ANTIALIASEDLINEENABLE:
-				if(!init) if(value != FALSE) UNIMPLEMENTED();
-				break;
-			case D3DRS_MINTESSELLATIONLEVEL:
-				if(!init) UNIMPLEMENTED();
-				break;
-			case D3DRS_MAXTESSELLATIONLEVEL:
-				if(!init) UNIMPLEMENTED();
-				break;
-			case D3DRS_ADAPTIVETESS_X:
-				if(!init) if((float&)value != 0.0f) UNIMPLEMENTED();
-				break;
-			case D3DRS_ADAPTIVETESS_Y:
-				if(value == D3DFMT_ATOC)   // NVIDIA hack to enable transparency anti-aliasing
-				{
-					renderer->setTransparencyAntialiasing(sw::TRANSPARENCY_ALPHA_TO_COVERAGE);
-				}
-				else if(value == D3DFMT_UNKNOWN)   // NVIDIA hack to disable transparency anti-aliasing
-				{
-					renderer->setTransparencyAntialiasing(sw::TRANSPARENCY_NONE);
-				}
-				else
-				{
-					if(!init) if((float&)value != 0.0f) UNIMPLEMENTED();
-				}
-				break;
-			case D3DRS_ADAPTIVETESS_Z:
-				if(!init) if((float&)value != 1.0f) UNIMPLEMENTED();
-				break;
-			case D3DRS_ADAPTIVETESS_W:
-				if(!init) if((float&)value != 0.0f) UNIMPLEMENTED();
-				break;
-			case D3DRS_ENABLEADAPTIVETESSELLATION:
-				if(!init) UNIMPLEMENTED();
-				break;
-			case D3DRS_TWOSIDEDSTENCILMODE:
-				renderer->setTwoSidedStencil(value != FALSE);
-				break;
-			case D3DRS_CCW_STENCILFAIL:
-				switch(value)
-				{
-				case D3DSTENCILOP_KEEP:
-					renderer->setStencilFailOperationCCW(sw::OPERATION_KEEP);
-					break;
-				case D3DSTENCILOP_ZERO:
-					renderer->setStencilFailOperationCCW(sw::OPERATION_ZERO);
-					break;
-				case D3DSTENCILOP_REPLACE:
-					renderer->setStencilFailOperationCCW(sw::OPERATION_REPLACE);
-					break;
-				case D3DSTENCILOP_INCRSAT:
-					renderer->setStencilFailOperationCCW(sw::OPERATION_INCRSAT);
-					break;
-				case D3DSTENCILOP_DECRSAT:
-					renderer->setStencilFailOperationCCW(sw::OPERATION_DECRSAT);
-					break;
-				case D3DSTENCILOP_INVERT:
-					renderer->setStencilFailOperationCCW(sw::OPERATION_INVERT);
-					break;
-				case D3DSTENCILOP_INCR:
-					renderer->setStencilFailOperationCCW(sw::OPERATION_INCR);
-					break;
-				case D3DSTENCILOP_DECR:
-					renderer->setStencilFailOperationCCW(sw::OPERATION_DECR);
-					break;
-				default:
-					ASSERT(false);
-				}
-				break;
-			case D3DRS_CCW_STENCILZFAIL:
-				switch(value)
-				{
-				case D3DSTENCILOP_KEEP:
-					renderer->setStencilZFailOperationCCW(sw::OPERATION_KEEP);
-					break;
-				case D3DSTENCILOP_ZERO:
-					renderer->setStencilZFailOperationCCW(sw::OPERATION_ZERO);
-					break;
-				case D3DSTENCILOP_REPLACE:
-					renderer->setStencilZFailOperationCCW(sw::OPERATION_REPLACE);
-					break;
-				case D3DSTENCILOP_INCRSAT:
-					renderer->setStencilZFailOperationCCW(sw::OPERATION_INCRSAT);
-					break;
-				case D3DSTENCILOP_DECRSAT:
-					renderer->setStencilZFailOperationCCW(sw::OPERATION_DECRSAT);
-					break;
-				case D3DSTENCILOP_INVERT:
-					renderer->setStencilZFailOperationCCW(sw::OPERATION_INVERT);
-					break;
-				case D3DSTENCILOP_INCR:
-					renderer->setStencilZFailOperationCCW(sw::OPERATION_INCR);
-					break;
-				case D3DSTENCILOP_DECR:
-					renderer->setStencilZFailOperationCCW(sw::OPERATION_DECR);
-					break;
-				default:
-					ASSERT(false);
-				}
-				break;
-			case D3DRS_CCW_STENCILPASS:
-				switch(value)
-				{
-				case D3DSTENCILOP_KEEP:
-					renderer->setStencilPassOperationCCW(sw::OPERATION_KEEP);
-					break;
-				case D3DSTENCILOP_ZERO:
-					renderer->setStencilPassOperationCCW(sw::OPERATION_ZERO);
-					break;
-				case D3DSTENCILOP_REPLACE:
-					renderer->setStencilPassOperationCCW(sw::OPERATION_REPLACE);
-					break;
-				case D3DSTENCILOP_INCRSAT:
-					renderer->setStencilPassOperationCCW(sw::OPERATION_INCRSAT);
-					break;
-				case D3DSTENCILOP_DECRSAT:
-					renderer->setStencilPassOperationCCW(sw::OPERATION_DECRSAT);
-					break;
-				case D3DSTENCILOP_INVERT:
-					renderer->setStencilPassOperationCCW(sw::OPERATION_INVERT);
-					break;
-				case D3DSTENCILOP_INCR:
-					renderer->setStencilPassOperationCCW(sw::OPERATION_INCR);
-					break;
-				case D3DSTENCILOP_DECR:
-					renderer->setStencilPassOperationCCW(sw::OPERATION_DECR);
-					break;
-				default:
-					ASSERT(false);
-				}
-				break;
-			case D3DRS_CCW_STENCILFUNC:
-				switch(value)
-				{
-				case D3DCMP_NEVER:
-					renderer->setStencilCompareCCW(sw::STENCIL_NEVER);
-					break;
-				case D3DCMP_LESS:
-					renderer->setStencilCompareCCW(sw::STENCIL_LESS);
-					break;
-				case D3DCMP_EQUAL:
-					renderer->setStencilCompareCCW(sw::STENCIL_EQUAL);
-					break;
-				case D3DCMP_LESSEQUAL:
-					renderer->setStencilCompareCCW(sw::STENCIL_LESSEQUAL);
-					break;
-				case D3DCMP_GREATER:
-					renderer->setStencilCompareCCW(sw::STENCIL_GREATER);
-					break;
-				case D3DCMP_NOTEQUAL:
-					renderer->setStencilCompareCCW(sw::STENCIL_NOTEQUAL);
-					break;
-				case D3DCMP_GREATEREQUAL:
-					renderer->setStencilCompareCCW(sw::STENCIL_GREATEREQUAL);
-					break;
-				case D3DCMP_ALWAYS:
-					renderer->setStencilCompareCCW(sw::STENCIL_ALWAYS);
-					break;
-				default:
-					ASSERT(false);
-				}
-				break;
-			case D3DRS_COLORWRITEENABLE1:
-				renderer->setColorWriteMask(1, value);
-				break;
-			case D3DRS_COLORWRITEENABLE2:
-				renderer->setColorWriteMask(2, value);
-				break;
-			case D3DRS_COLORWRITEENABLE3:
-				renderer->setColorWriteMask(3, value);
-				break;
-			case D3DRS_BLENDFACTOR:
-				renderer->setBlendConstant(sw::Color<float>(value));
-				break;
-			case D3DRS_SRGBWRITEENABLE:
-				renderer->setWriteSRGB(value != FALSE);
-				break;
-			case D3DRS_DEPTHBIAS:
-				renderer->setDepthBias((float&)value);
-				break;
-			case D3DRS_WRAP8:
-				renderer->setTextureWrap(8, value);
-				break;
-			case D3DRS_WRAP9:
-				renderer->setTextureWrap(9, value);
-				break;
-			case D3DRS_WRAP10:
-				renderer->setTextureWrap(10, value);
-				break;
-			case D3DRS_WRAP11:
-				renderer->setTextureWrap(11, value);
-				break;
-			case D3DRS_WRAP12:
-				renderer->setTextureWrap(12, value);
-				break;
-			case D3DRS_WRAP13:
-				renderer->setTextureWrap(13, value);
-				break;
-			case D3DRS_WRAP14:
-				renderer->setTextureWrap(14, value);
-				break;
-			case D3DRS_WRAP15:
-				renderer->setTextureWrap(15, value);
-				break;
-			case D3DRS_SEPARATEALPHABLENDENABLE:
-				renderer->setSeparateAlphaBlendEnable(value != FALSE);
-				break;
-			case D3DRS_SRCBLENDALPHA:
-				switch(value)
-				{
-				case D3DBLEND_ZERO:
-					renderer->setSourceBlendFactorAlpha(sw::BLEND_ZERO);
-					break;
-				case D3DBLEND_ONE:
-					renderer->setSourceBlendFactorAlpha(sw::BLEND_ONE);
-					break;
-				case D3DBLEND_SRCCOLOR:
-					renderer->setSourceBlendFactorAlpha(sw::BLEND_SOURCE);
-					break;
-				case D3DBLEND_INVSRCCOLOR:
-					renderer->setSourceBlendFactorAlpha(sw::BLEND_INVSOURCE);
-					break;
-				case D3DBLEND_SRCALPHA:
-					renderer->setSourceBlendFactorAlpha(sw::BLEND_SOURCEALPHA);
-					break;
-				case D3DBLEND_INVSRCALPHA:
-					renderer->setSourceBlendFactorAlpha(sw::BLEND_INVSOURCEALPHA);
-					break;
-				case D3DBLEND_DESTALPHA:
-					renderer->setSourceBlendFactorAlpha(sw::BLEND_DESTALPHA);
-					break;
-				case D3DBLEND_INVDESTALPHA:
-					renderer->setSourceBlendFactorAlpha(sw::BLEND_INVDESTALPHA);
-					break;
-				case D3DBLEND_DESTCOLOR:
-					renderer->setSourceBlendFactorAlpha(sw::BLEND_DEST);
-					break;
-				case D3DBLEND_INVDESTCOLOR:
-					renderer->setSourceBlendFactorAlpha(sw::BLEND_INVDEST);
-					break;
-				case D3DBLEND_SRCALPHASAT:
-					renderer->setSourceBlendFactorAlpha(sw::BLEND_SRCALPHASAT);
-					break;
-				case D3DBLEND_BOTHSRCALPHA:
-					renderer->setSourceBlendFactorAlpha(sw::BLEND_SOURCEALPHA);
-					renderer->setDestBlendFactorAlpha(sw::BLEND_INVSOURCEALPHA);
-					break;
-				case D3DBLEND_BOTHINVSRCALPHA:
-					renderer->setSourceBlendFactorAlpha(sw::BLEND_INVSOURCEALPHA);
-					renderer->setDestBlendFactorAlpha(sw::BLEND_SOURCEALPHA);
-					break;
-				case D3DBLEND_BLENDFACTOR:
-					renderer->setSourceBlendFactorAlpha(sw::BLEND_CONSTANT);
-					break;
-				case D3DBLEND_INVBLENDFACTOR:
-					renderer->setSourceBlendFactorAlpha(sw::BLEND_INVCONSTANT);
-					break;
-				default:
-					ASSERT(false);
-				}
-				break;
-			case D3DRS_DESTBLENDALPHA:
-				switch(value)
-				{
-				case D3DBLEND_ZERO:
-					renderer->setDestBlendFactorAlpha(sw::BLEND_ZERO);
-					break;
-				case D3DBLEND_ONE:
-					renderer->setDestBlendFactorAlpha(sw::BLEND_ONE);
-					break;
-				case D3DBLEND_SRCCOLOR:
-					renderer->setDestBlendFactorAlpha(sw::BLEND_SOURCE);
-					break;
-				case D3DBLEND_INVSRCCOLOR:
-					renderer->setDestBlendFactorAlpha(sw::BLEND_INVSOURCE);
-					break;
-				case D3DBLEND_SRCALPHA:
-					renderer->setDestBlendFactorAlpha(sw::BLEND_SOURCEALPHA);
-					break;
-				case D3DBLEND_INVSRCALPHA:
-					renderer->setDestBlendFactorAlpha(sw::BLEND_INVSOURCEALPHA);
-					break;
-				case D3DBLEND_DESTALPHA:
-					renderer->setDestBlendFactorAlpha(sw::BLEND_DESTALPHA);
-					break;
-				case D3DBLEND_INVDESTALPHA:
-					renderer->setDestBlendFactorAlpha(sw::BLEND_INVDESTALPHA);
-					break;
-				case D3DBLEND_DESTCOLOR:
-					renderer->setDestBlendFactorAlpha(sw::BLEND_DEST);
-					break;
-				case D3DBLEND_INVDESTCOLOR:
-					renderer->setDestBlendFactorAlpha(sw::BLEND_INVDEST);
-					break;
-				case D3DBLEND_SRCALPHASAT:
-					renderer->setDestBlendFactorAlpha(sw::BLEND_SRCALPHASAT);
-					break;
-				case D3DBLEND_BOTHSRCALPHA:
-					renderer->setSourceBlendFactorAlpha(sw::BLEND_SOURCEALPHA);
-					renderer->setDestBlendFactorAlpha(sw::BLEND_INVSOURCEALPHA);
-					break;
-				case D3DBLEND_BOTHINVSRCALPHA:
-					renderer->setSourceBlendFactorAlpha(sw::BLEND_INVSOURCEALPHA);
-					renderer->setDestBlendFactorAlpha(sw::BLEND_SOURCEALPHA);
-					break;
-				case D3DBLEND_BLENDFACTOR:
-					renderer->setDestBlendFactorAlpha(sw::BLEND_CONSTANT);
-					break;
-				case D3DBLEND_INVBLENDFACTOR:
-					renderer->setDestBlendFactorAlpha(sw::BLEND_INVCONSTANT);
-					break;
-				default:
-					ASSERT(false);
-				}
-				break;
-			case D3DRS_BLENDOPALPHA:
-				switch(value)
-				{
-				case D3DBLENDOP_ADD:
-					renderer->setBlendOperationAlpha(sw::BLENDOP_ADD);
-					break;
-				case D3DBLENDOP_SUBTRACT:
-					renderer->setBlendOperationAlpha(sw::BLENDOP_SUB);
-					break;
-				case D3DBLENDOP_REVSUBTRACT:
-					renderer->setBlendOperationAlpha(sw::BLENDOP_INVSUB);
-					break;
-				case D3DBLENDOP_MIN:
-					renderer->setBlendOperationAlpha(sw::BLENDOP_MIN);
-					break;
-				case D3DBLENDOP_MAX:
-					renderer->setBlendOperationAlpha(sw::BLENDOP_MAX);
-					break;
-				default:
-					ASSERT(false);
-				}
-				break;
-			default:
-				ASSERT(false);
+				else ASSERT(false);
 			}
 		}
 		else   // stateRecorder
 		{
-			stateRecorder->setRenderState(state, value);
+			stateRecorder->setTransform(state, matrix);
 		}
 
 		return D3D_OK;
 	}
 
-	long Direct3DDevice9::SetRenderTarget(unsigned long index, IDirect3DSurface9 *iRenderTarget)
+	long Direct3DDevice9::SetVertexDeclaration(IDirect3DVertexDeclaration9 *iVertexDeclaration)
 	{
 		CriticalSection cs(this);
 
-		TRACE("unsigned long index = %d, IDirect3DSurface9 *newRenderTarget = 0x%0.8p", index, iRenderTarget);
+		TRACE("IDirect3DVertexDeclaration9 *declaration = 0x%0.8p", iVertexDeclaration);
 
-		// FIXME: Check for D3DUSAGE_RENDERTARGET
+		Direct3DVertexDeclaration9 *vertexDeclaration = static_cast<Direct3DVertexDeclaration9*>(iVertexDeclaration);
 
-		if(index >= 4 || (index == 0 && !iRenderTarget))
+		if(!stateRecorder)
 		{
-			return INVALIDCALL();
-		}
+			if(this->vertexDeclaration == vertexDeclaration)
+			{
+				return D3D_OK;
+			}
 
-		Direct3DSurface9 *renderTarget = static_cast<Direct3DSurface9*>(iRenderTarget);
+			if(vertexDeclaration)
+			{
+				vertexDeclaration->bind();
+			}
 
-		if(renderTarget)
-		{
-			renderTarget->bind();
-		}
+			if(this->vertexDeclaration)
+			{
+				this->vertexDeclaration->unbind();
+			}
 
-		if(this->renderTarget[index])
-		{
-			this->renderTarget[index]->unbind();
+			this->vertexDeclaration = vertexDeclaration;
 		}
-
-		this->renderTarget[index] = renderTarget;
-
-		if(renderTarget && index == 0)
+		else
 		{
-			D3DSURFACE_DESC renderTargetDesc;
-			renderTarget->GetDesc(&renderTargetDesc);
-
-			// Reset viewport to size of current render target
-			viewport.X = 0;
-			viewport.Y = 0;
-			viewport.Width = renderTargetDesc.Width;
-			viewport.Height = renderTargetDesc.Height;
-			viewport.MinZ = 0;
-			viewport.MaxZ = 1;
-
-			// Reset scissor rectangle to size of current render target
-			scissorRect.left = 0;
-			scissorRect.top = 0;
-			scissorRect.right = renderTargetDesc.Width;
-			scissorRect.bottom = renderTargetDesc.Height;
-
-			// Set the multi-sample mask, if maskable
-			if(renderTargetDesc.MultiSampleType != D3DMULTISAMPLE_NONE &&
-			   renderTargetDesc.MultiSampleType != D3DMULTISAMPLE_NONMASKABLE)
-			{
-				renderer->setMultiSampleMask(renderState[D3DRS_MULTISAMPLEMASK]);
-			}
-			else
-			{
-				renderer->setMultiSampleMask(0xFFFFFFFF);
-			}
+			stateRecorder->setVertexDeclaration(vertexDeclaration);
 		}
 
-		renderer->setRenderTarget(index, renderTarget);
-
 		return D3D_OK;
 	}
 
-	long Direct3DDevice9::SetSamplerState(unsigned long sampler, D3DSAMPLERSTATETYPE state, unsigned long value)
+	long Direct3DDevice9::SetVertexShader(IDirect3DVertexShader9 *iVertexShader)
 	{
 		CriticalSection cs(this);
 
-		TRACE("unsigned long sampler = %d, D3DSAMPLERSTATETYPE state = %d, unsigned long value = %d", sampler, state, value);
-
-		if(state < D3DSAMP_ADDRESSU || state > D3DSAMP_DMAPOFFSET)
-		{
-			return INVALIDCALL();
-		}
-
-		if((sampler >= 16 && sampler <= D3DDMAPSAMPLER) || sampler > D3DVERTEXTEXTURESAMPLER3)
-		{
-			return INVALIDCALL();
-		}
+		TRACE("IDirect3DVertexShader9 *shader = 0x%0.8p", iVertexShader);
 
-		if(sampler >= D3DVERTEXTEXTURESAMPLER0)
-		{
-			sampler = 16 + (sampler - D3DVERTEXTEXTURESAMPLER0);
-		}
+		Direct3DVertexShader9 *vertexShader = static_cast<Direct3DVertexShader9*>(iVertexShader);
 
 		if(!stateRecorder)
 		{
-			if(!init && samplerState[sampler][state] == value)
+			if(this->vertexShader == vertexShader)
 			{
 				return D3D_OK;
 			}
 
-			samplerState[sampler][state] = value;
-
-			sw::SamplerType type = sampler < 16 ? sw::SAMPLER_PIXEL : sw::SAMPLER_VERTEX;
-			int index = sampler < 16 ? sampler : sampler - 16;   // Sampler index within type group
+			if(vertexShader)
+			{
+				vertexShader->bind();
+			}
 
-			switch(state)
+			if(this->vertexShader)
 			{
-			case D3DSAMP_ADDRESSU:
-				switch(value)
-				{
-				case D3DTADDRESS_WRAP:
-					renderer->setAddressingModeU(type, index, sw::ADDRESSING_WRAP);
-					break;
-				case D3DTADDRESS_MIRROR:
-					renderer->setAddressingModeU(type, index, sw::ADDRESSING_MIRROR);
-					break;
-				case D3DTADDRESS_CLAMP:
-					renderer->setAddressingModeU(type, index, sw::ADDRESSING_CLAMP);
-					break;
-				case D3DTADDRESS_BORDER:
-					renderer->setAddressingModeU(type, index, sw::ADDRESSING_BORDER);
-					break;
-				case D3DTADDRESS_MIRRORONCE:
-					renderer->setAddressingModeU(type, index, sw::ADDRESSING_MIRRORONCE);
-					break;
-				default:
-					ASSERT(false);
-				}
-				break;
-			case D3DSAMP_ADDRESSV:
-				switch(value)
-				{
-				case D3DTADDRESS_WRAP:
-					renderer->setAddressingModeV(type, index, sw::ADDRESSING_WRAP);
-					break;
-				case D3DTADDRESS_MIRROR:
-					renderer->setAddressingModeV(type, index, sw::ADDRESSING_MIRROR);
-					break;
-				case D3DTADDRESS_CLAMP:
-					renderer->setAddressingModeV(type, index, sw::ADDRESSING_CLAMP);
-					break;
-				case D3DTADDRESS_BORDER:
-					renderer->setAddressingModeV(type, index, sw::ADDRESSING_BORDER);
-					break;
-				case D3DTADDRESS_MIRRORONCE:
-					renderer->setAddressingModeV(type, index, sw::ADDRESSING_MIRRORONCE);
-					break;
-				default:
-					ASSERT(false);
-				}
-				break;
-			case D3DSAMP_ADDRESSW:
-				switch(value)
-				{
-				case D3DTADDRESS_WRAP:
-					renderer->setAddressingModeW(type, index, sw::ADDRESSING_WRAP);
-					break;
-				case D3DTADDRESS_MIRROR:
-					renderer->setAddressingModeW(type, index, sw::ADDRESSING_MIRROR);
-					break;
-				case D3DTADDRESS_CLAMP:
-					renderer->setAddressingModeW(type, index, sw::ADDRESSING_CLAMP);
-					break;
-				case D3DTADDRESS_BORDER:
-					renderer->setAddressingModeW(type, index, sw::ADDRESSING_BORDER);
-					break;
-				case D3DTADDRESS_MIRRORONCE:
-					renderer->setAddressingModeW(type, index, sw::ADDRESSING_MIRRORONCE);
-					break;
-				default:
-					ASSERT(false);
-				}
-				break;
-			case D3DSAMP_BORDERCOLOR:
-				renderer->setBorderColor(type, index, value);
-				break;
-			case D3DSAMP_MAGFILTER:
-				// NOTE: SwiftShader does not differentiate between minification and magnification filter
-				switch(value)
-				{
-				case D3DTEXF_NONE:
-					renderer->setTextureFilter(type, index, sw::FILTER_POINT);   // FIXME: Only for mipmap filter
-					break;
-				case D3DTEXF_POINT:
-					renderer->setTextureFilter(type, index, sw::FILTER_POINT);
-					break;
-				case D3DTEXF_LINEAR:
-					renderer->setTextureFilter(type, index, sw::FILTER_LINEAR);
-					break;
-				case D3DTEXF_ANISOTROPIC:
-					renderer->setTextureFilter(type, index, sw::FILTER_ANISOTROPIC);
-					break;
-				case D3DTEXF_PYRAMIDALQUAD:
-					renderer->setTextureFilter(type, index, sw::FILTER_LINEAR);   // FIXME: Unimplemented, fail silently
-					break;
-				case D3DTEXF_GAUSSIANQUAD:
-					renderer->setTextureFilter(type, index, sw::FILTER_LINEAR);   // FIXME: Unimplemented, fail silently
-					break;
-				default:
-					return INVALIDCALL();
-				};
-				break;
-			case D3DSAMP_MINFILTER:
-				// NOTE: SwiftShader does not differentiate between minification and magnification filter
-				switch(value)
-				{
-				case D3DTEXF_NONE:
-					renderer->setTextureFilter(type, index, sw::FILTER_POINT);   // FIXME: Only for mipmap filter
-					break;
-				case D3DTEXF_POINT:
-					renderer->setTextureFilter(type, index, sw::FILTER_POINT);
-					break;
-				case D3DTEXF_LINEAR:
-					renderer->setTextureFilter(type, index, sw::FILTER_LINEAR);
-					break;
-				case D3DTEXF_ANISOTROPIC:
-					renderer->setTextureFilter(type, index, sw::FILTER_ANISOTROPIC);
-					break;
-				case D3DTEXF_PYRAMIDALQUAD:
-					renderer->setTextureFilter(type, index, sw::FILTER_LINEAR);   // FIXME: Unimplemented, fail silently
-					break;
-				case D3DTEXF_GAUSSIANQUAD:
-					renderer->setTextureFilter(type, index, sw::FILTER_LINEAR);   // FIXME: Unimplemented, fail silently
-					break;
-				default:
-					return INVALIDCALL();
-				};
-				break;
-			case D3DSAMP_MIPFILTER:
-				switch(value)
-				{
-				case D3DTEXF_NONE:
-					renderer->setMipmapFilter(type, index, sw::MIPMAP_NONE);
-					break;
-				case D3DTEXF_POINT:
-					renderer->setMipmapFilter(type, index, sw::MIPMAP_POINT);
-					break;
-				case D3DTEXF_LINEAR:
-					renderer->setMipmapFilter(type, index, sw::MIPMAP_LINEAR);
-					break;
-				case D3DTEXF_ANISOTROPIC:
-					renderer->setMipmapFilter(type, index, sw::MIPMAP_LINEAR);   // FIXME: Only for texture filter
-					break;
-				case D3DTEXF_PYRAMIDALQUAD:
-					renderer->setMipmapFilter(type, index, sw::MIPMAP_LINEAR);   // FIXME: Only for texture filter
-					break;
-				case D3DTEXF_GAUSSIANQUAD:
-					renderer->setMipmapFilter(type, index, sw::MIPMAP_LINEAR);   // FIXME: Only for texture filter
-					break;
-				default:
-					return INVALIDCALL();
-				};
-				break;
-			case D3DSAMP_MIPMAPLODBIAS:
-				if(value == D3DFMT_GET4)   // ATI hack to enable Fetch4
-				{
-					renderer->setGatherEnable(type, index, true);
-				}
-				else if(value == D3DFMT_GET1)   // ATI hack to disable Fetch4
-				{
-					renderer->setGatherEnable(type, index, false);
-				}
-				else
-				{
-					float LOD = (float&)value - sw::log2((float)context->renderTarget[0]->getSuperSampleCount());   // FIXME: Update when render target changes
-					renderer->setMipmapLOD(type, index, LOD);
-				}
-				break;
-			case D3DSAMP_MAXMIPLEVEL:
-				break;
-			case D3DSAMP_MAXANISOTROPY:
-				renderer->setMaxAnisotropy(type, index, sw::clamp((unsigned int)value, (unsigned int)1, maxAnisotropy));
-				break;
-			case D3DSAMP_SRGBTEXTURE:
-				renderer->setReadSRGB(type, index, value != FALSE);
-				break;
-			case D3DSAMP_ELEMENTINDEX:
-				if(!init) UNIMPLEMENTED();   // Multi-element textures deprecated in favor of multiple render targets
-				break;
-			case D3DSAMP_DMAPOFFSET:
-			//	if(!init) UNIMPLEMENTED();
-				break;
-			default:
-				ASSERT(false);
+				this->vertexShader->unbind();
 			}
+
+			this->vertexShader = vertexShader;
+			vertexShaderDirty = true;
 		}
-		else   // stateRecorder
+		else
 		{
-			stateRecorder->setSamplerState(sampler, state, value);
+			stateRecorder->setVertexShader(vertexShader);
 		}
 
 		return D3D_OK;
 	}
 
-	long Direct3DDevice9::SetScissorRect(const RECT *rect)
+	long Direct3DDevice9::SetVertexShaderConstantB(unsigned int startRegister, const int *constantData, unsigned int count)
 	{
 		CriticalSection cs(this);
 
-		TRACE("const RECT *rect = 0x%0.8p", rect);
+		TRACE("unsigned int startRegister = %d, const int *constantData = 0x%0.8p, unsigned int count = %d", startRegister, constantData, count);
 
-		if(!rect)
+		if(!constantData)
 		{
 			return INVALIDCALL();
 		}
 
 		if(!stateRecorder)
 		{
-			scissorRect = *rect;
+			for(unsigned int i = 0; i < count && startRegister + i < 16; i++)
+			{
+				vertexShaderConstantB[startRegister + i] = constantData[i];
+			}
+
+			vertexShaderConstantsBDirty = sw::max(startRegister + count, vertexShaderConstantsBDirty);
+			vertexShaderDirty = true;   // Reload DEF constants
 		}
 		else
 		{
-			stateRecorder->setScissorRect(rect);
+			stateRecorder->setVertexShaderConstantB(startRegister, constantData, count);
 		}
 
 		return D3D_OK;
 	}
 
-	long Direct3DDevice9::SetSoftwareVertexProcessing(int software)
+	long Direct3DDevice9::SetVertexShaderConstantF(unsigned int startRegister, const float *constantData, unsigned int count)
 	{
 		CriticalSection cs(this);
 
-		TRACE("int software = %d", software);
+		TRACE("unsigned int startRegister = %d, const int *constantData = 0x%0.8p, unsigned int count = %d", startRegister, constantData, count);
 
-		if(behaviourFlags & D3DCREATE_SOFTWARE_VERTEXPROCESSING && software == FALSE)
+		if(!constantData)
 		{
 			return INVALIDCALL();
 		}
 
-		if(behaviourFlags & D3DCREATE_HARDWARE_VERTEXPROCESSING && software == TRUE)
+		if(!stateRecorder)
 		{
-			return INVALIDCALL();
-		}
+			for(unsigned int i = 0; i < count && startRegister + i < MAX_VERTEX_SHADER_CONST; i++)
+			{
+				vertexShaderConstantF[startRegister + i][0] = constantData[i * 4 + 0];
+				vertexShaderConstantF[startRegister + i][1] = constantData[i * 4 + 1];
+				vertexShaderConstantF[startRegister + i][2] = constantData[i * 4 + 2];
+				vertexShaderConstantF[startRegister + i][3] = constantData[i * 4 + 3];
+			}
 
-		softwareVertexProcessing = (software != FALSE);
+			vertexShaderConstantsFDirty = sw::max(startRegister + count, vertexShaderConstantsFDirty);
+			vertexShaderDirty = true;   // Reload DEF constants
+		}
+		else
+		{
+			stateRecorder->setVertexShaderConstantF(startRegister, constantData, count);
+		}
 
 		return D3D_OK;
 	}
 
-	long Direct3DDevice9::SetStreamSource(unsigned int stream, IDirect3DVertexBuffer9 *iVertexBuffer, unsigned int offset, unsigned int stride)
+	long Direct3DDevice9::SetVertexShaderConstantI(unsigned int startRegister, const int *constantData, unsigned int count)
 	{
 		CriticalSection cs(this);
 
-		TRACE("unsigned int stream = %d, IDirect3DVertexBuffer9 *data = 0x%0.8p, unsigned int offset = %d, unsigned int stride = %d", stream, iVertexBuffer, offset, stride);
+		TRACE("unsigned int startRegister = %d, const int *constantData = 0x%0.8p, unsigned int count = %d", startRegister, constantData, count);
 
-		Direct3DVertexBuffer9 *vertexBuffer = static_cast<Direct3DVertexBuffer9*>(iVertexBuffer);
+		if(!constantData)
+		{
+			return INVALIDCALL();
+		}
 
 		if(!stateRecorder)
 		{
-			if(dataStream[stream] == vertexBuffer && streamOffset[stream] == offset && streamStride[stream] == stride)
-			{
-				return D3D_OK;
-			}
-
-			if(vertexBuffer)
-			{
-				vertexBuffer->bind();
-			}
-
-			if(dataStream[stream])
+			for(unsigned int i = 0; i < count && startRegister + i < 16; i++)
 			{
-				dataStream[stream]->unbind();
+				vertexShaderConstantI[startRegister + i][0] = constantData[i * 4 + 0];
+				vertexShaderConstantI[startRegister + i][1] = constantData[i * 4 + 1];
+				vertexShaderConstantI[startRegister + i][2] = constantData[i * 4 + 2];
+				vertexShaderConstantI[startRegister + i][3] = constantData[i * 4 + 3];
 			}
 
-			dataStream[stream] = vertexBuffer;
-			streamOffset[stream] = offset;
-			streamStride[stream] = stride;
+			vertexShaderConstantsIDirty = sw::max(startRegister + count, vertexShaderConstantsIDirty);
+			vertexShaderDirty = true;   // Reload DEF constants
 		}
 		else
 		{
-			stateRecorder->setStreamSource(stream, vertexBuffer, offset, stride);
+			stateRecorder->setVertexShaderConstantI(startRegister, constantData, count);
 		}
 
 		return D3D_OK;
 	}
 
-	long Direct3DDevice9::SetStreamSourceFreq(unsigned int streamNumber, unsigned int divider)
+	long Direct3DDevice9::SetViewport(const D3DVIEWPORT9 *viewport)
 	{
 		CriticalSection cs(this);
 
-		TRACE("unsigned int streamNumber = %d, unsigned int divider = %d", streamNumber, divider);
+		TRACE("const D3DVIEWPORT9 *viewport = 0x%0.8p", viewport);
 
-		if(!instancingEnabled)
+		if(!viewport)   // FIXME: Check if valid
 		{
 			return INVALIDCALL();
 		}
 
 		if(!stateRecorder)
 		{
-			streamSourceFreq[streamNumber] = divider;
+			this->viewport = *viewport;
 		}
 		else
 		{
-			stateRecorder->setStreamSourceFreq(streamNumber, divider);
+			stateRecorder->setViewport(viewport);
 		}
 
 		return D3D_OK;
 	}
 
-	long Direct3DDevice9::SetTexture(unsigned long sampler, IDirect3DBaseTexture9 *iBaseTexture)
+	int Direct3DDevice9::ShowCursor(int show)
 	{
 		CriticalSection cs(this);
 
-		TRACE("unsigned long sampler = %d, IDirect3DBaseTexture9 *texture = 0x%0.8p", sampler, iBaseTexture);
+		TRACE("int show = %d", show);
 
-		if((sampler >= 16 && sampler <= D3DDMAPSAMPLER) || sampler > D3DVERTEXTEXTURESAMPLER3)
+		int oldValue = showCursor ? TRUE : FALSE;
+		showCursor = show != FALSE;
+
+		if(showCursor)
 		{
-			return INVALIDCALL();
+			sw::FrameBuffer::setCursorImage(cursor);
 		}
-
-		if(sampler >= D3DVERTEXTEXTURESAMPLER0)
+		else
 		{
-			sampler = 16 + (sampler - D3DVERTEXTEXTURESAMPLER0);
+			sw::FrameBuffer::setCursorImage(0);
 		}
 
-		Direct3DBaseTexture9 *baseTexture = dynamic_cast<Direct3DBaseTexture9*>(iBaseTexture);
+		return oldValue;
+	}
 
-		if(!stateRecorder)
+	long Direct3DDevice9::StretchRect(IDirect3DSurface9 *sourceSurface, const RECT *sourceRect, IDirect3DSurface9 *destSurface, const RECT *destRect, D3DTEXTUREFILTERTYPE filter)
+	{
+		CriticalSection cs(this);
+
+		TRACE("IDirect3DSurface9 *sourceSurface = 0x%0.8p, const RECT *sourceRect = 0x%0.8p, IDirect3DSurface9 *destSurface = 0x%0.8p, const RECT *destRect = 0x%0.8p, D3DTEXTUREFILTERTYPE filter = %d", sourceSurface, sourceRect, destSurface, destRect, filter);
+
+		if(!sourceSurface || !destSurface || !validRectangle(sourceRect, sourceSurface) || !validRectangle(destRect, destSurface))
 		{
-			if(texture[sampler] == baseTexture)
-			{
-				return D3D_OK;
-			}
+			return INVALIDCALL();
+		}
 
-			if(baseTexture)
-			{
-				baseTexture->bind();   // FIXME: Bind individual sub-surfaces?
-			}
+		D3DSURFACE_DESC sourceDescription;
+		D3DSURFACE_DESC destDescription;
 
-			if(texture[sampler])
-			{
-				texture[sampler]->unbind();
-			}
+		sourceSurface->GetDesc(&sourceDescription);
+		destSurface->GetDesc(&destDescription);
 
-			texture[sampler] = baseTexture;
+		if(sourceDescription.Pool != D3DPOOL_DEFAULT || destDescription.Pool != D3DPOOL_DEFAULT)
+		{
+			return INVALIDCALL();
+		}
+
+		Direct3DSurface9 *source = static_cast<Direct3DSurface9*>(sourceSurface);
+		Direct3DSurface9 *dest = static_cast<Direct3DSurface9*>(destSurface);
+
+		stretchRect(source, sourceRect, dest, destRect, filter);
+
+		return D3D_OK;
+	}
+
+	long Direct3DDevice9::TestCooperativeLevel()
+	{
+		CriticalSection cs(this);
+
+		TRACE("void");
+
+		return D3D_OK;
+	}
+
+	long Direct3DDevice9::UpdateSurface(IDirect3DSurface9 *sourceSurface, const RECT *sourceRect, IDirect3DSurface9 *destinationSurface, const POINT *destPoint)
+	{
+		CriticalSection cs(this);
+
+		TRACE("IDirect3DSurface9 *sourceSurface = 0x%0.8p, const RECT *sourceRect = 0x%0.8p, IDirect3DSurface9 *destinationSurface = 0x%0.8p, const POINT *destPoint = 0x%0.8p", sourceSurface, sourceRect, destinationSurface, destPoint);
+
+		if(!sourceSurface || !destinationSurface)
+		{
+			return INVALIDCALL();
+		}
+
+		D3DSURFACE_DESC sourceDescription;
+		D3DSURFACE_DESC destinationDescription;
+
+		sourceSurface->GetDesc(&sourceDescription);
+		destinationSurface->GetDesc(&destinationDescription);
+
+		RECT sRect;
+		RECT dRect;
+
+		if(sourceRect)
+		{
+			sRect.left = sourceRect->left;
+			sRect.top = sourceRect->top;
+			sRect.right = sourceRect->right;
+			sRect.bottom = sourceRect->bottom;
 		}
 		else
 		{
-			stateRecorder->setTexture(sampler, baseTexture);
+			sRect.left = 0;
+			sRect.top = 0;
+			sRect.right = sourceDescription.Width;
+			sRect.bottom = sourceDescription.Height;
+		}
+
+		if(destPoint)
+		{
+			dRect.left = destPoint->x;
+			dRect.top = destPoint->y;
+			dRect.right = destPoint->x + sRect.right - sRect.left;
+			dRect.bottom = destPoint->y + sRect.bottom - sRect.top;
+		}
+		else
+		{
+			dRect.left = 0;
+			dRect.top = 0;
+			dRect.right = sRect.right - sRect.left;
+			dRect.bottom = sRect.bottom - sRect.top;
+		}
+
+		if(!validRectangle(&sRect, sourceSurface) || !validRectangle(&dRect, destinationSurface))
+		{
+			return INVALIDCALL();
+		}
+
+		int sWidth = sRect.right - sRect.left;
+		int sHeight = sRect.bottom - sRect.top;
+
+		int dWidth = dRect.right - dRect.left;
+		int dHeight = dRect.bottom - dRect.top;
+
+		if(sourceDescription.MultiSampleType      != D3DMULTISAMPLE_NONE ||
+		   destinationDescription.MultiSampleType != D3DMULTISAMPLE_NONE ||
+		// sourceDescription.Pool      != D3DPOOL_SYSTEMMEM ||   // FIXME: Check back buffer and depth buffer memory pool flags
+		// destinationDescription.Pool != D3DPOOL_DEFAULT ||
+		   sourceDescription.Format != destinationDescription.Format)
+		{
+			return INVALIDCALL();
+		}
+
+		sw::Surface *source = static_cast<Direct3DSurface9*>(sourceSurface);
+		sw::Surface *dest = static_cast<Direct3DSurface9*>(destinationSurface);
+
+		unsigned char *sBuffer = (unsigned char*)source->lockExternal(sRect.left, sRect.top, 0, sw::LOCK_READONLY, sw::PUBLIC);
+		unsigned char *dBuffer = (unsigned char*)dest->lockExternal(dRect.left, dRect.top, 0, sw::LOCK_WRITEONLY, sw::PUBLIC);
+		int sPitch = source->getExternalPitchB();
+		int dPitch = dest->getExternalPitchB();
+
+		unsigned int width;
+		unsigned int height;
+		unsigned int bytes;
+
+		switch(sourceDescription.Format)
+		{
+		case D3DFMT_DXT1:
+		case D3DFMT_ATI1:
+			width = (dWidth + 3) / 4;
+			height = (dHeight + 3) / 4;
+			bytes = width * 8;   // 64 bit per 4x4 block
+			break;
+		case D3DFMT_DXT2:
+		case D3DFMT_DXT3:
+		case D3DFMT_DXT4:
+		case D3DFMT_DXT5:
+		case D3DFMT_ATI2:
+			width = (dWidth + 3) / 4;
+			height = (dHeight + 3) / 4;
+			bytes = width * 16;   // 128 bit per 4x4 block
+			break;
+		default:
+			width = dWidth;
+			height = dHeight;
+			bytes = width * Direct3DSurface9::bytes(sourceDescription.Format);
+		}
+
+		if(sourceDescription.Format == D3DFMT_ATI1 || sourceDescription.Format == D3DFMT_ATI2)
+		{
+			// Make the pitch correspond to 4 rows
+			sPitch *= 4;
+			dPitch *= 4;
+		}
+
+		for(unsigned int y = 0; y < height; y++)
+		{
+			memcpy(dBuffer, sBuffer, bytes);
+
+			sBuffer += sPitch;
+			dBuffer += dPitch;
 		}
 
+		source->unlockExternal();
+		dest->unlockExternal();
+
 		return D3D_OK;
 	}
 
-	long Direct3DDevice9::SetTextureStageState(unsigned long stage, D3DTEXTURESTAGESTATETYPE type, unsigned long value)
+	long Direct3DDevice9::UpdateTexture(IDirect3DBaseTexture9 *sourceTexture, IDirect3DBaseTexture9 *destinationTexture)
 	{
 		CriticalSection cs(this);
 
-		TRACE("unsigned long stage = %d, D3DTEXTURESTAGESTATETYPE type = %d, unsigned long value = %d", stage, type, value);
+		TRACE("IDirect3DBaseTexture9 *sourceTexture = 0x%0.8p, IDirect3DBaseTexture9 *destinationTexture = 0x%0.8p", sourceTexture, destinationTexture);
 
-		if(stage < 0 || stage >= 8 || type < D3DTSS_COLOROP || type > D3DTSS_CONSTANT)
+		if(!sourceTexture || !destinationTexture)
 		{
 			return INVALIDCALL();
 		}
 
-		if(!stateRecorder)
+		// FIXME: Check memory pools
+
+		D3DRESOURCETYPE type = sourceTexture->GetType();
+
+		if(type != destinationTexture->GetType())
+		{
+			return INVALIDCALL();
+		}
+
+		switch(type)
 		{
-			if(!init && textureStageState[stage][type] == value)
+		case D3DRTYPE_TEXTURE:
 			{
-				return D3D_OK;
-			}
+				IDirect3DTexture9 *source;
+				IDirect3DTexture9 *dest;
 
-			textureStageState[stage][type] = value;
+				sourceTexture->QueryInterface(IID_IDirect3DTexture9, (void**)&source);
+				destinationTexture->QueryInterface(IID_IDirect3DTexture9, (void**)&dest);
 
-			switch(type)
-			{
-			case D3DTSS_COLOROP:
-				switch(value)
-				{
-				case D3DTOP_DISABLE:
-					renderer->setStageOperation(stage, sw::TextureStage::STAGE_DISABLE);
-					break;
-				case D3DTOP_SELECTARG1:
-					renderer->setStageOperation(stage, sw::TextureStage::STAGE_SELECTARG1);
-					break;
-				case D3DTOP_SELECTARG2:
-					renderer->setStageOperation(stage, sw::TextureStage::STAGE_SELECTARG2);
-					break;
-				case D3DTOP_MODULATE:
-					renderer->setStageOperation(stage, sw::TextureStage::STAGE_MODULATE);
-					break;
-				case D3DTOP_MODULATE2X:
-					renderer->setStageOperation(stage, sw::TextureStage::STAGE_MODULATE2X);
-					break;
-				case D3DTOP_MODULATE4X:
-					renderer->setStageOperation(stage, sw::TextureStage::STAGE_MODULATE4X);
-					break;
-				case D3DTOP_ADD:
-					renderer->setStageOperation(stage, sw::TextureStage::STAGE_ADD);
-					break;
-				case D3DTOP_ADDSIGNED:
-					renderer->setStageOperation(stage, sw::TextureStage::STAGE_ADDSIGNED);
-					break;
-				case D3DTOP_ADDSIGNED2X:
-					renderer->setStageOperation(stage, sw::TextureStage::STAGE_ADDSIGNED2X);
-					break;
-				case D3DTOP_SUBTRACT:
-					renderer->setStageOperation(stage, sw::TextureStage::STAGE_SUBTRACT);
-					break;
-				case D3DTOP_ADDSMOOTH:
-					renderer->setStageOperation(stage, sw::TextureStage::STAGE_ADDSMOOTH);
-					break;
-				case D3DTOP_BLENDDIFFUSEALPHA:
-					renderer->setStageOperation(stage, sw::TextureStage::STAGE_BLENDDIFFUSEALPHA);
-					break;
-				case D3DTOP_BLENDTEXTUREALPHA:
-					renderer->setStageOperation(stage, sw::TextureStage::STAGE_BLENDTEXTUREALPHA);
-					break;
-				case D3DTOP_BLENDFACTORALPHA:
-					renderer->setStageOperation(stage, sw::TextureStage::STAGE_BLENDFACTORALPHA);
-					break;
-				case D3DTOP_BLENDTEXTUREALPHAPM:
-					renderer->setStageOperation(stage, sw::TextureStage::STAGE_BLENDTEXTUREALPHAPM);
-					break;
-				case D3DTOP_BLENDCURRENTALPHA:
-					renderer->setStageOperation(stage, sw::TextureStage::STAGE_BLENDCURRENTALPHA);
-					break;
-				case D3DTOP_PREMODULATE:
-					renderer->setStageOperation(stage, sw::TextureStage::STAGE_PREMODULATE);
-					break;
-				case D3DTOP_MODULATEALPHA_ADDCOLOR:
-					renderer->setStageOperation(stage, sw::TextureStage::STAGE_MODULATEALPHA_ADDCOLOR);
-					break;
-				case D3DTOP_MODULATECOLOR_ADDALPHA:
-					renderer->setStageOperation(stage, sw::TextureStage::STAGE_MODULATECOLOR_ADDALPHA);
-					break;
-				case D3DTOP_MODULATEINVALPHA_ADDCOLOR:
-					renderer->setStageOperation(stage, sw::TextureStage::STAGE_MODULATEINVALPHA_ADDCOLOR);
-					break;
-				case D3DTOP_MODULATEINVCOLOR_ADDALPHA:
-					renderer->setStageOperation(stage, sw::TextureStage::STAGE_MODULATEINVCOLOR_ADDALPHA);
-					break;
-				case D3DTOP_BUMPENVMAP:
-					renderer->setStageOperation(stage, sw::TextureStage::STAGE_BUMPENVMAP);
-					break;
-				case D3DTOP_BUMPENVMAPLUMINANCE:
-					renderer->setStageOperation(stage, sw::TextureStage::STAGE_BUMPENVMAPLUMINANCE);
-					break;
-				case D3DTOP_DOTPRODUCT3:
-					renderer->setStageOperation(stage, sw::TextureStage::STAGE_DOT3);
-					break;
-				case D3DTOP_MULTIPLYADD:
-					renderer->setStageOperation(stage, sw::TextureStage::STAGE_MULTIPLYADD);
-					break;
-				case D3DTOP_LERP:
-					renderer->setStageOperation(stage, sw::TextureStage::STAGE_LERP);
-					break;
-				default:
-					ASSERT(false);
-				}
-				break;
-			case D3DTSS_COLORARG1:
-				switch(value & D3DTA_SELECTMASK)
-				{
-				case D3DTA_DIFFUSE:
-					renderer->setFirstArgument(stage, sw::TextureStage::SOURCE_DIFFUSE);
-					break;
-				case D3DTA_CURRENT:
-					renderer->setFirstArgument(stage, sw::TextureStage::SOURCE_CURRENT);
-					break;
-				case D3DTA_TEXTURE:
-					renderer->setFirstArgument(stage, sw::TextureStage::SOURCE_TEXTURE);
-					break;
-				case D3DTA_TFACTOR:
-					renderer->setFirstArgument(stage, sw::TextureStage::SOURCE_TFACTOR);
-					break;
-				case D3DTA_SPECULAR:
-					renderer->setFirstArgument(stage, sw::TextureStage::SOURCE_SPECULAR);
-					break;
-				case D3DTA_TEMP:
-					renderer->setFirstArgument(stage, sw::TextureStage::SOURCE_TEMP);
-					break;
-				case D3DTA_CONSTANT:
-					renderer->setFirstArgument(stage, sw::TextureStage::SOURCE_CONSTANT);
-					break;
-				default:
-					ASSERT(false);
-				}
+				ASSERT(source && dest);
 
-				switch(value & ~D3DTA_SELECTMASK)
+				for(unsigned int level = 0; level < source->GetLevelCount() && level < dest->GetLevelCount(); level++)   // FIXME: Fail when source texture has fewer levels than the destination
 				{
-				case 0:
-					renderer->setFirstModifier(stage, sw::TextureStage::MODIFIER_COLOR);
-					break;
-				case D3DTA_COMPLEMENT:
-					renderer->setFirstModifier(stage, sw::TextureStage::MODIFIER_INVCOLOR);
-					break;
-				case D3DTA_ALPHAREPLICATE:
-					renderer->setFirstModifier(stage, sw::TextureStage::MODIFIER_ALPHA);
-					break;
-				case D3DTA_COMPLEMENT | D3DTA_ALPHAREPLICATE:
-					renderer->setFirstModifier(stage, sw::TextureStage::MODIFIER_INVALPHA);
-					break;
-				default:
-					ASSERT(false);
-				}
-				break;
-			case D3DTSS_COLORARG2:
-				switch(value & D3DTA_SELECTMASK)
-				{
-				case D3DTA_DIFFUSE:
-					renderer->setSecondArgument(stage, sw::TextureStage::SOURCE_DIFFUSE);
-					break;
-				case D3DTA_CURRENT:
-					renderer->setSecondArgument(stage, sw::TextureStage::SOURCE_CURRENT);
-					break;
-				case D3DTA_TEXTURE:
-					renderer->setSecondArgument(stage, sw::TextureStage::SOURCE_TEXTURE);
-					break;
-				case D3DTA_TFACTOR:
-					renderer->setSecondArgument(stage, sw::TextureStage::SOURCE_TFACTOR);
-					break;
-				case D3DTA_SPECULAR:
-					renderer->setSecondArgument(stage, sw::TextureStage::SOURCE_SPECULAR);
-					break;
-				case D3DTA_TEMP:
-					renderer->setSecondArgument(stage, sw::TextureStage::SOURCE_TEMP);
-					break;
-				case D3DTA_CONSTANT:
-					renderer->setSecondArgument(stage, sw::TextureStage::SOURCE_CONSTANT);
-					break;
-				default:
-					ASSERT(false);
+					IDirect3DSurface9 *sourceSurface;
+					IDirect3DSurface9 *destinationSurface;
+
+					source->GetSurfaceLevel(level, &sourceSurface);
+					dest->GetSurfaceLevel(level, &destinationSurface);
+
+					UpdateSurface(sourceSurface, 0, destinationSurface, 0);
+
+					sourceSurface->Release();
+					destinationSurface->Release();
 				}
 
-				switch(value & ~D3DTA_SELECTMASK)
-				{
-				case 0:
-					renderer->setSecondModifier(stage, sw::TextureStage::MODIFIER_COLOR);
-					break;
-				case D3DTA_COMPLEMENT:
-					renderer->setSecondModifier(stage, sw::TextureStage::MODIFIER_INVCOLOR);
-					break;
-				case D3DTA_ALPHAREPLICATE:
-					renderer->setSecondModifier(stage, sw::TextureStage::MODIFIER_ALPHA);
-					break;
-				case D3DTA_COMPLEMENT | D3DTA_ALPHAREPLICATE:
-					renderer->setSecondModifier(stage, sw::TextureStage::MODIFIER_INVALPHA);
-					break;
-				default:
-					ASSERT(false);
-				}
-				break;
-			case D3DTSS_ALPHAOP:
-				switch(value)
-				{
-				case D3DTOP_DISABLE:
-					renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_DISABLE);
-					break;
-				case D3DTOP_SELECTARG1:
-					renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_SELECTARG1);
-					break;
-				case D3DTOP_SELECTARG2:
-					renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_SELECTARG2);
-					break;
-				case D3DTOP_MODULATE:
-					renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_MODULATE);
-					break;
-				case D3DTOP_MODULATE2X:
-					renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_MODULATE2X);
-					break;
-				case D3DTOP_MODULATE4X:
-					renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_MODULATE4X);
-					break;
-				case D3DTOP_ADD:
-					renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_ADD);
-					break;
-				case D3DTOP_ADDSIGNED:
-					renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_ADDSIGNED);
-					break;
-				case D3DTOP_ADDSIGNED2X:
-					renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_ADDSIGNED2X);
-					break;
-				case D3DTOP_SUBTRACT:
-					renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_SUBTRACT);
-					break;
-				case D3DTOP_ADDSMOOTH:
-					renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_ADDSMOOTH);
-					break;
-				case D3DTOP_BLENDDIFFUSEALPHA:
-					renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_BLENDDIFFUSEALPHA);
-					break;
-				case D3DTOP_BLENDTEXTUREALPHA:
-					renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_BLENDTEXTUREALPHA);
-					break;
-				case D3DTOP_BLENDFACTORALPHA:
-					renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_BLENDFACTORALPHA);
-					break;
-				case D3DTOP_BLENDTEXTUREALPHAPM:
-					renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_BLENDTEXTUREALPHAPM);
-					break;
-				case D3DTOP_BLENDCURRENTALPHA:
-					renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_BLENDCURRENTALPHA);
-					break;
-				case D3DTOP_PREMODULATE:
-					renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_PREMODULATE);
-					break;
-				case D3DTOP_MODULATEALPHA_ADDCOLOR:
-					renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_MODULATEALPHA_ADDCOLOR);
-					break;
-				case D3DTOP_MODULATECOLOR_ADDALPHA:
-					renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_MODULATECOLOR_ADDALPHA);
-					break;
-				case D3DTOP_MODULATEINVALPHA_ADDCOLOR:
-					renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_MODULATEINVALPHA_ADDCOLOR);
-					break;
-				case D3DTOP_MODULATEINVCOLOR_ADDALPHA:
-					renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_MODULATEINVCOLOR_ADDALPHA);
-					break;
-				case D3DTOP_BUMPENVMAP:
-					renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_BUMPENVMAP);
-					break;
-				case D3DTOP_BUMPENVMAPLUMINANCE:
-					renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_BUMPENVMAPLUMINANCE);
-					break;
-				case D3DTOP_DOTPRODUCT3:
-					renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_DOT3);
-					break;
-				case D3DTOP_MULTIPLYADD:
-					renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_MULTIPLYADD);
-					break;
-				case D3DTOP_LERP:
-					renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_LERP);
-					break;
-				default:
-					ASSERT(false);
-				}
-				break;
-			case D3DTSS_ALPHAARG1:
-				switch(value & D3DTA_SELECTMASK)
-				{
-				case D3DTA_DIFFUSE:
-					renderer->setFirstArgumentAlpha(stage, sw::TextureStage::SOURCE_DIFFUSE);
-					break;
-				case D3DTA_CURRENT:
-					renderer->setFirstArgumentAlpha(stage, sw::TextureStage::SOURCE_CURRENT);
-					break;
-				case D3DTA_TEXTURE:
-					renderer->setFirstArgumentAlpha(stage, sw::TextureStage::SOURCE_TEXTURE);
-					break;
-				case D3DTA_TFACTOR:
-					renderer->setFirstArgumentAlpha(stage, sw::TextureStage::SOURCE_TFACTOR);
-					break;
-				case D3DTA_SPECULAR:
-					renderer->setFirstArgumentAlpha(stage, sw::TextureStage::SOURCE_SPECULAR);
-					break;
-				case D3DTA_TEMP:
-					renderer->setFirstArgumentAlpha(stage, sw::TextureStage::SOURCE_TEMP);
-					break;
-				case D3DTA_CONSTANT:
-					renderer->setFirstArgumentAlpha(stage, sw::TextureStage::SOURCE_CONSTANT);
-					break;
-				default:
-					ASSERT(false);
-				}
+				source->Release();
+				dest->Release();
+			}
+			break;
+		case D3DRTYPE_VOLUMETEXTURE:
+			{
+				IDirect3DVolumeTexture9 *source;
+				IDirect3DVolumeTexture9 *dest;
 
-				switch(value & ~D3DTA_SELECTMASK)
-				{
-				case 0:
-					renderer->setFirstModifierAlpha(stage, sw::TextureStage::MODIFIER_COLOR);
-					break;
-				case D3DTA_COMPLEMENT:
-					renderer->setFirstModifierAlpha(stage, sw::TextureStage::MODIFIER_INVCOLOR);
-					break;
-				case D3DTA_ALPHAREPLICATE:
-					renderer->setFirstModifierAlpha(stage, sw::TextureStage::MODIFIER_ALPHA);
-					break;
-				case D3DTA_COMPLEMENT | D3DTA_ALPHAREPLICATE:
-					renderer->setSecondModifier(stage, sw::TextureStage::MODIFIER_INVALPHA);
-					break;
-				default:
-					ASSERT(false);
-				}
-				break;
-			case D3DTSS_ALPHAARG2:
-				switch(value & D3DTA_SELECTMASK)
-				{
-				case D3DTA_DIFFUSE:
-					renderer->setSecondArgumentAlpha(stage, sw::TextureStage::SOURCE_DIFFUSE);
-					break;
-				case D3DTA_CURRENT:
-					renderer->setSecondArgumentAlpha(stage, sw::TextureStage::SOURCE_CURRENT);
-					break;
-				case D3DTA_TEXTURE:
-					renderer->setSecondArgumentAlpha(stage, sw::TextureStage::SOURCE_TEXTURE);
-					break;
-				case D3DTA_TFACTOR:
-					renderer->setSecondArgumentAlpha(stage, sw::TextureStage::SOURCE_TFACTOR);
-					break;
-				case D3DTA_SPECULAR:
-					renderer->setSecondArgumentAlpha(stage, sw::TextureStage::SOURCE_SPECULAR);
-					break;
-				case D3DTA_TEMP:
-					renderer->setSecondArgumentAlpha(stage, sw::TextureStage::SOURCE_TEMP);
-					break;
-				case D3DTA_CONSTANT:
-					renderer->setSecondArgumentAlpha(stage, sw::TextureStage::SOURCE_CONSTANT);
-					break;
-				default:
-					ASSERT(false);
-				}
+				sourceTexture->QueryInterface(IID_IDirect3DVolumeTexture9, (void**)&source);
+				destinationTexture->QueryInterface(IID_IDirect3DVolumeTexture9, (void**)&dest);
 
-				switch(value & ~D3DTA_SELECTMASK)
-				{
-				case 0:
-					renderer->setSecondModifierAlpha(stage, sw::TextureStage::MODIFIER_COLOR);
-					break;
-				case D3DTA_COMPLEMENT:
-					renderer->setSecondModifierAlpha(stage, sw::TextureStage::MODIFIER_INVCOLOR);
-					break;
-				case D3DTA_ALPHAREPLICATE:
-					renderer->setSecondModifierAlpha(stage, sw::TextureStage::MODIFIER_ALPHA);
-					break;
-				case D3DTA_COMPLEMENT | D3DTA_ALPHAREPLICATE:
-					renderer->setSecondModifierAlpha(stage, sw::TextureStage::MODIFIER_INVALPHA);
-					break;
-				default:
-					ASSERT(false);
-				}
-				break;
-			case D3DTSS_BUMPENVMAT00:
-				renderer->setBumpmapMatrix(stage, 0, (float&)value);
-				break;
-			case D3DTSS_BUMPENVMAT01:
-				renderer->setBumpmapMatrix(stage, 1, (float&)value);
-				break;
-			case D3DTSS_BUMPENVMAT10:
-				renderer->setBumpmapMatrix(stage, 2, (float&)value);
-				break;
-			case D3DTSS_BUMPENVMAT11:
-				renderer->setBumpmapMatrix(stage, 3, (float&)value);
-				break;
-			case D3DTSS_TEXCOORDINDEX:
-				renderer->setTexCoordIndex(stage, value & 0x0000FFFF);
+				ASSERT(source && dest);
 
-				switch(value & 0xFFFF0000)
-				{
-				case D3DTSS_TCI_PASSTHRU:
-					renderer->setTexGen(stage, sw::TEXGEN_PASSTHRU);
-					break;
-				case D3DTSS_TCI_CAMERASPACENORMAL:
-					renderer->setTexCoordIndex(stage, stage);
-					renderer->setTexGen(stage, sw::TEXGEN_NORMAL);
-					break;
-				case D3DTSS_TCI_CAMERASPACEPOSITION:
-					renderer->setTexCoordIndex(stage, stage);
-					renderer->setTexGen(stage, sw::TEXGEN_POSITION);
-					break;
-				case D3DTSS_TCI_CAMERASPACEREFLECTIONVECTOR:
-					renderer->setTexCoordIndex(stage, stage);
-					renderer->setTexGen(stage, sw::TEXGEN_REFLECTION);
-					break;
-				case D3DTSS_TCI_SPHEREMAP:
-					renderer->setTexCoordIndex(stage, stage);
-					renderer->setTexGen(stage, sw::TEXGEN_SPHEREMAP);
-					break;
-				default:
-					ASSERT(false);
-				}
-				break;
-			case D3DTSS_BUMPENVLSCALE:
-				renderer->setLuminanceScale(stage, (float&)value);
-				break;
-			case D3DTSS_BUMPENVLOFFSET:
-				renderer->setLuminanceOffset(stage, (float&)value);
-				break;
-			case D3DTSS_TEXTURETRANSFORMFLAGS:
-				switch(value & ~D3DTTFF_PROJECTED)
-				{
-				case D3DTTFF_DISABLE:
-					renderer->setTextureTransform(stage, 0, (value & D3DTTFF_PROJECTED) == D3DTTFF_PROJECTED);
-					break;
-				case D3DTTFF_COUNT1:
-					renderer->setTextureTransform(stage, 1, (value & D3DTTFF_PROJECTED) == D3DTTFF_PROJECTED);
-					break;
-				case D3DTTFF_COUNT2:
-					renderer->setTextureTransform(stage, 2, (value & D3DTTFF_PROJECTED) == D3DTTFF_PROJECTED);
-					break;
-				case D3DTTFF_COUNT3:
-					renderer->setTextureTransform(stage, 3, (value & D3DTTFF_PROJECTED) == D3DTTFF_PROJECTED);
-					break;
-				case D3DTTFF_COUNT4:
-					renderer->setTextureTransform(stage, 4, (value & D3DTTFF_PROJECTED) == D3DTTFF_PROJECTED);
-					break;
-				default:
-					ASSERT(false);
-				}
-				break;
-			case D3DTSS_COLORARG0:
-				switch(value & D3DTA_SELECTMASK)
+				for(unsigned int level = 0; level < source->GetLevelCount() && level < dest->GetLevelCount(); level++)   // FIXME: Fail when source texture has fewer levels than the destination
 				{
-				case D3DTA_CURRENT:
-					renderer->setThirdArgument(stage, sw::TextureStage::SOURCE_CURRENT);
-					break;
-				case D3DTA_DIFFUSE:
-					renderer->setThirdArgument(stage, sw::TextureStage::SOURCE_DIFFUSE);
-					break;
-				case D3DTA_SPECULAR:
-					renderer->setThirdArgument(stage, sw::TextureStage::SOURCE_SPECULAR);
-					break;
-				case D3DTA_TEMP:
-					renderer->setThirdArgument(stage, sw::TextureStage::SOURCE_TEMP);
-					break;
-				case D3DTA_TEXTURE:
-					renderer->setThirdArgument(stage, sw::TextureStage::SOURCE_TEXTURE);
-					break;
-				case D3DTA_TFACTOR:
-					renderer->setThirdArgument(stage, sw::TextureStage::SOURCE_TFACTOR);
-					break;
-				default:
-					ASSERT(false);
-				}
+					IDirect3DVolume9 *sourceVolume;
+					IDirect3DVolume9 *destinationVolume;
 
-				switch(value & ~D3DTA_SELECTMASK)
-				{
-				case 0:
-					renderer->setThirdModifier(stage, sw::TextureStage::MODIFIER_COLOR);
-					break;
-				case D3DTA_COMPLEMENT:
-					renderer->setThirdModifier(stage, sw::TextureStage::MODIFIER_INVCOLOR);
-					break;
-				case D3DTA_ALPHAREPLICATE:
-					renderer->setThirdModifier(stage, sw::TextureStage::MODIFIER_ALPHA);
-					break;
-				case D3DTA_COMPLEMENT | D3DTA_ALPHAREPLICATE:
-					renderer->setThirdModifier(stage, sw::TextureStage::MODIFIER_INVALPHA);
-					break;
-				default:
-					ASSERT(false);
-				}
-				break;
-			case D3DTSS_ALPHAARG0:
-				switch(value & D3DTA_SELECTMASK)
-				{
-				case D3DTA_DIFFUSE:
-					renderer->setThirdArgumentAlpha(stage, sw::TextureStage::SOURCE_DIFFUSE);
-					break;
-				case D3DTA_CURRENT:
-					renderer->setThirdArgumentAlpha(stage, sw::TextureStage::SOURCE_CURRENT);
-					break;
-				case D3DTA_TEXTURE:
-					renderer->setThirdArgumentAlpha(stage, sw::TextureStage::SOURCE_TEXTURE);
-					break;
-				case D3DTA_TFACTOR:
-					renderer->setThirdArgumentAlpha(stage, sw::TextureStage::SOURCE_TFACTOR);
-					break;
-				case D3DTA_SPECULAR:
-					renderer->setThirdArgumentAlpha(stage, sw::TextureStage::SOURCE_SPECULAR);
-					break;
-				case D3DTA_TEMP:
-					renderer->setThirdArgumentAlpha(stage, sw::TextureStage::SOURCE_TEMP);
-					break;
-				case D3DTA_CONSTANT:
-					renderer->setThirdArgumentAlpha(stage, sw::TextureStage::SOURCE_CONSTANT);
-					break;
-				default:
-					ASSERT(false);
-				}
+					source->GetVolumeLevel(level, &sourceVolume);
+					dest->GetVolumeLevel(level, &destinationVolume);
 
-				switch(value & ~D3DTA_SELECTMASK)
-				{
-				case 0:
-					renderer->setThirdModifierAlpha(stage, sw::TextureStage::MODIFIER_COLOR);
-					break;
-				case D3DTA_COMPLEMENT:
-					renderer->setThirdModifierAlpha(stage, sw::TextureStage::MODIFIER_INVCOLOR);
-					break;
-				case D3DTA_ALPHAREPLICATE:
-					renderer->setThirdModifierAlpha(stage, sw::TextureStage::MODIFIER_ALPHA);
-					break;
-				case D3DTA_COMPLEMENT | D3DTA_ALPHAREPLICATE:
-					renderer->setThirdModifierAlpha(stage, sw::TextureStage::MODIFIER_INVALPHA);
-					break;
-				default:
-					ASSERT(false);
+					updateVolume(sourceVolume, destinationVolume);
+
+					sourceVolume->Release();
+					destinationVolume->Release();
 				}
-				break;
-			case D3DTSS_RESULTARG:
-				switch(value & D3DTA_SELECTMASK)
+
+				source->Release();
+				dest->Release();
+			}
+			break;
+		case D3DRTYPE_CUBETEXTURE:
+			{
+				IDirect3DCubeTexture9 *source;
+				IDirect3DCubeTexture9 *dest;
+
+				sourceTexture->QueryInterface(IID_IDirect3DCubeTexture9, (void**)&source);
+				destinationTexture->QueryInterface(IID_IDirect3DCubeTexture9, (void**)&dest);
+
+				ASSERT(source && dest);
+
+				for(int face = 0; face < 6; face++)
 				{
-				case D3DTA_CURRENT:
-					renderer->setDestinationArgument(stage, sw::TextureStage::DESTINATION_CURRENT);
-					break;
-				case D3DTA_TEMP:
-					renderer->setDestinationArgument(stage, sw::TextureStage::DESTINATION_TEMP);
-					break;
-				default:
-					ASSERT(false);
+					for(unsigned int level = 0; level < source->GetLevelCount() && level < dest->GetLevelCount(); level++)   // FIXME: Fail when source texture has fewer levels than the destination
+					{
+						IDirect3DSurface9 *sourceSurface;
+						IDirect3DSurface9 *destinationSurface;
+
+						source->GetCubeMapSurface((D3DCUBEMAP_FACES)face, level, &sourceSurface);
+						dest->GetCubeMapSurface((D3DCUBEMAP_FACES)face, level, &destinationSurface);
+
+						UpdateSurface(sourceSurface, 0, destinationSurface, 0);
+
+						sourceSurface->Release();
+						destinationSurface->Release();
+					}
 				}
-				break;
-			case D3DTSS_CONSTANT:
-				renderer->setConstantColor(stage, value);
-				break;
-			default:
-				ASSERT(false);
+
+				source->Release();
+				dest->Release();
 			}
-		}
-		else   // stateRecorder
-		{
-			stateRecorder->setTextureStageState(stage, type, value);
+			break;
+		default:
+			UNIMPLEMENTED();
 		}
 
 		return D3D_OK;
 	}
 
-	long Direct3DDevice9::SetTransform(D3DTRANSFORMSTATETYPE state, const D3DMATRIX *matrix)
+	long Direct3DDevice9::ValidateDevice(unsigned long *numPasses)
 	{
 		CriticalSection cs(this);
 
-		TRACE("D3DTRANSFORMSTATETYPE state = %d, const D3DMATRIX *matrix = 0x%0.8p", state, matrix);
+		TRACE("unsigned long *numPasses = 0x%0.8p", numPasses);
 
-		if(!matrix)
+		if(!numPasses)
 		{
 			return INVALIDCALL();
 		}
 
-		if(!stateRecorder)
-		{
-			this->matrix[state] = *matrix;
+		*numPasses = 1;
 
-			sw::Matrix M(matrix->_11, matrix->_21, matrix->_31, matrix->_41,
-			             matrix->_12, matrix->_22, matrix->_32, matrix->_42,
-			             matrix->_13, matrix->_23, matrix->_33, matrix->_43,
-			             matrix->_14, matrix->_24, matrix->_34, matrix->_44);
+		return D3D_OK;
+	}
 
-			switch(state)
-			{
-			case D3DTS_WORLD:
-				renderer->setModelMatrix(M);
-				break;
-			case D3DTS_VIEW:
-				renderer->setViewMatrix(M);
-				break;
-			case D3DTS_PROJECTION:
-				renderer->setProjectionMatrix(M);
-				break;
-			case D3DTS_TEXTURE0:
-				renderer->setTextureMatrix(0, M);
-				break;
-			case D3DTS_TEXTURE1:
-				renderer->setTextureMatrix(1, M);
-				break;
-			case D3DTS_TEXTURE2:
-				renderer->setTextureMatrix(2, M);
-				break;
-			case D3DTS_TEXTURE3:
-				renderer->setTextureMatrix(3, M);
-				break;
-			case D3DTS_TEXTURE4:
-				renderer->setTextureMatrix(4, M);
-				break;
-			case D3DTS_TEXTURE5:
-				renderer->setTextureMatrix(5, M);
-				break;
-			case D3DTS_TEXTURE6:
-				renderer->setTextureMatrix(6, M);
-				break;
-			case D3DTS_TEXTURE7:
-				renderer->setTextureMatrix(7, M);
-				break;
-			default:
-				if(state > 256 && state < 512)
-				{
-					renderer->setModelMatrix(M, state - 256);
-				}
-				else ASSERT(false);
-			}
-		}
-		else   // stateRecorder
-		{
-			stateRecorder->setTransform(state, matrix);
-		}
-
-		return D3D_OK;
+	long Direct3DDevice9::getAdapterDisplayMode(unsigned int adapter, D3DDISPLAYMODE *mode)
+	{
+		return d3d9->GetAdapterDisplayMode(adapter, mode);
 	}
 
-	long Direct3DDevice9::SetVertexDeclaration(IDirect3DVertexDeclaration9 *iVertexDeclaration)
+	int Direct3DDevice9::typeStride(unsigned char streamType)
 	{
-		CriticalSection cs(this);
-
-		TRACE("IDirect3DVertexDeclaration9 *declaration = 0x%0.8p", iVertexDeclaration);
-
-		Direct3DVertexDeclaration9 *vertexDeclaration = static_cast<Direct3DVertexDeclaration9*>(iVertexDeclaration);
-
-		if(!stateRecorder)
-		{
-			if(this->vertexDeclaration == vertexDeclaration)
-			{
-				return D3D_OK;
-			}
-
-			if(vertexDeclaration)
-			{
-				vertexDeclaration->bind();
-			}
-
-			if(this->vertexDeclaration)
-			{
-				this->vertexDeclaration->unbind();
-			}
-
-			this->vertexDeclaration = vertexDeclaration;
-		}
-		else
+		static int LUT[] =
 		{
-			stateRecorder->setVertexDeclaration(vertexDeclaration);
-		}
+			4,	// D3DDECLTYPE_FLOAT1    =  0,  // 1D float expanded to (value, 0., 0., 1.)
+			8,	// D3DDECLTYPE_FLOAT2    =  1,  // 2D float expanded to (value, value, 0., 1.)
+			12,	// D3DDECLTYPE_FLOAT3    =  2,  // 3D float expanded to (value, value, value, 1.)
+			16,	// D3DDECLTYPE_FLOAT4    =  3,  // 4D float
+			4,	// D3DDECLTYPE_D3DCOLOR  =  4,  // 4D packed unsigned bytes mapped to 0. to 1. range. Input is in D3DCOLOR format (ARGB) expanded to (R, G, B, A)
+			4,	// D3DDECLTYPE_UBYTE4    =  5,  // 4D unsigned byte
+			4,	// D3DDECLTYPE_SHORT2    =  6,  // 2D signed short expanded to (value, value, 0., 1.)
+			8,	// D3DDECLTYPE_SHORT4    =  7,  // 4D signed short
+			4,	// D3DDECLTYPE_UBYTE4N   =  8,  // Each of 4 bytes is normalized by dividing to 255.0
+			4,	// D3DDECLTYPE_SHORT2N   =  9,  // 2D signed short normalized (v[0]/32767.0,v[1]/32767.0,0,1)
+			8,	// D3DDECLTYPE_SHORT4N   = 10,  // 4D signed short normalized (v[0]/32767.0,v[1]/32767.0,v[2]/32767.0,v[3]/32767.0)
+			4,	// D3DDECLTYPE_USHORT2N  = 11,  // 2D unsigned short normalized (v[0]/65535.0,v[1]/65535.0,0,1)
+			8,	// D3DDECLTYPE_USHORT4N  = 12,  // 4D unsigned short normalized (v[0]/65535.0,v[1]/65535.0,v[2]/65535.0,v[3]/65535.0)
+			4,	// D3DDECLTYPE_UDEC3     = 13,  // 3D unsigned 10 10 10 format expanded to (value, value, value, 1)
+			4,	// D3DDECLTYPE_DEC3N     = 14,  // 3D signed 10 10 10 format normalized and expanded to (v[0]/511.0, v[1]/511.0, v[2]/511.0, 1)
+			4,	// D3DDECLTYPE_FLOAT16_2 = 15,  // Two 16-bit floating point values, expanded to (value, value, 0, 1)
+			8,	// D3DDECLTYPE_FLOAT16_4 = 16,  // Four 16-bit floating point values
+			0,	// D3DDECLTYPE_UNUSED    = 17,  // When the type field in a decl is unused.
+		};
 
-		return D3D_OK;
+		return LUT[streamType];
 	}
 
-	long Direct3DDevice9::SetVertexShader(IDirect3DVertexShader9 *iVertexShader)
+	bool Direct3DDevice9::instanceData()
 	{
-		CriticalSection cs(this);
+		ASSERT(vertexDeclaration);
 
-		TRACE("IDirect3DVertexShader9 *shader = 0x%0.8p", iVertexShader);
+		D3DVERTEXELEMENT9 vertexElement[MAXD3DDECLLENGTH + 1];
+		unsigned int numElements;
+		vertexDeclaration->GetDeclaration(vertexElement, &numElements);
 
-		Direct3DVertexShader9 *vertexShader = static_cast<Direct3DVertexShader9*>(iVertexShader);
+		bool instanceData = false;
 
-		if(!stateRecorder)
+		for(unsigned int i = 0; i < numElements - 1; i++)
 		{
-			if(this->vertexShader == vertexShader)
-			{
-				return D3D_OK;
-			}
-
-			if(vertexShader)
-			{
-				vertexShader->bind();
-			}
+			unsigned short stream = vertexElement[i].Stream;
 
-			if(this->vertexShader)
+			if(stream != 0)
 			{
-				this->vertexShader->unbind();
+				instanceData = instanceData || (streamSourceFreq[stream] & D3DSTREAMSOURCE_INSTANCEDATA) != 0;
 			}
-
-			this->vertexShader = vertexShader;
-			vertexShaderDirty = true;
-		}
-		else
-		{
-			stateRecorder->setVertexShader(vertexShader);
 		}
 
-		return D3D_OK;
+		return instanceData;
 	}
 
-	long Direct3DDevice9::SetVertexShaderConstantB(unsigned int startRegister, const int *constantData, unsigned int count)
+	void Direct3DDevice9::applyState()
 	{
-		CriticalSection cs(this);
-
-		TRACE("unsigned int startRegister = %d, const int *constantData = 0x%0.8p, unsigned int count = %d", startRegister, constantData, count);
-
-		if(!constantData)
-		{
-			return INVALIDCALL();
-		}
-
-		if(!stateRecorder)
+		for(int i = 0; i < dirtyRenderStateCount; i++)
 		{
-			for(unsigned int i = 0; i < count && startRegister + i < 16; i++)
-			{
-				vertexShaderConstantB[startRegister + i] = constantData[i];
-			}
+			D3DRENDERSTATETYPE state = dirtyRenderState[i];
 
-			vertexShaderConstantsBDirty = sw::max(startRegister + count, vertexShaderConstantsBDirty);
-			vertexShaderDirty = true;   // Reload DEF constants
-		}
-		else
-		{
-			stateRecorder->setVertexShaderConstantB(startRegister, constantData, count);
+			renderStateDirty[state] = false;
+			applyRenderState(state, renderState[state]);
 		}
 
-		return D3D_OK;
-	}
-
-	long Direct3DDevice9::SetVertexShaderConstantF(unsigned int startRegister, const float *constantData, unsigned int count)
-	{
-		CriticalSection cs(this);
-
-		TRACE("unsigned int startRegister = %d, const int *constantData = 0x%0.8p, unsigned int count = %d", startRegister, constantData, count);
-
-		if(!constantData)
+		for(int i = 0; i < dirtySamplerStateCount; i++)
 		{
-			return INVALIDCALL();
+			unsigned long sampler = dirtySamplerState[i] / (D3DSAMP_DMAPOFFSET + 1);
+			D3DSAMPLERSTATETYPE state = (D3DSAMPLERSTATETYPE)(dirtySamplerState[i] % (D3DSAMP_DMAPOFFSET + 1));
+
+			samplerStateDirty[sampler][state] = false;
+			applySamplerState(sampler, state, samplerState[sampler][state]);
 		}
 
-		if(!stateRecorder)
+		for(int i = 0; i < dirtyTextureStageStateCount; i++)
 		{
-			for(unsigned int i = 0; i < count && startRegister + i < MAX_VERTEX_SHADER_CONST; i++)
-			{
-				vertexShaderConstantF[startRegister + i][0] = constantData[i * 4 + 0];
-				vertexShaderConstantF[startRegister + i][1] = constantData[i * 4 + 1];
-				vertexShaderConstantF[startRegister + i][2] = constantData[i * 4 + 2];
-				vertexShaderConstantF[startRegister + i][3] = constantData[i * 4 + 3];
-			}
+			unsigned long stage = dirtyTextureStageState[i] / (D3DTSS_CONSTANT + 1);
+			D3DTEXTURESTAGESTATETYPE type = (D3DTEXTURESTAGESTATETYPE)(dirtyTextureStageState[i] % (D3DTSS_CONSTANT + 1));
 
-			vertexShaderConstantsFDirty = sw::max(startRegister + count, vertexShaderConstantsFDirty);
-			vertexShaderDirty = true;   // Reload DEF constants
-		}
-		else
-		{
-			stateRecorder->setVertexShaderConstantF(startRegister, constantData, count);
+			textureStageStateDirty[stage][type] = false;
+			applyTextureStageState(stage, type, textureStageState[stage][type]);
 		}
 
-		return D3D_OK;
+		dirtyRenderStateCount = 0;
+		dirtySamplerStateCount = 0;
+		dirtyTextureStageStateCount = 0;
 	}
 
-	long Direct3DDevice9::SetVertexShaderConstantI(unsigned int startRegister, const int *constantData, unsigned int count)
+	void Direct3DDevice9::applyRenderState(D3DRENDERSTATETYPE state, unsigned long value)
 	{
-		CriticalSection cs(this);
-
-		TRACE("unsigned int startRegister = %d, const int *constantData = 0x%0.8p, unsigned int count = %d", startRegister, constantData, count);
-
-		if(!constantData)
-		{
-			return INVALIDCALL();
-		}
-
-		if(!stateRecorder)
+		switch(state)
 		{
-			for(unsigned int i = 0; i < count && startRegister + i < 16; i++)
+		case D3DRS_ZENABLE:
+			switch(value)
 			{
-				vertexShaderConstantI[startRegister + i][0] = constantData[i * 4 + 0];
-				vertexShaderConstantI[startRegister + i][1] = constantData[i * 4 + 1];
-				vertexShaderConstantI[startRegister + i][2] = constantData[i * 4 + 2];
-				vertexShaderConstantI[startRegister + i][3] = constantData[i * 4 + 3];
+			case D3DZB_TRUE:
+			case D3DZB_USEW:
+				renderer->setDepthBufferEnable(true);
+				break;
+			case D3DZB_FALSE:
+				renderer->setDepthBufferEnable(false);
+				break;
+			default:
+				ASSERT(false);
 			}
-
-			vertexShaderConstantsIDirty = sw::max(startRegister + count, vertexShaderConstantsIDirty);
-			vertexShaderDirty = true;   // Reload DEF constants
-		}
-		else
-		{
-			stateRecorder->setVertexShaderConstantI(startRegister, constantData, count);
-		}
-
-		return D3D_OK;
-	}
-
-	long Direct3DDevice9::SetViewport(const D3DVIEWPORT9 *viewport)
-	{
-		CriticalSection cs(this);
-
-		TRACE("const D3DVIEWPORT9 *viewport = 0x%0.8p", viewport);
-
-		if(!viewport)   // FIXME: Check if valid
-		{
-			return INVALIDCALL();
-		}
-
-		if(!stateRecorder)
-		{
-			this->viewport = *viewport;
-		}
-		else
-		{
-			stateRecorder->setViewport(viewport);
-		}
-
-		return D3D_OK;
-	}
-
-	int Direct3DDevice9::ShowCursor(int show)
-	{
-		CriticalSection cs(this);
-
-		TRACE("int show = %d", show);
-
-		int oldValue = showCursor ? TRUE : FALSE;
-		showCursor = show != FALSE;
-
-		if(showCursor)
-		{
-			sw::FrameBuffer::setCursorImage(cursor);
-		}
-		else
-		{
-			sw::FrameBuffer::setCursorImage(0);
-		}
-
-		return oldValue;
-	}
-
-	long Direct3DDevice9::StretchRect(IDirect3DSurface9 *sourceSurface, const RECT *sourceRect, IDirect3DSurface9 *destSurface, const RECT *destRect, D3DTEXTUREFILTERTYPE filter)
-	{
-		CriticalSection cs(this);
-
-		TRACE("IDirect3DSurface9 *sourceSurface = 0x%0.8p, const RECT *sourceRect = 0x%0.8p, IDirect3DSurface9 *destSurface = 0x%0.8p, const RECT *destRect = 0x%0.8p, D3DTEXTUREFILTERTYPE filter = %d", sourceSurface, sourceRect, destSurface, destRect, filter);
-
-		if(!sourceSurface || !destSurface || !validRectangle(sourceRect, sourceSurface) || !validRectangle(destRect, destSurface))
-		{
-			return INVALIDCALL();
-		}
-
-		D3DSURFACE_DESC sourceDescription;
-		D3DSURFACE_DESC destDescription;
-
-		sourceSurface->GetDesc(&sourceDescription);
-		destSurface->GetDesc(&destDescription);
-
-		if(sourceDescription.Pool != D3DPOOL_DEFAULT || destDescription.Pool != D3DPOOL_DEFAULT)
-		{
-			return INVALIDCALL();
+			break;
+		case D3DRS_FILLMODE:
+			switch(value)
+			{
+			case D3DFILL_POINT:
+				renderer->setFillMode(sw::FILL_VERTEX);
+				break;
+			case D3DFILL_WIREFRAME:
+				renderer->setFillMode(sw::FILL_WIREFRAME);
+				break;
+			case D3DFILL_SOLID:
+				renderer->setFillMode(sw::FILL_SOLID);
+				break;
+			default:
+				ASSERT(false);
+			}
+			break;
+		case D3DRS_SHADEMODE:
+			switch(value)
+			{
+			case D3DSHADE_FLAT:
+				renderer->setShadingMode(sw::SHADING_FLAT);
+				break;
+			case D3DSHADE_GOURAUD:
+				renderer->setShadingMode(sw::SHADING_GOURAUD);
+				break;
+			case D3DSHADE_PHONG:
+				break;
+			default:
+				ASSERT(false);
+			}
+			break;
+		case D3DRS_ZWRITEENABLE:
+			renderer->setDepthWriteEnable(value != FALSE);
+			break;
+		case D3DRS_ALPHATESTENABLE:
+			renderer->setAlphaTestEnable(value != FALSE);
+			break;
+		case D3DRS_LASTPIXEL:
+		//	if(!init) UNIMPLEMENTED();   // FIXME
+			break;
+		case D3DRS_SRCBLEND:
+			switch(value)
+			{
+			case D3DBLEND_ZERO:
+				renderer->setSourceBlendFactor(sw::BLEND_ZERO);
+				break;
+			case D3DBLEND_ONE:
+				renderer->setSourceBlendFactor(sw::BLEND_ONE);
+				break;
+			case D3DBLEND_SRCCOLOR:
+				renderer->setSourceBlendFactor(sw::BLEND_SOURCE);
+				break;
+			case D3DBLEND_INVSRCCOLOR:
+				renderer->setSourceBlendFactor(sw::BLEND_INVSOURCE);
+				break;
+			case D3DBLEND_SRCALPHA:
+				renderer->setSourceBlendFactor(sw::BLEND_SOURCEALPHA);
+				break;
+			case D3DBLEND_INVSRCALPHA:
+				renderer->setSourceBlendFactor(sw::BLEND_INVSOURCEALPHA);
+				break;
+			case D3DBLEND_DESTALPHA:
+				renderer->setSourceBlendFactor(sw::BLEND_DESTALPHA);
+				break;
+			case D3DBLEND_INVDESTALPHA:
+				renderer->setSourceBlendFactor(sw::BLEND_INVDESTALPHA);
+				break;
+			case D3DBLEND_DESTCOLOR:
+				renderer->setSourceBlendFactor(sw::BLEND_DEST);
+				break;
+			case D3DBLEND_INVDESTCOLOR:
+				renderer->setSourceBlendFactor(sw::BLEND_INVDEST);
+				break;
+			case D3DBLEND_SRCALPHASAT:
+				renderer->setSourceBlendFactor(sw::BLEND_SRCALPHASAT);
+				break;
+			case D3DBLEND_BOTHSRCALPHA:
+				renderer->setSourceBlendFactor(sw::BLEND_SOURCEALPHA);
+				renderer->setDestBlendFactor(sw::BLEND_INVSOURCEALPHA);
+				break;
+			case D3DBLEND_BOTHINVSRCALPHA:
+				renderer->setSourceBlendFactor(sw::BLEND_INVSOURCEALPHA);
+				renderer->setDestBlendFactor(sw::BLEND_SOURCEALPHA);
+				break;
+			case D3DBLEND_BLENDFACTOR:
+				renderer->setSourceBlendFactor(sw::BLEND_CONSTANT);
+				break;
+			case D3DBLEND_INVBLENDFACTOR:
+				renderer->setSourceBlendFactor(sw::BLEND_INVCONSTANT);
+				break;
+			default:
+				ASSERT(false);
+			}
+			break;
+		case D3DRS_DESTBLEND:
+			switch(value)
+			{
+			case D3DBLEND_ZERO:
+				renderer->setDestBlendFactor(sw::BLEND_ZERO);
+				break;
+			case D3DBLEND_ONE:
+				renderer->setDestBlendFactor(sw::BLEND_ONE);
+				break;
+			case D3DBLEND_SRCCOLOR:
+				renderer->setDestBlendFactor(sw::BLEND_SOURCE);
+				break;
+			case D3DBLEND_INVSRCCOLOR:
+				renderer->setDestBlendFactor(sw::BLEND_INVSOURCE);
+				break;
+			case D3DBLEND_SRCALPHA:
+				renderer->setDestBlendFactor(sw::BLEND_SOURCEALPHA);
+				break;
+			case D3DBLEND_INVSRCALPHA:
+				renderer->setDestBlendFactor(sw::BLEND_INVSOURCEALPHA);
+				break;
+			case D3DBLEND_DESTALPHA:
+				renderer->setDestBlendFactor(sw::BLEND_DESTALPHA);
+				break;
+			case D3DBLEND_INVDESTALPHA:
+				renderer->setDestBlendFactor(sw::BLEND_INVDESTALPHA);
+				break;
+			case D3DBLEND_DESTCOLOR:
+				renderer->setDestBlendFactor(sw::BLEND_DEST);
+				break;
+			case D3DBLEND_INVDESTCOLOR:
+				renderer->setDestBlendFactor(sw::BLEND_INVDEST);
+				break;
+			case D3DBLEND_SRCALPHASAT:
+				renderer->setDestBlendFactor(sw::BLEND_SRCALPHASAT);
+				break;
+			case D3DBLEND_BOTHSRCALPHA:
+				renderer->setSourceBlendFactor(sw::BLEND_SOURCEALPHA);
+				renderer->setDestBlendFactor(sw::BLEND_INVSOURCEALPHA);
+				break;
+			case D3DBLEND_BOTHINVSRCALPHA:
+				renderer->setSourceBlendFactor(sw::BLEND_INVSOURCEALPHA);
+				renderer->setDestBlendFactor(sw::BLEND_SOURCEALPHA);
+				break;
+			case D3DBLEND_BLENDFACTOR:
+				renderer->setDestBlendFactor(sw::BLEND_CONSTANT);
+				break;
+			case D3DBLEND_INVBLENDFACTOR:
+				renderer->setDestBlendFactor(sw::BLEND_INVCONSTANT);
+				break;
+			default:
+				ASSERT(false);
+			}
+			break;
+		case D3DRS_CULLMODE:
+			switch(value)
+			{
+			case D3DCULL_NONE:
+				renderer->setCullMode(sw::CULL_NONE, true);
+				break;
+			case D3DCULL_CCW:
+				renderer->setCullMode(sw::CULL_COUNTERCLOCKWISE, true);
+				break;
+			case D3DCULL_CW:
+				renderer->setCullMode(sw::CULL_CLOCKWISE, true);
+				break;
+			default:
+				ASSERT(false);
+			}
+			break;
+		case D3DRS_ZFUNC:
+			switch(value)
+			{
+			case D3DCMP_NEVER:
+				renderer->setDepthCompare(sw::DEPTH_NEVER);
+				break;
+			case D3DCMP_LESS:
+				renderer->setDepthCompare(sw::DEPTH_LESS);
+				break;
+			case D3DCMP_EQUAL:
+				renderer->setDepthCompare(sw::DEPTH_EQUAL);
+				break;
+			case D3DCMP_LESSEQUAL:
+				renderer->setDepthCompare(sw::DEPTH_LESSEQUAL);
+				break;
+			case D3DCMP_GREATER:
+				renderer->setDepthCompare(sw::DEPTH_GREATER);
+				break;
+			case D3DCMP_NOTEQUAL:
+				renderer->setDepthCompare(sw::DEPTH_NOTEQUAL);
+				break;
+			case D3DCMP_GREATEREQUAL:
+				renderer->setDepthCompare(sw::DEPTH_GREATEREQUAL);
+				break;
+			case D3DCMP_ALWAYS:
+				renderer->setDepthCompare(sw::DEPTH_ALWAYS);
+				break;
+			default:
+				ASSERT(false);
+			}
+			break;
+		case D3DRS_ALPHAREF:
+			renderer->setAlphaReference(value & 0x000000FF);
+			break;
+		case D3DRS_ALPHAFUNC:
+			switch(value)
+			{
+			case D3DCMP_NEVER:
+				renderer->setAlphaCompare(sw::ALPHA_NEVER);
+				break;
+			case D3DCMP_LESS:
+				renderer->setAlphaCompare(sw::ALPHA_LESS);
+				break;
+			case D3DCMP_EQUAL:
+				renderer->setAlphaCompare(sw::ALPHA_EQUAL);
+				break;
+			case D3DCMP_LESSEQUAL:
+				renderer->setAlphaCompare(sw::ALPHA_LESSEQUAL);
+				break;
+			case D3DCMP_GREATER:
+				renderer->setAlphaCompare(sw::ALPHA_GREATER);
+				break;
+			case D3DCMP_NOTEQUAL:
+				renderer->setAlphaCompare(sw::ALPHA_NOTEQUAL);
+				break;
+			case D3DCMP_GREATEREQUAL:
+				renderer->setAlphaCompare(sw::ALPHA_GREATEREQUAL);
+				break;
+			case D3DCMP_ALWAYS:
+				renderer->setAlphaCompare(sw::ALPHA_ALWAYS);
+				break;
+			default:
+				ASSERT(false);
+			}
+			break;
+		case D3DRS_DITHERENABLE:
+		//	if(!init) UNIMPLEMENTED();
+			break;
+		case D3DRS_ALPHABLENDENABLE:
+			renderer->setAlphaBlendEnable(value != FALSE);
+			break;
+		case D3DRS_FOGENABLE:
+			renderer->setFogEnable(value != FALSE);
+			break;
+		case D3DRS_FOGCOLOR:
+			renderer->setFogColor(value);
+			break;
+		case D3DRS_FOGTABLEMODE:
+			switch(value)
+			{
+			case D3DFOG_NONE:
+				renderer->setPixelFogMode(sw::FOG_NONE);
+				break;
+			case D3DFOG_LINEAR:
+				renderer->setPixelFogMode(sw::FOG_LINEAR);
+				break;
+			case D3DFOG_EXP:
+				renderer->setPixelFogMode(sw::FOG_EXP);
+				break;
+			case D3DFOG_EXP2:
+				renderer->setPixelFogMode(sw::FOG_EXP2);
+				break;
+			default:
+				ASSERT(false);
+			}
+			break;
+		case D3DRS_FOGSTART:
+			renderer->setFogStart((float&)value);
+			break;
+		case D3DRS_FOGEND:
+			renderer->setFogEnd((float&)value);
+			break;
+		case D3DRS_FOGDENSITY:
+			renderer->setFogDensity((float&)value);
+			break;
+		case D3DRS_RANGEFOGENABLE:
+			renderer->setRangeFogEnable(value != FALSE);
+			break;
+		case D3DRS_SPECULARENABLE:
+			renderer->setSpecularEnable(value != FALSE);
+			break;
+		case D3DRS_STENCILENABLE:
+			renderer->setStencilEnable(value != FALSE);
+			break;
+		case D3DRS_STENCILFAIL:
+			switch(value)
+			{
+			case D3DSTENCILOP_KEEP:
+				renderer->setStencilFailOperation(sw::OPERATION_KEEP);
+				break;
+			case D3DSTENCILOP_ZERO:
+				renderer->setStencilFailOperation(sw::OPERATION_ZERO);
+				break;
+			case D3DSTENCILOP_REPLACE:
+				renderer->setStencilFailOperation(sw::OPERATION_REPLACE);
+				break;
+			case D3DSTENCILOP_INCRSAT:
+				renderer->setStencilFailOperation(sw::OPERATION_INCRSAT);
+				break;
+			case D3DSTENCILOP_DECRSAT:
+				renderer->setStencilFailOperation(sw::OPERATION_DECRSAT);
+				break;
+			case D3DSTENCILOP_INVERT:
+				renderer->setStencilFailOperation(sw::OPERATION_INVERT);
+				break;
+			case D3DSTENCILOP_INCR:
+				renderer->setStencilFailOperation(sw::OPERATION_INCR);
+				break;
+			case D3DSTENCILOP_DECR:
+				renderer->setStencilFailOperation(sw::OPERATION_DECR);
+				break;
+			default:
+				ASSERT(false);
+			}
+			break;
+		case D3DRS_STENCILZFAIL:
+			switch(value)
+			{
+			case D3DSTENCILOP_KEEP:
+				renderer->setStencilZFailOperation(sw::OPERATION_KEEP);
+				break;
+			case D3DSTENCILOP_ZERO:
+				renderer->setStencilZFailOperation(sw::OPERATION_ZERO);
+				break;
+			case D3DSTENCILOP_REPLACE:
+				renderer->setStencilZFailOperation(sw::OPERATION_REPLACE);
+				break;
+			case D3DSTENCILOP_INCRSAT:
+				renderer->setStencilZFailOperation(sw::OPERATION_INCRSAT);
+				break;
+			case D3DSTENCILOP_DECRSAT:
+				renderer->setStencilZFailOperation(sw::OPERATION_DECRSAT);
+				break;
+			case D3DSTENCILOP_INVERT:
+				renderer->setStencilZFailOperation(sw::OPERATION_INVERT);
+				break;
+			case D3DSTENCILOP_INCR:
+				renderer->setStencilZFailOperation(sw::OPERATION_INCR);
+				break;
+			case D3DSTENCILOP_DECR:
+				renderer->setStencilZFailOperation(sw::OPERATION_DECR);
+				break;
+			default:
+				ASSERT(false);
+			}
+			break;
+		case D3DRS_STENCILPASS:
+			switch(value)
+			{
+			case D3DSTENCILOP_KEEP:
+				renderer->setStencilPassOperation(sw::OPERATION_KEEP);
+				break;
+			case D3DSTENCILOP_ZERO:
+				renderer->setStencilPassOperation(sw::OPERATION_ZERO);
+				break;
+			case D3DSTENCILOP_REPLACE:
+				renderer->setStencilPassOperation(sw::OPERATION_REPLACE);
+				break;
+			case D3DSTENCILOP_INCRSAT:
+				renderer->setStencilPassOperation(sw::OPERATION_INCRSAT);
+				break;
+			case D3DSTENCILOP_DECRSAT:
+				renderer->setStencilPassOperation(sw::OPERATION_DECRSAT);
+				break;
+			case D3DSTENCILOP_INVERT:
+				renderer->setStencilPassOperation(sw::OPERATION_INVERT);
+				break;
+			case D3DSTENCILOP_INCR:
+				renderer->setStencilPassOperation(sw::OPERATION_INCR);
+				break;
+			case D3DSTENCILOP_DECR:
+				renderer->setStencilPassOperation(sw::OPERATION_DECR);
+				break;
+			default:
+				ASSERT(false);
+			}
+			break;
+		case D3DRS_STENCILFUNC:
+			switch(value)
+			{
+			case D3DCMP_NEVER:
+				renderer->setStencilCompare(sw::STENCIL_NEVER);
+				break;
+			case D3DCMP_LESS:
+				renderer->setStencilCompare(sw::STENCIL_LESS);
+				break;
+			case D3DCMP_EQUAL:
+				renderer->setStencilCompare(sw::STENCIL_EQUAL);
+				break;
+			case D3DCMP_LESSEQUAL:
+				renderer->setStencilCompare(sw::STENCIL_LESSEQUAL);
+				break;
+			case D3DCMP_GREATER:
+				renderer->setStencilCompare(sw::STENCIL_GREATER);
+				break;
+			case D3DCMP_NOTEQUAL:
+				renderer->setStencilCompare(sw::STENCIL_NOTEQUAL);
+				break;
+			case D3DCMP_GREATEREQUAL:
+				renderer->setStencilCompare(sw::STENCIL_GREATEREQUAL);
+				break;
+			case D3DCMP_ALWAYS:
+				renderer->setStencilCompare(sw::STENCIL_ALWAYS);
+				break;
+			default:
+				ASSERT(false);
+			}
+			break;
+		case D3DRS_STENCILREF:
+			renderer->setStencilReference(value);
+			renderer->setStencilReferenceCCW(value);
+			break;
+		case D3DRS_STENCILMASK:
+			renderer->setStencilMask(value);
+			renderer->setStencilMaskCCW(value);
+			break;
+		case D3DRS_STENCILWRITEMASK:
+			renderer->setStencilWriteMask(value);
+			renderer->setStencilWriteMaskCCW(value);
+			break;
+		case D3DRS_TEXTUREFACTOR:
+			renderer->setTextureFactor(value);
+			break;
+		case D3DRS_WRAP0:
+			renderer->setTextureWrap(0, value);
+			break;
+		case D3DRS_WRAP1:
+			renderer->setTextureWrap(1, value);
+			break;
+		case D3DRS_WRAP2:
+			renderer->setTextureWrap(2, value);
+			break;
+		case D3DRS_WRAP3:
+			renderer->setTextureWrap(3, value);
+			break;
+		case D3DRS_WRAP4:
+			renderer->setTextureWrap(4, value);
+			break;
+		case D3DRS_WRAP5:
+			renderer->setTextureWrap(5, value);
+			break;
+		case D3DRS_WRAP6:
+			renderer->setTextureWrap(6, value);
+			break;
+		case D3DRS_WRAP7:
+			renderer->setTextureWrap(7, value);
+			break;
+		case D3DRS_CLIPPING:
+			// Ignored, clipping is always performed
+			break;
+		case D3DRS_LIGHTING:
+			renderer->setLightingEnable(value != FALSE);
+			break;
+		case D3DRS_AMBIENT:
+			renderer->setGlobalAmbient(value);
+			break;
+		case D3DRS_FOGVERTEXMODE:
+			switch(value)
+			{
+			case D3DFOG_NONE:
+				renderer->setVertexFogMode(sw::FOG_NONE);
+				break;
+			case D3DFOG_LINEAR:
+				renderer->setVertexFogMode(sw::FOG_LINEAR);
+				break;
+			case D3DFOG_EXP:
+				renderer->setVertexFogMode(sw::FOG_EXP);
+				break;
+			case D3DFOG_EXP2:
+				renderer->setVertexFogMode(sw::FOG_EXP2);
+				break;
+			default:
+				ASSERT(false);
+			}
+			break;
+		case D3DRS_COLORVERTEX:
+			renderer->setColorVertexEnable(value != FALSE);
+			break;
+		case D3DRS_LOCALVIEWER:
+			renderer->setLocalViewer(value != FALSE);
+			break;
+		case D3DRS_NORMALIZENORMALS:
+			renderer->setNormalizeNormals(value != FALSE);
+			break;
+		case D3DRS_DIFFUSEMATERIALSOURCE:
+			switch(value)
+			{
+			case D3DMCS_MATERIAL:
+				renderer->setDiffuseMaterialSource(sw::MATERIAL_MATERIAL);
+				break;
+			case D3DMCS_COLOR1:
+				renderer->setDiffuseMaterialSource(sw::MATERIAL_COLOR1);
+				break;
+			case D3DMCS_COLOR2:
+				renderer->setDiffuseMaterialSource(sw::MATERIAL_COLOR2);
+				break;
+			default:
+				ASSERT(false);
+			}
+			break;
+		case D3DRS_SPECULARMATERIALSOURCE:
+			switch(value)
+			{
+			case D3DMCS_MATERIAL:
+				renderer->setSpecularMaterialSource(sw::MATERIAL_MATERIAL);
+				break;
+			case D3DMCS_COLOR1:
+				renderer->setSpecularMaterialSource(sw::MATERIAL_COLOR1);
+				break;
+			case D3DMCS_COLOR2:
+				renderer->setSpecularMaterialSource(sw::MATERIAL_COLOR2);
+				break;
+			default:
+				ASSERT(false);
+			}
+			break;
+		case D3DRS_AMBIENTMATERIALSOURCE:
+			switch(value)
+			{
+			case D3DMCS_MATERIAL:
+				renderer->setAmbientMaterialSource(sw::MATERIAL_MATERIAL);
+				break;
+			case D3DMCS_COLOR1:
+				renderer->setAmbientMaterialSource(sw::MATERIAL_COLOR1);
+				break;
+			case D3DMCS_COLOR2:
+				renderer->setAmbientMaterialSource(sw::MATERIAL_COLOR2);
+				break;
+			default:
+				ASSERT(false);
+			}
+			break;
+		case D3DRS_EMISSIVEMATERIALSOURCE:
+			switch(value)
+			{
+			case D3DMCS_MATERIAL:
+				renderer->setEmissiveMaterialSource(sw::MATERIAL_MATERIAL);
+				break;
+			case D3DMCS_COLOR1:
+				renderer->setEmissiveMaterialSource(sw::MATERIAL_COLOR1);
+				break;
+			case D3DMCS_COLOR2:
+				renderer->setEmissiveMaterialSource(sw::MATERIAL_COLOR2);
+				break;
+			default:
+				ASSERT(false);
+			}
+			break;
+		case D3DRS_VERTEXBLEND:
+			switch(value)
+			{
+			case D3DVBF_DISABLE:
+				renderer->setVertexBlendMatrixCount(0);
+				break;
+			case D3DVBF_1WEIGHTS:
+				renderer->setVertexBlendMatrixCount(2);
+				break;
+			case D3DVBF_2WEIGHTS:
+				renderer->setVertexBlendMatrixCount(3);
+				break;
+			case D3DVBF_3WEIGHTS:
+				renderer->setVertexBlendMatrixCount(4);
+				break;
+			case D3DVBF_TWEENING:
+				UNIMPLEMENTED();
+				break;
+			case D3DVBF_0WEIGHTS:
+				renderer->setVertexBlendMatrixCount(1);
+				break;
+			default:
+				ASSERT(false);
+			}
+			break;
+		case D3DRS_CLIPPLANEENABLE:
+			renderer->setClipFlags(value);
+			break;
+		case D3DRS_POINTSIZE:
+			if(value == D3DFMT_INST && pixelShaderVersionX >= D3DPS_VERSION(2, 0))   // ATI hack to enable instancing on SM 2.0 hardware
+			{
+				instancingEnabled = true;
+			}
+			else if(value == D3DFMT_A2M1)   // ATI hack to enable transparency anti-aliasing
+			{
+				renderer->setTransparencyAntialiasing(sw::TRANSPARENCY_ALPHA_TO_COVERAGE);
+				renderer->setAlphaTestEnable(true);
+			}
+			else if(value == D3DFMT_A2M0)   // ATI hack to disable transparency anti-aliasing
+			{
+				renderer->setTransparencyAntialiasing(sw::TRANSPARENCY_NONE);
+				renderer->setAlphaTestEnable(false);
+			}
+			else
+			{
+				renderer->setPointSize((float&)value);
+			}
+			break;
+		case D3DRS_POINTSIZE_MIN:
+			renderer->setPointSizeMin((float&)value);
+			break;
+		case D3DRS_POINTSPRITEENABLE:
+			renderer->setPointSpriteEnable(value != FALSE);
+			break;
+		case D3DRS_POINTSCALEENABLE:
+			renderer->setPointScaleEnable(value != FALSE);
+			break;
+		case D3DRS_POINTSCALE_A:
+			renderer->setPointScaleA((float&)value);
+			break;
+		case D3DRS_POINTSCALE_B:
+			renderer->setPointScaleB((float&)value);
+			break;
+		case D3DRS_POINTSCALE_C:
+			renderer->setPointScaleC((float&)value);
+			break;
+		case D3DRS_MULTISAMPLEANTIALIAS:
+		//	if(!init) UNIMPLEMENTED();
+			break;
+		case D3DRS_MULTISAMPLEMASK:
+			SetRenderTarget(0, renderTarget[0]);   // Sets the multi-sample mask, if maskable
+			break;
+		case D3DRS_PATCHEDGESTYLE:
+			if(!init) if(value != D3DPATCHEDGE_DISCRETE) UNIMPLEMENTED();
+			break;
+		case D3DRS_DEBUGMONITORTOKEN:
+			if(!init) UNIMPLEMENTED();
+			break;
+		case D3DRS_POINTSIZE_MAX:
+			renderer->setPointSizeMax((float&)value);
+			break;
+		case D3DRS_INDEXEDVERTEXBLENDENABLE:
+			renderer->setIndexedVertexBlendEnable(value != FALSE);
+			break;
+		case D3DRS_COLORWRITEENABLE:
+			renderer->setColorWriteMask(0, value & 0x0000000F);
+			break;
+		case D3DRS_TWEENFACTOR:
+			if(!init) UNIMPLEMENTED();
+			break;
+		case D3DRS_BLENDOP:
+			switch(value)
+			{
+			case D3DBLENDOP_ADD:
+				renderer->setBlendOperation(sw::BLENDOP_ADD);
+				break;
+			case D3DBLENDOP_SUBTRACT:
+				renderer->setBlendOperation(sw::BLENDOP_SUB);
+				break;
+			case D3DBLENDOP_REVSUBTRACT:
+				renderer->setBlendOperation(sw::BLENDOP_INVSUB);
+				break;
+			case D3DBLENDOP_MIN:
+				renderer->setBlendOperation(sw::BLENDOP_MIN);
+				break;
+			case D3DBLENDOP_MAX:
+				renderer->setBlendOperation(sw::BLENDOP_MAX);
+				break;
+			default:
+				ASSERT(false);
+			}
+			break;
+		case D3DRS_POSITIONDEGREE:
+			if(!init) UNIMPLEMENTED();
+			break;
+		case D3DRS_NORMALDEGREE:
+			if(!init) UNIMPLEMENTED();
+			break;
+		case D3DRS_SCISSORTESTENABLE:
+			break;   // Applied by SetRenderState, Clear needs it
+		case D3DRS_SLOPESCALEDEPTHBIAS:
+			renderer->setSlopeDepthBias((float&)value);
+			break;
+		case D3DRS_ANTIALIASEDLINEENABLE:
+			if(!init) if(value != FALSE) UNIMPLEMENTED();
+			break;
+		case D3DRS_MINTESSELLATIONLEVEL:
+			if(!init) UNIMPLEMENTED();
+			break;
+		case D3DRS_MAXTESSELLATIONLEVEL:
+			if(!init) UNIMPLEMENTED();
+			break;
+		case D3DRS_ADAPTIVETESS_X:
+			if(!init) if((float&)value != 0.0f) UNIMPLEMENTED();
+			break;
+		case D3DRS_ADAPTIVETESS_Y:
+			if(value == D3DFMT_ATOC)   // NVIDIA hack to enable transparency anti-aliasing
+			{
+				renderer->setTransparencyAntialiasing(sw::TRANSPARENCY_ALPHA_TO_COVERAGE);
+			}
+			else if(value == D3DFMT_UNKNOWN)   // NVIDIA hack to disable transparency anti-aliasing
+			{
+				renderer->setTransparencyAntialiasing(sw::TRANSPARENCY_NONE);
+			}
+			else
+			{
+				if(!init) if((float&)value != 0.0f) UNIMPLEMENTED();
+			}
+			break;
+		case D3DRS_ADAPTIVETESS_Z:
+			if(!init) if((float&)value != 1.0f) UNIMPLEMENTED();
+			break;
+		case D3DRS_ADAPTIVETESS_W:
+			if(!init) if((float&)value != 0.0f) UNIMPLEMENTED();
+			break;
+		case D3DRS_ENABLEADAPTIVETESSELLATION:
+			if(!init) UNIMPLEMENTED();
+			break;
+		case D3DRS_TWOSIDEDSTENCILMODE:
+			renderer->setTwoSidedStencil(value != FALSE);
+			break;
+		case D3DRS_CCW_STENCILFAIL:
+			switch(value)
+			{
+			case D3DSTENCILOP_KEEP:
+				renderer->setStencilFailOperationCCW(sw::OPERATION_KEEP);
+				break;
+			case D3DSTENCILOP_ZERO:
+				renderer->setStencilFailOperationCCW(sw::OPERATION_ZERO);
+				break;
+			case D3DSTENCILOP_REPLACE:
+				renderer->setStencilFailOperationCCW(sw::OPERATION_REPLACE);
+				break;
+			case D3DSTENCILOP_INCRSAT:
+				renderer->setStencilFailOperationCCW(sw::OPERATION_INCRSAT);
+				break;
+			case D3DSTENCILOP_DECRSAT:
+				renderer->setStencilFailOperationCCW(sw::OPERATION_DECRSAT);
+				break;
+			case D3DSTENCILOP_INVERT:
+				renderer->setStencilFailOperationCCW(sw::OPERATION_INVERT);
+				break;
+			case D3DSTENCILOP_INCR:
+				renderer->setStencilFailOperationCCW(sw::OPERATION_INCR);
+				break;
+			case D3DSTENCILOP_DECR:
+				renderer->setStencilFailOperationCCW(sw::OPERATION_DECR);
+				break;
+			default:
+				ASSERT(false);
+			}
+			break;
+		case D3DRS_CCW_STENCILZFAIL:
+			switch(value)
+			{
+			case D3DSTENCILOP_KEEP:
+				renderer->setStencilZFailOperationCCW(sw::OPERATION_KEEP);
+				break;
+			case D3DSTENCILOP_ZERO:
+				renderer->setStencilZFailOperationCCW(sw::OPERATION_ZERO);
+				break;
+			case D3DSTENCILOP_REPLACE:
+				renderer->setStencilZFailOperationCCW(sw::OPERATION_REPLACE);
+				break;
+			case D3DSTENCILOP_INCRSAT:
+				renderer->setStencilZFailOperationCCW(sw::OPERATION_INCRSAT);
+				break;
+			case D3DSTENCILOP_DECRSAT:
+				renderer->setStencilZFailOperationCCW(sw::OPERATION_DECRSAT);
+				break;
+			case D3DSTENCILOP_INVERT:
+				renderer->setStencilZFailOperationCCW(sw::OPERATION_INVERT);
+				break;
+			case D3DSTENCILOP_INCR:
+				renderer->setStencilZFailOperationCCW(sw::OPERATION_INCR);
+				break;
+			case D3DSTENCILOP_DECR:
+				renderer->setStencilZFailOperationCCW(sw::OPERATION_DECR);
+				break;
+			default:
+				ASSERT(false);
+			}
+			break;
+		case D3DRS_CCW_STENCILPASS:
+			switch(value)
+			{
+			case D3DSTENCILOP_KEEP:
+				renderer->setStencilPassOperationCCW(sw::OPERATION_KEEP);
+				break;
+			case D3DSTENCILOP_ZERO:
+				renderer->setStencilPassOperationCCW(sw::OPERATION_ZERO);
+				break;
+			case D3DSTENCILOP_REPLACE:
+				renderer->setStencilPassOperationCCW(sw::OPERATION_REPLACE);
+				break;
+			case D3DSTENCILOP_INCRSAT:
+				renderer->setStencilPassOperationCCW(sw::OPERATION_INCRSAT);
+				break;
+			case D3DSTENCILOP_DECRSAT:
+				renderer->setStencilPassOperationCCW(sw::OPERATION_DECRSAT);
+				break;
+			case D3DSTENCILOP_INVERT:
+				renderer->setStencilPassOperationCCW(sw::OPERATION_INVERT);
+				break;
+			case D3DSTENCILOP_INCR:
+				renderer->setStencilPassOperationCCW(sw::OPERATION_INCR);
+				break;
+			case D3DSTENCILOP_DECR:
+				renderer->setStencilPassOperationCCW(sw::OPERATION_DECR);
+				break;
+			default:
+				ASSERT(false);
+			}
+			break;
+		case D3DRS_CCW_STENCILFUNC:
+			switch(value)
+			{
+			case D3DCMP_NEVER:
+				renderer->setStencilCompareCCW(sw::STENCIL_NEVER);
+				break;
+			case D3DCMP_LESS:
+				renderer->setStencilCompareCCW(sw::STENCIL_LESS);
+				break;
+			case D3DCMP_EQUAL:
+				renderer->setStencilCompareCCW(sw::STENCIL_EQUAL);
+				break;
+			case D3DCMP_LESSEQUAL:
+				renderer->setStencilCompareCCW(sw::STENCIL_LESSEQUAL);
+				break;
+			case D3DCMP_GREATER:
+				renderer->setStencilCompareCCW(sw::STENCIL_GREATER);
+				break;
+			case D3DCMP_NOTEQUAL:
+				renderer->setStencilCompareCCW(sw::STENCIL_NOTEQUAL);
+				break;
+			case D3DCMP_GREATEREQUAL:
+				renderer->setStencilCompareCCW(sw::STENCIL_GREATEREQUAL);
+				break;
+			case D3DCMP_ALWAYS:
+				renderer->setStencilCompareCCW(sw::STENCIL_ALWAYS);
+				break;
+			default:
+				ASSERT(false);
+			}
+			break;
+		case D3DRS_COLORWRITEENABLE1:
+			renderer->setColorWriteMask(1, value);
+			break;
+		case D3DRS_COLORWRITEENABLE2:
+			renderer->setColorWriteMask(2, value);
+			break;
+		case D3DRS_COLORWRITEENABLE3:
+			renderer->setColorWriteMask(3, value);
+			break;
+		case D3DRS_BLENDFACTOR:
+			renderer->setBlendConstant(sw::Color<float>(value));
+			break;
+		case D3DRS_SRGBWRITEENABLE:
+			renderer->setWriteSRGB(value != FALSE);
+			break;
+		case D3DRS_DEPTHBIAS:
+			renderer->setDepthBias((float&)value);
+			break;
+		case D3DRS_WRAP8:
+			renderer->setTextureWrap(8, value);
+			break;
+		case D3DRS_WRAP9:
+			renderer->setTextureWrap(9, value);
+			break;
+		case D3DRS_WRAP10:
+			renderer->setTextureWrap(10, value);
+			break;
+		case D3DRS_WRAP11:
+			renderer->setTextureWrap(11, value);
+			break;
+		case D3DRS_WRAP12:
+			renderer->setTextureWrap(12, value);
+			break;
+		case D3DRS_WRAP13:
+			renderer->setTextureWrap(13, value);
+			break;
+		case D3DRS_WRAP14:
+			renderer->setTextureWrap(14, value);
+			break;
+		case D3DRS_WRAP15:
+			renderer->setTextureWrap(15, value);
+			break;
+		case D3DRS_SEPARATEALPHABLENDENABLE:
+			renderer->setSeparateAlphaBlendEnable(value != FALSE);
+			break;
+		case D3DRS_SRCBLENDALPHA:
+			switch(value)
+			{
+			case D3DBLEND_ZERO:
+				renderer->setSourceBlendFactorAlpha(sw::BLEND_ZERO);
+				break;
+			case D3DBLEND_ONE:
+				renderer->setSourceBlendFactorAlpha(sw::BLEND_ONE);
+				break;
+			case D3DBLEND_SRCCOLOR:
+				renderer->setSourceBlendFactorAlpha(sw::BLEND_SOURCE);
+				break;
+			case D3DBLEND_INVSRCCOLOR:
+				renderer->setSourceBlendFactorAlpha(sw::BLEND_INVSOURCE);
+				break;
+			case D3DBLEND_SRCALPHA:
+				renderer->setSourceBlendFactorAlpha(sw::BLEND_SOURCEALPHA);
+				break;
+			case D3DBLEND_INVSRCALPHA:
+				renderer->setSourceBlendFactorAlpha(sw::BLEND_INVSOURCEALPHA);
+				break;
+			case D3DBLEND_DESTALPHA:
+				renderer->setSourceBlendFactorAlpha(sw::BLEND_DESTALPHA);
+				break;
+			case D3DBLEND_INVDESTALPHA:
+				renderer->setSourceBlendFactorAlpha(sw::BLEND_INVDESTALPHA);
+				break;
+			case D3DBLEND_DESTCOLOR:
+				renderer->setSourceBlendFactorAlpha(sw::BLEND_DEST);
+				break;
+			case D3DBLEND_INVDESTCOLOR:
+				renderer->setSourceBlendFactorAlpha(sw::BLEND_INVDEST);
+				break;
+			case D3DBLEND_SRCALPHASAT:
+				renderer->setSourceBlendFactorAlpha(sw::BLEND_SRCALPHASAT);
+				break;
+			case D3DBLEND_BOTHSRCALPHA:
+				renderer->setSourceBlendFactorAlpha(sw::BLEND_SOURCEALPHA);
+				renderer->setDestBlendFactorAlpha(sw::BLEND_INVSOURCEALPHA);
+				break;
+			case D3DBLEND_BOTHINVSRCALPHA:
+				renderer->setSourceBlendFactorAlpha(sw::BLEND_INVSOURCEALPHA);
+				renderer->setDestBlendFactorAlpha(sw::BLEND_SOURCEALPHA);
+				break;
+			case D3DBLEND_BLENDFACTOR:
+				renderer->setSourceBlendFactorAlpha(sw::BLEND_CONSTANT);
+				break;
+			case D3DBLEND_INVBLENDFACTOR:
+				renderer->setSourceBlendFactorAlpha(sw::BLEND_INVCONSTANT);
+				break;
+			default:
+				ASSERT(false);
+			}
+			break;
+		case D3DRS_DESTBLENDALPHA:
+			switch(value)
+			{
+			case D3DBLEND_ZERO:
+				renderer->setDestBlendFactorAlpha(sw::BLEND_ZERO);
+				break;
+			case D3DBLEND_ONE:
+				renderer->setDestBlendFactorAlpha(sw::BLEND_ONE);
+				break;
+			case D3DBLEND_SRCCOLOR:
+				renderer->setDestBlendFactorAlpha(sw::BLEND_SOURCE);
+				break;
+			case D3DBLEND_INVSRCCOLOR:
+				renderer->setDestBlendFactorAlpha(sw::BLEND_INVSOURCE);
+				break;
+			case D3DBLEND_SRCALPHA:
+				renderer->setDestBlendFactorAlpha(sw::BLEND_SOURCEALPHA);
+				break;
+			case D3DBLEND_INVSRCALPHA:
+				renderer->setDestBlendFactorAlpha(sw::BLEND_INVSOURCEALPHA);
+				break;
+			case D3DBLEND_DESTALPHA:
+				renderer->setDestBlendFactorAlpha(sw::BLEND_DESTALPHA);
+				break;
+			case D3DBLEND_INVDESTALPHA:
+				renderer->setDestBlendFactorAlpha(sw::BLEND_INVDESTALPHA);
+				break;
+			case D3DBLEND_DESTCOLOR:
+				renderer->setDestBlendFactorAlpha(sw::BLEND_DEST);
+				break;
+			case D3DBLEND_INVDESTCOLOR:
+				renderer->setDestBlendFactorAlpha(sw::BLEND_INVDEST);
+				break;
+			case D3DBLEND_SRCALPHASAT:
+				renderer->setDestBlendFactorAlpha(sw::BLEND_SRCALPHASAT);
+				break;
+			case D3DBLEND_BOTHSRCALPHA:
+				renderer->setSourceBlendFactorAlpha(sw::BLEND_SOURCEALPHA);
+				renderer->setDestBlendFactorAlpha(sw::BLEND_INVSOURCEALPHA);
+				break;
+			case D3DBLEND_BOTHINVSRCALPHA:
+				renderer->setSourceBlendFactorAlpha(sw::BLEND_INVSOURCEALPHA);
+				renderer->setDestBlendFactorAlpha(sw::BLEND_SOURCEALPHA);
+				break;
+			case D3DBLEND_BLENDFACTOR:
+				renderer->setDestBlendFactorAlpha(sw::BLEND_CONSTANT);
+				break;
+			case D3DBLEND_INVBLENDFACTOR:
+				renderer->setDestBlendFactorAlpha(sw::BLEND_INVCONSTANT);
+				break;
+			default:
+				ASSERT(false);
+			}
+			break;
+		case D3DRS_BLENDOPALPHA:
+			switch(value)
+			{
+			case D3DBLENDOP_ADD:
+				renderer->setBlendOperationAlpha(sw::BLENDOP_ADD);
+				break;
+			case D3DBLENDOP_SUBTRACT:
+				renderer->setBlendOperationAlpha(sw::BLENDOP_SUB);
+				break;
+			case D3DBLENDOP_REVSUBTRACT:
+				renderer->setBlendOperationAlpha(sw::BLENDOP_INVSUB);
+				break;
+			case D3DBLENDOP_MIN:
+				renderer->setBlendOperationAlpha(sw::BLENDOP_MIN);
+				break;
+			case D3DBLENDOP_MAX:
+				renderer->setBlendOperationAlpha(sw::BLENDOP_MAX);
+				break;
+			default:
+				ASSERT(false);
+			}
+			break;
+		default:
+			ASSERT(false);
 		}
-
-		Direct3DSurface9 *source = static_cast<Direct3DSurface9*>(sourceSurface);
-		Direct3DSurface9 *dest = static_cast<Direct3DSurface9*>(destSurface);
-
-		stretchRect(source, sourceRect, dest, destRect, filter);
-
-		return D3D_OK;
-	}
-
-	long Direct3DDevice9::TestCooperativeLevel()
-	{
-		CriticalSection cs(this);
-
-		TRACE("void");
-
-		return D3D_OK;
 	}
 
-	long Direct3DDevice9::UpdateSurface(IDirect3DSurface9 *sourceSurface, const RECT *sourceRect, IDirect3DSurface9 *destinationSurface, const POINT *destPoint)
+	void Direct3DDevice9::applySamplerState(unsigned long sampler, D3DSAMPLERSTATETYPE state, unsigned long value)
 	{
-		CriticalSection cs(this);
-
-		TRACE("IDirect3DSurface9 *sourceSurface = 0x%0.8p, const RECT *sourceRect = 0x%0.8p, IDirect3DSurface9 *destinationSurface = 0x%0.8p, const POINT *destPoint = 0x%0.8p", sourceSurface, sourceRect, destinationSurface, destPoint);
-
-		if(!sourceSurface || !destinationSurface)
-		{
-			return INVALIDCALL();
-		}
-
-		D3DSURFACE_DESC sourceDescription;
-		D3DSURFACE_DESC destinationDescription;
-
-		sourceSurface->GetDesc(&sourceDescription);
-		destinationSurface->GetDesc(&destinationDescription);
-
-		RECT sRect;
-		RECT dRect;
-
-		if(sourceRect)
-		{
-			sRect.left = sourceRect->left;
-			sRect.top = sourceRect->top;
-			sRect.right = sourceRect->right;
-			sRect.bottom = sourceRect->bottom;
-		}
-		else
-		{
-			sRect.left = 0;
-			sRect.top = 0;
-			sRect.right = sourceDescription.Width;
-			sRect.bottom = sourceDescription.Height;
-		}
-
-		if(destPoint)
-		{
-			dRect.left = destPoint->x;
-			dRect.top = destPoint->y;
-			dRect.right = destPoint->x + sRect.right - sRect.left;
-			dRect.bottom = destPoint->y + sRect.bottom - sRect.top;
-		}
-		else
-		{
-			dRect.left = 0;
-			dRect.top = 0;
-			dRect.right = sRect.right - sRect.left;
-			dRect.bottom = sRect.bottom - sRect.top;
-		}
-
-		if(!validRectangle(&sRect, sourceSurface) || !validRectangle(&dRect, destinationSurface))
-		{
-			return INVALIDCALL();
-		}
-
-		int sWidth = sRect.right - sRect.left;
-		int sHeight = sRect.bottom - sRect.top;
-
-		int dWidth = dRect.right - dRect.left;
-		int dHeight = dRect.bottom - dRect.top;
+		sw::SamplerType type = sampler < 16 ? sw::SAMPLER_PIXEL : sw::SAMPLER_VERTEX;
+		int index = sampler < 16 ? sampler : sampler - 16;   // Sampler index within type group
 
-		if(sourceDescription.MultiSampleType      != D3DMULTISAMPLE_NONE ||
-		   destinationDescription.MultiSampleType != D3DMULTISAMPLE_NONE ||
-		// sourceDescription.Pool      != D3DPOOL_SYSTEMMEM ||   // FIXME: Check back buffer and depth buffer memory pool flags
-		// destinationDescription.Pool != D3DPOOL_DEFAULT ||
-		   sourceDescription.Format != destinationDescription.Format)
-		{
-			return INVALIDCALL();
-		}
-
-		sw::Surface *source = static_cast<Direct3DSurface9*>(sourceSurface);
-		sw::Surface *dest = static_cast<Direct3DSurface9*>(destinationSurface);
-
-		unsigned char *sBuffer = (unsigned char*)source->lockExternal(sRect.left, sRect.top, 0, sw::LOCK_READONLY, sw::PUBLIC);
-		unsigned char *dBuffer = (unsigned char*)dest->lockExternal(dRect.left, dRect.top, 0, sw::LOCK_WRITEONLY, sw::PUBLIC);
-		int sPitch = source->getExternalPitchB();
-		int dPitch = dest->getExternalPitchB();
-
-		unsigned int width;
-		unsigned int height;
-		unsigned int bytes;
-
-		switch(sourceDescription.Format)
+		switch(state)
 		{
-		case D3DFMT_DXT1:
-		case D3DFMT_ATI1:
-			width = (dWidth + 3) / 4;
-			height = (dHeight + 3) / 4;
-			bytes = width * 8;   // 64 bit per 4x4 block
+		case D3DSAMP_ADDRESSU:
+			switch(value)
+			{
+			case D3DTADDRESS_WRAP:
+				renderer->setAddressingModeU(type, index, sw::ADDRESSING_WRAP);
+				break;
+			case D3DTADDRESS_MIRROR:
+				renderer->setAddressingModeU(type, index, sw::ADDRESSING_MIRROR);
+				break;
+			case D3DTADDRESS_CLAMP:
+				renderer->setAddressingModeU(type, index, sw::ADDRESSING_CLAMP);
+				break;
+			case D3DTADDRESS_BORDER:
+				renderer->setAddressingModeU(type, index, sw::ADDRESSING_BORDER);
+				break;
+			case D3DTADDRESS_MIRRORONCE:
+				renderer->setAddressingModeU(type, index, sw::ADDRESSING_MIRRORONCE);
+				break;
+			default:
+				ASSERT(false);
+			}
+			break;
+		case D3DSAMP_ADDRESSV:
+			switch(value)
+			{
+			case D3DTADDRESS_WRAP:
+				renderer->setAddressingModeV(type, index, sw::ADDRESSING_WRAP);
+				break;
+			case D3DTADDRESS_MIRROR:
+				renderer->setAddressingModeV(type, index, sw::ADDRESSING_MIRROR);
+				break;
+			case D3DTADDRESS_CLAMP:
+				renderer->setAddressingModeV(type, index, sw::ADDRESSING_CLAMP);
+				break;
+			case D3DTADDRESS_BORDER:
+				renderer->setAddressingModeV(type, index, sw::ADDRESSING_BORDER);
+				break;
+			case D3DTADDRESS_MIRRORONCE:
+				renderer->setAddressingModeV(type, index, sw::ADDRESSING_MIRRORONCE);
+				break;
+			default:
+				ASSERT(false);
+			}
+			break;
+		case D3DSAMP_ADDRESSW:
+			switch(value)
+			{
+			case D3DTADDRESS_WRAP:
+				renderer->setAddressingModeW(type, index, sw::ADDRESSING_WRAP);
+				break;
+			case D3DTADDRESS_MIRROR:
+				renderer->setAddressingModeW(type, index, sw::ADDRESSING_MIRROR);
+				break;
+			case D3DTADDRESS_CLAMP:
+				renderer->setAddressingModeW(type, index, sw::ADDRESSING_CLAMP);
+				break;
+			case D3DTADDRESS_BORDER:
+				renderer->setAddressingModeW(type, index, sw::ADDRESSING_BORDER);
+				break;
+			case D3DTADDRESS_MIRRORONCE:
+				renderer->setAddressingModeW(type, index, sw::ADDRESSING_MIRRORONCE);
+				break;
+			default:
+				ASSERT(false);
+			}
+			break;
+		case D3DSAMP_BORDERCOLOR:
+			renderer->setBorderColor(type, index, value);
+			break;
+		case D3DSAMP_MAGFILTER:
+			// NOTE: SwiftShader does not differentiate between minification and magnification filter
+			switch(value)
+			{
+			case D3DTEXF_NONE:
+				renderer->setTextureFilter(type, index, sw::FILTER_POINT);   // FIXME: Only for mipmap filter
+				break;
+			case D3DTEXF_POINT:
+				renderer->setTextureFilter(type, index, sw::FILTER_POINT);
+				break;
+			case D3DTEXF_LINEAR:
+				renderer->setTextureFilter(type, index, sw::FILTER_LINEAR);
+				break;
+			case D3DTEXF_ANISOTROPIC:
+				renderer->setTextureFilter(type, index, sw::FILTER_ANISOTROPIC);
+				break;
+			case D3DTEXF_PYRAMIDALQUAD:
+				renderer->setTextureFilter(type, index, sw::FILTER_LINEAR);   // FIXME: Unimplemented, fail silently
+				break;
+			case D3DTEXF_GAUSSIANQUAD:
+				renderer->setTextureFilter(type, index, sw::FILTER_LINEAR);   // FIXME: Unimplemented, fail silently
+				break;
+			default:
+				ASSERT(false);   // Rejected by SetSamplerState
+			};
 			break;
-		case D3DFMT_DXT2:
-		case D3DFMT_DXT3:
-		case D3DFMT_DXT4:
-		case D3DFMT_DXT5:
-		case D3DFMT_ATI2:
-			width = (dWidth + 3) / 4;
-			height = (dHeight + 3) / 4;
-			bytes = width * 16;   // 128 bit per 4x4 block
+		case D3DSAMP_MINFILTER:
+			// NOTE: SwiftShader does not differentiate between minification and magnification filter
+			switch(value)
+			{
+			case D3DTEXF_NONE:
+				renderer->setTextureFilter(type, index, sw::FILTER_POINT);   // FIXME: Only for mipmap filter
+				break;
+			case D3DTEXF_POINT:
+				renderer->setTextureFilter(type, index, sw::FILTER_POINT);
+				break;
+			case D3DTEXF_LINEAR:
+				renderer->setTextureFilter(type, index, sw::FILTER_LINEAR);
+				break;
+			case D3DTEXF_ANISOTROPIC:
+				renderer->setTextureFilter(type, index, sw::FILTER_ANISOTROPIC);
+				break;
+			case D3DTEXF_PYRAMIDALQUAD:
+				renderer->setTextureFilter(type, index, sw::FILTER_LINEAR);   // FIXME: Unimplemented, fail silently
+				break;
+			case D3DTEXF_GAUSSIANQUAD:
+				renderer->setTextureFilter(type, index, sw::FILTER_LINEAR);   // FIXME: Unimplemented, fail silently
+				break;
+			default:
+				ASSERT(false);   // Rejected by SetSamplerState
+			};
+			break;
+		case D3DSAMP_MIPFILTER:
+			switch(value)
+			{
+			case D3DTEXF_NONE:
+				renderer->setMipmapFilter(type, index, sw::MIPMAP_NONE);
+				break;
+			case D3DTEXF_POINT:
+				renderer->setMipmapFilter(type, index, sw::MIPMAP_POINT);
+				break;
+			case D3DTEXF_LINEAR:
+				renderer->setMipmapFilter(type, index, sw::MIPMAP_LINEAR);
+				break;
+			case D3DTEXF_ANISOTROPIC:
+				renderer->setMipmapFilter(type, index, sw::MIPMAP_LINEAR);   // FIXME: Only for texture filter
+				break;
+			case D3DTEXF_PYRAMIDALQUAD:
+				renderer->setMipmapFilter(type, index, sw::MIPMAP_LINEAR);   // FIXME: Only for texture filter
+				break;
+			case D3DTEXF_GAUSSIANQUAD:
+				renderer->setMipmapFilter(type, index, sw::MIPMAP_LINEAR);   // FIXME: Only for texture filter
+				break;
+			default:
+				ASSERT(false);   // Rejected by SetSamplerState
+			};
+			break;
+		case D3DSAMP_MIPMAPLODBIAS:
+			if(value == D3DFMT_GET4)   // ATI hack to enable Fetch4
+			{
+				renderer->setGatherEnable(type, index, true);
+			}
+			else if(value == D3DFMT_GET1)   // ATI hack to disable Fetch4
+			{
+				renderer->setGatherEnable(type, index, false);
+			}
+			else
+			{
+				float LOD = (float&)value - sw::log2((float)context->renderTarget[0]->getSuperSampleCount());   // FIXME: Update when render target changes
+				renderer->setMipmapLOD(type, index, LOD);
+			}
+			break;
+		case D3DSAMP_MAXMIPLEVEL:
+			break;
+		case D3DSAMP_MAXANISOTROPY:
+			renderer->setMaxAnisotropy(type, index, sw::clamp((unsigned int)value, (unsigned int)1, maxAnisotropy));
+			break;
+		case D3DSAMP_SRGBTEXTURE:
+			renderer->setReadSRGB(type, index, value != FALSE);
+			break;
+		case D3DSAMP_ELEMENTINDEX:
+			if(!init) UNIMPLEMENTED();   // Multi-element textures deprecated in favor of multiple render targets
+			break;
+		case D3DSAMP_DMAPOFFSET:
+		//	if(!init) UNIMPLEMENTED();
 			break;
 		default:
-			width = dWidth;
-			height = dHeight;
-			bytes = width * Direct3DSurface9::bytes(sourceDescription.Format);
-		}
-
-		if(sourceDescription.Format == D3DFMT_ATI1 || sourceDescription.Format == D3DFMT_ATI2)
-		{
-			// Make the pitch correspond to 4 rows
-			sPitch *= 4;
-			dPitch *= 4;
-		}
-
-		for(unsigned int y = 0; y < height; y++)
-		{
-			memcpy(dBuffer, sBuffer, bytes);
-
-			sBuffer += sPitch;
-			dBuffer += dPitch;
+			ASSERT(false);
 		}
-
-		source->unlockExternal();
-		dest->unlockExternal();
-
-		return D3D_OK;
 	}
 
-	long Direct3DDevice9::UpdateTexture(IDirect3DBaseTexture9 *sourceTexture, IDirect3DBaseTexture9 *destinationTexture)
+	void Direct3DDevice9::applyTextureStageState(unsigned long stage, D3DTEXTURESTAGESTATETYPE type, unsigned long value)
 	{
-		CriticalSection cs(this);
-
-		TRACE("IDirect3DBaseTexture9 *sourceTexture = 0x%0.8p, IDirect3DBaseTexture9 *destinationTexture = 0x%0.8p", sourceTexture, destinationTexture);
-
-		if(!sourceTexture || !destinationTexture)
-		{
-			return INVALIDCALL();
-		}
-
-		// FIXME: Check memory pools
-
-		D3DRESOURCETYPE type = sourceTexture->GetType();
-
-		if(type != destinationTexture->GetType())
-		{
-			return INVALIDCALL();
-		}
-
 		switch(type)
 		{
-		case D3DRTYPE_TEXTURE:
+		case D3DTSS_COLOROP:
+			switch(value)
 			{
-				IDirect3DTexture9 *source;
-				IDirect3DTexture9 *dest;
-
-				sourceTexture->QueryInterface(IID_IDirect3DTexture9, (void**)&source);
-				destinationTexture->QueryInterface(IID_IDirect3DTexture9, (void**)&dest);
-
-				ASSERT(source && dest);
+			case D3DTOP_DISABLE:
+				renderer->setStageOperation(stage, sw::TextureStage::STAGE_DISABLE);
+				break;
+			case D3DTOP_SELECTARG1:
+				renderer->setStageOperation(stage, sw::TextureStage::STAGE_SELECTARG1);
+				break;
+			case D3DTOP_SELECTARG2:
+				renderer->setStageOperation(stage, sw::TextureStage::STAGE_SELECTARG2);
+				break;
+			case D3DTOP_MODULATE:
+				renderer->setStageOperation(stage, sw::TextureStage::STAGE_MODULATE);
+				break;
+			case D3DTOP_MODULATE2X:
+				renderer->setStageOperation(stage, sw::TextureStage::STAGE_MODULATE2X);
+				break;
+			case D3DTOP_MODULATE4X:
+				renderer->setStageOperation(stage, sw::TextureStage::STAGE_MODULATE4X);
+				break;
+			case D3DTOP_ADD:
+				renderer->setStageOperation(stage, sw::TextureStage::STAGE_ADD);
+				break;
+			case D3DTOP_ADDSIGNED:
+				renderer->setStageOperation(stage, sw::TextureStage::STAGE_ADDSIGNED);
+				break;
+			case D3DTOP_ADDSIGNED2X:
+				renderer->setStageOperation(stage, sw::TextureStage::STAGE_ADDSIGNED2X);
+				break;
+			case D3DTOP_SUBTRACT:
+				renderer->setStageOperation(stage, sw::TextureStage::STAGE_SUBTRACT);
+				break;
+			case D3DTOP_ADDSMOOTH:
+				renderer->setStageOperation(stage, sw::TextureStage::STAGE_ADDSMOOTH);
+				break;
+			case D3DTOP_BLENDDIFFUSEALPHA:
+				renderer->setStageOperation(stage, sw::TextureStage::STAGE_BLENDDIFFUSEALPHA);
+				break;
+			case D3DTOP_BLENDTEXTUREALPHA:
+				renderer->setStageOperation(stage, sw::TextureStage::STAGE_BLENDTEXTUREALPHA);
+				break;
+			case D3DTOP_BLENDFACTORALPHA:
+				renderer->setStageOperation(stage, sw::TextureStage::STAGE_BLENDFACTORALPHA);
+				break;
+			case D3DTOP_BLENDTEXTUREALPHAPM:
+				renderer->setStageOperation(stage, sw::TextureStage::STAGE_BLENDTEXTUREALPHAPM);
+				break;
+			case D3DTOP_BLENDCURRENTALPHA:
+				renderer->setStageOperation(stage, sw::TextureStage::STAGE_BLENDCURRENTALPHA);
+				break;
+			case D3DTOP_PREMODULATE:
+				renderer->setStageOperation(stage, sw::TextureStage::STAGE_PREMODULATE);
+				break;
+			case D3DTOP_MODULATEALPHA_ADDCOLOR:
+				renderer->setStageOperation(stage, sw::TextureStage::STAGE_MODULATEALPHA_ADDCOLOR);
+				break;
+			case D3DTOP_MODULATECOLOR_ADDALPHA:
+				renderer->setStageOperation(stage, sw::TextureStage::STAGE_MODULATECOLOR_ADDALPHA);
+				break;
+			case D3DTOP_MODULATEINVALPHA_ADDCOLOR:
+				renderer->setStageOperation(stage, sw::TextureStage::STAGE_MODULATEINVALPHA_ADDCOLOR);
+				break;
+			case D3DTOP_MODULATEINVCOLOR_ADDALPHA:
+				renderer->setStageOperation(stage, sw::TextureStage::STAGE_MODULATEINVCOLOR_ADDALPHA);
+				break;
+			case D3DTOP_BUMPENVMAP:
+				renderer->setStageOperation(stage, sw::TextureStage::STAGE_BUMPENVMAP);
+				break;
+			case D3DTOP_BUMPENVMAPLUMINANCE:
+				renderer->setStageOperation(stage, sw::TextureStage::STAGE_BUMPENVMAPLUMINANCE);
+				break;
+			case D3DTOP_DOTPRODUCT3:
+				renderer->setStageOperation(stage, sw::TextureStage::STAGE_DOT3);
+				break;
+			case D3DTOP_MULTIPLYADD:
+				renderer->setStageOperation(stage, sw::TextureStage::STAGE_MULTIPLYADD);
+				break;
+			case D3DTOP_LERP:
+				renderer->setStageOperation(stage, sw::TextureStage::STAGE_LERP);
+				break;
+			default:
+				ASSERT(false);
+			}
+			break;
+		case D3DTSS_COLORARG1:
+			switch(value & D3DTA_SELECTMASK)
+			{
+			case D3DTA_DIFFUSE:
+				renderer->setFirstArgument(stage, sw::TextureStage::SOURCE_DIFFUSE);
+				break;
+			case D3DTA_CURRENT:
+				renderer->setFirstArgument(stage, sw::TextureStage::SOURCE_CURRENT);
+				break;
+			case D3DTA_TEXTURE:
+				renderer->setFirstArgument(stage, sw::TextureStage::SOURCE_TEXTURE);
+				break;
+			case D3DTA_TFACTOR:
+				renderer->setFirstArgument(stage, sw::TextureStage::SOURCE_TFACTOR);
+				break;
+			case D3DTA_SPECULAR:
+				renderer->setFirstArgument(stage, sw::TextureStage::SOURCE_SPECULAR);
+				break;
+			case D3DTA_TEMP:
+				renderer->setFirstArgument(stage, sw::TextureStage::SOURCE_TEMP);
+				break;
+			case D3DTA_CONSTANT:
+				renderer->setFirstArgument(stage, sw::TextureStage::SOURCE_CONSTANT);
+				break;
+			default:
+				ASSERT(false);
+			}
 
-				for(unsigned int level = 0; level < source->GetLevelCount() && level < dest->GetLevelCount(); level++)   // FIXME: Fail when source texture has fewer levels than the destination
-				{
-					IDirect3DSurface9 *sourceSurface;
-					IDirect3DSurface9 *destinationSurface;
+			switch(value & ~D3DTA_SELECTMASK)
+			{
+			case 0:
+				renderer->setFirstModifier(stage, sw::TextureStage::MODIFIER_COLOR);
+				break;
+			case D3DTA_COMPLEMENT:
+				renderer->setFirstModifier(stage, sw::TextureStage::MODIFIER_INVCOLOR);
+				break;
+			case D3DTA_ALPHAREPLICATE:
+				renderer->setFirstModifier(stage, sw::TextureStage::MODIFIER_ALPHA);
+				break;
+			case D3DTA_COMPLEMENT | D3DTA_ALPHAREPLICATE:
+				renderer->setFirstModifier(stage, sw::TextureStage::MODIFIER_INVALPHA);
+				break;
+			default:
+				ASSERT(false);
+			}
+			break;
+		case D3DTSS_COLORARG2:
+			switch(value & D3DTA_SELECTMASK)
+			{
+			case D3DTA_DIFFUSE:
+				renderer->setSecondArgument(stage, sw::TextureStage::SOURCE_DIFFUSE);
+				break;
+			case D3DTA_CURRENT:
+				renderer->setSecondArgument(stage, sw::TextureStage::SOURCE_CURRENT);
+				break;
+			case D3DTA_TEXTURE:
+				renderer->setSecondArgument(stage, sw::TextureStage::SOURCE_TEXTURE);
+				break;
+			case D3DTA_TFACTOR:
+				renderer->setSecondArgument(stage, sw::TextureStage::SOURCE_TFACTOR);
+				break;
+			case D3DTA_SPECULAR:
+				renderer->setSecondArgument(stage, sw::TextureStage::SOURCE_SPECULAR);
+				break;
+			case D3DTA_TEMP:
+				renderer->setSecondArgument(stage, sw::TextureStage::SOURCE_TEMP);
+				break;
+			case D3DTA_CONSTANT:
+				renderer->setSecondArgument(stage, sw::TextureStage::SOURCE_CONSTANT);
+				break;
+			default:
+				ASSERT(false);
+			}
 
-					source->GetSurfaceLevel(level, &sourceSurface);
-					dest->GetSurfaceLevel(level, &destinationSurface);
+			switch(value & ~D3DTA_SELECTMASK)
+			{
+			case 0:
+				renderer->setSecondModifier(stage, sw::TextureStage::MODIFIER_COLOR);
+				break;
+			case D3DTA_COMPLEMENT:
+				renderer->setSecondModifier(stage, sw::TextureStage::MODIFIER_INVCOLOR);
+				break;
+			case D3DTA_ALPHAREPLICATE:
+				renderer->setSecondModifier(stage, sw::TextureStage::MODIFIER_ALPHA);
+				break;
+			case D3DTA_COMPLEMENT | D3DTA_ALPHAREPLICATE:
+				renderer->setSecondModifier(stage, sw::TextureStage::MODIFIER_INVALPHA);
+				break;
+			default:
+				ASSERT(false);
+			}
+			break;
+		case D3DTSS_ALPHAOP:
+			switch(value)
+			{
+			case D3DTOP_DISABLE:
+				renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_DISABLE);
+				break;
+			case D3DTOP_SELECTARG1:
+				renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_SELECTARG1);
+				break;
+			case D3DTOP_SELECTARG2:
+				renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_SELECTARG2);
+				break;
+			case D3DTOP_MODULATE:
+				renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_MODULATE);
+				break;
+			case D3DTOP_MODULATE2X:
+				renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_MODULATE2X);
+				break;
+			case D3DTOP_MODULATE4X:
+				renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_MODULATE4X);
+				break;
+			case D3DTOP_ADD:
+				renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_ADD);
+				break;
+			case D3DTOP_ADDSIGNED:
+				renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_ADDSIGNED);
+				break;
+			case D3DTOP_ADDSIGNED2X:
+				renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_ADDSIGNED2X);
+				break;
+			case D3DTOP_SUBTRACT:
+				renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_SUBTRACT);
+				break;
+			case D3DTOP_ADDSMOOTH:
+				renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_ADDSMOOTH);
+				break;
+			case D3DTOP_BLENDDIFFUSEALPHA:
+				renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_BLENDDIFFUSEALPHA);
+				break;
+			case D3DTOP_BLENDTEXTUREALPHA:
+				renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_BLENDTEXTUREALPHA);
+				break;
+			case D3DTOP_BLENDFACTORALPHA:
+				renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_BLENDFACTORALPHA);
+				break;
+			case D3DTOP_BLENDTEXTUREALPHAPM:
+				renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_BLENDTEXTUREALPHAPM);
+				break;
+			case D3DTOP_BLENDCURRENTALPHA:
+				renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_BLENDCURRENTALPHA);
+				break;
+			case D3DTOP_PREMODULATE:
+				renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_PREMODULATE);
+				break;
+			case D3DTOP_MODULATEALPHA_ADDCOLOR:
+				renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_MODULATEALPHA_ADDCOLOR);
+				break;
+			case D3DTOP_MODULATECOLOR_ADDALPHA:
+				renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_MODULATECOLOR_ADDALPHA);
+				break;
+			case D3DTOP_MODULATEINVALPHA_ADDCOLOR:
+				renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_MODULATEINVALPHA_ADDCOLOR);
+				break;
+			case D3DTOP_MODULATEINVCOLOR_ADDALPHA:
+				renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_MODULATEINVCOLOR_ADDALPHA);
+				break;
+			case D3DTOP_BUMPENVMAP:
+				renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_BUMPENVMAP);
+				break;
+			case D3DTOP_BUMPENVMAPLUMINANCE:
+				renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_BUMPENVMAPLUMINANCE);
+				break;
+			case D3DTOP_DOTPRODUCT3:
+				renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_DOT3);
+				break;
+			case D3DTOP_MULTIPLYADD:
+				renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_MULTIPLYADD);
+				break;
+			case D3DTOP_LERP:
+				renderer->setStageOperationAlpha(stage, sw::TextureStage::STAGE_LERP);
+				break;
+			default:
+				ASSERT(false);
+			}
+			break;
+		case D3DTSS_ALPHAARG1:
+			switch(value & D3DTA_SELECTMASK)
+			{
+			case D3DTA_DIFFUSE:
+				renderer->setFirstArgumentAlpha(stage, sw::TextureStage::SOURCE_DIFFUSE);
+				break;
+			case D3DTA_CURRENT:
+				renderer->setFirstArgumentAlpha(stage, sw::TextureStage::SOURCE_CURRENT);
+				break;
+			case D3DTA_TEXTURE:
+				renderer->setFirstArgumentAlpha(stage, sw::TextureStage::SOURCE_TEXTURE);
+				break;
+			case D3DTA_TFACTOR:
+				renderer->setFirstArgumentAlpha(stage, sw::TextureStage::SOURCE_TFACTOR);
+				break;
+			case D3DTA_SPECULAR:
+				renderer->setFirstArgumentAlpha(stage, sw::TextureStage::SOURCE_SPECULAR);
+				break;
+			case D3DTA_TEMP:
+				renderer->setFirstArgumentAlpha(stage, sw::TextureStage::SOURCE_TEMP);
+				break;
+			case D3DTA_CONSTANT:
+				renderer->setFirstArgumentAlpha(stage, sw::TextureStage::SOURCE_CONSTANT);
+				break;
+			default:
+				ASSERT(false);
+			}
 
-					UpdateSurface(sourceSurface, 0, destinationSurface, 0);
+			switch(value & ~D3DTA_SELECTMASK)
+			{
+			case 0:
+				renderer->setFirstModifierAlpha(stage, sw::TextureStage::MODIFIER_COLOR);
+				break;
+			case D3DTA_COMPLEMENT:
+				renderer->setFirstModifierAlpha(stage, sw::TextureStage::MODIFIER_INVCOLOR);
+				break;
+			case D3DTA_ALPHAREPLICATE:
+				renderer->setFirstModifierAlpha(stage, sw::TextureStage::MODIFIER_ALPHA);
+				break;
+			case D3DTA_COMPLEMENT | D3DTA_ALPHAREPLICATE:
+				renderer->setSecondModifier(stage, sw::TextureStage::MODIFIER_INVALPHA);
+				break;
+			default:
+				ASSERT(false);
+			}
+			break;
+		case D3DTSS_ALPHAARG2:
+			switch(value & D3DTA_SELECTMASK)
+			{
+			case D3DTA_DIFFUSE:
+				renderer->setSecondArgumentAlpha(stage, sw::TextureStage::SOURCE_DIFFUSE);
+				break;
+			case D3DTA_CURRENT:
+				renderer->setSecondArgumentAlpha(stage, sw::TextureStage::SOURCE_CURRENT);
+				break;
+			case D3DTA_TEXTURE:
+				renderer->setSecondArgumentAlpha(stage, sw::TextureStage::SOURCE_TEXTURE);
+				break;
+			case D3DTA_TFACTOR:
+				renderer->setSecondArgumentAlpha(stage, sw::TextureStage::SOURCE_TFACTOR);
+				break;
+			case D3DTA_SPECULAR:
+				renderer->setSecondArgumentAlpha(stage, sw::TextureStage::SOURCE_SPECULAR);
+				break;
+			case D3DTA_TEMP:
+				renderer->setSecondArgumentAlpha(stage, sw::TextureStage::SOURCE_TEMP);
+				break;
+			case D3DTA_CONSTANT:
+				renderer->setSecondArgumentAlpha(stage, sw::TextureStage::SOURCE_CONSTANT);
+				break;
+			default:
+				ASSERT(false);
+			}
 
-					sourceSurface->Release();
-					destinationSurface->Release();
-				}
+			switch(value & ~D3DTA_SELECTMASK)
+			{
+			case 0:
+				renderer->setSecondModifierAlpha(stage, sw::TextureStage::MODIFIER_COLOR);
+				break;
+			case D3DTA_COMPLEMENT:
+				renderer->setSecondModifierAlpha(stage, sw::TextureStage::MODIFIER_INVCOLOR);
+				break;
+			case D3DTA_ALPHAREPLICATE:
+				renderer->setSecondModifierAlpha(stage, sw::TextureStage::MODIFIER_ALPHA);
+				break;
+			case D3DTA_COMPLEMENT | D3DTA_ALPHAREPLICATE:
+				renderer->setSecondModifierAlpha(stage, sw::TextureStage::MODIFIER_INVALPHA);
+				break;
+			default:
+				ASSERT(false);
+			}
+			break;
+		case D3DTSS_BUMPENVMAT00:
+			renderer->setBumpmapMatrix(stage, 0, (float&)value);
+			break;
+		case D3DTSS_BUMPENVMAT01:
+			renderer->setBumpmapMatrix(stage, 1, (float&)value);
+			break;
+		case D3DTSS_BUMPENVMAT10:
+			renderer->setBumpmapMatrix(stage, 2, (float&)value);
+			break;
+		case D3DTSS_BUMPENVMAT11:
+			renderer->setBumpmapMatrix(stage, 3, (float&)value);
+			break;
+		case D3DTSS_TEXCOORDINDEX:
+			renderer->setTexCoordIndex(stage, value & 0x0000FFFF);
 
-				source->Release();
-				dest->Release();
+			switch(value & 0xFFFF0000)
+			{
+			case D3DTSS_TCI_PASSTHRU:
+				renderer->setTexGen(stage, sw::TEXGEN_PASSTHRU);
+				break;
+			case D3DTSS_TCI_CAMERASPACENORMAL:
+				renderer->setTexCoordIndex(stage, stage);
+				renderer->setTexGen(stage, sw::TEXGEN_NORMAL);
+				break;
+			case D3DTSS_TCI_CAMERASPACEPOSITION:
+				renderer->setTexCoordIndex(stage, stage);
+				renderer->setTexGen(stage, sw::TEXGEN_POSITION);
+				break;
+			case D3DTSS_TCI_CAMERASPACEREFLECTIONVECTOR:
+				renderer->setTexCoordIndex(stage, stage);
+				renderer->setTexGen(stage, sw::TEXGEN_REFLECTION);
+				break;
+			case D3DTSS_TCI_SPHEREMAP:
+				renderer->setTexCoordIndex(stage, stage);
+				renderer->setTexGen(stage, sw::TEXGEN_SPHEREMAP);
+				break;
+			default:
+				ASSERT(false);
 			}
 			break;
-		case D3DRTYPE_VOLUMETEXTURE:
+		case D3DTSS_BUMPENVLSCALE:
+			renderer->setLuminanceScale(stage, (float&)value);
+			break;
+		case D3DTSS_BUMPENVLOFFSET:
+			renderer->setLuminanceOffset(stage, (float&)value);
+			break;
+		case D3DTSS_TEXTURETRANSFORMFLAGS:
+			switch(value & ~D3DTTFF_PROJECTED)
 			{
-				IDirect3DVolumeTexture9 *source;
-				IDirect3DVolumeTexture9 *dest;
-
-				sourceTexture->QueryInterface(IID_IDirect3DVolumeTexture9, (void**)&source);
-				destinationTexture->QueryInterface(IID_IDirect3DVolumeTexture9, (void**)&dest);
-
-				ASSERT(source && dest);
-
-				for(unsigned int level = 0; level < source->GetLevelCount() && level < dest->GetLevelCount(); level++)   // FIXME: Fail when source texture has fewer levels than the destination
-				{
-					IDirect3DVolume9 *sourceVolume;
-					IDirect3DVolume9 *destinationVolume;
-
-					source->GetVolumeLevel(level, &sourceVolume);
-					dest->GetVolumeLevel(level, &destinationVolume);
-
-					updateVolume(sourceVolume, destinationVolume);
-
-					sourceVolume->Release();
-					destinationVolume->Release();
-				}
-
-				source->Release();
-				dest->Release();
+			case D3DTTFF_DISABLE:
+				renderer->setTextureTransform(stage, 0, (value & D3DTTFF_PROJECTED) == D3DTTFF_PROJECTED);
+				break;
+			case D3DTTFF_COUNT1:
+				renderer->setTextureTransform(stage, 1, (value & D3DTTFF_PROJECTED) == D3DTTFF_PROJECTED);
+				break;
+			case D3DTTFF_COUNT2:
+				renderer->setTextureTransform(stage, 2, (value & D3DTTFF_PROJECTED) == D3DTTFF_PROJECTED);
+				break;
+			case D3DTTFF_COUNT3:
+				renderer->setTextureTransform(stage, 3, (value & D3DTTFF_PROJECTED) == D3DTTFF_PROJECTED);
+				break;
+			case D3DTTFF_COUNT4:
+				renderer->setTextureTransform(stage, 4, (value & D3DTTFF_PROJECTED) == D3DTTFF_PROJECTED);
+				break;
+			default:
+				ASSERT(false);
 			}
 			break;
-		case D3DRTYPE_CUBETEXTURE:
+		case D3DTSS_COLORARG0:
+			switch(value & D3DTA_SELECTMASK)
 			{
-				IDirect3DCubeTexture9 *source;
-				IDirect3DCubeTexture9 *dest;
-
-				sourceTexture->QueryInterface(IID_IDirect3DCubeTexture9, (void**)&source);
-				destinationTexture->QueryInterface(IID_IDirect3DCubeTexture9, (void**)&dest);
-
-				ASSERT(source && dest);
-
-				for(int face = 0; face < 6; face++)
-				{
-					for(unsigned int level = 0; level < source->GetLevelCount() && level < dest->GetLevelCount(); level++)   // FIXME: Fail when source texture has fewer levels than the destination
-					{
-						IDirect3DSurface9 *sourceSurface;
-						IDirect3DSurface9 *destinationSurface;
-
-						source->GetCubeMapSurface((D3DCUBEMAP_FACES)face, level, &sourceSurface);
-						dest->GetCubeMapSurface((D3DCUBEMAP_FACES)face, level, &destinationSurface);
-
-						UpdateSurface(sourceSurface, 0, destinationSurface, 0);
-
-						sourceSurface->Release();
-						destinationSurface->Release();
-					}
-				}
+			case D3DTA_CURRENT:
+				renderer->setThirdArgument(stage, sw::TextureStage::SOURCE_CURRENT);
+				break;
+			case D3DTA_DIFFUSE:
+				renderer->setThirdArgument(stage, sw::TextureStage::SOURCE_DIFFUSE);
+				break;
+			case D3DTA_SPECULAR:
+				renderer->setThirdArgument(stage, sw::TextureStage::SOURCE_SPECULAR);
+				break;
+			case D3DTA_TEMP:
+				renderer->setThirdArgument(stage, sw::TextureStage::SOURCE_TEMP);
+				break;
+			case D3DTA_TEXTURE:
+				renderer->setThirdArgument(stage, sw::TextureStage::SOURCE_TEXTURE);
+				break;
+			case D3DTA_TFACTOR:
+				renderer->setThirdArgument(stage, sw::TextureStage::SOURCE_TFACTOR);
+				break;
+			default:
+				ASSERT(false);
+			}
 
-				source->Release();
-				dest->Release();
+			switch(value & ~D3DTA_SELECTMASK)
+			{
+			case 0:
+				renderer->setThirdModifier(stage, sw::TextureStage::MODIFIER_COLOR);
+				break;
+			case D3DTA_COMPLEMENT:
+				renderer->setThirdModifier(stage, sw::TextureStage::MODIFIER_INVCOLOR);
+				break;
+			case D3DTA_ALPHAREPLICATE:
+				renderer->setThirdModifier(stage, sw::TextureStage::MODIFIER_ALPHA);
+				break;
+			case D3DTA_COMPLEMENT | D3DTA_ALPHAREPLICATE:
+				renderer->setThirdModifier(stage, sw::TextureStage::MODIFIER_INVALPHA);
+				break;
+			default:
+				ASSERT(false);
 			}
 			break;
-		default:
-			UNIMPLEMENTED();
-		}
-
-		return D3D_OK;
-	}
-
-	long Direct3DDevice9::ValidateDevice(unsigned long *numPasses)
-	{
-		CriticalSection cs(this);
-
-		TRACE("unsigned long *numPasses = 0x%0.8p", numPasses);
-
-		if(!numPasses)
-		{
-			return INVALIDCALL();
-		}
-
-		*numPasses = 1;
-
-		return D3D_OK;
-	}
-
-	long Direct3DDevice9::getAdapterDisplayMode(unsigned int adapter, D3DDISPLAYMODE *mode)
-	{
-		return d3d9->GetAdapterDisplayMode(adapter, mode);
-	}
-
-	int Direct3DDevice9::typeStride(unsigned char streamType)
-	{
-		static int LUT[] =
-		{
-			4,	// D3DDECLTYPE_FLOAT1    =  0,  // 1D float expanded to (value, 0., 0., 1.)
-			8,	// D3DDECLTYPE_FLOAT2    =  1,  // 2D float expanded to (value, value, 0., 1.)
-			12,	// D3DDECLTYPE_FLOAT3    =  2,  // 3D float expanded to (value, value, value, 1.)
-			16,	// D3DDECLTYPE_FLOAT4    =  3,  // 4D float
-			4,	// D3DDECLTYPE_D3DCOLOR  =  4,  // 4D packed unsigned bytes mapped to 0. to 1. range. Input is in D3DCOLOR format (ARGB) expanded to (R, G, B, A)
-			4,	// D3DDECLTYPE_UBYTE4    =  5,  // 4D unsigned byte
-			4,	// D3DDECLTYPE_SHORT2    =  6,  // 2D signed short expanded to (value, value, 0., 1.)
-			8,	// D3DDECLTYPE_SHORT4    =  7,  // 4D signed short
-			4,	// D3DDECLTYPE_UBYTE4N   =  8,  // Each of 4 bytes is normalized by dividing to 255.0
-			4,	// D3DDECLTYPE_SHORT2N   =  9,  // 2D signed short normalized (v[0]/32767.0,v[1]/32767.0,0,1)
-			8,	// D3DDECLTYPE_SHORT4N   = 10,  // 4D signed short normalized (v[0]/32767.0,v[1]/32767.0,v[2]/32767.0,v[3]/32767.0)
-			4,	// D3DDECLTYPE_USHORT2N  = 11,  // 2D unsigned short normalized (v[0]/65535.0,v[1]/65535.0,0,1)
-			8,	// D3DDECLTYPE_USHORT4N  = 12,  // 4D unsigned short normalized (v[0]/65535.0,v[1]/65535.0,v[2]/65535.0,v[3]/65535.0)
-			4,	// D3DDECLTYPE_UDEC3     = 13,  // 3D unsigned 10 10 10 format expanded to (value, value, value, 1)
-			4,	// D3DDECLTYPE_DEC3N     = 14,  // 3D signed 10 10 10 format normalized and expanded to (v[0]/511.0, v[1]/511.0, v[2]/511.0, 1)
-			4,	// D3DDECLTYPE_FLOAT16_2 = 15,  // Two 16-bit floating point values, expanded to (value, value, 0, 1)
-			8,	// D3DDECLTYPE_FLOAT16_4 = 16,  // Four 16-bit floating point values
-			0,	// D3DDECLTYPE_UNUSED    = 17,  // When the type field in a decl is unused.
-		};
-
-		return LUT[streamType];
-	}
-
-	bool Direct3DDevice9::instanceData()
-	{
-		ASSERT(vertexDeclaration);
-
-		D3DVERTEXELEMENT9 vertexElement[MAXD3DDECLLENGTH + 1];
-		unsigned int numElements;
-		vertexDeclaration->GetDeclaration(vertexElement, &numElements);
-
-		bool instanceData = false;
-
-		for(unsigned int i = 0; i < numElements - 1; i++)
-		{
-			unsigned short stream = vertexElement[i].Stream;
+		case D3DTSS_ALPHAARG0:
+			switch(value & D3DTA_SELECTMASK)
+			{
+			case D3DTA_DIFFUSE:
+				renderer->setThirdArgumentAlpha(stage, sw::TextureStage::SOURCE_DIFFUSE);
+				break;
+			case D3DTA_CURRENT:
+				renderer->setThirdArgumentAlpha(stage, sw::TextureStage::SOURCE_CURRENT);
+				break;
+			case D3DTA_TEXTURE:
+				renderer->setThirdArgumentAlpha(stage, sw::TextureStage::SOURCE_TEXTURE);
+				break;
+			case D3DTA_TFACTOR:
+				renderer->setThirdArgumentAlpha(stage, sw::TextureStage::SOURCE_TFACTOR);
+				break;
+			case D3DTA_SPECULAR:
+				renderer->setThirdArgumentAlpha(stage, sw::TextureStage::SOURCE_SPECULAR);
+				break;
+			case D3DTA_TEMP:
+				renderer->setThirdArgumentAlpha(stage, sw::TextureStage::SOURCE_TEMP);
+				break;
+			case D3DTA_CONSTANT:
+				renderer->setThirdArgumentAlpha(stage, sw::TextureStage::SOURCE_CONSTANT);
+				break;
+			default:
+				ASSERT(false);
+			}
 
-			if(stream != 0)
+			switch(value & ~D3DTA_SELECTMASK)
 			{
-				instanceData = instanceData || (streamSourceFreq[stream] & D3DSTREAMSOURCE_INSTANCEDATA) != 0;
+			case 0:
+				renderer->setThirdModifierAlpha(stage, sw::TextureStage::MODIFIER_COLOR);
+				break;
+			case D3DTA_COMPLEMENT:
+				renderer->setThirdModifierAlpha(stage, sw::TextureStage::MODIFIER_INVCOLOR);
+				break;
+			case D3DTA_ALPHAREPLICATE:
+				renderer->setThirdModifierAlpha(stage, sw::TextureStage::MODIFIER_ALPHA);
+				break;
+			case D3DTA_COMPLEMENT | D3DTA_ALPHAREPLICATE:
+				renderer->setThirdModifierAlpha(stage, sw::TextureStage::MODIFIER_INVALPHA);
+				break;
+			default:
+				ASSERT(false);
+			}
+			break;
+		case D3DTSS_RESULTARG:
+			switch(value & D3DTA_SELECTMASK)
+			{
+			case D3DTA_CURRENT:
+				renderer->setDestinationArgument(stage, sw::TextureStage::DESTINATION_CURRENT);
+				break;
+			case D3DTA_TEMP:
+				renderer->setDestinationArgument(stage, sw::TextureStage::DESTINATION_TEMP);
+				break;
+			default:
+				ASSERT(false);
 			}
+			break;
+		case D3DTSS_CONSTANT:
+			renderer->setConstantColor(stage, value);
+			break;
+		default:
+			ASSERT(false);
 		}
-
-		return instanceData;
 	}
 
 	bool Direct3DDevice9::bindResources(Direct3DIndexBuffer9 *indexBuffer)
 	{
+		applyState();   // Changed render, sampler and texture stage states, in one batch
+
 		if(!bindViewport())
 		{
 			return false;   // Zero-area target region
@@ -5839,6 +5883,86 @@ namespace D3D9
 		}
 	}
 
+	unsigned int Direct3DDevice9::streamUserVertices(const void *vertices, unsigned int length)
+	{
+		unsigned int offset = (userVertexOffset + 15) & ~15;
+		unsigned long flags = D3DLOCK_NOOVERWRITE;
+
+		if(length > userVertexBufferSize)
+		{
+			if(userVertexBuffer)
+			{
+				userVertexBuffer->unbind();
+			}
+
+			userVertexBufferSize = 1 << 20;
+
+			while(userVertexBufferSize < length)
+			{
+				userVertexBufferSize *= 2;
+			}
+
+			userVertexBuffer = new Direct3DVertexBuffer9(this, userVertexBufferSize, D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY, 0, D3DPOOL_DEFAULT);
+			userVertexBuffer->bind();
+			offset = 0;
+		}
+		else if(offset + length > userVertexBufferSize)
+		{
+			// Draws still reading the old storage keep it alive until they complete
+			offset = 0;
+			flags = D3DLOCK_DISCARD;
+		}
+
+		void *data;
+		userVertexBuffer->Lock(offset, length, &data, flags);
+		memcpy(data, vertices, length);
+		userVertexBuffer->Unlock();
+
+		userVertexOffset = offset + length;
+
+		return offset;
+	}
+
+	unsigned int Direct3DDevice9::streamUserIndices(const void *indices, unsigned int length)
+	{
+		unsigned int offset = (userIndexOffset + 3) & ~3;
+		unsigned long flags = D3DLOCK_NOOVERWRITE;
+
+		if(length > userIndexBufferSize)
+		{
+			if(userIndexBuffer)
+			{
+				userIndexBuffer->unbind();
+			}
+
+			userIndexBufferSize = 256 * 1024;
+
+			while(userIndexBufferSize < length)
+			{
+				userIndexBufferSize *= 2;
+			}
+
+			// Draws use the format of the indices, not the buffer's
+			userIndexBuffer = new Direct3DIndexBuffer9(this, userIndexBufferSize, D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY, D3DFMT_INDEX16, D3DPOOL_DEFAULT);
+			userIndexBuffer->bind();
+			offset = 0;
+		}
+		else if(offset + length > userIndexBufferSize)
+		{
+			offset = 0;
+			flags = D3DLOCK_DISCARD;
+		}
+
+		void *data;
+		userIndexBuffer->Lock(offset, length, &data, flags);
+		memcpy(data, indices, length);
+		userIndexBuffer->Unlock();
+
+		userIndexOffset = offset + length;
+
+		return offset;
+	}
+
 	void Direct3DDevice9::bindIndexBuffer(Direct3DIndexBuffer9 *indexBuffer)
 	{
 		sw::Resource *resource = 0;
@@ -6188,6 +6312,59 @@ namespace D3D9
 		return stateRecorder != 0;
 	}
 
+	void Direct3DDevice9::updateRenderState(D3DRENDERSTATETYPE state, unsigned long value)
+	{
+		if(!init && renderState[state] == value)
+		{
+			return;
+		}
+
+		renderState[state] = value;
+
+		if(state == D3DRS_SCISSORTESTENABLE)   // Also used by Clear
+		{
+			scissorEnable = (value != FALSE);
+		}
+
+		if(!renderStateDirty[state])
+		{
+			renderStateDirty[state] = true;
+			dirtyRenderState[dirtyRenderStateCount++] = state;
+		}
+	}
+
+	void Direct3DDevice9::updateSamplerState(unsigned long sampler, D3DSAMPLERSTATETYPE state, unsigned long value)
+	{
+		if(!init && samplerState[sampler][state] == value)
+		{
+			return;
+		}
+
+		samplerState[sampler][state] = value;
+
+		if(!samplerStateDirty[sampler][state])
+		{
+			samplerStateDirty[sampler][state] = true;
+			dirtySamplerState[dirtySamplerStateCount++] = sampler * (D3DSAMP_DMAPOFFSET + 1) + state;
+		}
+	}
+
+	void Direct3DDevice9::updateTextureStageState(unsigned long stage, D3DTEXTURESTAGESTATETYPE type, unsigned long value)
+	{
+		if(!init && textureStageState[stage][type] == value)
+		{
+			return;
+		}
+
+		textureStageState[stage][type] = value;
+
+		if(!textureStageStateDirty[stage][type])
+		{
+			textureStageStateDirty[stage][type] = true;
+			dirtyTextureStageState[dirtyTextureStageStateCount++] = stage * (D3DTSS_CONSTANT + 1) + type;
+		}
+	}
+
 	void Direct3DDevice9::setOcclusionEnabled(bool enable)
 	{
 		renderer->setOcclusionEnabled(enable);
@@ -6203,6 +6380,16 @@ namespace D3D9
 		renderer->addQuery(query);
 	}
 
+	int Direct3DDevice9::getDrawSequence() const
+	{
+		return renderer->getDrawSequence();
+	}
+
+	bool Direct3DDevice9::isDrawComplete(int sequence) const
+	{
+		return renderer->isComplete(sequence);
+	}
+
 	void Direct3DDevice9::stretchRect(Direct3DSurface9 *source, const RECT *sourceRect, Direct3DSurface9 *dest, const RECT *destRect, D3DTEXTUREFILTERTYPE filter)
 	{
 		D3DSURFACE_DESC sourceDescription;
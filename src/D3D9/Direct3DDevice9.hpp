@@ -182,9 +182,14 @@ namespace D3D9
 		// Internal methods
 		long getAdapterDisplayMode(unsigned int adapter, D3DDISPLAYMODE *mode);
 		bool isRecording() const;   // In a state recording mode
+		void updateRenderState(D3DRENDERSTATETYPE state, unsigned long value);                              // Validated, not recorded
+		void updateSamplerState(unsigned long sampler, D3DSAMPLERSTATETYPE state, unsigned long value);     // Sampler index 0 to 19
+		void updateTextureStageState(unsigned long stage, D3DTEXTURESTAGESTATETYPE type, unsigned long value);
 		void setOcclusionEnabled(bool enable);
 		void removeQuery(sw::Query *query);
 		void addQuery(sw::Query *query);
+		int getDrawSequence() const;
+		bool isDrawComplete(int sequence) const;   // Non-blocking, true once the draws issued before the sequence number have retired
 		void stretchRect(Direct3DSurface9 *sourceSurface, const RECT *sourceRect, Direct3DSurface9 *destSurface, const RECT *destRect, D3DTEXTUREFILTERTYPE filter);
 
 	private:
@@ -192,8 +197,14 @@ namespace D3D9
 		bool instanceData();
 		bool bindResources(Direct3DIndexBuffer9 *indexBuffer);
 		void bindVertexStreams(int base, bool instancing, int instance);
+		unsigned int streamUserVertices(const void *vertices, unsigned int length);   // Returns the offset in userVertexBuffer
+		unsigned int streamUserIndices(const void *indices, unsigned int length);     // Returns the offset in userIndexBuffer
 		void bindIndexBuffer(Direct3DIndexBuffer9 *indexBuffer);
 		void bindShaderConstants();
+		void applyState();
+		void applyRenderState(D3DRENDERSTATETYPE state, unsigned long value);
+		void applySamplerState(unsigned long sampler, D3DSAMPLERSTATETYPE state, unsigned long value);
+		void applyTextureStageState(unsigned long stage, D3DTEXTURESTAGESTATETYPE type, unsigned long value);
 		void bindLights();
 		bool bindViewport();   // Also adjusts for scissoring
 		void bindTextures();
@@ -283,6 +294,16 @@ namespace D3D9
 		unsigned int streamSourceFreq[MAX_VERTEX_INPUTS];
 		Direct3DIndexBuffer9 *indexData;
 
+		// Streaming buffers for the data of DrawPrimitiveUP and DrawIndexedPrimitiveUP.
+		// Appended to without overwriting, and discarded when full, so draws still
+		// using the previous contents keep their own copy.
+		Direct3DVertexBuffer9 *userVertexBuffer;
+		Direct3DIndexBuffer9 *userIndexBuffer;
+		unsigned int userVertexBufferSize;
+		unsigned int userIndexBufferSize;
+		unsigned int userVertexOffset;
+		unsigned int userIndexOffset;
+
 		Direct3DSwapChain9 *swapChain;
 		Direct3DSurface9 *renderTarget[4];
 		Direct3DSurface9 *depthStencil;
@@ -293,6 +314,17 @@ namespace D3D9
 		unsigned long renderState[D3DRS_BLENDOPALPHA + 1];
 		unsigned long textureStageState[8][D3DTSS_CONSTANT + 1];
 		unsigned long samplerState[16 + 4][D3DSAMP_DMAPOFFSET + 1];
+
+		// States changed since the last draw, applied to the renderer by bindResources
+		bool renderStateDirty[D3DRS_BLENDOPALPHA + 1];
+		bool textureStageStateDirty[8][D3DTSS_CONSTANT + 1];
+		bool samplerStateDirty[16 + 4][D3DSAMP_DMAPOFFSET + 1];
+		D3DRENDERSTATETYPE dirtyRenderState[D3DRS_BLENDOPALPHA + 1];
+		int dirtyTextureStageState[8 * (D3DTSS_CONSTANT + 1)];
+		int dirtySamplerState[(16 + 4) * (D3DSAMP_DMAPOFFSET + 1)];
+		int dirtyRenderStateCount;
+		int dirtyTextureStageStateCount;
+		int dirtySamplerStateCount;
 		bool init;
 
 		struct Palette
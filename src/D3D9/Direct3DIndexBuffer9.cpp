@@ -22,9 +22,9 @@
 
 namespace D3D9
 {
-	Direct3DIndexBuffer9::Direct3DIndexBuffer9(Direct3DDevice9 *device, unsigned int length, unsigned long usage, D3DFORMAT format, D3DPOOL pool) : Direct3DResource9(device, D3DRTYPE_INDEXBUFFER, pool, length), length(length), usage(usage), format(format)
+	Direct3DIndexBuffer9::Direct3DIndexBuffer9(Direct3DDevice9 *device, unsigned int length, unsigned long usage, D3DFORMAT format, D3DPOOL pool) : Direct3DResource9(device, D3DRTYPE_INDEXBUFFER, pool, length), length(length), usage(usage), format(format), resourcePool(length + 16)
 	{
-		indexBuffer = new sw::Resource(length + 16);
+		indexBuffer = resourcePool.acquire();
 		lockCount = 0;
 	}
 
@@ -178,10 +178,11 @@ namespace D3D9
 
 		void *buffer;
 
-		if(flags & D3DLOCK_DISCARD/* && usage & D3DUSAGE_DYNAMIC*/)
+		if(flags & D3DLOCK_DISCARD/* && usage & D3DUSAGE_DYNAMIC*/ && lockCount == 0)
 		{
-			indexBuffer->destruct();
-			indexBuffer = new sw::Resource(length + 16);
+			// Rename instead of waiting for the draws in flight, their storage gets recycled once they're done
+			resourcePool.retire(indexBuffer);
+			indexBuffer = resourcePool.acquire();
 
 			buffer = (void*)indexBuffer->data();
 		}
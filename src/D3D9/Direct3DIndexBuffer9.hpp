@@ -16,14 +16,10 @@
 #define D3D9_Direct3DIndexBuffer9_hpp
 
 #include "Direct3DResource9.hpp"
+#include "Resource.hpp"
 
 #include <d3d9.h>
 
-namespace sw
-{
-	class Resource;
-}
-
 namespace D3D9
 {
 	class Direct3DIndexBuffer9 : public IDirect3DIndexBuffer9, public Direct3DResource9
@@ -64,6 +60,7 @@ namespace D3D9
 		const D3DFORMAT format;
 
 		sw::Resource *indexBuffer;
+		sw::ResourcePool resourcePool;   // Storage renamed by D3DLOCK_DISCARD
 		int lockCount;
 	};
 }
@@ -33,6 +33,9 @@ namespace D3D9
 		{
 			query = 0;
 		}
+
+		sequence = device->getDrawSequence();
+		timestamp = 0;
 	}
 
 	Direct3DQuery9::~Direct3DQuery9()
@@ -151,7 +154,7 @@ namespace D3D9
 		case D3DQUERYTYPE_EVENT:
 			if(flags == D3DISSUE_END)
 			{
-			//	device->renderer->synchronize();   // FIXME
+				sequence = device->getDrawSequence();   // Signaled once the draws issued so far have retired
 			}
 			else return INVALIDCALL();
 			break;
@@ -202,8 +205,14 @@ namespace D3D9
 			return INVALIDCALL();
 		}
 
+		// Never waits, the renderer retires draws whether or not D3DGETDATA_FLUSH is specified
 		bool signaled = !query || query->reference == 0;
 
+		if(type == D3DQUERYTYPE_EVENT)
+		{
+			signaled = device->isDrawComplete(sequence);
+		}
+
 		if(size && signaled)
 		{
 			if(!data)
@@ -229,7 +238,7 @@ namespace D3D9
 				break;
 			case D3DQUERYTYPE_RESOURCEMANAGER:		UNIMPLEMENTED(); break;
 			case D3DQUERYTYPE_VERTEXSTATS:			UNIMPLEMENTED(); break;
-			case D3DQUERYTYPE_EVENT:				*(BOOL*)data = TRUE; break;                       // FIXME
+			case D3DQUERYTYPE_EVENT:				*(BOOL*)data = TRUE; break;
 			case D3DQUERYTYPE_OCCLUSION:
 				*(DWORD*)data = query->data;
 				break;
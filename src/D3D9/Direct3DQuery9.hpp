@@ -52,6 +52,7 @@ namespace D3D9
 		// TODO: create a union, or subclasses for each type.
 		sw::Query *query;   // D3DQUERYTYPE_OCCLUSION
 		UINT64 timestamp;   // D3DQUERYTYPE_TIMESTAMP
+		int sequence;       // D3DQUERYTYPE_EVENT, renderer draw sequence at the last D3DISSUE_END
 	};
 }
 
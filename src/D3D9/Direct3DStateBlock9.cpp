@@ -82,6 +82,8 @@ namespace D3D9
 			captureClippingPlanes();
 			captureMaterial();
 		}
+
+		compile();
 	}
 
 	Direct3DStateBlock9::~Direct3DStateBlock9()
@@ -149,12 +151,9 @@ namespace D3D9
 			device->SetIndices(indexBuffer);
 		}
 
-		for(int state = D3DRS_ZENABLE; state <= D3DRS_BLENDOPALPHA; state++)
+		for(D3DRENDERSTATETYPE state : capturedRenderStates)
 		{
-			if(renderStateCaptured[state])
-			{
-				device->SetRenderState((D3DRENDERSTATETYPE)state, renderState[state]);
-			}
+			device->updateRenderState(state, renderState[state]);
 		}
 
 		if(nPatchModeCaptured)
@@ -162,27 +161,14 @@ namespace D3D9
 			device->SetNPatchMode(nPatchMode);
 		}
 
-		for(int stage = 0; stage < 8; stage++)
+		for(const StageState &state : capturedTextureStageStates)
 		{
-			for(int state = D3DTSS_COLOROP; state <= D3DTSS_CONSTANT; state++)
-			{
-				if(textureStageStateCaptured[stage][state])
-				{
-					device->SetTextureStageState(stage, (D3DTEXTURESTAGESTATETYPE)state, textureStageState[stage][state]);
-				}
-			}
+			device->updateTextureStageState(state.stage, state.type, textureStageState[state.stage][state.type]);
 		}
 
-		for(int sampler = 0; sampler < 16 + 4; sampler++)
+		for(const SamplerState &state : capturedSamplerStates)
 		{
-			for(int state = D3DSAMP_ADDRESSU; state <= D3DSAMP_DMAPOFFSET; state++)
-			{
-				if(samplerStateCaptured[sampler][state])
-				{
-					int index = sampler < 16 ? sampler : D3DVERTEXTEXTURESAMPLER0 + (sampler - 16);
-					device->SetSamplerState(index, (D3DSAMPLERSTATETYPE)state, samplerState[sampler][state]);
-				}
-			}
+			device->updateSamplerState(state.sampler, state.type, samplerState[state.sampler][state.type]);
 		}
 
 		for(int stream = 0; stream < MAX_VERTEX_INPUTS; stream++)
@@ -207,12 +193,9 @@ namespace D3D9
 			}
 		}
 
-		for(int state = 0; state < 512; state++)
+		for(D3DTRANSFORMSTATETYPE state : capturedTransforms)
 		{
-			if(transformCaptured[state])
-			{
-				device->SetTransform((D3DTRANSFORMSTATETYPE)state, &transform[state]);
-			}
+			device->SetTransform(state, &transform[state]);
 		}
 
 		if(materialCaptured)
@@ -251,12 +234,9 @@ namespace D3D9
 			device->SetViewport(&viewport);
 		}
 
-		for(int i = 0; i < MAX_PIXEL_SHADER_CONST; i++)
+		for(int i : capturedPixelShaderConstantsF)
 		{
-			if(*(int*)pixelShaderConstantF[i] != 0x80000000)
-			{
-				device->SetPixelShaderConstantF(i, pixelShaderConstantF[i], 1);
-			}
+			device->SetPixelShaderConstantF(i, pixelShaderConstantF[i], 1);
 		}
 
 		for(int i = 0; i < 16; i++)
@@ -275,12 +255,9 @@ namespace D3D9
 			}
 		}
 
-		for(int i = 0; i < MAX_VERTEX_SHADER_CONST; i++)
+		for(int i : capturedVertexShaderConstantsF)
 		{
-			if(*(int*)vertexShaderConstantF[i] != 0x80000000)
-			{
-				device->SetVertexShaderConstantF(i, vertexShaderConstantF[i], 1);
-			}
+			device->SetVertexShaderConstantF(i, vertexShaderConstantF[i], 1);
 		}
 
 		for(int i = 0; i < 16; i++)
@@ -369,12 +346,9 @@ namespace D3D9
 			this->indexBuffer = indexBuffer;
 		}
 
-		for(int state = 0; state < D3DRS_BLENDOPALPHA + 1; state++)
+		for(D3DRENDERSTATETYPE state : capturedRenderStates)
 		{
-			if(renderStateCaptured[state])
-			{
-				device->GetRenderState((D3DRENDERSTATETYPE)state, &renderState[state]);
-			}
+			device->GetRenderState(state, &renderState[state]);
 		}
 
 		if(nPatchModeCaptured)
@@ -382,27 +356,15 @@ namespace D3D9
 			nPatchMode = device->GetNPatchMode();
 		}
 
-		for(int stage = 0; stage < 8; stage++)
+		for(const StageState &state : capturedTextureStageStates)
 		{
-			for(int state = 0; state < D3DTSS_CONSTANT + 1; state++)
-			{
-				if(textureStageStateCaptured[stage][state])
-				{
-					device->GetTextureStageState(stage, (D3DTEXTURESTAGESTATETYPE)state, &textureStageState[stage][state]);
-				}
-			}
+			device->GetTextureStageState(state.stage, state.type, &textureStageState[state.stage][state.type]);
 		}
 
-		for(int sampler = 0; sampler < 16 + 4; sampler++)
+		for(const SamplerState &state : capturedSamplerStates)
 		{
-			for(int state = 0; state < D3DSAMP_DMAPOFFSET + 1; state++)
-			{
-				if(samplerStateCaptured[sampler][state])
-				{
-					int index = sampler < 16 ? sampler : D3DVERTEXTEXTURESAMPLER0 + (sampler - 16);
-					device->GetSamplerState(index, (D3DSAMPLERSTATETYPE)state, &samplerState[sampler][state]);
-				}
-			}
+			int index = state.sampler < 16 ? state.sampler : D3DVERTEXTEXTURESAMPLER0 + (state.sampler - 16);
+			device->GetSamplerState(index, state.type, &samplerState[state.sampler][state.type]);
 		}
 
 		for(int stream = 0; stream < MAX_VERTEX_INPUTS; stream++)
@@ -455,12 +417,9 @@ namespace D3D9
 			}
 		}
 
-		for(int state = 0; state < 512; state++)
+		for(D3DTRANSFORMSTATETYPE state : capturedTransforms)
 		{
-			if(transformCaptured[state])
-			{
-				device->GetTransform((D3DTRANSFORMSTATETYPE)state, &transform[state]);
-			}
+			device->GetTransform(state, &transform[state]);
 		}
 
 		if(materialCaptured)
@@ -528,12 +487,9 @@ namespace D3D9
 			device->GetViewport(&viewport);
 		}
 
-		for(int i = 0; i < MAX_PIXEL_SHADER_CONST; i++)
+		for(int i : capturedPixelShaderConstantsF)
 		{
-			if(*(int*)pixelShaderConstantF[i] != 0x80000000)
-			{
-				device->GetPixelShaderConstantF(i, pixelShaderConstantF[i], 1);
-			}
+			device->GetPixelShaderConstantF(i, pixelShaderConstantF[i], 1);
 		}
 
 		for(int i = 0; i < 16; i++)
@@ -552,12 +508,9 @@ namespace D3D9
 			}
 		}
 
-		for(int i = 0; i < MAX_VERTEX_SHADER_CONST; i++)
+		for(int i : capturedVertexShaderConstantsF)
 		{
-			if(*(int*)vertexShaderConstantF[i] != 0x80000000)
-			{
-				device->GetVertexShaderConstantF(i, vertexShaderConstantF[i], 1);
-			}
+			device->GetVertexShaderConstantF(i, vertexShaderConstantF[i], 1);
 		}
 
 		for(int i = 0; i < 16; i++)
@@ -809,6 +762,70 @@ namespace D3D9
 		memcpy(vertexShaderConstantI[startRegister], constantData, count * sizeof(int[4]));
 	}
 
+	void Direct3DStateBlock9::compile()
+	{
+		capturedRenderStates.clear();
+		capturedTextureStageStates.clear();
+		capturedSamplerStates.clear();
+		capturedTransforms.clear();
+		capturedPixelShaderConstantsF.clear();
+		capturedVertexShaderConstantsF.clear();
+
+		for(int state = D3DRS_ZENABLE; state <= D3DRS_BLENDOPALPHA; state++)
+		{
+			if(renderStateCaptured[state])
+			{
+				capturedRenderStates.push_back((D3DRENDERSTATETYPE)state);
+			}
+		}
+
+		for(int stage = 0; stage < 8; stage++)
+		{
+			for(int state = D3DTSS_COLOROP; state <= D3DTSS_CONSTANT; state++)
+			{
+				if(textureStageStateCaptured[stage][state])
+				{
+					capturedTextureStageStates.push_back({(unsigned long)stage, (D3DTEXTURESTAGESTATETYPE)state});
+				}
+			}
+		}
+
+		for(int sampler = 0; sampler < 16 + 4; sampler++)
+		{
+			for(int state = D3DSAMP_ADDRESSU; state <= D3DSAMP_DMAPOFFSET; state++)
+			{
+				if(samplerStateCaptured[sampler][state])
+				{
+					capturedSamplerStates.push_back({(unsigned long)sampler, (D3DSAMPLERSTATETYPE)state});
+				}
+			}
+		}
+
+		for(int state = 0; state < 512; state++)
+		{
+			if(transformCaptured[state])
+			{
+				capturedTransforms.push_back((D3DTRANSFORMSTATETYPE)state);
+			}
+		}
+
+		for(int i = 0; i < MAX_PIXEL_SHADER_CONST; i++)
+		{
+			if(*(int*)pixelShaderConstantF[i] != 0x80000000)
+			{
+				capturedPixelShaderConstantsF.push_back(i);
+			}
+		}
+
+		for(int i = 0; i < MAX_VERTEX_SHADER_CONST; i++)
+		{
+			if(*(int*)vertexShaderConstantF[i] != 0x80000000)
+			{
+				capturedVertexShaderConstantsF.push_back(i);
+			}
+		}
+	}
+
 	void Direct3DStateBlock9::clear()
 	{
 		// Erase capture flags
@@ -77,6 +77,8 @@ namespace D3D9
 		void setVertexShaderConstantF(unsigned int startRegister, const float *constantData, unsigned int count);
 		void setVertexShaderConstantI(unsigned int startRegister, const int *constantData, unsigned int count);
 
+		void compile();   // Lists the captured states, once recording or capturing is done
+
 	private:
 		// Individual states
 		void captureRenderState(D3DRENDERSTATETYPE state);
@@ -192,6 +194,26 @@ namespace D3D9
 		bool paletteNumberCaptured;
 		unsigned int paletteNumber;
 
+		// Compiled lists of the captured states, so Apply and Capture don't scan every capture flag
+		struct StageState
+		{
+			unsigned long stage;
+			D3DTEXTURESTAGESTATETYPE type;
+		};
+
+		struct SamplerState
+		{
+			unsigned long sampler;   // 0 to 19, vertex texture samplers last
+			D3DSAMPLERSTATETYPE type;
+		};
+
+		std::vector<D3DRENDERSTATETYPE> capturedRenderStates;
+		std::vector<StageState> capturedTextureStageStates;
+		std::vector<SamplerState> capturedSamplerStates;
+		std::vector<D3DTRANSFORMSTATETYPE> capturedTransforms;
+		std::vector<int> capturedPixelShaderConstantsF;
+		std::vector<int> capturedVertexShaderConstantsF;
+
 		void clear();
 	};
 }
@@ -90,10 +90,10 @@ namespace D3D9
 		#if PERF_HUD
 			sw::Renderer *renderer = device->renderer;
 
-			static int64_t frame = sw::Timer::ticks();
+			static int64_t frame = sw::Timer::counter();
 
-			int64_t frameTime = sw::Timer::ticks() - frame;
-			frame = sw::Timer::ticks();
+			int64_t frameTime = sw::Timer::counter() - frame;
+			frame = sw::Timer::counter();
 
 			if(frameTime > 0)
 			{
@@ -22,7 +22,7 @@
 
 namespace D3D9
 {
-	Direct3DVertexBuffer9::Direct3DVertexBuffer9(Direct3DDevice9 *device, unsigned int length, unsigned long usage, long FVF, D3DPOOL pool) : Direct3DResource9(device, D3DRTYPE_VERTEXBUFFER, pool, length), length(length), usage(usage), FVF(FVF)
+	Direct3DVertexBuffer9::Direct3DVertexBuffer9(Direct3DDevice9 *device, unsigned int length, unsigned long usage, long FVF, D3DPOOL pool) : Direct3DResource9(device, D3DRTYPE_VERTEXBUFFER, pool, length), length(length), usage(usage), FVF(FVF), resourcePool(length + 192 + 1024)
 	{
 		if(FVF)
 		{
@@ -63,7 +63,7 @@ namespace D3D9
 			ASSERT(length >= stride);       // FIXME
 		}
 
-		vertexBuffer = new sw::Resource(length + 192 + 1024);   // NOTE: Applications can 'overshoot' while writing vertices
+		vertexBuffer = resourcePool.acquire();   // NOTE: Applications can 'overshoot' while writing vertices
 		lockCount = 0;
 	}
 
@@ -197,10 +197,11 @@ namespace D3D9
 
 		void *buffer;
 
-		if(flags & D3DLOCK_DISCARD/* && usage & D3DUSAGE_DYNAMIC*/)
+		if(flags & D3DLOCK_DISCARD/* && usage & D3DUSAGE_DYNAMIC*/ && lockCount == 0)
 		{
-			vertexBuffer->destruct();
-			vertexBuffer = new sw::Resource(length + 192 + 1024);   // NOTE: Applications can 'overshoot' while writing vertices
+			// Rename instead of waiting for the draws in flight, their storage gets recycled once they're done
+			resourcePool.retire(vertexBuffer);
+			vertexBuffer = resourcePool.acquire();
 
 			buffer = (void*)vertexBuffer->data();
 		}
@@ -16,14 +16,10 @@
 #define D3D9_Direct3DVertexBuffer9_hpp
 
 #include "Direct3DResource9.hpp"
+#include "Resource.hpp"
 
 #include <d3d9.h>
 
-namespace sw
-{
-	class Resource;
-}
-
 namespace D3D9
 {
 	class Direct3DVertexBuffer9 : public IDirect3DVertexBuffer9, public Direct3DResource9
@@ -64,6 +60,7 @@ namespace D3D9
 		const long FVF;
 
 		sw::Resource *vertexBuffer;
+		sw::ResourcePool resourcePool;   // Storage renamed by D3DLOCK_DISCARD
 		int lockCount;
 	};
 }
@@ -111,7 +111,7 @@ namespace sw
 		references = -1;
 
 		data = (DrawData*)allocate(sizeof(DrawData));
-		data->constants = &constants;
+		data->constants = &getConstants();
 	}
 
 	DrawCall::~DrawCall()
@@ -17,8 +17,9 @@
 
 #include "Common/Types.hpp"
 
-#define PERF_HUD 0       // Display time spent on vertex, setup and pixel processing for each thread
+#define PERF_HUD 0       // Display time spent on vertex, setup and pixel processing for each thread, enables pipeline statistics at startup
 #define PERF_PROFILE 0   // Profile various pipeline stages and display the timing in SwiftConfig
+#define SHADER_PROFILE 0   // 1: Count the executions of each shader instruction, 2: Also sample their cycles (LLVM only). Written out at exit.
 
 #define ASTC_SUPPORT 0
 
@@ -96,6 +97,7 @@ namespace sw
 		MAX_PROGRAM_TEXEL_OFFSET = 7,
 		MAX_TEXTURE_LOD = MIPMAP_LEVELS - 2,   // Trilinear accesses lod+1
 		RENDERTARGETS = 8,
+		MAX_THREAD_COUNT = 128,   // Also bounds the number of pixel clusters
 		NUM_TEMPORARY_REGISTERS = 4096,
 	};
 }
@@ -17,8 +17,10 @@
 #include "Renderer/Surface.hpp"
 #include "Reactor/Reactor.hpp"
 #include "Common/Timer.hpp"
+#include "Common/Trace.hpp"
 #include "Common/Debug.hpp"
 
+#include <algorithm>
 #include <stdio.h>
 #include <string.h>
 #include <time.h>
@@ -31,6 +33,7 @@ namespace sw
 
 	FrameBuffer::Cursor FrameBuffer::cursor = {};
 	bool FrameBuffer::topLeftOrigin = false;
+	std::atomic<int> FrameBuffer::threadCount(1);
 
 	FrameBuffer::FrameBuffer(int width, int height, bool fullscreen, bool topLeftOrigin)
 	{
@@ -49,6 +52,19 @@ namespace sw
 		blitRoutine = nullptr;
 		blitState = {};
 
+		damaged = false;
+		complete = false;
+		copied = Rect(0, 0, width, height);
+
+		for(int i = 0; i < MAX_COPY_THREADS; i++)
+		{
+			worker[i] = nullptr;
+			resume[i] = nullptr;
+			suspend[i] = nullptr;
+		}
+
+		exitThreads = false;
+
 		if(ASYNCHRONOUS_BLIT)
 		{
 			terminate = false;
@@ -67,9 +83,79 @@ namespace sw
 			delete blitThread;
 		}
 
+		terminateThreads();
+
 		delete blitRoutine;
 	}
 
+	void FrameBuffer::setThreadCount(int count)
+	{
+		threadCount = std::max(1, std::min(count, (int)MAX_COPY_THREADS));
+	}
+
+	void FrameBuffer::initializeThreads(int count)
+	{
+		// Band 0 is processed by the calling thread
+		for(int i = 1; i < count; i++)
+		{
+			resume[i] = new Event();
+			suspend[i] = new Event();
+
+			Parameters parameters;
+			parameters.frameBuffer = this;
+			parameters.threadIndex = i;
+
+			worker[i] = new Thread(bandFunction, &parameters);
+
+			suspend[i]->wait();
+		}
+	}
+
+	void FrameBuffer::terminateThreads()
+	{
+		exitThreads = true;
+
+		for(int i = 1; i < MAX_COPY_THREADS; i++)
+		{
+			if(worker[i])
+			{
+				resume[i]->signal();
+				worker[i]->join();
+
+				delete worker[i];
+				delete resume[i];
+				delete suspend[i];
+
+				worker[i] = nullptr;
+				resume[i] = nullptr;
+				suspend[i] = nullptr;
+			}
+		}
+
+		exitThreads = false;
+	}
+
+	void FrameBuffer::bandFunction(void *parameters)
+	{
+		FrameBuffer *frameBuffer = static_cast<Parameters*>(parameters)->frameBuffer;
+		int threadIndex = static_cast<Parameters*>(parameters)->threadIndex;
+
+		frameBuffer->suspend[threadIndex]->signal();   // Parameters have been read
+
+		while(true)
+		{
+			frameBuffer->resume[threadIndex]->wait();
+
+			if(frameBuffer->exitThreads)
+			{
+				return;
+			}
+
+			frameBuffer->copyBand(&frameBuffer->band[threadIndex]);
+			frameBuffer->suspend[threadIndex]->signal();
+		}
+	}
+
 	void FrameBuffer::setCursorImage(sw::Surface *cursorImage)
 	{
 		if(cursorImage)
@@ -99,6 +185,22 @@ namespace sw
 		cursor.positionY = y;
 	}
 
+	void FrameBuffer::setDamage(const Rect &region)
+	{
+		if(damaged)
+		{
+			damage.x0 = std::min(damage.x0, region.x0);
+			damage.y0 = std::min(damage.y0, region.y0);
+			damage.x1 = std::max(damage.x1, region.x1);
+			damage.y1 = std::max(damage.y1, region.y1);
+		}
+		else
+		{
+			damage = region;
+			damaged = true;
+		}
+	}
+
 	void FrameBuffer::copy(sw::Surface *source)
 	{
 		if(!source)
@@ -106,6 +208,8 @@ namespace sw
 			return;
 		}
 
+		sw::TraceScope scope("FrameBuffer copy");
+
 		if(!lock())
 		{
 			return;
@@ -133,6 +237,18 @@ namespace sw
 		cursor.x = cursor.positionX - cursor.hotspotX;
 		cursor.y = cursor.positionY - cursor.hotspotY;
 
+		copied = Rect(0, 0, width, height);
+
+		if(damaged && preservesContents() && complete)
+		{
+			copied = damage;
+			copied.x0 &= ~3;   // Keeps the routine's vector loads aligned
+			copied.clip(0, 0, width, height);
+		}
+
+		damaged = false;
+		complete = true;
+
 		if(ASYNCHRONOUS_BLIT)
 		{
 			blitEvent.signal();
@@ -151,39 +267,124 @@ namespace sw
 
 	void FrameBuffer::copyLocked()
 	{
-		if(memcmp(&blitState, &updateState, sizeof(BlitState)) != 0)
+		if(!isDirectCopy(updateState) && memcmp(&blitState, &updateState, sizeof(BlitState)) != 0)
 		{
 			blitState = updateState;
 			delete blitRoutine;
 
 			blitRoutine = copyRoutine(blitState);
-			blitFunction = (void(*)(void*, void*, Cursor*))blitRoutine->getEntry();
+			blitFunction = (void(*)(void*, void*, Cursor*, Rect*))blitRoutine->getEntry();
+		}
+
+		const int minimumBandPixels = 64 * 1024;   // Smaller copies are not worth waking up threads for
+
+		int count = threadCount;
+		int rows = copied.height();
+		int bandCount = std::min(std::min(count, copied.width() * rows / minimumBandPixels), rows);
+
+		if(bandCount <= 1)
+		{
+			copyBand(&copied);
+
+			return;
+		}
+
+		if(!worker[bandCount - 1])
+		{
+			terminateThreads();
+			initializeThreads(count);
+		}
+
+		for(int i = 0; i < bandCount; i++)
+		{
+			band[i] = copied;
+			band[i].y0 = copied.y0 + rows * i / bandCount;
+			band[i].y1 = copied.y0 + rows * (i + 1) / bandCount;
 		}
 
-		blitFunction(framebuffer, renderbuffer, &cursor);
+		for(int i = 1; i < bandCount; i++)
+		{
+			resume[i]->signal();
+		}
+
+		copyBand(&band[0]);
+
+		for(int i = 1; i < bandCount; i++)
+		{
+			suspend[i]->wait();
+		}
+	}
+
+	void FrameBuffer::copyBand(Rect *region)
+	{
+		if(isDirectCopy(updateState))
+		{
+			const int bytes = Surface::bytes(updateState.destFormat);
+			const int rowBytes = region->width() * bytes;
+
+			for(int y = region->y0; y < region->y1; y++)
+			{
+				memcpy((byte*)framebuffer + y * updateState.destStride + region->x0 * bytes,
+				       (byte*)renderbuffer + y * updateState.sourceStride + region->x0 * bytes, rowBytes);
+			}
+		}
+		else
+		{
+			blitFunction(framebuffer, renderbuffer, &cursor, region);
+		}
+	}
+
+	bool FrameBuffer::isDirectCopy(const BlitState &state)
+	{
+		if(state.cursorWidth != 0 && state.cursorHeight != 0)
+		{
+			return false;   // The cursor gets blended by the routine
+		}
+
+		// Pairs which the copy routine moves unchanged, including the alpha or padding byte
+		switch(state.destFormat)
+		{
+		case FORMAT_X8R8G8B8:
+		case FORMAT_A8R8G8B8:
+			return state.sourceFormat == FORMAT_X8R8G8B8 || state.sourceFormat == FORMAT_A8R8G8B8;
+		case FORMAT_X8B8G8R8:
+		case FORMAT_A8B8G8R8:
+		case FORMAT_SRGB8_X8:
+		case FORMAT_SRGB8_A8:
+			return state.sourceFormat == FORMAT_X8B8G8R8 || state.sourceFormat == FORMAT_A8B8G8R8;
+		case FORMAT_R5G6B5:
+			return state.sourceFormat == FORMAT_R5G6B5;
+		default:
+			return false;
+		}
 	}
 
 	Routine *FrameBuffer::copyRoutine(const BlitState &state)
 	{
 		const int width = state.width;
-		const int height = state.height;
 		const int dBytes = Surface::bytes(state.destFormat);
 		const int dStride = state.destStride;
 		const int sBytes = Surface::bytes(state.sourceFormat);
 		const int sStride = state.sourceStride;
 
-		Function<Void(Pointer<Byte>, Pointer<Byte>, Pointer<Byte>)> function;
+		Function<Void(Pointer<Byte>, Pointer<Byte>, Pointer<Byte>, Pointer<Byte>)> function;
 		{
 			Pointer<Byte> dst(function.Arg<0>());
 			Pointer<Byte> src(function.Arg<1>());
 			Pointer<Byte> cursor(function.Arg<2>());
+			Pointer<Byte> region(function.Arg<3>());   // Rect to convert, left edge a multiple of 4
+
+			Int left = *Pointer<Int>(region + OFFSET(Rect,x0));
+			Int top = *Pointer<Int>(region + OFFSET(Rect,y0));
+			Int right = *Pointer<Int>(region + OFFSET(Rect,x1));
+			Int bottom = *Pointer<Int>(region + OFFSET(Rect,y1));
 
-			For(Int y = 0, y < height, y++)
+			For(Int y = top, y < bottom, y++)
 			{
-				Pointer<Byte> d = dst + y * dStride;
-				Pointer<Byte> s = src + y * sStride;
+				Pointer<Byte> d = dst + y * dStride + left * dBytes;
+				Pointer<Byte> s = src + y * sStride + left * sBytes;
 
-				Int x0 = 0;
+				Int x0 = left;
 
 				switch(state.destFormat)
 				{
@@ -196,7 +397,7 @@ namespace sw
 						{
 						case FORMAT_X8R8G8B8:
 						case FORMAT_A8R8G8B8:
-							For(, x < width - 3, x += 4)
+							For(, x < right - 3, x += 4)
 							{
 								*Pointer<Int4>(d, 1) = *Pointer<Int4>(s, sStride % 16 ? 1 : 16);
 
@@ -206,7 +407,7 @@ namespace sw
 							break;
 						case FORMAT_X8B8G8R8:
 						case FORMAT_A8B8G8R8:
-							For(, x < width - 3, x += 4)
+							For(, x < right - 3, x += 4)
 							{
 								Int4 bgra = *Pointer<Int4>(s, sStride % 16 ? 1 : 16);
 
@@ -219,7 +420,7 @@ namespace sw
 							}
 							break;
 						case FORMAT_A16B16G16R16:
-							For(, x < width - 1, x += 2)
+							For(, x < right - 1, x += 2)
 							{
 								Short4 c0 = As<UShort4>(Swizzle(*Pointer<Short4>(s + 0), 0xC6)) >> 8;
 								Short4 c1 = As<UShort4>(Swizzle(*Pointer<Short4>(s + 8), 0xC6)) >> 8;
@@ -231,7 +432,7 @@ namespace sw
 							}
 							break;
 						case FORMAT_R5G6B5:
-							For(, x < width - 3, x += 4)
+							For(, x < right - 3, x += 4)
 							{
 								Int4 rgb = Int4(*Pointer<Short4>(s));
 
@@ -248,7 +449,7 @@ namespace sw
 							break;
 						}
 
-						For(, x < width, x++)
+						For(, x < right, x++)
 						{
 							switch(state.sourceFormat)
 							{
@@ -304,7 +505,7 @@ namespace sw
 						{
 						case FORMAT_X8B8G8R8:
 						case FORMAT_A8B8G8R8:
-							For(, x < width - 3, x += 4)
+							For(, x < right - 3, x += 4)
 							{
 								*Pointer<Int4>(d, 1) = *Pointer<Int4>(s, sStride % 16 ? 1 : 16);
 
@@ -314,7 +515,7 @@ namespace sw
 							break;
 						case FORMAT_X8R8G8B8:
 						case FORMAT_A8R8G8B8:
-							For(, x < width - 3, x += 4)
+							For(, x < right - 3, x += 4)
 							{
 								Int4 bgra = *Pointer<Int4>(s, sStride % 16 ? 1 : 16);
 
@@ -327,7 +528,7 @@ namespace sw
 							}
 							break;
 						case FORMAT_A16B16G16R16:
-							For(, x < width - 1, x += 2)
+							For(, x < right - 1, x += 2)
 							{
 								Short4 c0 = *Pointer<UShort4>(s + 0) >> 8;
 								Short4 c1 = *Pointer<UShort4>(s + 8) >> 8;
@@ -339,7 +540,7 @@ namespace sw
 							}
 							break;
 						case FORMAT_R5G6B5:
-							For(, x < width - 3, x += 4)
+							For(, x < right - 3, x += 4)
 							{
 								Int4 rgb = Int4(*Pointer<Short4>(s));
 
@@ -357,7 +558,7 @@ namespace sw
 							break;
 						}
 
-						For(, x < width, x++)
+						For(, x < right, x++)
 						{
 							switch(state.sourceFormat)
 							{
@@ -403,7 +604,7 @@ namespace sw
 					break;
 				case FORMAT_R8G8B8:
 					{
-						For(Int x = x0, x < width, x++)
+						For(Int x = x0, x < right, x++)
 						{
 							switch(state.sourceFormat)
 							{
@@ -445,7 +646,7 @@ namespace sw
 					break;
 				case FORMAT_R5G6B5:
 					{
-						For(Int x = x0, x < width, x++)
+						For(Int x = x0, x < right, x++)
 						{
 							switch(state.sourceFormat)
 							{
@@ -507,7 +708,7 @@ namespace sw
 				{
 					Int y = y0 + y1;
 
-					If(y >= 0 && y < height)
+					If(y >= top && y < bottom)   // Each band blends its own rows
 					{
 						Pointer<Byte> d = dst + y * dStride + x0 * dBytes;
 						Pointer<Byte> s = src + y * sStride + x0 * sBytes;
@@ -531,6 +732,8 @@ namespace sw
 			}
 		}
 
+		Nucleus::setRoutineCategory(RoutineFrameBuffer);
+
 		return function(L"FrameBuffer");
 	}
 
@@ -19,6 +19,8 @@
 #include "Renderer/Surface.hpp"
 #include "Common/Thread.hpp"
 
+#include <atomic>
+
 namespace sw
 {
 	using namespace rr;
@@ -50,6 +52,14 @@ namespace sw
 		virtual void *lock() = 0;
 		virtual void unlock() = 0;
 
+		// Adds a window region with a top-left origin which changed since the last flip. Only
+		// the union of the regions gets converted and presented by the next flip, if the
+		// backend preserves its contents. Without damage the whole window is updated. Virtual
+		// so that libEGL, which doesn't link the frame buffer code, can call it.
+		virtual void setDamage(const Rect &region);
+
+		static void setThreadCount(int count);   // Large copies are split into row bands converted in parallel
+
 		static void setCursorImage(sw::Surface *cursor);
 		static void setCursorOrigin(int x0, int y0);
 		static void setCursorPosition(int x, int y);
@@ -58,6 +68,9 @@ namespace sw
 
 	protected:
 		void copy(sw::Surface *source);
+		virtual bool preservesContents() const { return false; }   // The window buffer keeps pixels from one flip to the next
+
+		Rect copied;   // Region updated by the last copy()
 
 		bool windowed;
 
@@ -68,7 +81,20 @@ namespace sw
 		Format format;
 
 	private:
+		enum { MAX_COPY_THREADS = 16 };
+
+		struct Parameters
+		{
+			FrameBuffer *frameBuffer;
+			int threadIndex;
+		};
+
 		void copyLocked();
+		void copyBand(Rect *region);
+		void initializeThreads(int count);
+		void terminateThreads();
+		static void bandFunction(void *parameters);
+		static bool isDirectCopy(const BlitState &state);   // Rows can be copied as-is, without a routine
 
 		static void threadFunction(void *parameters);
 
@@ -89,11 +115,15 @@ namespace sw
 
 		static Cursor cursor;
 
-		void (*blitFunction)(void *dst, void *src, Cursor *cursor);
+		void (*blitFunction)(void *dst, void *src, Cursor *cursor, Rect *region);
 		Routine *blitRoutine;
 		BlitState blitState;     // State of the current blitRoutine.
 		BlitState updateState;   // State of the routine to be generated.
 
+		Rect damage;
+		bool damaged;
+		bool complete;   // Holds a full frame, so damaged regions can be copied on their own
+
 		static void blend(const BlitState &state, const Pointer<Byte> &d, const Pointer<Byte> &s, const Pointer<Byte> &c);
 
 		Thread *blitThread;
@@ -102,6 +132,13 @@ namespace sw
 		volatile bool terminate;
 
 		static bool topLeftOrigin;
+
+		static std::atomic<int> threadCount;
+		Thread *worker[MAX_COPY_THREADS];
+		Event *resume[MAX_COPY_THREADS];
+		Event *suspend[MAX_COPY_THREADS];
+		bool exitThreads;
+		Rect band[MAX_COPY_THREADS];
 	};
 }
 
@@ -145,15 +145,17 @@ namespace sw
 
 		if(!mit_shm)
 		{
-			libX11->XPutImage(x_display, x_window, x_gc, x_image, 0, 0, 0, 0, width, height);
+			// The pixels are copied into the request, so the image can be reused without a round trip
+			libX11->XPutImage(x_display, x_window, x_gc, x_image, copied.x0, copied.y0, copied.x0, copied.y0, copied.width(), copied.height());
+			libX11->XFlush(x_display);
 		}
 		else
 		{
-			libX11->XShmPutImage(x_display, x_window, x_gc, x_image, 0, 0, 0, 0, width, height, False);
+			// The server reads the shared segment, so it must be done before the next copy overwrites it
+			libX11->XShmPutImage(x_display, x_window, x_gc, x_image, copied.x0, copied.y0, copied.x0, copied.y0, copied.width(), copied.height(), False);
+			libX11->XSync(x_display, False);
 		}
 
-		libX11->XSync(x_display, False);
-
 		if(false)   // Draw the framerate on screen
 		{
 			static double fpsTime = sw::Timer::seconds();
@@ -37,6 +37,9 @@ namespace sw
 		void *lock() override;
 		void unlock() override;
 
+	protected:
+		bool preservesContents() const override { return true; }
+
 	private:
 		const bool ownX11;
 		Display *x_display;
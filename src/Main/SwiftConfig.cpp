@@ -15,12 +15,20 @@
 #include "SwiftConfig.hpp"
 
 #include "Config.hpp"
+#include "Renderer/LockStatistics.hpp"
+#include "Renderer/MemoryStatistics.hpp"
+#include "Renderer/PipelineStatistics.hpp"
+#include "Renderer/RoutineStatistics.hpp"
+#include "Renderer/Surface.hpp"
 #include "Common/Configurator.hpp"
+#include "Common/Resource.hpp"
 #include "Common/Debug.hpp"
 #include "Common/Version.h"
 
 #include <sstream>
+#include <vector>
 #include <stdio.h>
+#include <stdlib.h>
 #include <time.h>
 #include <sys/stat.h>
 #include <string.h>
@@ -44,6 +52,14 @@ namespace sw
 		return ss.str();
 	}
 
+	// Prefix of the routine category's optimization settings, generic routines have none
+	static const char *categoryName(int category)
+	{
+		static const char *const names[rr::RoutineCategoryCount] = {"", "Vertex", "Setup", "Pixel", "Blit", "FrameBuffer"};
+
+		return names[category];
+	}
+
 	SwiftConfig::SwiftConfig(bool disableServerOverride) : listenSocket(0)
 	{
 		readConfiguration(disableServerOverride);
@@ -172,7 +188,18 @@ namespace sw
 	{
 		if(match(&request, "GET /"))
 		{
-			if(match(&request, "swiftshader") || match(&request, "swiftconfig"))
+			if(match(&request, "metrics"))
+			{
+				if(match(&request, " "))
+				{
+					return send(clientSocket, OK, metrics(false), "text/plain; version=0.0.4; charset=UTF-8");
+				}
+				else if(match(&request, ".json "))
+				{
+					return send(clientSocket, OK, metrics(true), "application/json");
+				}
+			}
+			else if(match(&request, "swiftshader") || match(&request, "swiftconfig"))
 			{
 				if(match(&request, " ") || match(&request, "/ "))
 				{
@@ -334,8 +361,27 @@ namespace sw
 		html += "<option value='4096'" + (config.setupRoutineCacheSize == 4096 ? selected : empty) + ">4096</option>\n";
 		html += "</select></td>\n";
 		html += "</tr>\n";
+		html += "<tr><td>Routine memory:</td><td><select name='routineMemory' title='The amount of generated code up to which routine caches which keep regenerating evicted routines get enlarged.'>\n";
+		html += "<option value='0'"   + (config.routineMemory == 0   ? selected : empty) + ">Fixed cache sizes</option>\n";
+		html += "<option value='32'"  + (config.routineMemory == 32  ? selected : empty) + ">32 MB</option>\n";
+		html += "<option value='64'"  + (config.routineMemory == 64  ? selected : empty) + ">64 MB (default)</option>\n";
+		html += "<option value='128'" + (config.routineMemory == 128 ? selected : empty) + ">128 MB</option>\n";
+		html += "<option value='256'" + (config.routineMemory == 256 ? selected : empty) + ">256 MB</option>\n";
+		html += "</select></td>\n";
+		html += "</tr>\n";
+		html += "<tr><td>Dynamic sampler state:</td><td><select name='dynamicSamplerState' title='Sampler state which is read at run time instead of being compiled into routines. Dynamic state samples slightly slower but needs fewer routines when applications keep changing it.'>\n";
+		html += "<option value='0'" + (config.dynamicSamplerState == 0 ? selected : empty) + ">None (default)</option>\n";
+		html += "<option value='1'" + (config.dynamicSamplerState == 1 ? selected : empty) + ">Swizzles</option>\n";
+		html += "<option value='2'" + (config.dynamicSamplerState == 2 ? selected : empty) + ">Depth comparisons</option>\n";
+		html += "<option value='3'" + (config.dynamicSamplerState == 3 ? selected : empty) + ">Swizzles and depth comparisons</option>\n";
+		html += "</select></td>\n";
+		html += "</tr>\n";
 		html += "<tr><td>Vertex cache size:</td><td><select name='vertexCacheSize' title='The number of processed vertices being cached for reuse. Lower numbers save memory but require more vertices to be reprocessed.'>\n";
 		html += "<option value='64'"   + (config.vertexCacheSize == 64   ? selected : empty) + ">64 (default)</option>\n";
+		html += "<option value='128'"  + (config.vertexCacheSize == 128  ? selected : empty) + ">128</option>\n";
+		html += "<option value='256'"  + (config.vertexCacheSize == 256  ? selected : empty) + ">256</option>\n";
+		html += "<option value='512'"  + (config.vertexCacheSize == 512  ? selected : empty) + ">512</option>\n";
+		html += "<option value='1024'" + (config.vertexCacheSize == 1024 ? selected : empty) + ">1024</option>\n";
 		html += "</select></td>\n";
 		html += "</tr>\n";
 		html += "</table>\n";
@@ -352,6 +398,11 @@ namespace sw
 		html += "<option value='1'" + (config.mipmapQuality == 1 ? selected : empty) + ">Linear (default)</option>\n";
 		html += "</select></td>\n";
 		html += "</tr>\n";
+		html += "<tr><td>Adaptive anisotropic filtering:</td><td><select name='adaptiveAnisotropy' title='Stops taking anisotropic filtering samples when the ends of the footprint are nearly equal. Enabling it is faster but can lose fine detail.'>\n";
+		html += "<option value='0'" + (config.adaptiveAnisotropy == 0 ? selected : empty) + ">Off (default)</option>\n";
+		html += "<option value='1'" + (config.adaptiveAnisotropy == 1 ? selected : empty) + ">On</option>\n";
+		html += "</select></td>\n";
+		html += "</tr>\n";
 		html += "<tr><td>Perspective correction:</td><td><select name='perspectiveCorrection' title='Enables or disables perspective correction. Disabling it is faster but can causes distortion. Recommended for 2D applications only.'>\n";
 		html += "<option value='0'" + (config.perspectiveCorrection == 0 ? selected : empty) + ">Off</option>\n";
 		html += "<option value='1'" + (config.perspectiveCorrection == 1 ? selected : empty) + ">On (default)</option>\n";
@@ -365,6 +416,11 @@ namespace sw
 		html += "<option value='4'" + (config.transcendentalPrecision == 4 ? selected : empty) + ">IEEE</option>\n";
 		html += "</select></td>\n";
 		html += "</tr>\n";
+		html += "<tr><td>Medium precision math:</td><td><select name='mediumPrecisionMath' title='Computes the transcendental functions of shader instructions with medium precision at partial precision. Enabling it is faster, and still within the precision required for mediump.'>\n";
+		html += "<option value='0'" + (config.mediumPrecisionMath == 0 ? selected : empty) + ">Off (default)</option>\n";
+		html += "<option value='1'" + (config.mediumPrecisionMath == 1 ? selected : empty) + ">On</option>\n";
+		html += "</select></td>\n";
+		html += "</tr>\n";
 		html += "<tr><td>Transparency anti-aliasing:</td><td><select name='transparencyAntialiasing' title='The technique used to anti-alias alpha-tested transparent textures.'>\n";
 		html += "<option value='0'" + (config.transparencyAntialiasing == 0 ? selected : empty) + ">None (default)</option>\n";
 		html += "<option value='1'" + (config.transparencyAntialiasing == 1 ? selected : empty) + ">Alpha-to-Coverage</option>\n";
@@ -397,6 +453,11 @@ namespace sw
 		html += "<tr><td>Enable SSE3:</td><td><input name = 'enableSSE3' type='checkbox'" + (config.enableSSE3 ? checked : empty) + " title='If checked enables the use of SSE3 instruction set extentions if supported by the CPU.'></td></tr>";
 		html += "<tr><td>Enable SSSE3:</td><td><input name = 'enableSSSE3' type='checkbox'" + (config.enableSSSE3 ? checked : empty) + " title='If checked enables the use of SSSE3 instruction set extentions if supported by the CPU.'></td></tr>";
 		html += "<tr><td>Enable SSE4.1:</td><td><input name = 'enableSSE4_1' type='checkbox'" + (config.enableSSE4_1 ? checked : empty) + " title='If checked enables the use of SSE4.1 instruction set extentions if supported by the CPU.'></td></tr>";
+		html += "<tr><td>Enable AVX:</td><td><input name = 'enableAVX' type='checkbox'" + (config.enableAVX ? checked : empty) + " title='If checked enables the use of AVX instruction set extentions if supported by the CPU and OS.'></td></tr>";
+		html += "<tr><td>Enable AVX2:</td><td><input name = 'enableAVX2' type='checkbox'" + (config.enableAVX2 ? checked : empty) + " title='If checked enables the use of AVX2 instruction set extentions if supported by the CPU and OS.'></td></tr>";
+		html += "<tr><td>Enable FMA:</td><td><input name = 'enableFMA' type='checkbox'" + (config.enableFMA ? checked : empty) + " title='If checked enables the use of fused multiply-add instructions if supported by the CPU and OS.'></td></tr>";
+		html += "<tr><td>Enable F16C:</td><td><input name = 'enableF16C' type='checkbox'" + (config.enableF16C ? checked : empty) + " title='If checked enables the use of half-precision conversion instructions if supported by the CPU and OS.'></td></tr>";
+		html += "<tr><td>Enable AVX-512:</td><td><input name = 'enableAVX512' type='checkbox'" + (config.enableAVX512 ? checked : empty) + " title='If checked enables the use of AVX-512 Foundation instructions if supported by the CPU and OS.'></td></tr>";
 		html += "</table>\n";
 		html += "<h2><em>Compiler optimizations</em></h2>\n";
 		html += "<table>\n";
@@ -511,7 +572,144 @@ namespace sw
 		return html;
 	}
 
-	void SwiftConfig::send(Socket *clientSocket, Status code, std::string body)
+	// Live counters in the Prometheus text exposition format, or as a JSON array.
+	// Per-thread pipeline counters only advance while Processor/PipelineStatistics is enabled.
+	std::string SwiftConfig::metrics(bool json)
+	{
+		struct Metric
+		{
+			const char *name;
+			const char *type;
+			const char *help;
+			std::string labels;   // Comma-separated name="value" pairs
+			double value;
+		};
+
+		std::vector<Metric> metrics;
+
+		SwiftShaderPipelineStatistics pipeline;
+		swiftshaderGetPipelineStatistics(&pipeline);
+
+		SwiftShaderRoutineStatistics routines;
+		swiftshaderGetRoutineStatistics(&routines);
+
+		metrics.push_back({"swiftshader_draws_total", "counter", "Draw calls submitted.", "", (double)pipeline.draws});
+		metrics.push_back({"swiftshader_frames_per_second", "gauge", "Frames presented per second.", "", (double)profiler.FPS});
+
+		double primitives = 0.0;
+		double pixels = 0.0;
+
+		for(int thread = 0; thread < MAX_THREAD_COUNT; thread++)
+		{
+			const SwiftShaderThreadStatistics &t = pipeline.thread[thread];
+
+			if(t.primitiveTasks == 0 && t.pixelTasks == 0)
+			{
+				continue;   // Thread never ran any task
+			}
+
+			std::string label = "thread=\"" + itoa(thread) + "\"";
+
+			metrics.push_back({"swiftshader_thread_busy_seconds_total", "counter", "Time each worker thread spent per pipeline stage.", label + ",stage=\"vertex\"", t.vertexMicroseconds * 1.0e-6});
+			metrics.push_back({"swiftshader_thread_busy_seconds_total", "counter", "Time each worker thread spent per pipeline stage.", label + ",stage=\"setup\"", t.setupMicroseconds * 1.0e-6});
+			metrics.push_back({"swiftshader_thread_busy_seconds_total", "counter", "Time each worker thread spent per pipeline stage.", label + ",stage=\"pixel\"", t.pixelMicroseconds * 1.0e-6});
+
+			primitives += (double)t.primitives;
+			pixels += (double)t.pixels;
+		}
+
+		metrics.push_back({"swiftshader_primitives_total", "counter", "Primitives entering the pipeline.", "", primitives});
+		metrics.push_back({"swiftshader_pixels_total", "counter", "Samples passing the depth and stencil tests.", "", pixels});
+
+		const char *cacheHelp = "Routine cache lookups.";
+		metrics.push_back({"swiftshader_routine_cache_lookups_total", "counter", cacheHelp, "cache=\"vertex\",result=\"hit\"", (double)routines.vertexCacheHits});
+		metrics.push_back({"swiftshader_routine_cache_lookups_total", "counter", cacheHelp, "cache=\"vertex\",result=\"miss\"", (double)routines.vertexCacheMisses});
+		metrics.push_back({"swiftshader_routine_cache_lookups_total", "counter", cacheHelp, "cache=\"setup\",result=\"hit\"", (double)routines.setupCacheHits});
+		metrics.push_back({"swiftshader_routine_cache_lookups_total", "counter", cacheHelp, "cache=\"setup\",result=\"miss\"", (double)routines.setupCacheMisses});
+		metrics.push_back({"swiftshader_routine_cache_lookups_total", "counter", cacheHelp, "cache=\"pixel\",result=\"hit\"", (double)routines.pixelCacheHits});
+		metrics.push_back({"swiftshader_routine_cache_lookups_total", "counter", cacheHelp, "cache=\"pixel\",result=\"miss\"", (double)routines.pixelCacheMisses});
+		metrics.push_back({"swiftshader_routine_cache_lookups_total", "counter", cacheHelp, "cache=\"blit\",result=\"hit\"", (double)routines.blitCacheHits});
+		metrics.push_back({"swiftshader_routine_cache_lookups_total", "counter", cacheHelp, "cache=\"blit\",result=\"miss\"", (double)routines.blitCacheMisses});
+
+		metrics.push_back({"swiftshader_jit_routines_total", "counter", "Routines compiled.", "", (double)routines.routines});
+		metrics.push_back({"swiftshader_jit_seconds_total", "counter", "Time spent compiling routines.", "", routines.compileMicroseconds * 1.0e-6});
+		metrics.push_back({"swiftshader_jit_shared_routines_total", "counter", "Compiled routines sharing the machine code of an identical one.", "", (double)routines.sharedRoutines});
+		SwiftShaderMemoryStatistics memory;
+		swiftshaderGetMemoryStatistics(&memory);
+
+		const char *memoryHelp = "Memory currently allocated.";
+		metrics.push_back({"swiftshader_memory_bytes", "gauge", memoryHelp, "kind=\"surface\"", (double)memory.surfaceBytes});
+		metrics.push_back({"swiftshader_memory_bytes", "gauge", memoryHelp, "kind=\"resource\"", (double)memory.resourceBytes});
+		metrics.push_back({"swiftshader_memory_bytes", "gauge", memoryHelp, "kind=\"draw\"", (double)memory.drawBytes});
+		metrics.push_back({"swiftshader_memory_bytes", "gauge", memoryHelp, "kind=\"routine\"", (double)memory.routineBytes});
+		metrics.push_back({"swiftshader_memory_bytes", "gauge", memoryHelp, "kind=\"other\"", (double)memory.otherBytes});
+		metrics.push_back({"swiftshader_surface_memory_budget_bytes", "gauge", "Limit above which idle surface copies get evicted.", "", (double)memory.surfaceBudget});
+		metrics.push_back({"swiftshader_surface_evictions_total", "counter", "Idle internal surface copies released.", "", (double)memory.evictions});
+		metrics.push_back({"swiftshader_resource_lock_wait_seconds_total", "counter", "Time spent blocked on resource locks.", "", Resource::lockWaitSeconds()});
+
+		std::vector<SwiftShaderLockStatistics> locks(swiftshaderGetLockStatistics(nullptr, 0));
+		locks.resize(swiftshaderGetLockStatistics(locks.data(), (int)locks.size()));
+
+		for(const SwiftShaderLockStatistics &lock : locks)
+		{
+			std::string label = "lock=\"" + std::string(lock.name) + "\"";
+			metrics.push_back({"swiftshader_lock_acquisitions_total", "counter", "Acquisitions of named mutexes.", label, (double)lock.acquisitions});
+		}
+
+		for(const SwiftShaderLockStatistics &lock : locks)
+		{
+			std::string label = "lock=\"" + std::string(lock.name) + "\"";
+			metrics.push_back({"swiftshader_lock_contended_acquisitions_total", "counter", "Acquisitions of named mutexes which had to wait.", label, (double)lock.contendedAcquisitions});
+		}
+
+		for(const SwiftShaderLockStatistics &lock : locks)
+		{
+			std::string label = "lock=\"" + std::string(lock.name) + "\"";
+			metrics.push_back({"swiftshader_lock_wait_seconds_total", "counter", "Time spent waiting for named mutexes.", label, lock.waitNanoseconds * 1.0e-9});
+		}
+
+		std::string text = json ? "[\n" : "";
+
+		for(size_t i = 0; i < metrics.size(); i++)
+		{
+			const Metric &metric = metrics[i];
+
+			if(json)
+			{
+				std::string labels = metric.labels;
+				std::replace(labels.begin(), labels.end(), '=', ':');
+
+				text += "{\"name\":\"" + std::string(metric.name) + "\",\"labels\":{" + labels + "},\"value\":" + ftoa(metric.value) + "}";
+				text += (i + 1 < metrics.size()) ? ",\n" : "\n";
+			}
+			else
+			{
+				if(i == 0 || strcmp(metrics[i - 1].name, metric.name) != 0)
+				{
+					text += "# HELP " + std::string(metric.name) + " " + metric.help + "\n";
+					text += "# TYPE " + std::string(metric.name) + " " + metric.type + "\n";
+				}
+
+				text += metric.name;
+
+				if(!metric.labels.empty())
+				{
+					text += "{" + metric.labels + "}";
+				}
+
+				text += " " + ftoa(metric.value) + "\n";
+			}
+		}
+
+		if(json)
+		{
+			text += "]\n";
+		}
+
+		return text;
+	}
+
+	void SwiftConfig::send(Socket *clientSocket, Status code, std::string body, const char *contentType)
 	{
 		std::string status;
 		char header[1024];
@@ -522,10 +720,10 @@ namespace sw
 		case NotFound: status += "HTTP/1.1 404 Not Found\r\n"; break;
 		}
 
-		sprintf(header, "Content-Type: text/html; charset=UTF-8\r\n"
+		sprintf(header, "Content-Type: %s\r\n"
 						"Content-Length: %zd\r\n"
 						"Host: localhost\r\n"
-						"\r\n", body.size());
+						"\r\n", contentType, body.size());
 
 		std::string message = status + header + body;
 		clientSocket->send(message.c_str(), (int)message.length());
@@ -539,6 +737,11 @@ namespace sw
 		config.enableSSE3 = false;
 		config.enableSSSE3 = false;
 		config.enableSSE4_1 = false;
+		config.enableAVX = false;
+		config.enableAVX2 = false;
+		config.enableFMA = false;
+		config.enableF16C = false;
+		config.enableAVX512 = false;
 		config.disableServer = false;
 		config.forceWindowed = false;
 		config.complementaryDepthBuffer = false;
@@ -582,6 +785,14 @@ namespace sw
 			{
 				config.setupRoutineCacheSize = integer;
 			}
+			else if(sscanf(post, "routineMemory=%d", &integer))
+			{
+				config.routineMemory = integer;
+			}
+			else if(sscanf(post, "dynamicSamplerState=%d", &integer))
+			{
+				config.dynamicSamplerState = integer;
+			}
 			else if(sscanf(post, "vertexCacheSize=%d", &integer))
 			{
 				config.vertexCacheSize = integer;
@@ -594,6 +805,10 @@ namespace sw
 			{
 				config.mipmapQuality = integer;
 			}
+			else if(sscanf(post, "adaptiveAnisotropy=%d", &integer))
+			{
+				config.adaptiveAnisotropy = integer != 0;
+			}
 			else if(sscanf(post, "perspectiveCorrection=%d", &integer))
 			{
 				config.perspectiveCorrection = integer != 0;
@@ -602,6 +817,10 @@ namespace sw
 			{
 				config.transcendentalPrecision = integer;
 			}
+			else if(sscanf(post, "mediumPrecisionMath=%d", &integer))
+			{
+				config.mediumPrecisionMath = integer != 0;
+			}
 			else if(sscanf(post, "transparencyAntialiasing=%d", &integer))
 			{
 				config.transparencyAntialiasing = integer;
@@ -650,6 +869,41 @@ namespace sw
 					config.enableSSE4_1 = true;
 				}
 			}
+			else if(strstr(post, "enableAVX=on"))
+			{
+				if(config.enableSSE4_1)
+				{
+					config.enableAVX = true;
+				}
+			}
+			else if(strstr(post, "enableAVX2=on"))
+			{
+				if(config.enableAVX)
+				{
+					config.enableAVX2 = true;
+				}
+			}
+			else if(strstr(post, "enableFMA=on"))
+			{
+				if(config.enableAVX)
+				{
+					config.enableFMA = true;
+				}
+			}
+			else if(strstr(post, "enableF16C=on"))
+			{
+				if(config.enableAVX)
+				{
+					config.enableF16C = true;
+				}
+			}
+			else if(strstr(post, "enableAVX512=on"))
+			{
+				if(config.enableAVX2 && config.enableFMA)
+				{
+					config.enableAVX512 = true;
+				}
+			}
 			else if(sscanf(post, "optimization%d=%d", &index, &integer))
 			{
 				config.optimization[index - 1] = (rr::Optimization)integer;
@@ -724,24 +978,89 @@ namespace sw
 		config.vertexRoutineCacheSize = ini.getInteger("Caches", "VertexRoutineCacheSize", 1024);
 		config.pixelRoutineCacheSize = ini.getInteger("Caches", "PixelRoutineCacheSize", 1024);
 		config.setupRoutineCacheSize = ini.getInteger("Caches", "SetupRoutineCacheSize", 1024);
+		config.routineMemory = ini.getInteger("Caches", "RoutineMemory", 64);
+		config.dynamicSamplerState = ini.getInteger("Caches", "DynamicSamplerState", 0);
+		config.asynchronousCompilation = ini.getBoolean("Caches", "AsynchronousCompilation", true);
+		config.hotRoutineThreshold = ini.getInteger("Caches", "HotRoutineThreshold", 0);
+		config.uniformSpecializationThreshold = ini.getInteger("Caches", "UniformSpecializationThreshold", 0);
+		config.statisticsLogInterval = ini.getInteger("Caches", "StatisticsLogInterval", 0);
 		config.vertexCacheSize = ini.getInteger("Caches", "VertexCacheSize", 64);
 		config.textureSampleQuality = ini.getInteger("Quality", "TextureSampleQuality", 2);
 		config.mipmapQuality = ini.getInteger("Quality", "MipmapQuality", 1);
+		config.adaptiveAnisotropy = ini.getBoolean("Quality", "AdaptiveAnisotropy", false);
 		config.perspectiveCorrection = ini.getBoolean("Quality", "PerspectiveCorrection", true);
 		config.transcendentalPrecision = ini.getInteger("Quality", "TranscendentalPrecision", 2);
+		config.mediumPrecisionMath = ini.getBoolean("Quality", "MediumPrecisionMath", false);
 		config.transparencyAntialiasing = ini.getInteger("Quality", "TransparencyAntialiasing", 0);
 		config.threadCount = ini.getInteger("Processor", "ThreadCount", DEFAULT_THREAD_COUNT);
+
+		// Lets benchmarks and test harnesses pick the thread count without writing an ini file
+		const char *threadCount = getenv("SWIFTSHADER_THREAD_COUNT");
+
+		if(threadCount)
+		{
+			config.threadCount = atoi(threadCount);
+		}
+
+		config.drawCallQueueSize = ini.getInteger("Processor", "DrawCallQueueSize", 64);
+		config.drawCallMerging = ini.getBoolean("Processor", "DrawCallMerging", true);
+		config.threadSpinCount = ini.getInteger("Processor", "ThreadSpinCount", 16384);
+		config.minThreadCount = ini.getInteger("Processor", "MinThreadCount", 1);
+		config.pixelClustersPerThread = ini.getInteger("Processor", "PixelClustersPerThread", 2);
+		config.inlineDrawPixels = ini.getInteger("Processor", "InlineDrawPixels", 4096);
+		config.threadAffinity = ini.getInteger("Processor", "ThreadAffinity", 0);
+		config.reservedCores = ini.getInteger("Processor", "ReservedCores", 0);
+		config.threadNumaNode = ini.getInteger("Processor", "ThreadNumaNode", -1);
+		config.pipelineStatistics = ini.getBoolean("Processor", "PipelineStatistics", false);
+		config.tiledRasterization = ini.getBoolean("Processor", "TiledRasterization", false);
+		config.coarseDepthCulling = ini.getBoolean("Processor", "CoarseDepthCulling", true);
+		config.compressedTextureSampling = ini.getBoolean("Processor", "CompressedTextureSampling", false);
+		config.tiledTextureLayout = ini.getBoolean("Processor", "TiledTextureLayout", false);
+		config.linearSRGBTextures = ini.getBoolean("Processor", "LinearSRGBTextures", false);
+		config.guardBandClipping = ini.getBoolean("Processor", "GuardBandClipping", false);
 		config.enableSSE = ini.getBoolean("Processor", "EnableSSE", true);
 		config.enableSSE2 = ini.getBoolean("Processor", "EnableSSE2", true);
 		config.enableSSE3 = ini.getBoolean("Processor", "EnableSSE3", true);
 		config.enableSSSE3 = ini.getBoolean("Processor", "EnableSSSE3", true);
 		config.enableSSE4_1 = ini.getBoolean("Processor", "EnableSSE4_1", true);
+		config.enableAVX = ini.getBoolean("Processor", "EnableAVX", true);
+		config.enableAVX2 = ini.getBoolean("Processor", "EnableAVX2", true);
+		config.enableFMA = ini.getBoolean("Processor", "EnableFMA", true);
+		config.enableF16C = ini.getBoolean("Processor", "EnableF16C", true);
+		config.enableAVX512 = ini.getBoolean("Processor", "EnableAVX512", false);   // Routines don't use 512-bit vectors
 
 		for(int pass = 0; pass < 10; pass++)
 		{
 			config.optimization[pass] = (rr::Optimization)ini.getInteger("Optimization", "OptimizationPass" + itoa(pass + 1), pass == 0 ? rr::InstructionCombining : rr::Disabled);
 		}
 
+		// Setup routines only get the scalar replacement which always runs, pixel routines more than the default
+		static const rr::Optimization setupPasses[10] = {rr::Disabled};
+		static const rr::Optimization pixelPasses[10] = {rr::InstructionCombining, rr::CFGSimplification, rr::LICM, rr::DeadStoreElimination, rr::Disabled};
+		const rr::Optimization *categoryDefaults[rr::RoutineCategoryCount] = {nullptr, nullptr, setupPasses, pixelPasses, nullptr, nullptr};
+
+		for(int category = 0; category < rr::RoutineCategoryCount; category++)
+		{
+			// E.g. PixelPass1=5 selects the first pass of pixel routines, PixelPass1=-1 makes them use the OptimizationPass list
+			std::string prefix = categoryName(category);
+			int first = prefix.empty() ? -1 : ini.getInteger("Optimization", prefix + "Pass1", -2);
+			const rr::Optimization *defaults = (first == -2) ? categoryDefaults[category] : nullptr;
+
+			config.categoryOptimized[category] = defaults || first >= 0;
+
+			for(int pass = 0; pass < 10; pass++)
+			{
+				int value = defaults ? defaults[pass] : rr::Disabled;
+
+				if(!defaults && first >= 0)
+				{
+					value = ini.getInteger("Optimization", prefix + "Pass" + itoa(pass + 1), rr::Disabled);
+				}
+
+				config.categoryOptimization[category][pass] = (rr::Optimization)value;
+			}
+		}
+
 		config.disableServer = ini.getBoolean("Testing", "DisableServer", false);
 		config.forceWindowed = ini.getBoolean("Testing", "ForceWindowed", false);
 		config.complementaryDepthBuffer = ini.getBoolean("Testing", "ComplementaryDepthBuffer", false);
@@ -782,24 +1101,69 @@ namespace sw
 		ini.addValue("Caches", "VertexRoutineCacheSize", itoa(config.vertexRoutineCacheSize));
 		ini.addValue("Caches", "PixelRoutineCacheSize", itoa(config.pixelRoutineCacheSize));
 		ini.addValue("Caches", "SetupRoutineCacheSize", itoa(config.setupRoutineCacheSize));
+		ini.addValue("Caches", "RoutineMemory", itoa(config.routineMemory));
+		ini.addValue("Caches", "DynamicSamplerState", itoa(config.dynamicSamplerState));
+		ini.addValue("Caches", "AsynchronousCompilation", itoa(config.asynchronousCompilation));
+		ini.addValue("Caches", "HotRoutineThreshold", itoa(config.hotRoutineThreshold));
+		ini.addValue("Caches", "UniformSpecializationThreshold", itoa(config.uniformSpecializationThreshold));
+		ini.addValue("Caches", "StatisticsLogInterval", itoa(config.statisticsLogInterval));
 		ini.addValue("Caches", "VertexCacheSize", itoa(config.vertexCacheSize));
 		ini.addValue("Quality", "TextureSampleQuality", itoa(config.textureSampleQuality));
 		ini.addValue("Quality", "MipmapQuality", itoa(config.mipmapQuality));
+		ini.addValue("Quality", "AdaptiveAnisotropy", itoa(config.adaptiveAnisotropy));
 		ini.addValue("Quality", "PerspectiveCorrection", itoa(config.perspectiveCorrection));
 		ini.addValue("Quality", "TranscendentalPrecision", itoa(config.transcendentalPrecision));
+		ini.addValue("Quality", "MediumPrecisionMath", itoa(config.mediumPrecisionMath));
 		ini.addValue("Quality", "TransparencyAntialiasing", itoa(config.transparencyAntialiasing));
 		ini.addValue("Processor", "ThreadCount", itoa(config.threadCount));
+		ini.addValue("Processor", "DrawCallQueueSize", itoa(config.drawCallQueueSize));
+		ini.addValue("Processor", "DrawCallMerging", itoa(config.drawCallMerging));
+		ini.addValue("Processor", "ThreadSpinCount", itoa(config.threadSpinCount));
+		ini.addValue("Processor", "MinThreadCount", itoa(config.minThreadCount));
+		ini.addValue("Processor", "PixelClustersPerThread", itoa(config.pixelClustersPerThread));
+		ini.addValue("Processor", "InlineDrawPixels", itoa(config.inlineDrawPixels));
+		ini.addValue("Processor", "ThreadAffinity", itoa(config.threadAffinity));
+		ini.addValue("Processor", "ReservedCores", itoa(config.reservedCores));
+		ini.addValue("Processor", "ThreadNumaNode", itoa(config.threadNumaNode));
+		ini.addValue("Processor", "PipelineStatistics", itoa(config.pipelineStatistics));
+		ini.addValue("Processor", "TiledRasterization", itoa(config.tiledRasterization));
+		ini.addValue("Processor", "CoarseDepthCulling", itoa(config.coarseDepthCulling));
+		ini.addValue("Processor", "CompressedTextureSampling", itoa(config.compressedTextureSampling));
+		ini.addValue("Processor", "TiledTextureLayout", itoa(config.tiledTextureLayout));
+		ini.addValue("Processor", "LinearSRGBTextures", itoa(config.linearSRGBTextures));
+		ini.addValue("Processor", "GuardBandClipping", itoa(config.guardBandClipping));
 	//	ini.addValue("Processor", "EnableSSE", itoa(config.enableSSE));
 		ini.addValue("Processor", "EnableSSE2", itoa(config.enableSSE2));
 		ini.addValue("Processor", "EnableSSE3", itoa(config.enableSSE3));
 		ini.addValue("Processor", "EnableSSSE3", itoa(config.enableSSSE3));
 		ini.addValue("Processor", "EnableSSE4_1", itoa(config.enableSSE4_1));
+		ini.addValue("Processor", "EnableAVX", itoa(config.enableAVX));
+		ini.addValue("Processor", "EnableAVX2", itoa(config.enableAVX2));
+		ini.addValue("Processor", "EnableFMA", itoa(config.enableFMA));
+		ini.addValue("Processor", "EnableF16C", itoa(config.enableF16C));
+		ini.addValue("Processor", "EnableAVX512", itoa(config.enableAVX512));
 
 		for(int pass = 0; pass < 10; pass++)
 		{
 			ini.addValue("Optimization", "OptimizationPass" + itoa(pass + 1), itoa(config.optimization[pass]));
 		}
 
+		for(int category = rr::RoutineVertex; category < rr::RoutineCategoryCount; category++)
+		{
+			std::string prefix = categoryName(category);
+
+			if(!config.categoryOptimized[category])
+			{
+				ini.addValue("Optimization", prefix + "Pass1", "-1");
+				continue;
+			}
+
+			for(int pass = 0; pass < 10; pass++)
+			{
+				ini.addValue("Optimization", prefix + "Pass" + itoa(pass + 1), itoa(config.categoryOptimization[category][pass]));
+			}
+		}
+
 		ini.addValue("Testing", "DisableServer", itoa(config.disableServer));
 		ini.addValue("Testing", "ForceWindowed", itoa(config.forceWindowed));
 		ini.addValue("Testing", "ComplementaryDepthBuffer", itoa(config.complementaryDepthBuffer));
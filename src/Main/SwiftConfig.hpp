@@ -37,18 +37,49 @@ namespace sw
 			int vertexRoutineCacheSize;
 			int pixelRoutineCacheSize;
 			int setupRoutineCacheSize;
+			int routineMemory;   // Megabytes of routine code up to which thrashing routine caches grow
+			int dynamicSamplerState;   // DynamicSamplerState flags of sampler state read at run time instead of compiled in
+			bool asynchronousCompilation;
+			int hotRoutineThreshold;
+			int uniformSpecializationThreshold;   // Draws with the same branch uniforms after which they get folded into routines, 0 disables it
+			int statisticsLogInterval;
 			int vertexCacheSize;
 			int textureSampleQuality;
 			int mipmapQuality;
+			bool adaptiveAnisotropy;
 			bool perspectiveCorrection;
 			int transcendentalPrecision;
+			bool mediumPrecisionMath;   // GLSL mediump instructions use the partial precision code paths
 			int threadCount;
+			int drawCallQueueSize;
+			bool drawCallMerging;
+			int threadSpinCount;
+			int minThreadCount;   // Workers kept active when fewer suffice for the load, 0 always uses all of them
+			int pixelClustersPerThread;   // Interleaved groups of rows dividing the pixel work, per worker thread
+			int inlineDrawPixels;   // Scissor area up to which small draws are executed by the application thread
+			int threadAffinity;
+			int reservedCores;
+			int threadNumaNode;
+			bool pipelineStatistics;
+			bool tiledRasterization;
+			bool coarseDepthCulling;
+			bool compressedTextureSampling;
+			bool tiledTextureLayout;
+			bool linearSRGBTextures;
+			bool guardBandClipping;
 			bool enableSSE;
 			bool enableSSE2;
 			bool enableSSE3;
 			bool enableSSSE3;
 			bool enableSSE4_1;
+			bool enableAVX;
+			bool enableAVX2;
+			bool enableFMA;
+			bool enableF16C;
+			bool enableAVX512;
 			rr::Optimization optimization[10];
+			rr::Optimization categoryOptimization[rr::RoutineCategoryCount][10];
+			bool categoryOptimized[rr::RoutineCategoryCount];   // Uses its own passes instead of 'optimization'
 			bool disableServer;
 			bool keepSystemCursor;
 			bool forceWindowed;
@@ -91,7 +122,8 @@ namespace sw
 		void respond(Socket *clientSocket, const char *request);
 		std::string page();
 		std::string profile();
-		void send(Socket *clientSocket, Status code, std::string body = "");
+		std::string metrics(bool json);
+		void send(Socket *clientSocket, Status code, std::string body = "", const char *contentType = "text/html; charset=UTF-8");
 		void parsePost(const char *post);
 
 		void readConfiguration(bool disableServerOverride = false);
@@ -32,6 +32,7 @@ LibX11exports::LibX11exports(void *libX11, void *libXext)
 	XDefaultVisual = (Visual *(*)(Display*, int screen_number))getProcAddress(libX11, "XDefaultVisual");
 	XSetErrorHandler = (int (*(*)(int (*)(Display*, XErrorEvent*)))(Display*, XErrorEvent*))getProcAddress(libX11, "XSetErrorHandler");
 	XSync = (int (*)(Display*, Bool))getProcAddress(libX11, "XSync");
+	XFlush = (int (*)(Display*))getProcAddress(libX11, "XFlush");
 	XCreateImage = (XImage *(*)(Display*, Visual*, unsigned int, int, int, char*, unsigned int, unsigned int, int, int))getProcAddress(libX11, "XCreateImage");
 	XCloseDisplay = (int (*)(Display*))getProcAddress(libX11, "XCloseDisplay");
 	XPutImage = (int (*)(Display*, Drawable, GC, XImage*, int, int, int, int, unsigned int, unsigned int))getProcAddress(libX11, "XPutImage");
@@ -16,6 +16,7 @@
 
 #include "../libEGL/Texture.hpp"
 #include "../common/debug.h"
+#include "Common/CPUID.hpp"
 #include "Common/Math.hpp"
 #include "Common/Thread.hpp"
 
@@ -24,11 +25,26 @@
 #include <string.h>
 #include <algorithm>
 
+#if defined(__linux__) && !defined(__ANDROID__)
+#include <sys/mman.h>
+#endif
+
 #if defined(__APPLE__)
 #include <CoreFoundation/CoreFoundation.h>
 #include <IOSurface/IOSurface.h>
 #endif
 
+#if defined(__i386__) || defined(__x86_64__)
+	#include <emmintrin.h>
+	#include <tmmintrin.h>
+
+	#if defined(_MSC_VER)
+		#define SSSE3_FUNCTION
+	#else
+		#define SSSE3_FUNCTION __attribute__((target("ssse3")))
+	#endif
+#endif
+
 namespace gl
 {
 	bool IsUnsizedInternalFormat(GLint internalformat)
@@ -676,12 +692,74 @@ namespace egl
 		memcpy(dest, source, width * bytes);
 	}
 
+	#if defined(__i386__) || defined(__x86_64__)
+		// Four pixels per shuffle. Returns the number of pixels converted, as the last
+		// ones are left to the caller to not read past the end of the row.
+		SSSE3_FUNCTION static int RGB8toRGBX8SSSE3(unsigned char *dest, const unsigned char *source, GLsizei width)
+		{
+			const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+			const __m128i alpha = _mm_set1_epi32(0xFF000000);
+			int x = 0;
+
+			for(; 3 * x + 16 <= 3 * width; x += 4)
+			{
+				__m128i rgb = _mm_loadu_si128((const __m128i*)(source + 3 * x));
+				_mm_storeu_si128((__m128i*)(dest + 4 * x), _mm_or_si128(_mm_shuffle_epi8(rgb, shuffle), alpha));
+			}
+
+			return x;
+		}
+
+		// Replicates each nibble of eight RGBA4 pixels into the byte it expands to
+		static inline void RGBA4toRGBA8SSE2(unsigned char *dest, __m128i rgba)
+		{
+			__m128i high = _mm_and_si128(_mm_srli_epi16(rgba, 4), _mm_set1_epi16(0x0F0F));   // B, R
+			__m128i low = _mm_and_si128(rgba, _mm_set1_epi16(0x0F0F));                       // A, G
+			high = _mm_or_si128(high, _mm_slli_epi16(high, 4));
+			low = _mm_or_si128(low, _mm_slli_epi16(low, 4));
+
+			// Interleaving gives B, A, R, G, which rotating the halves of each pixel puts in order
+			__m128i bargLow = _mm_unpacklo_epi8(high, low);
+			__m128i bargHigh = _mm_unpackhi_epi8(high, low);
+			__m128i rgbaLow = _mm_shufflehi_epi16(_mm_shufflelo_epi16(bargLow, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+			__m128i rgbaHigh = _mm_shufflehi_epi16(_mm_shufflelo_epi16(bargHigh, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+
+			_mm_storeu_si128((__m128i*)dest, rgbaLow);
+			_mm_storeu_si128((__m128i*)(dest + 16), rgbaHigh);
+		}
+
+		static inline void RGBA5_A1toRGBA8SSE2(unsigned char *dest, __m128i rgba)
+		{
+			const __m128i mask5 = _mm_set1_epi16(0x00F8);
+			const __m128i mask3 = _mm_set1_epi16(0x0007);
+
+			__m128i r = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(rgba, 8), mask5), _mm_srli_epi16(rgba, 13));
+			__m128i g = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(rgba, 3), mask5), _mm_and_si128(_mm_srli_epi16(rgba, 8), mask3));
+			__m128i b = _mm_or_si128(_mm_and_si128(_mm_slli_epi16(rgba, 2), mask5), _mm_and_si128(_mm_srli_epi16(rgba, 3), mask3));
+			__m128i a = _mm_sub_epi16(_mm_setzero_si128(), _mm_and_si128(rgba, _mm_set1_epi16(0x0001)));   // 0xFFFF or 0
+
+			__m128i rg = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+			__m128i ba = _mm_or_si128(b, _mm_slli_epi16(a, 8));
+
+			_mm_storeu_si128((__m128i*)dest, _mm_unpacklo_epi16(rg, ba));
+			_mm_storeu_si128((__m128i*)(dest + 16), _mm_unpackhi_epi16(rg, ba));
+		}
+	#endif
+
 	template<>
 	void TransferRow<RGB8toRGBX8>(unsigned char *dest, const unsigned char *source, GLsizei width, GLsizei bytes)
 	{
 		unsigned char *destB = dest;
+		int x = 0;
 
-		for(int x = 0; x < width; x++)
+		#if defined(__i386__) || defined(__x86_64__)
+			if(sw::CPUID::supportsSSSE3())
+			{
+				x = RGB8toRGBX8SSSE3(dest, source, width);
+			}
+		#endif
+
+		for(; x < width; x++)
 		{
 			destB[4 * x + 0] = source[x * 3 + 0];
 			destB[4 * x + 1] = source[x * 3 + 1];
@@ -755,8 +833,19 @@ namespace egl
 	{
 		const unsigned short *source4444 = reinterpret_cast<const unsigned short*>(source);
 		unsigned char *dest4444 = dest;
+		int x = 0;
 
-		for(int x = 0; x < width; x++)
+		#if defined(__i386__) || defined(__x86_64__)
+			if(sw::CPUID::supportsSSE2())
+			{
+				for(; x + 8 <= width; x += 8)
+				{
+					RGBA4toRGBA8SSE2(dest4444 + 4 * x, _mm_loadu_si128((const __m128i*)(source4444 + x)));
+				}
+			}
+		#endif
+
+		for(; x < width; x++)
 		{
 			unsigned short rgba = source4444[x];
 			dest4444[4 * x + 0] = ((rgba & 0xF000) >> 8) | ((rgba & 0xF000) >> 12);
@@ -771,8 +860,19 @@ namespace egl
 	{
 		const unsigned short *source5551 = reinterpret_cast<const unsigned short*>(source);
 		unsigned char *dest8888 = dest;
+		int x = 0;
 
-		for(int x = 0; x < width; x++)
+		#if defined(__i386__) || defined(__x86_64__)
+			if(sw::CPUID::supportsSSE2())
+			{
+				for(; x + 8 <= width; x += 8)
+				{
+					RGBA5_A1toRGBA8SSE2(dest8888 + 4 * x, _mm_loadu_si128((const __m128i*)(source5551 + x)));
+				}
+			}
+		#endif
+
+		for(; x < width; x++)
 		{
 			unsigned short rgba = source5551[x];
 			dest8888[4 * x + 0] = ((rgba & 0xF800) >> 8) | ((rgba & 0xF800) >> 13);
@@ -844,10 +944,7 @@ namespace egl
 		const float *source32F = reinterpret_cast<const float*>(source);
 		sw::half *dest16F = reinterpret_cast<sw::half*>(dest);
 
-		for(int x = 0; x < width; x++)
-		{
-			dest16F[x] = source32F[x];
-		}
+		sw::floatToHalf(dest16F, source32F, width);
 	}
 
 	template<>
@@ -856,11 +953,7 @@ namespace egl
 		const float *source32F = reinterpret_cast<const float*>(source);
 		sw::half *dest16F = reinterpret_cast<sw::half*>(dest);
 
-		for(int x = 0; x < width; x++)
-		{
-			dest16F[2 * x + 0] = source32F[2 * x + 0];
-			dest16F[2 * x + 1] = source32F[2 * x + 1];
-		}
+		sw::floatToHalf(dest16F, source32F, 2 * width);
 	}
 
 	template<>
@@ -899,13 +992,7 @@ namespace egl
 		const float *source32F = reinterpret_cast<const float*>(source);
 		sw::half *dest16F = reinterpret_cast<sw::half*>(dest);
 
-		for(int x = 0; x < width; x++)
-		{
-			dest16F[4 * x + 0] = source32F[4 * x + 0];
-			dest16F[4 * x + 1] = source32F[4 * x + 1];
-			dest16F[4 * x + 2] = source32F[4 * x + 2];
-			dest16F[4 * x + 3] = source32F[4 * x + 3];
-		}
+		sw::floatToHalf(dest16F, source32F, 4 * width);
 	}
 
 	template<>
@@ -1009,6 +1096,14 @@ namespace egl
 	template<TransferType transferType>
 	void Transfer(void *buffer, const void *input, const Rectangle &rect)
 	{
+		// Rows without padding on either side are copied in one go
+		if(transferType == Bytes && rect.inputPitch == rect.destPitch && rect.destPitch == rect.width * rect.bytes &&
+		   (rect.depth == 1 || (rect.inputHeight == rect.height && rect.destSlice == rect.destPitch * rect.height)))
+		{
+			memcpy(buffer, input, rect.destPitch * rect.height * rect.depth);
+			return;
+		}
+
 		for(int z = 0; z < rect.depth; z++)
 		{
 			const unsigned char *inputStart = static_cast<const unsigned char*>(input) + (z * rect.inputPitch * rect.inputHeight);
@@ -1284,6 +1379,11 @@ namespace egl
 			return clientBuffer.lock(x, y, z);
 		}
 
+		void *lock(int x, int y, int z, int width, int height, int depth, sw::Lock lock) override
+		{
+			return this->lock(x, y, z, lock);
+		}
+
 		void unlock() override
 		{
 			LOGLOCK("image=%p op=%s.ani", this, __FUNCTION__);
@@ -1309,6 +1409,56 @@ namespace egl
 		return new ClientBufferImage(clientBuffer);
 	}
 
+#if defined(__linux__) && !defined(__ANDROID__)
+	// The mapping is the image's buffer, so the sampler and renderer access the dma-buf in place
+	class DmaBufImage : public Image
+	{
+	public:
+		DmaBufImage(GLsizei width, GLsizei height, GLint internalformat, void *mapping, size_t mappingSize, size_t offset, int pitchB)
+			: Image(width, height, internalformat, static_cast<uint8_t*>(mapping) + offset, pitchB),
+			  mapping(mapping), mappingSize(mappingSize) {}
+
+	private:
+		void *mapping;
+		size_t mappingSize;
+
+		~DmaBufImage() override
+		{
+			sync();   // Wait for any threads that use this image to finish.
+
+			munmap(mapping, mappingSize);
+		}
+
+		void *lockInternal(int x, int y, int z, sw::Lock lock, sw::Accessor client) override
+		{
+			return Image::lockInternal(x, y, z, lock, client);
+		}
+
+		void unlockInternal() override
+		{
+			return Image::unlockInternal();
+		}
+
+		void release() override
+		{
+			return Image::release();
+		}
+	};
+
+	Image *Image::create(GLsizei width, GLsizei height, GLint internalformat, int fd, size_t offset, int pitchB)
+	{
+		size_t mappingSize = offset + (size_t)pitchB * height;
+		void *mapping = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+		if(mapping == MAP_FAILED)
+		{
+			return nullptr;
+		}
+
+		return new DmaBufImage(width, height, internalformat, mapping, mappingSize, offset, pitchB);
+	}
+#endif
+
 	Image::~Image()
 	{
 		// sync() must be called in the destructor of the most derived class to ensure their vtable isn't destroyed
@@ -1723,7 +1873,7 @@ namespace egl
 		GLsizei inputHeight = (unpackParameters.imageHeight == 0) ? height : unpackParameters.imageHeight;
 		char *input = ((char*)pixels) + gl::ComputePackingOffset(format, type, inputWidth, inputHeight, unpackParameters);
 
-		void *buffer = lock(xoffset, yoffset, zoffset, sw::LOCK_WRITEONLY);
+		void *buffer = lock(xoffset, yoffset, zoffset, width, height, depth, sw::LOCK_WRITEONLY);
 
 		if(buffer)
 		{
@@ -1751,7 +1901,7 @@ namespace egl
 		int inputSlice = imageSize / depth;
 		int rows = inputSlice / inputPitch;
 
-		void *buffer = lock(xoffset, yoffset, zoffset, sw::LOCK_WRITEONLY);
+		void *buffer = lock(xoffset, yoffset, zoffset, width, height, depth, sw::LOCK_WRITEONLY);
 
 		if(buffer)
 		{
@@ -123,6 +123,15 @@ protected:
 		Object::addRef();
 	}
 
+	// EGL image wrapping memory owned by the client
+	Image(GLsizei width, GLsizei height, GLint internalformat, void *pixels, int pitchB)
+		: sw::Surface(width, height, 1, gl::SelectInternalFormat(internalformat), pixels, pitchB, pitchB * height),
+		  width(width), height(height), depth(1), internalformat(internalformat), parentTexture(nullptr)
+	{
+		shared = true;
+		Object::addRef();
+	}
+
 	// Render target
 	Image(GLsizei width, GLsizei height, GLint internalformat, int multiSampleDepth, bool lockable)
 		: sw::Surface(nullptr, width, height, 1, 0, multiSampleDepth, gl::SelectInternalFormat(internalformat), lockable, true),
@@ -148,6 +157,11 @@ public:
 	// Back buffer from client buffer
 	static Image *create(const egl::ClientBuffer& clientBuffer);
 
+#if defined(__linux__) && !defined(__ANDROID__)
+	// EGLImage mapping a dma-buf, returns nullptr when the file descriptor can't be mapped
+	static Image *create(GLsizei width, GLsizei height, GLint internalformat, int fd, size_t offset, int pitchB);
+#endif
+
 	static size_t size(int width, int height, int depth, int border, int samples, GLint internalformat);
 
 	GLsizei getWidth() const
@@ -187,6 +201,12 @@ public:
 		return lockExternal(x, y, z, lock, sw::PUBLIC);
 	}
 
+	// Only the width x height x depth region at (x, y, z) gets modified
+	virtual void *lock(int x, int y, int z, int width, int height, int depth, sw::Lock lock)
+	{
+		return lockExternal(x, y, z, width, height, depth, lock, sw::PUBLIC);
+	}
+
 	unsigned int getPitch() const
 	{
 		return getExternalPitchB();
@@ -334,6 +354,11 @@ private:
 		return lockNativeBuffer(GRALLOC_USAGE_SW_READ_OFTEN | GRALLOC_USAGE_SW_WRITE_OFTEN);
 	}
 
+	void *lock(int x, int y, int z, int width, int height, int depth, sw::Lock lock) override
+	{
+		return this->lock(x, y, z, lock);
+	}
+
 	void unlock() override
 	{
 		LOGLOCK("image=%p op=%s.ani", this, __FUNCTION__);
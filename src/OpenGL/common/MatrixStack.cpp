@@ -25,6 +25,7 @@ namespace sw
 
 		top = 0;
 		this->size = size;
+		version = 0;
 	}
 
 	MatrixStack::~MatrixStack()
@@ -36,11 +37,13 @@ namespace sw
 	void MatrixStack::identity()
 	{
 		stack[top] = 1;
+		version++;
 	}
 
 	void MatrixStack::load(const Matrix &M)
 	{
 		stack[top] = M;
+		version++;
 	}
 
 	void MatrixStack::load(const float *M)
@@ -49,6 +52,7 @@ namespace sw
 		                    M[1], M[5], M[9],  M[13],
 		                    M[2], M[6], M[10], M[14],
 		                    M[3], M[7], M[11], M[15]);
+		version++;
 	}
 
 	void MatrixStack::load(const double *M)
@@ -57,11 +61,13 @@ namespace sw
 		                    (float)M[1], (float)M[5], (float)M[9],  (float)M[13],
 		                    (float)M[2], (float)M[6], (float)M[10], (float)M[14],
 		                    (float)M[3], (float)M[7], (float)M[11], (float)M[15]);
+		version++;
 	}
 
 	void MatrixStack::translate(float x, float y, float z)
 	{
 		stack[top] *= Matrix::translate(x, y, z);
+		version++;
 	}
 
 	void MatrixStack::translate(double x, double y, double z)
@@ -88,6 +94,7 @@ namespace sw
 		                  x*z*_c-y*s, y*z*_c+x*s, c+z*z*_c);
 
 		stack[top] *= rotate;
+		version++;
 	}
 
 	void MatrixStack::rotate(double angle, double x, double y, double z)
@@ -98,6 +105,7 @@ namespace sw
 	void MatrixStack::scale(float x, float y, float z)
 	{
 		stack[top] *= Matrix::scale(x, y, z);
+		version++;
 	}
 
 	void MatrixStack::scale(double x, double y, double z)
@@ -111,6 +119,7 @@ namespace sw
 		                     M[1], M[5], M[9],  M[13],
 		                     M[2], M[6], M[10], M[14],
 		                     M[3], M[7], M[11], M[15]);
+		version++;
 	}
 
 	void MatrixStack::multiply(const double *M)
@@ -119,6 +128,7 @@ namespace sw
 		                     (float)M[1], (float)M[5], (float)M[9],  (float)M[13],
 		                     (float)M[2], (float)M[6], (float)M[10], (float)M[14],
 		                     (float)M[3], (float)M[7], (float)M[11], (float)M[15]);
+		version++;
 	}
 
 	void MatrixStack::frustum(float left, float right, float bottom, float top, float zNear, float zFar)
@@ -141,6 +151,7 @@ namespace sw
 	                   0,               0,               -1, 0);
 
 		stack[this->top] *= frustum;
+		version++;
 	}
 
 	void MatrixStack::ortho(double left, double right, double bottom, double top, double zNear, double zFar)
@@ -162,6 +173,7 @@ namespace sw
 		             0,           0,           0,            1);
 
 		stack[this->top] *= ortho;
+		version++;
 	}
 
 	bool MatrixStack::push()
@@ -179,6 +191,7 @@ namespace sw
 		if(top <= 0) return false;
 
 		top--;
+		version++;
 
 		return true;
 	}
@@ -188,6 +201,11 @@ namespace sw
 		return stack[top];
 	}
 
+	unsigned int MatrixStack::getVersion() const
+	{
+		return version;
+	}
+
 	bool MatrixStack::isIdentity() const
 	{
 		const Matrix &m = stack[top];
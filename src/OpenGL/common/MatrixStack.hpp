@@ -48,11 +48,13 @@ namespace sw
 
 		const Matrix &current();
 		bool isIdentity() const;
+		unsigned int getVersion() const;   // Changes whenever the current matrix does
 
 	private:
 		int top;
 		int size;
 		Matrix *stack;
+		unsigned int version;
 	};
 }
 
@@ -103,6 +103,7 @@ bool TCompiler::compile(const char* const shaderStrings[],
                         int compileOptions)
 {
 	TScopedPoolAllocator scopedAlloc(&allocator, true);
+	allocator.resetStatistics();
 	clearResults();
 
 	if (numStrings == 0)
@@ -117,6 +118,13 @@ bool TCompiler::compile(const char* const shaderStrings[],
 		++firstSource;
 	}
 
+	// Directives of the previously compiled shader don't carry over
+	for(auto &extension : extensionBehavior)
+	{
+		extension.second = EBhUndefined;
+	}
+	symbolTable.clearInvariance();
+
 	TIntermediate intermediate(infoSink);
 	TParseContext parseContext(symbolTable, extensionBehavior, intermediate,
 	                           shaderType, compileOptions, true,
@@ -158,6 +166,9 @@ bool TCompiler::compile(const char* const shaderStrings[],
 	while (!symbolTable.atBuiltInLevel())
 		symbolTable.pop();
 
+	sh::Trace("Shader compile used %d kB of pool pages for %d allocations of %d kB\n",
+	          (int)(allocator.getPeakUsage() / 1024), allocator.getAllocationCount(), (int)(allocator.getAllocatedBytes() / 1024));
+
 	return success;
 }
 
@@ -86,6 +86,7 @@ public:
 	// Get results of the last compilation.
 	int getShaderVersion() const { return shaderVersion; }
 	TInfoSink& getInfoSink() { return infoSink; }
+	size_t getPoolPeakUsage() const { return allocator.getPeakUsage(); }   // Of the last compile, in bytes
 
 protected:
 	GLenum getShaderType() const { return shaderType; }
@@ -60,6 +60,7 @@ void TDirectiveHandler::handlePragma(const pp::SourceLocation& loc,
 	static const char kSTDGL[] = "STDGL";
 	static const char kOptimize[] = "optimize";
 	static const char kDebug[] = "debug";
+	static const char kFastMath[] = "swiftshader_fast_math";
 	static const char kOn[] = "on";
 	static const char kOff[] = "off";
 
@@ -82,6 +83,13 @@ void TDirectiveHandler::handlePragma(const pp::SourceLocation& loc,
 		else if (value == kOff) mPragma.debug = false;
 		else invalidValue = true;
 	}
+	else if (name == kFastMath)
+	{
+		// Trades the precision of the transcendental functions for speed
+		if (value == kOn) mPragma.fastMath = true;
+		else if (value == kOff) mPragma.fastMath = false;
+		else invalidValue = true;
+	}
 	else
 	{
 		mDiagnostics.report(pp::Diagnostics::PP_UNRECOGNIZED_PRAGMA, loc, name);
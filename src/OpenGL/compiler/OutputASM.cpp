@@ -514,6 +514,7 @@ namespace glsl
 
 		functionArray.push_back(Function(0, "main(", nullptr, nullptr));
 		currentFunction = 0;
+		currentLine = 0;
 		outputQualifier = EvqOutput;   // Initialize outputQualifier to any value other than EvqFragColor or EvqFragData
 	}
 
@@ -525,6 +526,9 @@ namespace glsl
 	{
 		if(shader)
 		{
+			// '#pragma swiftshader_fast_math(on)' computes every instruction at partial precision
+			shader->setFastMath(mContext.pragma().fastMath);
+
 			emitShader(GLOBAL);
 
 			if(functionArray.size() > 1)   // Only call main() when there are other functions
@@ -2088,6 +2092,7 @@ namespace glsl
 		{
 			TIntermTyped* src = src0->getAsTyped();
 			instruction->dst.partialPrecision = src && (src->getPrecision() <= EbpLow);
+			instruction->dst.mediumPrecision = src && (src->getPrecision() == EbpMedium);
 		}
 
 		source(instruction->src[0], src0, index0);
@@ -2096,11 +2101,24 @@ namespace glsl
 		source(instruction->src[3], src3, index3);
 		source(instruction->src[4], src4, index4);
 
-		shader->append(instruction);
+		TIntermNode *node = dst ? dst : src0;
+
+		if(node && node->getLine().first_line > 0)
+		{
+			currentLine = node->getLine().first_line;
+		}
+
+		append(instruction);
 
 		return instruction;
 	}
 
+	void OutputASM::append(Instruction *instruction)
+	{
+		instruction->line = currentLine;
+		shader->append(instruction);
+	}
+
 	Instruction *OutputASM::emitCast(TIntermTyped *dst, TIntermTyped *src)
 	{
 		return emitCast(dst, 0, src, 0);
@@ -2394,7 +2412,7 @@ namespace glsl
 					instruction->src[0].bufferIndex = argumentInfo.bufferIndex;
 					instruction->src[0].index = argumentInfo.typedMemberInfo.offset + argumentInfo.clampedIndex * argumentInfo.typedMemberInfo.arrayStride;
 
-					shader->append(instruction);
+					append(instruction);
 
 					arg = &unpackedUniform;
 					index = 0;
@@ -2423,7 +2441,7 @@ namespace glsl
 						instruction->src[0].index = matrixStartOffset + j * argumentInfo.typedMemberInfo.matrixStride;
 						instruction->src[0].swizzle = srcSwizzle;
 
-						shader->append(instruction);
+						append(instruction);
 					}
 
 					arg = &unpackedUniform;
@@ -2528,7 +2546,7 @@ namespace glsl
 			source(insert->src[1], src);
 			source(insert->src[2], binary->getRight());
 
-			shader->append(insert);
+			append(insert);
 		}
 		else
 		{
@@ -2539,7 +2557,7 @@ namespace glsl
 			source(mov1->src[0], src);
 			mov1->src[0].swizzle = swizzleSwizzle(mov1->src[0].swizzle, swizzle);
 
-			shader->append(mov1);
+			append(mov1);
 
 			for(int offset = 1; offset < dst->totalRegisterCount(); offset++)
 			{
@@ -2551,7 +2569,7 @@ namespace glsl
 
 				source(mov->src[0], src, offset);
 
-				shader->append(mov);
+				append(mov);
 			}
 		}
 	}
@@ -2577,7 +2595,7 @@ namespace glsl
 
 			source(insert->src[1], binary->getRight());
 
-			shader->append(insert);
+			append(insert);
 		}
 		else
 		{
@@ -2594,7 +2612,7 @@ namespace glsl
 			source(mov1->src[0], root, offset);
 			mov1->src[0].swizzle = swizzleSwizzle(mov1->src[0].swizzle, swizzle);
 
-			shader->append(mov1);
+			append(mov1);
 
 			for(int i = 1; i < node->totalRegisterCount(); i++)
 			{
@@ -58,6 +58,7 @@ namespace glsl
 	struct ShaderVariable
 	{
 		ShaderVariable(const TType& type, const std::string& name, int registerIndex);
+		ShaderVariable() : type(0), precision(0), arraySize(0), registerIndex(-1) {}   // For program binaries
 
 		GLenum type;
 		GLenum precision;
@@ -72,6 +73,7 @@ namespace glsl
 	struct Uniform : public ShaderVariable
 	{
 		Uniform(const TType& type, const std::string &name, int registerIndex, int blockId, const BlockMemberInfo& blockMemberInfo);
+		Uniform() : blockId(-1) {}
 
 		int blockId;
 		BlockMemberInfo blockInfo;
@@ -83,6 +85,7 @@ namespace glsl
 	{
 		UniformBlock(const std::string& name, unsigned int dataSize, unsigned int arraySize,
 		             TLayoutBlockStorage layout, bool isRowMajorLayout, int registerIndex, int blockId);
+		UniformBlock() : dataSize(0), arraySize(0), layout(EbsUnspecified), isRowMajorLayout(false), registerIndex(-1), blockId(-1) {}
 
 		std::string name;
 		unsigned int dataSize;
@@ -163,6 +166,10 @@ namespace glsl
 		{
 		}
 
+		Varying() : qualifier(EvqTemporary), column(-1)
+		{
+		}
+
 		bool isArray() const
 		{
 			return arraySize >= 1;
@@ -269,6 +276,7 @@ namespace glsl
 		Instruction *emit(sw::Shader::Opcode op, TIntermTyped *dst = 0, TIntermNode *src0 = 0, TIntermNode *src1 = 0, TIntermNode *src2 = 0, TIntermNode *src3 = 0, TIntermNode *src4 = 0);
 		Instruction *emit(sw::Shader::Opcode op, TIntermTyped *dst, int dstIndex, TIntermNode *src0 = 0, int index0 = 0, TIntermNode *src1 = 0, int index1 = 0,
 		                  TIntermNode *src2 = 0, int index2 = 0, TIntermNode *src3 = 0, int index3 = 0, TIntermNode *src4 = 0, int index4 = 0);
+		void append(Instruction *instruction);   // Tags the instruction with the current source line
 		Instruction *emitCast(TIntermTyped *dst, TIntermTyped *src);
 		Instruction *emitCast(TIntermTyped *dst, int dstIndex, TIntermTyped *src, int srcIndex);
 		void emitBinary(sw::Shader::Opcode op, TIntermTyped *dst = 0, TIntermNode *src0 = 0, TIntermNode *src1 = 0, TIntermNode *src2 = 0);
@@ -372,6 +380,8 @@ namespace glsl
 		int currentFunction;
 		std::vector<Function> functionArray;
 
+		int currentLine;   // GLSL line of the last emitted operand, for profiling
+
 		TQualifier outputQualifier;
 
 		std::set<int> deterministicVariables;
@@ -53,6 +53,64 @@ void SetGlobalPoolAllocator(TPoolAllocator* poolAllocator)
 	OS_SetTLSValue(PoolIndex, poolAllocator);
 }
 
+#if !defined(SWIFTSHADER_TRANSLATOR_DISABLE_POOL_ALLOC)
+namespace
+{
+//
+// Pages of the default size released by the pools of this thread. Compiling
+// hundreds of shaders would otherwise allocate and free the same pages for
+// each of them.
+//
+class TPageCache {
+public:
+	~TPageCache()
+	{
+		while (pages) {
+			TFreePage* next = pages->next;
+			delete [] reinterpret_cast<char*>(pages);
+			pages = next;
+		}
+
+		// Pools destroyed after the thread's cache free their own pages
+		capacity = 0;
+	}
+
+	void* take()
+	{
+		TFreePage* page = pages;
+		if (page) {
+			pages = page->next;
+			count--;
+		}
+		return page;
+	}
+
+	bool give(void* page)
+	{
+		if (count >= capacity)
+			return false;
+
+		TFreePage* freePage = static_cast<TFreePage*>(page);
+		freePage->next = pages;
+		pages = freePage;
+		count++;
+		return true;
+	}
+
+private:
+	struct TFreePage {
+		TFreePage* next;
+	};
+
+	TFreePage* pages = nullptr;
+	int count = 0;
+	int capacity = 64;   // 2 MB of default sized pages
+};
+
+thread_local TPageCache pageCache;
+}  // anonymous namespace
+#endif
+
 //
 // Implement the functionality of the TPoolAllocator class, which
 // is documented in PoolAlloc.h.
@@ -64,7 +122,9 @@ TPoolAllocator::TPoolAllocator(int growthIncrement, int allocationAlignment) :
 	freeList(0),
 	inUseList(0),
 	numCalls(0),
-	totalBytes(0)
+	totalBytes(0),
+	pageBytes(0),
+	peakBytes(0)
 #endif
 {
 	//
@@ -113,7 +173,7 @@ TPoolAllocator::~TPoolAllocator()
 	while (inUseList) {
 		tHeader* next = inUseList->nextPage;
 		inUseList->~tHeader();
-		delete [] reinterpret_cast<char*>(inUseList);
+		releasePage(inUseList);
 		inUseList = next;
 	}
 
@@ -123,7 +183,7 @@ TPoolAllocator::~TPoolAllocator()
 	//
 	while (freeList) {
 		tHeader* next = freeList->nextPage;
-		delete [] reinterpret_cast<char*>(freeList);
+		releasePage(freeList);
 		freeList = next;
 	}
 #else  // !defined(SWIFTSHADER_TRANSLATOR_DISABLE_POOL_ALLOC)
@@ -209,6 +269,7 @@ void TPoolAllocator::pop()
 		inUseList->~tHeader();
 
 		tHeader* nextInUse = inUseList->nextPage;
+		pageBytes -= inUseList->pageCount * pageSize;
 		if (inUseList->pageCount > 1)
 			delete [] reinterpret_cast<char*>(inUseList);
 		else {
@@ -285,9 +346,7 @@ void* TPoolAllocator::allocate(size_t numBytes)
 		if (memory == 0)
 			return 0;
 
-		// Use placement-new to initialize header
-		new(memory) tHeader(inUseList, (numBytesToAlloc + pageSize - 1) / pageSize);
-		inUseList = memory;
+		addPage(memory, (numBytesToAlloc + pageSize - 1) / pageSize);
 
 		currentPageOffset = pageSize;  // make next allocation come from a new page
 
@@ -303,14 +362,16 @@ void* TPoolAllocator::allocate(size_t numBytes)
 		memory = freeList;
 		freeList = freeList->nextPage;
 	} else {
-		memory = reinterpret_cast<tHeader*>(::new char[pageSize]);
+		memory = nullptr;
+		if (pageSize == defaultGrowthIncrement)
+			memory = static_cast<tHeader*>(pageCache.take());
+		if (memory == 0)
+			memory = reinterpret_cast<tHeader*>(::new char[pageSize]);
 		if (memory == 0)
 			return 0;
 	}
 
-	// Use placement-new to initialize header
-	new(memory) tHeader(inUseList, 1);
-	inUseList = memory;
+	addPage(memory, 1);
 
 	unsigned char* ret = reinterpret_cast<unsigned char *>(inUseList) + headerSkip;
 	currentPageOffset = (headerSkip + allocationSize + alignmentMask) & ~alignmentMask;
@@ -326,6 +387,63 @@ void* TPoolAllocator::allocate(size_t numBytes)
 #endif
 }
 
+#if !defined(SWIFTSHADER_TRANSLATOR_DISABLE_POOL_ALLOC)
+void TPoolAllocator::addPage(tHeader* page, size_t pageCount)
+{
+	// Use placement-new to initialize header
+	new(page) tHeader(inUseList, pageCount);
+	inUseList = page;
+
+	pageBytes += pageCount * pageSize;
+	if (pageBytes > peakBytes)
+		peakBytes = pageBytes;
+}
+
+void TPoolAllocator::releasePage(tHeader* page)
+{
+	if (page->pageCount == 1 && pageSize == defaultGrowthIncrement && pageCache.give(page))
+		return;
+
+	delete [] reinterpret_cast<char*>(page);
+}
+#endif
+
+void TPoolAllocator::resetStatistics()
+{
+#if !defined(SWIFTSHADER_TRANSLATOR_DISABLE_POOL_ALLOC)
+	numCalls = 0;
+	totalBytes = 0;
+	peakBytes = pageBytes;
+#endif
+}
+
+size_t TPoolAllocator::getPeakUsage() const
+{
+#if !defined(SWIFTSHADER_TRANSLATOR_DISABLE_POOL_ALLOC)
+	return peakBytes;
+#else
+	return 0;
+#endif
+}
+
+int TPoolAllocator::getAllocationCount() const
+{
+#if !defined(SWIFTSHADER_TRANSLATOR_DISABLE_POOL_ALLOC)
+	return numCalls;
+#else
+	return 0;
+#endif
+}
+
+size_t TPoolAllocator::getAllocatedBytes() const
+{
+#if !defined(SWIFTSHADER_TRANSLATOR_DISABLE_POOL_ALLOC)
+	return totalBytes;
+#else
+	return 0;
+#endif
+}
+
 
 //
 // Check all allocations in a list for damage by calling check on each.
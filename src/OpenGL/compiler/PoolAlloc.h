@@ -121,9 +121,15 @@ private:
 // page size.  But, having it be about that size or equal to a set of
 // pages is likely most optimal.
 //
+// Single pages of the default size aren't returned to the OS when a pool is
+// destroyed, but kept by the thread for the pools of the next compiles.
+//
 class TPoolAllocator {
 public:
-	TPoolAllocator(int growthIncrement = 8*1024, int allocationAlignment = 16);
+	// Most shaders fit in a few pages of this size
+	static const int defaultGrowthIncrement = 32*1024;
+
+	TPoolAllocator(int growthIncrement = defaultGrowthIncrement, int allocationAlignment = 16);
 
 	//
 	// Don't call the destructor just to free up the memory, call pop()
@@ -160,6 +166,15 @@ public:
 	// by calling pop(), and to not have to solve memory leak problems.
 	//
 
+	//
+	// Statistics of the allocations since the last call to resetStatistics(),
+	// like the ones of a single compile.
+	//
+	void resetStatistics();
+	size_t getPeakUsage() const;   // most bytes of pages in use at once
+	int getAllocationCount() const;
+	size_t getAllocatedBytes() const;
+
 private:
 	size_t alignment; // all returned allocations will be aligned at
                       // this granularity, which will be a power of 2
@@ -198,6 +213,9 @@ private:
 	typedef std::vector<tAllocState> tAllocStack;
 
 	// Track allocations if and only if we're using guard blocks
+	void addPage(tHeader* page, size_t pageCount);
+	void releasePage(tHeader* page);
+
 	void* initializeAllocation(tHeader* block, unsigned char* memory, size_t numBytes) {
 #ifdef GUARD_BLOCKS
 		new(memory) TAllocation(numBytes, memory, block->lastAllocation);
@@ -218,6 +236,8 @@ private:
 
 	int numCalls;           // just an interesting statistic
 	size_t totalBytes;      // just an interesting statistic
+	size_t pageBytes;       // size of the pages in inUseList
+	size_t peakBytes;       // largest pageBytes since the statistics were reset
 
 #else  // !defined(SWIFTSHADER_TRANSLATOR_DISABLE_POOL_ALLOC)
 	std::vector<std::vector<void *>> mStack;
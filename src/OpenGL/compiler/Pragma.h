@@ -17,11 +17,12 @@
 
 struct TPragma {
 	// By default optimization is turned on and debug is turned off.
-	TPragma() : optimize(true), debug(false) { }
-	TPragma(bool o, bool d) : optimize(o), debug(d) { }
+	TPragma() : optimize(true), debug(false), fastMath(false) { }
+	TPragma(bool o, bool d) : optimize(o), debug(d), fastMath(false) { }
 
 	bool optimize;
 	bool debug;
+	bool fastMath;   // Vendor specific, applies to the whole shader
 };
 
 #endif // COMPILER_PRAGMA_H_
@@ -512,6 +512,12 @@ public:
 	void setGlobalInvariant() { mGlobalInvariant = true; }
 	bool getGlobalInvariant() const { return mGlobalInvariant; }
 
+	void clearInvariance()
+	{
+		mInvariantVaryings.clear();
+		mGlobalInvariant = false;
+	}
+
 	bool hasUnmangledBuiltIn(const char *name) { return mUnmangledBuiltinNames.count(std::string(name)) > 0; }
 
 private:
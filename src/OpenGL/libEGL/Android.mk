@@ -27,6 +27,7 @@ COMMON_CFLAGS += -D__STDC_INT64__
 endif
 
 COMMON_SRC_FILES := \
+	../../Common/MutexLock.cpp \
 	Config.cpp \
 	Display.cpp \
 	Surface.cpp \
@@ -19,6 +19,7 @@
 #include "Renderer/Surface.hpp"
 
 #include <EGL/egl.h>
+#include <EGL/eglext.h>
 #include <GLES/gl.h>
 
 namespace gl { class Surface; }
@@ -39,6 +40,9 @@ public:
 	virtual EGLint getConfigID() const = 0;
 	virtual void finish() = 0;
 	virtual void blit(sw::Surface *source, const sw::SliceRect &sRect, sw::Surface *dest, const sw::SliceRect &dRect) = 0;
+	virtual void endFrame() {}   // Called by eglSwapBuffers on the current context, before presenting
+	virtual void setPriority(EGLint priority) {}   // EGL_CONTEXT_PRIORITY_*_IMG
+	virtual EGLint getPriority() const { return EGL_CONTEXT_PRIORITY_MEDIUM_IMG; }
 
 	Display *getDisplay() const { return display; }
 
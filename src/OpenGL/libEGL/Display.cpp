@@ -515,12 +515,20 @@ EGLSurface Display::createPBufferSurface(EGLConfig config, const EGLint *attribL
 			return error(EGL_BAD_PARAMETER, EGL_NO_SURFACE);
 		}
 
-		if(textureFormat != EGL_TEXTURE_RGBA)
+#if !defined(__APPLE__)
+		// Host memory which isn't bound as a texture becomes the render target of a
+		// current surface, for headless rendering without copying the frames.
+		const bool renderTarget = (textureFormat == EGL_NO_TEXTURE && textureTarget == EGL_NO_TEXTURE);
+#else
+		const bool renderTarget = false;
+#endif
+
+		if(textureFormat != EGL_TEXTURE_RGBA && !renderTarget)
 		{
 			return error(EGL_BAD_ATTRIBUTE, EGL_NO_SURFACE);
 		}
 
-		if(textureTarget != EGL_TEXTURE_RECTANGLE_ANGLE)
+		if(textureTarget != EGL_TEXTURE_RECTANGLE_ANGLE && !renderTarget)
 		{
 			return error(EGL_BAD_ATTRIBUTE, EGL_NO_SURFACE);
 		}
@@ -559,7 +567,7 @@ EGLSurface Display::createPBufferSurface(EGLConfig config, const EGLint *attribL
 	return success(surface);
 }
 
-EGLContext Display::createContext(EGLConfig configHandle, const egl::Context *shareContext, EGLint clientVersion)
+EGLContext Display::createContext(EGLConfig configHandle, const egl::Context *shareContext, EGLint clientVersion, EGLint priority)
 {
 	const egl::Config *config = mConfigSet.get(configHandle);
 	egl::Context *context = nullptr;
@@ -589,6 +597,7 @@ EGLContext Display::createContext(EGLConfig configHandle, const egl::Context *sh
 		return error(EGL_BAD_ALLOC, EGL_NO_CONTEXT);
 	}
 
+	context->setPriority(priority);   // Only a hint, contexts which don't support it report medium priority
 	context->addRef();
 	mContextSet.insert(context);
 
@@ -61,7 +61,7 @@ namespace egl
 
 		EGLSurface createWindowSurface(EGLNativeWindowType window, EGLConfig config, const EGLAttrib *attribList);
 		EGLSurface createPBufferSurface(EGLConfig config, const EGLint *attribList, EGLClientBuffer clientBuffer = nullptr);
-		EGLContext createContext(EGLConfig configHandle, const Context *shareContext, EGLint clientVersion);
+		EGLContext createContext(EGLConfig configHandle, const Context *shareContext, EGLint clientVersion, EGLint priority);
 		EGLSyncKHR createSync(Context *context);
 
 		void destroySurface(Surface *surface);
@@ -35,6 +35,7 @@
 #endif
 
 #include <algorithm>
+#include <stdlib.h>
 
 namespace gl
 {
@@ -62,22 +63,7 @@ bool Surface::initialize()
 {
 	ASSERT(!backBuffer && !depthStencil);
 
-	if(libGLESv2)
-	{
-		if(clientBuffer)
-		{
-			backBuffer = libGLESv2->createBackBufferFromClientBuffer(
-				egl::ClientBuffer(width, height, getClientBufferFormat(), clientBuffer, clientBufferPlane));
-		}
-		else
-		{
-			backBuffer = libGLESv2->createBackBuffer(width, height, config->mRenderTargetFormat, config->mSamples);
-		}
-	}
-	else if(libGLES_CM)
-	{
-		backBuffer = libGLES_CM->createBackBuffer(width, height, config->mRenderTargetFormat, config->mSamples);
-	}
+	backBuffer = createBackBuffer();
 
 	if(!backBuffer)
 	{
@@ -108,6 +94,28 @@ bool Surface::initialize()
 	return true;
 }
 
+Image *Surface::createBackBuffer() const
+{
+	if(libGLESv2)
+	{
+		if(clientBuffer)
+		{
+			return libGLESv2->createBackBufferFromClientBuffer(
+				egl::ClientBuffer(width, height, getClientBufferFormat(), clientBuffer, clientBufferPlane));
+		}
+		else
+		{
+			return libGLESv2->createBackBuffer(width, height, config->mRenderTargetFormat, config->mSamples);
+		}
+	}
+	else if(libGLES_CM)
+	{
+		return libGLES_CM->createBackBuffer(width, height, config->mRenderTargetFormat, config->mSamples);
+	}
+
+	return nullptr;
+}
+
 void Surface::deleteResources()
 {
 	if(depthStencil)
@@ -159,6 +167,11 @@ void Surface::setMultisampleResolve(EGLenum multisampleResolve)
 	this->multisampleResolve = multisampleResolve;
 }
 
+void Surface::swap(const EGLint *rects, EGLint count)
+{
+	swap();   // The whole surface gets presented
+}
+
 void Surface::setSwapBehavior(EGLenum swapBehavior)
 {
 	this->swapBehavior = swapBehavior;
@@ -292,10 +305,29 @@ egl::Texture *Surface::getBoundTexture() const
 	return texture;
 }
 
+// Number of swapped frames the application can get ahead of the window by, which
+// presents each one before eglSwapBuffers returns when it is 1.
+static int framesInFlight()
+{
+	static const int count = []()
+	{
+		const char *frames = getenv("SWIFTSHADER_FRAMES_IN_FLIGHT");
+
+		return frames ? std::max(1, std::min(atoi(frames), (int)WindowSurface::MAX_FRAMES_IN_FLIGHT)) : 1;
+	}();
+
+	return count;
+}
+
 WindowSurface::WindowSurface(Display *display, const Config *config, EGLNativeWindowType window)
 	: Surface(display, config), window(window)
 {
 	pixelAspectRatio = (EGLint)(1.0 * EGL_DISPLAY_SCALING);   // FIXME: Determine actual pixel aspect ratio
+
+	if(framesInFlight() > 1)
+	{
+		swapBehavior = EGL_BUFFER_DESTROYED;   // Swapping hands out another back buffer
+	}
 }
 
 WindowSurface::~WindowSurface()
@@ -314,12 +346,85 @@ void WindowSurface::swap()
 {
 	if(backBuffer && frameBuffer)
 	{
-		frameBuffer->flip(backBuffer);
+		if(framesInFlight() > 1 && swapBehavior == EGL_BUFFER_DESTROYED)
+		{
+			// The frame gets presented once later frames have been swapped, by which time its
+			// draws have had the time to finish. Rendering continues in another back buffer.
+			pendingFrames.push_back(backBuffer);
+			backBuffer = nullptr;
+
+			if(pendingFrames.size() >= (size_t)framesInFlight())
+			{
+				presentPendingFrame();
+			}
+
+			if(!spareBuffers.empty())
+			{
+				backBuffer = spareBuffers.back();
+				spareBuffers.pop_back();
+			}
+			else
+			{
+				backBuffer = createBackBuffer();
+			}
+
+			if(!backBuffer)   // Out of memory, fall back to presenting every frame
+			{
+				backBuffer = pendingFrames.back();
+				pendingFrames.pop_back();
+
+				while(!pendingFrames.empty())
+				{
+					presentPendingFrame();
+				}
+
+				frameBuffer->flip(backBuffer);
+			}
+
+			if(getCurrentDrawSurface() == this)
+			{
+				getCurrentContext()->makeCurrent(this);   // Framebuffer zero uses the new back buffer
+			}
+		}
+		else
+		{
+			while(!pendingFrames.empty())
+			{
+				presentPendingFrame();
+			}
+
+			frameBuffer->flip(backBuffer);
+		}
 
 		checkForResize();
 	}
 }
 
+void WindowSurface::presentPendingFrame()
+{
+	Image *frame = pendingFrames.front();
+	pendingFrames.erase(pendingFrames.begin());
+
+	frameBuffer->flip(frame);
+	spareBuffers.push_back(frame);
+}
+
+void WindowSurface::swap(const EGLint *rects, EGLint count)
+{
+	if(frameBuffer)
+	{
+		for(EGLint i = 0; i < count; i++)
+		{
+			const EGLint *rect = &rects[4 * i];
+
+			// The frame buffer has a top-left origin
+			frameBuffer->setDamage(sw::Rect(rect[0], height - (rect[1] + rect[3]), rect[0] + rect[2], height - rect[1]));
+		}
+	}
+
+	swap();
+}
+
 EGLNativeWindowType WindowSurface::getWindowHandle() const
 {
 	return window;
@@ -385,6 +490,19 @@ bool WindowSurface::checkForResize()
 
 void WindowSurface::deleteResources()
 {
+	for(Image *frame : pendingFrames)
+	{
+		frame->release();
+	}
+
+	for(Image *buffer : spareBuffers)
+	{
+		buffer->release();
+	}
+
+	pendingFrames.clear();
+	spareBuffers.clear();
+
 	delete frameBuffer;
 	frameBuffer = nullptr;
 
@@ -444,7 +562,13 @@ PBufferSurface::~PBufferSurface()
 
 void PBufferSurface::swap()
 {
-	// No effect
+	// The render target is the output, so there's nothing to copy. Host memory gets
+	// handed to the application though, so wait for the frame's rendering to finish.
+	if(clientBuffer && backBuffer && textureTarget == EGL_NO_TEXTURE)
+	{
+		backBuffer->lock(0, 0, 0, sw::LOCK_READONLY);
+		backBuffer->unlock();
+	}
 }
 
 EGLNativeWindowType PBufferSurface::getWindowHandle() const
@@ -26,6 +26,8 @@
 
 #include <EGL/egl.h>
 
+#include <vector>
+
 namespace egl
 {
 class Display;
@@ -36,6 +38,7 @@ class Surface : public gl::Surface, public gl::Object
 public:
 	virtual bool initialize();
 	virtual void swap() = 0;
+	virtual void swap(const EGLint *rects, EGLint count);   // Only the rectangles changed, as x, y, width, height with a bottom-left origin
 
 	egl::Image *getRenderTarget() override;
 	egl::Image *getDepthStencil() override;
@@ -75,6 +78,7 @@ protected:
 	virtual void deleteResources();
 
 	sw::Format getClientBufferFormat() const;
+	Image *createBackBuffer() const;
 
 	const Display *const display;
 	const Config *const config;
@@ -121,16 +125,23 @@ public:
 
 	bool isWindowSurface() const override { return true; }
 	void swap() override;
+	void swap(const EGLint *rects, EGLint count) override;
 
 	EGLNativeWindowType getWindowHandle() const override;
 
+	enum { MAX_FRAMES_IN_FLIGHT = 3 };   // Limit of SWIFTSHADER_FRAMES_IN_FLIGHT
+
 private:
 	void deleteResources() override;
 	bool checkForResize();
 	bool reset(int backBufferWidth, int backBufferHeight);
+	void presentPendingFrame();
 
 	const EGLNativeWindowType window;
 	sw::FrameBuffer *frameBuffer = nullptr;
+
+	std::vector<Image*> pendingFrames;   // Swapped but not yet presented, oldest first
+	std::vector<Image*> spareBuffers;    // Presented, reused as back buffers
 };
 
 class PBufferSurface : public Surface
@@ -143,6 +154,7 @@ public:
 	~PBufferSurface() override;
 
 	bool isPBufferSurface() const override { return true; }
+	using Surface::swap;
 	void swap() override;
 
 	EGLNativeWindowType getWindowHandle() const override;
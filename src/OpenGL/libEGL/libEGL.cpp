@@ -31,6 +31,7 @@
 
 #include <algorithm>
 #include <vector>
+#include <limits.h>
 #include <string.h>
 
 namespace egl
@@ -123,6 +124,112 @@ public:
 private:
 	std::vector<EGLAttrib> attrib;
 };
+
+#if defined(__linux__) && !defined(__ANDROID__)
+constexpr EGLAttrib DrmFourcc(char a, char b, char c, char d)
+{
+	return (EGLAttrib)a | ((EGLAttrib)b << 8) | ((EGLAttrib)c << 16) | ((EGLAttrib)d << 24);
+}
+
+// Single-plane formats whose memory layout matches an internal format, so the dma-buf can be used in place
+GLenum GLPixelFormatFromDrmFourcc(EGLAttrib fourcc)
+{
+	switch(fourcc)
+	{
+	case DrmFourcc('A', 'R', '2', '4'): return GL_BGRA8_EXT;   // DRM_FORMAT_ARGB8888
+	case DrmFourcc('A', 'B', '2', '4'): return GL_RGBA8;       // DRM_FORMAT_ABGR8888
+	case DrmFourcc('X', 'B', '2', '4'): return GL_RGB8;        // DRM_FORMAT_XBGR8888
+	case DrmFourcc('R', 'G', '1', '6'): return GL_RGB565;      // DRM_FORMAT_RGB565
+	case DrmFourcc('G', 'R', '8', '8'): return GL_RG8;         // DRM_FORMAT_GR88
+	case DrmFourcc('R', '8', ' ', ' '): return GL_R8;          // DRM_FORMAT_R8
+	default:                            return GL_NONE;
+	}
+}
+
+EGLImage createDmaBufImage(egl::Display *display, EGLContext ctx, EGLClientBuffer buffer, const EGLAttrib *attrib_list)
+{
+	if(ctx != EGL_NO_CONTEXT)
+	{
+		return error(EGL_BAD_CONTEXT, EGL_NO_IMAGE_KHR);
+	}
+
+	if(buffer)
+	{
+		return error(EGL_BAD_PARAMETER, EGL_NO_IMAGE_KHR);
+	}
+
+	EGLAttrib width = -1;
+	EGLAttrib height = -1;
+	EGLAttrib fourcc = -1;
+	EGLAttrib fd = -1;
+	EGLAttrib offset = -1;
+	EGLAttrib pitch = -1;
+
+	if(attrib_list)
+	{
+		for(const EGLAttrib *attribute = attrib_list; attribute[0] != EGL_NONE; attribute += 2)
+		{
+			switch(attribute[0])
+			{
+			case EGL_WIDTH:                     width = attribute[1];  break;
+			case EGL_HEIGHT:                    height = attribute[1]; break;
+			case EGL_LINUX_DRM_FOURCC_EXT:      fourcc = attribute[1]; break;
+			case EGL_DMA_BUF_PLANE0_FD_EXT:     fd = attribute[1];     break;
+			case EGL_DMA_BUF_PLANE0_OFFSET_EXT: offset = attribute[1]; break;
+			case EGL_DMA_BUF_PLANE0_PITCH_EXT:  pitch = attribute[1];  break;
+			case EGL_IMAGE_PRESERVED_KHR:
+			case EGL_YUV_COLOR_SPACE_HINT_EXT:
+			case EGL_SAMPLE_RANGE_HINT_EXT:
+			case EGL_YUV_CHROMA_HORIZONTAL_SITING_HINT_EXT:
+			case EGL_YUV_CHROMA_VERTICAL_SITING_HINT_EXT:
+				break;   // The contents are always preserved, and the hints only apply to YUV formats
+			case EGL_DMA_BUF_PLANE1_FD_EXT:
+			case EGL_DMA_BUF_PLANE1_OFFSET_EXT:
+			case EGL_DMA_BUF_PLANE1_PITCH_EXT:
+			case EGL_DMA_BUF_PLANE2_FD_EXT:
+			case EGL_DMA_BUF_PLANE2_OFFSET_EXT:
+			case EGL_DMA_BUF_PLANE2_PITCH_EXT:
+				return error(EGL_BAD_MATCH, EGL_NO_IMAGE_KHR);   // Multi-planar formats are not supported
+			default:
+				return error(EGL_BAD_ATTRIBUTE, EGL_NO_IMAGE_KHR);
+			}
+		}
+	}
+
+	if(width <= 0 || height <= 0 || fourcc == -1 || fd < 0 || offset < 0 || pitch <= 0)
+	{
+		return error(EGL_BAD_PARAMETER, EGL_NO_IMAGE_KHR);
+	}
+
+	GLenum internalformat = GLPixelFormatFromDrmFourcc(fourcc);
+
+	if(internalformat == GL_NONE)
+	{
+		return error(EGL_BAD_MATCH, EGL_NO_IMAGE_KHR);
+	}
+
+	if(width > INT_MAX || height > INT_MAX || pitch > INT_MAX)
+	{
+		return error(EGL_BAD_ACCESS, EGL_NO_IMAGE_KHR);
+	}
+
+	Image *image = nullptr;
+
+	if(libGLESv2)
+	{
+		image = libGLESv2->createImageFromDmaBuf((int)width, (int)height, internalformat, (int)fd, (size_t)offset, (int)pitch);
+	}
+
+	if(!image)
+	{
+		return error(EGL_BAD_ACCESS, EGL_NO_IMAGE_KHR);
+	}
+
+	EGLImage eglImage = display->createSharedImage(image);
+
+	return success(eglImage);
+}
+#endif
 }
 
 EGLint GetError(void)
@@ -236,9 +343,15 @@ const char *QueryString(EGLDisplay dpy, EGLint name)
 		               "EGL_KHR_gl_renderbuffer_image "
 		               "EGL_KHR_fence_sync "
 		               "EGL_KHR_image_base "
+#if defined(__linux__) && !defined(__ANDROID__)
+		               "EGL_EXT_image_dma_buf_import "
+#endif
 		               "EGL_KHR_surfaceless_context "
+		               "EGL_KHR_swap_buffers_with_damage "
+		               "EGL_EXT_swap_buffers_with_damage "
 		               "EGL_ANGLE_iosurface_client_buffer "
 		               "EGL_ANDROID_framebuffer_target "
+		               "EGL_IMG_context_priority "
 		               "EGL_ANDROID_recordable");
 	case EGL_VENDOR:
 		return success("Google Inc.");
@@ -777,6 +890,7 @@ EGLContext CreateContext(EGLDisplay dpy, EGLConfig config, EGLContext share_cont
 
 	EGLint majorVersion = 1;
 	EGLint minorVersion = 0;
+	EGLint priority = EGL_CONTEXT_PRIORITY_MEDIUM_IMG;
 
 	if(attrib_list)
 	{
@@ -819,6 +933,18 @@ EGLContext CreateContext(EGLDisplay dpy, EGLConfig config, EGLContext share_cont
 					return error(EGL_BAD_ATTRIBUTE, EGL_NO_CONTEXT);
 				}
 				break;
+			case EGL_CONTEXT_PRIORITY_LEVEL_IMG:
+				switch(attribute[1])
+				{
+				case EGL_CONTEXT_PRIORITY_HIGH_IMG:
+				case EGL_CONTEXT_PRIORITY_MEDIUM_IMG:
+				case EGL_CONTEXT_PRIORITY_LOW_IMG:
+					priority = attribute[1];
+					break;
+				default:
+					return error(EGL_BAD_ATTRIBUTE, EGL_NO_CONTEXT);
+				}
+				break;
 			case EGL_CONTEXT_OPENGL_RESET_NOTIFICATION_STRATEGY_KHR:
 				switch(attribute[1])
 				{
@@ -873,7 +999,7 @@ EGLContext CreateContext(EGLDisplay dpy, EGLConfig config, EGLContext share_cont
 		return error(EGL_BAD_CONTEXT, EGL_NO_CONTEXT);
 	}
 
-	return display->createContext(config, shareContext, majorVersion);
+	return display->createContext(config, shareContext, majorVersion, priority);
 }
 
 EGLBoolean DestroyContext(EGLDisplay dpy, EGLContext ctx)
@@ -932,10 +1058,10 @@ EGLBoolean MakeCurrent(EGLDisplay dpy, EGLSurface draw, EGLSurface read, EGLCont
 		return EGL_FALSE;
 	}
 
-	if((draw != EGL_NO_SURFACE && drawSurface->hasClientBuffer()) ||
-	   (read != EGL_NO_SURFACE && readSurface->hasClientBuffer()))
+	if((draw != EGL_NO_SURFACE && drawSurface->hasClientBuffer() && drawSurface->getTextureTarget() != EGL_NO_TEXTURE) ||
+	   (read != EGL_NO_SURFACE && readSurface->hasClientBuffer() && readSurface->getTextureTarget() != EGL_NO_TEXTURE))
 	{
-		// Make current is not supported on IOSurface pbuffers.
+		// Make current is not supported on IOSurface pbuffers, only on host memory ones without a texture target.
 		return error(EGL_BAD_SURFACE, EGL_FALSE);
 	}
 
@@ -1038,6 +1164,9 @@ EGLBoolean QueryContext(EGLDisplay dpy, EGLContext ctx, EGLint attribute, EGLint
 	case EGL_RENDER_BUFFER:
 		*value = EGL_BACK_BUFFER;
 		break;
+	case EGL_CONTEXT_PRIORITY_LEVEL_IMG:
+		*value = context->getPriority();
+		break;
 	default:
 		return error(EGL_BAD_ATTRIBUTE, EGL_FALSE);
 	}
@@ -1108,11 +1237,52 @@ EGLBoolean SwapBuffers(EGLDisplay dpy, EGLSurface surface)
 		return error(EGL_BAD_SURFACE, EGL_FALSE);
 	}
 
+	egl::Context *context = egl::getCurrentContext();
+
+	if(context)
+	{
+		context->endFrame();
+	}
+
 	eglSurface->swap();
 
 	return success(EGL_TRUE);
 }
 
+EGLBoolean SwapBuffersWithDamageKHR(EGLDisplay dpy, EGLSurface surface, EGLint *rects, EGLint n_rects)
+{
+	TRACE("(EGLDisplay dpy = %p, EGLSurface surface = %p, EGLint *rects = %p, EGLint n_rects = %d)", dpy, surface, rects, n_rects);
+
+	egl::Display *display = egl::Display::get(dpy);
+	egl::Surface *eglSurface = (egl::Surface*)surface;
+
+	if(!validateSurface(display, eglSurface))
+	{
+		return EGL_FALSE;
+	}
+
+	if(surface == EGL_NO_SURFACE)
+	{
+		return error(EGL_BAD_SURFACE, EGL_FALSE);
+	}
+
+	if(n_rects < 0 || (n_rects > 0 && !rects))
+	{
+		return error(EGL_BAD_PARAMETER, EGL_FALSE);
+	}
+
+	egl::Context *context = egl::getCurrentContext();
+
+	if(context)
+	{
+		context->endFrame();
+	}
+
+	eglSurface->swap(rects, n_rects);
+
+	return success(EGL_TRUE);
+}
+
 EGLBoolean CopyBuffers(EGLDisplay dpy, EGLSurface surface, EGLNativePixmapType target)
 {
 	TRACE("(EGLDisplay dpy = %p, EGLSurface surface = %p, EGLNativePixmapType target = %p)", dpy, surface, target);
@@ -1147,6 +1317,13 @@ EGLImage CreateImage(EGLDisplay dpy, EGLContext ctx, EGLenum target, EGLClientBu
 		return error(EGL_BAD_CONTEXT, EGL_NO_IMAGE_KHR);
 	}
 
+	#if defined(__linux__) && !defined(__ANDROID__)
+		if(target == EGL_LINUX_DMA_BUF_EXT)
+		{
+			return createDmaBufImage(display, ctx, buffer, attrib_list);
+		}
+	#endif
+
 	EGLenum imagePreserved = EGL_FALSE;
 	GLuint textureLevel = 0;
 	if(attrib_list)
@@ -1511,6 +1688,8 @@ __eglMustCastToProperFunctionPointerType GetProcAddress(const char *procname)
 		FUNCTION(eglReleaseThread),
 		FUNCTION(eglSurfaceAttrib),
 		FUNCTION(eglSwapBuffers),
+		FUNCTION(eglSwapBuffersWithDamageEXT),
+		FUNCTION(eglSwapBuffersWithDamageKHR),
 		FUNCTION(eglSwapInterval),
 		FUNCTION(eglTerminate),
 		FUNCTION(eglWaitClient),
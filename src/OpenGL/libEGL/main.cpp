@@ -374,6 +374,7 @@ EGLBoolean QueryContext(EGLDisplay dpy, EGLContext ctx, EGLint attribute, EGLint
 EGLBoolean WaitGL(void);
 EGLBoolean WaitNative(EGLint engine);
 EGLBoolean SwapBuffers(EGLDisplay dpy, EGLSurface surface);
+EGLBoolean SwapBuffersWithDamageKHR(EGLDisplay dpy, EGLSurface surface, EGLint *rects, EGLint n_rects);
 EGLBoolean CopyBuffers(EGLDisplay dpy, EGLSurface surface, EGLNativePixmapType target);
 EGLImageKHR CreateImageKHR(EGLDisplay dpy, EGLContext ctx, EGLenum target, EGLClientBuffer buffer, const EGLint *attrib_list);
 EGLImageKHR CreateImage(EGLDisplay dpy, EGLContext ctx, EGLenum target, EGLClientBuffer buffer, const EGLAttrib *attrib_list);
@@ -576,6 +577,18 @@ EGLAPI EGLBoolean EGLAPIENTRY eglSwapBuffers(EGLDisplay dpy, EGLSurface surface)
 	return egl::SwapBuffers(dpy, surface);
 }
 
+EGLAPI EGLBoolean EGLAPIENTRY eglSwapBuffersWithDamageKHR(EGLDisplay dpy, EGLSurface surface, EGLint *rects, EGLint n_rects)
+{
+	LockGuard lock(egl::getDisplayLock(dpy));
+	return egl::SwapBuffersWithDamageKHR(dpy, surface, rects, n_rects);
+}
+
+EGLAPI EGLBoolean EGLAPIENTRY eglSwapBuffersWithDamageEXT(EGLDisplay dpy, EGLSurface surface, EGLint *rects, EGLint n_rects)
+{
+	LockGuard lock(egl::getDisplayLock(dpy));
+	return egl::SwapBuffersWithDamageKHR(dpy, surface, rects, n_rects);
+}
+
 EGLAPI EGLBoolean EGLAPIENTRY eglCopyBuffers(EGLDisplay dpy, EGLSurface surface, EGLNativePixmapType target)
 {
 	LockGuard lock(egl::getDisplayLock(dpy));
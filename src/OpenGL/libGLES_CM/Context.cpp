@@ -198,6 +198,10 @@ Context::Context(egl::Display *const display, const Context *shareContext, const
 	lightModelTwoSide = false;
 
 	matrixMode = GL_MODELVIEW;
+	mModelViewVersion = 0;
+	mProjectionVersion = 0;
+	mTextureVersion[0] = 0;
+	mTextureVersion[1] = 0;
 
 	for(int i = 0; i < MAX_TEXTURE_UNITS; i++)
 	{
@@ -347,6 +351,8 @@ void Context::markAllStateDirty()
 	mSampleStateDirty = true;
 	mDitherStateDirty = true;
 	mFrontFaceDirty = true;
+	mLightingStateDirty = true;
+	mMatrixStateDirty = true;
 }
 
 void Context::setClearColor(float red, float green, float blue, float alpha)
@@ -621,6 +627,7 @@ bool Context::isDitherEnabled() const
 void Context::setLightingEnabled(bool enable)
 {
 	lightingEnabled = enable;
+	mLightingStateDirty = true;
 }
 
 bool Context::isLightingEnabled() const
@@ -631,6 +638,7 @@ bool Context::isLightingEnabled() const
 void Context::setLightEnabled(int index, bool enable)
 {
 	light[index].enabled = enable;
+	mLightingStateDirty = true;
 }
 
 bool Context::isLightEnabled(int index) const
@@ -641,16 +649,19 @@ bool Context::isLightEnabled(int index) const
 void Context::setLightAmbient(int index, float r, float g, float b, float a)
 {
 	light[index].ambient = {r, g, b, a};
+	mLightingStateDirty = true;
 }
 
 void Context::setLightDiffuse(int index, float r, float g, float b, float a)
 {
 	light[index].diffuse = {r, g, b, a};
+	mLightingStateDirty = true;
 }
 
 void Context::setLightSpecular(int index, float r, float g, float b, float a)
 {
 	light[index].specular = {r, g, b, a};
+	mLightingStateDirty = true;
 }
 
 void Context::setLightPosition(int index, float x, float y, float z, float w)
@@ -661,37 +672,44 @@ void Context::setLightPosition(int index, float x, float y, float z, float w)
 	v = modelViewStack.current() * v;
 
 	light[index].position = {v.x, v.y, v.z, v.w};
+	mLightingStateDirty = true;
 }
 
 void Context::setLightDirection(int index, float x, float y, float z)
 {
 	// FIXME: Transform by inverse of 3x3 model-view matrix
 	light[index].direction = {x, y, z};
+	mLightingStateDirty = true;
 }
 
 void Context::setLightAttenuationConstant(int index, float constant)
 {
 	light[index].attenuation.constant = constant;
+	mLightingStateDirty = true;
 }
 
 void Context::setLightAttenuationLinear(int index, float linear)
 {
 	light[index].attenuation.linear = linear;
+	mLightingStateDirty = true;
 }
 
 void Context::setLightAttenuationQuadratic(int index, float quadratic)
 {
 	light[index].attenuation.quadratic = quadratic;
+	mLightingStateDirty = true;
 }
 
 void Context::setSpotLightExponent(int index, float exponent)
 {
 	light[index].spotExponent = exponent;
+	mLightingStateDirty = true;
 }
 
 void Context::setSpotLightCutoff(int index, float cutoff)
 {
 	light[index].spotCutoffAngle = cutoff;
+	mLightingStateDirty = true;
 }
 
 void Context::setGlobalAmbient(float red, float green, float blue, float alpha)
@@ -700,6 +718,7 @@ void Context::setGlobalAmbient(float red, float green, float blue, float alpha)
 	globalAmbient.green = green;
 	globalAmbient.blue = blue;
 	globalAmbient.alpha = alpha;
+	mLightingStateDirty = true;
 }
 
 void Context::setMaterialAmbient(float red, float green, float blue, float alpha)
@@ -708,6 +727,7 @@ void Context::setMaterialAmbient(float red, float green, float blue, float alpha
 	materialAmbient.green = green;
 	materialAmbient.blue = blue;
 	materialAmbient.alpha = alpha;
+	mLightingStateDirty = true;
 }
 
 void Context::setMaterialDiffuse(float red, float green, float blue, float alpha)
@@ -716,6 +736,7 @@ void Context::setMaterialDiffuse(float red, float green, float blue, float alpha
 	materialDiffuse.green = green;
 	materialDiffuse.blue = blue;
 	materialDiffuse.alpha = alpha;
+	mLightingStateDirty = true;
 }
 
 void Context::setMaterialSpecular(float red, float green, float blue, float alpha)
@@ -724,6 +745,7 @@ void Context::setMaterialSpecular(float red, float green, float blue, float alph
 	materialSpecular.green = green;
 	materialSpecular.blue = blue;
 	materialSpecular.alpha = alpha;
+	mLightingStateDirty = true;
 }
 
 void Context::setMaterialEmission(float red, float green, float blue, float alpha)
@@ -732,16 +754,19 @@ void Context::setMaterialEmission(float red, float green, float blue, float alph
 	materialEmission.green = green;
 	materialEmission.blue = blue;
 	materialEmission.alpha = alpha;
+	mLightingStateDirty = true;
 }
 
 void Context::setMaterialShininess(float shininess)
 {
 	materialShininess = shininess;
+	mLightingStateDirty = true;
 }
 
 void Context::setLightModelTwoSide(bool enable)
 {
 	lightModelTwoSide = enable;
+	mLightingStateDirty = true;
 }
 
 void Context::setFogEnabled(bool enable)
@@ -1961,46 +1986,73 @@ void Context::applyState(GLenum drawMode)
 	case GL_FLAT:   device->setShadingMode(sw::SHADING_FLAT);    break;
 	}
 
-	device->setLightingEnable(lightingEnabled);
-	device->setGlobalAmbient(sw::Color<float>(globalAmbient.red, globalAmbient.green, globalAmbient.blue, globalAmbient.alpha));
-
-	for(int i = 0; i < MAX_LIGHTS; i++)
+	if(mLightingStateDirty)
 	{
-		device->setLightEnable(i, light[i].enabled);
-		device->setLightAmbient(i, sw::Color<float>(light[i].ambient.red, light[i].ambient.green, light[i].ambient.blue, light[i].ambient.alpha));
-		device->setLightDiffuse(i, sw::Color<float>(light[i].diffuse.red, light[i].diffuse.green, light[i].diffuse.blue, light[i].diffuse.alpha));
-		device->setLightSpecular(i, sw::Color<float>(light[i].specular.red, light[i].specular.green, light[i].specular.blue, light[i].specular.alpha));
-		device->setLightAttenuation(i, light[i].attenuation.constant, light[i].attenuation.linear, light[i].attenuation.quadratic);
+		device->setLightingEnable(lightingEnabled);
+		device->setGlobalAmbient(sw::Color<float>(globalAmbient.red, globalAmbient.green, globalAmbient.blue, globalAmbient.alpha));
 
-		if(light[i].position.w != 0.0f)
-		{
-			device->setLightPosition(i, sw::Point(light[i].position.x / light[i].position.w, light[i].position.y / light[i].position.w, light[i].position.z / light[i].position.w));
-		}
-		else   // Directional light
+		for(int i = 0; i < MAX_LIGHTS; i++)
 		{
-			// Hack: set the position far way
-			float max = sw::max(abs(light[i].position.x), abs(light[i].position.y), abs(light[i].position.z));
-			device->setLightPosition(i, sw::Point(1e10f * (light[i].position.x / max), 1e10f * (light[i].position.y / max), 1e10f * (light[i].position.z / max)));
+			device->setLightEnable(i, light[i].enabled);
+			device->setLightAmbient(i, sw::Color<float>(light[i].ambient.red, light[i].ambient.green, light[i].ambient.blue, light[i].ambient.alpha));
+			device->setLightDiffuse(i, sw::Color<float>(light[i].diffuse.red, light[i].diffuse.green, light[i].diffuse.blue, light[i].diffuse.alpha));
+			device->setLightSpecular(i, sw::Color<float>(light[i].specular.red, light[i].specular.green, light[i].specular.blue, light[i].specular.alpha));
+			device->setLightAttenuation(i, light[i].attenuation.constant, light[i].attenuation.linear, light[i].attenuation.quadratic);
+
+			if(light[i].position.w != 0.0f)
+			{
+				device->setLightPosition(i, sw::Point(light[i].position.x / light[i].position.w, light[i].position.y / light[i].position.w, light[i].position.z / light[i].position.w));
+			}
+			else   // Directional light
+			{
+				// Hack: set the position far way
+				float max = sw::max(abs(light[i].position.x), abs(light[i].position.y), abs(light[i].position.z));
+				device->setLightPosition(i, sw::Point(1e10f * (light[i].position.x / max), 1e10f * (light[i].position.y / max), 1e10f * (light[i].position.z / max)));
+			}
 		}
+
+		device->setMaterialAmbient(sw::Color<float>(materialAmbient.red, materialAmbient.green, materialAmbient.blue, materialAmbient.alpha));
+		device->setMaterialDiffuse(sw::Color<float>(materialDiffuse.red, materialDiffuse.green, materialDiffuse.blue, materialDiffuse.alpha));
+		device->setMaterialSpecular(sw::Color<float>(materialSpecular.red, materialSpecular.green, materialSpecular.blue, materialSpecular.alpha));
+		device->setMaterialEmission(sw::Color<float>(materialEmission.red, materialEmission.green, materialEmission.blue, materialEmission.alpha));
+		device->setMaterialShininess(materialShininess);
+
+		device->setDiffuseMaterialSource(sw::MATERIAL_MATERIAL);
+		device->setSpecularMaterialSource(sw::MATERIAL_MATERIAL);
+		device->setAmbientMaterialSource(sw::MATERIAL_MATERIAL);
+		device->setEmissiveMaterialSource(sw::MATERIAL_MATERIAL);
+
+		mLightingStateDirty = false;
+	}
+
+	// Matrices are only sent when changed, since each one invalidates the vertex processor's transform constants
+	if(mMatrixStateDirty || projectionStack.getVersion() != mProjectionVersion)
+	{
+		device->setProjectionMatrix(projectionStack.current());
+		mProjectionVersion = projectionStack.getVersion();
 	}
 
-	device->setMaterialAmbient(sw::Color<float>(materialAmbient.red, materialAmbient.green, materialAmbient.blue, materialAmbient.alpha));
-	device->setMaterialDiffuse(sw::Color<float>(materialDiffuse.red, materialDiffuse.green, materialDiffuse.blue, materialDiffuse.alpha));
-	device->setMaterialSpecular(sw::Color<float>(materialSpecular.red, materialSpecular.green, materialSpecular.blue, materialSpecular.alpha));
-	device->setMaterialEmission(sw::Color<float>(materialEmission.red, materialEmission.green, materialEmission.blue, materialEmission.alpha));
-	device->setMaterialShininess(materialShininess);
+	if(mMatrixStateDirty || modelViewStack.getVersion() != mModelViewVersion)
+	{
+		device->setModelMatrix(modelViewStack.current());
+		mModelViewVersion = modelViewStack.getVersion();
+	}
 
-	device->setDiffuseMaterialSource(sw::MATERIAL_MATERIAL);
-	device->setSpecularMaterialSource(sw::MATERIAL_MATERIAL);
-	device->setAmbientMaterialSource(sw::MATERIAL_MATERIAL);
-	device->setEmissiveMaterialSource(sw::MATERIAL_MATERIAL);
+	if(mMatrixStateDirty || textureStack0.getVersion() != mTextureVersion[0])
+	{
+		device->setTextureMatrix(0, textureStack0.current());
+		device->setTextureTransform(0, textureStack0.isIdentity() ? 0 : 4, false);
+		mTextureVersion[0] = textureStack0.getVersion();
+	}
+
+	if(mMatrixStateDirty || textureStack1.getVersion() != mTextureVersion[1])
+	{
+		device->setTextureMatrix(1, textureStack1.current());
+		device->setTextureTransform(1, textureStack1.isIdentity() ? 0 : 4, false);
+		mTextureVersion[1] = textureStack1.getVersion();
+	}
 
-	device->setProjectionMatrix(projectionStack.current());
-	device->setModelMatrix(modelViewStack.current());
-	device->setTextureMatrix(0, textureStack0.current());
-	device->setTextureMatrix(1, textureStack1.current());
-	device->setTextureTransform(0, textureStack0.isIdentity() ? 0 : 4, false);
-	device->setTextureTransform(1, textureStack1.isIdentity() ? 0 : 4, false);
+	mMatrixStateDirty = false;
 	device->setTexGen(0, sw::TEXGEN_NONE);
 	device->setTexGen(1, sw::TEXGEN_NONE);
 
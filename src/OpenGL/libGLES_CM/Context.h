@@ -638,6 +638,13 @@ private:
 	bool mSampleStateDirty;
 	bool mFrontFaceDirty;
 	bool mDitherStateDirty;
+	bool mLightingStateDirty;
+	bool mMatrixStateDirty;
+
+	// Versions of the matrix stacks last sent to the device
+	unsigned int mModelViewVersion;
+	unsigned int mProjectionVersion;
+	unsigned int mTextureVersion[2];
 
 	sw::MatrixStack &currentMatrixStack();
 	GLenum matrixMode;
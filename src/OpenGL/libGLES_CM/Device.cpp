@@ -224,7 +224,7 @@ namespace es1
 			return;
 		}
 
-		draw(type, indexOffset, primitiveCount);
+		draw(type, indexOffset, primitiveCount, false);
 	}
 
 	void Device::drawPrimitive(sw::DrawType type, unsigned int primitiveCount)
@@ -236,7 +236,7 @@ namespace es1
 
 		setIndexBuffer(nullptr);
 
-		draw(type, 0, primitiveCount);
+		draw(type, 0, primitiveCount, false);
 	}
 
 	void Device::setScissorEnable(bool enable)
@@ -50,6 +50,7 @@ COMMON_SRC_FILES := \
 	ResourceManager.cpp \
 	Shader.cpp \
 	Texture.cpp \
+	TraceRecorder.cpp \
 	TransformFeedback.cpp \
 	utilities.cpp \
 	VertexArray.cpp \
@@ -25,7 +25,7 @@
 namespace es2
 {
 
-Buffer::Buffer(GLuint name) : NamedObject(name)
+Buffer::Buffer(GLuint name) : NamedObject(name), mStoragePool(0)
 {
 	mContents = 0;
 	mSize = 0;
@@ -34,10 +34,13 @@ Buffer::Buffer(GLuint name) : NamedObject(name)
 	mOffset = 0;
 	mLength = 0;
 	mAccess = 0;
+	mPixelPackPending = false;
 }
 
 Buffer::~Buffer()
 {
+	clearIndexRanges();
+
 	if(mContents)
 	{
 		mContents->destruct();
@@ -46,19 +49,37 @@ Buffer::~Buffer()
 
 void Buffer::bufferData(const void *data, GLsizeiptr size, GLenum usage)
 {
+	const int padding = 1024;   // For SIMD processing of vertices
+	const size_t bytes = size + padding;
+
+	mSize = size;
+	mUsage = usage;
+	clearIndexRanges();
+	mPixelPackPending = false;   // The storage gets replaced, a pending pack still completes into the old one
+
 	if(mContents)
 	{
-		mContents->destruct();
+		// Storage still read by draws in flight is orphaned, never waited for
+		if(recyclesStorage() && mContents->size == bytes)
+		{
+			mStoragePool.retire(mContents);
+		}
+		else
+		{
+			mContents->destruct();
+			mStoragePool.resize(bytes);
+		}
+
 		mContents = 0;
 	}
-
-	mSize = size;
-	mUsage = usage;
+	else
+	{
+		mStoragePool.resize(bytes);
+	}
 
 	if(size > 0)
 	{
-		const int padding = 1024;   // For SIMD processing of vertices
-		mContents = new sw::Resource(size + padding);
+		mContents = mStoragePool.acquire();
 
 		if(!mContents)
 		{
@@ -77,7 +98,28 @@ void Buffer::bufferSubData(const void *data, GLsizeiptr size, GLintptr offset)
 {
 	if(mContents && data)
 	{
-		char *buffer = (char*)mContents->lock(sw::PUBLIC);
+		clearIndexRanges();
+
+		if(mPixelPackPending)
+		{
+			finishPixelPack();   // Orphaning would copy the contents before they got packed
+		}
+
+		// Updating uniform buffers between draws would otherwise wait for each of them, since
+		// they're referenced in place. The copy is bounded so large buffers keep waiting instead.
+		const GLsizeiptr maxOrphanCopy = 1024 * 1024;
+
+		if(!mContents->tryLock(sw::PUBLIC))
+		{
+			if(mSize - size <= maxOrphanCopy)
+			{
+				orphanContents(offset, size, true);
+			}
+
+			mContents->lock(sw::PUBLIC);
+		}
+
+		char *buffer = (char*)mContents->data();
 		memcpy(buffer + offset, data, size);
 		mContents->unlock();
 	}
@@ -87,7 +129,39 @@ void* Buffer::mapRange(GLintptr offset, GLsizeiptr length, GLbitfield access)
 {
 	if(mContents)
 	{
-		char* buffer = (char*)mContents->lock(sw::PUBLIC);
+		if(mPixelPackPending)
+		{
+			finishPixelPack();
+		}
+
+		if(access & GL_MAP_WRITE_BIT)
+		{
+			clearIndexRanges();
+		}
+
+		const bool invalidate = (access & (GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_INVALIDATE_RANGE_BIT)) != 0;
+		char *buffer = nullptr;
+
+		if(access & GL_MAP_UNSYNCHRONIZED_BIT)
+		{
+			// The application takes care of not modifying data which draws in flight use
+			buffer = static_cast<char*>(const_cast<void*>(mContents->data()));
+		}
+		else if(invalidate && !mContents->tryLock(sw::PUBLIC))
+		{
+			orphanContents(offset, length, !(access & GL_MAP_INVALIDATE_BUFFER_BIT));
+
+			buffer = (char*)mContents->lock(sw::PUBLIC);
+		}
+		else if(invalidate)
+		{
+			buffer = static_cast<char*>(const_cast<void*>(mContents->data()));   // Locked by tryLock()
+		}
+		else
+		{
+			buffer = (char*)mContents->lock(sw::PUBLIC);
+		}
+
 		mIsMapped = true;
 		mOffset = offset;
 		mLength = length;
@@ -99,7 +173,7 @@ void* Buffer::mapRange(GLintptr offset, GLsizeiptr length, GLbitfield access)
 
 bool Buffer::unmap()
 {
-	if(mContents)
+	if(mContents && !(mAccess & GL_MAP_UNSYNCHRONIZED_BIT))
 	{
 		mContents->unlock();
 	}
@@ -115,4 +189,126 @@ sw::Resource *Buffer::getResource()
 	return mContents;
 }
 
+void *Buffer::lockForPixelPack()
+{
+	if(!mContents)
+	{
+		return nullptr;
+	}
+
+	// Draws reading the storage lock it as well, so they wait for the pack to complete
+	clearIndexRanges();
+	mPixelPackPending = true;
+
+	return mContents->lock(sw::EXCLUSIVE);
+}
+
+void Buffer::finishPixelPack() const
+{
+	mContents->lock(sw::PUBLIC);
+	mContents->unlock();
+	mPixelPackPending = false;
+}
+
+bool Buffer::recyclesStorage() const
+{
+	// Static buffers are rarely respecified, retired storage would mostly waste memory
+	switch(mUsage)
+	{
+	case GL_STATIC_DRAW:
+	case GL_STATIC_READ:
+	case GL_STATIC_COPY:
+		return false;
+	default:
+		return true;
+	}
+}
+
+// Replaces the storage still used by draws in flight instead of waiting for them. Preserving
+// copies the contents outside of the range which is about to be written.
+void Buffer::orphanContents(GLintptr offset, GLsizeiptr length, bool preserve)
+{
+	sw::Resource *contents = recyclesStorage() ? mStoragePool.acquire() : new sw::Resource(mContents->size);
+
+	if(preserve)
+	{
+		const char *previous = static_cast<const char*>(mContents->data());
+		char *current = static_cast<char*>(const_cast<void*>(contents->data()));
+
+		memcpy(current, previous, offset);
+		memcpy(current + offset + length, previous + offset + length, mSize - (offset + length));
+	}
+
+	if(recyclesStorage())
+	{
+		mStoragePool.retire(mContents);
+	}
+	else
+	{
+		mContents->destruct();
+	}
+
+	mContents = contents;
+}
+
+const IndexRange *Buffer::getIndexRange(GLenum type, GLintptr offset, GLsizei count, bool primitiveRestart) const
+{
+	auto range = mIndexRanges.find({type, offset, count, primitiveRestart});
+
+	return (range != mIndexRanges.end()) ? &range->second : nullptr;
+}
+
+void Buffer::setIndexRange(GLenum type, GLintptr offset, GLsizei count, bool primitiveRestart, const IndexRange &range)
+{
+	const size_t maxIndexRanges = 64;   // Bounds the memory of buffers drawn with many different offsets
+
+	if(mIndexRanges.size() >= maxIndexRanges)
+	{
+		clearIndexRanges();
+	}
+
+	IndexRange &entry = mIndexRanges[{type, offset, count, primitiveRestart}];
+
+	if(entry.restartStream)
+	{
+		entry.restartStream->destruct();
+	}
+
+	entry = range;
+	entry.restartStream = nullptr;
+}
+
+void Buffer::setRestartStream(GLenum type, GLintptr offset, GLsizei count, GLenum mode, sw::Resource *stream, unsigned int primitiveCount)
+{
+	auto range = mIndexRanges.find({type, offset, count, true});
+
+	if(range == mIndexRanges.end())
+	{
+		stream->destruct();
+		return;
+	}
+
+	if(range->second.restartStream)
+	{
+		range->second.restartStream->destruct();   // Draws in flight still reading it keep it alive
+	}
+
+	range->second.restartMode = mode;
+	range->second.restartStream = stream;
+	range->second.restartPrimitiveCount = primitiveCount;
+}
+
+void Buffer::clearIndexRanges()
+{
+	for(auto &range : mIndexRanges)
+	{
+		if(range.second.restartStream)
+		{
+			range.second.restartStream->destruct();
+		}
+	}
+
+	mIndexRanges.clear();
+}
+
 }
@@ -25,10 +25,23 @@
 #include <GLES2/gl2.h>
 
 #include <cstddef>
+#include <map>
 #include <vector>
 
 namespace es2
 {
+struct IndexRange
+{
+	GLuint minIndex;
+	GLuint maxIndex;
+	std::vector<GLsizei> restartIndices;   // Only computed when primitive restart is enabled
+
+	// Indices with the restarts removed and strips, fans and loops expanded into lists, for the last mode drawn
+	GLenum restartMode;
+	sw::Resource *restartStream;
+	unsigned int restartPrimitiveCount;
+};
+
 class Buffer : public gl::NamedObject
 {
 public:
@@ -39,7 +52,7 @@ public:
 	void bufferData(const void *data, GLsizeiptr size, GLenum usage);
 	void bufferSubData(const void *data, GLsizeiptr size, GLintptr offset);
 
-	const void *data() const { return mContents ? mContents->data() : 0; }
+	const void *data() const { if(mPixelPackPending) finishPixelPack(); return mContents ? mContents->data() : 0; }
 	size_t size() const { return mSize; }
 	GLenum usage() const { return mUsage; }
 	bool isMapped() const { return mIsMapped; }
@@ -53,7 +66,43 @@ public:
 
 	sw::Resource *getResource();
 
+	// Locks the storage for a glReadPixels() completed on another thread, which unlocks it.
+	// Returns nullptr when there is no storage. Reading or writing the contents waits for it.
+	void *lockForPixelPack();
+
+	// Index ranges of earlier draws, discarded when the contents change
+	const IndexRange *getIndexRange(GLenum type, GLintptr offset, GLsizei count, bool primitiveRestart) const;
+	void setIndexRange(GLenum type, GLintptr offset, GLsizei count, bool primitiveRestart, const IndexRange &range);
+	void setRestartStream(GLenum type, GLintptr offset, GLsizei count, GLenum mode, sw::Resource *stream, unsigned int primitiveCount);   // Takes ownership
+	void contentsChanged() { clearIndexRanges(); }   // For writes which bypass bufferSubData()
+
 private:
+	struct IndexRangeKey
+	{
+		GLenum type;
+		GLintptr offset;
+		GLsizei count;
+		bool primitiveRestart;
+
+		bool operator<(const IndexRangeKey &other) const
+		{
+			if(offset != other.offset) return offset < other.offset;
+			if(count != other.count) return count < other.count;
+			if(type != other.type) return type < other.type;
+			return primitiveRestart < other.primitiveRestart;
+		}
+	};
+
+	std::map<IndexRangeKey, IndexRange> mIndexRanges;
+	void clearIndexRanges();
+
+	void finishPixelPack() const;
+	mutable bool mPixelPackPending;
+
+	bool recyclesStorage() const;
+	void orphanContents(GLintptr offset, GLsizeiptr length, bool preserve);
+	sw::ResourcePool mStoragePool;   // Orphaned storage of dynamic and streaming buffers, reused once draws are done with it
+
 	sw::Resource *mContents;
 	size_t mSize;
 	GLenum mUsage;
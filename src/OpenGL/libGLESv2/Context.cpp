@@ -30,6 +30,7 @@
 #include "Sampler.h"
 #include "Shader.h"
 #include "Texture.h"
+#include "TraceRecorder.h"
 #include "TransformFeedback.h"
 #include "VertexArray.h"
 #include "VertexDataManager.h"
@@ -37,19 +38,169 @@
 #include "libEGL/Display.h"
 #include "common/Surface.hpp"
 #include "Common/Half.hpp"
+#include "Common/Thread.hpp"
+#include "Renderer/Blitter.hpp"
 
 #include <EGL/eglext.h>
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <list>
+#include <map>
+#include <mutex>
 #include <string>
 
 namespace es2
 {
+// Process-wide thread completing glReadPixels() into pixel pack buffers, so the
+// application doesn't wait for the draws still rendering to the read buffer.
+// The pack buffer's storage stays locked until the pixels have been written,
+// which makes mapping it or drawing with it the synchronization point.
+class PixelPacker
+{
+public:
+	struct Task
+	{
+		egl::Image *source;   // Referenced until packed
+		sw::SliceRectF sRect;
+		sw::SliceRect dRect;
+		sw::Format format;
+		void *pixels;
+		int pitch;
+		int slice;
+		sw::Resource *storage;   // Locked by Buffer::lockForPixelPack()
+	};
+
+	static void schedule(const Task &task);
+	static void finish();                           // Waits for all scheduled tasks to complete
+	static void finish(const egl::Image *source);   // Waits for the tasks reading the image, scheduled by any context
+
+private:
+	PixelPacker();
+
+	static PixelPacker &get();
+	static void threadFunction(void *parameters);
+	void threadLoop();
+
+	std::mutex mutex;
+	std::condition_variable work;
+	std::condition_variable done;
+	std::list<Task> queue;
+	bool active;
+	std::map<const egl::Image*, int> pending;   // Scheduled or active tasks per source image, only compared
+
+	static std::atomic<int> pendingTasks;   // Lets draws skip the lock while nothing is being packed
+
+	sw::Blitter *blitter;   // Not the context's, which may get destroyed while packing
+	sw::Thread *thread;
+};
+
+std::atomic<int> PixelPacker::pendingTasks(0);
+
+PixelPacker::PixelPacker() : active(false)
+{
+	blitter = new sw::Blitter();
+	thread = new sw::Thread(threadFunction, this);
+}
+
+PixelPacker &PixelPacker::get()
+{
+	static PixelPacker *packer = new PixelPacker();   // Its thread may outlive any context
+
+	return *packer;
+}
+
+void PixelPacker::schedule(const Task &task)
+{
+	PixelPacker &packer = get();
+
+	task.source->addRef();
+
+	std::lock_guard<std::mutex> lock(packer.mutex);
+	packer.queue.push_back(task);
+	packer.pending[task.source]++;
+	pendingTasks++;
+	packer.work.notify_one();
+}
+
+void PixelPacker::finish()
+{
+	if(pendingTasks == 0)
+	{
+		return;
+	}
+
+	PixelPacker &packer = get();
+
+	std::unique_lock<std::mutex> lock(packer.mutex);
+	packer.done.wait(lock, [&packer]() { return packer.queue.empty() && !packer.active; });
+}
+
+void PixelPacker::finish(const egl::Image *source)
+{
+	if(pendingTasks == 0 || !source)
+	{
+		return;
+	}
+
+	PixelPacker &packer = get();
+
+	std::unique_lock<std::mutex> lock(packer.mutex);
+	packer.done.wait(lock, [&packer, source]() { return packer.pending.find(source) == packer.pending.end(); });
+}
+
+void PixelPacker::threadFunction(void *parameters)
+{
+	static_cast<PixelPacker*>(parameters)->threadLoop();
+}
+
+void PixelPacker::threadLoop()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while(true)
+	{
+		work.wait(lock, [this]() { return !queue.empty(); });
+
+		Task task = queue.front();
+		queue.pop_front();
+		active = true;
+
+		lock.unlock();
+
+		sw::Surface *externalSurface = sw::Surface::create(task.dRect.x1, task.dRect.y1, 1, task.format, task.pixels, task.pitch, task.slice);
+		blitter->blit(task.source, task.sRect, externalSurface, task.dRect, {false, false, false});
+		externalSurface->lockExternal(0, 0, 0, sw::LOCK_READONLY, sw::PUBLIC);
+		externalSurface->unlockExternal();
+		delete externalSurface;
+
+		task.storage->unlock();
+
+		lock.lock();
+		active = false;
+
+		if(--pending[task.source] == 0)
+		{
+			pending.erase(task.source);
+		}
+
+		pendingTasks--;
+		done.notify_all();
+
+		// Released after the bookkeeping, so a new image can't reuse the address while it's still pending
+		lock.unlock();
+		task.source->release();
+		lock.lock();
+	}
+}
+
 Context::Context(egl::Display *display, const Context *shareContext, const egl::Config *config)
 	: egl::Context(display), config(config)
 {
 	sw::Context *context = new sw::Context();
 	device = new es2::Device(context);
+	priority = EGL_CONTEXT_PRIORITY_MEDIUM_IMG;
 
 	setClearColor(0.0f, 0.0f, 0.0f, 0.0f);
 
@@ -101,6 +252,7 @@ Context::Context(egl::Display *display, const Context *shareContext, const egl::
 	mState.generateMipmapHint = GL_DONT_CARE;
 	mState.fragmentShaderDerivativeHint = GL_DONT_CARE;
 	mState.textureFilteringHint = GL_DONT_CARE;
+	mState.maxShaderCompilerThreads = 0xFFFFFFFF;   // No limit requested
 
 	mState.lineWidth = 1.0f;
 
@@ -173,6 +325,8 @@ Context::Context(egl::Display *display, const Context *shareContext, const egl::
 	mInvalidFramebufferOperation = false;
 
 	mHasBeenCurrent = false;
+	mSurfaceRenderTarget = nullptr;
+	mSurfaceDepthStencil = nullptr;
 
 	markAllStateDirty();
 }
@@ -232,6 +386,9 @@ Context::~Context()
 		mState.activeQuery[i] = nullptr;
 	}
 
+	device->setConditionalQuery(nullptr);
+	mState.conditionalQuery = nullptr;
+
 	mState.arrayBuffer = nullptr;
 	mState.copyReadBuffer = nullptr;
 	mState.copyWriteBuffer = nullptr;
@@ -266,6 +423,31 @@ Context::~Context()
 
 void Context::makeCurrent(gl::Surface *surface)
 {
+	egl::Image *defaultRenderTarget = surface ? surface->getRenderTarget() : nullptr;
+	egl::Image *depthStencil = surface ? surface->getDepthStencil() : nullptr;
+
+	// The device belongs to this context, so its applied state is still valid. Unless the
+	// surface's buffers changed, switching back to the context leaves everything in place.
+	if(mHasBeenCurrent && defaultRenderTarget == mSurfaceRenderTarget && depthStencil == mSurfaceDepthStencil)
+	{
+		if(defaultRenderTarget)
+		{
+			defaultRenderTarget->release();
+		}
+
+		if(depthStencil)
+		{
+			depthStencil->release();
+		}
+
+		if(TraceRecorder::enabled())
+		{
+			TraceRecorder::makeCurrent(surface ? surface->getWidth() : 0, surface ? surface->getHeight() : 0);
+		}
+
+		return;
+	}
+
 	if(!mHasBeenCurrent)
 	{
 		mVertexDataManager = new VertexDataManager(this);
@@ -284,12 +466,12 @@ void Context::makeCurrent(gl::Surface *surface)
 		mHasBeenCurrent = true;
 	}
 
+	mSurfaceRenderTarget = defaultRenderTarget;
+	mSurfaceDepthStencil = depthStencil;
+
 	if(surface)
 	{
 		// Wrap the existing resources into GL objects and assign them to the '0' names
-		egl::Image *defaultRenderTarget = surface->getRenderTarget();
-		egl::Image *depthStencil = surface->getDepthStencil();
-
 		Colorbuffer *colorbufferZero = new Colorbuffer(defaultRenderTarget);
 		DepthStencilbuffer *depthStencilbufferZero = new DepthStencilbuffer(depthStencil);
 		Framebuffer *framebufferZero = new DefaultFramebuffer(colorbufferZero, depthStencilbufferZero);
@@ -312,6 +494,11 @@ void Context::makeCurrent(gl::Surface *surface)
 	}
 
 	markAllStateDirty();
+
+	if(TraceRecorder::enabled())
+	{
+		TraceRecorder::makeCurrent(surface ? surface->getWidth() : 0, surface ? surface->getHeight() : 0);
+	}
 }
 
 EGLint Context::getClientVersion() const
@@ -324,10 +511,29 @@ EGLint Context::getConfigID() const
 	return config->mConfigID;
 }
 
+void Context::setPriority(EGLint priority)
+{
+	switch(priority)
+	{
+	case EGL_CONTEXT_PRIORITY_HIGH_IMG:   device->setPriority(sw::Renderer::PRIORITY_HIGH);   break;
+	case EGL_CONTEXT_PRIORITY_MEDIUM_IMG: device->setPriority(sw::Renderer::PRIORITY_MEDIUM); break;
+	case EGL_CONTEXT_PRIORITY_LOW_IMG:    device->setPriority(sw::Renderer::PRIORITY_LOW);    break;
+	default: UNREACHABLE(priority);
+	}
+
+	this->priority = priority;
+}
+
+EGLint Context::getPriority() const
+{
+	return priority;
+}
+
 // This function will set all of the state-related dirty flags, so that all state is set during next pre-draw.
 void Context::markAllStateDirty()
 {
 	mAppliedProgramSerial = 0;
+	markSamplerStateDirty();
 
 	mDepthStateDirty = true;
 	mMaskStateDirty = true;
@@ -339,6 +545,15 @@ void Context::markAllStateDirty()
 	mFrontFaceDirty = true;
 }
 
+void Context::markSamplerStateDirty()
+{
+	for(int sampler = 0; sampler < MAX_COMBINED_TEXTURE_IMAGE_UNITS; sampler++)
+	{
+		mAppliedTextureSerial[sampler] = 0;
+		mAppliedSamplerSerial[sampler] = 0;
+	}
+}
+
 void Context::setClearColor(float red, float green, float blue, float alpha)
 {
 	mState.colorClearValue.red = red;
@@ -678,9 +893,24 @@ void Context::setFragmentShaderDerivativeHint(GLenum hint)
 
 void Context::setTextureFilteringHint(GLenum hint)
 {
+	if(hint != mState.textureFilteringHint)
+	{
+		markSamplerStateDirty();
+	}
+
 	mState.textureFilteringHint = hint;
 }
 
+void Context::setMaxShaderCompilerThreads(GLuint count)
+{
+	mState.maxShaderCompilerThreads = count;
+}
+
+GLuint Context::getMaxShaderCompilerThreads() const
+{
+	return mState.maxShaderCompilerThreads;
+}
+
 void Context::setViewportParams(GLint x, GLint y, GLsizei width, GLsizei height)
 {
 	mState.viewportX = x;
@@ -847,6 +1077,11 @@ const VertexAttributeArray &Context::getVertexArrayAttributes()
 	return getCurrentVertexArray()->getVertexAttributes();
 }
 
+const TranslatedAttribute *Context::getVertexArrayTranslation()
+{
+	return getCurrentVertexArray()->getTranslatedAttributes();
+}
+
 const VertexAttributeArray &Context::getCurrentVertexAttributes()
 {
 	return mState.vertexAttribute;
@@ -1072,9 +1307,9 @@ void Context::deleteTransformFeedback(GLuint transformFeedback)
 	TransformFeedback *transformFeedbackObject = mTransformFeedbackNameSpace.remove(transformFeedback);
 
 	// Detach if currently bound.
-	if(mState.transformFeedback == transformFeedback)
-	{
-		mState.transformFeedback = 0;
+	if(mState.transformFeedback == transformFeedback)
+	{
+		mState.transformFeedback = 0;
 	}
 
 	if(transformFeedbackObject)
@@ -1387,6 +1622,12 @@ void Context::beginQuery(GLenum target, GLuint query)
 		return error(GL_INVALID_OPERATION);
 	}
 
+	// From NV_conditional_render: the query used for conditional rendering can't be restarted
+	if(queryObject == mState.conditionalQuery)
+	{
+		return error(GL_INVALID_OPERATION);
+	}
+
 	// Set query as active for specified target
 	mState.activeQuery[qType] = queryObject;
 
@@ -1418,6 +1659,61 @@ void Context::endQuery(GLenum target)
 	mState.activeQuery[qType] = nullptr;
 }
 
+void Context::beginConditionalRender(GLuint query, GLenum mode)
+{
+	Query *queryObject = getQuery(query);
+
+	if(!queryObject)
+	{
+		return error(GL_INVALID_VALUE);
+	}
+
+	if(mState.conditionalQuery)
+	{
+		return error(GL_INVALID_OPERATION);
+	}
+
+	switch(queryObject->getType())
+	{
+	case GL_ANY_SAMPLES_PASSED_EXT:
+	case GL_ANY_SAMPLES_PASSED_CONSERVATIVE_EXT:
+		break;
+	default:
+		return error(GL_INVALID_OPERATION);
+	}
+
+	for(int i = 0; i < QUERY_TYPE_COUNT; i++)
+	{
+		if(mState.activeQuery[i] == queryObject)
+		{
+			return error(GL_INVALID_OPERATION);
+		}
+	}
+
+	mState.conditionalQuery = queryObject;
+
+	// The renderer decides once the draw calls counted by the query are done, without stalling
+	// the application, so the wait and no-wait modes behave the same and regions are not tracked
+	device->setConditionalQuery(queryObject->getQuery());
+}
+
+void Context::endConditionalRender()
+{
+	if(!mState.conditionalQuery)
+	{
+		return error(GL_INVALID_OPERATION);
+	}
+
+	device->setConditionalQuery(nullptr);
+	mState.conditionalQuery = nullptr;
+}
+
+bool Context::conditionalRenderPassed()
+{
+	// Clears are performed by the application thread, so they have to wait for the result
+	return !mState.conditionalQuery || mState.conditionalQuery->getResult() != GL_FALSE;
+}
+
 void Context::setFramebufferZero(Framebuffer *buffer)
 {
 	delete mFramebufferNameSpace.remove(0);
@@ -1933,6 +2229,7 @@ template<typename T> bool Context::getIntegerv(GLenum pname, T *params) const
 	case GL_GENERATE_MIPMAP_HINT:             *params = mState.generateMipmapHint;            return true;
 	case GL_FRAGMENT_SHADER_DERIVATIVE_HINT_OES: *params = mState.fragmentShaderDerivativeHint; return true;
 	case GL_TEXTURE_FILTERING_HINT_CHROMIUM:  *params = mState.textureFilteringHint;          return true;
+	case GL_MAX_SHADER_COMPILER_THREADS_KHR:  *params = sw::clampToSignedInt(mState.maxShaderCompilerThreads); return true;
 	case GL_ACTIVE_TEXTURE:                   *params = (mState.activeSampler + GL_TEXTURE0); return true;
 	case GL_STENCIL_FUNC:                     *params = mState.stencilFunc;                   return true;
 	case GL_STENCIL_REF:                      *params = mState.stencilRef;                    return true;
@@ -2308,8 +2605,8 @@ template<typename T> bool Context::getIntegerv(GLenum pname, T *params) const
 		*params = mState.pixelUnpackBuffer.name();
 		return true;
 	case GL_PROGRAM_BINARY_FORMATS:
-		// Since NUM_PROGRAM_BINARY_FORMATS is 0, the input
-		// should be a 0 sized array, so don't write to params
+		static_assert(NUM_PROGRAM_BINARY_FORMATS == 1, "Update the program binary formats query");
+		params[0] = PROGRAM_BINARY_FORMAT_SWIFTSHADER;
 		return true;
 	case GL_READ_BUFFER:
 		{
@@ -2506,6 +2803,7 @@ bool Context::getQueryParameterInfo(GLenum pname, GLenum *type, unsigned int *nu
 	case GL_GENERATE_MIPMAP_HINT:
 	case GL_FRAGMENT_SHADER_DERIVATIVE_HINT_OES:
 	case GL_TEXTURE_FILTERING_HINT_CHROMIUM:
+	case GL_MAX_SHADER_COMPILER_THREADS_KHR:
 	case GL_RED_BITS:
 	case GL_GREEN_BITS:
 	case GL_BLUE_BITS:
@@ -2738,6 +3036,7 @@ bool Context::applyRenderTarget()
 		{
 			egl::Image *renderTarget = framebuffer->getRenderTarget(i);
 			GLint layer = framebuffer->getColorbufferLayer(i);
+			finishPixelPacks(renderTarget);
 			device->setRenderTarget(i, renderTarget, layer);
 			if(renderTarget) renderTarget->release();
 		}
@@ -2996,11 +3295,11 @@ void Context::applyState(GLenum drawMode)
 	device->setRasterizerDiscard(mState.rasterizerDiscardEnabled);
 }
 
-GLenum Context::applyVertexBuffer(GLint base, GLint first, GLsizei count, GLsizei instanceId)
+GLenum Context::applyVertexBuffer(GLint base, GLint first, GLsizei count, GLsizei instanceCount)
 {
 	TranslatedAttribute attributes[MAX_VERTEX_ATTRIBS];
 
-	GLenum err = mVertexDataManager->prepareVertexData(first, count, attributes, instanceId);
+	GLenum err = mVertexDataManager->prepareVertexData(first, count, attributes, instanceCount);
 	if(err != GL_NO_ERROR)
 	{
 		return err;
@@ -3029,6 +3328,8 @@ GLenum Context::applyVertexBuffer(GLint base, GLint first, GLsizei count, GLsize
 		attribute.type = attributes[i].type;
 		attribute.count = attributes[i].count;
 		attribute.normalized = attributes[i].normalized;
+		attribute.divisor = attributes[i].divisor;
+		attribute.instanceStride = attributes[i].instanceStride;
 
 		int stream = program->getAttributeStream(i);
 		device->setInputStream(stream, attribute);
@@ -3096,88 +3397,108 @@ void Context::applyTextures(sw::SamplerType samplerType)
 
 			if(texture->isSamplerComplete(samplerObject))
 			{
-				GLenum wrapS, wrapT, wrapR, minFilter, magFilter, compFunc, compMode;
-				GLfloat minLOD, maxLOD, maxAnisotropy;
+				int sampler = (samplerType == sw::SAMPLER_PIXEL) ? samplerIndex : MAX_TEXTURE_IMAGE_UNITS + samplerIndex;
+				unsigned int textureSerial = texture->getParameterSerial();
+				unsigned int samplerSerial = samplerObject ? samplerObject->getSerial() : 0;
 
-				if(samplerObject)
+				// Skip reconverting and setting the parameters when neither object changed since
+				if(textureSerial != mAppliedTextureSerial[sampler] || samplerSerial != mAppliedSamplerSerial[sampler])
 				{
-					wrapS = samplerObject->getWrapS();
-					wrapT = samplerObject->getWrapT();
-					wrapR = samplerObject->getWrapR();
-					minFilter = samplerObject->getMinFilter();
-					magFilter = samplerObject->getMagFilter();
-					minLOD = samplerObject->getMinLod();
-					maxLOD = samplerObject->getMaxLod();
-					compFunc = samplerObject->getCompareFunc();
-					compMode = samplerObject->getCompareMode();
-					maxAnisotropy = samplerObject->getMaxAnisotropy();
-				}
-				else
-				{
-					wrapS = texture->getWrapS();
-					wrapT = texture->getWrapT();
-					wrapR = texture->getWrapR();
-					minFilter = texture->getMinFilter();
-					magFilter = texture->getMagFilter();
-					minLOD = texture->getMinLOD();
-					maxLOD = texture->getMaxLOD();
-					compFunc = texture->getCompareFunc();
-					compMode = texture->getCompareMode();
-					maxAnisotropy = texture->getMaxAnisotropy();
+					applySamplerState(samplerType, samplerIndex, texture, samplerObject);
+
+					mAppliedTextureSerial[sampler] = textureSerial;
+					mAppliedSamplerSerial[sampler] = samplerSerial;
 				}
 
-				GLint baseLevel = texture->getBaseLevel();
-				GLint maxLevel = texture->getMaxLevel();
-				GLenum swizzleR = texture->getSwizzleR();
-				GLenum swizzleG = texture->getSwizzleG();
-				GLenum swizzleB = texture->getSwizzleB();
-				GLenum swizzleA = texture->getSwizzleA();
-
-				device->setAddressingModeU(samplerType, samplerIndex, es2sw::ConvertTextureWrap(wrapS));
-				device->setAddressingModeV(samplerType, samplerIndex, es2sw::ConvertTextureWrap(wrapT));
-				device->setAddressingModeW(samplerType, samplerIndex, es2sw::ConvertTextureWrap(wrapR));
-				device->setCompareFunc(samplerType, samplerIndex, es2sw::ConvertCompareFunc(compFunc, compMode));
-				device->setSwizzleR(samplerType, samplerIndex, es2sw::ConvertSwizzleType(swizzleR));
-				device->setSwizzleG(samplerType, samplerIndex, es2sw::ConvertSwizzleType(swizzleG));
-				device->setSwizzleB(samplerType, samplerIndex, es2sw::ConvertSwizzleType(swizzleB));
-				device->setSwizzleA(samplerType, samplerIndex, es2sw::ConvertSwizzleType(swizzleA));
-				device->setMinLod(samplerType, samplerIndex, minLOD);
-				device->setMaxLod(samplerType, samplerIndex, maxLOD);
-				device->setBaseLevel(samplerType, samplerIndex, baseLevel);
-				device->setMaxLevel(samplerType, samplerIndex, maxLevel);
-				device->setTextureFilter(samplerType, samplerIndex, es2sw::ConvertTextureFilter(minFilter, magFilter, maxAnisotropy));
-				device->setMipmapFilter(samplerType, samplerIndex, es2sw::ConvertMipMapFilter(minFilter));
-				device->setMaxAnisotropy(samplerType, samplerIndex, maxAnisotropy);
-				device->setHighPrecisionFiltering(samplerType, samplerIndex, mState.textureFilteringHint == GL_NICEST);
 				device->setSyncRequired(samplerType, samplerIndex, texture->requiresSync());
 
-				applyTexture(samplerType, samplerIndex, texture);
+				applyTexture(samplerType, samplerIndex, texture, samplerObject);
 			}
 			else
 			{
-				applyTexture(samplerType, samplerIndex, nullptr);
+				applyTexture(samplerType, samplerIndex, nullptr, nullptr);
 			}
 		}
 		else
 		{
-			applyTexture(samplerType, samplerIndex, nullptr);
+			applyTexture(samplerType, samplerIndex, nullptr, nullptr);
 		}
 	}
 }
 
-void Context::applyTexture(sw::SamplerType type, int index, Texture *baseTexture)
+void Context::applySamplerState(sw::SamplerType samplerType, int samplerIndex, Texture *texture, Sampler *samplerObject)
+{
+	GLenum wrapS, wrapT, wrapR, minFilter, magFilter, compFunc, compMode;
+	GLfloat minLOD, maxLOD, maxAnisotropy;
+
+	if(samplerObject)
+	{
+		wrapS = samplerObject->getWrapS();
+		wrapT = samplerObject->getWrapT();
+		wrapR = samplerObject->getWrapR();
+		minFilter = samplerObject->getMinFilter();
+		magFilter = samplerObject->getMagFilter();
+		minLOD = samplerObject->getMinLod();
+		maxLOD = samplerObject->getMaxLod();
+		compFunc = samplerObject->getCompareFunc();
+		compMode = samplerObject->getCompareMode();
+		maxAnisotropy = samplerObject->getMaxAnisotropy();
+	}
+	else
+	{
+		wrapS = texture->getWrapS();
+		wrapT = texture->getWrapT();
+		wrapR = texture->getWrapR();
+		minFilter = texture->getMinFilter();
+		magFilter = texture->getMagFilter();
+		minLOD = texture->getMinLOD();
+		maxLOD = texture->getMaxLOD();
+		compFunc = texture->getCompareFunc();
+		compMode = texture->getCompareMode();
+		maxAnisotropy = texture->getMaxAnisotropy();
+	}
+
+	GLint baseLevel = texture->getBaseLevel();
+	GLint maxLevel = texture->getMaxLevel();
+	GLenum swizzleR = texture->getSwizzleR();
+	GLenum swizzleG = texture->getSwizzleG();
+	GLenum swizzleB = texture->getSwizzleB();
+	GLenum swizzleA = texture->getSwizzleA();
+
+	device->setAddressingModeU(samplerType, samplerIndex, es2sw::ConvertTextureWrap(wrapS));
+	device->setAddressingModeV(samplerType, samplerIndex, es2sw::ConvertTextureWrap(wrapT));
+	device->setAddressingModeW(samplerType, samplerIndex, es2sw::ConvertTextureWrap(wrapR));
+	device->setCompareFunc(samplerType, samplerIndex, es2sw::ConvertCompareFunc(compFunc, compMode));
+	device->setSwizzleR(samplerType, samplerIndex, es2sw::ConvertSwizzleType(swizzleR));
+	device->setSwizzleG(samplerType, samplerIndex, es2sw::ConvertSwizzleType(swizzleG));
+	device->setSwizzleB(samplerType, samplerIndex, es2sw::ConvertSwizzleType(swizzleB));
+	device->setSwizzleA(samplerType, samplerIndex, es2sw::ConvertSwizzleType(swizzleA));
+	device->setMinLod(samplerType, samplerIndex, minLOD);
+	device->setMaxLod(samplerType, samplerIndex, maxLOD);
+	device->setBaseLevel(samplerType, samplerIndex, baseLevel);
+	device->setMaxLevel(samplerType, samplerIndex, maxLevel);
+	device->setTextureFilter(samplerType, samplerIndex, es2sw::ConvertTextureFilter(minFilter, magFilter, maxAnisotropy));
+	device->setMipmapFilter(samplerType, samplerIndex, es2sw::ConvertMipMapFilter(minFilter));
+	device->setMaxAnisotropy(samplerType, samplerIndex, maxAnisotropy);
+	device->setHighPrecisionFiltering(samplerType, samplerIndex, mState.textureFilteringHint == GL_NICEST);
+}
+
+void Context::applyTexture(sw::SamplerType type, int index, Texture *baseTexture, Sampler *samplerObject)
 {
 	Program *program = getCurrentProgram();
 	int sampler = (type == sw::SAMPLER_PIXEL) ? index : 16 + index;
 	bool textureUsed = false;
+	bool sizeQueried = false;
 
 	if(type == sw::SAMPLER_PIXEL)
 	{
 		textureUsed = program->getPixelShader()->usesSampler(index);
+		sizeQueried = program->getPixelShader()->queriesSamplerSize(index);
 	}
 	else if(type == sw::SAMPLER_VERTEX)
 	{
 		textureUsed = program->getVertexShader()->usesSampler(index);
+		sizeQueried = program->getVertexShader()->queriesSamplerSize(index);
 	}
 	else UNREACHABLE(type);
 
@@ -3204,6 +3525,13 @@ void Context::applyTexture(sw::SamplerType type, int index, Texture *baseTexture
 			{
 				Texture2D *texture = static_cast<Texture2D*>(baseTexture);
 
+				// Without mipmap filtering only the base level is sampled, so the others
+				// don't get bound, which would generate and allocate them.
+				if(!baseTexture->isMipmapFiltered(samplerObject) && !sizeQueried)
+				{
+					maxLevel = baseLevel;
+				}
+
 				for(int mipmapLevel = 0; mipmapLevel < sw::MIPMAP_LEVELS; mipmapLevel++)
 				{
 					int surfaceLevel = mipmapLevel + baseLevel;
@@ -3312,8 +3640,6 @@ void Context::readPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum
 	GLsizei outputWidth = (mState.packParameters.rowLength > 0) ? mState.packParameters.rowLength : width;
 	GLsizei outputPitch = gl::ComputePitch(outputWidth, format, type, mState.packParameters.alignment);
 	GLsizei outputHeight = (mState.packParameters.imageHeight == 0) ? height : mState.packParameters.imageHeight;
-	pixels = getPixelPackBuffer() ? (unsigned char*)getPixelPackBuffer()->data() + (ptrdiff_t)pixels : (unsigned char*)pixels;
-	pixels = ((char*)pixels) + gl::ComputePackingOffset(format, type, outputWidth, outputHeight, mState.packParameters);
 
 	// Sized query sanity check
 	if(bufSize)
@@ -3349,6 +3675,49 @@ void Context::readPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum
 	sw::SliceRect dstRect(0, 0, width, height, 0);
 	srcRect.clip(0.0f, 0.0f, (float)renderTarget->getWidth(), (float)renderTarget->getHeight());
 
+	// Color renderbuffers only get written by draws, clears and blits, which wait for the readbacks
+	// of their render targets, whichever context of the share group scheduled them. Texture images
+	// can also be written by uploads, so they're read here.
+	GLenum readBufferType = framebuffer->getReadBufferType();
+	bool deferred = getPixelPackBuffer() && format != GL_DEPTH_COMPONENT && format != GL_DEPTH_STENCIL_OES && format != GL_STENCIL_INDEX_OES &&
+	                (readBufferType == GL_RENDERBUFFER || readBufferType == GL_FRAMEBUFFER_DEFAULT) &&
+	                renderTarget->isChildOf(nullptr) && !renderTarget->isShared() && renderTarget->getMultiSampleCount() <= 1;
+
+	size_t packingOffset = gl::ComputePackingOffset(format, type, outputWidth, outputHeight, mState.packParameters);
+	void *packStorage = nullptr;
+
+	if(deferred)
+	{
+		packStorage = getPixelPackBuffer()->lockForPixelPack();
+		deferred = (packStorage != nullptr);
+	}
+
+	if(deferred)
+	{
+		PixelPacker::Task task;
+		task.source = renderTarget;
+		task.sRect = srcRect;
+		task.dRect = dstRect;
+		task.format = es2::ConvertReadFormatType(format, type);
+		task.pixels = (char*)packStorage + (ptrdiff_t)pixels + packingOffset;
+		task.pitch = outputPitch;
+		task.slice = outputPitch * outputHeight;
+		task.storage = getPixelPackBuffer()->getResource();
+
+		PixelPacker::schedule(task);
+
+		renderTarget->release();
+		return;
+	}
+
+	if(getPixelPackBuffer())
+	{
+		getPixelPackBuffer()->contentsChanged();
+	}
+
+	pixels = getPixelPackBuffer() ? (unsigned char*)getPixelPackBuffer()->data() + (ptrdiff_t)pixels : (unsigned char*)pixels;
+	pixels = ((char*)pixels) + packingOffset;
+
 	if(format != GL_DEPTH_STENCIL_OES)   // The blitter only handles reading either depth or stencil.
 	{
 		sw::Surface *externalSurface = sw::Surface::create(width, height, 1, es2::ConvertReadFormatType(format, type), pixels, outputPitch, outputPitch  *  outputHeight);
@@ -3413,7 +3782,7 @@ void Context::readPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum
 
 void Context::clear(GLbitfield mask)
 {
-	if(mState.rasterizerDiscardEnabled)
+	if(mState.rasterizerDiscardEnabled || !conditionalRenderPassed())
 	{
 		return;
 	}
@@ -3462,7 +3831,7 @@ void Context::clear(GLbitfield mask)
 void Context::clearColorBuffer(GLint drawbuffer, void *value, sw::Format format)
 {
 	unsigned int rgbaMask = getColorMask();
-	if(rgbaMask && !mState.rasterizerDiscardEnabled)
+	if(rgbaMask && !mState.rasterizerDiscardEnabled && conditionalRenderPassed())
 	{
 		Framebuffer *framebuffer = getDrawFramebuffer();
 		if(!framebuffer || (framebuffer->completeness() != GL_FRAMEBUFFER_COMPLETE))
@@ -3480,6 +3849,7 @@ void Context::clearColorBuffer(GLint drawbuffer, void *value, sw::Format format)
 				clearRect.clip(mState.scissorX, mState.scissorY, mState.scissorX + mState.scissorWidth, mState.scissorY + mState.scissorHeight);
 			}
 
+			finishPixelPacks(colorbuffer);
 			device->clear(value, format, colorbuffer, clearRect, rgbaMask);
 
 			colorbuffer->release();
@@ -3504,7 +3874,7 @@ void Context::clearColorBuffer(GLint drawbuffer, const GLfloat *value)
 
 void Context::clearDepthBuffer(const GLfloat value)
 {
-	if(mState.depthMask && !mState.rasterizerDiscardEnabled)
+	if(mState.depthMask && !mState.rasterizerDiscardEnabled && conditionalRenderPassed())
 	{
 		Framebuffer *framebuffer = getDrawFramebuffer();
 		if(!framebuffer || (framebuffer->completeness() != GL_FRAMEBUFFER_COMPLETE))
@@ -3532,7 +3902,7 @@ void Context::clearDepthBuffer(const GLfloat value)
 
 void Context::clearStencilBuffer(const GLint value)
 {
-	if(mState.stencilWritemask && !mState.rasterizerDiscardEnabled)
+	if(mState.stencilWritemask && !mState.rasterizerDiscardEnabled && conditionalRenderPassed())
 	{
 		Framebuffer *framebuffer = getDrawFramebuffer();
 		if(!framebuffer || (framebuffer->completeness() != GL_FRAMEBUFFER_COMPLETE))
@@ -3579,40 +3949,40 @@ void Context::drawArrays(GLenum mode, GLint first, GLsizei count, GLsizei instan
 		return error(GL_INVALID_ENUM);
 	}
 
+	if(instanceCount <= 0)
+	{
+		return;
+	}
+
 	applyState(mode);
 
-	for(int i = 0; i < instanceCount; ++i)
+	GLenum err = applyVertexBuffer(0, first, count, instanceCount);
+	if(err != GL_NO_ERROR)
 	{
-		device->setInstanceID(i);
-
-		GLenum err = applyVertexBuffer(0, first, count, i);
-		if(err != GL_NO_ERROR)
-		{
-			return error(err);
-		}
+		return error(err);
+	}
 
-		applyShaders();
-		applyTextures();
+	applyShaders();
+	applyTextures();
 
-		if(!getCurrentProgram()->validateSamplers(false))
-		{
-			return error(GL_INVALID_OPERATION);
-		}
+	if(!getCurrentProgram()->validateSamplers(false))
+	{
+		return error(GL_INVALID_OPERATION);
+	}
 
-		if(primitiveCount <= 0)
-		{
-			return;
-		}
+	if(primitiveCount <= 0)
+	{
+		return;
+	}
 
-		TransformFeedback* transformFeedback = getTransformFeedback();
-		if(!cullSkipsDraw(mode) || (transformFeedback->isActive() && !transformFeedback->isPaused()))
-		{
-			device->drawPrimitive(primitiveType, primitiveCount);
-		}
-		if(transformFeedback)
-		{
-			transformFeedback->addVertexOffset(primitiveCount * verticesPerPrimitive);
-		}
+	TransformFeedback* transformFeedback = getTransformFeedback();
+	if(!cullSkipsDraw(mode) || (transformFeedback->isActive() && !transformFeedback->isPaused()))
+	{
+		device->drawPrimitive(primitiveType, primitiveCount, instanceCount);
+	}
+	if(transformFeedback)
+	{
+		transformFeedback->addVertexOffset(primitiveCount * verticesPerPrimitive * instanceCount);
 	}
 }
 
@@ -3667,41 +4037,41 @@ void Context::drawElements(GLenum mode, GLuint start, GLuint end, GLsizei count,
 		return error(err);
 	}
 
+	if(instanceCount <= 0)
+	{
+		return;
+	}
+
 	applyState(internalMode);
 
-	for(int i = 0; i < instanceCount; ++i)
+	GLsizei vertexCount = indexInfo.maxIndex - indexInfo.minIndex + 1;
+	err = applyVertexBuffer(-(int)indexInfo.minIndex, indexInfo.minIndex, vertexCount, instanceCount);
+	if(err != GL_NO_ERROR)
 	{
-		device->setInstanceID(i);
-
-		GLsizei vertexCount = indexInfo.maxIndex - indexInfo.minIndex + 1;
-		err = applyVertexBuffer(-(int)indexInfo.minIndex, indexInfo.minIndex, vertexCount, i);
-		if(err != GL_NO_ERROR)
-		{
-			return error(err);
-		}
+		return error(err);
+	}
 
-		applyShaders();
-		applyTextures();
+	applyShaders();
+	applyTextures();
 
-		if(!getCurrentProgram()->validateSamplers(false))
-		{
-			return error(GL_INVALID_OPERATION);
-		}
+	if(!getCurrentProgram()->validateSamplers(false))
+	{
+		return error(GL_INVALID_OPERATION);
+	}
 
-		if(primitiveCount <= 0)
-		{
-			return;
-		}
+	if(primitiveCount <= 0)
+	{
+		return;
+	}
 
-		TransformFeedback* transformFeedback = getTransformFeedback();
-		if(!cullSkipsDraw(internalMode) || (transformFeedback->isActive() && !transformFeedback->isPaused()))
-		{
-			device->drawIndexedPrimitive(primitiveType, indexInfo.indexOffset, indexInfo.primitiveCount);
-		}
-		if(transformFeedback)
-		{
-			transformFeedback->addVertexOffset(indexInfo.primitiveCount * verticesPerPrimitive);
-		}
+	TransformFeedback* transformFeedback = getTransformFeedback();
+	if(!cullSkipsDraw(internalMode) || (transformFeedback->isActive() && !transformFeedback->isPaused()))
+	{
+		device->drawIndexedPrimitive(primitiveType, indexInfo.indexOffset, indexInfo.primitiveCount, instanceCount);
+	}
+	if(transformFeedback)
+	{
+		transformFeedback->addVertexOffset(indexInfo.primitiveCount * verticesPerPrimitive * instanceCount);
 	}
 }
 
@@ -3713,9 +4083,23 @@ void Context::blit(sw::Surface *source, const sw::SliceRect &sRect, sw::Surface
 
 void Context::finish()
 {
+	PixelPacker::finish();
 	device->finish();
 }
 
+void Context::endFrame()
+{
+	if(TraceRecorder::enabled())
+	{
+		TraceRecorder::frameEnd();
+	}
+}
+
+void Context::finishPixelPacks(egl::Image *renderTarget)
+{
+	PixelPacker::finish(renderTarget);
+}
+
 void Context::flush()
 {
 	// We don't queue anything without processing it as fast as possible
@@ -4277,6 +4661,7 @@ void Context::blitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1
 			egl::Image *readRenderTarget = readFramebuffer->getReadRenderTarget();
 			egl::Image *drawRenderTarget = drawFramebuffer->getRenderTarget(0);
 
+			finishPixelPacks(drawRenderTarget);
 			bool success = device->stretchRect(readRenderTarget, &sourceTrimmedRect, drawRenderTarget, &destTrimmedRect, (filter ? Device::USE_FILTER : 0) | Device::COLOR_BUFFER);
 
 			readRenderTarget->release();
@@ -4491,6 +4876,7 @@ const GLubyte *Context::getExtensions(GLuint index, GLuint *numExt) const
 		"GL_EXT_texture_filter_anisotropic",
 		"GL_EXT_texture_format_BGRA8888",
 		"GL_EXT_texture_rg",
+		"GL_KHR_parallel_shader_compile",
 #if (ASTC_SUPPORT)
 		"GL_KHR_texture_compression_astc_hdr",
 		"GL_KHR_texture_compression_astc_ldr",
@@ -4504,6 +4890,7 @@ const GLubyte *Context::getExtensions(GLuint index, GLuint *numExt) const
 		"GL_APPLE_texture_format_BGRA8888",
 		"GL_CHROMIUM_color_buffer_float_rgba", // A subset of EXT_color_buffer_float on top of OpenGL ES 2.0
 		"GL_CHROMIUM_texture_filtering_hint",
+		"GL_NV_conditional_render",
 		"GL_NV_depth_buffer_float2",
 		"GL_NV_fence",
 		"GL_NV_framebuffer_blit",
@@ -33,6 +33,7 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 namespace egl
 {
@@ -104,7 +105,8 @@ enum
 	MAX_TRANSFORM_FEEDBACK_SEPARATE_ATTRIBS = 4,
 	MAX_UNIFORM_BUFFER_BINDINGS = sw::MAX_UNIFORM_BUFFER_BINDINGS,
 	UNIFORM_BUFFER_OFFSET_ALIGNMENT = 4,
-	NUM_PROGRAM_BINARY_FORMATS = 0,
+	NUM_PROGRAM_BINARY_FORMATS = 1,
+	PROGRAM_BINARY_FORMAT_SWIFTSHADER = 0x8FFF,   // Not a registered enum, only meaningful to this implementation
 };
 
 const GLenum compressedTextureFormats[] =
@@ -383,6 +385,7 @@ struct State
 	GLenum generateMipmapHint;
 	GLenum fragmentShaderDerivativeHint;
 	GLenum textureFilteringHint;
+	GLuint maxShaderCompilerThreads;
 
 	GLint viewportX;
 	GLint viewportY;
@@ -422,6 +425,7 @@ struct State
 	VertexAttribute vertexAttribute[MAX_VERTEX_ATTRIBS];
 	gl::BindingPointer<Texture> samplerTexture[TEXTURE_TYPE_COUNT][MAX_COMBINED_TEXTURE_IMAGE_UNITS];
 	gl::BindingPointer<Query> activeQuery[QUERY_TYPE_COUNT];
+	gl::BindingPointer<Query> conditionalQuery;   // GL_NV_conditional_render
 
 	gl::PixelStorageModes unpackParameters;
 	gl::PixelStorageModes packParameters;
@@ -435,8 +439,11 @@ public:
 	void makeCurrent(gl::Surface *surface) override;
 	EGLint getClientVersion() const override;
 	EGLint getConfigID() const override;
+	void setPriority(EGLint priority) override;
+	EGLint getPriority() const override;
 
 	void markAllStateDirty();
+	void markSamplerStateDirty();
 
 	// State manipulation
 	void setClearColor(float red, float green, float blue, float alpha);
@@ -492,6 +499,8 @@ public:
 	void setGenerateMipmapHint(GLenum hint);
 	void setFragmentShaderDerivativeHint(GLenum hint);
 	void setTextureFilteringHint(GLenum hint);
+	void setMaxShaderCompilerThreads(GLuint count);
+	GLuint getMaxShaderCompilerThreads() const;
 
 	void setViewportParams(GLint x, GLint y, GLsizei width, GLsizei height);
 
@@ -525,6 +534,7 @@ public:
 	const void *getVertexAttribPointer(unsigned int attribNum) const;
 
 	const VertexAttributeArray &getVertexArrayAttributes();
+	const TranslatedAttribute *getVertexArrayTranslation();
 	// Context attribute current values can be queried independently from VAO current values
 	const VertexAttributeArray &getCurrentVertexAttributes();
 
@@ -601,6 +611,9 @@ public:
 
 	void beginQuery(GLenum target, GLuint query);
 	void endQuery(GLenum target);
+	void beginConditionalRender(GLuint query, GLenum mode);
+	void endConditionalRender();
+	bool conditionalRenderPassed();
 
 	void setFramebufferZero(Framebuffer *framebuffer);
 
@@ -676,6 +689,7 @@ public:
 	void clearStencilBuffer(const GLint value);
 	void finish() override;
 	void flush();
+	void endFrame() override;
 
 	void recordInvalidEnum();
 	void recordInvalidValue();
@@ -707,13 +721,15 @@ private:
 	void applyScissor(int width, int height);
 	bool applyRenderTarget();
 	void applyState(GLenum drawMode);
-	GLenum applyVertexBuffer(GLint base, GLint first, GLsizei count, GLsizei instanceId);
+	GLenum applyVertexBuffer(GLint base, GLint first, GLsizei count, GLsizei instanceCount);
 	GLenum applyIndexBuffer(const void *indices, GLuint start, GLuint end, GLsizei count, GLenum mode, GLenum type, TranslatedIndexData *indexInfo);
 	void applyShaders();
 	void applyTextures();
 	void applyTextures(sw::SamplerType type);
-	void applyTexture(sw::SamplerType type, int sampler, Texture *texture);
+	void applySamplerState(sw::SamplerType type, int sampler, Texture *texture, Sampler *samplerObject);
+	void applyTexture(sw::SamplerType type, int sampler, Texture *texture, Sampler *samplerObject);
 	void clearColorBuffer(GLint drawbuffer, void *value, sw::Format format);
+	void finishPixelPacks(egl::Image *renderTarget);   // Before writing to a render target which is still being read
 
 	void detachBuffer(GLuint buffer);
 	void detachTexture(GLuint texture);
@@ -754,9 +770,15 @@ private:
 	bool mInvalidFramebufferOperation;
 
 	bool mHasBeenCurrent;
+	egl::Image *mSurfaceRenderTarget;   // Images of framebuffer zero, which keeps them alive, only compared
+	egl::Image *mSurfaceDepthStencil;
 
 	unsigned int mAppliedProgramSerial;
 
+	// Parameter serials of the texture and sampler objects last applied to each sampler, 0 when dirty
+	unsigned int mAppliedTextureSerial[MAX_COMBINED_TEXTURE_IMAGE_UNITS];
+	unsigned int mAppliedSamplerSerial[MAX_COMBINED_TEXTURE_IMAGE_UNITS];
+
 	// state caching flags
 	bool mDepthStateDirty;
 	bool mMaskStateDirty;
@@ -768,6 +790,7 @@ private:
 	bool mDitherStateDirty;
 
 	Device *device;
+	EGLint priority;
 	ResourceManager *mResourceManager;
 };
 
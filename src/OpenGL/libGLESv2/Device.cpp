@@ -128,8 +128,10 @@ namespace es2
 		vertexShader = nullptr;
 
 		pixelShaderDirty = true;
+		pixelShaderConstantsFDirtyBegin = 0;
 		pixelShaderConstantsFDirty = 0;
 		vertexShaderDirty = true;
+		vertexShaderConstantsFDirtyBegin = 0;
 		vertexShaderConstantsFDirty = 0;
 
 		for(int i = 0; i < FRAGMENT_UNIFORM_VECTORS; i++)
@@ -249,26 +251,26 @@ namespace es2
 		stencilBuffer->clearStencil(stencil, mask, clearRect.x0, clearRect.y0, clearRect.width(), clearRect.height());
 	}
 
-	void Device::drawIndexedPrimitive(sw::DrawType type, unsigned int indexOffset, unsigned int primitiveCount)
+	void Device::drawIndexedPrimitive(sw::DrawType type, unsigned int indexOffset, unsigned int primitiveCount, unsigned int instanceCount)
 	{
-		if(!bindResources() || !primitiveCount)
+		if(!bindResources() || !primitiveCount || !instanceCount)
 		{
 			return;
 		}
 
-		draw(type, indexOffset, primitiveCount);
+		draw(type, indexOffset, primitiveCount, false, instanceCount);
 	}
 
-	void Device::drawPrimitive(sw::DrawType type, unsigned int primitiveCount)
+	void Device::drawPrimitive(sw::DrawType type, unsigned int primitiveCount, unsigned int instanceCount)
 	{
-		if(!bindResources() || !primitiveCount)
+		if(!bindResources() || !primitiveCount || !instanceCount)
 		{
 			return;
 		}
 
 		setIndexBuffer(nullptr);
 
-		draw(type, 0, primitiveCount);
+		draw(type, 0, primitiveCount, false, instanceCount);
 	}
 
 	void Device::setPixelShader(const PixelShader *pixelShader)
@@ -279,14 +281,20 @@ namespace es2
 
 	void Device::setPixelShaderConstantF(unsigned int startRegister, const float *constantData, unsigned int count)
 	{
-		for(unsigned int i = 0; i < count && startRegister + i < FRAGMENT_UNIFORM_VECTORS; i++)
+		if(startRegister >= FRAGMENT_UNIFORM_VECTORS)
 		{
-			pixelShaderConstantF[startRegister + i][0] = constantData[i * 4 + 0];
-			pixelShaderConstantF[startRegister + i][1] = constantData[i * 4 + 1];
-			pixelShaderConstantF[startRegister + i][2] = constantData[i * 4 + 2];
-			pixelShaderConstantF[startRegister + i][3] = constantData[i * 4 + 3];
+			return;
+		}
+
+		count = min(count, FRAGMENT_UNIFORM_VECTORS - startRegister);
+		memcpy(pixelShaderConstantF[startRegister], constantData, count * sizeof(pixelShaderConstantF[0]));
+
+		if(pixelShaderConstantsFDirty == 0)
+		{
+			pixelShaderConstantsFDirtyBegin = startRegister;
 		}
 
+		pixelShaderConstantsFDirtyBegin = min(startRegister, pixelShaderConstantsFDirtyBegin);
 		pixelShaderConstantsFDirty = max(startRegister + count, pixelShaderConstantsFDirty);
 		pixelShaderDirty = true;   // Reload DEF constants
 	}
@@ -370,14 +378,20 @@ namespace es2
 
 	void Device::setVertexShaderConstantF(unsigned int startRegister, const float *constantData, unsigned int count)
 	{
-		for(unsigned int i = 0; i < count && startRegister + i < VERTEX_UNIFORM_VECTORS; i++)
+		if(startRegister >= VERTEX_UNIFORM_VECTORS)
+		{
+			return;
+		}
+
+		count = min(count, VERTEX_UNIFORM_VECTORS - startRegister);
+		memcpy(vertexShaderConstantF[startRegister], constantData, count * sizeof(vertexShaderConstantF[0]));
+
+		if(vertexShaderConstantsFDirty == 0)
 		{
-			vertexShaderConstantF[startRegister + i][0] = constantData[i * 4 + 0];
-			vertexShaderConstantF[startRegister + i][1] = constantData[i * 4 + 1];
-			vertexShaderConstantF[startRegister + i][2] = constantData[i * 4 + 2];
-			vertexShaderConstantF[startRegister + i][3] = constantData[i * 4 + 3];
+			vertexShaderConstantsFDirtyBegin = startRegister;
 		}
 
+		vertexShaderConstantsFDirtyBegin = min(startRegister, vertexShaderConstantsFDirtyBegin);
 		vertexShaderConstantsFDirty = max(startRegister + count, vertexShaderConstantsFDirty);
 		vertexShaderDirty = true;   // Reload DEF constants
 	}
@@ -725,10 +739,12 @@ namespace es2
 			{
 				if(pixelShaderConstantsFDirty)
 				{
-					Renderer::setPixelShaderConstantF(0, pixelShaderConstantF[0], pixelShaderConstantsFDirty);
+					unsigned int begin = pixelShaderConstantsFDirtyBegin;
+					Renderer::setPixelShaderConstantF(begin, pixelShaderConstantF[begin], pixelShaderConstantsFDirty - begin);
 				}
 
 				Renderer::setPixelShader(pixelShader);   // Loads shader constants set with DEF
+				pixelShaderConstantsFDirtyBegin = 0;
 				pixelShaderConstantsFDirty = pixelShader->dirtyConstantsF;   // Shader DEF'ed constants are dirty
 			}
 			else
@@ -745,10 +761,12 @@ namespace es2
 			{
 				if(vertexShaderConstantsFDirty)
 				{
-					Renderer::setVertexShaderConstantF(0, vertexShaderConstantF[0], vertexShaderConstantsFDirty);
+					unsigned int begin = vertexShaderConstantsFDirtyBegin;
+					Renderer::setVertexShaderConstantF(begin, vertexShaderConstantF[begin], vertexShaderConstantsFDirty - begin);
 				}
 
 				Renderer::setVertexShader(vertexShader);   // Loads shader constants set with DEF
+				vertexShaderConstantsFDirtyBegin = 0;
 				vertexShaderConstantsFDirty = vertexShader->dirtyConstantsF;   // Shader DEF'ed constants are dirty
 			}
 			else
@@ -58,8 +58,8 @@ namespace es2
 		void clearColor(float red, float green, float blue, float alpha, unsigned int rgbaMask);
 		void clearDepth(float z);
 		void clearStencil(unsigned int stencil, unsigned int mask);
-		void drawIndexedPrimitive(sw::DrawType type, unsigned int indexOffset, unsigned int primitiveCount);
-		void drawPrimitive(sw::DrawType type, unsigned int primiveCount);
+		void drawIndexedPrimitive(sw::DrawType type, unsigned int indexOffset, unsigned int primitiveCount, unsigned int instanceCount = 1);
+		void drawPrimitive(sw::DrawType type, unsigned int primiveCount, unsigned int instanceCount = 1);
 		void setPixelShader(const sw::PixelShader *shader);
 		void setPixelShaderConstantF(unsigned int startRegister, const float *constantData, unsigned int count);
 		void setScissorEnable(bool enable);
@@ -98,8 +98,10 @@ namespace es2
 		const sw::VertexShader *vertexShader;
 
 		bool pixelShaderDirty;
+		unsigned int pixelShaderConstantsFDirtyBegin;   // Span of registers to upload to the renderer
 		unsigned int pixelShaderConstantsFDirty;
 		bool vertexShaderDirty;
+		unsigned int vertexShaderConstantsFDirtyBegin;
 		unsigned int vertexShaderConstantsFDirty;
 
 		float pixelShaderConstantF[sw::FRAGMENT_UNIFORM_VECTORS][4];
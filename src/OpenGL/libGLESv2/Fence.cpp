@@ -17,7 +17,6 @@
 #include "Fence.h"
 
 #include "main.h"
-#include "Common/Thread.hpp"
 
 namespace es2
 {
@@ -27,6 +26,9 @@ Fence::Fence()
 	mQuery = false;
 	mCondition = GL_NONE;
 	mStatus = GL_FALSE;
+
+	mDevice = nullptr;
+	mSequence = 0;
 }
 
 Fence::~Fence()
@@ -51,6 +53,9 @@ void Fence::setFence(GLenum condition)
 	mQuery = true;
 	mCondition = condition;
 	mStatus = GL_FALSE;
+
+	mDevice = getDevice();
+	mSequence = mDevice->getDrawSequence();
 }
 
 GLboolean Fence::testFence()
@@ -60,10 +65,9 @@ GLboolean Fence::testFence()
 		return error(GL_INVALID_OPERATION, GL_TRUE);
 	}
 
-	// The current assumtion is that no matter where the fence is placed, it is
-	// done by the time it is tested, which is similar to Context::flush(), since
-	// we don't queue anything without processing it as fast as possible.
-	mStatus = GL_TRUE;
+	// The fence is done once the draw calls issued before it have finished.
+	// Reading their results is still synchronized through the resource locks.
+	mStatus = mDevice->isComplete(mSequence) ? GL_TRUE : GL_FALSE;
 
 	return mStatus;
 }
@@ -75,10 +79,8 @@ void Fence::finishFence()
 		return error(GL_INVALID_OPERATION);
 	}
 
-	while(!testFence())
-	{
-		sw::Thread::yield();
-	}
+	mDevice->synchronize(mSequence);
+	mStatus = GL_TRUE;
 }
 
 void Fence::getFenceiv(GLenum pname, GLint *params)
@@ -117,22 +119,42 @@ void Fence::getFenceiv(GLenum pname, GLint *params)
 
 FenceSync::FenceSync(GLuint name, GLenum condition, GLbitfield flags) : NamedObject(name), mCondition(condition), mFlags(flags)
 {
+	mDevice = getDevice();
+	mSequence = mDevice->getDrawSequence();
 }
 
 FenceSync::~FenceSync()
 {
 }
 
+bool FenceSync::isSignaled() const
+{
+	// Draw calls are numbered per device. Contexts sharing the fence keep relying
+	// on the resource locks to synchronize access to the rendering results.
+	Device *device = getDevice();
+
+	return device != mDevice || mDevice->isComplete(mSequence);
+}
+
 GLenum FenceSync::clientWait(GLbitfield flags, GLuint64 timeout)
 {
-	// The current assumtion is that no matter where the fence is placed, it is
-	// done by the time it is tested, which is similar to Context::flush(), since
-	// we don't queue anything without processing it as fast as possible.
-	return GL_ALREADY_SIGNALED;
+	if(isSignaled())
+	{
+		return GL_ALREADY_SIGNALED;
+	}
+
+	if(timeout == 0)
+	{
+		return GL_TIMEOUT_EXPIRED;
+	}
+
+	// Only waits for the draw calls issued before the fence, not for the whole pipeline
+	return mDevice->synchronize(mSequence, timeout) ? GL_CONDITION_SATISFIED : GL_TIMEOUT_EXPIRED;
 }
 
 void FenceSync::serverWait(GLbitfield flags, GLuint64 timeout)
 {
+	// Draw calls are processed in submission order, so later ones never overtake the fence
 }
 
 void FenceSync::getSynciv(GLenum pname, GLsizei *length, GLint *values)
@@ -146,10 +168,7 @@ void FenceSync::getSynciv(GLenum pname, GLsizei *length, GLint *values)
 		}
 		break;
 	case GL_SYNC_STATUS:
-		// The current assumtion is that no matter where the fence is placed, it is
-		// done by the time it is tested, which is similar to Context::flush(), since
-		// we don't queue anything without processing it as fast as possible.
-		values[0] = GL_SIGNALED;
+		values[0] = isSignaled() ? GL_SIGNALED : GL_UNSIGNALED;
 		if(length) {
 			*length = 1;
 		}
@@ -23,6 +23,8 @@
 namespace es2
 {
 
+class Device;
+
 class Fence
 {
 public:
@@ -39,6 +41,9 @@ private:
 	bool mQuery;
 	GLenum mCondition;
 	GLboolean mStatus;
+
+	Device *mDevice;
+	int mSequence;   // Draw calls issued before the fence
 };
 
 class FenceSync : public gl::NamedObject
@@ -55,8 +60,13 @@ public:
 	GLbitfield getFlags() const { return mFlags; }
 
 private:
+	bool isSignaled() const;
+
 	GLenum mCondition;
 	GLbitfield mFlags;
+
+	Device *mDevice;
+	int mSequence;   // Draw calls issued before the fence
 };
 
 }
@@ -19,10 +19,15 @@
 
 #include "Buffer.h"
 #include "common/debug.h"
+#include "Common/CPUID.hpp"
 
 #include <string.h>
 #include <algorithm>
 
+#if defined(__i386__) || defined(__x86_64__)
+	#include <emmintrin.h>
+#endif
+
 namespace
 {
 	enum { INITIAL_INDEX_BUFFER_SIZE = 4096 * sizeof(GLuint) };
@@ -69,26 +74,9 @@ inline GLsizei getNumIndices(const std::vector<GLsizei>& restartIndices, size_t
 	       ((i == 0) ? restartIndices[0] : ((i == restartIndices.size()) ? (count - restartIndices[i - 1] - 1) : (restartIndices[i] - restartIndices[i - 1] - 1)));
 }
 
-void copyIndices(GLenum mode, GLenum type, const std::vector<GLsizei>& restartIndices, const void *input, GLsizei count, void* output)
+template<class IndexType>
+void copyIndices(GLenum mode, const std::vector<GLsizei>& restartIndices, const IndexType *input, GLsizei count, IndexType *output)
 {
-	size_t bytesPerIndex = 0;
-	const unsigned char* inPtr = static_cast<const unsigned char*>(input);
-	unsigned char* outPtr = static_cast<unsigned char*>(output);
-	switch(type)
-	{
-	case GL_UNSIGNED_BYTE:
-		bytesPerIndex = sizeof(GLubyte);
-		break;
-	case GL_UNSIGNED_INT:
-		bytesPerIndex = sizeof(GLuint);
-		break;
-	case GL_UNSIGNED_SHORT:
-		bytesPerIndex = sizeof(GLushort);
-		break;
-	default:
-		UNREACHABLE(type);
-	}
-
 	size_t numRestarts = restartIndices.size();
 	switch(mode)
 	{
@@ -100,13 +88,13 @@ void copyIndices(GLenum mode, GLenum type, const std::vector<GLsizei>& restartIn
 		for(size_t i = 0; i <= numRestarts; ++i)
 		{
 			GLsizei numIndices = getNumIndices(restartIndices, i, count);
-			size_t numBytes = (numIndices / verticesPerPrimitive) * verticesPerPrimitive * bytesPerIndex;
-			if(numBytes > 0)
+			GLsizei numCopied = (numIndices / verticesPerPrimitive) * verticesPerPrimitive;
+			if(numCopied > 0)
 			{
-				memcpy(outPtr, inPtr, numBytes);
-				outPtr += numBytes;
+				memcpy(output, input, numCopied * sizeof(IndexType));
+				output += numCopied;
 			}
-			inPtr += (numIndices + 1) * bytesPerIndex;
+			input += numIndices + 1;
 		}
 	}
 		break;
@@ -117,12 +105,12 @@ void copyIndices(GLenum mode, GLenum type, const std::vector<GLsizei>& restartIn
 			GLsizei numTriangles = (numIndices - 2);
 			for(GLsizei tri = 0; tri < numTriangles; ++tri)
 			{
-				memcpy(outPtr, inPtr, bytesPerIndex);
-				outPtr += bytesPerIndex;
-				memcpy(outPtr, inPtr + ((tri + 1) * bytesPerIndex), bytesPerIndex + bytesPerIndex);
-				outPtr += bytesPerIndex + bytesPerIndex;
+				output[0] = input[0];
+				output[1] = input[tri + 1];
+				output[2] = input[tri + 2];
+				output += 3;
 			}
-			inPtr += (numIndices + 1) * bytesPerIndex;
+			input += numIndices + 1;
 		}
 		break;
 	case GL_TRIANGLE_STRIP:
@@ -134,21 +122,19 @@ void copyIndices(GLenum mode, GLenum type, const std::vector<GLsizei>& restartIn
 			{
 				if(tri & 1) // Reverse odd triangles
 				{
-					memcpy(outPtr, inPtr + ((tri + 1) * bytesPerIndex), bytesPerIndex);
-					outPtr += bytesPerIndex;
-					memcpy(outPtr, inPtr + ((tri + 0) * bytesPerIndex), bytesPerIndex);
-					outPtr += bytesPerIndex;
-					memcpy(outPtr, inPtr + ((tri + 2) * bytesPerIndex), bytesPerIndex);
-					outPtr += bytesPerIndex;
+					output[0] = input[tri + 1];
+					output[1] = input[tri + 0];
+					output[2] = input[tri + 2];
 				}
 				else
 				{
-					size_t numBytes = 3 * bytesPerIndex;
-					memcpy(outPtr, inPtr + (tri * bytesPerIndex), numBytes);
-					outPtr += numBytes;
+					output[0] = input[tri + 0];
+					output[1] = input[tri + 1];
+					output[2] = input[tri + 2];
 				}
+				output += 3;
 			}
-			inPtr += (numIndices + 1) * bytesPerIndex;
+			input += numIndices + 1;
 		}
 		break;
 	case GL_LINE_LOOP:
@@ -158,18 +144,17 @@ void copyIndices(GLenum mode, GLenum type, const std::vector<GLsizei>& restartIn
 			if(numIndices >= 2)
 			{
 				GLsizei numLines = numIndices;
-				memcpy(outPtr, inPtr + (numIndices - 1) * bytesPerIndex, bytesPerIndex); // Last vertex
-				outPtr += bytesPerIndex;
-				memcpy(outPtr, inPtr, bytesPerIndex); // First vertex
-				outPtr += bytesPerIndex;
-				size_t bytesPerLine = 2 * bytesPerIndex;
-				for(GLsizei tri = 0; tri < (numLines - 1); ++tri)
+				output[0] = input[numIndices - 1]; // Last vertex
+				output[1] = input[0]; // First vertex
+				output += 2;
+				for(GLsizei line = 0; line < (numLines - 1); ++line)
 				{
-					memcpy(outPtr, inPtr + tri * bytesPerIndex, bytesPerLine);
-					outPtr += bytesPerLine;
+					output[0] = input[line + 0];
+					output[1] = input[line + 1];
+					output += 2;
 				}
 			}
-			inPtr += (numIndices + 1) * bytesPerIndex;
+			input += numIndices + 1;
 		}
 		break;
 	case GL_LINE_STRIP:
@@ -177,13 +162,13 @@ void copyIndices(GLenum mode, GLenum type, const std::vector<GLsizei>& restartIn
 		{
 			GLsizei numIndices = getNumIndices(restartIndices, i, count);
 			GLsizei numLines = numIndices - 1;
-			size_t bytesPerLine = 2 * bytesPerIndex;
-			for(GLsizei tri = 0; tri < numLines; ++tri)
+			for(GLsizei line = 0; line < numLines; ++line)
 			{
-				memcpy(outPtr, inPtr + tri * bytesPerIndex, bytesPerLine);
-				outPtr += bytesPerLine;
+				output[0] = input[line + 0];
+				output[1] = input[line + 1];
+				output += 2;
 			}
-			inPtr += (numIndices + 1) * bytesPerIndex;
+			input += numIndices + 1;
 		}
 		break;
 	default:
@@ -192,13 +177,29 @@ void copyIndices(GLenum mode, GLenum type, const std::vector<GLsizei>& restartIn
 	}
 }
 
-template<class IndexType>
-void computeRange(const IndexType *indices, GLsizei count, GLuint *minIndex, GLuint *maxIndex, std::vector<GLsizei>* restartIndices)
+void copyIndices(GLenum mode, GLenum type, const std::vector<GLsizei>& restartIndices, const void *input, GLsizei count, void* output)
 {
-	*maxIndex = 0;
-	*minIndex = MAX_ELEMENTS_INDICES;
+	switch(type)
+	{
+	case GL_UNSIGNED_BYTE:
+		copyIndices(mode, restartIndices, static_cast<const GLubyte*>(input), count, static_cast<GLubyte*>(output));
+		break;
+	case GL_UNSIGNED_INT:
+		copyIndices(mode, restartIndices, static_cast<const GLuint*>(input), count, static_cast<GLuint*>(output));
+		break;
+	case GL_UNSIGNED_SHORT:
+		copyIndices(mode, restartIndices, static_cast<const GLushort*>(input), count, static_cast<GLushort*>(output));
+		break;
+	default:
+		UNREACHABLE(type);
+	}
+}
 
-	for(GLsizei i = 0; i < count; i++)
+// Accumulates the range of indices [begin, count)
+template<class IndexType>
+void computeRange(const IndexType *indices, GLsizei begin, GLsizei count, GLuint *minIndex, GLuint *maxIndex, std::vector<GLsizei>* restartIndices)
+{
+	for(GLsizei i = begin; i < count; i++)
 	{
 		if(restartIndices && indices[i] == IndexType(-1))
 		{
@@ -210,6 +211,123 @@ void computeRange(const IndexType *indices, GLsizei count, GLuint *minIndex, GLu
 	}
 }
 
+#if defined(__i386__) || defined(__x86_64__)
+// SSE2 only has unsigned 8-bit minimum and maximum, wider
+// lanes get compared as signed after flipping the sign bit.
+inline __m128i equalsRestart(__m128i v, GLubyte) { return _mm_cmpeq_epi8(v, _mm_set1_epi8(-1)); }
+inline __m128i equalsRestart(__m128i v, GLushort) { return _mm_cmpeq_epi16(v, _mm_set1_epi16(-1)); }
+inline __m128i equalsRestart(__m128i v, GLuint) { return _mm_cmpeq_epi32(v, _mm_set1_epi32(-1)); }
+
+inline int laneMask(__m128i mask, GLubyte) { return _mm_movemask_epi8(mask); }
+inline int laneMask(__m128i mask, GLushort) { return _mm_movemask_epi8(_mm_packs_epi16(mask, _mm_setzero_si128())); }
+inline int laneMask(__m128i mask, GLuint) { return _mm_movemask_ps(_mm_castsi128_ps(mask)); }
+
+inline __m128i minimum(__m128i a, __m128i b, GLubyte) { return _mm_min_epu8(a, b); }
+inline __m128i maximum(__m128i a, __m128i b, GLubyte) { return _mm_max_epu8(a, b); }
+
+inline __m128i minimum(__m128i a, __m128i b, GLushort)
+{
+	const __m128i bias = _mm_set1_epi16(-0x8000);
+	return _mm_xor_si128(_mm_min_epi16(_mm_xor_si128(a, bias), _mm_xor_si128(b, bias)), bias);
+}
+
+inline __m128i maximum(__m128i a, __m128i b, GLushort)
+{
+	const __m128i bias = _mm_set1_epi16(-0x8000);
+	return _mm_xor_si128(_mm_max_epi16(_mm_xor_si128(a, bias), _mm_xor_si128(b, bias)), bias);
+}
+
+inline __m128i minimum(__m128i a, __m128i b, GLuint)
+{
+	const __m128i bias = _mm_set1_epi32((int)0x80000000);
+	__m128i greater = _mm_cmpgt_epi32(_mm_xor_si128(a, bias), _mm_xor_si128(b, bias));
+	return _mm_or_si128(_mm_and_si128(greater, b), _mm_andnot_si128(greater, a));
+}
+
+inline __m128i maximum(__m128i a, __m128i b, GLuint)
+{
+	const __m128i bias = _mm_set1_epi32((int)0x80000000);
+	__m128i greater = _mm_cmpgt_epi32(_mm_xor_si128(a, bias), _mm_xor_si128(b, bias));
+	return _mm_or_si128(_mm_and_si128(greater, a), _mm_andnot_si128(greater, b));
+}
+
+// Returns the number of indices processed, a multiple of the lane count. Restart
+// indices are the largest value of their type, so they can't lower the minimum,
+// and get zeroed to not raise the maximum.
+template<class IndexType>
+GLsizei computeRangeSSE2(const IndexType *indices, GLsizei count, GLuint *minIndex, GLuint *maxIndex, std::vector<GLsizei>* restartIndices)
+{
+	const int lanes = sizeof(__m128i) / sizeof(IndexType);
+	const IndexType type = 0;
+
+	__m128i low = _mm_set1_epi8(-1);
+	__m128i high = _mm_setzero_si128();
+	size_t restarts = restartIndices ? restartIndices->size() : 0;
+
+	GLsizei i = 0;
+	for(; i + lanes <= count; i += lanes)
+	{
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(indices + i));
+
+		if(restartIndices)
+		{
+			__m128i restart = equalsRestart(v, type);
+
+			for(int mask = laneMask(restart, type); mask; mask &= mask - 1)
+			{
+				int lane = 0;
+				while(!(mask & (1 << lane))) lane++;
+				restartIndices->push_back(i + lane);
+			}
+
+			high = maximum(high, _mm_andnot_si128(restart, v), type);
+		}
+		else
+		{
+			high = maximum(high, v, type);
+		}
+
+		low = minimum(low, v, type);
+	}
+
+	if(restartIndices && (GLsizei)(restartIndices->size() - restarts) == i)
+	{
+		return i;   // Only restart indices, which don't count towards the range
+	}
+
+	IndexType lowLanes[lanes];
+	IndexType highLanes[lanes];
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(lowLanes), low);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(highLanes), high);
+
+	for(int lane = 0; lane < lanes && i > 0; lane++)
+	{
+		if(*minIndex > lowLanes[lane]) *minIndex = lowLanes[lane];
+		if(*maxIndex < highLanes[lane]) *maxIndex = highLanes[lane];
+	}
+
+	return i;
+}
+#endif
+
+template<class IndexType>
+void computeRange(const IndexType *indices, GLsizei count, GLuint *minIndex, GLuint *maxIndex, std::vector<GLsizei>* restartIndices)
+{
+	*maxIndex = 0;
+	*minIndex = MAX_ELEMENTS_INDICES;
+
+	GLsizei begin = 0;
+
+	#if defined(__i386__) || defined(__x86_64__)
+		if(sw::CPUID::supportsSSE2())
+		{
+			begin = computeRangeSSE2(indices, count, minIndex, maxIndex, restartIndices);
+		}
+	#endif
+
+	computeRange(indices, begin, count, minIndex, maxIndex, restartIndices);
+}
+
 void computeRange(GLenum type, const void *indices, GLsizei count, GLuint *minIndex, GLuint *maxIndex, std::vector<GLsizei>* restartIndices)
 {
 	if(type == GL_UNSIGNED_BYTE)
@@ -289,19 +407,64 @@ GLenum IndexDataManager::prepareIndexData(GLenum mode, GLenum type, GLuint start
 		indices = static_cast<const GLubyte*>(buffer->data()) + offset;
 	}
 
-	std::vector<GLsizei>* restartIndices = primitiveRestart ? new std::vector<GLsizei>() : nullptr;
-	computeRange(type, indices, count, &translated->minIndex, &translated->maxIndex, restartIndices);
+	const std::vector<GLsizei> *restartIndices = primitiveRestart ? &mRestartIndices : nullptr;
+	const IndexRange *range = buffer ? buffer->getIndexRange(type, offset, count, primitiveRestart) : nullptr;
+
+	if(range)
+	{
+		translated->minIndex = range->minIndex;
+		translated->maxIndex = range->maxIndex;
+
+		if(restartIndices)
+		{
+			restartIndices = &range->restartIndices;
+		}
+	}
+	else
+	{
+		mRestartIndices.clear();
+		computeRange(type, indices, count, &translated->minIndex, &translated->maxIndex, primitiveRestart ? &mRestartIndices : nullptr);
+
+		if(buffer)
+		{
+			buffer->setIndexRange(type, offset, count, primitiveRestart, {translated->minIndex, translated->maxIndex, mRestartIndices});
+		}
+	}
 
 	StreamingIndexBuffer *streamingBuffer = mStreamingBuffer;
 
 	sw::Resource *staticBuffer = buffer ? buffer->getResource() : NULL;
 
-	if(restartIndices)
+	if(restartIndices && range && range->restartStream && range->restartMode == mode)
+	{
+		// Converted by an earlier draw of the same contents
+		translated->primitiveCount = range->restartPrimitiveCount;
+		translated->indexBuffer = range->restartStream;
+		translated->indexOffset = 0;
+	}
+	else if(restartIndices && buffer)
+	{
+		int vertexPerPrimitive = recomputePrimitiveCount(mode, count, *restartIndices, &translated->primitiveCount);
+		if(vertexPerPrimitive == -1)
+		{
+			return GL_INVALID_ENUM;
+		}
+
+		// Index buffers are mostly drawn many times without changing, so the conversion is kept with them
+		int convertCount = translated->primitiveCount * vertexPerPrimitive;
+		sw::Resource *stream = new sw::Resource(convertCount * typeSize(type) + 16);
+
+		copyIndices(mode, type, *restartIndices, indices, count, const_cast<void*>(stream->data()));
+		buffer->setRestartStream(type, offset, count, mode, stream, translated->primitiveCount);
+
+		translated->indexBuffer = stream;
+		translated->indexOffset = 0;
+	}
+	else if(restartIndices)
 	{
 		int vertexPerPrimitive = recomputePrimitiveCount(mode, count, *restartIndices, &translated->primitiveCount);
 		if(vertexPerPrimitive == -1)
 		{
-			delete restartIndices;
 			return GL_INVALID_ENUM;
 		}
 
@@ -313,7 +476,6 @@ GLenum IndexDataManager::prepareIndexData(GLenum mode, GLenum type, GLuint start
 
 		if(output == NULL)
 		{
-			delete restartIndices;
 			ERR("Failed to map index buffer.");
 			return GL_OUT_OF_MEMORY;
 		}
@@ -323,7 +485,6 @@ GLenum IndexDataManager::prepareIndexData(GLenum mode, GLenum type, GLuint start
 
 		translated->indexBuffer = streamingBuffer->getResource();
 		translated->indexOffset = static_cast<unsigned int>(streamOffset);
-		delete restartIndices;
 	}
 	else if(staticBuffer)
 	{
@@ -370,7 +531,7 @@ std::size_t IndexDataManager::typeSize(GLenum type)
 	}
 }
 
-StreamingIndexBuffer::StreamingIndexBuffer(size_t initialSize) : mIndexBuffer(NULL), mBufferSize(initialSize)
+StreamingIndexBuffer::StreamingIndexBuffer(size_t initialSize) : mIndexBuffer(NULL), mBufferSize(initialSize), mBufferPool(initialSize + 16)
 {
 	if(initialSize > 0)
 	{
@@ -399,7 +560,9 @@ void *StreamingIndexBuffer::map(size_t requiredSpace, size_t *offset)
 
 	if(mIndexBuffer)
 	{
-		mapPtr = (char*)mIndexBuffer->lock(sw::PUBLIC) + mWritePosition;
+		// Like the streaming vertex buffer, content still read by draws is never overwritten,
+		// only recycled through the pool, so a private lock doesn't have to wait for them.
+		mapPtr = (char*)mIndexBuffer->lock(sw::PRIVATE) + mWritePosition;
 
 		if(!mapPtr)
 		{
@@ -433,8 +596,9 @@ void StreamingIndexBuffer::reserveSpace(size_t requiredSpace, GLenum type)
 		}
 
 		mBufferSize = std::max(requiredSpace, 2 * mBufferSize);
+		mBufferPool.resize(mBufferSize + 16);
 
-		mIndexBuffer = new sw::Resource(mBufferSize + 16);
+		mIndexBuffer = mBufferPool.acquire();
 
 		if(!mIndexBuffer)
 		{
@@ -447,8 +611,8 @@ void StreamingIndexBuffer::reserveSpace(size_t requiredSpace, GLenum type)
 	{
 		if(mIndexBuffer)
 		{
-			mIndexBuffer->destruct();
-			mIndexBuffer = new sw::Resource(mBufferSize + 16);
+			mBufferPool.retire(mIndexBuffer);
+			mIndexBuffer = mBufferPool.acquire();
 		}
 
 		mWritePosition = 0;
@@ -22,6 +22,8 @@
 
 #include <GLES2/gl2.h>
 
+#include <vector>
+
 namespace es2
 {
 
@@ -53,6 +55,8 @@ private:
 	sw::Resource *mIndexBuffer;
 	size_t mBufferSize;
 	size_t mWritePosition;
+
+	sw::ResourcePool mBufferPool;
 };
 
 class IndexDataManager
@@ -67,6 +71,7 @@ public:
 
 private:
 	StreamingIndexBuffer *mStreamingBuffer;
+	std::vector<GLsizei> mRestartIndices;   // Reused, to not allocate for each draw
 };
 
 }
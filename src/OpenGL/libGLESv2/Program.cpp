@@ -25,6 +25,8 @@
 #include "common/debug.h"
 #include "Shader/PixelShader.hpp"
 #include "Shader/VertexShader.hpp"
+#include "Common/BinaryStream.hpp"
+#include "Common/Version.h"
 
 #include <algorithm>
 #include <string>
@@ -245,24 +247,21 @@ namespace es2
 			std::string baseName(name);
 			unsigned int subscript = GL_INVALID_INDEX;
 			baseName = ParseUniformName(baseName, &subscript);
-			for(auto const &varying : fragmentShader->varyings)
+			for(auto const &varying : fragmentOutputs)
 			{
-				if(varying.qualifier == EvqFragmentOut)
+				if(varying.name == baseName)
 				{
-					if(varying.name == baseName)
-					{
-						ASSERT(varying.registerIndex >= 0);
+					ASSERT(varying.registerIndex >= 0);
 
-						if(subscript == GL_INVALID_INDEX)   // No subscript
-						{
-							return varying.registerIndex;
-						}
+					if(subscript == GL_INVALID_INDEX)   // No subscript
+					{
+						return varying.registerIndex;
+					}
 
-						int rowCount = VariableRowCount(varying.type);
-						int colCount = VariableColumnCount(varying.type);
+					int rowCount = VariableRowCount(varying.type);
+					int colCount = VariableColumnCount(varying.type);
 
-						return varying.registerIndex + (rowCount > 1 ? colCount * subscript : subscript);
-					}
+					return varying.registerIndex + (rowCount > 1 ? colCount * subscript : subscript);
 				}
 			}
 		}
@@ -505,7 +504,7 @@ namespace es2
 		}
 
 		Uniform *targetUniform = uniforms[uniformIndex[location].index];
-		targetUniform->dirty = true;
+		markUniformDirty(targetUniform);
 
 		int size = targetUniform->size();
 
@@ -595,7 +594,7 @@ namespace es2
 		}
 
 		Uniform *targetUniform = uniforms[uniformIndex[location].index];
-		targetUniform->dirty = true;
+		markUniformDirty(targetUniform);
 
 		if(targetUniform->type != type)
 		{
@@ -692,7 +691,7 @@ namespace es2
 		}
 
 		Uniform *targetUniform = uniforms[uniformIndex[location].index];
-		targetUniform->dirty = true;
+		markUniformDirty(targetUniform);
 
 		int size = targetUniform->size();
 
@@ -748,7 +747,7 @@ namespace es2
 		}
 
 		Uniform *targetUniform = uniforms[uniformIndex[location].index];
-		targetUniform->dirty = true;
+		markUniformDirty(targetUniform);
 
 		int size = targetUniform->size();
 
@@ -810,7 +809,7 @@ namespace es2
 		}
 
 		Uniform *targetUniform = uniforms[uniformIndex[location].index];
-		targetUniform->dirty = true;
+		markUniformDirty(targetUniform);
 
 		int size = targetUniform->size();
 
@@ -866,7 +865,7 @@ namespace es2
 		}
 
 		Uniform *targetUniform = uniforms[uniformIndex[location].index];
-		targetUniform->dirty = true;
+		markUniformDirty(targetUniform);
 
 		int size = targetUniform->size();
 
@@ -1078,87 +1077,94 @@ namespace es2
 
 	void Program::dirtyAllUniforms()
 	{
-		size_t numUniforms = uniforms.size();
-		for(size_t index = 0; index < numUniforms; index++)
+		dirtyUniforms.clear();
+
+		for(Uniform *uniform : uniforms)
 		{
-			uniforms[index]->dirty = true;
+			uniform->dirty = true;
+
+			if(uniform->blockInfo.index == -1)   // Block members are sourced from buffers
+			{
+				dirtyUniforms.push_back(uniform);
+			}
 		}
 	}
 
-	// Applies all the uniforms set for this program object to the device
-	void Program::applyUniforms(Device *device)
+	void Program::markUniformDirty(Uniform *uniform)
 	{
-		GLint numUniforms = static_cast<GLint>(uniformIndex.size());
-		for(GLint location = 0; location < numUniforms; location++)
+		if(!uniform->dirty)
 		{
-			if((uniformIndex[location].element != 0) || (uniformIndex[location].index == GL_INVALID_INDEX))
-			{
-				continue;
-			}
-
-			Uniform *targetUniform = uniforms[uniformIndex[location].index];
-
-			if(targetUniform->dirty && (targetUniform->blockInfo.index == -1))
-			{
-				GLsizei size = targetUniform->size();
-				GLfloat *f = (GLfloat*)targetUniform->data;
-				GLint *i = (GLint*)targetUniform->data;
-				GLuint *ui = (GLuint*)targetUniform->data;
-				GLboolean *b = (GLboolean*)targetUniform->data;
-
-				switch(targetUniform->type)
-				{
-				case GL_BOOL:       applyUniform1bv(device, location, size, b);       break;
-				case GL_BOOL_VEC2:  applyUniform2bv(device, location, size, b);       break;
-				case GL_BOOL_VEC3:  applyUniform3bv(device, location, size, b);       break;
-				case GL_BOOL_VEC4:  applyUniform4bv(device, location, size, b);       break;
-				case GL_FLOAT:      applyUniform1fv(device, location, size, f);       break;
-				case GL_FLOAT_VEC2: applyUniform2fv(device, location, size, f);       break;
-				case GL_FLOAT_VEC3: applyUniform3fv(device, location, size, f);       break;
-				case GL_FLOAT_VEC4: applyUniform4fv(device, location, size, f);       break;
-				case GL_FLOAT_MAT2:   applyUniformMatrix2fv(device, location, size, f);   break;
-				case GL_FLOAT_MAT2x3: applyUniformMatrix2x3fv(device, location, size, f); break;
-				case GL_FLOAT_MAT2x4: applyUniformMatrix2x4fv(device, location, size, f); break;
-				case GL_FLOAT_MAT3x2: applyUniformMatrix3x2fv(device, location, size, f); break;
-				case GL_FLOAT_MAT3:   applyUniformMatrix3fv(device, location, size, f);   break;
-				case GL_FLOAT_MAT3x4: applyUniformMatrix3x4fv(device, location, size, f); break;
-				case GL_FLOAT_MAT4x2: applyUniformMatrix4x2fv(device, location, size, f); break;
-				case GL_FLOAT_MAT4x3: applyUniformMatrix4x3fv(device, location, size, f); break;
-				case GL_FLOAT_MAT4:   applyUniformMatrix4fv(device, location, size, f);   break;
-				case GL_SAMPLER_2D:
-				case GL_SAMPLER_CUBE:
-				case GL_SAMPLER_2D_RECT_ARB:
-				case GL_SAMPLER_EXTERNAL_OES:
-				case GL_SAMPLER_3D_OES:
-				case GL_SAMPLER_2D_ARRAY:
-				case GL_SAMPLER_2D_SHADOW:
-				case GL_SAMPLER_CUBE_SHADOW:
-				case GL_SAMPLER_2D_ARRAY_SHADOW:
-				case GL_INT_SAMPLER_2D:
-				case GL_UNSIGNED_INT_SAMPLER_2D:
-				case GL_INT_SAMPLER_CUBE:
-				case GL_UNSIGNED_INT_SAMPLER_CUBE:
-				case GL_INT_SAMPLER_3D:
-				case GL_UNSIGNED_INT_SAMPLER_3D:
-				case GL_INT_SAMPLER_2D_ARRAY:
-				case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY:
-				case GL_INT:        applyUniform1iv(device, location, size, i);       break;
-				case GL_INT_VEC2:   applyUniform2iv(device, location, size, i);       break;
-				case GL_INT_VEC3:   applyUniform3iv(device, location, size, i);       break;
-				case GL_INT_VEC4:   applyUniform4iv(device, location, size, i);       break;
-				case GL_UNSIGNED_INT:      applyUniform1uiv(device, location, size, ui); break;
-				case GL_UNSIGNED_INT_VEC2: applyUniform2uiv(device, location, size, ui); break;
-				case GL_UNSIGNED_INT_VEC3: applyUniform3uiv(device, location, size, ui); break;
-				case GL_UNSIGNED_INT_VEC4: applyUniform4uiv(device, location, size, ui); break;
-				default:
-					UNREACHABLE(targetUniform->type);
-				}
-
-				targetUniform->dirty = false;
-			}
+			uniform->dirty = true;
+			dirtyUniforms.push_back(uniform);
 		}
 	}
 
+	// Applies the uniforms set since the last draw with this program to the device
+	void Program::applyUniforms(Device *device)
+	{
+		for(Uniform *targetUniform : dirtyUniforms)
+		{
+			GLint location = targetUniform->location;
+			GLsizei size = targetUniform->size();
+			GLfloat *f = (GLfloat*)targetUniform->data;
+			GLint *i = (GLint*)targetUniform->data;
+			GLuint *ui = (GLuint*)targetUniform->data;
+			GLboolean *b = (GLboolean*)targetUniform->data;
+
+			switch(targetUniform->type)
+			{
+			case GL_BOOL:       applyUniform1bv(device, location, size, b);       break;
+			case GL_BOOL_VEC2:  applyUniform2bv(device, location, size, b);       break;
+			case GL_BOOL_VEC3:  applyUniform3bv(device, location, size, b);       break;
+			case GL_BOOL_VEC4:  applyUniform4bv(device, location, size, b);       break;
+			case GL_FLOAT:      applyUniform1fv(device, location, size, f);       break;
+			case GL_FLOAT_VEC2: applyUniform2fv(device, location, size, f);       break;
+			case GL_FLOAT_VEC3: applyUniform3fv(device, location, size, f);       break;
+			case GL_FLOAT_VEC4: applyUniform4fv(device, location, size, f);       break;
+			case GL_FLOAT_MAT2:   applyUniformMatrix2fv(device, location, size, f);   break;
+			case GL_FLOAT_MAT2x3: applyUniformMatrix2x3fv(device, location, size, f); break;
+			case GL_FLOAT_MAT2x4: applyUniformMatrix2x4fv(device, location, size, f); break;
+			case GL_FLOAT_MAT3x2: applyUniformMatrix3x2fv(device, location, size, f); break;
+			case GL_FLOAT_MAT3:   applyUniformMatrix3fv(device, location, size, f);   break;
+			case GL_FLOAT_MAT3x4: applyUniformMatrix3x4fv(device, location, size, f); break;
+			case GL_FLOAT_MAT4x2: applyUniformMatrix4x2fv(device, location, size, f); break;
+			case GL_FLOAT_MAT4x3: applyUniformMatrix4x3fv(device, location, size, f); break;
+			case GL_FLOAT_MAT4:   applyUniformMatrix4fv(device, location, size, f);   break;
+			case GL_SAMPLER_2D:
+			case GL_SAMPLER_CUBE:
+			case GL_SAMPLER_2D_RECT_ARB:
+			case GL_SAMPLER_EXTERNAL_OES:
+			case GL_SAMPLER_3D_OES:
+			case GL_SAMPLER_2D_ARRAY:
+			case GL_SAMPLER_2D_SHADOW:
+			case GL_SAMPLER_CUBE_SHADOW:
+			case GL_SAMPLER_2D_ARRAY_SHADOW:
+			case GL_INT_SAMPLER_2D:
+			case GL_UNSIGNED_INT_SAMPLER_2D:
+			case GL_INT_SAMPLER_CUBE:
+			case GL_UNSIGNED_INT_SAMPLER_CUBE:
+			case GL_INT_SAMPLER_3D:
+			case GL_UNSIGNED_INT_SAMPLER_3D:
+			case GL_INT_SAMPLER_2D_ARRAY:
+			case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY:
+			case GL_INT:        applyUniform1iv(device, location, size, i);       break;
+			case GL_INT_VEC2:   applyUniform2iv(device, location, size, i);       break;
+			case GL_INT_VEC3:   applyUniform3iv(device, location, size, i);       break;
+			case GL_INT_VEC4:   applyUniform4iv(device, location, size, i);       break;
+			case GL_UNSIGNED_INT:      applyUniform1uiv(device, location, size, ui); break;
+			case GL_UNSIGNED_INT_VEC2: applyUniform2uiv(device, location, size, ui); break;
+			case GL_UNSIGNED_INT_VEC3: applyUniform3uiv(device, location, size, ui); break;
+			case GL_UNSIGNED_INT_VEC4: applyUniform4uiv(device, location, size, ui); break;
+			default:
+				UNREACHABLE(targetUniform->type);
+			}
+
+			targetUniform->dirty = false;
+		}
+
+		dirtyUniforms.clear();
+	}
+
 	void Program::applyUniformBuffers(Device *device, BufferBinding* uniformBuffers)
 	{
 		GLint vertexUniformBuffers[MAX_UNIFORM_BUFFER_BINDINGS];
@@ -1246,6 +1252,7 @@ namespace es2
 				int nbComponentsPerReg = rowCount > 1 ? rowCount : colCount;
 				int componentStride = rowCount * colCount * size;
 				int baseOffset = transformFeedback->vertexOffset() * componentStride * sizeof(float);
+				transformFeedbackBuffers[index].get()->contentsChanged();
 				device->VertexProcessor::setTransformFeedbackBuffer(index,
 					transformFeedbackBuffers[index].get()->getResource(),
 					transformFeedbackBuffers[index].getOffset() + baseOffset,
@@ -1261,6 +1268,7 @@ namespace es2
 			// In INTERLEAVED_ATTRIBS mode, the values of one or more output variables
 			// written by a vertex shader are written, interleaved, into the buffer object
 			// bound to the first transform feedback binding point (index = 0).
+			transformFeedbackBuffers[0].get()->contentsChanged();
 			sw::Resource* resource = transformFeedbackBuffers[0].get()->getResource();
 			int componentStride = static_cast<int>(totalLinkedVaryingsComponents);
 			int baseOffset = transformFeedbackBuffers[0].getOffset() + (transformFeedback->vertexOffset() * componentStride * sizeof(float));
@@ -1379,6 +1387,12 @@ namespace es2
 
 						for(int i = 0; i < registers; i++)
 						{
+							// Registers the fragment shader never reads aren't stored, unless captured by transform feedback
+							if(!pixelBinary->getInput(in + i, 0).active() && transformFeedbackVaryings.empty())
+							{
+								continue;
+							}
+
 							vertexBinary->setOutput(out + i, components, sw::Shader::Semantic(sw::Shader::USAGE_COLOR, in + i, pixelBinary->getInput(in + i, 0).flat));
 						}
 					}
@@ -1541,6 +1555,7 @@ namespace es2
 
 		vertexBinary = new sw::VertexShader(vertexShader->getVertexShader());
 		pixelBinary = new sw::PixelShader(fragmentShader->getPixelShader());
+		pixelBinary->removeUnreadInputs();
 
 		if(!linkVaryings())
 		{
@@ -1573,9 +1588,126 @@ namespace es2
 			return;
 		}
 
+		for(auto const &varying : fragmentShader->varyings)
+		{
+			if(varying.qualifier == EvqFragmentOut)
+			{
+				fragmentOutputs.push_back(varying);
+			}
+		}
+
+		serializeBinary();
+		dirtyAllUniforms();   // Relinking keeps the serial, so the Context won't do it
+
 		linked = true;   // Success
 	}
 
+	static const char binaryMagic[4] = {'S', 'W', 'P', 'B'};
+	static const char binaryBuild[] = VERSION_STRING " " __DATE__ " " __TIME__;   // The format follows the code
+
+	void Program::serializeBinary()
+	{
+		sw::BinaryWriter writer;
+
+		writer.write(binaryMagic);
+		writer.write(std::string(binaryBuild));
+
+		writer.write((unsigned int)attributeBinding.size());
+
+		for(auto const &binding : attributeBinding)
+		{
+			writer.write(binding.first);
+			writer.write(binding.second);
+		}
+
+		writer.write((unsigned int)transformFeedbackVaryings.size());
+
+		for(auto const &varying : transformFeedbackVaryings)
+		{
+			writer.write(varying);
+		}
+
+		writer.write(transformFeedbackBufferMode);
+
+		vertexShader->serialize(writer);
+		fragmentShader->serialize(writer);
+
+		binary = writer.data();
+	}
+
+	void Program::loadBinary(const void *data, GLsizei length)
+	{
+		unlink();
+
+		sw::BinaryReader reader(data, length);
+
+		char magic[4];
+		std::string build;
+		reader.read(magic);
+		reader.read(build);
+
+		if(reader.failed() || memcmp(magic, binaryMagic, sizeof(magic)) != 0 || build != binaryBuild)
+		{
+			appendToInfoLog("The program binary was not created by this version of SwiftShader.");
+			return;
+		}
+
+		std::map<std::string, GLuint> bindings;
+		unsigned int bindingCount = 0;
+		reader.read(bindingCount);
+
+		for(unsigned int i = 0; i < bindingCount && !reader.failed(); i++)
+		{
+			std::string name;
+			GLuint location = 0;
+			reader.read(name);
+			reader.read(location);
+			bindings[name] = location;
+		}
+
+		std::vector<std::string> varyings;
+		unsigned int varyingCount = 0;
+		reader.read(varyingCount);
+
+		for(unsigned int i = 0; i < varyingCount && !reader.failed(); i++)
+		{
+			varyings.push_back(std::string());
+			reader.read(varyings.back());
+		}
+
+		GLenum bufferMode = GL_INTERLEAVED_ATTRIBS;
+		reader.read(bufferMode);
+
+		// Not known to the resource manager, only used for linking
+		VertexShader *storedVertexShader = new VertexShader(nullptr, 0);
+		FragmentShader *storedFragmentShader = new FragmentShader(nullptr, 0);
+
+		if(storedVertexShader->deserialize(reader) && storedFragmentShader->deserialize(reader) && reader.atEnd())
+		{
+			// The binary replaces the linked state, the bindings and shaders only apply to it
+			std::swap(attributeBinding, bindings);
+			std::swap(transformFeedbackVaryings, varyings);
+			std::swap(transformFeedbackBufferMode, bufferMode);
+			std::swap(vertexShader, storedVertexShader);
+			std::swap(fragmentShader, storedFragmentShader);
+
+			link();
+
+			std::swap(attributeBinding, bindings);
+			std::swap(transformFeedbackVaryings, varyings);
+			std::swap(transformFeedbackBufferMode, bufferMode);
+			std::swap(vertexShader, storedVertexShader);
+			std::swap(fragmentShader, storedFragmentShader);
+		}
+		else
+		{
+			appendToInfoLog("The program binary is corrupt.");
+		}
+
+		delete storedVertexShader;
+		delete storedFragmentShader;
+	}
+
 	// Determines the mapping between GL attributes and vertex stream usage indices
 	bool Program::linkAttributes()
 	{
@@ -1848,6 +1980,11 @@ namespace es2
 
 			unsigned int index = (blockInfo.index == -1) ? static_cast<unsigned int>(uniforms.size() - 1) : GL_INVALID_INDEX;
 
+			if(blockInfo.index == -1)
+			{
+				uniform->location = static_cast<int>(uniformIndex.size());
+			}
+
 			for(int i = 0; i < uniform->size(); i++)
 			{
 				uniformIndex.push_back(UniformLocation(glslUniform.name, i, index));
@@ -2657,7 +2794,10 @@ namespace es2
 		}
 
 		uniformIndex.clear();
+		dirtyUniforms.clear();
 		transformFeedbackLinkedVaryings.clear();
+		fragmentOutputs.clear();
+		binary.clear();
 
 		delete[] infoLog;
 		infoLog = 0;
@@ -2677,8 +2817,24 @@ namespace es2
 
 	GLint Program::getBinaryLength() const
 	{
-		UNIMPLEMENTED();
-		return 0;
+		return linked ? static_cast<GLint>(binary.size()) : 0;
+	}
+
+	bool Program::getBinary(GLsizei bufSize, GLsizei *length, void *data) const
+	{
+		if(!linked || bufSize < static_cast<GLsizei>(binary.size()))
+		{
+			return false;
+		}
+
+		memcpy(data, binary.data(), binary.size());
+
+		if(length)
+		{
+			*length = static_cast<GLsizei>(binary.size());
+		}
+
+		return true;
 	}
 
 	void Program::release()
@@ -66,6 +66,7 @@ namespace es2
 
 		unsigned char *data = nullptr;
 		bool dirty = true;
+		int location = -1;   // Of the first element, -1 for uniform block members
 
 		short psRegisterIndex = -1;
 		short vsRegisterIndex = -1;
@@ -219,11 +220,15 @@ namespace es2
 		bool getBinaryRetrievableHint() const { return retrievableBinary; }
 		void setBinaryRetrievable(bool retrievable) { retrievableBinary = retrievable; }
 		GLint getBinaryLength() const;
+		bool getBinary(GLsizei bufSize, GLsizei *length, void *binary) const;   // Fails when bufSize is too small
+		void loadBinary(const void *binary, GLsizei length);   // Links the stored shaders, sets the link status
 
 	private:
 		void unlink();
 		void resetUniformBlockBindings();
 
+		void serializeBinary();
+
 		bool linkVaryings();
 		bool linkTransformFeedback();
 
@@ -239,6 +244,7 @@ namespace es2
 		bool validateUniformStruct(GLenum shader, const glsl::Uniform &newUniformStruct);
 		bool defineUniform(GLenum shader, const glsl::Uniform &uniform, const Uniform::BlockInfo& blockInfo);
 		bool defineUniformBlock(const Shader *shader, const glsl::UniformBlock &block);
+		void markUniformDirty(Uniform *uniform);
 		bool applyUniform(Device *device, GLint location, float* data);
 		bool applyUniform1bv(Device *device, GLint location, GLsizei count, const GLboolean *v);
 		bool applyUniform2bv(Device *device, GLint location, GLsizei count, const GLboolean *v);
@@ -305,6 +311,7 @@ namespace es2
 
 		typedef std::vector<Uniform*> UniformArray;
 		UniformArray uniforms;
+		UniformArray dirtyUniforms;   // To apply on the next draw, excluding uniform block members
 		typedef std::vector<Uniform> UniformStructArray;
 		UniformStructArray uniformStructs;
 		typedef std::vector<UniformLocation> UniformIndex;
@@ -313,6 +320,9 @@ namespace es2
 		UniformBlockArray uniformBlocks;
 		typedef std::vector<LinkedVarying> LinkedVaryingArray;
 		LinkedVaryingArray transformFeedbackLinkedVaryings;
+		std::vector<glsl::Varying> fragmentOutputs;   // Kept for when the shader gets detached or recompiled
+
+		std::vector<unsigned char> binary;   // The compiled shaders and link inputs of the last successful link
 
 		bool linked;
 		bool orphaned;   // Flag to indicate that the program can be deleted when no longer in use
@@ -28,10 +28,18 @@ Query::Query(GLuint name, GLenum type) : NamedObject(name)
 	mStatus = GL_FALSE;
 	mResult = GL_FALSE;
 	mType = type;
+	mDevice = nullptr;
+	mSequence = 0;
 }
 
 Query::~Query()
 {
+	if(mQuery)
+	{
+		synchronize();   // Retiring draw calls still update the query
+		releaseConditions();
+	}
+
 	delete mQuery;
 }
 
@@ -61,6 +69,11 @@ void Query::begin()
 			return error(GL_OUT_OF_MEMORY);
 		}
 	}
+	else
+	{
+		synchronize();   // Draw calls from the previous use must not count towards the new one
+		releaseConditions();
+	}
 
 	Device *device = getDevice();
 
@@ -91,6 +104,8 @@ void Query::end()
 
 	mQuery->end();
 	device->removeQuery(mQuery);
+	mDevice = device;
+	mSequence = device->getDrawSequence();
 	switch(mType)
 	{
 	case GL_ANY_SAMPLES_PASSED_EXT:
@@ -110,12 +125,10 @@ void Query::end()
 
 GLuint Query::getResult()
 {
-	if(mQuery)
+	if(mQuery && !testQuery())
 	{
-		while(!testQuery())
-		{
-			sw::Thread::yield();
-		}
+		synchronize();
+		testQuery();
 	}
 
 	return (GLuint)mResult;
@@ -136,6 +149,11 @@ GLenum Query::getType() const
 	return mType;
 }
 
+sw::Query *Query::getQuery() const
+{
+	return mQuery;
+}
+
 GLboolean Query::testQuery()
 {
 	if(mQuery != nullptr && mStatus != GL_TRUE)
@@ -164,4 +182,27 @@ GLboolean Query::testQuery()
 
 	return GL_TRUE;   // Prevent blocking when query is nullptr
 }
+
+// Waits only for the draw calls submitted before the query ended, not for the whole renderer
+void Query::synchronize()
+{
+	if(mDevice && mDevice == getDevice())
+	{
+		mDevice->synchronize(mSequence);
+	}
+
+	while(mQuery->reference != 0)   // Draw calls of another context's device
+	{
+		sw::Thread::yield();
+	}
+}
+
+// Waits for the conditionally rendered draw calls to read the result before it gets reset or deleted
+void Query::releaseConditions()
+{
+	while(mQuery->conditions != 0)
+	{
+		sw::Thread::yield();
+	}
+}
 }
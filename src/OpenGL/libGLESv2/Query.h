@@ -25,6 +25,8 @@
 namespace es2
 {
 
+class Device;
+
 class Query : public gl::NamedObject
 {
 public:
@@ -37,14 +39,20 @@ public:
 	GLboolean isResultAvailable();
 
 	GLenum getType() const;
+	sw::Query *getQuery() const;   // Counter which conditional draw calls depend on, nullptr before the first use
 
 private:
 	GLboolean testQuery();
+	void synchronize();
+	void releaseConditions();
 
 	sw::Query* mQuery;
 	GLenum mType;
 	GLboolean mStatus;
 	GLint mResult;
+
+	Device *mDevice;   // Device which drew the counted draw calls
+	int mSequence;     // Draw sequence number when the query ended
 };
 
 }
@@ -22,6 +22,8 @@
 
 #include <GLES2/gl2.h>
 
+#include <atomic>
+
 namespace es2
 {
 
@@ -42,18 +44,20 @@ public:
 		mCompareMode = GL_NONE;
 		mCompareFunc = GL_LEQUAL;
 		mMaxAnisotropy = 1.0f;
+
+		mSerial = issueSerial();
 	}
 
-	void setMinFilter(GLenum minFilter) { mMinFilter = minFilter; }
-	void setMagFilter(GLenum magFilter) { mMagFilter = magFilter; }
-	void setWrapS(GLenum wrapS) { mWrapModeS = wrapS; }
-	void setWrapT(GLenum wrapT) { mWrapModeT = wrapT; }
-	void setWrapR(GLenum wrapR) { mWrapModeR = wrapR; }
-	void setMinLod(GLfloat minLod) { mMinLod = minLod; }
-	void setMaxLod(GLfloat maxLod) { mMaxLod = maxLod; }
-	void setCompareMode(GLenum compareMode) { mCompareMode = compareMode; }
-	void setCompareFunc(GLenum compareFunc) { mCompareFunc = compareFunc; }
-	void setMaxAnisotropy(GLfloat maxAnisotropy) { mMaxAnisotropy = maxAnisotropy; }
+	void setMinFilter(GLenum minFilter) { mMinFilter = minFilter; mSerial = issueSerial(); }
+	void setMagFilter(GLenum magFilter) { mMagFilter = magFilter; mSerial = issueSerial(); }
+	void setWrapS(GLenum wrapS) { mWrapModeS = wrapS; mSerial = issueSerial(); }
+	void setWrapT(GLenum wrapT) { mWrapModeT = wrapT; mSerial = issueSerial(); }
+	void setWrapR(GLenum wrapR) { mWrapModeR = wrapR; mSerial = issueSerial(); }
+	void setMinLod(GLfloat minLod) { mMinLod = minLod; mSerial = issueSerial(); }
+	void setMaxLod(GLfloat maxLod) { mMaxLod = maxLod; mSerial = issueSerial(); }
+	void setCompareMode(GLenum compareMode) { mCompareMode = compareMode; mSerial = issueSerial(); }
+	void setCompareFunc(GLenum compareFunc) { mCompareFunc = compareFunc; mSerial = issueSerial(); }
+	void setMaxAnisotropy(GLfloat maxAnisotropy) { mMaxAnisotropy = maxAnisotropy; mSerial = issueSerial(); }
 
 	GLenum getMinFilter() const { return mMinFilter; }
 	GLenum getMagFilter() const { return mMagFilter; }
@@ -66,7 +70,16 @@ public:
 	GLenum getCompareFunc() const { return mCompareFunc; }
 	GLfloat getMaxAnisotropy() const { return mMaxAnisotropy; }
 
+	unsigned int getSerial() const { return mSerial; }   // Unique in the process, changes with the parameters
+
 private:
+	static unsigned int issueSerial()
+	{
+		static std::atomic<unsigned int> currentSerial(1);
+
+		return currentSerial++;
+	}
+
 	GLenum mMinFilter;
 	GLenum mMagFilter;
 
@@ -79,6 +92,8 @@ private:
 	GLenum mCompareMode;
 	GLenum mCompareFunc;
 	GLfloat mMaxAnisotropy;
+
+	unsigned int mSerial;
 };
 
 }
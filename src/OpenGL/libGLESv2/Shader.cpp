@@ -20,17 +20,386 @@
 
 #include "main.h"
 #include "utilities.h"
+#include "Common/BinaryStream.hpp"
+#include "Common/CPUID.hpp"
+#include "Common/MutexLock.hpp"
+#include "Common/Thread.hpp"
 
 #include <string>
 #include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace
+{
+	// Compiler output of earlier compilations, shared by all contexts of the process. The
+	// ShBuiltInResources and compile options are constants of this build, so the shader
+	// type and source are the full key.
+	class CompileCache
+	{
+	public:
+		struct Output
+		{
+			std::string infoLog;
+			std::vector<unsigned char> shader;   // Serialized es2::Shader, empty when compilation failed
+		};
+
+		std::shared_ptr<const Output> find(const std::string &key)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			auto entry = entries.find(key);
+
+			return (entry != entries.end()) ? entry->second : nullptr;
+		}
+
+		void insert(const std::string &key, const std::shared_ptr<const Output> &output)
+		{
+			const size_t maxBytes = 32 * 1024 * 1024;   // Bounds the memory of processes generating many shaders
+			size_t entryBytes = key.size() + output->infoLog.size() + output->shader.size();
+
+			std::lock_guard<std::mutex> lock(mutex);
+
+			if(bytes + entryBytes > maxBytes)
+			{
+				entries.clear();
+				bytes = 0;
+			}
+
+			if(entries.emplace(key, output).second)
+			{
+				bytes += entryBytes;
+			}
+		}
+
+	private:
+		std::mutex mutex;
+		std::unordered_map<std::string, std::shared_ptr<const Output>> entries;
+		size_t bytes = 0;
+	};
+
+	CompileCache compileCache;
+
+	// Initialized compilers, so the built-in symbol table gets built once per shader type
+	// instead of once per compilation. Each compiler translates one shader at a time.
+	class CompilerPool
+	{
+	public:
+		TranslatorASM *take(GLenum shaderType)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			auto compiler = idle.find(shaderType);
+
+			if(compiler == idle.end())
+			{
+				return nullptr;
+			}
+
+			TranslatorASM *assembler = compiler->second;
+			idle.erase(compiler);
+
+			return assembler;
+		}
+
+		void give(GLenum shaderType, TranslatorASM *compiler)
+		{
+			compiler->setShaderObject(nullptr);
+
+			std::lock_guard<std::mutex> lock(mutex);
+			idle.emplace(shaderType, compiler);
+		}
+
+		void clear()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			for(auto &compiler : idle)
+			{
+				delete compiler.second;
+			}
+
+			idle.clear();
+		}
+
+	private:
+		std::mutex mutex;
+		std::multimap<GLenum, TranslatorASM*> idle;
+	};
+
+	CompilerPool compilerPool;
+	std::mutex compilerGlobalsMutex;   // Compilers also run on ShaderCompiler threads
+
+	void write(sw::BinaryWriter &binary, const glsl::ShaderVariable &variable)
+	{
+		binary.write(variable.type);
+		binary.write(variable.precision);
+		binary.write(variable.name);
+		binary.write(variable.arraySize);
+		binary.write(variable.registerIndex);
+		binary.write((unsigned int)variable.fields.size());
+
+		for(const auto &field : variable.fields)
+		{
+			write(binary, field);
+		}
+	}
+
+	void read(sw::BinaryReader &binary, glsl::ShaderVariable &variable)
+	{
+		unsigned int fieldCount = 0;
+
+		binary.read(variable.type);
+		binary.read(variable.precision);
+		binary.read(variable.name);
+		binary.read(variable.arraySize);
+		binary.read(variable.registerIndex);
+		binary.read(fieldCount);
+
+		variable.fields.clear();
+
+		for(unsigned int i = 0; i < fieldCount && !binary.failed(); i++)
+		{
+			variable.fields.push_back(glsl::ShaderVariable());
+			read(binary, variable.fields.back());
+		}
+	}
+
+	void write(sw::BinaryWriter &binary, const glsl::Varying &varying)
+	{
+		write(binary, static_cast<const glsl::ShaderVariable&>(varying));
+		binary.write(varying.qualifier);
+		binary.write(varying.column);
+	}
+
+	void read(sw::BinaryReader &binary, glsl::Varying &varying)
+	{
+		read(binary, static_cast<glsl::ShaderVariable&>(varying));
+		binary.read(varying.qualifier);
+		binary.read(varying.column);
+	}
+
+	void write(sw::BinaryWriter &binary, const glsl::Uniform &uniform)
+	{
+		write(binary, static_cast<const glsl::ShaderVariable&>(uniform));
+		binary.write(uniform.blockId);
+		binary.write(uniform.blockInfo);
+	}
+
+	void read(sw::BinaryReader &binary, glsl::Uniform &uniform)
+	{
+		read(binary, static_cast<glsl::ShaderVariable&>(uniform));
+		binary.read(uniform.blockId);
+		binary.read(uniform.blockInfo);
+	}
+
+	void write(sw::BinaryWriter &binary, const glsl::Attribute &attribute)
+	{
+		binary.write(attribute.type);
+		binary.write(attribute.name);
+		binary.write(attribute.arraySize);
+		binary.write(attribute.layoutLocation);
+		binary.write(attribute.registerIndex);
+	}
+
+	void read(sw::BinaryReader &binary, glsl::Attribute &attribute)
+	{
+		binary.read(attribute.type);
+		binary.read(attribute.name);
+		binary.read(attribute.arraySize);
+		binary.read(attribute.layoutLocation);
+		binary.read(attribute.registerIndex);
+	}
+
+	void write(sw::BinaryWriter &binary, const glsl::UniformBlock &block)
+	{
+		binary.write(block.name);
+		binary.write(block.dataSize);
+		binary.write(block.arraySize);
+		binary.write(block.layout);
+		binary.write(block.isRowMajorLayout);
+		binary.write((unsigned int)block.fields.size());
+
+		for(int field : block.fields)
+		{
+			binary.write(field);
+		}
+
+		binary.write(block.registerIndex);
+		binary.write(block.blockId);
+	}
+
+	void read(sw::BinaryReader &binary, glsl::UniformBlock &block)
+	{
+		unsigned int fieldCount = 0;
+
+		binary.read(block.name);
+		binary.read(block.dataSize);
+		binary.read(block.arraySize);
+		binary.read(block.layout);
+		binary.read(block.isRowMajorLayout);
+		binary.read(fieldCount);
+
+		block.fields.clear();
+
+		for(unsigned int i = 0; i < fieldCount && !binary.failed(); i++)
+		{
+			int field = 0;
+			binary.read(field);
+			block.fields.push_back(field);
+		}
+
+		binary.read(block.registerIndex);
+		binary.read(block.blockId);
+	}
+
+	template<class List>
+	void writeList(sw::BinaryWriter &binary, const List &list)
+	{
+		binary.write((unsigned int)list.size());
+
+		for(const auto &element : list)
+		{
+			write(binary, element);
+		}
+	}
+
+	template<class List>
+	void readList(sw::BinaryReader &binary, List &list)
+	{
+		unsigned int count = 0;
+		binary.read(count);
+
+		list.clear();
+
+		for(unsigned int i = 0; i < count && !binary.failed(); i++)
+		{
+			list.push_back(typename List::value_type());
+			read(binary, list.back());
+		}
+	}
+}
 
 namespace es2
 {
+// Process-wide pool of threads compiling shaders for GL_KHR_parallel_shader_compile.
+// Threads get added as compilations get scheduled, up to the largest count
+// requested through glMaxShaderCompilerThreadsKHR, and are never destroyed.
+class ShaderCompiler
+{
+public:
+	static void schedule(Shader *shader, unsigned int maxThreads);
+	static bool idle();
+
+private:
+	ShaderCompiler() : active(0), threadCount(0) {}
+
+	static ShaderCompiler &get();
+	static void threadFunction(void *parameters);
+	void threadLoop();
+
+	enum { MAX_COMPILER_THREADS = 16 };
+
+	sw::MutexLock mutex;
+	sw::Event work;
+	std::list<Shader*> queue;
+	int active;   // Compilations in progress
+
+	int threadCount;
+	sw::Thread *thread[MAX_COMPILER_THREADS];
+};
+
+ShaderCompiler &ShaderCompiler::get()
+{
+	static ShaderCompiler *compiler = new ShaderCompiler();   // Its threads may outlive any context
+
+	return *compiler;
+}
+
+void ShaderCompiler::schedule(Shader *shader, unsigned int maxThreads)
+{
+	ShaderCompiler &compiler = get();
+	int wantedThreads = (int)std::min<unsigned int>(maxThreads, std::min(sw::CPUID::coreCount(), (int)MAX_COMPILER_THREADS));
+
+	compiler.mutex.lock();
+
+	while(compiler.threadCount < wantedThreads)
+	{
+		compiler.thread[compiler.threadCount++] = new sw::Thread(threadFunction, &compiler);
+	}
+
+	compiler.queue.push_back(shader);
+	compiler.mutex.unlock();
+
+	compiler.work.signal();
+}
+
+bool ShaderCompiler::idle()
+{
+	ShaderCompiler &compiler = get();
+
+	compiler.mutex.lock();
+	bool idle = compiler.queue.empty() && compiler.active == 0;
+	compiler.mutex.unlock();
+
+	return idle;
+}
+
+void ShaderCompiler::threadFunction(void *parameters)
+{
+	static_cast<ShaderCompiler*>(parameters)->threadLoop();
+}
+
+void ShaderCompiler::threadLoop()
+{
+	while(true)
+	{
+		work.wait();
+
+		while(true)
+		{
+			mutex.lock();
+
+			if(queue.empty())
+			{
+				mutex.unlock();
+				break;
+			}
+
+			Shader *shader = queue.front();
+			queue.pop_front();
+			bool moreWork = !queue.empty();
+			active++;
+
+			mutex.unlock();
+
+			if(moreWork)
+			{
+				work.signal();   // Let another compiler thread take the next shader
+			}
+
+			shader->translate(shader->pendingSource);
+
+			mutex.lock();
+			active--;
+			mutex.unlock();
+
+			// The shader may get destroyed as soon as it no longer compiles
+			std::lock_guard<std::mutex> lock(shader->compileMutex);
+			shader->compiling = false;
+			shader->compileDone.notify_all();
+		}
+	}
+}
+
 bool Shader::compilerInitialized = false;
 
 Shader::Shader(ResourceManager *manager, GLuint handle) : mHandle(handle), mResourceManager(manager)
 {
 	mSource = nullptr;
+	compiling = false;
 
 	clear();
 
@@ -40,6 +409,7 @@ Shader::Shader(ResourceManager *manager, GLuint handle) : mHandle(handle), mReso
 
 Shader::~Shader()
 {
+	finishCompile();
 	delete[] mSource;
 }
 
@@ -90,6 +460,8 @@ void Shader::setSource(GLsizei count, const char *const *string, const GLint *le
 
 size_t Shader::getInfoLogLength() const
 {
+	finishCompile();
+
 	if(infoLog.empty())
 	{
 		return 0;
@@ -102,6 +474,8 @@ size_t Shader::getInfoLogLength() const
 
 void Shader::getInfoLog(GLsizei bufSize, GLsizei *length, char *infoLogOut)
 {
+	finishCompile();
+
 	int index = 0;
 
 	if(bufSize > 0)
@@ -156,13 +530,25 @@ void Shader::getSource(GLsizei bufSize, GLsizei *length, char *source)
 
 TranslatorASM *Shader::createCompiler(GLenum shaderType)
 {
-	if(!compilerInitialized)
 	{
-		InitCompilerGlobals();
-		compilerInitialized = true;
+		std::lock_guard<std::mutex> lock(compilerGlobalsMutex);
+
+		if(!compilerInitialized)
+		{
+			InitCompilerGlobals();
+			compilerInitialized = true;
+		}
 	}
 
-	TranslatorASM *assembler = new TranslatorASM(this, shaderType);
+	TranslatorASM *assembler = compilerPool.take(shaderType);
+
+	if(assembler)
+	{
+		assembler->setShaderObject(this);
+		return assembler;
+	}
+
+	assembler = new TranslatorASM(this, shaderType);
 
 	ShBuiltInResources resources;
 	resources.MaxVertexAttribs = MAX_VERTEX_ATTRIBS;
@@ -197,20 +583,56 @@ void Shader::clear()
 	activeAttributes.clear();
 }
 
-void Shader::compile()
+void Shader::compile(unsigned int maxThreads)
+{
+	finishCompile();
+
+	// Ensure we don't pass a nullptr source to the compiler
+	std::string source = mSource ? mSource : "";
+
+	if(maxThreads == 0)
+	{
+		translate(source);
+		return;
+	}
+
+	pendingSource = source;
+
+	{
+		std::lock_guard<std::mutex> lock(compileMutex);
+		compiling = true;
+	}
+
+	ShaderCompiler::schedule(this, maxThreads);
+}
+
+void Shader::translate(const std::string &shaderSource)
 {
 	clear();
 
-	createShader();
-	TranslatorASM *compiler = createCompiler(getType());
+	const char *source = shaderSource.c_str();
 
-	// Ensure we don't pass a nullptr source to the compiler
-	const char *source = "\0";
-	if(mSource)
+	const GLenum type = getType();
+	std::string key(reinterpret_cast<const char*>(&type), sizeof(type));
+	key += source;
+
+	if(auto cached = compileCache.find(key))
 	{
-		source = mSource;
+		sw::BinaryReader reader(cached->shader.data(), cached->shader.size());
+
+		if(cached->shader.empty() || !deserialize(reader))
+		{
+			deleteShader();
+		}
+
+		infoLog = cached->infoLog;
+
+		return;
 	}
 
+	createShader();
+	TranslatorASM *compiler = createCompiler(type);
+
 	bool success = compiler->compile(&source, 1, SH_OBJECT_CODE);
 
 	if(false)
@@ -222,7 +644,7 @@ void Shader::compile()
 			char buffer[256];
 			sprintf(buffer, "shader-input-%d-%d.txt", getName(), serial);
 			FILE *file = fopen(buffer, "wt");
-			fprintf(file, "%s", mSource);
+			fprintf(file, "%s", source);
 			fclose(file);
 		}
 
@@ -241,14 +663,99 @@ void Shader::compile()
 		TRACE("\n%s", infoLog.c_str());
 	}
 
-	delete compiler;
+	compilerPool.give(type, compiler);
+
+	auto output = std::make_shared<CompileCache::Output>();
+	output->infoLog = infoLog;
+
+	if(success)
+	{
+		sw::BinaryWriter writer;
+		serialize(writer);
+		output->shader = writer.data();
+	}
+
+	compileCache.insert(key, output);
 }
 
 bool Shader::isCompiled()
 {
+	finishCompile();
+
 	return getShader() != 0;
 }
 
+bool Shader::isCompileComplete() const
+{
+	std::lock_guard<std::mutex> lock(compileMutex);
+
+	return !compiling;
+}
+
+void Shader::finishCompile() const
+{
+	std::unique_lock<std::mutex> lock(compileMutex);
+
+	compileDone.wait(lock, [this]() { return !compiling; });
+}
+
+void Shader::serialize(sw::BinaryWriter &binary) const
+{
+	binary.write(shaderVersion);
+
+	writeList(binary, varyings);
+	writeList(binary, activeUniforms);
+	writeList(binary, activeUniformStructs);
+	writeList(binary, activeAttributes);
+	writeList(binary, activeUniformBlocks);
+
+	getShader()->serialize(binary);
+}
+
+bool Shader::deserialize(sw::BinaryReader &binary)
+{
+	clear();
+	activeUniformStructs.clear();
+	activeUniformBlocks.clear();
+
+	binary.read(shaderVersion);
+
+	readList(binary, varyings);
+	readList(binary, activeUniforms);
+	readList(binary, activeUniformStructs);
+	readList(binary, activeAttributes);
+	readList(binary, activeUniformBlocks);
+
+	// Linking indexes blocks, samplers and attribute streams with these
+	for(const auto &uniform : activeUniforms)
+	{
+		if(uniform.registerIndex < 0 || uniform.blockId < -1 || uniform.blockId >= static_cast<int>(activeUniformBlocks.size()))
+		{
+			return false;
+		}
+	}
+
+	for(const auto &attribute : activeAttributes)
+	{
+		if(attribute.layoutLocation < -1 || attribute.layoutLocation >= MAX_VERTEX_ATTRIBS ||
+		   attribute.registerIndex < -1 || attribute.registerIndex >= MAX_VERTEX_ATTRIBS)
+		{
+			return false;
+		}
+	}
+
+	createShader();
+
+	if(!getShader()->deserialize(binary))
+	{
+		deleteShader();
+
+		return false;
+	}
+
+	return true;
+}
+
 void Shader::addRef()
 {
 	mRefCount++;
@@ -281,6 +788,15 @@ void Shader::flagForDeletion()
 
 void Shader::releaseCompiler()
 {
+	std::lock_guard<std::mutex> lock(compilerGlobalsMutex);
+
+	// Releasing is only a hint, ignored while parallel compilations are pending
+	if(!ShaderCompiler::idle())
+	{
+		return;
+	}
+
+	compilerPool.clear();
 	FreeCompilerGlobals();
 	compilerInitialized = false;
 }
@@ -375,6 +891,7 @@ VertexShader::VertexShader(ResourceManager *manager, GLuint handle) : Shader(man
 
 VertexShader::~VertexShader()
 {
+	finishCompile();
 	delete vertexShader;
 }
 
@@ -428,6 +945,7 @@ FragmentShader::FragmentShader(ResourceManager *manager, GLuint handle) : Shader
 
 FragmentShader::~FragmentShader()
 {
+	finishCompile();
 	delete pixelShader;
 }
 
@@ -26,6 +26,8 @@
 
 #include <GLES2/gl2.h>
 
+#include <condition_variable>
+#include <mutex>
 #include <string>
 #include <list>
 #include <vector>
@@ -35,12 +37,21 @@ namespace glsl
 	class OutputASM;
 }
 
+namespace sw
+{
+	class BinaryWriter;
+	class BinaryReader;
+}
+
 namespace es2
 {
 
+class ShaderCompiler;
+
 class Shader : public glsl::Shader
 {
 	friend class Program;
+	friend class ShaderCompiler;
 
 public:
 	Shader(ResourceManager *manager, GLuint handle);
@@ -57,8 +68,13 @@ public:
 	size_t getSourceLength() const;
 	void getSource(GLsizei bufSize, GLsizei *length, char *source);
 
-	void compile();
+	void compile(unsigned int maxThreads = 0);   // Compiles on a ShaderCompiler thread when maxThreads isn't 0
 	bool isCompiled();
+	bool isCompileComplete() const;   // GL_COMPLETION_STATUS_KHR, without waiting
+
+	// The compiler output, stored in program binaries
+	void serialize(sw::BinaryWriter &binary) const;
+	bool deserialize(sw::BinaryReader &binary);
 
 	void addRef();
 	void release();
@@ -72,6 +88,8 @@ protected:
 	static bool compilerInitialized;
 	TranslatorASM *createCompiler(GLenum shaderType);
 	void clear();
+	void translate(const std::string &source);
+	void finishCompile() const;   // Waits for a parallel compilation to complete
 
 	static bool compareVarying(const glsl::Varying &x, const glsl::Varying &y);
 
@@ -87,6 +105,11 @@ private:
 	bool mDeleteStatus;         // Flag to indicate that the shader can be deleted when no longer in use
 
 	ResourceManager *mResourceManager;
+
+	std::string pendingSource;   // Copied, so the source can be changed while compiling
+	bool compiling;
+	mutable std::mutex compileMutex;
+	mutable std::condition_variable compileDone;
 };
 
 class VertexShader : public Shader
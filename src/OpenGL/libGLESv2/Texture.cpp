@@ -20,6 +20,8 @@
 
 #include "main.h"
 #include "mathutil.h"
+#include "Buffer.h"
+#include "Context.h"
 #include "Framebuffer.h"
 #include "Device.hpp"
 #include "Sampler.h"
@@ -27,12 +29,149 @@
 #include "libEGL/Display.h"
 #include "common/Surface.hpp"
 #include "common/debug.h"
+#include "Common/CPUID.hpp"
+#include "Common/Thread.hpp"
 
 #include <algorithm>
+#include <atomic>
+#include <climits>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <set>
 
 namespace es2
 {
 
+struct TextureUploader::Upload
+{
+	egl::Image *image;
+	GLint xoffset;
+	GLint yoffset;
+	GLint zoffset;
+	GLsizei width;
+	GLsizei height;
+	GLsizei depth;
+	GLenum format;
+	GLenum type;
+	gl::PixelStorageModes unpackParameters;
+	const void *pixels;
+	sw::Resource *storage;   // The pixel unpack buffer's, locked until converted
+};
+
+class TextureUploader::Queue
+{
+public:
+	static Queue &get()
+	{
+		static Queue *queue = new Queue();   // Its threads may outlive any context
+
+		return *queue;
+	}
+
+	void schedule(const Upload &upload)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		while(threadCount < std::min(sw::CPUID::coreCount(), (int)MAX_UPLOAD_THREADS))
+		{
+			thread[threadCount++] = new sw::Thread(threadFunction, this);
+		}
+
+		uploads.push_back(upload);
+		images.insert(upload.image);
+		work.notify_one();
+	}
+
+	void finish(const egl::Image *image)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [this, image]() { return images.find(image) == images.end(); });
+	}
+
+private:
+	Queue() : threadCount(0) {}
+
+	static void threadFunction(void *parameters)
+	{
+		static_cast<Queue*>(parameters)->threadLoop();
+	}
+
+	void threadLoop();
+
+	enum { MAX_UPLOAD_THREADS = 8 };
+
+	std::mutex mutex;
+	std::condition_variable work;
+	std::condition_variable done;
+	std::list<Upload> uploads;
+	std::multiset<const egl::Image*> images;   // Of the scheduled uploads, until they complete
+
+	int threadCount;
+	sw::Thread *thread[MAX_UPLOAD_THREADS];
+};
+
+std::atomic<int> TextureUploader::pending(0);
+
+bool TextureUploader::schedule(egl::Image *image, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const gl::PixelStorageModes &unpackParameters, const void *pixels)
+{
+	// Shared images can be accessed by other APIs, which don't wait for uploads
+	if(image->isShared())
+	{
+		return false;
+	}
+
+	Context *context = getContextLocked();
+	Buffer *unpackBuffer = context ? context->getPixelUnpackBuffer() : nullptr;
+	const char *contents = unpackBuffer ? static_cast<const char*>(unpackBuffer->data()) : nullptr;
+
+	if(!contents || pixels < contents || pixels >= contents + unpackBuffer->size())
+	{
+		return false;
+	}
+
+	// Draws reading the buffer, and writes other than orphaning it, wait for the conversion.
+	// Unlike the renderer's PRIVATE locks it's not released by draws, and isn't shared with pixel packing.
+	sw::Resource *storage = unpackBuffer->getResource();
+	storage->lock(sw::MANAGED);
+
+	pending++;
+	Queue::get().schedule({image, xoffset, yoffset, zoffset, width, height, depth, format, type, unpackParameters, pixels, storage});
+
+	return true;
+}
+
+void TextureUploader::finish(const egl::Image *image)
+{
+	if(image)
+	{
+		Queue::get().finish(image);
+	}
+}
+
+void TextureUploader::Queue::threadLoop()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while(true)
+	{
+		work.wait(lock, [this]() { return !uploads.empty(); });
+
+		Upload upload = uploads.front();
+		uploads.pop_front();
+
+		lock.unlock();
+
+		upload.image->loadImageData(upload.xoffset, upload.yoffset, upload.zoffset, upload.width, upload.height, upload.depth, upload.format, upload.type, upload.unpackParameters, upload.pixels);
+		upload.storage->unlock();
+
+		lock.lock();
+		images.erase(images.find(upload.image));
+		pending--;
+		done.notify_all();
+	}
+}
+
 Texture::Texture(GLuint name) : egl::Texture(name)
 {
 	mMinFilter = GL_NEAREST_MIPMAP_LINEAR;
@@ -53,6 +192,7 @@ Texture::Texture(GLuint name) : egl::Texture(name)
 	mSwizzleG = GL_GREEN;
 	mSwizzleB = GL_BLUE;
 	mSwizzleA = GL_ALPHA;
+	mParameterSerial = issueSerial();
 
 	resource = new sw::Resource(0);
 }
@@ -67,9 +207,18 @@ sw::Resource *Texture::getResource() const
 	return resource;
 }
 
+unsigned int Texture::issueSerial()
+{
+	static std::atomic<unsigned int> currentSerial(1);   // Textures are shared between contexts of any thread
+
+	return currentSerial++;
+}
+
 // Returns true on successful filter state update (valid enum parameter)
 bool Texture::setMinFilter(GLenum filter)
 {
+	mParameterSerial = issueSerial();   // Also for invalid values, it only costs reapplying them
+
 	switch(filter)
 	{
 	case GL_NEAREST_MIPMAP_NEAREST:
@@ -93,6 +242,8 @@ bool Texture::setMinFilter(GLenum filter)
 // Returns true on successful filter state update (valid enum parameter)
 bool Texture::setMagFilter(GLenum filter)
 {
+	mParameterSerial = issueSerial();
+
 	switch(filter)
 	{
 	case GL_NEAREST:
@@ -107,6 +258,8 @@ bool Texture::setMagFilter(GLenum filter)
 // Returns true on successful wrap state update (valid enum parameter)
 bool Texture::setWrapS(GLenum wrap)
 {
+	mParameterSerial = issueSerial();
+
 	switch(wrap)
 	{
 	case GL_REPEAT:
@@ -127,6 +280,8 @@ bool Texture::setWrapS(GLenum wrap)
 // Returns true on successful wrap state update (valid enum parameter)
 bool Texture::setWrapT(GLenum wrap)
 {
+	mParameterSerial = issueSerial();
+
 	switch(wrap)
 	{
 	case GL_REPEAT:
@@ -147,6 +302,8 @@ bool Texture::setWrapT(GLenum wrap)
 // Returns true on successful wrap state update (valid enum parameter)
 bool Texture::setWrapR(GLenum wrap)
 {
+	mParameterSerial = issueSerial();
+
 	switch(wrap)
 	{
 	case GL_REPEAT:
@@ -167,6 +324,8 @@ bool Texture::setWrapR(GLenum wrap)
 // Returns true on successful max anisotropy update (valid anisotropy value)
 bool Texture::setMaxAnisotropy(float textureMaxAnisotropy)
 {
+	mParameterSerial = issueSerial();
+
 	textureMaxAnisotropy = std::min(textureMaxAnisotropy, MAX_TEXTURE_MAX_ANISOTROPY);
 
 	if(textureMaxAnisotropy < 1.0f)
@@ -184,6 +343,8 @@ bool Texture::setMaxAnisotropy(float textureMaxAnisotropy)
 
 bool Texture::setBaseLevel(GLint baseLevel)
 {
+	mParameterSerial = issueSerial();
+
 	if(baseLevel < 0)
 	{
 		return false;
@@ -195,6 +356,8 @@ bool Texture::setBaseLevel(GLint baseLevel)
 
 bool Texture::setCompareFunc(GLenum compareFunc)
 {
+	mParameterSerial = issueSerial();
+
 	switch(compareFunc)
 	{
 	case GL_LEQUAL:
@@ -214,6 +377,8 @@ bool Texture::setCompareFunc(GLenum compareFunc)
 
 bool Texture::setCompareMode(GLenum compareMode)
 {
+	mParameterSerial = issueSerial();
+
 	switch(compareMode)
 	{
 	case GL_COMPARE_REF_TO_TEXTURE:
@@ -233,24 +398,32 @@ void Texture::makeImmutable(GLsizei levels)
 
 bool Texture::setMaxLevel(GLint maxLevel)
 {
+	mParameterSerial = issueSerial();
+
 	mMaxLevel = maxLevel;
 	return true;
 }
 
 bool Texture::setMaxLOD(GLfloat maxLOD)
 {
+	mParameterSerial = issueSerial();
+
 	mMaxLOD = maxLOD;
 	return true;
 }
 
 bool Texture::setMinLOD(GLfloat minLOD)
 {
+	mParameterSerial = issueSerial();
+
 	mMinLOD = minLOD;
 	return true;
 }
 
 bool Texture::setSwizzleR(GLenum swizzleR)
 {
+	mParameterSerial = issueSerial();
+
 	switch(swizzleR)
 	{
 	case GL_RED:
@@ -268,6 +441,8 @@ bool Texture::setSwizzleR(GLenum swizzleR)
 
 bool Texture::setSwizzleG(GLenum swizzleG)
 {
+	mParameterSerial = issueSerial();
+
 	switch(swizzleG)
 	{
 	case GL_RED:
@@ -285,6 +460,8 @@ bool Texture::setSwizzleG(GLenum swizzleG)
 
 bool Texture::setSwizzleB(GLenum swizzleB)
 {
+	mParameterSerial = issueSerial();
+
 	switch(swizzleB)
 	{
 	case GL_RED:
@@ -302,6 +479,8 @@ bool Texture::setSwizzleB(GLenum swizzleB)
 
 bool Texture::setSwizzleA(GLenum swizzleA)
 {
+	mParameterSerial = issueSerial();
+
 	switch(swizzleA)
 	{
 	case GL_RED:
@@ -339,7 +518,11 @@ void Texture::setImage(GLenum format, GLenum type, const gl::PixelStorageModes &
 	if(pixels && image)
 	{
 		GLsizei depth = (getTarget() == GL_TEXTURE_3D_OES || getTarget() == GL_TEXTURE_2D_ARRAY) ? image->getDepth() : 1;
-		image->loadImageData(0, 0, 0, image->getWidth(), image->getHeight(), depth, format, type, unpackParameters, pixels);
+
+		if(!TextureUploader::schedule(image, 0, 0, 0, image->getWidth(), image->getHeight(), depth, format, type, unpackParameters, pixels))
+		{
+			image->loadImageData(0, 0, 0, image->getWidth(), image->getHeight(), depth, format, type, unpackParameters, pixels);
+		}
 	}
 }
 
@@ -361,7 +544,10 @@ void Texture::subImage(GLint xoffset, GLint yoffset, GLint zoffset, GLsizei widt
 
 	if(pixels && width > 0 && height > 0 && depth > 0)
 	{
-		image->loadImageData(xoffset, yoffset, zoffset, width, height, depth, format, type, unpackParameters, pixels);
+		if(!TextureUploader::schedule(image, xoffset, yoffset, zoffset, width, height, depth, format, type, unpackParameters, pixels))
+		{
+			image->loadImageData(xoffset, yoffset, zoffset, width, height, depth, format, type, unpackParameters, pixels);
+		}
 	}
 }
 
@@ -420,6 +606,9 @@ bool Texture::isMipmapFiltered(Sampler *sampler) const
 
 Texture2D::Texture2D(GLuint name) : Texture(name)
 {
+	mPendingMipmapBase = 0;
+	mPendingMipmapTop = 0;
+
 	mSurface = nullptr;
 
 	mColorbufferProxy = nullptr;
@@ -533,6 +722,8 @@ bool Texture2D::requiresSync() const
 
 void Texture2D::setImage(GLint level, GLsizei width, GLsizei height, GLint internalformat, GLenum format, GLenum type, const gl::PixelStorageModes &unpackParameters, const void *pixels)
 {
+	generatePendingMipmaps();
+
 	if(image[level])
 	{
 		image[level]->release();
@@ -551,6 +742,7 @@ void Texture2D::setImage(GLint level, GLsizei width, GLsizei height, GLint inter
 void Texture2D::bindTexImage(gl::Surface *surface)
 {
 	image.release();
+	mPendingMipmapTop = mPendingMipmapBase;
 
 	image[0] = surface->getRenderTarget();
 
@@ -561,6 +753,7 @@ void Texture2D::bindTexImage(gl::Surface *surface)
 void Texture2D::releaseTexImage()
 {
 	image.release();
+	mPendingMipmapTop = mPendingMipmapBase;
 
 	if(mSurface)
 	{
@@ -571,6 +764,8 @@ void Texture2D::releaseTexImage()
 
 void Texture2D::setCompressedImage(GLint level, GLenum format, GLsizei width, GLsizei height, GLsizei imageSize, const void *pixels)
 {
+	generatePendingMipmaps();
+
 	if(image[level])
 	{
 		image[level]->release();
@@ -588,16 +783,22 @@ void Texture2D::setCompressedImage(GLint level, GLenum format, GLsizei width, GL
 
 void Texture2D::subImage(GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const gl::PixelStorageModes &unpackParameters, const void *pixels)
 {
+	generatePendingMipmaps();
+
 	Texture::subImage(xoffset, yoffset, 0, width, height, 1, format, type, unpackParameters, pixels, image[level]);
 }
 
 void Texture2D::subImageCompressed(GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLsizei imageSize, const void *pixels)
 {
+	generatePendingMipmaps();
+
 	Texture::subImageCompressed(xoffset, yoffset, 0, width, height, 1, format, imageSize, pixels, image[level]);
 }
 
 void Texture2D::copyImage(GLint level, GLenum internalformat, GLint x, GLint y, GLsizei width, GLsizei height, Renderbuffer *source)
 {
+	generatePendingMipmaps();
+
 	if(image[level])
 	{
 		image[level]->release();
@@ -636,6 +837,8 @@ void Texture2D::copySubImage(GLenum target, GLint level, GLint xoffset, GLint yo
 		return error(GL_INVALID_OPERATION);
 	}
 
+	generatePendingMipmaps();
+
 	if(xoffset + width > image[level]->getWidth() || yoffset + height > image[level]->getHeight() || zoffset != 0)
 	{
 		return error(GL_INVALID_VALUE);
@@ -667,6 +870,8 @@ void Texture2D::setSharedImage(egl::Image *sharedImage)
 		return;
 	}
 
+	generatePendingMipmaps();
+
 	sharedImage->addRef();
 
 	if(image[0])
@@ -768,6 +973,9 @@ void Texture2D::generateMipmaps()
 		return;   // Zero dimension. Not an error.
 	}
 
+	// Levels still pending from an earlier call may derive from another base level
+	generatePendingMipmaps();
+
 	int maxsize = std::max(image[mBaseLevel]->getWidth(), image[mBaseLevel]->getHeight());
 	int p = log2(maxsize) + mBaseLevel;
 	int q = std::min(p, mMaxLevel);
@@ -785,6 +993,30 @@ void Texture2D::generateMipmaps()
 		{
 			return error(GL_OUT_OF_MEMORY);
 		}
+	}
+
+	// Surface buffers are allocated on first lock, so levels which are never sampled or accessed take no memory
+	mPendingMipmapBase = mBaseLevel;
+	mPendingMipmapTop = q;
+
+	// Other textures can modify a shared base level behind our back
+	if(image[mBaseLevel]->isShared())
+	{
+		generatePendingMipmaps();
+	}
+}
+
+void Texture2D::generatePendingMipmaps()
+{
+	int top = mPendingMipmapTop;
+	mPendingMipmapTop = mPendingMipmapBase;
+
+	for(int i = mPendingMipmapBase + 1; i <= top; i++)
+	{
+		if(!image[i - 1] || !image[i])
+		{
+			break;
+		}
 
 		getDevice()->stretchRect(image[i - 1], 0, image[i], 0, Device::ALL_BUFFERS | Device::USE_FILTER);
 	}
@@ -792,6 +1024,11 @@ void Texture2D::generateMipmaps()
 
 egl::Image *Texture2D::getImage(unsigned int level)
 {
+	if((GLint)level > mPendingMipmapBase && (GLint)level <= mPendingMipmapTop)
+	{
+		generatePendingMipmaps();
+	}
+
 	return image[level];
 }
 
@@ -819,6 +1056,8 @@ egl::Image *Texture2D::getRenderTarget(GLenum target, unsigned int level)
 	ASSERT(target == getTarget());
 	ASSERT(level < IMPLEMENTATION_MAX_TEXTURE_LEVELS);
 
+	generatePendingMipmaps();   // Rendering to any level changes what the pending levels derive from
+
 	if(image[level])
 	{
 		image[level]->addRef();
@@ -1965,3 +2204,24 @@ NO_SANITIZE_FUNCTION egl::Image *createDepthStencil(int width, int height, sw::F
 
 	return surface;
 }
+
+#if defined(__linux__) && !defined(__ANDROID__)
+NO_SANITIZE_FUNCTION egl::Image *createImageFromDmaBuf(int width, int height, GLenum internalformat, int fd, size_t offset, int pitch)
+{
+	if(width > es2::IMPLEMENTATION_MAX_RENDERBUFFER_SIZE || height > es2::IMPLEMENTATION_MAX_RENDERBUFFER_SIZE)
+	{
+		ERR("Invalid parameters: %dx%d", width, height);
+		return nullptr;
+	}
+
+	int bytes = sw::Surface::bytes(gl::SelectInternalFormat(internalformat));
+
+	if(pitch < width * bytes || pitch % bytes != 0 || pitch > INT_MAX / height)
+	{
+		ERR("Invalid pitch: %d", pitch);
+		return nullptr;
+	}
+
+	return egl::Image::create(width, height, internalformat, fd, offset, pitch);
+}
+#endif
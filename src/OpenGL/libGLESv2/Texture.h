@@ -27,6 +27,7 @@
 
 #include <GLES2/gl2.h>
 
+#include <atomic>
 #include <vector>
 
 namespace gl { class Surface; }
@@ -45,18 +46,44 @@ enum
 	IMPLEMENTATION_MAX_RENDERBUFFER_SIZE = sw::OUTLINE_RESOLUTION,
 };
 
+// Process-wide pool of threads converting texture uploads from pixel unpack buffers, so the
+// application doesn't wait for them. Accessing an image through ImageLevels waits for the
+// uploads to it to complete, which orders them against any later use of the texture.
+class TextureUploader
+{
+public:
+	// Returns false when the pixels aren't in the current context's pixel unpack buffer
+	static bool schedule(egl::Image *image, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const gl::PixelStorageModes &unpackParameters, const void *pixels);
+	static void finish(const egl::Image *image);
+
+	static bool busy() { return pending.load(std::memory_order_acquire) != 0; }
+
+private:
+	struct Upload;
+	class Queue;
+
+	static std::atomic<int> pending;   // Scheduled uploads which haven't completed yet
+};
+
 class ImageLevels
 {
 public:
 	inline const egl::Image* operator[](size_t index) const
 	{
-		return (index < IMPLEMENTATION_MAX_TEXTURE_LEVELS) ? image[index] : nullptr;
+		if(index < IMPLEMENTATION_MAX_TEXTURE_LEVELS)
+		{
+			if(TextureUploader::busy()) TextureUploader::finish(image[index]);
+			return image[index];
+		}
+
+		return nullptr;
 	}
 
 	inline egl::Image*& operator[](size_t index)
 	{
 		if(index < IMPLEMENTATION_MAX_TEXTURE_LEVELS)
 		{
+			if(TextureUploader::busy()) TextureUploader::finish(image[index]);
 			return image[index];
 		}
 
@@ -71,6 +98,7 @@ public:
 		{
 			if(image[i])
 			{
+				if(TextureUploader::busy()) TextureUploader::finish(image[i]);
 				image[i]->release();
 				image[i] = nullptr;
 			}
@@ -83,6 +111,7 @@ public:
 		{
 			if(image[i])
 			{
+				if(TextureUploader::busy()) TextureUploader::finish(image[i]);
 				image[i]->unbind(texture);
 				image[i] = nullptr;
 			}
@@ -142,6 +171,10 @@ public:
 	GLenum getSwizzleB() const { return mSwizzleB; }
 	GLenum getSwizzleA() const { return mSwizzleA; }
 
+	// Changes whenever any of the above sampling parameters may have changed. Unique in the process,
+	// so it also tells apart textures reusing the memory of deleted ones.
+	unsigned int getParameterSerial() const { return mParameterSerial; }
+
 	virtual GLsizei getWidth(GLenum target, GLint level) const = 0;
 	virtual GLsizei getHeight(GLenum target, GLint level) const = 0;
 	virtual GLsizei getDepth(GLenum target, GLint level) const;
@@ -150,6 +183,7 @@ public:
 	virtual bool requiresSync() const = 0;
 
 	virtual bool isSamplerComplete(Sampler *sampler) const = 0;
+	bool isMipmapFiltered(Sampler *sampler) const;
 	virtual bool isCompressed(GLenum target, GLint level) const = 0;
 	virtual bool isDepth(GLenum target, GLint level) const = 0;
 
@@ -171,7 +205,7 @@ protected:
 
 	bool copy(egl::Image *source, const sw::SliceRect &sourceRect, GLint xoffset, GLint yoffset, GLint zoffset, egl::Image *dest);
 
-	bool isMipmapFiltered(Sampler *sampler) const;
+	static unsigned int issueSerial();
 
 	GLenum mMinFilter;
 	GLenum mMagFilter;
@@ -191,6 +225,7 @@ protected:
 	GLenum mSwizzleG;
 	GLenum mSwizzleB;
 	GLenum mSwizzleA;
+	unsigned int mParameterSerial;
 
 	sw::Resource *resource;
 };
@@ -239,9 +274,15 @@ protected:
 	~Texture2D() override;
 
 	bool isMipmapComplete() const;
+	void generatePendingMipmaps();
 
 	ImageLevels image;
 
+	// Levels above mPendingMipmapBase, up to mPendingMipmapTop, were created by generateMipmaps()
+	// but get filled from their parent level only once their contents are first needed.
+	GLint mPendingMipmapBase;
+	GLint mPendingMipmapTop;
+
 	gl::Surface *mSurface;
 
 	// A specific internal reference count is kept for colorbuffer proxy references,
@@ -0,0 +1,226 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// TraceFormat.h: Defines the binary layout of the GL call traces written by
+// TraceRecorder and played back by the GLReplay tool.
+//
+// A trace starts with a TraceHeader, followed by one record per call. Each
+// record is a TraceCall identifier and the byte size of its payload, both
+// 32-bit. Payloads are sequences of 32-bit words: integers and floats take
+// one word and pointer-sized integers take two. Pointer arguments start with
+// a TracePointer tag. Offsets into buffer objects follow as two words, and
+// client memory as a byte count followed by the bytes, padded to a word.
+// All values are stored in the byte order of the recording machine.
+
+#ifndef LIBGLESV2_TRACEFORMAT_H_
+#define LIBGLESV2_TRACEFORMAT_H_
+
+#include <stdint.h>
+
+namespace es2
+{
+
+enum : uint32_t
+{
+	TRACE_MAGIC = 0x54575347,   // "GSWT"
+	TRACE_VERSION = 1,
+};
+
+struct TraceHeader
+{
+	uint32_t magic;
+	uint32_t version;
+};
+
+enum TracePointer : uint32_t
+{
+	TRACE_POINTER_NULL,
+	TRACE_POINTER_OFFSET,   // Into the bound buffer object
+	TRACE_POINTER_DATA,     // Client memory, stored inline
+	TRACE_POINTER_CLIENT,   // Client vertex array, stored by TRACE_CLIENT_VERTEX_DATA when drawing
+};
+
+// GL entry points captured by the recorder, with their extension aliases.
+// Payloads hold the arguments in declaration order. SPECIAL calls can't be
+// replayed from their arguments alone: Gen and Create calls store the names
+// they returned, ReadPixels only stores the offset of its destination, and
+// ShaderSource stores the shader name and the concatenated source string.
+#define GL_TRACE_CALLS(CALL, SPECIAL) \
+	CALL(ActiveTexture) \
+	CALL(AttachShader) \
+	CALL(BindAttribLocation) \
+	CALL(BindBuffer) \
+	CALL(BindBufferBase) \
+	CALL(BindBufferRange) \
+	CALL(BindFramebuffer) \
+	CALL(BindRenderbuffer) \
+	CALL(BindSampler) \
+	CALL(BindTexture) \
+	CALL(BindVertexArray) \
+	CALL(BlendColor) \
+	CALL(BlendEquation) \
+	CALL(BlendEquationSeparate) \
+	CALL(BlendFunc) \
+	CALL(BlendFuncSeparate) \
+	CALL(BlitFramebuffer) \
+	CALL(BufferData) \
+	CALL(BufferSubData) \
+	CALL(Clear) \
+	CALL(ClearColor) \
+	CALL(ClearDepthf) \
+	CALL(ClearStencil) \
+	CALL(ColorMask) \
+	CALL(CompileShader) \
+	CALL(CompressedTexImage2D) \
+	CALL(CompressedTexSubImage2D) \
+	CALL(CopyTexImage2D) \
+	CALL(CopyTexSubImage2D) \
+	SPECIAL(CreateProgram) \
+	SPECIAL(CreateShader) \
+	CALL(CullFace) \
+	CALL(DeleteBuffers) \
+	CALL(DeleteFramebuffers) \
+	CALL(DeleteProgram) \
+	CALL(DeleteRenderbuffers) \
+	CALL(DeleteSamplers) \
+	CALL(DeleteShader) \
+	CALL(DeleteTextures) \
+	CALL(DeleteVertexArrays) \
+	CALL(DepthFunc) \
+	CALL(DepthMask) \
+	CALL(DepthRangef) \
+	CALL(DetachShader) \
+	CALL(Disable) \
+	CALL(DisableVertexAttribArray) \
+	CALL(DrawArrays) \
+	CALL(DrawArraysInstanced) \
+	CALL(DrawBuffers) \
+	CALL(DrawElements) \
+	CALL(DrawElementsInstanced) \
+	CALL(DrawRangeElements) \
+	CALL(Enable) \
+	CALL(EnableVertexAttribArray) \
+	CALL(Finish) \
+	CALL(Flush) \
+	CALL(FramebufferRenderbuffer) \
+	CALL(FramebufferTexture2D) \
+	CALL(FramebufferTextureLayer) \
+	CALL(FrontFace) \
+	SPECIAL(GenBuffers) \
+	CALL(GenerateMipmap) \
+	SPECIAL(GenFramebuffers) \
+	SPECIAL(GenRenderbuffers) \
+	SPECIAL(GenSamplers) \
+	SPECIAL(GenTextures) \
+	SPECIAL(GenVertexArrays) \
+	CALL(Hint) \
+	CALL(InvalidateFramebuffer) \
+	CALL(LineWidth) \
+	CALL(LinkProgram) \
+	CALL(PixelStorei) \
+	CALL(PolygonOffset) \
+	CALL(ReadBuffer) \
+	SPECIAL(ReadPixels) \
+	CALL(RenderbufferStorage) \
+	CALL(RenderbufferStorageMultisample) \
+	CALL(SampleCoverage) \
+	CALL(SamplerParameterf) \
+	CALL(SamplerParameteri) \
+	CALL(Scissor) \
+	SPECIAL(ShaderSource) \
+	CALL(StencilFunc) \
+	CALL(StencilFuncSeparate) \
+	CALL(StencilMask) \
+	CALL(StencilMaskSeparate) \
+	CALL(StencilOp) \
+	CALL(StencilOpSeparate) \
+	CALL(TexImage2D) \
+	CALL(TexImage3D) \
+	CALL(TexParameterf) \
+	CALL(TexParameterfv) \
+	CALL(TexParameteri) \
+	CALL(TexParameteriv) \
+	CALL(TexStorage2D) \
+	CALL(TexStorage3D) \
+	CALL(TexSubImage2D) \
+	CALL(TexSubImage3D) \
+	CALL(Uniform1f) \
+	CALL(Uniform1fv) \
+	CALL(Uniform1i) \
+	CALL(Uniform1iv) \
+	CALL(Uniform1ui) \
+	CALL(Uniform1uiv) \
+	CALL(Uniform2f) \
+	CALL(Uniform2fv) \
+	CALL(Uniform2i) \
+	CALL(Uniform2iv) \
+	CALL(Uniform2ui) \
+	CALL(Uniform2uiv) \
+	CALL(Uniform3f) \
+	CALL(Uniform3fv) \
+	CALL(Uniform3i) \
+	CALL(Uniform3iv) \
+	CALL(Uniform3ui) \
+	CALL(Uniform3uiv) \
+	CALL(Uniform4f) \
+	CALL(Uniform4fv) \
+	CALL(Uniform4i) \
+	CALL(Uniform4iv) \
+	CALL(Uniform4ui) \
+	CALL(Uniform4uiv) \
+	CALL(UniformBlockBinding) \
+	CALL(UniformMatrix2fv) \
+	CALL(UniformMatrix2x3fv) \
+	CALL(UniformMatrix2x4fv) \
+	CALL(UniformMatrix3fv) \
+	CALL(UniformMatrix3x2fv) \
+	CALL(UniformMatrix3x4fv) \
+	CALL(UniformMatrix4fv) \
+	CALL(UniformMatrix4x2fv) \
+	CALL(UniformMatrix4x3fv) \
+	CALL(UseProgram) \
+	CALL(VertexAttrib1f) \
+	CALL(VertexAttrib1fv) \
+	CALL(VertexAttrib2f) \
+	CALL(VertexAttrib2fv) \
+	CALL(VertexAttrib3f) \
+	CALL(VertexAttrib3fv) \
+	CALL(VertexAttrib4f) \
+	CALL(VertexAttrib4fv) \
+	CALL(VertexAttribDivisor) \
+	CALL(VertexAttribI4i) \
+	CALL(VertexAttribI4iv) \
+	CALL(VertexAttribI4ui) \
+	CALL(VertexAttribI4uiv) \
+	CALL(VertexAttribIPointer) \
+	CALL(VertexAttribPointer) \
+	CALL(Viewport)
+
+enum TraceCall : uint32_t
+{
+	TRACE_MAKE_CURRENT,          // Surface width and height, or zero without a surface
+	TRACE_FRAME_END,             // eglSwapBuffers
+	TRACE_CLIENT_VERTEX_DATA,    // Attribute index, size, type, normalized, pure integer, stride, first vertex, data
+
+	#define TRACE_CALL_ENUM(name) TRACE_##name,
+	GL_TRACE_CALLS(TRACE_CALL_ENUM, TRACE_CALL_ENUM)
+	#undef TRACE_CALL_ENUM
+
+	TRACE_CALL_COUNT
+};
+
+}
+
+#endif   // LIBGLESV2_TRACEFORMAT_H_
@@ -0,0 +1,381 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// TraceRecorder.cpp: Implements the TraceRecorder class, which writes GL call
+// traces for offline replay.
+
+#include "TraceRecorder.h"
+
+#include "main.h"
+#include "Buffer.h"
+#include "Context.h"
+#include "common/Image.hpp"
+
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+namespace
+{
+	class TraceFile
+	{
+	public:
+		~TraceFile()
+		{
+			if(file)
+			{
+				fclose(file);
+			}
+		}
+
+		void write(es2::TraceCall call, const std::vector<uint32_t> &payload)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			if(!file && !failed)
+			{
+				file = fopen(getenv("SWIFTSHADER_GL_TRACE_FILE"), "wb");
+				failed = !file;
+
+				if(file)
+				{
+					es2::TraceHeader header = {es2::TRACE_MAGIC, es2::TRACE_VERSION};
+					fwrite(&header, sizeof(header), 1, file);
+				}
+			}
+
+			if(file)
+			{
+				uint32_t record[2] = {call, (uint32_t)(payload.size() * sizeof(uint32_t))};
+				fwrite(record, sizeof(record), 1, file);
+				fwrite(payload.data(), sizeof(uint32_t), payload.size(), file);
+
+				if(call == es2::TRACE_FRAME_END)
+				{
+					fflush(file);   // Keeps complete frames when the process gets killed
+				}
+			}
+		}
+
+	private:
+		std::mutex mutex;
+		FILE *file = nullptr;
+		bool failed = false;
+	};
+
+	TraceFile traceFile;
+
+	// Reads the range of vertices referenced by an index array, skipping primitive restart indices
+	template<class Index>
+	bool indexRange(const void *indices, GLsizei count, bool primitiveRestart, GLuint &minIndex, GLuint &maxIndex)
+	{
+		const Index *index = static_cast<const Index*>(indices);
+		const Index restart = static_cast<Index>(~0u);
+		bool found = false;
+
+		for(GLsizei i = 0; i < count; i++)
+		{
+			if(primitiveRestart && index[i] == restart)
+			{
+				continue;
+			}
+
+			if(!found)
+			{
+				minIndex = maxIndex = index[i];
+				found = true;
+			}
+			else if(index[i] < minIndex)
+			{
+				minIndex = index[i];
+			}
+			else if(index[i] > maxIndex)
+			{
+				maxIndex = index[i];
+			}
+		}
+
+		return found;
+	}
+}
+
+namespace es2
+{
+
+const bool TraceRecorder::active = getenv("SWIFTSHADER_GL_TRACE_FILE") != nullptr;
+
+TraceRecorder::TraceRecorder(TraceCall call) : call(call)
+{
+}
+
+TraceRecorder::~TraceRecorder()
+{
+	traceFile.write(call, payload);
+}
+
+TraceRecorder &TraceRecorder::operator<<(GLuint value)
+{
+	payload.push_back(value);
+	return *this;
+}
+
+TraceRecorder &TraceRecorder::operator<<(GLint value)
+{
+	payload.push_back(static_cast<uint32_t>(value));
+	return *this;
+}
+
+TraceRecorder &TraceRecorder::operator<<(GLfloat value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	payload.push_back(bits);
+	return *this;
+}
+
+TraceRecorder &TraceRecorder::operator<<(GLboolean value)
+{
+	payload.push_back(value);
+	return *this;
+}
+
+TraceRecorder &TraceRecorder::operator<<(long value)
+{
+	return *this << static_cast<long long>(value);
+}
+
+TraceRecorder &TraceRecorder::operator<<(long long value)
+{
+	int64_t value64 = value;
+	append(&value64, sizeof(value64));
+	return *this;
+}
+
+TraceRecorder &TraceRecorder::operator<<(const TraceData &data)
+{
+	payload.push_back(data.type);
+
+	switch(data.type)
+	{
+	case TRACE_POINTER_OFFSET:
+		*this << static_cast<long long>(reinterpret_cast<intptr_t>(data.pointer));
+		break;
+	case TRACE_POINTER_DATA:
+		payload.push_back(static_cast<uint32_t>(data.size));
+		append(data.pointer, data.size);
+		break;
+	default:
+		break;
+	}
+
+	return *this;
+}
+
+void TraceRecorder::append(const void *data, size_t size)
+{
+	size_t start = payload.size();
+	payload.resize(start + (size + sizeof(uint32_t) - 1) / sizeof(uint32_t), 0);
+	memcpy(&payload[start], data, size);
+}
+
+TraceData TraceRecorder::pixels(const void *pixels, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type)
+{
+	auto context = getContext();
+
+	if(!context || context->getPixelUnpackBuffer())
+	{
+		return traceOffset(pixels);
+	}
+
+	if(!pixels || width <= 0 || height <= 0 || depth <= 0)
+	{
+		return traceData(nullptr, 0);
+	}
+
+	// Covers the skipped rows and images, but stops at the last pixel read
+	const gl::PixelStorageModes &unpack = context->getUnpackParameters();
+	GLsizei rowWidth = unpack.rowLength ? unpack.rowLength : width;
+	GLsizei imageHeight = unpack.imageHeight ? unpack.imageHeight : height;
+	size_t pitch = gl::ComputePitch(rowWidth, format, type, unpack.alignment);
+	size_t row = gl::ComputePitch(width, format, type, 1);
+	size_t size = gl::ComputePackingOffset(format, type, rowWidth, imageHeight, unpack) +
+	              pitch * (imageHeight * (depth - 1) + height - 1) + row;
+
+	return traceData(pixels, size);
+}
+
+TraceData TraceRecorder::compressedPixels(const void *data, GLsizei imageSize)
+{
+	auto context = getContext();
+
+	if(!context || context->getPixelUnpackBuffer())
+	{
+		return traceOffset(data);
+	}
+
+	return traceData(data, (imageSize > 0) ? imageSize : 0);
+}
+
+TraceData TraceRecorder::indices(const void *indices, GLsizei count, GLenum type)
+{
+	auto context = getContext();
+
+	if(!context || context->getElementArrayBuffer())
+	{
+		return traceOffset(indices);
+	}
+
+	size_t indexSize = (type == GL_UNSIGNED_INT) ? 4 : (type == GL_UNSIGNED_SHORT) ? 2 : 1;
+
+	return traceData(indices, (count > 0) ? count * indexSize : 0);
+}
+
+TraceData TraceRecorder::attribPointer(const void *pointer)
+{
+	auto context = getContext();
+
+	if(!context || context->getArrayBuffer())
+	{
+		return traceOffset(pointer);
+	}
+
+	return {TRACE_POINTER_CLIENT, pointer, 0};
+}
+
+void TraceRecorder::clientVertexData(GLint first, GLsizei count, GLsizei instanceCount)
+{
+	auto context = getContext();
+
+	if(!context || first < 0 || count <= 0 || instanceCount <= 0)
+	{
+		return;
+	}
+
+	for(unsigned int i = 0; i < MAX_VERTEX_ATTRIBS; i++)
+	{
+		const VertexAttribute &attribute = context->getVertexAttribState(i);
+
+		if(!attribute.mArrayEnabled || attribute.mBoundBuffer || !attribute.mPointer)
+		{
+			continue;
+		}
+
+		GLint start = first;
+		GLsizei vertices = count;
+
+		if(attribute.mDivisor != 0)
+		{
+			start = 0;
+			vertices = (instanceCount - 1) / attribute.mDivisor + 1;
+		}
+
+		GLsizei stride = attribute.stride();
+		size_t size = (vertices - 1) * stride + attribute.typeSize();
+		const void *data = static_cast<const char*>(attribute.mPointer) + start * stride;
+
+		TraceRecorder(TRACE_CLIENT_VERTEX_DATA) << i << attribute.mSize << attribute.mType << GLboolean(attribute.mNormalized)
+		                                        << GLboolean(attribute.mPureInteger) << stride << start << traceData(data, size);
+	}
+}
+
+void TraceRecorder::clientVertexData(const void *indices, GLsizei count, GLenum type, GLsizei instanceCount)
+{
+	GLuint minIndex = 0;
+	GLuint maxIndex = 0;
+	bool found = false;
+
+	{
+		auto context = getContext();
+
+		if(!context || count <= 0)
+		{
+			return;
+		}
+
+		Buffer *elementBuffer = context->getElementArrayBuffer();
+
+		if(elementBuffer)
+		{
+			const char *data = static_cast<const char*>(elementBuffer->data());
+			size_t offset = reinterpret_cast<size_t>(indices);
+			size_t indexSize = (type == GL_UNSIGNED_INT) ? 4 : (type == GL_UNSIGNED_SHORT) ? 2 : 1;
+
+			if(!data || offset + count * indexSize > elementBuffer->size())
+			{
+				return;
+			}
+
+			indices = data + offset;
+		}
+
+		if(!indices)
+		{
+			return;
+		}
+
+		bool primitiveRestart = context->isPrimitiveRestartFixedIndexEnabled();
+
+		switch(type)
+		{
+		case GL_UNSIGNED_BYTE:  found = indexRange<GLubyte>(indices, count, primitiveRestart, minIndex, maxIndex);  break;
+		case GL_UNSIGNED_SHORT: found = indexRange<GLushort>(indices, count, primitiveRestart, minIndex, maxIndex); break;
+		case GL_UNSIGNED_INT:   found = indexRange<GLuint>(indices, count, primitiveRestart, minIndex, maxIndex);   break;
+		default: return;
+		}
+	}
+
+	if(found)
+	{
+		clientVertexData(static_cast<GLint>(minIndex), static_cast<GLsizei>(maxIndex - minIndex + 1), instanceCount);
+	}
+}
+
+void TraceRecorder::shaderSource(GLuint shader, GLsizei count, const GLchar *const *string, const GLint *length)
+{
+	std::string source;
+
+	for(GLsizei i = 0; i < count && string; i++)
+	{
+		if(!string[i])
+		{
+			continue;
+		}
+
+		if(length && length[i] >= 0)
+		{
+			source.append(string[i], length[i]);
+		}
+		else
+		{
+			source.append(string[i]);
+		}
+	}
+
+	TraceRecorder(TRACE_ShaderSource) << shader << traceString(source.c_str());
+}
+
+void TraceRecorder::makeCurrent(GLsizei width, GLsizei height)
+{
+	TraceRecorder(TRACE_MAKE_CURRENT) << width << height;
+}
+
+void TraceRecorder::frameEnd()
+{
+	TraceRecorder record(TRACE_FRAME_END);
+}
+
+}
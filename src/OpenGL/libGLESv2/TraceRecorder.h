@@ -0,0 +1,114 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// TraceRecorder.h: Defines the TraceRecorder class, which serializes GL calls
+// made through the exported entry points to the file named by the
+// SWIFTSHADER_GL_TRACE_FILE environment variable. See TraceFormat.h.
+
+#ifndef LIBGLESV2_TRACERECORDER_H_
+#define LIBGLESV2_TRACERECORDER_H_
+
+#include "TraceFormat.h"
+
+#include <GLES2/gl2.h>
+#include <GLES3/gl3.h>
+
+#include <stddef.h>
+#include <string.h>
+#include <vector>
+
+// Records a call when tracing is enabled. The arguments are appended with
+// operator<<, and the record is written at the end of the statement.
+#define TRACE_GL(name) if(!es2::TraceRecorder::enabled()) {} else es2::TraceRecorder(es2::TRACE_##name)
+
+namespace es2
+{
+
+struct TraceData
+{
+	TracePointer type;
+	const void *pointer;
+	size_t size;   // Bytes of client memory, for TRACE_POINTER_DATA
+};
+
+inline TraceData traceData(const void *data, size_t size)
+{
+	return {data ? TRACE_POINTER_DATA : TRACE_POINTER_NULL, data, size};
+}
+
+inline TraceData traceOffset(const void *offset)
+{
+	return {TRACE_POINTER_OFFSET, offset, 0};
+}
+
+template<class T>
+inline TraceData traceArray(const T *array, ptrdiff_t count, int components = 1)
+{
+	return traceData(array, (count > 0) ? count * components * sizeof(T) : 0);
+}
+
+inline TraceData traceString(const char *string)
+{
+	return traceData(string, string ? strlen(string) + 1 : 0);
+}
+
+class TraceRecorder
+{
+public:
+	explicit TraceRecorder(TraceCall call);
+
+	~TraceRecorder();   // Appends the record to the trace
+
+	static bool enabled()
+	{
+		return active;
+	}
+
+	TraceRecorder &operator<<(GLuint value);
+	TraceRecorder &operator<<(GLint value);
+	TraceRecorder &operator<<(GLfloat value);
+	TraceRecorder &operator<<(GLboolean value);
+	TraceRecorder &operator<<(long value);
+	TraceRecorder &operator<<(long long value);
+	TraceRecorder &operator<<(const TraceData &data);
+
+	// Pointer arguments which are offsets when a buffer is bound to their target
+	static TraceData pixels(const void *pixels, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type);
+	static TraceData indices(const void *indices, GLsizei count, GLenum type);
+	static TraceData compressedPixels(const void *data, GLsizei imageSize);
+	static TraceData attribPointer(const void *pointer);
+
+	// Stores the client side vertex arrays read by a draw call, before recording it
+	static void clientVertexData(GLint first, GLsizei count, GLsizei instanceCount);
+	static void clientVertexData(const void *indices, GLsizei count, GLenum type, GLsizei instanceCount);
+
+	// Records the concatenated strings, with their lengths
+	static void shaderSource(GLuint shader, GLsizei count, const GLchar *const *string, const GLint *length);
+
+	static void makeCurrent(GLsizei width, GLsizei height);
+	static void frameEnd();
+
+private:
+	void append(const void *data, size_t size);
+
+	std::vector<uint32_t> payload;
+	const TraceCall call;
+
+	static const bool active;
+};
+
+}
+
+#endif   // LIBGLESV2_TRACERECORDER_H_
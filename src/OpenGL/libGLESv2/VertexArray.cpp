@@ -17,7 +17,7 @@
 namespace es2
 {
 
-VertexArray::VertexArray(GLuint name) : gl::NamedObject(name)
+VertexArray::VertexArray(GLuint name) : gl::NamedObject(name), mTranslationDirty(true)
 {
 }
 
@@ -37,6 +37,7 @@ void VertexArray::detachBuffer(GLuint bufferName)
 		if(mVertexAttributes[attribute].mBoundBuffer.name() == bufferName)
 		{
 			mVertexAttributes[attribute].mBoundBuffer = nullptr;
+			mTranslationDirty = true;
 		}
 	}
 
@@ -56,12 +57,14 @@ void VertexArray::setVertexAttribDivisor(GLuint index, GLuint divisor)
 {
 	ASSERT(index < MAX_VERTEX_ATTRIBS);
 	mVertexAttributes[index].mDivisor = divisor;
+	mTranslationDirty = true;
 }
 
 void VertexArray::enableAttribute(unsigned int attributeIndex, bool enabledState)
 {
 	ASSERT(attributeIndex < MAX_VERTEX_ATTRIBS);
 	mVertexAttributes[attributeIndex].mArrayEnabled = enabledState;
+	mTranslationDirty = true;
 }
 
 void VertexArray::setAttributeState(unsigned int attributeIndex, Buffer *boundBuffer, GLint size, GLenum type,
@@ -75,6 +78,7 @@ void VertexArray::setAttributeState(unsigned int attributeIndex, Buffer *boundBu
 	mVertexAttributes[attributeIndex].mPureInteger = pureInteger;
 	mVertexAttributes[attributeIndex].mStride = stride;
 	mVertexAttributes[attributeIndex].mPointer = pointer;
+	mTranslationDirty = true;
 }
 
 void VertexArray::setElementArrayBuffer(Buffer *buffer)
@@ -82,4 +86,58 @@ void VertexArray::setElementArrayBuffer(Buffer *buffer)
 	mElementArrayBuffer = buffer;
 }
 
+const TranslatedAttribute *VertexArray::getTranslatedAttributes()
+{
+	if(!mTranslationDirty)
+	{
+		return mTranslated;
+	}
+
+	for(int i = 0; i < MAX_VERTEX_ATTRIBS; i++)
+	{
+		const VertexAttribute &attrib = mVertexAttributes[i];
+		TranslatedAttribute &translated = mTranslated[i];
+
+		if(!attrib.mArrayEnabled)
+		{
+			continue;
+		}
+
+		const bool isInstanced = attrib.mDivisor > 0;
+
+		// Client arrays get gathered into tightly packed streams
+		GLsizei stride = attrib.mBoundBuffer ? attrib.stride() : attrib.typeSize();
+
+		translated.offset = attrib.mBoundBuffer ? static_cast<unsigned int>(attrib.mOffset) : 0;
+		translated.stride = isInstanced ? 0 : stride;
+		translated.instanceStride = isInstanced ? stride : 0;
+		translated.divisor = attrib.mDivisor;
+		translated.vertexBuffer = nullptr;
+
+		switch(attrib.mType)
+		{
+		case GL_BYTE:           translated.type = sw::STREAMTYPE_SBYTE;  break;
+		case GL_UNSIGNED_BYTE:  translated.type = sw::STREAMTYPE_BYTE;   break;
+		case GL_SHORT:          translated.type = sw::STREAMTYPE_SHORT;  break;
+		case GL_UNSIGNED_SHORT: translated.type = sw::STREAMTYPE_USHORT; break;
+		case GL_INT:            translated.type = sw::STREAMTYPE_INT;    break;
+		case GL_UNSIGNED_INT:   translated.type = sw::STREAMTYPE_UINT;   break;
+		case GL_FIXED:          translated.type = sw::STREAMTYPE_FIXED;  break;
+		case GL_FLOAT:          translated.type = sw::STREAMTYPE_FLOAT;  break;
+		case GL_HALF_FLOAT:     translated.type = sw::STREAMTYPE_HALF;   break;
+		case GL_HALF_FLOAT_OES: translated.type = sw::STREAMTYPE_HALF;   break;
+		case GL_INT_2_10_10_10_REV:          translated.type = sw::STREAMTYPE_2_10_10_10_INT;  break;
+		case GL_UNSIGNED_INT_2_10_10_10_REV: translated.type = sw::STREAMTYPE_2_10_10_10_UINT; break;
+		default: UNREACHABLE(attrib.mType); translated.type = sw::STREAMTYPE_FLOAT;  break;
+		}
+
+		translated.count = attrib.mSize;
+		translated.normalized = attrib.mNormalized;
+	}
+
+	mTranslationDirty = false;
+
+	return mTranslated;
+}
+
 }
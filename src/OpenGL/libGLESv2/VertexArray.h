@@ -19,6 +19,7 @@
 
 #include "Buffer.h"
 #include "Context.h"
+#include "VertexDataManager.h"
 
 #include <GLES2/gl2.h>
 
@@ -43,9 +44,17 @@ public:
 	Buffer *getElementArrayBuffer() const { return mElementArrayBuffer; }
 	void setElementArrayBuffer(Buffer *buffer);
 
+	// Stream setup of the enabled attributes, only rebuilt after attribute state changes. Offsets are
+	// relative to the first vertex, and the resources are left for the draw since buffers can orphan
+	// their storage.
+	const TranslatedAttribute *getTranslatedAttributes();
+
 private:
 	VertexAttributeArray mVertexAttributes;
 	gl::BindingPointer<Buffer> mElementArrayBuffer;
+
+	TranslatedAttribute mTranslated[MAX_VERTEX_ATTRIBS];
+	bool mTranslationDirty;
 };
 
 }
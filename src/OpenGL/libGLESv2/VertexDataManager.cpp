@@ -25,6 +25,18 @@
 namespace
 {
 	enum {INITIAL_STREAM_BUFFER_SIZE = 1024 * 1024};
+
+	// Gathers strided elements, with a size known at compile time so the copies get inlined
+	template<int elementSize>
+	void copyElements(char *output, const char *input, int inputStride, GLsizei count)
+	{
+		for(int i = 0; i < count; i++)
+		{
+			memcpy(output, input, elementSize);
+			output += elementSize;
+			input += inputStride;
+		}
+	}
 }
 
 namespace es2
@@ -96,11 +108,19 @@ unsigned int VertexDataManager::writeAttributeData(StreamingVertexBuffer *vertex
 	}
 	else
 	{
-		for(int i = 0; i < count; i++)
+		switch(elementSize)
 		{
-			memcpy(output, input, elementSize);
-			output += elementSize;
-			input += inputStride;
+		case 4:  copyElements<4>(output, input, inputStride, count);  break;
+		case 8:  copyElements<8>(output, input, inputStride, count);  break;
+		case 12: copyElements<12>(output, input, inputStride, count); break;
+		case 16: copyElements<16>(output, input, inputStride, count); break;
+		default:
+			for(int i = 0; i < count; i++)
+			{
+				memcpy(output, input, elementSize);
+				output += elementSize;
+				input += inputStride;
+			}
 		}
 	}
 
@@ -109,7 +129,7 @@ unsigned int VertexDataManager::writeAttributeData(StreamingVertexBuffer *vertex
 	return streamOffset;
 }
 
-GLenum VertexDataManager::prepareVertexData(GLint start, GLsizei count, TranslatedAttribute *translated, GLsizei instanceId)
+GLenum VertexDataManager::prepareVertexData(GLint start, GLsizei count, TranslatedAttribute *translated, GLsizei instanceCount)
 {
 	if(!mStreamingBuffer)
 	{
@@ -130,7 +150,7 @@ GLenum VertexDataManager::prepareVertexData(GLint start, GLsizei count, Translat
 			if(!attrib.mBoundBuffer)
 			{
 				const bool isInstanced = attrib.mDivisor > 0;
-				mStreamingBuffer->addRequiredSpace(attrib.typeSize() * (isInstanced ? 1 : count));
+				mStreamingBuffer->addRequiredSpace(attrib.typeSize() * (isInstanced ? (GLsizei)((instanceCount - 1) / attrib.mDivisor) + 1 : count));
 			}
 		}
 	}
@@ -138,6 +158,8 @@ GLenum VertexDataManager::prepareVertexData(GLint start, GLsizei count, Translat
 	mStreamingBuffer->reserveRequiredSpace();
 
 	// Perform the vertex data translations
+	const TranslatedAttribute *arrays = mContext->getVertexArrayTranslation();
+
 	for(int i = 0; i < MAX_VERTEX_ATTRIBS; i++)
 	{
 		if(program->getAttributeStream(i) != -1)
@@ -148,8 +170,8 @@ GLenum VertexDataManager::prepareVertexData(GLint start, GLsizei count, Translat
 			{
 				const bool isInstanced = attrib.mDivisor > 0;
 
-				// Instanced vertices do not apply the 'start' offset
-				GLint firstVertexIndex = isInstanced ? instanceId / attrib.mDivisor : start;
+				// Instanced vertices do not apply the 'start' offset, the renderer steps through them per instance
+				GLint firstVertexIndex = isInstanced ? 0 : start;
 
 				Buffer *buffer = attrib.mBoundBuffer;
 
@@ -160,17 +182,19 @@ GLenum VertexDataManager::prepareVertexData(GLint start, GLsizei count, Translat
 					return GL_INVALID_OPERATION;
 				}
 
-				sw::Resource *staticBuffer = buffer ? buffer->getResource() : nullptr;
+				// The format and strides only change along with the vertex array state
+				translated[i] = arrays[i];
 
-				if(staticBuffer)
+				// All vertex formats are read natively by the Renderer, so buffer objects are
+				// used in place. Only client arrays get copied, as they may change at any time.
+				if(buffer)
 				{
-					translated[i].vertexBuffer = staticBuffer;
-					translated[i].offset = firstVertexIndex * attrib.stride() + static_cast<int>(attrib.mOffset);
-					translated[i].stride = isInstanced ? 0 : attrib.stride();
+					translated[i].vertexBuffer = buffer->getResource();
+					translated[i].offset += firstVertexIndex * translated[i].stride;
 				}
 				else
 				{
-					unsigned int streamOffset = writeAttributeData(mStreamingBuffer, firstVertexIndex, isInstanced ? 1 : count, attrib);
+					unsigned int streamOffset = writeAttributeData(mStreamingBuffer, firstVertexIndex, isInstanced ? (GLsizei)((instanceCount - 1) / attrib.mDivisor) + 1 : count, attrib);
 
 					if(streamOffset == ~0u)
 					{
@@ -179,28 +203,7 @@ GLenum VertexDataManager::prepareVertexData(GLint start, GLsizei count, Translat
 
 					translated[i].vertexBuffer = mStreamingBuffer->getResource();
 					translated[i].offset = streamOffset;
-					translated[i].stride = isInstanced ? 0 : attrib.typeSize();
 				}
-
-				switch(attrib.mType)
-				{
-				case GL_BYTE:           translated[i].type = sw::STREAMTYPE_SBYTE;  break;
-				case GL_UNSIGNED_BYTE:  translated[i].type = sw::STREAMTYPE_BYTE;   break;
-				case GL_SHORT:          translated[i].type = sw::STREAMTYPE_SHORT;  break;
-				case GL_UNSIGNED_SHORT: translated[i].type = sw::STREAMTYPE_USHORT; break;
-				case GL_INT:            translated[i].type = sw::STREAMTYPE_INT;    break;
-				case GL_UNSIGNED_INT:   translated[i].type = sw::STREAMTYPE_UINT;   break;
-				case GL_FIXED:          translated[i].type = sw::STREAMTYPE_FIXED;  break;
-				case GL_FLOAT:          translated[i].type = sw::STREAMTYPE_FLOAT;  break;
-				case GL_HALF_FLOAT:     translated[i].type = sw::STREAMTYPE_HALF;   break;
-				case GL_HALF_FLOAT_OES: translated[i].type = sw::STREAMTYPE_HALF;   break;
-				case GL_INT_2_10_10_10_REV:          translated[i].type = sw::STREAMTYPE_2_10_10_10_INT;  break;
-				case GL_UNSIGNED_INT_2_10_10_10_REV: translated[i].type = sw::STREAMTYPE_2_10_10_10_UINT; break;
-				default: UNREACHABLE(attrib.mType); translated[i].type = sw::STREAMTYPE_FLOAT;  break;
-				}
-
-				translated[i].count = attrib.mSize;
-				translated[i].normalized = attrib.mNormalized;
 			}
 			else
 			{
@@ -227,6 +230,8 @@ GLenum VertexDataManager::prepareVertexData(GLint start, GLsizei count, Translat
 				}
 				translated[i].count = 4;
 				translated[i].stride = 0;
+				translated[i].divisor = 0;
+				translated[i].instanceStride = 0;
 				translated[i].offset = 0;
 				translated[i].normalized = false;
 			}
@@ -289,7 +294,7 @@ ConstantVertexBuffer::~ConstantVertexBuffer()
 {
 }
 
-StreamingVertexBuffer::StreamingVertexBuffer(unsigned int size) : VertexBuffer(size)
+StreamingVertexBuffer::StreamingVertexBuffer(unsigned int size) : VertexBuffer(size), mBufferPool(size)
 {
 	mBufferSize = size;
 	mWritePosition = 0;
@@ -332,8 +337,9 @@ void StreamingVertexBuffer::reserveRequiredSpace()
 		}
 
 		mBufferSize = std::max(mRequiredSpace, 3 * mBufferSize / 2);   // 1.5 x mBufferSize is arbitrary and should be checked to see we don't have too many reallocations.
+		mBufferPool.resize(mBufferSize);
 
-		mVertexBuffer = new sw::Resource(mBufferSize);
+		mVertexBuffer = mBufferPool.acquire();
 
 		if(!mVertexBuffer)
 		{
@@ -346,8 +352,8 @@ void StreamingVertexBuffer::reserveRequiredSpace()
 	{
 		if(mVertexBuffer)
 		{
-			mVertexBuffer->destruct();
-			mVertexBuffer = new sw::Resource(mBufferSize);
+			mBufferPool.retire(mVertexBuffer);
+			mVertexBuffer = mBufferPool.acquire();
 		}
 
 		mWritePosition = 0;
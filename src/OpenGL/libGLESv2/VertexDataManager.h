@@ -34,6 +34,8 @@ struct TranslatedAttribute
 
 	unsigned int offset;
 	unsigned int stride;   // 0 means not to advance the read pointer at all
+	unsigned int divisor;          // Instances per element, 0 when not instanced
+	unsigned int instanceStride;   // Bytes between the elements of consecutive instances
 
 	sw::Resource *vertexBuffer;
 };
@@ -73,6 +75,8 @@ protected:
 	unsigned int mBufferSize;
 	unsigned int mWritePosition;
 	unsigned int mRequiredSpace;
+
+	sw::ResourcePool mBufferPool;
 };
 
 class VertexDataManager
@@ -83,7 +87,7 @@ public:
 
 	void dirtyCurrentValue(int index) { mDirtyCurrentValue[index] = true; }
 
-	GLenum prepareVertexData(GLint start, GLsizei count, TranslatedAttribute *outAttribs, GLsizei instanceId);
+	GLenum prepareVertexData(GLint start, GLsizei count, TranslatedAttribute *outAttribs, GLsizei instanceCount);
 
 private:
 	unsigned int writeAttributeData(StreamingVertexBuffer *vertexBuffer, GLint start, GLsizei count, const VertexAttribute &attribute);
@@ -16,17 +16,20 @@
 
 #include "main.h"
 #include "entry_points.h"
+#include "TraceRecorder.h"
 #include "libEGL/main.h"
 
 extern "C"
 {
 GL_APICALL void GL_APIENTRY glActiveTexture(GLenum texture)
 {
+	TRACE_GL(ActiveTexture) << texture;
 	return gl::ActiveTexture(texture);
 }
 
 GL_APICALL void GL_APIENTRY glAttachShader(GLuint program, GLuint shader)
 {
+	TRACE_GL(AttachShader) << program << shader;
 	return gl::AttachShader(program, shader);
 }
 
@@ -35,73 +38,92 @@ GL_APICALL void GL_APIENTRY glBeginQueryEXT(GLenum target, GLuint name)
 	return gl::BeginQueryEXT(target, name);
 }
 
+GL_APICALL void GL_APIENTRY glBeginConditionalRenderNV(GLuint id, GLenum mode)
+{
+	return gl::BeginConditionalRenderNV(id, mode);
+}
+
 GL_APICALL void GL_APIENTRY glBindAttribLocation(GLuint program, GLuint index, const GLchar* name)
 {
+	TRACE_GL(BindAttribLocation) << program << index << es2::traceString(name);
 	return gl::BindAttribLocation(program, index, name);
 }
 
 GL_APICALL void GL_APIENTRY glBindBuffer(GLenum target, GLuint buffer)
 {
+	TRACE_GL(BindBuffer) << target << buffer;
 	return gl::BindBuffer(target, buffer);
 }
 
 GL_APICALL void GL_APIENTRY glBindFramebuffer(GLenum target, GLuint framebuffer)
 {
+	TRACE_GL(BindFramebuffer) << target << framebuffer;
 	return gl::BindFramebuffer(target, framebuffer);
 }
 
 GL_APICALL void GL_APIENTRY glBindFramebufferOES(GLenum target, GLuint framebuffer)
 {
+	TRACE_GL(BindFramebuffer) << target << framebuffer;
 	return gl::BindFramebuffer(target, framebuffer);
 }
 
 GL_APICALL void GL_APIENTRY glBindRenderbuffer(GLenum target, GLuint renderbuffer)
 {
+	TRACE_GL(BindRenderbuffer) << target << renderbuffer;
 	return gl::BindRenderbuffer(target, renderbuffer);
 }
 
 GL_APICALL void GL_APIENTRY glBindRenderbufferOES(GLenum target, GLuint renderbuffer)
 {
+	TRACE_GL(BindRenderbuffer) << target << renderbuffer;
 	return gl::BindRenderbuffer(target, renderbuffer);
 }
 
 GL_APICALL void GL_APIENTRY glBindTexture(GLenum target, GLuint texture)
 {
+	TRACE_GL(BindTexture) << target << texture;
 	return gl::BindTexture(target, texture);
 }
 
 GL_APICALL void GL_APIENTRY glBlendColor(GLclampf red, GLclampf green, GLclampf blue, GLclampf alpha)
 {
+	TRACE_GL(BlendColor) << red << green << blue << alpha;
 	return gl::BlendColor(red, green, blue, alpha);
 }
 
 GL_APICALL void GL_APIENTRY glBlendEquation(GLenum mode)
 {
+	TRACE_GL(BlendEquation) << mode;
 	return gl::BlendEquation(mode);
 }
 
 GL_APICALL void GL_APIENTRY glBlendEquationSeparate(GLenum modeRGB, GLenum modeAlpha)
 {
+	TRACE_GL(BlendEquationSeparate) << modeRGB << modeAlpha;
 	return gl::BlendEquationSeparate(modeRGB, modeAlpha);
 }
 
 GL_APICALL void GL_APIENTRY glBlendFunc(GLenum sfactor, GLenum dfactor)
 {
+	TRACE_GL(BlendFunc) << sfactor << dfactor;
 	return gl::BlendFunc(sfactor, dfactor);
 }
 
 GL_APICALL void GL_APIENTRY glBlendFuncSeparate(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha, GLenum dstAlpha)
 {
+	TRACE_GL(BlendFuncSeparate) << srcRGB << dstRGB << srcAlpha << dstAlpha;
 	return gl::BlendFuncSeparate(srcRGB, dstRGB, srcAlpha, dstAlpha);
 }
 
 GL_APICALL void GL_APIENTRY glBufferData(GLenum target, GLsizeiptr size, const GLvoid* data, GLenum usage)
 {
+	TRACE_GL(BufferData) << target << size << es2::traceData(data, (size > 0) ? size : 0) << usage;
 	return gl::BufferData(target, size, data, usage);
 }
 
 GL_APICALL void GL_APIENTRY glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid* data)
 {
+	TRACE_GL(BufferSubData) << target << offset << size << es2::traceData(data, (size > 0) ? size : 0);
 	return gl::BufferSubData(target, offset, size, data);
 }
 
@@ -117,73 +139,89 @@ GL_APICALL GLenum GL_APIENTRY glCheckFramebufferStatusOES(GLenum target)
 
 GL_APICALL void GL_APIENTRY glClear(GLbitfield mask)
 {
+	TRACE_GL(Clear) << mask;
 	return gl::Clear(mask);
 }
 
 GL_APICALL void GL_APIENTRY glClearColor(GLclampf red, GLclampf green, GLclampf blue, GLclampf alpha)
 {
+	TRACE_GL(ClearColor) << red << green << blue << alpha;
 	return gl::ClearColor(red, green, blue, alpha);
 }
 
 GL_APICALL void GL_APIENTRY glClearDepthf(GLclampf depth)
 {
+	TRACE_GL(ClearDepthf) << depth;
 	return gl::ClearDepthf(depth);
 }
 
 GL_APICALL void GL_APIENTRY glClearStencil(GLint s)
 {
+	TRACE_GL(ClearStencil) << s;
 	return gl::ClearStencil(s);
 }
 
 GL_APICALL void GL_APIENTRY glColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha)
 {
+	TRACE_GL(ColorMask) << red << green << blue << alpha;
 	return gl::ColorMask(red, green, blue, alpha);
 }
 
 GL_APICALL void GL_APIENTRY glCompileShader(GLuint shader)
 {
+	TRACE_GL(CompileShader) << shader;
 	return gl::CompileShader(shader);
 }
 
 GL_APICALL void GL_APIENTRY glCompressedTexImage2D(GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height,
                                                    GLint border, GLsizei imageSize, const GLvoid* data)
 {
+	TRACE_GL(CompressedTexImage2D) << target << level << internalformat << width << height << border << imageSize << es2::TraceRecorder::compressedPixels(data, imageSize);
 	return gl::CompressedTexImage2D(target, level, internalformat, width, height, border, imageSize, data);
 }
 
 GL_APICALL void GL_APIENTRY glCompressedTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height,
                                                       GLenum format, GLsizei imageSize, const GLvoid* data)
 {
+	TRACE_GL(CompressedTexSubImage2D) << target << level << xoffset << yoffset << width << height << format << imageSize << es2::TraceRecorder::compressedPixels(data, imageSize);
 	return gl::CompressedTexSubImage2D(target, level, xoffset, yoffset, width, height, format, imageSize, data);
 }
 
 GL_APICALL void GL_APIENTRY glCopyTexImage2D(GLenum target, GLint level, GLenum internalformat, GLint x, GLint y, GLsizei width, GLsizei height, GLint border)
 {
+	TRACE_GL(CopyTexImage2D) << target << level << internalformat << x << y << width << height << border;
 	return gl::CopyTexImage2D(target, level, internalformat, x, y, width, height, border);
 }
 
 GL_APICALL void GL_APIENTRY glCopyTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint x, GLint y, GLsizei width, GLsizei height)
 {
+	TRACE_GL(CopyTexSubImage2D) << target << level << xoffset << yoffset << x << y << width << height;
 	return gl::CopyTexSubImage2D(target, level, xoffset, yoffset, x, y, width, height);
 }
 
 GL_APICALL GLuint GL_APIENTRY glCreateProgram(void)
 {
-	return gl::CreateProgram();
+	GLuint name = gl::CreateProgram();
+	TRACE_GL(CreateProgram) << name;
+	return name;
 }
 
 GL_APICALL GLuint GL_APIENTRY glCreateShader(GLenum type)
 {
-	return gl::CreateShader(type);
+	GLuint name = gl::CreateShader(type);
+	TRACE_GL(CreateShader) << type << name;
+	return name;
 }
 
 GL_APICALL void GL_APIENTRY glCullFace(GLenum mode)
 {
+	TRACE_GL(CullFace) << mode;
 	return gl::CullFace(mode);
 }
 
 GL_APICALL void GL_APIENTRY glDeleteBuffers(GLsizei n, const GLuint* buffers)
 {
+	TRACE_GL(DeleteBuffers) << n << es2::traceArray(buffers, n);
 	return gl::DeleteBuffers(n, buffers);
 }
 
@@ -194,16 +232,19 @@ GL_APICALL void GL_APIENTRY glDeleteFencesNV(GLsizei n, const GLuint* fences)
 
 GL_APICALL void GL_APIENTRY glDeleteFramebuffers(GLsizei n, const GLuint* framebuffers)
 {
+	TRACE_GL(DeleteFramebuffers) << n << es2::traceArray(framebuffers, n);
 	return gl::DeleteFramebuffers(n, framebuffers);
 }
 
 GL_APICALL void GL_APIENTRY glDeleteFramebuffersOES(GLsizei n, const GLuint* framebuffers)
 {
+	TRACE_GL(DeleteFramebuffers) << n << es2::traceArray(framebuffers, n);
 	return gl::DeleteFramebuffers(n, framebuffers);
 }
 
 GL_APICALL void GL_APIENTRY glDeleteProgram(GLuint program)
 {
+	TRACE_GL(DeleteProgram) << program;
 	return gl::DeleteProgram(program);
 }
 
@@ -214,101 +255,127 @@ GL_APICALL void GL_APIENTRY glDeleteQueriesEXT(GLsizei n, const GLuint *ids)
 
 GL_APICALL void GL_APIENTRY glDeleteRenderbuffers(GLsizei n, const GLuint* renderbuffers)
 {
+	TRACE_GL(DeleteRenderbuffers) << n << es2::traceArray(renderbuffers, n);
 	return gl::DeleteRenderbuffers(n, renderbuffers);
 }
 
 GL_APICALL void GL_APIENTRY glDeleteRenderbuffersOES(GLsizei n, const GLuint* renderbuffers)
 {
+	TRACE_GL(DeleteRenderbuffers) << n << es2::traceArray(renderbuffers, n);
 	return gl::DeleteRenderbuffers(n, renderbuffers);
 }
 
 GL_APICALL void GL_APIENTRY glDeleteShader(GLuint shader)
 {
+	TRACE_GL(DeleteShader) << shader;
 	return gl::DeleteShader(shader);
 }
 
 GL_APICALL void GL_APIENTRY glDeleteTextures(GLsizei n, const GLuint* textures)
 {
+	TRACE_GL(DeleteTextures) << n << es2::traceArray(textures, n);
 	return gl::DeleteTextures(n, textures);
 }
 
 GL_APICALL void GL_APIENTRY glDepthFunc(GLenum func)
 {
+	TRACE_GL(DepthFunc) << func;
 	return gl::DepthFunc(func);
 }
 
 GL_APICALL void GL_APIENTRY glDepthMask(GLboolean flag)
 {
+	TRACE_GL(DepthMask) << flag;
 	return gl::DepthMask(flag);
 }
 
 GL_APICALL void GL_APIENTRY glDepthRangef(GLclampf zNear, GLclampf zFar)
 {
+	TRACE_GL(DepthRangef) << zNear << zFar;
 	return gl::DepthRangef(zNear, zFar);
 }
 
 GL_APICALL void GL_APIENTRY glDetachShader(GLuint program, GLuint shader)
 {
+	TRACE_GL(DetachShader) << program << shader;
 	return gl::DetachShader(program, shader);
 }
 
 GL_APICALL void GL_APIENTRY glDisable(GLenum cap)
 {
+	TRACE_GL(Disable) << cap;
 	return gl::Disable(cap);
 }
 
 GL_APICALL void GL_APIENTRY glDisableVertexAttribArray(GLuint index)
 {
+	TRACE_GL(DisableVertexAttribArray) << index;
 	return gl::DisableVertexAttribArray(index);
 }
 
 GL_APICALL void GL_APIENTRY glDrawArrays(GLenum mode, GLint first, GLsizei count)
 {
+	if(es2::TraceRecorder::enabled()) es2::TraceRecorder::clientVertexData(first, count, 1);
+	TRACE_GL(DrawArrays) << mode << first << count;
 	return gl::DrawArrays(mode, first, count);
 }
 
 GL_APICALL void GL_APIENTRY glDrawElements(GLenum mode, GLsizei count, GLenum type, const GLvoid* indices)
 {
+	if(es2::TraceRecorder::enabled()) es2::TraceRecorder::clientVertexData(indices, count, type, 1);
+	TRACE_GL(DrawElements) << mode << count << type << es2::TraceRecorder::indices(indices, count, type);
 	return gl::DrawElements(mode, count, type, indices);
 }
 
 GL_APICALL void GL_APIENTRY glDrawArraysInstancedEXT(GLenum mode, GLint first, GLsizei count, GLsizei instanceCount)
 {
+	if(es2::TraceRecorder::enabled()) es2::TraceRecorder::clientVertexData(first, count, instanceCount);
+	TRACE_GL(DrawArraysInstanced) << mode << first << count << instanceCount;
 	return gl::DrawArraysInstancedEXT(mode, first, count, instanceCount);
 }
 
 GL_APICALL void GL_APIENTRY glDrawElementsInstancedEXT(GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instanceCount)
 {
+	if(es2::TraceRecorder::enabled()) es2::TraceRecorder::clientVertexData(indices, count, type, instanceCount);
+	TRACE_GL(DrawElementsInstanced) << mode << count << type << es2::TraceRecorder::indices(indices, count, type) << instanceCount;
 	return gl::DrawElementsInstancedEXT(mode, count, type, indices, instanceCount);
 }
 
 GL_APICALL void GL_APIENTRY glVertexAttribDivisorEXT(GLuint index, GLuint divisor)
 {
+	TRACE_GL(VertexAttribDivisor) << index << divisor;
 	return gl::VertexAttribDivisorEXT(index, divisor);
 }
 
 GL_APICALL void GL_APIENTRY glDrawArraysInstancedANGLE(GLenum mode, GLint first, GLsizei count, GLsizei instanceCount)
 {
+	if(es2::TraceRecorder::enabled()) es2::TraceRecorder::clientVertexData(first, count, instanceCount);
+	TRACE_GL(DrawArraysInstanced) << mode << first << count << instanceCount;
 	return gl::DrawArraysInstancedANGLE(mode, first, count, instanceCount);
 }
 
 GL_APICALL void GL_APIENTRY glDrawElementsInstancedANGLE(GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instanceCount)
 {
+	if(es2::TraceRecorder::enabled()) es2::TraceRecorder::clientVertexData(indices, count, type, instanceCount);
+	TRACE_GL(DrawElementsInstanced) << mode << count << type << es2::TraceRecorder::indices(indices, count, type) << instanceCount;
 	return gl::DrawElementsInstancedANGLE(mode, count, type, indices, instanceCount);
 }
 
 GL_APICALL void GL_APIENTRY glVertexAttribDivisorANGLE(GLuint index, GLuint divisor)
 {
+	TRACE_GL(VertexAttribDivisor) << index << divisor;
 	return gl::VertexAttribDivisorANGLE(index, divisor);
 }
 
 GL_APICALL void GL_APIENTRY glEnable(GLenum cap)
 {
+	TRACE_GL(Enable) << cap;
 	return gl::Enable(cap);
 }
 
 GL_APICALL void GL_APIENTRY glEnableVertexAttribArray(GLuint index)
 {
+	TRACE_GL(EnableVertexAttribArray) << index;
 	return gl::EnableVertexAttribArray(index);
 }
 
@@ -317,6 +384,11 @@ GL_APICALL void GL_APIENTRY glEndQueryEXT(GLenum target)
 	return gl::EndQueryEXT(target);
 }
 
+GL_APICALL void GL_APIENTRY glEndConditionalRenderNV(void)
+{
+	return gl::EndConditionalRenderNV();
+}
+
 GL_APICALL void GL_APIENTRY glFinishFenceNV(GLuint fence)
 {
 	return gl::FinishFenceNV(fence);
@@ -324,51 +396,61 @@ GL_APICALL void GL_APIENTRY glFinishFenceNV(GLuint fence)
 
 GL_APICALL void GL_APIENTRY glFinish(void)
 {
+	TRACE_GL(Finish);
 	return gl::Finish();
 }
 
 GL_APICALL void GL_APIENTRY glFlush(void)
 {
+	TRACE_GL(Flush);
 	return gl::Flush();
 }
 
 GL_APICALL void GL_APIENTRY glFramebufferRenderbuffer(GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer)
 {
+	TRACE_GL(FramebufferRenderbuffer) << target << attachment << renderbuffertarget << renderbuffer;
 	return gl::FramebufferRenderbuffer(target, attachment, renderbuffertarget, renderbuffer);
 }
 
 GL_APICALL void GL_APIENTRY glFramebufferRenderbufferOES(GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer)
 {
+	TRACE_GL(FramebufferRenderbuffer) << target << attachment << renderbuffertarget << renderbuffer;
 	return gl::FramebufferRenderbuffer(target, attachment, renderbuffertarget, renderbuffer);
 }
 
 GL_APICALL void GL_APIENTRY glFramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level)
 {
+	TRACE_GL(FramebufferTexture2D) << target << attachment << textarget << texture << level;
 	return gl::FramebufferTexture2D(target, attachment, textarget, texture, level);
 }
 
 GL_APICALL void GL_APIENTRY glFramebufferTexture2DOES(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level)
 {
+	TRACE_GL(FramebufferTexture2D) << target << attachment << textarget << texture << level;
 	return gl::FramebufferTexture2D(target, attachment, textarget, texture, level);
 }
 
 GL_APICALL void GL_APIENTRY glFrontFace(GLenum mode)
 {
+	TRACE_GL(FrontFace) << mode;
 	return gl::FrontFace(mode);
 }
 
 GL_APICALL void GL_APIENTRY glGenBuffers(GLsizei n, GLuint* buffers)
 {
-	return gl::GenBuffers(n, buffers);
+	gl::GenBuffers(n, buffers);
+	TRACE_GL(GenBuffers) << n << es2::traceArray(buffers, n);
 }
 
 GL_APICALL void GL_APIENTRY glGenerateMipmap(GLenum target)
 {
+	TRACE_GL(GenerateMipmap) << target;
 	return gl::GenerateMipmap(target);
 }
 
 GL_APICALL void GL_APIENTRY glGenerateMipmapOES(GLenum target)
 {
+	TRACE_GL(GenerateMipmap) << target;
 	return gl::GenerateMipmap(target);
 }
 
@@ -379,12 +461,14 @@ GL_APICALL void GL_APIENTRY glGenFencesNV(GLsizei n, GLuint* fences)
 
 GL_APICALL void GL_APIENTRY glGenFramebuffers(GLsizei n, GLuint* framebuffers)
 {
-	return gl::GenFramebuffers(n, framebuffers);
+	gl::GenFramebuffers(n, framebuffers);
+	TRACE_GL(GenFramebuffers) << n << es2::traceArray(framebuffers, n);
 }
 
 GL_APICALL void GL_APIENTRY glGenFramebuffersOES(GLsizei n, GLuint* framebuffers)
 {
-	return gl::GenFramebuffers(n, framebuffers);
+	gl::GenFramebuffers(n, framebuffers);
+	TRACE_GL(GenFramebuffers) << n << es2::traceArray(framebuffers, n);
 }
 
 GL_APICALL void GL_APIENTRY glGenQueriesEXT(GLsizei n, GLuint* ids)
@@ -394,17 +478,20 @@ GL_APICALL void GL_APIENTRY glGenQueriesEXT(GLsizei n, GLuint* ids)
 
 GL_APICALL void GL_APIENTRY glGenRenderbuffers(GLsizei n, GLuint* renderbuffers)
 {
-	return gl::GenRenderbuffers(n, renderbuffers);
+	gl::GenRenderbuffers(n, renderbuffers);
+	TRACE_GL(GenRenderbuffers) << n << es2::traceArray(renderbuffers, n);
 }
 
 GL_APICALL void GL_APIENTRY glGenRenderbuffersOES(GLsizei n, GLuint* renderbuffers)
 {
-	return gl::GenRenderbuffers(n, renderbuffers);
+	gl::GenRenderbuffers(n, renderbuffers);
+	TRACE_GL(GenRenderbuffers) << n << es2::traceArray(renderbuffers, n);
 }
 
 GL_APICALL void GL_APIENTRY glGenTextures(GLsizei n, GLuint* textures)
 {
-	return gl::GenTextures(n, textures);
+	gl::GenTextures(n, textures);
+	TRACE_GL(GenTextures) << n << es2::traceArray(textures, n);
 }
 
 GL_APICALL void GL_APIENTRY glGetActiveAttrib(GLuint program, GLuint index, GLsizei bufsize, GLsizei *length, GLint *size, GLenum *type, GLchar *name)
@@ -579,6 +666,7 @@ GL_APICALL void GL_APIENTRY glGetVertexAttribPointerv(GLuint index, GLenum pname
 
 GL_APICALL void GL_APIENTRY glHint(GLenum target, GLenum mode)
 {
+	TRACE_GL(Hint) << target << mode;
 	return gl::Hint(target, mode);
 }
 
@@ -639,21 +727,30 @@ GL_APICALL GLboolean GL_APIENTRY glIsTexture(GLuint texture)
 
 GL_APICALL void GL_APIENTRY glLineWidth(GLfloat width)
 {
+	TRACE_GL(LineWidth) << width;
 	return gl::LineWidth(width);
 }
 
 GL_APICALL void GL_APIENTRY glLinkProgram(GLuint program)
 {
+	TRACE_GL(LinkProgram) << program;
 	return gl::LinkProgram(program);
 }
 
+GL_APICALL void GL_APIENTRY glMaxShaderCompilerThreadsKHR(GLuint count)
+{
+	return gl::MaxShaderCompilerThreadsKHR(count);
+}
+
 GL_APICALL void GL_APIENTRY glPixelStorei(GLenum pname, GLint param)
 {
+	TRACE_GL(PixelStorei) << pname << param;
 	return gl::PixelStorei(pname, param);
 }
 
 GL_APICALL void GL_APIENTRY glPolygonOffset(GLfloat factor, GLfloat units)
 {
+	TRACE_GL(PolygonOffset) << factor << units;
 	return gl::PolygonOffset(factor, units);
 }
 
@@ -665,6 +762,7 @@ GL_APICALL void GL_APIENTRY glReadnPixelsEXT(GLint x, GLint y, GLsizei width, GL
 
 GL_APICALL void GL_APIENTRY glReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, GLvoid* pixels)
 {
+	TRACE_GL(ReadPixels) << x << y << width << height << format << type << es2::traceOffset(pixels);
 	return gl::ReadPixels(x, y, width, height, format, type, pixels);
 }
 
@@ -675,26 +773,31 @@ GL_APICALL void GL_APIENTRY glReleaseShaderCompiler(void)
 
 GL_APICALL void GL_APIENTRY glRenderbufferStorageMultisample(GLenum target, GLsizei samples, GLenum internalformat, GLsizei width, GLsizei height)
 {
+	TRACE_GL(RenderbufferStorageMultisample) << target << samples << internalformat << width << height;
 	return gl::RenderbufferStorageMultisample(target, samples, internalformat, width, height);
 }
 
 GL_APICALL void GL_APIENTRY glRenderbufferStorageMultisampleANGLE(GLenum target, GLsizei samples, GLenum internalformat, GLsizei width, GLsizei height)
 {
+	TRACE_GL(RenderbufferStorageMultisample) << target << samples << internalformat << width << height;
 	return gl::RenderbufferStorageMultisampleANGLE(target, samples, internalformat, width, height);
 }
 
 GL_APICALL void GL_APIENTRY glRenderbufferStorage(GLenum target, GLenum internalformat, GLsizei width, GLsizei height)
 {
+	TRACE_GL(RenderbufferStorage) << target << internalformat << width << height;
 	return gl::RenderbufferStorage(target, internalformat, width, height);
 }
 
 GL_APICALL void GL_APIENTRY glRenderbufferStorageOES(GLenum target, GLenum internalformat, GLsizei width, GLsizei height)
 {
+	TRACE_GL(RenderbufferStorage) << target << internalformat << width << height;
 	return gl::RenderbufferStorage(target, internalformat, width, height);
 }
 
 GL_APICALL void GL_APIENTRY glSampleCoverage(GLclampf value, GLboolean invert)
 {
+	TRACE_GL(SampleCoverage) << value << invert;
 	return gl::SampleCoverage(value, invert);
 }
 
@@ -705,6 +808,7 @@ GL_APICALL void GL_APIENTRY glSetFenceNV(GLuint fence, GLenum condition)
 
 GL_APICALL void GL_APIENTRY glScissor(GLint x, GLint y, GLsizei width, GLsizei height)
 {
+	TRACE_GL(Scissor) << x << y << width << height;
 	return gl::Scissor(x, y, width, height);
 }
 
@@ -715,36 +819,43 @@ GL_APICALL void GL_APIENTRY glShaderBinary(GLsizei n, const GLuint* shaders, GLe
 
 GL_APICALL void GL_APIENTRY glShaderSource(GLuint shader, GLsizei count, const GLchar *const *string, const GLint *length)
 {
+	if(es2::TraceRecorder::enabled()) es2::TraceRecorder::shaderSource(shader, count, string, length);
 	return gl::ShaderSource(shader, count, string, length);
 }
 
 GL_APICALL void GL_APIENTRY glStencilFunc(GLenum func, GLint ref, GLuint mask)
 {
+	TRACE_GL(StencilFunc) << func << ref << mask;
 	return gl::StencilFunc(func, ref, mask);
 }
 
 GL_APICALL void GL_APIENTRY glStencilFuncSeparate(GLenum face, GLenum func, GLint ref, GLuint mask)
 {
+	TRACE_GL(StencilFuncSeparate) << face << func << ref << mask;
 	return gl::StencilFuncSeparate(face, func, ref, mask);
 }
 
 GL_APICALL void GL_APIENTRY glStencilMask(GLuint mask)
 {
+	TRACE_GL(StencilMask) << mask;
 	return gl::StencilMask(mask);
 }
 
 GL_APICALL void GL_APIENTRY glStencilMaskSeparate(GLenum face, GLuint mask)
 {
+	TRACE_GL(StencilMaskSeparate) << face << mask;
 	return gl::StencilMaskSeparate(face, mask);
 }
 
 GL_APICALL void GL_APIENTRY glStencilOp(GLenum fail, GLenum zfail, GLenum zpass)
 {
+	TRACE_GL(StencilOp) << fail << zfail << zpass;
 	return gl::StencilOp(fail, zfail, zpass);
 }
 
 GL_APICALL void GL_APIENTRY glStencilOpSeparate(GLenum face, GLenum fail, GLenum zfail, GLenum zpass)
 {
+	TRACE_GL(StencilOpSeparate) << face << fail << zfail << zpass;
 	return gl::StencilOpSeparate(face, fail, zfail, zpass);
 }
 
@@ -756,132 +867,158 @@ GLboolean GL_APIENTRY glTestFenceNV(GLuint fence)
 GL_APICALL void GL_APIENTRY glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height,
                                          GLint border, GLenum format, GLenum type, const GLvoid* pixels)
 {
+	TRACE_GL(TexImage2D) << target << level << internalformat << width << height << border << format << type << es2::TraceRecorder::pixels(pixels, width, height, 1, format, type);
 	return gl::TexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
 }
 
 GL_APICALL void GL_APIENTRY glTexParameterf(GLenum target, GLenum pname, GLfloat param)
 {
+	TRACE_GL(TexParameterf) << target << pname << param;
 	return gl::TexParameterf(target, pname, param);
 }
 
 GL_APICALL void GL_APIENTRY glTexParameterfv(GLenum target, GLenum pname, const GLfloat* params)
 {
+	TRACE_GL(TexParameterfv) << target << pname << es2::traceArray(params, 1);
 	return gl::TexParameterfv(target, pname, params);
 }
 
 GL_APICALL void GL_APIENTRY glTexParameteri(GLenum target, GLenum pname, GLint param)
 {
+	TRACE_GL(TexParameteri) << target << pname << param;
 	return gl::TexParameteri(target, pname, param);
 }
 
 GL_APICALL void GL_APIENTRY glTexParameteriv(GLenum target, GLenum pname, const GLint* params)
 {
+	TRACE_GL(TexParameteriv) << target << pname << es2::traceArray(params, 1);
 	return gl::TexParameteriv(target, pname, params);
 }
 
 GL_APICALL void GL_APIENTRY glTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height,
                                             GLenum format, GLenum type, const GLvoid* pixels)
 {
+	TRACE_GL(TexSubImage2D) << target << level << xoffset << yoffset << width << height << format << type << es2::TraceRecorder::pixels(pixels, width, height, 1, format, type);
 	return gl::TexSubImage2D(target, level, xoffset, yoffset, width, height, format, type, pixels);
 }
 
 GL_APICALL void GL_APIENTRY glUniform1f(GLint location, GLfloat x)
 {
+	TRACE_GL(Uniform1f) << location << x;
 	return gl::Uniform1f(location, x);
 }
 
 GL_APICALL void GL_APIENTRY glUniform1fv(GLint location, GLsizei count, const GLfloat* v)
 {
+	TRACE_GL(Uniform1fv) << location << count << es2::traceArray(v, count, 1);
 	return gl::Uniform1fv(location, count, v);
 }
 
 GL_APICALL void GL_APIENTRY glUniform1i(GLint location, GLint x)
 {
+	TRACE_GL(Uniform1i) << location << x;
 	return gl::Uniform1i(location, x);
 }
 
 GL_APICALL void GL_APIENTRY glUniform1iv(GLint location, GLsizei count, const GLint* v)
 {
+	TRACE_GL(Uniform1iv) << location << count << es2::traceArray(v, count, 1);
 	return gl::Uniform1iv(location, count, v);
 }
 
 GL_APICALL void GL_APIENTRY glUniform2f(GLint location, GLfloat x, GLfloat y)
 {
+	TRACE_GL(Uniform2f) << location << x << y;
 	return gl::Uniform2f(location, x, y);
 }
 
 GL_APICALL void GL_APIENTRY glUniform2fv(GLint location, GLsizei count, const GLfloat* v)
 {
+	TRACE_GL(Uniform2fv) << location << count << es2::traceArray(v, count, 2);
 	return gl::Uniform2fv(location, count, v);
 }
 
 GL_APICALL void GL_APIENTRY glUniform2i(GLint location, GLint x, GLint y)
 {
+	TRACE_GL(Uniform2i) << location << x << y;
 	return gl::Uniform2i(location, x, y);
 }
 
 GL_APICALL void GL_APIENTRY glUniform2iv(GLint location, GLsizei count, const GLint* v)
 {
+	TRACE_GL(Uniform2iv) << location << count << es2::traceArray(v, count, 2);
 	return gl::Uniform2iv(location, count, v);
 }
 
 GL_APICALL void GL_APIENTRY glUniform3f(GLint location, GLfloat x, GLfloat y, GLfloat z)
 {
+	TRACE_GL(Uniform3f) << location << x << y << z;
 	return gl::Uniform3f(location, x, y, z);
 }
 
 GL_APICALL void GL_APIENTRY glUniform3fv(GLint location, GLsizei count, const GLfloat* v)
 {
+	TRACE_GL(Uniform3fv) << location << count << es2::traceArray(v, count, 3);
 	return gl::Uniform3fv(location, count, v);
 }
 
 GL_APICALL void GL_APIENTRY glUniform3i(GLint location, GLint x, GLint y, GLint z)
 {
+	TRACE_GL(Uniform3i) << location << x << y << z;
 	return gl::Uniform3i(location, x, y, z);
 }
 
 GL_APICALL void GL_APIENTRY glUniform3iv(GLint location, GLsizei count, const GLint* v)
 {
+	TRACE_GL(Uniform3iv) << location << count << es2::traceArray(v, count, 3);
 	return gl::Uniform3iv(location, count, v);
 }
 
 GL_APICALL void GL_APIENTRY glUniform4f(GLint location, GLfloat x, GLfloat y, GLfloat z, GLfloat w)
 {
+	TRACE_GL(Uniform4f) << location << x << y << z << w;
 	return gl::Uniform4f(location, x, y, z, w);
 }
 
 GL_APICALL void GL_APIENTRY glUniform4fv(GLint location, GLsizei count, const GLfloat* v)
 {
+	TRACE_GL(Uniform4fv) << location << count << es2::traceArray(v, count, 4);
 	return gl::Uniform4fv(location, count, v);
 }
 
 GL_APICALL void GL_APIENTRY glUniform4i(GLint location, GLint x, GLint y, GLint z, GLint w)
 {
+	TRACE_GL(Uniform4i) << location << x << y << z << w;
 	return gl::Uniform4i(location, x, y, z, w);
 }
 
 GL_APICALL void GL_APIENTRY glUniform4iv(GLint location, GLsizei count, const GLint* v)
 {
+	TRACE_GL(Uniform4iv) << location << count << es2::traceArray(v, count, 4);
 	return gl::Uniform4iv(location, count, v);
 }
 
 GL_APICALL void GL_APIENTRY glUniformMatrix2fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
 {
+	TRACE_GL(UniformMatrix2fv) << location << count << transpose << es2::traceArray(value, count, 4);
 	return gl::UniformMatrix2fv(location, count, transpose, value);
 }
 
 GL_APICALL void GL_APIENTRY glUniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
 {
+	TRACE_GL(UniformMatrix3fv) << location << count << transpose << es2::traceArray(value, count, 9);
 	return gl::UniformMatrix3fv(location, count, transpose, value);
 }
 
 GL_APICALL void GL_APIENTRY glUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
 {
+	TRACE_GL(UniformMatrix4fv) << location << count << transpose << es2::traceArray(value, count, 16);
 	return gl::UniformMatrix4fv(location, count, transpose, value);
 }
 
 GL_APICALL void GL_APIENTRY glUseProgram(GLuint program)
 {
+	TRACE_GL(UseProgram) << program;
 	return gl::UseProgram(program);
 }
 
@@ -892,51 +1029,61 @@ GL_APICALL void GL_APIENTRY glValidateProgram(GLuint program)
 
 GL_APICALL void GL_APIENTRY glVertexAttrib1f(GLuint index, GLfloat x)
 {
+	TRACE_GL(VertexAttrib1f) << index << x;
 	return gl::VertexAttrib1f(index, x);
 }
 
 GL_APICALL void GL_APIENTRY glVertexAttrib1fv(GLuint index, const GLfloat* values)
 {
+	TRACE_GL(VertexAttrib1fv) << index << es2::traceArray(values, 1, 1);
 	return gl::VertexAttrib1fv(index, values);
 }
 
 GL_APICALL void GL_APIENTRY glVertexAttrib2f(GLuint index, GLfloat x, GLfloat y)
 {
+	TRACE_GL(VertexAttrib2f) << index << x << y;
 	return gl::VertexAttrib2f(index, x, y);
 }
 
 GL_APICALL void GL_APIENTRY glVertexAttrib2fv(GLuint index, const GLfloat* values)
 {
+	TRACE_GL(VertexAttrib2fv) << index << es2::traceArray(values, 1, 2);
 	return gl::VertexAttrib2fv(index, values);
 }
 
 GL_APICALL void GL_APIENTRY glVertexAttrib3f(GLuint index, GLfloat x, GLfloat y, GLfloat z)
 {
+	TRACE_GL(VertexAttrib3f) << index << x << y << z;
 	return gl::VertexAttrib3f(index, x, y, z);
 }
 
 GL_APICALL void GL_APIENTRY glVertexAttrib3fv(GLuint index, const GLfloat* values)
 {
+	TRACE_GL(VertexAttrib3fv) << index << es2::traceArray(values, 1, 3);
 	return gl::VertexAttrib3fv(index, values);
 }
 
 GL_APICALL void GL_APIENTRY glVertexAttrib4f(GLuint index, GLfloat x, GLfloat y, GLfloat z, GLfloat w)
 {
+	TRACE_GL(VertexAttrib4f) << index << x << y << z << w;
 	return gl::VertexAttrib4f(index, x, y, z, w);
 }
 
 GL_APICALL void GL_APIENTRY glVertexAttrib4fv(GLuint index, const GLfloat* values)
 {
+	TRACE_GL(VertexAttrib4fv) << index << es2::traceArray(values, 1, 4);
 	return gl::VertexAttrib4fv(index, values);
 }
 
 GL_APICALL void GL_APIENTRY glVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid* ptr)
 {
+	TRACE_GL(VertexAttribPointer) << index << size << type << normalized << stride << es2::TraceRecorder::attribPointer(ptr);
 	return gl::VertexAttribPointer(index, size, type, normalized, stride, ptr);
 }
 
 GL_APICALL void GL_APIENTRY glViewport(GLint x, GLint y, GLsizei width, GLsizei height)
 {
+	TRACE_GL(Viewport) << x << y << width << height;
 	return gl::Viewport(x, y, width, height);
 }
 
@@ -948,17 +1095,20 @@ GL_APICALL void GL_APIENTRY glBlitFramebufferNV(GLint srcX0, GLint srcY0, GLint
 GL_APICALL void GL_APIENTRY glBlitFramebufferANGLE(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1,
                                                    GLbitfield mask, GLenum filter)
 {
+	TRACE_GL(BlitFramebuffer) << srcX0 << srcY0 << srcX1 << srcY1 << dstX0 << dstY0 << dstX1 << dstY1 << mask << filter;
 	return gl::BlitFramebufferANGLE(srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, mask, filter);
 }
 
 GL_APICALL void GL_APIENTRY glTexImage3DOES(GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height, GLsizei depth,
                                             GLint border, GLenum format, GLenum type, const GLvoid* pixels)
 {
+	TRACE_GL(TexImage3D) << target << level << internalformat << width << height << depth << border << format << type << es2::TraceRecorder::pixels(pixels, width, height, depth, format, type);
 	return gl::TexImage3DOES(target, level, internalformat, width, height, depth, border, format, type, pixels);
 }
 
 GL_APICALL void GL_APIENTRY glTexSubImage3DOES(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void *pixels)
 {
+	TRACE_GL(TexSubImage3D) << target << level << xoffset << yoffset << zoffset << width << height << depth << format << type << es2::TraceRecorder::pixels(pixels, width, height, depth, format, type);
 	return gl::TexSubImage3DOES(target, level, xoffset, yoffset, zoffset, width, height, depth, format, type, pixels);
 }
 
@@ -994,26 +1144,32 @@ GL_APICALL void GL_APIENTRY glEGLImageTargetRenderbufferStorageOES(GLenum target
 
 GL_APICALL void GL_APIENTRY glDrawBuffersEXT(GLsizei n, const GLenum *bufs)
 {
+	TRACE_GL(DrawBuffers) << n << es2::traceArray(bufs, n);
 	return gl::DrawBuffersEXT(n, bufs);
 }
 
 GL_APICALL void GL_APIENTRY glReadBuffer(GLenum src)
 {
+	TRACE_GL(ReadBuffer) << src;
 	return gl::ReadBuffer(src);
 }
 
 GL_APICALL void GL_APIENTRY glDrawRangeElements(GLenum mode, GLuint start, GLuint end, GLsizei count, GLenum type, const void *indices)
 {
+	if(es2::TraceRecorder::enabled()) es2::TraceRecorder::clientVertexData(indices, count, type, 1);
+	TRACE_GL(DrawRangeElements) << mode << start << end << count << type << es2::TraceRecorder::indices(indices, count, type);
 	return gl::DrawRangeElements(mode, start, end, count, type, indices);
 }
 
 GL_APICALL void GL_APIENTRY glTexImage3D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLsizei depth, GLint border, GLenum format, GLenum type, const void *data)
 {
+	TRACE_GL(TexImage3D) << target << level << internalformat << width << height << depth << border << format << type << es2::TraceRecorder::pixels(data, width, height, depth, format, type);
 	return gl::TexImage3D(target, level, internalformat, width, height, depth, border, format, type, data);
 }
 
 GL_APICALL void GL_APIENTRY glTexSubImage3D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void *data)
 {
+	TRACE_GL(TexSubImage3D) << target << level << xoffset << yoffset << zoffset << width << height << depth << format << type << es2::TraceRecorder::pixels(data, width, height, depth, format, type);
 	return gl::TexSubImage3D(target, level, xoffset, yoffset, zoffset, width, height, depth, format, type, data);
 }
 
@@ -1079,46 +1235,55 @@ GL_APICALL void GL_APIENTRY glGetBufferPointerv(GLenum target, GLenum pname, voi
 
 GL_APICALL void GL_APIENTRY glDrawBuffers(GLsizei n, const GLenum *bufs)
 {
+	TRACE_GL(DrawBuffers) << n << es2::traceArray(bufs, n);
 	return gl::DrawBuffers(n, bufs);
 }
 
 GL_APICALL void GL_APIENTRY glUniformMatrix2x3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value)
 {
+	TRACE_GL(UniformMatrix2x3fv) << location << count << transpose << es2::traceArray(value, count, 6);
 	return gl::UniformMatrix2x3fv(location, count, transpose, value);
 }
 
 GL_APICALL void GL_APIENTRY glUniformMatrix3x2fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value)
 {
+	TRACE_GL(UniformMatrix3x2fv) << location << count << transpose << es2::traceArray(value, count, 6);
 	return gl::UniformMatrix3x2fv(location, count, transpose, value);
 }
 
 GL_APICALL void GL_APIENTRY glUniformMatrix2x4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value)
 {
+	TRACE_GL(UniformMatrix2x4fv) << location << count << transpose << es2::traceArray(value, count, 8);
 	return gl::UniformMatrix2x4fv(location, count, transpose, value);
 }
 
 GL_APICALL void GL_APIENTRY glUniformMatrix4x2fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value)
 {
+	TRACE_GL(UniformMatrix4x2fv) << location << count << transpose << es2::traceArray(value, count, 8);
 	return gl::UniformMatrix4x2fv(location, count, transpose, value);
 }
 
 GL_APICALL void GL_APIENTRY glUniformMatrix3x4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value)
 {
+	TRACE_GL(UniformMatrix3x4fv) << location << count << transpose << es2::traceArray(value, count, 12);
 	return gl::UniformMatrix3x4fv(location, count, transpose, value);
 }
 
 GL_APICALL void GL_APIENTRY glUniformMatrix4x3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value)
 {
+	TRACE_GL(UniformMatrix4x3fv) << location << count << transpose << es2::traceArray(value, count, 12);
 	return gl::UniformMatrix4x3fv(location, count, transpose, value);
 }
 
 GL_APICALL void GL_APIENTRY glBlitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1, GLbitfield mask, GLenum filter)
 {
+	TRACE_GL(BlitFramebuffer) << srcX0 << srcY0 << srcX1 << srcY1 << dstX0 << dstY0 << dstX1 << dstY1 << mask << filter;
 	return gl::BlitFramebuffer(srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, mask, filter);
 }
 
 GL_APICALL void GL_APIENTRY glFramebufferTextureLayer(GLenum target, GLenum attachment, GLuint texture, GLint level, GLint layer)
 {
+	TRACE_GL(FramebufferTextureLayer) << target << attachment << texture << level << layer;
 	return gl::FramebufferTextureLayer(target, attachment, texture, level, layer);
 }
 
@@ -1134,32 +1299,38 @@ GL_APICALL void GL_APIENTRY glFlushMappedBufferRange(GLenum target, GLintptr off
 
 GL_APICALL void GL_APIENTRY glBindVertexArray(GLuint array)
 {
+	TRACE_GL(BindVertexArray) << array;
 	return gl::BindVertexArray(array);
 }
 
 GL_APICALL void GL_APIENTRY glBindVertexArrayOES(GLuint array)
 {
+	TRACE_GL(BindVertexArray) << array;
 	return gl::BindVertexArrayOES(array);
 }
 
 GL_APICALL void GL_APIENTRY glDeleteVertexArrays(GLsizei n, const GLuint *arrays)
 {
+	TRACE_GL(DeleteVertexArrays) << n << es2::traceArray(arrays, n);
 	return gl::DeleteVertexArrays(n, arrays);
 }
 
 GL_APICALL void GL_APIENTRY glDeleteVertexArraysOES(GLsizei n, const GLuint *arrays)
 {
+	TRACE_GL(DeleteFramebuffers) << n << es2::traceArray(arrays, n);
 	return gl::DeleteFramebuffersOES(n, arrays);
 }
 
 GL_APICALL void GL_APIENTRY glGenVertexArrays(GLsizei n, GLuint *arrays)
 {
-	return gl::GenVertexArrays(n, arrays);
+	gl::GenVertexArrays(n, arrays);
+	TRACE_GL(GenVertexArrays) << n << es2::traceArray(arrays, n);
 }
 
 GL_APICALL void GL_APIENTRY glGenVertexArraysOES(GLsizei n, GLuint *arrays)
 {
-	return gl::GenVertexArraysOES(n, arrays);
+	gl::GenVertexArraysOES(n, arrays);
+	TRACE_GL(GenVertexArrays) << n << es2::traceArray(arrays, n);
 }
 
 GL_APICALL GLboolean GL_APIENTRY glIsVertexArray(GLuint array)
@@ -1189,11 +1360,13 @@ GL_APICALL void GL_APIENTRY glEndTransformFeedback(void)
 
 GL_APICALL void GL_APIENTRY glBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
 {
+	TRACE_GL(BindBufferRange) << target << index << buffer << offset << size;
 	return gl::BindBufferRange(target, index, buffer, offset, size);
 }
 
 GL_APICALL void GL_APIENTRY glBindBufferBase(GLenum target, GLuint index, GLuint buffer)
 {
+	TRACE_GL(BindBufferBase) << target << index << buffer;
 	return gl::BindBufferBase(target, index, buffer);
 }
 
@@ -1209,6 +1382,7 @@ GL_APICALL void GL_APIENTRY glGetTransformFeedbackVarying(GLuint program, GLuint
 
 GL_APICALL void GL_APIENTRY glVertexAttribIPointer(GLuint index, GLint size, GLenum type, GLsizei stride, const void *pointer)
 {
+	TRACE_GL(VertexAttribIPointer) << index << size << type << stride << es2::TraceRecorder::attribPointer(pointer);
 	return gl::VertexAttribIPointer(index, size, type, stride, pointer);
 }
 
@@ -1224,21 +1398,25 @@ GL_APICALL void GL_APIENTRY glGetVertexAttribIuiv(GLuint index, GLenum pname, GL
 
 GL_APICALL void GL_APIENTRY glVertexAttribI4i(GLuint index, GLint x, GLint y, GLint z, GLint w)
 {
+	TRACE_GL(VertexAttribI4i) << index << x << y << z << w;
 	return gl::VertexAttribI4i(index, x, y, z, w);
 }
 
 GL_APICALL void GL_APIENTRY glVertexAttribI4ui(GLuint index, GLuint x, GLuint y, GLuint z, GLuint w)
 {
+	TRACE_GL(VertexAttribI4ui) << index << x << y << z << w;
 	return gl::VertexAttribI4ui(index, x, y, z, w);
 }
 
 GL_APICALL void GL_APIENTRY glVertexAttribI4iv(GLuint index, const GLint *v)
 {
+	TRACE_GL(VertexAttribI4iv) << index << es2::traceArray(v, 1, 4);
 	return gl::VertexAttribI4iv(index, v);
 }
 
 GL_APICALL void GL_APIENTRY glVertexAttribI4uiv(GLuint index, const GLuint *v)
 {
+	TRACE_GL(VertexAttribI4uiv) << index << es2::traceArray(v, 1, 4);
 	return gl::VertexAttribI4uiv(index, v);
 }
 
@@ -1254,41 +1432,49 @@ GL_APICALL GLint GL_APIENTRY glGetFragDataLocation(GLuint program, const GLchar
 
 GL_APICALL void GL_APIENTRY glUniform1ui(GLint location, GLuint v0)
 {
+	TRACE_GL(Uniform1ui) << location << v0;
 	return gl::Uniform1ui(location, v0);
 }
 
 GL_APICALL void GL_APIENTRY glUniform2ui(GLint location, GLuint v0, GLuint v1)
 {
+	TRACE_GL(Uniform2ui) << location << v0 << v1;
 	return gl::Uniform2ui(location, v0, v1);
 }
 
 GL_APICALL void GL_APIENTRY glUniform3ui(GLint location, GLuint v0, GLuint v1, GLuint v2)
 {
+	TRACE_GL(Uniform3ui) << location << v0 << v1 << v2;
 	return gl::Uniform3ui(location, v0, v1, v2);
 }
 
 GL_APICALL void GL_APIENTRY glUniform4ui(GLint location, GLuint v0, GLuint v1, GLuint v2, GLuint v3)
 {
+	TRACE_GL(Uniform4ui) << location << v0 << v1 << v2 << v3;
 	return gl::Uniform4ui(location, v0, v1, v2, v3);
 }
 
 GL_APICALL void GL_APIENTRY glUniform1uiv(GLint location, GLsizei count, const GLuint *value)
 {
+	TRACE_GL(Uniform1uiv) << location << count << es2::traceArray(value, count, 1);
 	return gl::Uniform1uiv(location, count, value);
 }
 
 GL_APICALL void GL_APIENTRY glUniform2uiv(GLint location, GLsizei count, const GLuint *value)
 {
+	TRACE_GL(Uniform2uiv) << location << count << es2::traceArray(value, count, 2);
 	return gl::Uniform2uiv(location, count, value);
 }
 
 GL_APICALL void GL_APIENTRY glUniform3uiv(GLint location, GLsizei count, const GLuint *value)
 {
+	TRACE_GL(Uniform3uiv) << location << count << es2::traceArray(value, count, 3);
 	return gl::Uniform3uiv(location, count, value);
 }
 
 GL_APICALL void GL_APIENTRY glUniform4uiv(GLint location, GLsizei count, const GLuint *value)
 {
+	TRACE_GL(Uniform4uiv) << location << count << es2::traceArray(value, count, 4);
 	return gl::Uniform4uiv(location, count, value);
 }
 
@@ -1349,16 +1535,21 @@ GL_APICALL void GL_APIENTRY glGetActiveUniformBlockName(GLuint program, GLuint u
 
 GL_APICALL void GL_APIENTRY glUniformBlockBinding(GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding)
 {
+	TRACE_GL(UniformBlockBinding) << program << uniformBlockIndex << uniformBlockBinding;
 	return gl::UniformBlockBinding(program, uniformBlockIndex, uniformBlockBinding);
 }
 
 GL_APICALL void GL_APIENTRY glDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instanceCount)
 {
+	if(es2::TraceRecorder::enabled()) es2::TraceRecorder::clientVertexData(first, count, instanceCount);
+	TRACE_GL(DrawArraysInstanced) << mode << first << count << instanceCount;
 	return gl::DrawArraysInstanced(mode, first, count, instanceCount);
 }
 
 GL_APICALL void GL_APIENTRY glDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instanceCount)
 {
+	if(es2::TraceRecorder::enabled()) es2::TraceRecorder::clientVertexData(indices, count, type, instanceCount);
+	TRACE_GL(DrawElementsInstanced) << mode << count << type << es2::TraceRecorder::indices(indices, count, type) << instanceCount;
 	return gl::DrawElementsInstanced(mode, count, type, indices, instanceCount);
 }
 
@@ -1409,11 +1600,13 @@ GL_APICALL void GL_APIENTRY glGetBufferParameteri64v(GLenum target, GLenum pname
 
 GL_APICALL void GL_APIENTRY glGenSamplers(GLsizei count, GLuint *samplers)
 {
-	return gl::GenSamplers(count, samplers);
+	gl::GenSamplers(count, samplers);
+	TRACE_GL(GenSamplers) << count << es2::traceArray(samplers, count);
 }
 
 GL_APICALL void GL_APIENTRY glDeleteSamplers(GLsizei count, const GLuint *samplers)
 {
+	TRACE_GL(DeleteSamplers) << count << es2::traceArray(samplers, count);
 	return gl::DeleteSamplers(count, samplers);
 }
 
@@ -1424,11 +1617,13 @@ GL_APICALL GLboolean GL_APIENTRY glIsSampler(GLuint sampler)
 
 GL_APICALL void GL_APIENTRY glBindSampler(GLuint unit, GLuint sampler)
 {
+	TRACE_GL(BindSampler) << unit << sampler;
 	return gl::BindSampler(unit, sampler);
 }
 
 GL_APICALL void GL_APIENTRY glSamplerParameteri(GLuint sampler, GLenum pname, GLint param)
 {
+	TRACE_GL(SamplerParameteri) << sampler << pname << param;
 	return gl::SamplerParameteri(sampler, pname, param);
 }
 
@@ -1439,6 +1634,7 @@ GL_APICALL void GL_APIENTRY glSamplerParameteriv(GLuint sampler, GLenum pname, c
 
 GL_APICALL void GL_APIENTRY glSamplerParameterf(GLuint sampler, GLenum pname, GLfloat param)
 {
+	TRACE_GL(SamplerParameterf) << sampler << pname << param;
 	return gl::SamplerParameterf(sampler, pname, param);
 }
 
@@ -1459,6 +1655,7 @@ GL_APICALL void GL_APIENTRY glGetSamplerParameterfv(GLuint sampler, GLenum pname
 
 GL_APICALL void GL_APIENTRY glVertexAttribDivisor(GLuint index, GLuint divisor)
 {
+	TRACE_GL(VertexAttribDivisor) << index << divisor;
 	return gl::VertexAttribDivisor(index, divisor);
 }
 
@@ -1509,6 +1706,7 @@ GL_APICALL void GL_APIENTRY glProgramParameteri(GLuint program, GLenum pname, GL
 
 GL_APICALL void GL_APIENTRY glInvalidateFramebuffer(GLenum target, GLsizei numAttachments, const GLenum *attachments)
 {
+	TRACE_GL(InvalidateFramebuffer) << target << numAttachments << es2::traceArray(attachments, numAttachments);
 	return gl::InvalidateFramebuffer(target, numAttachments, attachments);
 }
 
@@ -1519,11 +1717,13 @@ GL_APICALL void GL_APIENTRY glInvalidateSubFramebuffer(GLenum target, GLsizei nu
 
 GL_APICALL void GL_APIENTRY glTexStorage2D(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height)
 {
+	TRACE_GL(TexStorage2D) << target << levels << internalformat << width << height;
 	return gl::TexStorage2D(target, levels, internalformat, width, height);
 }
 
 GL_APICALL void GL_APIENTRY glTexStorage3D(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height, GLsizei depth)
 {
+	TRACE_GL(TexStorage3D) << target << levels << internalformat << width << height << depth;
 	return gl::TexStorage3D(target, levels, internalformat, width, height, depth);
 }
 
@@ -1539,12 +1739,16 @@ egl::Image *createBackBuffer(int width, int height, sw::Format format, int multi
 egl::Image *createBackBufferFromClientBuffer(const egl::ClientBuffer& clientBuffer);
 egl::Image *createDepthStencil(int width, int height, sw::Format format, int multiSampleDepth);
 sw::FrameBuffer *createFrameBuffer(void *nativeDisplay, EGLNativeWindowType window, int width, int height);
+#if defined(__linux__) && !defined(__ANDROID__)
+egl::Image *createImageFromDmaBuf(int width, int height, GLenum internalformat, int fd, size_t offset, int pitch);
+#endif
 
 LibGLESv2exports::LibGLESv2exports()
 {
 	this->glActiveTexture = gl::ActiveTexture;
 	this->glAttachShader = gl::AttachShader;
 	this->glBeginQueryEXT = gl::BeginQueryEXT;
+	this->glBeginConditionalRenderNV = gl::BeginConditionalRenderNV;
 	this->glBindAttribLocation = gl::BindAttribLocation;
 	this->glBindBuffer = gl::BindBuffer;
 	this->glBindFramebuffer = gl::BindFramebuffer;
@@ -1596,6 +1800,7 @@ LibGLESv2exports::LibGLESv2exports()
 	this->glEnable = gl::Enable;
 	this->glEnableVertexAttribArray = gl::EnableVertexAttribArray;
 	this->glEndQueryEXT = gl::EndQueryEXT;
+	this->glEndConditionalRenderNV = gl::EndConditionalRenderNV;
 	this->glFinishFenceNV = gl::FinishFenceNV;
 	this->glFinish = gl::Finish;
 	this->glFlush = gl::Flush;
@@ -1653,6 +1858,7 @@ LibGLESv2exports::LibGLESv2exports()
 	this->glIsTexture = gl::IsTexture;
 	this->glLineWidth = gl::LineWidth;
 	this->glLinkProgram = gl::LinkProgram;
+	this->glMaxShaderCompilerThreadsKHR = gl::MaxShaderCompilerThreadsKHR;
 	this->glPixelStorei = gl::PixelStorei;
 	this->glPolygonOffset = gl::PolygonOffset;
 	this->glReadnPixelsEXT = gl::ReadnPixelsEXT;
@@ -1743,6 +1949,9 @@ LibGLESv2exports::LibGLESv2exports()
 	this->createBackBufferFromClientBuffer = ::createBackBufferFromClientBuffer;
 	this->createDepthStencil = ::createDepthStencil;
 	this->createFrameBuffer = ::createFrameBuffer;
+#if defined(__linux__) && !defined(__ANDROID__)
+	this->createImageFromDmaBuf = ::createImageFromDmaBuf;
+#endif
 }
 
 extern "C" GL_APICALL LibGLESv2exports *libGLESv2_swiftshader()
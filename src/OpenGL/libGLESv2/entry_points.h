@@ -24,6 +24,7 @@ namespace gl
 	void ActiveTexture(GLenum texture);
 	void AttachShader(GLuint program, GLuint shader);
 	void BeginQueryEXT(GLenum target, GLuint name);
+	void BeginConditionalRenderNV(GLuint id, GLenum mode);
 	void BindAttribLocation(GLuint program, GLuint index, const GLchar* name);
 	void BindBuffer(GLenum target, GLuint buffer);
 	void BindFramebuffer(GLenum target, GLuint framebuffer);
@@ -77,6 +78,7 @@ namespace gl
 	void Enable(GLenum cap);
 	void EnableVertexAttribArray(GLuint index);
 	void EndQueryEXT(GLenum target);
+	void EndConditionalRenderNV(void);
 	void FinishFenceNV(GLuint fence);
 	void Finish(void);
 	void Flush(void);
@@ -134,6 +136,7 @@ namespace gl
 	GLboolean IsTexture(GLuint texture);
 	void LineWidth(GLfloat width);
 	void LinkProgram(GLuint program);
+	void MaxShaderCompilerThreadsKHR(GLuint count);
 	void PixelStorei(GLenum pname, GLint param);
 	void PolygonOffset(GLfloat factor, GLfloat units);
 	void ReadnPixelsEXT(GLint x, GLint y, GLsizei width, GLsizei height,
@@ -142,6 +142,29 @@ void BeginQueryEXT(GLenum target, GLuint name)
 	}
 }
 
+void BeginConditionalRenderNV(GLuint id, GLenum mode)
+{
+	TRACE("(GLuint id = %d, GLenum mode = 0x%X)", id, mode);
+
+	switch(mode)
+	{
+	case GL_QUERY_WAIT_NV:
+	case GL_QUERY_NO_WAIT_NV:
+	case GL_QUERY_BY_REGION_WAIT_NV:
+	case GL_QUERY_BY_REGION_NO_WAIT_NV:
+		break;
+	default:
+		return error(GL_INVALID_ENUM);
+	}
+
+	auto context = es2::getContext();
+
+	if(context)
+	{
+		context->beginConditionalRender(id, mode);
+	}
+}
+
 void BindAttribLocation(GLuint program, GLuint index, const GLchar* name)
 {
 	TRACE("(GLuint program = %d, GLuint index = %d, const GLchar* name = %s)", program, index, name);
@@ -683,7 +706,7 @@ void CompileShader(GLuint shader)
 			}
 		}
 
-		shaderObject->compile();
+		shaderObject->compile(context->getMaxShaderCompilerThreads());
 	}
 }
 
@@ -1826,6 +1849,18 @@ void EndQueryEXT(GLenum target)
 	}
 }
 
+void EndConditionalRenderNV(void)
+{
+	TRACE("()");
+
+	auto context = es2::getContext();
+
+	if(context)
+	{
+		context->endConditionalRender();
+	}
+}
+
 void FinishFenceNV(GLuint fence)
 {
 	TRACE("(GLuint fence = %d)", fence);
@@ -2932,6 +2967,9 @@ void GetProgramiv(GLuint program, GLenum pname, GLint* params)
 		case GL_LINK_STATUS:
 			*params = programObject->isLinked();
 			return;
+		case GL_COMPLETION_STATUS_KHR:
+			*params = GL_TRUE;   // Linking waits for the compilation of the shaders
+			return;
 		case GL_VALIDATE_STATUS:
 			*params = programObject->isValidated();
 			return;
@@ -3151,6 +3189,9 @@ void GetShaderiv(GLuint shader, GLenum pname, GLint* params)
 		case GL_COMPILE_STATUS:
 			*params = shaderObject->isCompiled() ? GL_TRUE : GL_FALSE;
 			return;
+		case GL_COMPLETION_STATUS_KHR:
+			*params = shaderObject->isCompileComplete() ? GL_TRUE : GL_FALSE;
+			return;
 		case GL_INFO_LOG_LENGTH:
 			*params = (GLint)shaderObject->getInfoLogLength();
 			return;
@@ -4196,6 +4237,18 @@ void ReleaseShaderCompiler(void)
 	es2::Shader::releaseCompiler();
 }
 
+void MaxShaderCompilerThreadsKHR(GLuint count)
+{
+	TRACE("(GLuint count = %d)", count);
+
+	auto context = es2::getContext();
+
+	if(context)
+	{
+		context->setMaxShaderCompilerThreads(count);
+	}
+}
+
 void RenderbufferStorageMultisample(GLenum target, GLsizei samples, GLenum internalformat, GLsizei width, GLsizei height)
 {
 	TRACE("(GLenum target = 0x%X, GLsizei samples = %d, GLenum internalformat = 0x%X, GLsizei width = %d, GLsizei height = %d)",
@@ -6315,6 +6368,7 @@ extern "C" NO_SANITIZE_FUNCTION __eglMustCastToProperFunctionPointerType es2GetP
 
 		FUNCTION(ActiveTexture),
 		FUNCTION(AttachShader),
+		FUNCTION(BeginConditionalRenderNV),
 		FUNCTION(BeginQuery),
 		FUNCTION(BeginQueryEXT),
 		FUNCTION(BeginTransformFeedback),
@@ -6397,6 +6451,7 @@ extern "C" NO_SANITIZE_FUNCTION __eglMustCastToProperFunctionPointerType es2GetP
 		FUNCTION(EGLImageTargetTexture2DOES),
 		FUNCTION(Enable),
 		FUNCTION(EnableVertexAttribArray),
+		FUNCTION(EndConditionalRenderNV),
 		FUNCTION(EndQuery),
 		FUNCTION(EndQueryEXT),
 		FUNCTION(EndTransformFeedback),
@@ -6506,6 +6561,7 @@ extern "C" NO_SANITIZE_FUNCTION __eglMustCastToProperFunctionPointerType es2GetP
 		FUNCTION(LineWidth),
 		FUNCTION(LinkProgram),
 		FUNCTION(MapBufferRange),
+		FUNCTION(MaxShaderCompilerThreadsKHR),
 		FUNCTION(PauseTransformFeedback),
 		FUNCTION(PixelStorei),
 		FUNCTION(PolygonOffset),
@@ -44,6 +44,7 @@ public:
 	void (*glActiveTexture)(GLenum texture);
 	void (*glAttachShader)(GLuint program, GLuint shader);
 	void (*glBeginQueryEXT)(GLenum target, GLuint name);
+	void (*glBeginConditionalRenderNV)(GLuint id, GLenum mode);
 	void (*glBindAttribLocation)(GLuint program, GLuint index, const GLchar* name);
 	void (*glBindBuffer)(GLenum target, GLuint buffer);
 	void (*glBindFramebuffer)(GLenum target, GLuint framebuffer);
@@ -97,6 +98,7 @@ public:
 	void (*glEnable)(GLenum cap);
 	void (*glEnableVertexAttribArray)(GLuint index);
 	void (*glEndQueryEXT)(GLenum target);
+	void (*glEndConditionalRenderNV)(void);
 	void (*glFinishFenceNV)(GLuint fence);
 	void (*glFinish)(void);
 	void (*glFlush)(void);
@@ -154,6 +156,7 @@ public:
 	GLboolean (*glIsTexture)(GLuint texture);
 	void (*glLineWidth)(GLfloat width);
 	void (*glLinkProgram)(GLuint program);
+	void (*glMaxShaderCompilerThreadsKHR)(GLuint count);
 	void (*glPixelStorei)(GLenum pname, GLint param);
 	void (*glPolygonOffset)(GLfloat factor, GLfloat units);
 	void (*glReadnPixelsEXT)(GLint x, GLint y, GLsizei width, GLsizei height,
@@ -249,6 +252,9 @@ public:
 	egl::Image *(*createBackBufferFromClientBuffer)(const egl::ClientBuffer& clientBuffer);
 	egl::Image *(*createDepthStencil)(int width, int height, sw::Format format, int multiSampleDepth);
 	sw::FrameBuffer *(*createFrameBuffer)(void *nativeDisplay, EGLNativeWindowType window, int width, int height);
+#if defined(__linux__) && !defined(__ANDROID__)
+	egl::Image *(*createImageFromDmaBuf)(int width, int height, GLenum internalformat, int fd, size_t offset, int pitch);
+#endif
 };
 
 class LibGLESv2
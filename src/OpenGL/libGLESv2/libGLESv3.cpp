@@ -3475,10 +3475,22 @@ void GetProgramBinary(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *
 		{
 			return error(GL_INVALID_OPERATION);
 		}
-	}
 
-	// SwiftShader doesn't return a program binary and sets the program binay size to 0, so any attempt at getting one is invalid.
-	return error(GL_INVALID_OPERATION);
+		if(!programObject->getBinary(bufSize, length, binary))
+		{
+			if(length)
+			{
+				*length = 0;
+			}
+
+			return error(GL_INVALID_OPERATION);
+		}
+
+		if(binaryFormat)
+		{
+			*binaryFormat = es2::PROGRAM_BINARY_FORMAT_SWIFTSHADER;
+		}
+	}
 }
 
 void ProgramBinary(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length)
@@ -3501,10 +3513,23 @@ void ProgramBinary(GLuint program, GLenum binaryFormat, const void *binary, GLsi
 		{
 			return error(GL_INVALID_OPERATION);
 		}
-	}
 
-	// Regardless of what the binaryFormat is, it is unrecognized by SwiftShader, since it supports no format.
-	return error(GL_INVALID_ENUM);
+		if(binaryFormat != es2::PROGRAM_BINARY_FORMAT_SWIFTSHADER)
+		{
+			return error(GL_INVALID_ENUM);
+		}
+
+		if(programObject == context->getCurrentProgram())
+		{
+			es2::TransformFeedback* transformFeedback = context->getTransformFeedback();
+			if(transformFeedback && transformFeedback->isActive())
+			{
+				return error(GL_INVALID_OPERATION);
+			}
+		}
+
+		programObject->loadBinary(binary, length);   // An unusable binary only fails the link
+	}
 }
 
 void ProgramParameteri(GLuint program, GLenum pname, GLint value)
@@ -15,13 +15,17 @@
 #include "Constants.hpp"
 
 #include "Common/Math.hpp"
-#include "Common/Half.hpp"
 
 #include <memory.h>
 
 namespace sw
 {
-	Constants constants;
+	const Constants &getConstants()
+	{
+		static const ALIGN(64, Constants) constants;   // Cache line aligned, thread-safe initialization
+
+		return constants;
+	}
 
 	Constants::Constants()
 	{
@@ -353,10 +357,5 @@ namespace sw
 		memcpy(&this->unscaleInt, &unscaleInt, sizeof(unscaleInt));
 		memcpy(&this->unscaleUInt, &unscaleUInt, sizeof(unscaleUInt));
 		memcpy(&this->unscaleFixed, &unscaleFixed, sizeof(unscaleFixed));
-
-		for(int i = 0; i <= 0xFFFF; i++)
-		{
-			half2float[i] = (float)reinterpret_cast<half&>(i);
-		}
 	}
 }
\ No newline at end of file
@@ -19,26 +19,30 @@
 
 namespace sw
 {
+	// Members are grouped by how often routines use them, so the lines every pixel
+	// routine touches stay together and the large, format specific tables come last.
 	struct Constants
 	{
 		Constants();
 
-		unsigned int transposeBit0[16];
-		unsigned int transposeBit1[16];
-		unsigned int transposeBit2[16];
+		// Quad positions and coverage, used by every pixel routine
+		float4 X[4];
+		float4 Y[4];
 
-		ushort4 cWeight[17];
-		float4 uvWeight[17];
-		float4 uvStart[17];
+		int Xf[4];
+		int Yf[4];
 
 		unsigned int occlusionCount[16];
 
+		// Depth and stencil write masks
+		dword4 maskD4X[16];
+		dword4 invMaskD4X[16];
 		byte8 maskB4Q[16];
 		byte8 invMaskB4Q[16];
+
+		// Write masks of color formats up to 64 bits per pixel
 		word4 maskW4Q[16];
 		word4 invMaskW4Q[16];
-		dword4 maskD4X[16];
-		dword4 invMaskD4X[16];
 		qword maskQ0Q[16];
 		qword maskQ1Q[16];
 		qword maskQ2Q[16];
@@ -47,6 +51,15 @@ namespace sw
 		qword invMaskQ1Q[16];
 		qword invMaskQ2Q[16];
 		qword invMaskQ3Q[16];
+		dword2 maskD01Q[16];
+		dword2 maskD23Q[16];
+		dword2 invMaskD01Q[16];
+		dword2 invMaskD23Q[16];
+		word4 maskW01Q[4];
+		dword4 maskD01X[4];
+		word4 mask565Q[8];
+
+		// Write masks of 128 bit per pixel color formats
 		dword4 maskX0X[16];
 		dword4 maskX1X[16];
 		dword4 maskX2X[16];
@@ -55,37 +68,31 @@ namespace sw
 		dword4 invMaskX1X[16];
 		dword4 invMaskX2X[16];
 		dword4 invMaskX3X[16];
-		dword2 maskD01Q[16];
-		dword2 maskD23Q[16];
-		dword2 invMaskD01Q[16];
-		dword2 invMaskD23Q[16];
 		qword2 maskQ01X[16];
 		qword2 maskQ23X[16];
 		qword2 invMaskQ01X[16];
 		qword2 invMaskQ23X[16];
-		word4 maskW01Q[4];
-		dword4 maskD01X[4];
-		word4 mask565Q[8];
+
+		// Cube face selection
+		unsigned int transposeBit0[16];
+		unsigned int transposeBit1[16];
+		unsigned int transposeBit2[16];
+
+		// Sampling
+		ushort4 cWeight[17];
+		float4 uvWeight[17];
+		float4 uvStart[17];
 
 		unsigned short sRGBtoLinear8_16[256];
 		unsigned short sRGBtoLinear6_16[64];
 		unsigned short sRGBtoLinear5_16[32];
 
-		unsigned short linearToSRGB12_16[4096];
-		unsigned short sRGBtoLinear12_16[4096];
-
 		// Centroid parameters
 		float4 sampleX[4][16];
 		float4 sampleY[4][16];
 		float4 weight[16];
 
-		// Fragment offsets
-		int Xf[4];
-		int Yf[4];
-
-		float4 X[4];
-		float4 Y[4];
-
+		// Vertex processing
 		dword maxX[16];
 		dword maxY[16];
 		dword maxZ[16];
@@ -104,10 +111,12 @@ namespace sw
 		float4 unscaleUInt;
 		float4 unscaleFixed;
 
-		float half2float[65536];
+		// sRGB render targets
+		unsigned short linearToSRGB12_16[4096];
+		unsigned short sRGBtoLinear12_16[4096];
 	};
 
-	extern Constants constants;
+	const Constants &getConstants();   // Built on first use, the tables take a while to compute
 }
 
 #endif   // sw_Constants_hpp
@@ -26,6 +26,18 @@ namespace sw
 	extern bool halfIntegerCoordinates;     // Pixel centers are not at integer coordinates
 	extern bool symmetricNormalizedDepth;   // [-1, 1] instead of [0, 1]
 
+	// Same as sw::half's conversion, including denormals, infinities and NaNs
+	static RValue<Float4> halfToFloat(RValue<Int4> halfBits)
+	{
+		UInt4 bits = As<UInt4>(halfBits);
+		UInt4 expmant = bits & UInt4(0x7FFF);
+		UInt4 sign = (bits ^ expmant) << 16;
+		UInt4 infnan = CmpNLE(expmant, UInt4(0x7BFF)) & UInt4(255 << 23);
+		Float4 magnitude = As<Float4>(expmant << 13) * As<Float4>(UInt4((254 - 15) << 23));   // Rebias the exponent by 2^112
+
+		return As<Float4>(As<UInt4>(magnitude) | sign | infnan);
+	}
+
 	VertexRoutine::VertexRoutine(const VertexProcessor::State &state, const VertexShader *shader)
 		: v(shader && shader->indirectAddressableInput),
 		  o(shader && shader->indirectAddressableOutput),
@@ -491,56 +503,16 @@ namespace sw
 			break;
 		case STREAMTYPE_HALF:
 			{
-				if(stream.count >= 1)
-				{
-					UShort x0 = *Pointer<UShort>(source0 + 0);
-					UShort x1 = *Pointer<UShort>(source1 + 0);
-					UShort x2 = *Pointer<UShort>(source2 + 0);
-					UShort x3 = *Pointer<UShort>(source3 + 0);
-
-					v.x.x = *Pointer<Float>(constants + OFFSET(Constants,half2float) + Int(x0) * 4);
-					v.x.y = *Pointer<Float>(constants + OFFSET(Constants,half2float) + Int(x1) * 4);
-					v.x.z = *Pointer<Float>(constants + OFFSET(Constants,half2float) + Int(x2) * 4);
-					v.x.w = *Pointer<Float>(constants + OFFSET(Constants,half2float) + Int(x3) * 4);
-				}
-
-				if(stream.count >= 2)
-				{
-					UShort y0 = *Pointer<UShort>(source0 + 2);
-					UShort y1 = *Pointer<UShort>(source1 + 2);
-					UShort y2 = *Pointer<UShort>(source2 + 2);
-					UShort y3 = *Pointer<UShort>(source3 + 2);
-
-					v.y.x = *Pointer<Float>(constants + OFFSET(Constants,half2float) + Int(y0) * 4);
-					v.y.y = *Pointer<Float>(constants + OFFSET(Constants,half2float) + Int(y1) * 4);
-					v.y.z = *Pointer<Float>(constants + OFFSET(Constants,half2float) + Int(y2) * 4);
-					v.y.w = *Pointer<Float>(constants + OFFSET(Constants,half2float) + Int(y3) * 4);
-				}
-
-				if(stream.count >= 3)
+				// Converted arithmetically, a lookup table takes 256 KB of mostly cold cache lines
+				for(int i = 0; i < 4 && i < (int)stream.count; i++)
 				{
-					UShort z0 = *Pointer<UShort>(source0 + 4);
-					UShort z1 = *Pointer<UShort>(source1 + 4);
-					UShort z2 = *Pointer<UShort>(source2 + 4);
-					UShort z3 = *Pointer<UShort>(source3 + 4);
-
-					v.z.x = *Pointer<Float>(constants + OFFSET(Constants,half2float) + Int(z0) * 4);
-					v.z.y = *Pointer<Float>(constants + OFFSET(Constants,half2float) + Int(z1) * 4);
-					v.z.z = *Pointer<Float>(constants + OFFSET(Constants,half2float) + Int(z2) * 4);
-					v.z.w = *Pointer<Float>(constants + OFFSET(Constants,half2float) + Int(z3) * 4);
-				}
+					Int4 bits(0);
+					bits = Insert(bits, Int(*Pointer<UShort>(source0 + 2 * i)), 0);
+					bits = Insert(bits, Int(*Pointer<UShort>(source1 + 2 * i)), 1);
+					bits = Insert(bits, Int(*Pointer<UShort>(source2 + 2 * i)), 2);
+					bits = Insert(bits, Int(*Pointer<UShort>(source3 + 2 * i)), 3);
 
-				if(stream.count >= 4)
-				{
-					UShort w0 = *Pointer<UShort>(source0 + 6);
-					UShort w1 = *Pointer<UShort>(source1 + 6);
-					UShort w2 = *Pointer<UShort>(source2 + 6);
-					UShort w3 = *Pointer<UShort>(source3 + 6);
-
-					v.w.x = *Pointer<Float>(constants + OFFSET(Constants,half2float) + Int(w0) * 4);
-					v.w.y = *Pointer<Float>(constants + OFFSET(Constants,half2float) + Int(w1) * 4);
-					v.w.z = *Pointer<Float>(constants + OFFSET(Constants,half2float) + Int(w2) * 4);
-					v.w.w = *Pointer<Float>(constants + OFFSET(Constants,half2float) + Int(w3) * 4);
+					v[i] = halfToFloat(bits);
 				}
 			}
 			break;
@@ -36,6 +36,11 @@ namespace rr
 	bool CPUID::SSE3 = detectSSE3();
 	bool CPUID::SSSE3 = detectSSSE3();
 	bool CPUID::SSE4_1 = detectSSE4_1();
+	bool CPUID::AVX = detectAVX();
+	bool CPUID::AVX2 = detectAVX2();
+	bool CPUID::FMA = detectFMA();
+	bool CPUID::F16C = detectF16C();
+	bool CPUID::AVX512F = detectAVX512F();
 
 	bool CPUID::enableMMX = true;
 	bool CPUID::enableCMOV = true;
@@ -44,6 +49,11 @@ namespace rr
 	bool CPUID::enableSSE3 = true;
 	bool CPUID::enableSSSE3 = true;
 	bool CPUID::enableSSE4_1 = true;
+	bool CPUID::enableAVX = true;
+	bool CPUID::enableAVX2 = true;
+	bool CPUID::enableFMA = true;
+	bool CPUID::enableF16C = true;
+	bool CPUID::enableAVX512F = false;   // Opt-in, routines don't use 512-bit vectors and it can lower the clock frequency
 
 	void CPUID::setEnableMMX(bool enable)
 	{
@@ -56,6 +66,11 @@ namespace rr
 			enableSSE3 = false;
 			enableSSSE3 = false;
 			enableSSE4_1 = false;
+			enableAVX = false;
+			enableAVX2 = false;
+			enableFMA = false;
+			enableF16C = false;
+			enableAVX512F = false;
 		}
 	}
 
@@ -70,6 +85,11 @@ namespace rr
 			enableSSE3 = false;
 			enableSSSE3 = false;
 			enableSSE4_1 = false;
+			enableAVX = false;
+			enableAVX2 = false;
+			enableFMA = false;
+			enableF16C = false;
+			enableAVX512F = false;
 		}
 	}
 
@@ -88,6 +108,11 @@ namespace rr
 			enableSSE3 = false;
 			enableSSSE3 = false;
 			enableSSE4_1 = false;
+			enableAVX = false;
+			enableAVX2 = false;
+			enableFMA = false;
+			enableF16C = false;
+			enableAVX512F = false;
 		}
 	}
 
@@ -106,6 +131,11 @@ namespace rr
 			enableSSE3 = false;
 			enableSSSE3 = false;
 			enableSSE4_1 = false;
+			enableAVX = false;
+			enableAVX2 = false;
+			enableFMA = false;
+			enableF16C = false;
+			enableAVX512F = false;
 		}
 	}
 
@@ -124,6 +154,11 @@ namespace rr
 		{
 			enableSSSE3 = false;
 			enableSSE4_1 = false;
+			enableAVX = false;
+			enableAVX2 = false;
+			enableFMA = false;
+			enableF16C = false;
+			enableAVX512F = false;
 		}
 	}
 
@@ -142,6 +177,11 @@ namespace rr
 		else
 		{
 			enableSSE4_1 = false;
+			enableAVX = false;
+			enableAVX2 = false;
+			enableFMA = false;
+			enableF16C = false;
+			enableAVX512F = false;
 		}
 	}
 
@@ -158,6 +198,76 @@ namespace rr
 			enableSSE3 = true;
 			enableSSSE3 = true;
 		}
+		else
+		{
+			enableAVX = false;
+			enableAVX2 = false;
+			enableFMA = false;
+			enableF16C = false;
+			enableAVX512F = false;
+		}
+	}
+
+	void CPUID::setEnableAVX(bool enable)
+	{
+		enableAVX = enable;
+
+		if(enableAVX)
+		{
+			setEnableSSE4_1(true);
+		}
+		else
+		{
+			enableAVX2 = false;
+			enableFMA = false;
+			enableF16C = false;
+			enableAVX512F = false;
+		}
+	}
+
+	void CPUID::setEnableAVX2(bool enable)
+	{
+		enableAVX2 = enable;
+
+		if(enableAVX2)
+		{
+			setEnableAVX(true);
+		}
+		else
+		{
+			enableAVX512F = false;
+		}
+	}
+
+	void CPUID::setEnableFMA(bool enable)
+	{
+		enableFMA = enable;
+
+		if(enableFMA)
+		{
+			setEnableAVX(true);
+		}
+	}
+
+	void CPUID::setEnableF16C(bool enable)
+	{
+		enableF16C = enable;
+
+		if(enableF16C)
+		{
+			setEnableAVX(true);
+		}
+	}
+
+	void CPUID::setEnableAVX512F(bool enable)
+	{
+		enableAVX512F = enable;
+
+		if(enableAVX512F)
+		{
+			setEnableAVX2(true);
+			setEnableFMA(true);
+		}
 	}
 
 	static void cpuid(int registers[4], int info)
@@ -176,6 +286,58 @@ namespace rr
 		#endif
 	}
 
+	static void cpuidex(int registers[4], int info, int subleaf)
+	{
+		#if defined(__i386__) || defined(__x86_64__)
+			#if defined(_WIN32)
+				__cpuidex(registers, info, subleaf);
+			#else
+				__asm volatile("cpuid": "=a" (registers[0]), "=b" (registers[1]), "=c" (registers[2]), "=d" (registers[3]): "a" (info), "c" (subleaf));
+			#endif
+		#else
+			registers[0] = 0;
+			registers[1] = 0;
+			registers[2] = 0;
+			registers[3] = 0;
+		#endif
+	}
+
+	// Register state the OS saves and restores on context switches, zero without XSAVE support.
+	static unsigned long long osSavedState()
+	{
+		int registers[4];
+		cpuid(registers, 1);
+
+		if((registers[2] & 0x08000000) == 0)   // OSXSAVE
+		{
+			return 0;
+		}
+
+		#if defined(__i386__) || defined(__x86_64__)
+			#if defined(_WIN32)
+				return _xgetbv(0);
+			#else
+				unsigned int eax, edx;
+				__asm volatile("xgetbv": "=a" (eax), "=d" (edx): "c" (0));
+				return ((unsigned long long)edx << 32) | eax;
+			#endif
+		#else
+			return 0;
+		#endif
+	}
+
+	// Returns true if the OS saves and restores the XMM and YMM registers on context switches.
+	static bool osSupportsYMM()
+	{
+		return (osSavedState() & 0x6) == 0x6;
+	}
+
+	// Also the opmask registers and the upper halves of ZMM0-15 and all of ZMM16-31.
+	static bool osSupportsZMM()
+	{
+		return (osSavedState() & 0xE6) == 0xE6;
+	}
+
 	bool CPUID::detectMMX()
 	{
 		int registers[4];
@@ -224,4 +386,53 @@ namespace rr
 		cpuid(registers, 1);
 		return SSE4_1 = (registers[2] & 0x00080000) != 0;
 	}
+
+	bool CPUID::detectAVX()
+	{
+		int registers[4];
+		cpuid(registers, 1);
+		return AVX = (registers[2] & 0x10000000) != 0 && osSupportsYMM();
+	}
+
+	bool CPUID::detectAVX2()
+	{
+		int registers[4];
+		cpuid(registers, 0);
+
+		if(registers[0] < 7)
+		{
+			return AVX2 = false;
+		}
+
+		cpuidex(registers, 7, 0);
+		return AVX2 = (registers[1] & 0x00000020) != 0 && detectAVX();
+	}
+
+	bool CPUID::detectFMA()
+	{
+		int registers[4];
+		cpuid(registers, 1);
+		return FMA = (registers[2] & 0x00001000) != 0 && detectAVX();
+	}
+
+	bool CPUID::detectF16C()
+	{
+		int registers[4];
+		cpuid(registers, 1);
+		return F16C = (registers[2] & 0x20000000) != 0 && detectAVX();
+	}
+
+	bool CPUID::detectAVX512F()
+	{
+		int registers[4];
+		cpuid(registers, 0);
+
+		if(registers[0] < 7)
+		{
+			return AVX512F = false;
+		}
+
+		cpuidex(registers, 7, 0);
+		return AVX512F = (registers[1] & 0x00010000) != 0 && detectAVX2() && osSupportsZMM();
+	}
 }
@@ -36,6 +36,11 @@ namespace rr
 		static bool supportsSSE3();
 		static bool supportsSSSE3();
 		static bool supportsSSE4_1();
+		static bool supportsAVX();    // Also requires the OS to preserve the upper halves of the YMM registers
+		static bool supportsAVX2();
+		static bool supportsFMA();
+		static bool supportsF16C();
+		static bool supportsAVX512F();   // Also requires the OS to preserve the ZMM and opmask registers
 
 		static void setEnableMMX(bool enable);
 		static void setEnableCMOV(bool enable);
@@ -44,6 +49,11 @@ namespace rr
 		static void setEnableSSE3(bool enable);
 		static void setEnableSSSE3(bool enable);
 		static void setEnableSSE4_1(bool enable);
+		static void setEnableAVX(bool enable);
+		static void setEnableAVX2(bool enable);
+		static void setEnableFMA(bool enable);
+		static void setEnableF16C(bool enable);
+		static void setEnableAVX512F(bool enable);
 
 	private:
 		static bool MMX;
@@ -53,6 +63,11 @@ namespace rr
 		static bool SSE3;
 		static bool SSSE3;
 		static bool SSE4_1;
+		static bool AVX;
+		static bool AVX2;
+		static bool FMA;
+		static bool F16C;
+		static bool AVX512F;
 
 		static bool enableMMX;
 		static bool enableCMOV;
@@ -61,6 +76,11 @@ namespace rr
 		static bool enableSSE3;
 		static bool enableSSSE3;
 		static bool enableSSE4_1;
+		static bool enableAVX;
+		static bool enableAVX2;
+		static bool enableFMA;
+		static bool enableF16C;
+		static bool enableAVX512F;
 
 		static bool detectMMX();
 		static bool detectCMOV();
@@ -69,6 +89,11 @@ namespace rr
 		static bool detectSSE3();
 		static bool detectSSSE3();
 		static bool detectSSE4_1();
+		static bool detectAVX();
+		static bool detectAVX2();
+		static bool detectFMA();
+		static bool detectF16C();
+		static bool detectAVX512F();
 	};
 }
 
@@ -113,6 +138,31 @@ namespace rr
 	{
 		return SSE4_1 && enableSSE4_1;
 	}
+
+	inline bool CPUID::supportsAVX()
+	{
+		return AVX && enableAVX;
+	}
+
+	inline bool CPUID::supportsAVX2()
+	{
+		return AVX2 && enableAVX2;
+	}
+
+	inline bool CPUID::supportsFMA()
+	{
+		return FMA && enableFMA;
+	}
+
+	inline bool CPUID::supportsF16C()
+	{
+		return F16C && enableF16C;
+	}
+
+	inline bool CPUID::supportsAVX512F()
+	{
+		return AVX512F && enableAVX512F;
+	}
 }
 
 #endif   // rr_CPUID_hpp
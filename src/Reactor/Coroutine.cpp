@@ -0,0 +1,239 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#if defined(__APPLE__)
+#define _XOPEN_SOURCE 700   // For the deprecated, but functional, ucontext routines
+#endif
+
+#include "Coroutine.hpp"
+
+#include "Nucleus.hpp"
+
+#if defined(_WIN32)
+	#include <windows.h>
+	#undef Yield   // Defined in WinBase.h
+#elif defined(__ANDROID__)
+	#include <condition_variable>
+	#include <mutex>
+	#include <thread>
+#else
+	#include <ucontext.h>
+#endif
+
+#include <cassert>
+
+namespace rr
+{
+	static const size_t stackSize = 1024 * 1024;
+
+#if defined(_WIN32)
+	struct Coroutine::Context
+	{
+		LPVOID fiber = nullptr;
+		LPVOID caller = nullptr;
+
+		static void WINAPI main(LPVOID parameter)
+		{
+			Coroutine *coroutine = static_cast<Coroutine*>(parameter);
+			coroutine->run();
+
+			SwitchToFiber(coroutine->context->caller);   // Fibers must not return
+		}
+	};
+
+	bool Coroutine::resume()
+	{
+		if(finished)
+		{
+			return false;
+		}
+
+		if(!context->fiber)
+		{
+			context->fiber = CreateFiber(stackSize, Context::main, this);
+		}
+
+		bool converted = !IsThreadAFiber();
+		context->caller = converted ? ConvertThreadToFiber(nullptr) : GetCurrentFiber();
+
+		SwitchToFiber(context->fiber);
+
+		if(converted)
+		{
+			ConvertFiberToThread();
+		}
+
+		return !finished;
+	}
+
+	void Coroutine::yield(void *coroutine)
+	{
+		SwitchToFiber(static_cast<Coroutine*>(coroutine)->context->caller);
+	}
+
+	Coroutine::~Coroutine()
+	{
+		assert(finished || !context->fiber);
+
+		if(context->fiber)
+		{
+			DeleteFiber(context->fiber);
+		}
+
+		delete context;
+	}
+#elif defined(__ANDROID__)
+	// Bionic lacks the ucontext routines, so each coroutine gets a thread, which takes turns with its caller
+	struct Coroutine::Context
+	{
+		std::thread thread;
+		std::mutex mutex;
+		std::condition_variable signal;
+		bool running = false;   // The coroutine has the turn, rather than its caller
+	};
+
+	bool Coroutine::resume()
+	{
+		if(finished)
+		{
+			return false;
+		}
+
+		std::unique_lock<std::mutex> lock(context->mutex);
+		context->running = true;
+
+		if(!context->thread.joinable())
+		{
+			context->thread = std::thread([this]()
+			{
+				{
+					std::unique_lock<std::mutex> lock(context->mutex);
+					context->signal.wait(lock, [this]() { return context->running; });
+				}
+
+				run();
+
+				std::lock_guard<std::mutex> lock(context->mutex);
+				context->running = false;
+				context->signal.notify_all();
+			});
+		}
+
+		context->signal.notify_all();
+		context->signal.wait(lock, [this]() { return !context->running; });
+
+		return !finished;
+	}
+
+	void Coroutine::yield(void *coroutine)
+	{
+		Context *context = static_cast<Coroutine*>(coroutine)->context;
+
+		std::unique_lock<std::mutex> lock(context->mutex);
+		context->running = false;
+		context->signal.notify_all();
+		context->signal.wait(lock, [context]() { return context->running; });
+	}
+
+	Coroutine::~Coroutine()
+	{
+		assert(finished || !context->thread.joinable());
+
+		if(context->thread.joinable())
+		{
+			context->thread.join();
+		}
+
+		delete context;
+	}
+#else
+	struct Coroutine::Context
+	{
+		ucontext_t fiber;
+		ucontext_t caller;
+		char *stack = nullptr;
+
+		// makecontext() only passes int arguments, so the pointer is split in two
+		static void main(int high, int low)
+		{
+			uint64_t pointer = (static_cast<uint64_t>(static_cast<uint32_t>(high)) << 32) | static_cast<uint32_t>(low);
+			reinterpret_cast<Coroutine*>(static_cast<uintptr_t>(pointer))->run();
+		}   // Continues with uc_link, the latest caller
+	};
+
+	bool Coroutine::resume()
+	{
+		if(finished)
+		{
+			return false;
+		}
+
+		if(!context->stack)
+		{
+			context->stack = new char[stackSize];
+
+			getcontext(&context->fiber);
+			context->fiber.uc_stack.ss_sp = context->stack;
+			context->fiber.uc_stack.ss_size = stackSize;
+			context->fiber.uc_link = &context->caller;
+
+			uint64_t pointer = reinterpret_cast<uintptr_t>(this);
+			makecontext(&context->fiber, reinterpret_cast<void(*)()>(Context::main), 2,
+			            static_cast<int>(pointer >> 32), static_cast<int>(pointer & 0xFFFFFFFF));
+		}
+
+		swapcontext(&context->caller, &context->fiber);
+
+		return !finished;
+	}
+
+	void Coroutine::yield(void *coroutine)
+	{
+		Context *context = static_cast<Coroutine*>(coroutine)->context;
+
+		swapcontext(&context->fiber, &context->caller);
+	}
+
+	Coroutine::~Coroutine()
+	{
+		assert(finished || !context->stack);
+
+		delete[] context->stack;
+		delete context;
+	}
+#endif
+
+	Coroutine::Coroutine(Routine *routine, void *data) : routine(routine), data(data), finished(false), context(new Context())
+	{
+	}
+
+	bool Coroutine::isFinished() const
+	{
+		return finished;
+	}
+
+	void Coroutine::run()
+	{
+		auto entry = reinterpret_cast<void(*)(void*, void*)>(const_cast<void*>(routine->getEntry()));
+		entry(this, data);
+
+		finished = true;
+	}
+
+	void Yield(RValue<Pointer<Byte>> coroutine)
+	{
+		Nucleus::createCall(Coroutine::yield, coroutine.value);
+	}
+}
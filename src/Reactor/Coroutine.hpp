@@ -0,0 +1,63 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef rr_Coroutine_hpp
+#define rr_Coroutine_hpp
+
+#include "Reactor.hpp"
+
+#ifdef Yield   // Defined in WinBase.h
+#undef Yield
+#endif
+
+namespace rr
+{
+	// Runs a routine which can suspend itself with Yield(), and continue where
+	// it left off when resumed. The routine's entry has the signature
+	// void(Byte *coroutine, Byte *data), and its first argument is passed to
+	// Yield(). Each coroutine runs on a stack of its own, as a fiber of the
+	// thread calling resume(), so many of them can be interleaved on a few
+	// threads, for instance to run all invocations up to a barrier.
+	class Coroutine
+	{
+	public:
+		Coroutine(Routine *routine, void *data);   // The routine must outlive the coroutine
+
+		~Coroutine();   // Must have finished running
+
+		// Runs the routine until it yields or returns. Returns false once it returned.
+		// Only one thread at a time may resume a coroutine.
+		bool resume();
+		bool isFinished() const;
+
+		// Called by the generated code
+		static void yield(void *coroutine);
+
+	private:
+		struct Context;
+
+		void run();
+
+		Routine *const routine;
+		void *const data;
+		bool finished;
+		Context *context;   // Platform specific
+	};
+
+	// Suspends the coroutine, until the next Coroutine::resume()
+	void Yield(RValue<Pointer<Byte>> coroutine);
+}
+
+#endif   // rr_Coroutine_hpp
@@ -29,7 +29,11 @@
 	#include <unistd.h>
 #endif
 
+#include <atomic>
 #include <memory.h>
+#include <map>
+#include <mutex>
+#include <vector>
 
 #undef allocate
 #undef deallocate
@@ -48,6 +52,8 @@ struct Allocation
 	unsigned char *block;
 };
 
+std::atomic<size_t> executableBytes(0);
+
 void *allocateRaw(size_t bytes, size_t alignment)
 {
 	ASSERT((alignment & (alignment - 1)) == 0);   // Power of 2 alignment.
@@ -116,6 +122,9 @@ int anonymousFd()
 // Ensure there is enough space in the "anonymous" fd for length.
 void ensureAnonFileSize(int anonFd, size_t length)
 {
+	static std::mutex fileSizeMutex;   // Routines can be compiled on several threads
+	std::lock_guard<std::mutex> lock(fileSizeMutex);
+
 	static size_t fileSize = 0;
 	if(length > fileSize)
 	{
@@ -125,6 +134,204 @@ void ensureAnonFileSize(int anonFd, size_t length)
 }
 #endif  // defined(LINUX_ENABLE_NAMED_MMAP)
 
+#if !defined(_WIN32)
+// Maps read-write pages which can later be made executable. Returns nullptr on failure.
+void *mapPages(size_t length)
+{
+	void *mapping;
+
+	#if defined(LINUX_ENABLE_NAMED_MMAP)
+		// Try to name the memory region for the executable code,
+		// to aid profilers.
+		int anonFd = anonymousFd();
+		if(anonFd == -1)
+		{
+			mapping = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+			               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		}
+		else
+		{
+			ensureAnonFileSize(anonFd, length);
+			mapping = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+			               MAP_PRIVATE, anonFd, 0);
+		}
+	#else
+		mapping = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+		               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	#endif
+
+	return (mapping == MAP_FAILED) ? nullptr : mapping;
+}
+
+// Packs the executable memory of routines into large regions, instead of mapping
+// each routine separately. This saves a system call per allocation and keeps the
+// code of all routines close together. Allocations remain page granular, because
+// markExecutable() changes the protection of individual routines.
+class ExecutableMemoryPool
+{
+public:
+	void *allocate(size_t length);
+	bool deallocate(void *memory, size_t length);   // Returns false if the memory was not allocated from the pool
+
+private:
+	// Regions are aligned to, and as large as, a huge page. Once all of a region's
+	// pages have been marked executable the kernel can back it with a huge page.
+	static const size_t regionSize = 2 * 1024 * 1024;
+	static const size_t maxPooledLength = regionSize / 4;   // Larger allocations get their own mapping
+
+	struct Region
+	{
+		unsigned char *base;
+		std::map<size_t, size_t> freeRanges;   // Offset to length of the unused page ranges
+		size_t freeLength;
+	};
+
+	bool allocateRegion();
+
+	std::mutex mutex;
+	std::vector<Region> regions;
+};
+
+bool ExecutableMemoryPool::allocateRegion()
+{
+	// Over-allocate, so the region can be aligned by unmapping the excess.
+	unsigned char *mapping = (unsigned char*)mapPages(2 * regionSize);
+
+	if(!mapping)
+	{
+		return false;
+	}
+
+	unsigned char *base = (unsigned char*)(((uintptr_t)mapping + regionSize - 1) & ~(uintptr_t)(regionSize - 1));
+
+	if(base != mapping)
+	{
+		munmap(mapping, base - mapping);
+	}
+
+	munmap(base + regionSize, (mapping + 2 * regionSize) - (base + regionSize));
+
+	#if defined(MADV_HUGEPAGE)
+		madvise(base, regionSize, MADV_HUGEPAGE);
+	#endif
+
+	Region region;
+	region.base = base;
+	region.freeRanges[0] = regionSize;
+	region.freeLength = regionSize;
+	regions.push_back(region);
+
+	return true;
+}
+
+void *ExecutableMemoryPool::allocate(size_t length)
+{
+	if(length > maxPooledLength)
+	{
+		return mapPages(length);
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for(int attempt = 0; attempt < 2; attempt++)
+	{
+		for(Region &region : regions)
+		{
+			if(region.freeLength < length)
+			{
+				continue;
+			}
+
+			for(auto range = region.freeRanges.begin(); range != region.freeRanges.end(); range++)
+			{
+				if(range->second >= length)   // First fit
+				{
+					size_t offset = range->first;
+					size_t remaining = range->second - length;
+
+					region.freeRanges.erase(range);
+
+					if(remaining > 0)
+					{
+						region.freeRanges[offset + length] = remaining;
+					}
+
+					region.freeLength -= length;
+
+					return region.base + offset;
+				}
+			}
+		}
+
+		if(!allocateRegion())
+		{
+			break;
+		}
+	}
+
+	return mapPages(length);
+}
+
+bool ExecutableMemoryPool::deallocate(void *memory, size_t length)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for(size_t i = 0; i < regions.size(); i++)
+	{
+		Region &region = regions[i];
+
+		if((unsigned char*)memory < region.base || (unsigned char*)memory >= region.base + regionSize)
+		{
+			continue;
+		}
+
+		// Return the pages to the system, but keep the address range for reuse.
+		mprotect(memory, length, PROT_READ | PROT_WRITE);
+		madvise(memory, length, MADV_DONTNEED);
+
+		size_t offset = (unsigned char*)memory - region.base;
+		auto range = region.freeRanges.emplace(offset, length).first;
+
+		auto next = std::next(range);
+		if(next != region.freeRanges.end() && next->first == offset + length)
+		{
+			range->second += next->second;
+			region.freeRanges.erase(next);
+		}
+
+		if(range != region.freeRanges.begin())
+		{
+			auto previous = std::prev(range);
+			if(previous->first + previous->second == offset)
+			{
+				previous->second += range->second;
+				region.freeRanges.erase(range);
+			}
+		}
+
+		region.freeLength += length;
+
+		// Keep one region around to avoid remapping when routines come and go.
+		if(region.freeLength == regionSize && regions.size() > 1)
+		{
+			munmap(region.base, regionSize);
+			regions[i] = regions.back();
+			regions.pop_back();
+		}
+
+		return true;
+	}
+
+	return false;
+}
+
+ExecutableMemoryPool &executableMemoryPool()
+{
+	// Leaked, so routines released by other static destructors at exit can still free their memory
+	static ExecutableMemoryPool *pool = new ExecutableMemoryPool();
+	return *pool;
+}
+#endif   // !defined(_WIN32)
 }  // anonymous namespace
 
 size_t memoryPageSize()
@@ -176,33 +383,19 @@ void *allocateExecutable(size_t bytes)
 {
 	size_t pageSize = memoryPageSize();
 	size_t length = (bytes + pageSize - 1) & ~(pageSize - 1);
-	void *mapping;
-
-	#if defined(LINUX_ENABLE_NAMED_MMAP)
-		// Try to name the memory region for the executable code,
-		// to aid profilers.
-		int anonFd = anonymousFd();
-		if(anonFd == -1)
-		{
-			mapping = mmap(nullptr, length, PROT_READ | PROT_WRITE,
-			               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-		}
-		else
-		{
-			ensureAnonFileSize(anonFd, length);
-			mapping = mmap(nullptr, length, PROT_READ | PROT_WRITE,
-			               MAP_PRIVATE, anonFd, 0);
-		}
 
-		if(mapping == MAP_FAILED)
-		{
-			mapping = nullptr;
-		}
+	#if defined(_WIN32)
+		void *memory = allocate(length, pageSize);
 	#else
-		mapping = allocate(length, pageSize);
+		void *memory = executableMemoryPool().allocate(length);
 	#endif
 
-	return mapping;
+	if(memory)
+	{
+		executableBytes += length;
+	}
+
+	return memory;
 }
 
 void markExecutable(void *memory, size_t bytes)
@@ -217,17 +410,29 @@ void markExecutable(void *memory, size_t bytes)
 
 void deallocateExecutable(void *memory, size_t bytes)
 {
+	if(memory)
+	{
+		size_t pageSize = memoryPageSize();
+		executableBytes -= (bytes + pageSize - 1) & ~(pageSize - 1);
+	}
+
 	#if defined(_WIN32)
 		unsigned long oldProtection;
 		VirtualProtect(memory, bytes, PAGE_READWRITE, &oldProtection);
 		deallocate(memory);
-	#elif defined(LINUX_ENABLE_NAMED_MMAP)
+	#else
 		size_t pageSize = memoryPageSize();
 		size_t length = (bytes + pageSize - 1) & ~(pageSize - 1);
-		munmap(memory, length);
-	#else
-		mprotect(memory, bytes, PROT_READ | PROT_WRITE);
-		deallocate(memory);
+
+		if(memory && !executableMemoryPool().deallocate(memory, length))
+		{
+			munmap(memory, length);
+		}
 	#endif
 }
+
+size_t executableMemoryUsage()
+{
+	return executableBytes;
+}
 }
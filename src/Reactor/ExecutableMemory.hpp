@@ -25,6 +25,8 @@ size_t memoryPageSize();
 void *allocateExecutable(size_t bytes);   // Allocates memory that can be made executable using markExecutable()
 void markExecutable(void *memory, size_t bytes);
 void deallocateExecutable(void *memory, size_t bytes);
+
+size_t executableMemoryUsage();   // Bytes of routine code currently allocated, in whole pages
 }
 
 #endif   // rr_ExecutableMemory_hpp
@@ -63,6 +63,7 @@
 	#include "llvm/IR/LegacyPassManager.h"
 	#include "llvm/IR/Mangler.h"
 	#include "llvm/IR/Module.h"
+	#include "llvm/Object/SymbolSize.h"
 	#include "llvm/Support/Error.h"
 	#include "llvm/Support/TargetSelect.h"
 	#include "llvm/Target/TargetOptions.h"
@@ -76,9 +77,17 @@
 	#define CreateCall2 CreateCall
 	#define CreateCall3 CreateCall
 
+	#include <mutex>
 	#include <unordered_map>
 #endif
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <list>
+#include <mutex>
 #include <numeric>
 #include <fstream>
 
@@ -118,13 +127,35 @@ namespace rr
 
 namespace
 {
+#if REACTOR_LLVM_VERSION < 7
 	rr::LLVMReactorJIT *reactorJIT = nullptr;
 	llvm::IRBuilder<> *builder = nullptr;
 	llvm::LLVMContext *context = nullptr;
 	llvm::Module *module = nullptr;
 	llvm::Function *function = nullptr;
 
-	rr::MutexLock codegenMutex;
+	rr::MutexLock codegenMutex("codegen");
+#else
+	// Each thread builds its routines in its own LLVM context and JIT,
+	// so several can be compiled at once.
+	thread_local rr::LLVMReactorJIT *reactorJIT = nullptr;
+	thread_local llvm::IRBuilder<> *builder = nullptr;
+	thread_local llvm::LLVMContext *context = nullptr;
+	thread_local llvm::Module *module = nullptr;
+	thread_local llvm::Function *function = nullptr;
+
+	std::once_flag targetInitialized;
+#endif
+
+	thread_local bool optimizationEnabled = true;
+	thread_local rr::RoutineCategory routineCategory = rr::RoutineGeneric;
+
+	// Compiler threads read the passes of each category while the configuration may change them,
+	// so every change publishes an immutable copy. Replaced copies are kept, since a routine
+	// may still be compiling with them.
+	std::atomic<const rr::Optimization*> categoryOptimization[rr::RoutineCategoryCount];   // Null uses rr::optimization
+	std::list<std::array<rr::Optimization, 10>> categoryOptimizationCopies;
+	std::mutex categoryOptimizationMutex;   // Serializes the changes
 
 #if REACTOR_LLVM_VERSION >= 7
 	llvm::Value *lowerPAVG(llvm::Value *x, llvm::Value *y)
@@ -500,12 +531,25 @@ namespace rr
 			return routineManager->acquireRoutine(entry);
 		}
 
-		void optimize(llvm::Module *module)
+		void optimize(llvm::Module *module, RoutineCategory category)
 		{
-			static llvm::PassManager *passManager = nullptr;
+			// Only accessed while holding the codegen mutex
+			static llvm::PassManager *passManagers[RoutineCategoryCount] = {};   // Built on first use
+			static Optimization passManagerPasses[RoutineCategoryCount][10];      // Passes each was built with
+			llvm::PassManager *&passManager = passManagers[category];
+
+			const Optimization *optimization = Nucleus::getOptimizationPasses(category);
+
+			if(passManager && memcmp(passManagerPasses[category], optimization, sizeof(passManagerPasses[category])) != 0)
+			{
+				delete passManager;   // The configuration changed
+				passManager = nullptr;
+			}
 
 			if(!passManager)
 			{
+				memcpy(passManagerPasses[category], optimization, sizeof(passManagerPasses[category]));
+
 				passManager = new llvm::PassManager();
 
 				passManager->add(new llvm::TargetData(*executionEngine->getTargetData()));
@@ -570,6 +614,54 @@ namespace rr
 		ObjLayer objLayer;
 		CompileLayer compileLayer;
 		size_t emittedFunctionsNum;
+		std::mutex layerMutex;   // Routines can release their module from any thread
+		std::string currentRoutineName;   // For profilers, while the module is being loaded
+		size_t loadedCodeSize;            // Of the functions in the last loaded object
+		std::vector<rr::CodeSpan> loadedSpans;   // Sections of the last loaded object, after relocation
+
+		void notifyLoaded(const llvm::object::ObjectFile &object, const llvm::RuntimeDyld::LoadedObjectInfo &info)
+		{
+			for(const llvm::object::SectionRef &section : object.sections())
+			{
+				uint64_t address = info.getSectionLoadAddress(section);
+
+				if(address != 0 && section.getSize() != 0 && !section.isBSS())
+				{
+					loadedSpans.push_back({reinterpret_cast<const void*>(static_cast<uintptr_t>(address)),
+					                       static_cast<size_t>(section.getSize())});
+				}
+			}
+
+			// The debug object has its sections relocated to their load addresses.
+			llvm::object::OwningBinary<llvm::object::ObjectFile> debugObject = info.getObjectForDebug(object);
+			if(!debugObject.getBinary())
+			{
+				return;
+			}
+
+			for(const auto &symbolSize : llvm::object::computeSymbolSizes(*debugObject.getBinary()))
+			{
+				const llvm::object::SymbolRef &symbol = symbolSize.first;
+
+				llvm::Expected<llvm::object::SymbolRef::Type> type = symbol.getType();
+				if(!type || *type != llvm::object::SymbolRef::ST_Function)
+				{
+					llvm::consumeError(type.takeError());
+					continue;
+				}
+
+				llvm::Expected<uint64_t> address = symbol.getAddress();
+				if(!address)
+				{
+					llvm::consumeError(address.takeError());
+					continue;
+				}
+
+				loadedCodeSize += symbolSize.second;
+				writePerfMapEntry(reinterpret_cast<const void*>(static_cast<uintptr_t>(*address)),
+				                  symbolSize.second, currentRoutineName.c_str());
+			}
+		}
 
 	public:
 		LLVMReactorJIT(const char *arch, const llvm::SmallVectorImpl<std::string>& mattrs,
@@ -605,9 +697,14 @@ namespace rr
 					return ObjLayer::Resources{
 						std::make_shared<llvm::SectionMemoryManager>(),
 						resolver};
+				},
+				[this](llvm::orc::VModuleKey, const llvm::object::ObjectFile &object,
+				       const llvm::RuntimeDyld::LoadedObjectInfo &info) {
+					notifyLoaded(object, info);
 				}),
 			compileLayer(objLayer, llvm::orc::SimpleCompiler(*targetMachine)),
-			emittedFunctionsNum(0)
+			emittedFunctionsNum(0),
+			loadedCodeSize(0)
 		{
 		}
 
@@ -622,7 +719,8 @@ namespace rr
 			::module = nullptr;
 		}
 
-		LLVMRoutine *acquireRoutine(llvm::Function *func)
+		LLVMRoutine *acquireRoutine(llvm::Function *func, const std::string &routineName, size_t &codeSize,
+		                            std::vector<rr::CodeSpan> &codeSpans)
 		{
 			std::string name = "f" + llvm::Twine(emittedFunctionsNum++).str();
 			func->setName(name);
@@ -633,6 +731,11 @@ namespace rr
 			::module = nullptr;
 			mod->setDataLayout(dataLayout);
 
+			std::lock_guard<std::mutex> lock(layerMutex);
+			currentRoutineName = routineName;
+			loadedCodeSize = 0;
+			loadedSpans.clear();
+
 			auto moduleKey = session.allocateVModule();
 			llvm::cantFail(compileLayer.addModule(moduleKey, std::move(mod)));
 
@@ -651,11 +754,15 @@ namespace rr
 			}
 
 			void *addr = reinterpret_cast<void *>(static_cast<intptr_t>(expectAddr.get()));
+			codeSize = loadedCodeSize;
+			codeSpans = loadedSpans;
 			return new LLVMRoutine(addr, releaseRoutineCallback, this, moduleKey);
 		}
 
-		void optimize(llvm::Module *module)
+		void optimize(llvm::Module *module, RoutineCategory category)
 		{
+			const Optimization *optimization = Nucleus::getOptimizationPasses(category);
+
 			std::unique_ptr<llvm::legacy::PassManager> passManager(
 				new llvm::legacy::PassManager());
 
@@ -686,6 +793,7 @@ namespace rr
 	private:
 		void releaseRoutineModule(llvm::orc::VModuleKey moduleKey)
 		{
+			std::lock_guard<std::mutex> lock(layerMutex);
 			llvm::cantFail(compileLayer.removeModule(moduleKey));
 		}
 
@@ -805,37 +913,36 @@ namespace rr
 		return llvm::cast<llvm::VectorType>(T(type))->getNumElements();
 	}
 
-	Nucleus::Nucleus()
+	// The compilation target is chosen once, by the first routine of the process. Each
+	// thread's JIT still creates its own TargetMachine from it, since those can't be used
+	// by concurrent compilations, but all of them generate code for the same features.
+	struct JITTarget
 	{
-		::codegenMutex.lock();   // Reactor and LLVM are currently not thread safe
-
-		llvm::InitializeNativeTarget();
+		JITTarget();
 
+		const char *arch;
+		llvm::SmallVector<std::string, 16> mattrs;
 #if REACTOR_LLVM_VERSION >= 7
-		llvm::InitializeNativeTargetAsmPrinter();
-		llvm::InitializeNativeTargetAsmParser();
+		llvm::TargetOptions options;
 #endif
+	};
 
-		if(!::context)
-		{
-			::context = new llvm::LLVMContext();
-		}
-
+	JITTarget::JITTarget()
+	{
 		#if defined(__x86_64__)
-			static const char arch[] = "x86-64";
+			arch = "x86-64";
 		#elif defined(__i386__)
-			static const char arch[] = "x86";
+			arch = "x86";
 		#elif defined(__aarch64__)
-			static const char arch[] = "arm64";
+			arch = "arm64";
 		#elif defined(__arm__)
-			static const char arch[] = "arm";
+			arch = "arm";
 		#elif defined(__mips__)
-			static const char arch[] = "mipsel";
+			arch = "mipsel";
 		#else
 		#error "unknown architecture"
 		#endif
 
-		llvm::SmallVector<std::string, 1> mattrs;
 #if defined(__i386__) || defined(__x86_64__)
 		mattrs.push_back(CPUID::supportsMMX()    ? "+mmx"    : "-mmx");
 		mattrs.push_back(CPUID::supportsCMOV()   ? "+cmov"   : "-cmov");
@@ -847,6 +954,11 @@ namespace rr
 		mattrs.push_back(CPUID::supportsSSE4_1() ? "+sse41"  : "-sse41");
 #else
 		mattrs.push_back(CPUID::supportsSSE4_1() ? "+sse4.1" : "-sse4.1");
+		mattrs.push_back(CPUID::supportsAVX()    ? "+avx"    : "-avx");
+		mattrs.push_back(CPUID::supportsAVX2()   ? "+avx2"   : "-avx2");
+		mattrs.push_back(CPUID::supportsFMA()    ? "+fma"    : "-fma");
+		mattrs.push_back(CPUID::supportsF16C()   ? "+f16c"   : "-f16c");
+		mattrs.push_back(CPUID::supportsAVX512F() ? "+avx512f" : "-avx512f");
 #endif
 #elif defined(__arm__)
 #if __ARM_ARCH >= 8
@@ -863,18 +975,47 @@ namespace rr
 		// llvm::NoInfsFPMath = true;
 		// llvm::NoNaNsFPMath = true;
 #else
-		llvm::TargetOptions targetOpts;
-		targetOpts.UnsafeFPMath = false;
-		// targetOpts.NoInfsFPMath = true;
-		// targetOpts.NoNaNsFPMath = true;
+		options.UnsafeFPMath = false;
+		// options.NoInfsFPMath = true;
+		// options.NoNaNsFPMath = true;
 #endif
+	}
+
+	static const JITTarget &jitTarget()
+	{
+		static const JITTarget target;   // Thread-safe initialization
+
+		return target;
+	}
+
+	Nucleus::Nucleus()
+	{
+#if REACTOR_LLVM_VERSION < 7
+		::codegenMutex.lock();   // The LLVM 3 JIT is not thread safe
+
+		llvm::InitializeNativeTarget();
+#else
+		std::call_once(::targetInitialized, []()
+		{
+			llvm::InitializeNativeTarget();
+			llvm::InitializeNativeTargetAsmPrinter();
+			llvm::InitializeNativeTargetAsmParser();
+		});
+#endif
+
+		if(!::context)
+		{
+			::context = new llvm::LLVMContext();
+		}
 
 		if(!::reactorJIT)
 		{
+			const JITTarget &target = jitTarget();
+
 #if REACTOR_LLVM_VERSION < 7
-			::reactorJIT = new LLVMReactorJIT(arch, mattrs);
+			::reactorJIT = new LLVMReactorJIT(target.arch, target.mattrs);
 #else
-			::reactorJIT = new LLVMReactorJIT(arch, mattrs, targetOpts);
+			::reactorJIT = new LLVMReactorJIT(target.arch, target.mattrs, target.options);
 #endif
 		}
 
@@ -902,11 +1043,15 @@ namespace rr
 	{
 		::reactorJIT->endSession();
 
+#if REACTOR_LLVM_VERSION < 7
 		::codegenMutex.unlock();
+#endif
 	}
 
 	Routine *Nucleus::acquireRoutine(const wchar_t *name, bool runOptimizations)
 	{
+		auto start = std::chrono::steady_clock::now();
+
 		if(::builder->GetInsertBlock()->empty() || !::builder->GetInsertBlock()->back().isTerminator())
 		{
 			llvm::Type *type = ::function->getReturnType();
@@ -932,11 +1077,23 @@ namespace rr
 			::module->print(file, 0);
 		}
 
-		if(runOptimizations)
+		uint64_t instructionCount = 0;
+		for(const llvm::BasicBlock &basicBlock : *::function)
+		{
+			instructionCount += basicBlock.size();
+		}
+
+		auto optimizeStart = std::chrono::steady_clock::now();
+
+		if(runOptimizations && ::optimizationEnabled)
 		{
 			optimize();
 		}
 
+		::routineCategory = RoutineGeneric;
+
+		auto optimizeEnd = std::chrono::steady_clock::now();
+
 		if(false)
 		{
 #if REACTOR_LLVM_VERSION < 7
@@ -948,8 +1105,30 @@ namespace rr
 			::module->print(file, 0);
 		}
 
+		std::wstring wideName(name);
+		std::string asciiName(wideName.begin(), wideName.end());
+
+		size_t codeSize = 0;
+		std::vector<CodeSpan> codeSpans;
+
+#if REACTOR_LLVM_VERSION < 7
 		LLVMRoutine *routine = ::reactorJIT->acquireRoutine(::function);
 
+		if(routine)
+		{
+			codeSize = routine->getCodeSize();
+			codeSpans.push_back({routine->getBuffer(), static_cast<size_t>(routine->getFunctionSize())});
+			writePerfMapEntry(routine->getEntry(), codeSize, asciiName.c_str());
+		}
+#else
+		LLVMRoutine *routine = ::reactorJIT->acquireRoutine(::function, asciiName, codeSize, codeSpans);
+#endif
+
+		auto end = std::chrono::steady_clock::now();
+		recordCompilation(instructionCount, codeSize,
+		                  std::chrono::duration_cast<std::chrono::microseconds>(end - start).count(),
+		                  std::chrono::duration_cast<std::chrono::microseconds>(optimizeEnd - optimizeStart).count());
+
 #if defined(_WIN32) && REACTOR_LLVM_VERSION < 7
 		if(CodeAnalystLogJITCode)
 		{
@@ -957,12 +1136,105 @@ namespace rr
 		}
 #endif
 
-		return routine;
+		return shareIdenticalRoutine(routine, codeSpans);
+	}
+
+	void Nucleus::setOptimizationEnabled(bool enabled)
+	{
+		::optimizationEnabled = enabled;
+	}
+
+	bool Nucleus::isOptimizationEnabled()
+	{
+		return ::optimizationEnabled;
+	}
+
+	// LLVM's own passes already cover these
+	void Nucleus::setGlobalOptimizationEnabled(bool enabled)
+	{
+	}
+
+	bool Nucleus::isGlobalOptimizationEnabled()
+	{
+		return false;
+	}
+
+	void Nucleus::setOptimizationPasses(RoutineCategory category, const Optimization passes[10])
+	{
+		std::lock_guard<std::mutex> lock(::categoryOptimizationMutex);
+
+		const Optimization *current = ::categoryOptimization[category];
+
+		if(!passes)
+		{
+			::categoryOptimization[category] = nullptr;
+		}
+		else if(!current || memcmp(current, passes, 10 * sizeof(Optimization)) != 0)
+		{
+			// Reuse an identical copy, so switching between configurations doesn't keep allocating
+			auto copy = std::find_if(::categoryOptimizationCopies.begin(), ::categoryOptimizationCopies.end(), [passes](const std::array<Optimization, 10> &copy)
+			{
+				return memcmp(copy.data(), passes, 10 * sizeof(Optimization)) == 0;
+			});
+
+			if(copy == ::categoryOptimizationCopies.end())
+			{
+				::categoryOptimizationCopies.emplace_back();
+				copy = std::prev(::categoryOptimizationCopies.end());
+				std::copy(passes, passes + 10, copy->begin());
+			}
+
+			::categoryOptimization[category] = copy->data();
+		}
+	}
+
+	const Optimization *Nucleus::getOptimizationPasses(RoutineCategory category)
+	{
+		const Optimization *passes = ::categoryOptimization[category];
+
+		return passes ? passes : optimization;
+	}
+
+	void Nucleus::setRoutineCategory(RoutineCategory category)
+	{
+		::routineCategory = category;
+	}
+
+	void Nucleus::setCPUFeatures(unsigned int enabled)
+	{
+		// Set from the most to the least demanding extension, enabling one also enables its prerequisites
+		CPUID::setEnableAVX512F((enabled & CPU_AVX512F) != 0);
+		CPUID::setEnableF16C((enabled & CPU_F16C) != 0);
+		CPUID::setEnableFMA((enabled & CPU_FMA) != 0);
+		CPUID::setEnableAVX2((enabled & CPU_AVX2) != 0);
+		CPUID::setEnableAVX((enabled & CPU_AVX) != 0);
+		CPUID::setEnableSSE4_1((enabled & CPU_SSE4_1) != 0);
+		CPUID::setEnableSSSE3((enabled & CPU_SSSE3) != 0);
+		CPUID::setEnableSSE3((enabled & CPU_SSE3) != 0);
+		CPUID::setEnableSSE2((enabled & CPU_SSE2) != 0);
+	}
+
+	unsigned int Nucleus::getCPUFeatures()
+	{
+		return (CPUID::supportsSSE2()    ? CPU_SSE2    : 0) |
+		       (CPUID::supportsSSE3()    ? CPU_SSE3    : 0) |
+		       (CPUID::supportsSSSE3()   ? CPU_SSSE3   : 0) |
+		       (CPUID::supportsSSE4_1()  ? CPU_SSE4_1  : 0) |
+		       (CPUID::supportsAVX()     ? CPU_AVX     : 0) |
+		       (CPUID::supportsAVX2()    ? CPU_AVX2    : 0) |
+		       (CPUID::supportsFMA()     ? CPU_FMA     : 0) |
+		       (CPUID::supportsF16C()    ? CPU_F16C    : 0) |
+		       (CPUID::supportsAVX512F() ? CPU_AVX512F : 0);
+	}
+
+	Routine *Nucleus::loadRoutine(const void *image, size_t size)
+	{
+		return nullptr;   // JIT-compiled code isn't relocatable
 	}
 
 	void Nucleus::optimize()
 	{
-		::reactorJIT->optimize(::module);
+		::reactorJIT->optimize(::module, ::routineCategory);
 	}
 
 	Value *Nucleus::allocateStackVariable(Type *type, int arraySize)
@@ -1501,6 +1773,16 @@ namespace rr
 		::builder->CreateUnreachable();
 	}
 
+	void Nucleus::createCall(void (*function)(void*), Value *argument)
+	{
+		llvm::Type *pointerType = llvm::Type::getInt8PtrTy(*::context);
+		llvm::FunctionType *functionType = llvm::FunctionType::get(llvm::Type::getVoidTy(*::context), pointerType, false);
+		llvm::Constant *address = llvm::ConstantInt::get(llvm::Type::getIntNTy(*::context, sizeof(void*) * 8), reinterpret_cast<uintptr_t>(function));
+		llvm::Value *callee = ::builder->CreateIntToPtr(address, llvm::PointerType::get(functionType, 0));
+
+		::builder->CreateCall(callee, ::builder->CreateBitCast(V(argument), pointerType));
+	}
+
 	static Value *createSwizzle4(Value *val, unsigned char select)
 	{
 		int swizzle[4] =
@@ -6639,6 +6921,18 @@ namespace rr
 #endif
 	}
 
+	RValue<Float4> FMA(RValue<Float4> x, RValue<Float4> y, RValue<Float4> z)
+	{
+#if REACTOR_LLVM_VERSION < 7
+		return x * y + z;
+#else
+		// Fused when the target has FMA instructions, a separate multiply and add otherwise
+		llvm::Function *fmuladd = llvm::Intrinsic::getDeclaration(::module, llvm::Intrinsic::fmuladd, {T(Float4::getType())});
+
+		return RValue<Float4>(V(::builder->CreateCall(fmuladd, {V(x.value), V(y.value), V(z.value)})));
+#endif
+	}
+
 	RValue<Float4> Insert(RValue<Float4> x, RValue<Float> element, int i)
 	{
 		return RValue<Float4>(Nucleus::createInsertElement(x.value, element.value, i));
@@ -6894,6 +7188,73 @@ namespace rr
 		return lhs = lhs - offset;
 	}
 
+	RValue<Float4> Gather(RValue<Pointer<Float>> base, RValue<Int4> offsets)
+	{
+#if REACTOR_LLVM_VERSION >= 7 && (defined(__i386__) || defined(__x86_64__))
+		if(CPUID::supportsAVX2())
+		{
+			return x86::gatherdps(base, offsets);
+		}
+#endif
+
+		Pointer<Byte> address = base;
+
+		Float4 result;
+		result = Insert(result, *Pointer<Float>(address + Extract(offsets, 0)), 0);
+		result = Insert(result, *Pointer<Float>(address + Extract(offsets, 1)), 1);
+		result = Insert(result, *Pointer<Float>(address + Extract(offsets, 2)), 2);
+		result = Insert(result, *Pointer<Float>(address + Extract(offsets, 3)), 3);
+
+		return result;
+	}
+
+	RValue<Int4> Gather(RValue<Pointer<Int>> base, RValue<Int4> offsets)
+	{
+#if REACTOR_LLVM_VERSION >= 7 && (defined(__i386__) || defined(__x86_64__))
+		if(CPUID::supportsAVX2())
+		{
+			return x86::gatherdd(base, offsets);
+		}
+#endif
+
+		Pointer<Byte> address = base;
+
+		Int4 result;
+		result = Insert(result, *Pointer<Int>(address + Extract(offsets, 0)), 0);
+		result = Insert(result, *Pointer<Int>(address + Extract(offsets, 1)), 1);
+		result = Insert(result, *Pointer<Int>(address + Extract(offsets, 2)), 2);
+		result = Insert(result, *Pointer<Int>(address + Extract(offsets, 3)), 3);
+
+		return result;
+	}
+
+	void MaskedStore(RValue<Pointer<Float4>> base, RValue<Float4> val, RValue<Int4> mask, unsigned int alignment)
+	{
+#if REACTOR_LLVM_VERSION < 7
+		Pointer<Float4> pointer(base, alignment);
+
+		Int4 previous = As<Int4>(Float4(*pointer));
+		*pointer = As<Float4>((As<Int4>(val) & mask) | (previous & ~mask));
+#else
+		// Lowered to a masked move with AVX, or to conditional scalar stores
+		llvm::Value *condition = ::builder->CreateICmpSLT(V(mask.value), llvm::Constant::getNullValue(T(Int4::getType())));
+		::builder->CreateMaskedStore(V(val.value), V(base.value), alignment, condition);
+#endif
+	}
+
+	void Prefetch(RValue<Pointer<Byte>> address)
+	{
+#if REACTOR_LLVM_VERSION >= 7
+		// Read access, high temporal locality, data cache
+		llvm::Function *prefetch = llvm::Intrinsic::getDeclaration(::module, llvm::Intrinsic::prefetch);
+		llvm::Value *rw = V(Nucleus::createConstantInt(0));
+		llvm::Value *locality = V(Nucleus::createConstantInt(3));
+		llvm::Value *cache = V(Nucleus::createConstantInt(1));
+
+		::builder->CreateCall(prefetch, {V(address.value), rw, locality, cache});
+#endif
+	}
+
 	void Return()
 	{
 		Nucleus::createRetVoid();
@@ -6982,6 +7343,32 @@ namespace rr
 			return RValue<Float4>(V(::builder->CreateCall(rcpps, ARGS(V(val.value)))));
 		}
 
+#if REACTOR_LLVM_VERSION >= 7
+		RValue<Float4> gatherdps(RValue<Pointer<Float>> base, RValue<Int4> offsets)
+		{
+			llvm::Function *gather = llvm::Intrinsic::getDeclaration(::module, llvm::Intrinsic::x86_avx2_gather_d_ps);
+
+			llvm::Value *source = llvm::Constant::getNullValue(T(Float4::getType()));
+			llvm::Value *pointer = ::builder->CreateBitCast(V(base.value), llvm::Type::getInt8PtrTy(*::context));
+			llvm::Value *mask = llvm::ConstantExpr::getBitCast(llvm::Constant::getAllOnesValue(T(Int4::getType())), T(Float4::getType()));
+			llvm::Value *scale = llvm::ConstantInt::get(llvm::Type::getInt8Ty(*::context), 1);
+
+			return RValue<Float4>(V(::builder->CreateCall(gather, {source, pointer, V(offsets.value), mask, scale})));
+		}
+
+		RValue<Int4> gatherdd(RValue<Pointer<Int>> base, RValue<Int4> offsets)
+		{
+			llvm::Function *gather = llvm::Intrinsic::getDeclaration(::module, llvm::Intrinsic::x86_avx2_gather_d_d);
+
+			llvm::Value *source = llvm::Constant::getNullValue(T(Int4::getType()));
+			llvm::Value *pointer = ::builder->CreateBitCast(V(base.value), llvm::Type::getInt8PtrTy(*::context));
+			llvm::Value *mask = llvm::Constant::getAllOnesValue(T(Int4::getType()));
+			llvm::Value *scale = llvm::ConstantInt::get(llvm::Type::getInt8Ty(*::context), 1);
+
+			return RValue<Int4>(V(::builder->CreateCall(gather, {source, pointer, V(offsets.value), mask, scale})));
+		}
+#endif
+
 		RValue<Float4> sqrtps(RValue<Float4> val)
 		{
 #if REACTOR_LLVM_VERSION < 7
@@ -39,6 +39,16 @@ namespace rr
 		return entry;
 	}
 
+	const void *LLVMRoutine::getBuffer()
+	{
+		return buffer;
+	}
+
+	int LLVMRoutine::getFunctionSize()
+	{
+		return functionSize;
+	}
+
 	int LLVMRoutine::getCodeSize()
 	{
 		return functionSize - static_cast<int>((uintptr_t)entry - (uintptr_t)buffer);
@@ -36,10 +36,10 @@ namespace rr
 
 		//void setFunctionSize(int functionSize);
 
-		//const void *getBuffer();
+		const void *getBuffer();
 		const void *getEntry();
 		//int getBufferSize();
-		//int getFunctionSize();   // Includes constants before the entry point
+		int getFunctionSize();   // Includes constants before the entry point
 		int getCodeSize();       // Executable code only
 		//bool isDynamic();
 
@@ -17,6 +17,7 @@
 
 #include <cassert>
 #include <cstdarg>
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 
@@ -44,7 +45,37 @@ namespace rr
 		OptimizationCount
 	};
 
-	extern Optimization optimization[10];
+	extern Optimization optimization[10];   // Passes of routines whose category has no pipeline of its own
+
+	// Kinds of routines which can be given their own optimization passes. Setup and
+	// blit routines are short and run briefly, so they benefit little from optimization,
+	// while pixel routines run for every fragment.
+	enum RoutineCategory
+	{
+		RoutineGeneric,
+		RoutineVertex,
+		RoutineSetup,
+		RoutinePixel,
+		RoutineBlit,
+		RoutineFrameBuffer,
+
+		RoutineCategoryCount
+	};
+
+	enum CPUFeature
+	{
+		CPU_SSE2    = 1 << 0,
+		CPU_SSE3    = 1 << 1,
+		CPU_SSSE3   = 1 << 2,
+		CPU_SSE4_1  = 1 << 3,
+		CPU_AVX     = 1 << 4,
+		CPU_AVX2    = 1 << 5,
+		CPU_FMA     = 1 << 6,
+		CPU_F16C    = 1 << 7,
+		CPU_AVX512F = 1 << 8,
+
+		CPU_ALL = (1 << 9) - 1
+	};
 
 	class Nucleus
 	{
@@ -54,6 +85,29 @@ namespace rr
 		virtual ~Nucleus();
 
 		Routine *acquireRoutine(const wchar_t *name, bool runOptimizations = true);
+		static Routine *loadRoutine(const void *image, size_t size);   // From Routine::getImage(), or nullptr if unsupported
+
+		// Routines acquired on the calling thread only run the optimization passes while enabled
+		static void setOptimizationEnabled(bool enabled);
+		static bool isOptimizationEnabled();
+
+		// Common subexpression elimination and loop-invariant code motion across basic blocks, off by default.
+		// Routines acquired on the calling thread run them while enabled. Only the Subzero back-end has them.
+		static void setGlobalOptimizationEnabled(bool enabled);
+		static bool isGlobalOptimizationEnabled();
+
+		// Routines of a category with passes of its own run them instead of the 'optimization' list.
+		// Null makes the category use that list again. Only the LLVM back-end has configurable passes.
+		static void setOptimizationPasses(RoutineCategory category, const Optimization passes[10]);
+		static const Optimization *getOptimizationPasses(RoutineCategory category);   // Currently used by the category
+
+		// Category of the next routine acquired on the calling thread, it reverts to RoutineGeneric afterwards
+		static void setRoutineCategory(RoutineCategory category);
+
+		// Instruction set extensions which the JIT may target, among the CPUFeature bits the CPU and OS
+		// support. Takes effect for the compilation target chosen by the first routine of the process.
+		static void setCPUFeatures(unsigned int enabled);
+		static unsigned int getCPUFeatures();   // Supported and enabled
 
 		static Value *allocateStackVariable(Type *type, int arraySize = 0);
 		static BasicBlock *createBasicBlock();
@@ -148,6 +202,7 @@ namespace rr
 		static SwitchCases *createSwitch(Value *control, BasicBlock *defaultBranch, unsigned numCases);
 		static void addSwitchCase(SwitchCases *switchCases, int label, BasicBlock *branch);
 		static void createUnreachable();
+		static void createCall(void (*function)(void*), Value *argument);   // Of a host function. Makes the routine process specific.
 
 		// Constant values
 		static Value *createNullValue(Type *type);
@@ -17,6 +17,8 @@
 #include "src/IceCfg.h"
 #include "src/IceCfgNode.h"
 
+#include <algorithm>
+#include <map>
 #include <vector>
 
 namespace
@@ -24,7 +26,7 @@ namespace
 	class Optimizer
 	{
 	public:
-		void run(Ice::Cfg *function);
+		void run(Ice::Cfg *function, bool globalOptimizations);
 
 	private:
 		void analyzeUses(Ice::Cfg *function);
@@ -32,6 +34,12 @@ namespace
 		void eliminateUnitializedLoads();
 		void eliminateLoadsFollowingSingleStore();
 		void optimizeStoresInSingleBasicBlock();
+		void eliminateCommonSubexpressions();
+		void hoistLoopInvariants();
+
+		void analyzeControlFlow();
+		bool dominates(Ice::CfgNode *a, Ice::CfgNode *b) const;
+		Ice::Inst *getTerminator(Ice::CfgNode *node) const;
 
 		void replace(Ice::Inst *instruction, Ice::Operand *newValue);
 		void deleteInstruction(Ice::Inst *instruction);
@@ -46,6 +54,8 @@ namespace
 		static Ice::Operand *storeData(const Ice::Inst *instruction);
 		static std::size_t storeSize(const Ice::Inst *instruction);
 		static bool loadTypeMatchesStore(const Ice::Inst *load, const Ice::Inst *store);
+		static bool isPure(const Ice::Inst &instruction);
+		static bool mayTrap(const Ice::Inst &instruction);
 
 		Ice::Cfg *function;
 		Ice::GlobalContext *context;
@@ -89,9 +99,29 @@ namespace
 		bool hasLoadStoreInsts(Ice::CfgNode* node) const;
 
 		std::vector<Optimizer::Uses*> allocatedUses;
+
+		// Control flow graph, indexed by Ice::CfgNode::getIndex().
+		std::vector<Ice::CfgNode*> nodes;
+		std::vector<std::vector<Ice::CfgNode*>> successors;
+		std::vector<std::vector<Ice::CfgNode*>> predecessors;
+		std::vector<Ice::CfgNode*> reversePostorder;
+		std::vector<int> postorderNumber;   // -1 for unreachable nodes
+		std::vector<Ice::CfgNode*> immediateDominator;
+
+		struct Expression
+		{
+			bool operator<(const Expression &other) const;
+
+			Ice::Inst::InstKind kind;
+			int op;
+			Ice::Type type;
+			std::vector<Ice::Operand*> operands;
+		};
+
+		static Expression getExpression(const Ice::Inst &instruction);
 	};
 
-	void Optimizer::run(Ice::Cfg *function)
+	void Optimizer::run(Ice::Cfg *function, bool globalOptimizations)
 	{
 		this->function = function;
 		this->context = function->getContext();
@@ -102,7 +132,14 @@ namespace
 		eliminateUnitializedLoads();
 		eliminateLoadsFollowingSingleStore();
 		optimizeStoresInSingleBasicBlock();
-		eliminateDeadCode();
+
+		if(globalOptimizations)
+		{
+			analyzeControlFlow();
+			eliminateCommonSubexpressions();
+			hoistLoopInvariants();
+			eliminateDeadCode();
+		}
 
 		for(auto uses : allocatedUses)
 		{
@@ -427,6 +464,371 @@ namespace
 		}
 	}
 
+	void Optimizer::eliminateCommonSubexpressions()
+	{
+		// Walk the dominator tree in preorder, keeping the pure expressions computed by
+		// the dominating blocks available. An expression recomputed in a block dominated
+		// by its first occurrence is replaced by the earlier result.
+		std::vector<std::vector<Ice::CfgNode*>> dominated(nodes.size());
+		for(Ice::CfgNode *node : reversePostorder)
+		{
+			if(immediateDominator[node->getIndex()] != node)
+			{
+				dominated[immediateDominator[node->getIndex()]->getIndex()].push_back(node);
+			}
+		}
+
+		std::map<Expression, Ice::Variable*> available;
+		std::vector<std::vector<Expression>> scopes;   // Expressions made available by each block on the stack
+		std::vector<std::pair<Ice::CfgNode*, size_t>> stack;
+
+		if(!reversePostorder.empty())
+		{
+			stack.push_back({reversePostorder.front(), 0});
+			scopes.push_back({});
+		}
+
+		while(!stack.empty())
+		{
+			Ice::CfgNode *node = stack.back().first;
+			size_t &child = stack.back().second;
+
+			if(child == 0)
+			{
+				for(Ice::Inst &inst : node->getInsts())
+				{
+					if(inst.isDeleted() || !isPure(inst))
+					{
+						continue;
+					}
+
+					Expression expression = getExpression(inst);
+					auto existing = available.find(expression);
+
+					if(existing != available.end())
+					{
+						replace(&inst, existing->second);
+					}
+					else
+					{
+						available[expression] = inst.getDest();
+						scopes.back().push_back(expression);
+					}
+				}
+			}
+
+			if(child < dominated[node->getIndex()].size())
+			{
+				Ice::CfgNode *next = dominated[node->getIndex()][child++];
+				stack.push_back({next, 0});
+				scopes.push_back({});
+			}
+			else
+			{
+				for(const Expression &expression : scopes.back())
+				{
+					available.erase(expression);
+				}
+
+				scopes.pop_back();
+				stack.pop_back();
+			}
+		}
+	}
+
+	void Optimizer::hoistLoopInvariants()
+	{
+		// Find the natural loops. Each back edge targets a header which dominates its
+		// source, and the loop body consists of the nodes reaching the source without
+		// passing through the header. Loops sharing a header are merged.
+		std::map<Ice::CfgNode*, std::vector<bool>> loops;
+
+		for(Ice::CfgNode *node : reversePostorder)
+		{
+			for(Ice::CfgNode *header : successors[node->getIndex()])
+			{
+				if(!dominates(header, node))
+				{
+					continue;
+				}
+
+				std::vector<bool> &body = loops[header];
+				body.resize(nodes.size(), false);
+				body[header->getIndex()] = true;
+
+				std::vector<Ice::CfgNode*> worklist;
+				if(!body[node->getIndex()])
+				{
+					body[node->getIndex()] = true;
+					worklist.push_back(node);
+				}
+
+				while(!worklist.empty())
+				{
+					Ice::CfgNode *current = worklist.back();
+					worklist.pop_back();
+
+					for(Ice::CfgNode *predecessor : predecessors[current->getIndex()])
+					{
+						if(!body[predecessor->getIndex()])
+						{
+							body[predecessor->getIndex()] = true;
+							worklist.push_back(predecessor);
+						}
+					}
+				}
+			}
+		}
+
+		// Process inner loops first, so their invariants can be hoisted further
+		// out of the enclosing loops.
+		std::vector<std::pair<size_t, Ice::CfgNode*>> order;
+		for(auto &loop : loops)
+		{
+			order.push_back({std::count(loop.second.begin(), loop.second.end(), true), loop.first});
+		}
+		std::sort(order.begin(), order.end(), [](const std::pair<size_t, Ice::CfgNode*> &a, const std::pair<size_t, Ice::CfgNode*> &b)
+		{
+			return a.first < b.first || (a.first == b.first && a.second->getIndex() < b.second->getIndex());
+		});
+
+		for(auto &loop : order)
+		{
+			Ice::CfgNode *header = loop.second;
+			const std::vector<bool> &body = loops[header];
+
+			// Only hoist into a preheader: the header's single predecessor from outside
+			// the loop, which unconditionally branches to the header.
+			Ice::CfgNode *preheader = nullptr;
+			bool multipleEntries = false;
+			for(Ice::CfgNode *predecessor : predecessors[header->getIndex()])
+			{
+				if(!body[predecessor->getIndex()])
+				{
+					multipleEntries = multipleEntries || (preheader && preheader != predecessor);
+					preheader = predecessor;
+				}
+			}
+
+			if(!preheader || multipleEntries)
+			{
+				continue;
+			}
+
+			Ice::Inst *terminator = getTerminator(preheader);
+			if(!terminator || !terminator->isUnconditionalBranch())
+			{
+				continue;
+			}
+
+			bool modified;
+			do
+			{
+				modified = false;
+
+				for(Ice::CfgNode *node : reversePostorder)
+				{
+					if(!body[node->getIndex()])
+					{
+						continue;
+					}
+
+					std::vector<Ice::Inst*> invariants;
+					for(Ice::Inst &inst : node->getInsts())
+					{
+						if(inst.isDeleted() || !isPure(inst) || mayTrap(inst))
+						{
+							continue;
+						}
+
+						bool invariant = true;
+						for(Ice::SizeT i = 0; i < inst.getSrcSize() && invariant; i++)
+						{
+							if(Ice::Variable *var = llvm::dyn_cast<Ice::Variable>(inst.getSrc(i)))
+							{
+								Ice::Inst *definition = getDefinition(var);
+								invariant = !definition || !body[getNode(definition)->getIndex()];
+							}
+						}
+
+						if(invariant)
+						{
+							invariants.push_back(&inst);
+						}
+					}
+
+					for(Ice::Inst *inst : invariants)
+					{
+						node->getInsts().remove(inst);
+						preheader->getInsts().insert(Ice::InstList::iterator(terminator), inst);
+						setNode(inst, preheader);
+						modified = true;
+					}
+				}
+			}
+			while(modified);
+		}
+	}
+
+	void Optimizer::analyzeControlFlow()
+	{
+		size_t count = function->getNumNodes();
+
+		nodes.assign(count, nullptr);
+		successors.assign(count, {});
+		predecessors.assign(count, {});
+		reversePostorder.clear();
+		postorderNumber.assign(count, -1);
+		immediateDominator.assign(count, nullptr);
+
+		for(Ice::CfgNode *node : function->getNodes())
+		{
+			nodes[node->getIndex()] = node;
+
+			if(Ice::Inst *terminator = getTerminator(node))
+			{
+				for(Ice::CfgNode *successor : terminator->getTerminatorEdges())
+				{
+					successors[node->getIndex()].push_back(successor);
+					predecessors[successor->getIndex()].push_back(node);
+				}
+			}
+		}
+
+		// Depth-first traversal from the entry to number the reachable nodes.
+		Ice::CfgNode *entry = function->getEntryNode();
+		std::vector<bool> visited(count, false);
+		std::vector<std::pair<Ice::CfgNode*, size_t>> stack;
+		std::vector<Ice::CfgNode*> postorder;
+
+		visited[entry->getIndex()] = true;
+		stack.push_back({entry, 0});
+
+		while(!stack.empty())
+		{
+			Ice::CfgNode *node = stack.back().first;
+			size_t &edge = stack.back().second;
+
+			if(edge < successors[node->getIndex()].size())
+			{
+				Ice::CfgNode *successor = successors[node->getIndex()][edge++];
+
+				if(!visited[successor->getIndex()])
+				{
+					visited[successor->getIndex()] = true;
+					stack.push_back({successor, 0});
+				}
+			}
+			else
+			{
+				postorderNumber[node->getIndex()] = (int)postorder.size();
+				postorder.push_back(node);
+				stack.pop_back();
+			}
+		}
+
+		reversePostorder.assign(postorder.rbegin(), postorder.rend());
+
+		// Iterative dominator computation (Cooper, Harvey and Kennedy).
+		immediateDominator[entry->getIndex()] = entry;
+
+		bool changed;
+		do
+		{
+			changed = false;
+
+			for(Ice::CfgNode *node : reversePostorder)
+			{
+				if(node == entry)
+				{
+					continue;
+				}
+
+				Ice::CfgNode *dominator = nullptr;
+				for(Ice::CfgNode *predecessor : predecessors[node->getIndex()])
+				{
+					if(!immediateDominator[predecessor->getIndex()])
+					{
+						continue;   // Unreachable, or not processed yet
+					}
+
+					if(!dominator)
+					{
+						dominator = predecessor;
+						continue;
+					}
+
+					Ice::CfgNode *other = predecessor;
+					while(dominator != other)
+					{
+						while(postorderNumber[dominator->getIndex()] < postorderNumber[other->getIndex()])
+						{
+							dominator = immediateDominator[dominator->getIndex()];
+						}
+
+						while(postorderNumber[other->getIndex()] < postorderNumber[dominator->getIndex()])
+						{
+							other = immediateDominator[other->getIndex()];
+						}
+					}
+				}
+
+				if(immediateDominator[node->getIndex()] != dominator)
+				{
+					immediateDominator[node->getIndex()] = dominator;
+					changed = true;
+				}
+			}
+		}
+		while(changed);
+	}
+
+	bool Optimizer::dominates(Ice::CfgNode *a, Ice::CfgNode *b) const
+	{
+		if(!immediateDominator[b->getIndex()])
+		{
+			return false;   // Unreachable
+		}
+
+		while(b != a)
+		{
+			Ice::CfgNode *dominator = immediateDominator[b->getIndex()];
+
+			if(dominator == b)
+			{
+				return false;   // Reached the entry
+			}
+
+			b = dominator;
+		}
+
+		return true;
+	}
+
+	Ice::Inst *Optimizer::getTerminator(Ice::CfgNode *node) const
+	{
+		for(Ice::Inst &inst : Ice::reverse_range(node->getInsts()))
+		{
+			if(inst.isDeleted())
+			{
+				continue;
+			}
+
+			switch(inst.getKind())
+			{
+			case Ice::Inst::Br:
+			case Ice::Inst::Switch:
+			case Ice::Inst::Ret:
+			case Ice::Inst::Unreachable:
+				return &inst;
+			default:
+				return nullptr;
+			}
+		}
+
+		return nullptr;
+	}
+
 	void Optimizer::analyzeUses(Ice::Cfg *function)
 	{
 		for(Ice::CfgNode *basicBlock : function->getNodes())
@@ -707,6 +1109,102 @@ namespace
 		return false;
 	}
 
+	bool Optimizer::isPure(const Ice::Inst &instruction)
+	{
+		if(!instruction.getDest() || instruction.hasSideEffects())
+		{
+			return false;
+		}
+
+		switch(instruction.getKind())
+		{
+		case Ice::Inst::Arithmetic:
+		case Ice::Inst::Cast:
+		case Ice::Inst::ExtractElement:
+		case Ice::Inst::Fcmp:
+		case Ice::Inst::Icmp:
+		case Ice::Inst::InsertElement:
+		case Ice::Inst::Select:
+		case Ice::Inst::ShuffleVector:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	bool Optimizer::mayTrap(const Ice::Inst &instruction)
+	{
+		if(auto *arithmetic = llvm::dyn_cast<Ice::InstArithmetic>(&instruction))
+		{
+			switch(arithmetic->getOp())
+			{
+			case Ice::InstArithmetic::Udiv:
+			case Ice::InstArithmetic::Sdiv:
+			case Ice::InstArithmetic::Urem:
+			case Ice::InstArithmetic::Srem:
+				return true;   // Division by zero
+			default:
+				break;
+			}
+		}
+
+		return false;
+	}
+
+	Optimizer::Expression Optimizer::getExpression(const Ice::Inst &instruction)
+	{
+		Expression expression;
+
+		expression.kind = instruction.getKind();
+		expression.op = 0;
+		expression.type = instruction.getDest()->getType();
+
+		for(Ice::SizeT i = 0; i < instruction.getSrcSize(); i++)
+		{
+			expression.operands.push_back(instruction.getSrc(i));
+		}
+
+		if(auto *arithmetic = llvm::dyn_cast<Ice::InstArithmetic>(&instruction))
+		{
+			expression.op = arithmetic->getOp();
+
+			if(arithmetic->isCommutative() && expression.operands[1] < expression.operands[0])
+			{
+				std::swap(expression.operands[0], expression.operands[1]);
+			}
+		}
+		else if(auto *cast = llvm::dyn_cast<Ice::InstCast>(&instruction))
+		{
+			expression.op = cast->getCastKind();
+		}
+		else if(auto *fcmp = llvm::dyn_cast<Ice::InstFcmp>(&instruction))
+		{
+			expression.op = fcmp->getCondition();
+		}
+		else if(auto *icmp = llvm::dyn_cast<Ice::InstIcmp>(&instruction))
+		{
+			expression.op = icmp->getCondition();
+		}
+		else if(auto *shuffle = llvm::dyn_cast<Ice::InstShuffleVector>(&instruction))
+		{
+			for(Ice::SizeT i = 0; i < shuffle->getNumIndexes(); i++)
+			{
+				expression.operands.push_back(shuffle->getIndex(i));
+			}
+		}
+
+		return expression;
+	}
+
+	bool Optimizer::Expression::operator<(const Expression &other) const
+	{
+		if(kind != other.kind) return kind < other.kind;
+		if(op != other.op) return op < other.op;
+		if(type != other.type) return type < other.type;
+
+		return operands < other.operands;
+	}
+
 	Optimizer::Uses* Optimizer::getUses(Ice::Operand* operand)
 	{
 		Optimizer::Uses* uses = (Optimizer::Uses*)operand->Ice::Operand::getExternalData();
@@ -828,10 +1326,10 @@ namespace
 
 namespace rr
 {
-	void optimize(Ice::Cfg *function)
+	void optimize(Ice::Cfg *function, bool globalOptimizations)
 	{
 		Optimizer optimizer;
 
-		optimizer.run(function);
+		optimizer.run(function, globalOptimizations);
 	}
 }
\ No newline at end of file
@@ -19,7 +19,8 @@
 
 namespace rr
 {
-	void optimize(Ice::Cfg *function);
+	// Global optimizations transform code across basic blocks, the other passes stay within them
+	void optimize(Ice::Cfg *function, bool globalOptimizations = false);
 }
 
 #endif   // rr_Optimizer_hpp
@@ -2106,6 +2106,7 @@ namespace rr
 	RValue<Float4> Rcp_pp(RValue<Float4> val, bool exactAtPow2 = false);
 	RValue<Float4> RcpSqrt_pp(RValue<Float4> val);
 	RValue<Float4> Sqrt(RValue<Float4> x);
+	RValue<Float4> FMA(RValue<Float4> x, RValue<Float4> y, RValue<Float4> z);   // x * y + z, with a single rounding where supported
 	RValue<Float4> Insert(RValue<Float4> val, RValue<Float> element, int i);
 	RValue<Float> Extract(RValue<Float4> x, int i);
 	RValue<Float4> Swizzle(RValue<Float4> x, unsigned char select);
@@ -2184,6 +2185,15 @@ namespace rr
 	RValue<Pointer<Byte>> operator-=(Pointer<Byte> &lhs, RValue<Int> offset);
 	RValue<Pointer<Byte>> operator-=(Pointer<Byte> &lhs, RValue<UInt> offset);
 
+	// Gather loads lane i from base + offsets[i] bytes. MaskedStore only writes the lanes
+	// whose mask is all ones, but may read and rewrite the others when not supported natively.
+	RValue<Float4> Gather(RValue<Pointer<Float>> base, RValue<Int4> offsets);
+	RValue<Int4> Gather(RValue<Pointer<Int>> base, RValue<Int4> offsets);
+	void MaskedStore(RValue<Pointer<Float4>> base, RValue<Float4> val, RValue<Int4> mask, unsigned int alignment = 16);
+
+	// Hints that the cache line at the address will be read soon. Never faults, and may do nothing.
+	void Prefetch(RValue<Pointer<Byte>> address);
+
 	template<class T, int S = 1>
 	class Array : public LValue<T>
 	{
@@ -0,0 +1,391 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures compile latency and execution throughput of representative Reactor
+// programs. Each run prints one line per benchmark:
+//
+//   <backend> <benchmark> compile_ms=<median> min_compile_ms=<min> mitems_per_s=<throughput>
+//
+// Usage: ReactorBenchmarks [--filter <substring>] [--compiles <count>] [--seconds <time>]
+
+#include "Reactor.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#ifndef REACTOR_BENCHMARK_BACKEND
+#define REACTOR_BENCHMARK_BACKEND "Reactor"
+#endif
+
+using namespace rr;
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	double elapsedSeconds(Clock::time_point start)
+	{
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	// Each benchmark generates its routine, then processes 'items' elements per call.
+	struct Benchmark
+	{
+		const char *name;
+		Routine *(*generate)();
+		void *(*setup)(int items);   // Returns the argument block passed to run()
+		void (*run)(const void *entry, void *arguments, int items);
+		void (*teardown)(void *arguments);
+	};
+
+	// Blit: RGBA8 to normalized RGBA32F conversion.
+
+	struct BlitArguments
+	{
+		std::vector<unsigned char> source;
+		std::vector<float> destination;
+	};
+
+	Routine *generateBlit()
+	{
+		Function<Void(Pointer<Byte>, Pointer<Byte>, Int)> function;
+		{
+			Pointer<Byte> destination = function.Arg<0>();
+			Pointer<Byte> source = function.Arg<1>();
+			Int count = function.Arg<2>();
+
+			For(Int i = 0, i < count, i++)
+			{
+				Float4 color = Float4(*Pointer<Byte4>(source + i * 4)) * Float4(1.0f / 255.0f);
+				*Pointer<Float4>(destination + i * 16, 16) = color;
+			}
+		}
+
+		return function(L"BlitBenchmark");
+	}
+
+	void *setupBlit(int items)
+	{
+		BlitArguments *arguments = new BlitArguments;
+		arguments->source.resize(items * 4);
+		arguments->destination.resize(items * 4 + 4);
+
+		for(size_t i = 0; i < arguments->source.size(); i++)
+		{
+			arguments->source[i] = (unsigned char)(i * 7);
+		}
+
+		return arguments;
+	}
+
+	float *align16(std::vector<float> &buffer)
+	{
+		return (float*)(((uintptr_t)buffer.data() + 15) & ~(uintptr_t)15);
+	}
+
+	void runBlit(const void *entry, void *arguments, int items)
+	{
+		BlitArguments *blit = (BlitArguments*)arguments;
+		void (*callable)(void*, void*, int) = (void(*)(void*, void*, int))entry;
+		callable(align16(blit->destination), blit->source.data(), items);
+	}
+
+	void teardownBlit(void *arguments)
+	{
+		delete (BlitArguments*)arguments;
+	}
+
+	// Sampler: bilinear filtering of a single channel float texture, four samples per iteration.
+
+	const int textureSize = 256;
+
+	struct SamplerArguments
+	{
+		std::vector<float> texture;
+		std::vector<float> coordinates;   // Four u's followed by four v's
+		std::vector<float> destination;
+	};
+
+	Routine *generateSampler()
+	{
+		Function<Void(Pointer<Byte>, Pointer<Byte>, Pointer<Byte>, Int)> function;
+		{
+			Pointer<Byte> destination = function.Arg<0>();
+			Pointer<Byte> texture = function.Arg<1>();
+			Pointer<Byte> coordinates = function.Arg<2>();
+			Int quads = function.Arg<3>();
+
+			Float4 size = Float4(float(textureSize));
+			Int4 maxIndex = Int4(textureSize - 1);
+
+			For(Int i = 0, i < quads, i++)
+			{
+				Float4 u = *Pointer<Float4>(coordinates + i * 32 + 0);
+				Float4 v = *Pointer<Float4>(coordinates + i * 32 + 16);
+
+				Float4 x = u * size - Float4(0.5f);
+				Float4 y = v * size - Float4(0.5f);
+				Float4 x0 = Floor(x);
+				Float4 y0 = Floor(y);
+				Float4 fx = x - x0;
+				Float4 fy = y - y0;
+
+				Int4 ix0 = Min(Max(Int4(x0), Int4(0)), maxIndex);
+				Int4 iy0 = Min(Max(Int4(y0), Int4(0)), maxIndex);
+				Int4 ix1 = Min(ix0 + Int4(1), maxIndex);
+				Int4 iy1 = Min(iy0 + Int4(1), maxIndex);
+
+				Int4 row0 = iy0 * Int4(textureSize * 4);
+				Int4 row1 = iy1 * Int4(textureSize * 4);
+				Int4 column0 = ix0 * Int4(4);
+				Int4 column1 = ix1 * Int4(4);
+
+				Float4 c00 = Gather(Pointer<Float>(texture), row0 + column0);
+				Float4 c10 = Gather(Pointer<Float>(texture), row0 + column1);
+				Float4 c01 = Gather(Pointer<Float>(texture), row1 + column0);
+				Float4 c11 = Gather(Pointer<Float>(texture), row1 + column1);
+
+				Float4 c0 = FMA(c10 - c00, fx, c00);
+				Float4 c1 = FMA(c11 - c01, fx, c01);
+
+				*Pointer<Float4>(destination + i * 16, 16) = FMA(c1 - c0, fy, c0);
+			}
+		}
+
+		return function(L"SamplerBenchmark");
+	}
+
+	void *setupSampler(int items)
+	{
+		SamplerArguments *arguments = new SamplerArguments;
+		int quads = items / 4;
+		arguments->texture.resize(textureSize * textureSize);
+		arguments->coordinates.resize(quads * 8);
+		arguments->destination.resize(quads * 4 + 4);
+
+		for(size_t i = 0; i < arguments->texture.size(); i++)
+		{
+			arguments->texture[i] = float(i % 251) / 251.0f;
+		}
+
+		unsigned int seed = 1;
+
+		for(size_t i = 0; i < arguments->coordinates.size(); i++)
+		{
+			seed = seed * 1103515245 + 12345;
+			arguments->coordinates[i] = float((seed >> 8) & 0xFFFF) / 65536.0f;
+		}
+
+		return arguments;
+	}
+
+	void runSampler(const void *entry, void *arguments, int items)
+	{
+		SamplerArguments *sampler = (SamplerArguments*)arguments;
+		void (*callable)(void*, void*, void*, int) = (void(*)(void*, void*, void*, int))entry;
+		callable(align16(sampler->destination), sampler->texture.data(), sampler->coordinates.data(), items / 4);
+	}
+
+	void teardownSampler(void *arguments)
+	{
+		delete (SamplerArguments*)arguments;
+	}
+
+	// Vertex transform: 4x4 matrix times position, one vertex per iteration.
+
+	struct VertexArguments
+	{
+		std::vector<float> matrix;   // Column-major
+		std::vector<float> positions;
+		std::vector<float> destination;
+	};
+
+	Routine *generateVertex()
+	{
+		Function<Void(Pointer<Byte>, Pointer<Byte>, Pointer<Byte>, Int)> function;
+		{
+			Pointer<Byte> destination = function.Arg<0>();
+			Pointer<Byte> matrix = function.Arg<1>();
+			Pointer<Byte> positions = function.Arg<2>();
+			Int count = function.Arg<3>();
+
+			Float4 c0 = *Pointer<Float4>(matrix + 0, 16);
+			Float4 c1 = *Pointer<Float4>(matrix + 16, 16);
+			Float4 c2 = *Pointer<Float4>(matrix + 32, 16);
+			Float4 c3 = *Pointer<Float4>(matrix + 48, 16);
+
+			For(Int i = 0, i < count, i++)
+			{
+				Float4 p = *Pointer<Float4>(positions + i * 16, 16);
+
+				Float4 r = c0 * p.xxxx;
+				r = FMA(c1, p.yyyy, r);
+				r = FMA(c2, p.zzzz, r);
+				r = FMA(c3, p.wwww, r);
+
+				*Pointer<Float4>(destination + i * 16, 16) = r;
+			}
+		}
+
+		return function(L"VertexBenchmark");
+	}
+
+	void *setupVertex(int items)
+	{
+		VertexArguments *arguments = new VertexArguments;
+		arguments->matrix.resize(16 + 4);
+		arguments->positions.resize(items * 4 + 4);
+		arguments->destination.resize(items * 4 + 4);
+
+		float *matrix = align16(arguments->matrix);
+
+		for(int i = 0; i < 16; i++)
+		{
+			matrix[i] = (i % 5 == 0) ? 1.0f : 0.125f * i;
+		}
+
+		float *positions = align16(arguments->positions);
+
+		for(int i = 0; i < items * 4; i++)
+		{
+			positions[i] = (i % 4 == 3) ? 1.0f : float(i % 17);
+		}
+
+		return arguments;
+	}
+
+	void runVertex(const void *entry, void *arguments, int items)
+	{
+		VertexArguments *vertex = (VertexArguments*)arguments;
+		void (*callable)(void*, void*, void*, int) = (void(*)(void*, void*, void*, int))entry;
+		callable(align16(vertex->destination), align16(vertex->matrix), align16(vertex->positions), items);
+	}
+
+	void teardownVertex(void *arguments)
+	{
+		delete (VertexArguments*)arguments;
+	}
+
+	const Benchmark benchmarks[] =
+	{
+		{"Blit",    generateBlit,    setupBlit,    runBlit,    teardownBlit},
+		{"Sampler", generateSampler, setupSampler, runSampler, teardownSampler},
+		{"Vertex",  generateVertex,  setupVertex,  runVertex,  teardownVertex},
+	};
+
+	const int itemsPerCall = 4096;   // Small enough to stay cache resident
+
+	bool runBenchmark(const Benchmark &benchmark, int compiles, double seconds)
+	{
+		std::vector<double> compileTimes;
+		Routine *routine = nullptr;
+
+		for(int i = 0; i < compiles; i++)
+		{
+			delete routine;
+
+			Clock::time_point start = Clock::now();
+			routine = benchmark.generate();
+			compileTimes.push_back(elapsedSeconds(start) * 1000.0);
+
+			if(!routine)
+			{
+				fprintf(stderr, "%s: failed to generate routine\n", benchmark.name);
+				return false;
+			}
+		}
+
+		std::sort(compileTimes.begin(), compileTimes.end());
+
+		const void *entry = routine->getEntry();
+		void *arguments = benchmark.setup(itemsPerCall);
+
+		benchmark.run(entry, arguments, itemsPerCall);   // Warm up
+
+		long long calls = 0;
+		Clock::time_point start = Clock::now();
+		double elapsed = 0.0;
+
+		do
+		{
+			for(int i = 0; i < 16; i++)
+			{
+				benchmark.run(entry, arguments, itemsPerCall);
+			}
+
+			calls += 16;
+			elapsed = elapsedSeconds(start);
+		}
+		while(elapsed < seconds);
+
+		benchmark.teardown(arguments);
+		delete routine;
+
+		double throughput = double(calls) * itemsPerCall / elapsed / 1.0e6;
+
+		printf("%s %s compile_ms=%.3f min_compile_ms=%.3f mitems_per_s=%.2f\n",
+		       REACTOR_BENCHMARK_BACKEND, benchmark.name,
+		       compileTimes[compileTimes.size() / 2], compileTimes[0], throughput);
+		fflush(stdout);
+
+		return true;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	const char *filter = nullptr;
+	int compiles = 10;
+	double seconds = 1.0;
+
+	for(int i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+		{
+			filter = argv[++i];
+		}
+		else if(strcmp(argv[i], "--compiles") == 0 && i + 1 < argc)
+		{
+			compiles = std::max(atoi(argv[++i]), 1);
+		}
+		else if(strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+		{
+			seconds = std::max(atof(argv[++i]), 0.0);
+		}
+		else
+		{
+			fprintf(stderr, "Usage: %s [--filter <substring>] [--compiles <count>] [--seconds <time>]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	bool success = true;
+
+	for(const Benchmark &benchmark : benchmarks)
+	{
+		if(filter && !strstr(benchmark.name, filter))
+		{
+			continue;
+		}
+
+		success &= runBenchmark(benchmark, compiles, seconds);
+	}
+
+	return success ? 0 : 1;
+}
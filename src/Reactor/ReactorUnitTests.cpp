@@ -13,9 +13,14 @@
 // limitations under the License.
 
 #include "Reactor.hpp"
+#include "Coroutine.hpp"
+#include "CPUID.hpp"
 
 #include "gtest/gtest.h"
 
+#include <atomic>
+#include <thread>
+
 using namespace rr;
 
 int reference(int *p, int y)
@@ -992,6 +997,462 @@ TEST(ReactorUnitTests, MulAdd)
 	delete routine;
 }
 
+TEST(ReactorUnitTests, FMA)
+{
+	Routine *routine = nullptr;
+
+	{
+		Function<Int(Pointer<Byte>)> function;
+		{
+			Pointer<Byte> out = function.Arg<0>();
+
+			*Pointer<Float4>(out + 16 * 0) =
+				FMA(Float4(1.0f, 2.0f, -3.0f, 0.5f),
+				    Float4(4.0f, -5.0f, 6.0f, 8.0f),
+				    Float4(0.25f, 1.0f, 2.0f, -4.0f));
+
+			Return(0);
+		}
+
+		routine = function(L"one");
+
+		if(routine)
+		{
+			float out[1][4];
+
+			memset(&out, 0, sizeof(out));
+
+			int(*callable)(void*) = (int(*)(void*))routine->getEntry();
+			callable(&out);
+
+			EXPECT_EQ(out[0][0], 4.25f);
+			EXPECT_EQ(out[0][1], -9.0f);
+			EXPECT_EQ(out[0][2], -16.0f);
+			EXPECT_EQ(out[0][3], 0.0f);
+		}
+	}
+
+	delete routine;
+}
+
+TEST(ReactorUnitTests, Gather)
+{
+	Routine *routine = nullptr;
+
+	{
+		Function<Int(Pointer<Byte>, Pointer<Byte>)> function;
+		{
+			Pointer<Byte> out = function.Arg<0>();
+			Pointer<Byte> in = function.Arg<1>();
+
+			*Pointer<Float4>(out + 16 * 0) = Gather(Pointer<Float>(in), Int4(12, 0, 28, 4));
+			*Pointer<Int4>(out + 16 * 1) = Gather(Pointer<Int>(in), Int4(4, 4, 20, 8));
+
+			Return(0);
+		}
+
+		routine = function(L"one");
+
+		if(routine)
+		{
+			float in[8] = {0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f};
+			int out[2][4];
+
+			memset(&out, 0, sizeof(out));
+
+			int(*callable)(void*, void*) = (int(*)(void*, void*))routine->getEntry();
+			callable(&out, in);
+
+			float outFloat[4];
+			memcpy(outFloat, out[0], sizeof(outFloat));
+
+			EXPECT_EQ(outFloat[0], 3.0f);
+			EXPECT_EQ(outFloat[1], 0.0f);
+			EXPECT_EQ(outFloat[2], 7.0f);
+			EXPECT_EQ(outFloat[3], 1.0f);
+
+			int inInt[8];
+			memcpy(inInt, in, sizeof(inInt));
+
+			EXPECT_EQ(out[1][0], inInt[1]);
+			EXPECT_EQ(out[1][1], inInt[1]);
+			EXPECT_EQ(out[1][2], inInt[5]);
+			EXPECT_EQ(out[1][3], inInt[2]);
+		}
+	}
+
+	delete routine;
+}
+
+TEST(ReactorUnitTests, MaskedStore)
+{
+	Routine *routine = nullptr;
+
+	{
+		Function<Int(Pointer<Byte>)> function;
+		{
+			Pointer<Byte> out = function.Arg<0>();
+
+			MaskedStore(Pointer<Float4>(out), Float4(1.0f, 2.0f, 3.0f, 4.0f), Int4(-1, 0, 0, -1));
+
+			Return(0);
+		}
+
+		routine = function(L"one");
+
+		if(routine)
+		{
+			alignas(16) float out[4] = {-1.0f, -2.0f, -3.0f, -4.0f};
+
+			int(*callable)(void*) = (int(*)(void*))routine->getEntry();
+			callable(out);
+
+			EXPECT_EQ(out[0], 1.0f);
+			EXPECT_EQ(out[1], -2.0f);
+			EXPECT_EQ(out[2], -3.0f);
+			EXPECT_EQ(out[3], 4.0f);
+		}
+	}
+
+	delete routine;
+}
+
+TEST(ReactorUnitTests, Prefetch)
+{
+	Routine *routine = nullptr;
+
+	{
+		Function<Int(Pointer<Byte>)> function;
+		{
+			Pointer<Byte> in = function.Arg<0>();
+
+			Prefetch(in + 64);   // Only a hint, the load must still see the data
+
+			Return(*Pointer<Int>(in + 64));
+		}
+
+		routine = function(L"one");
+
+		if(routine)
+		{
+			int in[32] = {};
+			in[16] = 7;
+
+			int(*callable)(void*) = (int(*)(void*))routine->getEntry();
+			int result = callable(in);
+
+			EXPECT_EQ(result, 7);
+		}
+	}
+
+	delete routine;
+}
+
+TEST(ReactorUnitTests, Coroutine)
+{
+	Routine *routine = nullptr;
+
+	{
+		Function<Void(Pointer<Byte>, Pointer<Int>)> function;
+		{
+			Pointer<Byte> coroutine = function.Arg<0>();
+			Pointer<Int> counter = function.Arg<1>();
+
+			For(Int i = 0, i < 3, i++)
+			{
+				*counter = *counter + i;
+				Yield(coroutine);
+			}
+
+			*counter = 100;
+		}
+
+		routine = function(L"one");
+
+		if(routine)
+		{
+			// Two coroutines interleaved on this thread keep their own state
+			int counter[2] = {0, 10};
+			Coroutine first(routine, &counter[0]);
+			Coroutine second(routine, &counter[1]);
+
+			EXPECT_TRUE(first.resume());
+			EXPECT_TRUE(second.resume());
+			EXPECT_TRUE(first.resume());
+			EXPECT_EQ(counter[0], 1);
+			EXPECT_EQ(counter[1], 10);
+
+			EXPECT_TRUE(second.resume());
+			EXPECT_TRUE(second.resume());
+			EXPECT_FALSE(second.resume());
+			EXPECT_TRUE(second.isFinished());
+			EXPECT_EQ(counter[1], 100);
+
+			EXPECT_TRUE(first.resume());
+			EXPECT_EQ(counter[0], 3);
+			EXPECT_FALSE(first.resume());
+			EXPECT_FALSE(first.resume());
+			EXPECT_EQ(counter[0], 100);
+		}
+	}
+
+	delete routine;
+}
+
+TEST(ReactorUnitTests, CPUIDEnableAVX)
+{
+	// Disabling an extension also disables the extensions which build on it
+	CPUID::setEnableAVX(false);
+	EXPECT_FALSE(CPUID::supportsAVX());
+	EXPECT_FALSE(CPUID::supportsAVX2());
+
+	// Enabling one enables its prerequisites, but never reports unsupported hardware
+	CPUID::setEnableAVX2(true);
+	EXPECT_TRUE(!CPUID::supportsAVX2() || CPUID::supportsAVX());
+	EXPECT_TRUE(!CPUID::supportsAVX() || CPUID::supportsSSE4_1());
+
+	CPUID::setEnableAVX(true);
+	CPUID::setEnableAVX2(true);
+	CPUID::setEnableFMA(true);
+	CPUID::setEnableF16C(true);
+}
+
+TEST(ReactorUnitTests, CPUIDEnableFMA)
+{
+	// FMA is encoded with VEX prefixes, so it can't be used without AVX
+	CPUID::setEnableAVX(false);
+	EXPECT_FALSE(CPUID::supportsFMA());
+
+	CPUID::setEnableFMA(true);
+	EXPECT_TRUE(!CPUID::supportsFMA() || CPUID::supportsAVX());
+
+	CPUID::setEnableFMA(false);
+	EXPECT_FALSE(CPUID::supportsFMA());
+
+	CPUID::setEnableAVX(true);
+	CPUID::setEnableAVX2(true);
+	CPUID::setEnableFMA(true);
+	CPUID::setEnableF16C(true);
+}
+
+TEST(ReactorUnitTests, GlobalOptimizationHoisting)
+{
+	Routine *routine = nullptr;
+	Nucleus::setGlobalOptimizationEnabled(true);
+
+	{
+		Function<Void(Pointer<Int>, Int, Int)> function;
+		{
+			Pointer<Int> out = function.Arg<0>();
+			Int a = function.Arg<1>();
+			Int b = function.Arg<2>();
+
+			// Loop invariant, and computed again in a block dominated by the first computation
+			Int c = a * b + 3;
+
+			For(Int i = 0, i < 4, i++)
+			{
+				out[i] = (a * b + 3) + i;
+			}
+
+			If(a > 0)
+			{
+				out[4] = a * b + 3 - c;
+			}
+		}
+
+		routine = function(L"one");
+
+		if(routine)
+		{
+			int out[5] = {-1, -1, -1, -1, -1};
+			auto callable = (void(*)(int*, int, int))routine->getEntry();
+			callable(out, 2, 5);
+
+			EXPECT_EQ(out[0], 13);
+			EXPECT_EQ(out[1], 14);
+			EXPECT_EQ(out[2], 15);
+			EXPECT_EQ(out[3], 16);
+			EXPECT_EQ(out[4], 0);
+		}
+	}
+
+	Nucleus::setGlobalOptimizationEnabled(false);
+	delete routine;
+}
+
+TEST(ReactorUnitTests, GlobalOptimizationStoreBlocksHoisting)
+{
+	Routine *routine = nullptr;
+	Nucleus::setGlobalOptimizationEnabled(true);
+
+	{
+		Function<Void(Pointer<Int>, Pointer<Int>, Pointer<Int>)> function;
+		{
+			Pointer<Int> out = function.Arg<0>();
+			Pointer<Int> p = function.Arg<1>();
+			Pointer<Int> q = function.Arg<2>();
+
+			// Both pointers address the same integer, so the load of q changes every iteration
+			For(Int i = 0, i < 4, i++)
+			{
+				out[i] = *q;
+				*p = *p + 1;
+			}
+		}
+
+		routine = function(L"one");
+
+		if(routine)
+		{
+			int out[4] = {-1, -1, -1, -1};
+			int x = 10;
+			auto callable = (void(*)(int*, int*, int*))routine->getEntry();
+			callable(out, &x, &x);
+
+			EXPECT_EQ(out[0], 10);
+			EXPECT_EQ(out[1], 11);
+			EXPECT_EQ(out[2], 12);
+			EXPECT_EQ(out[3], 13);
+			EXPECT_EQ(x, 14);
+		}
+	}
+
+	Nucleus::setGlobalOptimizationEnabled(false);
+	delete routine;
+}
+
+static void increment(void *counter)
+{
+	(*static_cast<int*>(counter))++;
+}
+
+TEST(ReactorUnitTests, GlobalOptimizationCallBlocksHoisting)
+{
+	Routine *routine = nullptr;
+	Nucleus::setGlobalOptimizationEnabled(true);
+
+	{
+		Function<Void(Pointer<Int>, Pointer<Byte>)> function;
+		{
+			Pointer<Int> out = function.Arg<0>();
+			Pointer<Byte> counter = function.Arg<1>();
+
+			// The call writes the counter behind the routine's back, neither the load nor the call may move
+			For(Int i = 0, i < 4, i++)
+			{
+				Nucleus::createCall(increment, RValue<Pointer<Byte>>(counter).value);
+				out[i] = *Pointer<Int>(counter) + *Pointer<Int>(counter);
+			}
+		}
+
+		routine = function(L"one");
+
+		if(routine)
+		{
+			int out[4] = {-1, -1, -1, -1};
+			int counter = 0;
+			auto callable = (void(*)(int*, int*))routine->getEntry();
+			callable(out, &counter);
+
+			EXPECT_EQ(out[0], 2);
+			EXPECT_EQ(out[1], 4);
+			EXPECT_EQ(out[2], 6);
+			EXPECT_EQ(out[3], 8);
+			EXPECT_EQ(counter, 4);
+		}
+	}
+
+	Nucleus::setGlobalOptimizationEnabled(false);
+	delete routine;
+}
+
+static int sumBelow(RoutineCategory category, int n)
+{
+	Routine *routine = nullptr;
+	int result = -1;
+
+	{
+		Function<Int(Int)> function;
+		{
+			Int x = function.Arg<0>();
+			Int sum = 0;
+
+			For(Int i = 0, i < x, i++)
+			{
+				sum += i;
+			}
+
+			Return(sum);
+		}
+
+		Nucleus::setRoutineCategory(category);
+		routine = function(L"one");
+
+		if(routine)
+		{
+			auto callable = (int(*)(int))routine->getEntry();
+			result = callable(n);
+		}
+	}
+
+	delete routine;
+
+	return result;
+}
+
+TEST(ReactorUnitTests, CategoryOptimizationPasses)
+{
+	// Changing the passes of a category replaces the pipeline its routines get compiled with
+	const Optimization passes[][10] =
+	{
+		{Disabled},
+		{InstructionCombining, CFGSimplification, Disabled},
+		{ScalarReplAggregates, GVN, LICM, AggressiveDCE, Reassociate, DeadStoreElimination, SCCP, Disabled},
+	};
+
+	for(const auto &categoryPasses : passes)
+	{
+		for(int category = RoutineGeneric; category < RoutineCategoryCount; category++)
+		{
+			Nucleus::setOptimizationPasses((RoutineCategory)category, categoryPasses);
+			EXPECT_EQ(sumBelow((RoutineCategory)category, 10), 45);
+		}
+	}
+
+	for(int category = RoutineGeneric; category < RoutineCategoryCount; category++)
+	{
+		Nucleus::setOptimizationPasses((RoutineCategory)category, nullptr);
+		EXPECT_EQ(sumBelow((RoutineCategory)category, 10), 45);
+	}
+}
+
+TEST(ReactorUnitTests, CategoryOptimizationPassesConcurrentChange)
+{
+	const Optimization few[10] = {InstructionCombining, Disabled};
+	const Optimization many[10] = {InstructionCombining, CFGSimplification, GVN, LICM, AggressiveDCE, Disabled};
+
+	std::atomic<bool> compiling(true);
+
+	std::thread configuration([&compiling, &few, &many]()
+	{
+		for(int i = 0; compiling; i++)
+		{
+			Nucleus::setOptimizationPasses(RoutinePixel, (i % 3 == 2) ? nullptr : (i % 3 == 1) ? many : few);
+		}
+	});
+
+	for(int i = 0; i < 16; i++)
+	{
+		EXPECT_EQ(sumBelow(RoutinePixel, i), i * (i - 1) / 2);
+	}
+
+	compiling = false;
+	configuration.join();
+
+	Nucleus::setOptimizationPasses(RoutinePixel, nullptr);
+}
+
 int main(int argc, char **argv)
 {
 	::testing::InitGoogleTest(&argc, argv);
@@ -16,7 +16,18 @@
 
 #include "Thread.hpp"
 
+#include <atomic>
 #include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
 
 namespace rr
 {
@@ -40,8 +51,239 @@ namespace rr
 		}
 	}
 
+	bool Routine::getImage(const void *&image, size_t &size)
+	{
+		return false;
+	}
+
 	Routine::~Routine()
 	{
 		assert(bindCount == 0);
 	}
+
+	namespace
+	{
+		struct SharedCode
+		{
+			Routine *routine;
+			std::vector<CodeSpan> spans;
+			std::vector<unsigned char> bytes;   // Copy of the spans, when they can change
+			int users;
+		};
+
+		std::mutex sharedCodeMutex;
+		std::unordered_multimap<uint64_t, SharedCode*> sharedCodes;   // By hash of the spans
+		std::atomic<uint64_t> sharedRoutineCount(0);
+
+		uint64_t hashSpans(const std::vector<CodeSpan> &spans)
+		{
+			uint64_t hash = 0xCBF29CE484222325ull;
+
+			for(const CodeSpan &span : spans)
+			{
+				const unsigned char *bytes = static_cast<const unsigned char*>(span.data);
+
+				for(size_t i = 0; i < span.size; i++)
+				{
+					hash = (hash ^ bytes[i]) * 0x100000001B3ull;   // FNV-1a
+				}
+
+				hash = (hash ^ span.size) * 0x100000001B3ull;
+			}
+
+			return hash;
+		}
+
+		bool identicalSpans(const std::vector<CodeSpan> &a, const std::vector<CodeSpan> &b)
+		{
+			if(a.size() != b.size())
+			{
+				return false;
+			}
+
+			for(size_t i = 0; i < a.size(); i++)
+			{
+				if(a[i].size != b[i].size || memcmp(a[i].data, b[i].data, a[i].size) != 0)
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		// One reference to code which may be shared by several cache entries
+		class SharedRoutine : public Routine
+		{
+		public:
+			SharedRoutine(SharedCode *code, uint64_t hash) : code(code), hash(hash)
+			{
+			}
+
+			~SharedRoutine() override
+			{
+				Routine *last = nullptr;
+
+				{
+					std::lock_guard<std::mutex> lock(sharedCodeMutex);
+
+					if(--code->users == 0)
+					{
+						auto range = sharedCodes.equal_range(hash);
+
+						for(auto it = range.first; it != range.second; ++it)
+						{
+							if(it->second == code)
+							{
+								sharedCodes.erase(it);
+								break;
+							}
+						}
+
+						last = code->routine;
+						delete code;
+					}
+				}
+
+				delete last;   // Frees the executable memory, outside of the lock
+			}
+
+			const void *getEntry() override
+			{
+				return code->routine->getEntry();
+			}
+
+			bool getImage(const void *&image, size_t &size) override
+			{
+				return code->routine->getImage(image, size);
+			}
+
+		private:
+			SharedCode *const code;
+			const uint64_t hash;
+		};
+	}
+
+	Routine *shareIdenticalRoutine(Routine *routine, const std::vector<CodeSpan> &spans, bool copySpans)
+	{
+		if(!routine || spans.empty())
+		{
+			return routine;
+		}
+
+		uint64_t hash = hashSpans(spans);
+
+		std::lock_guard<std::mutex> lock(sharedCodeMutex);
+
+		auto range = sharedCodes.equal_range(hash);
+
+		for(auto it = range.first; it != range.second; ++it)
+		{
+			SharedCode *code = it->second;
+
+			if(identicalSpans(code->spans, spans))
+			{
+				code->users++;
+				sharedRoutineCount++;
+				delete routine;
+
+				return new SharedRoutine(code, hash);
+			}
+		}
+
+		SharedCode *code = new SharedCode{routine, spans, {}, 1};
+
+		if(copySpans)
+		{
+			for(const CodeSpan &span : spans)
+			{
+				const unsigned char *bytes = static_cast<const unsigned char*>(span.data);
+				code->bytes.insert(code->bytes.end(), bytes, bytes + span.size);
+			}
+
+			size_t offset = 0;
+
+			for(CodeSpan &span : code->spans)
+			{
+				span.data = code->bytes.data() + offset;
+				offset += span.size;
+			}
+		}
+
+		sharedCodes.insert({hash, code});
+
+		return new SharedRoutine(code, hash);
+	}
+
+	bool isPerfMapEnabled()
+	{
+		#if defined(__linux__)
+			static const bool enabled = getenv("SWIFTSHADER_PERF_MAP") != nullptr;
+			return enabled;
+		#else
+			return false;
+		#endif
+	}
+
+	void writePerfMapEntry(const void *code, size_t size, const char *name)
+	{
+		#if defined(__linux__)
+			if(!isPerfMapEnabled() || !code)
+			{
+				return;
+			}
+
+			static std::mutex mutex;   // Routines are compiled on several threads
+			std::lock_guard<std::mutex> lock(mutex);
+
+			static FILE *file = nullptr;
+			if(!file)
+			{
+				char path[64];
+				snprintf(path, sizeof(path), "/tmp/perf-%d.map", (int)getpid());
+				file = fopen(path, "a");
+
+				if(!file)
+				{
+					return;
+				}
+			}
+
+			// The format is "<start> <size> <symbol>", with hexadecimal start and size.
+			fprintf(file, "%lx %lx %s\n", (unsigned long)(uintptr_t)code, (unsigned long)size, name);
+			fflush(file);   // The profiler may read the file while we're still running
+		#endif
+	}
+
+	namespace
+	{
+		std::atomic<uint64_t> routineCount(0);
+		std::atomic<uint64_t> instructionCount(0);
+		std::atomic<uint64_t> codeByteCount(0);
+		std::atomic<uint64_t> compileMicroseconds(0);
+		std::atomic<uint64_t> optimizeMicroseconds(0);
+	}
+
+	CompilerStatistics getCompilerStatistics()
+	{
+		CompilerStatistics statistics;
+
+		statistics.routines = routineCount;
+		statistics.instructions = instructionCount;
+		statistics.codeBytes = codeByteCount;
+		statistics.compileMicroseconds = compileMicroseconds;
+		statistics.optimizeMicroseconds = optimizeMicroseconds;
+		statistics.sharedRoutines = sharedRoutineCount;
+
+		return statistics;
+	}
+
+	void recordCompilation(uint64_t instructions, uint64_t codeBytes, uint64_t compileTime, uint64_t optimizeTime)
+	{
+		routineCount++;
+		instructionCount += instructions;
+		codeByteCount += codeBytes;
+		compileMicroseconds += compileTime;
+		optimizeMicroseconds += optimizeTime;
+	}
 }
@@ -15,6 +15,10 @@
 #ifndef rr_Routine_hpp
 #define rr_Routine_hpp
 
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
 namespace rr
 {
 	class Routine
@@ -26,6 +30,10 @@ namespace rr
 
 		virtual const void *getEntry() = 0;
 
+		// Unrelocated image of the code, which Nucleus::loadRoutine() accepts.
+		// Not available on all backends, nor after getEntry() has been called.
+		virtual bool getImage(const void *&image, size_t &size);
+
 		// Reference counting
 		void bind();
 		void unbind();
@@ -33,6 +41,40 @@ namespace rr
 	private:
 		volatile int bindCount;
 	};
+
+	// Code deduplication. Routines generated from different keys are often
+	// identical. The returned routine shares the executable memory of a live
+	// routine with byte-identical spans, in which case the given routine is
+	// deleted, or else becomes the shared copy. Spans must cover everything
+	// the code depends on, including its constants. They must remain unchanged
+	// while the routine lives, unless copySpans is set.
+	struct CodeSpan
+	{
+		const void *data;
+		size_t size;
+	};
+
+	Routine *shareIdenticalRoutine(Routine *routine, const std::vector<CodeSpan> &spans, bool copySpans = false);
+
+	// Profiler support. When the SWIFTSHADER_PERF_MAP environment variable is set, the
+	// location of each routine's code is appended to /tmp/perf-<pid>.map, which perf
+	// and other Linux profilers use to symbolize JIT-compiled code.
+	bool isPerfMapEnabled();
+	void writePerfMapEntry(const void *code, size_t size, const char *name);
+
+	// Compiler instrumentation, accumulated over all routines compiled by the process.
+	struct CompilerStatistics
+	{
+		uint64_t routines;
+		uint64_t instructions;           // Intermediate representation, before optimization
+		uint64_t codeBytes;              // Size of the generated images
+		uint64_t compileMicroseconds;    // Time spent in Nucleus::acquireRoutine()
+		uint64_t optimizeMicroseconds;   // Part of the above spent in optimization passes
+		uint64_t sharedRoutines;         // Compiled routines which were identical to a live one, and share its code
+	};
+
+	CompilerStatistics getCompilerStatistics();
+	void recordCompilation(uint64_t instructions, uint64_t codeBytes, uint64_t compileMicroseconds, uint64_t optimizeMicroseconds);
 }
 
 #endif   // rr_Routine_hpp
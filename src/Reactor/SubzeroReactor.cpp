@@ -48,6 +48,7 @@
 #endif
 #endif
 
+#include <chrono>
 #include <mutex>
 #include <limits>
 #include <iostream>
@@ -55,16 +56,23 @@
 
 namespace
 {
-	Ice::GlobalContext *context = nullptr;
-	Ice::Cfg *function = nullptr;
-	Ice::CfgNode *basicBlock = nullptr;
-	Ice::CfgLocalAllocatorScope *allocator = nullptr;
-	rr::Routine *routine = nullptr;
-
-	std::mutex codegenMutex;
-
-	Ice::ELFFileStreamer *elfFile = nullptr;
-	Ice::Fdstream *out = nullptr;
+	// Each thread builds its own routine, so several can be compiled at once.
+	// Subzero keeps its own per-thread state in thread-local storage as well.
+	thread_local Ice::GlobalContext *context = nullptr;
+	thread_local Ice::Cfg *function = nullptr;
+	thread_local Ice::CfgNode *basicBlock = nullptr;
+	thread_local Ice::CfgLocalAllocatorScope *allocator = nullptr;
+	thread_local rr::Routine *routine = nullptr;
+
+	std::once_flag flagsInitialized;
+	thread_local bool optimizationEnabled = true;
+	thread_local bool globalOptimizationEnabled = false;
+	unsigned int cpuFeatures = rr::CPU_ALL;
+
+	thread_local Ice::ELFFileStreamer *elfFile = nullptr;
+	thread_local Ice::Fdstream *out = nullptr;
+	thread_local llvm::raw_os_ostream *dumpStream = nullptr;   // Subzero's dump and error streams, one per compile
+	thread_local llvm::raw_os_ostream *errorStream = nullptr;
 }
 
 namespace
@@ -445,7 +453,7 @@ namespace rr
 		ELFMemoryStreamer &operator=(const ELFMemoryStreamer &) = delete;
 
 	public:
-		ELFMemoryStreamer() : Routine(), entry(nullptr)
+		ELFMemoryStreamer() : Routine(), entry(nullptr), name("Routine"), persistent(true)
 		{
 			position = 0;
 			buffer.reserve(0x1000);
@@ -497,6 +505,7 @@ namespace rr
 
 				size_t codeSize = 0;
 				entry = loadImage(&buffer[0], codeSize);
+				writePerfMapEntry(entry, codeSize, name.c_str());
 
 				#if defined(_WIN32)
 					VirtualProtect(&buffer[0], buffer.size(), PAGE_EXECUTE_READ, &oldProtection);
@@ -510,57 +519,101 @@ namespace rr
 			return entry;
 		}
 
+		bool getImage(const void *&image, size_t &size) override
+		{
+			if(entry || buffer.empty() || !persistent)
+			{
+				return false;   // Already relocated in place
+			}
+
+			image = &buffer[0];
+			size = buffer.size();
+
+			return true;
+		}
+
+		void setName(const std::string &routineName)
+		{
+			name = routineName;
+		}
+
+		void setPersistent(bool persistent)
+		{
+			this->persistent = persistent;
+		}
+
+		size_t getImageSize() const
+		{
+			return buffer.size();
+		}
+
 	private:
 		void *entry;
 		std::vector<uint8_t, ExecutableAllocator<uint8_t>> buffer;
 		std::size_t position;
+		std::string name;   // For profilers
+		bool persistent;    // No host addresses in the image
 
 		#if defined(_WIN32)
 		DWORD oldProtection;
 		#endif
 	};
 
-	Nucleus::Nucleus()
+	static void createContext()
 	{
-		::codegenMutex.lock();   // Reactor is currently not thread safe
-
-		Ice::ClFlags &Flags = Ice::ClFlags::Flags;
-		Ice::ClFlags::getParsedClFlags(Flags);
-
-		#if defined(__arm__)
-			Flags.setTargetArch(Ice::Target_ARM32);
-			Flags.setTargetInstructionSet(Ice::ARM32InstructionSet_HWDivArm);
-		#elif defined(__mips__)
-			Flags.setTargetArch(Ice::Target_MIPS32);
-			Flags.setTargetInstructionSet(Ice::BaseInstructionSet);
-		#else   // x86
-			Flags.setTargetArch(sizeof(void*) == 8 ? Ice::Target_X8664 : Ice::Target_X8632);
-			Flags.setTargetInstructionSet(CPUID::SSE4_1 ? Ice::X86InstructionSet_SSE4_1 : Ice::X86InstructionSet_SSE2);
-		#endif
-		Flags.setOutFileType(Ice::FT_Elf);
-		Flags.setOptLevel(Ice::Opt_2);
-		Flags.setApplicationBinaryInterface(Ice::ABI_Platform);
-		Flags.setVerbose(false ? Ice::IceV_Most : Ice::IceV_None);
-		Flags.setDisableHybridAssembly(true);
-
-		static llvm::raw_os_ostream cout(std::cout);
-		static llvm::raw_os_ostream cerr(std::cerr);
+		::dumpStream = new llvm::raw_os_ostream(std::cout);
+		::errorStream = new llvm::raw_os_ostream(std::cerr);
 
 		if(false)   // Write out to a file
 		{
 			std::error_code errorCode;
 			::out = new Ice::Fdstream("out.o", errorCode, llvm::sys::fs::F_None);
 			::elfFile = new Ice::ELFFileStreamer(*out);
-			::context = new Ice::GlobalContext(&cout, &cout, &cerr, elfFile);
+			::context = new Ice::GlobalContext(::dumpStream, ::dumpStream, ::errorStream, elfFile);
 		}
 		else
 		{
 			ELFMemoryStreamer *elfMemory = new ELFMemoryStreamer();
-			::context = new Ice::GlobalContext(&cout, &cout, &cerr, elfMemory);
+			::context = new Ice::GlobalContext(::dumpStream, ::dumpStream, ::errorStream, elfMemory);
 			::routine = elfMemory;
 		}
 	}
 
+	Nucleus::Nucleus()
+	{
+		// The flags are global to Subzero and identical for every routine
+		std::call_once(::flagsInitialized, []()
+		{
+			Ice::ClFlags &Flags = Ice::ClFlags::Flags;
+			Ice::ClFlags::getParsedClFlags(Flags);
+
+			#if defined(__arm__)
+				Flags.setTargetArch(Ice::Target_ARM32);
+				Flags.setTargetInstructionSet(Ice::ARM32InstructionSet_HWDivArm);
+			#elif defined(__mips__)
+				Flags.setTargetArch(Ice::Target_MIPS32);
+				Flags.setTargetInstructionSet(Ice::BaseInstructionSet);
+			#else   // x86
+				Flags.setTargetArch(sizeof(void*) == 8 ? Ice::Target_X8664 : Ice::Target_X8632);
+				Flags.setTargetInstructionSet((rr::Nucleus::getCPUFeatures() & rr::CPU_SSE4_1) ? Ice::X86InstructionSet_SSE4_1 : Ice::X86InstructionSet_SSE2);
+			#endif
+			Flags.setOutFileType(Ice::FT_Elf);
+			Flags.setOptLevel(Ice::Opt_2);
+			Flags.setApplicationBinaryInterface(Ice::ABI_Platform);
+			Flags.setVerbose(false ? Ice::IceV_Most : Ice::IceV_None);
+			Flags.setDisableHybridAssembly(true);
+
+			// The first context runs the target's static initialization, which other
+			// threads must not race with, so it's created before any other one.
+			createContext();
+		});
+
+		if(!::context)
+		{
+			createContext();
+		}
+	}
+
 	Nucleus::~Nucleus()
 	{
 		delete ::routine;
@@ -572,7 +625,18 @@ namespace rr
 		delete ::elfFile;
 		delete ::out;
 
-		::codegenMutex.unlock();
+		delete ::dumpStream;
+		delete ::errorStream;
+
+		::routine = nullptr;
+		::allocator = nullptr;
+		::function = nullptr;
+		::basicBlock = nullptr;
+		::context = nullptr;
+		::elfFile = nullptr;
+		::out = nullptr;
+		::dumpStream = nullptr;
+		::errorStream = nullptr;
 	}
 
 	Routine *Nucleus::acquireRoutine(const wchar_t *name, bool runOptimizations)
@@ -582,11 +646,29 @@ namespace rr
 			createRetVoid();
 		}
 
+		auto start = std::chrono::steady_clock::now();
+
 		std::wstring wideName(name);
 		std::string asciiName(wideName.begin(), wideName.end());
 		::function->setFunctionName(Ice::GlobalString::createWithString(::context, asciiName));
 
-		optimize();
+		uint64_t instructionCount = 0;
+		for(Ice::CfgNode *basicBlock : ::function->getNodes())
+		{
+			for(Ice::Inst &instruction : basicBlock->getInsts())
+			{
+				instructionCount += instruction.isDeleted() ? 0 : 1;
+			}
+		}
+
+		auto optimizeStart = std::chrono::steady_clock::now();
+
+		if(runOptimizations && ::optimizationEnabled)
+		{
+			optimize();
+		}
+
+		auto optimizeEnd = std::chrono::steady_clock::now();
 
 		::function->translate();
 		assert(!::function->hasError());
@@ -613,12 +695,90 @@ namespace rr
 		Routine *handoffRoutine = ::routine;
 		::routine = nullptr;
 
-		return handoffRoutine;
+		size_t imageSize = 0;
+		std::vector<CodeSpan> imageSpans;
+
+		if(handoffRoutine)
+		{
+			static_cast<ELFMemoryStreamer*>(handoffRoutine)->setName(asciiName);
+			imageSize = static_cast<ELFMemoryStreamer*>(handoffRoutine)->getImageSize();
+
+			const void *image = nullptr;
+			size_t size = 0;
+			if(handoffRoutine->getImage(image, size))
+			{
+				imageSpans.push_back({image, size});
+			}
+		}
+
+		auto end = std::chrono::steady_clock::now();
+		recordCompilation(instructionCount, imageSize,
+		                  std::chrono::duration_cast<std::chrono::microseconds>(end - start).count(),
+		                  std::chrono::duration_cast<std::chrono::microseconds>(optimizeEnd - optimizeStart).count());
+
+		// The image gets relocated in place when it's loaded, so it's compared before then
+		return shareIdenticalRoutine(handoffRoutine, imageSpans, true);
+	}
+
+	void Nucleus::setOptimizationEnabled(bool enabled)
+	{
+		::optimizationEnabled = enabled;
+	}
+
+	bool Nucleus::isOptimizationEnabled()
+	{
+		return ::optimizationEnabled;
+	}
+
+	void Nucleus::setGlobalOptimizationEnabled(bool enabled)
+	{
+		::globalOptimizationEnabled = enabled;
+	}
+
+	bool Nucleus::isGlobalOptimizationEnabled()
+	{
+		return ::globalOptimizationEnabled;
+	}
+
+	// Subzero runs the same passes for all routines
+	void Nucleus::setOptimizationPasses(RoutineCategory category, const Optimization passes[10])
+	{
+	}
+
+	const Optimization *Nucleus::getOptimizationPasses(RoutineCategory category)
+	{
+		return optimization;
+	}
+
+	void Nucleus::setRoutineCategory(RoutineCategory category)
+	{
+	}
+
+	void Nucleus::setCPUFeatures(unsigned int enabled)
+	{
+		::cpuFeatures = enabled;
+	}
+
+	unsigned int Nucleus::getCPUFeatures()
+	{
+		// Subzero only distinguishes between SSE2 and SSE4.1 targets
+		unsigned int supported = CPUID::ARM ? 0 : CPUID::SSE4_1 ? (CPU_SSE2 | CPU_SSE3 | CPU_SSSE3 | CPU_SSE4_1) : CPU_SSE2;
+		unsigned int features = supported & ::cpuFeatures;
+
+		return (features & CPU_SSE4_1) == CPU_SSE4_1 ? features : (features & CPU_SSE2);
+	}
+
+	Routine *Nucleus::loadRoutine(const void *image, size_t size)
+	{
+		ELFMemoryStreamer *routine = new ELFMemoryStreamer();
+		routine->writeBytes(llvm::StringRef(static_cast<const char*>(image), size));
+
+		return routine;
 	}
 
 	void Nucleus::optimize()
 	{
-		rr::optimize(::function);
+		rr::optimize(::function, ::globalOptimizationEnabled);
 	}
 
 	Value *Nucleus::allocateStackVariable(Type *t, int arraySize)
@@ -1291,6 +1451,25 @@ namespace rr
 		::basicBlock->appendInst(unreachable);
 	}
 
+	void Nucleus::createCall(void (*function)(void*), Value *argument)
+	{
+		// Called through a register, which doesn't need a relocation
+		Ice::Type pointerType = sizeof(void*) == 8 ? Ice::IceType_i64 : Ice::IceType_i32;
+		Ice::Variable *callee = ::function->makeVariable(pointerType);
+		auto assign = Ice::InstAssign::create(::function, callee, ::context->getConstantInt(pointerType, reinterpret_cast<intptr_t>(function)));
+		::basicBlock->appendInst(assign);
+
+		auto call = Ice::InstCall::create(::function, 1, nullptr, callee, false);
+		call->addArg(argument);
+		::basicBlock->appendInst(call);
+
+		// The image embeds the host address, so it can't be loaded by another process
+		if(::routine)
+		{
+			static_cast<ELFMemoryStreamer*>(::routine)->setPersistent(false);
+		}
+	}
+
 	static Value *createSwizzle4(Value *val, unsigned char select)
 	{
 		int swizzle[4] =
@@ -6886,6 +7065,11 @@ namespace rr
 		}
 	}
 
+	RValue<Float4> FMA(RValue<Float4> x, RValue<Float4> y, RValue<Float4> z)
+	{
+		return x * y + z;   // Subzero doesn't emit FMA instructions
+	}
+
 	RValue<Float4> Insert(RValue<Float4> x, RValue<Float> element, int i)
 	{
 		return RValue<Float4>(Nucleus::createInsertElement(x.value, element.value, i));
@@ -7165,6 +7349,45 @@ namespace rr
 		return lhs = lhs - offset;
 	}
 
+	RValue<Float4> Gather(RValue<Pointer<Float>> base, RValue<Int4> offsets)
+	{
+		Pointer<Byte> address = base;
+
+		Float4 result;
+		result = Insert(result, *Pointer<Float>(address + Extract(offsets, 0)), 0);
+		result = Insert(result, *Pointer<Float>(address + Extract(offsets, 1)), 1);
+		result = Insert(result, *Pointer<Float>(address + Extract(offsets, 2)), 2);
+		result = Insert(result, *Pointer<Float>(address + Extract(offsets, 3)), 3);
+
+		return result;
+	}
+
+	RValue<Int4> Gather(RValue<Pointer<Int>> base, RValue<Int4> offsets)
+	{
+		Pointer<Byte> address = base;
+
+		Int4 result;
+		result = Insert(result, *Pointer<Int>(address + Extract(offsets, 0)), 0);
+		result = Insert(result, *Pointer<Int>(address + Extract(offsets, 1)), 1);
+		result = Insert(result, *Pointer<Int>(address + Extract(offsets, 2)), 2);
+		result = Insert(result, *Pointer<Int>(address + Extract(offsets, 3)), 3);
+
+		return result;
+	}
+
+	void MaskedStore(RValue<Pointer<Float4>> base, RValue<Float4> val, RValue<Int4> mask, unsigned int alignment)
+	{
+		Pointer<Float4> pointer(base, alignment);
+
+		Int4 previous = As<Int4>(Float4(*pointer));
+		*pointer = As<Float4>((As<Int4>(val) & mask) | (previous & ~mask));
+	}
+
+	void Prefetch(RValue<Pointer<Byte>> address)
+	{
+		// Subzero doesn't emit prefetch instructions
+	}
+
 	void Return()
 	{
 		Nucleus::createRetVoid();
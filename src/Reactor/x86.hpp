@@ -103,6 +103,9 @@ namespace rr
 		RValue<Int4> pmovsxbd(RValue<SByte16> x);
 		RValue<Int4> pmovzxwd(RValue<UShort8> x);
 		RValue<Int4> pmovsxwd(RValue<Short8> x);
+
+		RValue<Float4> gatherdps(RValue<Pointer<Float>> base, RValue<Int4> offsets);   // AVX2
+		RValue<Int4> gatherdd(RValue<Pointer<Int>> base, RValue<Int4> offsets);        // AVX2
 	}
 }
 
@@ -14,8 +14,10 @@
 
 #include "Blitter.hpp"
 
+#include "RoutineStatistics.hpp"
 #include "Shader/ShaderCore.hpp"
 #include "Reactor/Reactor.hpp"
+#include "Common/Math.hpp"
 #include "Common/Memory.hpp"
 #include "Common/Debug.hpp"
 
@@ -25,12 +27,166 @@ namespace sw
 
 	Blitter::Blitter()
 	{
-		blitCache = new RoutineCache<State>(1024);
+		blitCache = RoutineCache<State>::acquire(1024, "blit");
+
+		threadCount = 1;
+		workerCount = 0;
+		worker = nullptr;
+		resume = nullptr;
+		suspend = nullptr;
+		band = nullptr;
+
+		exitThreads = false;
+		bandFunction = nullptr;
 	}
 
 	Blitter::~Blitter()
 	{
-		delete blitCache;
+		terminateThreads();
+
+		blitCache->release();
+	}
+
+	void Blitter::setThreadCount(int count)
+	{
+		count = max(count, 1);   // Follows the renderer's thread count, which has no upper limit
+
+		bandMutex.lock();
+
+		if(count != threadCount)
+		{
+			terminateThreads();
+			threadCount = count;
+		}
+
+		bandMutex.unlock();
+	}
+
+	void Blitter::initializeThreads()
+	{
+		workerCount = threadCount;
+		worker = new Thread*[workerCount];
+		resume = new Event*[workerCount];
+		suspend = new Event*[workerCount];
+		band = new BlitData[workerCount];
+
+		// Band 0 is processed by the calling thread
+		worker[0] = nullptr;
+		resume[0] = nullptr;
+		suspend[0] = nullptr;
+
+		for(int i = 1; i < workerCount; i++)
+		{
+			resume[i] = new Event();
+			suspend[i] = new Event();
+
+			Parameters parameters;
+			parameters.blitter = this;
+			parameters.threadIndex = i;
+
+			worker[i] = new Thread(threadFunction, &parameters);
+
+			suspend[i]->wait();
+		}
+	}
+
+	void Blitter::terminateThreads()
+	{
+		exitThreads = true;
+
+		for(int i = 1; i < workerCount; i++)
+		{
+			resume[i]->signal();
+			worker[i]->join();
+
+			delete worker[i];
+			delete resume[i];
+			delete suspend[i];
+		}
+
+		delete[] worker;
+		delete[] resume;
+		delete[] suspend;
+		delete[] band;
+
+		worker = nullptr;
+		resume = nullptr;
+		suspend = nullptr;
+		band = nullptr;
+		workerCount = 0;
+
+		exitThreads = false;
+	}
+
+	void Blitter::threadFunction(void *parameters)
+	{
+		Blitter *blitter = static_cast<Parameters*>(parameters)->blitter;
+		int threadIndex = static_cast<Parameters*>(parameters)->threadIndex;
+
+		blitter->suspend[threadIndex]->signal();   // Parameters have been read
+
+		while(true)
+		{
+			blitter->resume[threadIndex]->wait();
+
+			if(blitter->exitThreads)
+			{
+				return;
+			}
+
+			blitter->bandFunction(&blitter->band[threadIndex]);
+			blitter->suspend[threadIndex]->signal();
+		}
+	}
+
+	void Blitter::execute(void (*blitFunction)(const BlitData *data), const BlitData &data, bool parallel)
+	{
+		const int minimumBandPixels = 64 * 1024;   // Smaller blits are not worth waking up threads for
+
+		int rows = data.y1d - data.y0d;
+		int pixels = (data.x1d - data.x0d) * rows;
+		int bandCount = parallel ? min(min(threadCount, pixels / minimumBandPixels), rows / 2) : 1;
+
+		if(bandCount <= 1)
+		{
+			blitFunction(&data);
+
+			return;
+		}
+
+		bandMutex.lock();
+
+		bandCount = min(bandCount, threadCount);   // May have changed while waiting for the lock
+
+		if(workerCount < bandCount)
+		{
+			terminateThreads();
+			initializeThreads();
+		}
+
+		bandFunction = blitFunction;
+
+		for(int i = 0; i < bandCount; i++)
+		{
+			// Bands start on even rows so they don't share quad layout rows
+			band[i] = data;
+			band[i].y0d = (i == 0) ? data.y0d : data.y0d + ((rows * i / bandCount) & ~1);
+			band[i].y1d = (i == bandCount - 1) ? data.y1d : data.y0d + ((rows * (i + 1) / bandCount) & ~1);
+		}
+
+		for(int i = 1; i < bandCount; i++)
+		{
+			resume[i]->signal();
+		}
+
+		blitFunction(&band[0]);
+
+		for(int i = 1; i < bandCount; i++)
+		{
+			suspend[i]->wait();
+		}
+
+		bandMutex.unlock();
 	}
 
 	void Blitter::clear(void *pixel, sw::Format format, Surface *dest, const SliceRect &dRect, unsigned int rgbaMask)
@@ -102,38 +258,59 @@ namespace sw
 		}
 
 		bool useDestInternal = !dest->isExternalDirty();
-		uint8_t *slice = (uint8_t*)dest->lock(dRect.x0, dRect.y0, dRect.slice, sw::LOCK_WRITEONLY, sw::PUBLIC, useDestInternal);
 
-		for(int j = 0; j < dest->getSamples(); j++)
+		BlitData data;
+
+		data.dest = dest->lock(0, 0, dRect.slice, sw::LOCK_WRITEONLY, sw::PUBLIC, useDestInternal);
+		data.dPitchB = dest->getPitchB(useDestInternal);
+		data.dSliceB = dest->getSliceB(useDestInternal);
+
+		data.x0d = dRect.x0;
+		data.x1d = dRect.x1;
+		data.y0d = dRect.y0;
+		data.y1d = dRect.y1;
+
+		data.packed = packed;
+		data.dBytes = Surface::bytes(dest->getFormat());
+		data.dSamples = dest->getSamples();
+
+		execute(fastClearBand, data, true);
+
+		dest->unlock(useDestInternal);
+
+		return true;
+	}
+
+	void Blitter::fastClearBand(const BlitData *data)
+	{
+		uint8_t *slice = (uint8_t*)data->dest + data->y0d * data->dPitchB + data->x0d * data->dBytes;
+
+		for(int j = 0; j < data->dSamples; j++)
 		{
 			uint8_t *d = slice;
 
-			switch(Surface::bytes(dest->getFormat()))
+			switch(data->dBytes)
 			{
 			case 2:
-				for(int i = dRect.y0; i < dRect.y1; i++)
+				for(int i = data->y0d; i < data->y1d; i++)
 				{
-					sw::clear((uint16_t*)d, packed, dRect.x1 - dRect.x0);
-					d += dest->getPitchB(useDestInternal);
+					sw::clear((uint16_t*)d, data->packed, data->x1d - data->x0d);
+					d += data->dPitchB;
 				}
 				break;
 			case 4:
-				for(int i = dRect.y0; i < dRect.y1; i++)
+				for(int i = data->y0d; i < data->y1d; i++)
 				{
-					sw::clear((uint32_t*)d, packed, dRect.x1 - dRect.x0);
-					d += dest->getPitchB(useDestInternal);
+					sw::clear((uint32_t*)d, data->packed, data->x1d - data->x0d);
+					d += data->dPitchB;
 				}
 				break;
 			default:
 				assert(false);
 			}
 
-			slice += dest->getSliceB(useDestInternal);
+			slice += data->dSliceB;
 		}
-
-		dest->unlock(useDestInternal);
-
-		return true;
 	}
 
 	void Blitter::blit(Surface *source, const SliceRectF &sourceRect, Surface *dest, const SliceRect &destRect, const Blitter::Options& options)
@@ -148,6 +325,8 @@ namespace sw
 			return;
 		}
 
+		countFallback(BLIT_FALLBACK);
+
 		SliceRectF sRect = sourceRect;
 		SliceRect dRect = destRect;
 
@@ -193,6 +372,8 @@ namespace sw
 
 	void Blitter::blit3D(Surface *source, Surface *dest)
 	{
+		countFallback(BLIT_FALLBACK);
+
 		source->lockInternal(0, 0, 0, sw::LOCK_READONLY, sw::PUBLIC);
 		dest->lockInternal(0, 0, 0, sw::LOCK_WRITEONLY, sw::PUBLIC);
 
@@ -1385,6 +1566,8 @@ namespace sw
 			}
 		}
 
+		Nucleus::setRoutineCategory(RoutineBlit);
+
 		return function(L"BlitRoutine");
 	}
 
@@ -1418,25 +1601,15 @@ namespace sw
 		state.sourceFormat = isStencil ? source->getStencilFormat() : source->getFormat(useSourceInternal);
 		state.destFormat = isStencil ? dest->getStencilFormat() : dest->getFormat(useDestInternal);
 		state.destSamples = dest->getSamples();
+		state.hash = ((state.sourceFormat * 31 + state.destFormat) * 31 + state.destSamples) * 256 + state.writeMask;
 
-		criticalSection.lock();
-		Routine *blitRoutine = blitCache->query(state);
+		Routine *blitRoutine = getRoutine(state);
 
 		if(!blitRoutine)
 		{
-			blitRoutine = generate(state);
-
-			if(!blitRoutine)
-			{
-				criticalSection.unlock();
-				return false;
-			}
-
-			blitCache->add(state, blitRoutine);
+			return false;
 		}
 
-		criticalSection.unlock();
-
 		void (*blitFunction)(const BlitData *data) = (void(*)(const BlitData*))blitRoutine->getEntry();
 
 		BlitData data;
@@ -1465,7 +1638,9 @@ namespace sw
 		data.sWidth = source->getWidth();
 		data.sHeight = source->getHeight();
 
-		blitFunction(&data);
+		// Rows can only be processed in parallel when they don't read what other rows write
+		execute(blitFunction, data, source != dest);
+		blitRoutine->unbind();
 
 		if(isStencil)
 		{
@@ -1480,4 +1655,70 @@ namespace sw
 
 		return true;
 	}
+
+	bool Blitter::convert(const void *source, Format sourceFormat, int sPitchB, void *dest, Format destFormat, int dPitchB, int width, int height)
+	{
+		State state(Options(false, false, false));
+		state.sourceFormat = sourceFormat;
+		state.destFormat = destFormat;
+		state.destSamples = 1;
+		state.hash = ((state.sourceFormat * 31 + state.destFormat) * 31 + state.destSamples) * 256 + state.writeMask;
+
+		Routine *blitRoutine = getRoutine(state);
+
+		if(!blitRoutine)
+		{
+			return false;
+		}
+
+		void (*blitFunction)(const BlitData *data) = (void(*)(const BlitData*))blitRoutine->getEntry();
+
+		BlitData data;
+
+		data.source = const_cast<void*>(source);
+		data.dest = dest;
+		data.sPitchB = sPitchB;
+		data.dPitchB = dPitchB;
+		data.dSliceB = dPitchB * height;
+
+		// Unscaled, sampling at texel centers
+		data.w = 1.0f;
+		data.h = 1.0f;
+		data.x0 = 0.5f;
+		data.y0 = 0.5f;
+
+		data.x0d = 0;
+		data.x1d = width;
+		data.y0d = 0;
+		data.y1d = height;
+
+		data.sWidth = width;
+		data.sHeight = height;
+
+		execute(blitFunction, data, source != dest);
+		blitRoutine->unbind();
+
+		return true;
+	}
+
+	Routine *Blitter::getRoutine(const State &state)
+	{
+		criticalSection.lock();
+		Routine *blitRoutine = blitCache->query(state);
+		countRoutineCacheQuery(BLIT_ROUTINE_CACHE, blitRoutine != nullptr);
+
+		if(!blitRoutine)
+		{
+			blitRoutine = generate(state);
+
+			if(blitRoutine)
+			{
+				blitRoutine = blitCache->add(state, blitRoutine);
+			}
+		}
+
+		criticalSection.unlock();
+
+		return blitRoutine;
+	}
 }
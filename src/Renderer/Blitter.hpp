@@ -18,6 +18,7 @@
 #include "Surface.hpp"
 #include "RoutineCache.hpp"
 #include "Reactor/Reactor.hpp"
+#include "Common/Thread.hpp"
 
 #include <string.h>
 
@@ -66,6 +67,8 @@ namespace sw
 			Format sourceFormat;
 			Format destFormat;
 			int destSamples;
+
+			unsigned int hash;
 		};
 
 		struct BlitData
@@ -88,6 +91,11 @@ namespace sw
 
 			int sWidth;
 			int sHeight;
+
+			// Used by fastClear() only
+			uint32_t packed;
+			int dBytes;
+			int dSamples;
 		};
 
 	public:
@@ -97,9 +105,19 @@ namespace sw
 		void clear(void *pixel, sw::Format format, Surface *dest, const SliceRect &dRect, unsigned int rgbaMask);
 		void blit(Surface *source, const SliceRectF &sRect, Surface *dest, const SliceRect &dRect, const Options &options);
 		void blit3D(Surface *source, Surface *dest);
+		bool convert(const void *source, Format sourceFormat, int sPitchB, void *dest, Format destFormat, int dPitchB, int width, int height);
+
+		void setThreadCount(int count);   // Large blits are split into row bands processed in parallel
 
 	private:
+		struct Parameters
+		{
+			Blitter *blitter;
+			int threadIndex;
+		};
+
 		bool fastClear(void *pixel, sw::Format format, Surface *dest, const SliceRect &dRect, unsigned int rgbaMask);
+		static void fastClearBand(const BlitData *data);
 
 		bool read(Float4 &color, Pointer<Byte> element, const State &state);
 		bool write(Float4 &color, Pointer<Byte> element, const State &state);
@@ -111,10 +129,27 @@ namespace sw
 		static Float4 LinearToSRGB(Float4 &color);
 		static Float4 sRGBtoLinear(Float4 &color);
 		bool blitReactor(Surface *source, const SliceRectF &sRect, Surface *dest, const SliceRect &dRect, const Options &options);
+		Routine *getRoutine(const State &state);   // Bound, the caller unbinds it
 		Routine *generate(const State &state);
 
+		void execute(void (*blitFunction)(const BlitData *data), const BlitData &data, bool parallel);
+		void initializeThreads();
+		void terminateThreads();
+		static void threadFunction(void *parameters);
+
 		RoutineCache<State> *blitCache;
 		MutexLock criticalSection;
+
+		int threadCount;
+		int workerCount;   // Size of the arrays below, 0 until a blit gets split into bands
+		Thread **worker;
+		Event **resume;
+		Event **suspend;
+		bool exitThreads;
+
+		void (*bandFunction)(const BlitData *data);
+		BlitData *band;
+		MutexLock bandMutex;
 	};
 }
 
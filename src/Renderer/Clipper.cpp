@@ -15,6 +15,7 @@
 #include "Clipper.hpp"
 
 #include "Polygon.hpp"
+#include "Primitive.hpp"
 #include "Renderer.hpp"
 #include "Common/Debug.hpp"
 
@@ -40,6 +41,71 @@ namespace sw
 		       Clipper::CLIP_FINITE;   // FIXME: xyz finite
 	}
 
+	unsigned int Clipper::classifyTriangles(const Triangle *triangle, int count, const DrawCall &draw, TriangleBatch &batch) const
+	{
+		// Computes what clip() needs of up to four triangles at once, keeping the
+		// computations lane-parallel so the compiler can vectorize them.
+		unsigned int clipped = 0;
+
+		for(int i = 0; i < count; i++)
+		{
+			const Triangle &t = triangle[i];
+			unsigned int clipFlagsAnd = t.v0.clipFlags & t.v1.clipFlags & t.v2.clipFlags;
+			unsigned int clipFlagsOr = t.v0.clipFlags | t.v1.clipFlags | t.v2.clipFlags | draw.clipFlags;
+
+			clipped |= (clipFlagsAnd == CLIP_FINITE && clipFlagsOr != CLIP_FINITE) ? (1 << i) : 0;
+		}
+
+		if(!clipped)
+		{
+			return 0;
+		}
+
+		const DrawData &data = *draw.data;
+		int pos = draw.setupState.positionRegister;
+		bool guardBand = data.guardBandX > 1.0f && data.guardBandY > 1.0f;
+		unsigned int inside = 0;
+
+		for(int i = 0; i < 4; i++)
+		{
+			const Triangle &t = triangle[i < count ? i : 0];
+			const float4 *V[3] = {&t.v0.v[pos], &t.v1.v[pos], &t.v2.v[pos]};
+			bool insideGuardBand = guardBand;
+
+			for(int j = 0; j < 3; j++)
+			{
+				const float4 &v = *V[j];
+
+				batch.near[i][j] = v.z - n * v.w;
+				insideGuardBand = insideGuardBand && (v.w > 0.0f) && !(abs(v.x) > data.guardBandX * v.w) && !(abs(v.y) > data.guardBandY * v.w);
+			}
+
+			inside |= insideGuardBand ? (1 << i) : 0;
+		}
+
+		batch.insideGuardBand = inside;
+
+		return clipped;
+	}
+
+	bool Clipper::clip(Polygon &polygon, int clipFlagsOr, const DrawCall &draw, const TriangleBatch &batch, int index)
+	{
+		// Vertices inside the guard band stay inside it when clipped against the near and
+		// far planes, the guard band is a convex region of clip space.
+		if(batch.insideGuardBand & (1 << index))
+		{
+			clipFlagsOr &= ~CLIP_XY;
+		}
+
+		if(clipFlagsOr & CLIP_NEAR)
+		{
+			clipPolygon(polygon, batch.near[index]);
+			clipFlagsOr &= ~CLIP_NEAR;
+		}
+
+		return polygon.n >= 3 && clip(polygon, clipFlagsOr, draw);
+	}
+
 	bool Clipper::clip(Polygon &polygon, int clipFlagsOr, const DrawCall &draw)
 	{
 		if(clipFlagsOr & CLIP_FRUSTUM)
@@ -48,6 +114,10 @@ namespace sw
 			if(polygon.n >= 3) {
 			if(clipFlagsOr & CLIP_FAR)    clipFar(polygon);
 			if(polygon.n >= 3) {
+			if((clipFlagsOr & CLIP_XY) && insideGuardBand(polygon, *draw.data))
+			{
+				clipFlagsOr &= ~CLIP_XY;   // Off-screen pixels are discarded by the scissor rectangle
+			}
 			if(clipFlagsOr & CLIP_LEFT)   clipLeft(polygon);
 			if(polygon.n >= 3) {
 			if(clipFlagsOr & CLIP_RIGHT)  clipRight(polygon);
@@ -81,197 +151,101 @@ namespace sw
 		return polygon.n >= 3;
 	}
 
+	// The distances of all vertices to a plane are computed in one loop, which
+	// the compiler can vectorize, and each of them only once instead of per edge.
+
 	void Clipper::clipNear(Polygon &polygon)
 	{
 		const float4 **V = polygon.P[polygon.i];
-		const float4 **T = polygon.P[polygon.i + 1];
-
-		int t = 0;
+		float d[16];
 
 		for(int i = 0; i < polygon.n; i++)
 		{
-			int j = i == polygon.n - 1 ? 0 : i + 1;
-
-			float di = V[i]->z - n * V[i]->w;
-			float dj = V[j]->z - n * V[j]->w;
-
-			if(di >= 0)
-			{
-				T[t++] = V[i];
-
-				if(dj < 0)
-				{
-					clipEdge(polygon.B[polygon.b], *V[i], *V[j], di, dj);
-					T[t++] = &polygon.B[polygon.b++];
-				}
-			}
-			else
-			{
-				if(dj > 0)
-				{
-					clipEdge(polygon.B[polygon.b], *V[j], *V[i], dj, di);
-					T[t++] = &polygon.B[polygon.b++];
-				}
-			}
+			d[i] = V[i]->z - n * V[i]->w;
 		}
 
-		polygon.n = t;
-		polygon.i += 1;
+		clipPolygon(polygon, d);
 	}
 
 	void Clipper::clipFar(Polygon &polygon)
 	{
 		const float4 **V = polygon.P[polygon.i];
-		const float4 **T = polygon.P[polygon.i + 1];
-
-		int t = 0;
+		float d[16];
 
 		for(int i = 0; i < polygon.n; i++)
 		{
-			int j = i == polygon.n - 1 ? 0 : i + 1;
-
-			float di = V[i]->w - V[i]->z;
-			float dj = V[j]->w - V[j]->z;
-
-			if(di >= 0)
-			{
-				T[t++] = V[i];
-
-				if(dj < 0)
-				{
-					clipEdge(polygon.B[polygon.b], *V[i], *V[j], di, dj);
-					T[t++] = &polygon.B[polygon.b++];
-				}
-			}
-			else
-			{
-				if(dj > 0)
-				{
-					clipEdge(polygon.B[polygon.b], *V[j], *V[i], dj, di);
-					T[t++] = &polygon.B[polygon.b++];
-				}
-			}
+			d[i] = V[i]->w - V[i]->z;
 		}
 
-		polygon.n = t;
-		polygon.i += 1;
+		clipPolygon(polygon, d);
 	}
 
 	void Clipper::clipLeft(Polygon &polygon)
 	{
 		const float4 **V = polygon.P[polygon.i];
-		const float4 **T = polygon.P[polygon.i + 1];
-
-		int t = 0;
+		float d[16];
 
 		for(int i = 0; i < polygon.n; i++)
 		{
-			int j = i == polygon.n - 1 ? 0 : i + 1;
-
-			float di = V[i]->w + V[i]->x;
-			float dj = V[j]->w + V[j]->x;
-
-			if(di >= 0)
-			{
-				T[t++] = V[i];
-
-				if(dj < 0)
-				{
-					clipEdge(polygon.B[polygon.b], *V[i], *V[j], di, dj);
-					T[t++] = &polygon.B[polygon.b++];
-				}
-			}
-			else
-			{
-				if(dj > 0)
-				{
-					clipEdge(polygon.B[polygon.b], *V[j], *V[i], dj, di);
-					T[t++] = &polygon.B[polygon.b++];
-				}
-			}
+			d[i] = V[i]->w + V[i]->x;
 		}
 
-		polygon.n = t;
-		polygon.i += 1;
+		clipPolygon(polygon, d);
 	}
 
 	void Clipper::clipRight(Polygon &polygon)
 	{
 		const float4 **V = polygon.P[polygon.i];
-		const float4 **T = polygon.P[polygon.i + 1];
-
-		int t = 0;
+		float d[16];
 
 		for(int i = 0; i < polygon.n; i++)
 		{
-			int j = i == polygon.n - 1 ? 0 : i + 1;
+			d[i] = V[i]->w - V[i]->x;
+		}
 
-			float di = V[i]->w - V[i]->x;
-			float dj = V[j]->w - V[j]->x;
+		clipPolygon(polygon, d);
+	}
 
-			if(di >= 0)
-			{
-				T[t++] = V[i];
+	void Clipper::clipTop(Polygon &polygon)
+	{
+		const float4 **V = polygon.P[polygon.i];
+		float d[16];
 
-				if(dj < 0)
-				{
-					clipEdge(polygon.B[polygon.b], *V[i], *V[j], di, dj);
-					T[t++] = &polygon.B[polygon.b++];
-				}
-			}
-			else
-			{
-				if(dj > 0)
-				{
-					clipEdge(polygon.B[polygon.b], *V[j], *V[i], dj, di);
-					T[t++] = &polygon.B[polygon.b++];
-				}
-			}
+		for(int i = 0; i < polygon.n; i++)
+		{
+			d[i] = V[i]->w - V[i]->y;
 		}
 
-		polygon.n = t;
-		polygon.i += 1;
+		clipPolygon(polygon, d);
 	}
 
-	void Clipper::clipTop(Polygon &polygon)
+	void Clipper::clipBottom(Polygon &polygon)
 	{
 		const float4 **V = polygon.P[polygon.i];
-		const float4 **T = polygon.P[polygon.i + 1];
-
-		int t = 0;
+		float d[16];
 
 		for(int i = 0; i < polygon.n; i++)
 		{
-			int j = i == polygon.n - 1 ? 0 : i + 1;
+			d[i] = V[i]->w + V[i]->y;
+		}
 
-			float di = V[i]->w - V[i]->y;
-			float dj = V[j]->w - V[j]->y;
+		clipPolygon(polygon, d);
+	}
 
-			if(di >= 0)
-			{
-				T[t++] = V[i];
+	void Clipper::clipPlane(Polygon &polygon, const Plane &p)
+	{
+		const float4 **V = polygon.P[polygon.i];
+		float d[16];
 
-				if(dj < 0)
-				{
-					clipEdge(polygon.B[polygon.b], *V[i], *V[j], di, dj);
-					T[t++] = &polygon.B[polygon.b++];
-				}
-			}
-			else
-			{
-				if(dj > 0)
-				{
-					clipEdge(polygon.B[polygon.b], *V[j], *V[i], dj, di);
-					T[t++] = &polygon.B[polygon.b++];
-				}
-			}
+		for(int i = 0; i < polygon.n; i++)
+		{
+			d[i] = p.A * V[i]->x + p.B * V[i]->y + p.C * V[i]->z + p.D * V[i]->w;
 		}
 
-		polygon.n = t;
-		polygon.i += 1;
+		clipPolygon(polygon, d);
 	}
 
-	void Clipper::clipBottom(Polygon &polygon)
+	void Clipper::clipPolygon(Polygon &polygon, const float *d)
 	{
 		const float4 **V = polygon.P[polygon.i];
 		const float4 **T = polygon.P[polygon.i + 1];
@@ -282,8 +256,8 @@ namespace sw
 		{
 			int j = i == polygon.n - 1 ? 0 : i + 1;
 
-			float di = V[i]->w + V[i]->y;
-			float dj = V[j]->w + V[j]->y;
+			float di = d[i];
+			float dj = d[j];
 
 			if(di >= 0)
 			{
@@ -309,42 +283,26 @@ namespace sw
 		polygon.i += 1;
 	}
 
-	void Clipper::clipPlane(Polygon &polygon, const Plane &p)
+	bool Clipper::insideGuardBand(const Polygon &polygon, const DrawData &data) const
 	{
-		const float4 **V = polygon.P[polygon.i];
-		const float4 **T = polygon.P[polygon.i + 1];
+		if(data.guardBandX <= 1.0f || data.guardBandY <= 1.0f)
+		{
+			return false;
+		}
 
-		int t = 0;
+		const float4 *const *V = polygon.P[polygon.i];
 
 		for(int i = 0; i < polygon.n; i++)
 		{
-			int j = i == polygon.n - 1 ? 0 : i + 1;
-
-			float di = p.A * V[i]->x + p.B * V[i]->y + p.C * V[i]->z + p.D * V[i]->w;
-			float dj = p.A * V[j]->x + p.B * V[j]->y + p.C * V[j]->z + p.D * V[j]->w;
+			const float4 &v = *V[i];
 
-			if(di >= 0)
+			if(!(v.w > 0.0f) || abs(v.x) > data.guardBandX * v.w || abs(v.y) > data.guardBandY * v.w)
 			{
-				T[t++] = V[i];
-
-				if(dj < 0)
-				{
-					clipEdge(polygon.B[polygon.b], *V[i], *V[j], di, dj);
-					T[t++] = &polygon.B[polygon.b++];
-				}
-			}
-			else
-			{
-				if(dj > 0)
-				{
-					clipEdge(polygon.B[polygon.b], *V[j], *V[i], dj, di);
-					T[t++] = &polygon.B[polygon.b++];
-				}
+				return false;
 			}
 		}
 
-		polygon.n = t;
-		polygon.i += 1;
+		return true;
 	}
 
 	inline void Clipper::clipEdge(float4 &Vo, const float4 &Vi, const float4 &Vj, float di, float dj) const
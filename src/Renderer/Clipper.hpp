@@ -21,6 +21,7 @@
 namespace sw
 {
 	struct Polygon;
+	struct Triangle;
 	struct DrawCall;
 	struct DrawData;
 
@@ -38,6 +39,7 @@ namespace sw
 			CLIP_NEAR   = 1 << 5,
 
 			CLIP_FRUSTUM = 0x003F,
+			CLIP_XY      = CLIP_LEFT | CLIP_RIGHT | CLIP_TOP | CLIP_BOTTOM,
 
 			CLIP_FINITE = 1 << 7,   // All position coordinates are finite
 
@@ -52,6 +54,13 @@ namespace sw
 			CLIP_USER = 0x3F00
 		};
 
+		// Near plane distances and guard band tests of up to four triangles, computed at once
+		struct TriangleBatch
+		{
+			float near[4][3];
+			unsigned int insideGuardBand;   // Triangles with all vertices inside the guard band
+		};
+
 		Clipper(bool symmetricNormalizedDepth);
 
 		~Clipper();
@@ -59,6 +68,10 @@ namespace sw
 		unsigned int computeClipFlags(const float4 &v);
 		bool clip(Polygon &polygon, int clipFlagsOr, const DrawCall &draw);
 
+		// Returns the triangles which need clipping, and fills in the batch for clipping them
+		unsigned int classifyTriangles(const Triangle *triangle, int count, const DrawCall &draw, TriangleBatch &batch) const;
+		bool clip(Polygon &polygon, int clipFlagsOr, const DrawCall &draw, const TriangleBatch &batch, int index);
+
 	private:
 		void clipNear(Polygon &polygon);
 		void clipFar(Polygon &polygon);
@@ -67,6 +80,9 @@ namespace sw
 		void clipTop(Polygon &polygon);
 		void clipBottom(Polygon &polygon);
 		void clipPlane(Polygon &polygon, const Plane &plane);
+		void clipPolygon(Polygon &polygon, const float *d);   // Against the plane at which the vertex distances d are zero
+
+		bool insideGuardBand(const Polygon &polygon, const DrawData &data) const;
 
 		void clipEdge(float4 &Vo, const float4 &Vi, const float4 &Vj, float di, float dj) const;
 
@@ -38,7 +38,13 @@ namespace sw
 	bool forceWindowed = false;
 	bool quadLayoutEnabled = false;
 	bool veryEarlyDepthTest = true;
+	bool tiledRasterization = false;
+	bool coarseDepthCulling = true;
 	bool complementaryDepthBuffer = false;
+	bool compressedTextureSampling = false;
+	bool tiledTextureLayout = false;
+	bool linearSRGBTextures = false;
+	bool guardBandClipping = false;
 	bool postBlendSRGB = false;
 	bool exactColorRounding = false;
 	TransparencyAntialiasing transparencyAntialiasing = TRANSPARENCY_NONE;
@@ -196,6 +202,18 @@ namespace sw
 		return true;
 	}
 
+	AttachmentFormat::AttachmentFormat(const Surface *surface)
+	{
+		internal = surface ? surface->getInternalFormat() : FORMAT_NULL;
+		external = surface ? surface->getExternalFormat() : FORMAT_NULL;
+		samples = surface ? surface->getSamples() : 0;
+	}
+
+	bool AttachmentFormat::operator!=(const AttachmentFormat &format) const
+	{
+		return internal != format.internal || external != format.external || samples != format.samples;
+	}
+
 	void Context::init()
 	{
 		for(int i = 0; i < 8; i++)
@@ -223,9 +241,12 @@ namespace sw
 		for(int i = 0; i < RENDERTARGETS; ++i)
 		{
 			renderTarget[i] = nullptr;
+			renderTargetFormat[i] = AttachmentFormat();
 		}
 		depthBuffer = nullptr;
+		depthBufferFormat = AttachmentFormat();
 		stencilBuffer = nullptr;
+		stencilBufferFormat = AttachmentFormat();
 
 		stencilEnable = false;
 		stencilCompareMode = STENCIL_ALWAYS;
@@ -303,8 +324,6 @@ namespace sw
 		pixelShader = 0;
 		vertexShader = 0;
 
-		instanceID = 0;
-
 		occlusionEnabled = false;
 		transformFeedbackQueryEnabled = false;
 		transformFeedbackEnabled = 0;
@@ -318,6 +337,8 @@ namespace sw
 
 		colorLogicOpEnabled = false;
 		logicalOperation = LOGICALOP_COPY;
+
+		stateModified = true;
 	}
 
 	const float &Context::exp2Bias()
@@ -337,17 +358,17 @@ namespace sw
 
 	void Context::setLightingEnable(bool lightingEnable)
 	{
-		this->lightingEnable = lightingEnable;
+		setState(this->lightingEnable, lightingEnable);
 	}
 
 	void Context::setSpecularEnable(bool specularEnable)
 	{
-		Context::specularEnable = specularEnable;
+		setState(Context::specularEnable, specularEnable);
 	}
 
 	void Context::setLightEnable(int light, bool lightEnable)
 	{
-		Context::lightEnable[light] = lightEnable;
+		setState(Context::lightEnable[light], lightEnable);
 	}
 
 	void Context::setLightPosition(int light, Point worldLightPosition)
@@ -357,38 +378,39 @@ namespace sw
 
 	void Context::setAmbientMaterialSource(MaterialSource ambientMaterialSource)
 	{
-		Context::ambientMaterialSource = ambientMaterialSource;
+		setState(Context::ambientMaterialSource, ambientMaterialSource);
 	}
 
 	void Context::setDiffuseMaterialSource(MaterialSource diffuseMaterialSource)
 	{
-		Context::diffuseMaterialSource = diffuseMaterialSource;
+		setState(Context::diffuseMaterialSource, diffuseMaterialSource);
 	}
 
 	void Context::setSpecularMaterialSource(MaterialSource specularMaterialSource)
 	{
-		Context::specularMaterialSource = specularMaterialSource;
+		setState(Context::specularMaterialSource, specularMaterialSource);
 	}
 
 	void Context::setEmissiveMaterialSource(MaterialSource emissiveMaterialSource)
 	{
-		Context::emissiveMaterialSource = emissiveMaterialSource;
+		setState(Context::emissiveMaterialSource, emissiveMaterialSource);
 	}
 
 	void Context::setPointSpriteEnable(bool pointSpriteEnable)
 	{
-		Context::pointSpriteEnable = pointSpriteEnable;
+		setState(Context::pointSpriteEnable, pointSpriteEnable);
 	}
 
 	void Context::setPointScaleEnable(bool pointScaleEnable)
 	{
-		Context::pointScaleEnable = pointScaleEnable;
+		setState(Context::pointScaleEnable, pointScaleEnable);
 	}
 
 	bool Context::setDepthBufferEnable(bool depthBufferEnable)
 	{
 		bool modified = (Context::depthBufferEnable != depthBufferEnable);
 		Context::depthBufferEnable = depthBufferEnable;
+		stateModified |= modified;
 		return modified;
 	}
 
@@ -396,6 +418,7 @@ namespace sw
 	{
 		bool modified = (Context::alphaBlendEnable != alphaBlendEnable);
 		Context::alphaBlendEnable = alphaBlendEnable;
+		stateModified |= modified;
 		return modified;
 	}
 
@@ -403,6 +426,7 @@ namespace sw
 	{
 		bool modified = (Context::sourceBlendFactorState != sourceBlendFactor);
 		Context::sourceBlendFactorState = sourceBlendFactor;
+		stateModified |= modified;
 		return modified;
 	}
 
@@ -410,6 +434,7 @@ namespace sw
 	{
 		bool modified = (Context::destBlendFactorState != destBlendFactor);
 		Context::destBlendFactorState = destBlendFactor;
+		stateModified |= modified;
 		return modified;
 	}
 
@@ -417,6 +442,7 @@ namespace sw
 	{
 		bool modified = (Context::blendOperationState != blendOperation);
 		Context::blendOperationState = blendOperation;
+		stateModified |= modified;
 		return modified;
 	}
 
@@ -424,6 +450,7 @@ namespace sw
 	{
 		bool modified = (Context::separateAlphaBlendEnable != separateAlphaBlendEnable);
 		Context::separateAlphaBlendEnable = separateAlphaBlendEnable;
+		stateModified |= modified;
 		return modified;
 	}
 
@@ -431,6 +458,7 @@ namespace sw
 	{
 		bool modified = (Context::sourceBlendFactorStateAlpha != sourceBlendFactorAlpha);
 		Context::sourceBlendFactorStateAlpha = sourceBlendFactorAlpha;
+		stateModified |= modified;
 		return modified;
 	}
 
@@ -438,6 +466,7 @@ namespace sw
 	{
 		bool modified = (Context::destBlendFactorStateAlpha != destBlendFactorAlpha);
 		Context::destBlendFactorStateAlpha = destBlendFactorAlpha;
+		stateModified |= modified;
 		return modified;
 	}
 
@@ -445,6 +474,7 @@ namespace sw
 	{
 		bool modified = (Context::blendOperationStateAlpha != blendOperationAlpha);
 		Context::blendOperationStateAlpha = blendOperationAlpha;
+		stateModified |= modified;
 		return modified;
 	}
 
@@ -452,6 +482,7 @@ namespace sw
 	{
 		bool modified = (Context::colorWriteMask[index] != colorWriteMask);
 		Context::colorWriteMask[index] = colorWriteMask;
+		stateModified |= modified;
 		return modified;
 	}
 
@@ -459,6 +490,7 @@ namespace sw
 	{
 		bool modified = (Context::writeSRGB != sRGB);
 		Context::writeSRGB = sRGB;
+		stateModified |= modified;
 		return modified;
 	}
 
@@ -466,6 +498,7 @@ namespace sw
 	{
 		bool modified = (Context::colorLogicOpEnabled != enabled);
 		Context::colorLogicOpEnabled = enabled;
+		stateModified |= modified;
 		return modified;
 	}
 
@@ -473,12 +506,13 @@ namespace sw
 	{
 		bool modified = (Context::logicalOperation != logicalOperation);
 		Context::logicalOperation = logicalOperation;
+		stateModified |= modified;
 		return modified;
 	}
 
 	void Context::setColorVertexEnable(bool colorVertexEnable)
 	{
-		Context::colorVertexEnable = colorVertexEnable;
+		setState(Context::colorVertexEnable, colorVertexEnable);
 	}
 
 	bool Context::fogActive()
@@ -277,6 +277,19 @@ namespace sw
 		TRANSPARENCY_LAST = TRANSPARENCY_ALPHA_TO_COVERAGE
 	};
 
+	// Properties of an attachment which the routines depend on. They're tracked apart from the surface
+	// pointer, because a new surface can reuse the address of a deleted one.
+	struct AttachmentFormat
+	{
+		AttachmentFormat(const Surface *surface = nullptr);
+
+		bool operator!=(const AttachmentFormat &format) const;
+
+		Format internal;
+		Format external;   // Determines whether sRGB writes apply
+		int samples;
+	};
+
 	class Context
 	{
 	public:
@@ -299,6 +312,19 @@ namespace sw
 
 		void setGlobalMipmapBias(float bias);
 
+		// Assign a state which the routines depend on, flag it as modified when it changes
+		template<class T, class U>
+		void setState(T &state, const U &value)
+		{
+			const T newState = value;
+
+			if(state != newState)
+			{
+				state = newState;
+				stateModified = true;
+			}
+		}
+
 		// Set fixed-function vertex pipeline states
 		void setLightingEnable(bool lightingEnable);
 		void setSpecularEnable(bool specularEnable);
@@ -406,6 +432,7 @@ namespace sw
 		int getSuperSampleCount() const;
 
 		DrawType drawType;
+		bool stateModified;   // Routine states must be derived again
 
 		bool stencilEnable;
 		StencilCompareMode stencilCompareMode;
@@ -466,10 +493,13 @@ namespace sw
 		bool textureTransformProject[8];
 
 		Surface *renderTarget[RENDERTARGETS];
+		AttachmentFormat renderTargetFormat[RENDERTARGETS];
 		unsigned int renderTargetLayer[RENDERTARGETS];
 		Surface *depthBuffer;
+		AttachmentFormat depthBufferFormat;
 		unsigned int depthBufferLayer;
 		Surface *stencilBuffer;
+		AttachmentFormat stencilBufferFormat;
 		unsigned int stencilBufferLayer;
 
 		// Fog
@@ -490,9 +520,6 @@ namespace sw
 		// Global mipmap bias
 		float bias;
 
-		// Instancing
-		int instanceID;
-
 		// Fixed-function vertex pipeline state
 		bool lightingEnable;
 		bool specularEnable;
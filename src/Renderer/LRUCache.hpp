@@ -19,6 +19,7 @@
 
 namespace sw
 {
+	// Keys must provide an unsigned int 'hash' member and operator==.
 	template<class Key, class Data>
 	class LRUCache
 	{
@@ -28,20 +29,44 @@ namespace sw
 		~LRUCache();
 
 		Data *query(const Key &key) const;
-		Data *add(const Key &key, Data *data);
-	
+		Data *add(const Key &key, Data *data, bool *evicted = nullptr, unsigned int *evictedHash = nullptr);
+		void resize(int n);   // Only grows, keeping the entries and their order
+
 		int getSize() {return size;}
 		Key &getKey(int i) {return key[i];}
 
 	private:
+		int find(const Key &key) const;
+		void insert(int entry);
+		void remove(int entry);
+		void link(int entry) const;   // Make most recently used
+		void unlink(int entry) const;
+
+		static unsigned int hash(unsigned int h)
+		{
+			// Spread the bits of the states' XOR hashes over the table
+			h ^= h >> 16;
+			h *= 0x85EBCA6B;
+			h ^= h >> 13;
+			h *= 0xC2B2AE35;
+			h ^= h >> 16;
+
+			return h;
+		}
+
 		int size;
-		int mask;
-		int top;
 		int fill;
+		int tableMask;
+
+		mutable int head;   // Most recently used
+		mutable int tail;   // Least recently used
 
 		Key *key;
-		Key **ref;
 		Data **data;
+		mutable int *prev;
+		mutable int *next;
+
+		int *table;   // Open addressing, entry index or -1
 	};
 }
 
@@ -51,19 +76,25 @@ namespace sw
 	LRUCache<Key, Data>::LRUCache(int n)
 	{
 		size = ceilPow2(n);
-		mask = size - 1;
-		top = 0;
 		fill = 0;
+		tableMask = 2 * size - 1;   // At most half full, to keep probe sequences short
+		head = -1;
+		tail = -1;
 
 		key = new Key[size];
-		ref = new Key*[size];
 		data = new Data*[size];
+		prev = new int[size];
+		next = new int[size];
+		table = new int[2 * size];
 
 		for(int i = 0; i < size; i++)
 		{
 			data[i] = nullptr;
+		}
 
-			ref[i] = &key[i];
+		for(int i = 0; i < 2 * size; i++)
+		{
+			table[i] = -1;
 		}
 	}
 
@@ -73,8 +104,14 @@ namespace sw
 		delete[] key;
 		key = nullptr;
 
-		delete[] ref;
-		ref = nullptr;
+		delete[] prev;
+		prev = nullptr;
+
+		delete[] next;
+		next = nullptr;
+
+		delete[] table;
+		table = nullptr;
 
 		for(int i = 0; i < size; i++)
 		{
@@ -92,53 +129,221 @@ namespace sw
 	template<class Key, class Data>
 	Data *LRUCache<Key, Data>::query(const Key &key) const
 	{
-		for(int i = top; i > top - fill; i--)
+		int entry = find(key);
+
+		if(entry < 0)
+		{
+			return nullptr;   // Not found
+		}
+
+		if(entry != head)
+		{
+			unlink(entry);
+			link(entry);
+		}
+
+		return data[entry];
+	}
+
+	template<class Key, class Data>
+	Data *LRUCache<Key, Data>::add(const Key &key, Data *data, bool *evicted, unsigned int *evictedHash)
+	{
+		data->bind();
+
+		int entry = find(key);
+
+		if(evicted)
 		{
-			int j = i & mask;
+			*evicted = (entry < 0) && (fill == size);
+		}
 
-			if(key == *ref[j])
+		if(entry >= 0)
+		{
+			unlink(entry);
+		}
+		else
+		{
+			if(fill < size)
+			{
+				entry = fill++;
+			}
+			else
 			{
-				Data *hit = data[j];
+				entry = tail;
+				unlink(entry);
+				remove(entry);
 
-				if(i != top)
+				if(evictedHash)
 				{
-					// Move one up
-					int k = (j + 1) & mask;
+					*evictedHash = this->key[entry].hash;
+				}
+			}
+
+			this->key[entry] = key;
+			insert(entry);
+		}
 
-					Data *swapD = data[k];
-					data[k] = data[j];
-					data[j] = swapD;
+		if(this->data[entry])
+		{
+			this->data[entry]->unbind();
+		}
 
-					Key *swapK = ref[k];
-					ref[k] = ref[j];
-					ref[j] = swapK;
-				}
+		this->data[entry] = data;
+		link(entry);
+
+		return data;
+	}
+
+	template<class Key, class Data>
+	void LRUCache<Key, Data>::resize(int n)
+	{
+		int newSize = ceilPow2(n);
+
+		if(newSize <= size)
+		{
+			return;
+		}
+
+		Key *oldKey = key;
+		Data **oldData = data;
+		int *oldPrev = prev;
+		int *oldNext = next;
+		int oldTail = tail;
+
+		delete[] table;
+
+		size = newSize;
+		fill = 0;
+		tableMask = 2 * size - 1;
+		head = -1;
+		tail = -1;
+
+		key = new Key[size];
+		data = new Data*[size];
+		prev = new int[size];
+		next = new int[size];
+		table = new int[2 * size];
 
-				return hit;
+		for(int i = 0; i < size; i++)
+		{
+			data[i] = nullptr;
+		}
+
+		for(int i = 0; i < 2 * size; i++)
+		{
+			table[i] = -1;
+		}
+
+		// Least recently used first, so the most recently used one ends up at the head.
+		// The references held by the old entries move over to the new ones.
+		for(int entry = oldTail; entry >= 0; entry = oldPrev[entry])
+		{
+			int moved = fill++;
+
+			key[moved] = oldKey[entry];
+			data[moved] = oldData[entry];
+			insert(moved);
+			link(moved);
+		}
+
+		delete[] oldKey;
+		delete[] oldData;
+		delete[] oldPrev;
+		delete[] oldNext;
+	}
+
+	template<class Key, class Data>
+	int LRUCache<Key, Data>::find(const Key &key) const
+	{
+		for(unsigned int slot = hash(key.hash) & tableMask; table[slot] >= 0; slot = (slot + 1) & tableMask)
+		{
+			int entry = table[slot];
+
+			if(this->key[entry].hash == key.hash && this->key[entry] == key)
+			{
+				return entry;
 			}
 		}
 
-		return nullptr;   // Not found
+		return -1;
 	}
 
 	template<class Key, class Data>
-	Data *LRUCache<Key, Data>::add(const Key &key, Data *data)
+	void LRUCache<Key, Data>::insert(int entry)
 	{
-		top = (top + 1) & mask;
-		fill = fill + 1 < size ? fill + 1 : size;
+		unsigned int slot = hash(key[entry].hash) & tableMask;
+
+		while(table[slot] >= 0)
+		{
+			slot = (slot + 1) & tableMask;
+		}
 
-		*ref[top] = key;
+		table[slot] = entry;
+	}
 
-		data->bind();
+	template<class Key, class Data>
+	void LRUCache<Key, Data>::remove(int entry)
+	{
+		unsigned int slot = hash(key[entry].hash) & tableMask;
 
-		if(this->data[top])
+		while(table[slot] != entry)
 		{
-			this->data[top]->unbind();
+			slot = (slot + 1) & tableMask;
 		}
 
-		this->data[top] = data;
+		// Shift later members of the probe sequence back, instead of leaving a tombstone
+		for(unsigned int probe = (slot + 1) & tableMask; table[probe] >= 0; probe = (probe + 1) & tableMask)
+		{
+			unsigned int home = hash(key[table[probe]].hash) & tableMask;
 
-		return data;
+			if(((probe - home) & tableMask) >= ((probe - slot) & tableMask))
+			{
+				table[slot] = table[probe];
+				slot = probe;
+			}
+		}
+
+		table[slot] = -1;
+	}
+
+	template<class Key, class Data>
+	void LRUCache<Key, Data>::link(int entry) const
+	{
+		prev[entry] = -1;
+		next[entry] = head;
+
+		if(head >= 0)
+		{
+			prev[head] = entry;
+		}
+		else
+		{
+			tail = entry;
+		}
+
+		head = entry;
+	}
+
+	template<class Key, class Data>
+	void LRUCache<Key, Data>::unlink(int entry) const
+	{
+		if(prev[entry] >= 0)
+		{
+			next[prev[entry]] = next[entry];
+		}
+		else
+		{
+			head = next[entry];
+		}
+
+		if(next[entry] >= 0)
+		{
+			prev[next[entry]] = prev[entry];
+		}
+		else
+		{
+			tail = prev[entry];
+		}
 	}
 }
 
@@ -0,0 +1,52 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "LockStatistics.hpp"
+
+#include "Common/MutexLock.hpp"
+#include "Reactor/MutexLock.hpp"
+
+namespace
+{
+	template<typename Counters>
+	void copyStatistics(SwiftShaderLockStatistics *statistics, int count, int index, const Counters *counters)
+	{
+		if(statistics && index < count)
+		{
+			statistics[index].name = counters->name;
+			statistics[index].acquisitions = counters->acquisitions;
+			statistics[index].contendedAcquisitions = counters->contendedAcquisitions;
+			statistics[index].waitNanoseconds = counters->waitNanoseconds;
+		}
+	}
+}
+
+extern "C" int swiftshaderGetLockStatistics(SwiftShaderLockStatistics *statistics, int count)
+{
+	int locks = 0;
+
+	// Renderer locks, followed by the JIT compiler's
+	while(const sw::LockCounters *counters = sw::getLockCounters(locks))
+	{
+		copyStatistics(statistics, count, locks++, counters);
+	}
+
+	for(int i = 0; const rr::LockCounters *counters = rr::getLockCounters(i); i++)
+	{
+		copyStatistics(statistics, count, locks++, counters);
+	}
+
+	return locks;
+}
@@ -0,0 +1,39 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef sw_LockStatistics_hpp
+#define sw_LockStatistics_hpp
+
+#include <stdint.h>
+
+extern "C"
+{
+	// Contention counters of a named lock, accumulated since the library was
+	// loaded. Only collected when SWIFTSHADER_LOCK_STATISTICS is set in the
+	// environment. Locks sharing a name, like those of all resources, add to
+	// the same counters.
+	struct SwiftShaderLockStatistics
+	{
+		const char *name;
+		uint64_t acquisitions;
+		uint64_t contendedAcquisitions;   // Acquisitions which had to wait for another thread
+		uint64_t waitNanoseconds;         // Time spent waiting in contended acquisitions
+	};
+
+	// Fills in up to count entries and returns the number of named locks
+	int swiftshaderGetLockStatistics(SwiftShaderLockStatistics *statistics, int count);
+}
+
+#endif   // sw_LockStatistics_hpp
@@ -0,0 +1,36 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "MemoryStatistics.hpp"
+
+#include "Surface.hpp"
+#include "Common/Memory.hpp"
+#include "Reactor/ExecutableMemory.hpp"
+
+extern "C" void swiftshaderGetMemoryStatistics(SwiftShaderMemoryStatistics *statistics)
+{
+	if(!statistics)
+	{
+		return;
+	}
+
+	statistics->surfaceBytes = sw::memoryUsage(sw::MEMORY_SURFACE);
+	statistics->resourceBytes = sw::memoryUsage(sw::MEMORY_RESOURCE);
+	statistics->drawBytes = sw::memoryUsage(sw::MEMORY_DRAW);
+	statistics->routineBytes = rr::executableMemoryUsage();
+	statistics->otherBytes = sw::memoryUsage(sw::MEMORY_OTHER);
+
+	statistics->surfaceBudget = sw::Surface::getMemoryBudget();
+	statistics->evictions = sw::Surface::evictionCount();
+}
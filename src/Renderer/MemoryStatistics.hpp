@@ -0,0 +1,39 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef sw_MemoryStatistics_hpp
+#define sw_MemoryStatistics_hpp
+
+#include <stdint.h>
+
+extern "C"
+{
+	// Bytes currently allocated, per kind of allocation. Process-wide, so
+	// contexts of all displays add to the same counters.
+	struct SwiftShaderMemoryStatistics
+	{
+		uint64_t surfaceBytes;    // Texture, render target and depth/stencil buffers
+		uint64_t resourceBytes;   // Resource buffers, e.g. vertex and index data
+		uint64_t drawBytes;       // Draw call state
+		uint64_t routineBytes;    // Executable memory of the compiled routines
+		uint64_t otherBytes;      // Everything else allocated by sw::allocate()
+
+		uint64_t surfaceBudget;   // Capabilities/TextureMemory limit on surfaceBytes, 0 for none
+		uint64_t evictions;       // Idle internal surface copies released to stay under the budget
+	};
+
+	void swiftshaderGetMemoryStatistics(SwiftShaderMemoryStatistics *statistics);
+}
+
+#endif   // sw_MemoryStatistics_hpp
@@ -0,0 +1,174 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "OverdrawHeatmap.hpp"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+
+namespace
+{
+	std::mutex heatmapMutex;
+	sw::OverdrawHeatmap heatmap = {false, nullptr, 0, 0, 0};
+	int allocatedHeight = 0;
+
+	// Draws in flight may still reference the counters of a previous, smaller heatmap, so they stay allocated
+	std::vector<std::unique_ptr<unsigned int[]>> allocations;
+
+	void heatColor(unsigned int count, unsigned char rgb[3])
+	{
+		static const unsigned char ramp[9][3] =
+		{
+			{  0,   0,   0},
+			{  0,   0, 255},
+			{  0, 128, 255},
+			{  0, 255, 255},
+			{  0, 255, 128},
+			{  0, 255,   0},
+			{255, 255,   0},
+			{255, 128,   0},
+			{255,   0,   0},
+		};
+
+		const unsigned char *color = ramp[count < 8 ? count : 8];
+
+		rgb[0] = color[0];
+		rgb[1] = color[1];
+		rgb[2] = color[2];
+	}
+}
+
+extern "C" void swiftshaderEnableOverdrawHeatmap(int width, int height)
+{
+	std::lock_guard<std::mutex> lock(heatmapMutex);
+
+	heatmap.enabled = (width > 0 && height > 0);
+
+	if(!heatmap.enabled)
+	{
+		return;
+	}
+
+	if(allocations.empty() || width > heatmap.pitch || height > allocatedHeight)
+	{
+		// Padded to whole quads, so pixel routines can update all four counters of each
+		int pitch = width > heatmap.pitch ? (width + 1) & ~1 : heatmap.pitch;
+		allocatedHeight = height > allocatedHeight ? (height + 1) & ~1 : allocatedHeight;
+
+		allocations.emplace_back(new unsigned int[pitch * allocatedHeight]());
+		heatmap.pitch = pitch;
+	}
+
+	heatmap.counters = allocations.back().get();
+	heatmap.width = width;
+	heatmap.height = height;
+}
+
+extern "C" void swiftshaderResetOverdrawHeatmap()
+{
+	std::lock_guard<std::mutex> lock(heatmapMutex);
+
+	if(!allocations.empty())
+	{
+		memset(allocations.back().get(), 0, heatmap.pitch * allocatedHeight * sizeof(unsigned int));
+	}
+}
+
+extern "C" void swiftshaderGetOverdrawStatistics(SwiftShaderOverdrawStatistics *statistics)
+{
+	if(!statistics)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(heatmapMutex);
+
+	memset(statistics, 0, sizeof(SwiftShaderOverdrawStatistics));
+
+	if(allocations.empty())
+	{
+		return;
+	}
+
+	const unsigned int *counters = allocations.back().get();
+
+	for(int i = 0; i < heatmap.pitch * allocatedHeight; i++)
+	{
+		unsigned int shaded = counters[i] & 0xFFFF;
+
+		statistics->shadedPixels += shaded;
+		statistics->lateRejectedPixels += counters[i] >> 16;
+		statistics->touchedPixels += (shaded != 0);
+
+		if(shaded > statistics->maxShaded)
+		{
+			statistics->maxShaded = shaded;
+		}
+	}
+}
+
+extern "C" int swiftshaderWriteOverdrawHeatmap(const char *path, int lateRejections)
+{
+	std::lock_guard<std::mutex> lock(heatmapMutex);
+
+	if(allocations.empty() || !path)
+	{
+		return 0;
+	}
+
+	FILE *file = fopen(path, "wb");
+
+	if(!file)
+	{
+		return 0;
+	}
+
+	// The area last enabled, with rows in memory order
+	int width = heatmap.width;
+	int height = heatmap.height;
+	const unsigned int *counters = allocations.back().get();
+	std::vector<unsigned char> row(width * 3);
+
+	fprintf(file, "P6\n%d %d\n255\n", width, height);
+
+	for(int y = 0; y < height; y++)
+	{
+		for(int x = 0; x < width; x++)
+		{
+			unsigned int counter = counters[y * heatmap.pitch + x];
+
+			heatColor(lateRejections ? counter >> 16 : counter & 0xFFFF, &row[x * 3]);
+		}
+
+		fwrite(row.data(), 1, row.size(), file);
+	}
+
+	bool success = !ferror(file);
+	fclose(file);
+
+	return success ? 1 : 0;
+}
+
+namespace sw
+{
+	OverdrawHeatmap getOverdrawHeatmap()
+	{
+		std::lock_guard<std::mutex> lock(heatmapMutex);
+
+		return heatmap;
+	}
+}
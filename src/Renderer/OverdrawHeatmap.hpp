@@ -0,0 +1,59 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef sw_OverdrawHeatmap_hpp
+#define sw_OverdrawHeatmap_hpp
+
+#include <stdint.h>
+
+extern "C"
+{
+	struct SwiftShaderOverdrawStatistics
+	{
+		uint64_t shadedPixels;         // Pixel shader invocations, counting the covered pixels of each quad
+		uint64_t lateRejectedPixels;   // Shaded pixels which then failed the depth or stencil test
+		uint64_t touchedPixels;        // Pixels shaded at least once
+		unsigned int maxShaded;        // Most shader invocations of a single pixel
+	};
+
+	// Counts how often the pixel shader ran for each pixel of the render targets, and how many of
+	// those fragments a late depth or stencil test rejected. The rendered output doesn't change.
+	// Draws to targets larger than width by height aren't counted. Zero dimensions disable it, and
+	// growing them restarts the counts.
+	void swiftshaderEnableOverdrawHeatmap(int width, int height);
+	void swiftshaderResetOverdrawHeatmap();   // Call while no draw calls are in flight, e.g. after glFinish()
+	void swiftshaderGetOverdrawStatistics(SwiftShaderOverdrawStatistics *statistics);
+
+	// Writes a binary PPM of the shader invocations, or of the late rejections, per pixel.
+	// Black is none, and blue through red is one to eight or more. Returns 0 on failure.
+	int swiftshaderWriteOverdrawHeatmap(const char *path, int lateRejections);
+}
+
+namespace sw
+{
+	// Each counter holds the shader invocations of a pixel in the low 16 bits, and its late
+	// rejections in the high 16 bits. Once allocated, counters stay valid after disabling.
+	struct OverdrawHeatmap
+	{
+		bool enabled;
+		unsigned int *counters;
+		int width;
+		int height;
+		int pitch;   // In counters
+	};
+
+	OverdrawHeatmap getOverdrawHeatmap();
+}
+
+#endif   // sw_OverdrawHeatmap_hpp
@@ -0,0 +1,94 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "PipelineStatistics.hpp"
+
+#include "Main/Config.hpp"
+#include "Common/Timer.hpp"
+
+namespace
+{
+	std::atomic<int64_t> counters[sw::MAX_THREAD_COUNT][sw::PIPELINE_COUNTER_COUNT];
+	std::atomic<uint64_t> draws;
+
+	uint64_t microseconds(int64_t counter)
+	{
+		return (uint64_t)((double)counter * 1.0e6 / (double)sw::Timer::frequency());
+	}
+}
+
+static_assert(sizeof(SwiftShaderPipelineStatistics::thread) / sizeof(SwiftShaderThreadStatistics) == sw::MAX_THREAD_COUNT,
+              "Thread statistics don't match MAX_THREAD_COUNT");
+
+extern "C" void swiftshaderEnablePipelineStatistics(int enable)
+{
+	sw::pipelineStatisticsEnabled = (enable != 0);
+}
+
+extern "C" void swiftshaderResetPipelineStatistics()
+{
+	for(int thread = 0; thread < sw::MAX_THREAD_COUNT; thread++)
+	{
+		for(int counter = 0; counter < sw::PIPELINE_COUNTER_COUNT; counter++)
+		{
+			counters[thread][counter] = 0;
+		}
+	}
+
+	draws = 0;
+}
+
+extern "C" void swiftshaderGetPipelineStatistics(SwiftShaderPipelineStatistics *statistics)
+{
+	if(!statistics)
+	{
+		return;
+	}
+
+	statistics->draws = draws;
+
+	for(int thread = 0; thread < sw::MAX_THREAD_COUNT; thread++)
+	{
+		SwiftShaderThreadStatistics &s = statistics->thread[thread];
+		const std::atomic<int64_t> *c = counters[thread];
+
+		s.vertexMicroseconds = microseconds(c[sw::VERTEX_TIME]);
+		s.setupMicroseconds = microseconds(c[sw::SETUP_TIME]);
+		s.pixelMicroseconds = microseconds(c[sw::PIXEL_TIME]);
+		s.primitives = c[sw::PRIMITIVE_COUNT];
+		s.pixels = c[sw::PIXEL_COUNT];
+		s.primitiveTasks = c[sw::PRIMITIVE_TASKS];
+		s.pixelTasks = c[sw::PIXEL_TASKS];
+	}
+}
+
+namespace sw
+{
+	std::atomic<bool> pipelineStatisticsEnabled(PERF_HUD != 0);
+
+	void countPipelineStatistic(int thread, PipelineCounter counter, int64_t value)
+	{
+		counters[thread][counter].fetch_add(value, std::memory_order_relaxed);
+	}
+
+	void countDrawCall()
+	{
+		draws.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	int64_t getPipelineStatistic(int thread, PipelineCounter counter)
+	{
+		return counters[thread][counter];
+	}
+}
@@ -0,0 +1,75 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef sw_PipelineStatistics_hpp
+#define sw_PipelineStatistics_hpp
+
+#include <atomic>
+#include <stdint.h>
+
+extern "C"
+{
+	// Counters of one worker thread, accumulated while pipeline statistics
+	// are enabled. Renderers sharing a thread index add to the same counters.
+	struct SwiftShaderThreadStatistics
+	{
+		uint64_t vertexMicroseconds;   // Vertex processing and primitive assembly
+		uint64_t setupMicroseconds;    // Clipping, culling and triangle setup
+		uint64_t pixelMicroseconds;    // Rasterization and pixel processing
+		uint64_t primitives;           // Primitives entering the pipeline
+		uint64_t pixels;               // Samples passing the depth and stencil tests
+		uint64_t primitiveTasks;
+		uint64_t pixelTasks;
+	};
+
+	struct SwiftShaderPipelineStatistics
+	{
+		uint64_t draws;   // Draw calls submitted, also counted while disabled
+		SwiftShaderThreadStatistics thread[128];   // Indexed by worker thread, up to MAX_THREAD_COUNT
+	};
+
+	void swiftshaderEnablePipelineStatistics(int enable);
+	void swiftshaderResetPipelineStatistics();
+	void swiftshaderGetPipelineStatistics(SwiftShaderPipelineStatistics *statistics);
+}
+
+namespace sw
+{
+	enum PipelineCounter
+	{
+		VERTEX_TIME,   // In Timer::counter() units
+		SETUP_TIME,
+		PIXEL_TIME,
+		PRIMITIVE_COUNT,
+		PIXEL_COUNT,
+		PRIMITIVE_TASKS,
+		PIXEL_TASKS,
+
+		PIPELINE_COUNTER_COUNT
+	};
+
+	extern std::atomic<bool> pipelineStatisticsEnabled;
+
+	// A relaxed load, cheap enough to test for every task when disabled
+	inline bool pipelineStatistics()
+	{
+		return pipelineStatisticsEnabled.load(std::memory_order_relaxed);
+	}
+
+	void countPipelineStatistic(int thread, PipelineCounter counter, int64_t value);
+	void countDrawCall();
+	int64_t getPipelineStatistic(int thread, PipelineCounter counter);
+}
+
+#endif   // sw_PipelineStatistics_hpp
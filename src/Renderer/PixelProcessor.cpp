@@ -15,11 +15,15 @@
 #include "PixelProcessor.hpp"
 
 #include "Surface.hpp"
+#include "RoutineStatistics.hpp"
+#include "PipelineStatistics.hpp"
+#include "OverdrawHeatmap.hpp"
 #include "Primitive.hpp"
 #include "Shader/PixelPipeline.hpp"
 #include "Shader/PixelProgram.hpp"
 #include "Shader/PixelShader.hpp"
 #include "Shader/Constants.hpp"
+#include "Common/Trace.hpp"
 #include "Common/Debug.hpp"
 
 #include <string.h>
@@ -27,8 +31,12 @@
 namespace sw
 {
 	extern bool complementaryDepthBuffer;
+	extern bool booleanFaceRegister;
 	extern TransparencyAntialiasing transparencyAntialiasing;
 	extern bool perspectiveCorrection;
+	extern bool mediumPrecisionMath;
+	extern bool tiledRasterization;
+	extern bool coarseDepthCulling;
 
 	bool precachePixel = false;
 
@@ -78,8 +86,11 @@ namespace sw
 
 	PixelProcessor::~PixelProcessor()
 	{
-		delete routineCache;
-		routineCache = 0;
+		if(routineCache)
+		{
+			routineCache->release();
+			routineCache = 0;
+		}
 	}
 
 	void PixelProcessor::setFloatConstant(unsigned int index, const float value[4])
@@ -161,19 +172,22 @@ namespace sw
 
 	void PixelProcessor::setRenderTarget(int index, Surface *renderTarget, unsigned int layer)
 	{
-		context->renderTarget[index] = renderTarget;
+		context->setState(context->renderTarget[index], renderTarget);
+		context->setState(context->renderTargetFormat[index], renderTarget);
 		context->renderTargetLayer[index] = layer;
 	}
 
 	void PixelProcessor::setDepthBuffer(Surface *depthBuffer, unsigned int layer)
 	{
-		context->depthBuffer = depthBuffer;
+		context->setState(context->depthBuffer, depthBuffer);
+		context->setState(context->depthBufferFormat, depthBuffer);
 		context->depthBufferLayer = layer;
 	}
 
 	void PixelProcessor::setStencilBuffer(Surface *stencilBuffer, unsigned int layer)
 	{
-		context->stencilBuffer = stencilBuffer;
+		context->setState(context->stencilBuffer, stencilBuffer);
+		context->setState(context->stencilBufferFormat, stencilBuffer);
 		context->stencilBufferLayer = layer;
 	}
 
@@ -181,7 +195,7 @@ namespace sw
 	{
 		if(stage < 8)
 		{
-			context->textureStage[stage].setTexCoordIndex(texCoordIndex);
+			context->stateModified |= context->textureStage[stage].setTexCoordIndex(texCoordIndex);
 		}
 		else ASSERT(false);
 	}
@@ -190,7 +204,7 @@ namespace sw
 	{
 		if(stage < 8)
 		{
-			context->textureStage[stage].setStageOperation(stageOperation);
+			context->stateModified |= context->textureStage[stage].setStageOperation(stageOperation);
 		}
 		else ASSERT(false);
 	}
@@ -199,7 +213,7 @@ namespace sw
 	{
 		if(stage < 8)
 		{
-			context->textureStage[stage].setFirstArgument(firstArgument);
+			context->stateModified |= context->textureStage[stage].setFirstArgument(firstArgument);
 		}
 		else ASSERT(false);
 	}
@@ -208,7 +222,7 @@ namespace sw
 	{
 		if(stage < 8)
 		{
-			context->textureStage[stage].setSecondArgument(secondArgument);
+			context->stateModified |= context->textureStage[stage].setSecondArgument(secondArgument);
 		}
 		else ASSERT(false);
 	}
@@ -217,7 +231,7 @@ namespace sw
 	{
 		if(stage < 8)
 		{
-			context->textureStage[stage].setThirdArgument(thirdArgument);
+			context->stateModified |= context->textureStage[stage].setThirdArgument(thirdArgument);
 		}
 		else ASSERT(false);
 	}
@@ -226,7 +240,7 @@ namespace sw
 	{
 		if(stage < 8)
 		{
-			context->textureStage[stage].setStageOperationAlpha(stageOperationAlpha);
+			context->stateModified |= context->textureStage[stage].setStageOperationAlpha(stageOperationAlpha);
 		}
 		else ASSERT(false);
 	}
@@ -235,7 +249,7 @@ namespace sw
 	{
 		if(stage < 8)
 		{
-			context->textureStage[stage].setFirstArgumentAlpha(firstArgumentAlpha);
+			context->stateModified |= context->textureStage[stage].setFirstArgumentAlpha(firstArgumentAlpha);
 		}
 		else ASSERT(false);
 	}
@@ -244,7 +258,7 @@ namespace sw
 	{
 		if(stage < 8)
 		{
-			context->textureStage[stage].setSecondArgumentAlpha(secondArgumentAlpha);
+			context->stateModified |= context->textureStage[stage].setSecondArgumentAlpha(secondArgumentAlpha);
 		}
 		else ASSERT(false);
 	}
@@ -253,7 +267,7 @@ namespace sw
 	{
 		if(stage < 8)
 		{
-			context->textureStage[stage].setThirdArgumentAlpha(thirdArgumentAlpha);
+			context->stateModified |= context->textureStage[stage].setThirdArgumentAlpha(thirdArgumentAlpha);
 		}
 		else ASSERT(false);
 	}
@@ -262,7 +276,7 @@ namespace sw
 	{
 		if(stage < 8)
 		{
-			context->textureStage[stage].setFirstModifier(firstModifier);
+			context->stateModified |= context->textureStage[stage].setFirstModifier(firstModifier);
 		}
 		else ASSERT(false);
 	}
@@ -271,7 +285,7 @@ namespace sw
 	{
 		if(stage < 8)
 		{
-			context->textureStage[stage].setSecondModifier(secondModifier);
+			context->stateModified |= context->textureStage[stage].setSecondModifier(secondModifier);
 		}
 		else ASSERT(false);
 	}
@@ -280,7 +294,7 @@ namespace sw
 	{
 		if(stage < 8)
 		{
-			context->textureStage[stage].setThirdModifier(thirdModifier);
+			context->stateModified |= context->textureStage[stage].setThirdModifier(thirdModifier);
 		}
 		else ASSERT(false);
 	}
@@ -289,7 +303,7 @@ namespace sw
 	{
 		if(stage < 8)
 		{
-			context->textureStage[stage].setFirstModifierAlpha(firstModifierAlpha);
+			context->stateModified |= context->textureStage[stage].setFirstModifierAlpha(firstModifierAlpha);
 		}
 		else ASSERT(false);
 	}
@@ -298,7 +312,7 @@ namespace sw
 	{
 		if(stage < 8)
 		{
-			context->textureStage[stage].setSecondModifierAlpha(secondModifierAlpha);
+			context->stateModified |= context->textureStage[stage].setSecondModifierAlpha(secondModifierAlpha);
 		}
 		else ASSERT(false);
 	}
@@ -307,7 +321,7 @@ namespace sw
 	{
 		if(stage < 8)
 		{
-			context->textureStage[stage].setThirdModifierAlpha(thirdModifierAlpha);
+			context->stateModified |= context->textureStage[stage].setThirdModifierAlpha(thirdModifierAlpha);
 		}
 		else ASSERT(false);
 	}
@@ -316,7 +330,7 @@ namespace sw
 	{
 		if(stage < 8)
 		{
-			context->textureStage[stage].setDestinationArgument(destinationArgument);
+			context->stateModified |= context->textureStage[stage].setDestinationArgument(destinationArgument);
 		}
 		else ASSERT(false);
 	}
@@ -361,7 +375,7 @@ namespace sw
 	{
 		if(sampler < TEXTURE_IMAGE_UNITS)
 		{
-			context->sampler[sampler].setTextureFilter(textureFilter);
+			context->stateModified |= context->sampler[sampler].setTextureFilter(textureFilter);
 		}
 		else ASSERT(false);
 	}
@@ -370,7 +384,7 @@ namespace sw
 	{
 		if(sampler < TEXTURE_IMAGE_UNITS)
 		{
-			context->sampler[sampler].setMipmapFilter(mipmapFilter);
+			context->stateModified |= context->sampler[sampler].setMipmapFilter(mipmapFilter);
 		}
 		else ASSERT(false);
 	}
@@ -379,7 +393,7 @@ namespace sw
 	{
 		if(sampler < TEXTURE_IMAGE_UNITS)
 		{
-			context->sampler[sampler].setGatherEnable(enable);
+			context->stateModified |= context->sampler[sampler].setGatherEnable(enable);
 		}
 		else ASSERT(false);
 	}
@@ -388,7 +402,7 @@ namespace sw
 	{
 		if(sampler < TEXTURE_IMAGE_UNITS)
 		{
-			context->sampler[sampler].setAddressingModeU(addressMode);
+			context->stateModified |= context->sampler[sampler].setAddressingModeU(addressMode);
 		}
 		else ASSERT(false);
 	}
@@ -397,7 +411,7 @@ namespace sw
 	{
 		if(sampler < TEXTURE_IMAGE_UNITS)
 		{
-			context->sampler[sampler].setAddressingModeV(addressMode);
+			context->stateModified |= context->sampler[sampler].setAddressingModeV(addressMode);
 		}
 		else ASSERT(false);
 	}
@@ -406,7 +420,7 @@ namespace sw
 	{
 		if(sampler < TEXTURE_IMAGE_UNITS)
 		{
-			context->sampler[sampler].setAddressingModeW(addressMode);
+			context->stateModified |= context->sampler[sampler].setAddressingModeW(addressMode);
 		}
 		else ASSERT(false);
 	}
@@ -415,7 +429,7 @@ namespace sw
 	{
 		if(sampler < TEXTURE_IMAGE_UNITS)
 		{
-			context->sampler[sampler].setReadSRGB(sRGB);
+			context->stateModified |= context->sampler[sampler].setReadSRGB(sRGB);
 		}
 		else ASSERT(false);
 	}
@@ -442,7 +456,7 @@ namespace sw
 	{
 		if(sampler < TEXTURE_IMAGE_UNITS)
 		{
-			context->sampler[sampler].setMaxAnisotropy(maxAnisotropy);
+			context->stateModified |= context->sampler[sampler].setMaxAnisotropy(maxAnisotropy);
 		}
 		else ASSERT(false);
 	}
@@ -451,7 +465,7 @@ namespace sw
 	{
 		if(sampler < TEXTURE_IMAGE_UNITS)
 		{
-			context->sampler[sampler].setHighPrecisionFiltering(highPrecisionFiltering);
+			context->stateModified |= context->sampler[sampler].setHighPrecisionFiltering(highPrecisionFiltering);
 		}
 		else ASSERT(false);
 	}
@@ -460,7 +474,7 @@ namespace sw
 	{
 		if(sampler < TEXTURE_IMAGE_UNITS)
 		{
-			context->sampler[sampler].setSwizzleR(swizzleR);
+			context->stateModified |= context->sampler[sampler].setSwizzleR(swizzleR);
 		}
 		else ASSERT(false);
 	}
@@ -469,7 +483,7 @@ namespace sw
 	{
 		if(sampler < TEXTURE_IMAGE_UNITS)
 		{
-			context->sampler[sampler].setSwizzleG(swizzleG);
+			context->stateModified |= context->sampler[sampler].setSwizzleG(swizzleG);
 		}
 		else ASSERT(false);
 	}
@@ -478,7 +492,7 @@ namespace sw
 	{
 		if(sampler < TEXTURE_IMAGE_UNITS)
 		{
-			context->sampler[sampler].setSwizzleB(swizzleB);
+			context->stateModified |= context->sampler[sampler].setSwizzleB(swizzleB);
 		}
 		else ASSERT(false);
 	}
@@ -487,7 +501,7 @@ namespace sw
 	{
 		if(sampler < TEXTURE_IMAGE_UNITS)
 		{
-			context->sampler[sampler].setSwizzleA(swizzleA);
+			context->stateModified |= context->sampler[sampler].setSwizzleA(swizzleA);
 		}
 		else ASSERT(false);
 	}
@@ -496,7 +510,7 @@ namespace sw
 	{
 		if(sampler < TEXTURE_IMAGE_UNITS)
 		{
-			context->sampler[sampler].setCompareFunc(compFunc);
+			context->stateModified |= context->sampler[sampler].setCompareFunc(compFunc);
 		}
 		else ASSERT(false);
 	}
@@ -523,7 +537,7 @@ namespace sw
 	{
 		if(sampler < TEXTURE_IMAGE_UNITS)
 		{
-			context->sampler[sampler].setMinLod(minLod);
+			context->stateModified |= context->sampler[sampler].setMinLod(minLod);
 		}
 		else ASSERT(false);
 	}
@@ -532,7 +546,7 @@ namespace sw
 	{
 		if(sampler < TEXTURE_IMAGE_UNITS)
 		{
-			context->sampler[sampler].setMaxLod(maxLod);
+			context->stateModified |= context->sampler[sampler].setMaxLod(maxLod);
 		}
 		else ASSERT(false);
 	}
@@ -568,28 +582,28 @@ namespace sw
 
 	void PixelProcessor::setDepthCompare(DepthCompareMode depthCompareMode)
 	{
-		context->depthCompareMode = depthCompareMode;
+		context->setState(context->depthCompareMode, depthCompareMode);
 	}
 
 	void PixelProcessor::setAlphaCompare(AlphaCompareMode alphaCompareMode)
 	{
-		context->alphaCompareMode = alphaCompareMode;
+		context->setState(context->alphaCompareMode, alphaCompareMode);
 	}
 
 	void PixelProcessor::setDepthWriteEnable(bool depthWriteEnable)
 	{
-		context->depthWriteEnable = depthWriteEnable;
+		context->setState(context->depthWriteEnable, depthWriteEnable);
 	}
 
 	void PixelProcessor::setAlphaTestEnable(bool alphaTestEnable)
 	{
-		context->alphaTestEnable = alphaTestEnable;
+		context->setState(context->alphaTestEnable, alphaTestEnable);
 	}
 
 	void PixelProcessor::setCullMode(CullMode cullMode, bool frontFacingCCW)
 	{
-		context->cullMode = cullMode;
-		context->frontFacingCCW = frontFacingCCW;
+		context->setState(context->cullMode, cullMode);
+		context->setState(context->frontFacingCCW, frontFacingCCW);
 	}
 
 	void PixelProcessor::setColorWriteMask(int index, int rgbaMask)
@@ -599,12 +613,12 @@ namespace sw
 
 	void PixelProcessor::setStencilEnable(bool stencilEnable)
 	{
-		context->stencilEnable = stencilEnable;
+		context->setState(context->stencilEnable, stencilEnable);
 	}
 
 	void PixelProcessor::setStencilCompare(StencilCompareMode stencilCompareMode)
 	{
-		context->stencilCompareMode = stencilCompareMode;
+		context->setState(context->stencilCompareMode, stencilCompareMode);
 	}
 
 	void PixelProcessor::setStencilReference(int stencilReference)
@@ -621,66 +635,66 @@ namespace sw
 
 	void PixelProcessor::setStencilMask(int stencilMask)
 	{
-		context->stencilMask = stencilMask;
+		context->setState(context->stencilMask, stencilMask);
 		stencil.set(context->stencilReference, stencilMask, context->stencilWriteMask);
 	}
 
 	void PixelProcessor::setStencilMaskCCW(int stencilMaskCCW)
 	{
-		context->stencilMaskCCW = stencilMaskCCW;
+		context->setState(context->stencilMaskCCW, stencilMaskCCW);
 		stencilCCW.set(context->stencilReferenceCCW, stencilMaskCCW, context->stencilWriteMaskCCW);
 	}
 
 	void PixelProcessor::setStencilFailOperation(StencilOperation stencilFailOperation)
 	{
-		context->stencilFailOperation = stencilFailOperation;
+		context->setState(context->stencilFailOperation, stencilFailOperation);
 	}
 
 	void PixelProcessor::setStencilPassOperation(StencilOperation stencilPassOperation)
 	{
-		context->stencilPassOperation = stencilPassOperation;
+		context->setState(context->stencilPassOperation, stencilPassOperation);
 	}
 
 	void PixelProcessor::setStencilZFailOperation(StencilOperation stencilZFailOperation)
 	{
-		context->stencilZFailOperation = stencilZFailOperation;
+		context->setState(context->stencilZFailOperation, stencilZFailOperation);
 	}
 
 	void PixelProcessor::setStencilWriteMask(int stencilWriteMask)
 	{
-		context->stencilWriteMask = stencilWriteMask;
+		context->setState(context->stencilWriteMask, stencilWriteMask);
 		stencil.set(context->stencilReference, context->stencilMask, stencilWriteMask);
 	}
 
 	void PixelProcessor::setStencilWriteMaskCCW(int stencilWriteMaskCCW)
 	{
-		context->stencilWriteMaskCCW = stencilWriteMaskCCW;
+		context->setState(context->stencilWriteMaskCCW, stencilWriteMaskCCW);
 		stencilCCW.set(context->stencilReferenceCCW, context->stencilMaskCCW, stencilWriteMaskCCW);
 	}
 
 	void PixelProcessor::setTwoSidedStencil(bool enable)
 	{
-		context->twoSidedStencil = enable;
+		context->setState(context->twoSidedStencil, enable);
 	}
 
 	void PixelProcessor::setStencilCompareCCW(StencilCompareMode stencilCompareMode)
 	{
-		context->stencilCompareModeCCW = stencilCompareMode;
+		context->setState(context->stencilCompareModeCCW, stencilCompareMode);
 	}
 
 	void PixelProcessor::setStencilFailOperationCCW(StencilOperation stencilFailOperation)
 	{
-		context->stencilFailOperationCCW = stencilFailOperation;
+		context->setState(context->stencilFailOperationCCW, stencilFailOperation);
 	}
 
 	void PixelProcessor::setStencilPassOperationCCW(StencilOperation stencilPassOperation)
 	{
-		context->stencilPassOperationCCW = stencilPassOperation;
+		context->setState(context->stencilPassOperationCCW, stencilPassOperation);
 	}
 
 	void PixelProcessor::setStencilZFailOperationCCW(StencilOperation stencilZFailOperation)
 	{
-		context->stencilZFailOperationCCW = stencilZFailOperation;
+		context->setState(context->stencilZFailOperationCCW, stencilZFailOperation);
 	}
 
 	void PixelProcessor::setTextureFactor(const Color<float> &textureFactor)
@@ -809,12 +823,12 @@ namespace sw
 
 	void PixelProcessor::setFillMode(FillMode fillMode)
 	{
-		context->fillMode = fillMode;
+		context->setState(context->fillMode, fillMode);
 	}
 
 	void PixelProcessor::setShadingMode(ShadingMode shadingMode)
 	{
-		context->shadingMode = shadingMode;
+		context->setState(context->shadingMode, shadingMode);
 	}
 
 	void PixelProcessor::setAlphaBlendEnable(bool alphaBlendEnable)
@@ -917,7 +931,7 @@ namespace sw
 
 	void PixelProcessor::setPixelFogMode(FogMode fogMode)
 	{
-		context->pixelFogMode = fogMode;
+		context->setState(context->pixelFogMode, fogMode);
 	}
 
 	void PixelProcessor::setPerspectiveCorrection(bool perspectiveEnable)
@@ -927,13 +941,17 @@ namespace sw
 
 	void PixelProcessor::setOcclusionEnabled(bool enable)
 	{
-		context->occlusionEnabled = enable;
+		context->setState(context->occlusionEnabled, enable);
 	}
 
 	void PixelProcessor::setRoutineCacheSize(int cacheSize)
 	{
-		delete routineCache;
-		routineCache = new RoutineCache<State>(clamp(cacheSize, 1, 65536), precachePixel ? "sw-pixel" : 0);
+		if(routineCache)
+		{
+			routineCache->release();
+		}
+
+		routineCache = RoutineCache<State>::acquire(clamp(cacheSize, 1, 65536), "pixel", precachePixel ? "sw-pixel" : 0);
 	}
 
 	void PixelProcessor::setFogRanges(float start, float end)
@@ -953,13 +971,42 @@ namespace sw
 		fog.offset = replicate(fogOffset);
 	}
 
+	bool PixelProcessor::overdrawHeatmapActive() const
+	{
+		OverdrawHeatmap heatmap = getOverdrawHeatmap();
+
+		if(!heatmap.enabled)
+		{
+			return false;
+		}
+
+		bool active = false;
+
+		for(int index = 0; index < RENDERTARGETS; index++)
+		{
+			Surface *target = context->renderTarget[index];
+
+			if(target)
+			{
+				if(target->getWidth() > heatmap.width || target->getHeight() > heatmap.height)
+				{
+					return false;
+				}
+
+				active = true;
+			}
+		}
+
+		return active;
+	}
+
 	const PixelProcessor::State PixelProcessor::update() const
 	{
 		State state;
 
 		if(context->pixelShader)
 		{
-			state.shaderID = context->pixelShader->getSerialID();
+			state.shaderID = context->pixelShader->getContentID();   // Shared by identical shaders, also across contexts
 		}
 		else
 		{
@@ -968,6 +1015,8 @@ namespace sw
 
 		state.depthOverride = context->pixelShader && context->pixelShader->depthOverride();
 		state.shaderContainsKill = context->pixelShader ? context->pixelShader->containsKill() : false;
+		state.fastMath = context->pixelShader && context->pixelShader->isFastMath();
+		state.mediumPrecisionMath = context->pixelShader && mediumPrecisionMath;
 
 		if(context->alphaTestActive())
 		{
@@ -978,6 +1027,10 @@ namespace sw
 
 		state.depthWriteEnable = context->depthWriteActive();
 
+		// Discard, alpha test and alpha-to-coverage only remove pixels from the coverage mask, which gets
+		// applied to the depth and stencil masks after shading, so only a shader depth output requires late testing.
+		state.earlyDepthTest = !state.depthOverride;
+
 		if(context->stencilActive())
 		{
 			state.stencilActive = true;
@@ -1004,9 +1057,20 @@ namespace sw
 			state.depthTestActive = true;
 			state.depthCompareMode = context->depthCompareMode;
 			state.quadLayoutDepthBuffer = Surface::hasQuadLayout(context->depthBuffer->getInternalFormat());
+			state.depthBuffer16 = context->depthBuffer->getInternalFormat() == FORMAT_D16;
+
+			if(context->getMultiSampleCount() == 1 && context->depthBuffer->hasCoarseDepth())
+			{
+				// Tiles are only rejected when no stencil or shader depth output can affect the outcome
+				state.coarseDepthActive = true;
+				state.coarseDepthTest = coarseDepthCulling && !complementaryDepthBuffer && !state.depthOverride && !state.stencilActive &&
+				                        (state.depthCompareMode == DEPTH_LESS || state.depthCompareMode == DEPTH_LESSEQUAL);
+			}
 		}
 
-		state.occlusionEnabled = context->occlusionEnabled;
+		state.occlusionEnabled = context->occlusionEnabled || pipelineStatistics();   // Statistics count the shaded pixels
+		state.overdrawHeatmap = overdrawHeatmapActive();
+		state.tiledRasterization = tiledRasterization;
 
 		state.fogActive = context->fogActive();
 		state.pixelFogMode = context->pixelFogActive();
@@ -1036,6 +1100,15 @@ namespace sw
 		state.writeSRGB	= context->writeSRGB && context->renderTarget[0] && Surface::isSRGBwritable(context->renderTarget[0]->getExternalFormat());
 		state.multiSample = context->getMultiSampleCount();
 		state.multiSampleMask = context->multiSampleMask;
+		state.uniformSamples = state.multiSample > 1;
+
+		for(int i = 0; i < RENDERTARGETS; i++)
+		{
+			if(state.colorWriteActive(i) && !context->renderTarget[i]->hasUniformSamples())
+			{
+				state.uniformSamples = false;
+			}
+		}
 
 		if(state.multiSample > 1 && context->pixelShader)
 		{
@@ -1177,34 +1250,149 @@ namespace sw
 			}
 		}
 
+		canonicalize(state, context->pixelShader);
+
 		state.hash = state.computeHash();
 
 		return state;
 	}
 
-	Routine *PixelProcessor::routine(const State &state)
+	void PixelProcessor::canonicalize(State &state, const PixelShader *shader)
 	{
-		Routine *routine = routineCache->query(state);
+		// Reset fields the pixel routine won't read, so draws which only differ
+		// in irrelevant state share the same routine.
+		if(!shader || !shader->isVFaceDeclared() || !booleanFaceRegister)
+		{
+			state.frontFaceCCW = false;
+		}
 
-		if(!routine)
+		for(int i = 0; i < RENDERTARGETS; i++)
 		{
-			const bool integerPipeline = (context->pixelShaderModel() <= 0x0104);
-			QuadRasterizer *generator = nullptr;
+			bool alphaTested = (i == 0) && state.alphaTestActive();   // Alpha testing reads the format of the first target
 
-			if(integerPipeline)
+			if(!state.colorWriteActive(i) && !alphaTested)
 			{
-				generator = new PixelPipeline(state, context->pixelShader);
+				state.targetFormat[i] = FORMAT_NULL;
 			}
-			else
+		}
+
+		if(state.colorWriteMask == 0)   // No color output, so blending doesn't get generated
+		{
+			// Same as update() leaves them when blending is inactive
+			state.alphaBlendActive = false;
+			state.sourceBlendFactor = BlendFactor();
+			state.destBlendFactor = BlendFactor();
+			state.blendOperation = BlendOperation();
+			state.sourceBlendFactorAlpha = BlendFactor();
+			state.destBlendFactorAlpha = BlendFactor();
+			state.blendOperationAlpha = BlendOperation();
+			state.logicalOperation = LOGICALOP_COPY;
+			state.writeSRGB = false;
+			state.uniformSamples = false;
+		}
+
+		// Depth prepasses and shadow maps only test and write depth and stencil, and count occlusion,
+		// so every shader shares one routine which doesn't interpolate, sample or shade anything.
+		if(state.colorWriteMask == 0 && !state.alphaTestActive() && !state.shaderContainsKill && !state.depthOverride)
+		{
+			state.depthOnly = true;
+			state.shaderID = 0;
+			state.fastMath = false;
+			state.mediumPrecisionMath = false;
+			state.fogActive = false;
+			state.pixelFogMode = FOG_NONE;
+			state.wBasedFog = false;
+			state.specularAdd = false;
+			state.perspective = false;
+			state.centroid = false;
+			state.frontFaceCCW = false;
+
+			for(int i = 0; i < TEXTURE_IMAGE_UNITS; i++)
 			{
-				generator = new PixelProgram(state, context->pixelShader);
+				state.sampler[i] = Sampler::State();
 			}
 
-			generator->generate();
-			routine = (*generator)(L"PixelRoutine_%0.8X", state.shaderID);
-			delete generator;
+			for(int i = 0; i < 8; i++)
+			{
+				state.textureStage[i] = TextureStage::State();
+			}
+
+			memset(state.interpolant, 0, sizeof(state.interpolant));
+		}
+	}
+
+	Routine *PixelProcessor::routine(const State &state)
+	{
+		Routine *routine = findRoutine(state);
+
+		if(!routine)
+		{
+			routine = addRoutine(state, generateRoutine(state, context->pixelShader));
+		}
 
-			routineCache->add(state, routine);
+		return routine;
+	}
+
+	Routine *PixelProcessor::findRoutine(const State &state)
+	{
+		Routine *routine = routineCache->query(state, shaderContent(state));
+		countRoutineCacheQuery(PIXEL_ROUTINE_CACHE, routine != nullptr);
+
+		return routine;
+	}
+
+	Routine *PixelProcessor::addRoutine(const State &state, Routine *routine)
+	{
+		return routineCache->add(state, routine, shaderContent(state));
+	}
+
+	ShaderContent PixelProcessor::shaderContent(const State &state) const
+	{
+		// The state only holds the shader's content ID
+		return (state.shaderID && context->pixelShader) ? context->pixelShader->getContent() : nullptr;
+	}
+
+	Routine *PixelProcessor::generateRoutine(const State &state, const PixelShader *shader)
+	{
+		Routine *cached = PersistentRoutineCache::loadPacked("sw-pixel", &state, sizeof(State));
+
+		if(!cached && precachePixel)
+		{
+			cached = PersistentRoutineCache::load("sw-pixel", &state, sizeof(State));
+		}
+
+		if(cached)
+		{
+			return cached;
+		}
+
+		if(state.depthOnly)
+		{
+			shader = nullptr;   // Not executed
+		}
+
+		const bool integerPipeline = (!shader || shader->getShaderModel() <= 0x0104);
+		TraceScope scope("Compile pixel routine");
+
+		QuadRasterizer *generator = nullptr;
+
+		if(integerPipeline)
+		{
+			generator = new PixelPipeline(state, shader);
+		}
+		else
+		{
+			generator = new PixelProgram(state, shader);
+		}
+
+		generator->generate();
+		Nucleus::setRoutineCategory(RoutinePixel);
+		Routine *routine = (*generator)(L"PixelRoutine_%0.8X", (unsigned int)state.shaderID);
+		delete generator;
+
+		if(precachePixel)
+		{
+			PersistentRoutineCache::store("sw-pixel", &state, sizeof(State), routine);
 		}
 
 		return routine;
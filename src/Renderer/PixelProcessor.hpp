@@ -17,6 +17,7 @@
 
 #include "Context.hpp"
 #include "RoutineCache.hpp"
+#include "Shader/Shader.hpp"
 
 namespace sw
 {
@@ -32,15 +33,24 @@ namespace sw
 		{
 			unsigned int computeHash();
 
-			int shaderID;
+			uint64_t shaderID;
+			bool specialized;                                      // The branch uniforms are folded into the shader
+			float4 specialization[Shader::MAX_BRANCH_CONSTANTS];   // Their values, in Shader::getBranchConstants() order
 
 			bool depthOverride                        : 1;   // TODO: Eliminate by querying shader.
 			bool shaderContainsKill                   : 1;   // TODO: Eliminate by querying shader.
+			bool fastMath                             : 1;
+			bool mediumPrecisionMath                  : 1;
+			bool earlyDepthTest                       : 1;   // Depth can be tested before shading.
+			bool depthOnly                            : 1;   // No color output, discard or depth export, so the shader doesn't run.
 
 			DepthCompareMode depthCompareMode         : BITS(DEPTH_LAST);
 			AlphaCompareMode alphaCompareMode         : BITS(ALPHA_LAST);
 			bool depthWriteEnable                     : 1;
 			bool quadLayoutDepthBuffer                : 1;
+			bool depthBuffer16                        : 1;   // FORMAT_D16, 16-bit unsigned normalized
+			bool coarseDepthActive                    : 1;
+			bool coarseDepthTest                      : 1;
 
 			bool stencilActive                        : 1;
 			StencilCompareMode stencilCompareMode     : BITS(STENCIL_LAST);
@@ -64,6 +74,8 @@ namespace sw
 			FogMode pixelFogMode                      : BITS(FOG_LAST);
 			bool specularAdd                          : 1;
 			bool occlusionEnabled                     : 1;
+			bool overdrawHeatmap                      : 1;   // Counts shader invocations and late rejections per pixel
+			bool tiledRasterization                   : 1;
 			bool wBasedFog                            : 1;
 			bool perspective                          : 1;
 			bool depthClamp                           : 1;
@@ -84,6 +96,7 @@ namespace sw
 			TransparencyAntialiasing transparencyAntialiasing : BITS(TRANSPARENCY_LAST);
 			bool centroid                                     : 1;
 			bool frontFaceCCW                                 : 1;
+			bool uniformSamples                               : 1;   // Render targets track quads with equal samples
 
 			LogicalOperation logicalOperation : BITS(LOGICALOP_LAST);
 
@@ -306,7 +319,13 @@ namespace sw
 
 	protected:
 		const State update() const;
+		// The returned routines are bound, and have to be unbound by the caller
 		Routine *routine(const State &state);
+		Routine *findRoutine(const State &state);
+		Routine *addRoutine(const State &state, Routine *routine);
+		static Routine *generateRoutine(const State &state, const PixelShader *shader);
+		static void canonicalize(State &state, const PixelShader *shader);   // Clears state the routine doesn't depend on
+		bool overdrawHeatmapActive() const;   // The heatmap is enabled and covers all render targets
 		void setRoutineCacheSize(int routineCacheSize);
 
 		// Shader constants
@@ -332,6 +351,7 @@ namespace sw
 		UniformBufferInfo uniformBufferInfo[MAX_UNIFORM_BUFFER_BINDINGS];
 
 		void setFogRanges(float start, float end);
+		ShaderContent shaderContent(const State &state) const;
 
 		Context *const context;
 
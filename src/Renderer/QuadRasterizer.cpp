@@ -51,25 +51,71 @@ namespace sw
 		occlusion = 0;
 		int clusterCount = Renderer::getClusterCount();
 
-		Do
+		if(!state.tiledRasterization)
 		{
-			Int yMin = *Pointer<Int>(primitive + OFFSET(Primitive,yMin));
-			Int yMax = *Pointer<Int>(primitive + OFFSET(Primitive,yMax));
+			Do
+			{
+				Int yMin = firstClusterRow(*Pointer<Int>(primitive + OFFSET(Primitive,yMin)), clusterCount);
+				Int yMax = *Pointer<Int>(primitive + OFFSET(Primitive,yMax));
 
-			Int cluster2 = cluster + cluster;
-			yMin += clusterCount * 2 - 2 - cluster2;
-			yMin &= -clusterCount * 2;
-			yMin += cluster2;
+				If(yMin < yMax)
+				{
+					rasterize(yMin, yMax);
+				}
 
-			If(yMin < yMax)
+				primitive += sizeof(Primitive) * state.multiSample;
+				count--;
+			}
+			Until(count == 0)
+		}
+		else
+		{
+			// Draw the batch one band of rows at a time, so the render targets'
+			// rows stay cache resident while all primitives covering them are drawn.
+			const int bandRows = clusterCount * 2 * TILE_ROW_PAIRS;
+
+			Pointer<Byte> batch = primitive;
+			Int batchCount = count;
+			Int batchMin = *Pointer<Int>(primitive + OFFSET(Primitive,yMin));
+			Int batchMax = *Pointer<Int>(primitive + OFFSET(Primitive,yMax));
+
+			Do
 			{
-				rasterize(yMin, yMax);
+				batchMin = Min(batchMin, *Pointer<Int>(primitive + OFFSET(Primitive,yMin)));
+				batchMax = Max(batchMax, *Pointer<Int>(primitive + OFFSET(Primitive,yMax)));
+
+				primitive += sizeof(Primitive) * state.multiSample;
+				count--;
 			}
+			Until(count == 0)
+
+			Int band = (batchMin / bandRows) * bandRows;
+
+			While(band < batchMax)
+			{
+				Int bandEnd = band + bandRows;
 
-			primitive += sizeof(Primitive) * state.multiSample;
-			count--;
+				primitive = batch;
+				count = batchCount;
+
+				Do
+				{
+					Int yMin = firstClusterRow(Max(*Pointer<Int>(primitive + OFFSET(Primitive,yMin)), band), clusterCount);
+					Int yMax = Min(*Pointer<Int>(primitive + OFFSET(Primitive,yMax)), bandEnd);
+
+					If(yMin < yMax)
+					{
+						rasterize(yMin, yMax);
+					}
+
+					primitive += sizeof(Primitive) * state.multiSample;
+					count--;
+				}
+				Until(count == 0)
+
+				band = bandEnd;
+			}
 		}
-		Until(count == 0)
 
 		if(state.occlusionEnabled)
 		{
@@ -90,6 +136,37 @@ namespace sw
 		Return();
 	}
 
+	// Rounds up to the first pair of rows handled by this cluster
+	Int QuadRasterizer::firstClusterRow(Int y, int clusterCount)
+	{
+		Int cluster2 = cluster + cluster;
+		y += clusterCount * 2 - 2 - cluster2;
+
+		if(isPow2(clusterCount))
+		{
+			y &= -clusterCount * 2;
+		}
+		else
+		{
+			y = (y / (clusterCount * 2)) * (clusterCount * 2);
+		}
+
+		return y + cluster2;
+	}
+
+	// Distance in bytes between consecutive pairs of rows handled by the same cluster
+	static Int clusterRowsStride(Int pitchB, int clusterCount)
+	{
+		if(isPow2(clusterCount))
+		{
+			return pitchB << (1 + sw::log2(clusterCount));
+		}
+		else
+		{
+			return pitchB * (2 * clusterCount);
+		}
+	}
+
 	void QuadRasterizer::rasterize(Int &yMin, Int &yMax)
 	{
 		Pointer<Byte> cBuffer[RENDERTARGETS];
@@ -161,7 +238,7 @@ namespace sw
 
 			if(veryEarlyDepthTest && state.multiSample == 1 && !state.depthOverride)
 			{
-				if(!state.stencilActive && state.depthTestActive && (state.depthCompareMode == DEPTH_LESSEQUAL || state.depthCompareMode == DEPTH_LESS))   // FIXME: Both modes ok?
+				if(!state.stencilActive && state.depthTestActive && !state.depthBuffer16 && (state.depthCompareMode == DEPTH_LESSEQUAL || state.depthCompareMode == DEPTH_LESS))   // FIXME: Both modes ok?
 				{
 					Float4 xxxx = Float4(Float(x0)) + *Pointer<Float4>(primitive + OFFSET(Primitive,xQuad), 16);
 
@@ -276,18 +353,63 @@ namespace sw
 					xRight[q] = Swizzle(xRight[q], 0xF5) - Short4(0, 1, 0, 1);
 				}
 
-				For(Int x = x0, x < x1, x += 2)
+				if(!state.coarseDepthActive)
 				{
-					Short4 xxxx = Short4(x);
-					Int cMask[4];
+					span(cBuffer, zBuffer, sBuffer, xLeft, xRight, x0, x1, y);
+				}
+				else
+				{
+					Pointer<Byte> coarseDepth = *Pointer<Pointer<Byte>>(data + OFFSET(DrawData,coarseDepthBuffer)) + (y / Surface::COARSE_TILE_HEIGHT) * *Pointer<Int>(data + OFFSET(DrawData,coarseDepthPitchB));
 
-					for(unsigned int q = 0; q < state.multiSample; q++)
+					For(Int tileX = x0 & ~(Surface::COARSE_TILE_WIDTH - 1), tileX < x1, tileX += Surface::COARSE_TILE_WIDTH)
 					{
-						Short4 mask = CmpGT(xxxx, xLeft[q]) & CmpGT(xRight[q], xxxx);
-						cMask[q] = SignMask(PackSigned(mask, mask)) & 0x0000000F;
-					}
+						Int tileX0 = Max(x0, tileX);
+						Int tileX1 = Min(x1, tileX + Surface::COARSE_TILE_WIDTH);
+						Pointer<Byte> tileDepth = coarseDepth + (tileX / Surface::COARSE_TILE_WIDTH) * sizeof(float);
+
+						If(*Pointer<Float>(tileDepth) < Float(0.0f))   // Still has to receive a deferred clear
+						{
+							Float clearValue = *Pointer<Float>(data + OFFSET(DrawData,depthClearValue));
+
+							clearTile(zBuffer, tileX, clearValue);
+							*Pointer<Float>(tileDepth) = clearValue;
+						}
+
+						Bool visible = true;
+
+						if(state.coarseDepthTest)
+						{
+							// Depth is linear in x, so its minimum over the tile's quads lies at the first or last one
+							Float4 xFirst = Float4(Float(tileX0)) + *Pointer<Float4>(primitive + OFFSET(Primitive,xQuad), 16);
+							Float4 xLast = Float4(Float((tileX1 - 1) & 0xFFFFFFFE)) + *Pointer<Float4>(primitive + OFFSET(Primitive,xQuad), 16);
+
+							Float4 zFirst = interpolate(xFirst, Dz[0], zFirst, primitive + OFFSET(Primitive,z), false, false, state.depthClamp);
+							Float4 zLast = interpolate(xLast, Dz[0], zLast, primitive + OFFSET(Primitive,z), false, false, state.depthClamp);
+
+							Float4 zMin = Min(zFirst, zLast);
+							zMin = Min(zMin, Swizzle(zMin, 0x4E));
+							zMin = Min(zMin, Swizzle(zMin, 0xB1));
 
-					quad(cBuffer, zBuffer, sBuffer, cMask, x, y);
+							if(state.depthCompareMode == DEPTH_LESS)
+							{
+								visible = Extract(zMin, 0) < *Pointer<Float>(tileDepth);
+							}
+							else
+							{
+								visible = Extract(zMin, 0) <= *Pointer<Float>(tileDepth);
+							}
+						}
+
+						If(visible)
+						{
+							span(cBuffer, zBuffer, sBuffer, xLeft, xRight, tileX0, tileX1, y);
+
+							if(state.depthWriteEnable)
+							{
+								*Pointer<Float>(tileDepth) = tileMaximum(zBuffer, tileX);
+							}
+						}
+					}
 				}
 			}
 
@@ -297,18 +419,18 @@ namespace sw
 			{
 				if(state.colorWriteActive(index))
 				{
-					cBuffer[index] += *Pointer<Int>(data + OFFSET(DrawData,colorPitchB[index])) << (1 + sw::log2(clusterCount));   // FIXME: Precompute
+					cBuffer[index] += clusterRowsStride(*Pointer<Int>(data + OFFSET(DrawData,colorPitchB[index])), clusterCount);   // FIXME: Precompute
 				}
 			}
 
 			if(state.depthTestActive)
 			{
-				zBuffer += *Pointer<Int>(data + OFFSET(DrawData,depthPitchB)) << (1 + sw::log2(clusterCount));   // FIXME: Precompute
+				zBuffer += clusterRowsStride(*Pointer<Int>(data + OFFSET(DrawData,depthPitchB)), clusterCount);   // FIXME: Precompute
 			}
 
 			if(state.stencilActive)
 			{
-				sBuffer += *Pointer<Int>(data + OFFSET(DrawData,stencilPitchB)) << (1 + sw::log2(clusterCount));   // FIXME: Precompute
+				sBuffer += clusterRowsStride(*Pointer<Int>(data + OFFSET(DrawData,stencilPitchB)), clusterCount);   // FIXME: Precompute
 			}
 
 			y += 2 * clusterCount;
@@ -316,6 +438,79 @@ namespace sw
 		Until(y >= yMax)
 	}
 
+	void QuadRasterizer::span(Pointer<Byte> cBuffer[4], Pointer<Byte> &zBuffer, Pointer<Byte> &sBuffer, Short4 xLeft[4], Short4 xRight[4], Int &x0, Int &x1, Int &y)
+	{
+		For(Int x = x0, x < x1, x += 2)
+		{
+			Short4 xxxx = Short4(x);
+			Int cMask[4];
+
+			for(unsigned int q = 0; q < state.multiSample; q++)
+			{
+				Short4 mask = CmpGT(xxxx, xLeft[q]) & CmpGT(xRight[q], xxxx);
+				cMask[q] = SignMask(PackSigned(mask, mask)) & 0x0000000F;
+			}
+
+			quad(cBuffer, zBuffer, sBuffer, cMask, x, y);
+		}
+	}
+
+	void QuadRasterizer::clearTile(Pointer<Byte> &zBuffer, Int &tileX, Float &clearValue)
+	{
+		Int x1 = Min(tileX + Surface::COARSE_TILE_WIDTH, *Pointer<Int>(data + OFFSET(DrawData,depthWidth)));
+
+		if(!state.quadLayoutDepthBuffer)
+		{
+			Int pitch = *Pointer<Int>(data + OFFSET(DrawData,depthPitchB));
+
+			For(Int x = tileX, x < x1, x++)
+			{
+				*Pointer<Float>(zBuffer + 4 * x) = clearValue;
+				*Pointer<Float>(zBuffer + 4 * x + pitch) = clearValue;
+			}
+		}
+		else
+		{
+			Float4 zValue = Float4(clearValue);
+
+			For(Int x = tileX, x < x1, x += 2)
+			{
+				*Pointer<Float4>(zBuffer + 8 * x, 16) = zValue;
+			}
+		}
+	}
+
+	Float QuadRasterizer::tileMaximum(Pointer<Byte> &zBuffer, Int &tileX)
+	{
+		// Reads every quad of the tile, including the ones outside of the current primitive
+		Int x1 = Min(tileX + Surface::COARSE_TILE_WIDTH, *Pointer<Int>(data + OFFSET(DrawData,depthWidth)));
+		Int pitch = *Pointer<Int>(data + OFFSET(DrawData,depthPitchB));
+
+		Float4 zMax = Float4(0.0f);   // Depth values are within [0, 1]
+
+		For(Int x = tileX, x < x1, x += 2)
+		{
+			Float4 zValue;
+
+			if(!state.quadLayoutDepthBuffer)
+			{
+				zValue.xy = *Pointer<Float4>(zBuffer + 4 * x);
+				zValue.zw = *Pointer<Float4>(zBuffer + 4 * x + pitch - 8);
+			}
+			else
+			{
+				zValue = *Pointer<Float4>(zBuffer + 8 * x, 16);
+			}
+
+			zMax = Max(zValue, zMax);
+		}
+
+		zMax = Max(zMax, Swizzle(zMax, 0x4E));
+		zMax = Max(zMax, Swizzle(zMax, 0xB1));
+
+		return Extract(zMax, 0);
+	}
+
 	Float4 QuadRasterizer::interpolate(Float4 &x, Float4 &D, Float4 &rhw, Pointer<Byte> planeEquation, bool flat, bool perspective, bool clamp)
 	{
 		Float4 interpolant = D;
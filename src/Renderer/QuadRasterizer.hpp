@@ -54,7 +54,13 @@ namespace sw
 		const PixelShader *const shader;
 
 	private:
+		enum { TILE_ROW_PAIRS = 8 };   // Pairs of rows per cluster in each band of tiled rasterization
+
 		void rasterize(Int &yMin, Int &yMax);
+		void span(Pointer<Byte> cBuffer[4], Pointer<Byte> &zBuffer, Pointer<Byte> &sBuffer, Short4 xLeft[4], Short4 xRight[4], Int &x0, Int &x1, Int &y);
+		void clearTile(Pointer<Byte> &zBuffer, Int &tileX, Float &clearValue);
+		Float tileMaximum(Pointer<Byte> &zBuffer, Int &tileX);
+		Int firstClusterRow(Int y, int clusterCount);
 	};
 }
 
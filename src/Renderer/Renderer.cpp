@@ -18,6 +18,10 @@
 #include "Surface.hpp"
 #include "Primitive.hpp"
 #include "Polygon.hpp"
+#include "RoutineStatistics.hpp"
+#include "PipelineStatistics.hpp"
+#include "OverdrawHeatmap.hpp"
+#include "WorkerPool.hpp"
 #include "Main/FrameBuffer.hpp"
 #include "Main/SwiftConfig.hpp"
 #include "Reactor/Reactor.hpp"
@@ -29,6 +33,7 @@
 #include "Common/Half.hpp"
 #include "Common/Math.hpp"
 #include "Common/Timer.hpp"
+#include "Common/Trace.hpp"
 #include "Common/Debug.hpp"
 
 #undef max
@@ -56,12 +61,19 @@ namespace sw
 	extern bool exactColorRounding;
 	extern TransparencyAntialiasing transparencyAntialiasing;
 	extern bool forceClearRegisters;
+	extern bool tiledRasterization;
+	extern bool coarseDepthCulling;
+	extern bool compressedTextureSampling;
+	extern bool tiledTextureLayout;
+	extern bool linearSRGBTextures;
+	extern bool guardBandClipping;
 
 	extern bool precacheVertex;
 	extern bool precacheSetup;
 	extern bool precachePixel;
 
 	static const int batchSize = 128;
+	static int clustersPerThread = 2;   // Finer pixel work items, so idle threads can steal the ones of busy clusters
 	AtomicInt threadCount(1);
 	AtomicInt Renderer::unitCount(1);
 	AtomicInt Renderer::clusterCount(1);
@@ -71,6 +83,7 @@ namespace sw
 	TranscendentalPrecision rcpPrecision = ACCURATE;
 	TranscendentalPrecision rsqPrecision = ACCURATE;
 	bool perspectiveCorrection = true;
+	bool mediumPrecisionMath = false;
 
 	static void setGlobalRenderingSettings(Conventions conventions, bool exactColorRounding)
 	{
@@ -90,38 +103,153 @@ namespace sw
 		}
 	}
 
-	struct Parameters
+	class Renderer::RoutineJob : public DeferredRoutine
 	{
-		Renderer *renderer;
-		int threadIndex;
+	public:
+		explicit RoutineJob(Renderer *renderer) : DeferredRoutine(renderer->hotRoutineThreshold), renderer(renderer)
+		{
+		}
+
+	protected:
+		void onCompiled() override
+		{
+			renderer->routineCompiled();
+		}
+
+	private:
+		Renderer *const renderer;
+	};
+
+	class Renderer::VertexRoutineJob : public Renderer::RoutineJob
+	{
+	public:
+		VertexRoutineJob(Renderer *renderer, const VertexProcessor::State &state, const VertexShader *shader)
+			: RoutineJob(renderer), state(state), shader(shader ? new VertexShader(shader) : nullptr)
+		{
+		}
+
+		~VertexRoutineJob() override
+		{
+			delete shader;
+		}
+
+	protected:
+		Routine *compile() override
+		{
+			Routine *routine = VertexProcessor::generateRoutine(state, shader);
+
+			if(!isTiered() || isReady())   // Else kept for the optimized compile
+			{
+				delete shader;
+				shader = nullptr;
+			}
+
+			return routine;
+		}
+
+	private:
+		const VertexProcessor::State state;
+		const VertexShader *shader;   // Private copy, the application may delete the original
+	};
+
+	class Renderer::SetupRoutineJob : public Renderer::RoutineJob
+	{
+	public:
+		SetupRoutineJob(Renderer *renderer, const SetupProcessor::State &state) : RoutineJob(renderer), state(state)
+		{
+		}
+
+	protected:
+		Routine *compile() override
+		{
+			return SetupProcessor::generateRoutine(state);
+		}
+
+	private:
+		const SetupProcessor::State state;
+	};
+
+	class Renderer::PixelRoutineJob : public Renderer::RoutineJob
+	{
+	public:
+		PixelRoutineJob(Renderer *renderer, const PixelProcessor::State &state, const PixelShader *shader)
+			: RoutineJob(renderer), state(state), shader(shader ? new PixelShader(shader) : nullptr)
+		{
+		}
+
+		~PixelRoutineJob() override
+		{
+			delete shader;
+		}
+
+	protected:
+		Routine *compile() override
+		{
+			Routine *routine = PixelProcessor::generateRoutine(state, shader);
+
+			if(!isTiered() || isReady())   // Else kept for the optimized compile
+			{
+				delete shader;
+				shader = nullptr;
+			}
+
+			return routine;
+		}
+
+	private:
+		const PixelProcessor::State state;
+		const PixelShader *shader;   // Private copy, the application may delete the original
 	};
 
 	DrawCall::DrawCall()
 	{
-		queries = 0;
+		sequence = 0;
+		condition = nullptr;
+
+		vsConstants = nullptr;
+		psConstants = nullptr;
 
-		vsDirtyConstF = VERTEX_UNIFORM_VECTORS + 1;
 		vsDirtyConstI = 16;
 		vsDirtyConstB = 16;
 
-		psDirtyConstF = FRAGMENT_UNIFORM_VECTORS;
+		psDirtyConstW = 8;
 		psDirtyConstI = 16;
 		psDirtyConstB = 16;
 
 		references = -1;
+		instancePrimitives = 0;
+		vertexOnly = false;
+		occlusion = false;
 
-		data = (DrawData*)allocate(sizeof(DrawData));
-		data->constants = &constants;
+		deferred = false;
+
+		data = (DrawData*)allocate(sizeof(DrawData), 16, MEMORY_DRAW);
+		data->constants = &getConstants();
 	}
 
 	DrawCall::~DrawCall()
 	{
-		delete queries;
-
 		deallocate(data);
 	}
 
-	Renderer::Renderer(Context *context, Conventions conventions, bool exactColorRounding) : VertexProcessor(context), PixelProcessor(context), SetupProcessor(context), context(context), viewport()
+	ConstantBlock::ConstantBlock(int count) : c((float4*)allocate(sizeof(float4) * count)), references(0)
+	{
+	}
+
+	ConstantBlock::~ConstantBlock()
+	{
+		deallocate(c);
+	}
+
+	void ConstantBlock::unbind()
+	{
+		if(references-- == 0)   // Atomic, returns the new count
+		{
+			delete this;
+		}
+	}
+
+	Renderer::Renderer(Context *context, Conventions conventions, bool exactColorRounding) : VertexProcessor(context), PixelProcessor(context), SetupProcessor(context), context(context), viewport(), schedulerMutex("scheduler")
 	{
 		setGlobalRenderingSettings(conventions, exactColorRounding);
 
@@ -134,18 +262,8 @@ namespace sw
 		updateProjectionMatrix = true;
 		updateClipPlanes = true;
 
-		#if PERF_HUD
-			resetTimers();
-		#endif
-
-		for(int i = 0; i < 16; i++)
-		{
-			vertexTask[i] = 0;
-
-			worker[i] = 0;
-			resume[i] = 0;
-			suspend[i] = 0;
-		}
+		vertexTask = nullptr;
+		task = nullptr;
 
 		threadsAwake = 0;
 		resumeApp = new Event();
@@ -153,33 +271,53 @@ namespace sw
 		currentDraw = 0;
 		nextDraw = 0;
 
-		qHead = 0;
 		qSize = 0;
+		pixelQueue = nullptr;
+		primitiveQueue = nullptr;
 
-		for(int i = 0; i < 16; i++)
-		{
-			triangleBatch[i] = 0;
-			primitiveBatch[i] = 0;
-		}
-
-		for(int draw = 0; draw < DRAW_COUNT; draw++)
-		{
-			drawCall[draw] = new DrawCall();
-			drawList[draw] = drawCall[draw];
-		}
+		triangleBatch = nullptr;
+		primitiveBatch = nullptr;
+		primitiveProgress = nullptr;
+		pixelProgress = nullptr;
 
-		for(int unit = 0; unit < 16; unit++)
+		for(int draw = 0; draw < MAX_DRAW_COUNT; draw++)
 		{
-			primitiveProgress[unit].init();
+			drawCall[draw] = nullptr;
+			drawList[draw] = nullptr;
 		}
 
-		for(int cluster = 0; cluster < 16; cluster++)
-		{
-			pixelProgress[cluster].init();
-		}
+		drawCallCount = 0;
+		drawCallLimit = 1;
+		drawCallMerging = false;
+		vertexCacheSize = 64;
 
 		clipFlags = 0;
 
+		vsConstants = nullptr;
+		psConstants = nullptr;
+		vsDirtyConstF[0] = vsDirtyConstF[1] = 0;
+		psDirtyConstF[0] = psDirtyConstF[1] = 0;
+
+		vertexRoutine = nullptr;
+		setupRoutine = nullptr;
+		pixelRoutine = nullptr;
+		genericVertexRoutine = nullptr;
+		vertexSpecialization = 0;
+		pixelSpecialization = 0;
+		specializedVertexRoutine = nullptr;
+		specializedPixelRoutine = nullptr;
+		asynchronousCompilation = false;
+		hotRoutineThreshold = 0;
+		statisticsLogInterval = 0;
+		threadSpinCount = 0;
+		minThreadCount = 0;
+		inlineDrawPixels = 0;
+		inlineExecution = 0;
+		threadAffinity = 0;
+		pendingCompilations = 0;
+
+		conditionalQuery = nullptr;
+
 		swiftConfig = new SwiftConfig(disableServer);
 		updateConfiguration(true);
 
@@ -188,6 +326,36 @@ namespace sw
 
 	Renderer::~Renderer()
 	{
+		// Draw calls may still be waiting for routines to be compiled
+		synchronize();
+
+		while(pendingCompilations != 0)
+		{
+			Thread::sleep(1);
+		}
+
+		for(auto deferred : deferredRoutines)
+		{
+			deferred->unbind();
+		}
+
+		holdRoutine(vertexRoutine, nullptr);
+		holdRoutine(setupRoutine, nullptr);
+		holdRoutine(pixelRoutine, nullptr);
+		holdRoutine(genericVertexRoutine, nullptr);
+		holdRoutine(specializedVertexRoutine, nullptr);
+		holdRoutine(specializedPixelRoutine, nullptr);
+
+		if(vsConstants)
+		{
+			vsConstants->unbind();
+		}
+
+		if(psConstants)
+		{
+			psConstants->unbind();
+		}
+
 		sync->destruct();
 
 		delete clipper;
@@ -199,7 +367,7 @@ namespace sw
 		terminateThreads();
 		delete resumeApp;
 
-		for(int draw = 0; draw < DRAW_COUNT; draw++)
+		for(int draw = 0; draw < drawCallCount; draw++)
 		{
 			delete drawCall[draw];
 		}
@@ -219,7 +387,7 @@ namespace sw
 		sw::deallocate(mem);
 	}
 
-	void Renderer::draw(DrawType drawType, unsigned int indexOffset, unsigned int count, bool update)
+	void Renderer::draw(DrawType drawType, unsigned int indexOffset, unsigned int count, bool update, unsigned int instanceCount)
 	{
 		#ifndef NDEBUG
 			if(count < minPrimitives || count > maxPrimitives)
@@ -228,11 +396,21 @@ namespace sw
 			}
 		#endif
 
-		context->drawType = drawType;
+		context->setState(context->drawType, drawType);
 
 		updateConfiguration();
 		updateClipper();
 
+		if(statisticsLogInterval > 0)
+		{
+			logRoutineStatistics(statisticsLogInterval);
+		}
+
+		if(minThreadCount > 0)
+		{
+			adaptThreadCount();
+		}
+
 		int ss = context->getSuperSampleCount();
 		int ms = context->getMultiSampleCount();
 		bool requiresSync = false;
@@ -249,15 +427,17 @@ namespace sw
 
 			sync->lock(sw::PRIVATE);
 
-			if(update || oldMultiSampleMask != context->multiSampleMask)
+			VertexProcessor::updateFixedFunction();
+
+			if(update || oldMultiSampleMask != context->multiSampleMask || stateModified())
 			{
 				vertexState = VertexProcessor::update(drawType);
 				setupState = SetupProcessor::update();
 				pixelState = PixelProcessor::update();
 
-				vertexRoutine = VertexProcessor::routine(vertexState);
-				setupRoutine = SetupProcessor::routine(setupState);
-				pixelRoutine = PixelProcessor::routine(pixelState);
+				acquireRoutines();
+
+				context->stateModified = false;
 			}
 
 			int batch = batchSize / ms;
@@ -297,18 +477,35 @@ namespace sw
 
 			do
 			{
-				for(int i = 0; i < DRAW_COUNT; i++)
+				for(int i = 0; i < drawCallCount; i++)
 				{
 					if(drawCall[i]->references == -1)
 					{
 						draw = drawCall[i];
-						drawList[nextDraw & DRAW_COUNT_BITS] = draw;
-
 						break;
 					}
 				}
 
-				if(!draw)
+				// Only allocate more draw calls when the application runs ahead of the workers
+				if(!draw && drawCallCount < drawCallLimit)
+				{
+					// Publish the slot before the count, finishDrawCall() scans the pool concurrently
+					draw = new DrawCall();
+					drawCall[drawCallCount] = draw;
+					++drawCallCount;
+				}
+
+				if(draw)
+				{
+					drawList[nextDraw & DRAW_COUNT_BITS] = draw;
+					draw->sequence = nextDraw;
+
+					if(Trace::enabled())
+					{
+						Trace::beginAsync("Draw", draw->sequence);
+					}
+				}
+				else
 				{
 					resumeApp->wait();
 				}
@@ -319,31 +516,68 @@ namespace sw
 
 			if(queries.size() != 0)
 			{
-				draw->queries = new std::list<Query*>();
 				bool includePrimitivesWrittenQueries = vertexState.transformFeedbackQueryEnabled && vertexState.transformFeedbackEnabled;
 				for(auto &query : queries)
 				{
 					if(includePrimitivesWrittenQueries || (query->type != Query::TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN))
 					{
 						++query->reference; // Atomic
-						draw->queries->push_back(query);
+						draw->queries.push_back(query);
 					}
 				}
 			}
 
 			draw->drawType = drawType;
 			draw->batchSize = batch;
+			draw->condition = conditionalQuery;
+
+			if(conditionalQuery)
+			{
+				++conditionalQuery->conditions; // Atomic
+			}
 
-			vertexRoutine->bind();
+			Routine *drawVertexRoutine = vertexRoutine;
+
+			if(genericVertexRoutine)
+			{
+				if(!deferredRoutine(vertexRoutine))
+				{
+					holdRoutine(genericVertexRoutine, nullptr);   // The specialized routine has been compiled
+				}
+				else if(!deferredRoutine(genericVertexRoutine))
+				{
+					drawVertexRoutine = genericVertexRoutine;
+				}
+			}
+
+			Routine *drawPixelRoutine = pixelRoutine;
+
+			if(uniformSpecializer.isEnabled())
+			{
+				specializeRoutines(drawVertexRoutine, drawPixelRoutine);
+			}
+
+			drawVertexRoutine->bind();
 			setupRoutine->bind();
-			pixelRoutine->bind();
+			drawPixelRoutine->bind();
 
-			draw->vertexRoutine = vertexRoutine;
+			draw->vertexRoutine = drawVertexRoutine;
 			draw->setupRoutine = setupRoutine;
-			draw->pixelRoutine = pixelRoutine;
-			draw->vertexPointer = (VertexProcessor::RoutinePointer)vertexRoutine->getEntry();
-			draw->setupPointer = (SetupProcessor::RoutinePointer)setupRoutine->getEntry();
-			draw->pixelPointer = (PixelProcessor::RoutinePointer)pixelRoutine->getEntry();
+			draw->pixelRoutine = drawPixelRoutine;
+
+			draw->deferredRoutine[0] = deferredRoutine(drawVertexRoutine);
+			draw->deferredRoutine[1] = deferredRoutine(setupRoutine);
+			draw->deferredRoutine[2] = deferredRoutine(drawPixelRoutine);
+			draw->deferred = draw->deferredRoutine[0] || draw->deferredRoutine[1] || draw->deferredRoutine[2];
+
+			// Routines still being compiled for another renderer sharing the caches
+			// aren't tracked here, so getEntry() waits for them.
+			if(!draw->deferred)   // Else the entry pointers are set by routinesReady()
+			{
+				draw->vertexPointer = (VertexProcessor::RoutinePointer)drawVertexRoutine->getEntry();
+				draw->setupPointer = (SetupProcessor::RoutinePointer)setupRoutine->getEntry();
+				draw->pixelPointer = (PixelProcessor::RoutinePointer)drawPixelRoutine->getEntry();
+			}
 			draw->setupPrimitives = setupPrimitives;
 			draw->setupState = setupState;
 
@@ -352,6 +586,8 @@ namespace sw
 				draw->vertexStream[i] = context->input[i].resource;
 				data->input[i] = context->input[i].buffer;
 				data->stride[i] = context->input[i].stride;
+				data->divisor[i] = context->input[i].divisor;
+				data->instanceStride[i] = context->input[i].instanceStride;
 
 				if(draw->vertexStream[i])
 				{
@@ -386,13 +622,17 @@ namespace sw
 
 			if(context->pixelShader)
 			{
-				if(draw->psDirtyConstF)
+				if(draw->psDirtyConstW)
 				{
-					memcpy(&data->ps.cW, PixelProcessor::cW, sizeof(word4) * 4 * (draw->psDirtyConstF < 8 ? draw->psDirtyConstF : 8));
-					memcpy(&data->ps.c, PixelProcessor::c, sizeof(float4) * draw->psDirtyConstF);
-					draw->psDirtyConstF = 0;
+					memcpy(&data->ps.cW, PixelProcessor::cW, sizeof(word4) * 4 * draw->psDirtyConstW);
+					draw->psDirtyConstW = 0;
 				}
 
+				psConstants = updateConstants(psConstants, PixelProcessor::c, FRAGMENT_UNIFORM_VECTORS, psDirtyConstF);
+				psConstants->bind();
+				draw->psConstants = psConstants;
+				data->ps.c = psConstants->c;
+
 				if(draw->psDirtyConstI)
 				{
 					memcpy(&data->ps.i, PixelProcessor::i, sizeof(int4) * draw->psDirtyConstI);
@@ -445,11 +685,10 @@ namespace sw
 					}
 				}
 
-				if(draw->vsDirtyConstF)
-				{
-					memcpy(&data->vs.c, VertexProcessor::c, sizeof(float4) * draw->vsDirtyConstF);
-					draw->vsDirtyConstF = 0;
-				}
+				vsConstants = updateConstants(vsConstants, VertexProcessor::c, VERTEX_UNIFORM_VECTORS + 1, vsDirtyConstF);
+				vsConstants->bind();
+				draw->vsConstants = vsConstants;
+				data->vs.c = vsConstants->c;
 
 				if(draw->vsDirtyConstI)
 				{
@@ -463,11 +702,6 @@ namespace sw
 					draw->vsDirtyConstB = 0;
 				}
 
-				if(context->vertexShader->isInstanceIdDeclared())
-				{
-					data->instanceID = context->instanceID;
-				}
-
 				VertexProcessor::lockUniformBuffers(data->vs.u, draw->vUniformBuffers);
 				VertexProcessor::lockTransformFeedbackBuffers(data->vs.t, data->vs.reg, data->vs.row, data->vs.col, data->vs.str, draw->transformFeedbackBuffers);
 			}
@@ -475,7 +709,11 @@ namespace sw
 			{
 				data->ff = ff;
 
-				draw->vsDirtyConstF = VERTEX_UNIFORM_VECTORS + 1;
+				if(drawVertexRoutine == genericVertexRoutine)
+				{
+					VertexProcessor::updateGenericLighting(data->ff);
+				}
+
 				draw->vsDirtyConstI = 16;
 				draw->vsDirtyConstB = 16;
 
@@ -530,6 +768,8 @@ namespace sw
 				else ASSERT(false);
 			}
 
+			draw->occlusion = pixelState.occlusionEnabled;
+
 			if(pixelState.occlusionEnabled)
 			{
 				for(int cluster = 0; cluster < clusterCount; cluster++)
@@ -548,6 +788,10 @@ namespace sw
 				}
 			#endif
 
+			#if SHADER_PROFILE
+				data->shaderProfile = ShaderProfile::table();
+			#endif
+
 			// Viewport
 			{
 				float W = 0.5f * viewport.width;
@@ -628,6 +872,12 @@ namespace sw
 						data->colorBuffer[index] += q * ms * context->renderTarget[index]->getSliceB(true);
 						data->colorPitchB[index] = context->renderTarget[index]->getInternalPitchB();
 						data->colorSliceB[index] = context->renderTarget[index]->getInternalSliceB();
+
+						if(pixelState.uniformSamples && pixelState.colorWriteActive(index))
+						{
+							data->uniformSamples[index] = context->renderTarget[index]->lockUniformSamples(layer);
+							data->uniformSamplesPitchB[index] = context->renderTarget[index]->getUniformSamplesPitchP();
+						}
 					}
 				}
 
@@ -638,10 +888,24 @@ namespace sw
 				{
 					unsigned int layer = context->depthBufferLayer;
 					requiresSync |= context->depthBuffer->requiresSync();
+
+					if(!pixelState.coarseDepthActive)
+					{
+						context->depthBuffer->flushDepthClear();
+					}
+
 					data->depthBuffer = (float*)context->depthBuffer->lockInternal(0, 0, layer, LOCK_READWRITE, MANAGED);
 					data->depthBuffer += q * ms * context->depthBuffer->getSliceB(true);
 					data->depthPitchB = context->depthBuffer->getInternalPitchB();
 					data->depthSliceB = context->depthBuffer->getInternalSliceB();
+
+					if(pixelState.coarseDepthActive)
+					{
+						data->coarseDepthBuffer = context->depthBuffer->lockCoarseDepth(layer);
+						data->coarseDepthPitchB = context->depthBuffer->getCoarseDepthPitchP() * sizeof(float);
+						data->depthWidth = context->depthBuffer->getWidth();
+						data->depthClearValue = context->depthBuffer->getDepthClearValue();
+					}
 				}
 
 				if(draw->stencilBuffer)
@@ -653,6 +917,13 @@ namespace sw
 					data->stencilPitchB = context->stencilBuffer->getStencilPitchB();
 					data->stencilSliceB = context->stencilBuffer->getStencilSliceB();
 				}
+
+				if(pixelState.overdrawHeatmap)
+				{
+					OverdrawHeatmap heatmap = getOverdrawHeatmap();   // Possibly disabled or grown since, but still allocated
+					data->overdrawHeatmap = heatmap.counters;
+					data->overdrawHeatmapPitchB = heatmap.pitch * sizeof(unsigned int);
+				}
 			}
 
 			// Scissor
@@ -661,17 +932,80 @@ namespace sw
 				data->scissorX1 = scissor.x1;
 				data->scissorY0 = scissor.y0;
 				data->scissorY1 = scissor.y1;
+
+				data->guardBandX = 0.0f;
+				data->guardBandY = 0.0f;
+
+				if(guardBandClipping)
+				{
+					float W = 0.5f * viewport.width;
+					float H = 0.5f * viewport.height;
+					float X0 = viewport.x0 + W;
+					float Y0 = viewport.y0 + H;
+
+					// Pixels outside the viewport are only discarded by the scissor rectangle
+					bool scissorInViewport = scissor.x0 >= X0 - abs(W) && scissor.x1 <= X0 + abs(W) &&
+					                         scissor.y0 >= Y0 - abs(H) && scissor.y1 <= Y0 + abs(H);
+
+					if(scissorInViewport && W != 0.0f && H != 0.0f)
+					{
+						// The edge setup multiplies two 28.4 fixed-point extents of up to 2 * guardBand pixels
+						// each, so the screen coordinates are kept within (32 * guardBand)^2 < 2^31
+						const float guardBand = 1440.0f;
+
+						data->guardBandX = max((guardBand - abs(X0)) / abs(W), 0.0f);
+						data->guardBandY = max((guardBand - abs(Y0)) / abs(H), 0.0f);
+					}
+				}
 			}
 
 			draw->primitive = 0;
-			draw->count = count;
+			draw->count = count * instanceCount;
+			draw->instancePrimitives = count;
+
+			draw->vertexOnly = setupState.rasterizerDiscard;
+			draw->clusterMask.reset();
+			draw->clusters = 0;
+
+			for(int cluster = 0; cluster < clusterCount && !draw->vertexOnly; cluster++)
+			{
+				if(clusterCoversRows(cluster, scissor.y0, scissor.y1))
+				{
+					draw->clusterMask.set(cluster);
+					draw->clusters++;
+				}
+			}
+
+			if(draw->clusters == 0 && !draw->vertexOnly)   // Nothing gets drawn, but the batches still have to be retired by some cluster
+			{
+				for(int cluster = 0; cluster < clusterCount; cluster++)
+				{
+					draw->clusterMask.set(cluster);
+				}
+
+				draw->clusters = clusterCount;
+			}
+
+			// Clusters which skip the draw call entirely hold one reference each until they have passed it
+			draw->references = instanceCount * ((count + batch - 1) / batch) + (clusterCount - draw->clusters);
 
-			draw->references = (count + batch - 1) / batch;
+			countDrawCall();   // Always counted, it's a single relaxed increment
+
+			if(mergeDrawCall(*draw))
+			{
+				finishDrawCall(*draw, 0);   // The previous draw call holds the same resources
+
+				continue;
+			}
 
 			schedulerMutex.lock();
 			++nextDraw; // Atomic
 			schedulerMutex.unlock();
 
+			// Waking the workers costs more than rendering a few primitives into a small area
+			int scissorArea = (scissor.x1 - scissor.x0) * (scissor.y1 - scissor.y0);
+			bool tinyDraw = draw->count <= batch && scissorArea <= inlineDrawPixels && !draw->deferred;
+
 			#ifndef NDEBUG
 			if(threadCount == 1)   // Use main thread for draw execution
 			{
@@ -682,16 +1016,14 @@ namespace sw
 			}
 			else
 			#endif
+			if(!tinyDraw || !executeInline())
 			{
-				if(!threadsAwake)
-				{
-					suspend[0]->wait();
-
-					threadsAwake = 1;
-					task[0].type = Task::RESUME;
+				resumeThreads();
+			}
 
-					resume[0]->signal();
-				}
+			if(draw->vertexOnly)
+			{
+				break;   // Other samples would only repeat the transform feedback output
 			}
 		}
 
@@ -704,7 +1036,17 @@ namespace sw
 
 	void Renderer::clear(void *value, Format format, Surface *dest, const Rect &clearRect, unsigned int rgbaMask)
 	{
+		// Unlike full depth clears, color clears are not deferred to the first draw touching a tile.
+		// Depth has per-tile metadata the rasterizer already reads, the coarse depth maxima, so a
+		// negative maximum marks a cleared tile at no cost. Color targets have no such metadata, and
+		// the pixel routine would have to test and fill tiles for every render target, format, sample
+		// count and write mask. Instead the Blitter fills the buffer in parallel bands.
 		blitter->clear(value, format, dest, clearRect, rgbaMask);
+
+		if(rgbaMask == 0xF)
+		{
+			dest->setUniformSamples(clearRect);   // Every sample got the same color
+		}
 	}
 
 	void Renderer::blit(Surface *source, const SliceRectF &sRect, Surface *dest, const SliceRect &dRect, bool filter, bool isStencil, bool sRGBconversion)
@@ -717,38 +1059,135 @@ namespace sw
 		blitter->blit3D(source, dest);
 	}
 
-	void Renderer::threadFunction(void *parameters)
+	bool Renderer::hasTasks(int threadIndex) const
+	{
+		#ifndef NDEBUG
+			if(threadCount == 1)
+			{
+				return false;   // Draw calls are executed by the application thread
+			}
+		#endif
+
+		// Read the type first, the application thread sets it after claiming slot 0
+		return task[threadIndex].type != Task::SUSPEND && !(threadIndex == 0 && inlineExecution);
+	}
+
+	void Renderer::executeTasks(int threadIndex, int count)
 	{
-		Renderer *renderer = static_cast<Parameters*>(parameters)->renderer;
-		int threadIndex = static_cast<Parameters*>(parameters)->threadIndex;
+		// Workers are shared with other renderers, which may have been configured differently
+		CPUID::setFlushToZero(logPrecision < IEEE);
+		CPUID::setDenormalsAreZero(logPrecision < IEEE);
 
-		if(logPrecision < IEEE)
+		bool adaptive = minThreadCount > 0;
+		int64_t time = adaptive ? Timer::counter() : 0;
+
+		// Once suspended the slot may be taken over by the application thread, don't touch it again
+		for(int i = 0; i < count && scheduleTask(threadIndex); i++)
 		{
-			CPUID::setFlushToZero(true);
-			CPUID::setDenormalsAreZero(true);
+			executeTask(threadIndex);
+
+			if(adaptive)
+			{
+				int64_t end = Timer::counter();
+				awakeTime[threadIndex] += end - time;
+				time = end;
+			}
 		}
+	}
+
+	void Renderer::taskLoop(int threadIndex)
+	{
+		bool adaptive = minThreadCount > 0;
+		int64_t time = adaptive ? Timer::counter() : 0;
+
+		while(scheduleTask(threadIndex))
+		{
+			executeTask(threadIndex);
 
-		renderer->threadLoop(threadIndex);
+			if(adaptive)
+			{
+				int64_t end = Timer::counter();
+				awakeTime[threadIndex] += end - time;
+				time = end;
+			}
+		}
 	}
 
-	void Renderer::threadLoop(int threadIndex)
+	bool Renderer::executeInline()
 	{
-		while(!exitThreads)
+		resumeMutex.lock();
+
+		// Only when no thread is running, so the draw isn't queued behind other work
+		bool idle = (threadsAwake == 0);
+
+		if(idle)
+		{
+			inlineExecution = 1;
+			threadsAwake = 1;
+			task[0].type = Task::RESUME;
+		}
+
+		resumeMutex.unlock();
+
+		if(!idle)
 		{
-			taskLoop(threadIndex);
+			return false;
+		}
+
+		// Other slots still get woken up when more tasks become available
+		taskLoop(0);
 
-			suspend[threadIndex]->signal();
-			resume[threadIndex]->wait();
+		inlineExecution = 0;
+
+		if(task[0].type != Task::SUSPEND)   // Resumed while we held it, its worker ignored the wakeup
+		{
+			WorkerPool::wake(0);
 		}
+
+		return true;
 	}
 
-	void Renderer::taskLoop(int threadIndex)
+	void Renderer::adaptThreadCount()
 	{
-		while(task[threadIndex].type != Task::SUSPEND)
+		int64_t time = Timer::counter();
+
+		if(time - adaptationTime < Timer::frequency() / 60)   // Adapt about once per frame
 		{
-			scheduleTask(threadIndex);
-			executeTask(threadIndex);
+			return;
+		}
+
+		int64_t busy = 0;
+		int64_t awake = 0;
+
+		for(int i = 0; i < threadCount; i++)
+		{
+			busy += busyTime[i];
+			awake += awakeTime[i];
+		}
+
+		busy -= adaptationBusy;
+		awake -= adaptationAwake;
+
+		if(awake > 0)
+		{
+			// Fraction of the workers' time spent rendering instead of handing off tasks
+			double efficiency = (double)busy / (double)awake;
+			int active = activeThreads;
+
+			if(efficiency < 0.5 && active > minThreadCount)
+			{
+				activeThreads = active - 1;
+			}
+			else if(efficiency > 0.8 && throttledWakeups > 0 && active < threadCount)
+			{
+				activeThreads = active + 1;   // Tasks were waiting for the parked slots
+			}
 		}
+
+		adaptationTime = time;
+		adaptationBusy += busy;
+		adaptationAwake += awake;
+		throttledWakeups = 0;
 	}
 
 	void Renderer::findAvailableTasks()
@@ -758,6 +1197,8 @@ namespace sw
 		{
 			if(!pixelProgress[cluster].executing)
 			{
+				passDrawCalls(cluster);
+
 				for(int unit = 0; unit < unitCount; unit++)
 				{
 					if(primitiveProgress[unit].references > 0)   // Contains processed primitives
@@ -766,16 +1207,23 @@ namespace sw
 						{
 							if(pixelProgress[cluster].processedPrimitives == primitiveProgress[unit].firstPrimitive)   // Previous primitives have been rendered
 							{
-								Task &task = taskQueue[qHead];
+								Task task;
 								task.type = Task::PIXELS;
 								task.primitiveUnit = unit;
 								task.pixelCluster = cluster;
 
+								if(!hasPixels(unit, cluster))
+								{
+									// Retire the batch for this cluster right away instead of queueing an empty task
+									finishRendering(task);
+
+									unit = -1;   // The next batch may now be ready for this cluster
+									continue;
+								}
+
 								pixelProgress[cluster].executing = true;
 
-								// Commit to the task queue
-								qHead = (qHead + 1) & TASK_COUNT_BITS;
-								qSize++;
+								queueTask(task);
 
 								break;
 							}
@@ -810,119 +1258,637 @@ namespace sw
 				draw = drawList[currentDraw & DRAW_COUNT_BITS];
 			}
 
+			if(!routinesReady(draw))
+			{
+				return;   // Later draw calls can't start before this one
+			}
+
+			if(draw->condition && !resolveCondition(*draw))
+			{
+				return;   // The query's draw calls are still being rendered
+			}
+
+			if(draw->primitive >= draw->count)
+			{
+				continue;   // Skipped
+			}
+
 			if(!primitiveProgress[unit].references)   // Task not already being executed and not still in use by a pixel unit
 			{
 				primitive = draw->primitive;
 				count = draw->count;
 				int batch = draw->batchSize;
 
+				// Batches don't cross instance boundaries, so each one is shaded for a single instance
+				int instanceEnd = (primitive / draw->instancePrimitives + 1) * draw->instancePrimitives;
+				int batchEnd = min(primitive + batch, instanceEnd);
+
 				primitiveProgress[unit].drawCall = currentDraw;
 				primitiveProgress[unit].firstPrimitive = primitive;
-				primitiveProgress[unit].primitiveCount = count - primitive >= batch ? batch : count - primitive;
+				primitiveProgress[unit].primitiveCount = batchEnd - primitive;
 
-				draw->primitive += batch;
+				draw->primitive = batchEnd;
 
-				Task &task = taskQueue[qHead];
+				Task task;
 				task.type = Task::PRIMITIVES;
 				task.primitiveUnit = unit;
 
 				primitiveProgress[unit].references = -1;
 
-				// Commit to the task queue
-				qHead = (qHead + 1) & TASK_COUNT_BITS;
-				qSize++;
+				queueTask(task);
+			}
+		}
+	}
+
+	void Renderer::passDrawCalls(int cluster)
+	{
+		// Pass draw calls whose scissor rectangle has no rows for this cluster without waiting for their primitives
+		while(pixelProgress[cluster].drawCall != nextDraw)
+		{
+			DrawCall &draw = *drawList[pixelProgress[cluster].drawCall & DRAW_COUNT_BITS];
+
+			if(draw.clusterMask.test(cluster))
+			{
+				break;
+			}
+
+			++pixelProgress[cluster].drawCall; // Atomic
+			pixelProgress[cluster].processedPrimitives = 0;
+
+			int ref = draw.references--; // Atomic
+
+			if(ref == 0)
+			{
+				finishDrawCall(draw, draw.count);
+			}
+		}
+	}
+
+	bool Renderer::resolveCondition(DrawCall &draw)
+	{
+		Query *query = draw.condition;
+
+		// Only the draw calls before this one update the query, it can't be active anymore
+		if(query->reference != 0 && !query->building)
+		{
+			return false;
+		}
+
+		draw.condition = nullptr;
+
+		if(query->data == 0 && !query->building)
+		{
+			// None of its batches have been scheduled yet, so only the clusters still have to pass it
+			int batch = draw.batchSize;
+			int batches = (draw.count / draw.instancePrimitives) * ((draw.instancePrimitives + batch - 1) / batch);
+
+			draw.references += draw.clusters - batches;
+			draw.count = 0;
+			draw.clusterMask.reset();
+			draw.clusters = 0;
+
+			if(draw.references == 0)   // Every cluster had passed it already
+			{
+				finishDrawCall(draw, 0);
+			}
+			else
+			{
+				// Clusters waiting for its primitives may not look for new tasks again
+				for(int cluster = 0; cluster < clusterCount; cluster++)
+				{
+					if(!pixelProgress[cluster].executing)
+					{
+						passDrawCalls(cluster);
+					}
+				}
+			}
+		}
+
+		--query->conditions; // Atomic
+
+		return true;
+	}
+
+	// Whether the cluster, which draws every clusterCount-th pair of rows, owns any row in [yMin, yMax)
+	bool Renderer::clusterCoversRows(int cluster, int yMin, int yMax)
+	{
+		int rows = clusterCount * 2;
+		int y = max(yMin, 0) + rows - 2 - 2 * cluster;
+		y = (y / rows) * rows + 2 * cluster;   // Same rounding as QuadRasterizer::firstClusterRow()
+
+		return y < yMax;
+	}
+
+	bool Renderer::hasPixels(int unit, int cluster) const
+	{
+		return primitiveProgress[unit].visible > 0 &&
+		       clusterCoversRows(cluster, primitiveProgress[unit].yMin, primitiveProgress[unit].yMax);
+	}
+
+	void Renderer::acquireRoutines()
+	{
+		holdRoutine(genericVertexRoutine, nullptr);
+
+		vertexSpecialization = 0;
+		pixelSpecialization = 0;
+		holdRoutine(specializedVertexRoutine, nullptr);
+		holdRoutine(specializedPixelRoutine, nullptr);
+
+		if(!compileAsynchronously())
+		{
+			holdRoutine(vertexRoutine, VertexProcessor::routine(vertexState));
+			holdRoutine(setupRoutine, SetupProcessor::routine(setupState));
+			holdRoutine(pixelRoutine, PixelProcessor::routine(pixelState));
+
+			return;
+		}
+
+		// On a cache miss, cache a deferred routine right away so subsequent draw
+		// calls with the same state wait for the same compilation.
+		DeferredRoutine *deferred[3] = {};
+
+		holdRoutine(vertexRoutine, VertexProcessor::findRoutine(vertexState));
+
+		if(!vertexRoutine)
+		{
+			deferred[0] = new VertexRoutineJob(this, vertexState, context->vertexShader);
+			vertexRoutine = VertexProcessor::addRoutine(vertexState, deferred[0]);
+		}
+
+		holdRoutine(setupRoutine, SetupProcessor::findRoutine(setupState));
+
+		if(!setupRoutine)
+		{
+			deferred[1] = new SetupRoutineJob(this, setupState);
+			setupRoutine = SetupProcessor::addRoutine(setupState, deferred[1]);
+		}
+
+		holdRoutine(pixelRoutine, PixelProcessor::findRoutine(pixelState));
+
+		if(!pixelRoutine)
+		{
+			deferred[2] = new PixelRoutineJob(this, pixelState, pixelState.depthOnly ? nullptr : context->pixelShader);
+			pixelRoutine = PixelProcessor::addRoutine(pixelState, deferred[2]);
+		}
+
+		for(int i = 0; i < 3; i++)
+		{
+			if(deferred[i])
+			{
+				scheduleCompilation(deferred[i]);
+			}
+		}
+
+		// Fixed-function states which only differ in their lights or material sources
+		// share a generic routine, so new lighting setups don't have to wait for a compile.
+		if(vertexState.fixedFunction && vertexState.vertexLightingActive && deferredRoutine(vertexRoutine))
+		{
+			VertexProcessor::State genericState = VertexProcessor::genericLightingState(vertexState);
+			genericVertexRoutine = VertexProcessor::findRoutine(genericState);
+
+			if(!genericVertexRoutine)
+			{
+				DeferredRoutine *generic = new VertexRoutineJob(this, genericState, nullptr);
+				genericVertexRoutine = VertexProcessor::addRoutine(genericState, generic);
+
+				scheduleCompilation(generic);
+			}
+		}
+	}
+
+	bool Renderer::compileAsynchronously() const
+	{
+		#ifndef NDEBUG
+			if(threadCount == 1)
+			{
+				return false;   // Draw calls are executed by the application thread
+			}
+		#endif
+
+		return asynchronousCompilation;
+	}
+
+	void Renderer::holdRoutine(Routine *&held, Routine *routine)
+	{
+		// The new routine arrives bound, the reference to the replaced one is released
+		if(held)
+		{
+			held->unbind();
+		}
+
+		held = routine;
+	}
+
+	void Renderer::scheduleCompilation(DeferredRoutine *routine)
+	{
+		routine->bind();
+		deferredRoutines.push_back(routine);
+
+		++pendingCompilations; // Atomic
+		RoutineCompiler::schedule(routine);
+	}
+
+	void Renderer::specializeRoutines(Routine *&drawVertexRoutine, Routine *&drawPixelRoutine)
+	{
+		uint64_t vertexKey = context->vertexShader ? uniformSpecializer.key(context->vertexShader, VertexProcessor::c) : 0;
+		uint64_t pixelKey = (context->pixelShader && !pixelState.depthOnly) ? uniformSpecializer.key(context->pixelShader, PixelProcessor::c) : 0;
+
+		if(vertexKey != vertexSpecialization)
+		{
+			vertexSpecialization = vertexKey;
+			holdRoutine(specializedVertexRoutine, vertexKey ? specializeVertexRoutine() : nullptr);
+		}
+
+		if(pixelKey != pixelSpecialization)
+		{
+			pixelSpecialization = pixelKey;
+			holdRoutine(specializedPixelRoutine, pixelKey ? specializePixelRoutine() : nullptr);
+		}
+
+		// Keep drawing with the generic routines while the specialized ones compile
+		if(specializedVertexRoutine && !deferredRoutine(specializedVertexRoutine))
+		{
+			drawVertexRoutine = specializedVertexRoutine;
+		}
+
+		if(specializedPixelRoutine && !deferredRoutine(specializedPixelRoutine))
+		{
+			drawPixelRoutine = specializedPixelRoutine;
+		}
+	}
+
+	Routine *Renderer::specializeVertexRoutine()
+	{
+		VertexProcessor::State state = vertexState;
+		state.specialized = true;
+		UniformSpecializer::capture(*context->vertexShader, VertexProcessor::c, state.specialization);
+		state.hash = state.computeHash();
+
+		Routine *routine = VertexProcessor::findRoutine(state);
+
+		if(!routine)
+		{
+			VertexShader specialized(context->vertexShader);
+			UniformSpecializer::fold(specialized, VertexProcessor::c);
+
+			if(compileAsynchronously())
+			{
+				DeferredRoutine *deferred = new VertexRoutineJob(this, state, &specialized);
+				routine = VertexProcessor::addRoutine(state, deferred);
+
+				scheduleCompilation(deferred);
+			}
+			else
+			{
+				VertexShader shader(&specialized);   // Analyzed with the definitions
+				routine = VertexProcessor::addRoutine(state, VertexProcessor::generateRoutine(state, &shader));
+			}
+		}
+
+		return routine;
+	}
+
+	Routine *Renderer::specializePixelRoutine()
+	{
+		PixelProcessor::State state = pixelState;
+		state.specialized = true;
+		UniformSpecializer::capture(*context->pixelShader, PixelProcessor::c, state.specialization);
+		state.hash = state.computeHash();
+
+		Routine *routine = PixelProcessor::findRoutine(state);
+
+		if(!routine)
+		{
+			PixelShader specialized(context->pixelShader);
+			UniformSpecializer::fold(specialized, PixelProcessor::c);
+
+			if(compileAsynchronously())
+			{
+				DeferredRoutine *deferred = new PixelRoutineJob(this, state, &specialized);
+				routine = PixelProcessor::addRoutine(state, deferred);
+
+				scheduleCompilation(deferred);
+			}
+			else
+			{
+				PixelShader shader(&specialized);   // Analyzed with the definitions
+				routine = PixelProcessor::addRoutine(state, PixelProcessor::generateRoutine(state, &shader));
+			}
+		}
+
+		return routine;
+	}
+
+	bool Renderer::stateModified() const
+	{
+		if(context->stateModified)
+		{
+			return true;
+		}
+
+		// Shaders are compared by content, since a new shader can reuse the address of a deleted one
+		uint64_t vertexShaderID = context->vertexShader ? context->vertexShader->getContentID() : 0;
+		uint64_t pixelShaderID = context->pixelShader ? context->pixelShader->getContentID() : 0;
+
+		if(vertexShaderID != vertexState.shaderID || pixelShaderID != pixelState.shaderID)
+		{
+			return true;
+		}
+
+		if(pixelState.occlusionEnabled != (context->occlusionEnabled || pipelineStatistics()))
+		{
+			return true;
+		}
+
+		if(pixelState.overdrawHeatmap != overdrawHeatmapActive())
+		{
+			return true;
+		}
+
+		// Input streams get reset and redefined by each draw call
+		for(int i = 0; i < MAX_VERTEX_INPUTS; i++)
+		{
+			const Stream &input = context->input[i];
+
+			if(context->vertexShader && !context->vertexShader->getInput(i).active())
+			{
+				continue;   // Left out of the state by VertexProcessor::canonicalize()
+			}
+
+			if(input.type != vertexState.input[i].type ||
+			   input.count != vertexState.input[i].count ||
+			   input.normalized != vertexState.input[i].normalized)
+			{
+				return true;
 			}
 		}
+
+		return false;
+	}
+
+	DeferredRoutine *Renderer::deferredRoutine(Routine *routine)
+	{
+		DeferredRoutine *pending = nullptr;
+
+		for(auto it = deferredRoutines.begin(); it != deferredRoutines.end();)
+		{
+			DeferredRoutine *deferred = *it;
+
+			if(deferred->isReady())
+			{
+				it = deferredRoutines.erase(it);
+				deferred->unbind();
+			}
+			else
+			{
+				if(deferred == routine)
+				{
+					pending = deferred;
+				}
+
+				++it;
+			}
+		}
+
+		return pending;
 	}
 
-	void Renderer::scheduleTask(int threadIndex)
+	bool Renderer::routinesReady(DrawCall *draw)
 	{
+		if(!draw->deferred)
+		{
+			return true;
+		}
+
+		for(int i = 0; i < 3; i++)
+		{
+			if(draw->deferredRoutine[i] && !draw->deferredRoutine[i]->isReady())
+			{
+				return false;
+			}
+		}
+
+		draw->vertexPointer = (VertexProcessor::RoutinePointer)draw->vertexRoutine->getEntry();
+		draw->setupPointer = (SetupProcessor::RoutinePointer)draw->setupRoutine->getEntry();
+		draw->pixelPointer = (PixelProcessor::RoutinePointer)draw->pixelRoutine->getEntry();
+		draw->deferred = false;
+
+		return true;
+	}
+
+	void Renderer::routineCompiled()
+	{
+		// Threads decide to suspend while holding the scheduler lock, so after
+		// passing through it they either saw the routine or are suspending.
 		schedulerMutex.lock();
+		schedulerMutex.unlock();
+
+		resumeThreads();
 
-		int curThreadsAwake = threadsAwake;
+		--pendingCompilations; // Atomic, must be the last access to this renderer
+	}
+
+	void Renderer::resumeThreads()
+	{
+		resumeMutex.lock();
 
-		if((int)qSize < threadCount - curThreadsAwake + 1)
+		if(!threadsAwake)
 		{
-			findAvailableTasks();
+			threadsAwake = 1;
+			task[0].type = Task::RESUME;
+
+			WorkerPool::wake(0);
 		}
 
-		if(qSize != 0)
+		resumeMutex.unlock();
+	}
+
+	void Renderer::queueTask(const Task &task)
+	{
+		// Count the task before it becomes visible, so qSize never underflows
+		qSize++;
+
+		// Keep clusters and units on the same thread when possible, for cache locality
+		if(task.type == Task::PIXELS)
+		{
+			pixelQueue[task.pixelCluster % threadCount].push(task);
+		}
+		else
 		{
-			task[threadIndex] = taskQueue[(qHead - qSize) & TASK_COUNT_BITS];
-			qSize--;
+			primitiveQueue[task.primitiveUnit % threadCount].push(task);
+		}
+	}
+
+	bool Renderer::acquireTask(int threadIndex)
+	{
+		Task &task = this->task[threadIndex];
+
+		if(pixelQueue[threadIndex].pop(task, qSize) ||
+		   primitiveQueue[threadIndex].pop(task, qSize))
+		{
+			return true;
+		}
+
+		// Steal from other threads, pixel tasks first
+		for(int i = 1; i < threadCount; i++)
+		{
+			if(pixelQueue[(threadIndex + i) % threadCount].steal(task, qSize))
+			{
+				return true;
+			}
+		}
+
+		for(int i = 1; i < threadCount; i++)
+		{
+			if(primitiveQueue[(threadIndex + i) % threadCount].steal(task, qSize))
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	bool Renderer::scheduleTask(int threadIndex)
+	{
+		// Tasks already distributed to the queues can be taken without the scheduler lock
+		if(acquireTask(threadIndex))
+		{
+			return true;
+		}
+
+		schedulerMutex.lock();
+
+		findAvailableTasks();
+
+		// Tasks are only queued while holding the scheduler lock, so failing to
+		// acquire one here means all queues are empty.
+		bool acquired = acquireTask(threadIndex);
+
+		if(acquired)
+		{
+			int curThreadsAwake = threadsAwake;
 
 			if(curThreadsAwake != threadCount)
 			{
 				int wakeup = qSize - curThreadsAwake + 1;
+				int active = activeThreads;
 
-				for(int i = 0; i < threadCount && wakeup > 0; i++)
+				// Parked slots don't get woken, their queued tasks are stolen by the active ones
+				for(int i = 0; i < active && wakeup > 0; i++)
 				{
 					if(task[i].type == Task::SUSPEND)
 					{
-						suspend[i]->wait();
 						task[i].type = Task::RESUME;
-						resume[i]->signal();
+						WorkerPool::wake(i);
 
 						++threadsAwake; // Atomic
 						wakeup--;
 					}
 				}
+
+				if(wakeup > 0 && active < threadCount)
+				{
+					++throttledWakeups; // Atomic
+				}
 			}
 		}
 		else
 		{
+			ASSERT(qSize == 0);
+
 			task[threadIndex].type = Task::SUSPEND;
 
 			--threadsAwake; // Atomic
 		}
 
 		schedulerMutex.unlock();
+
+		return acquired;
 	}
 
 	void Renderer::executeTask(int threadIndex)
 	{
-		#if PERF_HUD
-			int64_t startTick = Timer::ticks();
-		#endif
+		bool statistics = pipelineStatistics();
+		bool adaptive = minThreadCount > 0;
+		int64_t taskTime = adaptive ? Timer::counter() : 0;
+		int64_t startTime = statistics ? (adaptive ? taskTime : Timer::counter()) : 0;
 
 		switch(task[threadIndex].type)
 		{
 		case Task::PRIMITIVES:
 			{
 				int unit = task[threadIndex].primitiveUnit;
+				TraceScope scope("Primitives", unit);
 
 				int input = primitiveProgress[unit].firstPrimitive;
 				int count = primitiveProgress[unit].primitiveCount;
 				DrawCall *draw = drawList[primitiveProgress[unit].drawCall & DRAW_COUNT_BITS];
 				int (Renderer::*setupPrimitives)(int batch, int count) = draw->setupPrimitives;
 
-				processPrimitiveVertices(unit, input, count, draw->count, threadIndex);
+				processPrimitiveVertices(unit, input, count, draw->instancePrimitives, threadIndex);
 
-				#if PERF_HUD
-					int64_t time = Timer::ticks();
-					vertexTime[threadIndex] += time - startTick;
-					startTick = time;
-				#endif
+				if(statistics)
+				{
+					int64_t time = Timer::counter();
+					countPipelineStatistic(threadIndex, VERTEX_TIME, time - startTime);
+					countPipelineStatistic(threadIndex, PRIMITIVE_COUNT, count);
+					countPipelineStatistic(threadIndex, PRIMITIVE_TASKS, 1);
+					startTime = time;
+				}
+
+				if(draw->vertexOnly)   // No cluster visits the batch, retire it here
+				{
+					primitiveProgress[unit].visible = 0;
 
-				int visible = 0;
+					int ref = draw->references--; // Atomic
 
-				if(!draw->setupState.rasterizerDiscard)
+					if(ref == 0)
+					{
+						finishDrawCall(*draw, draw->count);
+					}
+
+					primitiveProgress[unit].references = 0;
+
+					break;
+				}
+
+				int visible = (this->*setupPrimitives)(unit, count);
+
+				int yMin = 0;
+				int yMax = 0;
+
+				if(visible > 0)
 				{
-					visible = (this->*setupPrimitives)(unit, count);
+					const Primitive *primitive = primitiveBatch[unit];
+					int ms = draw->setupState.multiSample;
+
+					yMin = primitive[0].yMin;
+					yMax = primitive[0].yMax;
+
+					for(int i = 1; i < visible; i++)
+					{
+						yMin = min(yMin, primitive[i * ms].yMin);
+						yMax = max(yMax, primitive[i * ms].yMax);
+					}
 				}
 
 				primitiveProgress[unit].visible = visible;
-				primitiveProgress[unit].references = clusterCount;
+				primitiveProgress[unit].yMin = yMin;
+				primitiveProgress[unit].yMax = yMax;
+				primitiveProgress[unit].references = draw->clusters;
 
-				#if PERF_HUD
-					setupTime[threadIndex] += Timer::ticks() - startTick;
-				#endif
+				if(statistics)
+				{
+					countPipelineStatistic(threadIndex, SETUP_TIME, Timer::counter() - startTime);
+				}
 			}
 			break;
 		case Task::PIXELS:
 			{
 				int unit = task[threadIndex].primitiveUnit;
 				int visible = primitiveProgress[unit].visible;
+				TraceScope scope("Pixels", task[threadIndex].pixelCluster);
 
 				if(visible > 0)
 				{
@@ -937,9 +1903,11 @@ namespace sw
 
 				finishRendering(task[threadIndex]);
 
-				#if PERF_HUD
-					pixelTime[threadIndex] += Timer::ticks() - startTick;
-				#endif
+				if(statistics)
+				{
+					countPipelineStatistic(threadIndex, PIXEL_TIME, Timer::counter() - startTime);
+					countPipelineStatistic(threadIndex, PIXEL_TASKS, 1);
+				}
 			}
 			break;
 		case Task::RESUME:
@@ -949,6 +1917,75 @@ namespace sw
 		default:
 			ASSERT(false);
 		}
+
+		if(adaptive)
+		{
+			busyTime[threadIndex] += Timer::counter() - taskTime;
+		}
+	}
+
+	void Renderer::TaskDeque::init()
+	{
+		head = 0;
+		count = 0;
+	}
+
+	void Renderer::TaskDeque::push(const Task &task)
+	{
+		mutex.lock();
+
+		ASSERT(count < CAPACITY);
+		this->task[(head + count) & CAPACITY_BITS] = task;
+		++count; // Atomic
+
+		mutex.unlock();
+	}
+
+	bool Renderer::TaskDeque::pop(Task &task, AtomicInt &queued)
+	{
+		if(count == 0)
+		{
+			return false;   // Don't contend for the lock of an empty queue
+		}
+
+		mutex.lock();
+
+		bool popped = (count != 0);
+
+		if(popped)
+		{
+			task = this->task[head];
+			head = (head + 1) & CAPACITY_BITS;
+			--count; // Atomic
+			--queued; // Atomic
+		}
+
+		mutex.unlock();
+
+		return popped;
+	}
+
+	bool Renderer::TaskDeque::steal(Task &task, AtomicInt &queued)
+	{
+		if(count == 0)
+		{
+			return false;
+		}
+
+		mutex.lock();
+
+		bool stolen = (count != 0);
+
+		if(stolen)
+		{
+			task = this->task[(head + count - 1) & CAPACITY_BITS];
+			--count; // Atomic
+			--queued; // Atomic
+		}
+
+		mutex.unlock();
+
+		return stolen;
 	}
 
 	void Renderer::synchronize()
@@ -957,13 +1994,50 @@ namespace sw
 		sync->unlock();
 	}
 
+	int Renderer::getDrawSequence() const
+	{
+		return nextDraw;
+	}
+
+	bool Renderer::isComplete(int sequence) const
+	{
+		if(completed.reached(sequence))
+		{
+			return true;
+		}
+
+		// Draws can finish out of order, so a later draw may already be done before the watermark reaches it
+		for(int i = 0; i < drawCallCount; i++)
+		{
+			const DrawCall *draw = drawCall[i];
+
+			// Compare the difference, so the comparison also holds when the sequence wraps around
+			if(draw->references != -1 && (int)((unsigned int)draw->sequence - (unsigned int)sequence) < 0)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void Renderer::synchronize(int sequence)
+	{
+		// Only waits for the draw calls submitted before the sequence number, not for the whole pipeline
+		completed.wait(sequence);
+	}
+
+	bool Renderer::synchronize(int sequence, uint64_t timeout)
+	{
+		return completed.wait(sequence, timeout);
+	}
+
 	void Renderer::finishRendering(Task &pixelTask)
 	{
 		int unit = pixelTask.primitiveUnit;
 		int cluster = pixelTask.pixelCluster;
 
 		DrawCall &draw = *drawList[primitiveProgress[unit].drawCall & DRAW_COUNT_BITS];
-		DrawData &data = *draw.data;
 		int primitive = primitiveProgress[unit].firstPrimitive;
 		int count = primitiveProgress[unit].primitiveCount;
 		int processedPrimitives = primitive + count;
@@ -984,113 +2058,297 @@ namespace sw
 
 			if(ref == 0)
 			{
-				#if PERF_PROFILE
-					for(int cluster = 0; cluster < clusterCount; cluster++)
-					{
-						for(int i = 0; i < PERF_TIMERS; i++)
-						{
-							profiler.cycles[i] += data.cycles[i][cluster];
-						}
-					}
-				#endif
+				finishDrawCall(draw, processedPrimitives);
+			}
+		}
 
-				if(draw.queries)
-				{
-					for(auto &query : *(draw.queries))
-					{
-						switch(query->type)
-						{
-						case Query::FRAGMENTS_PASSED:
-							for(int cluster = 0; cluster < clusterCount; cluster++)
-							{
-								query->data += data.occlusion[cluster];
-							}
-							break;
-						case Query::TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN:
-							query->data += processedPrimitives;
-							break;
-						default:
-							break;
-						}
+		pixelProgress[cluster].executing = false;
+	}
 
-						--query->reference; // Atomic
-					}
+	void Renderer::finishDrawCall(DrawCall &draw, int processedPrimitives)
+	{
+		DrawData &data = *draw.data;
 
-					delete draw.queries;
-					draw.queries = 0;
+		#if PERF_PROFILE
+			for(int cluster = 0; cluster < clusterCount; cluster++)
+			{
+				for(int i = 0; i < PERF_TIMERS; i++)
+				{
+					profiler.cycles[i] += data.cycles[i][cluster];
 				}
+			}
+		#endif
+
+		if(draw.occlusion && pipelineStatistics())
+		{
+			for(int cluster = 0; cluster < clusterCount; cluster++)
+			{
+				countPipelineStatistic(cluster, PIXEL_COUNT, data.occlusion[cluster]);
+			}
+		}
 
-				for(int i = 0; i < RENDERTARGETS; i++)
+		if(!draw.queries.empty())
+		{
+			for(auto &query : draw.queries)
+			{
+				switch(query->type)
 				{
-					if(draw.renderTarget[i])
+				case Query::FRAGMENTS_PASSED:
+					for(int cluster = 0; cluster < clusterCount; cluster++)
 					{
-						draw.renderTarget[i]->unlockInternal();
+						query->data += data.occlusion[cluster];
 					}
+					break;
+				case Query::TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN:
+					query->data += processedPrimitives;
+					break;
+				default:
+					break;
 				}
 
-				if(draw.depthBuffer)
-				{
-					draw.depthBuffer->unlockInternal();
-				}
+				--query->reference; // Atomic
+			}
+
+			draw.queries.clear();
+		}
+
+		for(int i = 0; i < RENDERTARGETS; i++)
+		{
+			if(draw.renderTarget[i])
+			{
+				draw.renderTarget[i]->unlockInternal();
+			}
+		}
+
+		if(draw.depthBuffer)
+		{
+			draw.depthBuffer->unlockInternal();
+		}
+
+		if(draw.stencilBuffer)
+		{
+			draw.stencilBuffer->unlockStencil();
+		}
+
+		for(int i = 0; i < TOTAL_IMAGE_UNITS; i++)
+		{
+			if(draw.texture[i])
+			{
+				draw.texture[i]->unlock();
+			}
+		}
+
+		for(int i = 0; i < MAX_VERTEX_INPUTS; i++)
+		{
+			if(draw.vertexStream[i])
+			{
+				draw.vertexStream[i]->unlock();
+			}
+		}
+
+		if(draw.indexBuffer)
+		{
+			draw.indexBuffer->unlock();
+		}
+
+		for(int i = 0; i < MAX_UNIFORM_BUFFER_BINDINGS; i++)
+		{
+			if(draw.pUniformBuffers[i])
+			{
+				draw.pUniformBuffers[i]->unlock();
+			}
+			if(draw.vUniformBuffers[i])
+			{
+				draw.vUniformBuffers[i]->unlock();
+			}
+		}
+
+		for(int i = 0; i < MAX_TRANSFORM_FEEDBACK_INTERLEAVED_COMPONENTS; i++)
+		{
+			if(draw.transformFeedbackBuffers[i])
+			{
+				draw.transformFeedbackBuffers[i]->unlock();
+			}
+		}
+
+		if(draw.vsConstants)
+		{
+			draw.vsConstants->unbind();
+			draw.vsConstants = nullptr;
+		}
+
+		if(draw.psConstants)
+		{
+			draw.psConstants->unbind();
+			draw.psConstants = nullptr;
+		}
+
+		draw.vertexRoutine->unbind();
+		draw.setupRoutine->unbind();
+		draw.pixelRoutine->unbind();
+
+		sync->unlock();
+
+		if(Trace::enabled())
+		{
+			Trace::endAsync("Draw", draw.sequence);
+		}
+
+		draw.references = -1;
+		advanceCompletion();
+		resumeApp->signal();
+	}
+
+	void Renderer::advanceCompletion()
+	{
+		// Every draw before nextDraw has its references set, so the oldest one still
+		// in flight bounds the sequence up to which everything has finished
+		unsigned int oldest = (int)nextDraw;
+
+		for(int i = 0; i < drawCallCount; i++)
+		{
+			const DrawCall *draw = drawCall[i];
+
+			if(draw->references != -1 && (int)((unsigned int)draw->sequence - oldest) < 0)
+			{
+				oldest = draw->sequence;
+			}
+		}
+
+		completed.advance(oldest);
+	}
+
+	bool Renderer::mergeDrawCall(DrawCall &draw)
+	{
+		DrawCall *previous = drawList[(nextDraw - 1) & DRAW_COUNT_BITS];
+
+		if(!drawCallMerging || !previous || previous == &draw)
+		{
+			return false;
+		}
+
+		schedulerMutex.lock();
+
+		// Batches which haven't been scheduled yet keep the previous draw call from finishing,
+		// and it can't get scheduled further while we hold the lock.
+		bool merged = previous->sequence == nextDraw - 1 &&
+		              previous->primitive < previous->count &&
+		              canMerge(*previous, draw);
+
+		if(merged)
+		{
+			int batch = previous->batchSize;
+			int primitive = previous->primitive;
+			int count = previous->count + draw.count;
+
+			int pending = (previous->count - primitive + batch - 1) / batch;
+			int batches = (count - primitive + batch - 1) / batch;
+
+			previous->references += batches - pending;
+			previous->count = count;
+			previous->instancePrimitives = count;
+		}
+
+		schedulerMutex.unlock();
+
+		return merged;
+	}
+
+	bool Renderer::canMerge(const DrawCall &previous, const DrawCall &draw) const
+	{
+		// Strips and fans can't be extended by just appending primitives
+		DrawType type = (DrawType)(draw.drawType & 0x0F);
+
+		if(type != DRAW_POINTLIST && type != DRAW_LINELIST && type != DRAW_TRIANGLELIST)
+		{
+			return false;
+		}
+
+		if(draw.drawType != previous.drawType || draw.batchSize != previous.batchSize ||
+		   draw.count != draw.instancePrimitives || previous.count != previous.instancePrimitives ||
+		   draw.deferred || previous.deferred || draw.occlusion || previous.occlusion ||
+		   draw.condition || previous.condition ||
+		   !draw.queries.empty() || !previous.queries.empty() ||
+		   draw.vertexOnly != previous.vertexOnly || draw.clusterMask != previous.clusterMask ||
+		   draw.clipFlags != previous.clipFlags || draw.setupPrimitives != previous.setupPrimitives)
+		{
+			return false;
+		}
+
+		// Identical routines imply identical states
+		if(draw.vertexRoutine != previous.vertexRoutine || draw.setupRoutine != previous.setupRoutine || draw.pixelRoutine != previous.pixelRoutine ||
+		   draw.vsConstants != previous.vsConstants || draw.psConstants != previous.psConstants || draw.indexBuffer != previous.indexBuffer ||
+		   draw.depthBuffer != previous.depthBuffer || draw.stencilBuffer != previous.stencilBuffer)
+		{
+			return false;
+		}
 
-				if(draw.stencilBuffer)
-				{
-					draw.stencilBuffer->unlockStencil();
-				}
+		if(memcmp(draw.vertexStream, previous.vertexStream, sizeof(draw.vertexStream)) != 0 ||
+		   memcmp(draw.renderTarget, previous.renderTarget, sizeof(draw.renderTarget)) != 0 ||
+		   memcmp(draw.texture, previous.texture, sizeof(draw.texture)) != 0 ||
+		   memcmp(draw.pUniformBuffers, previous.pUniformBuffers, sizeof(draw.pUniformBuffers)) != 0 ||
+		   memcmp(draw.vUniformBuffers, previous.vUniformBuffers, sizeof(draw.vUniformBuffers)) != 0)
+		{
+			return false;
+		}
 
-				for(int i = 0; i < TOTAL_IMAGE_UNITS; i++)
-				{
-					if(draw.texture[i])
-					{
-						draw.texture[i]->unlock();
-					}
-				}
+		for(int i = 0; i < MAX_TRANSFORM_FEEDBACK_INTERLEAVED_COMPONENTS; i++)
+		{
+			if(draw.transformFeedbackBuffers[i])
+			{
+				return false;   // Each draw appends to the output at its own offset
+			}
+		}
 
-				for(int i = 0; i < MAX_VERTEX_INPUTS; i++)
-				{
-					if(draw.vertexStream[i])
-					{
-						draw.vertexStream[i]->unlock();
-					}
-				}
+		const DrawData &data = *draw.data;
+		const DrawData &previousData = *previous.data;
+		const char *d = reinterpret_cast<const char*>(&data);
+		const char *p = reinterpret_cast<const char*>(&previousData);
 
-				if(draw.indexBuffer)
-				{
-					draw.indexBuffer->unlock();
-				}
+		int verticesPerPrimitive = (type == DRAW_TRIANGLELIST) ? 3 : (type == DRAW_LINELIST) ? 2 : 1;
+		int vertices = previous.count * verticesPerPrimitive;
 
-				for(int i = 0; i < MAX_UNIFORM_BUFFER_BINDINGS; i++)
-				{
-					if(draw.pUniformBuffers[i])
-					{
-						draw.pUniformBuffers[i]->unlock();
-					}
-					if(draw.vUniformBuffers[i])
-					{
-						draw.vUniformBuffers[i]->unlock();
-					}
-				}
+		if(draw.indexBuffer)
+		{
+			int indexSize = 1 << (((draw.drawType & 0x30) >> 4) - 1);
 
-				for(int i = 0; i < MAX_TRANSFORM_FEEDBACK_INTERLEAVED_COMPONENTS; i++)
-				{
-					if(draw.transformFeedbackBuffers[i])
-					{
-						draw.transformFeedbackBuffers[i]->unlock();
-					}
-				}
+			if(data.indices != static_cast<const char*>(previousData.indices) + vertices * indexSize ||
+			   memcmp(data.input, previousData.input, sizeof(data.input)) != 0)
+			{
+				return false;
+			}
+		}
+		else for(int i = 0; i < MAX_VERTEX_INPUTS; i++)   // The vertex streams must continue where the previous draw stopped
+		{
+			bool perVertex = data.input[i] && data.stride[i] != 0 && data.divisor[i] == 0;
+			const void *input = perVertex ? static_cast<const char*>(previousData.input[i]) + vertices * data.stride[i] : previousData.input[i];
 
-				draw.vertexRoutine->unbind();
-				draw.setupRoutine->unbind();
-				draw.pixelRoutine->unbind();
+			if(data.input[i] != input)
+			{
+				return false;
+			}
+		}
 
-				sync->unlock();
+		// Compare everything the routines read, except the indices and vertex inputs. Only the
+		// samplers in use have their texture data updated, and occlusion counts get written
+		// by the pixel routines.
+		if(data.constants != previousData.constants ||
+		   memcmp(d + OFFSET(DrawData, stride), p + OFFSET(DrawData, stride), OFFSET(DrawData, mipmap) - OFFSET(DrawData, stride)) != 0 ||
+		   memcmp(d + OFFSET(DrawData, vs), p + OFFSET(DrawData, vs), OFFSET(DrawData, occlusion) - OFFSET(DrawData, vs)) != 0 ||
+		   memcmp(d + OFFSET(DrawData, textureStage), p + OFFSET(DrawData, textureStage), sizeof(DrawData) - OFFSET(DrawData, textureStage)) != 0)
+		{
+			return false;
+		}
 
-				draw.references = -1;
-				resumeApp->signal();
+		for(int i = 0; i < TOTAL_IMAGE_UNITS; i++)
+		{
+			if(draw.texture[i] && memcmp(&data.mipmap[i], &previousData.mipmap[i], sizeof(Texture)) != 0)
+			{
+				return false;
 			}
 		}
 
-		pixelProgress[cluster].executing = false;
+		return true;
 	}
 
 	void Renderer::processPrimitiveVertices(int unit, unsigned int start, unsigned int triangleCount, unsigned int loop, int thread)
@@ -1104,10 +2362,21 @@ namespace sw
 		const void *indices = data->indices;
 		VertexProcessor::RoutinePointer vertexRoutine = draw->vertexPointer;
 
-		if(task->vertexCache.drawCall != primitiveDrawCall)
+		// Primitives are numbered consecutively over all instances
+		unsigned int primitiveStart = start;
+		int instance = start / loop;
+		start -= instance * loop;
+
+		if(task->vertexCache.drawCall != primitiveDrawCall || task->instanceID != instance)
 		{
 			task->vertexCache.clear();
 			task->vertexCache.drawCall = primitiveDrawCall;
+			task->instanceID = instance;
+
+			for(int i = 0; i < MAX_VERTEX_INPUTS; i++)
+			{
+				task->instanceOffset[i] = data->divisor[i] ? (instance / data->divisor[i]) * data->instanceStride[i] : 0;
+			}
 		}
 
 		unsigned int batch[128][3];   // FIXME: Adjust to dynamic batch size
@@ -1535,7 +2804,7 @@ namespace sw
 			return;
 		}
 
-		task->primitiveStart = start;
+		task->primitiveStart = primitiveStart;
 		task->vertexCount = triangleCount * 3;
 		vertexRoutine(&triangle->v0, (unsigned int*)&batch, task, data);
 	}
@@ -1553,9 +2822,23 @@ namespace sw
 		int pos = state.positionRegister;
 		const DrawData *data = draw.data;
 		int visible = 0;
+		unsigned int culled = 0;
+		unsigned int clipped = 0;
+		Clipper::TriangleBatch clipBatch;
 
 		for(int i = 0; i < count; i++, triangle++)
 		{
+			if((i & 3) == 0)
+			{
+				culled = cullTriangles(triangle, min(count - i, 4), draw);
+				clipped = clipper->classifyTriangles(triangle, min(count - i, 4), draw, clipBatch);
+			}
+
+			if(culled & (1 << (i & 3)))
+			{
+				continue;
+			}
+
 			Vertex &v0 = triangle->v0;
 			Vertex &v1 = triangle->v1;
 			Vertex &v2 = triangle->v2;
@@ -1566,9 +2849,9 @@ namespace sw
 
 				int clipFlagsOr = v0.clipFlags | v1.clipFlags | v2.clipFlags | draw.clipFlags;
 
-				if(clipFlagsOr != Clipper::CLIP_FINITE)
+				if(clipped & (1 << (i & 3)))
 				{
-					if(!clipper->clip(polygon, clipFlagsOr, draw))
+					if(!clipper->clip(polygon, clipFlagsOr, draw, clipBatch, i & 3))
 					{
 						continue;
 					}
@@ -1585,6 +2868,132 @@ namespace sw
 		return visible;
 	}
 
+	unsigned int Renderer::cullTriangles(const Triangle *triangle, int count, const DrawCall &draw) const
+	{
+		// Rejects up to four unclipped triangles which can't produce any fragments before they reach the
+		// setup routine. The computations are kept lane-parallel so the compiler can vectorize them.
+		const SetupProcessor::State &state = draw.setupState;
+		const DrawData &data = *draw.data;
+		int pos = state.positionRegister;
+
+		float A[4];
+		int xMin[4], xMax[4], yMin[4], yMax[4];
+		bool negative[4];
+		bool unclipped[4];
+
+		for(int i = 0; i < 4; i++)
+		{
+			const Triangle &t = triangle[i < count ? i : 0];
+
+			unclipped[i] = (i < count) && ((t.v0.clipFlags | t.v1.clipFlags | t.v2.clipFlags | draw.clipFlags) == Clipper::CLIP_FINITE);
+
+			float x0 = (float)t.v0.X, y0 = (float)t.v0.Y;
+			float x1 = (float)t.v1.X, y1 = (float)t.v1.Y;
+			float x2 = (float)t.v2.X, y2 = (float)t.v2.Y;
+
+			A[i] = (y2 - y0) * x1 + (y1 - y2) * x0 + (y0 - y1) * x2;   // Same as the setup routine
+			negative[i] = std::signbit(t.v0.v[pos].w) ^ std::signbit(t.v1.v[pos].w) ^ std::signbit(t.v2.v[pos].w);
+
+			xMin[i] = min(min(t.v0.X, t.v1.X), t.v2.X);
+			xMax[i] = max(max(t.v0.X, t.v1.X), t.v2.X);
+			yMin[i] = min(min(t.v0.Y, t.v1.Y), t.v2.Y);
+			yMax[i] = max(max(t.v0.Y, t.v1.Y), t.v2.Y);
+		}
+
+		unsigned int culled = 0;
+
+		for(int i = 0; i < 4; i++)
+		{
+			float area = negative[i] ? -A[i] : A[i];
+
+			bool cull = (A[i] == 0.0f) ||
+			            (state.cullMode == CULL_CLOCKWISE && area >= 0.0f) ||
+			            (state.cullMode == CULL_COUNTERCLOCKWISE && area <= 0.0f);
+
+			if(state.multiSample == 1)
+			{
+				// Pixel centers covered by the bounding box, using the setup routine's rounding
+				int x0 = (xMin[i] + 0x0F) >> 4;
+				int x1 = (xMax[i] + 0x0F) >> 4;
+				int y0 = (yMin[i] + 0x0F) >> 4;
+				int y1 = (yMax[i] + 0x0F) >> 4;
+
+				cull = cull || (x0 == x1) || (y0 == y1) ||
+				       (x1 <= data.scissorX0) || (x0 >= data.scissorX1) ||
+				       (y1 <= data.scissorY0) || (y0 >= data.scissorY1);
+			}
+
+			culled |= (unclipped[i] && cull) ? (1 << i) : 0;
+		}
+
+		return culled;
+	}
+
+	unsigned int Renderer::cullWidePrimitives(const Triangle *triangle, int count, int vertices, const DrawCall &draw, unsigned int &inside) const
+	{
+		// Classifies up to four points or lines at once, from boxes around their vertices which contain
+		// the corners of the polygons they get expanded to. Returns the ones entirely outside one of
+		// the frustum planes, and sets which ones are entirely inside, and don't need clipping.
+		const SetupProcessor::State &state = draw.setupState;
+		const DrawData &data = *draw.data;
+		int pos = state.positionRegister;
+
+		// Clip-space extents of one pixel per unit of w
+		const float pixelX = 16.0f / abs(data.Wx16[0]);
+		const float pixelY = 16.0f / abs(data.Hx16[0]);
+
+		unsigned int outsideMask = 0;
+		unsigned int insideMask = 0;
+
+		for(int i = 0; i < 4; i++)
+		{
+			const Triangle &t = triangle[i < count ? i : 0];
+			float radius = (vertices == 1) ? 0.5f * pointSize(t.v0, draw) : 0.5f * data.lineWidth;
+
+			unsigned int outside = Clipper::CLIP_FRUSTUM;
+			bool unclipped = true;
+
+			for(int j = 0; j < vertices; j++)
+			{
+				const float4 &P = (j == 0) ? t.v0.v[pos] : t.v1.v[pos];
+				float dx = radius * abs(P.w) * pixelX;
+				float dy = radius * abs(P.w) * pixelY;
+
+				// Same tests as Clipper::computeClipFlags(), on the far side of the box
+				unsigned int flags = ((P.x - dx > P.w)  ? Clipper::CLIP_RIGHT  : 0) |
+				                     ((P.y - dy > P.w)  ? Clipper::CLIP_TOP    : 0) |
+				                     ((P.z > P.w)       ? Clipper::CLIP_FAR    : 0) |
+				                     ((P.x + dx < -P.w) ? Clipper::CLIP_LEFT   : 0) |
+				                     ((P.y + dy < -P.w) ? Clipper::CLIP_BOTTOM : 0) |
+				                     (((j == 0 ? t.v0.clipFlags : t.v1.clipFlags) & Clipper::CLIP_NEAR) ? Clipper::CLIP_NEAR : 0);
+
+				outside &= flags;
+
+				// And on the near side
+				unclipped = unclipped && (P.w > 0.0f) && (P.x + dx <= P.w) && (P.x - dx >= -P.w) &&
+				            (P.y + dy <= P.w) && (P.y - dy >= -P.w) && (P.z <= P.w) &&
+				            !((j == 0 ? t.v0.clipFlags : t.v1.clipFlags) & Clipper::CLIP_NEAR);
+			}
+
+			outsideMask |= (i < count && outside != 0) ? (1 << i) : 0;
+			insideMask |= (i < count && unclipped) ? (1 << i) : 0;
+		}
+
+		inside = insideMask;
+
+		return outsideMask;
+	}
+
+	float Renderer::pointSize(const Vertex &v, const DrawCall &draw) const
+	{
+		const SetupProcessor::State &state = draw.setupState;
+		const DrawData &data = *draw.data;
+
+		float pSize = (state.pointSizeRegister != Unused) ? v.v[state.pointSizeRegister].y : data.point.pointSize[0];
+
+		return clamp(pSize, data.point.pointSizeMin, data.point.pointSizeMax);
+	}
+
 	int Renderer::setupWireframeTriangle(int unit, int count)
 	{
 		Triangle *triangle = triangleBatch[unit];
@@ -1696,16 +3105,26 @@ namespace sw
 		SetupProcessor::State &state = draw.setupState;
 
 		int ms = state.multiSample;
+		unsigned int culled = 0;
+		unsigned int inside = 0;
 
-		for(int i = 0; i < count; i++)
+		for(int i = 0; i < count; i++, triangle++)
 		{
-			if(setupLine(*primitive, *triangle, draw))
+			if((i & 3) == 0)
+			{
+				culled = cullWidePrimitives(triangle, min(count - i, 4), 2, draw, inside);
+			}
+
+			if(culled & (1 << (i & 3)))
+			{
+				continue;
+			}
+
+			if(setupLine(*primitive, *triangle, draw, (inside & (1 << (i & 3))) != 0))
 			{
 				primitive += ms;
 				visible++;
 			}
-
-			triangle++;
 		}
 
 		return visible;
@@ -1721,22 +3140,32 @@ namespace sw
 		SetupProcessor::State &state = draw.setupState;
 
 		int ms = state.multiSample;
+		unsigned int culled = 0;
+		unsigned int inside = 0;
 
-		for(int i = 0; i < count; i++)
+		for(int i = 0; i < count; i++, triangle++)
 		{
-			if(setupPoint(*primitive, *triangle, draw))
+			if((i & 3) == 0)
+			{
+				culled = cullWidePrimitives(triangle, min(count - i, 4), 1, draw, inside);
+			}
+
+			if(culled & (1 << (i & 3)))
+			{
+				continue;
+			}
+
+			if(setupPoint(*primitive, *triangle, draw, (inside & (1 << (i & 3))) != 0))
 			{
 				primitive += ms;
 				visible++;
 			}
-
-			triangle++;
 		}
 
 		return visible;
 	}
 
-	bool Renderer::setupLine(Primitive &primitive, Triangle &triangle, const DrawCall &draw)
+	bool Renderer::setupLine(Primitive &primitive, Triangle &triangle, const DrawCall &draw, bool inside)
 	{
 		const SetupProcessor::RoutinePointer &setupRoutine = draw.setupPointer;
 		const SetupProcessor::State &state = draw.setupState;
@@ -1791,19 +3220,19 @@ namespace sw
 
 			P[0].x += -dy0w;
 			P[0].y += +dx0h;
-			C[0] = clipper->computeClipFlags(P[0]);
+			C[0] = inside ? Clipper::CLIP_FINITE : clipper->computeClipFlags(P[0]);
 
 			P[1].x += -dy1w;
 			P[1].y += +dx1h;
-			C[1] = clipper->computeClipFlags(P[1]);
+			C[1] = inside ? Clipper::CLIP_FINITE : clipper->computeClipFlags(P[1]);
 
 			P[2].x += +dy1w;
 			P[2].y += -dx1h;
-			C[2] = clipper->computeClipFlags(P[2]);
+			C[2] = inside ? Clipper::CLIP_FINITE : clipper->computeClipFlags(P[2]);
 
 			P[3].x += +dy0w;
 			P[3].y += -dx0h;
-			C[3] = clipper->computeClipFlags(P[3]);
+			C[3] = inside ? Clipper::CLIP_FINITE : clipper->computeClipFlags(P[3]);
 
 			if((C[0] & C[1] & C[2] & C[3]) == Clipper::CLIP_FINITE)
 			{
@@ -1843,28 +3272,28 @@ namespace sw
 			float dy1 = lineWidth * 0.5f * P1.w / H;
 
 			P[0].x += -dx0;
-			C[0] = clipper->computeClipFlags(P[0]);
+			C[0] = inside ? Clipper::CLIP_FINITE : clipper->computeClipFlags(P[0]);
 
 			P[1].y += +dy0;
-			C[1] = clipper->computeClipFlags(P[1]);
+			C[1] = inside ? Clipper::CLIP_FINITE : clipper->computeClipFlags(P[1]);
 
 			P[2].x += +dx0;
-			C[2] = clipper->computeClipFlags(P[2]);
+			C[2] = inside ? Clipper::CLIP_FINITE : clipper->computeClipFlags(P[2]);
 
 			P[3].y += -dy0;
-			C[3] = clipper->computeClipFlags(P[3]);
+			C[3] = inside ? Clipper::CLIP_FINITE : clipper->computeClipFlags(P[3]);
 
 			P[4].x += -dx1;
-			C[4] = clipper->computeClipFlags(P[4]);
+			C[4] = inside ? Clipper::CLIP_FINITE : clipper->computeClipFlags(P[4]);
 
 			P[5].y += +dy1;
-			C[5] = clipper->computeClipFlags(P[5]);
+			C[5] = inside ? Clipper::CLIP_FINITE : clipper->computeClipFlags(P[5]);
 
 			P[6].x += +dx1;
-			C[6] = clipper->computeClipFlags(P[6]);
+			C[6] = inside ? Clipper::CLIP_FINITE : clipper->computeClipFlags(P[6]);
 
 			P[7].y += -dy1;
-			C[7] = clipper->computeClipFlags(P[7]);
+			C[7] = inside ? Clipper::CLIP_FINITE : clipper->computeClipFlags(P[7]);
 
 			if((C[0] & C[1] & C[2] & C[3] & C[4] & C[5] & C[6] & C[7]) == Clipper::CLIP_FINITE)
 			{
@@ -1932,7 +3361,7 @@ namespace sw
 		return false;
 	}
 
-	bool Renderer::setupPoint(Primitive &primitive, Triangle &triangle, const DrawCall &draw)
+	bool Renderer::setupPoint(Primitive &primitive, Triangle &triangle, const DrawCall &draw, bool inside)
 	{
 		const SetupProcessor::RoutinePointer &setupRoutine = draw.setupPointer;
 		const SetupProcessor::State &state = draw.setupState;
@@ -1940,20 +3369,7 @@ namespace sw
 
 		Vertex &v = triangle.v0;
 
-		float pSize;
-
-		int pts = state.pointSizeRegister;
-
-		if(state.pointSizeRegister != Unused)
-		{
-			pSize = v.v[pts].y;
-		}
-		else
-		{
-			pSize = data.point.pointSize[0];
-		}
-
-		pSize = clamp(pSize, data.point.pointSizeMin, data.point.pointSizeMax);
+		float pSize = pointSize(v, draw);
 
 		float4 P[4];
 		int C[4];
@@ -1970,19 +3386,19 @@ namespace sw
 
 		P[0].x -= X;
 		P[0].y += Y;
-		C[0] = clipper->computeClipFlags(P[0]);
+		C[0] = inside ? Clipper::CLIP_FINITE : clipper->computeClipFlags(P[0]);
 
 		P[1].x += X;
 		P[1].y += Y;
-		C[1] = clipper->computeClipFlags(P[1]);
+		C[1] = inside ? Clipper::CLIP_FINITE : clipper->computeClipFlags(P[1]);
 
 		P[2].x += X;
 		P[2].y -= Y;
-		C[2] = clipper->computeClipFlags(P[2]);
+		C[2] = inside ? Clipper::CLIP_FINITE : clipper->computeClipFlags(P[2]);
 
 		P[3].x -= X;
 		P[3].y -= Y;
-		C[3] = clipper->computeClipFlags(P[3]);
+		C[3] = inside ? Clipper::CLIP_FINITE : clipper->computeClipFlags(P[3]);
 
 		triangle.v1 = triangle.v0;
 		triangle.v2 = triangle.v0;
@@ -2012,72 +3428,108 @@ namespace sw
 
 	void Renderer::initializeThreads()
 	{
-		unitCount = ceilPow2(threadCount);
-		clusterCount = ceilPow2(threadCount);
+		// All renderers use the same workers, so a pool created by another one decides the thread count
+		threadCount = WorkerPool::attach(this, threadCount, threadAffinity, workerProcessors, threadSpinCount);
 
-		for(int i = 0; i < unitCount; i++)
-		{
-			triangleBatch[i] = (Triangle*)allocate(batchSize * sizeof(Triangle));
-			primitiveBatch[i] = (Primitive*)allocate(batchSize * sizeof(Primitive));
-		}
+		// Start with all slots active, the load decides how many of them stay so
+		activeThreads = (int)threadCount;
+		throttledWakeups = 0;
+		adaptationTime = Timer::counter();
+		adaptationBusy = 0;
+		adaptationAwake = 0;
 
 		for(int i = 0; i < threadCount; i++)
 		{
-			vertexTask[i] = (VertexTask*)allocate(sizeof(VertexTask));
-			vertexTask[i]->vertexCache.drawCall = -1;
+			busyTime[i] = 0;
+			awakeTime[i] = 0;
+		}
 
-			task[i].type = Task::SUSPEND;
+		// Neither the unit nor the cluster count has to be a power of two. Each cluster renders its
+		// rows in primitive order, but primitives concentrated in part of the screen keep only some
+		// of them busy. Having several per thread lets the others steal their batches from the queues.
+		unitCount = threadCount;
+		clusterCount = (threadCount > 1) ? min((int)threadCount * clustersPerThread, (int)MAX_THREAD_COUNT) : 1;
+
+		task = new Task[threadCount];
+		vertexTask = new VertexTask*[threadCount];
+		pixelQueue = new TaskDeque[threadCount];
+		primitiveQueue = new TaskDeque[threadCount];
+
+		triangleBatch = new Triangle*[unitCount];
+		primitiveBatch = new Primitive*[unitCount];
+		primitiveProgress = new PrimitiveProgress[unitCount];
+		pixelProgress = new PixelProgress[clusterCount];
+
+		for(int unit = 0; unit < unitCount; unit++)
+		{
+			triangleBatch[unit] = (Triangle*)allocate(batchSize * sizeof(Triangle));
+			primitiveBatch[unit] = (Primitive*)allocate(batchSize * sizeof(Primitive));
+			primitiveProgress[unit].init();
+		}
 
-			resume[i] = new Event();
-			suspend[i] = new Event();
+		for(int cluster = 0; cluster < clusterCount; cluster++)
+		{
+			pixelProgress[cluster].init();
+		}
 
-			Parameters parameters;
-			parameters.threadIndex = i;
-			parameters.renderer = this;
+		for(int i = 0; i < threadCount; i++)
+		{
+			task[i].type = Task::SUSPEND;
+			pixelQueue[i].init();
+			primitiveQueue[i].init();
 
-			exitThreads = false;
-			worker[i] = new Thread(threadFunction, &parameters);
+			vertexTask[i] = (VertexTask*)allocate(sizeof(VertexTask));
+			vertexTask[i]->vertexCache.initialize(vertexCacheSize);
 
-			suspend[i]->wait();
-			suspend[i]->signal();
+			#if SHADER_PROFILE
+				vertexTask[i]->thread = i;
+			#endif
 		}
 	}
 
 	void Renderer::terminateThreads()
 	{
+		if(!task)
+		{
+			return;
+		}
+
 		while(threadsAwake != 0)
 		{
 			Thread::sleep(1);
 		}
 
+		WorkerPool::detach(this);
+
 		for(int thread = 0; thread < threadCount; thread++)
 		{
-			if(worker[thread])
-			{
-				exitThreads = true;
-				resume[thread]->signal();
-				worker[thread]->join();
-
-				delete worker[thread];
-				worker[thread] = 0;
-				delete resume[thread];
-				resume[thread] = 0;
-				delete suspend[thread];
-				suspend[thread] = 0;
-			}
-
+			vertexTask[thread]->vertexCache.terminate();
 			deallocate(vertexTask[thread]);
-			vertexTask[thread] = 0;
 		}
 
-		for(int i = 0; i < 16; i++)
+		for(int unit = 0; unit < unitCount; unit++)
 		{
-			deallocate(triangleBatch[i]);
-			triangleBatch[i] = 0;
-
-			deallocate(primitiveBatch[i]);
-			primitiveBatch[i] = 0;
+			deallocate(triangleBatch[unit]);
+			deallocate(primitiveBatch[unit]);
 		}
+
+		delete[] task;
+		task = nullptr;
+		delete[] vertexTask;
+		vertexTask = nullptr;
+		delete[] pixelQueue;
+		pixelQueue = nullptr;
+		delete[] primitiveQueue;
+		primitiveQueue = nullptr;
+
+		delete[] triangleBatch;
+		triangleBatch = nullptr;
+		delete[] primitiveBatch;
+		primitiveBatch = nullptr;
+		delete[] primitiveProgress;
+		primitiveProgress = nullptr;
+		delete[] pixelProgress;
+		pixelProgress = nullptr;
 	}
 
 	void Renderer::loadConstants(const VertexShader *vertexShader)
@@ -2180,7 +3632,7 @@ namespace sw
 
 	void Renderer::setTransparencyAntialiasing(TransparencyAntialiasing transparencyAntialiasing)
 	{
-		sw::transparencyAntialiasing = transparencyAntialiasing;
+		context->setState(sw::transparencyAntialiasing, transparencyAntialiasing);
 	}
 
 	bool Renderer::isReadWriteTexture(int sampler)
@@ -2241,7 +3693,7 @@ namespace sw
 	{
 		ASSERT(sampler < TOTAL_IMAGE_UNITS && face < 6 && level < MIPMAP_LEVELS);
 
-		context->sampler[sampler].setTextureLevel(face, level, surface, type);
+		context->stateModified |= context->sampler[sampler].setTextureLevel(face, level, surface, type);
 	}
 
 	void Renderer::setTextureFilter(SamplerType type, int sampler, FilterType textureFilter)
@@ -2513,17 +3965,17 @@ namespace sw
 
 	void Renderer::setDepthBias(float bias)
 	{
-		context->depthBias = bias;
+		context->setState(context->depthBias, bias);
 	}
 
 	void Renderer::setSlopeDepthBias(float slopeBias)
 	{
-		context->slopeDepthBias = slopeBias;
+		context->setState(context->slopeDepthBias, slopeBias);
 	}
 
 	void Renderer::setRasterizerDiscard(bool rasterizerDiscard)
 	{
-		context->rasterizerDiscard = rasterizerDiscard;
+		context->setState(context->rasterizerDiscard, rasterizerDiscard);
 	}
 
 	void Renderer::setPixelShader(const PixelShader *shader)
@@ -2533,6 +3985,49 @@ namespace sw
 		loadConstants(shader);
 	}
 
+	ConstantBlock *Renderer::updateConstants(ConstantBlock *block, const float4 *c, int count, unsigned int (&dirty)[2])
+	{
+		if(block && dirty[0] >= dirty[1])
+		{
+			return block;   // Unchanged since the previous draw call
+		}
+
+		if(!block || block->isShared())   // Still used by pending draw calls, copy on write
+		{
+			if(block)
+			{
+				block->unbind();
+			}
+
+			block = new ConstantBlock(count);
+			block->bind();
+
+			memcpy(block->c, c, sizeof(float4) * count);
+		}
+		else
+		{
+			memcpy(&block->c[dirty[0]], &c[dirty[0]], sizeof(float4) * (dirty[1] - dirty[0]));
+		}
+
+		dirty[0] = dirty[1] = 0;
+
+		return block;
+	}
+
+	void Renderer::markDirty(unsigned int (&dirty)[2], unsigned int index, unsigned int count)
+	{
+		if(dirty[0] >= dirty[1])
+		{
+			dirty[0] = index;
+			dirty[1] = index + count;
+		}
+		else
+		{
+			dirty[0] = min(dirty[0], index);
+			dirty[1] = max(dirty[1], index + count);
+		}
+	}
+
 	void Renderer::setVertexShader(const VertexShader *shader)
 	{
 		context->vertexShader = shader;
@@ -2542,14 +4037,19 @@ namespace sw
 
 	void Renderer::setPixelShaderConstantF(unsigned int index, const float value[4], unsigned int count)
 	{
-		for(unsigned int i = 0; i < DRAW_COUNT; i++)
+		if(index < 8)
 		{
-			if(drawCall[i]->psDirtyConstF < index + count)
+			for(int i = 0; i < drawCallCount; i++)
 			{
-				drawCall[i]->psDirtyConstF = index + count;
+				if(drawCall[i]->psDirtyConstW < index + count)
+				{
+					drawCall[i]->psDirtyConstW = min(index + count, 8u);
+				}
 			}
 		}
 
+		markDirty(psDirtyConstF, index, count);
+
 		for(unsigned int i = 0; i < count; i++)
 		{
 			PixelProcessor::setFloatConstant(index + i, value);
@@ -2559,7 +4059,7 @@ namespace sw
 
 	void Renderer::setPixelShaderConstantI(unsigned int index, const int value[4], unsigned int count)
 	{
-		for(unsigned int i = 0; i < DRAW_COUNT; i++)
+		for(int i = 0; i < drawCallCount; i++)
 		{
 			if(drawCall[i]->psDirtyConstI < index + count)
 			{
@@ -2576,7 +4076,7 @@ namespace sw
 
 	void Renderer::setPixelShaderConstantB(unsigned int index, const int *boolean, unsigned int count)
 	{
-		for(unsigned int i = 0; i < DRAW_COUNT; i++)
+		for(int i = 0; i < drawCallCount; i++)
 		{
 			if(drawCall[i]->psDirtyConstB < index + count)
 			{
@@ -2593,13 +4093,7 @@ namespace sw
 
 	void Renderer::setVertexShaderConstantF(unsigned int index, const float value[4], unsigned int count)
 	{
-		for(unsigned int i = 0; i < DRAW_COUNT; i++)
-		{
-			if(drawCall[i]->vsDirtyConstF < index + count)
-			{
-				drawCall[i]->vsDirtyConstF = index + count;
-			}
-		}
+		markDirty(vsDirtyConstF, index, count);
 
 		for(unsigned int i = 0; i < count; i++)
 		{
@@ -2610,7 +4104,7 @@ namespace sw
 
 	void Renderer::setVertexShaderConstantI(unsigned int index, const int value[4], unsigned int count)
 	{
-		for(unsigned int i = 0; i < DRAW_COUNT; i++)
+		for(int i = 0; i < drawCallCount; i++)
 		{
 			if(drawCall[i]->vsDirtyConstI < index + count)
 			{
@@ -2627,7 +4121,7 @@ namespace sw
 
 	void Renderer::setVertexShaderConstantB(unsigned int index, const int *boolean, unsigned int count)
 	{
-		for(unsigned int i = 0; i < DRAW_COUNT; i++)
+		for(int i = 0; i < drawCallCount; i++)
 		{
 			if(drawCall[i]->vsDirtyConstB < index + count)
 			{
@@ -2675,37 +4169,46 @@ namespace sw
 		queries.remove(query);
 	}
 
-	#if PERF_HUD
-		int Renderer::getThreadCount()
-		{
-			return threadCount;
-		}
+	void Renderer::setConditionalQuery(Query *query)
+	{
+		conditionalQuery = query;
+	}
 
-		int64_t Renderer::getVertexTime(int thread)
-		{
-			return vertexTime[thread];
-		}
+	int Renderer::getThreadCount()
+	{
+		return threadCount;
+	}
 
-		int64_t Renderer::getSetupTime(int thread)
-		{
-			return setupTime[thread];
-		}
+	int64_t Renderer::getVertexTime(int thread)
+	{
+		return getPipelineStatistic(thread, VERTEX_TIME);
+	}
 
-		int64_t Renderer::getPixelTime(int thread)
-		{
-			return pixelTime[thread];
-		}
+	int64_t Renderer::getSetupTime(int thread)
+	{
+		return getPipelineStatistic(thread, SETUP_TIME);
+	}
+
+	int64_t Renderer::getPixelTime(int thread)
+	{
+		return getPipelineStatistic(thread, PIXEL_TIME);
+	}
+
+	void Renderer::resetTimers()
+	{
+		swiftshaderResetPipelineStatistics();
+	}
+
+	void Renderer::setPriority(Priority priority)
+	{
+		WorkerPool::setPriority(this, priority);
 
-		void Renderer::resetTimers()
+		// Workers idling while only higher priority renderers had work may now pick our tasks
+		for(int i = 0; i < threadCount; i++)
 		{
-			for(int thread = 0; thread < threadCount; thread++)
-			{
-				vertexTime[thread] = 0;
-				setupTime[thread] = 0;
-				pixelTime[thread] = 0;
-			}
+			WorkerPool::wake(i);
 		}
-	#endif
+	}
 
 	void Renderer::setViewport(const Viewport &viewport)
 	{
@@ -2748,6 +4251,46 @@ namespace sw
 			precacheSetup = !newConfiguration && configuration.precache;
 			precachePixel = !newConfiguration && configuration.precache;
 
+			asynchronousCompilation = configuration.asynchronousCompilation;
+			hotRoutineThreshold = max(configuration.hotRoutineThreshold, 0);
+			uniformSpecializer.setThreshold(max(configuration.uniformSpecializationThreshold, 0));
+			statisticsLogInterval = max(configuration.statisticsLogInterval, 0);
+			drawCallLimit = clamp(configuration.drawCallQueueSize, 1, (int)MAX_DRAW_COUNT);
+			drawCallMerging = configuration.drawCallMerging;
+			threadSpinCount = max(configuration.threadSpinCount, 0);
+			minThreadCount = max(configuration.minThreadCount, 0);
+			clustersPerThread = clamp(configuration.pixelClustersPerThread, 1, 8);   // Each pixel queue holds the tasks of that many clusters
+			inlineDrawPixels = max(configuration.inlineDrawPixels, 0);
+			threadAffinity = clamp(configuration.threadAffinity, 0, 2);
+
+			if(configuration.pipelineStatistics)   // Otherwise left to swiftshaderEnablePipelineStatistics()
+			{
+				pipelineStatisticsEnabled = true;
+			}
+
+			workerProcessors.clear();
+
+			if(threadAffinity != 0)
+			{
+				CPUID::processorSet(workerProcessors, configuration.threadNumaNode);
+
+				if(workerProcessors.empty())   // Unknown node, or none of its processors are available
+				{
+					CPUID::processorSet(workerProcessors);
+				}
+
+				// Leave the first processors to the application's own threads
+				int reserved = min(max(configuration.reservedCores, 0), (int)workerProcessors.size() - 1);
+				workerProcessors.erase(workerProcessors.begin(), workerProcessors.begin() + max(reserved, 0));
+			}
+			vertexCacheSize = configuration.vertexCacheSize;
+
+			context->stateModified = true;   // Routines depend on the configuration
+
+			Surface::setMemoryBudget((size_t)max(configuration.textureMemory, 0) * 1024 * 1024);
+
+			RoutineCacheThrashDetector::setMemoryBudget((size_t)max(configuration.routineMemory, 0) * 1024 * 1024);
+
 			VertexProcessor::setRoutineCacheSize(configuration.vertexRoutineCacheSize);
 			PixelProcessor::setRoutineCacheSize(configuration.pixelRoutineCacheSize);
 			SetupProcessor::setRoutineCacheSize(configuration.setupRoutineCacheSize);
@@ -2767,7 +4310,11 @@ namespace sw
 			default: Sampler::setMipmapQuality(MIPMAP_LINEAR); break;
 			}
 
+			Sampler::setAdaptiveAnisotropy(configuration.adaptiveAnisotropy);
+			Sampler::setDynamicState(configuration.dynamicSamplerState);
+
 			setPerspectiveCorrection(configuration.perspectiveCorrection);
+			mediumPrecisionMath = configuration.mediumPrecisionMath;
 
 			switch(configuration.transcendentalPrecision)
 			{
@@ -2819,26 +4366,57 @@ namespace sw
 			switch(configuration.threadCount)
 			{
 			case -1: threadCount = CPUID::coreCount();        break;
-			case 0:  threadCount = CPUID::processAffinity();  break;
+			case 0:  threadCount = workerProcessors.empty() ? CPUID::processAffinity() : (int)workerProcessors.size(); break;
 			default: threadCount = configuration.threadCount; break;
 			}
 
+			threadCount = clamp((int)threadCount, 1, (int)MAX_THREAD_COUNT);
+			blitter->setThreadCount(threadCount);
+			FrameBuffer::setThreadCount(threadCount);
+
+			CPUID::setEnableAVX2(configuration.enableAVX2);
+			CPUID::setEnableAVX(configuration.enableAVX);
 			CPUID::setEnableSSE4_1(configuration.enableSSE4_1);
 			CPUID::setEnableSSSE3(configuration.enableSSSE3);
 			CPUID::setEnableSSE3(configuration.enableSSE3);
 			CPUID::setEnableSSE2(configuration.enableSSE2);
 			CPUID::setEnableSSE(configuration.enableSSE);
 
+			// Reactor has its own CPUID for the JIT target
+			unsigned int cpuFeatures = (configuration.enableSSE2 ? rr::CPU_SSE2 : 0) |
+			                           (configuration.enableSSE3 ? rr::CPU_SSE3 : 0) |
+			                           (configuration.enableSSSE3 ? rr::CPU_SSSE3 : 0) |
+			                           (configuration.enableSSE4_1 ? rr::CPU_SSE4_1 : 0) |
+			                           (configuration.enableAVX ? rr::CPU_AVX : 0) |
+			                           (configuration.enableAVX2 ? rr::CPU_AVX2 : 0) |
+			                           (configuration.enableFMA ? rr::CPU_FMA : 0) |
+			                           (configuration.enableF16C ? rr::CPU_F16C : 0) |
+			                           (configuration.enableAVX512 ? rr::CPU_AVX512F : 0);
+
+			rr::Nucleus::setCPUFeatures(cpuFeatures);
+
 			for(int pass = 0; pass < 10; pass++)
 			{
 				optimization[pass] = configuration.optimization[pass];
 			}
 
+			for(int category = rr::RoutineVertex; category < rr::RoutineCategoryCount; category++)
+			{
+				const rr::Optimization *passes = configuration.categoryOptimized[category] ? configuration.categoryOptimization[category] : nullptr;
+				rr::Nucleus::setOptimizationPasses((rr::RoutineCategory)category, passes);
+			}
+
 			forceWindowed = configuration.forceWindowed;
 			complementaryDepthBuffer = configuration.complementaryDepthBuffer;
 			postBlendSRGB = configuration.postBlendSRGB;
 			exactColorRounding = configuration.exactColorRounding;
 			forceClearRegisters = configuration.forceClearRegisters;
+			tiledRasterization = configuration.tiledRasterization;
+			coarseDepthCulling = configuration.coarseDepthCulling;
+			compressedTextureSampling = configuration.compressedTextureSampling;
+			tiledTextureLayout = configuration.tiledTextureLayout;
+			linearSRGBTextures = configuration.linearSRGBTextures;
+			guardBandClipping = configuration.guardBandClipping;
 
 		#ifndef NDEBUG
 			minPrimitives = configuration.minPrimitives;
@@ -2846,7 +4424,7 @@ namespace sw
 		#endif
 		}
 
-		if(!initialUpdate && !worker[0])
+		if(!initialUpdate && !task)
 		{
 			initializeThreads();
 		}
@@ -20,16 +20,23 @@
 #include "SetupProcessor.hpp"
 #include "Plane.hpp"
 #include "Blitter.hpp"
+#include "RoutineCompiler.hpp"
+#include "UniformSpecializer.hpp"
+#include "Shader/ShaderProfile.hpp"
+#include "Common/CompletionSignal.hpp"
 #include "Common/MutexLock.hpp"
 #include "Common/Thread.hpp"
 #include "Main/Config.hpp"
 
+#include <bitset>
 #include <list>
+#include <vector>
 
 namespace sw
 {
 	class Clipper;
 	struct DrawCall;
+	class ConstantBlock;
 	class PixelShader;
 	class VertexShader;
 	class SwiftConfig;
@@ -89,7 +96,7 @@ namespace sw
 	{
 		enum Type { FRAGMENTS_PASSED, TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN };
 
-		Query(Type type) : building(false), reference(0), data(0), type(type)
+		Query(Type type) : building(false), reference(0), data(0), conditions(0), type(type)
 		{
 		}
 
@@ -107,6 +114,7 @@ namespace sw
 		bool building;
 		AtomicInt reference;
 		AtomicInt data;
+		AtomicInt conditions;   // Draw calls still to be skipped or not depending on the result
 
 		const Type type;
 	};
@@ -117,12 +125,14 @@ namespace sw
 
 		const void *input[MAX_VERTEX_INPUTS];
 		unsigned int stride[MAX_VERTEX_INPUTS];
+		unsigned int divisor[MAX_VERTEX_INPUTS];          // Instances per element, 0 for per-vertex streams
+		unsigned int instanceStride[MAX_VERTEX_INPUTS];
 		Texture mipmap[TOTAL_IMAGE_UNITS];
 		const void *indices;
 
 		struct VS
 		{
-			float4 c[VERTEX_UNIFORM_VECTORS + 1];   // One extra for indices out of range, c[VERTEX_UNIFORM_VECTORS] = {0, 0, 0, 0}
+			const float4 *c;   // VERTEX_UNIFORM_VECTORS + 1, one extra for indices out of range, c[VERTEX_UNIFORM_VECTORS] = {0, 0, 0, 0}
 			byte* u[MAX_UNIFORM_BUFFER_BINDINGS];
 			byte* t[MAX_TRANSFORM_FEEDBACK_INTERLEAVED_COMPONENTS];
 			unsigned int reg[MAX_TRANSFORM_FEEDBACK_INTERLEAVED_COMPONENTS]; // Offset used when reading from registers, in components
@@ -136,7 +146,7 @@ namespace sw
 		struct PS
 		{
 			word4 cW[8][4];
-			float4 c[FRAGMENT_UNIFORM_VECTORS];
+			const float4 *c;   // FRAGMENT_UNIFORM_VECTORS
 			byte* u[MAX_UNIFORM_BUFFER_BINDINGS];
 			int4 i[16];
 			bool b[16];
@@ -150,8 +160,6 @@ namespace sw
 
 		PS ps;
 
-		int instanceID;
-
 		VertexProcessor::PointSprite point;
 		float lineWidth;
 
@@ -159,10 +167,14 @@ namespace sw
 		PixelProcessor::Stencil stencilCCW;
 		PixelProcessor::Fog fog;
 		PixelProcessor::Factor factor;
-		unsigned int occlusion[16];   // Number of pixels passing depth test
+		unsigned int occlusion[MAX_THREAD_COUNT];   // Number of pixels passing depth test, per cluster
 
 		#if PERF_PROFILE
-			int64_t cycles[PERF_TIMERS][16];
+			int64_t cycles[PERF_TIMERS][MAX_THREAD_COUNT];
+		#endif
+
+		#if SHADER_PROFILE
+			ShaderProfile::Counter **shaderProfile;   // Indexed by the slot compiled into the shader programs
 		#endif
 
 		TextureStage::Uniforms textureStage[8];
@@ -179,17 +191,27 @@ namespace sw
 		float slopeDepthBias;
 		float depthRange;
 		float depthNear;
+		float guardBandX;   // Clip-space extents relative to w within which X and Y clipping can be skipped, zero when disabled
+		float guardBandY;
 		Plane clipPlane[6];
 
 		unsigned int *colorBuffer[RENDERTARGETS];
 		int colorPitchB[RENDERTARGETS];
 		int colorSliceB[RENDERTARGETS];
+		unsigned char *uniformSamples[RENDERTARGETS];
+		int uniformSamplesPitchB[RENDERTARGETS];
 		float *depthBuffer;
 		int depthPitchB;
 		int depthSliceB;
+		float *coarseDepthBuffer;
+		int coarseDepthPitchB;
+		int depthWidth;
+		float depthClearValue;   // For coarse depth tiles still marked as cleared
 		unsigned char *stencilBuffer;
 		int stencilPitchB;
 		int stencilSliceB;
+		unsigned int *overdrawHeatmap;
+		int overdrawHeatmapPitchB;
 
 		int scissorX0;
 		int scissorX1;
@@ -230,6 +252,32 @@ namespace sw
 			AtomicInt pixelCluster;
 		};
 
+		// Per-thread double-ended task queue. The owning thread takes tasks from
+		// the front, idle threads steal from the back. Tasks are only ever pushed
+		// by findAvailableTasks() while holding the scheduler mutex.
+		class TaskDeque
+		{
+		public:
+			void init();
+
+			void push(const Task &task);
+			bool pop(Task &task, AtomicInt &queued);
+			bool steal(Task &task, AtomicInt &queued);
+
+			int size() const { return count; }
+
+		private:
+			enum {
+				CAPACITY = 32,   // Must be power of 2 and hold all units and clusters
+				CAPACITY_BITS = CAPACITY - 1,
+			};
+
+			MutexLock mutex;
+			Task task[CAPACITY];
+			AtomicInt head;
+			AtomicInt count;
+		};
+
 		struct PrimitiveProgress
 		{
 			void init()
@@ -238,6 +286,8 @@ namespace sw
 				firstPrimitive = 0;
 				primitiveCount = 0;
 				visible = 0;
+				yMin = 0;
+				yMax = 0;
 				references = 0;
 			}
 
@@ -245,6 +295,8 @@ namespace sw
 			AtomicInt firstPrimitive;
 			AtomicInt primitiveCount;
 			AtomicInt visible;
+			AtomicInt yMin;   // Rows covered by the visible primitives
+			AtomicInt yMax;
 			AtomicInt references;
 		};
 
@@ -262,6 +314,11 @@ namespace sw
 			AtomicInt executing;
 		};
 
+		class RoutineJob;
+		class VertexRoutineJob;
+		class SetupRoutineJob;
+		class PixelRoutineJob;
+
 	public:
 		Renderer(Context *context, Conventions conventions, bool exactColorRounding);
 
@@ -270,7 +327,7 @@ namespace sw
 		void *operator new(size_t size);
 		void operator delete(void * mem);
 
-		void draw(DrawType drawType, unsigned int indexOffset, unsigned int count, bool update = true);
+		void draw(DrawType drawType, unsigned int indexOffset, unsigned int count, bool update = true, unsigned int instanceCount = 1);   // Without update, routine states are only derived again when modified
 
 		void clear(void *value, Format format, Surface *dest, const Rect &rect, unsigned int rgbaMask);
 		void blit(Surface *source, const SliceRectF &sRect, Surface *dest, const SliceRect &dRect, bool filter, bool isStencil = false, bool sRGBconversion = true);
@@ -341,28 +398,70 @@ namespace sw
 
 		void addQuery(Query *query);
 		void removeQuery(Query *query);
+		void setConditionalQuery(Query *query);   // Later draw calls are skipped when it counts no fragments, nullptr draws unconditionally
 
 		void synchronize();
 
-		#if PERF_HUD
-			// Performance timers
-			int getThreadCount();
-			int64_t getVertexTime(int thread);
-			int64_t getSetupTime(int thread);
-			int64_t getPixelTime(int thread);
-			void resetTimers();
-		#endif
+		// Draw calls are numbered in submission order, fences wait for the ones issued before them
+		int getDrawSequence() const;
+		bool isComplete(int sequence) const;
+		void synchronize(int sequence);
+		bool synchronize(int sequence, uint64_t timeout);   // Nanoseconds, returns false if the draws didn't complete in time
+
+		// Per-thread time spent on each stage while pipeline statistics are enabled, in Timer::counter() units
+		int getThreadCount();
+		int64_t getVertexTime(int thread);
+		int64_t getSetupTime(int thread);
+		int64_t getPixelTime(int thread);
+		void resetTimers();
 
 		static int getClusterCount() { return clusterCount; }
 
+		// Scheduling class among all renderers sharing the worker threads
+		enum Priority
+		{
+			PRIORITY_LOW,
+			PRIORITY_MEDIUM,
+			PRIORITY_HIGH
+		};
+
+		void setPriority(Priority priority);
+
 	private:
-		static void threadFunction(void *parameters);
-		void threadLoop(int threadIndex);
+		friend class WorkerPool;
+
+		bool hasTasks(int threadIndex) const;
+		void executeTasks(int threadIndex, int count);   // Called by worker threadIndex of the WorkerPool
 		void taskLoop(int threadIndex);
+		bool executeInline();
+		void adaptThreadCount();
 		void findAvailableTasks();
-		void scheduleTask(int threadIndex);
+		void queueTask(const Task &task);
+		bool acquireTask(int threadIndex);
+		bool scheduleTask(int threadIndex);   // Returns false when the thread has been suspended
 		void executeTask(int threadIndex);
 		void finishRendering(Task &pixelTask);
+		void finishDrawCall(DrawCall &draw, int processedPrimitives);
+		void advanceCompletion();
+		bool mergeDrawCall(DrawCall &draw);
+		bool canMerge(const DrawCall &previous, const DrawCall &draw) const;
+		static ConstantBlock *updateConstants(ConstantBlock *block, const float4 *c, int count, unsigned int (&dirty)[2]);
+		static void markDirty(unsigned int (&dirty)[2], unsigned int index, unsigned int count);
+
+		bool stateModified() const;
+		void acquireRoutines();
+		static void holdRoutine(Routine *&held, Routine *routine);
+		bool compileAsynchronously() const;
+		void scheduleCompilation(DeferredRoutine *routine);
+		void specializeRoutines(Routine *&drawVertexRoutine, Routine *&drawPixelRoutine);
+		Routine *specializeVertexRoutine();
+		Routine *specializePixelRoutine();
+		DeferredRoutine *deferredRoutine(Routine *routine);
+		bool routinesReady(DrawCall *draw);
+		bool resolveCondition(DrawCall &draw);
+		void passDrawCalls(int cluster);
+		void routineCompiled();
+		void resumeThreads();
 
 		void processPrimitiveVertices(int unit, unsigned int start, unsigned int count, unsigned int loop, int thread);
 
@@ -371,9 +470,14 @@ namespace sw
 		int setupVertexTriangle(int batch, int count);
 		int setupLines(int batch, int count);
 		int setupPoints(int batch, int count);
+		unsigned int cullTriangles(const Triangle *triangle, int count, const DrawCall &draw) const;
+		unsigned int cullWidePrimitives(const Triangle *triangle, int count, int vertices, const DrawCall &draw, unsigned int &inside) const;
+		float pointSize(const Vertex &v, const DrawCall &draw) const;
+		bool hasPixels(int unit, int cluster) const;
+		static bool clusterCoversRows(int cluster, int yMin, int yMax);
 
-		bool setupLine(Primitive &primitive, Triangle &triangle, const DrawCall &draw);
-		bool setupPoint(Primitive &primitive, Triangle &triangle, const DrawCall &draw);
+		bool setupLine(Primitive &primitive, Triangle &triangle, const DrawCall &draw, bool inside = false);
+		bool setupPoint(Primitive &primitive, Triangle &triangle, const DrawCall &draw, bool inside = false);   // Inside the frustum, no clipping required
 
 		bool isReadWriteTexture(int sampler);
 		void updateClipper();
@@ -391,68 +495,116 @@ namespace sw
 		Rect scissor;
 		int clipFlags;
 
-		Triangle *triangleBatch[16];
-		Primitive *primitiveBatch[16];
+		Triangle **triangleBatch;     // Per primitive unit
+		Primitive **primitiveBatch;   // Per primitive unit
 
 		// User-defined clipping planes
 		Plane userPlane[MAX_CLIP_PLANES];
 		Plane clipPlane[MAX_CLIP_PLANES];   // Tranformed to clip space
 		bool updateClipPlanes;
 
-		AtomicInt exitThreads;
 		AtomicInt threadsAwake;
-		Thread *worker[16];
-		Event *resume[16];         // Events for resuming threads
-		Event *suspend[16];        // Events for suspending threads
 		Event *resumeApp;          // Event for resuming the application thread
 
-		PrimitiveProgress primitiveProgress[16];
-		PixelProgress pixelProgress[16];
-		Task task[16];   // Current tasks for threads
+		// Thread slots which get woken for new tasks, the others stay parked. Adapted to the
+		// load between minThreadCount and threadCount, 0 keeps all slots active.
+		AtomicInt activeThreads;
+		int minThreadCount;
+		int64_t busyTime[MAX_THREAD_COUNT];    // Timer::counter() ticks each slot spent executing tasks
+		int64_t awakeTime[MAX_THREAD_COUNT];   // Including scheduling and stealing them
+		AtomicInt throttledWakeups;            // Tasks were queued while all active slots were awake
+		int64_t adaptationTime;
+		int64_t adaptationBusy;
+		int64_t adaptationAwake;
+
+		PrimitiveProgress *primitiveProgress;   // Per primitive unit
+		PixelProgress *pixelProgress;           // Per pixel cluster
+		Task *task;                             // Current tasks for threads
 
 		enum {
-			DRAW_COUNT = 16,   // Number of draw calls buffered (must be power of 2)
-			DRAW_COUNT_BITS = DRAW_COUNT - 1,
+			MAX_DRAW_COUNT = 256,   // Maximum number of draw calls buffered (must be power of 2)
+			DRAW_COUNT_BITS = MAX_DRAW_COUNT - 1,
 		};
-		DrawCall *drawCall[DRAW_COUNT];
-		DrawCall *drawList[DRAW_COUNT];
+		DrawCall *drawCall[MAX_DRAW_COUNT];   // Pool, grown on demand up to drawCallLimit
+		DrawCall *drawList[MAX_DRAW_COUNT];
+		AtomicInt drawCallCount;   // Also read by the workers when retiring draws
+		int drawCallLimit;
+		bool drawCallMerging;   // Append draws which only continue the previous one's vertex or index range to it
 
 		AtomicInt currentDraw;
 		AtomicInt nextDraw;
+		CompletionSignal completed;   // All draws before this sequence number have finished
 
-		enum {
-			TASK_COUNT = 32,   // Size of the task queue (must be power of 2)
-			TASK_COUNT_BITS = TASK_COUNT - 1,
-		};
-		Task taskQueue[TASK_COUNT];
-		AtomicInt qHead;
-		AtomicInt qSize;
+		TaskDeque *pixelQueue;       // Per thread pixel tasks, preferred since they retire draw calls
+		TaskDeque *primitiveQueue;   // Per thread primitive tasks
+		AtomicInt qSize;                // Total number of queued tasks
 
 		static AtomicInt unitCount;
 		static AtomicInt clusterCount;
 
 		MutexLock schedulerMutex;
 
-		#if PERF_HUD
-			int64_t vertexTime[16];
-			int64_t setupTime[16];
-			int64_t pixelTime[16];
-		#endif
-
-		VertexTask *vertexTask[16];
+		VertexTask **vertexTask;   // Per thread
+		int vertexCacheSize;       // Post-transform cache entries of each thread
 
 		SwiftConfig *swiftConfig;
 
 		std::list<Query*> queries;
+		Query *conditionalQuery;
 		Resource *sync;
 
 		VertexProcessor::State vertexState;
 		SetupProcessor::State setupState;
 		PixelProcessor::State pixelState;
 
+		// Bound while held, since the routine caches are shared with other renderers
 		Routine *vertexRoutine;
 		Routine *setupRoutine;
 		Routine *pixelRoutine;
+		Routine *genericVertexRoutine;   // Used while the fixed-function vertexRoutine is compiling
+
+		// Routines with the current branch uniforms folded in, used once they're compiled
+		UniformSpecializer uniformSpecializer;
+		uint64_t vertexSpecialization;
+		uint64_t pixelSpecialization;
+		Routine *specializedVertexRoutine;
+		Routine *specializedPixelRoutine;
+
+		bool asynchronousCompilation;
+		int hotRoutineThreshold;   // Asynchronously compiled routines get optimized once used by this many draws, 0 optimizes right away
+		int statisticsLogInterval;   // Seconds between routine statistics printouts, 0 disables them
+		std::list<DeferredRoutine*> deferredRoutines;   // Routines which may still be compiling
+		AtomicInt pendingCompilations;
+		MutexLock resumeMutex;
+		int threadSpinCount;   // Iterations a suspending thread polls for new work before blocking
+		int inlineDrawPixels;   // Scissor area up to which single-batch draws run on the application thread, 0 disables it
+		AtomicInt inlineExecution;   // The application thread is executing the tasks of thread slot 0
+		int threadAffinity;   // 0: unrestricted, 1: workers share the processor set, 2: each worker pinned to one processor
+		std::vector<int> workerProcessors;   // Processors available to worker threads
+
+		ConstantBlock *vsConstants;   // Snapshot of the vertex shader float constants
+		ConstantBlock *psConstants;   // Snapshot of the pixel shader float constants
+		unsigned int vsDirtyConstF[2];   // Range of constants changed since the snapshot
+		unsigned int psDirtyConstF[2];
+	};
+
+	// Reference counted copy of a float constant array. Draw calls issued while
+	// the constants don't change share one block, instead of each copying them.
+	class ConstantBlock
+	{
+	public:
+		explicit ConstantBlock(int count);
+
+		void bind() { ++references; }
+		void unbind();
+		bool isShared() const { return references > 1; }
+
+		float4 *const c;
+
+	private:
+		~ConstantBlock();
+
+		AtomicInt references;
 	};
 
 	struct DrawCall
@@ -463,11 +615,15 @@ namespace sw
 
 		AtomicInt drawType;
 		AtomicInt batchSize;
+		int sequence;   // Value of nextDraw when submitted
 
 		Routine *vertexRoutine;
 		Routine *setupRoutine;
 		Routine *pixelRoutine;
 
+		bool deferred;   // Routines are still being compiled, entry pointers are not set yet
+		DeferredRoutine *deferredRoutine[3];
+
 		VertexProcessor::RoutinePointer vertexPointer;
 		SetupProcessor::RoutinePointer setupPointer;
 		PixelProcessor::RoutinePointer pixelPointer;
@@ -485,20 +641,29 @@ namespace sw
 		Resource* vUniformBuffers[MAX_UNIFORM_BUFFER_BINDINGS];
 		Resource* transformFeedbackBuffers[MAX_TRANSFORM_FEEDBACK_INTERLEAVED_COMPONENTS];
 
-		unsigned int vsDirtyConstF;
+		ConstantBlock *vsConstants;
+		ConstantBlock *psConstants;
+
 		unsigned int vsDirtyConstI;
 		unsigned int vsDirtyConstB;
 
-		unsigned int psDirtyConstF;
+		unsigned int psDirtyConstW;   // Short constants used by ps_1_x
 		unsigned int psDirtyConstI;
 		unsigned int psDirtyConstB;
 
-		std::list<Query*> *queries;
+		std::vector<Query*> queries;   // Keeps its storage when the draw call gets reused
+		Query *condition;   // Skipped when it counted no fragments, decided once the draw calls before it are done
 
 		AtomicInt clipFlags;
 
+		bool vertexOnly;            // Rasterization is discarded, batches retire as soon as their vertices are processed
+		bool occlusion;             // The pixel routine counts samples passing the depth and stencil tests
+		std::bitset<MAX_THREAD_COUNT> clusterMask;   // Pixel clusters owning rows inside the scissor rectangle
+		int clusters;                                // Number of bits set in clusterMask
+
 		AtomicInt primitive;    // Current primitive to enter pipeline
-		AtomicInt count;        // Number of primitives to render
+		AtomicInt count;        // Number of primitives to render, over all instances
+		int instancePrimitives;   // Number of primitives per instance
 		AtomicInt references;   // Remaining references to this draw call, 0 when done drawing, -1 when resources unlocked and slot is free
 
 		DrawData *data;
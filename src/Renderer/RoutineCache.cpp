@@ -0,0 +1,434 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "RoutineCache.hpp"
+
+#include "Renderer.hpp"
+#include "Common/CPUID.hpp"
+#include "Common/Version.h"
+#include "Reactor/ExecutableMemory.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace sw
+{
+	extern bool halfIntegerCoordinates;
+	extern bool symmetricNormalizedDepth;
+	extern bool booleanFaceRegister;
+	extern bool fullPixelPositionRegister;
+	extern bool leadingVertexFirst;
+	extern bool secondaryColor;
+	extern bool colorsDefaultToZero;
+	extern bool complementaryDepthBuffer;
+	extern bool postBlendSRGB;
+	extern bool exactColorRounding;
+	extern TransparencyAntialiasing transparencyAntialiasing;
+	extern bool forceClearRegisters;
+
+	extern TranscendentalPrecision logPrecision;
+	extern TranscendentalPrecision expPrecision;
+	extern TranscendentalPrecision rcpPrecision;
+	extern TranscendentalPrecision rsqPrecision;
+	extern bool perspectiveCorrection;
+
+	static const char magic[4] = {'S', 'W', 'R', 'C'};
+	static const char packMagic[4] = {'S', 'W', 'R', 'P'};
+
+	struct Header
+	{
+		char magic[4];
+		uint32_t keySize;
+		uint32_t imageSize;
+		uint64_t fingerprint;
+	};
+
+	// Routine packs start with the magic and entry count, followed by the index
+	// sorted by key, then the routine files' contents.
+	struct PackEntry
+	{
+		uint64_t key;
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	static uint64_t hash(uint64_t h, const void *data, size_t size)
+	{
+		const unsigned char *bytes = static_cast<const unsigned char*>(data);
+
+		for(size_t i = 0; i < size; i++)
+		{
+			h = (h ^ bytes[i]) * 0x100000001B3ull;   // FNV-1a
+		}
+
+		return h;
+	}
+
+	// Everything outside of the processor states which affects the generated code.
+	// Compiled-in constants are covered by the build stamp.
+	static uint64_t fingerprint()
+	{
+		const char build[] = VERSION_STRING " " __DATE__ " " __TIME__;
+		uint64_t h = hash(0xCBF29CE484222325ull, build, sizeof(build));
+
+		const int settings[] =
+		{
+			(int)sizeof(void*),
+			CPUID::supportsMMX(), CPUID::supportsCMOV(), CPUID::supportsSSE(), CPUID::supportsSSE2(),
+			CPUID::supportsSSE3(), CPUID::supportsSSSE3(), CPUID::supportsSSE4_1(),
+			(int)rr::Nucleus::getCPUFeatures(),   // The JIT target, which may differ from the C++ code's CPUID
+			halfIntegerCoordinates, symmetricNormalizedDepth, booleanFaceRegister, fullPixelPositionRegister,
+			leadingVertexFirst, secondaryColor, colorsDefaultToZero, complementaryDepthBuffer,
+			postBlendSRGB, exactColorRounding, transparencyAntialiasing, forceClearRegisters,
+			logPrecision, expPrecision, rcpPrecision, rsqPrecision, perspectiveCorrection,
+			Renderer::getClusterCount()
+		};
+
+		h = hash(h, settings, sizeof(settings));
+
+		for(int category = 0; category < rr::RoutineCategoryCount; category++)
+		{
+			h = hash(h, rr::Nucleus::getOptimizationPasses((rr::RoutineCategory)category), sizeof(rr::optimization));
+		}
+
+		return h;
+	}
+
+	static std::string fileName(const char *name, uint64_t key)
+	{
+		const char *directory = getenv("SWIFTSHADER_ROUTINE_CACHE_DIR");
+
+		char file[64];
+		snprintf(file, sizeof(file), "/%s-%016llX.bin", name, (unsigned long long)key);
+
+		return std::string(directory ? directory : ".") + file;
+	}
+
+	static uint64_t packKey(const char *name, uint64_t key)
+	{
+		return hash(key, name, strlen(name));
+	}
+
+	static bool readFile(const char *path, std::vector<unsigned char> &data)
+	{
+		FILE *file = fopen(path, "rb");
+
+		if(!file)
+		{
+			return false;
+		}
+
+		bool read = fseek(file, 0, SEEK_END) == 0;
+		long size = read ? ftell(file) : -1;
+		read = read && size > 0 && fseek(file, 0, SEEK_SET) == 0;
+
+		if(read)
+		{
+			data.resize(size);
+			read = fread(&data[0], size, 1, file) == 1;
+		}
+
+		fclose(file);
+
+		return read;
+	}
+
+	static Routine *loadImage(const unsigned char *data, size_t size, const void *state, size_t stateSize, uint64_t print)
+	{
+		Header header;
+
+		if(size < sizeof(header))
+		{
+			return nullptr;
+		}
+
+		memcpy(&header, data, sizeof(header));
+
+		// The full key is stored to reject hash collisions
+		if(memcmp(header.magic, magic, sizeof(magic)) != 0 ||
+		   header.fingerprint != print ||
+		   header.keySize != stateSize ||
+		   header.imageSize == 0 ||
+		   size - sizeof(header) < (size_t)header.keySize + header.imageSize ||
+		   memcmp(data + sizeof(header), state, stateSize) != 0)
+		{
+			return nullptr;
+		}
+
+		return Nucleus::loadRoutine(data + sizeof(header) + header.keySize, header.imageSize);
+	}
+
+	// Read once, and kept for the lifetime of the process
+	static const std::vector<unsigned char> &routinePack()
+	{
+		static const std::vector<unsigned char> *pack = []()
+		{
+			std::vector<unsigned char> *data = new std::vector<unsigned char>();
+			const char *path = getenv("SWIFTSHADER_ROUTINE_PACK");
+			uint32_t count = 0;
+
+			if(path && readFile(path, *data) && data->size() >= 8 && memcmp(&(*data)[0], packMagic, sizeof(packMagic)) == 0)
+			{
+				memcpy(&count, &(*data)[4], sizeof(count));
+			}
+
+			if(data->size() < 8 + (size_t)count * sizeof(PackEntry) || count == 0)
+			{
+				if(path)
+				{
+					fprintf(stderr, "SwiftShader: ignoring invalid routine pack %s\n", path);
+				}
+
+				data->clear();
+			}
+
+			return data;
+		}();
+
+		return *pack;
+	}
+
+	Routine *PersistentRoutineCache::loadPacked(const char *name, const void *state, size_t stateSize)
+	{
+		const std::vector<unsigned char> &pack = routinePack();
+
+		if(pack.empty())
+		{
+			return nullptr;
+		}
+
+		const uint64_t print = fingerprint();
+		const uint64_t key = packKey(name, hash(print, state, stateSize));
+
+		uint32_t count;
+		memcpy(&count, &pack[4], sizeof(count));
+		const unsigned char *index = &pack[8];
+
+		int lo = 0;
+		int hi = (int)count - 1;
+
+		while(lo <= hi)
+		{
+			int mid = (lo + hi) / 2;
+
+			PackEntry entry;
+			memcpy(&entry, index + mid * sizeof(PackEntry), sizeof(entry));
+
+			if(entry.key < key)
+			{
+				lo = mid + 1;
+			}
+			else if(entry.key > key)
+			{
+				hi = mid - 1;
+			}
+			else
+			{
+				if(entry.offset > pack.size() || entry.size > pack.size() - entry.offset)
+				{
+					return nullptr;
+				}
+
+				return loadImage(&pack[entry.offset], entry.size, state, stateSize, print);
+			}
+		}
+
+		return nullptr;
+	}
+
+	Routine *PersistentRoutineCache::load(const char *name, const void *state, size_t stateSize)
+	{
+		const uint64_t print = fingerprint();
+		std::vector<unsigned char> data;
+
+		if(!readFile(fileName(name, hash(print, state, stateSize)).c_str(), data))
+		{
+			return nullptr;
+		}
+
+		return loadImage(&data[0], data.size(), state, stateSize, print);
+	}
+
+	int PersistentRoutineCache::writePack(const char *path, const char *const *files, int fileCount)
+	{
+		typedef std::pair<uint64_t, std::vector<unsigned char>> Packed;   // Key and file contents
+		std::vector<Packed> routines;
+
+		for(int i = 0; i < fileCount; i++)
+		{
+			// Routine files are named <name>-<key>.bin by store()
+			std::string file = files[i];
+			size_t slash = file.find_last_of("/\\");
+			std::string base = (slash == std::string::npos) ? file : file.substr(slash + 1);
+			size_t dash = base.rfind('-');
+			unsigned long long key = 0;
+			char extension[8] = {};
+
+			if(dash == std::string::npos || sscanf(base.c_str() + dash + 1, "%16llX.%4s", &key, extension) != 2 || strcmp(extension, "bin") != 0)
+			{
+				fprintf(stderr, "%s: not a routine file, skipped\n", files[i]);
+				continue;
+			}
+
+			Packed routine;
+			routine.first = packKey(base.substr(0, dash).c_str(), key);
+
+			if(!readFile(files[i], routine.second) || routine.second.size() < sizeof(Header) ||
+			   memcmp(&routine.second[0], magic, sizeof(magic)) != 0)
+			{
+				fprintf(stderr, "%s: can't read routine file, skipped\n", files[i]);
+				continue;
+			}
+
+			routines.push_back(std::move(routine));
+		}
+
+		std::sort(routines.begin(), routines.end(), [](const Packed &a, const Packed &b) { return a.first < b.first; });
+
+		// The same routine captured twice, e.g. from several cache directories
+		routines.erase(std::unique(routines.begin(), routines.end(), [](const Packed &a, const Packed &b) { return a.first == b.first; }), routines.end());
+
+		FILE *file = fopen(path, "wb");
+
+		if(!file)
+		{
+			return -1;
+		}
+
+		uint32_t count = (uint32_t)routines.size();
+		uint64_t offset = 8 + (uint64_t)count * sizeof(PackEntry);
+
+		bool written = fwrite(packMagic, sizeof(packMagic), 1, file) == 1 &&
+		               fwrite(&count, sizeof(count), 1, file) == 1;
+
+		for(const Packed &routine : routines)
+		{
+			PackEntry entry = {routine.first, offset, routine.second.size()};
+			offset += routine.second.size();
+
+			written = written && fwrite(&entry, sizeof(entry), 1, file) == 1;
+		}
+
+		for(const Packed &routine : routines)
+		{
+			written = written && fwrite(&routine.second[0], routine.second.size(), 1, file) == 1;
+		}
+
+		written = (fclose(file) == 0) && written;
+
+		if(!written)
+		{
+			remove(path);
+			return -1;
+		}
+
+		return (int)count;
+	}
+
+	static std::atomic<size_t> routineMemoryBudget(64 * 1024 * 1024);
+
+	RoutineCacheThrashDetector::RoutineCacheThrashDetector(const char *name) : name(name)
+	{
+		historyFill = 0;
+		historyNext = 0;
+
+		windowAdds = 0;
+		windowRecompiles = 0;
+		recompiles = 0;
+		evictions = 0;
+		budgetWarned = false;
+	}
+
+	int RoutineCacheThrashDetector::added(unsigned int hash, bool evicted, unsigned int evictedHash, int size)
+	{
+		// Routines only get added after a cache miss, so this is far cheaper than the compilation
+		for(int i = 0; i < historyFill; i++)
+		{
+			if(history[i] == hash)
+			{
+				recompiles++;
+				windowRecompiles++;
+				history[i] = ~hash;   // Counted once per eviction
+				break;
+			}
+		}
+
+		if(evicted)
+		{
+			evictions++;
+
+			history[historyNext] = evictedHash;
+			historyNext = (historyNext + 1) % HISTORY;
+
+			if(historyFill < HISTORY)
+			{
+				historyFill++;
+			}
+		}
+
+		windowAdds++;
+
+		// Consider growing once per cache size worth of additions, when at least a quarter were recompilations
+		if(windowAdds < max(size, 64))
+		{
+			return 0;
+		}
+
+		bool thrashing = windowRecompiles * 4 >= windowAdds;
+		int adds = windowAdds;
+		int recompiled = windowRecompiles;
+
+		windowAdds = 0;
+		windowRecompiles = 0;
+
+		if(!thrashing)
+		{
+			return 0;
+		}
+
+		size_t budget = routineMemoryBudget;
+
+		if(size >= 65536 || rr::executableMemoryUsage() >= budget)
+		{
+			if(!budgetWarned)
+			{
+				fprintf(stderr, "SwiftShader: %s routine cache thrashing, %d of the last %d routines were recompiled after eviction "
+				                "(%" PRIu64 " in total), can't grow beyond %d entries within the %d MB routine memory budget\n",
+				        name, recompiled, adds, recompiles, size, (int)(budget / (1024 * 1024)));
+
+				budgetWarned = true;
+			}
+
+			return 0;
+		}
+
+		fprintf(stderr, "SwiftShader: %s routine cache thrashing, %d of the last %d routines were recompiled after eviction "
+		                "(%" PRIu64 " in total, %" PRIu64 " evictions), growing from %d to %d entries\n",
+		        name, recompiled, adds, recompiles, evictions, size, 2 * size);
+
+		return 2 * size;
+	}
+
+	void RoutineCacheThrashDetector::setMemoryBudget(size_t bytes)
+	{
+		routineMemoryBudget = bytes;
+	}
+}
@@ -18,27 +18,124 @@
 #include "LRUCache.hpp"
 
 #include "Reactor/Reactor.hpp"
+#include "Common/MutexLock.hpp"
+
+#include <memory>
+#include <vector>
 
 namespace sw
 {
 	using namespace rr;
 
+	// Keeps routine images on disk, so later processes can skip code generation.
+	// Only backends which produce relocatable code support this.
+	class PersistentRoutineCache
+	{
+	public:
+		static Routine *load(const char *name, const void *state, size_t stateSize);
+		static void store(const char *name, const void *state, size_t stateSize, Routine *routine);
+
+		// Routine packs bundle the images store() wrote while running representative workloads,
+		// and are consulted whenever SWIFTSHADER_ROUTINE_PACK names one, even without precaching.
+		static Routine *loadPacked(const char *name, const void *state, size_t stateSize);
+		static int writePack(const char *path, const char *const *files, int fileCount);   // Returns the number of routines packed, or -1
+	};
+
+	// Notices when a full cache keeps regenerating routines it recently evicted,
+	// and decides when to grow it. Growth stops once the executable memory
+	// reaches the budget.
+	class RoutineCacheThrashDetector
+	{
+	public:
+		explicit RoutineCacheThrashDetector(const char *name);
+
+		// Called for each routine added to a cache of the given size.
+		// Returns the size the cache should grow to, or 0 to keep it.
+		int added(unsigned int hash, bool evicted, unsigned int evictedHash, int size);
+
+		static void setMemoryBudget(size_t bytes);   // 0 disables growing
+
+	private:
+		enum {HISTORY = 1024};   // Hashes of the most recent evictions
+
+		const char *name;
+
+		unsigned int history[HISTORY];
+		int historyFill;
+		int historyNext;
+
+		int windowAdds;        // Since growth was last considered
+		int windowRecompiles;
+		uint64_t recompiles;
+		uint64_t evictions;
+		bool budgetWarned;
+	};
+
+	typedef std::shared_ptr<const std::vector<unsigned char>> ShaderContent;   // See Shader::getContent()
+
+	// States identify their shader by a hash of its contents, so the entries also keep the
+	// contents and compare them, to keep colliding shaders from sharing a routine.
 	template<class State>
-	class RoutineCache : public LRUCache<State, Routine>
+	struct RoutineCacheKey
 	{
+		State state;
+		ShaderContent content;   // Null for states without a shader
+		unsigned int hash;
+
+		bool operator==(const RoutineCacheKey &key) const
+		{
+			if(!(state == key.state))
+			{
+				return false;
+			}
+
+			if(content == key.content)   // The same shader, or neither has one
+			{
+				return true;
+			}
+
+			return content && key.content && *content == *key.content;
+		}
+	};
+
+	// Thread-safe cache shared by all renderers in the process, so contexts with
+	// identical states don't each generate the same routines.
+	template<class State>
+	class RoutineCache : public LRUCache<RoutineCacheKey<State>, Routine>
+	{
+		typedef LRUCache<RoutineCacheKey<State>, Routine> Cache;
+
 	public:
-		RoutineCache(int n, const char *precache = nullptr);
-		~RoutineCache();
+		static RoutineCache *acquire(int n, const char *name, const char *precache = nullptr);   // Reference counted
+		void release();
+
+		// Both return the routine bound, so it outlives evictions by other renderers. Callers unbind it.
+		Routine *query(const State &state, const ShaderContent &content = nullptr);
+		Routine *add(const State &state, Routine *routine, const ShaderContent &content = nullptr);
 
 	private:
+		RoutineCache(int n, const char *name, const char *precache);
+		~RoutineCache();
+
+		static MutexLock &sharedMutex();
+
 		const char *precache;
 		#if defined(_WIN32)
 		HMODULE precacheDLL;
 		#endif
+
+		MutexLock mutex;
+		RoutineCacheThrashDetector thrashDetector;   // Guarded by mutex
+		int references;   // Guarded by sharedMutex()
+
+		static RoutineCache *shared;
 	};
 
 	template<class State>
-	RoutineCache<State>::RoutineCache(int n, const char *precache) : LRUCache<State, Routine>(n), precache(precache)
+	RoutineCache<State> *RoutineCache<State>::shared = nullptr;
+
+	template<class State>
+	RoutineCache<State>::RoutineCache(int n, const char *name, const char *precache) : Cache(n), precache(precache), thrashDetector(name), references(0)
 	{
 	}
 
@@ -46,6 +143,96 @@ namespace sw
 	RoutineCache<State>::~RoutineCache()
 	{
 	}
+
+	template<class State>
+	RoutineCache<State> *RoutineCache<State>::acquire(int n, const char *name, const char *precache)
+	{
+		MutexLock &lock = sharedMutex();
+		lock.lock();
+
+		// Renderers asking for a larger cache get a new one, the old one lives on until released
+		if(!shared || shared->getSize() < n)
+		{
+			shared = new RoutineCache(n, name, precache);
+		}
+
+		RoutineCache *cache = shared;
+		cache->references++;
+
+		lock.unlock();
+
+		return cache;
+	}
+
+	template<class State>
+	void RoutineCache<State>::release()
+	{
+		MutexLock &lock = sharedMutex();
+		lock.lock();
+
+		if(--references == 0)
+		{
+			if(shared == this)
+			{
+				shared = nullptr;
+			}
+
+			delete this;
+		}
+
+		lock.unlock();
+	}
+
+	template<class State>
+	Routine *RoutineCache<State>::query(const State &state, const ShaderContent &content)
+	{
+		RoutineCacheKey<State> key = {state, content, state.hash};
+
+		// Queries update the LRU order, so they need exclusive access too
+		mutex.lock();
+		Routine *routine = Cache::query(key);
+
+		if(routine)
+		{
+			routine->bind();
+		}
+
+		mutex.unlock();
+
+		return routine;
+	}
+
+	template<class State>
+	Routine *RoutineCache<State>::add(const State &state, Routine *routine, const ShaderContent &content)
+	{
+		RoutineCacheKey<State> key = {state, content, state.hash};
+
+		mutex.lock();
+
+		bool evicted = false;
+		unsigned int evictedHash = 0;
+		Cache::add(key, routine, &evicted, &evictedHash);
+		routine->bind();
+
+		int size = thrashDetector.added(state.hash, evicted, evictedHash, Cache::getSize());
+
+		if(size)
+		{
+			Cache::resize(size);
+		}
+
+		mutex.unlock();
+
+		return routine;
+	}
+
+	template<class State>
+	MutexLock &RoutineCache<State>::sharedMutex()
+	{
+		static MutexLock *mutex = new MutexLock("routine_cache");   // Never destroyed, renderers may outlive static destructors
+
+		return *mutex;
+	}
 }
 
 #endif   // sw_RoutineCache_hpp
@@ -0,0 +1,138 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "RoutineCompiler.hpp"
+
+#include "Reactor/Nucleus.hpp"
+#include "Common/CPUID.hpp"
+#include "Common/Math.hpp"
+#include "Common/Debug.hpp"
+
+namespace sw
+{
+	DeferredRoutine::DeferredRoutine(int hotThreshold) : routine(nullptr), unoptimized(nullptr), ready(0), uses(0), hotThreshold(hotThreshold)
+	{
+	}
+
+	DeferredRoutine::~DeferredRoutine()
+	{
+		if(routine)
+		{
+			routine.load()->unbind();
+		}
+
+		if(unoptimized)
+		{
+			unoptimized->unbind();
+		}
+	}
+
+	const void *DeferredRoutine::getEntry()
+	{
+		if(!ready)
+		{
+			compiled.wait();
+			compiled.signal();   // Let other waiters through
+		}
+
+		if(hotThreshold > 0 && uses++ == hotThreshold)   // Atomic
+		{
+			RoutineCompiler::schedule(this);
+		}
+
+		return routine.load()->getEntry();
+	}
+
+	RoutineCompiler::RoutineCompiler(int threadCount) : threadCount(threadCount)
+	{
+		for(int i = 0; i < threadCount; i++)
+		{
+			thread[i] = new Thread(threadFunction, this);
+		}
+	}
+
+	void RoutineCompiler::schedule(DeferredRoutine *routine)
+	{
+		// Shared by all renderers and never destroyed, since its threads may
+		// outlive any of them. Keep most cores available for rendering.
+		static RoutineCompiler *compiler = new RoutineCompiler(clamp(CPUID::coreCount() / 8, 1, (int)MAX_COMPILER_THREADS));
+
+		routine->bind();   // Kept alive until compiled
+
+		compiler->mutex.lock();
+		compiler->queue.push_back(routine);
+		compiler->mutex.unlock();
+
+		compiler->work.signal();
+	}
+
+	void RoutineCompiler::threadFunction(void *parameters)
+	{
+		static_cast<RoutineCompiler*>(parameters)->threadLoop();
+	}
+
+	void RoutineCompiler::threadLoop()
+	{
+		while(true)
+		{
+			work.wait();
+
+			while(true)
+			{
+				mutex.lock();
+
+				if(queue.empty())
+				{
+					mutex.unlock();
+					break;
+				}
+
+				DeferredRoutine *deferred = queue.front();
+				queue.pop_front();
+				bool moreWork = !queue.empty();
+
+				mutex.unlock();
+
+				if(moreWork)
+				{
+					work.signal();   // Let another compiler thread take the next job
+				}
+
+				const bool recompile = deferred->ready != 0;   // Hot tiered routine
+
+				Nucleus::setOptimizationEnabled(recompile || !deferred->isTiered());
+				Routine *routine = deferred->compile();
+				Nucleus::setOptimizationEnabled(true);
+
+				ASSERT(routine);
+				routine->bind();
+
+				if(!recompile)
+				{
+					deferred->routine = routine;
+					deferred->ready = 1;
+					deferred->compiled.signal();
+
+					deferred->onCompiled();
+				}
+				else
+				{
+					deferred->unoptimized = deferred->routine.exchange(routine);
+				}
+
+				deferred->unbind();
+			}
+		}
+	}
+}
@@ -0,0 +1,85 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef sw_RoutineCompiler_hpp
+#define sw_RoutineCompiler_hpp
+
+#include "Reactor/Routine.hpp"
+#include "Common/MutexLock.hpp"
+#include "Common/Thread.hpp"
+
+#include <atomic>
+#include <list>
+
+namespace sw
+{
+	using namespace rr;
+
+	// Routine whose code is generated asynchronously by the RoutineCompiler.
+	// It can be bound and cached right away, and forwards to the generated
+	// routine once compilation has completed.
+	// A tiered routine is first compiled without optimization passes. Once its
+	// entry has been requested hotThreshold times it is compiled again with
+	// them, and subsequent requests get the optimized code.
+	class DeferredRoutine : public Routine
+	{
+		friend class RoutineCompiler;
+
+	public:
+		explicit DeferredRoutine(int hotThreshold = 0);   // 0 disables tiering
+
+		~DeferredRoutine() override;
+
+		const void *getEntry() override;   // Waits for compilation to complete
+
+		bool isReady() const { return ready != 0; }
+		bool isTiered() const { return hotThreshold > 0; }
+
+	protected:
+		virtual Routine *compile() = 0;   // Called on a compiler thread, twice for tiered routines
+		virtual void onCompiled() {}      // Called on a compiler thread, after the entry became available
+
+	private:
+		std::atomic<Routine*> routine;
+		Routine *unoptimized;   // Replaced first tier, draws may still be executing it
+		AtomicInt ready;
+		AtomicInt uses;
+		const int hotThreshold;
+		Event compiled;
+	};
+
+	// Process-wide pool of threads generating DeferredRoutines.
+	class RoutineCompiler
+	{
+	public:
+		static void schedule(DeferredRoutine *routine);
+
+	private:
+		RoutineCompiler(int threadCount);
+
+		static void threadFunction(void *parameters);
+		void threadLoop();
+
+		enum { MAX_COMPILER_THREADS = 4 };
+
+		MutexLock mutex;
+		Event work;
+		std::list<DeferredRoutine*> queue;
+
+		int threadCount;
+		Thread *thread[MAX_COMPILER_THREADS];
+	};
+}
+
+#endif   // sw_RoutineCompiler_hpp
@@ -0,0 +1,111 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "RoutineStatistics.hpp"
+
+#include "Reactor/Routine.hpp"
+#include "Common/Timer.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <stdio.h>
+#include <inttypes.h>
+
+namespace
+{
+	std::atomic<uint64_t> cacheHits[sw::ROUTINE_CACHE_TYPE_COUNT];
+	std::atomic<uint64_t> cacheMisses[sw::ROUTINE_CACHE_TYPE_COUNT];
+	std::atomic<uint64_t> fallbacks[sw::FALLBACK_TYPE_COUNT];
+
+	std::mutex logMutex;
+	double lastLogTime = 0.0;
+}
+
+extern "C" void swiftshaderGetRoutineStatistics(SwiftShaderRoutineStatistics *statistics)
+{
+	if(!statistics)
+	{
+		return;
+	}
+
+	rr::CompilerStatistics compiler = rr::getCompilerStatistics();
+
+	statistics->routines = compiler.routines;
+	statistics->instructions = compiler.instructions;
+	statistics->codeBytes = compiler.codeBytes;
+	statistics->compileMicroseconds = compiler.compileMicroseconds;
+	statistics->optimizeMicroseconds = compiler.optimizeMicroseconds;
+
+	statistics->vertexCacheHits = cacheHits[sw::VERTEX_ROUTINE_CACHE];
+	statistics->vertexCacheMisses = cacheMisses[sw::VERTEX_ROUTINE_CACHE];
+	statistics->setupCacheHits = cacheHits[sw::SETUP_ROUTINE_CACHE];
+	statistics->setupCacheMisses = cacheMisses[sw::SETUP_ROUTINE_CACHE];
+	statistics->pixelCacheHits = cacheHits[sw::PIXEL_ROUTINE_CACHE];
+	statistics->pixelCacheMisses = cacheMisses[sw::PIXEL_ROUTINE_CACHE];
+	statistics->blitCacheHits = cacheHits[sw::BLIT_ROUTINE_CACHE];
+	statistics->blitCacheMisses = cacheMisses[sw::BLIT_ROUTINE_CACHE];
+
+	statistics->blitFallbacks = fallbacks[sw::BLIT_FALLBACK];
+	statistics->updateFallbacks = fallbacks[sw::UPDATE_FALLBACK];
+
+	statistics->sharedRoutines = compiler.sharedRoutines;
+}
+
+namespace sw
+{
+	void countRoutineCacheQuery(RoutineCacheType type, bool hit)
+	{
+		if(hit)
+		{
+			cacheHits[type].fetch_add(1, std::memory_order_relaxed);
+		}
+		else
+		{
+			cacheMisses[type].fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	void countFallback(FallbackType type)
+	{
+		fallbacks[type].fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void logRoutineStatistics(double interval)
+	{
+		double now = Timer::seconds();
+
+		{
+			std::lock_guard<std::mutex> lock(logMutex);
+
+			if(now - lastLogTime < interval)
+			{
+				return;
+			}
+
+			lastLogTime = now;
+		}
+
+		SwiftShaderRoutineStatistics s;
+		swiftshaderGetRoutineStatistics(&s);
+
+		fprintf(stderr, "SwiftShader: %" PRIu64 " routines, %" PRIu64 " instructions, %" PRIu64 " code bytes, "
+		                "%" PRIu64 " us compiling (%" PRIu64 " us optimizing), %" PRIu64 " shared\n",
+		        s.routines, s.instructions, s.codeBytes, s.compileMicroseconds, s.optimizeMicroseconds, s.sharedRoutines);
+		fprintf(stderr, "SwiftShader: cache hits/misses vertex %" PRIu64 "/%" PRIu64 ", setup %" PRIu64 "/%" PRIu64 ", "
+		                "pixel %" PRIu64 "/%" PRIu64 ", blit %" PRIu64 "/%" PRIu64 ", fallback blits %" PRIu64 ", fallback updates %" PRIu64 "\n",
+		        s.vertexCacheHits, s.vertexCacheMisses, s.setupCacheHits, s.setupCacheMisses,
+		        s.pixelCacheHits, s.pixelCacheMisses, s.blitCacheHits, s.blitCacheMisses,
+		        s.blitFallbacks, s.updateFallbacks);
+	}
+}
@@ -0,0 +1,78 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef sw_RoutineStatistics_hpp
+#define sw_RoutineStatistics_hpp
+
+#include <stdint.h>
+
+extern "C"
+{
+	// Snapshot of the JIT compiler and routine cache counters, accumulated
+	// since the library was loaded.
+	struct SwiftShaderRoutineStatistics
+	{
+		uint64_t routines;               // Routines compiled
+		uint64_t instructions;           // Intermediate instructions of the compiled routines
+		uint64_t codeBytes;              // Generated machine code
+		uint64_t compileMicroseconds;    // Total time spent compiling, including optimization
+		uint64_t optimizeMicroseconds;   // Time spent in optimization passes
+
+		uint64_t vertexCacheHits;
+		uint64_t vertexCacheMisses;
+		uint64_t setupCacheHits;
+		uint64_t setupCacheMisses;
+		uint64_t pixelCacheHits;
+		uint64_t pixelCacheMisses;
+		uint64_t blitCacheHits;
+		uint64_t blitCacheMisses;
+
+		uint64_t blitFallbacks;     // Blits done texel by texel, without a generated routine
+		uint64_t updateFallbacks;   // Surface format conversions done texel by texel
+
+		uint64_t sharedRoutines;   // Compiled routines identical to a live one, sharing its machine code
+	};
+
+	void swiftshaderGetRoutineStatistics(SwiftShaderRoutineStatistics *statistics);
+}
+
+namespace sw
+{
+	enum RoutineCacheType
+	{
+		VERTEX_ROUTINE_CACHE,
+		SETUP_ROUTINE_CACHE,
+		PIXEL_ROUTINE_CACHE,
+		BLIT_ROUTINE_CACHE,
+
+		ROUTINE_CACHE_TYPE_COUNT
+	};
+
+	void countRoutineCacheQuery(RoutineCacheType type, bool hit);
+
+	enum FallbackType
+	{
+		BLIT_FALLBACK,
+		UPDATE_FALLBACK,
+
+		FALLBACK_TYPE_COUNT
+	};
+
+	void countFallback(FallbackType type);
+
+	// Prints the statistics to stderr if at least interval seconds have passed since the last time
+	void logRoutineStatistics(double interval);
+}
+
+#endif   // sw_RoutineStatistics_hpp
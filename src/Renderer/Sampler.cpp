@@ -26,6 +26,8 @@ namespace sw
 {
 	FilterType Sampler::maximumTextureFilterQuality = FILTER_LINEAR;
 	MipmapType Sampler::maximumMipmapFilterQuality = MIPMAP_POINT;
+	bool Sampler::adaptiveAnisotropy = false;
+	int Sampler::dynamicState = 0;
 
 	Sampler::State::State()
 	{
@@ -47,6 +49,11 @@ namespace sw
 			{
 				mipmap.buffer[face] = &zero;
 			}
+
+			for(int i = 0; i < 4; i++)
+			{
+				mipmap.tileScale[i] = 1;
+			}
 		}
 
 		externalTextureFormat = FORMAT_NULL;
@@ -77,6 +84,8 @@ namespace sw
 		texture.maxLevel = 1000;
 		texture.maxLod = MAX_TEXTURE_LOD;
 		texture.minLod = 0;
+		memset(texture.swizzleMask, 0, sizeof(texture.swizzleMask));
+		memset(texture.compareMask, 0, sizeof(texture.compareMask));
 	}
 
 	Sampler::~Sampler()
@@ -103,6 +112,31 @@ namespace sw
 			state.swizzleA = swizzleA;
 			state.highPrecisionFiltering = highPrecisionFiltering;
 			state.compare = getCompareFunc();
+			state.tiledLayout = hasTiledLayout();
+			state.adaptiveAnisotropy = adaptiveAnisotropy && (state.textureFilter == FILTER_ANISOTROPIC);
+
+			// With a single effective level the derivatives only matter for anisotropy and for choosing between minification and magnification filters
+			bool minMagFilter = (state.textureFilter == FILTER_MIN_POINT_MAG_LINEAR) || (state.textureFilter == FILTER_MIN_LINEAR_MAG_POINT);
+			bool singleLevel = (state.mipmapFilter == MIPMAP_NONE) && !minMagFilter;
+			state.constantLod = (state.textureFilter != FILTER_ANISOTROPIC) && (singleLevel || (texture.minLod == texture.maxLod));
+
+			// Dynamic state is read from the texture data, so the routine only encodes that it's in use
+			bool identitySwizzle = (swizzleR == SWIZZLE_RED) && (swizzleG == SWIZZLE_GREEN) && (swizzleB == SWIZZLE_BLUE) && (swizzleA == SWIZZLE_ALPHA);
+
+			if((dynamicState & DYNAMIC_SAMPLER_SWIZZLE) && !identitySwizzle)
+			{
+				state.dynamicSwizzle = true;
+				state.swizzleR = SWIZZLE_RED;
+				state.swizzleG = SWIZZLE_GREEN;
+				state.swizzleB = SWIZZLE_BLUE;
+				state.swizzleA = SWIZZLE_ALPHA;
+			}
+
+			if((dynamicState & DYNAMIC_SAMPLER_COMPARE) && (state.compare != COMPARE_BYPASS))
+			{
+				state.dynamicCompare = true;
+				state.compare = COMPARE_LESSEQUAL;
+			}
 
 			#if PERF_PROFILE
 				state.compressedFormat = Surface::isCompressed(externalTextureFormat);
@@ -112,17 +146,25 @@ namespace sw
 		return state;
 	}
 
-	void Sampler::setTextureLevel(int face, int level, Surface *surface, TextureType type)
+	bool Sampler::setTextureLevel(int face, int level, Surface *surface, TextureType type)
 	{
+		// Only compare the fields which the sampler state is derived from
+		bool modified = (textureType != type);
+
 		if(surface)
 		{
 			Mipmap &mipmap = texture.mipmap[level];
 
+			modified = modified || (border != surface->getBorder());
 			border = surface->getBorder();
-			mipmap.buffer[face] = surface->lockInternal(-border, -border, 0, LOCK_UNLOCKED, PRIVATE);
+
+			const void *buffer = surface->lockInternal(-border, -border, 0, LOCK_UNLOCKED, PRIVATE);
+			modified = modified || (mipmap.buffer[face] != buffer);
+			mipmap.buffer[face] = buffer;
 
 			if(face == 0)
 			{
+				modified = modified || (externalTextureFormat != surface->getExternalFormat()) || (internalTextureFormat != surface->getInternalFormat());
 				externalTextureFormat = surface->getExternalFormat();
 				internalTextureFormat = surface->getInternalFormat();
 
@@ -132,6 +174,13 @@ namespace sw
 				int pitchP = surface->getInternalPitchP();
 				int sliceP = surface->getInternalSliceP();
 
+				if(Surface::isCompressed(internalTextureFormat))
+				{
+					// Compressed texels are addressed by their coordinates, packed as u + (v << 14)
+					pitchP = 1 << 14;
+					sliceP = height << 14;
+				}
+
 				if(level == 0)
 				{
 					texture.widthHeightLOD[0] = width * exp2LOD;
@@ -192,6 +241,8 @@ namespace sw
 				mipmap.wHalf[2] = halfTexelW;
 				mipmap.wHalf[3] = halfTexelW;
 
+				modified = modified || (mipmap.width[0] != width) || (mipmap.height[0] != height) || (mipmap.depth[0] != depth);
+
 				mipmap.width[0] = width;
 				mipmap.width[1] = width;
 				mipmap.width[2] = width;
@@ -212,6 +263,21 @@ namespace sw
 				mipmap.onePitchP[2] = 1;
 				mipmap.onePitchP[3] = pitchP;
 
+				short tileMask = surface->hasTiledLayout() ? 3 : 0;
+				short tileScale = surface->hasTiledLayout() ? 4 : 1;
+
+				modified = modified || (mipmap.tileMask[0] != tileMask);
+
+				mipmap.tileMask[0] = tileMask;
+				mipmap.tileMask[1] = tileMask;
+				mipmap.tileMask[2] = tileMask;
+				mipmap.tileMask[3] = tileMask;
+
+				mipmap.tileScale[0] = tileScale;
+				mipmap.tileScale[1] = tileScale;
+				mipmap.tileScale[2] = tileScale;
+				mipmap.tileScale[3] = tileScale;
+
 				mipmap.pitchP[0] = pitchP;
 				mipmap.pitchP[1] = pitchP;
 				mipmap.pitchP[2] = pitchP;
@@ -246,46 +312,72 @@ namespace sw
 					texture.mipmap[1].onePitchP[1] = CStride;
 					texture.mipmap[1].onePitchP[2] = 1;
 					texture.mipmap[1].onePitchP[3] = CStride;
+					texture.mipmap[1].tileMask[0] = 0;
+					texture.mipmap[1].tileMask[1] = 0;
+					texture.mipmap[1].tileMask[2] = 0;
+					texture.mipmap[1].tileMask[3] = 0;
+					texture.mipmap[1].tileScale[0] = 1;
+					texture.mipmap[1].tileScale[1] = 1;
+					texture.mipmap[1].tileScale[2] = 1;
+					texture.mipmap[1].tileScale[3] = 1;
 				}
 			}
 		}
 
 		textureType = type;
+
+		return modified;
 	}
 
-	void Sampler::setTextureFilter(FilterType textureFilter)
+	bool Sampler::setTextureFilter(FilterType textureFilter)
 	{
-		this->textureFilter = (FilterType)min(textureFilter, maximumTextureFilterQuality);
+		FilterType filter = (FilterType)min(textureFilter, maximumTextureFilterQuality);
+		bool modified = (this->textureFilter != filter);
+		this->textureFilter = filter;
+		return modified;
 	}
 
-	void Sampler::setMipmapFilter(MipmapType mipmapFilter)
+	bool Sampler::setMipmapFilter(MipmapType mipmapFilter)
 	{
-		mipmapFilterState = (MipmapType)min(mipmapFilter, maximumMipmapFilterQuality);
+		MipmapType filter = (MipmapType)min(mipmapFilter, maximumMipmapFilterQuality);
+		bool modified = (mipmapFilterState != filter);
+		mipmapFilterState = filter;
+		return modified;
 	}
 
-	void Sampler::setGatherEnable(bool enable)
+	bool Sampler::setGatherEnable(bool enable)
 	{
+		bool modified = (gather != enable);
 		gather = enable;
+		return modified;
 	}
 
-	void Sampler::setAddressingModeU(AddressingMode addressingMode)
+	bool Sampler::setAddressingModeU(AddressingMode addressingMode)
 	{
+		bool modified = (addressingModeU != addressingMode);
 		addressingModeU = addressingMode;
+		return modified;
 	}
 
-	void Sampler::setAddressingModeV(AddressingMode addressingMode)
+	bool Sampler::setAddressingModeV(AddressingMode addressingMode)
 	{
+		bool modified = (addressingModeV != addressingMode);
 		addressingModeV = addressingMode;
+		return modified;
 	}
 
-	void Sampler::setAddressingModeW(AddressingMode addressingMode)
+	bool Sampler::setAddressingModeW(AddressingMode addressingMode)
 	{
+		bool modified = (addressingModeW != addressingMode);
 		addressingModeW = addressingMode;
+		return modified;
 	}
 
-	void Sampler::setReadSRGB(bool sRGB)
+	bool Sampler::setReadSRGB(bool sRGB)
 	{
+		bool modified = (this->sRGB != sRGB);
 		this->sRGB = sRGB;
+		return modified;
 	}
 
 	void Sampler::setBorderColor(const Color<float> &borderColor)
@@ -307,39 +399,53 @@ namespace sw
 		texture.borderColorF[3][0] = texture.borderColorF[3][1] = texture.borderColorF[3][2] = texture.borderColorF[3][3] = borderColor.a;
 	}
 
-	void Sampler::setMaxAnisotropy(float maxAnisotropy)
+	bool Sampler::setMaxAnisotropy(float maxAnisotropy)
 	{
+		bool modified = (texture.maxAnisotropy != maxAnisotropy);
 		texture.maxAnisotropy = maxAnisotropy;
+		return modified;
 	}
 
-	void Sampler::setHighPrecisionFiltering(bool highPrecisionFiltering)
+	bool Sampler::setHighPrecisionFiltering(bool highPrecisionFiltering)
 	{
+		bool modified = (this->highPrecisionFiltering != highPrecisionFiltering);
 		this->highPrecisionFiltering = highPrecisionFiltering;
+		return modified;
 	}
 
-	void Sampler::setSwizzleR(SwizzleType swizzleR)
+	bool Sampler::setSwizzleR(SwizzleType swizzleR)
 	{
+		bool modified = (this->swizzleR != swizzleR);
 		this->swizzleR = swizzleR;
+		return modified;
 	}
 
-	void Sampler::setSwizzleG(SwizzleType swizzleG)
+	bool Sampler::setSwizzleG(SwizzleType swizzleG)
 	{
+		bool modified = (this->swizzleG != swizzleG);
 		this->swizzleG = swizzleG;
+		return modified;
 	}
 
-	void Sampler::setSwizzleB(SwizzleType swizzleB)
+	bool Sampler::setSwizzleB(SwizzleType swizzleB)
 	{
+		bool modified = (this->swizzleB != swizzleB);
 		this->swizzleB = swizzleB;
+		return modified;
 	}
 
-	void Sampler::setSwizzleA(SwizzleType swizzleA)
+	bool Sampler::setSwizzleA(SwizzleType swizzleA)
 	{
+		bool modified = (this->swizzleA != swizzleA);
 		this->swizzleA = swizzleA;
+		return modified;
 	}
 
-	void Sampler::setCompareFunc(CompareFunc compare)
+	bool Sampler::setCompareFunc(CompareFunc compare)
 	{
+		bool modified = (this->compare != compare);
 		this->compare = compare;
+		return modified;
 	}
 
 	void Sampler::setBaseLevel(int baseLevel)
@@ -352,14 +458,18 @@ namespace sw
 		texture.maxLevel = maxLevel;
 	}
 
-	void Sampler::setMinLod(float minLod)
+	bool Sampler::setMinLod(float minLod)
 	{
+		bool constantLod = (texture.minLod == texture.maxLod);
 		texture.minLod = clamp(minLod, 0.0f, (float)(MAX_TEXTURE_LOD));
+		return constantLod != (texture.minLod == texture.maxLod);
 	}
 
-	void Sampler::setMaxLod(float maxLod)
+	bool Sampler::setMaxLod(float maxLod)
 	{
+		bool constantLod = (texture.minLod == texture.maxLod);
 		texture.maxLod = clamp(maxLod, 0.0f, (float)(MAX_TEXTURE_LOD));
+		return constantLod != (texture.minLod == texture.maxLod);
 	}
 
 	void Sampler::setFilterQuality(FilterType maximumFilterQuality)
@@ -372,6 +482,16 @@ namespace sw
 		Sampler::maximumMipmapFilterQuality = maximumFilterQuality;
 	}
 
+	void Sampler::setAdaptiveAnisotropy(bool adaptiveAnisotropy)
+	{
+		Sampler::adaptiveAnisotropy = adaptiveAnisotropy;
+	}
+
+	void Sampler::setDynamicState(int dynamicState)
+	{
+		Sampler::dynamicState = dynamicState;
+	}
+
 	void Sampler::setMipmapLOD(float LOD)
 	{
 		texture.LOD = LOD;
@@ -413,6 +533,33 @@ namespace sw
 
 	const Texture &Sampler::getTextureData()
 	{
+		if(dynamicState & DYNAMIC_SAMPLER_SWIZZLE)
+		{
+			const SwizzleType swizzle[4] = {swizzleR, swizzleG, swizzleB, swizzleA};
+			const SwizzleType source[5] = {SWIZZLE_RED, SWIZZLE_GREEN, SWIZZLE_BLUE, SWIZZLE_ALPHA, SWIZZLE_ONE};
+
+			for(int i = 0; i < 4; i++)
+			{
+				for(int j = 0; j < 5; j++)
+				{
+					texture.swizzleMask[i][j] = (swizzle[i] == source[j]) ? -1 : 0;
+				}
+			}
+		}
+
+		if(dynamicState & DYNAMIC_SAMPLER_COMPARE)
+		{
+			CompareFunc compare = getCompareFunc();
+
+			bool less = (compare == COMPARE_LESSEQUAL) || (compare == COMPARE_LESS) || (compare == COMPARE_NOTEQUAL) || (compare == COMPARE_ALWAYS);
+			bool equal = (compare == COMPARE_LESSEQUAL) || (compare == COMPARE_GREATEREQUAL) || (compare == COMPARE_EQUAL) || (compare == COMPARE_ALWAYS);
+			bool greater = (compare == COMPARE_GREATEREQUAL) || (compare == COMPARE_GREATER) || (compare == COMPARE_NOTEQUAL) || (compare == COMPARE_ALWAYS);
+
+			texture.compareMask[0] = less ? -1 : 0;
+			texture.compareMask[1] = equal ? -1 : 0;
+			texture.compareMask[2] = greater ? -1 : 0;
+		}
+
 		return texture;
 	}
 
@@ -511,4 +658,18 @@ namespace sw
 
 		return compare;
 	}
+
+	bool Sampler::hasTiledLayout() const
+	{
+		// Levels may have been tiled independently, so the sampler handles both layouts
+		for(int level = 0; level < MIPMAP_LEVELS; level++)
+		{
+			if(texture.mipmap[level].tileMask[0] != 0)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
 }
@@ -36,6 +36,8 @@ namespace sw
 		short height[4];
 		short depth[4];
 		short onePitchP[4];
+		short tileMask[4];    // 3 when texels are stored in 4x4 tiles, 0 otherwise
+		short tileScale[4];   // 4 when texels are stored in 4x4 tiles, 1 otherwise
 		int4 pitchP;
 		int4 sliceP;
 	};
@@ -57,6 +59,10 @@ namespace sw
 		int maxLevel;
 		float minLod;
 		float maxLod;
+
+		// Sampler state read at run time by routines with dynamic swizzles or comparisons
+		int swizzleMask[4][5];   // Per output component, selects red, green, blue, alpha or one (none selected is zero)
+		int compareMask[3];      // Reference less than, equal to, and greater than or unordered with the texel
 	};
 
 	enum SamplerType
@@ -139,6 +145,12 @@ namespace sw
 		SWIZZLE_LAST = SWIZZLE_ONE
 	};
 
+	enum DynamicSamplerState
+	{
+		DYNAMIC_SAMPLER_SWIZZLE = 0x01,   // Non-identity swizzles share a routine
+		DYNAMIC_SAMPLER_COMPARE = 0x02,   // Depth comparison functions share a routine
+	};
+
 	class Sampler
 	{
 	public:
@@ -160,6 +172,11 @@ namespace sw
 			SwizzleType swizzleA           : BITS(SWIZZLE_LAST);
 			bool highPrecisionFiltering    : 1;
 			CompareFunc compare            : BITS(COMPARE_LAST);
+			bool tiledLayout               : 1;
+			bool adaptiveAnisotropy        : 1;
+			bool dynamicSwizzle            : 1;
+			bool dynamicCompare            : 1;
+			bool constantLod               : 1;   // Level of detail doesn't depend on the coordinates
 
 			#if PERF_PROFILE
 			bool compressedFormat          : 1;
@@ -172,31 +189,34 @@ namespace sw
 
 		State samplerState() const;
 
-		void setTextureLevel(int face, int level, Surface *surface, TextureType type);
+		// Setters of sampler state return true when modified
+		bool setTextureLevel(int face, int level, Surface *surface, TextureType type);
 
-		void setTextureFilter(FilterType textureFilter);
-		void setMipmapFilter(MipmapType mipmapFilter);
-		void setGatherEnable(bool enable);
-		void setAddressingModeU(AddressingMode addressingMode);
-		void setAddressingModeV(AddressingMode addressingMode);
-		void setAddressingModeW(AddressingMode addressingMode);
-		void setReadSRGB(bool sRGB);
+		bool setTextureFilter(FilterType textureFilter);
+		bool setMipmapFilter(MipmapType mipmapFilter);
+		bool setGatherEnable(bool enable);
+		bool setAddressingModeU(AddressingMode addressingMode);
+		bool setAddressingModeV(AddressingMode addressingMode);
+		bool setAddressingModeW(AddressingMode addressingMode);
+		bool setReadSRGB(bool sRGB);
 		void setBorderColor(const Color<float> &borderColor);
-		void setMaxAnisotropy(float maxAnisotropy);
-		void setHighPrecisionFiltering(bool highPrecisionFiltering);
-		void setSwizzleR(SwizzleType swizzleR);
-		void setSwizzleG(SwizzleType swizzleG);
-		void setSwizzleB(SwizzleType swizzleB);
-		void setSwizzleA(SwizzleType swizzleA);
-		void setCompareFunc(CompareFunc compare);
+		bool setMaxAnisotropy(float maxAnisotropy);
+		bool setHighPrecisionFiltering(bool highPrecisionFiltering);
+		bool setSwizzleR(SwizzleType swizzleR);
+		bool setSwizzleG(SwizzleType swizzleG);
+		bool setSwizzleB(SwizzleType swizzleB);
+		bool setSwizzleA(SwizzleType swizzleA);
+		bool setCompareFunc(CompareFunc compare);
 		void setBaseLevel(int baseLevel);
 		void setMaxLevel(int maxLevel);
-		void setMinLod(float minLod);
-		void setMaxLod(float maxLod);
+		bool setMinLod(float minLod);   // Modifies the routine state when the LOD range starts or stops being a single value
+		bool setMaxLod(float maxLod);
 		void setSyncRequired(bool isSincRequired);
 
 		static void setFilterQuality(FilterType maximumFilterQuality);
 		static void setMipmapQuality(MipmapType maximumFilterQuality);
+		static void setAdaptiveAnisotropy(bool adaptiveAnisotropy);
+		static void setDynamicState(int dynamicState);   // DynamicSamplerState flags
 		void setMipmapLOD(float lod);
 
 		bool hasTexture() const;
@@ -215,6 +235,7 @@ namespace sw
 		AddressingMode getAddressingModeV() const;
 		AddressingMode getAddressingModeW() const;
 		CompareFunc getCompareFunc() const;
+		bool hasTiledLayout() const;
 
 		Format externalTextureFormat;
 		Format internalTextureFormat;
@@ -242,6 +263,8 @@ namespace sw
 
 		static FilterType maximumTextureFilterQuality;
 		static MipmapType maximumMipmapFilterQuality;
+		static bool adaptiveAnisotropy;
+		static int dynamicState;
 	};
 }
 
@@ -15,11 +15,13 @@
 #include "SetupProcessor.hpp"
 
 #include "Primitive.hpp"
+#include "RoutineStatistics.hpp"
 #include "Polygon.hpp"
 #include "Context.hpp"
 #include "Renderer.hpp"
 #include "Shader/SetupRoutine.hpp"
 #include "Shader/Constants.hpp"
+#include "Common/Trace.hpp"
 #include "Common/Debug.hpp"
 
 namespace sw
@@ -65,8 +67,11 @@ namespace sw
 
 	SetupProcessor::~SetupProcessor()
 	{
-		delete routineCache;
-		routineCache = 0;
+		if(routineCache)
+		{
+			routineCache->release();
+			routineCache = 0;
+		}
 	}
 
 	SetupProcessor::State SetupProcessor::update() const
@@ -225,16 +230,53 @@ namespace sw
 
 	Routine *SetupProcessor::routine(const State &state)
 	{
-		Routine *routine = routineCache->query(state);
+		Routine *routine = findRoutine(state);
 
 		if(!routine)
 		{
-			SetupRoutine *generator = new SetupRoutine(state);
-			generator->generate();
-			routine = generator->getRoutine();
-			delete generator;
+			routine = addRoutine(state, generateRoutine(state));
+		}
+
+		return routine;
+	}
 
-			routineCache->add(state, routine);
+	Routine *SetupProcessor::findRoutine(const State &state)
+	{
+		Routine *routine = routineCache->query(state);
+		countRoutineCacheQuery(SETUP_ROUTINE_CACHE, routine != nullptr);
+
+		return routine;
+	}
+
+	Routine *SetupProcessor::addRoutine(const State &state, Routine *routine)
+	{
+		return routineCache->add(state, routine);
+	}
+
+	Routine *SetupProcessor::generateRoutine(const State &state)
+	{
+		Routine *cached = PersistentRoutineCache::loadPacked("sw-setup", &state, sizeof(State));
+
+		if(!cached && precacheSetup)
+		{
+			cached = PersistentRoutineCache::load("sw-setup", &state, sizeof(State));
+		}
+
+		if(cached)
+		{
+			return cached;
+		}
+
+		TraceScope scope("Compile setup routine");
+
+		SetupRoutine *generator = new SetupRoutine(state);
+		generator->generate();
+		Routine *routine = generator->getRoutine();
+		delete generator;
+
+		if(precacheSetup)
+		{
+			PersistentRoutineCache::store("sw-setup", &state, sizeof(State), routine);
 		}
 
 		return routine;
@@ -242,7 +284,11 @@ namespace sw
 
 	void SetupProcessor::setRoutineCacheSize(int cacheSize)
 	{
-		delete routineCache;
-		routineCache = new RoutineCache<State>(clamp(cacheSize, 1, 65536), precacheSetup ? "sw-setup" : 0);
+		if(routineCache)
+		{
+			routineCache->release();
+		}
+
+		routineCache = RoutineCache<State>::acquire(clamp(cacheSize, 1, 65536), "setup", precacheSetup ? "sw-setup" : 0);
 	}
 }
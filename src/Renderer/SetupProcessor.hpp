@@ -91,7 +91,11 @@ namespace sw
 
 	protected:
 		State update() const;
+		// The returned routines are bound, and have to be unbound by the caller
 		Routine *routine(const State &state);
+		Routine *findRoutine(const State &state);
+		Routine *addRoutine(const State &state, Routine *routine);
+		static Routine *generateRoutine(const State &state);
 
 		void setRoutineCacheSize(int cacheSize);
 
@@ -56,6 +56,8 @@ namespace sw
 			this->resource = resource;
 			this->buffer = buffer;
 			this->stride = stride;
+			this->divisor = 0;
+			this->instanceStride = 0;
 		}
 
 		Stream &define(StreamType type, unsigned int count, bool normalized = false)
@@ -84,6 +86,8 @@ namespace sw
 			resource = 0;
 			buffer = &null;
 			stride = 0;
+			divisor = 0;
+			instanceStride = 0;
 			type = STREAMTYPE_FLOAT;
 			count = 0;
 			normalized = false;
@@ -96,6 +100,9 @@ namespace sw
 			return count != 0;
 		}
 
+		unsigned int divisor;          // Instances sharing each element, 0 when advancing per vertex
+		unsigned int instanceStride;   // Bytes between the elements of consecutive instance groups
+
 		StreamType type;
 		unsigned char count;
 		bool normalized;
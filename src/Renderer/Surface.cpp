@@ -14,20 +14,34 @@
 
 #include "Surface.hpp"
 
+#include "Blitter.hpp"
 #include "Color.hpp"
 #include "Context.hpp"
 #include "ETC_Decoder.hpp"
 #include "Renderer.hpp"
+#include "RoutineStatistics.hpp"
 #include "Common/Half.hpp"
 #include "Common/Memory.hpp"
 #include "Common/CPUID.hpp"
 #include "Common/Resource.hpp"
+#include "Common/Timer.hpp"
 #include "Common/Debug.hpp"
 #include "Reactor/Reactor.hpp"
 
+#include <map>
+#include <mutex>
+#include <unordered_set>
+
 #if defined(__i386__) || defined(__x86_64__)
 	#include <xmmintrin.h>
 	#include <emmintrin.h>
+	#include <immintrin.h>
+
+	#if defined(_MSC_VER)
+		#define AVX_FUNCTION
+	#else
+		#define AVX_FUNCTION __attribute__((target("avx")))
+	#endif
 #endif
 
 #undef min
@@ -37,7 +51,18 @@ namespace sw
 {
 	extern bool quadLayoutEnabled;
 	extern bool complementaryDepthBuffer;
+	extern bool compressedTextureSampling;
+	extern bool tiledTextureLayout;
+	extern bool linearSRGBTextures;
 	extern TranscendentalPrecision logPrecision;
+	extern AtomicInt threadCount;
+
+	// Surfaces which may hold an evictable internal or external copy
+	static std::mutex surfaceRegistryMutex;
+	static std::unordered_set<Surface*> surfaceRegistry;
+	static std::atomic<size_t> memoryBudget(0);
+	static std::atomic<unsigned int> evictions(0);
+	static const double idleSeconds = 1.0;   // Covers the gap between setting a texture and locking it for drawing
 
 	unsigned int *Surface::palette = 0;
 	unsigned int Surface::paletteID = 0;
@@ -367,6 +392,9 @@ namespace sw
 		case FORMAT_D32FS8_COMPLEMENTARY:
 			*((float*)element) = 1 - r;
 			break;
+		case FORMAT_D16:
+			*((unsigned short*)element) = unorm<16>(r);
+			break;
 		case FORMAT_S8:
 			*((unsigned char*)element) = unorm<8>(r);
 			break;
@@ -1040,6 +1068,12 @@ namespace sw
 			b = r;
 			a = r;
 			break;
+		case FORMAT_D16:
+			r = *(unsigned short*)element * (1.0f / 0xFFFF);
+			g = r;
+			b = r;
+			a = r;
+			break;
 		case FORMAT_S8:
 			r = *(unsigned char*)element * (1.0f / 0xFF);
 			break;
@@ -1137,12 +1171,39 @@ namespace sw
 		case LOCK_WRITEONLY:
 		case LOCK_READWRITE:
 		case LOCK_DISCARD:
-			dirty = true;
+			markDirty(0, 0, 0, width, height, depth);
+			break;
+		default:
+			ASSERT(false);
+		}
+
+		return address(x, y, z);
+	}
+
+	void *Surface::Buffer::lockRect(int x, int y, int z, int width, int height, int depth, Lock lock)
+	{
+		this->lock = lock;
+
+		switch(lock)
+		{
+		case LOCK_UNLOCKED:
+		case LOCK_READONLY:
+		case LOCK_UPDATE:
+			break;
+		case LOCK_WRITEONLY:
+		case LOCK_READWRITE:
+		case LOCK_DISCARD:
+			markDirty(x, y, z, x + width, y + height, z + depth);
 			break;
 		default:
 			ASSERT(false);
 		}
 
+		return address(x, y, z);
+	}
+
+	void *Surface::Buffer::address(int x, int y, int z) const
+	{
 		if(buffer)
 		{
 			x += border;
@@ -1223,6 +1284,37 @@ namespace sw
 		lock = LOCK_UNLOCKED;
 	}
 
+	void Surface::Buffer::markDirty(int x0, int y0, int z0, int x1, int y1, int z1)
+	{
+		x0 = max(x0, 0);
+		y0 = max(y0, 0);
+		z0 = max(z0, 0);
+		x1 = min(x1, width);
+		y1 = min(y1, height);
+		z1 = min(z1, depth);
+
+		if(!dirty)
+		{
+			dirtyX0 = x0;
+			dirtyY0 = y0;
+			dirtyZ0 = z0;
+			dirtyX1 = x1;
+			dirtyY1 = y1;
+			dirtyZ1 = z1;
+		}
+		else
+		{
+			dirtyX0 = min(dirtyX0, x0);
+			dirtyY0 = min(dirtyY0, y0);
+			dirtyZ0 = min(dirtyZ0, z0);
+			dirtyX1 = max(dirtyX1, x1);
+			dirtyY1 = max(dirtyY1, y1);
+			dirtyZ1 = max(dirtyZ1, z1);
+		}
+
+		dirty = true;
+	}
+
 	class SurfaceImplementation : public Surface
 	{
 	public:
@@ -1273,14 +1365,16 @@ namespace sw
 		external.sliceP = external.bytes ? slice / external.bytes : 0;
 		external.border = 0;
 		external.lock = LOCK_UNLOCKED;
-		external.dirty = true;
+		external.dirty = false;
+		external.tiled = false;
+		external.markDirty(0, 0, 0, width, height, depth);
 
 		internal.buffer = nullptr;
 		internal.width = width;
 		internal.height = height;
 		internal.depth = depth;
 		internal.samples = 1;
-		internal.format = selectInternalFormat(format);
+		internal.format = selectInternalFormat(format, depth, 0);
 		internal.bytes = bytes(internal.format);
 		internal.pitchB = pitchB(internal.width, 0, internal.format, false);
 		internal.pitchP = pitchP(internal.width, 0, internal.format, false);
@@ -1289,6 +1383,18 @@ namespace sw
 		internal.border = 0;
 		internal.lock = LOCK_UNLOCKED;
 		internal.dirty = false;
+		internal.tiled = false;
+
+		// Memory which already has the internal layout is used in place, whatever its pitch
+		if(pixels && internal.format == external.format && !isCompressed(format) &&
+		   external.bytes && pitch % external.bytes == 0 && slice % external.bytes == 0 &&
+		   pitch >= internal.pitchB && slice >= pitch * height)
+		{
+			internal.pitchB = external.pitchB;
+			internal.pitchP = external.pitchP;
+			internal.sliceB = external.sliceB;
+			internal.sliceP = external.sliceP;
+		}
 
 		stencil.buffer = nullptr;
 		stencil.width = width;
@@ -1304,9 +1410,19 @@ namespace sw
 		stencil.border = 0;
 		stencil.lock = LOCK_UNLOCKED;
 		stencil.dirty = false;
+		stencil.tiled = false;
+
+		coarseDepth = nullptr;
+		coarseDepthDirty = true;
+		depthClearPending = false;
+		uniformSamples = nullptr;
+		uniformSamplesDirty = true;
+		depthClearValue = 0.0f;
 
 		dirtyContents = true;
 		paletteUsed = 0;
+
+		track();
 	}
 
 	Surface::Surface(Resource *texture, int width, int height, int depth, int border, int samples, Format format, bool lockable, bool renderTarget, int pitchPprovided) : lockable(lockable), renderTarget(renderTarget)
@@ -1331,13 +1447,14 @@ namespace sw
 		external.border = 0;
 		external.lock = LOCK_UNLOCKED;
 		external.dirty = false;
+		external.tiled = false;
 
 		internal.buffer = nullptr;
 		internal.width = width;
 		internal.height = height;
 		internal.depth = depth;
 		internal.samples = (short)samples;
-		internal.format = selectInternalFormat(format);
+		internal.format = selectInternalFormat(format, depth, border);
 		internal.bytes = bytes(internal.format);
 		internal.pitchB = !pitchPprovided ? pitchB(internal.width, border, internal.format, renderTarget) : pitchPprovided * internal.bytes;
 		internal.pitchP = !pitchPprovided ? pitchP(internal.width, border, internal.format, renderTarget) : pitchPprovided;
@@ -1346,6 +1463,18 @@ namespace sw
 		internal.border = (short)border;
 		internal.lock = LOCK_UNLOCKED;
 		internal.dirty = false;
+		internal.tiled = false;
+
+		// Texture uploads in the internal format are written straight into the buffer the sampler
+		// reads, instead of being copied over from an external one. That requires matching layouts.
+		// Buffers get allocated with the quad aligned size either way.
+		if(texture && !pitchPprovided && external.format == internal.format && border == 0)
+		{
+			external.pitchB = internal.pitchB;
+			external.pitchP = internal.pitchP;
+			external.sliceB = internal.sliceB;
+			external.sliceP = internal.sliceP;
+		}
 
 		stencil.buffer = nullptr;
 		stencil.width = width;
@@ -1361,9 +1490,19 @@ namespace sw
 		stencil.border = 0;
 		stencil.lock = LOCK_UNLOCKED;
 		stencil.dirty = false;
+		stencil.tiled = false;
+
+		coarseDepth = nullptr;
+		coarseDepthDirty = true;
+		depthClearPending = false;
+		uniformSamples = nullptr;
+		uniformSamplesDirty = true;
+		depthClearValue = 0.0f;
 
 		dirtyContents = true;
 		paletteUsed = 0;
+
+		track();
 	}
 
 	Surface::~Surface()
@@ -1372,6 +1511,8 @@ namespace sw
 		// We can't call it here because the parent resource may already have been destroyed.
 		ASSERT(isUnlocked());
 
+		untrack();
+
 		if(!hasParent)
 		{
 			resource->destruct();
@@ -1388,16 +1529,46 @@ namespace sw
 		}
 
 		deallocate(stencil.buffer);
+		deallocate(coarseDepth);
+		deallocate(uniformSamples);
 
 		external.buffer = nullptr;
 		internal.buffer = nullptr;
 		stencil.buffer = nullptr;
+		coarseDepth = nullptr;
+		uniformSamples = nullptr;
 	}
 
 	void *Surface::lockExternal(int x, int y, int z, Lock lock, Accessor client)
+	{
+		void *data = lockExternal(x, y, z, 0, 0, 0, lock, client);
+
+		switch(lock)
+		{
+		case LOCK_WRITEONLY:
+		case LOCK_READWRITE:
+		case LOCK_DISCARD:
+			// Any texel could be modified
+			external.markDirty(0, 0, 0, external.width, external.height, external.depth);
+			break;
+		default:
+			break;
+		}
+
+		return data;
+	}
+
+	void *Surface::lockExternal(int x, int y, int z, int width, int height, int depth, Lock lock, Accessor client)
 	{
 		resource->lock(client);
 
+		lastExternalAccess.store(Timer::counter(), std::memory_order_relaxed);
+
+		if(depthClearPending)
+		{
+			clearDepthTiles();
+		}
+
 		if(!external.buffer)
 		{
 			if(internal.buffer && identicalBuffers())
@@ -1410,6 +1581,14 @@ namespace sw
 			}
 		}
 
+		// An evicted external copy is recreated from the internal one, which has to be linear for it
+		if(internal.tiled && internal.dirty)
+		{
+			tile(internal, false);
+		}
+
+		ASSERT(!internal.tiled || !internal.dirty);   // Writes to the internal buffer restore the linear layout
+
 		if(internal.dirty)
 		{
 			if(lock != LOCK_DISCARD)
@@ -1428,12 +1607,14 @@ namespace sw
 		case LOCK_READWRITE:
 		case LOCK_DISCARD:
 			dirtyContents = true;
+			coarseDepthDirty = true;
+			uniformSamplesDirty = true;
 			break;
 		default:
 			ASSERT(false);
 		}
 
-		return external.lockRect(x, y, z, lock);
+		return external.lockRect(x, y, z, width, height, depth, lock);
 	}
 
 	void Surface::unlockExternal()
@@ -1450,9 +1631,12 @@ namespace sw
 			resource->lock(client);
 		}
 
+		lastAccess.store(Timer::counter(), std::memory_order_relaxed);
+
 		if(!internal.buffer)
 		{
-			if(external.buffer && identicalBuffers())
+			// Textures first accessed by the sampler get their own copy so it can be tiled
+			if(external.buffer && identicalBuffers() && !(lock == LOCK_UNLOCKED && isTileable()))
 			{
 				internal.buffer = external.buffer;
 			}
@@ -1462,6 +1646,38 @@ namespace sw
 			}
 		}
 
+		// Only the sampler understands the tiled layout, and updates are written linearly
+		if(internal.tiled && (lock != LOCK_UNLOCKED || external.dirty))
+		{
+			if(lock == LOCK_DISCARD)
+			{
+				internal.tiled = false;
+			}
+			else
+			{
+				tile(internal, false);
+			}
+		}
+
+		// The renderer fills the tiles of a deferred depth clear itself
+		if(depthClearPending && client != MANAGED)
+		{
+			if(lock == LOCK_DISCARD)
+			{
+				depthClearPending = false;
+			}
+			else if(lock == LOCK_UNLOCKED)
+			{
+				resource->lock(client);   // Wait for rendering to stop touching the tiles
+				clearDepthTiles();
+				resource->unlock();
+			}
+			else
+			{
+				clearDepthTiles();
+			}
+		}
+
 		// FIXME: WHQL requires conversion to lower external precision and back
 		if(logPrecision >= WHQL)
 		{
@@ -1496,6 +1712,13 @@ namespace sw
 
 			external.dirty = false;
 			paletteUsed = Surface::paletteID;
+			coarseDepthDirty = true;
+			uniformSamplesDirty = true;
+
+			if(lock == LOCK_UNLOCKED && internal.buffer != external.buffer && isTileable())
+			{
+				tile(internal, true);
+			}
 		}
 
 		switch(lock)
@@ -1507,6 +1730,14 @@ namespace sw
 		case LOCK_READWRITE:
 		case LOCK_DISCARD:
 			dirtyContents = true;
+
+			// The renderer keeps the coarse depth and uniform samples up to date
+			// when drawing, any other write leaves them unknown.
+			if(client != MANAGED)
+			{
+				coarseDepthDirty = true;
+				uniformSamplesDirty = true;
+			}
 			break;
 		default:
 			ASSERT(false);
@@ -1520,6 +1751,134 @@ namespace sw
 		return internal.lockRect(x, y, z, lock);
 	}
 
+	float *Surface::lockCoarseDepth(int z)
+	{
+		ASSERT(hasCoarseDepth());
+
+		int slice = getCoarseDepthSliceP();
+
+		if(!coarseDepth)
+		{
+			coarseDepth = (float*)allocate(slice * internal.depth * sizeof(float), 16, MEMORY_SURFACE);
+			coarseDepthDirty = true;
+		}
+
+		if(coarseDepthDirty)
+		{
+			// +Infinity never rejects anything, until the renderer has computed the tile's actual maximum
+			memfill4(coarseDepth, 0x7F800000, slice * internal.depth * sizeof(float));
+			coarseDepthDirty = false;
+		}
+
+		return coarseDepth + z * slice;
+	}
+
+	unsigned char *Surface::lockUniformSamples(int z)
+	{
+		ASSERT(hasUniformSamples());
+
+		int slice = getUniformSamplesSliceP();
+
+		if(!uniformSamples)
+		{
+			uniformSamples = (unsigned char*)allocate(slice * internal.depth, 16, MEMORY_SURFACE);
+			uniformSamplesDirty = true;
+		}
+
+		if(uniformSamplesDirty)
+		{
+			memset(uniformSamples, 0, slice * internal.depth);   // Unknown, until the renderer writes every sample of a quad
+			uniformSamplesDirty = false;
+		}
+
+		return uniformSamples + z * slice;
+	}
+
+	void Surface::setUniformSamples(const Rect &rect)
+	{
+		if(!hasUniformSamples())
+		{
+			return;
+		}
+
+		unsigned char *quads = lockUniformSamples(0);
+		int pitch = getUniformSamplesPitchP();
+
+		// Only quads lying entirely inside the rectangle had all of their samples written
+		int x0 = (rect.x0 + 1) / 2;
+		int x1 = rect.x1 / 2;
+		int y0 = (rect.y0 + 1) / 2;
+		int y1 = rect.y1 / 2;
+
+		// The last quad of an odd-sized surface lacks pixels which can't differ
+		if(rect.x1 == internal.width) x1 = pitch;
+		if(rect.y1 == internal.height) y1 = (internal.height + 1) / 2;
+
+		for(int y = y0; y < y1; y++)
+		{
+			for(int x = x0; x < x1; x++)
+			{
+				quads[y * pitch + x] = 1;
+			}
+		}
+	}
+
+	void Surface::flushDepthClear()
+	{
+		if(depthClearPending)
+		{
+			resource->lock(PUBLIC);
+			clearDepthTiles();
+			resource->unlock();
+		}
+	}
+
+	void Surface::clearDepthTiles()
+	{
+		// Negative tiles haven't been written since the deferred clear
+		float *buffer = (float*)internal.address(0, 0, 0);
+		const bool quadLayout = hasQuadLayout(internal.format);
+		const int tilePitch = getCoarseDepthPitchP();
+		const int tileRows = (internal.height + COARSE_TILE_HEIGHT - 1) / COARSE_TILE_HEIGHT;
+
+		for(int tileY = 0; tileY < tileRows; tileY++)
+		{
+			for(int tileX = 0; tileX < tilePitch; tileX++)
+			{
+				float &tile = coarseDepth[tileY * tilePitch + tileX];
+
+				if(tile >= 0.0f)
+				{
+					continue;
+				}
+
+				int x0 = tileX * COARSE_TILE_WIDTH;
+				int x1 = min(x0 + (int)COARSE_TILE_WIDTH, internal.width);
+				int y0 = tileY * COARSE_TILE_HEIGHT;
+				int y1 = min(y0 + (int)COARSE_TILE_HEIGHT, internal.height);
+
+				for(int y = y0; y < y1; y++)
+				{
+					for(int x = x0; x < x1; x++)
+					{
+						if(!quadLayout)
+						{
+							buffer[y * internal.pitchP + x] = depthClearValue;
+						}
+						else
+						{
+							buffer[(y & ~1) * internal.pitchP + (y & 1) * 2 + (x & ~1) * 2 + (x & 1)] = depthClearValue;
+						}
+					}
+				}
+
+				tile = depthClearValue;
+			}
+		}
+
+		depthClearPending = false;
+	}
+
 	void Surface::unlockInternal()
 	{
 		internal.unlockRect();
@@ -1885,61 +2244,203 @@ namespace sw
 		{
 			ASSERT(source.dirty && !destination.dirty);
 
-			switch(source.format)
-			{
-			case FORMAT_R8G8B8:		decodeR8G8B8(destination, source);		break;   // FIXME: Check destination format
-			case FORMAT_X1R5G5B5:	decodeX1R5G5B5(destination, source);	break;   // FIXME: Check destination format
-			case FORMAT_A1R5G5B5:	decodeA1R5G5B5(destination, source);	break;   // FIXME: Check destination format
-			case FORMAT_X4R4G4B4:	decodeX4R4G4B4(destination, source);	break;   // FIXME: Check destination format
-			case FORMAT_A4R4G4B4:	decodeA4R4G4B4(destination, source);	break;   // FIXME: Check destination format
-			case FORMAT_P8:			decodeP8(destination, source);			break;   // FIXME: Check destination format
-			case FORMAT_DXT1:		decodeDXT1(destination, source);		break;   // FIXME: Check destination format
-			case FORMAT_DXT3:		decodeDXT3(destination, source);		break;   // FIXME: Check destination format
-			case FORMAT_DXT5:		decodeDXT5(destination, source);		break;   // FIXME: Check destination format
-			case FORMAT_ATI1:		decodeATI1(destination, source);		break;   // FIXME: Check destination format
-			case FORMAT_ATI2:		decodeATI2(destination, source);		break;   // FIXME: Check destination format
-			case FORMAT_R11_EAC:         decodeEAC(destination, source, 1, false); break; // FIXME: Check destination format
-			case FORMAT_SIGNED_R11_EAC:  decodeEAC(destination, source, 1, true);  break; // FIXME: Check destination format
-			case FORMAT_RG11_EAC:        decodeEAC(destination, source, 2, false); break; // FIXME: Check destination format
-			case FORMAT_SIGNED_RG11_EAC: decodeEAC(destination, source, 2, true);  break; // FIXME: Check destination format
-			case FORMAT_ETC1:
-			case FORMAT_RGB8_ETC2:                      decodeETC2(destination, source, 0, false); break; // FIXME: Check destination format
-			case FORMAT_SRGB8_ETC2:                     decodeETC2(destination, source, 0, true);  break; // FIXME: Check destination format
-			case FORMAT_RGB8_PUNCHTHROUGH_ALPHA1_ETC2:  decodeETC2(destination, source, 1, false); break; // FIXME: Check destination format
-			case FORMAT_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2: decodeETC2(destination, source, 1, true);  break; // FIXME: Check destination format
-			case FORMAT_RGBA8_ETC2_EAC:                 decodeETC2(destination, source, 8, false); break; // FIXME: Check destination format
-			case FORMAT_SRGB8_ALPHA8_ETC2_EAC:          decodeETC2(destination, source, 8, true);  break; // FIXME: Check destination format
-			case FORMAT_RGBA_ASTC_4x4_KHR:           decodeASTC(destination, source, 4,  4,  1, false); break; // FIXME: Check destination format
-			case FORMAT_RGBA_ASTC_5x4_KHR:           decodeASTC(destination, source, 5,  4,  1, false); break; // FIXME: Check destination format
-			case FORMAT_RGBA_ASTC_5x5_KHR:           decodeASTC(destination, source, 5,  5,  1, false); break; // FIXME: Check destination format
-			case FORMAT_RGBA_ASTC_6x5_KHR:           decodeASTC(destination, source, 6,  5,  1, false); break; // FIXME: Check destination format
-			case FORMAT_RGBA_ASTC_6x6_KHR:           decodeASTC(destination, source, 6,  6,  1, false); break; // FIXME: Check destination format
-			case FORMAT_RGBA_ASTC_8x5_KHR:           decodeASTC(destination, source, 8,  5,  1, false); break; // FIXME: Check destination format
-			case FORMAT_RGBA_ASTC_8x6_KHR:           decodeASTC(destination, source, 8,  6,  1, false); break; // FIXME: Check destination format
-			case FORMAT_RGBA_ASTC_8x8_KHR:           decodeASTC(destination, source, 8,  8,  1, false); break; // FIXME: Check destination format
-			case FORMAT_RGBA_ASTC_10x5_KHR:          decodeASTC(destination, source, 10, 5,  1, false); break; // FIXME: Check destination format
-			case FORMAT_RGBA_ASTC_10x6_KHR:          decodeASTC(destination, source, 10, 6,  1, false); break; // FIXME: Check destination format
-			case FORMAT_RGBA_ASTC_10x8_KHR:          decodeASTC(destination, source, 10, 8,  1, false); break; // FIXME: Check destination format
-			case FORMAT_RGBA_ASTC_10x10_KHR:         decodeASTC(destination, source, 10, 10, 1, false); break; // FIXME: Check destination format
-			case FORMAT_RGBA_ASTC_12x10_KHR:         decodeASTC(destination, source, 12, 10, 1, false); break; // FIXME: Check destination format
-			case FORMAT_RGBA_ASTC_12x12_KHR:         decodeASTC(destination, source, 12, 12, 1, false); break; // FIXME: Check destination format
-			case FORMAT_SRGB8_ALPHA8_ASTC_4x4_KHR:   decodeASTC(destination, source, 4,  4,  1, true);  break; // FIXME: Check destination format
-			case FORMAT_SRGB8_ALPHA8_ASTC_5x4_KHR:   decodeASTC(destination, source, 5,  4,  1, true);  break; // FIXME: Check destination format
-			case FORMAT_SRGB8_ALPHA8_ASTC_5x5_KHR:   decodeASTC(destination, source, 5,  5,  1, true);  break; // FIXME: Check destination format
-			case FORMAT_SRGB8_ALPHA8_ASTC_6x5_KHR:   decodeASTC(destination, source, 6,  5,  1, true);  break; // FIXME: Check destination format
-			case FORMAT_SRGB8_ALPHA8_ASTC_6x6_KHR:   decodeASTC(destination, source, 6,  6,  1, true);  break; // FIXME: Check destination format
-			case FORMAT_SRGB8_ALPHA8_ASTC_8x5_KHR:   decodeASTC(destination, source, 8,  5,  1, true);  break; // FIXME: Check destination format
-			case FORMAT_SRGB8_ALPHA8_ASTC_8x6_KHR:   decodeASTC(destination, source, 8,  6,  1, true);  break; // FIXME: Check destination format
-			case FORMAT_SRGB8_ALPHA8_ASTC_8x8_KHR:   decodeASTC(destination, source, 8,  8,  1, true);  break; // FIXME: Check destination format
-			case FORMAT_SRGB8_ALPHA8_ASTC_10x5_KHR:  decodeASTC(destination, source, 10, 5,  1, true);  break; // FIXME: Check destination format
-			case FORMAT_SRGB8_ALPHA8_ASTC_10x6_KHR:  decodeASTC(destination, source, 10, 6,  1, true);  break; // FIXME: Check destination format
-			case FORMAT_SRGB8_ALPHA8_ASTC_10x8_KHR:  decodeASTC(destination, source, 10, 8,  1, true);  break; // FIXME: Check destination format
-			case FORMAT_SRGB8_ALPHA8_ASTC_10x10_KHR: decodeASTC(destination, source, 10, 10, 1, true);  break; // FIXME: Check destination format
-			case FORMAT_SRGB8_ALPHA8_ASTC_12x10_KHR: decodeASTC(destination, source, 12, 10, 1, true);  break; // FIXME: Check destination format
-			case FORMAT_SRGB8_ALPHA8_ASTC_12x12_KHR: decodeASTC(destination, source, 12, 12, 1, true);  break; // FIXME: Check destination format
-			default:				genericUpdate(destination, source);		break;
+			const bool astc = (source.format >= FORMAT_RGBA_ASTC_4x4_KHR) && (source.format <= FORMAT_SRGB8_ALPHA8_ASTC_12x12_KHR);
+
+			Buffer destinationRegion;
+			Buffer sourceRegion;
+			destinationRegion = destination;
+			sourceRegion = source;
+			updateRegion(destinationRegion, sourceRegion);
+
+			if(isCompressed(source.format) && !astc && sourceRegion.depth == 1)
+			{
+				decodeParallel(destinationRegion, sourceRegion);
 			}
+			else
+			{
+				decode(destinationRegion, sourceRegion);
+			}
+		}
+	}
+
+	void Surface::updateRegion(Buffer &destination, Buffer &source)
+	{
+		// Narrows both buffers to views of the source's modified region, when their layout allows it
+		if(source.samples > 1 || destination.samples > 1 || hasQuadLayout(source.format) || hasQuadLayout(destination.format))
+		{
+			return;
+		}
+
+		const bool astc = (source.format >= FORMAT_RGBA_ASTC_4x4_KHR) && (source.format <= FORMAT_SRGB8_ALPHA8_ASTC_12x12_KHR);
+
+		if(astc || isPalette(source.format))
+		{
+			return;
+		}
+
+		int x0 = source.dirtyX0;
+		int y0 = source.dirtyY0;
+		int z0 = source.dirtyZ0;
+		int x1 = min(source.dirtyX1, destination.width);
+		int y1 = min(source.dirtyY1, destination.height);
+		int z1 = min(source.dirtyZ1, destination.depth);
+
+		if(isCompressed(source.format))
+		{
+			// Block decoders walk whole rows of 4x4 blocks
+			x0 = 0;
+			x1 = min(source.width, destination.width);
+			y0 &= ~3;
+			y1 = min((y1 + 3) & ~3, destination.height);
 		}
+
+		if(x1 <= x0 || y1 <= y0 || z1 <= z0)
+		{
+			return;
+		}
+
+		destination.buffer = destination.lockRect(x0, y0, z0, LOCK_UPDATE);
+		destination.width = x1 - x0;
+		destination.height = y1 - y0;
+		destination.depth = z1 - z0;
+		destination.border = 0;
+
+		source.buffer = source.lockRect(x0, y0, z0, LOCK_READONLY);
+		source.width = x1 - x0;
+		source.height = y1 - y0;
+		source.depth = z1 - z0;
+		source.border = 0;
+
+		destination.unlockRect();
+		source.unlockRect();
+	}
+
+	void Surface::decode(Buffer &destination, Buffer &source)
+	{
+		switch(source.format)
+		{
+		case FORMAT_R8G8B8:		decodeR8G8B8(destination, source);		break;   // FIXME: Check destination format
+		case FORMAT_X1R5G5B5:	decodeX1R5G5B5(destination, source);	break;   // FIXME: Check destination format
+		case FORMAT_A1R5G5B5:	decodeA1R5G5B5(destination, source);	break;   // FIXME: Check destination format
+		case FORMAT_X4R4G4B4:	decodeX4R4G4B4(destination, source);	break;   // FIXME: Check destination format
+		case FORMAT_A4R4G4B4:	decodeA4R4G4B4(destination, source);	break;   // FIXME: Check destination format
+		case FORMAT_P8:			decodeP8(destination, source);			break;   // FIXME: Check destination format
+		case FORMAT_SRGB8_X8:
+		case FORMAT_SRGB8_A8:
+			if(destination.format == FORMAT_A16B16G16R16)
+			{
+				decodeSRGB8(destination, source);
+			}
+			else
+			{
+				genericUpdate(destination, source);
+			}
+			break;
+		case FORMAT_DXT1:		decodeDXT1(destination, source);		break;   // FIXME: Check destination format
+		case FORMAT_DXT3:		decodeDXT3(destination, source);		break;   // FIXME: Check destination format
+		case FORMAT_DXT5:		decodeDXT5(destination, source);		break;   // FIXME: Check destination format
+		case FORMAT_ATI1:		decodeATI1(destination, source);		break;   // FIXME: Check destination format
+		case FORMAT_ATI2:		decodeATI2(destination, source);		break;   // FIXME: Check destination format
+		case FORMAT_R11_EAC:         decodeEAC(destination, source, 1, false); break; // FIXME: Check destination format
+		case FORMAT_SIGNED_R11_EAC:  decodeEAC(destination, source, 1, true);  break; // FIXME: Check destination format
+		case FORMAT_RG11_EAC:        decodeEAC(destination, source, 2, false); break; // FIXME: Check destination format
+		case FORMAT_SIGNED_RG11_EAC: decodeEAC(destination, source, 2, true);  break; // FIXME: Check destination format
+		case FORMAT_ETC1:
+		case FORMAT_RGB8_ETC2:                      decodeETC2(destination, source, 0, false); break; // FIXME: Check destination format
+		case FORMAT_SRGB8_ETC2:                     decodeETC2(destination, source, 0, true);  break; // FIXME: Check destination format
+		case FORMAT_RGB8_PUNCHTHROUGH_ALPHA1_ETC2:  decodeETC2(destination, source, 1, false); break; // FIXME: Check destination format
+		case FORMAT_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2: decodeETC2(destination, source, 1, true);  break; // FIXME: Check destination format
+		case FORMAT_RGBA8_ETC2_EAC:                 decodeETC2(destination, source, 8, false); break; // FIXME: Check destination format
+		case FORMAT_SRGB8_ALPHA8_ETC2_EAC:          decodeETC2(destination, source, 8, true);  break; // FIXME: Check destination format
+		case FORMAT_RGBA_ASTC_4x4_KHR:           decodeASTC(destination, source, 4,  4,  1, false); break; // FIXME: Check destination format
+		case FORMAT_RGBA_ASTC_5x4_KHR:           decodeASTC(destination, source, 5,  4,  1, false); break; // FIXME: Check destination format
+		case FORMAT_RGBA_ASTC_5x5_KHR:           decodeASTC(destination, source, 5,  5,  1, false); break; // FIXME: Check destination format
+		case FORMAT_RGBA_ASTC_6x5_KHR:           decodeASTC(destination, source, 6,  5,  1, false); break; // FIXME: Check destination format
+		case FORMAT_RGBA_ASTC_6x6_KHR:           decodeASTC(destination, source, 6,  6,  1, false); break; // FIXME: Check destination format
+		case FORMAT_RGBA_ASTC_8x5_KHR:           decodeASTC(destination, source, 8,  5,  1, false); break; // FIXME: Check destination format
+		case FORMAT_RGBA_ASTC_8x6_KHR:           decodeASTC(destination, source, 8,  6,  1, false); break; // FIXME: Check destination format
+		case FORMAT_RGBA_ASTC_8x8_KHR:           decodeASTC(destination, source, 8,  8,  1, false); break; // FIXME: Check destination format
+		case FORMAT_RGBA_ASTC_10x5_KHR:          decodeASTC(destination, source, 10, 5,  1, false); break; // FIXME: Check destination format
+		case FORMAT_RGBA_ASTC_10x6_KHR:          decodeASTC(destination, source, 10, 6,  1, false); break; // FIXME: Check destination format
+		case FORMAT_RGBA_ASTC_10x8_KHR:          decodeASTC(destination, source, 10, 8,  1, false); break; // FIXME: Check destination format
+		case FORMAT_RGBA_ASTC_10x10_KHR:         decodeASTC(destination, source, 10, 10, 1, false); break; // FIXME: Check destination format
+		case FORMAT_RGBA_ASTC_12x10_KHR:         decodeASTC(destination, source, 12, 10, 1, false); break; // FIXME: Check destination format
+		case FORMAT_RGBA_ASTC_12x12_KHR:         decodeASTC(destination, source, 12, 12, 1, false); break; // FIXME: Check destination format
+		case FORMAT_SRGB8_ALPHA8_ASTC_4x4_KHR:   decodeASTC(destination, source, 4,  4,  1, true);  break; // FIXME: Check destination format
+		case FORMAT_SRGB8_ALPHA8_ASTC_5x4_KHR:   decodeASTC(destination, source, 5,  4,  1, true);  break; // FIXME: Check destination format
+		case FORMAT_SRGB8_ALPHA8_ASTC_5x5_KHR:   decodeASTC(destination, source, 5,  5,  1, true);  break; // FIXME: Check destination format
+		case FORMAT_SRGB8_ALPHA8_ASTC_6x5_KHR:   decodeASTC(destination, source, 6,  5,  1, true);  break; // FIXME: Check destination format
+		case FORMAT_SRGB8_ALPHA8_ASTC_6x6_KHR:   decodeASTC(destination, source, 6,  6,  1, true);  break; // FIXME: Check destination format
+		case FORMAT_SRGB8_ALPHA8_ASTC_8x5_KHR:   decodeASTC(destination, source, 8,  5,  1, true);  break; // FIXME: Check destination format
+		case FORMAT_SRGB8_ALPHA8_ASTC_8x6_KHR:   decodeASTC(destination, source, 8,  6,  1, true);  break; // FIXME: Check destination format
+		case FORMAT_SRGB8_ALPHA8_ASTC_8x8_KHR:   decodeASTC(destination, source, 8,  8,  1, true);  break; // FIXME: Check destination format
+		case FORMAT_SRGB8_ALPHA8_ASTC_10x5_KHR:  decodeASTC(destination, source, 10, 5,  1, true);  break; // FIXME: Check destination format
+		case FORMAT_SRGB8_ALPHA8_ASTC_10x6_KHR:  decodeASTC(destination, source, 10, 6,  1, true);  break; // FIXME: Check destination format
+		case FORMAT_SRGB8_ALPHA8_ASTC_10x8_KHR:  decodeASTC(destination, source, 10, 8,  1, true);  break; // FIXME: Check destination format
+		case FORMAT_SRGB8_ALPHA8_ASTC_10x10_KHR: decodeASTC(destination, source, 10, 10, 1, true);  break; // FIXME: Check destination format
+		case FORMAT_SRGB8_ALPHA8_ASTC_12x10_KHR: decodeASTC(destination, source, 12, 10, 1, true);  break; // FIXME: Check destination format
+		case FORMAT_SRGB8_ALPHA8_ASTC_12x12_KHR: decodeASTC(destination, source, 12, 12, 1, true);  break; // FIXME: Check destination format
+		default:				genericUpdate(destination, source);		break;
+		}
+	}
+
+	void Surface::decodeParallel(Buffer &destination, Buffer &source)
+	{
+		const int minimumBandTexels = 64 * 1024;   // Smaller images are not worth starting threads for
+		const int maximumBands = 16;
+
+		int blockRows = (min(destination.height, source.height) + 3) / 4;
+		int bandCount = min(min((int)threadCount, maximumBands), min(source.width * source.height / minimumBandTexels, blockRows));
+
+		if(bandCount <= 1)
+		{
+			decode(destination, source);
+
+			return;
+		}
+
+		// Each band is a 4-row aligned view of both buffers, decoded independently
+		DecodeBand band[maximumBands];
+		Thread *thread[maximumBands];
+
+		for(int i = 0; i < bandCount; i++)
+		{
+			int y0 = 4 * (blockRows * i / bandCount);
+			int y1 = 4 * (blockRows * (i + 1) / bandCount);
+
+			band[i].destination = destination;
+			band[i].destination.buffer = destination.lockRect(0, y0, 0, LOCK_UPDATE);
+			band[i].destination.height = max(min(y1, destination.height) - y0, 0);
+			band[i].destination.border = 0;
+
+			band[i].source = source;
+			band[i].source.buffer = source.lockRect(0, y0, 0, LOCK_READONLY);
+			band[i].source.height = max(min(y1, source.height) - y0, 0);
+			band[i].source.border = 0;
+		}
+
+		destination.unlockRect();
+		source.unlockRect();
+
+		for(int i = 1; i < bandCount; i++)
+		{
+			thread[i] = new Thread(decodeBand, &band[i]);
+		}
+
+		decodeBand(&band[0]);
+
+		for(int i = 1; i < bandCount; i++)
+		{
+			thread[i]->join();
+			delete thread[i];
+		}
+	}
+
+	void Surface::decodeBand(void *parameters)
+	{
+		DecodeBand *band = static_cast<DecodeBand*>(parameters);
+
+		decode(band->destination, band->source);
 	}
 
 	void Surface::genericUpdate(Buffer &destination, Buffer &source)
@@ -1952,6 +2453,85 @@ namespace sw
 		int width = min(destination.width, source.width);
 		int rowBytes = width * source.bytes;
 
+		// Half and single precision formats with the same components only differ in precision per component
+		int halfComponents = 0;
+		bool toHalf = false;
+
+		switch(source.format)
+		{
+		case FORMAT_R16F:          halfComponents = (destination.format == FORMAT_R32F) ? 1 : 0;          break;
+		case FORMAT_G16R16F:       halfComponents = (destination.format == FORMAT_G32R32F) ? 2 : 0;       break;
+		case FORMAT_B16G16R16F:    halfComponents = (destination.format == FORMAT_B32G32R32F) ? 3 : 0;    break;
+		case FORMAT_A16B16G16R16F: halfComponents = (destination.format == FORMAT_A32B32G32R32F) ? 4 : 0; break;
+		case FORMAT_R32F:          halfComponents = (destination.format == FORMAT_R16F) ? 1 : 0;          toHalf = true; break;
+		case FORMAT_G32R32F:       halfComponents = (destination.format == FORMAT_G16R16F) ? 2 : 0;       toHalf = true; break;
+		case FORMAT_B32G32R32F:    halfComponents = (destination.format == FORMAT_B16G16R16F) ? 3 : 0;    toHalf = true; break;
+		case FORMAT_A32B32G32R32F: halfComponents = (destination.format == FORMAT_A16B16G16R16F) ? 4 : 0; toHalf = true; break;
+		default:                   break;
+		}
+
+		if(halfComponents != 0 && source.samples <= 1 && destination.samples <= 1)
+		{
+			for(int z = 0; z < depth; z++)
+			{
+				unsigned char *sourceRow = sourceSlice + z * source.sliceB;
+				unsigned char *destinationRow = destinationSlice + z * destination.sliceB;
+
+				for(int y = 0; y < height; y++)
+				{
+					if(toHalf)
+					{
+						floatToHalf((half*)destinationRow, (const float*)sourceRow, width * halfComponents);
+					}
+					else
+					{
+						halfToFloat((float*)destinationRow, (const half*)sourceRow, width * halfComponents);
+					}
+
+					sourceRow += source.pitchB;
+					destinationRow += destination.pitchB;
+				}
+			}
+
+			source.unlockRect();
+			destination.unlockRect();
+
+			return;
+		}
+
+		// Format conversions use a generated routine keyed by the format pair, when the Blitter supports it
+		bool convertible = source.format != destination.format &&
+		                   source.samples <= 1 && destination.samples <= 1 &&
+		                   !hasQuadLayout(source.format) && !hasQuadLayout(destination.format) &&
+		                   isSRGBformat(source.format) == isSRGBformat(destination.format) &&   // The converter doesn't apply the sRGB curve
+		                   isNonNormalizedInteger(source.format) == isNonNormalizedInteger(destination.format);
+
+		if(convertible)
+		{
+			// Created once and never destroyed, surfaces may be updated during static destruction.
+			// Shared by concurrent updates: routine lookups are locked, and with a single thread
+			// the conversion itself touches no Blitter state.
+			static Blitter *converter = new Blitter();
+
+			for(int z = 0; z < depth && convertible; z++)
+			{
+				convertible = converter->convert(sourceSlice + z * source.sliceB, source.format, source.pitchB, destinationSlice + z * destination.sliceB, destination.format, destination.pitchB, width, height);
+			}
+
+			if(convertible)
+			{
+				source.unlockRect();
+				destination.unlockRect();
+
+				return;
+			}
+		}
+
+		if(source.format != destination.format)
+		{
+			countFallback(UPDATE_FALLBACK);
+		}
+
 		for(int z = 0; z < depth; z++)
 		{
 			unsigned char *sourceRow = sourceSlice;
@@ -2033,6 +2613,63 @@ namespace sw
 		destination.unlockRect();
 	}
 
+	void Surface::decodeSRGB8(Buffer &destination, Buffer &source)
+	{
+		// Initialized once, also when surfaces are updated concurrently
+		static const struct SRGBtoLinear16Table
+		{
+			SRGBtoLinear16Table()
+			{
+				for(int i = 0; i < 256; i++)
+				{
+					value[i] = static_cast<unsigned short>(sRGBtoLinear(static_cast<float>(i) / 255.0f) * 65535.0f + 0.5f);
+				}
+			}
+
+			unsigned short value[256];
+		} sRGBtoLinear16Table;
+
+		unsigned char *sourceSlice = (unsigned char*)source.lockRect(0, 0, 0, sw::LOCK_READONLY);
+		unsigned char *destinationSlice = (unsigned char*)destination.lockRect(0, 0, 0, sw::LOCK_UPDATE);
+
+		int depth = min(destination.depth, source.depth);
+		int height = min(destination.height, source.height);
+		int width = min(destination.width, source.width);
+		bool opaque = (source.format == FORMAT_SRGB8_X8);
+
+		for(int z = 0; z < depth; z++)
+		{
+			unsigned char *sourceRow = sourceSlice;
+			unsigned char *destinationRow = destinationSlice;
+
+			for(int y = 0; y < height; y++)
+			{
+				unsigned char *sourceElement = sourceRow;
+				unsigned short *destinationElement = (unsigned short*)destinationRow;
+
+				for(int x = 0; x < width; x++)
+				{
+					destinationElement[0] = sRGBtoLinear16Table.value[sourceElement[0]];
+					destinationElement[1] = sRGBtoLinear16Table.value[sourceElement[1]];
+					destinationElement[2] = sRGBtoLinear16Table.value[sourceElement[2]];
+					destinationElement[3] = opaque ? 0xFFFF : sourceElement[3] * 0x0101;   // Alpha is stored linearly
+
+					sourceElement += source.bytes;
+					destinationElement += 4;
+				}
+
+				sourceRow += source.pitchB;
+				destinationRow += destination.pitchB;
+			}
+
+			sourceSlice += source.sliceB;
+			destinationSlice += destination.sliceB;
+		}
+
+		source.unlockRect();
+		destination.unlockRect();
+	}
+
 	void Surface::decodeX1R5G5B5(Buffer &destination, Buffer &source)
 	{
 		unsigned char *sourceSlice = (unsigned char*)source.lockRect(0, 0, 0, sw::LOCK_READONLY);
@@ -2598,16 +3235,19 @@ namespace sw
 
 		if(isSRGB)
 		{
-			static byte sRGBtoLinearTable[256];
-			static bool sRGBtoLinearTableDirty = true;
-			if(sRGBtoLinearTableDirty)
+			// Initialized once, also when bands are decoded concurrently
+			static const struct SRGBtoLinearTable
 			{
-				for(int i = 0; i < 256; i++)
+				SRGBtoLinearTable()
 				{
-					sRGBtoLinearTable[i] = static_cast<byte>(sRGBtoLinear(static_cast<float>(i) / 255.0f) * 255.0f + 0.5f);
+					for(int i = 0; i < 256; i++)
+					{
+						value[i] = static_cast<byte>(sRGBtoLinear(static_cast<float>(i) / 255.0f) * 255.0f + 0.5f);
+					}
 				}
-				sRGBtoLinearTableDirty = false;
-			}
+
+				byte value[256];
+			} sRGBtoLinearTable;
 
 			// Perform sRGB conversion in place after decoding
 			byte *src = (byte*)internal.lockRect(0, 0, 0, LOCK_READWRITE);
@@ -2619,7 +3259,7 @@ namespace sw
 					byte *srcPix = srcRow + x * internal.bytes;
 					for(int i = 0; i < 3; i++)
 					{
-						srcPix[i] = sRGBtoLinearTable[srcPix[i]];
+						srcPix[i] = sRGBtoLinearTable.value[srcPix[i]];
 					}
 				}
 			}
@@ -2845,6 +3485,10 @@ namespace sw
 		case FORMAT_L8:
 		case FORMAT_L16:
 		case FORMAT_A8L8:
+		case FORMAT_D16:
+		case FORMAT_DXT1:
+		case FORMAT_DXT3:
+		case FORMAT_DXT5:
 		case FORMAT_YV12_BT601:
 		case FORMAT_YV12_BT709:
 		case FORMAT_YV12_JFIF:
@@ -2929,11 +3573,15 @@ namespace sw
 		case FORMAT_D32FS8_TEXTURE:
 		case FORMAT_D32F_SHADOW:
 		case FORMAT_D32FS8_SHADOW:
+		case FORMAT_D16:
 		case FORMAT_A8:
 		case FORMAT_R8:
 		case FORMAT_L8:
 		case FORMAT_L16:
 		case FORMAT_A8L8:
+		case FORMAT_DXT1:
+		case FORMAT_DXT3:
+		case FORMAT_DXT5:
 		case FORMAT_YV12_BT601:
 		case FORMAT_YV12_BT709:
 		case FORMAT_YV12_JFIF:
@@ -3205,6 +3853,7 @@ namespace sw
 		case FORMAT_D32FS8_TEXTURE: return 1;
 		case FORMAT_D32F_SHADOW:    return 1;
 		case FORMAT_D32FS8_SHADOW:  return 1;
+		case FORMAT_D16:            return 1;
 		case FORMAT_A8:             return 1;
 		case FORMAT_R8I:            return 1;
 		case FORMAT_R8:             return 1;
@@ -3215,6 +3864,9 @@ namespace sw
 		case FORMAT_L8:             return 1;
 		case FORMAT_L16:            return 1;
 		case FORMAT_A8L8:           return 2;
+		case FORMAT_DXT1:           return 4;
+		case FORMAT_DXT3:           return 4;
+		case FORMAT_DXT5:           return 4;
 		case FORMAT_YV12_BT601:     return 3;
 		case FORMAT_YV12_BT709:     return 3;
 		case FORMAT_YV12_JFIF:      return 3;
@@ -3227,9 +3879,161 @@ namespace sw
 
 	void *Surface::allocateBuffer(int width, int height, int depth, int border, int samples, Format format)
 	{
-		return allocate(size(width, height, depth, border, samples, format));
+		void *buffer = allocate(size(width, height, depth, border, samples, format), 16, MEMORY_SURFACE);
+
+		size_t budget = memoryBudget;
+
+		if(budget != 0 && memoryUsage() > budget)
+		{
+			evictIdleBuffers();
+		}
+
+		return buffer;
+	}
+
+	size_t Surface::memoryUsage()
+	{
+		return sw::memoryUsage(MEMORY_SURFACE);
+	}
+
+	void Surface::setMemoryBudget(size_t bytes)
+	{
+		memoryBudget = bytes;
+	}
+
+	size_t Surface::getMemoryBudget()
+	{
+		return memoryBudget;
+	}
+
+	unsigned int Surface::evictionCount()
+	{
+		return evictions;
+	}
+
+	void Surface::track()
+	{
+		lastAccess = 0;
+		lastExternalAccess = 0;
+
+		std::lock_guard<std::mutex> lock(surfaceRegistryMutex);
+		surfaceRegistry.insert(this);
+	}
+
+	void Surface::untrack()
+	{
+		std::lock_guard<std::mutex> lock(surfaceRegistryMutex);
+		surfaceRegistry.erase(this);
+	}
+
+	bool Surface::isEvictable() const
+	{
+		// Only an unmodified internal copy can be recreated from the external buffer we own
+		return ownExternal && external.buffer && internal.buffer && internal.buffer != external.buffer &&
+		       !internal.dirty && !depthClearPending &&
+		       internal.lock == LOCK_UNLOCKED && external.lock == LOCK_UNLOCKED;
+	}
+
+	bool Surface::isExternalEvictable() const
+	{
+		// An external copy in sync with an internal one of the same format can be copied back
+		// losslessly, which happens for textures that got a tiled or bordered internal copy.
+		return ownExternal && external.buffer && internal.buffer && internal.buffer != external.buffer &&
+		       !external.dirty && !internal.dirty && !depthClearPending &&
+		       external.format == internal.format && external.samples == 1 && internal.samples == 1 &&
+		       !isPalette(external.format) &&
+		       internal.lock == LOCK_UNLOCKED && external.lock == LOCK_UNLOCKED;
+	}
+
+	void Surface::evictIdleBuffers()
+	{
+		std::lock_guard<std::mutex> lock(surfaceRegistryMutex);
+
+		int64_t idle = Timer::counter() - (int64_t)(idleSeconds * Timer::frequency());
+		std::multimap<int64_t, std::pair<Surface*, bool>> candidates;   // Least recently used first, and whether it's the external copy
+
+		for(Surface *surface : surfaceRegistry)
+		{
+			int64_t access = surface->lastAccess.load(std::memory_order_relaxed);
+			int64_t externalAccess = surface->lastExternalAccess.load(std::memory_order_relaxed);
+
+			if(access < idle && surface->isEvictable())
+			{
+				candidates.insert({access, {surface, false}});
+			}
+
+			// Textures which are sampled but no longer updated only need their internal copy
+			if(externalAccess < idle && surface->isExternalEvictable())
+			{
+				candidates.insert({externalAccess, {surface, true}});
+			}
+		}
+
+		for(auto &candidate : candidates)
+		{
+			Surface *surface = candidate.second.first;
+			bool external = candidate.second.second;
+
+			if(memoryUsage() <= memoryBudget)
+			{
+				break;
+			}
+
+			// Surfaces in use by the application or the renderer are skipped, never waited for
+			if(!surface->resource->tryLock(EXCLUSIVE))
+			{
+				continue;
+			}
+
+			if(external)
+			{
+				if(surface->isExternalEvictable() && surface->lastExternalAccess.load(std::memory_order_relaxed) < idle)
+				{
+					deallocate(surface->external.buffer);
+					surface->external.buffer = nullptr;
+
+					// The next external lock copies the internal contents back
+					surface->internal.markDirty(0, 0, 0, surface->internal.width, surface->internal.height, surface->internal.depth);
+
+					evictions++;
+				}
+			}
+			else if(surface->isEvictable() && surface->lastAccess.load(std::memory_order_relaxed) < idle)
+			{
+				deallocate(surface->internal.buffer);
+				surface->internal.buffer = nullptr;
+				surface->internal.tiled = false;
+				surface->coarseDepthDirty = true;
+				surface->uniformSamplesDirty = true;
+
+				// The next internal lock converts the external contents again
+				surface->external.markDirty(0, 0, 0, surface->external.width, surface->external.height, surface->external.depth);
+
+				evictions++;
+			}
+
+			surface->resource->unlock();
+		}
 	}
 
+	#if defined(__i386__) || defined(__x86_64__)
+		// Fills 64-byte blocks of 32-byte aligned memory with half as many non-temporal stores as SSE
+		AVX_FUNCTION static void streamFillAVX(float *pointer, int pattern, int qxwords)
+		{
+			__m256 octo = _mm256_set1_ps((float&)pattern);
+
+			while(qxwords--)
+			{
+				_mm256_stream_ps(pointer + 0, octo);
+				_mm256_stream_ps(pointer + 8, octo);
+
+				pointer += 16;
+			}
+
+			_mm256_zeroupper();   // Avoids SSE transition penalties in the caller
+		}
+	#endif
+
 	void Surface::memfill4(void *buffer, int pattern, int bytes)
 	{
 		while((size_t)buffer & 0x1 && bytes >= 1)
@@ -3258,6 +4062,22 @@ namespace sw
 
 				__m128 quad = _mm_set_ps1((float&)pattern);
 
+				if(CPUID::supportsAVX() && bytes >= 16)
+				{
+					if((size_t)buffer & 0x10)
+					{
+						_mm_store_ps((float*)buffer, quad);
+						(float*&)buffer += 4;
+						bytes -= 16;
+					}
+
+					int qxwords = bytes / 64;
+					bytes -= qxwords * 64;
+
+					streamFillAVX((float*)buffer, pattern, qxwords);
+					(float*&)buffer += qxwords * 16;
+				}
+
 				float *pointer = (float*)buffer;
 				int qxwords = bytes / 64;
 				bytes -= qxwords * 64;
@@ -3300,6 +4120,9 @@ namespace sw
 
 	void Surface::sync()
 	{
+		// Called by the most derived destructors, before a parent resource can be destroyed
+		untrack();
+
 		resource->lock(EXCLUSIVE);
 		resource->unlock();
 	}
@@ -3341,6 +4164,33 @@ namespace sw
 		const bool entire = x0 == 0 && y0 == 0 && width == internal.width && height == internal.height;
 		const Lock lock = entire ? LOCK_DISCARD : LOCK_WRITEONLY;
 
+		if(entire && internal.depth == 1 && hasCoarseDepth())
+		{
+			// Only mark the tiles as cleared. The renderer fills each one when it first touches it,
+			// and any other access fills the remaining ones.
+			if(hasQuadLayout(internal.format) && complementaryDepthBuffer)
+			{
+				depth = 1 - depth;
+			}
+
+			lockInternal(0, 0, 0, LOCK_DISCARD, PUBLIC);
+
+			if(!coarseDepth)
+			{
+				coarseDepth = (float*)allocate(getCoarseDepthSliceP() * sizeof(float), 16, MEMORY_SURFACE);
+			}
+
+			const float cleared = -1.0f;   // Below any actual tile maximum
+			memfill4(coarseDepth, (int&)cleared, getCoarseDepthSliceP() * sizeof(float));
+			coarseDepthDirty = false;
+			depthClearPending = true;
+			depthClearValue = depth;
+
+			unlockInternal();
+
+			return;
+		}
+
 		int x1 = x0 + width;
 		int y1 = y0 + height;
 
@@ -3361,6 +4211,28 @@ namespace sw
 
 			unlockInternal();
 		}
+		else if(internal.format == FORMAT_D16)   // Quad layout
+		{
+			unsigned short value = unorm<16>(depth);
+			unsigned short *buffer = (unsigned short*)lockInternal(0, 0, 0, lock, PUBLIC);
+
+			for(int z = 0; z < internal.samples; z++)
+			{
+				for(int y = y0; y < y1; y++)
+				{
+					unsigned short *target = buffer + (y & ~1) * internal.pitchP + (y & 1) * 2;
+
+					for(int x = x0; x < x1; x++)
+					{
+						target[(x & ~1) * 2 + (x & 1)] = value;
+					}
+				}
+
+				buffer += internal.sliceP;
+			}
+
+			unlockInternal();
+		}
 		else   // Quad layout
 		{
 			if(complementaryDepthBuffer)
@@ -3714,6 +4586,11 @@ namespace sw
 		return renderTarget;
 	}
 
+	bool Surface::hasTiledLayout() const
+	{
+		return internal.tiled;
+	}
+
 	bool Surface::hasDirtyContents() const
 	{
 		return dirtyContents;
@@ -3741,7 +4618,70 @@ namespace sw
 		       external.samples == internal.samples;
 	}
 
-	Format Surface::selectInternalFormat(Format format) const
+	bool Surface::isTileable() const
+	{
+		// Memory we don't own can change behind our back, leaving a tiled copy stale
+		return tiledTextureLayout &&
+		       ownExternal &&
+		       internal.depth == 1 &&
+		       internal.border == 0 &&
+		       internal.samples == 1 &&
+		       internal.bytes == 4 &&
+		       !isDepth(internal.format) &&
+		       !isStencil(internal.format) &&
+		       !hasQuadLayout(internal.format) &&
+		       !isCompressed(internal.format) &&
+		       internal.pitchP % 4 == 0 &&
+		       internal.pitchP < 0x2000 &&   // Tiled columns must fit in 16-bit sampler coordinates
+		       internal.height % 4 == 0;
+	}
+
+	void Surface::tile(Buffer &buffer, bool tiled)
+	{
+		if(buffer.tiled == tiled)
+		{
+			return;
+		}
+
+		// Each 4x4 tile occupies 16 consecutive texels and tiles are stored in row-major
+		// order, so a band of four rows keeps the footprint it has in the linear layout.
+		const int rowB = 4 * 4;
+		const int tileB = 4 * rowB;
+		const int tilesX = buffer.pitchP / 4;
+		const int tilesY = buffer.height / 4;
+		const size_t size = buffer.pitchB * buffer.height;
+
+		unsigned char *texels = (unsigned char*)buffer.buffer;
+		unsigned char *copy = (unsigned char*)allocate(size);
+		memcpy(copy, texels, size);
+
+		for(int ty = 0; ty < tilesY; ty++)
+		{
+			for(int tx = 0; tx < tilesX; tx++)
+			{
+				unsigned char *tile = (tiled ? texels : copy) + (ty * tilesX + tx) * tileB;
+				unsigned char *linear = (tiled ? copy : texels) + 4 * ty * buffer.pitchB + tx * rowB;
+
+				for(int row = 0; row < 4; row++)
+				{
+					if(tiled)
+					{
+						memcpy(tile + row * rowB, linear + row * buffer.pitchB, rowB);
+					}
+					else
+					{
+						memcpy(linear + row * buffer.pitchB, tile + row * rowB, rowB);
+					}
+				}
+			}
+		}
+
+		deallocate(copy);
+
+		buffer.tiled = tiled;
+	}
+
+	Format Surface::selectInternalFormat(Format format, int depth, int border) const
 	{
 		switch(format)
 		{
@@ -3855,13 +4795,16 @@ namespace sw
 		case FORMAT_X8B8G8R8:
 			return FORMAT_X8B8G8R8;
 		case FORMAT_SRGB8_X8:
-			return FORMAT_SRGB8_X8;
+			// Decoded once at upload, so sampling and filtering operate on linear values
+			return linearSRGBTextures ? FORMAT_A16B16G16R16 : FORMAT_SRGB8_X8;
 		case FORMAT_SRGB8_A8:
-			return FORMAT_SRGB8_A8;
+			return linearSRGBTextures ? FORMAT_A16B16G16R16 : FORMAT_SRGB8_A8;
 		// Compressed formats
 		case FORMAT_DXT1:
 		case FORMAT_DXT3:
 		case FORMAT_DXT5:
+			// Single layer textures without a border are sampled directly from the compressed data
+			return (compressedTextureSampling && depth == 1 && border == 0) ? format : FORMAT_A8R8G8B8;
 		case FORMAT_RGB8_PUNCHTHROUGH_ALPHA1_ETC2:
 		case FORMAT_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2:
 		case FORMAT_RGBA8_ETC2_EAC:
@@ -3945,6 +4888,10 @@ namespace sw
 		case FORMAT_A32L32F:        return FORMAT_A32B32G32R32F;
 		// Depth/stencil formats
 		case FORMAT_D16:
+			if(!hasParent && !complementaryDepthBuffer)
+			{
+				return FORMAT_D16;   // Native 16-bit storage halves the depth traffic
+			}
 		case FORMAT_D32:
 		case FORMAT_D24X8:
 			if(hasParent)   // Texture
@@ -4007,12 +4954,127 @@ namespace sw
 
 		ASSERT(internal.depth == 1);  // Unimplemented
 
+		const int minimumBandSamples = 256 * 1024;   // Smaller resolves are not worth starting threads for
+		const int maximumBands = 16;
+
 		void *source = internal.lockRect(0, 0, 0, LOCK_READWRITE);
 
-		int width = internal.width;
-		int height = internal.height;
-		int pitch = internal.pitchB;
-		int slice = internal.sliceB;
+		// Quads whose samples are all equal already hold their resolved color in the first sample
+		const unsigned char *uniform = (hasUniformSamples() && uniformSamples && !uniformSamplesDirty) ? uniformSamples : nullptr;
+
+		int rows = internal.height;
+		int bandCount = min(min((int)threadCount, maximumBands), min(internal.width * rows * internal.samples / minimumBandSamples, rows));
+
+		if(bandCount <= 1)
+		{
+			ResolveBand band;
+			band.buffer = internal;
+			band.source = source;
+			band.uniform = uniform;
+			band.uniformPitch = getUniformSamplesPitchP();
+
+			resolveBand(&band);
+
+			return;
+		}
+
+		// Each band resolves whole rows, in place and independently of the others
+		ResolveBand band[maximumBands];
+		Thread *thread[maximumBands];
+
+		for(int i = 0; i < bandCount; i++)
+		{
+			int y0 = (rows * i / bandCount) & ~1;   // Starts at a row of quads
+			int y1 = (i + 1 == bandCount) ? rows : (rows * (i + 1) / bandCount) & ~1;
+
+			band[i].buffer = internal;
+			band[i].buffer.height = y1 - y0;
+			band[i].source = (unsigned char*)source + y0 * internal.pitchB;
+			band[i].uniform = uniform ? uniform + (y0 / 2) * getUniformSamplesPitchP() : nullptr;
+			band[i].uniformPitch = getUniformSamplesPitchP();
+		}
+
+		for(int i = 1; i < bandCount; i++)
+		{
+			thread[i] = new Thread(resolveBand, &band[i]);
+		}
+
+		resolveBand(&band[0]);
+
+		for(int i = 1; i < bandCount; i++)
+		{
+			thread[i]->join();
+			delete thread[i];
+		}
+	}
+
+	void Surface::resolveBand(void *parameters)
+	{
+		ResolveBand *band = static_cast<ResolveBand*>(parameters);
+
+		if(!band->uniform)
+		{
+			resolveSamples(band->buffer, band->source);
+
+			return;
+		}
+
+		// Resolve the runs of eight-pixel blocks holding a quad with differing samples, row pair by row pair.
+		// Blocks keep the vectorized resolves aligned for every format.
+		const Buffer &buffer = band->buffer;
+		const int blockQuads = 4;
+		int blocks = (band->uniformPitch + blockQuads - 1) / blockQuads;
+
+		for(int y = 0; y < buffer.height; y += 2)
+		{
+			const unsigned char *quads = band->uniform + (y / 2) * band->uniformPitch;
+
+			for(int block = 0; block < blocks;)
+			{
+				if(uniformQuads(quads, block * blockQuads, min((block + 1) * blockQuads, band->uniformPitch)))
+				{
+					block++;
+					continue;
+				}
+
+				int first = block;
+
+				do
+				{
+					block++;
+				}
+				while(block < blocks && !uniformQuads(quads, block * blockQuads, min((block + 1) * blockQuads, band->uniformPitch)));
+
+				Buffer run;
+				run = buffer;
+				run.width = min(2 * blockQuads * block, buffer.width) - 2 * blockQuads * first;
+				run.height = min(2, buffer.height - y);
+
+				resolveSamples(run, (unsigned char*)band->source + y * buffer.pitchB + 2 * blockQuads * first * bytes(buffer.format));
+			}
+		}
+	}
+
+	bool Surface::uniformQuads(const unsigned char *quads, int x0, int x1)
+	{
+		for(int i = x0; i < x1; i++)
+		{
+			if(!quads[i])
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void Surface::resolveSamples(const Buffer &buffer, void *source)
+	{
+
+		int width = buffer.width;
+		int height = buffer.height;
+		int pitch = buffer.pitchB;
+		int slice = buffer.sliceB;
 
 		unsigned char *source0 = (unsigned char*)source;
 		unsigned char *source1 = source0 + slice;
@@ -4031,14 +5093,14 @@ namespace sw
 		unsigned char *sourceE = sourceD + slice;
 		unsigned char *sourceF = sourceE + slice;
 
-		if(internal.format == FORMAT_X8R8G8B8 || internal.format == FORMAT_A8R8G8B8 ||
-		   internal.format == FORMAT_X8B8G8R8 || internal.format == FORMAT_A8B8G8R8 ||
-		   internal.format == FORMAT_SRGB8_X8 || internal.format == FORMAT_SRGB8_A8)
+		if(buffer.format == FORMAT_X8R8G8B8 || buffer.format == FORMAT_A8R8G8B8 ||
+		   buffer.format == FORMAT_X8B8G8R8 || buffer.format == FORMAT_A8B8G8R8 ||
+		   buffer.format == FORMAT_SRGB8_X8 || buffer.format == FORMAT_SRGB8_A8)
 		{
 			#if defined(__i386__) || defined(__x86_64__)
 				if(CPUID::supportsSSE2() && (width % 4) == 0)
 				{
-					if(internal.samples == 2)
+					if(buffer.samples == 2)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -4056,7 +5118,7 @@ namespace sw
 							source1 += pitch;
 						}
 					}
-					else if(internal.samples == 4)
+					else if(buffer.samples == 4)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -4080,7 +5142,7 @@ namespace sw
 							source3 += pitch;
 						}
 					}
-					else if(internal.samples == 8)
+					else if(buffer.samples == 8)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -4116,7 +5178,7 @@ namespace sw
 							source7 += pitch;
 						}
 					}
-					else if(internal.samples == 16)
+					else if(buffer.samples == 16)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -4183,7 +5245,7 @@ namespace sw
 			{
 				#define AVERAGE(x, y) (((x) & (y)) + ((((x) ^ (y)) >> 1) & 0x7F7F7F7F) + (((x) ^ (y)) & 0x01010101))
 
-				if(internal.samples == 2)
+				if(buffer.samples == 2)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -4201,7 +5263,7 @@ namespace sw
 						source1 += pitch;
 					}
 				}
-				else if(internal.samples == 4)
+				else if(buffer.samples == 4)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -4225,7 +5287,7 @@ namespace sw
 						source3 += pitch;
 					}
 				}
-				else if(internal.samples == 8)
+				else if(buffer.samples == 8)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -4261,7 +5323,7 @@ namespace sw
 						source7 += pitch;
 					}
 				}
-				else if(internal.samples == 16)
+				else if(buffer.samples == 16)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -4326,13 +5388,13 @@ namespace sw
 				#undef AVERAGE
 			}
 		}
-		else if(internal.format == FORMAT_G16R16)
+		else if(buffer.format == FORMAT_G16R16)
 		{
 
 			#if defined(__i386__) || defined(__x86_64__)
 				if(CPUID::supportsSSE2() && (width % 4) == 0)
 				{
-					if(internal.samples == 2)
+					if(buffer.samples == 2)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -4350,7 +5412,7 @@ namespace sw
 							source1 += pitch;
 						}
 					}
-					else if(internal.samples == 4)
+					else if(buffer.samples == 4)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -4374,7 +5436,7 @@ namespace sw
 							source3 += pitch;
 						}
 					}
-					else if(internal.samples == 8)
+					else if(buffer.samples == 8)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -4410,7 +5472,7 @@ namespace sw
 							source7 += pitch;
 						}
 					}
-					else if(internal.samples == 16)
+					else if(buffer.samples == 16)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -4477,7 +5539,7 @@ namespace sw
 			{
 				#define AVERAGE(x, y) (((x) & (y)) + ((((x) ^ (y)) >> 1) & 0x7FFF7FFF) + (((x) ^ (y)) & 0x00010001))
 
-				if(internal.samples == 2)
+				if(buffer.samples == 2)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -4495,7 +5557,7 @@ namespace sw
 						source1 += pitch;
 					}
 				}
-				else if(internal.samples == 4)
+				else if(buffer.samples == 4)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -4519,7 +5581,7 @@ namespace sw
 						source3 += pitch;
 					}
 				}
-				else if(internal.samples == 8)
+				else if(buffer.samples == 8)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -4555,7 +5617,7 @@ namespace sw
 						source7 += pitch;
 					}
 				}
-				else if(internal.samples == 16)
+				else if(buffer.samples == 16)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -4620,12 +5682,12 @@ namespace sw
 				#undef AVERAGE
 			}
 		}
-		else if(internal.format == FORMAT_A16B16G16R16)
+		else if(buffer.format == FORMAT_A16B16G16R16)
 		{
 			#if defined(__i386__) || defined(__x86_64__)
 				if(CPUID::supportsSSE2() && (width % 2) == 0)
 				{
-					if(internal.samples == 2)
+					if(buffer.samples == 2)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -4643,7 +5705,7 @@ namespace sw
 							source1 += pitch;
 						}
 					}
-					else if(internal.samples == 4)
+					else if(buffer.samples == 4)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -4667,7 +5729,7 @@ namespace sw
 							source3 += pitch;
 						}
 					}
-					else if(internal.samples == 8)
+					else if(buffer.samples == 8)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -4703,7 +5765,7 @@ namespace sw
 							source7 += pitch;
 						}
 					}
-					else if(internal.samples == 16)
+					else if(buffer.samples == 16)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -4770,7 +5832,7 @@ namespace sw
 			{
 				#define AVERAGE(x, y) (((x) & (y)) + ((((x) ^ (y)) >> 1) & 0x7FFF7FFF) + (((x) ^ (y)) & 0x00010001))
 
-				if(internal.samples == 2)
+				if(buffer.samples == 2)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -4788,7 +5850,7 @@ namespace sw
 						source1 += pitch;
 					}
 				}
-				else if(internal.samples == 4)
+				else if(buffer.samples == 4)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -4812,7 +5874,7 @@ namespace sw
 						source3 += pitch;
 					}
 				}
-				else if(internal.samples == 8)
+				else if(buffer.samples == 8)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -4848,7 +5910,7 @@ namespace sw
 						source7 += pitch;
 					}
 				}
-				else if(internal.samples == 16)
+				else if(buffer.samples == 16)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -4913,12 +5975,12 @@ namespace sw
 				#undef AVERAGE
 			}
 		}
-		else if(internal.format == FORMAT_R32F)
+		else if(buffer.format == FORMAT_R32F)
 		{
 			#if defined(__i386__) || defined(__x86_64__)
 				if(CPUID::supportsSSE() && (width % 4) == 0)
 				{
-					if(internal.samples == 2)
+					if(buffer.samples == 2)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -4937,7 +5999,7 @@ namespace sw
 							source1 += pitch;
 						}
 					}
-					else if(internal.samples == 4)
+					else if(buffer.samples == 4)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -4962,7 +6024,7 @@ namespace sw
 							source3 += pitch;
 						}
 					}
-					else if(internal.samples == 8)
+					else if(buffer.samples == 8)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -4999,7 +6061,7 @@ namespace sw
 							source7 += pitch;
 						}
 					}
-					else if(internal.samples == 16)
+					else if(buffer.samples == 16)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -5065,7 +6127,7 @@ namespace sw
 				else
 			#endif
 			{
-				if(internal.samples == 2)
+				if(buffer.samples == 2)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -5084,7 +6146,7 @@ namespace sw
 						source1 += pitch;
 					}
 				}
-				else if(internal.samples == 4)
+				else if(buffer.samples == 4)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -5109,7 +6171,7 @@ namespace sw
 						source3 += pitch;
 					}
 				}
-				else if(internal.samples == 8)
+				else if(buffer.samples == 8)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -5146,7 +6208,7 @@ namespace sw
 						source7 += pitch;
 					}
 				}
-				else if(internal.samples == 16)
+				else if(buffer.samples == 16)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -5210,12 +6272,12 @@ namespace sw
 				else ASSERT(false);
 			}
 		}
-		else if(internal.format == FORMAT_G32R32F)
+		else if(buffer.format == FORMAT_G32R32F)
 		{
 			#if defined(__i386__) || defined(__x86_64__)
 				if(CPUID::supportsSSE() && (width % 2) == 0)
 				{
-					if(internal.samples == 2)
+					if(buffer.samples == 2)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -5234,7 +6296,7 @@ namespace sw
 							source1 += pitch;
 						}
 					}
-					else if(internal.samples == 4)
+					else if(buffer.samples == 4)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -5259,7 +6321,7 @@ namespace sw
 							source3 += pitch;
 						}
 					}
-					else if(internal.samples == 8)
+					else if(buffer.samples == 8)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -5296,7 +6358,7 @@ namespace sw
 							source7 += pitch;
 						}
 					}
-					else if(internal.samples == 16)
+					else if(buffer.samples == 16)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -5362,7 +6424,7 @@ namespace sw
 				else
 			#endif
 			{
-				if(internal.samples == 2)
+				if(buffer.samples == 2)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -5381,7 +6443,7 @@ namespace sw
 						source1 += pitch;
 					}
 				}
-				else if(internal.samples == 4)
+				else if(buffer.samples == 4)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -5406,7 +6468,7 @@ namespace sw
 						source3 += pitch;
 					}
 				}
-				else if(internal.samples == 8)
+				else if(buffer.samples == 8)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -5443,7 +6505,7 @@ namespace sw
 						source7 += pitch;
 					}
 				}
-				else if(internal.samples == 16)
+				else if(buffer.samples == 16)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -5507,14 +6569,14 @@ namespace sw
 				else ASSERT(false);
 			}
 		}
-		else if(internal.format == FORMAT_A32B32G32R32F ||
-		        internal.format == FORMAT_X32B32G32R32F ||
-		        internal.format == FORMAT_X32B32G32R32F_UNSIGNED)
+		else if(buffer.format == FORMAT_A32B32G32R32F ||
+		        buffer.format == FORMAT_X32B32G32R32F ||
+		        buffer.format == FORMAT_X32B32G32R32F_UNSIGNED)
 		{
 			#if defined(__i386__) || defined(__x86_64__)
 				if(CPUID::supportsSSE())
 				{
-					if(internal.samples == 2)
+					if(buffer.samples == 2)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -5533,7 +6595,7 @@ namespace sw
 							source1 += pitch;
 						}
 					}
-					else if(internal.samples == 4)
+					else if(buffer.samples == 4)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -5558,7 +6620,7 @@ namespace sw
 							source3 += pitch;
 						}
 					}
-					else if(internal.samples == 8)
+					else if(buffer.samples == 8)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -5595,7 +6657,7 @@ namespace sw
 							source7 += pitch;
 						}
 					}
-					else if(internal.samples == 16)
+					else if(buffer.samples == 16)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -5661,7 +6723,7 @@ namespace sw
 				else
 			#endif
 			{
-				if(internal.samples == 2)
+				if(buffer.samples == 2)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -5680,7 +6742,7 @@ namespace sw
 						source1 += pitch;
 					}
 				}
-				else if(internal.samples == 4)
+				else if(buffer.samples == 4)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -5705,7 +6767,7 @@ namespace sw
 						source3 += pitch;
 					}
 				}
-				else if(internal.samples == 8)
+				else if(buffer.samples == 8)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -5742,7 +6804,7 @@ namespace sw
 						source7 += pitch;
 					}
 				}
-				else if(internal.samples == 16)
+				else if(buffer.samples == 16)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -5806,12 +6868,12 @@ namespace sw
 				else ASSERT(false);
 			}
 		}
-		else if(internal.format == FORMAT_R5G6B5)
+		else if(buffer.format == FORMAT_R5G6B5)
 		{
 			#if defined(__i386__) || defined(__x86_64__)
 				if(CPUID::supportsSSE2() && (width % 8) == 0)
 				{
-					if(internal.samples == 2)
+					if(buffer.samples == 2)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -5840,7 +6902,7 @@ namespace sw
 							source1 += pitch;
 						}
 					}
-					else if(internal.samples == 4)
+					else if(buffer.samples == 4)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -5881,7 +6943,7 @@ namespace sw
 							source3 += pitch;
 						}
 					}
-					else if(internal.samples == 8)
+					else if(buffer.samples == 8)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -5946,7 +7008,7 @@ namespace sw
 							source7 += pitch;
 						}
 					}
-					else if(internal.samples == 16)
+					else if(buffer.samples == 16)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -6066,7 +7128,7 @@ namespace sw
 			{
 				#define AVERAGE(x, y) (((x) & (y)) + ((((x) ^ (y)) >> 1) & 0x7BEF) + (((x) ^ (y)) & 0x0821))
 
-				if(internal.samples == 2)
+				if(buffer.samples == 2)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -6084,7 +7146,7 @@ namespace sw
 						source1 += pitch;
 					}
 				}
-				else if(internal.samples == 4)
+				else if(buffer.samples == 4)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -6108,7 +7170,7 @@ namespace sw
 						source3 += pitch;
 					}
 				}
-				else if(internal.samples == 8)
+				else if(buffer.samples == 8)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -6144,7 +7206,7 @@ namespace sw
 						source7 += pitch;
 					}
 				}
-				else if(internal.samples == 16)
+				else if(buffer.samples == 16)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -255,8 +255,12 @@ namespace sw
 			Color<float> sample(float x, float y, int layer) const;
 
 			void *lockRect(int x, int y, int z, Lock lock);
+			void *lockRect(int x, int y, int z, int width, int height, int depth, Lock lock);   // Writes are limited to the given region
 			void unlockRect();
 
+			void *address(int x, int y, int z) const;
+			void markDirty(int x0, int y0, int z0, int x1, int y1, int z1);
+
 			void *buffer;
 			int width;
 			int height;
@@ -274,6 +278,11 @@ namespace sw
 			AtomicInt lock;
 
 			bool dirty;   // Sibling internal/external buffer doesn't match.
+			bool tiled;   // Texels are stored in 4x4 tiles, only understood by the sampler.
+
+			// Bounds of the modified texels while dirty, lower inclusive, upper exclusive
+			int dirtyX0, dirtyY0, dirtyZ0;
+			int dirtyX1, dirtyY1, dirtyZ1;
 		};
 
 	protected:
@@ -299,6 +308,7 @@ namespace sw
 		inline int getSliceP(bool internal = false) const;
 
 		void *lockExternal(int x, int y, int z, Lock lock, Accessor client);
+		void *lockExternal(int x, int y, int z, int width, int height, int depth, Lock lock, Accessor client);
 		void unlockExternal();
 		inline Format getExternalFormat() const;
 		inline int getExternalPitchB() const;
@@ -320,7 +330,22 @@ namespace sw
 		inline int getStencilPitchB() const;
 		inline int getStencilSliceB() const;
 
-		void sync();                      // Wait for lock(s) to be released.
+		enum { COARSE_TILE_WIDTH = 16, COARSE_TILE_HEIGHT = 2 };   // Pixels covered by each coarse depth value
+
+		inline bool hasCoarseDepth() const;
+		float *lockCoarseDepth(int z);   // Maximum depth per tile, maintained by the renderer while drawing
+		inline int getCoarseDepthPitchP() const;
+		inline int getCoarseDepthSliceP() const;
+		inline float getDepthClearValue() const;
+		void flushDepthClear();   // Apply a deferred depth clear to the tiles the renderer hasn't touched
+
+		inline bool hasUniformSamples() const;
+		unsigned char *lockUniformSamples(int z);   // Nonzero per 2x2 quad whose pixels each have equal samples, maintained by the renderer while drawing
+		void setUniformSamples(const Rect &rect);   // After writing every sample of the rectangle alike
+		inline int getUniformSamplesPitchP() const;
+		inline int getUniformSamplesSliceP() const;
+
+		void sync();                      // Wait for lock(s) to be released. Also withdraws the surface from eviction.
 		virtual bool requiresSync() const { return false; }
 		inline bool isUnlocked() const;   // Only reliable after sync().
 
@@ -352,6 +377,7 @@ namespace sw
 		bool hasDepth() const;
 		bool hasPalette() const;
 		bool isRenderTarget() const;
+		bool hasTiledLayout() const;
 
 		bool hasDirtyContents() const;
 		void markContentsClean();
@@ -364,6 +390,10 @@ namespace sw
 		static int sliceB(int width, int height, int border, Format format, bool target);
 		static int sliceP(int width, int height, int border, Format format, bool target);
 		static size_t size(int width, int height, int depth, int border, int samples, Format format);
+		static size_t memoryUsage();   // Bytes of surface buffers currently allocated
+		static void setMemoryBudget(size_t bytes);   // Idle copies which can be recreated get evicted above it, 0 for no limit
+		static size_t getMemoryBudget();
+		static unsigned int evictionCount();
 
 		static bool isStencil(Format format);
 		static bool isDepth(Format format);
@@ -466,6 +496,7 @@ namespace sw
 		};
 
 		static void decodeR8G8B8(Buffer &destination, Buffer &source);
+		static void decodeSRGB8(Buffer &destination, Buffer &source);
 		static void decodeX1R5G5B5(Buffer &destination, Buffer &source);
 		static void decodeA1R5G5B5(Buffer &destination, Buffer &source);
 		static void decodeX4R4G4B4(Buffer &destination, Buffer &source);
@@ -481,15 +512,44 @@ namespace sw
 		static void decodeETC2(Buffer &internal, Buffer &external, int nbAlphaBits, bool isSRGB);
 		static void decodeASTC(Buffer &internal, Buffer &external, int xSize, int ySize, int zSize, bool isSRGB);
 
+		struct DecodeBand
+		{
+			Buffer destination;
+			Buffer source;
+		};
+
+		struct ResolveBand
+		{
+			Buffer buffer;
+			void *source;
+			const unsigned char *uniform;   // Uniform samples of the band's quads, nullptr to resolve all of them
+			int uniformPitch;
+		};
+
 		static void update(Buffer &destination, Buffer &source);
+		static void updateRegion(Buffer &destination, Buffer &source);
+		static void decode(Buffer &destination, Buffer &source);
+		static void decodeParallel(Buffer &destination, Buffer &source);
+		static void decodeBand(void *parameters);
 		static void genericUpdate(Buffer &destination, Buffer &source);
 		static void *allocateBuffer(int width, int height, int depth, int border, int samples, Format format);
 		static void memfill4(void *buffer, int pattern, int bytes);
 
 		bool identicalBuffers() const;
-		Format selectInternalFormat(Format format) const;
+		bool isTileable() const;
+		static void tile(Buffer &buffer, bool tiled);
+		Format selectInternalFormat(Format format, int depth, int border) const;
 
 		void resolve();
+		static void resolveBand(void *parameters);
+		static bool uniformQuads(const unsigned char *quads, int x0, int x1);
+		static void resolveSamples(const Buffer &buffer, void *source);
+
+		void track();
+		void untrack();
+		bool isEvictable() const;
+		bool isExternalEvictable() const;
+		static void evictIdleBuffers();
 
 		Buffer external;
 		Buffer internal;
@@ -498,6 +558,16 @@ namespace sw
 		const bool lockable;
 		const bool renderTarget;
 
+		void clearDepthTiles();
+
+		float *coarseDepth;
+		bool coarseDepthDirty;   // Coarse depth must be reset before use.
+		bool depthClearPending;   // Negative coarse depth tiles still have to be filled with depthClearValue.
+		float depthClearValue;
+
+		unsigned char *uniformSamples;
+		bool uniformSamplesDirty;   // Uniform samples must be reset before use.
+
 		bool dirtyContents;   // Sibling surfaces need updating (mipmaps / cube borders).
 		unsigned int paletteUsed;
 
@@ -506,6 +576,9 @@ namespace sw
 
 		bool hasParent;
 		bool ownExternal;
+
+		std::atomic<int64_t> lastAccess;           // Timer::counter() of the last internal lock, to find idle surfaces
+		std::atomic<int64_t> lastExternalAccess;   // Timer::counter() of the last external lock
 	};
 }
 
@@ -649,6 +722,43 @@ namespace sw
 		return internal.samples > 4 ? internal.samples / 4 : 1;
 	}
 
+	bool Surface::hasCoarseDepth() const
+	{
+		return isDepth(internal.format) && internal.format != FORMAT_D16 && internal.samples == 1;   // Tiles store float maxima
+	}
+
+	int Surface::getCoarseDepthPitchP() const
+	{
+		return (internal.width + COARSE_TILE_WIDTH - 1) / COARSE_TILE_WIDTH;
+	}
+
+	int Surface::getCoarseDepthSliceP() const
+	{
+		return getCoarseDepthPitchP() * ((internal.height + COARSE_TILE_HEIGHT - 1) / COARSE_TILE_HEIGHT);
+	}
+
+	float Surface::getDepthClearValue() const
+	{
+		return depthClearValue;
+	}
+
+	bool Surface::hasUniformSamples() const
+	{
+		// Samples beyond the fourth are drawn by separate passes, which only see their own coverage
+		return internal.samples > 1 && internal.samples <= 4 && internal.format != FORMAT_NULL &&
+		       !isDepth(internal.format) && !isStencil(internal.format) && !hasQuadLayout(internal.format);
+	}
+
+	int Surface::getUniformSamplesPitchP() const
+	{
+		return (internal.width + 1) / 2;
+	}
+
+	int Surface::getUniformSamplesSliceP() const
+	{
+		return getUniformSamplesPitchP() * ((internal.height + 1) / 2);
+	}
+
 	bool Surface::isUnlocked() const
 	{
 		return external.lock == LOCK_UNLOCKED &&
@@ -130,86 +130,118 @@ namespace sw
 		uniforms.luminanceOffset4[0] = uniforms.luminanceOffset4[1] = uniforms.luminanceOffset4[2] = uniforms.luminanceOffset4[3] = offset;
 	}
 
-	void TextureStage::setTexCoordIndex(unsigned int texCoordIndex)
+	bool TextureStage::setTexCoordIndex(unsigned int texCoordIndex)
 	{
 		ASSERT(texCoordIndex < 8);
 
+		bool modified = (this->texCoordIndex != (int)texCoordIndex);
 		this->texCoordIndex = texCoordIndex;
+		return modified;
 	}
 
-	void TextureStage::setStageOperation(StageOperation stageOperation)
+	bool TextureStage::setStageOperation(StageOperation stageOperation)
 	{
+		bool modified = (this->stageOperation != stageOperation);
 		this->stageOperation = stageOperation;
+		return modified;
 	}
 
-	void TextureStage::setFirstArgument(SourceArgument firstArgument)
+	bool TextureStage::setFirstArgument(SourceArgument firstArgument)
 	{
+		bool modified = (this->firstArgument != firstArgument);
 		this->firstArgument = firstArgument;
+		return modified;
 	}
 
-	void TextureStage::setSecondArgument(SourceArgument secondArgument)
+	bool TextureStage::setSecondArgument(SourceArgument secondArgument)
 	{
+		bool modified = (this->secondArgument != secondArgument);
 		this->secondArgument = secondArgument;
+		return modified;
 	}
 
-	void TextureStage::setThirdArgument(SourceArgument thirdArgument)
+	bool TextureStage::setThirdArgument(SourceArgument thirdArgument)
 	{
+		bool modified = (this->thirdArgument != thirdArgument);
 		this->thirdArgument = thirdArgument;
+		return modified;
 	}
 
-	void TextureStage::setStageOperationAlpha(StageOperation stageOperationAlpha)
+	bool TextureStage::setStageOperationAlpha(StageOperation stageOperationAlpha)
 	{
+		bool modified = (this->stageOperationAlpha != stageOperationAlpha);
 		this->stageOperationAlpha = stageOperationAlpha;
+		return modified;
 	}
 
-	void TextureStage::setFirstArgumentAlpha(SourceArgument firstArgumentAlpha)
+	bool TextureStage::setFirstArgumentAlpha(SourceArgument firstArgumentAlpha)
 	{
+		bool modified = (this->firstArgumentAlpha != firstArgumentAlpha);
 		this->firstArgumentAlpha = firstArgumentAlpha;
+		return modified;
 	}
 
-	void TextureStage::setSecondArgumentAlpha(SourceArgument secondArgumentAlpha)
+	bool TextureStage::setSecondArgumentAlpha(SourceArgument secondArgumentAlpha)
 	{
+		bool modified = (this->secondArgumentAlpha != secondArgumentAlpha);
 		this->secondArgumentAlpha = secondArgumentAlpha;
+		return modified;
 	}
 
-	void TextureStage::setThirdArgumentAlpha(SourceArgument thirdArgumentAlpha)
+	bool TextureStage::setThirdArgumentAlpha(SourceArgument thirdArgumentAlpha)
 	{
-		this->thirdArgumentAlpha= thirdArgumentAlpha;
+		bool modified = (this->thirdArgumentAlpha != thirdArgumentAlpha);
+		this->thirdArgumentAlpha = thirdArgumentAlpha;
+		return modified;
 	}
 
-	void TextureStage::setFirstModifier(ArgumentModifier firstModifier)
+	bool TextureStage::setFirstModifier(ArgumentModifier firstModifier)
 	{
+		bool modified = (this->firstModifier != firstModifier);
 		this->firstModifier = firstModifier;
+		return modified;
 	}
 
-	void TextureStage::setSecondModifier(ArgumentModifier secondModifier)
+	bool TextureStage::setSecondModifier(ArgumentModifier secondModifier)
 	{
+		bool modified = (this->secondModifier != secondModifier);
 		this->secondModifier = secondModifier;
+		return modified;
 	}
 
-	void TextureStage::setThirdModifier(ArgumentModifier thirdModifier)
+	bool TextureStage::setThirdModifier(ArgumentModifier thirdModifier)
 	{
+		bool modified = (this->thirdModifier != thirdModifier);
 		this->thirdModifier = thirdModifier;
+		return modified;
 	}
 
-	void TextureStage::setFirstModifierAlpha(ArgumentModifier firstModifierAlpha)
+	bool TextureStage::setFirstModifierAlpha(ArgumentModifier firstModifierAlpha)
 	{
+		bool modified = (this->firstModifierAlpha != firstModifierAlpha);
 		this->firstModifierAlpha = firstModifierAlpha;
+		return modified;
 	}
 
-	void TextureStage::setSecondModifierAlpha(ArgumentModifier secondModifierAlpha)
+	bool TextureStage::setSecondModifierAlpha(ArgumentModifier secondModifierAlpha)
 	{
+		bool modified = (this->secondModifierAlpha != secondModifierAlpha);
 		this->secondModifierAlpha = secondModifierAlpha;
+		return modified;
 	}
 
-	void TextureStage::setThirdModifierAlpha(ArgumentModifier thirdModifierAlpha)
+	bool TextureStage::setThirdModifierAlpha(ArgumentModifier thirdModifierAlpha)
 	{
+		bool modified = (this->thirdModifierAlpha != thirdModifierAlpha);
 		this->thirdModifierAlpha = thirdModifierAlpha;
+		return modified;
 	}
 
-	void TextureStage::setDestinationArgument(DestinationArgument destinationArgument)
+	bool TextureStage::setDestinationArgument(DestinationArgument destinationArgument)
 	{
+		bool modified = (this->destinationArgument != destinationArgument);
 		this->destinationArgument = destinationArgument;
+		return modified;
 	}
 
 	bool TextureStage::usesColor(SourceArgument source) const
@@ -141,22 +141,23 @@ namespace sw
 		void setLuminanceScale(float value);
 		void setLuminanceOffset(float value);
 
-		void setTexCoordIndex(unsigned int texCoordIndex);
-		void setStageOperation(StageOperation stageOperation);
-		void setFirstArgument(SourceArgument firstArgument);
-		void setSecondArgument(SourceArgument secondArgument);
-		void setThirdArgument(SourceArgument thirdArgument);
-		void setStageOperationAlpha(StageOperation stageOperationAlpha);
-		void setFirstArgumentAlpha(SourceArgument firstArgumentAlpha);
-		void setSecondArgumentAlpha(SourceArgument secondArgumentAlpha);
-		void setThirdArgumentAlpha(SourceArgument thirdArgumentAlpha);
-		void setFirstModifier(ArgumentModifier firstModifier);
-		void setSecondModifier(ArgumentModifier secondModifier);
-		void setThirdModifier(ArgumentModifier thirdModifier);
-		void setFirstModifierAlpha(ArgumentModifier firstModifierAlpha);
-		void setSecondModifierAlpha(ArgumentModifier secondModifierAlpha);
-		void setThirdModifierAlpha(ArgumentModifier thirdModifierAlpha);
-		void setDestinationArgument(DestinationArgument destinationArgument);
+		// Set texture stage states, return true when modified
+		bool setTexCoordIndex(unsigned int texCoordIndex);
+		bool setStageOperation(StageOperation stageOperation);
+		bool setFirstArgument(SourceArgument firstArgument);
+		bool setSecondArgument(SourceArgument secondArgument);
+		bool setThirdArgument(SourceArgument thirdArgument);
+		bool setStageOperationAlpha(StageOperation stageOperationAlpha);
+		bool setFirstArgumentAlpha(SourceArgument firstArgumentAlpha);
+		bool setSecondArgumentAlpha(SourceArgument secondArgumentAlpha);
+		bool setThirdArgumentAlpha(SourceArgument thirdArgumentAlpha);
+		bool setFirstModifier(ArgumentModifier firstModifier);
+		bool setSecondModifier(ArgumentModifier secondModifier);
+		bool setThirdModifier(ArgumentModifier thirdModifier);
+		bool setFirstModifierAlpha(ArgumentModifier firstModifierAlpha);
+		bool setSecondModifierAlpha(ArgumentModifier secondModifierAlpha);
+		bool setThirdModifierAlpha(ArgumentModifier thirdModifierAlpha);
+		bool setDestinationArgument(DestinationArgument destinationArgument);
 
 		Uniforms uniforms;   // FIXME: Private
 
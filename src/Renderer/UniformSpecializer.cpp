@@ -0,0 +1,156 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "UniformSpecializer.hpp"
+
+#include "Shader/Shader.hpp"
+
+#include <string.h>
+
+namespace sw
+{
+	static uint64_t hash(uint64_t seed, const void *data, size_t size)
+	{
+		const unsigned char *bytes = static_cast<const unsigned char*>(data);
+		uint64_t h = seed;
+
+		for(size_t i = 0; i < size; i++)
+		{
+			h = (h ^ bytes[i]) * 0x100000001B3ull;   // FNV-1a
+		}
+
+		return h;
+	}
+
+	UniformSpecializer::UniformSpecializer() : threshold(0), nextKey(1)
+	{
+	}
+
+	void UniformSpecializer::setThreshold(int draws)
+	{
+		threshold = draws;
+
+		valueSets.clear();   // Keys keep increasing, routines specialized before stay unique
+		variants.clear();
+	}
+
+	uint64_t UniformSpecializer::key(const Shader *shader, const float4 *uniforms)
+	{
+		const std::vector<unsigned int> &constants = shader->getBranchConstants();
+
+		if(threshold <= 0 || constants.empty())
+		{
+			return 0;
+		}
+
+		uint64_t contentID = shader->getContentID();
+		uint64_t h = contentID ^ 0xCBF29CE484222325ull;
+
+		for(unsigned int index : constants)
+		{
+			h = hash(h, &uniforms[index], sizeof(float4));
+		}
+
+		ValueSet *valueSet = nullptr;
+		auto range = valueSets.equal_range(h);
+
+		for(auto candidate = range.first; candidate != range.second && !valueSet; ++candidate)
+		{
+			if(candidate->second.contentID != contentID || candidate->second.values.size() != constants.size())
+			{
+				continue;
+			}
+
+			bool equal = true;
+
+			for(size_t i = 0; i < constants.size() && equal; i++)
+			{
+				equal = memcmp(&candidate->second.values[i], &uniforms[constants[i]], sizeof(float4)) == 0;
+			}
+
+			if(equal)
+			{
+				valueSet = &candidate->second;
+			}
+		}
+
+		if(!valueSet)
+		{
+			if(valueSets.size() >= MAX_TRACKED)
+			{
+				valueSets.clear();
+			}
+
+			ValueSet values = {contentID, {}, nextKey++, 0};   // 0 denotes generic routines
+
+			for(unsigned int index : constants)
+			{
+				values.values.push_back(uniforms[index]);
+			}
+
+			valueSet = &valueSets.insert({h, values})->second;
+		}
+
+		if(valueSet->draws < threshold)
+		{
+			if(++valueSet->draws < threshold)
+			{
+				return 0;
+			}
+
+			int &shaderVariants = variants[contentID];
+
+			if(shaderVariants == MAX_VARIANTS)   // Values keep changing, don't compile more routines
+			{
+				valueSet->draws = 0;
+				return 0;
+			}
+
+			shaderVariants++;
+		}
+
+		return valueSet->key;
+	}
+
+	void UniformSpecializer::fold(Shader &shader, const float4 *uniforms)
+	{
+		const std::vector<unsigned int> &constants = shader.getBranchConstants();
+
+		for(unsigned int index : constants)
+		{
+			Shader::Instruction *def = new Shader::Instruction(Shader::OPCODE_DEF);
+
+			def->dst.type = Shader::PARAMETER_CONST;
+			def->dst.index = index;
+			def->src[0].type = Shader::PARAMETER_FLOAT4LITERAL;
+
+			for(int i = 0; i < 4; i++)
+			{
+				def->src[0].value[i] = uniforms[index][i];
+			}
+
+			shader.append(def);
+		}
+	}
+
+	void UniformSpecializer::capture(const Shader &shader, const float4 *uniforms, float4 *values)
+	{
+		const std::vector<unsigned int> &constants = shader.getBranchConstants();
+
+		for(size_t i = 0; i < constants.size(); i++)
+		{
+			values[i] = uniforms[constants[i]];
+		}
+	}
+}
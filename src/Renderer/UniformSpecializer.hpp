@@ -0,0 +1,72 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef sw_UniformSpecializer_hpp
+#define sw_UniformSpecializer_hpp
+
+#include "Common/Types.hpp"
+
+#include <unordered_map>
+#include <vector>
+
+namespace sw
+{
+	class Shader;
+
+	// Decides when to fold the uniforms controlling a shader's branches and
+	// loops into its routines as constants. A set of values qualifies once
+	// it has been used by threshold draws. Draws with other values keep using
+	// the generic routine, so the values act as the guard of the specialized
+	// routine.
+	class UniformSpecializer
+	{
+	public:
+		UniformSpecializer();
+
+		void setThreshold(int draws);   // 0 disables specialization
+		bool isEnabled() const { return threshold > 0; }
+
+		// Returns the specialization key of the current branch uniform values,
+		// or 0 while they don't qualify. Keys are never shared by different values.
+		uint64_t key(const Shader *shader, const float4 *uniforms);
+
+		// Appends definitions of the branch uniforms to a private copy of the shader
+		static void fold(Shader &shader, const float4 *uniforms);
+
+		// Copies the folded values into a routine state, so they guard the cached routine
+		static void capture(const Shader &shader, const float4 *uniforms, float4 *values);
+
+	private:
+		enum
+		{
+			MAX_VARIANTS = 4,        // Specialized routines per shader
+			MAX_TRACKED = 4096,      // Value sets being counted before starting over
+		};
+
+		struct ValueSet
+		{
+			uint64_t contentID;
+			std::vector<float4> values;   // Of the branch constants, in order
+			uint64_t key;
+			int draws;
+		};
+
+		int threshold;
+		uint64_t nextKey;
+		std::unordered_multimap<uint64_t, ValueSet> valueSets;   // Per hash of the content ID and values, compared in full
+		std::unordered_map<uint64_t, int> variants;              // Per shader content ID
+	};
+}
+
+#endif   // sw_UniformSpecializer_hpp
@@ -14,12 +14,15 @@
 
 #include "VertexProcessor.hpp"
 
+#include "RoutineStatistics.hpp"
 #include "Shader/VertexPipeline.hpp"
 #include "Shader/VertexProgram.hpp"
 #include "Shader/VertexShader.hpp"
 #include "Shader/PixelShader.hpp"
 #include "Shader/Constants.hpp"
 #include "Common/Math.hpp"
+#include "Common/Memory.hpp"
+#include "Common/Trace.hpp"
 #include "Common/Debug.hpp"
 
 #include <string.h>
@@ -28,9 +31,31 @@ namespace sw
 {
 	bool precacheVertex = false;
 
+	extern bool mediumPrecisionMath;
+
+	void VertexCache::initialize(int size)
+	{
+		size = ceilPow2(clamp(size, 16, 4096));
+
+		vertex = (Vertex*)allocate(size * sizeof(Vertex));
+		tag = (unsigned int*)allocate(size / 4 * sizeof(unsigned int));
+		mask = size - 1;
+
+		drawCall = -1;
+	}
+
+	void VertexCache::terminate()
+	{
+		deallocate(vertex);
+		deallocate(tag);
+
+		vertex = nullptr;
+		tag = nullptr;
+	}
+
 	void VertexCache::clear()
 	{
-		for(int i = 0; i < 16; i++)
+		for(unsigned int i = 0; i < (mask + 1) / 4; i++)
 		{
 			tag[i] = 0x80000000;
 		}
@@ -124,8 +149,11 @@ namespace sw
 
 	VertexProcessor::~VertexProcessor()
 	{
-		delete routineCache;
-		routineCache = 0;
+		if(routineCache)
+		{
+			routineCache->release();
+			routineCache = 0;
+		}
 	}
 
 	void VertexProcessor::setInputStream(int index, const Stream &stream)
@@ -140,7 +168,7 @@ namespace sw
 			context->input[i].defaults();
 		}
 
-		context->preTransformed = preTransformed;
+		context->setState(context->preTransformed, preTransformed);
 	}
 
 	void VertexProcessor::setFloatConstant(unsigned int index, const float value[4])
@@ -246,7 +274,7 @@ namespace sw
 	void VertexProcessor::setProjectionMatrix(const Matrix &P)
 	{
 		this->P = P;
-		context->wBasedFog = (P[3][0] != 0.0f) || (P[3][1] != 0.0f) || (P[3][2] != 0.0f) || (P[3][3] != 1.0f);
+		context->setState(context->wBasedFog, (P[3][0] != 0.0f) || (P[3][1] != 0.0f) || (P[3][2] != 0.0f) || (P[3][3] != 1.0f));
 
 		updateMatrix = true;
 		updateProjectionMatrix = true;
@@ -346,17 +374,12 @@ namespace sw
 
 	void VertexProcessor::setFogEnable(bool fogEnable)
 	{
-		context->fogEnable = fogEnable;
+		context->setState(context->fogEnable, fogEnable);
 	}
 
 	void VertexProcessor::setVertexFogMode(FogMode fogMode)
 	{
-		context->vertexFogMode = fogMode;
-	}
-
-	void VertexProcessor::setInstanceID(int instanceID)
-	{
-		context->instanceID = instanceID;
+		context->setState(context->vertexFogMode, fogMode);
 	}
 
 	void VertexProcessor::setColorVertexEnable(bool colorVertexEnable)
@@ -443,19 +466,19 @@ namespace sw
 
 	void VertexProcessor::setRangeFogEnable(bool enable)
 	{
-		context->rangeFogEnable = enable;
+		context->setState(context->rangeFogEnable, enable);
 	}
 
 	void VertexProcessor::setIndexedVertexBlendEnable(bool indexedVertexBlendEnable)
 	{
-		context->indexedVertexBlendEnable = indexedVertexBlendEnable;
+		context->setState(context->indexedVertexBlendEnable, indexedVertexBlendEnable);
 	}
 
 	void VertexProcessor::setVertexBlendMatrixCount(unsigned int vertexBlendMatrixCount)
 	{
 		if(vertexBlendMatrixCount <= 4)
 		{
-			context->vertexBlendMatrixCount = vertexBlendMatrixCount;
+			context->setState(context->vertexBlendMatrixCount, vertexBlendMatrixCount);
 		}
 		else ASSERT(false);
 	}
@@ -464,7 +487,7 @@ namespace sw
 	{
 		if(stage < TEXTURE_IMAGE_UNITS)
 		{
-			context->textureWrap[stage] = mask;
+			context->setState(context->textureWrap[stage], mask);
 		}
 		else ASSERT(false);
 
@@ -480,19 +503,19 @@ namespace sw
 	{
 		if(stage < 8)
 		{
-			context->texGen[stage] = texGen;
+			context->setState(context->texGen[stage], texGen);
 		}
 		else ASSERT(false);
 	}
 
 	void VertexProcessor::setLocalViewer(bool localViewer)
 	{
-		context->localViewer = localViewer;
+		context->setState(context->localViewer, localViewer);
 	}
 
 	void VertexProcessor::setNormalizeNormals(bool normalizeNormals)
 	{
-		context->normalizeNormals = normalizeNormals;
+		context->setState(context->normalizeNormals, normalizeNormals);
 	}
 
 	void VertexProcessor::setTextureMatrix(int stage, const Matrix &T)
@@ -508,15 +531,15 @@ namespace sw
 
 	void VertexProcessor::setTextureTransform(int stage, int count, bool project)
 	{
-		context->textureTransformCount[stage] = count;
-		context->textureTransformProject[stage] = project;
+		context->setState(context->textureTransformCount[stage], count);
+		context->setState(context->textureTransformProject[stage], project);
 	}
 
 	void VertexProcessor::setTextureFilter(unsigned int sampler, FilterType textureFilter)
 	{
 		if(sampler < VERTEX_TEXTURE_IMAGE_UNITS)
 		{
-			context->sampler[TEXTURE_IMAGE_UNITS + sampler].setTextureFilter(textureFilter);
+			context->stateModified |= context->sampler[TEXTURE_IMAGE_UNITS + sampler].setTextureFilter(textureFilter);
 		}
 		else ASSERT(false);
 	}
@@ -525,7 +548,7 @@ namespace sw
 	{
 		if(sampler < VERTEX_TEXTURE_IMAGE_UNITS)
 		{
-			context->sampler[TEXTURE_IMAGE_UNITS + sampler].setMipmapFilter(mipmapFilter);
+			context->stateModified |= context->sampler[TEXTURE_IMAGE_UNITS + sampler].setMipmapFilter(mipmapFilter);
 		}
 		else ASSERT(false);
 	}
@@ -534,7 +557,7 @@ namespace sw
 	{
 		if(sampler < VERTEX_TEXTURE_IMAGE_UNITS)
 		{
-			context->sampler[TEXTURE_IMAGE_UNITS + sampler].setGatherEnable(enable);
+			context->stateModified |= context->sampler[TEXTURE_IMAGE_UNITS + sampler].setGatherEnable(enable);
 		}
 		else ASSERT(false);
 	}
@@ -543,7 +566,7 @@ namespace sw
 	{
 		if(sampler < VERTEX_TEXTURE_IMAGE_UNITS)
 		{
-			context->sampler[TEXTURE_IMAGE_UNITS + sampler].setAddressingModeU(addressMode);
+			context->stateModified |= context->sampler[TEXTURE_IMAGE_UNITS + sampler].setAddressingModeU(addressMode);
 		}
 		else ASSERT(false);
 	}
@@ -552,7 +575,7 @@ namespace sw
 	{
 		if(sampler < VERTEX_TEXTURE_IMAGE_UNITS)
 		{
-			context->sampler[TEXTURE_IMAGE_UNITS + sampler].setAddressingModeV(addressMode);
+			context->stateModified |= context->sampler[TEXTURE_IMAGE_UNITS + sampler].setAddressingModeV(addressMode);
 		}
 		else ASSERT(false);
 	}
@@ -561,7 +584,7 @@ namespace sw
 	{
 		if(sampler < VERTEX_TEXTURE_IMAGE_UNITS)
 		{
-			context->sampler[TEXTURE_IMAGE_UNITS + sampler].setAddressingModeW(addressMode);
+			context->stateModified |= context->sampler[TEXTURE_IMAGE_UNITS + sampler].setAddressingModeW(addressMode);
 		}
 		else ASSERT(false);
 	}
@@ -570,7 +593,7 @@ namespace sw
 	{
 		if(sampler < VERTEX_TEXTURE_IMAGE_UNITS)
 		{
-			context->sampler[TEXTURE_IMAGE_UNITS + sampler].setReadSRGB(sRGB);
+			context->stateModified |= context->sampler[TEXTURE_IMAGE_UNITS + sampler].setReadSRGB(sRGB);
 		}
 		else ASSERT(false);
 	}
@@ -597,7 +620,7 @@ namespace sw
 	{
 		if(sampler < VERTEX_TEXTURE_IMAGE_UNITS)
 		{
-			context->sampler[TEXTURE_IMAGE_UNITS + sampler].setMaxAnisotropy(maxAnisotropy);
+			context->stateModified |= context->sampler[TEXTURE_IMAGE_UNITS + sampler].setMaxAnisotropy(maxAnisotropy);
 		}
 		else ASSERT(false);
 	}
@@ -606,7 +629,7 @@ namespace sw
 	{
 		if(sampler < TEXTURE_IMAGE_UNITS)
 		{
-			context->sampler[sampler].setHighPrecisionFiltering(highPrecisionFiltering);
+			context->stateModified |= context->sampler[sampler].setHighPrecisionFiltering(highPrecisionFiltering);
 		}
 		else ASSERT(false);
 	}
@@ -615,7 +638,7 @@ namespace sw
 	{
 		if(sampler < VERTEX_TEXTURE_IMAGE_UNITS)
 		{
-			context->sampler[TEXTURE_IMAGE_UNITS + sampler].setSwizzleR(swizzleR);
+			context->stateModified |= context->sampler[TEXTURE_IMAGE_UNITS + sampler].setSwizzleR(swizzleR);
 		}
 		else ASSERT(false);
 	}
@@ -624,7 +647,7 @@ namespace sw
 	{
 		if(sampler < VERTEX_TEXTURE_IMAGE_UNITS)
 		{
-			context->sampler[TEXTURE_IMAGE_UNITS + sampler].setSwizzleG(swizzleG);
+			context->stateModified |= context->sampler[TEXTURE_IMAGE_UNITS + sampler].setSwizzleG(swizzleG);
 		}
 		else ASSERT(false);
 	}
@@ -633,7 +656,7 @@ namespace sw
 	{
 		if(sampler < VERTEX_TEXTURE_IMAGE_UNITS)
 		{
-			context->sampler[TEXTURE_IMAGE_UNITS + sampler].setSwizzleB(swizzleB);
+			context->stateModified |= context->sampler[TEXTURE_IMAGE_UNITS + sampler].setSwizzleB(swizzleB);
 		}
 		else ASSERT(false);
 	}
@@ -642,7 +665,7 @@ namespace sw
 	{
 		if(sampler < VERTEX_TEXTURE_IMAGE_UNITS)
 		{
-			context->sampler[TEXTURE_IMAGE_UNITS + sampler].setSwizzleA(swizzleA);
+			context->stateModified |= context->sampler[TEXTURE_IMAGE_UNITS + sampler].setSwizzleA(swizzleA);
 		}
 		else ASSERT(false);
 	}
@@ -651,7 +674,7 @@ namespace sw
 	{
 		if(sampler < VERTEX_TEXTURE_IMAGE_UNITS)
 		{
-			context->sampler[TEXTURE_IMAGE_UNITS + sampler].setCompareFunc(compFunc);
+			context->stateModified |= context->sampler[TEXTURE_IMAGE_UNITS + sampler].setCompareFunc(compFunc);
 		}
 		else ASSERT(false);
 	}
@@ -678,7 +701,7 @@ namespace sw
 	{
 		if(sampler < VERTEX_TEXTURE_IMAGE_UNITS)
 		{
-			context->sampler[TEXTURE_IMAGE_UNITS + sampler].setMinLod(minLod);
+			context->stateModified |= context->sampler[TEXTURE_IMAGE_UNITS + sampler].setMinLod(minLod);
 		}
 		else ASSERT(false);
 	}
@@ -687,7 +710,7 @@ namespace sw
 	{
 		if(sampler < VERTEX_TEXTURE_IMAGE_UNITS)
 		{
-			context->sampler[TEXTURE_IMAGE_UNITS + sampler].setMaxLod(maxLod);
+			context->stateModified |= context->sampler[TEXTURE_IMAGE_UNITS + sampler].setMaxLod(maxLod);
 		}
 		else ASSERT(false);
 	}
@@ -733,12 +756,12 @@ namespace sw
 
 	void VertexProcessor::setTransformFeedbackQueryEnabled(bool enable)
 	{
-		context->transformFeedbackQueryEnabled = enable;
+		context->setState(context->transformFeedbackQueryEnabled, enable);
 	}
 
 	void VertexProcessor::enableTransformFeedback(uint64_t enable)
 	{
-		context->transformFeedbackEnabled = enable;
+		context->setState(context->transformFeedbackEnabled, enable);
 	}
 
 	const Matrix &VertexProcessor::getModelTransform(int i)
@@ -898,11 +921,15 @@ namespace sw
 
 	void VertexProcessor::setRoutineCacheSize(int cacheSize)
 	{
-		delete routineCache;
-		routineCache = new RoutineCache<State>(clamp(cacheSize, 1, 65536), precacheVertex ? "sw-vertex" : 0);
+		if(routineCache)
+		{
+			routineCache->release();
+		}
+
+		routineCache = RoutineCache<State>::acquire(clamp(cacheSize, 1, 65536), "vertex", precacheVertex ? "sw-vertex" : 0);
 	}
 
-	const VertexProcessor::State VertexProcessor::update(DrawType drawType)
+	void VertexProcessor::updateFixedFunction()
 	{
 		if(isFixedFunction())
 		{
@@ -922,12 +949,15 @@ namespace sw
 				updateLighting = false;
 			}
 		}
+	}
 
+	const VertexProcessor::State VertexProcessor::update(DrawType drawType)
+	{
 		State state;
 
 		if(context->vertexShader)
 		{
-			state.shaderID = context->vertexShader->getSerialID();
+			state.shaderID = context->vertexShader->getContentID();   // Shared by identical shaders, also across contexts
 		}
 		else
 		{
@@ -936,6 +966,8 @@ namespace sw
 
 		state.fixedFunction = !context->vertexShader && context->pixelShaderModel() < 0x0300;
 		state.textureSampling = context->vertexShader ? context->vertexShader->containsTextureSampling() : false;
+		state.fastMath = context->vertexShader && context->vertexShader->isFastMath();
+		state.mediumPrecisionMath = context->vertexShader && mediumPrecisionMath;
 		state.positionRegister = context->vertexShader ? context->vertexShader->getPositionRegister() : Pos;
 		state.pointSizeRegister = context->vertexShader ? context->vertexShader->getPointSizeRegister() : Pts;
 
@@ -979,6 +1011,7 @@ namespace sw
 		//       which is an OpenGL ES 3.0 feature, and OpenGL ES 3.0 doesn't support quads as a primitive type.
 		DrawType type = static_cast<DrawType>(static_cast<unsigned int>(drawType) & 0xF);
 		state.verticesPerPrimitive = 1 + (type >= DRAW_LINELIST) + (type >= DRAW_TRIANGLELIST);
+		state.indexedDraw = (drawType & 0xF0) != DRAW_NONINDEXED;
 
 		for(int i = 0; i < MAX_VERTEX_INPUTS; i++)
 		{
@@ -1084,33 +1117,147 @@ namespace sw
 			state.output[Fog].xClamp = true;
 		}
 
+		canonicalize(state, context->vertexShader);
+
 		state.hash = state.computeHash();
 
 		return state;
 	}
 
+	void VertexProcessor::canonicalize(State &state, const VertexShader *shader)
+	{
+		// Reset fields the vertex routine won't read, so draws which only differ
+		// in irrelevant state share the same routine.
+		if(shader)
+		{
+			for(int i = 0; i < MAX_VERTEX_INPUTS; i++)
+			{
+				if(!shader->getInput(i).active())   // Bound, but never read by the shader
+				{
+					state.input[i].type = STREAMTYPE_COLOR;
+					state.input[i].count = 0;
+					state.input[i].normalized = false;
+				}
+			}
+		}
+
+		if(!state.transformFeedbackEnabled)
+		{
+			state.transformFeedbackQueryEnabled = false;
+			state.verticesPerPrimitive = 0;
+		}
+
+		state.multiSampling = false;   // Only affects the setup and pixel routines
+	}
+
 	Routine *VertexProcessor::routine(const State &state)
 	{
-		Routine *routine = routineCache->query(state);
+		Routine *routine = findRoutine(state);
 
 		if(!routine)   // Create one
 		{
-			VertexRoutine *generator = nullptr;
+			routine = addRoutine(state, generateRoutine(state, context->vertexShader));
+		}
 
-			if(state.fixedFunction)
-			{
-				generator = new VertexPipeline(state);
-			}
-			else
+		return routine;
+	}
+
+	VertexProcessor::State VertexProcessor::genericLightingState(const State &state)
+	{
+		State generic = state;
+
+		generic.genericLighting = true;
+		generic.vertexLightActive = 0;
+		generic.vertexDiffuseMaterialSourceActive = MATERIAL_MATERIAL;
+		generic.vertexSpecularMaterialSourceActive = MATERIAL_MATERIAL;
+		generic.vertexAmbientMaterialSourceActive = MATERIAL_MATERIAL;
+		generic.vertexEmissiveMaterialSourceActive = MATERIAL_MATERIAL;
+
+		generic.hash = generic.computeHash();
+
+		return generic;
+	}
+
+	void VertexProcessor::updateGenericLighting(FixedFunction &ff)
+	{
+		for(int i = 0; i < 8; i++)
+		{
+			int active = context->vertexLightActive(i) ? ~0 : 0;
+
+			ff.lightActive[i] = {active, active, active, active};
+		}
+
+		MaterialSource source[4];
+		source[FixedFunction::DIFFUSE_SOURCE] = context->vertexDiffuseMaterialSourceActive();
+		source[FixedFunction::SPECULAR_SOURCE] = context->vertexSpecularMaterialSourceActive();
+		source[FixedFunction::AMBIENT_SOURCE] = context->vertexAmbientMaterialSourceActive();
+		source[FixedFunction::EMISSIVE_SOURCE] = context->vertexEmissiveMaterialSourceActive();
+
+		for(int i = 0; i < 4; i++)
+		{
+			for(int j = MATERIAL_MATERIAL; j <= MATERIAL_LAST; j++)
 			{
-				generator = new VertexProgram(state, context->vertexShader);
+				int mask = (source[i] == j) ? ~0 : 0;
+
+				ff.materialSource[i][j] = {mask, mask, mask, mask};
 			}
+		}
+	}
+
+	Routine *VertexProcessor::findRoutine(const State &state)
+	{
+		Routine *routine = routineCache->query(state, shaderContent(state));
+		countRoutineCacheQuery(VERTEX_ROUTINE_CACHE, routine != nullptr);
+
+		return routine;
+	}
+
+	Routine *VertexProcessor::addRoutine(const State &state, Routine *routine)
+	{
+		return routineCache->add(state, routine, shaderContent(state));
+	}
+
+	ShaderContent VertexProcessor::shaderContent(const State &state) const
+	{
+		// The state only holds the shader's content ID
+		return (state.shaderID && context->vertexShader) ? context->vertexShader->getContent() : nullptr;
+	}
+
+	Routine *VertexProcessor::generateRoutine(const State &state, const VertexShader *shader)
+	{
+		Routine *cached = PersistentRoutineCache::loadPacked("sw-vertex", &state, sizeof(State));
+
+		if(!cached && precacheVertex)
+		{
+			cached = PersistentRoutineCache::load("sw-vertex", &state, sizeof(State));
+		}
+
+		if(cached)
+		{
+			return cached;
+		}
+
+		TraceScope scope("Compile vertex routine");
 
-			generator->generate();
-			routine = (*generator)(L"VertexRoutine_%0.8X", state.shaderID);
-			delete generator;
+		VertexRoutine *generator = nullptr;
 
-			routineCache->add(state, routine);
+		if(state.fixedFunction)
+		{
+			generator = new VertexPipeline(state);
+		}
+		else
+		{
+			generator = new VertexProgram(state, shader);
+		}
+
+		generator->generate();
+		Nucleus::setRoutineCategory(RoutineVertex);
+		Routine *routine = (*generator)(L"VertexRoutine_%0.8X", (unsigned int)state.shaderID);
+		delete generator;
+
+		if(precacheVertex)
+		{
+			PersistentRoutineCache::store("sw-vertex", &state, sizeof(State), routine);
 		}
 
 		return routine;
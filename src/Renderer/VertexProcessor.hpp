@@ -24,12 +24,15 @@ namespace sw
 {
 	struct DrawData;
 
-	struct VertexCache   // FIXME: Variable size
+	struct VertexCache
 	{
+		void initialize(int size);
+		void terminate();
 		void clear();
 
-		Vertex vertex[16][4];
-		unsigned int tag[16];
+		Vertex *vertex;      // Indexed by the low bits of the vertex index
+		unsigned int *tag;   // Index of the first vertex of each group of four
+		unsigned int mask;   // Vertex count minus one
 
 		int drawCall;
 	};
@@ -38,7 +41,13 @@ namespace sw
 	{
 		unsigned int vertexCount;
 		unsigned int primitiveStart;
+		int instanceID;
+		unsigned int instanceOffset[MAX_VERTEX_INPUTS];   // Bytes to the current instance's element of each input stream
 		VertexCache vertexCache;
+
+		#if SHADER_PROFILE
+			unsigned int thread;   // Selects the shader profile counters
+		#endif
 	};
 
 	class VertexProcessor
@@ -49,9 +58,13 @@ namespace sw
 			unsigned int computeHash();
 
 			uint64_t shaderID;
+			bool specialized;                                      // The branch uniforms are folded into the shader
+			float4 specialization[Shader::MAX_BRANCH_CONSTANTS];   // Their values, in Shader::getBranchConstants() order
 
 			bool fixedFunction             : 1;   // TODO: Eliminate by querying shader.
 			bool textureSampling           : 1;   // TODO: Eliminate by querying shader.
+			bool fastMath                  : 1;
+			bool mediumPrecisionMath       : 1;
 			unsigned int positionRegister  : BITS(MAX_VERTEX_OUTPUTS);   // TODO: Eliminate by querying shader.
 			unsigned int pointSizeRegister : BITS(MAX_VERTEX_OUTPUTS);   // TODO: Eliminate by querying shader.
 
@@ -77,10 +90,12 @@ namespace sw
 			bool transformFeedbackQueryEnabled                : 1;
 			uint64_t transformFeedbackEnabled                 : 64;
 			unsigned char verticesPerPrimitive                : 2; // 1 (points), 2 (lines) or 3 (triangles)
+			bool indexedDraw                                  : 1; // Vertices are fetched in index order, not sequentially
 
 			bool preTransformed : 1;
 			bool superSampling  : 1;
 			bool multiSampling  : 1;
+			bool genericLighting : 1;   // Light enables and material sources are read from the draw data
 
 			struct TextureState
 			{
@@ -169,6 +184,11 @@ namespace sw
 			float4 globalAmbient;
 			float4 materialEmission;
 			float4 materialAmbient;
+
+			// Only used by generic lighting routines
+			enum { DIFFUSE_SOURCE, SPECULAR_SOURCE, AMBIENT_SOURCE, EMISSIVE_SOURCE };
+			int4 lightActive[8];          // ~0 for active lights
+			int4 materialSource[4][3];    // ~0 masks selecting the material, color 0 or color 1
 		};
 
 		struct PointSprite
@@ -220,7 +240,6 @@ namespace sw
 		void setLightAttenuation(unsigned int light, float constant, float linear, float quadratic);
 		void setLightRange(unsigned int light, float lightRange);
 
-		void setInstanceID(int instanceID);
 
 		void setFogEnable(bool fogEnable);
 		void setVertexFogMode(FogMode fogMode);
@@ -284,8 +303,16 @@ namespace sw
 		const Matrix &getModelTransform(int i);
 		const Matrix &getViewTransform();
 
+		void updateFixedFunction();
 		const State update(DrawType drawType);
+		// The returned routines are bound, and have to be unbound by the caller
 		Routine *routine(const State &state);
+		Routine *findRoutine(const State &state);
+		Routine *addRoutine(const State &state, Routine *routine);
+		static Routine *generateRoutine(const State &state, const VertexShader *shader);
+		static void canonicalize(State &state, const VertexShader *shader);   // Clears state the routine doesn't depend on
+		static State genericLightingState(const State &state);   // Shared by fixed-function states only differing in lights or material sources
+		void updateGenericLighting(FixedFunction &ff);
 
 		bool isFixedFunction();
 		void setRoutineCacheSize(int cacheSize);
@@ -325,6 +352,7 @@ namespace sw
 		void setTransform(const Matrix &M, int i);
 		void setCameraTransform(const Matrix &M, int i);
 		void setNormalTransform(const Matrix &M, int i);
+		ShaderContent shaderContent(const State &state) const;
 
 		Context *const context;
 
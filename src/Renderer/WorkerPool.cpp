@@ -0,0 +1,261 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "WorkerPool.hpp"
+
+#include "Renderer.hpp"
+#include "Common/Debug.hpp"
+#include "Common/Trace.hpp"
+
+namespace sw
+{
+	static MutexLock poolMutex;       // Guards creating and destroying the pool
+	static WorkerPool *pool = nullptr;
+	static int poolUsers = 0;
+
+	struct WorkerParameters
+	{
+		WorkerPool *pool;
+		int worker;
+	};
+
+	int WorkerPool::attach(Renderer *renderer, int threadCount, int affinity, const std::vector<int> &processors, int spinCount)
+	{
+		poolMutex.lock();
+
+		if(!pool)
+		{
+			pool = new WorkerPool(threadCount, affinity, processors, spinCount);
+		}
+
+		poolUsers++;
+
+		pool->mutex.lock();
+		pool->clients.push_back({renderer, Renderer::PRIORITY_MEDIUM, 0});
+		pool->mutex.unlock();
+
+		int count = pool->threadCount;
+
+		poolMutex.unlock();
+
+		return count;
+	}
+
+	void WorkerPool::detach(Renderer *renderer)
+	{
+		poolMutex.lock();
+
+		ASSERT(pool);
+
+		while(true)
+		{
+			pool->mutex.lock();
+
+			auto client = pool->clients.begin();
+
+			while(client != pool->clients.end() && client->renderer != renderer)
+			{
+				++client;
+			}
+
+			ASSERT(client != pool->clients.end());
+
+			if(client->busy == 0)
+			{
+				pool->clients.erase(client);
+				pool->mutex.unlock();
+
+				break;
+			}
+
+			pool->mutex.unlock();
+
+			Thread::sleep(1);
+		}
+
+		if(--poolUsers == 0)
+		{
+			delete pool;
+			pool = nullptr;
+		}
+
+		poolMutex.unlock();
+	}
+
+	void WorkerPool::wake(int worker)
+	{
+		// Draws executed inline on the application thread never need the workers
+		if(!pool->started)
+		{
+			pool->start();
+		}
+
+		pool->work[worker]->signal();
+	}
+
+	void WorkerPool::setPriority(Renderer *renderer, int priority)
+	{
+		pool->mutex.lock();
+
+		for(Client &client : pool->clients)
+		{
+			if(client.renderer == renderer)
+			{
+				client.priority = priority;
+			}
+		}
+
+		pool->mutex.unlock();
+	}
+
+	WorkerPool::WorkerPool(int threadCount, int affinity, const std::vector<int> &processors, int spinCount) : mutex("workers"), threadCount(threadCount), spinCount(spinCount), affinity(affinity), processors(processors)
+	{
+		exiting = false;
+		started = false;
+
+		thread = new Thread*[threadCount];
+		work = new Event*[threadCount];
+
+		for(int i = 0; i < threadCount; i++)
+		{
+			thread[i] = nullptr;
+			work[i] = new Event();
+		}
+	}
+
+	void WorkerPool::start()
+	{
+		startMutex.lock();
+
+		if(started)
+		{
+			startMutex.unlock();
+			return;
+		}
+
+		for(int i = 0; i < threadCount; i++)
+		{
+			WorkerParameters parameters = {this, i};
+			thread[i] = new Thread(threadFunction, &parameters);   // Parameters are copied before it returns
+
+			if(affinity == 1)
+			{
+				thread[i]->setAffinity(processors);
+			}
+			else if(affinity == 2 && !processors.empty())
+			{
+				thread[i]->setAffinity(std::vector<int>(1, processors[i % processors.size()]));
+			}
+		}
+
+		started = true;
+		startMutex.unlock();
+	}
+
+	WorkerPool::~WorkerPool()
+	{
+		ASSERT(clients.empty());
+
+		exiting = true;
+
+		for(int i = 0; i < threadCount; i++)
+		{
+			if(thread[i])
+			{
+				work[i]->signal();
+				thread[i]->join();
+
+				delete thread[i];
+			}
+
+			delete work[i];
+		}
+
+		delete[] thread;
+		delete[] work;
+	}
+
+	void WorkerPool::threadFunction(void *parameters)
+	{
+		WorkerPool *pool = static_cast<WorkerParameters*>(parameters)->pool;
+		int worker = static_cast<WorkerParameters*>(parameters)->worker;
+
+		if(Trace::enabled())
+		{
+			Trace::threadName("Worker", worker);
+		}
+
+		pool->threadLoop(worker);
+	}
+
+	void WorkerPool::threadLoop(int worker)
+	{
+		size_t turn = 0;   // Rotates which renderer gets visited first
+
+		while(!exiting)
+		{
+			Client *client = nullptr;
+
+			mutex.lock();
+
+			size_t count = clients.size();
+			auto next = clients.begin();
+
+			for(size_t i = 0; i < (count ? turn % count : 0); i++)
+			{
+				++next;
+			}
+
+			// Renderers of equal priority take turns, a higher priority always goes first
+			for(size_t i = 0; i < count; i++)
+			{
+				if((!client || next->priority > client->priority) && next->renderer->hasTasks(worker))
+				{
+					client = &*next;
+
+					if(client->priority == Renderer::PRIORITY_HIGH)
+					{
+						break;
+					}
+				}
+
+				if(++next == clients.end())
+				{
+					next = clients.begin();
+				}
+			}
+
+			if(client)
+			{
+				client->busy++;   // Keeps it in the list until we're done
+			}
+
+			turn++;
+
+			mutex.unlock();
+
+			if(!client)
+			{
+				work[worker]->wait(spinCount);
+				continue;
+			}
+
+			client->renderer->executeTasks(worker, TASK_QUANTUM);
+
+			mutex.lock();
+			client->busy--;
+			mutex.unlock();
+		}
+	}
+}
@@ -0,0 +1,80 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef sw_WorkerPool_hpp
+#define sw_WorkerPool_hpp
+
+#include "Common/MutexLock.hpp"
+#include "Common/Thread.hpp"
+
+#include <atomic>
+#include <list>
+#include <vector>
+
+namespace sw
+{
+	class Renderer;
+
+	// Process-wide rendering threads, shared by all Renderers. Worker i executes the
+	// tasks of thread slot i of each attached Renderer, a few at a time and visiting
+	// them in turn. Contexts get a fair share of the cores, and the number of threads
+	// doesn't grow with the number of contexts. Renderers with a higher priority are
+	// visited first, so lower priority ones only get the workers they leave idle.
+	class WorkerPool
+	{
+	public:
+		// Creates the pool for the first renderer. Returns its thread count, which
+		// stays the same for all renderers until the last one has detached.
+		static int attach(Renderer *renderer, int threadCount, int affinity, const std::vector<int> &processors, int spinCount);
+		static void detach(Renderer *renderer);   // Waits for the workers to leave the renderer's tasks
+
+		static void wake(int worker);   // A thread slot of an attached renderer has tasks
+		static void setPriority(Renderer *renderer, int priority);
+
+	private:
+		WorkerPool(int threadCount, int affinity, const std::vector<int> &processors, int spinCount);
+
+		~WorkerPool();
+
+		void start();   // Spawns the threads on the first wakeup, short-lived processes may never need them
+
+		static void threadFunction(void *parameters);
+		void threadLoop(int worker);
+
+		enum {TASK_QUANTUM = 4};   // Tasks executed for one renderer before moving on to the next
+
+		struct Client
+		{
+			Renderer *renderer;
+			int priority;
+			int busy;   // Workers executing its tasks
+		};
+
+		MutexLock mutex;
+		std::list<Client> clients;
+
+		const int threadCount;
+		const int spinCount;
+		const int affinity;
+		const std::vector<int> processors;
+		Thread **thread;
+		Event **work;
+		volatile bool exiting;
+
+		MutexLock startMutex;
+		std::atomic<bool> started;
+	};
+}
+
+#endif   // sw_WorkerPool_hpp
@@ -15,80 +15,20 @@
 #include "Constants.hpp"
 
 #include "Common/Math.hpp"
-#include "Common/Half.hpp"
 
 #include <memory.h>
 
 namespace sw
 {
-	Constants constants;
-
-	Constants::Constants()
+	const Constants &getConstants()
 	{
-		static const unsigned int transposeBit0[16] =
-		{
-			0x00000000,
-			0x00000001,
-			0x00000010,
-			0x00000011,
-			0x00000100,
-			0x00000101,
-			0x00000110,
-			0x00000111,
-			0x00001000,
-			0x00001001,
-			0x00001010,
-			0x00001011,
-			0x00001100,
-			0x00001101,
-			0x00001110,
-			0x00001111
-		};
-
-		static const unsigned int transposeBit1[16] =
-		{
-			0x00000000,
-			0x00000002,
-			0x00000020,
-			0x00000022,
-			0x00000200,
-			0x00000202,
-			0x00000220,
-			0x00000222,
-			0x00002000,
-			0x00002002,
-			0x00002020,
-			0x00002022,
-			0x00002200,
-			0x00002202,
-			0x00002220,
-			0x00002222
-		};
-
-		static const unsigned int transposeBit2[16] =
-		{
-			0x00000000,
-			0x00000004,
-			0x00000040,
-			0x00000044,
-			0x00000400,
-			0x00000404,
-			0x00000440,
-			0x00000444,
-			0x00004000,
-			0x00004004,
-			0x00004040,
-			0x00004044,
-			0x00004400,
-			0x00004404,
-			0x00004440,
-			0x00004444
-		};
+		static const ALIGN(64, Constants) constants;   // Cache line aligned, thread-safe initialization
 
-		memcpy(&this->transposeBit0, transposeBit0, sizeof(transposeBit0));
-		memcpy(&this->transposeBit1, transposeBit1, sizeof(transposeBit1));
-		memcpy(&this->transposeBit2, transposeBit2, sizeof(transposeBit2));
+		return constants;
+	}
 
+	Constants::Constants()
+	{
 		static const ushort4 cWeight[17] =
 		{
 			{0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF},   // 0xFFFF / 1  = 0xFFFF
@@ -353,10 +293,5 @@ namespace sw
 		memcpy(&this->unscaleInt, &unscaleInt, sizeof(unscaleInt));
 		memcpy(&this->unscaleUInt, &unscaleUInt, sizeof(unscaleUInt));
 		memcpy(&this->unscaleFixed, &unscaleFixed, sizeof(unscaleFixed));
-
-		for(int i = 0; i <= 0xFFFF; i++)
-		{
-			half2float[i] = (float)reinterpret_cast<half&>(i);
-		}
 	}
 }
\ No newline at end of file
@@ -33,8 +33,129 @@ namespace sw
 		if(state.color[1].component & 0x8) specular.w = convertFixed12(v[1].w); else specular.w = Short4(0x0000);
 	}
 
+	PixelPipeline::StageCombiner PixelPipeline::stageCombiner(unsigned int operation, unsigned int argument1, unsigned int argument2, unsigned int modifier1, unsigned int modifier2, bool alpha)
+	{
+		// On the first stage the current color is the diffuse color
+		auto source = [](unsigned int argument) -> StageCombiner
+		{
+			switch(argument)
+			{
+			case TextureStage::SOURCE_TEXTURE: return COMBINER_TEXTURE;
+			case TextureStage::SOURCE_DIFFUSE: return COMBINER_DIFFUSE;
+			case TextureStage::SOURCE_CURRENT: return COMBINER_DIFFUSE;
+			default:                           return COMBINER_GENERIC;
+			}
+		};
+
+		// The alpha modifier doesn't affect the alpha channel
+		auto plain = [alpha](unsigned int modifier)
+		{
+			return modifier == TextureStage::MODIFIER_COLOR || (alpha && modifier == TextureStage::MODIFIER_ALPHA);
+		};
+
+		switch(operation)
+		{
+		case TextureStage::STAGE_SELECTARG1:
+			return plain(modifier1) ? source(argument1) : COMBINER_GENERIC;
+		case TextureStage::STAGE_SELECTARG2:
+			return plain(modifier2) ? source(argument2) : COMBINER_GENERIC;
+		case TextureStage::STAGE_MODULATE:
+			if(plain(modifier1) && plain(modifier2))
+			{
+				StageCombiner first = source(argument1);
+				StageCombiner second = source(argument2);
+
+				if((first == COMBINER_TEXTURE && second == COMBINER_DIFFUSE) ||
+				   (first == COMBINER_DIFFUSE && second == COMBINER_TEXTURE))
+				{
+					return COMBINER_MODULATE;
+				}
+			}
+			return COMBINER_GENERIC;
+		default:
+			return COMBINER_GENERIC;
+		}
+	}
+
+	bool PixelPipeline::singleStage()
+	{
+		const TextureStage::State &textureStage = state.textureStage[0];
+
+		if(textureStage.stageOperation == TextureStage::STAGE_DISABLE ||
+		   state.textureStage[1].stageOperation != TextureStage::STAGE_DISABLE ||
+		   textureStage.destinationArgument != TextureStage::DESTINATION_CURRENT)
+		{
+			return false;
+		}
+
+		StageCombiner color = stageCombiner(textureStage.stageOperation, textureStage.firstArgument, textureStage.secondArgument,
+		                                    textureStage.firstModifier, textureStage.secondModifier, false);
+		StageCombiner alpha = stageCombiner(textureStage.stageOperationAlpha, textureStage.firstArgumentAlpha, textureStage.secondArgumentAlpha,
+		                                    textureStage.firstModifierAlpha, textureStage.secondModifierAlpha, true);
+
+		if(color == COMBINER_GENERIC || alpha == COMBINER_GENERIC)
+		{
+			return false;
+		}
+
+		// Texture replace and texture modulate diffuse, without the generic stage's argument and clamping logic
+		current = diffuse;
+
+		if(color == COMBINER_DIFFUSE && alpha == COMBINER_DIFFUSE)
+		{
+			return true;
+		}
+
+		Vector4s texture = sampleTexture(0, 0);
+
+		if(color == COMBINER_TEXTURE)
+		{
+			current.x = texture.x;
+			current.y = texture.y;
+			current.z = texture.z;
+		}
+		else if(color == COMBINER_MODULATE)
+		{
+			current.x = MulHigh(texture.x, diffuse.x) << 4;
+			current.y = MulHigh(texture.y, diffuse.y) << 4;
+			current.z = MulHigh(texture.z, diffuse.z) << 4;
+		}
+
+		if(alpha == COMBINER_TEXTURE)
+		{
+			current.w = texture.w;
+		}
+		else if(alpha == COMBINER_MODULATE)
+		{
+			current.w = MulHigh(texture.w, diffuse.w) << 4;
+		}
+
+		if(!textureStage.cantUnderflow)   // Signed textures
+		{
+			if(color != COMBINER_DIFFUSE)
+			{
+				current.x = Max(current.x, Short4(0x0000));
+				current.y = Max(current.y, Short4(0x0000));
+				current.z = Max(current.z, Short4(0x0000));
+			}
+
+			if(alpha != COMBINER_DIFFUSE)
+			{
+				current.w = Max(current.w, Short4(0x0000));
+			}
+		}
+
+		return true;
+	}
+
 	void PixelPipeline::fixedFunction()
 	{
+		if(singleStage())
+		{
+			specularPixel(current, specular);
+			return;
+		}
+
 		current = diffuse;
 		Vector4s temp(0x0000, 0x0000, 0x0000, 0x0000);
 
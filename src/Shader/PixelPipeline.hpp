@@ -54,6 +54,17 @@ namespace sw
 		Float4 V;  // FIXME
 		Float4 W;  // FIXME
 
+		enum StageCombiner
+		{
+			COMBINER_GENERIC,
+			COMBINER_TEXTURE,    // Selects the texture
+			COMBINER_DIFFUSE,    // Selects the diffuse color
+			COMBINER_MODULATE,   // Texture times diffuse color
+		};
+
+		static StageCombiner stageCombiner(unsigned int operation, unsigned int argument1, unsigned int argument2, unsigned int modifier1, unsigned int modifier2, bool alpha);
+		bool singleStage();   // Emits the common single texture stage configurations, returns false for other ones
+
 		void fixedFunction();
 		void blendTexture(Vector4s &temp, Vector4s &texture, int stage);
 		void fogBlend(Vector4s &current, Float4 &fog);
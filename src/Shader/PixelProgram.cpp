@@ -25,6 +25,30 @@ namespace sw
 	extern bool halfIntegerCoordinates;     // Pixel centers are not at integer coordinates
 	extern bool fullPixelPositionRegister;
 
+	PixelProgram::PixelProgram(const PixelProcessor::State &state, const PixelShader *shader) :
+		PixelRoutine(state, shader), r(shader->indirectAddressableTemporaries),
+		loopDepth(-1), ifDepth(0), loopRepDepth(0), currentLabel(-1)
+	{
+		for(int i = 0; i < Shader::MAX_LABELS; ++i)
+		{
+			labelBlock[i] = 0;
+		}
+
+		enableStack[0] = Int4(0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF);
+
+		if(shader->containsBreakInstruction())
+		{
+			enableBreak = Int4(0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF);
+		}
+
+		if(shader->containsContinueInstruction())
+		{
+			enableContinue = Int4(0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF);
+		}
+
+		floatConstants = *Pointer<Pointer<Byte>>(data + OFFSET(DrawData, ps.c));
+	}
+
 	void PixelProgram::setBuiltins(Int &x, Int &y, Float4(&z)[4], Float4 &w)
 	{
 		if(shader->getShaderModel() >= 0x0300)
@@ -99,6 +123,10 @@ namespace sw
 			}
 		}
 
+		#if SHADER_PROFILE
+			profileShader(shader, *Pointer<Pointer<Byte>>(data + OFFSET(DrawData,shaderProfile)), cluster);
+		#endif
+
 		bool broadcastColor0 = true;
 
 		for(size_t i = 0; i < shader->getLength(); i++)
@@ -111,6 +139,10 @@ namespace sw
 				continue;
 			}
 
+			#if SHADER_PROFILE
+				profileBegin(i, opcode);
+			#endif
+
 			const Dst &dst = instruction->dst;
 			const Src &src0 = instruction->src[0];
 			const Src &src1 = instruction->src[1];
@@ -120,7 +152,7 @@ namespace sw
 
 			bool predicate = instruction->predicate;
 			Control control = instruction->control;
-			bool pp = dst.partialPrecision;
+			bool pp = dst.partialPrecision || state.fastMath || (dst.mediumPrecision && state.mediumPrecisionMath);
 			bool project = instruction->project;
 			bool bias = instruction->bias;
 
@@ -545,6 +577,10 @@ namespace sw
 					ASSERT(false);
 				}
 			}
+
+			#if SHADER_PROFILE
+				profileEnd(i, opcode);
+			#endif
 		}
 
 		if(currentLabel != -1)
@@ -852,6 +888,20 @@ namespace sw
 		return enable;
 	}
 
+	Bool PixelProgram::loopCondition()
+	{
+		Bool condition = iteration[loopDepth] > 0;
+
+		if(shader->containsBreakInstruction())
+		{
+			// Exit as soon as no lane remains in the loop, instead of running masked iterations
+			Int4 active = enableStack[enableIndex] & enableBreak;
+			condition = condition && (SignMask(active) != 0);
+		}
+
+		return condition;
+	}
+
 	Vector4f PixelProgram::fetchRegister(const Src &src, unsigned int offset)
 	{
 		Vector4f reg;
@@ -876,6 +926,11 @@ namespace sw
 		case Shader::PARAMETER_INPUT:
 			if(src.rel.type == Shader::PARAMETER_VOID)   // Not relative
 			{
+				if(shader->isInputLazy(i) && state.interpolant[i].project == 0)
+				{
+					interpolateInput(i);
+				}
+
 				reg = v[i];
 			}
 			else if(!src.rel.dynamic)
@@ -989,7 +1044,7 @@ namespace sw
 	{
 		if(bufferIndex == -1)
 		{
-			return data + OFFSET(DrawData, ps.c[index]);
+			return floatConstants + index * sizeof(float4);
 		}
 		else
 		{
@@ -1016,7 +1071,7 @@ namespace sw
 			c.z = c.z.zzzz;
 			c.w = c.w.wwww;
 
-			if(shader->containsDefineInstruction())   // Constant may be known at compile time
+			if(shader->containsDefineInstruction() && src.bufferIndex == -1)   // Constant may be known at compile time
 			{
 				for(size_t j = 0; j < shader->getLength(); j++)
 				{
@@ -1709,7 +1764,7 @@ namespace sw
 		Nucleus::createBr(testBlock);
 		Nucleus::setInsertBlock(testBlock);
 
-		branch(iteration[loopDepth] > 0, loopBlock, endBlock);
+		branch(loopCondition(), loopBlock, endBlock);
 		Nucleus::setInsertBlock(loopBlock);
 
 		iteration[loopDepth] = iteration[loopDepth] - 1;   // FIXME: --
@@ -1735,7 +1790,7 @@ namespace sw
 		Nucleus::createBr(testBlock);
 		Nucleus::setInsertBlock(testBlock);
 
-		branch(iteration[loopDepth] > 0, loopBlock, endBlock);
+		branch(loopCondition(), loopBlock, endBlock);
 		Nucleus::setInsertBlock(loopBlock);
 
 		iteration[loopDepth] = iteration[loopDepth] - 1;   // FIXME: --
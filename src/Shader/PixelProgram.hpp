@@ -23,27 +23,7 @@ namespace sw
 	class PixelProgram : public PixelRoutine
 	{
 	public:
-		PixelProgram(const PixelProcessor::State &state, const PixelShader *shader) :
-			PixelRoutine(state, shader), r(shader->indirectAddressableTemporaries),
-			loopDepth(-1), ifDepth(0), loopRepDepth(0), currentLabel(-1)
-		{
-			for(int i = 0; i < 2048; ++i)
-			{
-				labelBlock[i] = 0;
-			}
-
-			enableStack[0] = Int4(0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF);
-
-			if(shader->containsBreakInstruction())
-			{
-				enableBreak = Int4(0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF);
-			}
-
-			if(shader->containsContinueInstruction())
-			{
-				enableContinue = Int4(0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF);
-			}
-		}
+		PixelProgram(const PixelProcessor::State &state, const PixelShader *shader);
 
 		virtual ~PixelProgram() {}
 
@@ -82,6 +62,8 @@ namespace sw
 		Int4 enableContinue;
 		Int4 enableLeave;
 
+		Pointer<Byte> floatConstants;   // Loaded once, the draw call's constant block
+
 		Vector4f sampleTexture(const Src &sampler, Vector4f &uvwq, Float4 &bias, Vector4f &dsx, Vector4f &dsy, Vector4f &offset, SamplerFunction function);
 		Vector4f sampleTexture(int samplerIndex, Vector4f &uvwq, Float4 &bias, Vector4f &dsx, Vector4f &dsy, Vector4f &offset, SamplerFunction function);
 
@@ -89,6 +71,7 @@ namespace sw
 		void clampColor(Vector4f oC[RENDERTARGETS]);
 
 		Int4 enableMask(const Shader::Instruction *instruction);
+		Bool loopCondition();
 
 		Vector4f fetchRegister(const Src &src, unsigned int offset = 0);
 		Vector4f readConstant(const Src &src, unsigned int offset = 0);
@@ -159,8 +142,8 @@ namespace sw
 		BasicBlock *ifFalseBlock[24 + 24];
 		BasicBlock *loopRepTestBlock[4];
 		BasicBlock *loopRepEndBlock[4];
-		BasicBlock *labelBlock[2048];
-		std::vector<BasicBlock*> callRetBlock[2048];
+		BasicBlock *labelBlock[Shader::MAX_LABELS];
+		std::vector<BasicBlock*> callRetBlock[Shader::MAX_LABELS];
 		BasicBlock *returnBlock;
 		bool isConditionalIf[24 + 24];
 		std::vector<Int4> restoreContinue;
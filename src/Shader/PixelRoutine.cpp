@@ -54,7 +54,7 @@ namespace sw
 			Long pipeTime = Ticks();
 		#endif
 
-		const bool earlyDepthTest = !state.depthOverride && !state.alphaTestActive();
+		const bool earlyDepthTest = state.earlyDepthTest;
 
 		Int zMask[4];   // Depth mask
 		Int sMask[4];   // Stencil mask
@@ -71,9 +71,8 @@ namespace sw
 		}
 
 		Float4 f;
-		Float4 rhwCentroid;
 
-		Float4 xxxx = Float4(Float(x)) + *Pointer<Float4>(primitive + OFFSET(Primitive,xQuad), 16);
+		xxxx = Float4(Float(x)) + *Pointer<Float4>(primitive + OFFSET(Primitive,xQuad), 16);
 
 		if(interpolateZ())
 		{
@@ -91,6 +90,7 @@ namespace sw
 		}
 
 		Bool depthPass = false;
+		Int shadedMask = 0;   // Pixels of the quad running the shader, for the overdraw heatmap
 
 		if(earlyDepthTest)
 		{
@@ -109,8 +109,8 @@ namespace sw
 			Float4 yyyy = Float4(Float(y)) + *Pointer<Float4>(primitive + OFFSET(Primitive,yQuad), 16);
 
 			// Centroid locations
-			Float4 XXXX = Float4(0.0f);
-			Float4 YYYY = Float4(0.0f);
+			XXXX = Float4(0.0f);
+			YYYY = Float4(0.0f);
 
 			if(state.centroid)
 			{
@@ -144,43 +144,13 @@ namespace sw
 
 			for(int interpolant = 0; interpolant < MAX_FRAGMENT_INPUTS; interpolant++)
 			{
-				for(int component = 0; component < 4; component++)
+				// Inputs only read in conditional code get interpolated by the shader where they're read
+				if(shader && shader->isInputLazy(interpolant) && state.interpolant[interpolant].project == 0)
 				{
-					if(state.interpolant[interpolant].component & (1 << component))
-					{
-						if(!state.interpolant[interpolant].centroid)
-						{
-							v[interpolant][component] = interpolate(xxxx, Dv[interpolant][component], rhw, primitive + OFFSET(Primitive, V[interpolant][component]), (state.interpolant[interpolant].flat & (1 << component)) != 0, state.perspective, false);
-						}
-						else
-						{
-							v[interpolant][component] = interpolateCentroid(XXXX, YYYY, rhwCentroid, primitive + OFFSET(Primitive, V[interpolant][component]), (state.interpolant[interpolant].flat & (1 << component)) != 0, state.perspective);
-						}
-					}
+					continue;
 				}
 
-				Float4 rcp;
-
-				switch(state.interpolant[interpolant].project)
-				{
-				case 0:
-					break;
-				case 1:
-					rcp = reciprocal(v[interpolant].y);
-					v[interpolant].x = v[interpolant].x * rcp;
-					break;
-				case 2:
-					rcp = reciprocal(v[interpolant].z);
-					v[interpolant].x = v[interpolant].x * rcp;
-					v[interpolant].y = v[interpolant].y * rcp;
-					break;
-				case 3:
-					rcp = reciprocal(v[interpolant].w);
-					v[interpolant].x = v[interpolant].x * rcp;
-					v[interpolant].y = v[interpolant].y * rcp;
-					v[interpolant].z = v[interpolant].z * rcp;
-					break;
-				}
+				interpolateInput(interpolant);
 			}
 
 			if(state.fog.component)
@@ -202,6 +172,21 @@ namespace sw
 					Long shaderTime = Ticks();
 				#endif
 
+				if(state.overdrawHeatmap)
+				{
+					for(unsigned int q = 0; q < state.multiSample; q++)
+					{
+						if(earlyDepthTest)
+						{
+							shadedMask |= zMask[q] & sMask[q];
+						}
+						else
+						{
+							shadedMask |= cMask[q];   // Possibly failing the stencil test already
+						}
+					}
+				}
+
 				applyShader(cMask);
 
 				#if PERF_PROFILE
@@ -256,6 +241,11 @@ namespace sw
 						#endif
 
 						rasterOperation(f, cBuffer, x, sMask, zMask, cMask);
+
+						if(state.uniformSamples)
+						{
+							updateUniformSamples(x, y, sMask, zMask, cMask);
+						}
 					}
 				}
 
@@ -265,6 +255,11 @@ namespace sw
 			}
 		}
 
+		if(state.overdrawHeatmap)
+		{
+			countOverdraw(x, y, shadedMask, sMask, zMask, cMask);
+		}
+
 		for(unsigned int q = 0; q < state.multiSample; q++)
 		{
 			if(state.multiSampleMask & (1 << q))
@@ -278,6 +273,47 @@ namespace sw
 		#endif
 	}
 
+	void PixelRoutine::interpolateInput(int interpolant)
+	{
+		for(int component = 0; component < 4; component++)
+		{
+			if(state.interpolant[interpolant].component & (1 << component))
+			{
+				if(!state.interpolant[interpolant].centroid)
+				{
+					v[interpolant][component] = interpolate(xxxx, Dv[interpolant][component], rhw, primitive + OFFSET(Primitive, V[interpolant][component]), (state.interpolant[interpolant].flat & (1 << component)) != 0, state.perspective, false);
+				}
+				else
+				{
+					v[interpolant][component] = interpolateCentroid(XXXX, YYYY, rhwCentroid, primitive + OFFSET(Primitive, V[interpolant][component]), (state.interpolant[interpolant].flat & (1 << component)) != 0, state.perspective);
+				}
+			}
+		}
+
+		Float4 rcp;
+
+		switch(state.interpolant[interpolant].project)
+		{
+		case 0:
+			break;
+		case 1:
+			rcp = reciprocal(v[interpolant].y);
+			v[interpolant].x = v[interpolant].x * rcp;
+			break;
+		case 2:
+			rcp = reciprocal(v[interpolant].z);
+			v[interpolant].x = v[interpolant].x * rcp;
+			v[interpolant].y = v[interpolant].y * rcp;
+			break;
+		case 3:
+			rcp = reciprocal(v[interpolant].w);
+			v[interpolant].x = v[interpolant].x * rcp;
+			v[interpolant].y = v[interpolant].y * rcp;
+			v[interpolant].z = v[interpolant].z * rcp;
+			break;
+		}
+	}
+
 	Float4 PixelRoutine::interpolateCentroid(Float4 &x, Float4 &y, Float4 &rhw, Pointer<Byte> planeEquation, bool flat, bool perspective)
 	{
 		Float4 interpolant = *Pointer<Float4>(planeEquation + OFFSET(PlaneEquation,C), 16);
@@ -414,6 +450,10 @@ namespace sw
 			buffer = zBuffer + 4 * x;
 			pitch = *Pointer<Int>(data + OFFSET(DrawData,depthPitchB));
 		}
+		else if(state.depthBuffer16)
+		{
+			buffer = zBuffer + 4 * x;
+		}
 		else
 		{
 			buffer = zBuffer + 8 * x;
@@ -434,12 +474,21 @@ namespace sw
 				zValue.xy = *Pointer<Float4>(buffer);
 				zValue.zw = *Pointer<Float4>(buffer + pitch - 8);
 			}
+			else if(state.depthBuffer16)
+			{
+				zValue = Float4(*Pointer<UShort4>(buffer, 8));
+			}
 			else
 			{
 				zValue = *Pointer<Float4>(buffer, 16);
 			}
 		}
 
+		if(state.depthBuffer16)
+		{
+			Z = Float4(UShort4(Round(Z * Float4(0xFFFF)), true));   // Compare at the stored precision
+		}
+
 		Int4 zTest;
 
 		switch(state.depthCompareMode)
@@ -685,6 +734,10 @@ namespace sw
 			buffer = zBuffer + 4 * x;
 			pitch = *Pointer<Int>(data + OFFSET(DrawData,depthPitchB));
 		}
+		else if(state.depthBuffer16)
+		{
+			buffer = zBuffer + 4 * x;
+		}
 		else
 		{
 			buffer = zBuffer + 8 * x;
@@ -695,6 +748,18 @@ namespace sw
 			buffer += q * *Pointer<Int>(data + OFFSET(DrawData,depthSliceB));
 		}
 
+		if(state.depthBuffer16)
+		{
+			Short4 Z16 = As<Short4>(UShort4(Round(Z * Float4(0xFFFF)), true));
+			Short4 zValue16 = *Pointer<Short4>(buffer, 8);
+
+			Z16 &= *Pointer<Short4>(constants + OFFSET(Constants,maskW4Q) + zMask * 8, 8);
+			zValue16 &= *Pointer<Short4>(constants + OFFSET(Constants,invMaskW4Q) + zMask * 8, 8);
+			*Pointer<Short4>(buffer, 8) = Z16 | zValue16;
+
+			return;
+		}
+
 		Float4 zValue;
 
 		if(state.depthCompareMode != DEPTH_NEVER || (state.depthCompareMode != DEPTH_ALWAYS && !state.depthWriteEnable))
@@ -990,6 +1055,26 @@ namespace sw
 		}
 	}
 
+	bool PixelRoutine::blendReadsDestination(BlendOperation blendOperation, BlendFactor sourceFactor, BlendFactor destFactor)
+	{
+		auto readsDestination = [](BlendFactor factor)
+		{
+			return factor == BLEND_DEST || factor == BLEND_INVDEST ||
+			       factor == BLEND_DESTALPHA || factor == BLEND_INVDESTALPHA ||
+			       factor == BLEND_SRCALPHASAT;
+		};
+
+		switch(blendOperation)
+		{
+		case BLENDOP_NULL:
+			return false;
+		case BLENDOP_SOURCE:
+			return readsDestination(sourceFactor);
+		default:
+			return true;
+		}
+	}
+
 	bool PixelRoutine::isSRGB(int index) const
 	{
 		return Surface::isSRGBformat(state.targetFormat[index]);
@@ -1175,72 +1260,112 @@ namespace sw
 			return;
 		}
 
+		// Channels excluded by the write mask are taken from the color buffer by writeColor()
+		int rgbaWriteMask = state.colorWriteActive(index);
+		bool blendColor = (rgbaWriteMask & 0x7) != 0;
+		bool blendAlpha = (rgbaWriteMask & 0x8) != 0;
+
 		Vector4s pixel;
-		readPixel(index, cBuffer, x, pixel);
+
+		if((blendColor && blendReadsDestination(state.blendOperation, state.sourceBlendFactor, state.destBlendFactor)) ||
+		   (blendAlpha && blendReadsDestination(state.blendOperationAlpha, state.sourceBlendFactorAlpha, state.destBlendFactorAlpha)))
+		{
+			readPixel(index, cBuffer, x, pixel);
+		}
+
+		// Premultiplied source-over: Final Color = ObjectColor + PixelColor * (1 - ObjectAlpha)
+		if(state.blendOperation == BLENDOP_ADD && state.sourceBlendFactor == BLEND_ONE && state.destBlendFactor == BLEND_INVSOURCEALPHA &&
+		   state.blendOperationAlpha == BLENDOP_ADD && state.sourceBlendFactorAlpha == BLEND_ONE && state.destBlendFactorAlpha == BLEND_INVSOURCEALPHA)
+		{
+			UShort4 invAlpha = UShort4(0xFFFFu) - As<UShort4>(current.w);
+
+			if(blendColor)
+			{
+				current.x = AddSat(As<UShort4>(current.x), MulHigh(As<UShort4>(pixel.x), invAlpha));
+				current.y = AddSat(As<UShort4>(current.y), MulHigh(As<UShort4>(pixel.y), invAlpha));
+				current.z = AddSat(As<UShort4>(current.z), MulHigh(As<UShort4>(pixel.z), invAlpha));
+			}
+
+			if(blendAlpha)
+			{
+				current.w = AddSat(As<UShort4>(current.w), MulHigh(As<UShort4>(pixel.w), invAlpha));
+			}
+
+			return;
+		}
 
 		// Final Color = ObjectColor * SourceBlendFactor + PixelColor * DestinationBlendFactor
 		Vector4s sourceFactor;
 		Vector4s destFactor;
 
-		blendFactor(sourceFactor, current, pixel, state.sourceBlendFactor);
-		blendFactor(destFactor, current, pixel, state.destBlendFactor);
-
-		if(state.sourceBlendFactor != BLEND_ONE && state.sourceBlendFactor != BLEND_ZERO)
+		if(blendColor)
 		{
-			current.x = MulHigh(As<UShort4>(current.x), As<UShort4>(sourceFactor.x));
-			current.y = MulHigh(As<UShort4>(current.y), As<UShort4>(sourceFactor.y));
-			current.z = MulHigh(As<UShort4>(current.z), As<UShort4>(sourceFactor.z));
-		}
+			blendFactor(sourceFactor, current, pixel, state.sourceBlendFactor);
+			blendFactor(destFactor, current, pixel, state.destBlendFactor);
+
+			if(state.sourceBlendFactor != BLEND_ONE && state.sourceBlendFactor != BLEND_ZERO)
+			{
+				current.x = MulHigh(As<UShort4>(current.x), As<UShort4>(sourceFactor.x));
+				current.y = MulHigh(As<UShort4>(current.y), As<UShort4>(sourceFactor.y));
+				current.z = MulHigh(As<UShort4>(current.z), As<UShort4>(sourceFactor.z));
+			}
+
+			if(state.destBlendFactor != BLEND_ONE && state.destBlendFactor != BLEND_ZERO)
+			{
+				pixel.x = MulHigh(As<UShort4>(pixel.x), As<UShort4>(destFactor.x));
+				pixel.y = MulHigh(As<UShort4>(pixel.y), As<UShort4>(destFactor.y));
+				pixel.z = MulHigh(As<UShort4>(pixel.z), As<UShort4>(destFactor.z));
+			}
+
+			switch(state.blendOperation)
+			{
+			case BLENDOP_ADD:
+				current.x = AddSat(As<UShort4>(current.x), As<UShort4>(pixel.x));
+				current.y = AddSat(As<UShort4>(current.y), As<UShort4>(pixel.y));
+				current.z = AddSat(As<UShort4>(current.z), As<UShort4>(pixel.z));
+				break;
+			case BLENDOP_SUB:
+				current.x = SubSat(As<UShort4>(current.x), As<UShort4>(pixel.x));
+				current.y = SubSat(As<UShort4>(current.y), As<UShort4>(pixel.y));
+				current.z = SubSat(As<UShort4>(current.z), As<UShort4>(pixel.z));
+				break;
+			case BLENDOP_INVSUB:
+				current.x = SubSat(As<UShort4>(pixel.x), As<UShort4>(current.x));
+				current.y = SubSat(As<UShort4>(pixel.y), As<UShort4>(current.y));
+				current.z = SubSat(As<UShort4>(pixel.z), As<UShort4>(current.z));
+				break;
+			case BLENDOP_MIN:
+				current.x = Min(As<UShort4>(current.x), As<UShort4>(pixel.x));
+				current.y = Min(As<UShort4>(current.y), As<UShort4>(pixel.y));
+				current.z = Min(As<UShort4>(current.z), As<UShort4>(pixel.z));
+				break;
+			case BLENDOP_MAX:
+				current.x = Max(As<UShort4>(current.x), As<UShort4>(pixel.x));
+				current.y = Max(As<UShort4>(current.y), As<UShort4>(pixel.y));
+				current.z = Max(As<UShort4>(current.z), As<UShort4>(pixel.z));
+				break;
+			case BLENDOP_SOURCE:
+				// No operation
+				break;
+			case BLENDOP_DEST:
+				current.x = pixel.x;
+				current.y = pixel.y;
+				current.z = pixel.z;
+				break;
+			case BLENDOP_NULL:
+				current.x = Short4(0x0000);
+				current.y = Short4(0x0000);
+				current.z = Short4(0x0000);
+				break;
+			default:
+				ASSERT(false);
+			}
 
-		if(state.destBlendFactor != BLEND_ONE && state.destBlendFactor != BLEND_ZERO)
-		{
-			pixel.x = MulHigh(As<UShort4>(pixel.x), As<UShort4>(destFactor.x));
-			pixel.y = MulHigh(As<UShort4>(pixel.y), As<UShort4>(destFactor.y));
-			pixel.z = MulHigh(As<UShort4>(pixel.z), As<UShort4>(destFactor.z));
 		}
 
-		switch(state.blendOperation)
+		if(!blendAlpha)
 		{
-		case BLENDOP_ADD:
-			current.x = AddSat(As<UShort4>(current.x), As<UShort4>(pixel.x));
-			current.y = AddSat(As<UShort4>(current.y), As<UShort4>(pixel.y));
-			current.z = AddSat(As<UShort4>(current.z), As<UShort4>(pixel.z));
-			break;
-		case BLENDOP_SUB:
-			current.x = SubSat(As<UShort4>(current.x), As<UShort4>(pixel.x));
-			current.y = SubSat(As<UShort4>(current.y), As<UShort4>(pixel.y));
-			current.z = SubSat(As<UShort4>(current.z), As<UShort4>(pixel.z));
-			break;
-		case BLENDOP_INVSUB:
-			current.x = SubSat(As<UShort4>(pixel.x), As<UShort4>(current.x));
-			current.y = SubSat(As<UShort4>(pixel.y), As<UShort4>(current.y));
-			current.z = SubSat(As<UShort4>(pixel.z), As<UShort4>(current.z));
-			break;
-		case BLENDOP_MIN:
-			current.x = Min(As<UShort4>(current.x), As<UShort4>(pixel.x));
-			current.y = Min(As<UShort4>(current.y), As<UShort4>(pixel.y));
-			current.z = Min(As<UShort4>(current.z), As<UShort4>(pixel.z));
-			break;
-		case BLENDOP_MAX:
-			current.x = Max(As<UShort4>(current.x), As<UShort4>(pixel.x));
-			current.y = Max(As<UShort4>(current.y), As<UShort4>(pixel.y));
-			current.z = Max(As<UShort4>(current.z), As<UShort4>(pixel.z));
-			break;
-		case BLENDOP_SOURCE:
-			// No operation
-			break;
-		case BLENDOP_DEST:
-			current.x = pixel.x;
-			current.y = pixel.y;
-			current.z = pixel.z;
-			break;
-		case BLENDOP_NULL:
-			current.x = Short4(0x0000);
-			current.y = Short4(0x0000);
-			current.z = Short4(0x0000);
-			break;
-		default:
-			ASSERT(false);
+			return;
 		}
 
 		blendFactorAlpha(sourceFactor, current, pixel, state.sourceBlendFactorAlpha);
@@ -2721,4 +2846,88 @@ namespace sw
 	{
 		return state.colorWriteMask || state.alphaTestActive() || state.shaderContainsKill;
 	}
+
+	void PixelRoutine::updateUniformSamples(Int &x, Int &y, Int sMask[4], Int zMask[4], Int cMask[4])
+	{
+		Int written = 0xF;   // Pixels of the quad with every sample written
+		Int touched = 0;     // Pixels of the quad with any sample written
+
+		for(unsigned int q = 0; q < state.multiSample; q++)
+		{
+			Int mask = 0;   // Same combination as writeColor()
+
+			if(state.multiSampleMask & (1 << q))
+			{
+				mask = state.depthTestActive ? zMask[q] : cMask[q];
+
+				if(state.stencilActive)
+				{
+					mask &= sMask[q];
+				}
+			}
+
+			written &= mask;
+			touched |= mask;
+		}
+
+		for(int index = 0; index < RENDERTARGETS; index++)
+		{
+			if(!state.colorWriteActive(index))
+			{
+				continue;
+			}
+
+			Pointer<Byte> uniform = *Pointer<Pointer<Byte>>(data + OFFSET(DrawData,uniformSamples[index])) +
+			                        (y >> 1) * *Pointer<Int>(data + OFFSET(DrawData,uniformSamplesPitchB[index])) + (x >> 1);
+
+			// Each sample gets the same color, unless it's combined with the sample's previous value
+			int formatMask = (1 << Surface::componentCount(state.targetFormat[index])) - 1;
+			bool overwrite = !state.alphaBlendActive && state.logicalOperation == LOGICALOP_COPY &&
+			                 (state.colorWriteActive(index) & formatMask) == formatMask;
+
+			If(touched != written)
+			{
+				*uniform = Byte(0);   // Some pixels now differ in their written and unwritten samples
+			}
+
+			if(overwrite)
+			{
+				If(written == 0xF)
+				{
+					*uniform = Byte(1);
+				}
+			}
+		}
+	}
+
+	void PixelRoutine::countOverdraw(Int &x, Int &y, Int &shadedMask, Int sMask[4], Int zMask[4], Int cMask[4])
+	{
+		Int covered = 0;   // Pixels with any sample left after discard and alpha testing
+		Int passed = 0;    // Pixels with any sample also passing the depth and stencil tests
+
+		for(unsigned int q = 0; q < state.multiSample; q++)
+		{
+			covered |= cMask[q];
+			passed |= cMask[q] & zMask[q] & sMask[q];
+		}
+
+		Int rejected = shadedMask & covered & ~passed;
+
+		Int pitchB = *Pointer<Int>(data + OFFSET(DrawData,overdrawHeatmapPitchB));
+		Pointer<Byte> buffer = *Pointer<Pointer<Byte>>(data + OFFSET(DrawData,overdrawHeatmap)) + y * pitchB + x * 4;
+
+		// The heatmap rows and pitch are padded to quads, and each cluster owns its row pairs
+		for(int i = 0; i < 4; i++)
+		{
+			Pointer<Byte> counter = buffer + 4 * (i & 1);
+
+			if(i & 2)
+			{
+				counter += pitchB;
+			}
+
+			Int increment = ((shadedMask >> i) & 1) | (((rejected >> i) & 1) << 16);
+			*Pointer<Int>(counter) = *Pointer<Int>(counter) + increment;
+		}
+	}
 }
@@ -36,6 +36,12 @@ namespace sw
 
 		RegisterArray<MAX_FRAGMENT_INPUTS> v;   // Varying registers
 
+		// Interpolation locations of the quad, also used for lazy inputs
+		Float4 xxxx;
+		Float4 XXXX;   // Centroid
+		Float4 YYYY;
+		Float4 rhwCentroid;
+
 		// Depth output
 		Float4 oDepth;
 
@@ -49,6 +55,8 @@ namespace sw
 
 		virtual void quad(Pointer<Byte> cBuffer[4], Pointer<Byte> &zBuffer, Pointer<Byte> &sBuffer, Int cMask[4], Int &x, Int &y);
 
+		void interpolateInput(int interpolant);   // Into v[interpolant], at the quad's location
+
 		void alphaTest(Int &aMask, Short4 &alpha);
 		void alphaToCoverage(Int cMask[4], Float4 &alpha);
 		void fogBlend(Vector4f &c0, Float4 &fog);
@@ -77,6 +85,7 @@ namespace sw
 		void blendFactor(Vector4s &blendFactor, const Vector4s &current, const Vector4s &pixel, BlendFactor blendFactorActive);
 		void blendFactorAlpha(Vector4s &blendFactor, const Vector4s &current, const Vector4s &pixel, BlendFactor blendFactorAlphaActive);
 		void readPixel(int index, Pointer<Byte> &cBuffer, Int &x, Vector4s &pixel);
+		static bool blendReadsDestination(BlendOperation blendOperation, BlendFactor sourceFactor, BlendFactor destFactor);
 		void blendFactor(Vector4f &blendFactor, const Vector4f &oC, const Vector4f &pixel, BlendFactor blendFactorActive);
 		void blendFactorAlpha(Vector4f &blendFactor, const Vector4f &oC, const Vector4f &pixel, BlendFactor blendFactorAlphaActive);
 		void writeStencil(Pointer<Byte> &sBuffer, int q, Int &x, Int &sMask, Int &zMask, Int &cMask);
@@ -87,6 +96,8 @@ namespace sw
 		Float4 sRGBtoLinear(const Float4 &x);
 
 		bool colorUsed();
+		void updateUniformSamples(Int &x, Int &y, Int sMask[4], Int zMask[4], Int cMask[4]);
+		void countOverdraw(Int &x, Int &y, Int &shadedMask, Int sMask[4], Int zMask[4], Int cMask[4]);
 	};
 }
 
@@ -14,7 +14,9 @@
 
 #include "PixelShader.hpp"
 
+#include "Renderer/Vertex.hpp"
 #include "Common/Debug.hpp"
+#include "Common/BinaryStream.hpp"
 
 #include <string.h>
 
@@ -22,6 +24,7 @@ namespace sw
 {
 	PixelShader::PixelShader(const PixelShader *ps) : Shader()
 	{
+		shaderType = SHADER_PIXEL;
 		shaderModel = 0x0300;
 		vPosDeclared = false;
 		vFaceDeclared = false;
@@ -38,6 +41,7 @@ namespace sw
 			vPosDeclared = ps->vPosDeclared;
 			vFaceDeclared = ps->vFaceDeclared;
 			usedSamplers = ps->usedSamplers;
+			setFastMath(ps->isFastMath());
 
 			optimize();
 			analyze();
@@ -138,6 +142,62 @@ namespace sw
 		return input[2 + coordinate][component].active();
 	}
 
+	void PixelShader::appendContent(Content &content) const
+	{
+		Shader::appendContent(content);
+		append(content, input, sizeof(input));
+
+		const int flags[] = {vPosDeclared, vFaceDeclared, zOverride, kill, centroid};
+
+		append(content, flags, sizeof(flags));
+	}
+
+	void PixelShader::serialize(BinaryWriter &binary) const
+	{
+		Shader::serialize(binary);
+
+		binary.write(input);
+		binary.write(vPosDeclared);
+		binary.write(vFaceDeclared);
+	}
+
+	bool PixelShader::deserialize(BinaryReader &binary)
+	{
+		if(!Shader::deserialize(binary))
+		{
+			return false;
+		}
+
+		binary.read(input);
+		binary.read(vPosDeclared);
+		binary.read(vFaceDeclared);
+
+		// The setup and pixel processors turn these into vertex output indices
+		for(int i = 0; i < MAX_FRAGMENT_INPUTS; i++)
+		{
+			for(int component = 0; component < 4; component++)
+			{
+				const Semantic &semantic = input[i][component];
+
+				switch(semantic.usage)
+				{
+				case 0xFF:
+					break;
+				case USAGE_TEXCOORD:
+					if(semantic.index >= MAX_VERTEX_OUTPUTS - T0) return false;
+					break;
+				case USAGE_COLOR:
+					if(semantic.index >= MAX_VERTEX_OUTPUTS - C0) return false;
+					break;
+				default:
+					return false;
+				}
+			}
+		}
+
+		return !binary.failed();
+	}
+
 	void PixelShader::setInput(int inputIdx, int nbComponents, const sw::Shader::Semantic& semantic)
 	{
 		for(int i = 0; i < nbComponents; ++i)
@@ -151,16 +211,192 @@ namespace sw
 		return input[inputIdx][component];
 	}
 
+	bool PixelShader::isInputLazy(int inputIdx) const
+	{
+		return lazyInput[inputIdx];
+	}
+
+	void PixelShader::analyzeLazyInputs()
+	{
+		for(int i = 0; i < MAX_FRAGMENT_INPUTS; i++)
+		{
+			lazyInput[i] = false;
+		}
+
+		if(shaderModel < 0x0300)
+		{
+			return;
+		}
+
+		// Inputs read by a few instructions which are all inside of conditional
+		// blocks, but not in loops or subroutines, are interpolated at each read.
+		const int maxLazyReads = 2;
+
+		int reads[MAX_FRAGMENT_INPUTS] = {0};
+		bool eager[MAX_FRAGMENT_INPUTS] = {false};
+		int conditionalDepth = 0;
+		int loopDepth = 0;
+		bool subroutine = false;
+
+		for(const auto &inst : instruction)
+		{
+			switch(inst->opcode)
+			{
+			case OPCODE_IF:
+			case OPCODE_IFC:
+			case OPCODE_SWITCH:
+				conditionalDepth++;
+				break;
+			case OPCODE_ENDIF:
+			case OPCODE_ENDSWITCH:
+				conditionalDepth--;
+				break;
+			case OPCODE_LOOP:
+			case OPCODE_REP:
+			case OPCODE_WHILE:
+				loopDepth++;
+				break;
+			case OPCODE_ENDLOOP:
+			case OPCODE_ENDREP:
+			case OPCODE_ENDWHILE:
+				loopDepth--;
+				break;
+			case OPCODE_LABEL:
+				subroutine = true;
+				break;
+			default:
+				break;
+			}
+
+			for(int i = 0; i < 5; i++)
+			{
+				const SourceParameter &src = inst->src[i];
+
+				if(src.rel.type == PARAMETER_INPUT && src.rel.index < MAX_FRAGMENT_INPUTS)
+				{
+					eager[src.rel.index] = true;
+				}
+
+				if(src.type != PARAMETER_INPUT)
+				{
+					continue;
+				}
+
+				if(src.rel.type != PARAMETER_VOID)
+				{
+					return;   // Dynamically indexed
+				}
+
+				if(src.index >= MAX_FRAGMENT_INPUTS)
+				{
+					continue;
+				}
+
+				reads[src.index]++;
+
+				bool matrix = inst->opcode == OPCODE_M3X2 || inst->opcode == OPCODE_M3X3 || inst->opcode == OPCODE_M3X4 ||
+				              inst->opcode == OPCODE_M4X3 || inst->opcode == OPCODE_M4X4;
+
+				if(matrix)   // Also reads the next rows
+				{
+					for(unsigned int r = 0; r < 4 && src.index + r < MAX_FRAGMENT_INPUTS; r++)
+					{
+						eager[src.index + r] = true;
+					}
+				}
+				else if(conditionalDepth == 0 || loopDepth > 0 || subroutine)
+				{
+					eager[src.index] = true;
+				}
+			}
+		}
+
+		for(int i = 0; i < MAX_FRAGMENT_INPUTS; i++)
+		{
+			lazyInput[i] = !eager[i] && reads[i] > 0 && reads[i] <= maxLazyReads;
+		}
+	}
+
+	void PixelShader::removeUnreadInputs()
+	{
+		if(shaderModel < 0x0300)
+		{
+			return;   // Inputs are implied by the instructions
+		}
+
+		unsigned char read[MAX_FRAGMENT_INPUTS] = {0};   // Component masks
+
+		for(const auto &inst : instruction)
+		{
+			for(int i = 0; i < 5; i++)
+			{
+				const SourceParameter &src = inst->src[i];
+
+				if(src.type != PARAMETER_INPUT)
+				{
+					continue;
+				}
+
+				if(src.rel.type != PARAMETER_VOID || src.index >= MAX_FRAGMENT_INPUTS)
+				{
+					return;   // Dynamically indexed, any input may be read
+				}
+
+				int registers = 1;
+
+				switch(inst->opcode)
+				{
+				case OPCODE_M3X2: registers = (i == 1) ? 2 : 1; break;
+				case OPCODE_M3X3: registers = (i == 1) ? 3 : 1; break;
+				case OPCODE_M3X4: registers = (i == 1) ? 4 : 1; break;
+				case OPCODE_M4X3: registers = (i == 1) ? 3 : 1; break;
+				case OPCODE_M4X4: registers = (i == 1) ? 4 : 1; break;
+				default: break;
+				}
+
+				// The swizzle replicates components for the unused lanes
+				unsigned char mask = 0;
+				for(int c = 0; c < 4; c++)
+				{
+					mask |= 1 << ((src.swizzle >> (2 * c)) & 0x03);
+				}
+
+				for(int r = 0; r < registers && src.index + r < MAX_FRAGMENT_INPUTS; r++)
+				{
+					read[src.index + r] |= (registers > 1) ? 0x0F : mask;
+				}
+			}
+		}
+
+		for(int i = 0; i < MAX_FRAGMENT_INPUTS; i++)
+		{
+			if(read[i])
+			{
+				read[i] |= 0x01;   // The first component holds the centroid qualifier for all of them
+			}
+
+			for(int c = 0; c < 4; c++)
+			{
+				if(!(read[i] & (1 << c)))
+				{
+					input[i][c] = Semantic();
+				}
+			}
+		}
+	}
+
 	void PixelShader::analyze()
 	{
 		analyzeZOverride();
 		analyzeKill();
 		analyzeInterpolants();
+		analyzeLazyInputs();
 		analyzeDirtyConstants();
 		analyzeDynamicBranching();
 		analyzeSamplers();
 		analyzeCallSites();
 		analyzeIndirectAddressing();
+		analyzeBranchConstants();
 	}
 
 	void PixelShader::analyzeZOverride()
@@ -35,9 +35,14 @@ namespace sw
 		bool usesDiffuse(int component) const;
 		bool usesSpecular(int component) const;
 		bool usesTexture(int coordinate, int component) const;
+		void appendContent(Content &content) const override;
+		void serialize(BinaryWriter &binary) const override;
+		bool deserialize(BinaryReader &binary) override;
 
 		void setInput(int inputIdx, int nbComponents, const Semantic& semantic);
 		const Semantic& getInput(int inputIdx, int component) const;
+		void removeUnreadInputs();   // Deactivates input components which no instruction reads, so they don't get interpolated
+		bool isInputLazy(int inputIdx) const;   // Only read in conditional code, so interpolated where it's read
 
 		void declareVPos() { vPosDeclared = true; }
 		void declareVFace() { vFaceDeclared = true; }
@@ -49,8 +54,10 @@ namespace sw
 		void analyzeZOverride();
 		void analyzeKill();
 		void analyzeInterpolants();
+		void analyzeLazyInputs();
 
 		Semantic input[MAX_FRAGMENT_INPUTS][4];
+		bool lazyInput[MAX_FRAGMENT_INPUTS];
 
 		bool vPosDeclared;
 		bool vFaceDeclared;
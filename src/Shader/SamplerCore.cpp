@@ -102,7 +102,11 @@ namespace sw
 			Float4 uDelta;
 			Float4 vDelta;
 
-			if(state.textureType != TEXTURE_3D)
+			if(isBilinearRGBA8(function) && state.mipmapFilter == MIPMAP_NONE)
+			{
+				// The level of detail only selects the mipmap, so it doesn't need to be computed
+			}
+			else if(state.textureType != TEXTURE_3D)
 			{
 				if(state.textureType != TEXTURE_CUBE)
 				{
@@ -209,6 +213,9 @@ namespace sw
 					case FORMAT_V16U16:
 					case FORMAT_A16W16V16U16:
 					case FORMAT_Q16W16V16U16:
+					case FORMAT_DXT1:
+					case FORMAT_DXT3:
+					case FORMAT_DXT5:
 					case FORMAT_YV12_BT601:
 					case FORMAT_YV12_BT709:
 					case FORMAT_YV12_JFIF:
@@ -266,6 +273,10 @@ namespace sw
 					applySwizzle(state.swizzleB, c.z, col);
 					applySwizzle(state.swizzleA, c.w, col);
 				}
+				else if(state.dynamicSwizzle)
+				{
+					applyDynamicSwizzle(texture, c);
+				}
 			}
 		}
 
@@ -437,6 +448,9 @@ namespace sw
 				case FORMAT_V16U16:
 				case FORMAT_A16W16V16U16:
 				case FORMAT_Q16W16V16U16:
+				case FORMAT_DXT1:
+				case FORMAT_DXT3:
+				case FORMAT_DXT5:
 				case FORMAT_YV12_BT601:
 				case FORMAT_YV12_BT709:
 				case FORMAT_YV12_JFIF:
@@ -494,11 +508,49 @@ namespace sw
 				applySwizzle(state.swizzleB, c.z, col);
 				applySwizzle(state.swizzleA, c.w, col);
 			}
+			else if(state.dynamicSwizzle)
+			{
+				applyDynamicSwizzle(texture, c);
+			}
 		}
 
 		return c;
 	}
 
+	void SamplerCore::applyDynamicSwizzle(Pointer<Byte> &texture, Vector4s &c)
+	{
+		Vector4s col(c);
+
+		for(int i = 0; i < 4; i++)
+		{
+			Short4 s = Short4(0x1000) & Short4(*Pointer<Int>(texture + OFFSET(Texture,swizzleMask[i][4])));
+
+			for(int j = 0; j < 4; j++)
+			{
+				s |= col[j] & Short4(*Pointer<Int>(texture + OFFSET(Texture,swizzleMask[i][j])));
+			}
+
+			c[i] = s;
+		}
+	}
+
+	void SamplerCore::applyDynamicSwizzle(Pointer<Byte> &texture, Vector4f &c)
+	{
+		Vector4f col(c);
+
+		for(int i = 0; i < 4; i++)
+		{
+			Int4 f = As<Int4>(Float4(1.0f)) & Int4(*Pointer<Int>(texture + OFFSET(Texture,swizzleMask[i][4])));
+
+			for(int j = 0; j < 4; j++)
+			{
+				f |= As<Int4>(col[j]) & Int4(*Pointer<Int>(texture + OFFSET(Texture,swizzleMask[i][j])));
+			}
+
+			c[i] = As<Float4>(f);
+		}
+	}
+
 	Vector4f SamplerCore::textureSize(Pointer<Byte> &texture, Float4 &lod)
 	{
 		Vector4f size;
@@ -699,21 +751,52 @@ namespace sw
 
 			Int i = 0;
 
-			Do
+			if(state.adaptiveAnisotropy)
+			{
+				// Sample both ends of the footprint first, and skip the interior when they're nearly equal
+				If(a > 2)
+				{
+					Float4 n = Float4(Float(a - 1));
+					Float4 u1 = u0 + du * n;
+					Float4 v1 = v0 + dv * n;
+
+					Vector4s c0 = sampleQuad(texture, u0, v0, w, offset, lod, face, secondLOD, function);
+					Vector4s c1 = sampleQuad(texture, u1, v1, w, offset, lod, face, secondLOD, function);
+
+					If(nearlyEqual(c0, c1))
+					{
+						// Average in the scaled domain of the weighted sum
+						if(hasUnsignedTextureComponent(0)) cSum.x = As<Short4>(Average(As<UShort4>(c0.x), As<UShort4>(c1.x))); else cSum.x = (c0.x >> 2) + (c1.x >> 2);
+						if(hasUnsignedTextureComponent(1)) cSum.y = As<Short4>(Average(As<UShort4>(c0.y), As<UShort4>(c1.y))); else cSum.y = (c0.y >> 2) + (c1.y >> 2);
+						if(hasUnsignedTextureComponent(2)) cSum.z = As<Short4>(Average(As<UShort4>(c0.z), As<UShort4>(c1.z))); else cSum.z = (c0.z >> 2) + (c1.z >> 2);
+						if(hasUnsignedTextureComponent(3)) cSum.w = As<Short4>(Average(As<UShort4>(c0.w), As<UShort4>(c1.w))); else cSum.w = (c0.w >> 2) + (c1.w >> 2);
+
+						i = a;
+					}
+					Else
+					{
+						accumulateAniso(cSum, c0, cw, sw);
+						accumulateAniso(cSum, c1, cw, sw);
+
+						u0 += du;
+						v0 += dv;
+
+						i = 2;
+					}
+				}
+			}
+
+			While(i < a)
 			{
 				c = sampleQuad(texture, u0, v0, w, offset, lod, face, secondLOD, function);
 
 				u0 += du;
 				v0 += dv;
 
-				if(hasUnsignedTextureComponent(0)) cSum.x += As<Short4>(MulHigh(As<UShort4>(c.x), cw)); else cSum.x += MulHigh(c.x, sw);
-				if(hasUnsignedTextureComponent(1)) cSum.y += As<Short4>(MulHigh(As<UShort4>(c.y), cw)); else cSum.y += MulHigh(c.y, sw);
-				if(hasUnsignedTextureComponent(2)) cSum.z += As<Short4>(MulHigh(As<UShort4>(c.z), cw)); else cSum.z += MulHigh(c.z, sw);
-				if(hasUnsignedTextureComponent(3)) cSum.w += As<Short4>(MulHigh(As<UShort4>(c.w), cw)); else cSum.w += MulHigh(c.w, sw);
+				accumulateAniso(cSum, c, cw, sw);
 
 				i++;
 			}
-			Until(i >= a)
 
 			if(hasUnsignedTextureComponent(0)) c.x = cSum.x; else c.x = AddSat(cSum.x, cSum.x);
 			if(hasUnsignedTextureComponent(1)) c.y = cSum.y; else c.y = AddSat(cSum.y, cSum.y);
@@ -724,6 +807,51 @@ namespace sw
 		return c;
 	}
 
+	void SamplerCore::accumulateAniso(Vector4s &cSum, Vector4s &c, UShort4 &cw, Short4 &sw)
+	{
+		if(hasUnsignedTextureComponent(0)) cSum.x += As<Short4>(MulHigh(As<UShort4>(c.x), cw)); else cSum.x += MulHigh(c.x, sw);
+		if(hasUnsignedTextureComponent(1)) cSum.y += As<Short4>(MulHigh(As<UShort4>(c.y), cw)); else cSum.y += MulHigh(c.y, sw);
+		if(hasUnsignedTextureComponent(2)) cSum.z += As<Short4>(MulHigh(As<UShort4>(c.z), cw)); else cSum.z += MulHigh(c.z, sw);
+		if(hasUnsignedTextureComponent(3)) cSum.w += As<Short4>(MulHigh(As<UShort4>(c.w), cw)); else cSum.w += MulHigh(c.w, sw);
+	}
+
+	Bool SamplerCore::nearlyEqual(Vector4s &c0, Vector4s &c1)
+	{
+		// True when no component of any pixel differs by more than about one 8-bit step
+		Int4 different = Int4(0);
+
+		for(int component = 0; component < textureComponentCount(); component++)
+		{
+			if(hasUnsignedTextureComponent(component))
+			{
+				Int4 difference = Abs(Int4(As<UShort4>(c0[component])) - Int4(As<UShort4>(c1[component])));
+				different |= CmpNLE(difference, Int4(0x0100));
+			}
+			else
+			{
+				Int4 difference = Abs(Int4(c0[component]) - Int4(c1[component]));
+				different |= CmpNLE(difference, Int4(0x0080));
+			}
+		}
+
+		return SignMask(different) == 0;
+	}
+
+	Bool SamplerCore::nearlyEqual(Vector4f &c0, Vector4f &c1)
+	{
+		// True when no component of any pixel differs by more than about 1/512 of its magnitude
+		Int4 different = Int4(0);
+
+		for(int component = 0; component < textureComponentCount(); component++)
+		{
+			Float4 difference = Abs(c0[component] - c1[component]);
+			Float4 tolerance = (Abs(c0[component]) + Abs(c1[component])) * Float4(1.0f / 1024.0f);
+			different |= CmpNLE(difference, tolerance);
+		}
+
+		return SignMask(different) == 0;
+	}
+
 	Vector4s SamplerCore::sampleQuad(Pointer<Byte> &texture, Float4 &u, Float4 &v, Float4 &w, Vector4f &offset, Float &lod, Int face[4], bool secondLOD, SamplerFunction function)
 	{
 		if(state.textureType != TEXTURE_3D)
@@ -738,6 +866,11 @@ namespace sw
 
 	Vector4s SamplerCore::sampleQuad2D(Pointer<Byte> &texture, Float4 &u, Float4 &v, Float4 &w, Vector4f &offset, Float &lod, Int face[4], bool secondLOD, SamplerFunction function)
 	{
+		if(isBilinearRGBA8(function))
+		{
+			return sampleBilinearRGBA8(texture, u, v, lod, face, secondLOD);
+		}
+
 		Vector4s c;
 
 		int componentCount = textureComponentCount();
@@ -931,6 +1064,132 @@ namespace sw
 		return c;
 	}
 
+	Vector4s SamplerCore::sampleBilinearRGBA8(Pointer<Byte> &texture, Float4 &u, Float4 &v, Float &lod, Int face[4], bool secondLOD)
+	{
+		// Produces the same result as sampleQuad2D, but computes the texel indices of all four
+		// corners from a single base index, fetches each corner with one gather, and shares the
+		// coordinate and weight computations between them.
+		Pointer<Byte> mipmap;
+		Pointer<Byte> buffer[4];
+
+		selectMipmap(texture, buffer, mipmap, lod, face, secondLOD);
+
+		UShort4 uuuu = As<UShort4>(address(u, ADDRESSING_CLAMP, mipmap));
+		UShort4 vvvv = As<UShort4>(address(v, ADDRESSING_CLAMP, mipmap));
+
+		UShort4 uuuu0 = SubSat(uuuu, *Pointer<UShort4>(mipmap + OFFSET(Mipmap,uHalf)));
+		UShort4 vvvv0 = SubSat(vvvv, *Pointer<UShort4>(mipmap + OFFSET(Mipmap,vHalf)));
+		UShort4 uuuu1 = AddSat(uuuu, *Pointer<UShort4>(mipmap + OFFSET(Mipmap,uHalf)));
+		UShort4 vvvv1 = AddSat(vvvv, *Pointer<UShort4>(mipmap + OFFSET(Mipmap,vHalf)));
+
+		UShort4 width = *Pointer<UShort4>(mipmap + OFFSET(Mipmap,width));
+		UShort4 height = *Pointer<UShort4>(mipmap + OFFSET(Mipmap,height));
+
+		// Texel coordinates. The far corners coincide with the near ones at the clamped edges.
+		Short4 x0 = As<Short4>(MulHigh(uuuu0, width));
+		Short4 y0 = As<Short4>(MulHigh(vvvv0, height));
+		Short4 dx = As<Short4>(MulHigh(uuuu1, width)) - x0;
+		Short4 dy = As<Short4>(MulHigh(vvvv1, height)) - y0;
+
+		Int4 index00;
+		Int4 index10;
+		Int4 index01;
+		Int4 index11;
+
+		if(state.tiledLayout)
+		{
+			// Tiled indices aren't linear in the coordinates, so compute each corner separately
+			index00 = texelIndex(x0, y0, mipmap);
+			index10 = texelIndex(x0 + dx, y0, mipmap);
+			index01 = texelIndex(x0, y0 + dy, mipmap);
+			index11 = texelIndex(x0 + dx, y0 + dy, mipmap);
+		}
+		else
+		{
+			Short4 onePitchP = *Pointer<Short4>(mipmap + OFFSET(Mipmap,onePitchP));
+
+			index00 = Int4(MulAdd(As<Short4>(UnpackLow(x0, y0)), onePitchP), MulAdd(As<Short4>(UnpackHigh(x0, y0)), onePitchP));
+			Int4 delta11(MulAdd(As<Short4>(UnpackLow(dx, dy)), onePitchP), MulAdd(As<Short4>(UnpackHigh(dx, dy)), onePitchP));
+			Int4 delta10 = Int4(dx);
+
+			index10 = index00 + delta10;
+			index01 = index00 + (delta11 - delta10);
+			index11 = index00 + delta11;
+		}
+
+		Pointer<Int> texels = Pointer<Int>(buffer[0]);
+
+		Vector4s c0 = unpackRGBA8(Gather(texels, index00 << 2));
+		Vector4s c1 = unpackRGBA8(Gather(texels, index10 << 2));
+		Vector4s c2 = unpackRGBA8(Gather(texels, index01 << 2));
+		Vector4s c3 = unpackRGBA8(Gather(texels, index11 << 2));
+
+		// Fractions
+		UShort4 f0u = uuuu0 * width;
+		UShort4 f0v = vvvv0 * height;
+
+		UShort4 f1u = ~f0u;
+		UShort4 f1v = ~f0v;
+
+		UShort4 f0u0v = MulHigh(f0u, f0v);
+		UShort4 f1u0v = MulHigh(f1u, f0v);
+		UShort4 f0u1v = MulHigh(f0u, f1v);
+		UShort4 f1u1v = MulHigh(f1u, f1v);
+
+		Vector4s c;
+
+		for(int component = 0; component < textureComponentCount(); component++)
+		{
+			c0[component] = MulHigh(As<UShort4>(c0[component]), f1u1v);
+			c1[component] = MulHigh(As<UShort4>(c1[component]), f0u1v);
+			c2[component] = MulHigh(As<UShort4>(c2[component]), f1u0v);
+			c3[component] = MulHigh(As<UShort4>(c3[component]), f0u0v);
+
+			c[component] = (c0[component] + c1[component]) + (c2[component] + c3[component]);
+		}
+
+		return c;
+	}
+
+	Vector4s SamplerCore::unpackRGBA8(RValue<Int4> texels)
+	{
+		Vector4s c;
+
+		Int4 t = texels;
+		c.x = As<Short4>(Int2(t));
+		c.y = As<Short4>(Int2(Swizzle(t, 0xEE)));
+
+		switch(state.textureFormat)
+		{
+		case FORMAT_A8R8G8B8:
+		case FORMAT_X8R8G8B8:
+			c.z = As<Short4>(UnpackLow(c.x, c.y));
+			c.x = As<Short4>(UnpackHigh(c.x, c.y));
+			c.y = c.z;
+			c.w = c.x;
+			c.z = UnpackLow(As<Byte8>(c.z), As<Byte8>(c.z));
+			c.y = UnpackHigh(As<Byte8>(c.y), As<Byte8>(c.y));
+			c.x = UnpackLow(As<Byte8>(c.x), As<Byte8>(c.x));
+			c.w = UnpackHigh(As<Byte8>(c.w), As<Byte8>(c.w));
+			break;
+		case FORMAT_A8B8G8R8:
+		case FORMAT_X8B8G8R8:
+			c.z = As<Short4>(UnpackHigh(c.x, c.y));
+			c.x = As<Short4>(UnpackLow(c.x, c.y));
+			c.y = c.x;
+			c.w = c.z;
+			c.x = UnpackLow(As<Byte8>(c.x), As<Byte8>(c.x));
+			c.y = UnpackHigh(As<Byte8>(c.y), As<Byte8>(c.y));
+			c.z = UnpackLow(As<Byte8>(c.z), As<Byte8>(c.z));
+			c.w = UnpackHigh(As<Byte8>(c.w), As<Byte8>(c.w));
+			break;
+		default:
+			ASSERT(false);
+		}
+
+		return c;
+	}
+
 	Vector4s SamplerCore::sample3D(Pointer<Byte> &texture, Float4 &u_, Float4 &v_, Float4 &w_, Vector4f &offset, Float &lod, bool secondLOD, SamplerFunction function)
 	{
 		Vector4s c_;
@@ -1058,6 +1317,14 @@ namespace sw
 
 	Vector4f SamplerCore::sampleFloatFilter(Pointer<Byte> &texture, Float4 &u, Float4 &v, Float4 &w, Float4 &q, Vector4f &offset, Float &lod, Float &anisotropy, Float4 &uDelta, Float4 &vDelta, Int face[4], SamplerFunction function)
 	{
+		if(state.dynamicCompare)
+		{
+			for(int i = 0; i < 3; i++)
+			{
+				compareMask[i] = Int4(*Pointer<Int>(texture + OFFSET(Texture,compareMask[i])));
+			}
+		}
+
 		Vector4f c = sampleFloatAniso(texture, u, v, w, q, offset, lod, anisotropy, uDelta, vDelta, face, false, function);
 
 		if(function == Fetch)
@@ -1169,7 +1436,43 @@ namespace sw
 
 			Int i = 0;
 
-			Do
+			if(state.adaptiveAnisotropy)
+			{
+				// Sample both ends of the footprint first, and skip the interior when they're nearly equal
+				If(a > 2)
+				{
+					Float4 n = Float4(Float(a - 1));
+					Float4 u1 = u0 + du * n;
+					Float4 v1 = v0 + dv * n;
+
+					Vector4f c0 = sampleFloat(texture, u0, v0, w, q, offset, lod, face, secondLOD, function);
+					Vector4f c1 = sampleFloat(texture, u1, v1, w, q, offset, lod, face, secondLOD, function);
+
+					If(nearlyEqual(c0, c1))
+					{
+						cSum.x = (c0.x + c1.x) * Float4(0.5f);
+						cSum.y = (c0.y + c1.y) * Float4(0.5f);
+						cSum.z = (c0.z + c1.z) * Float4(0.5f);
+						cSum.w = (c0.w + c1.w) * Float4(0.5f);
+
+						i = a;
+					}
+					Else
+					{
+						cSum.x = (c0.x + c1.x) * A;
+						cSum.y = (c0.y + c1.y) * A;
+						cSum.z = (c0.z + c1.z) * A;
+						cSum.w = (c0.w + c1.w) * A;
+
+						u0 += du;
+						v0 += dv;
+
+						i = 2;
+					}
+				}
+			}
+
+			While(i < a)
 			{
 				c = sampleFloat(texture, u0, v0, w, q, offset, lod, face, secondLOD, function);
 
@@ -1183,7 +1486,6 @@ namespace sw
 
 				i++;
 			}
-			Until(i >= a)
 
 			c.x = cSum.x;
 			c.y = cSum.y;
@@ -1226,7 +1528,7 @@ namespace sw
 		address(w, z0, z0, fv, mipmap, offset.z, filter, OFFSET(Mipmap, depth), state.addressingModeW, function);
 
 		Int4 pitchP = *Pointer<Int4>(mipmap + OFFSET(Mipmap, pitchP), 16);
-		y0 *= pitchP;
+		computeOffsets(x0, y0, pitchP, mipmap);
 		if(hasThirdCoordinate())
 		{
 			Int4 sliceP = *Pointer<Int4>(mipmap + OFFSET(Mipmap, sliceP), 16);
@@ -1239,7 +1541,7 @@ namespace sw
 		}
 		else
 		{
-			y1 *= pitchP;
+			computeOffsets(x1, y1, pitchP, mipmap);
 
 			Vector4f c0 = sampleTexel(x0, y0, z0, q, mipmap, buffer, function);
 			Vector4f c1 = sampleTexel(x1, y0, z0, q, mipmap, buffer, function);
@@ -1296,7 +1598,7 @@ namespace sw
 
 		Int4 pitchP = *Pointer<Int4>(mipmap + OFFSET(Mipmap, pitchP), 16);
 		Int4 sliceP = *Pointer<Int4>(mipmap + OFFSET(Mipmap, sliceP), 16);
-		y0 *= pitchP;
+		computeOffsets(x0, y0, pitchP, mipmap);
 		z0 *= sliceP;
 
 		if(state.textureFilter == FILTER_POINT || (function == Fetch))
@@ -1305,7 +1607,7 @@ namespace sw
 		}
 		else
 		{
-			y1 *= pitchP;
+			computeOffsets(x1, y1, pitchP, mipmap);
 			z1 *= sliceP;
 
 			Vector4f c0 = sampleTexel(x0, y0, z0, w, mipmap, buffer, function);
@@ -1380,6 +1682,13 @@ namespace sw
 
 	void SamplerCore::computeLod(Pointer<Byte> &texture, Float &lod, Float &anisotropy, Float4 &uDelta, Float4 &vDelta, Float4 &uuuu, Float4 &vvvv, const Float &lodBias, Vector4f &dsx, Vector4f &dsy, SamplerFunction function)
 	{
+		if(state.constantLod)
+		{
+			// minLod equals maxLod, or the only level is sampled regardless of LOD
+			lod = *Pointer<Float>(texture + OFFSET(Texture, minLod));
+			return;
+		}
+
 		if(function != Lod && function != Fetch)
 		{
 			Float4 duvdxy;
@@ -1451,6 +1760,13 @@ namespace sw
 
 	void SamplerCore::computeLodCube(Pointer<Byte> &texture, Float &lod, Float4 &u, Float4 &v, Float4 &w, const Float &lodBias, Vector4f &dsx, Vector4f &dsy, Float4 &M, SamplerFunction function)
 	{
+		if(state.constantLod)
+		{
+			// minLod equals maxLod, or the only level is sampled regardless of LOD
+			lod = *Pointer<Float>(texture + OFFSET(Texture, minLod));
+			return;
+		}
+
 		if(function != Lod && function != Fetch)
 		{
 			Float4 dudxy, dvdxy, dsdxy;
@@ -1517,6 +1833,13 @@ namespace sw
 
 	void SamplerCore::computeLod3D(Pointer<Byte> &texture, Float &lod, Float4 &uuuu, Float4 &vvvv, Float4 &wwww, const Float &lodBias, Vector4f &dsx, Vector4f &dsy, SamplerFunction function)
 	{
+		if(state.constantLod)
+		{
+			// minLod equals maxLod, or the only level is sampled regardless of LOD
+			lod = *Pointer<Float>(texture + OFFSET(Texture, minLod));
+			return;
+		}
+
 		if(function != Lod && function != Fetch)
 		{
 			Float4 dudxy, dvdxy, dsdxy;
@@ -1598,19 +1921,15 @@ namespace sw
 		// FACE_POSITIVE_Z = 100b
 		// FACE_NEGATIVE_Z = 101b
 
-		Int yAxis = SignMask(yMajor);
-		Int zAxis = SignMask(zMajor);
-
 		Int4 n = ((xn & xMajor) | (yn & yMajor) | (zn & zMajor)) & Int4(0x80000000);
-		Int negative = SignMask(n);
 
-		face[0] = *Pointer<Int>(constants + OFFSET(Constants,transposeBit0) + negative * 4);
-		face[0] |= *Pointer<Int>(constants + OFFSET(Constants,transposeBit1) + yAxis * 4);
-		face[0] |= *Pointer<Int>(constants + OFFSET(Constants,transposeBit2) + zAxis * 4);
-		face[1] = (face[0] >> 4)  & 0x7;
-		face[2] = (face[0] >> 8)  & 0x7;
-		face[3] = (face[0] >> 12) & 0x7;
-		face[0] &= 0x7;
+		// Assemble all four face indices in one register, and only then move them to scalars
+		Int4 faces = (As<Int4>(As<UInt4>(n) >> 31)) | (yMajor & Int4(2)) | (zMajor & Int4(4));
+
+		face[0] = Extract(faces, 0);
+		face[1] = Extract(faces, 1);
+		face[2] = Extract(faces, 2);
+		face[3] = Extract(faces, 3);
 
 		M = Max(Max(absX, absY), absZ);
 
@@ -1671,6 +1990,11 @@ namespace sw
 			vvvv = applyOffset(vvvv, offset.y, Int4(h), texelFetch ? ADDRESSING_TEXELFETCH : state.addressingModeV);
 		}
 
+		if(state.tiledLayout)
+		{
+			tileCoordinates(uuuu, vvvv, mipmap);
+		}
+
 		Short4 uuu2 = uuuu;
 		uuuu = As<Short4>(UnpackLow(uuuu, vvvv));
 		uuu2 = As<Short4>(UnpackHigh(uuu2, vvvv));
@@ -1727,6 +2051,16 @@ namespace sw
 	}
 
 	void SamplerCore::computeIndices(UInt index[4], Int4& uuuu, Int4& vvvv, Int4& wwww, const Pointer<Byte> &mipmap, SamplerFunction function)
+	{
+		UInt4 indices = computeIndexVector(uuuu, vvvv, wwww);
+
+		for(int i = 0; i < 4; i++)
+		{
+			index[i] = Extract(As<Int4>(indices), i);
+		}
+	}
+
+	UInt4 SamplerCore::computeIndexVector(Int4& uuuu, Int4& vvvv, Int4& wwww)
 	{
 		UInt4 indices = uuuu + vvvv;
 
@@ -1735,9 +2069,43 @@ namespace sw
 			indices += As<UInt4>(wwww);
 		}
 
-		for(int i = 0; i < 4; i++)
+		return indices;
+	}
+
+	void SamplerCore::tileCoordinates(Short4 &uuuu, Short4 &vvvv, const Pointer<Byte> &mipmap)
+	{
+		// Moves the texel's position within its 4x4 tile into the column, so that
+		// column + row * pitch still yields its index in the tiled layout.
+		Short4 tileMask = *Pointer<Short4>(mipmap + OFFSET(Mipmap, tileMask));
+		Short4 tileScale = *Pointer<Short4>(mipmap + OFFSET(Mipmap, tileScale));
+
+		uuuu = (uuuu & tileMask) + ((vvvv & tileMask) << 2) + (uuuu & ~tileMask) * tileScale;
+		vvvv = vvvv & ~tileMask;
+	}
+
+	Int4 SamplerCore::texelIndex(Short4 uuuu, Short4 vvvv, const Pointer<Byte> &mipmap)
+	{
+		tileCoordinates(uuuu, vvvv, mipmap);
+
+		Short4 onePitchP = *Pointer<Short4>(mipmap + OFFSET(Mipmap,onePitchP));
+
+		return Int4(MulAdd(As<Short4>(UnpackLow(uuuu, vvvv)), onePitchP), MulAdd(As<Short4>(UnpackHigh(uuuu, vvvv)), onePitchP));
+	}
+
+	void SamplerCore::computeOffsets(Int4 &x, Int4 &y, const Int4 &pitchP, const Pointer<Byte> &mipmap)
+	{
+		// Turns texel coordinates into column and row offsets which sum to the texel's index
+		if(state.tiledLayout)
 		{
-			index[i] = Extract(As<Int4>(indices), i);
+			Int4 tileMask = Int4(*Pointer<Short4>(mipmap + OFFSET(Mipmap, tileMask)));
+			Int4 tileScale = Int4(*Pointer<Short4>(mipmap + OFFSET(Mipmap, tileScale)));
+
+			x = (x & tileMask) + (x & ~tileMask) * tileScale;
+			y = ((y & tileMask) << 2) + (y & ~tileMask) * pitchP;
+		}
+		else
+		{
+			y *= pitchP;
 		}
 	}
 
@@ -2002,6 +2370,120 @@ namespace sw
 		return c;
 	}
 
+	Vector4s SamplerCore::sampleCompressedTexel(UInt index[4], Pointer<Byte> buffer[4], Pointer<Byte> &mipmap)
+	{
+		ASSERT(state.textureFormat == FORMAT_DXT1 || state.textureFormat == FORMAT_DXT3 || state.textureFormat == FORMAT_DXT5);
+
+		// DXT3 and DXT5 blocks start with 64 bits of alpha, followed by a DXT1 color block
+		const bool alphaBlock = (state.textureFormat != FORMAT_DXT1);
+		const int blockSize = alphaBlock ? 16 : 8;
+		const int colorOffset = alphaBlock ? 8 : 0;
+
+		Vector4s c;
+
+		// The index holds the texel coordinates packed as u + (v << 14), see Sampler::setTextureLevel()
+		Int width = Int(*Pointer<Short>(mipmap + OFFSET(Mipmap, width)));
+		Int blockPitchB = ((width + 3) >> 2) * blockSize;
+
+		Int4 colors;
+		Int4 selector;
+		Int4 alpha;   // DXT3: 4-bit alpha, DXT5: end points in the low 16 bits and the 3-bit index above
+
+		for(int i = 0; i < 4; i++)
+		{
+			Int u = As<Int>(index[i] & UInt(0x3FFF));
+			Int v = As<Int>(index[i] >> 14);
+
+			Pointer<Byte> block = buffer[0] + (v >> 2) * blockPitchB + (u >> 2) * blockSize;
+			Int texel = ((v & Int(3)) << 2) + (u & Int(3));
+
+			colors = Insert(colors, *Pointer<Int>(block + colorOffset), i);
+			selector = Insert(selector, (*Pointer<Int>(block + colorOffset + 4) >> (texel << 1)) & Int(3), i);
+
+			if(state.textureFormat == FORMAT_DXT3)
+			{
+				Int nibble = texel << 2;
+				alpha = Insert(alpha, (*Pointer<Int>(block + ((nibble >> 5) << 2)) >> (nibble & Int(31))) & Int(0xF), i);
+			}
+			else if(state.textureFormat == FORMAT_DXT5)
+			{
+				// The index may straddle a 32-bit boundary, so it's read from the byte it starts in
+				Int bit = Int(16) + texel * Int(3);
+				Int endPoints = Int(*Pointer<UShort>(block));
+				alpha = Insert(alpha, endPoints | (((*Pointer<Int>(block + (bit >> 3)) >> (bit & Int(7))) & Int(7)) << 16), i);
+			}
+		}
+
+		Int4 c0 = colors & Int4(0xFFFF);
+		Int4 c1 = As<Int4>(As<UInt4>(colors) >> 16);
+		Int4 opaque = Int4(-1);   // DXT3 and DXT5 colors always use four values
+
+		if(!alphaBlock)
+		{
+			opaque = CmpNLE(c0, c1);   // c0 > c1, else c3 is transparent black
+		}
+
+		// Expand the 5:6:5 end points to eight bits, identical to Surface::decodeDXT1()
+		Int4 e0[3];
+		Int4 e1[3];
+		e0[0] = ((c0 & Int4(0xF800)) >> 8) | ((c0 & Int4(0xE000)) >> 13);
+		e0[1] = ((c0 & Int4(0x07E0)) >> 3) | ((c0 & Int4(0x0600)) >> 9);
+		e0[2] = ((c0 & Int4(0x001F)) << 3) | ((c0 & Int4(0x001C)) >> 2);
+		e1[0] = ((c1 & Int4(0xF800)) >> 8) | ((c1 & Int4(0xE000)) >> 13);
+		e1[1] = ((c1 & Int4(0x07E0)) >> 3) | ((c1 & Int4(0x0600)) >> 9);
+		e1[2] = ((c1 & Int4(0x001F)) << 3) | ((c1 & Int4(0x001C)) >> 2);
+
+		Int4 select0 = CmpEQ(selector, Int4(0));
+		Int4 select1 = CmpEQ(selector, Int4(1));
+		Int4 select2 = CmpEQ(selector, Int4(2));
+		Int4 select3 = CmpEQ(selector, Int4(3));
+
+		for(int n = 0; n < 3; n++)
+		{
+			// x / 3 == (x * 0xAAAB) >> 17 for the range of x used here
+			Int4 c2 = ((((e0[n] << 1) + e1[n] + Int4(1)) * Int4(0xAAAB)) >> 17) & opaque;
+			Int4 c3 = ((((e1[n] << 1) + e0[n] + Int4(1)) * Int4(0xAAAB)) >> 17) & opaque;
+			c2 |= ((e0[n] + e1[n]) >> 1) & ~opaque;
+
+			Int4 texel = (e0[n] & select0) | (e1[n] & select1) | (c2 & select2) | (c3 & select3);
+
+			Short4 t = Short4(texel);
+			c[n] = t | (t << 8);
+		}
+
+		if(state.textureFormat == FORMAT_DXT3)
+		{
+			Short4 a = Short4(alpha);
+			c.w = a | (a << 4) | (a << 8) | (a << 12);
+		}
+		else if(state.textureFormat == FORMAT_DXT5)
+		{
+			// Interpolated identically to Surface::decodeDXT5()
+			Int4 a0 = alpha & Int4(0xFF);
+			Int4 a1 = (alpha >> 8) & Int4(0xFF);
+			Int4 i = alpha >> 16;
+			Int4 eight = CmpNLE(a0, a1);   // Else six interpolated values, 0 and 0xFF
+
+			// x / 7 == (x * 0x2493) >> 16 and x / 5 == (x * 0x3334) >> 16 for the range of x used here
+			Int4 a7 = ((((Int4(8) - i) * a0) + ((i - Int4(1)) * a1) + Int4(3)) * Int4(0x2493)) >> 16;
+			Int4 a5 = ((((Int4(6) - i) * a0) + ((i - Int4(1)) * a1) + Int4(2)) * Int4(0x3334)) >> 16;
+			a5 = (a5 & CmpLT(i, Int4(6))) | (Int4(0xFF) & CmpEQ(i, Int4(7)));
+
+			Int4 texel = (a7 & eight) | (a5 & ~eight);
+			texel = (a0 & CmpEQ(i, Int4(0))) | (a1 & CmpEQ(i, Int4(1))) | (texel & CmpNLT(i, Int4(2)));
+
+			Short4 a = Short4(texel);
+			c.w = a | (a << 8);
+		}
+		else
+		{
+			Short4 a = Short4(~(select3 & ~opaque)) & Short4(0x00FF);
+			c.w = a | (a << 8);
+		}
+
+		return c;
+	}
+
 	Vector4s SamplerCore::sampleTexel(Short4 &uuuu, Short4 &vvvv, Short4 &wwww, Vector4f &offset, Pointer<Byte> &mipmap, Pointer<Byte> buffer[4], SamplerFunction function)
 	{
 		Vector4s c;
@@ -2103,6 +2585,10 @@ namespace sw
 			c.y = Min(g, UShort4(0x3FFF)) << 2;
 			c.z = Min(b, UShort4(0x3FFF)) << 2;
 		}
+		else if(hasCompressedFormat())
+		{
+			return sampleCompressedTexel(index, buffer, mipmap);
+		}
 		else
 		{
 			return sampleTexel(index, buffer);
@@ -2153,11 +2639,18 @@ namespace sw
 				c.y = Float4(c.y.yw, c.z.yw);
 				break;
 			case 1:
-				// FIXME: Optimal shuffling?
-				c.x.x = *Pointer<Float>(buffer[f0] + index[0] * 4);
-				c.x.y = *Pointer<Float>(buffer[f1] + index[1] * 4);
-				c.x.z = *Pointer<Float>(buffer[f2] + index[2] * 4);
-				c.x.w = *Pointer<Float>(buffer[f3] + index[3] * 4);
+				if(state.textureType != TEXTURE_CUBE)   // All texels come from the same face
+				{
+					c.x = Gather(Pointer<Float>(buffer[f0]), As<Int4>(computeIndexVector(uuuu, vvvv, wwww) << 2));
+				}
+				else
+				{
+					// FIXME: Optimal shuffling?
+					c.x.x = *Pointer<Float>(buffer[f0] + index[0] * 4);
+					c.x.y = *Pointer<Float>(buffer[f1] + index[1] * 4);
+					c.x.z = *Pointer<Float>(buffer[f2] + index[2] * 4);
+					c.x.w = *Pointer<Float>(buffer[f3] + index[3] * 4);
+				}
 				break;
 			default:
 				ASSERT(false);
@@ -2174,7 +2667,13 @@ namespace sw
 
 				Int4 boolean;
 
-				switch(state.compare)
+				if(state.dynamicCompare)
+				{
+					boolean = (CmpLT(ref, c.x) & compareMask[0]) |
+					          (CmpEQ(ref, c.x) & compareMask[1]) |
+					          (CmpNLE(ref, c.x) & compareMask[2]);
+				}
+				else switch(state.compare)
 				{
 				case COMPARE_LESSEQUAL:    boolean = CmpLE(ref, c.x);  break;
 				case COMPARE_GREATEREQUAL: boolean = CmpNLT(ref, c.x); break;
@@ -2197,7 +2696,7 @@ namespace sw
 		{
 			ASSERT(!hasYuvFormat());
 
-			Vector4s cs = sampleTexel(index, buffer);
+			Vector4s cs = hasCompressedFormat() ? sampleCompressedTexel(index, buffer, mipmap) : sampleTexel(index, buffer);
 
 			bool isInteger = Surface::isNonNormalizedInteger(state.textureFormat);
 			int componentCount = textureComponentCount();
@@ -2566,6 +3065,31 @@ namespace sw
 		c = Insert(c, *Pointer<Short>(LUT + 2 * Int(Extract(c, 3))), 3);
 	}
 
+	bool SamplerCore::isBilinearRGBA8(SamplerFunction function) const
+	{
+		if(state.textureType != TEXTURE_2D ||
+		   state.textureFilter != FILTER_LINEAR ||
+		   state.addressingModeU != ADDRESSING_CLAMP ||
+		   state.addressingModeV != ADDRESSING_CLAMP ||
+		   state.sRGB ||
+		   function == Fetch ||
+		   function.option == Offset)
+		{
+			return false;
+		}
+
+		switch(state.textureFormat)
+		{
+		case FORMAT_A8R8G8B8:
+		case FORMAT_X8R8G8B8:
+		case FORMAT_A8B8G8R8:
+		case FORMAT_X8B8G8R8:
+			return true;
+		default:
+			return false;
+		}
+	}
+
 	bool SamplerCore::hasFloatTexture() const
 	{
 		return Surface::isFloatFormat(state.textureFormat);
@@ -2654,6 +3178,9 @@ namespace sw
 		case FORMAT_X16B16G16R16UI:
 		case FORMAT_A16B16G16R16I:
 		case FORMAT_A16B16G16R16UI:
+		case FORMAT_DXT1:
+		case FORMAT_DXT3:
+		case FORMAT_DXT5:
 		case FORMAT_YV12_BT601:
 		case FORMAT_YV12_BT709:
 		case FORMAT_YV12_JFIF:
@@ -2728,6 +3255,9 @@ namespace sw
 		case FORMAT_X16B16G16R16UI:
 		case FORMAT_A16B16G16R16I:
 		case FORMAT_A16B16G16R16UI:
+		case FORMAT_DXT1:
+		case FORMAT_DXT3:
+		case FORMAT_DXT5:
 		case FORMAT_YV12_BT601:
 		case FORMAT_YV12_BT709:
 		case FORMAT_YV12_JFIF:
@@ -2787,6 +3317,9 @@ namespace sw
 		case FORMAT_D32FS8_TEXTURE:
 		case FORMAT_D32F_SHADOW:
 		case FORMAT_D32FS8_SHADOW:
+		case FORMAT_DXT1:
+		case FORMAT_DXT3:
+		case FORMAT_DXT5:
 		case FORMAT_YV12_BT601:
 		case FORMAT_YV12_BT709:
 		case FORMAT_YV12_JFIF:
@@ -2867,6 +3400,9 @@ namespace sw
 		case FORMAT_D32FS8_TEXTURE:
 		case FORMAT_D32F_SHADOW:
 		case FORMAT_D32FS8_SHADOW:
+		case FORMAT_DXT1:
+		case FORMAT_DXT3:
+		case FORMAT_DXT5:
 		case FORMAT_YV12_BT601:
 		case FORMAT_YV12_BT709:
 		case FORMAT_YV12_JFIF:
@@ -2953,6 +3489,9 @@ namespace sw
 		case FORMAT_V16U16:
 		case FORMAT_A16W16V16U16:
 		case FORMAT_Q16W16V16U16:
+		case FORMAT_DXT1:
+		case FORMAT_DXT3:
+		case FORMAT_DXT5:
 			return false;
 		default:
 			ASSERT(false);
@@ -2961,6 +3500,11 @@ namespace sw
 		return false;
 	}
 
+	bool SamplerCore::hasCompressedFormat() const
+	{
+		return Surface::isCompressed(state.textureFormat);
+	}
+
 	bool SamplerCore::isRGBComponent(int component) const
 	{
 		switch(state.textureFormat)
@@ -3023,6 +3567,9 @@ namespace sw
 		case FORMAT_V16U16:         return false;
 		case FORMAT_A16W16V16U16:   return false;
 		case FORMAT_Q16W16V16U16:   return false;
+		case FORMAT_DXT1:           return component < 3;
+		case FORMAT_DXT3:           return component < 3;
+		case FORMAT_DXT5:           return component < 3;
 		case FORMAT_YV12_BT601:     return component < 3;
 		case FORMAT_YV12_BT709:     return component < 3;
 		case FORMAT_YV12_JFIF:      return component < 3;
@@ -57,13 +57,20 @@ namespace sw
 	private:
 		Vector4s sampleTexture(Pointer<Byte> &texture, Float4 &u, Float4 &v, Float4 &w, Float4 &q, Float4 &bias, Vector4f &dsx, Vector4f &dsy, Vector4f &offset, SamplerFunction function, bool fixed12);
 
+		void applyDynamicSwizzle(Pointer<Byte> &texture, Vector4s &c);
+		void applyDynamicSwizzle(Pointer<Byte> &texture, Vector4f &c);
 		void border(Short4 &mask, Float4 &coordinates);
 		void border(Int4 &mask, Float4 &coordinates);
 		Short4 offsetSample(Short4 &uvw, Pointer<Byte> &mipmap, int halfOffset, bool wrap, int count, Float &lod);
 		Vector4s sampleFilter(Pointer<Byte> &texture, Float4 &u, Float4 &v, Float4 &w, Vector4f &offset, Float &lod, Float &anisotropy, Float4 &uDelta, Float4 &vDelta, Int face[4], SamplerFunction function);
 		Vector4s sampleAniso(Pointer<Byte> &texture, Float4 &u, Float4 &v, Float4 &w, Vector4f &offset, Float &lod, Float &anisotropy, Float4 &uDelta, Float4 &vDelta, Int face[4], bool secondLOD, SamplerFunction function);
+		void accumulateAniso(Vector4s &cSum, Vector4s &c, UShort4 &cw, Short4 &sw);
+		Bool nearlyEqual(Vector4s &c0, Vector4s &c1);
+		Bool nearlyEqual(Vector4f &c0, Vector4f &c1);
 		Vector4s sampleQuad(Pointer<Byte> &texture, Float4 &u, Float4 &v, Float4 &w, Vector4f &offset, Float &lod, Int face[4], bool secondLOD, SamplerFunction function);
 		Vector4s sampleQuad2D(Pointer<Byte> &texture, Float4 &u, Float4 &v, Float4 &w, Vector4f &offset, Float &lod, Int face[4], bool secondLOD, SamplerFunction function);
+		Vector4s sampleBilinearRGBA8(Pointer<Byte> &texture, Float4 &u, Float4 &v, Float &lod, Int face[4], bool secondLOD);
+		Vector4s unpackRGBA8(RValue<Int4> texels);
 		Vector4s sample3D(Pointer<Byte> &texture, Float4 &u, Float4 &v, Float4 &w, Vector4f &offset, Float &lod, bool secondLOD, SamplerFunction function);
 		Vector4f sampleFloatFilter(Pointer<Byte> &texture, Float4 &u, Float4 &v, Float4 &w, Float4 &q, Vector4f &offset, Float &lod, Float &anisotropy, Float4 &uDelta, Float4 &vDelta, Int face[4], SamplerFunction function);
 		Vector4f sampleFloatAniso(Pointer<Byte> &texture, Float4 &u, Float4 &v, Float4 &w, Float4 &q, Vector4f &offset, Float &lod, Float &anisotropy, Float4 &uDelta, Float4 &vDelta, Int face[4], bool secondLOD, SamplerFunction function);
@@ -79,8 +86,13 @@ namespace sw
 		Short4 applyOffset(Short4 &uvw, Float4 &offset, const Int4 &whd, AddressingMode mode);
 		void computeIndices(UInt index[4], Short4 uuuu, Short4 vvvv, Short4 wwww, Vector4f &offset, const Pointer<Byte> &mipmap, SamplerFunction function);
 		void computeIndices(UInt index[4], Int4& uuuu, Int4& vvvv, Int4& wwww, const Pointer<Byte> &mipmap, SamplerFunction function);
+		UInt4 computeIndexVector(Int4& uuuu, Int4& vvvv, Int4& wwww);
+		void tileCoordinates(Short4 &uuuu, Short4 &vvvv, const Pointer<Byte> &mipmap);
+		Int4 texelIndex(Short4 uuuu, Short4 vvvv, const Pointer<Byte> &mipmap);
+		void computeOffsets(Int4 &x, Int4 &y, const Int4 &pitchP, const Pointer<Byte> &mipmap);
 		Vector4s sampleTexel(Short4 &u, Short4 &v, Short4 &s, Vector4f &offset, Pointer<Byte> &mipmap, Pointer<Byte> buffer[4], SamplerFunction function);
 		Vector4s sampleTexel(UInt index[4], Pointer<Byte> buffer[4]);
+		Vector4s sampleCompressedTexel(UInt index[4], Pointer<Byte> buffer[4], Pointer<Byte> &mipmap);
 		Vector4f sampleTexel(Int4 &u, Int4 &v, Int4 &s, Float4 &z, Pointer<Byte> &mipmap, Pointer<Byte> buffer[4], SamplerFunction function);
 		void selectMipmap(Pointer<Byte> &texture, Pointer<Byte> buffer[4], Pointer<Byte> &mipmap, Float &lod, Int face[4], bool secondLOD);
 		Short4 address(Float4 &uw, AddressingMode addressingMode, Pointer<Byte>& mipmap);
@@ -96,6 +108,7 @@ namespace sw
 		void sRGBtoLinear16_6_16(Short4 &c);
 		void sRGBtoLinear16_5_16(Short4 &c);
 
+		bool isBilinearRGBA8(SamplerFunction function) const;   // Clamped bilinear 2D sampling of an unsigned normalized 8-bit RGBA format
 		bool hasFloatTexture() const;
 		bool hasUnnormalizedIntegerTexture() const;
 		bool hasUnsignedTextureComponent(int component) const;
@@ -106,10 +119,13 @@ namespace sw
 		bool has16bitTextureComponents() const;
 		bool has32bitIntegerTextureComponents() const;
 		bool hasYuvFormat() const;
+		bool hasCompressedFormat() const;
 		bool isRGBComponent(int component) const;
 
 		Pointer<Byte> &constants;
 		const Sampler::State &state;
+
+		Int4 compareMask[3];   // Texture::compareMask, for dynamic comparisons
 	};
 }
 
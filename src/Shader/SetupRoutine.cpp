@@ -476,6 +476,7 @@ namespace sw
 			Return(true);
 		}
 
+		Nucleus::setRoutineCategory(RoutineSetup);
 		routine = function(L"SetupRoutine");
 	}
 
@@ -18,11 +18,14 @@
 #include "PixelShader.hpp"
 #include "Common/Math.hpp"
 #include "Common/Debug.hpp"
+#include "Common/BinaryStream.hpp"
 
+#include <map>
 #include <set>
 #include <fstream>
 #include <sstream>
 #include <stdarg.h>
+#include <string.h>
 
 namespace sw
 {
@@ -112,7 +115,7 @@ namespace sw
 		}
 	}
 
-	Shader::Instruction::Instruction(Opcode opcode) : opcode(opcode), analysis(0)
+	Shader::Instruction::Instruction(Opcode opcode) : opcode(opcode), line(0), analysis(0)
 	{
 		control = CONTROL_RESERVED0;
 
@@ -126,7 +129,7 @@ namespace sw
 		usageIndex = 0;
 	}
 
-	Shader::Instruction::Instruction(const unsigned long *token, int size, unsigned char majorVersion) : analysis(0)
+	Shader::Instruction::Instruction(const unsigned long *token, int size, unsigned char majorVersion) : line(0), analysis(0)
 	{
 		parseOperationToken(*token++, majorVersion);
 
@@ -1129,9 +1132,11 @@ namespace sw
 		       analysisLeave;
 	}
 
-	Shader::Shader() : serialID(serialCounter++)
+	Shader::Shader() : serialID(serialCounter++), contentID(0)
 	{
 		usedSamplers = 0;
+		sizedSamplers = 0;
+		fastMath = false;
 	}
 
 	Shader::~Shader()
@@ -1418,80 +1423,1080 @@ namespace sw
 		return containsDefine;
 	}
 
+	const std::vector<unsigned int> &Shader::getBranchConstants() const
+	{
+		return branchConstants;
+	}
+
 	bool Shader::usesSampler(int index) const
 	{
 		return (usedSamplers & (1 << index)) != 0;
 	}
 
-	int Shader::getSerialID() const
-	{
-		return serialID;
-	}
+	bool Shader::queriesSamplerSize(int index) const
+	{
+		return (sizedSamplers & (1 << index)) != 0;
+	}
+
+	void Shader::setFastMath(bool enable)
+	{
+		fastMath = enable;
+	}
+
+	bool Shader::isFastMath() const
+	{
+		return fastMath;
+	}
+
+	int Shader::getSerialID() const
+	{
+		return serialID;
+	}
+
+	uint64_t Shader::getContentID() const
+	{
+		getContent();
+
+		return contentID;
+	}
+
+	std::shared_ptr<const Shader::Content> Shader::getContent() const
+	{
+		std::call_once(contentComputed, [this]()
+		{
+			Content *bytes = new Content();
+			appendContent(*bytes);
+
+			// FNV-1a
+			uint64_t h = 0xCBF29CE484222325ull;
+
+			for(unsigned char byte : *bytes)
+			{
+				h = (h ^ byte) * 0x100000001B3ull;
+			}
+
+			content.reset(bytes);
+			contentID = h;
+		});
+
+		return content;
+	}
+
+	void Shader::appendContent(Content &content) const
+	{
+		// Append each field explicitly, since the instructions contain padding and unused union members
+		append(content, &shaderType, sizeof(shaderType));
+		append(content, &shaderModel, sizeof(shaderModel));
+
+		for(const Instruction *inst : instruction)
+		{
+			const unsigned int fields[] =
+			{
+				inst->opcode, inst->control, inst->predicate, inst->predicateNot, inst->predicateSwizzle,
+				inst->coissue, inst->samplerType, inst->usage, inst->usageIndex, inst->analysis,
+				inst->dst.mask, inst->dst.saturate, inst->dst.partialPrecision, inst->dst.mediumPrecision, inst->dst.centroid, (unsigned int)inst->dst.shift
+			};
+
+			append(content, fields, sizeof(fields));
+			append(content, inst->dst);
+
+			for(const SourceParameter &src : inst->src)
+			{
+				const unsigned int modifiers[] = {src.swizzle, src.modifier, (unsigned int)src.bufferIndex};
+
+				append(content, modifiers, sizeof(modifiers));
+				append(content, src);
+			}
+		}
+
+		const unsigned int analysis[] =
+		{
+			dirtyConstantsF, dirtyConstantsI, dirtyConstantsB,
+			indirectAddressableTemporaries, indirectAddressableInput, indirectAddressableOutput,
+			usedSamplers, dynamicBranching, containsBreak, containsContinue, containsLeave, containsDefine
+		};
+
+		append(content, analysis, sizeof(analysis));
+	}
+
+	void Shader::serialize(BinaryWriter &binary) const
+	{
+		binary.write(shaderType);
+		binary.write(shaderModel);
+		binary.write(usedSamplers);
+		binary.write(fastMath);
+		binary.write((unsigned int)instruction.size());
+
+		for(const Instruction *inst : instruction)
+		{
+			binary.write(inst->opcode);
+			binary.write(inst->control);   // Also holds the project and bias bits
+			binary.write(inst->predicate);
+			binary.write(inst->predicateNot);
+			binary.write(inst->predicateSwizzle);
+			binary.write(inst->coissue);
+			binary.write(inst->samplerType);
+			binary.write(inst->usage);
+			binary.write(inst->usageIndex);
+			binary.write(inst->dst);
+			binary.write(inst->src);
+			binary.write(inst->line);
+			binary.write(inst->analysis);
+		}
+	}
+
+	bool Shader::deserialize(BinaryReader &binary)
+	{
+		for(auto &inst : instruction)
+		{
+			delete inst;
+		}
+
+		instruction.clear();
+
+		const ShaderType expectedType = shaderType;
+		unsigned int count = 0;
+
+		binary.read(shaderType);
+		binary.read(shaderModel);
+		binary.read(usedSamplers);
+		binary.read(fastMath);
+		binary.read(count);
+
+		if(shaderType != expectedType)
+		{
+			shaderType = expectedType;
+
+			return false;
+		}
+
+		for(unsigned int i = 0; i < count && !binary.failed(); i++)
+		{
+			Opcode opcode = OPCODE_NULL;
+			binary.read(opcode);
+
+			Instruction *inst = new Instruction(opcode);
+
+			binary.read(inst->control);
+			binary.read(inst->predicate);
+			binary.read(inst->predicateNot);
+			binary.read(inst->predicateSwizzle);
+			binary.read(inst->coissue);
+			binary.read(inst->samplerType);
+			binary.read(inst->usage);
+			binary.read(inst->usageIndex);
+			binary.read(inst->dst);
+			binary.read(inst->src);
+			binary.read(inst->line);
+			binary.read(inst->analysis);
+
+			append(inst);
+
+			// The programs index their register arrays and labels with these without checking
+			if(!isValid(inst))
+			{
+				return false;
+			}
+		}
+
+		if(binary.failed())
+		{
+			return false;
+		}
+
+		analyzeCallSites();   // The serialized call sites index the return blocks
+
+		return true;
+	}
+
+	void Shader::append(Content &content, const void *data, size_t size)
+	{
+		const unsigned char *bytes = static_cast<const unsigned char*>(data);
+		content.insert(content.end(), bytes, bytes + size);
+	}
+
+	void Shader::append(Content &content, const Parameter &parameter)
+	{
+		unsigned int fields[6] = {parameter.type};
+
+		switch(parameter.type)
+		{
+		case PARAMETER_FLOAT4LITERAL:
+		case PARAMETER_BOOL1LITERAL:
+		case PARAMETER_INT4LITERAL:
+			memcpy(&fields[1], parameter.integer, sizeof(parameter.integer));
+			break;
+		case PARAMETER_LABEL:
+			fields[1] = parameter.label;
+			fields[2] = parameter.callSite;
+			break;
+		default:
+			fields[1] = parameter.index;
+			fields[2] = parameter.rel.type;
+			fields[3] = parameter.rel.index;
+			fields[4] = parameter.rel.swizzle;
+			fields[5] = (parameter.rel.scale << 1) | parameter.rel.dynamic;
+			break;
+		}
+
+		append(content, fields, sizeof(fields));
+	}
+
+	size_t Shader::getLength() const
+	{
+		return instruction.size();
+	}
+
+	Shader::ShaderType Shader::getShaderType() const
+	{
+		return shaderType;
+	}
+
+	unsigned short Shader::getShaderModel() const
+	{
+		return shaderModel;
+	}
+
+	void Shader::print(const char *fileName, ...) const
+	{
+		char fullName[1024 + 1];
+
+		va_list vararg;
+		va_start(vararg, fileName);
+		vsnprintf(fullName, 1024, fileName, vararg);
+		va_end(vararg);
+
+		std::ofstream file(fullName, std::ofstream::out);
+
+		for(const auto &inst : instruction)
+		{
+			file << inst->string(shaderType, shaderModel) << std::endl;
+		}
+	}
+
+	void Shader::printInstruction(int index, const char *fileName) const
+	{
+		std::ofstream file(fileName, std::ofstream::out | std::ofstream::app);
+
+		file << instruction[index]->string(shaderType, shaderModel) << std::endl;
+	}
+
+	void Shader::append(Instruction *instruction)
+	{
+		this->instruction.push_back(instruction);
+	}
+
+	void Shader::declareSampler(int i)
+	{
+		if(i >= 0 && i < 16)
+		{
+			usedSamplers |= 1 << i;
+		}
+	}
+
+	const Shader::Instruction *Shader::getInstruction(size_t i) const
+	{
+		ASSERT(i < instruction.size());
+
+		return instruction[i];
+	}
+
+	void Shader::optimize()
+	{
+		optimizeLeave();
+		optimizeCall();
+		removeNull();
+
+		// The register-level passes below require every temporary access to be static
+		if(shaderModel >= 0x0200 && !hasRelativeTemporaries())
+		{
+			for(int pass = 0; pass < 8; pass++)
+			{
+				bool propagated = propagateCopies();
+				bool folded = foldConstants();
+
+				if(!propagated && !folded)
+				{
+					break;
+				}
+			}
+
+			while(removeDeadInstructions())
+			{
+			}
+
+			removeNull();
+			compactTemporaries();
+		}
+	}
+
+	// Whether the index and relative addressing fields of the parameter are meaningful
+	static bool isRegister(Shader::ParameterType type)
+	{
+		switch(type)
+		{
+		case Shader::PARAMETER_VOID:
+		case Shader::PARAMETER_FLOAT4LITERAL:
+		case Shader::PARAMETER_BOOL1LITERAL:
+		case Shader::PARAMETER_INT4LITERAL:
+		case Shader::PARAMETER_LABEL:
+			return false;
+		default:
+			return true;
+		}
+	}
+
+	// Instructions which transfer control or change the execution mask
+	static bool isBoundary(const Shader::Instruction *inst)
+	{
+		if(inst->isBranch() || inst->isCall() || inst->isBreak() || inst->isLoop() || inst->isEndLoop())
+		{
+			return true;
+		}
+
+		switch(inst->opcode)
+		{
+		case Shader::OPCODE_LABEL:
+		case Shader::OPCODE_RET:
+		case Shader::OPCODE_ELSE:
+		case Shader::OPCODE_ENDIF:
+		case Shader::OPCODE_LEAVE:
+		case Shader::OPCODE_CONTINUE:
+		case Shader::OPCODE_TEST:
+		case Shader::OPCODE_SWITCH:
+		case Shader::OPCODE_ENDSWITCH:
+		case Shader::OPCODE_DISCARD:
+		case Shader::OPCODE_TEXKILL:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	// Instructions which never have an effect beyond writing their destination register
+	static bool isRemovable(const Shader::Instruction *inst)
+	{
+		if(isBoundary(inst))
+		{
+			return false;
+		}
+
+		switch(inst->opcode)
+		{
+		case Shader::OPCODE_NULL:
+		case Shader::OPCODE_DCL:
+		case Shader::OPCODE_DEF:
+		case Shader::OPCODE_DEFI:
+		case Shader::OPCODE_DEFB:
+			return false;
+		default:
+			return true;
+		}
+	}
+
+	// Number of consecutive registers read through source i, starting at its index
+	static int sourceRows(const Shader::Instruction *inst, int i)
+	{
+		if(i != 1)
+		{
+			return 1;
+		}
+
+		switch(inst->opcode)
+		{
+		case Shader::OPCODE_M4X4:
+		case Shader::OPCODE_M3X4:
+			return 4;
+		case Shader::OPCODE_M4X3:
+		case Shader::OPCODE_M3X3:
+			return 3;
+		case Shader::OPCODE_M3X2:
+			return 2;
+		default:
+			return 1;
+		}
+	}
+
+	unsigned int Shader::registerCount(ParameterType type, int bufferIndex) const
+	{
+		const bool pixel = (shaderType == SHADER_PIXEL);
+
+		switch(type)
+		{
+		case PARAMETER_TEMP:      return NUM_TEMPORARY_REGISTERS;
+		case PARAMETER_INPUT:     return pixel ? MAX_FRAGMENT_INPUTS : MAX_VERTEX_INPUTS;
+		case PARAMETER_CONST:
+			if(bufferIndex != -1)   // Byte offset into a uniform block
+			{
+				return (bufferIndex >= 0 && bufferIndex < MAX_UNIFORM_BUFFER_BINDINGS) ? MAX_UNIFORM_BLOCK_SIZE : 0;
+			}
+			return pixel ? FRAGMENT_UNIFORM_VECTORS : VERTEX_UNIFORM_VECTORS;
+		case PARAMETER_TEXTURE:   return pixel ? MAX_FRAGMENT_INPUTS - 2 : 1;   // Address register for vertex shaders
+		case PARAMETER_RASTOUT:   return pixel ? 0 : 3;   // Position, fog and point size
+		case PARAMETER_ATTROUT:   return pixel ? 0 : 2;
+		case PARAMETER_OUTPUT:    return pixel ? RENDERTARGETS : MAX_VERTEX_OUTPUTS;
+		case PARAMETER_CONSTINT:  return 16;
+		case PARAMETER_COLOROUT:  return pixel ? RENDERTARGETS : 0;
+		case PARAMETER_DEPTHOUT:  return pixel ? 1 : 0;
+		case PARAMETER_SAMPLER:   return pixel ? TEXTURE_IMAGE_UNITS : VERTEX_TEXTURE_IMAGE_UNITS;
+		case PARAMETER_CONSTBOOL: return 16;
+		case PARAMETER_LOOP:      return 1;
+		case PARAMETER_MISCTYPE:  return pixel ? VFaceIndex + 1 : VertexIDIndex + 1;
+		case PARAMETER_PREDICATE: return 1;
+		default:                  return 0;
+		}
+	}
+
+	bool Shader::isValid(const Instruction *inst) const
+	{
+		const Opcode opcode = inst->opcode;
+
+		if(!(opcode <= OPCODE_DEFI || (opcode >= OPCODE_TEXCOORD && opcode <= OPCODE_BREAKP) || (opcode >= OPCODE_NULL && opcode <= OPCODE_UMAX)))
+		{
+			return false;
+		}
+
+		if(inst->control > CONTROL_RESERVED1 || inst->samplerType > SAMPLER_VOLUME || inst->usage > USAGE_SAMPLE)
+		{
+			return false;
+		}
+
+		if((inst->isCall() || opcode == OPCODE_LABEL) && inst->dst.label >= MAX_LABELS)
+		{
+			return false;
+		}
+
+		auto validParameter = [this](const Parameter &parameter, unsigned int rows, int bufferIndex)
+		{
+			switch(parameter.type)
+			{
+			case PARAMETER_VOID:
+			case PARAMETER_FLOAT4LITERAL:
+			case PARAMETER_BOOL1LITERAL:
+			case PARAMETER_INT4LITERAL:
+				return true;
+			case PARAMETER_LABEL:   // The call site overlaps the relative addressing
+				return parameter.label < MAX_LABELS;
+			default:
+				break;
+			}
+
+			unsigned int count = registerCount(parameter.type, bufferIndex);
+
+			if(parameter.index >= count || rows > count - parameter.index)
+			{
+				return false;
+			}
+
+			switch(parameter.rel.type)
+			{
+			case PARAMETER_VOID:
+				return true;
+			case PARAMETER_TEMP:
+			case PARAMETER_INPUT:
+			case PARAMETER_CONST:
+			case PARAMETER_ADDR:
+			case PARAMETER_OUTPUT:
+			case PARAMETER_LOOP:
+			case PARAMETER_MISCTYPE:
+				return parameter.rel.index < registerCount(parameter.rel.type, bufferIndex);
+			default:
+				return false;
+			}
+		};
+
+		if(!validParameter(inst->dst, 1, -1))
+		{
+			return false;
+		}
+
+		for(int i = 0; i < 5; i++)
+		{
+			const SourceParameter &src = inst->src[i];
+
+			if(src.modifier > MODIFIER_NOT || src.bufferIndex < -1 || !validParameter(src, sourceRows(inst, i), src.bufferIndex))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// Instructions whose sources may be replaced by equivalent registers
+	static bool isRewritable(const Shader::Instruction *inst)
+	{
+		if(!isRemovable(inst))
+		{
+			return false;
+		}
+
+		// A replacement can't preserve the rows following a matrix source
+		return sourceRows(inst, 1) == 1;
+	}
+
+	// Instructions whose result depends on the values held by neighboring pixels
+	static bool isCrossLane(Shader::Opcode opcode)
+	{
+		switch(opcode)
+		{
+		case Shader::OPCODE_DFDX:
+		case Shader::OPCODE_DFDY:
+		case Shader::OPCODE_FWIDTH:
+		case Shader::OPCODE_TEX:
+		case Shader::OPCODE_TEXOFFSET:
+		case Shader::OPCODE_TEXBIAS:
+		case Shader::OPCODE_TEXOFFSETBIAS:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	// Instructions where each destination component only depends on the same component of the sources
+	static bool isComponentwise(Shader::Opcode opcode)
+	{
+		switch(opcode)
+		{
+		case Shader::OPCODE_MOV:
+		case Shader::OPCODE_ADD:
+		case Shader::OPCODE_SUB:
+		case Shader::OPCODE_MUL:
+		case Shader::OPCODE_MAD:
+		case Shader::OPCODE_MIN:
+		case Shader::OPCODE_MAX:
+		case Shader::OPCODE_SLT:
+		case Shader::OPCODE_SGE:
+		case Shader::OPCODE_FRC:
+		case Shader::OPCODE_ABS:
+		case Shader::OPCODE_SGN:
+		case Shader::OPCODE_LRP:
+		case Shader::OPCODE_CMP0:
+		case Shader::OPCODE_TRUNC:
+		case Shader::OPCODE_FLOOR:
+		case Shader::OPCODE_ROUND:
+		case Shader::OPCODE_ROUNDEVEN:
+		case Shader::OPCODE_CEIL:
+		case Shader::OPCODE_SQRT:
+		case Shader::OPCODE_RSQ:
+		case Shader::OPCODE_DIV:
+		case Shader::OPCODE_MOD:
+		case Shader::OPCODE_EXP2:
+		case Shader::OPCODE_LOG2:
+		case Shader::OPCODE_EXP:
+		case Shader::OPCODE_LOG:
+		case Shader::OPCODE_POW:
+		case Shader::OPCODE_F2B:
+		case Shader::OPCODE_B2F:
+		case Shader::OPCODE_F2I:
+		case Shader::OPCODE_I2F:
+		case Shader::OPCODE_F2U:
+		case Shader::OPCODE_U2F:
+		case Shader::OPCODE_I2B:
+		case Shader::OPCODE_B2I:
+		case Shader::OPCODE_NEG:
+		case Shader::OPCODE_NOT:
+		case Shader::OPCODE_OR:
+		case Shader::OPCODE_XOR:
+		case Shader::OPCODE_AND:
+		case Shader::OPCODE_STEP:
+		case Shader::OPCODE_SMOOTH:
+		case Shader::OPCODE_IADD:
+		case Shader::OPCODE_ISUB:
+		case Shader::OPCODE_IMUL:
+		case Shader::OPCODE_INEG:
+		case Shader::OPCODE_IABS:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	// Destination components whose computation reads the sources
+	static unsigned int usedLanes(const Shader::Instruction *inst)
+	{
+		return isComponentwise(inst->opcode) ? inst->dst.mask : 0xF;
+	}
+
+	static unsigned int component(const Shader::SourceParameter &src, int lane)
+	{
+		return (src.swizzle >> (2 * lane)) & 0x3;
+	}
+
+	// Register components read through source i
+	static unsigned int readMask(const Shader::Instruction *inst, int i)
+	{
+		unsigned int lanes = usedLanes(inst);
+		unsigned int mask = 0;
+
+		for(int lane = 0; lane < 4; lane++)
+		{
+			if(lanes & (1 << lane))
+			{
+				mask |= 1 << component(inst->src[i], lane);
+			}
+		}
+
+		return mask;
+	}
+
+	static bool sameRegister(const Shader::SourceParameter &a, const Shader::SourceParameter &b)
+	{
+		return a.type == b.type && a.index == b.index && a.bufferIndex == b.bufferIndex;
+	}
+
+	bool Shader::hasRelativeTemporaries() const
+	{
+		for(const auto &inst : instruction)
+		{
+			if(inst->dst.type == PARAMETER_TEMP && inst->dst.rel.type != PARAMETER_VOID)
+			{
+				return true;
+			}
+
+			for(int i = 0; i < 5; i++)
+			{
+				if(inst->src[i].type == PARAMETER_TEMP && inst->src[i].rel.type != PARAMETER_VOID)
+				{
+					return true;
+				}
+			}
+		}
+
+		return false;
+	}
+
+	bool Shader::propagateCopies()
+	{
+		struct Copy
+		{
+			Copy() : component(0), valid(false)
+			{
+			}
+
+			SourceParameter source;   // Register or literal holding the value
+			unsigned int component;
+			bool valid;
+		};
+
+		struct Temporary
+		{
+			Copy copy[4];
+		};
+
+		std::map<unsigned int, Temporary> copies;   // Per temporary register component, tracked within a basic block
+		bool uniform = true;   // All pixels of a quad execute the current instruction
+		bool changed = false;
+
+		for(auto &inst : instruction)
+		{
+			if(isBoundary(inst))
+			{
+				copies.clear();
+				uniform = false;
+
+				continue;
+			}
+
+			if(isRewritable(inst) && (uniform || !isCrossLane(inst->opcode)))
+			{
+				unsigned int lanes = usedLanes(inst);
+
+				for(int i = 0; i < 5; i++)
+				{
+					SourceParameter &src = inst->src[i];
+
+					if(src.type != PARAMETER_TEMP || src.rel.type != PARAMETER_VOID)
+					{
+						continue;
+					}
+
+					auto temporary = copies.find(src.index);
+
+					if(temporary == copies.end() || lanes == 0)
+					{
+						continue;
+					}
+
+					const Copy *first = nullptr;
+					bool literal = true;
+					bool replaceable = true;
+
+					for(int lane = 0; lane < 4; lane++)
+					{
+						if(lanes & (1 << lane))
+						{
+							const Copy &copy = temporary->second.copy[component(src, lane)];
+
+							if(!copy.valid)
+							{
+								replaceable = false;
+								break;
+							}
+
+							if(copy.source.type != PARAMETER_FLOAT4LITERAL)
+							{
+								literal = false;
+							}
+
+							if(!first)
+							{
+								first = &copy;
+							}
+							else if(!literal && !sameRegister(copy.source, first->source))
+							{
+								replaceable = false;
+								break;
+							}
+						}
+					}
+
+					if(!replaceable)
+					{
+						continue;
+					}
+
+					SourceParameter replacement;
+
+					if(literal)
+					{
+						replacement.type = PARAMETER_FLOAT4LITERAL;
+
+						for(int lane = 0; lane < 4; lane++)
+						{
+							const Copy &copy = temporary->second.copy[component(src, lane)];
+							replacement.value[lane] = (lanes & (1 << lane)) ? copy.source.value[copy.component] : 0.0f;
+						}
+					}
+					else
+					{
+						replacement = first->source;
+						replacement.swizzle = 0;
+
+						for(int lane = 0; lane < 4; lane++)
+						{
+							// Unused lanes keep reading a component which is known to be valid
+							const Copy &copy = temporary->second.copy[component(src, lane)];
+							unsigned int c = (lanes & (1 << lane)) ? copy.component : first->component;
+							replacement.swizzle |= c << (2 * lane);
+						}
+					}
 
-	size_t Shader::getLength() const
-	{
-		return instruction.size();
-	}
+					replacement.modifier = src.modifier;
+					src = replacement;
+					changed = true;
+				}
+			}
 
-	Shader::ShaderType Shader::getShaderType() const
-	{
-		return shaderType;
+			const DestinationParameter &dst = inst->dst;
+
+			if(!isRegister(dst.type))
+			{
+				continue;
+			}
+
+			// Forget copies invalidated by this write
+			if(dst.type == PARAMETER_TEMP)
+			{
+				auto temporary = copies.find(dst.index);
+
+				if(temporary != copies.end())
+				{
+					for(int c = 0; c < 4; c++)
+					{
+						if(dst.mask & (1 << c))
+						{
+							temporary->second.copy[c].valid = false;
+						}
+					}
+				}
+			}
+
+			for(auto &temporary : copies)
+			{
+				for(int c = 0; c < 4; c++)
+				{
+					const SourceParameter &source = temporary.second.copy[c].source;
+
+					if(source.type == dst.type && (source.index == dst.index || dst.rel.type != PARAMETER_VOID))
+					{
+						temporary.second.copy[c].valid = false;
+					}
+				}
+			}
+
+			if(inst->opcode == OPCODE_MOV && dst.type == PARAMETER_TEMP && dst.rel.type == PARAMETER_VOID &&
+			   !dst.saturate && dst.shift == 0 && !inst->predicate)
+			{
+				const SourceParameter &src = inst->src[0];
+
+				if(src.modifier != MODIFIER_NONE)
+				{
+					continue;
+				}
+
+				bool copyable = false;
+
+				switch(src.type)
+				{
+				case PARAMETER_FLOAT4LITERAL:
+					copyable = true;
+					break;
+				case PARAMETER_TEMP:
+				case PARAMETER_INPUT:
+				case PARAMETER_CONST:
+					copyable = src.rel.type == PARAMETER_VOID && !(src.type == PARAMETER_TEMP && src.index == dst.index);
+					break;
+				default:
+					break;
+				}
+
+				if(copyable)
+				{
+					Temporary &temporary = copies[dst.index];
+
+					for(int lane = 0; lane < 4; lane++)
+					{
+						if(dst.mask & (1 << lane))
+						{
+							temporary.copy[lane].source = src;
+							temporary.copy[lane].component = component(src, lane);
+							temporary.copy[lane].valid = true;
+						}
+					}
+				}
+			}
+		}
+
+		return changed;
 	}
 
-	unsigned short Shader::getShaderModel() const
+	bool Shader::foldConstants()
 	{
-		return shaderModel;
+		bool changed = false;
+
+		for(auto &inst : instruction)
+		{
+			int sources = 0;
+
+			switch(inst->opcode)
+			{
+			case OPCODE_ADD:
+			case OPCODE_SUB:
+			case OPCODE_MUL:
+				sources = 2;
+				break;
+			default:
+				continue;
+			}
+
+			bool foldable = true;
+
+			for(int i = 0; i < sources; i++)
+			{
+				if(inst->src[i].type != PARAMETER_FLOAT4LITERAL || inst->src[i].modifier != MODIFIER_NONE)
+				{
+					foldable = false;
+				}
+			}
+
+			if(!foldable)
+			{
+				continue;
+			}
+
+			SourceParameter result;
+			result.type = PARAMETER_FLOAT4LITERAL;
+
+			for(int lane = 0; lane < 4; lane++)
+			{
+				float a = inst->src[0].value[component(inst->src[0], lane)];
+				float b = inst->src[1].value[component(inst->src[1], lane)];
+
+				switch(inst->opcode)
+				{
+				case OPCODE_ADD: result.value[lane] = a + b; break;
+				case OPCODE_SUB: result.value[lane] = a - b; break;
+				case OPCODE_MUL: result.value[lane] = a * b; break;
+				default: ASSERT(false);
+				}
+
+				// Denormals may get flushed at run time, so leave them to the JIT-compiled code
+				if(std::fpclassify(a) == FP_SUBNORMAL ||
+				   std::fpclassify(b) == FP_SUBNORMAL ||
+				   std::fpclassify(result.value[lane]) == FP_SUBNORMAL)
+				{
+					foldable = false;
+				}
+			}
+
+			if(!foldable)
+			{
+				continue;
+			}
+
+			inst->opcode = OPCODE_MOV;
+			inst->src[0] = result;
+
+			for(int i = 1; i < 5; i++)
+			{
+				inst->src[i] = SourceParameter();
+			}
+
+			changed = true;
+		}
+
+		return changed;
 	}
 
-	void Shader::print(const char *fileName, ...) const
+	bool Shader::removeDeadInstructions()
 	{
-		char fullName[1024 + 1];
+		std::map<unsigned int, unsigned int> readMasks;   // Components of each temporary register ever read
 
-		va_list vararg;
-		va_start(vararg, fileName);
-		vsnprintf(fullName, 1024, fileName, vararg);
-		va_end(vararg);
+		for(const auto &inst : instruction)
+		{
+			if(inst->opcode == OPCODE_NULL)
+			{
+				continue;
+			}
 
-		std::ofstream file(fullName, std::ofstream::out);
+			for(int i = 0; i < 5; i++)
+			{
+				const SourceParameter &src = inst->src[i];
 
-		for(const auto &inst : instruction)
+				if(!isRegister(src.type))
+				{
+					continue;
+				}
+
+				if(src.type == PARAMETER_TEMP)
+				{
+					for(int row = 0; row < sourceRows(inst, i); row++)
+					{
+						readMasks[src.index + row] |= readMask(inst, i);
+					}
+				}
+
+				if(src.rel.type == PARAMETER_TEMP)
+				{
+					readMasks[src.rel.index] |= 0xF;
+				}
+			}
+
+			const DestinationParameter &dst = inst->dst;
+
+			if(isRegister(dst.type) && dst.rel.type == PARAMETER_TEMP)
+			{
+				readMasks[dst.rel.index] |= 0xF;
+			}
+
+			if(inst->opcode == OPCODE_TEXKILL && dst.type == PARAMETER_TEMP)
+			{
+				readMasks[dst.index] |= 0xF;
+			}
+		}
+
+		bool changed = false;
+
+		for(auto &inst : instruction)
 		{
-			file << inst->string(shaderType, shaderModel) << std::endl;
+			const DestinationParameter &dst = inst->dst;
+
+			if(dst.type == PARAMETER_TEMP && isRemovable(inst) && (dst.mask & readMasks[dst.index]) == 0)
+			{
+				inst->opcode = OPCODE_NULL;
+				changed = true;
+			}
 		}
+
+		return changed;
 	}
 
-	void Shader::printInstruction(int index, const char *fileName) const
+	void Shader::compactTemporaries()
 	{
-		std::ofstream file(fileName, std::ofstream::out | std::ofstream::app);
+		std::set<unsigned int> used;
 
-		file << instruction[index]->string(shaderType, shaderModel) << std::endl;
-	}
+		for(const auto &inst : instruction)
+		{
+			const DestinationParameter &dst = inst->dst;
 
-	void Shader::append(Instruction *instruction)
-	{
-		this->instruction.push_back(instruction);
-	}
+			if(dst.type == PARAMETER_TEMP)
+			{
+				used.insert(dst.index);
+			}
 
-	void Shader::declareSampler(int i)
-	{
-		if(i >= 0 && i < 16)
+			if(isRegister(dst.type) && dst.rel.type == PARAMETER_TEMP)
+			{
+				used.insert(dst.rel.index);
+			}
+
+			for(int i = 0; i < 5; i++)
+			{
+				const SourceParameter &src = inst->src[i];
+
+				if(!isRegister(src.type))
+				{
+					continue;
+				}
+
+				if(src.type == PARAMETER_TEMP)
+				{
+					for(int row = 0; row < sourceRows(inst, i); row++)
+					{
+						used.insert(src.index + row);
+					}
+				}
+
+				if(src.rel.type == PARAMETER_TEMP)
+				{
+					used.insert(src.rel.index);
+				}
+			}
+		}
+
+		// Renumbering in increasing order keeps the rows of each matrix source consecutive
+		std::map<unsigned int, unsigned int> indices;   // Original to compacted temporary register index
+
+		for(unsigned int index : used)
 		{
-			usedSamplers |= 1 << i;
+			unsigned int next = static_cast<unsigned int>(indices.size());
+			indices[index] = next;
 		}
-	}
 
-	const Shader::Instruction *Shader::getInstruction(size_t i) const
-	{
-		ASSERT(i < instruction.size());
+		for(auto &inst : instruction)
+		{
+			DestinationParameter &dst = inst->dst;
 
-		return instruction[i];
-	}
+			if(dst.type == PARAMETER_TEMP)
+			{
+				dst.index = indices[dst.index];
+			}
 
-	void Shader::optimize()
-	{
-		optimizeLeave();
-		optimizeCall();
-		removeNull();
+			if(isRegister(dst.type) && dst.rel.type == PARAMETER_TEMP)
+			{
+				dst.rel.index = indices[dst.rel.index];
+			}
+
+			for(int i = 0; i < 5; i++)
+			{
+				SourceParameter &src = inst->src[i];
+
+				if(!isRegister(src.type))
+				{
+					continue;
+				}
+
+				if(src.type == PARAMETER_TEMP)
+				{
+					src.index = indices[src.index];
+				}
+
+				if(src.rel.type == PARAMETER_TEMP)
+				{
+					src.rel.index = indices[src.rel.index];
+				}
+			}
+		}
 	}
 
 	void Shader::optimizeLeave()
@@ -1625,6 +2630,74 @@ namespace sw
 		}
 	}
 
+	void Shader::analyzeBranchConstants()
+	{
+		// Branch conditions are either uniforms or temporaries holding
+		// the result of a comparison, so look one instruction back.
+		std::set<unsigned int> constants;
+		std::set<unsigned int> conditions;   // Temporaries used as branch conditions
+
+		auto addSource = [&](const SourceParameter &src)
+		{
+			if(src.type == PARAMETER_CONST && src.rel.type == PARAMETER_VOID && src.bufferIndex == -1)
+			{
+				constants.insert(src.index);
+			}
+			else if(src.type == PARAMETER_TEMP && src.rel.type == PARAMETER_VOID)
+			{
+				conditions.insert(src.index);
+			}
+		};
+
+		for(const auto &inst : instruction)
+		{
+			switch(inst->opcode)
+			{
+			case OPCODE_IFC:
+			case OPCODE_BREAKC:
+				addSource(inst->src[1]);
+				// Fall through
+			case OPCODE_IF:
+			case OPCODE_WHILE:
+			case OPCODE_CALLNZ:
+				addSource(inst->src[0]);
+				break;
+			default:
+				break;
+			}
+		}
+
+		for(const auto &inst : instruction)
+		{
+			if(inst->dst.type != PARAMETER_TEMP || conditions.find(inst->dst.index) == conditions.end())
+			{
+				continue;
+			}
+
+			for(int i = 0; i < 3; i++)
+			{
+				const SourceParameter &src = inst->src[i];
+
+				if(src.type == PARAMETER_CONST && src.rel.type == PARAMETER_VOID && src.bufferIndex == -1)
+				{
+					constants.insert(src.index);
+				}
+			}
+		}
+
+		branchConstants.clear();
+
+		for(unsigned int index : constants)
+		{
+			if(branchConstants.size() == MAX_BRANCH_CONSTANTS)
+			{
+				break;
+			}
+
+			branchConstants.push_back(index);
+		}
+	}
+
 	void Shader::analyzeDynamicBranching()
 	{
 		dynamicBranching = false;
@@ -1867,6 +2940,13 @@ namespace sw
 					}
 				}
 				break;
+			case OPCODE_TEXSIZE:
+				if(inst->src[1].type == PARAMETER_SAMPLER)
+				{
+					// Dynamically indexed sampler arrays could query any of them
+					sizedSamplers |= (inst->src[1].rel.type != PARAMETER_VOID) ? 0xFFFF : (1 << inst->src[1].index);
+				}
+				break;
 			default:
 				break;
 			}
@@ -1877,7 +2957,7 @@ namespace sw
 	// This is used to know what basic block to return to.
 	void Shader::analyzeCallSites()
 	{
-		int callSiteIndex[2048] = {0};
+		int callSiteIndex[MAX_LABELS] = {0};
 
 		for(auto &inst : instruction)
 		{
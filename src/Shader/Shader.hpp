@@ -17,11 +17,16 @@
 
 #include "Common/Types.hpp"
 
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
 namespace sw
 {
+	class BinaryWriter;
+	class BinaryReader;
+
 	class Shader
 	{
 	public:
@@ -458,7 +463,7 @@ namespace sw
 				};
 			};
 
-			DestinationParameter() : mask(0xF), saturate(false), partialPrecision(false), centroid(false), shift(0)
+			DestinationParameter() : mask(0xF), saturate(false), partialPrecision(false), mediumPrecision(false), centroid(false), shift(0)
 			{
 			}
 
@@ -468,6 +473,7 @@ namespace sw
 
 			bool saturate         : 1;
 			bool partialPrecision : 1;
+			bool mediumPrecision  : 1;   // Computed from mediump values, tolerates partial precision
 			bool centroid         : 1;
 			signed char shift     : 4;
 		};
@@ -538,6 +544,8 @@ namespace sw
 			DestinationParameter dst;
 			SourceParameter src[5];
 
+			int line;   // GLSL source line, 0 when unknown
+
 			union
 			{
 				unsigned int analysis;
@@ -558,6 +566,16 @@ namespace sw
 		virtual ~Shader();
 
 		int getSerialID() const;
+		typedef std::vector<unsigned char> Content;
+
+		// Both are computed once, shaders must not change afterwards. The ID is a hash of the
+		// content, so unlike the serial ID it is shared by identical shaders and stable across
+		// processes. Caches keyed by it compare the content, since distinct shaders may collide.
+		uint64_t getContentID() const;
+		std::shared_ptr<const Content> getContent() const;
+		virtual void appendContent(Content &content) const;   // Everything code generation depends on
+		virtual void serialize(BinaryWriter &binary) const;   // For program binaries, only read back by the same build
+		virtual bool deserialize(BinaryReader &binary);
 		size_t getLength() const;
 		ShaderType getShaderType() const;
 		unsigned short getShaderModel() const;
@@ -582,6 +600,13 @@ namespace sw
 		bool containsLeaveInstruction() const;
 		bool containsDefineInstruction() const;
 		bool usesSampler(int i) const;
+		bool queriesSamplerSize(int i) const;
+		const std::vector<unsigned int> &getBranchConstants() const;   // Uniform registers controlling branches and loops
+
+		// Lets every instruction compute transcendentals at partial precision, for programs
+		// which tolerate it. Part of the processor state, so it doesn't affect the content ID.
+		void setFastMath(bool enable);
+		bool isFastMath() const;
 
 		struct Semantic
 		{
@@ -616,18 +641,30 @@ namespace sw
 		bool indirectAddressableInput;
 		bool indirectAddressableOutput;
 
+		enum {MAX_LABELS = 2048};
+		enum {MAX_BRANCH_CONSTANTS = 16};
+
 	protected:
 		void parse(const unsigned long *token);
 
+		static void append(Content &content, const void *data, size_t size);
+		static void append(Content &content, const Parameter &parameter);
+
 		void optimizeLeave();
 		void optimizeCall();
 		void removeNull();
+		bool propagateCopies();
+		bool foldConstants();
+		bool removeDeadInstructions();
+		void compactTemporaries();
+		bool hasRelativeTemporaries() const;
 
 		void analyzeDirtyConstants();
 		void analyzeDynamicBranching();
 		void analyzeSamplers();
 		void analyzeCallSites();
 		void analyzeIndirectAddressing();
+		void analyzeBranchConstants();
 		void markFunctionAnalysis(unsigned int functionLabel, Analysis flag);
 
 		ShaderType shaderType;
@@ -645,12 +682,23 @@ namespace sw
 
 		std::vector<Instruction*> instruction;
 
-		unsigned short usedSamplers;   // Bit flags
+		unsigned short usedSamplers;    // Bit flags
+		unsigned short sizedSamplers;   // Bit flags of samplers whose level dimensions get queried
+
+		std::vector<unsigned int> branchConstants;   // Sorted, at most MAX_BRANCH_CONSTANTS
 
 	private:
+		unsigned int registerCount(ParameterType type, int bufferIndex) const;   // Zero for types the programs don't handle
+		bool isValid(const Instruction *instruction) const;
+
 		const int serialID;
 		static volatile int serialCounter;
 
+		mutable std::once_flag contentComputed;
+		mutable std::shared_ptr<const Content> content;
+		mutable uint64_t contentID;
+
+		bool fastMath;
 		bool dynamicBranching;
 		bool containsBreak;
 		bool containsContinue;
@@ -127,14 +127,28 @@ namespace sw
 		Int4 i = RoundInt(x0 - Float4(0.5f));
 		Float4 ii = As<Float4>((i + Int4(127)) << 23);   // Add single-precision bias, and shift into exponent.
 
-		// For the fractional part use a polynomial
-		// which approximates 2^f in the 0 to 1 range.
+		// For the fractional part use a minimax polynomial which approximates
+		// 2^f in the 0 to 1 range, with the lowest degree meeting the precision.
 		Float4 f = x0 - Float4(i);
-		Float4 ff = As<Float4>(Int4(0x3AF61905));     // 1.8775767e-3f
-		ff = ff * f + As<Float4>(Int4(0x3C134806));   // 8.9893397e-3f
-		ff = ff * f + As<Float4>(Int4(0x3D64AA23));   // 5.5826318e-2f
-		ff = ff * f + As<Float4>(Int4(0x3E75EAD4));   // 2.4015361e-1f
-		ff = ff * f + As<Float4>(Int4(0x3F31727B));   // 6.9315308e-1f
+		Float4 ff;
+
+		if(expPrecision <= PARTIAL)
+		{
+			// Relative error 2^-13.5
+			ff = As<Float4>(Int4(0x3D9DD553));            // 7.7067040e-2f
+			ff = ff * f + As<Float4>(Int4(0x3E691BC5));   // 2.2764499e-1f
+			ff = ff * f + As<Float4>(Int4(0x3F31F32C));   // 6.9511676e-1f
+		}
+		else
+		{
+			// Relative error 2^-22.5
+			ff = As<Float4>(Int4(0x3AF4BA7D));            // 1.8671300e-3f
+			ff = ff * f + As<Float4>(Int4(0x3C13BC2B));   // 9.0170307e-3f
+			ff = ff * f + As<Float4>(Int4(0x3D648E73));   // 5.5799913e-2f
+			ff = ff * f + As<Float4>(Int4(0x3E75EDAB));   // 2.4016444e-1f
+			ff = ff * f + As<Float4>(Int4(0x3F31725D));   // 6.9315130e-1f
+		}
+
 		ff = ff * f + Float4(1.0f);
 
 		return ii * ff;
@@ -155,9 +169,22 @@ namespace sw
 		x1 = (x1 - Float4(1.4960938f)) * Float4(256.0f);   // FIXME: (x1 - 1.4960938f) * 256.0f;
 		x0 = As<Float4>((As<Int4>(x0) & Int4(0x007FFFFF)) | As<Int4>(Float4(1.0f)));
 
-		x2 = (Float4(9.5428179e-2f) * x0 + Float4(4.7779095e-1f)) * x0 + Float4(1.9782813e-1f);
-		x3 = ((Float4(1.6618466e-2f) * x0 + Float4(2.0350508e-1f)) * x0 + Float4(2.7382900e-1f)) * x0 + Float4(4.0496687e-2f);
-		x2 /= x3;
+		// Approximate log2(m) / (m - 1) for the mantissa m in the 1 to 2 range
+		if(logPrecision <= PARTIAL)
+		{
+			// Minimax polynomial, absolute error 2^-13
+			x2 = ((As<Float4>(Int4(0xBDAD9B3C)) * x0 +   // -8.4768742e-2f
+			       As<Float4>(Int4(0x3F147477))) * x0 +   // 5.7990211e-1f
+			       As<Float4>(Int4(0xBFCAEFC5))) * x0 +   // -1.5854422e+0f
+			       As<Float4>(Int4(0x4021E070));          // 2.5293236e+0f
+		}
+		else
+		{
+			// Rational approximation, absolute error 2^-24
+			x2 = (Float4(9.5428179e-2f) * x0 + Float4(4.7779095e-1f)) * x0 + Float4(1.9782813e-1f);
+			x3 = ((Float4(1.6618466e-2f) * x0 + Float4(2.0350508e-1f)) * x0 + Float4(2.7382900e-1f)) * x0 + Float4(4.0496687e-2f);
+			x2 /= x3;
+		}
 
 		x1 += (x0 - Float4(1.0f)) * x2;
 
@@ -276,54 +303,110 @@ namespace sw
 		return sine_pi(y, pp);
 	}
 
-	Float4 sine(RValue<Float4> x, bool pp)
+	// Reduces x to turns in the [-0.5, 0.5] range, shared by all the trigonometric functions
+	static Float4 reduceTurns(RValue<Float4> x)
 	{
-		// Reduce to [-0.5, 0.5] range
 		Float4 y = x * Float4(1.59154943e-1f);   // 1/2pi
-		y = y - Round(y);
-
-		if(!pp)
-		{
-			// From the paper: "A Fast, Vectorizable Algorithm for Producing Single-Precision Sine-Cosine Pairs"
-			// This implementation passes OpenGL ES 3.0 precision requirements, at the cost of more operations:
-			// !pp : 17 mul, 7 add, 1 sub, 1 reciprocal
-			//  pp : 4 mul, 2 add, 2 abs
-
-			Float4 y2 = y * y;
-			Float4 c1 = y2 * (y2 * (y2 * Float4(-0.0204391631f) + Float4(0.2536086171f)) + Float4(-1.2336977925f)) + Float4(1.0f);
-			Float4 s1 = y * (y2 * (y2 * (y2 * Float4(-0.0046075748f) + Float4(0.0796819754f)) + Float4(-0.645963615f)) + Float4(1.5707963235f));
-			Float4 c2 = (c1 * c1) - (s1 * s1);
-			Float4 s2 = Float4(2.0f) * s1 * c1;
-			return Float4(2.0f) * s2 * c2 * reciprocal(s2 * s2 + c2 * c2, pp, true);
-		}
+		return y - Round(y);
+	}
 
+	// Parabola approximating sin(2 pi y) for y in turns, with a precision of 0.001
+	static Float4 parabolicSine(RValue<Float4> y)
+	{
 		const Float4 A = Float4(-16.0f);
 		const Float4 B = Float4(8.0f);
 		const Float4 C = Float4(7.75160950e-1f);
 		const Float4 D = Float4(2.24839049e-1f);
 
-		// Parabola approximating sine
 		Float4 sin = y * (Abs(y) * A + B);
 
 		// Improve precision from 0.06 to 0.001
-		if(true)
+		return sin * (Abs(sin) * D + C);
+	}
+
+	// Moves y a quarter turn ahead, since cos(2 pi y) = sin(2 pi (y + 1/4)), staying in the [-0.5, 0.5] range
+	static Float4 quarterTurn(RValue<Float4> y)
+	{
+		Float4 z = y + Float4(0.25f);
+		return z - As<Float4>(CmpNLT(z, Float4(0.5f)) & As<Int4>(Float4(1.0f)));
+	}
+
+	// From the paper: "A Fast, Vectorizable Algorithm for Producing Single-Precision Sine-Cosine Pairs"
+	// Polynomials approximate the sine and cosine of a quarter of the angle, which get doubled into
+	// the sine s and cosine c of half of the angle. The callers normalize the last doubling, as in
+	// sin = 2 * s * c / (s^2 + c^2) and cos = (c^2 - s^2) / (s^2 + c^2), which share the reciprocal.
+	// This passes OpenGL ES 3.0 precision requirements.
+	static void halfAngle(RValue<Float4> y, Float4 &s2, Float4 &c2)
+	{
+		Float4 y2 = y * y;
+		Float4 c1 = y2 * (y2 * (y2 * Float4(-0.0204391631f) + Float4(0.2536086171f)) + Float4(-1.2336977925f)) + Float4(1.0f);
+		Float4 s1 = y * (y2 * (y2 * (y2 * Float4(-0.0046075748f) + Float4(0.0796819754f)) + Float4(-0.645963615f)) + Float4(1.5707963235f));
+		c2 = (c1 * c1) - (s1 * s1);
+		s2 = Float4(2.0f) * s1 * c1;
+	}
+
+	Float4 sine(RValue<Float4> x, bool pp)
+	{
+		Float4 y = reduceTurns(x);
+
+		if(!pp)
 		{
-			sin = sin * (Abs(sin) * D + C);
+			Float4 s2, c2;
+			halfAngle(y, s2, c2);
+			Float4 r = reciprocal(s2 * s2 + c2 * c2, pp, true);
+			return Float4(2.0f) * s2 * c2 * r;
 		}
 
-		return sin;
+		return parabolicSine(y);
 	}
 
 	Float4 cosine(RValue<Float4> x, bool pp)
 	{
-		// cos(x) = sin(x + pi/2)
-		Float4 y = x + Float4(1.57079632e+0f);
-		return sine(y, pp);
+		Float4 y = reduceTurns(x);
+
+		if(!pp)
+		{
+			Float4 s2, c2;
+			halfAngle(y, s2, c2);
+			Float4 r = reciprocal(s2 * s2 + c2 * c2, pp, true);
+			return (c2 * c2 - s2 * s2) * r;
+		}
+
+		return parabolicSine(quarterTurn(y));
+	}
+
+	void sineCosine(RValue<Float4> x, Float4 &sin, Float4 &cos, bool pp)
+	{
+		Float4 y = reduceTurns(x);
+
+		if(!pp)
+		{
+			Float4 s2, c2;
+			halfAngle(y, s2, c2);
+			Float4 r = reciprocal(s2 * s2 + c2 * c2, pp, true);
+			sin = Float4(2.0f) * s2 * c2 * r;
+			cos = (c2 * c2 - s2 * s2) * r;
+		}
+		else
+		{
+			sin = parabolicSine(y);
+			cos = parabolicSine(quarterTurn(y));
+		}
 	}
 
 	Float4 tangent(RValue<Float4> x, bool pp)
 	{
-		return sine(x, pp) / cosine(x, pp);
+		Float4 y = reduceTurns(x);
+
+		if(!pp)
+		{
+			// The normalization of the sine and cosine cancels out
+			Float4 s2, c2;
+			halfAngle(y, s2, c2);
+			return Float4(2.0f) * s2 * c2 / (c2 * c2 - s2 * s2);
+		}
+
+		return parabolicSine(y) / parabolicSine(quarterTurn(y));
 	}
 
 	Float4 arccos(RValue<Float4> x, bool pp)
@@ -463,12 +546,12 @@ namespace sw
 
 	Float4 dot3(const Vector4f &v0, const Vector4f &v1)
 	{
-		return v0.x * v1.x + v0.y * v1.y + v0.z * v1.z;
+		return FMA(v0.z, v1.z, FMA(v0.y, v1.y, v0.x * v1.x));
 	}
 
 	Float4 dot4(const Vector4f &v0, const Vector4f &v1)
 	{
-		return v0.x * v1.x + v0.y * v1.y + v0.z * v1.z + v0.w * v1.w;
+		return FMA(v0.w, v1.w, FMA(v0.z, v1.z, FMA(v0.y, v1.y, v0.x * v1.x)));
 	}
 
 	void transpose4x4(Short4 &row0, Short4 &row1, Short4 &row2, Short4 &row3)
@@ -783,10 +866,10 @@ namespace sw
 
 	void ShaderCore::mad(Vector4f &dst, const Vector4f &src0, const Vector4f &src1, const Vector4f &src2)
 	{
-		dst.x = src0.x * src1.x + src2.x;
-		dst.y = src0.y * src1.y + src2.y;
-		dst.z = src0.z * src1.z + src2.z;
-		dst.w = src0.w * src1.w + src2.w;
+		dst.x = FMA(src0.x, src1.x, src2.x);
+		dst.y = FMA(src0.y, src1.y, src2.y);
+		dst.z = FMA(src0.z, src1.z, src2.z);
+		dst.w = FMA(src0.w, src1.w, src2.w);
 	}
 
 	void ShaderCore::imad(Vector4f &dst, const Vector4f &src0, const Vector4f &src1, const Vector4f &src2)
@@ -1585,8 +1668,7 @@ namespace sw
 
 	void ShaderCore::sincos(Vector4f &dst, const Vector4f &src, bool pp)
 	{
-		dst.x = cosine_pi(src.x, pp);
-		dst.y = sine_pi(src.x, pp);
+		sineCosine(src.x, dst.y, dst.x, pp);
 	}
 
 	void ShaderCore::cos(Vector4f &dst, const Vector4f &src, bool pp)
@@ -2003,4 +2085,64 @@ namespace sw
 		dst.z = dst.x;
 		dst.w = dst.x;
 	}
+
+	#if SHADER_PROFILE
+		void ShaderCore::profileShader(const Shader *shader, RValue<Pointer<Byte>> profiles, RValue<Int> thread)
+		{
+			profileSlot = ShaderProfile::get(shader);
+
+			if(profileSlot != -1)
+			{
+				profile = *Pointer<Pointer<Byte>>(profiles + profileSlot * (int)sizeof(ShaderProfile::Counter*));
+				profile += thread * Int((int)(shader->getLength() * sizeof(ShaderProfile::Counter)));
+			}
+		}
+
+		void ShaderCore::profileBegin(size_t index, Shader::Opcode opcode)
+		{
+			if(profileSlot == -1)
+			{
+				return;
+			}
+
+			// A label starts a new function, only reached through its calls
+			if(opcode != Shader::OPCODE_LABEL)
+			{
+				profileExecution(index);
+			}
+
+			#if SHADER_PROFILE >= 2
+				profileBlock = Nucleus::getInsertBlock();
+				profileTime = Ticks();
+			#endif
+		}
+
+		void ShaderCore::profileEnd(size_t index, Shader::Opcode opcode)
+		{
+			if(profileSlot == -1)
+			{
+				return;
+			}
+
+			if(opcode == Shader::OPCODE_LABEL)
+			{
+				profileExecution(index);
+			}
+
+			#if SHADER_PROFILE >= 2
+				// Flow control continues in another block, which the start time might not dominate
+				if(Nucleus::getInsertBlock() == profileBlock)
+				{
+					Pointer<Long> cycles = profile + (int)(index * sizeof(ShaderProfile::Counter) + OFFSET(ShaderProfile::Counter,cycles));
+					*cycles = *cycles + (Ticks() - profileTime);
+				}
+			#endif
+		}
+
+		void ShaderCore::profileExecution(size_t index)
+		{
+			Pointer<Long> executions = profile + (int)(index * sizeof(ShaderProfile::Counter) + OFFSET(ShaderProfile::Counter,executions));
+			*executions = *executions + Long(Int(1));
+		}
+	#endif
 }
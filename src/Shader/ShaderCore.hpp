@@ -16,6 +16,7 @@
 #define sw_ShaderCore_hpp
 
 #include "Shader.hpp"
+#include "ShaderProfile.hpp"
 #include "Reactor/Reactor.hpp"
 #include "Common/Debug.hpp"
 
@@ -67,6 +68,7 @@ namespace sw
 	Float4 cosine_pi(RValue<Float4> x, bool pp = false);   // limited to [-pi, pi] range
 	Float4 sine(RValue<Float4> x, bool pp = false);
 	Float4 cosine(RValue<Float4> x, bool pp = false);
+	void sineCosine(RValue<Float4> x, Float4 &sin, Float4 &cos, bool pp = false);   // Shares the range reduction
 	Float4 tangent(RValue<Float4> x, bool pp = false);
 	Float4 arccos(RValue<Float4> x, bool pp = false);
 	Float4 arcsin(RValue<Float4> x, bool pp = false);
@@ -370,7 +372,26 @@ namespace sw
 		void equal(Vector4f &dst, const Vector4f &src0, const Vector4f &src1);
 		void notEqual(Vector4f &dst, const Vector4f &src0, const Vector4f &src1);
 
+		#if SHADER_PROFILE
+			// Brackets the code of each instruction with updates of its ShaderProfile counters
+			void profileShader(const Shader *shader, RValue<Pointer<Byte>> profiles, RValue<Int> thread);
+			void profileBegin(size_t index, Shader::Opcode opcode);
+			void profileEnd(size_t index, Shader::Opcode opcode);
+		#endif
+
 	private:
+		#if SHADER_PROFILE
+			void profileExecution(size_t index);
+
+			int profileSlot = -1;
+			Pointer<Byte> profile;   // Counters of the current thread
+
+			#if SHADER_PROFILE >= 2
+				BasicBlock *profileBlock = nullptr;
+				Long profileTime;
+			#endif
+		#endif
+
 		void sgn(Float4 &dst, const Float4 &src);
 		void isgn(Float4 &dst, const Float4 &src);
 		void cmp0(Float4 &dst, const Float4 &src0, const Float4 &src1, const Float4 &src2);
@@ -0,0 +1,169 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ShaderProfile.hpp"
+
+#include "Shader.hpp"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+namespace
+{
+	struct Entry
+	{
+		int slot;
+		sw::Shader::ShaderType shaderType;
+		std::vector<std::string> instructions;
+		std::vector<int> lines;
+		std::vector<sw::ShaderProfile::Counter> counters;   // [MAX_THREAD_COUNT][instructions.size()]
+	};
+
+	class Registry
+	{
+	public:
+		~Registry()
+		{
+			sw::ShaderProfile::report();
+		}
+
+		std::mutex mutex;
+		std::map<uint64_t, Entry> entries;   // Indexed by shader content ID
+		sw::ShaderProfile::Counter *table[sw::ShaderProfile::SLOTS] = {};
+		int slots = 0;
+	};
+
+	Registry registry;
+}
+
+namespace sw
+{
+	int ShaderProfile::get(const Shader *shader)
+	{
+		std::lock_guard<std::mutex> lock(registry.mutex);
+
+		auto it = registry.entries.find(shader->getContentID());
+
+		if(it != registry.entries.end())
+		{
+			return it->second.slot;
+		}
+
+		size_t length = shader->getLength();
+
+		if(registry.slots == SLOTS || length == 0)
+		{
+			return -1;
+		}
+
+		// std::map nodes don't move, and the counters are never resized, so the table stays valid
+		Entry &entry = registry.entries[shader->getContentID()];
+
+		entry.slot = registry.slots++;
+		entry.shaderType = shader->getShaderType();
+		entry.instructions.resize(length);
+		entry.lines.resize(length);
+		entry.counters.resize(MAX_THREAD_COUNT * length, Counter{0, 0});
+
+		for(size_t i = 0; i < length; i++)
+		{
+			const Shader::Instruction *instruction = shader->getInstruction(i);
+
+			entry.instructions[i] = instruction->string(shader->getShaderType(), shader->getShaderModel());
+			entry.lines[i] = instruction->line;
+		}
+
+		registry.table[entry.slot] = &entry.counters[0];
+
+		return entry.slot;
+	}
+
+	ShaderProfile::Counter **ShaderProfile::table()
+	{
+		return registry.table;
+	}
+
+	void ShaderProfile::report()
+	{
+		std::lock_guard<std::mutex> lock(registry.mutex);
+
+		if(registry.entries.empty())
+		{
+			return;
+		}
+
+		const char *path = getenv("SWIFTSHADER_SHADER_PROFILE");
+		FILE *file = fopen(path ? path : "shader_profile.txt", "w");
+
+		if(!file)
+		{
+			return;
+		}
+
+		for(auto &it : registry.entries)
+		{
+			const Entry &entry = it.second;
+			size_t length = entry.instructions.size();
+
+			std::vector<Counter> total(length, Counter{0, 0});
+			int64_t totalCycles = 0;
+
+			for(int thread = 0; thread < MAX_THREAD_COUNT; thread++)
+			{
+				for(size_t i = 0; i < length; i++)
+				{
+					total[i].executions += entry.counters[thread * length + i].executions;
+					total[i].cycles += entry.counters[thread * length + i].cycles;
+				}
+			}
+
+			std::vector<size_t> order(length);
+
+			for(size_t i = 0; i < length; i++)
+			{
+				order[i] = i;
+				totalCycles += total[i].cycles;
+			}
+
+			// Without cycle samples the execution counts are the best estimate of the cost
+			std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+			{
+				return totalCycles ? total[a].cycles > total[b].cycles : total[a].executions > total[b].executions;
+			});
+
+			fprintf(file, "%s shader %016" PRIx64 ", %" PRIu64 " cycles\n", entry.shaderType == Shader::SHADER_PIXEL ? "Pixel" : "Vertex", it.first, totalCycles);
+
+			for(size_t i : order)
+			{
+				if(total[i].executions == 0)
+				{
+					break;
+				}
+
+				fprintf(file, "%5d  line %4d  %12" PRId64 " executions  %14" PRId64 " cycles  %s\n",
+				        (int)i, entry.lines[i], total[i].executions, total[i].cycles, entry.instructions[i].c_str());
+			}
+
+			fprintf(file, "\n");
+		}
+
+		fclose(file);
+	}
+}
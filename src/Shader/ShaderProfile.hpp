@@ -0,0 +1,51 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef sw_ShaderProfile_hpp
+#define sw_ShaderProfile_hpp
+
+#include "Main/Config.hpp"
+
+#include <stdint.h>
+
+namespace sw
+{
+	class Shader;
+
+	// Per-instruction execution counters of the generated shader programs, enabled by SHADER_PROFILE.
+	// The counters of a shader live until exit, when they get written to SWIFTSHADER_SHADER_PROFILE
+	// (shader_profile.txt by default), most expensive instructions first.
+	class ShaderProfile
+	{
+	public:
+		struct Counter
+		{
+			int64_t executions;   // Quads or vertex groups which executed the instruction
+			int64_t cycles;       // Sampled with SHADER_PROFILE 2, excluding flow control
+		};
+
+		// Returns the table slot of the shader's counters, laid out as [MAX_THREAD_COUNT][shader->getLength()],
+		// or -1 when the table is full. Shaders with the same content share a slot. Slots are only valid
+		// within the process, so routines loaded from the on-disk routine cache don't get profiled.
+		static int get(const Shader *shader);
+
+		static Counter **table();   // Counters of each slot, referenced by DrawData::shaderProfile
+
+		static void report();
+
+		enum {SLOTS = 1024};
+	};
+}
+
+#endif   // sw_ShaderProfile_hpp
@@ -248,249 +248,43 @@ namespace sw
 
 			for(int i = 0; i < 8; i++)
 			{
-				if(!(state.vertexLightActive & (1 << i)))
+				if(state.genericLighting)
 				{
-					continue;
-				}
-
-				Vector4f L;    // Light vector
-				Float4 att;   // Attenuation
-
-				// Attenuation
-				{
-					Float4 d;   // Distance
-
-					L.x = L.y = L.z = *Pointer<Float4>(data + OFFSET(DrawData,ff.lightPosition[i]));   // FIXME: Unpack
-					L.x = L.x.xxxx;
-					L.y = L.y.yyyy;
-					L.z = L.z.zzzz;
-
-					L.x -= vertexPosition.x;
-					L.y -= vertexPosition.y;
-					L.z -= vertexPosition.z;
-					d = dot3(L, L);
-					d = RcpSqrt_pp(d);     // FIXME: Sufficient precision?
-					L.x *= d;
-					L.y *= d;
-					L.z *= d;
-					d = Rcp_pp(d);       // FIXME: Sufficient precision?
-
-					Float4 q = *Pointer<Float4>(data + OFFSET(DrawData,ff.attenuationQuadratic[i]));
-					Float4 l = *Pointer<Float4>(data + OFFSET(DrawData,ff.attenuationLinear[i]));
-					Float4 c = *Pointer<Float4>(data + OFFSET(DrawData,ff.attenuationConstant[i]));
-
-					att = Rcp_pp((q * d + l) * d + c);
-				}
-
-				// Ambient per light
-				{
-					Float4 lightAmbient = *Pointer<Float4>(data + OFFSET(DrawData,ff.lightAmbient[i]));   // FIXME: Unpack
-
-					ambient.x = ambient.x + lightAmbient.x * att;
-					ambient.y = ambient.y + lightAmbient.y * att;
-					ambient.z = ambient.z + lightAmbient.z * att;
-				}
-
-				// Diffuse
-				if(state.vertexNormalActive)
-				{
-					Float4 dot;
-
-					dot = dot3(L, normal);
-					dot = Max(dot, Float4(0.0f));
-					dot *= att;
-
-					Vector4f diff;
-
-					if(state.vertexDiffuseMaterialSourceActive == MATERIAL_MATERIAL)
-					{
-						diff.x = diff.y = diff.z = *Pointer<Float4>(data + OFFSET(DrawData,ff.materialDiffuse));   // FIXME: Unpack
-						diff.x = diff.x.xxxx;
-						diff.y = diff.y.yyyy;
-						diff.z = diff.z.zzzz;
-					}
-					else if(state.vertexDiffuseMaterialSourceActive == MATERIAL_COLOR1)
+					If(*Pointer<Int>(data + OFFSET(DrawData,ff.lightActive[i])) != 0)
 					{
-						diff = v[Color0];
+						addLight(i, vertexPosition, normal, ambient);
 					}
-					else if(state.vertexDiffuseMaterialSourceActive == MATERIAL_COLOR2)
-					{
-						diff = v[Color1];
-					}
-					else ASSERT(false);
-
-					Float4 lightDiffuse = *Pointer<Float4>(data + OFFSET(DrawData,ff.lightDiffuse[i]));
-
-					o[C0].x = o[C0].x + diff.x * dot * lightDiffuse.x;   // FIXME: Clamp first?
-					o[C0].y = o[C0].y + diff.y * dot * lightDiffuse.y;   // FIXME: Clamp first?
-					o[C0].z = o[C0].z + diff.z * dot * lightDiffuse.z;   // FIXME: Clamp first?
 				}
-
-				// Specular
-				if(state.vertexSpecularActive)
+				else if(state.vertexLightActive & (1 << i))
 				{
-					Vector4f S;
-					Vector4f C;   // Camera vector
-					Float4 pow;
-
-					pow = *Pointer<Float>(data + OFFSET(DrawData,ff.materialShininess));
-
-					S.x = Float4(0.0f) - vertexPosition.x;
-					S.y = Float4(0.0f) - vertexPosition.y;
-					S.z = Float4(0.0f) - vertexPosition.z;
-					C = normalize(S);
-
-					S.x = L.x + C.x;
-					S.y = L.y + C.y;
-					S.z = L.z + C.z;
-					C = normalize(S);
-
-					Float4 dot = Max(dot3(C, normal), Float4(0.0f));   // FIXME: max(dot3(C, normal), 0)
-
-					Float4 P = power(dot, pow);
-					P *= att;
-
-					Vector4f spec;
-
-					if(state.vertexSpecularMaterialSourceActive == MATERIAL_MATERIAL)
-					{
-						Float4 materialSpecular = *Pointer<Float4>(data + OFFSET(DrawData,ff.materialSpecular));   // FIXME: Unpack
-
-						spec.x = materialSpecular.x;
-						spec.y = materialSpecular.y;
-						spec.z = materialSpecular.z;
-					}
-					else if(state.vertexSpecularMaterialSourceActive == MATERIAL_COLOR1)
-					{
-						spec = v[Color0];
-					}
-					else if(state.vertexSpecularMaterialSourceActive == MATERIAL_COLOR2)
-					{
-						spec = v[Color1];
-					}
-					else ASSERT(false);
-
-					Float4 lightSpecular = *Pointer<Float4>(data + OFFSET(DrawData,ff.lightSpecular[i]));
-
-					spec.x *= lightSpecular.x;
-					spec.y *= lightSpecular.y;
-					spec.z *= lightSpecular.z;
-
-					spec.x *= P;
-					spec.y *= P;
-					spec.z *= P;
-
-					spec.x = Max(spec.x, Float4(0.0f));
-					spec.y = Max(spec.y, Float4(0.0f));
-					spec.z = Max(spec.z, Float4(0.0f));
-
-					if(secondaryColor)
-					{
-						o[C1].x = o[C1].x + spec.x;
-						o[C1].y = o[C1].y + spec.y;
-						o[C1].z = o[C1].z + spec.z;
-					}
-					else
-					{
-						o[C0].x = o[C0].x + spec.x;
-						o[C0].y = o[C0].y + spec.y;
-						o[C0].z = o[C0].z + spec.z;
-					}
+					addLight(i, vertexPosition, normal, ambient);
 				}
 			}
 
-			if(state.vertexAmbientMaterialSourceActive == MATERIAL_MATERIAL)
-			{
-				Float4 materialAmbient = *Pointer<Float4>(data + OFFSET(DrawData,ff.materialAmbient));   // FIXME: Unpack
+			Vector4f materialAmbient = materialColor(state.vertexAmbientMaterialSourceActive, OFFSET(DrawData,ff.materialAmbient), VertexProcessor::FixedFunction::AMBIENT_SOURCE);
 
-				ambient.x = ambient.x * materialAmbient.x;
-				ambient.y = ambient.y * materialAmbient.y;
-				ambient.z = ambient.z * materialAmbient.z;
-			}
-			else if(state.vertexAmbientMaterialSourceActive == MATERIAL_COLOR1)
-			{
-				Vector4f materialDiffuse = v[Color0];
-
-				ambient.x = ambient.x * materialDiffuse.x;
-				ambient.y = ambient.y * materialDiffuse.y;
-				ambient.z = ambient.z * materialDiffuse.z;
-			}
-			else if(state.vertexAmbientMaterialSourceActive == MATERIAL_COLOR2)
-			{
-				Vector4f materialSpecular = v[Color1];
-
-				ambient.x = ambient.x * materialSpecular.x;
-				ambient.y = ambient.y * materialSpecular.y;
-				ambient.z = ambient.z * materialSpecular.z;
-			}
-			else ASSERT(false);
+			ambient.x = ambient.x * materialAmbient.x;
+			ambient.y = ambient.y * materialAmbient.y;
+			ambient.z = ambient.z * materialAmbient.z;
 
 			o[C0].x = o[C0].x + ambient.x;
 			o[C0].y = o[C0].y + ambient.y;
 			o[C0].z = o[C0].z + ambient.z;
 
 			// Emissive
-			if(state.vertexEmissiveMaterialSourceActive == MATERIAL_MATERIAL)
-			{
-				Float4 materialEmission = *Pointer<Float4>(data + OFFSET(DrawData,ff.materialEmission));   // FIXME: Unpack
+			Vector4f materialEmission = materialColor(state.vertexEmissiveMaterialSourceActive, OFFSET(DrawData,ff.materialEmission), VertexProcessor::FixedFunction::EMISSIVE_SOURCE);
 
-				o[C0].x = o[C0].x + materialEmission.x;
-				o[C0].y = o[C0].y + materialEmission.y;
-				o[C0].z = o[C0].z + materialEmission.z;
-			}
-			else if(state.vertexEmissiveMaterialSourceActive == MATERIAL_COLOR1)
-			{
-				Vector4f materialSpecular = v[Color0];
-
-				o[C0].x = o[C0].x + materialSpecular.x;
-				o[C0].y = o[C0].y + materialSpecular.y;
-				o[C0].z = o[C0].z + materialSpecular.z;
-			}
-			else if(state.vertexEmissiveMaterialSourceActive == MATERIAL_COLOR2)
-			{
-				Vector4f materialSpecular = v[Color1];
-
-				o[C0].x = o[C0].x + materialSpecular.x;
-				o[C0].y = o[C0].y + materialSpecular.y;
-				o[C0].z = o[C0].z + materialSpecular.z;
-			}
-			else ASSERT(false);
+			o[C0].x = o[C0].x + materialEmission.x;
+			o[C0].y = o[C0].y + materialEmission.y;
+			o[C0].z = o[C0].z + materialEmission.z;
 
 			// Diffuse alpha component
-			if(state.vertexDiffuseMaterialSourceActive == MATERIAL_MATERIAL)
-			{
-				o[C0].w = Float4(*Pointer<Float4>(data + OFFSET(DrawData,ff.materialDiffuse[0]))).wwww;   // FIXME: Unpack
-			}
-			else if(state.vertexDiffuseMaterialSourceActive == MATERIAL_COLOR1)
-			{
-				Vector4f alpha = v[Color0];
-				o[C0].w = alpha.w;
-			}
-			else if(state.vertexDiffuseMaterialSourceActive == MATERIAL_COLOR2)
-			{
-				Vector4f alpha = v[Color1];
-				o[C0].w = alpha.w;
-			}
-			else ASSERT(false);
+			o[C0].w = materialColor(state.vertexDiffuseMaterialSourceActive, OFFSET(DrawData,ff.materialDiffuse), VertexProcessor::FixedFunction::DIFFUSE_SOURCE).w;
 
 			if(state.vertexSpecularActive)
 			{
 				// Specular alpha component
-				if(state.vertexSpecularMaterialSourceActive == MATERIAL_MATERIAL)
-				{
-					o[C1].w = Float4(*Pointer<Float4>(data + OFFSET(DrawData,ff.materialSpecular[3]))).wwww;   // FIXME: Unpack
-				}
-				else if(state.vertexSpecularMaterialSourceActive == MATERIAL_COLOR1)
-				{
-					Vector4f alpha = v[Color0];
-					o[C1].w = alpha.w;
-				}
-				else if(state.vertexSpecularMaterialSourceActive == MATERIAL_COLOR2)
-				{
-					Vector4f alpha = v[Color1];
-					o[C1].w = alpha.w;
-				}
-				else ASSERT(false);
+				o[C1].w = materialColor(state.vertexSpecularMaterialSourceActive, OFFSET(DrawData,ff.materialSpecular), VertexProcessor::FixedFunction::SPECULAR_SOURCE).w;
 			}
 		}
 
@@ -541,6 +335,160 @@ namespace sw
 		processPointSize();
 	}
 
+	void VertexPipeline::addLight(int i, Vector4f &vertexPosition, Vector4f &normal, Vector4f &ambient)
+	{
+		Vector4f L;    // Light vector
+		Float4 att;   // Attenuation
+
+		// Attenuation
+		{
+			Float4 d;   // Distance
+
+			L.x = L.y = L.z = *Pointer<Float4>(data + OFFSET(DrawData,ff.lightPosition[i]));   // FIXME: Unpack
+			L.x = L.x.xxxx;
+			L.y = L.y.yyyy;
+			L.z = L.z.zzzz;
+
+			L.x -= vertexPosition.x;
+			L.y -= vertexPosition.y;
+			L.z -= vertexPosition.z;
+			d = dot3(L, L);
+			d = RcpSqrt_pp(d);     // FIXME: Sufficient precision?
+			L.x *= d;
+			L.y *= d;
+			L.z *= d;
+			d = Rcp_pp(d);       // FIXME: Sufficient precision?
+
+			Float4 q = *Pointer<Float4>(data + OFFSET(DrawData,ff.attenuationQuadratic[i]));
+			Float4 l = *Pointer<Float4>(data + OFFSET(DrawData,ff.attenuationLinear[i]));
+			Float4 c = *Pointer<Float4>(data + OFFSET(DrawData,ff.attenuationConstant[i]));
+
+			att = Rcp_pp((q * d + l) * d + c);
+		}
+
+		// Ambient per light
+		{
+			Float4 lightAmbient = *Pointer<Float4>(data + OFFSET(DrawData,ff.lightAmbient[i]));   // FIXME: Unpack
+
+			ambient.x = ambient.x + lightAmbient.x * att;
+			ambient.y = ambient.y + lightAmbient.y * att;
+			ambient.z = ambient.z + lightAmbient.z * att;
+		}
+
+		// Diffuse
+		if(state.vertexNormalActive)
+		{
+			Float4 dot;
+
+			dot = dot3(L, normal);
+			dot = Max(dot, Float4(0.0f));
+			dot *= att;
+
+			Vector4f diff = materialColor(state.vertexDiffuseMaterialSourceActive, OFFSET(DrawData,ff.materialDiffuse), VertexProcessor::FixedFunction::DIFFUSE_SOURCE);
+
+			Float4 lightDiffuse = *Pointer<Float4>(data + OFFSET(DrawData,ff.lightDiffuse[i]));
+
+			o[C0].x = o[C0].x + diff.x * dot * lightDiffuse.x;   // FIXME: Clamp first?
+			o[C0].y = o[C0].y + diff.y * dot * lightDiffuse.y;   // FIXME: Clamp first?
+			o[C0].z = o[C0].z + diff.z * dot * lightDiffuse.z;   // FIXME: Clamp first?
+		}
+
+		// Specular
+		if(state.vertexSpecularActive)
+		{
+			Vector4f S;
+			Vector4f C;   // Camera vector
+			Float4 pow;
+
+			pow = *Pointer<Float>(data + OFFSET(DrawData,ff.materialShininess));
+
+			S.x = Float4(0.0f) - vertexPosition.x;
+			S.y = Float4(0.0f) - vertexPosition.y;
+			S.z = Float4(0.0f) - vertexPosition.z;
+			C = normalize(S);
+
+			S.x = L.x + C.x;
+			S.y = L.y + C.y;
+			S.z = L.z + C.z;
+			C = normalize(S);
+
+			Float4 dot = Max(dot3(C, normal), Float4(0.0f));   // FIXME: max(dot3(C, normal), 0)
+
+			Float4 P = power(dot, pow);
+			P *= att;
+
+			Vector4f spec = materialColor(state.vertexSpecularMaterialSourceActive, OFFSET(DrawData,ff.materialSpecular), VertexProcessor::FixedFunction::SPECULAR_SOURCE);
+
+			Float4 lightSpecular = *Pointer<Float4>(data + OFFSET(DrawData,ff.lightSpecular[i]));
+
+			spec.x *= lightSpecular.x;
+			spec.y *= lightSpecular.y;
+			spec.z *= lightSpecular.z;
+
+			spec.x *= P;
+			spec.y *= P;
+			spec.z *= P;
+
+			spec.x = Max(spec.x, Float4(0.0f));
+			spec.y = Max(spec.y, Float4(0.0f));
+			spec.z = Max(spec.z, Float4(0.0f));
+
+			if(secondaryColor)
+			{
+				o[C1].x = o[C1].x + spec.x;
+				o[C1].y = o[C1].y + spec.y;
+				o[C1].z = o[C1].z + spec.z;
+			}
+			else
+			{
+				o[C0].x = o[C0].x + spec.x;
+				o[C0].y = o[C0].y + spec.y;
+				o[C0].z = o[C0].z + spec.z;
+			}
+		}
+	}
+
+	Vector4f VertexPipeline::materialColor(MaterialSource source, int materialOffset, int sourceIndex)
+	{
+		Vector4f color;
+
+		if(state.genericLighting)
+		{
+			// Selected with masks, since the vertex colors aren't necessarily defined
+			Float4 material = *Pointer<Float4>(data + materialOffset);   // FIXME: Unpack
+			Vector4f color0 = v[Color0];
+			Vector4f color1 = v[Color1];
+
+			Int4 useMaterial = *Pointer<Int4>(data + OFFSET(DrawData,ff.materialSource[sourceIndex][MATERIAL_MATERIAL]));
+			Int4 useColor0 = *Pointer<Int4>(data + OFFSET(DrawData,ff.materialSource[sourceIndex][MATERIAL_COLOR1]));
+			Int4 useColor1 = *Pointer<Int4>(data + OFFSET(DrawData,ff.materialSource[sourceIndex][MATERIAL_COLOR2]));
+
+			color.x = As<Float4>((As<Int4>(Float4(material.xxxx)) & useMaterial) | (As<Int4>(color0.x) & useColor0) | (As<Int4>(color1.x) & useColor1));
+			color.y = As<Float4>((As<Int4>(Float4(material.yyyy)) & useMaterial) | (As<Int4>(color0.y) & useColor0) | (As<Int4>(color1.y) & useColor1));
+			color.z = As<Float4>((As<Int4>(Float4(material.zzzz)) & useMaterial) | (As<Int4>(color0.z) & useColor0) | (As<Int4>(color1.z) & useColor1));
+			color.w = As<Float4>((As<Int4>(Float4(material.wwww)) & useMaterial) | (As<Int4>(color0.w) & useColor0) | (As<Int4>(color1.w) & useColor1));
+		}
+		else if(source == MATERIAL_MATERIAL)
+		{
+			color.x = color.y = color.z = color.w = *Pointer<Float4>(data + materialOffset);   // FIXME: Unpack
+			color.x = color.x.xxxx;
+			color.y = color.y.yyyy;
+			color.z = color.z.zzzz;
+			color.w = color.w.wwww;
+		}
+		else if(source == MATERIAL_COLOR1)
+		{
+			color = v[Color0];
+		}
+		else if(source == MATERIAL_COLOR2)
+		{
+			color = v[Color1];
+		}
+		else ASSERT(false);
+
+		return color;
+	}
+
 	void VertexPipeline::processTextureCoordinate(int stage, Vector4f &normal, Vector4f &position)
 	{
 		if(state.output[T0 + stage].write)
@@ -31,6 +31,8 @@ namespace sw
 
 	private:
 		void pipeline(UInt &index) override;
+		void addLight(int i, Vector4f &vertexPosition, Vector4f &normal, Vector4f &ambient);
+		Vector4f materialColor(MaterialSource source, int materialOffset, int sourceIndex);   // Material or vertex color
 		void processTextureCoordinate(int stage, Vector4f &normal, Vector4f &position);
 		void processPointSize();
 
@@ -30,7 +30,7 @@ namespace sw
 		loopRepDepth = 0;
 		currentLabel = -1;
 
-		for(int i = 0; i < 2048; i++)
+		for(int i = 0; i < Shader::MAX_LABELS; i++)
 		{
 			labelBlock[i] = 0;
 		}
@@ -50,8 +50,10 @@ namespace sw
 
 		if(shader->isInstanceIdDeclared())
 		{
-			instanceID = *Pointer<Int>(data + OFFSET(DrawData,instanceID));
+			instanceID = *Pointer<Int>(task + OFFSET(VertexTask,instanceID));
 		}
+
+		floatConstants = *Pointer<Pointer<Byte>>(data + OFFSET(DrawData,vs.c));
 	}
 
 	VertexProgram::~VertexProgram()
@@ -114,6 +116,10 @@ namespace sw
 			}
 		}
 
+		#if SHADER_PROFILE
+			profileShader(shader, *Pointer<Pointer<Byte>>(data + OFFSET(DrawData,shaderProfile)), *Pointer<Int>(task + OFFSET(VertexTask,thread)));
+		#endif
+
 		for(size_t i = 0; i < shader->getLength(); i++)
 		{
 			const Shader::Instruction *instruction = shader->getInstruction(i);
@@ -124,6 +130,10 @@ namespace sw
 				continue;
 			}
 
+			#if SHADER_PROFILE
+				profileBegin(i, opcode);
+			#endif
+
 			Dst dst = instruction->dst;
 			Src src0 = instruction->src[0];
 			Src src1 = instruction->src[1];
@@ -134,7 +144,7 @@ namespace sw
 			bool predicate = instruction->predicate;
 			Control control = instruction->control;
 			bool integer = dst.type == Shader::PARAMETER_ADDR;
-			bool pp = dst.partialPrecision;
+			bool pp = dst.partialPrecision || state.fastMath || (dst.mediumPrecision && state.mediumPrecisionMath);
 
 			Vector4f d;
 			Vector4f s0;
@@ -604,6 +614,10 @@ namespace sw
 					ASSERT(false);
 				}
 			}
+
+			#if SHADER_PROFILE
+				profileEnd(i, opcode);
+			#endif
 		}
 
 		if(currentLabel != -1)
@@ -819,7 +833,7 @@ namespace sw
 	{
 		if(bufferIndex == -1)
 		{
-			return data + OFFSET(DrawData, vs.c[index]);
+			return floatConstants + index * sizeof(float4);
 		}
 		else
 		{
@@ -846,7 +860,7 @@ namespace sw
 			c.z = c.z.zzzz;
 			c.w = c.w.wwww;
 
-			if(shader->containsDefineInstruction())   // Constant may be known at compile time
+			if(shader->containsDefineInstruction() && src.bufferIndex == -1)   // Constant may be known at compile time
 			{
 				for(size_t j = 0; j < shader->getLength(); j++)
 				{
@@ -997,6 +1011,20 @@ namespace sw
 		return enable;
 	}
 
+	Bool VertexProgram::loopCondition()
+	{
+		Bool condition = iteration[loopDepth] > 0;
+
+		if(shader->containsBreakInstruction())
+		{
+			// Exit as soon as no lane remains in the loop, instead of running masked iterations
+			Int4 active = enableStack[enableIndex] & enableBreak;
+			condition = condition && (SignMask(active) != 0);
+		}
+
+		return condition;
+	}
+
 	void VertexProgram::M3X2(Vector4f &dst, Vector4f &src0, Src &src1)
 	{
 		Vector4f row0 = fetchRegister(src1, 0);
@@ -1422,7 +1450,7 @@ namespace sw
 		Nucleus::createBr(testBlock);
 		Nucleus::setInsertBlock(testBlock);
 
-		branch(iteration[loopDepth] > 0, loopBlock, endBlock);
+		branch(loopCondition(), loopBlock, endBlock);
 		Nucleus::setInsertBlock(loopBlock);
 
 		iteration[loopDepth] = iteration[loopDepth] - 1;   // FIXME: --
@@ -1448,7 +1476,7 @@ namespace sw
 		Nucleus::createBr(testBlock);
 		Nucleus::setInsertBlock(testBlock);
 
-		branch(iteration[loopDepth] > 0, loopBlock, endBlock);
+		branch(loopCondition(), loopBlock, endBlock);
 		Nucleus::setInsertBlock(loopBlock);
 
 		iteration[loopDepth] = iteration[loopDepth] - 1;   // FIXME: --
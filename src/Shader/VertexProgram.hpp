@@ -58,6 +58,8 @@ namespace sw
 		Int instanceID;
 		Int4 vertexID;
 
+		Pointer<Byte> floatConstants;   // Loaded once, the draw call's constant block
+
 		typedef Shader::DestinationParameter Dst;
 		typedef Shader::SourceParameter Src;
 		typedef Shader::Control Control;
@@ -74,6 +76,7 @@ namespace sw
 		Int relativeAddress(const Shader::Relative &rel, int bufferIndex = -1);
 		Int4 dynamicAddress(const Shader::Relative &rel);
 		Int4 enableMask(const Shader::Instruction *instruction);
+		Bool loopCondition();
 
 		void M3X2(Vector4f &dst, Vector4f &src0, Src &src1);
 		void M3X3(Vector4f &dst, Vector4f &src0, Src &src1);
@@ -128,8 +131,8 @@ namespace sw
 		BasicBlock *ifFalseBlock[24 + 24];
 		BasicBlock *loopRepTestBlock[4];
 		BasicBlock *loopRepEndBlock[4];
-		BasicBlock *labelBlock[2048];
-		std::vector<BasicBlock*> callRetBlock[2048];
+		BasicBlock *labelBlock[Shader::MAX_LABELS];
+		std::vector<BasicBlock*> callRetBlock[Shader::MAX_LABELS];
 		BasicBlock *returnBlock;
 		bool isConditionalIf[24 + 24];
 		std::vector<Int4> restoreContinue;
@@ -26,6 +26,18 @@ namespace sw
 	extern bool halfIntegerCoordinates;     // Pixel centers are not at integer coordinates
 	extern bool symmetricNormalizedDepth;   // [-1, 1] instead of [0, 1]
 
+	// Same as sw::half's conversion, including denormals, infinities and NaNs
+	static RValue<Float4> halfToFloat(RValue<Int4> halfBits)
+	{
+		UInt4 bits = As<UInt4>(halfBits);
+		UInt4 expmant = bits & UInt4(0x7FFF);
+		UInt4 sign = (bits ^ expmant) << 16;
+		UInt4 infnan = CmpNLE(expmant, UInt4(0x7BFF)) & UInt4(255 << 23);
+		Float4 magnitude = As<Float4>(expmant << 13) * As<Float4>(UInt4((254 - 15) << 23));   // Rebias the exponent by 2^112
+
+		return As<Float4>(As<UInt4>(magnitude) | sign | infnan);
+	}
+
 	VertexRoutine::VertexRoutine(const VertexProcessor::State &state, const VertexShader *shader)
 		: v(shader && shader->indirectAddressableInput),
 		  o(shader && shader->indirectAddressableOutput),
@@ -42,19 +54,31 @@ namespace sw
 		const bool textureSampling = state.textureSampling;
 
 		Pointer<Byte> cache = task + OFFSET(VertexTask,vertexCache);
-		Pointer<Byte> vertexCache = cache + OFFSET(VertexCache,vertex);
-		Pointer<Byte> tagCache = cache + OFFSET(VertexCache,tag);
+		Pointer<Byte> vertexCache = *Pointer<Pointer<Byte>>(cache + OFFSET(VertexCache,vertex));
+		Pointer<Byte> tagCache = *Pointer<Pointer<Byte>>(cache + OFFSET(VertexCache,tag));
+		UInt cacheMask = *Pointer<UInt>(cache + OFFSET(VertexCache,mask));
 
 		UInt vertexCount = *Pointer<UInt>(task + OFFSET(VertexTask,vertexCount));
-		UInt primitiveNumber = *Pointer<UInt>(task + OFFSET(VertexTask, primitiveStart));
 		UInt indexInPrimitive = 0;
 
 		constants = *Pointer<Pointer<Byte>>(data + OFFSET(DrawData,constants));
 
+		loadStreams();
+
+		if(state.transformFeedbackEnabled != 0)
+		{
+			loadTransformFeedback();
+		}
+
 		Do
 		{
+			if(state.indexedDraw)
+			{
+				prefetchStreams(vertexCount);
+			}
+
 			UInt index = *Pointer<UInt>(batch);
-			UInt tagIndex = index & 0x0000003C;
+			UInt tagIndex = index & cacheMask & 0xFFFFFFFC;
 			UInt indexQ = !textureSampling ? UInt(index & 0xFFFFFFFC) : index;   // FIXME: TEXLDL hack to have independent LODs, hurts performance.
 
 			If(*Pointer<UInt>(tagCache + tagIndex) != indexQ)
@@ -70,18 +94,17 @@ namespace sw
 				writeCache(cacheLine0);
 			}
 
-			UInt cacheIndex = index & 0x0000003F;
+			UInt cacheIndex = index & cacheMask;
 			Pointer<Byte> cacheLine = vertexCache + cacheIndex * UInt((int)sizeof(Vertex));
 			writeVertex(vertex, cacheLine);
 
 			if(state.transformFeedbackEnabled != 0)
 			{
-				transformFeedback(vertex, primitiveNumber, indexInPrimitive);
+				transformFeedback(vertex, indexInPrimitive);
 
 				indexInPrimitive++;
 				If(indexInPrimitive == 3)
 				{
-					primitiveNumber++;
 					indexInPrimitive = 0;
 				}
 			}
@@ -95,14 +118,75 @@ namespace sw
 		Return();
 	}
 
+	void VertexRoutine::loadStreams()
+	{
+		for(int i = 0; i < MAX_VERTEX_INPUTS; i++)
+		{
+			if(state.input[i])
+			{
+				streamBuffer[i] = *Pointer<Pointer<Byte>>(data + OFFSET(DrawData,input) + sizeof(void*) * i);
+				streamBuffer[i] += *Pointer<UInt>(task + OFFSET(VertexTask,instanceOffset) + sizeof(unsigned int) * i);
+				streamStride[i] = *Pointer<UInt>(data + OFFSET(DrawData,stride) + sizeof(unsigned int) * i);
+			}
+		}
+	}
+
+	void VertexRoutine::loadTransformFeedback()
+	{
+		// Primitives are numbered over the whole draw, so each batch captures into its own range of the
+		// buffers, known before any unit starts, and the units write their batches concurrently.
+		UInt firstVertex = *Pointer<UInt>(task + OFFSET(VertexTask,primitiveStart)) * UInt(state.verticesPerPrimitive);
+
+		for(int i = 0; i < MAX_TRANSFORM_FEEDBACK_INTERLEAVED_COMPONENTS; i++)
+		{
+			if(state.transformFeedbackEnabled & (1ULL << i))
+			{
+				feedbackStride[i] = *Pointer<UInt>(data + OFFSET(DrawData,vs.str[i])) * UInt((int)sizeof(float));
+				feedbackBuffer[i] = *Pointer<Pointer<Byte>>(data + OFFSET(DrawData,vs.t[i])) + firstVertex * feedbackStride[i];
+			}
+		}
+	}
+
+	void VertexRoutine::prefetchStreams(const UInt &vertexCount)
+	{
+		// Indexed vertices are scattered through the streams, where the hardware prefetchers
+		// don't see them coming. Sequential ones are already read four at a time.
+		If(vertexCount > UInt(PREFETCH_DISTANCE))
+		{
+			UInt index = *Pointer<UInt>(batch + PREFETCH_DISTANCE * sizeof(unsigned int)) & 0xFFFFFFFC;
+
+			for(int i = 0; i < MAX_VERTEX_INPUTS; i++)
+			{
+				if(state.input[i])
+				{
+					Prefetch(streamBuffer[i] + index * streamStride[i]);
+				}
+			}
+		}
+	}
+
 	void VertexRoutine::readInput(UInt &index)
 	{
 		for(int i = 0; i < MAX_VERTEX_INPUTS; i++)
 		{
-			Pointer<Byte> input = *Pointer<Pointer<Byte>>(data + OFFSET(DrawData,input) + sizeof(void*) * i);
-			UInt stride = *Pointer<UInt>(data + OFFSET(DrawData,stride) + sizeof(unsigned int) * i);
+			const Stream &stream = state.input[i];
+
+			if(stream)
+			{
+				v[i] = readStream(streamBuffer[i], streamStride[i], stream, index);
+			}
+			else   // All default components, without touching the stream
+			{
+				bool isNativeFloatAttrib = (stream.attribType == VertexShader::ATTRIBTYPE_FLOAT) || stream.normalized;
+
+				Vector4f defaults;
+				defaults.x = Float4(0.0f);
+				defaults.y = Float4(0.0f);
+				defaults.z = Float4(0.0f);
+				defaults.w = isNativeFloatAttrib ? As<Float4>(Float4(1.0f)) : As<Float4>(Int4(0));
 
-			v[i] = readStream(input, stride, state.input[i], index);
+				v[i] = defaults;
+			}
 		}
 	}
 
@@ -491,56 +575,16 @@ namespace sw
 			break;
 		case STREAMTYPE_HALF:
 			{
-				if(stream.count >= 1)
+				// Converted arithmetically, a lookup table takes 256 KB of mostly cold cache lines
+				for(int i = 0; i < 4 && i < (int)stream.count; i++)
 				{
-					UShort x0 = *Pointer<UShort>(source0 + 0);
-					UShort x1 = *Pointer<UShort>(source1 + 0);
-					UShort x2 = *Pointer<UShort>(source2 + 0);
-					UShort x3 = *Pointer<UShort>(source3 + 0);
-
-					v.x.x = *Pointer<Float>(constants + OFFSET(Constants,half2float) + Int(x0) * 4);
-					v.x.y = *Pointer<Float>(constants + OFFSET(Constants,half2float) + Int(x1) * 4);
-					v.x.z = *Pointer<Float>(constants + OFFSET(Constants,half2float) + Int(x2) * 4);
-					v.x.w = *Pointer<Float>(constants + OFFSET(Constants,half2float) + Int(x3) * 4);
-				}
+					Int4 bits(0);
+					bits = Insert(bits, Int(*Pointer<UShort>(source0 + 2 * i)), 0);
+					bits = Insert(bits, Int(*Pointer<UShort>(source1 + 2 * i)), 1);
+					bits = Insert(bits, Int(*Pointer<UShort>(source2 + 2 * i)), 2);
+					bits = Insert(bits, Int(*Pointer<UShort>(source3 + 2 * i)), 3);
 
-				if(stream.count >= 2)
-				{
-					UShort y0 = *Pointer<UShort>(source0 + 2);
-					UShort y1 = *Pointer<UShort>(source1 + 2);
-					UShort y2 = *Pointer<UShort>(source2 + 2);
-					UShort y3 = *Pointer<UShort>(source3 + 2);
-
-					v.y.x = *Pointer<Float>(constants + OFFSET(Constants,half2float) + Int(y0) * 4);
-					v.y.y = *Pointer<Float>(constants + OFFSET(Constants,half2float) + Int(y1) * 4);
-					v.y.z = *Pointer<Float>(constants + OFFSET(Constants,half2float) + Int(y2) * 4);
-					v.y.w = *Pointer<Float>(constants + OFFSET(Constants,half2float) + Int(y3) * 4);
-				}
-
-				if(stream.count >= 3)
-				{
-					UShort z0 = *Pointer<UShort>(source0 + 4);
-					UShort z1 = *Pointer<UShort>(source1 + 4);
-					UShort z2 = *Pointer<UShort>(source2 + 4);
-					UShort z3 = *Pointer<UShort>(source3 + 4);
-
-					v.z.x = *Pointer<Float>(constants + OFFSET(Constants,half2float) + Int(z0) * 4);
-					v.z.y = *Pointer<Float>(constants + OFFSET(Constants,half2float) + Int(z1) * 4);
-					v.z.z = *Pointer<Float>(constants + OFFSET(Constants,half2float) + Int(z2) * 4);
-					v.z.w = *Pointer<Float>(constants + OFFSET(Constants,half2float) + Int(z3) * 4);
-				}
-
-				if(stream.count >= 4)
-				{
-					UShort w0 = *Pointer<UShort>(source0 + 6);
-					UShort w1 = *Pointer<UShort>(source1 + 6);
-					UShort w2 = *Pointer<UShort>(source2 + 6);
-					UShort w3 = *Pointer<UShort>(source3 + 6);
-
-					v.w.x = *Pointer<Float>(constants + OFFSET(Constants,half2float) + Int(w0) * 4);
-					v.w.y = *Pointer<Float>(constants + OFFSET(Constants,half2float) + Int(w1) * 4);
-					v.w.z = *Pointer<Float>(constants + OFFSET(Constants,half2float) + Int(w2) * 4);
-					v.w.w = *Pointer<Float>(constants + OFFSET(Constants,half2float) + Int(w3) * 4);
+					v[i] = halfToFloat(bits);
 				}
 			}
 			break;
@@ -752,12 +796,10 @@ namespace sw
 		*Pointer<Int>(vertex + OFFSET(Vertex,clipFlags)) = *Pointer<Int>(cache + OFFSET(Vertex,clipFlags));
 	}
 
-	void VertexRoutine::transformFeedback(const Pointer<Byte> &vertex, const UInt &primitiveNumber, const UInt &indexInPrimitive)
+	void VertexRoutine::transformFeedback(const Pointer<Byte> &vertex, const UInt &indexInPrimitive)
 	{
 		If(indexInPrimitive < state.verticesPerPrimitive)
 		{
-			UInt tOffset = primitiveNumber * state.verticesPerPrimitive + indexInPrimitive;
-
 			for(int i = 0; i < MAX_TRANSFORM_FEEDBACK_INTERLEAVED_COMPONENTS; i++)
 			{
 				if(state.transformFeedbackEnabled & (1ULL << i))
@@ -765,9 +807,8 @@ namespace sw
 					UInt reg = *Pointer<UInt>(data + OFFSET(DrawData, vs.reg[i]));
 					UInt row = *Pointer<UInt>(data + OFFSET(DrawData, vs.row[i]));
 					UInt col = *Pointer<UInt>(data + OFFSET(DrawData, vs.col[i]));
-					UInt str = *Pointer<UInt>(data + OFFSET(DrawData, vs.str[i]));
 
-					Pointer<Byte> t = *Pointer<Pointer<Byte>>(data + OFFSET(DrawData, vs.t[i])) + (tOffset * str * sizeof(float));
+					Pointer<Byte> t = feedbackBuffer[i];
 					Pointer<Byte> v = vertex + OFFSET(Vertex, v) + reg * sizeof(float);
 
 					For(UInt r = 0, r < row, r++)
@@ -781,6 +822,8 @@ namespace sw
 							*Pointer<Float>(t + rOffsetX + cOffset) = *Pointer<Float>(v + rOffset4 + cOffset);
 						}
 					}
+
+					feedbackBuffer[i] += feedbackStride[i];
 				}
 			}
 		}
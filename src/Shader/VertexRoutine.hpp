@@ -58,13 +58,26 @@ namespace sw
 
 		typedef VertexProcessor::State::Input Stream;
 
+		// Loaded once per batch, for the streams which contain data
+		Pointer<Byte> streamBuffer[MAX_VERTEX_INPUTS];
+		UInt streamStride[MAX_VERTEX_INPUTS];
+
+		// Where the batch's next captured vertex goes, for the enabled transform feedback components
+		Pointer<Byte> feedbackBuffer[MAX_TRANSFORM_FEEDBACK_INTERLEAVED_COMPONENTS];
+		UInt feedbackStride[MAX_TRANSFORM_FEEDBACK_INTERLEAVED_COMPONENTS];
+
+		enum {PREFETCH_DISTANCE = 8};   // Vertices ahead whose inputs get prefetched
+
+		void loadStreams();
+		void loadTransformFeedback();
+		void prefetchStreams(const UInt &vertexCount);
 		Vector4f readStream(Pointer<Byte> &buffer, UInt &stride, const Stream &stream, const UInt &index);
 		void readInput(UInt &index);
 		void computeClipFlags();
 		void postTransform();
 		void writeCache(Pointer<Byte> &cacheLine);
 		void writeVertex(const Pointer<Byte> &vertex, Pointer<Byte> &cacheLine);
-		void transformFeedback(const Pointer<Byte> &vertex, const UInt &primitiveNumber, const UInt &indexInPrimitive);
+		void transformFeedback(const Pointer<Byte> &vertex, const UInt &indexInPrimitive);
 	};
 }
 
@@ -16,6 +16,7 @@
 
 #include "Renderer/Vertex.hpp"
 #include "Common/Debug.hpp"
+#include "Common/BinaryStream.hpp"
 
 #include <string.h>
 
@@ -23,6 +24,7 @@ namespace sw
 {
 	VertexShader::VertexShader(const VertexShader *vs) : Shader()
 	{
+		shaderType = SHADER_VERTEX;
 		shaderModel = 0x0300;
 		positionRegister = Pos;
 		pointSizeRegister = Unused;
@@ -51,6 +53,7 @@ namespace sw
 			instanceIdDeclared = vs->instanceIdDeclared;
 			vertexIdDeclared = vs->vertexIdDeclared;
 			usedSamplers = vs->usedSamplers;
+			setFastMath(vs->isFastMath());
 
 			optimize();
 			analyze();
@@ -157,6 +160,60 @@ namespace sw
 		return textureSampling;
 	}
 
+	void VertexShader::appendContent(Content &content) const
+	{
+		Shader::appendContent(content);
+		append(content, input, sizeof(input));
+		append(content, output, sizeof(output));
+		append(content, attribType, sizeof(attribType));
+
+		const int registers[] = {positionRegister, pointSizeRegister, instanceIdDeclared, vertexIdDeclared, textureSampling};
+
+		append(content, registers, sizeof(registers));
+	}
+
+	void VertexShader::serialize(BinaryWriter &binary) const
+	{
+		Shader::serialize(binary);
+
+		binary.write(input);
+		binary.write(output);
+		binary.write(attribType);
+		binary.write(positionRegister);
+		binary.write(pointSizeRegister);
+		binary.write(instanceIdDeclared);
+		binary.write(vertexIdDeclared);
+	}
+
+	bool VertexShader::deserialize(BinaryReader &binary)
+	{
+		if(!Shader::deserialize(binary))
+		{
+			return false;
+		}
+
+		binary.read(input);
+		binary.read(output);
+		binary.read(attribType);
+		binary.read(positionRegister);
+		binary.read(pointSizeRegister);
+		binary.read(instanceIdDeclared);
+		binary.read(vertexIdDeclared);
+
+		for(int i = 0; i < MAX_VERTEX_INPUTS; i++)
+		{
+			if(attribType[i] > ATTRIBTYPE_LAST)
+			{
+				return false;
+			}
+		}
+
+		bool validPosition = (positionRegister >= 0 && positionRegister < MAX_VERTEX_OUTPUTS) || positionRegister == Unused;
+		bool validPointSize = (pointSizeRegister >= 0 && pointSizeRegister < MAX_VERTEX_OUTPUTS) || pointSizeRegister == Unused;
+
+		return !binary.failed() && validPosition && validPointSize;
+	}
+
 	void VertexShader::setInput(int inputIdx, const sw::Shader::Semantic& semantic, AttribType aType)
 	{
 		input[inputIdx] = semantic;
@@ -208,6 +265,7 @@ namespace sw
 		analyzeSamplers();
 		analyzeCallSites();
 		analyzeIndirectAddressing();
+		analyzeBranchConstants();
 	}
 
 	void VertexShader::analyzeInput()
@@ -39,6 +39,9 @@ namespace sw
 
 		static int validate(const unsigned long *const token);   // Returns number of instructions if valid
 		bool containsTextureSampling() const;
+		void appendContent(Content &content) const override;
+		void serialize(BinaryWriter &binary) const override;
+		bool deserialize(BinaryReader &binary) override;
 
 		void setInput(int inputIdx, const Semantic& semantic, AttribType attribType = ATTRIBTYPE_FLOAT);
 		void setOutput(int outputIdx, int nbComponents, const Semantic& semantic);
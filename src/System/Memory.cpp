@@ -125,6 +125,28 @@ void deallocate(void *memory)
 	#endif
 }
 
+void *allocatePages(size_t bytes)
+{
+	#if defined(_WIN32)
+		return VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	#else
+		void *memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		return (memory == MAP_FAILED) ? nullptr : memory;
+	#endif
+}
+
+void deallocatePages(void *memory, size_t bytes)
+{
+	if(memory)
+	{
+		#if defined(_WIN32)
+			VirtualFree(memory, 0, MEM_RELEASE);
+		#else
+			munmap(memory, bytes);
+		#endif
+	}
+}
+
 void clear(uint16_t *memory, uint16_t element, size_t count)
 {
 	#if defined(_MSC_VER) && defined(__x86__) && !defined(MEMORY_SANITIZER)
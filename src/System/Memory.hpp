@@ -25,6 +25,9 @@ size_t memoryPageSize();
 void *allocate(size_t bytes, size_t alignment = 16);
 void deallocate(void *memory);
 
+void *allocatePages(size_t bytes);   // Zero-initialized, committed when first touched
+void deallocatePages(void *memory, size_t bytes);
+
 void clear(uint16_t *memory, uint16_t element, size_t count);
 void clear(uint32_t *memory, uint32_t element, size_t count);
 }
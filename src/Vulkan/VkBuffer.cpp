@@ -54,4 +54,9 @@ void Buffer::bind(VkDeviceMemory pDeviceMemory, VkDeviceSize pMemoryOffset)
 	memory = Cast(pDeviceMemory)->getOffsetPointer(pMemoryOffset);
 }
 
+void* Buffer::getOffsetPointer(VkDeviceSize offset) const
+{
+	return reinterpret_cast<uint8_t*>(memory) + offset;
+}
+
 } // namespace vk
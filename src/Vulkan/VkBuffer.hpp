@@ -31,6 +31,8 @@ public:
 
 	const VkMemoryRequirements getMemoryRequirements() const;
 	void bind(VkDeviceMemory pDeviceMemory, VkDeviceSize pMemoryOffset);
+	void* getOffsetPointer(VkDeviceSize offset) const;
+	VkDeviceSize getSize() const { return size; }
 
 private:
 	void*                 memory = nullptr;
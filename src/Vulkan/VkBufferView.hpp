@@ -35,6 +35,11 @@ public:
 		return 0;
 	}
 
+	VkBuffer getBuffer() const { return buffer; }
+	VkFormat getFormat() const { return format; }
+	VkDeviceSize getOffset() const { return offset; }
+	VkDeviceSize getRange() const { return range; }
+
 private:
 	VkBuffer     buffer;
 	VkFormat     format;
@@ -13,34 +13,579 @@
 // limitations under the License.
 
 #include "VkCommandBuffer.hpp"
+#include "VkBuffer.hpp"
+#include "VkComputeEngine.hpp"
+#include "VkDescriptorSet.hpp"
+#include "VkDescriptorSetLayout.hpp"
+#include "VkPipeline.hpp"
+#include "VkQueryPool.hpp"
+#include "VkRenderPass.hpp"
+#include "System/Memory.hpp"
+
+#include <algorithm>
+#include <new>
+#include <string.h>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+	#include <emmintrin.h>
+	#define STREAMING_STORES 1
+#endif
+
+namespace
+{
+	constexpr size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+	constexpr size_t alignUp(size_t size)
+	{
+		return (size + vk::REQUIRED_MEMORY_ALIGNMENT - 1) & ~static_cast<size_t>(vk::REQUIRED_MEMORY_ALIGNMENT - 1);
+	}
+
+	template<typename T>
+	constexpr size_t arraySize(uint32_t count)
+	{
+		return alignUp(count * sizeof(T));
+	}
+
+	// Arrays are copied right after their command, into the same allocation
+	template<typename Command>
+	uint8_t *tail(Command *command)
+	{
+		return reinterpret_cast<uint8_t*>(command) + alignUp(sizeof(Command));
+	}
+
+	template<typename T>
+	const T *copy(uint8_t *&tail, const T *array, uint32_t count)
+	{
+		T *destination = reinterpret_cast<T*>(tail);
+
+		if(count > 0)
+		{
+			memcpy(destination, array, count * sizeof(T));
+		}
+
+		tail += arraySize<T>(count);
+
+		return destination;
+	}
+
+	struct BeginRenderPass
+	{
+		VkRenderPass renderPass;
+		VkFramebuffer framebuffer;
+		VkRect2D renderArea;
+		uint32_t clearValueCount;
+		const VkClearValue* clearValues;
+		VkSubpassContents contents;
+	};
+
+	struct NextSubpass
+	{
+		VkSubpassContents contents;
+	};
+
+	struct EndRenderPass
+	{
+	};
+
+	struct ExecuteCommands
+	{
+		uint32_t commandBufferCount;
+		const VkCommandBuffer* commandBuffers;
+	};
+
+	struct PipelineBarrier
+	{
+		VkPipelineStageFlags srcStageMask;
+		VkPipelineStageFlags dstStageMask;
+		VkDependencyFlags dependencyFlags;
+	};
+
+	struct BindPipeline
+	{
+		VkPipelineBindPoint pipelineBindPoint;
+		VkPipeline pipeline;
+	};
+
+	struct BindVertexBuffers
+	{
+		uint32_t firstBinding;
+		uint32_t bindingCount;
+		const VkBuffer* buffers;
+		const VkDeviceSize* offsets;
+	};
+
+	struct BindIndexBuffer
+	{
+		VkBuffer buffer;
+		VkDeviceSize offset;
+		VkIndexType indexType;
+	};
+
+	struct BindDescriptorSets
+	{
+		VkPipelineBindPoint pipelineBindPoint;
+		VkPipelineLayout layout;
+		uint32_t firstSet;
+		uint32_t descriptorSetCount;
+		const VkDescriptorSet* descriptorSets;
+		uint32_t dynamicOffsetCount;
+		const uint32_t* dynamicOffsets;
+	};
+
+	struct PushConstants
+	{
+		VkPipelineLayout layout;
+		VkShaderStageFlags stageFlags;
+		uint32_t offset;
+		uint32_t size;
+		const uint8_t* values;
+	};
+
+	struct SetViewport
+	{
+		uint32_t firstViewport;
+		uint32_t viewportCount;
+		const VkViewport* viewports;
+	};
+
+	struct SetScissor
+	{
+		uint32_t firstScissor;
+		uint32_t scissorCount;
+		const VkRect2D* scissors;
+	};
+
+	struct SetLineWidth
+	{
+		float lineWidth;
+	};
+
+	struct SetDepthBias
+	{
+		float depthBiasConstantFactor;
+		float depthBiasClamp;
+		float depthBiasSlopeFactor;
+	};
+
+	struct SetBlendConstants
+	{
+		float blendConstants[4];
+	};
+
+	struct SetDepthBounds
+	{
+		float minDepthBounds;
+		float maxDepthBounds;
+	};
+
+	// Compare mask, write mask or reference
+	struct SetStencilValue
+	{
+		VkStencilFaceFlags faceMask;
+		uint32_t value;
+	};
+
+	void setStencilValue(uint32_t values[2], const SetStencilValue* command)
+	{
+		if(command->faceMask & VK_STENCIL_FACE_FRONT_BIT)
+		{
+			values[0] = command->value;
+		}
+
+		if(command->faceMask & VK_STENCIL_FACE_BACK_BIT)
+		{
+			values[1] = command->value;
+		}
+	}
+
+	struct Draw
+	{
+		uint32_t vertexCount;
+		uint32_t instanceCount;
+		uint32_t firstVertex;
+		uint32_t firstInstance;
+	};
+
+	struct DrawIndexed
+	{
+		uint32_t indexCount;
+		uint32_t instanceCount;
+		uint32_t firstIndex;
+		int32_t vertexOffset;
+		uint32_t firstInstance;
+	};
+
+	struct DrawIndirect
+	{
+		VkBuffer buffer;
+		VkDeviceSize offset;
+		uint32_t drawCount;
+		uint32_t stride;
+	};
+
+	struct Dispatch
+	{
+		uint32_t baseGroupX;
+		uint32_t baseGroupY;
+		uint32_t baseGroupZ;
+		uint32_t groupCountX;
+		uint32_t groupCountY;
+		uint32_t groupCountZ;
+	};
+
+	struct DispatchIndirect
+	{
+		VkBuffer buffer;
+		VkDeviceSize offset;
+	};
+
+	struct CopyBuffer
+	{
+		VkBuffer srcBuffer;
+		VkBuffer dstBuffer;
+		uint32_t regionCount;
+		const VkBufferCopy* regions;
+	};
+
+	struct UpdateBuffer
+	{
+		VkBuffer dstBuffer;
+		VkDeviceSize dstOffset;
+		VkDeviceSize dataSize;
+		const uint8_t* data;
+	};
+
+	struct FillBuffer
+	{
+		VkBuffer dstBuffer;
+		VkDeviceSize dstOffset;
+		VkDeviceSize size;
+		uint32_t data;
+	};
+
+	struct CopyImage
+	{
+		VkImage srcImage;
+		VkImageLayout srcImageLayout;
+		VkImage dstImage;
+		VkImageLayout dstImageLayout;
+		uint32_t regionCount;
+		const VkImageCopy* regions;
+	};
+
+	struct BlitImage
+	{
+		VkImage srcImage;
+		VkImageLayout srcImageLayout;
+		VkImage dstImage;
+		VkImageLayout dstImageLayout;
+		uint32_t regionCount;
+		const VkImageBlit* regions;
+		VkFilter filter;
+	};
+
+	struct CopyBufferToImage
+	{
+		VkBuffer srcBuffer;
+		VkImage dstImage;
+		VkImageLayout dstImageLayout;
+		uint32_t regionCount;
+		const VkBufferImageCopy* regions;
+	};
+
+	struct CopyImageToBuffer
+	{
+		VkImage srcImage;
+		VkImageLayout srcImageLayout;
+		VkBuffer dstBuffer;
+		uint32_t regionCount;
+		const VkBufferImageCopy* regions;
+	};
+
+	struct ResolveImage
+	{
+		VkImage srcImage;
+		VkImageLayout srcImageLayout;
+		VkImage dstImage;
+		VkImageLayout dstImageLayout;
+		uint32_t regionCount;
+		const VkImageResolve* regions;
+	};
+
+	struct ResetQueryPool
+	{
+		VkQueryPool queryPool;
+		uint32_t firstQuery;
+		uint32_t queryCount;
+	};
+
+	struct WriteTimestamp
+	{
+		VkQueryPool queryPool;
+		uint32_t query;
+	};
+
+	struct CopyQueryPoolResults
+	{
+		VkQueryPool queryPool;
+		uint32_t firstQuery;
+		uint32_t queryCount;
+		VkBuffer dstBuffer;
+		VkDeviceSize dstOffset;
+		VkDeviceSize stride;
+		VkQueryResultFlags flags;
+	};
+
+	enum : size_t
+	{
+		PARALLEL_TRANSFER_SIZE = 1 << 20,
+		TRANSFER_CHUNK_SIZE = 256 << 10,
+		STREAMING_TRANSFER_SIZE = 8 << 20,   // Destinations this large wouldn't stay in the caches anyway
+	};
+
+	// Copy or fill of buffer memory. Large ones are split in chunks, which are
+	// processed by the compute engine's threads like the workgroups of a dispatch.
+	class BufferTransfer : public vk::ComputeProgram
+	{
+	public:
+		BufferTransfer(uint8_t* dst, const uint8_t* src, size_t size) :
+			dst(dst), src(src), pattern(0), size(size), streaming(size >= STREAMING_TRANSFER_SIZE)
+		{
+		}
+
+		// dst and size are multiples of 4 bytes
+		BufferTransfer(uint8_t* dst, uint32_t pattern, size_t size) :
+			dst(dst), src(nullptr), pattern(pattern), size(size), streaming(size >= STREAMING_TRANSFER_SIZE)
+		{
+		}
+
+		void execute() const
+		{
+			if(size < PARALLEL_TRANSFER_SIZE)
+			{
+				transfer(0, size);
+			}
+			else
+			{
+				uint32_t chunkCount = static_cast<uint32_t>((size + TRANSFER_CHUNK_SIZE - 1) / TRANSFER_CHUNK_SIZE);
+				vk::ComputeEngine::dispatch(*this, 0, 0, 0, chunkCount, 1, 1);
+			}
+		}
+
+		void run(uint32_t groupX, uint32_t groupY, uint32_t groupZ, void* sharedMemory) const override
+		{
+			size_t offset = size_t(groupX) * TRANSFER_CHUNK_SIZE;
+			transfer(offset, std::min<size_t>(size - offset, TRANSFER_CHUNK_SIZE));
+		}
+
+		size_t getSharedMemorySize() const override
+		{
+			return 0;
+		}
+
+	private:
+		void transfer(size_t offset, size_t count) const
+		{
+			uint8_t* d = dst + offset;
+			const uint8_t* s = src ? src + offset : nullptr;
+
+			#if defined(STREAMING_STORES)
+				if(streaming)
+				{
+					// Non-temporal stores need 16 byte aligned destinations
+					size_t head = std::min<size_t>((16 - (reinterpret_cast<uintptr_t>(d) & 15)) & 15, count);
+					transferCached(d, s, head);
+					d += head;
+					s = s ? s + head : nullptr;
+					count -= head;
+
+					size_t body = count & ~size_t(15);
+					if(s)
+					{
+						for(size_t i = 0; i < body; i += 16)
+						{
+							_mm_stream_si128(reinterpret_cast<__m128i*>(d + i), _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i)));
+						}
+					}
+					else
+					{
+						__m128i value = _mm_set1_epi32(pattern);
+						for(size_t i = 0; i < body; i += 16)
+						{
+							_mm_stream_si128(reinterpret_cast<__m128i*>(d + i), value);
+						}
+					}
+
+					_mm_sfence();
+
+					d += body;
+					s = s ? s + body : nullptr;
+					count -= body;
+				}
+			#endif
+
+			transferCached(d, s, count);
+		}
+
+		void transferCached(uint8_t* d, const uint8_t* s, size_t count) const
+		{
+			if(s)
+			{
+				memcpy(d, s, count);
+			}
+			else
+			{
+				sw::clear(reinterpret_cast<uint32_t*>(d), pattern, count / 4);
+			}
+		}
+
+		uint8_t* const dst;
+		const uint8_t* const src;   // Null for fills
+		const uint32_t pattern;
+		const size_t size;
+		const bool streaming;
+	};
+}
 
 namespace vk
 {
 
+void *CommandBuffer::CommandStream::allocate(size_t size)
+{
+	if(!current || current->used + size > current->size)
+	{
+		// Chunks left over from before a rewind get reused when the command fits
+		Chunk *next = current ? current->next : first;
+
+		if(!next || size > next->size)
+		{
+			// FIXME: use the command pool's allocator
+			size_t chunkSize = std::max(size, DEFAULT_CHUNK_SIZE);
+			Chunk *chunk = static_cast<Chunk*>(vk::allocate(sizeof(Chunk) + chunkSize, REQUIRED_MEMORY_ALIGNMENT, nullptr));
+
+			if(!chunk)
+			{
+				return nullptr;
+			}
+
+			chunk->next = next;
+			chunk->size = chunkSize;
+			(current ? current->next : first) = chunk;
+			next = chunk;
+		}
+
+		next->used = 0;
+		current = next;
+	}
+
+	void *memory = data(current) + current->used;
+	current->used += size;
+
+	return memory;
+}
+
+void CommandBuffer::CommandStream::rewind()
+{
+	current = nullptr;
+}
+
+void CommandBuffer::CommandStream::release()
+{
+	while(first)
+	{
+		Chunk *next = first->next;
+		vk::deallocate(first, nullptr);
+		first = next;
+	}
+
+	current = nullptr;
+}
+
+template<typename Function>
+void CommandBuffer::CommandStream::forEach(Function function) const
+{
+	for(Chunk *chunk = current ? first : nullptr; chunk; chunk = chunk->next)
+	{
+		for(size_t offset = 0; offset < chunk->used;)
+		{
+			const CommandHeader *header = reinterpret_cast<const CommandHeader*>(data(chunk) + offset);
+			function(header->type, header + 1);
+			offset += header->size;
+		}
+
+		if(chunk == current)
+		{
+			break;
+		}
+	}
+}
+
+template<typename Command>
+Command *CommandBuffer::record(CommandType type, size_t arraySize)
+{
+	static_assert(std::is_trivially_destructible<Command>::value, "Recorded commands are never destroyed");
+	ASSERT(state == RECORDING);
+
+	size_t size = sizeof(CommandHeader) + alignUp(sizeof(Command)) + arraySize;
+	CommandHeader *header = static_cast<CommandHeader*>(commands.allocate(size));
+
+	if(!header)
+	{
+		outOfMemory = true;
+		return nullptr;
+	}
+
+	header->type = type;
+	header->size = static_cast<uint32_t>(size);
+
+	return new (header + 1) Command;
+}
+
 CommandBuffer::CommandBuffer(VkCommandBufferLevel pLevel) : level(pLevel)
 {
 	pipelines[VK_PIPELINE_BIND_POINT_GRAPHICS] = VK_NULL_HANDLE;
 	pipelines[VK_PIPELINE_BIND_POINT_COMPUTE] = VK_NULL_HANDLE;
+
+	memset(descriptorSets, 0, sizeof(descriptorSets));
+	memset(dynamicOffsets, 0, sizeof(dynamicOffsets));
+	memset(&dynamicState, 0, sizeof(dynamicState));
+	memset(pushConstantData, 0, sizeof(pushConstantData));
 }
 
 void CommandBuffer::destroy(const VkAllocationCallbacks* pAllocator)
 {
+	commands.release();
 }
 
 VkResult CommandBuffer::begin(VkCommandBufferUsageFlags flags, const VkCommandBufferInheritanceInfo* pInheritanceInfo)
 {
-	state = RECORDING;
+	ASSERT(state != RECORDING && state != PENDING);
 
-	UNIMPLEMENTED();
+	// Secondary command buffers are replayed against the state of the primary
+	// executing them, so pInheritanceInfo has nothing to provide when recording
+
+	// Beginning an executable command buffer implicitly resets it
+	commands.rewind();
+	outOfMemory = false;
+
+	state = RECORDING;
 
 	return VK_SUCCESS;
 }
 
 VkResult CommandBuffer::end()
 {
-	state = EXECUTABLE;
+	ASSERT(state == RECORDING);
 
-	UNIMPLEMENTED();
+	if(outOfMemory)
+	{
+		state = INVALID;
+
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+	}
+
+	state = EXECUTABLE;
 
 	return VK_SUCCESS;
 }
@@ -49,9 +594,16 @@ VkResult CommandBuffer::reset(VkCommandPoolResetFlags flags)
 {
 	ASSERT(state != PENDING);
 
-	UNIMPLEMENTED();
+	if(flags & VK_COMMAND_BUFFER_RESET_RELEASE_RESOURCES_BIT)
+	{
+		commands.release();
+	}
+	else
+	{
+		commands.rewind();   // Keeps the chunks for recording again
+	}
 
-	// FIXME: put command buffer back to the initial state
+	outOfMemory = false;
 	state = INITIAL;
 
 	return VK_SUCCESS;
@@ -60,22 +612,48 @@ VkResult CommandBuffer::reset(VkCommandPoolResetFlags flags)
 void CommandBuffer::beginRenderPass(VkRenderPass renderPass, VkFramebuffer framebuffer, VkRect2D renderArea,
                                     uint32_t clearValueCount, const VkClearValue* pClearValues, VkSubpassContents contents)
 {
-	UNIMPLEMENTED();
+	auto command = record<BeginRenderPass>(CMD_BEGIN_RENDER_PASS, arraySize<VkClearValue>(clearValueCount));
+
+	if(command)
+	{
+		uint8_t *arrays = tail(command);
+
+		command->renderPass = renderPass;
+		command->framebuffer = framebuffer;
+		command->renderArea = renderArea;
+		command->clearValueCount = clearValueCount;
+		command->clearValues = copy(arrays, pClearValues, clearValueCount);
+		command->contents = contents;
+	}
 }
 
 void CommandBuffer::nextSubpass(VkSubpassContents contents)
 {
-	UNIMPLEMENTED();
+	auto command = record<NextSubpass>(CMD_NEXT_SUBPASS);
+
+	if(command)
+	{
+		command->contents = contents;
+	}
 }
 
 void CommandBuffer::endRenderPass()
 {
-	UNIMPLEMENTED();
+	record<EndRenderPass>(CMD_END_RENDER_PASS);
 }
 
 void CommandBuffer::executeCommands(uint32_t commandBufferCount, const VkCommandBuffer* pCommandBuffers)
 {
-	UNIMPLEMENTED();
+	// Only the handles are recorded, the secondaries' commands aren't copied
+	auto command = record<ExecuteCommands>(CMD_EXECUTE_COMMANDS, arraySize<VkCommandBuffer>(commandBufferCount));
+
+	if(command)
+	{
+		uint8_t *arrays = tail(command);
+
+		command->commandBufferCount = commandBufferCount;
+		command->commandBuffers = copy(arrays, pCommandBuffers, commandBufferCount);
+	}
 }
 
 void CommandBuffer::setDeviceMask(uint32_t deviceMask)
@@ -86,7 +664,17 @@ void CommandBuffer::setDeviceMask(uint32_t deviceMask)
 void CommandBuffer::dispatchBase(uint32_t baseGroupX, uint32_t baseGroupY, uint32_t baseGroupZ,
                                  uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ)
 {
-	UNIMPLEMENTED();
+	auto command = record<Dispatch>(CMD_DISPATCH);
+
+	if(command)
+	{
+		command->baseGroupX = baseGroupX;
+		command->baseGroupY = baseGroupY;
+		command->baseGroupZ = baseGroupZ;
+		command->groupCountX = groupCountX;
+		command->groupCountY = groupCountY;
+		command->groupCountZ = groupCountZ;
+	}
 }
 
 void CommandBuffer::pipelineBarrier(VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask,
@@ -95,21 +683,43 @@ void CommandBuffer::pipelineBarrier(VkPipelineStageFlags srcStageMask, VkPipelin
                                     uint32_t bufferMemoryBarrierCount, const VkBufferMemoryBarrier* pBufferMemoryBarriers,
                                     uint32_t imageMemoryBarrierCount, const VkImageMemoryBarrier* pImageMemoryBarriers)
 {
-	UNIMPLEMENTED();
+	// Commands are executed in order, so only the stages are kept
+	auto command = record<PipelineBarrier>(CMD_PIPELINE_BARRIER);
+
+	if(command)
+	{
+		command->srcStageMask = srcStageMask;
+		command->dstStageMask = dstStageMask;
+		command->dependencyFlags = dependencyFlags;
+	}
 }
 
 void CommandBuffer::bindPipeline(VkPipelineBindPoint pipelineBindPoint, VkPipeline pipeline)
 {
-	pipelines[pipelineBindPoint] = pipeline;
+	auto command = record<BindPipeline>(CMD_BIND_PIPELINE);
+
+	if(command)
+	{
+		command->pipelineBindPoint = pipelineBindPoint;
+		command->pipeline = pipeline;
+	}
 }
 
 void CommandBuffer::bindVertexBuffers(uint32_t firstBinding, uint32_t bindingCount,
                                       const VkBuffer* pBuffers, const VkDeviceSize* pOffsets)
 {
-	for(uint32_t i = firstBinding; i < (firstBinding + bindingCount); ++i)
+	ASSERT(firstBinding + bindingCount <= MaxVertexInputBindings);
+
+	auto command = record<BindVertexBuffers>(CMD_BIND_VERTEX_BUFFERS, arraySize<VkBuffer>(bindingCount) + arraySize<VkDeviceSize>(bindingCount));
+
+	if(command)
 	{
-		vertexInputBindings[i].buffer = pBuffers[i];
-		vertexInputBindings[i].offset = pOffsets[i];
+		uint8_t *arrays = tail(command);
+
+		command->firstBinding = firstBinding;
+		command->bindingCount = bindingCount;
+		command->buffers = copy(arrays, pBuffers, bindingCount);
+		command->offsets = copy(arrays, pOffsets, bindingCount);
 	}
 }
 
@@ -125,36 +735,90 @@ void CommandBuffer::endQuery(VkQueryPool queryPool, uint32_t query)
 
 void CommandBuffer::resetQueryPool(VkQueryPool queryPool, uint32_t firstQuery, uint32_t queryCount)
 {
-	UNIMPLEMENTED();
+	auto command = record<ResetQueryPool>(CMD_RESET_QUERY_POOL);
+
+	if(command)
+	{
+		command->queryPool = queryPool;
+		command->firstQuery = firstQuery;
+		command->queryCount = queryCount;
+	}
 }
 
 void CommandBuffer::writeTimestamp(VkPipelineStageFlagBits pipelineStage, VkQueryPool queryPool, uint32_t query)
 {
-	UNIMPLEMENTED();
+	// Commands are executed in order, so all stages have completed when it's reached
+	auto command = record<WriteTimestamp>(CMD_WRITE_TIMESTAMP);
+
+	if(command)
+	{
+		command->queryPool = queryPool;
+		command->query = query;
+	}
 }
 
 void CommandBuffer::copyQueryPoolResults(VkQueryPool queryPool, uint32_t firstQuery, uint32_t queryCount,
 	VkBuffer dstBuffer, VkDeviceSize dstOffset, VkDeviceSize stride, VkQueryResultFlags flags)
 {
-	UNIMPLEMENTED();
+	auto command = record<CopyQueryPoolResults>(CMD_COPY_QUERY_POOL_RESULTS);
+
+	if(command)
+	{
+		command->queryPool = queryPool;
+		command->firstQuery = firstQuery;
+		command->queryCount = queryCount;
+		command->dstBuffer = dstBuffer;
+		command->dstOffset = dstOffset;
+		command->stride = stride;
+		command->flags = flags;
+	}
 }
 
 void CommandBuffer::pushConstants(VkPipelineLayout layout, VkShaderStageFlags stageFlags,
 	uint32_t offset, uint32_t size, const void* pValues)
 {
-	UNIMPLEMENTED();
+	auto command = record<PushConstants>(CMD_PUSH_CONSTANTS, arraySize<uint8_t>(size));
+
+	if(command)
+	{
+		uint8_t *arrays = tail(command);
+
+		command->layout = layout;
+		command->stageFlags = stageFlags;
+		command->offset = offset;
+		command->size = size;
+		command->values = copy(arrays, static_cast<const uint8_t*>(pValues), size);
+	}
 }
 
 void CommandBuffer::setViewport(uint32_t firstViewport, uint32_t viewportCount, const VkViewport* pViewports)
 {
 	// Note: The bound graphics pipeline must have been created with the VK_DYNAMIC_STATE_VIEWPORT dynamic state enabled
-	UNIMPLEMENTED();
+	auto command = record<SetViewport>(CMD_SET_VIEWPORT, arraySize<VkViewport>(viewportCount));
+
+	if(command)
+	{
+		uint8_t *arrays = tail(command);
+
+		command->firstViewport = firstViewport;
+		command->viewportCount = viewportCount;
+		command->viewports = copy(arrays, pViewports, viewportCount);
+	}
 }
 
 void CommandBuffer::setScissor(uint32_t firstScissor, uint32_t scissorCount, const VkRect2D* pScissors)
 {
 	// Note: The bound graphics pipeline must have been created with the VK_DYNAMIC_STATE_SCISSOR dynamic state enabled
-	UNIMPLEMENTED();
+	auto command = record<SetScissor>(CMD_SET_SCISSOR, arraySize<VkRect2D>(scissorCount));
+
+	if(command)
+	{
+		uint8_t *arrays = tail(command);
+
+		command->firstScissor = firstScissor;
+		command->scissorCount = scissorCount;
+		command->scissors = copy(arrays, pScissors, scissorCount);
+	}
 }
 
 void CommandBuffer::setLineWidth(float lineWidth)
@@ -164,7 +828,12 @@ void CommandBuffer::setLineWidth(float lineWidth)
 	// If the wide lines feature is not enabled, lineWidth must be 1.0
 	ASSERT(lineWidth == 1.0f);
 
-	UNIMPLEMENTED();
+	auto command = record<SetLineWidth>(CMD_SET_LINE_WIDTH);
+
+	if(command)
+	{
+		command->lineWidth = lineWidth;
+	}
 }
 
 void CommandBuffer::setDepthBias(float depthBiasConstantFactor, float depthBiasClamp, float depthBiasSlopeFactor)
@@ -174,7 +843,14 @@ void CommandBuffer::setDepthBias(float depthBiasConstantFactor, float depthBiasC
 	// If the depth bias clamping feature is not enabled, depthBiasClamp must be 0.0
 	ASSERT(depthBiasClamp == 0.0f);
 
-	UNIMPLEMENTED();
+	auto command = record<SetDepthBias>(CMD_SET_DEPTH_BIAS);
+
+	if(command)
+	{
+		command->depthBiasConstantFactor = depthBiasConstantFactor;
+		command->depthBiasClamp = depthBiasClamp;
+		command->depthBiasSlopeFactor = depthBiasSlopeFactor;
+	}
 }
 
 void CommandBuffer::setBlendConstants(const float blendConstants[4])
@@ -184,7 +860,12 @@ void CommandBuffer::setBlendConstants(const float blendConstants[4])
 	// blendConstants is an array of four values specifying the R, G, B, and A components
 	// of the blend constant color used in blending, depending on the blend factor.
 
-	UNIMPLEMENTED();
+	auto command = record<SetBlendConstants>(CMD_SET_BLEND_CONSTANTS);
+
+	if(command)
+	{
+		memcpy(command->blendConstants, blendConstants, sizeof(command->blendConstants));
+	}
 }
 
 void CommandBuffer::setDepthBounds(float minDepthBounds, float maxDepthBounds)
@@ -195,7 +876,13 @@ void CommandBuffer::setDepthBounds(float minDepthBounds, float maxDepthBounds)
 	ASSERT(minDepthBounds >= 0.0f && minDepthBounds <= 1.0f);
 	ASSERT(maxDepthBounds >= 0.0f && maxDepthBounds <= 1.0f);
 
-	UNIMPLEMENTED();
+	auto command = record<SetDepthBounds>(CMD_SET_DEPTH_BOUNDS);
+
+	if(command)
+	{
+		command->minDepthBounds = minDepthBounds;
+		command->maxDepthBounds = maxDepthBounds;
+	}
 }
 
 void CommandBuffer::setStencilCompareMask(VkStencilFaceFlags faceMask, uint32_t compareMask)
@@ -205,7 +892,13 @@ void CommandBuffer::setStencilCompareMask(VkStencilFaceFlags faceMask, uint32_t
 	// faceMask must not be 0
 	ASSERT(faceMask != 0);
 
-	UNIMPLEMENTED();
+	auto command = record<SetStencilValue>(CMD_SET_STENCIL_COMPARE_MASK);
+
+	if(command)
+	{
+		command->faceMask = faceMask;
+		command->value = compareMask;
+	}
 }
 
 void CommandBuffer::setStencilWriteMask(VkStencilFaceFlags faceMask, uint32_t writeMask)
@@ -215,7 +908,13 @@ void CommandBuffer::setStencilWriteMask(VkStencilFaceFlags faceMask, uint32_t wr
 	// faceMask must not be 0
 	ASSERT(faceMask != 0);
 
-	UNIMPLEMENTED();
+	auto command = record<SetStencilValue>(CMD_SET_STENCIL_WRITE_MASK);
+
+	if(command)
+	{
+		command->faceMask = faceMask;
+		command->value = writeMask;
+	}
 }
 
 void CommandBuffer::setStencilReference(VkStencilFaceFlags faceMask, uint32_t reference)
@@ -225,68 +924,179 @@ void CommandBuffer::setStencilReference(VkStencilFaceFlags faceMask, uint32_t re
 	// faceMask must not be 0
 	ASSERT(faceMask != 0);
 
-	UNIMPLEMENTED();
+	auto command = record<SetStencilValue>(CMD_SET_STENCIL_REFERENCE);
+
+	if(command)
+	{
+		command->faceMask = faceMask;
+		command->value = reference;
+	}
 }
 
 void CommandBuffer::bindDescriptorSets(VkPipelineBindPoint pipelineBindPoint, VkPipelineLayout layout,
 	uint32_t firstSet, uint32_t descriptorSetCount, const VkDescriptorSet* pDescriptorSets,
 	uint32_t dynamicOffsetCount, const uint32_t* pDynamicOffsets)
 {
-	UNIMPLEMENTED();
+	auto command = record<BindDescriptorSets>(CMD_BIND_DESCRIPTOR_SETS, arraySize<VkDescriptorSet>(descriptorSetCount) + arraySize<uint32_t>(dynamicOffsetCount));
+
+	if(command)
+	{
+		uint8_t *arrays = tail(command);
+
+		command->pipelineBindPoint = pipelineBindPoint;
+		command->layout = layout;
+		command->firstSet = firstSet;
+		command->descriptorSetCount = descriptorSetCount;
+		command->descriptorSets = copy(arrays, pDescriptorSets, descriptorSetCount);
+		command->dynamicOffsetCount = dynamicOffsetCount;
+		command->dynamicOffsets = copy(arrays, pDynamicOffsets, dynamicOffsetCount);
+	}
 }
 
 void CommandBuffer::bindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType)
 {
-	UNIMPLEMENTED();
+	auto command = record<BindIndexBuffer>(CMD_BIND_INDEX_BUFFER);
+
+	if(command)
+	{
+		command->buffer = buffer;
+		command->offset = offset;
+		command->indexType = indexType;
+	}
 }
 
 void CommandBuffer::dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ)
 {
-	UNIMPLEMENTED();
+	dispatchBase(0, 0, 0, groupCountX, groupCountY, groupCountZ);
 }
 
 void CommandBuffer::dispatchIndirect(VkBuffer buffer, VkDeviceSize offset)
 {
-	UNIMPLEMENTED();
+	auto command = record<DispatchIndirect>(CMD_DISPATCH_INDIRECT);
+
+	if(command)
+	{
+		command->buffer = buffer;
+		command->offset = offset;
+	}
 }
 
 void CommandBuffer::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, uint32_t regionCount, const VkBufferCopy* pRegions)
 {
-	UNIMPLEMENTED();
+	auto command = record<CopyBuffer>(CMD_COPY_BUFFER, arraySize<VkBufferCopy>(regionCount));
+
+	if(command)
+	{
+		uint8_t *arrays = tail(command);
+
+		command->srcBuffer = srcBuffer;
+		command->dstBuffer = dstBuffer;
+		command->regionCount = regionCount;
+		command->regions = copy(arrays, pRegions, regionCount);
+	}
 }
 
 void CommandBuffer::copyImage(VkImage srcImage, VkImageLayout srcImageLayout, VkImage dstImage, VkImageLayout dstImageLayout,
 	uint32_t regionCount, const VkImageCopy* pRegions)
 {
-	UNIMPLEMENTED();
+	auto command = record<CopyImage>(CMD_COPY_IMAGE, arraySize<VkImageCopy>(regionCount));
+
+	if(command)
+	{
+		uint8_t *arrays = tail(command);
+
+		command->srcImage = srcImage;
+		command->srcImageLayout = srcImageLayout;
+		command->dstImage = dstImage;
+		command->dstImageLayout = dstImageLayout;
+		command->regionCount = regionCount;
+		command->regions = copy(arrays, pRegions, regionCount);
+	}
 }
 
 void CommandBuffer::blitImage(VkImage srcImage, VkImageLayout srcImageLayout, VkImage dstImage, VkImageLayout dstImageLayout,
 	uint32_t regionCount, const VkImageBlit* pRegions, VkFilter filter)
 {
-	UNIMPLEMENTED();
+	auto command = record<BlitImage>(CMD_BLIT_IMAGE, arraySize<VkImageBlit>(regionCount));
+
+	if(command)
+	{
+		uint8_t *arrays = tail(command);
+
+		command->srcImage = srcImage;
+		command->srcImageLayout = srcImageLayout;
+		command->dstImage = dstImage;
+		command->dstImageLayout = dstImageLayout;
+		command->regionCount = regionCount;
+		command->regions = copy(arrays, pRegions, regionCount);
+		command->filter = filter;
+	}
 }
 
 void CommandBuffer::copyBufferToImage(VkBuffer srcBuffer, VkImage dstImage, VkImageLayout dstImageLayout,
 	uint32_t regionCount, const VkBufferImageCopy* pRegions)
 {
-	UNIMPLEMENTED();
+	auto command = record<CopyBufferToImage>(CMD_COPY_BUFFER_TO_IMAGE, arraySize<VkBufferImageCopy>(regionCount));
+
+	if(command)
+	{
+		uint8_t *arrays = tail(command);
+
+		command->srcBuffer = srcBuffer;
+		command->dstImage = dstImage;
+		command->dstImageLayout = dstImageLayout;
+		command->regionCount = regionCount;
+		command->regions = copy(arrays, pRegions, regionCount);
+	}
 }
 
 void CommandBuffer::copyImageToBuffer(VkImage srcImage, VkImageLayout srcImageLayout, VkBuffer dstBuffer,
 	uint32_t regionCount, const VkBufferImageCopy* pRegions)
 {
-	UNIMPLEMENTED();
+	auto command = record<CopyImageToBuffer>(CMD_COPY_IMAGE_TO_BUFFER, arraySize<VkBufferImageCopy>(regionCount));
+
+	if(command)
+	{
+		uint8_t *arrays = tail(command);
+
+		command->srcImage = srcImage;
+		command->srcImageLayout = srcImageLayout;
+		command->dstBuffer = dstBuffer;
+		command->regionCount = regionCount;
+		command->regions = copy(arrays, pRegions, regionCount);
+	}
 }
 
 void CommandBuffer::updateBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, VkDeviceSize dataSize, const void* pData)
 {
-	UNIMPLEMENTED();
+	// dataSize must be less than or equal to 65536 bytes
+	ASSERT(dataSize <= 65536);
+
+	uint32_t size = static_cast<uint32_t>(dataSize);
+	auto command = record<UpdateBuffer>(CMD_UPDATE_BUFFER, arraySize<uint8_t>(size));
+
+	if(command)
+	{
+		uint8_t *arrays = tail(command);
+
+		command->dstBuffer = dstBuffer;
+		command->dstOffset = dstOffset;
+		command->dataSize = dataSize;
+		command->data = copy(arrays, static_cast<const uint8_t*>(pData), size);
+	}
 }
 
 void CommandBuffer::fillBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, VkDeviceSize size, uint32_t data)
 {
-	UNIMPLEMENTED();
+	auto command = record<FillBuffer>(CMD_FILL_BUFFER);
+
+	if(command)
+	{
+		command->dstBuffer = dstBuffer;
+		command->dstOffset = dstOffset;
+		command->size = size;
+		command->data = data;
+	}
 }
 
 void CommandBuffer::clearColorImage(VkImage image, VkImageLayout imageLayout, const VkClearColorValue* pColor,
@@ -310,7 +1120,19 @@ void CommandBuffer::clearAttachments(uint32_t attachmentCount, const VkClearAtta
 void CommandBuffer::resolveImage(VkImage srcImage, VkImageLayout srcImageLayout, VkImage dstImage, VkImageLayout dstImageLayout,
 	uint32_t regionCount, const VkImageResolve* pRegions)
 {
-	UNIMPLEMENTED();
+	auto command = record<ResolveImage>(CMD_RESOLVE_IMAGE, arraySize<VkImageResolve>(regionCount));
+
+	if(command)
+	{
+		uint8_t *arrays = tail(command);
+
+		command->srcImage = srcImage;
+		command->srcImageLayout = srcImageLayout;
+		command->dstImage = dstImage;
+		command->dstImageLayout = dstImageLayout;
+		command->regionCount = regionCount;
+		command->regions = copy(arrays, pRegions, regionCount);
+	}
 }
 
 void CommandBuffer::setEvent(VkEvent event, VkPipelineStageFlags stageMask)
@@ -333,30 +1155,322 @@ void CommandBuffer::waitEvents(uint32_t eventCount, const VkEvent* pEvents, VkPi
 
 void CommandBuffer::draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance)
 {
-	UNIMPLEMENTED();
+	auto command = record<Draw>(CMD_DRAW);
+
+	if(command)
+	{
+		command->vertexCount = vertexCount;
+		command->instanceCount = instanceCount;
+		command->firstVertex = firstVertex;
+		command->firstInstance = firstInstance;
+	}
 }
 
 void CommandBuffer::drawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance)
 {
-	UNIMPLEMENTED();
+	auto command = record<DrawIndexed>(CMD_DRAW_INDEXED);
+
+	if(command)
+	{
+		command->indexCount = indexCount;
+		command->instanceCount = instanceCount;
+		command->firstIndex = firstIndex;
+		command->vertexOffset = vertexOffset;
+		command->firstInstance = firstInstance;
+	}
 }
 
 void CommandBuffer::drawIndirect(VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount, uint32_t stride)
 {
-	UNIMPLEMENTED();
+	auto command = record<DrawIndirect>(CMD_DRAW_INDIRECT);
+
+	if(command)
+	{
+		command->buffer = buffer;
+		command->offset = offset;
+		command->drawCount = drawCount;
+		command->stride = stride;
+	}
 }
 
 void CommandBuffer::drawIndexedIndirect(VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount, uint32_t stride)
 {
-	UNIMPLEMENTED();
+	auto command = record<DrawIndirect>(CMD_DRAW_INDEXED_INDIRECT);
+
+	if(command)
+	{
+		command->buffer = buffer;
+		command->offset = offset;
+		command->drawCount = drawCount;
+		command->stride = stride;
+	}
+}
+
+void CommandBuffer::execute(CommandType type, const void *command)
+{
+	switch(type)
+	{
+	case CMD_BEGIN_RENDER_PASS:
+		{
+			auto beginRenderPass = static_cast<const BeginRenderPass*>(command);
+			renderPass = Cast(beginRenderPass->renderPass);
+			framebuffer = beginRenderPass->framebuffer;
+			renderArea = beginRenderPass->renderArea;
+			clearValues = beginRenderPass->clearValues;
+			subpass = 0;
+			beginSubpass();
+		}
+		break;
+	case CMD_NEXT_SUBPASS:
+		subpass++;
+		beginSubpass();
+		break;
+	case CMD_END_RENDER_PASS:
+		// Attachments are rendered in place, so storing takes no work. Discarded
+		// contents are only worth skipping once rendering is binned into tiles.
+		renderPass = nullptr;
+		framebuffer = VK_NULL_HANDLE;
+		break;
+	case CMD_EXECUTE_COMMANDS:
+		{
+			auto executeCommands = static_cast<const ExecuteCommands*>(command);
+
+			for(uint32_t i = 0; i < executeCommands->commandBufferCount; i++)
+			{
+				const CommandBuffer* secondary = Cast(executeCommands->commandBuffers[i]);
+				ASSERT(secondary->level == VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+
+				// Replays the secondary's stream in place, updating this command buffer's execution state
+				secondary->commands.forEach([this](CommandType type, const void *command)
+				{
+					execute(type, command);
+				});
+			}
+		}
+		break;
+	case CMD_PIPELINE_BARRIER:
+		break;   // Commands are executed in order
+	case CMD_BIND_PIPELINE:
+		{
+			auto bindPipeline = static_cast<const BindPipeline*>(command);
+			pipelines[bindPipeline->pipelineBindPoint] = bindPipeline->pipeline;
+		}
+		break;
+	case CMD_BIND_VERTEX_BUFFERS:
+		{
+			auto bindVertexBuffers = static_cast<const BindVertexBuffers*>(command);
+
+			for(uint32_t i = 0; i < bindVertexBuffers->bindingCount; ++i)
+			{
+				vertexInputBindings[bindVertexBuffers->firstBinding + i].buffer = bindVertexBuffers->buffers[i];
+				vertexInputBindings[bindVertexBuffers->firstBinding + i].offset = bindVertexBuffers->offsets[i];
+			}
+		}
+		break;
+	case CMD_BIND_DESCRIPTOR_SETS:
+		{
+			auto bindDescriptorSets = static_cast<const BindDescriptorSets*>(command);
+			auto bindPoint = bindDescriptorSets->pipelineBindPoint;
+
+			// The dynamic offsets of higher sets follow those of the lower ones
+			uint32_t dynamicOffsetIndex = 0;
+			for(uint32_t set = 0; set < bindDescriptorSets->firstSet; set++)
+			{
+				if(descriptorSets[bindPoint][set])
+				{
+					dynamicOffsetIndex += descriptorSets[bindPoint][set]->layout->getDynamicDescriptorCount();
+				}
+			}
+
+			ASSERT(dynamicOffsetIndex + bindDescriptorSets->dynamicOffsetCount <= MaxDynamicOffsets);
+
+			for(uint32_t i = 0; i < bindDescriptorSets->descriptorSetCount; i++)
+			{
+				descriptorSets[bindPoint][bindDescriptorSets->firstSet + i] = Cast(bindDescriptorSets->descriptorSets[i]);
+			}
+
+			for(uint32_t i = 0; i < bindDescriptorSets->dynamicOffsetCount; i++)
+			{
+				dynamicOffsets[bindPoint][dynamicOffsetIndex + i] = bindDescriptorSets->dynamicOffsets[i];
+			}
+		}
+		break;
+	case CMD_PUSH_CONSTANTS:
+		{
+			auto pushConstants = static_cast<const PushConstants*>(command);
+			ASSERT(pushConstants->offset + pushConstants->size <= MAX_PUSH_CONSTANT_SIZE);
+			memcpy(pushConstantData + pushConstants->offset, pushConstants->values, pushConstants->size);
+		}
+		break;
+	case CMD_SET_VIEWPORT:
+		{
+			auto setViewport = static_cast<const SetViewport*>(command);
+			ASSERT(setViewport->firstViewport + setViewport->viewportCount <= MAX_VIEWPORTS);
+			memcpy(&dynamicState.viewports[setViewport->firstViewport], setViewport->viewports, setViewport->viewportCount * sizeof(VkViewport));
+		}
+		break;
+	case CMD_SET_SCISSOR:
+		{
+			auto setScissor = static_cast<const SetScissor*>(command);
+			ASSERT(setScissor->firstScissor + setScissor->scissorCount <= MAX_VIEWPORTS);
+			memcpy(&dynamicState.scissors[setScissor->firstScissor], setScissor->scissors, setScissor->scissorCount * sizeof(VkRect2D));
+		}
+		break;
+	case CMD_SET_LINE_WIDTH:
+		dynamicState.lineWidth = static_cast<const SetLineWidth*>(command)->lineWidth;
+		break;
+	case CMD_SET_DEPTH_BIAS:
+		{
+			auto setDepthBias = static_cast<const SetDepthBias*>(command);
+			dynamicState.depthBiasConstantFactor = setDepthBias->depthBiasConstantFactor;
+			dynamicState.depthBiasClamp = setDepthBias->depthBiasClamp;
+			dynamicState.depthBiasSlopeFactor = setDepthBias->depthBiasSlopeFactor;
+		}
+		break;
+	case CMD_SET_BLEND_CONSTANTS:
+		memcpy(dynamicState.blendConstants, static_cast<const SetBlendConstants*>(command)->blendConstants, sizeof(dynamicState.blendConstants));
+		break;
+	case CMD_SET_DEPTH_BOUNDS:
+		{
+			auto setDepthBounds = static_cast<const SetDepthBounds*>(command);
+			dynamicState.minDepthBounds = setDepthBounds->minDepthBounds;
+			dynamicState.maxDepthBounds = setDepthBounds->maxDepthBounds;
+		}
+		break;
+	case CMD_SET_STENCIL_COMPARE_MASK:
+		setStencilValue(dynamicState.stencilCompareMask, static_cast<const SetStencilValue*>(command));
+		break;
+	case CMD_SET_STENCIL_WRITE_MASK:
+		setStencilValue(dynamicState.stencilWriteMask, static_cast<const SetStencilValue*>(command));
+		break;
+	case CMD_SET_STENCIL_REFERENCE:
+		setStencilValue(dynamicState.stencilReference, static_cast<const SetStencilValue*>(command));
+		break;
+	case CMD_DISPATCH:
+		{
+			auto dispatch = static_cast<const Dispatch*>(command);
+			executeDispatch(dispatch->baseGroupX, dispatch->baseGroupY, dispatch->baseGroupZ,
+			                dispatch->groupCountX, dispatch->groupCountY, dispatch->groupCountZ);
+		}
+		break;
+	case CMD_DISPATCH_INDIRECT:
+		{
+			auto dispatchIndirect = static_cast<const DispatchIndirect*>(command);
+			auto groupCounts = static_cast<const VkDispatchIndirectCommand*>(Cast(dispatchIndirect->buffer)->getOffsetPointer(dispatchIndirect->offset));
+			executeDispatch(0, 0, 0, groupCounts->x, groupCounts->y, groupCounts->z);
+		}
+		break;
+	case CMD_COPY_BUFFER:
+		{
+			auto copyBuffer = static_cast<const CopyBuffer*>(command);
+			auto srcBuffer = Cast(copyBuffer->srcBuffer);
+			auto dstBuffer = Cast(copyBuffer->dstBuffer);
+
+			for(uint32_t i = 0; i < copyBuffer->regionCount; i++)
+			{
+				const VkBufferCopy& region = copyBuffer->regions[i];
+				BufferTransfer(static_cast<uint8_t*>(dstBuffer->getOffsetPointer(region.dstOffset)),
+				               static_cast<const uint8_t*>(srcBuffer->getOffsetPointer(region.srcOffset)),
+				               static_cast<size_t>(region.size)).execute();
+			}
+		}
+		break;
+	case CMD_UPDATE_BUFFER:
+		{
+			auto updateBuffer = static_cast<const UpdateBuffer*>(command);
+			memcpy(Cast(updateBuffer->dstBuffer)->getOffsetPointer(updateBuffer->dstOffset), updateBuffer->data, static_cast<size_t>(updateBuffer->dataSize));
+		}
+		break;
+	case CMD_FILL_BUFFER:
+		{
+			auto fillBuffer = static_cast<const FillBuffer*>(command);
+			auto dstBuffer = Cast(fillBuffer->dstBuffer);
+
+			// VK_WHOLE_SIZE fills up to the largest multiple of 4 bytes
+			VkDeviceSize size = fillBuffer->size;
+			if(size == VK_WHOLE_SIZE)
+			{
+				size = (dstBuffer->getSize() - fillBuffer->dstOffset) & ~VkDeviceSize(3);
+			}
+
+			BufferTransfer(static_cast<uint8_t*>(dstBuffer->getOffsetPointer(fillBuffer->dstOffset)),
+			               fillBuffer->data, static_cast<size_t>(size)).execute();
+		}
+		break;
+	case CMD_COPY_IMAGE:
+	case CMD_BLIT_IMAGE:
+	case CMD_COPY_BUFFER_TO_IMAGE:
+	case CMD_COPY_IMAGE_TO_BUFFER:
+	case CMD_RESOLVE_IMAGE:
+		UNIMPLEMENTED();   // vk::Image doesn't exist yet
+		break;
+	case CMD_RESET_QUERY_POOL:
+		{
+			auto resetQueryPool = static_cast<const ResetQueryPool*>(command);
+			Cast(resetQueryPool->queryPool)->reset(resetQueryPool->firstQuery, resetQueryPool->queryCount);
+		}
+		break;
+	case CMD_WRITE_TIMESTAMP:
+		{
+			auto writeTimestamp = static_cast<const WriteTimestamp*>(command);
+			Cast(writeTimestamp->queryPool)->writeTimestamp(writeTimestamp->query);
+		}
+		break;
+	case CMD_COPY_QUERY_POOL_RESULTS:
+		{
+			auto copyResults = static_cast<const CopyQueryPoolResults*>(command);
+			Cast(copyResults->queryPool)->getResults(copyResults->firstQuery, copyResults->queryCount, 0,
+			                                         Cast(copyResults->dstBuffer)->getOffsetPointer(copyResults->dstOffset),
+			                                         copyResults->stride, copyResults->flags);
+		}
+		break;
+	default:
+		UNIMPLEMENTED();
+	}
+}
+
+void CommandBuffer::beginSubpass()
+{
+	ASSERT(renderPass && (subpass < renderPass->getSubpassCount()));
+
+	// Attachments are loaded by their first subpass. Loading previous contents
+	// needs no work, and neither does DONT_CARE, so only clears are performed.
+	for(uint32_t i = 0; i < renderPass->getAttachmentCount(); i++)
+	{
+		if(renderPass->isFirstUse(i, subpass) && renderPass->clearsContents(i))
+		{
+			UNIMPLEMENTED();   // vk::Framebuffer doesn't exist yet, clearValues[i] over the renderArea
+		}
+	}
+}
+
+void CommandBuffer::executeDispatch(uint32_t baseGroupX, uint32_t baseGroupY, uint32_t baseGroupZ,
+                                    uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ)
+{
+	auto pipeline = static_cast<ComputePipeline*>(Cast(pipelines[VK_PIPELINE_BIND_POINT_COMPUTE]));
+	ASSERT(pipeline && (pipeline->bindPoint() == VK_PIPELINE_BIND_POINT_COMPUTE));
+
+	auto program = pipeline->getProgram();
+	if(!program)
+	{
+		UNIMPLEMENTED();   // Compute shaders aren't compiled yet
+		return;
+	}
+
+	ComputeEngine::dispatch(*program, baseGroupX, baseGroupY, baseGroupZ, groupCountX, groupCountY, groupCountZ);
 }
 
 void CommandBuffer::submit()
 {
+	ASSERT(state == EXECUTABLE);
+
 	// Perform recorded work
 	state = PENDING;
 
-	UNIMPLEMENTED();
+	commands.forEach([this](CommandType type, const void *command)
+	{
+		execute(type, command);
+	});
 
 	// After work is completed
 	state = EXECUTABLE;
@@ -21,6 +21,9 @@
 namespace vk
 {
 
+class DescriptorSet;
+class RenderPass;
+
 class CommandBuffer
 {
 public:
@@ -110,17 +113,134 @@ public:
 	void submit();
 
 private:
+	// Commands are recorded as tagged POD structs into a linear stream of chunks, so recording
+	// doesn't allocate per command and resetting just rewinds the stream for reuse.
+	enum CommandType : uint32_t
+	{
+		CMD_BEGIN_RENDER_PASS,
+		CMD_NEXT_SUBPASS,
+		CMD_END_RENDER_PASS,
+		CMD_EXECUTE_COMMANDS,
+		CMD_PIPELINE_BARRIER,
+		CMD_BIND_PIPELINE,
+		CMD_BIND_VERTEX_BUFFERS,
+		CMD_BIND_INDEX_BUFFER,
+		CMD_BIND_DESCRIPTOR_SETS,
+		CMD_PUSH_CONSTANTS,
+		CMD_SET_VIEWPORT,
+		CMD_SET_SCISSOR,
+		CMD_SET_LINE_WIDTH,
+		CMD_SET_DEPTH_BIAS,
+		CMD_SET_BLEND_CONSTANTS,
+		CMD_SET_DEPTH_BOUNDS,
+		CMD_SET_STENCIL_COMPARE_MASK,
+		CMD_SET_STENCIL_WRITE_MASK,
+		CMD_SET_STENCIL_REFERENCE,
+		CMD_DRAW,
+		CMD_DRAW_INDEXED,
+		CMD_DRAW_INDIRECT,
+		CMD_DRAW_INDEXED_INDIRECT,
+		CMD_DISPATCH,
+		CMD_DISPATCH_INDIRECT,
+		CMD_COPY_BUFFER,
+		CMD_UPDATE_BUFFER,
+		CMD_FILL_BUFFER,
+		CMD_COPY_IMAGE,
+		CMD_BLIT_IMAGE,
+		CMD_COPY_BUFFER_TO_IMAGE,
+		CMD_COPY_IMAGE_TO_BUFFER,
+		CMD_RESOLVE_IMAGE,
+		CMD_RESET_QUERY_POOL,
+		CMD_WRITE_TIMESTAMP,
+		CMD_COPY_QUERY_POOL_RESULTS,
+	};
+
+	struct CommandHeader
+	{
+		CommandType type;
+		uint32_t size;   // Including the header and any arrays copied after the command
+	};
+
+	class CommandStream
+	{
+	public:
+		void *allocate(size_t size);   // Returns nullptr when out of memory
+		void rewind();
+		void release();
+
+		template<typename Function>
+		void forEach(Function function) const;
+
+	private:
+		struct Chunk
+		{
+			Chunk *next;
+			size_t size;   // Usable bytes following the chunk header
+			size_t used;
+		};
+
+		static uint8_t *data(Chunk *chunk) { return reinterpret_cast<uint8_t*>(chunk + 1); }
+
+		Chunk *first = nullptr;
+		Chunk *current = nullptr;   // Chunks after this one are left over from before a rewind
+	};
+
+	template<typename Command>
+	Command *record(CommandType type, size_t arraySize = 0);   // Returns nullptr when out of memory
+
+	void execute(CommandType type, const void *command);
+	void beginSubpass();
+	void executeDispatch(uint32_t baseGroupX, uint32_t baseGroupY, uint32_t baseGroupZ,
+	                     uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ);
+
+	CommandStream commands;
+	bool outOfMemory = false;
+
 	enum State { INITIAL, RECORDING, EXECUTABLE, PENDING, INVALID };
 	State state = INITIAL;
 	VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+
+	// Execution state, updated while replaying the commands
 	VkPipeline pipelines[VK_PIPELINE_BIND_POINT_RANGE_SIZE];
 
+	RenderPass* renderPass = nullptr;
+	VkFramebuffer framebuffer = VK_NULL_HANDLE;
+	VkRect2D renderArea = {};
+	const VkClearValue* clearValues = nullptr;   // Points into the recorded command
+	uint32_t subpass = 0;
+
 	struct VertexInputBindings
 	{
 		VkBuffer buffer;
 		VkDeviceSize offset;
 	};
 	VertexInputBindings vertexInputBindings[MaxVertexInputBindings];
+
+	// Per bind point tables of the bound sets, with the dynamic offsets of their
+	// buffers in set and binding order. Binding only swaps the set pointers.
+	static constexpr uint32_t MaxDynamicOffsets = MAX_DESCRIPTOR_SET_UNIFORM_BUFFERS_DYNAMIC + MAX_DESCRIPTOR_SET_STORAGE_BUFFERS_DYNAMIC;
+	DescriptorSet* descriptorSets[VK_PIPELINE_BIND_POINT_RANGE_SIZE][MAX_BOUND_DESCRIPTOR_SETS];
+	uint32_t dynamicOffsets[VK_PIPELINE_BIND_POINT_RANGE_SIZE][MaxDynamicOffsets];
+
+	// State which draws read as-is, so that setting it never affects which routines are used
+	struct DynamicState
+	{
+		VkViewport viewports[MAX_VIEWPORTS];
+		VkRect2D scissors[MAX_VIEWPORTS];
+		float lineWidth;
+		float depthBiasConstantFactor;
+		float depthBiasClamp;
+		float depthBiasSlopeFactor;
+		float blendConstants[4];
+		float minDepthBounds;
+		float maxDepthBounds;
+		uint32_t stencilCompareMask[2];   // Front and back faces
+		uint32_t stencilWriteMask[2];
+		uint32_t stencilReference[2];
+	};
+	DynamicState dynamicState;
+
+	uint8_t pushConstantData[MAX_PUSH_CONSTANT_SIZE];
 };
 
 using DispatchableCommandBuffer = DispatchableObject<CommandBuffer, VkCommandBuffer>;
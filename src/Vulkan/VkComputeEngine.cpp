@@ -0,0 +1,218 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "VkComputeEngine.hpp"
+
+#include "VkConfig.h"
+#include "VkDebug.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vk
+{
+
+namespace
+{
+	// Each participating thread owns a contiguous range of the dispatch's workgroups.
+	// Workgroups are claimed one at a time from the front of a range, so a thread
+	// which runs out of work steals from the ranges of the others.
+	struct WorkgroupRange
+	{
+		std::atomic<uint64_t> next;
+		uint64_t end;
+	};
+
+	class ThreadPool
+	{
+	public:
+		ThreadPool() : threadCount(std::max(std::thread::hardware_concurrency(), 1u)),
+		               ranges(new WorkgroupRange[threadCount]),
+		               scratch(threadCount * MAX_COMPUTE_SHARED_MEMORY_SIZE)
+		{
+			// The dispatching thread takes part as well, as participant 0
+			for(unsigned int i = 1; i < threadCount; i++)
+			{
+				threads.push_back(std::thread(&ThreadPool::threadLoop, this, i));
+			}
+		}
+
+		~ThreadPool()
+		{
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				terminate = true;
+			}
+
+			work.notify_all();
+
+			for(auto& thread : threads)
+			{
+				thread.join();
+			}
+		}
+
+		void dispatch(const ComputeProgram& program, const uint32_t base[3], const uint32_t count[3])
+		{
+			ASSERT(program.getSharedMemorySize() <= MAX_COMPUTE_SHARED_MEMORY_SIZE);
+
+			// One dispatch at a time, queues may submit concurrently
+			std::unique_lock<std::mutex> dispatchLock(dispatchMutex);
+
+			uint64_t groupCount = uint64_t(count[0]) * count[1] * count[2];
+			if(groupCount == 0)
+			{
+				return;
+			}
+
+			for(int i = 0; i < 3; i++)
+			{
+				groupBase[i] = base[i];
+				groupCounts[i] = count[i];
+			}
+
+			current = &program;
+
+			// Threads without a workgroup of their own would only steal
+			unsigned int participants = static_cast<unsigned int>(std::min<uint64_t>(threadCount, groupCount));
+			for(unsigned int i = 0; i < threadCount; i++)
+			{
+				uint64_t begin = std::min(groupCount * i / participants, groupCount);
+				uint64_t end = std::min(groupCount * (i + 1) / participants, groupCount);
+				ranges[i].next.store(begin, std::memory_order_relaxed);
+				ranges[i].end = end;
+			}
+
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				participantCount = participants;
+				busyThreads = participants - 1;
+				generation++;
+			}
+
+			if(participants > 1)
+			{
+				work.notify_all();
+			}
+
+			runWorkgroups(0);
+
+			std::unique_lock<std::mutex> lock(mutex);
+			done.wait(lock, [this]() { return busyThreads == 0; });
+
+			current = nullptr;
+		}
+
+		static ThreadPool& get()
+		{
+			static ThreadPool pool;
+			return pool;
+		}
+
+	private:
+		void threadLoop(unsigned int index)
+		{
+			uint64_t seenGeneration = 0;
+
+			while(true)
+			{
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					work.wait(lock, [&]() { return terminate || ((generation != seenGeneration) && (index < participantCount)); });
+
+					if(terminate)
+					{
+						return;
+					}
+
+					seenGeneration = generation;
+				}
+
+				runWorkgroups(index);
+
+				bool last = false;
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					last = (--busyThreads == 0);
+				}
+
+				if(last)
+				{
+					done.notify_one();
+				}
+			}
+		}
+
+		void runWorkgroups(unsigned int index)
+		{
+			void* sharedMemory = &scratch[index * MAX_COMPUTE_SHARED_MEMORY_SIZE];
+
+			// Own range first, then the others' in order, starting with the neighbor
+			for(unsigned int i = 0; i < threadCount; i++)
+			{
+				WorkgroupRange& range = ranges[(index + i) % threadCount];
+
+				while(true)
+				{
+					uint64_t group = range.next.fetch_add(1, std::memory_order_relaxed);
+					if(group >= range.end)
+					{
+						break;
+					}
+
+					uint32_t x = static_cast<uint32_t>(group % groupCounts[0]);
+					uint32_t y = static_cast<uint32_t>((group / groupCounts[0]) % groupCounts[1]);
+					uint32_t z = static_cast<uint32_t>(group / (uint64_t(groupCounts[0]) * groupCounts[1]));
+
+					current->run(groupBase[0] + x, groupBase[1] + y, groupBase[2] + z, sharedMemory);
+				}
+			}
+		}
+
+		const unsigned int threadCount;
+		std::unique_ptr<WorkgroupRange[]> ranges;
+		std::vector<uint8_t> scratch;   // Per-thread shared memory arenas
+		std::vector<std::thread> threads;
+
+		std::mutex dispatchMutex;
+		const ComputeProgram* current = nullptr;
+		uint32_t groupBase[3] = {};
+		uint32_t groupCounts[3] = {};
+
+		std::mutex mutex;
+		std::condition_variable work;
+		std::condition_variable done;
+		uint64_t generation = 0;
+		unsigned int participantCount = 0;
+		unsigned int busyThreads = 0;
+		bool terminate = false;
+	};
+}
+
+void ComputeEngine::dispatch(const ComputeProgram& program,
+                             uint32_t baseGroupX, uint32_t baseGroupY, uint32_t baseGroupZ,
+                             uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ)
+{
+	const uint32_t base[3] = { baseGroupX, baseGroupY, baseGroupZ };
+	const uint32_t count[3] = { groupCountX, groupCountY, groupCountZ };
+
+	ThreadPool::get().dispatch(program, base, count);
+}
+
+} // namespace vk
@@ -0,0 +1,50 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VK_COMPUTE_ENGINE_HPP_
+#define VK_COMPUTE_ENGINE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace vk
+{
+
+// Compiled compute shader of a pipeline
+class ComputeProgram
+{
+public:
+	// Executes all invocations of one workgroup, as the SIMD lanes of the routine.
+	// Called concurrently for different workgroups, each with its own shared memory.
+	virtual void run(uint32_t groupX, uint32_t groupY, uint32_t groupZ, void* sharedMemory) const = 0;
+
+	virtual size_t getSharedMemorySize() const = 0;
+
+protected:
+	virtual ~ComputeProgram() {}
+};
+
+// Process-wide pool of threads executing the workgroups of dispatches
+class ComputeEngine
+{
+public:
+	// Returns once all the workgroups have been executed
+	static void dispatch(const ComputeProgram& program,
+	                     uint32_t baseGroupX, uint32_t baseGroupY, uint32_t baseGroupZ,
+	                     uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ);
+};
+
+} // namespace vk
+
+#endif // VK_COMPUTE_ENGINE_HPP_
@@ -49,6 +49,25 @@ enum {
 	MaxVertexInputBindings = 16,
 };
 
+enum
+{
+	MAX_VIEWPORTS = 16,
+	MAX_PUSH_CONSTANT_SIZE = 128,
+};
+
+enum
+{
+	MAX_COMPUTE_SHARED_MEMORY_SIZE = 16384,
+};
+
+enum
+{
+	MAX_BOUND_DESCRIPTOR_SETS = 4,
+	MAX_DESCRIPTOR_SET_UNIFORM_BUFFERS_DYNAMIC = 8,
+	MAX_DESCRIPTOR_SET_STORAGE_BUFFERS_DYNAMIC = 4,
+	DESCRIPTOR_SET_ALIGNMENT = 64,   // Cache line
+};
+
 }
 
 #endif // VK_CONFIG_HPP_
@@ -0,0 +1,158 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "VkDescriptorPool.hpp"
+
+#include "VkDescriptorSet.hpp"
+#include "VkDescriptorSetLayout.hpp"
+
+#include <cstring>
+
+namespace vk
+{
+
+namespace
+{
+	size_t ComputePoolSize(const VkDescriptorPoolCreateInfo* pCreateInfo)
+	{
+		// Each set has a header, and is padded to the set alignment
+		size_t size = pCreateInfo->maxSets * (DescriptorSetHeaderSize + DESCRIPTOR_SET_ALIGNMENT - 1);
+
+		for(uint32_t i = 0; i < pCreateInfo->poolSizeCount; i++)
+		{
+			size += pCreateInfo->pPoolSizes[i].descriptorCount * DescriptorSetLayout::GetDescriptorSize(pCreateInfo->pPoolSizes[i].type);
+		}
+
+		return size;
+	}
+}
+
+DescriptorPool::DescriptorPool(const VkDescriptorPoolCreateInfo* pCreateInfo, void* mem) :
+	ranges(reinterpret_cast<Range*>(mem)), maxSets(pCreateInfo->maxSets), poolSize(ComputePoolSize(pCreateInfo))
+{
+	uintptr_t poolAddress = reinterpret_cast<uintptr_t>(ranges + maxSets);
+	poolAddress = (poolAddress + DESCRIPTOR_SET_ALIGNMENT - 1) & ~uintptr_t(DESCRIPTOR_SET_ALIGNMENT - 1);
+	pool = reinterpret_cast<uint8_t*>(poolAddress);
+}
+
+void DescriptorPool::destroy(const VkAllocationCallbacks* pAllocator)
+{
+	vk::deallocate(ranges, pAllocator);
+}
+
+size_t DescriptorPool::ComputeRequiredAllocationSize(const VkDescriptorPoolCreateInfo* pCreateInfo)
+{
+	return sizeof(Range) * pCreateInfo->maxSets + (DESCRIPTOR_SET_ALIGNMENT - 1) + ComputePoolSize(pCreateInfo);
+}
+
+VkResult DescriptorPool::allocateSets(uint32_t descriptorSetCount, const VkDescriptorSetLayout* pSetLayouts, VkDescriptorSet* pDescriptorSets)
+{
+	for(uint32_t i = 0; i < descriptorSetCount; i++)
+	{
+		const DescriptorSetLayout* layout = Cast(pSetLayouts[i]);
+
+		VkResult result = allocateSet(layout->getSetSize(), &pDescriptorSets[i]);
+
+		if(result != VK_SUCCESS)
+		{
+			freeSets(i, pDescriptorSets);
+
+			for(uint32_t j = 0; j < descriptorSetCount; j++)
+			{
+				pDescriptorSets[j] = VK_NULL_HANDLE;
+			}
+
+			return result;
+		}
+
+		layout->initialize(Cast(pDescriptorSets[i]));
+	}
+
+	return VK_SUCCESS;
+}
+
+void DescriptorPool::freeSets(uint32_t descriptorSetCount, const VkDescriptorSet* pDescriptorSets)
+{
+	for(uint32_t i = 0; i < descriptorSetCount; i++)
+	{
+		if(pDescriptorSets[i] != VK_NULL_HANDLE)
+		{
+			freeSet(pDescriptorSets[i]);
+		}
+	}
+}
+
+void DescriptorPool::reset()
+{
+	rangeCount = 0;
+	usedSize = 0;
+}
+
+VkResult DescriptorPool::allocateSet(size_t size, VkDescriptorSet* pDescriptorSet)
+{
+	if((rangeCount == maxSets) || (poolSize - usedSize < size))
+	{
+		return VK_ERROR_OUT_OF_POOL_MEMORY;
+	}
+
+	// First fit, in the gaps left by freed sets or after the last set
+	size_t offset = 0;
+	uint32_t index = 0;
+
+	for(; index < rangeCount; index++)
+	{
+		if(ranges[index].offset - offset >= size)
+		{
+			break;
+		}
+
+		offset = ranges[index].offset + ranges[index].size;
+	}
+
+	if((index == rangeCount) && (poolSize - offset < size))
+	{
+		return VK_ERROR_FRAGMENTED_POOL;
+	}
+
+	memmove(ranges + index + 1, ranges + index, sizeof(Range) * (rangeCount - index));
+	ranges[index].offset = offset;
+	ranges[index].size = size;
+	rangeCount++;
+	usedSize += size;
+
+	*pDescriptorSet = *reinterpret_cast<DescriptorSet*>(pool + offset);
+
+	return VK_SUCCESS;
+}
+
+void DescriptorPool::freeSet(VkDescriptorSet descriptorSet)
+{
+	size_t offset = reinterpret_cast<uint8_t*>(Cast(descriptorSet)) - pool;
+
+	for(uint32_t index = 0; index < rangeCount; index++)
+	{
+		if(ranges[index].offset == offset)
+		{
+			usedSize -= ranges[index].size;
+			rangeCount--;
+			memmove(ranges + index, ranges + index + 1, sizeof(Range) * (rangeCount - index));
+			return;
+		}
+	}
+
+	ASSERT(false);   // Not allocated from this pool
+}
+
+} // namespace vk
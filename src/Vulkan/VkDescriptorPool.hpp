@@ -0,0 +1,65 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef VK_DESCRIPTOR_POOL_HPP_
+#define VK_DESCRIPTOR_POOL_HPP_
+
+#include "VkObject.hpp"
+
+namespace vk
+{
+
+// All the pool's sets are allocated from a single block, reserved at creation
+class DescriptorPool : public Object<DescriptorPool, VkDescriptorPool>
+{
+public:
+	DescriptorPool(const VkDescriptorPoolCreateInfo* pCreateInfo, void* mem);
+	~DescriptorPool() = delete;
+	void destroy(const VkAllocationCallbacks* pAllocator);
+
+	static size_t ComputeRequiredAllocationSize(const VkDescriptorPoolCreateInfo* pCreateInfo);
+
+	VkResult allocateSets(uint32_t descriptorSetCount, const VkDescriptorSetLayout* pSetLayouts, VkDescriptorSet* pDescriptorSets);
+	void freeSets(uint32_t descriptorSetCount, const VkDescriptorSet* pDescriptorSets);
+	void reset();
+
+private:
+	// Memory used by a set, kept sorted by offset so that free space is found between them
+	struct Range
+	{
+		size_t offset;
+		size_t size;
+	};
+
+	VkResult allocateSet(size_t size, VkDescriptorSet* pDescriptorSet);
+	void freeSet(VkDescriptorSet descriptorSet);
+
+	Range* ranges = nullptr;
+	uint32_t rangeCount = 0;
+	uint32_t maxSets = 0;
+
+	uint8_t* pool = nullptr;   // Aligned to DESCRIPTOR_SET_ALIGNMENT
+	size_t poolSize = 0;
+	size_t usedSize = 0;
+};
+
+static inline DescriptorPool* Cast(VkDescriptorPool object)
+{
+	return reinterpret_cast<DescriptorPool*>(object);
+}
+
+} // namespace vk
+
+#endif // VK_DESCRIPTOR_POOL_HPP_
@@ -0,0 +1,51 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef VK_DESCRIPTOR_SET_HPP_
+#define VK_DESCRIPTOR_SET_HPP_
+
+#include "VkObject.hpp"
+
+#include <cstddef>
+
+namespace vk
+{
+
+class DescriptorSetLayout;
+
+// Sets are carved out of their pool's memory, at the set alignment, as this
+// header followed by the descriptors. Binding a set only stores its address.
+class DescriptorSet
+{
+public:
+	operator VkDescriptorSet()
+	{
+		return reinterpret_cast<VkDescriptorSet>(this);
+	}
+
+	const DescriptorSetLayout* layout;
+	alignas(16) uint8_t data[1];   // Extends to the layout's set size
+};
+
+static constexpr size_t DescriptorSetHeaderSize = offsetof(DescriptorSet, data);
+
+static inline DescriptorSet* Cast(VkDescriptorSet object)
+{
+	return reinterpret_cast<DescriptorSet*>(object);
+}
+
+} // namespace vk
+
+#endif // VK_DESCRIPTOR_SET_HPP_
@@ -0,0 +1,280 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "VkDescriptorSetLayout.hpp"
+
+#include "VkBuffer.hpp"
+#include "VkBufferView.hpp"
+#include "VkDescriptorSet.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace vk
+{
+
+DescriptorSetLayout::DescriptorSetLayout(const VkDescriptorSetLayoutCreateInfo* pCreateInfo, void* mem) :
+	flags(pCreateInfo->flags), bindingCount(pCreateInfo->bindingCount), bindings(reinterpret_cast<Binding*>(mem))
+{
+	VkSampler* immutableSamplers = reinterpret_cast<VkSampler*>(bindings + bindingCount);
+
+	for(uint32_t i = 0; i < bindingCount; i++)
+	{
+		const VkDescriptorSetLayoutBinding& binding = pCreateInfo->pBindings[i];
+
+		bindings[i].binding = binding.binding;
+		bindings[i].type = binding.descriptorType;
+		bindings[i].count = binding.descriptorCount;
+		bindings[i].immutableSamplers = nullptr;
+
+		bool hasSampler = (binding.descriptorType == VK_DESCRIPTOR_TYPE_SAMPLER) ||
+		                  (binding.descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+
+		if(hasSampler && binding.pImmutableSamplers)
+		{
+			memcpy(immutableSamplers, binding.pImmutableSamplers, sizeof(VkSampler) * binding.descriptorCount);
+			bindings[i].immutableSamplers = immutableSamplers;
+			immutableSamplers += binding.descriptorCount;
+		}
+	}
+
+	std::sort(bindings, bindings + bindingCount, [](const Binding& a, const Binding& b)
+	{
+		return a.binding < b.binding;
+	});
+
+	size_t descriptorSize = 0;
+
+	for(uint32_t i = 0; i < bindingCount; i++)
+	{
+		bindings[i].offset = static_cast<uint32_t>(descriptorSize);
+		bindings[i].dynamicIndex = dynamicDescriptorCount;
+
+		descriptorSize += GetDescriptorSize(bindings[i].type) * bindings[i].count;
+
+		if((bindings[i].type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC) ||
+		   (bindings[i].type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC))
+		{
+			dynamicDescriptorCount += bindings[i].count;
+		}
+	}
+
+	setSize = GetSetSize(descriptorSize);
+}
+
+void DescriptorSetLayout::destroy(const VkAllocationCallbacks* pAllocator)
+{
+	vk::deallocate(bindings, pAllocator);
+}
+
+size_t DescriptorSetLayout::ComputeRequiredAllocationSize(const VkDescriptorSetLayoutCreateInfo* pCreateInfo)
+{
+	size_t size = sizeof(Binding) * pCreateInfo->bindingCount;
+
+	for(uint32_t i = 0; i < pCreateInfo->bindingCount; i++)
+	{
+		const VkDescriptorSetLayoutBinding& binding = pCreateInfo->pBindings[i];
+
+		bool hasSampler = (binding.descriptorType == VK_DESCRIPTOR_TYPE_SAMPLER) ||
+		                  (binding.descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+
+		if(hasSampler && binding.pImmutableSamplers)
+		{
+			size += sizeof(VkSampler) * binding.descriptorCount;
+		}
+	}
+
+	return size;
+}
+
+size_t DescriptorSetLayout::GetDescriptorSize(VkDescriptorType type)
+{
+	switch(type)
+	{
+	case VK_DESCRIPTOR_TYPE_SAMPLER:
+	case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+	case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+	case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+	case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+		return sizeof(ImageDescriptor);
+	case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+	case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+		return sizeof(TexelBufferDescriptor);
+	case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+	case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+	case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+	case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+		return sizeof(BufferDescriptor);
+	default:
+		UNIMPLEMENTED();
+		return 0;
+	}
+}
+
+size_t DescriptorSetLayout::GetSetSize(size_t descriptorSize)
+{
+	size_t size = DescriptorSetHeaderSize + descriptorSize;
+
+	return (size + DESCRIPTOR_SET_ALIGNMENT - 1) & ~size_t(DESCRIPTOR_SET_ALIGNMENT - 1);
+}
+
+void DescriptorSetLayout::initialize(DescriptorSet* descriptorSet) const
+{
+	descriptorSet->layout = this;
+	memset(descriptorSet->data, 0, setSize - DescriptorSetHeaderSize);
+
+	for(uint32_t i = 0; i < bindingCount; i++)
+	{
+		if(bindings[i].immutableSamplers)
+		{
+			auto imageDescriptors = reinterpret_cast<ImageDescriptor*>(descriptorSet->data + bindings[i].offset);
+
+			for(uint32_t j = 0; j < bindings[i].count; j++)
+			{
+				imageDescriptors[j].sampler = bindings[i].immutableSamplers[j];
+			}
+		}
+	}
+}
+
+size_t DescriptorSetLayout::getBindingOffset(uint32_t binding) const
+{
+	return bindings[getBindingIndex(binding)].offset;
+}
+
+uint32_t DescriptorSetLayout::getDynamicOffsetIndex(uint32_t binding) const
+{
+	return bindings[getBindingIndex(binding)].dynamicIndex;
+}
+
+uint32_t DescriptorSetLayout::getBindingIndex(uint32_t binding) const
+{
+	for(uint32_t i = 0; i < bindingCount; i++)
+	{
+		if(bindings[i].binding == binding)
+		{
+			return i;
+		}
+	}
+
+	ASSERT(false);   // Bindings used by updates and shaders must be part of the layout
+	return 0;
+}
+
+size_t DescriptorSetLayout::getDescriptorOffset(uint32_t& bindingIndex, uint32_t& arrayElement) const
+{
+	while(arrayElement >= bindings[bindingIndex].count)
+	{
+		arrayElement -= bindings[bindingIndex].count;
+		bindingIndex++;
+		ASSERT(bindingIndex < bindingCount);
+	}
+
+	return bindings[bindingIndex].offset + GetDescriptorSize(bindings[bindingIndex].type) * arrayElement;
+}
+
+void DescriptorSetLayout::WriteDescriptorSet(const VkWriteDescriptorSet& descriptorWrite)
+{
+	DescriptorSet* dstSet = Cast(descriptorWrite.dstSet);
+	const DescriptorSetLayout* layout = dstSet->layout;
+
+	uint32_t bindingIndex = layout->getBindingIndex(descriptorWrite.dstBinding);
+	uint32_t arrayElement = descriptorWrite.dstArrayElement;
+
+	for(uint32_t i = 0; i < descriptorWrite.descriptorCount; i++, arrayElement++)
+	{
+		uint8_t* descriptor = dstSet->data + layout->getDescriptorOffset(bindingIndex, arrayElement);
+
+		switch(descriptorWrite.descriptorType)
+		{
+		case VK_DESCRIPTOR_TYPE_SAMPLER:
+		case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+		case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+		case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+		case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+			{
+				const VkDescriptorImageInfo& imageInfo = descriptorWrite.pImageInfo[i];
+				auto imageDescriptor = reinterpret_cast<ImageDescriptor*>(descriptor);
+
+				bool hasSampler = (descriptorWrite.descriptorType == VK_DESCRIPTOR_TYPE_SAMPLER) ||
+				                  (descriptorWrite.descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+
+				// Immutable samplers were written when the set was allocated
+				if(hasSampler && !layout->bindings[bindingIndex].immutableSamplers)
+				{
+					imageDescriptor->sampler = imageInfo.sampler;
+				}
+
+				if(descriptorWrite.descriptorType != VK_DESCRIPTOR_TYPE_SAMPLER)
+				{
+					imageDescriptor->imageView = imageInfo.imageView;
+					imageDescriptor->imageLayout = imageInfo.imageLayout;
+				}
+			}
+			break;
+		case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+		case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+			{
+				const BufferView* bufferView = Cast(descriptorWrite.pTexelBufferView[i]);
+				const Buffer* buffer = Cast(bufferView->getBuffer());
+				auto texelBufferDescriptor = reinterpret_cast<TexelBufferDescriptor*>(descriptor);
+
+				texelBufferDescriptor->pointer = buffer->getOffsetPointer(bufferView->getOffset());
+				texelBufferDescriptor->range = (bufferView->getRange() == VK_WHOLE_SIZE) ?
+				                               (buffer->getSize() - bufferView->getOffset()) : bufferView->getRange();
+				texelBufferDescriptor->format = bufferView->getFormat();
+			}
+			break;
+		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+			{
+				const VkDescriptorBufferInfo& bufferInfo = descriptorWrite.pBufferInfo[i];
+				const Buffer* buffer = Cast(bufferInfo.buffer);
+				auto bufferDescriptor = reinterpret_cast<BufferDescriptor*>(descriptor);
+
+				bufferDescriptor->pointer = buffer->getOffsetPointer(bufferInfo.offset);
+				bufferDescriptor->range = (bufferInfo.range == VK_WHOLE_SIZE) ?
+				                          (buffer->getSize() - bufferInfo.offset) : bufferInfo.range;
+			}
+			break;
+		default:
+			UNIMPLEMENTED();
+		}
+	}
+}
+
+void DescriptorSetLayout::CopyDescriptorSet(const VkCopyDescriptorSet& descriptorCopy)
+{
+	const DescriptorSet* srcSet = Cast(descriptorCopy.srcSet);
+	DescriptorSet* dstSet = Cast(descriptorCopy.dstSet);
+
+	uint32_t srcBindingIndex = srcSet->layout->getBindingIndex(descriptorCopy.srcBinding);
+	uint32_t dstBindingIndex = dstSet->layout->getBindingIndex(descriptorCopy.dstBinding);
+	uint32_t srcArrayElement = descriptorCopy.srcArrayElement;
+	uint32_t dstArrayElement = descriptorCopy.dstArrayElement;
+
+	for(uint32_t i = 0; i < descriptorCopy.descriptorCount; i++, srcArrayElement++, dstArrayElement++)
+	{
+		size_t srcOffset = srcSet->layout->getDescriptorOffset(srcBindingIndex, srcArrayElement);
+		size_t dstOffset = dstSet->layout->getDescriptorOffset(dstBindingIndex, dstArrayElement);
+		size_t size = GetDescriptorSize(srcSet->layout->bindings[srcBindingIndex].type);
+
+		memcpy(dstSet->data + dstOffset, srcSet->data + srcOffset, size);
+	}
+}
+
+} // namespace vk
@@ -0,0 +1,105 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef VK_DESCRIPTOR_SET_LAYOUT_HPP_
+#define VK_DESCRIPTOR_SET_LAYOUT_HPP_
+
+#include "VkObject.hpp"
+
+namespace vk
+{
+
+class DescriptorSet;
+
+// Descriptors are plain structs stored inline in their set, in binding order,
+// so that routines reach any resource from the set's address with one indirection.
+struct BufferDescriptor
+{
+	void* pointer;        // Buffer memory, with the descriptor's offset applied
+	VkDeviceSize range;   // Dynamic buffers add the bound dynamic offset to the pointer
+};
+
+struct TexelBufferDescriptor
+{
+	void* pointer;
+	VkDeviceSize range;
+	VkFormat format;
+};
+
+// Samplers and image views aren't implemented yet, so their handles are held
+// in the slot where their state will be stored.
+struct ImageDescriptor
+{
+	VkSampler sampler;
+	VkImageView imageView;
+	VkImageLayout imageLayout;
+};
+
+class DescriptorSetLayout : public Object<DescriptorSetLayout, VkDescriptorSetLayout>
+{
+public:
+	DescriptorSetLayout(const VkDescriptorSetLayoutCreateInfo* pCreateInfo, void* mem);
+	~DescriptorSetLayout() = delete;
+	void destroy(const VkAllocationCallbacks* pAllocator);
+
+	static size_t ComputeRequiredAllocationSize(const VkDescriptorSetLayoutCreateInfo* pCreateInfo);
+
+	static size_t GetDescriptorSize(VkDescriptorType type);
+	static size_t GetSetSize(size_t descriptorSize);   // Includes the header, rounded to the set alignment
+
+	static void WriteDescriptorSet(const VkWriteDescriptorSet& descriptorWrite);
+	static void CopyDescriptorSet(const VkCopyDescriptorSet& descriptorCopy);
+
+	// Zeroes the descriptors, except immutable samplers
+	void initialize(DescriptorSet* descriptorSet) const;
+
+	size_t getSetSize() const { return setSize; }
+	uint32_t getDynamicDescriptorCount() const { return dynamicDescriptorCount; }
+
+	// Used by shader compilation to address the descriptors of a binding
+	size_t getBindingOffset(uint32_t binding) const;
+	uint32_t getDynamicOffsetIndex(uint32_t binding) const;   // Of the binding's first descriptor
+
+private:
+	struct Binding
+	{
+		uint32_t binding;
+		VkDescriptorType type;
+		uint32_t count;
+		uint32_t offset;         // Of the first descriptor, from the start of the set's data
+		uint32_t dynamicIndex;   // Of the first descriptor, among the set's dynamic buffers
+		const VkSampler* immutableSamplers;
+	};
+
+	uint32_t getBindingIndex(uint32_t binding) const;
+
+	// Moves past the end of a binding's array into the following bindings, as updates do
+	size_t getDescriptorOffset(uint32_t& bindingIndex, uint32_t& arrayElement) const;
+
+	VkDescriptorSetLayoutCreateFlags flags = 0;
+	uint32_t bindingCount = 0;
+	Binding* bindings = nullptr;   // Sorted by binding number
+	size_t setSize = 0;
+	uint32_t dynamicDescriptorCount = 0;
+};
+
+static inline DescriptorSetLayout* Cast(VkDescriptorSetLayout object)
+{
+	return reinterpret_cast<DescriptorSetLayout*>(object);
+}
+
+} // namespace vk
+
+#endif // VK_DESCRIPTOR_SET_LAYOUT_HPP_
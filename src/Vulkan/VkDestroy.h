@@ -15,13 +15,19 @@
 #include "VkBuffer.hpp"
 #include "VkBufferView.hpp"
 #include "VkCommandBuffer.hpp"
+#include "VkDescriptorPool.hpp"
+#include "VkDescriptorSetLayout.hpp"
 #include "VkDevice.hpp"
 #include "VkDeviceMemory.hpp"
 #include "VkEvent.hpp"
 #include "VkFence.hpp"
 #include "VkInstance.hpp"
 #include "VkPhysicalDevice.hpp"
+#include "VkPipeline.hpp"
+#include "VkPipelineCache.hpp"
+#include "VkQueryPool.hpp"
 #include "VkQueue.hpp"
+#include "VkRenderPass.hpp"
 #include "VkSemaphore.hpp"
 
 namespace vk
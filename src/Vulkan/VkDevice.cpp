@@ -45,6 +45,11 @@ Device::Device(const Device::CreateInfo* info, void* mem)
 
 void Device::destroy(const VkAllocationCallbacks* pAllocator)
 {
+	for(uint32_t i = 0; i < queueCount; i++)
+	{
+		queues[i].destroy();
+	}
+
 	vk::deallocate(queues, pAllocator);
 }
 
@@ -61,9 +66,28 @@ size_t Device::ComputeRequiredAllocationSize(const Device::CreateInfo* info)
 
 VkQueue Device::getQueue(uint32_t queueFamilyIndex, uint32_t queueIndex) const
 {
-	ASSERT(queueFamilyIndex == 0);
+	// Each family's queues are created together, by a single VkDeviceQueueCreateInfo
+	for(uint32_t i = 0; i < queueCount; i++)
+	{
+		if(queues[i].getFamilyIndex() == queueFamilyIndex)
+		{
+			ASSERT((i + queueIndex < queueCount) && (queues[i + queueIndex].getFamilyIndex() == queueFamilyIndex));
+
+			return queues[i + queueIndex];
+		}
+	}
+
+	UNREACHABLE(queueFamilyIndex);
+
+	return VK_NULL_HANDLE;
+}
 
-	return queues[queueIndex];
+void Device::waitIdle()
+{
+	for(uint32_t i = 0; i < queueCount; i++)
+	{
+		queues[i].waitIdle();
+	}
 }
 
 void Device::getImageSparseMemoryRequirements(VkImage pImage, uint32_t* pSparseMemoryRequirementCount,
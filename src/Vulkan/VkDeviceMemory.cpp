@@ -15,10 +15,166 @@
 #include "VkDeviceMemory.hpp"
 
 #include "VkConfig.h"
+#include "System/Memory.hpp"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <set>
+#include <stdint.h>
 
 namespace vk
 {
 
+namespace
+{
+	// Small allocations are suballocated from 4 MiB blocks of pages by a buddy
+	// allocator, larger ones get pages of their own.
+	class BuddyAllocator
+	{
+	public:
+		enum
+		{
+			MIN_ORDER = 8,    // 256 bytes
+			MAX_ORDER = 22,   // The whole block
+			ORDER_COUNT = MAX_ORDER - MIN_ORDER + 1,
+			BLOCK_SIZE = 1 << MAX_ORDER,
+			MAX_ALLOCATION_SIZE = BLOCK_SIZE / 4,
+		};
+
+		~BuddyAllocator()
+		{
+			for(auto& block : blocks)
+			{
+				sw::deallocatePages(block.second->base, BLOCK_SIZE);
+				delete block.second;
+			}
+		}
+
+		void* allocate(size_t size)
+		{
+			ASSERT(size <= MAX_ALLOCATION_SIZE);
+
+			int order = orderOf(size);
+			std::unique_lock<std::mutex> lock(mutex);
+
+			for(auto& block : blocks)
+			{
+				void* memory = take(block.second, order);
+				if(memory)
+				{
+					return memory;
+				}
+			}
+
+			uint8_t* base = static_cast<uint8_t*>(sw::allocatePages(BLOCK_SIZE));
+			if(!base)
+			{
+				return nullptr;
+			}
+
+			Block* block = new Block();
+			block->base = base;
+			block->freeLists[MAX_ORDER - MIN_ORDER].insert(0);
+			blocks[reinterpret_cast<uintptr_t>(base)] = block;
+
+			return take(block, order);
+		}
+
+		void deallocate(void* memory, size_t size)
+		{
+			int order = orderOf(size);
+			std::unique_lock<std::mutex> lock(mutex);
+
+			auto it = blocks.upper_bound(reinterpret_cast<uintptr_t>(memory));
+			ASSERT(it != blocks.begin());
+			Block* block = (--it)->second;
+
+			uint32_t offset = static_cast<uint32_t>(static_cast<uint8_t*>(memory) - block->base);
+			block->used -= size_t(1) << order;
+
+			// Merge with the free buddies, up to the whole block
+			for(; order < MAX_ORDER; order++)
+			{
+				uint32_t buddy = offset ^ (1u << order);
+				if(block->freeLists[order - MIN_ORDER].erase(buddy) == 0)
+				{
+					break;
+				}
+
+				offset = std::min(offset, buddy);
+			}
+
+			block->freeLists[order - MIN_ORDER].insert(offset);
+
+			// Keep one block around, so that allocating and freeing doesn't map and unmap pages
+			if((block->used == 0) && (blocks.size() > 1))
+			{
+				sw::deallocatePages(block->base, BLOCK_SIZE);
+				blocks.erase(it);
+				delete block;
+			}
+		}
+
+		static BuddyAllocator& get()
+		{
+			static BuddyAllocator allocator;
+			return allocator;
+		}
+
+	private:
+		struct Block
+		{
+			uint8_t* base = nullptr;
+			size_t used = 0;
+			std::set<uint32_t> freeLists[ORDER_COUNT];   // Offsets of the free ranges of each order
+		};
+
+		static int orderOf(size_t size)
+		{
+			int order = MIN_ORDER;
+			while((size_t(1) << order) < size)
+			{
+				order++;
+			}
+
+			return order;
+		}
+
+		// Splits the smallest free range which fits, returns nullptr if there is none
+		void* take(Block* block, int order)
+		{
+			int available = order;
+			while((available <= MAX_ORDER) && block->freeLists[available - MIN_ORDER].empty())
+			{
+				available++;
+			}
+
+			if(available > MAX_ORDER)
+			{
+				return nullptr;
+			}
+
+			auto& freeList = block->freeLists[available - MIN_ORDER];
+			uint32_t offset = *freeList.begin();
+			freeList.erase(freeList.begin());
+
+			while(available > order)
+			{
+				available--;
+				block->freeLists[available - MIN_ORDER].insert(offset + (1u << available));
+			}
+
+			block->used += size_t(1) << order;
+
+			return block->base + offset;
+		}
+
+		std::mutex mutex;
+		std::map<uintptr_t, Block*> blocks;   // By base address
+	};
+}
+
 DeviceMemory::DeviceMemory(const VkMemoryAllocateInfo* pCreateInfo, void* mem) :
 	size(pCreateInfo->allocationSize), memoryTypeIndex(pCreateInfo->memoryTypeIndex)
 {
@@ -27,7 +183,19 @@ DeviceMemory::DeviceMemory(const VkMemoryAllocateInfo* pCreateInfo, void* mem) :
 
 void DeviceMemory::destroy(const VkAllocationCallbacks* pAllocator)
 {
-	vk::deallocate(buffer, DEVICE_MEMORY);
+	if(!buffer)
+	{
+		return;
+	}
+
+	if(size <= BuddyAllocator::MAX_ALLOCATION_SIZE)
+	{
+		BuddyAllocator::get().deallocate(buffer, static_cast<size_t>(size));
+	}
+	else
+	{
+		sw::deallocatePages(buffer, static_cast<size_t>(size));
+	}
 }
 
 size_t DeviceMemory::ComputeRequiredAllocationSize(const VkMemoryAllocateInfo* pCreateInfo)
@@ -38,9 +206,17 @@ size_t DeviceMemory::ComputeRequiredAllocationSize(const VkMemoryAllocateInfo* p
 
 VkResult DeviceMemory::allocate()
 {
-	if(!buffer)
+	if(!buffer && (size <= SIZE_MAX))
 	{
-		buffer = vk::allocate(size, REQUIRED_MEMORY_ALIGNMENT, DEVICE_MEMORY);
+		// Large allocations are mapped pages, which are only committed once touched
+		if(size <= BuddyAllocator::MAX_ALLOCATION_SIZE)
+		{
+			buffer = BuddyAllocator::get().allocate(static_cast<size_t>(size));
+		}
+		else
+		{
+			buffer = sw::allocatePages(static_cast<size_t>(size));
+		}
 	}
 
 	if(!buffer)
@@ -16,6 +16,9 @@
 #define VK_FENCE_HPP_
 
 #include "VkObject.hpp"
+#include "System/CompletionSignal.hpp"
+
+#include <atomic>
 
 namespace vk
 {
@@ -24,7 +27,7 @@ class Fence : public Object<Fence, VkFence>
 {
 public:
 	Fence(const VkFenceCreateInfo* pCreateInfo, void* mem) :
-		status((pCreateInfo->flags & VK_FENCE_CREATE_SIGNALED_BIT) ? VK_SUCCESS : VK_NOT_READY)
+		target((pCreateInfo->flags & VK_FENCE_CREATE_SIGNALED_BIT) ? 0 : 1)
 	{
 	}
 
@@ -35,23 +38,37 @@ public:
 		return 0;
 	}
 
+	// Signaled by the queue thread when the submitted work completes
 	void signal()
 	{
-		status = VK_SUCCESS;
+		completed.advance(target);
 	}
 
+	// Each reset waits for the next generation, so no lock is needed to clear the signaled state
 	void reset()
 	{
-		status = VK_NOT_READY;
+		if(completed.reached(target))
+		{
+			target = completed.get() + 1;
+		}
 	}
 
 	VkResult getStatus() const
 	{
-		return status;
+		return completed.reached(target) ? VK_SUCCESS : VK_NOT_READY;
 	}
 
+	// Returns VK_SUCCESS once signaled, or VK_TIMEOUT after timeout nanoseconds
+	VkResult wait(uint64_t timeout) const
+	{
+		return completed.wait(target, timeout) ? VK_SUCCESS : VK_TIMEOUT;
+	}
+
+	static constexpr uint64_t INFINITE_TIMEOUT = sw::CompletionSignal::INFINITE_TIMEOUT;
+
 private:
-	VkResult status = VK_NOT_READY;
+	std::atomic<unsigned int> target;
+	mutable sw::CompletionSignal completed;
 };
 
 static inline Fence* Cast(VkFence object)
@@ -144,12 +144,12 @@ const VkPhysicalDeviceLimits& PhysicalDevice::getLimits() const
 		65536, // maxTexelBufferElements
 		16384, // maxUniformBufferRange
 		(1ul << 27), // maxStorageBufferRange
-		128, // maxPushConstantsSize
+		vk::MAX_PUSH_CONSTANT_SIZE, // maxPushConstantsSize
 		4096, // maxMemoryAllocationCount
 		4000, // maxSamplerAllocationCount
 		131072, // bufferImageGranularity
 		0, // sparseAddressSpaceSize (unsupported)
-		4, // maxBoundDescriptorSets
+		vk::MAX_BOUND_DESCRIPTOR_SETS, // maxBoundDescriptorSets
 		16, // maxPerStageDescriptorSamplers
 		12, // maxPerStageDescriptorUniformBuffers
 		4, // maxPerStageDescriptorStorageBuffers
@@ -159,9 +159,9 @@ const VkPhysicalDeviceLimits& PhysicalDevice::getLimits() const
 		128, // maxPerStageResources
 		96, // maxDescriptorSetSamplers
 		72, // maxDescriptorSetUniformBuffers
-		8, // maxDescriptorSetUniformBuffersDynamic
+		vk::MAX_DESCRIPTOR_SET_UNIFORM_BUFFERS_DYNAMIC, // maxDescriptorSetUniformBuffersDynamic
 		24, // maxDescriptorSetStorageBuffers
-		4, // maxDescriptorSetStorageBuffersDynamic
+		vk::MAX_DESCRIPTOR_SET_STORAGE_BUFFERS_DYNAMIC, // maxDescriptorSetStorageBuffersDynamic
 		96, // maxDescriptorSetSampledImages
 		24, // maxDescriptorSetStorageImages
 		4, // maxDescriptorSetInputAttachments
@@ -187,7 +187,7 @@ const VkPhysicalDeviceLimits& PhysicalDevice::getLimits() const
 		4, // maxFragmentOutputAttachments
 		1, // maxFragmentDualSrcAttachments
 		4, // maxFragmentCombinedOutputResources
-		16384, // maxComputeSharedMemorySize
+		MAX_COMPUTE_SHARED_MEMORY_SIZE, // maxComputeSharedMemorySize
 		{ 65535, 65535, 65535 }, // maxComputeWorkGroupCount[3]
 		128, // maxComputeWorkGroupInvocations
 		{ 128, 128, 64, }, // maxComputeWorkGroupSize[3]
@@ -198,7 +198,7 @@ const VkPhysicalDeviceLimits& PhysicalDevice::getLimits() const
 		UINT32_MAX, // maxDrawIndirectCount
 		2, // maxSamplerLodBias
 		16, // maxSamplerAnisotropy
-		16, // maxViewports
+		vk::MAX_VIEWPORTS, // maxViewports
 		{ 4096, 4096 }, // maxViewportDimensions[2]
 		{ -8192, 8191 }, // viewportBoundsRange[2]
 		0, // viewportSubPixelBits
@@ -227,8 +227,8 @@ const VkPhysicalDeviceLimits& PhysicalDevice::getLimits() const
 		sampleCounts, // sampledImageStencilSampleCounts
 		VK_SAMPLE_COUNT_1_BIT, // storageImageSampleCounts (unsupported)
 		1, // maxSampleMaskWords
-		false, // timestampComputeAndGraphics
-		60, // timestampPeriod
+		true, // timestampComputeAndGraphics
+		1, // timestampPeriod (nanoseconds)
 		8, // maxClipDistances
 		8, // maxCullDistances
 		8, // maxCombinedClipAndCullDistances
@@ -425,9 +425,36 @@ void PhysicalDevice::getImageFormatProperties(VkFormat format, VkImageType type,
 
 }
 
+namespace
+{
+	// Every queue executes its submissions on its own thread, so work submitted to
+	// the compute and transfer queues overlaps with the graphics queue's.
+	const VkQueueFamilyProperties queueFamilyProperties[] =
+	{
+		{
+			VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT, // queueFlags
+			1, // queueCount
+			64, // timestampValidBits
+			{ 1, 1, 1 }, // minImageTransferGranularity
+		},
+		{
+			VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT, // queueFlags
+			2, // queueCount
+			64, // timestampValidBits
+			{ 1, 1, 1 }, // minImageTransferGranularity
+		},
+		{
+			VK_QUEUE_TRANSFER_BIT, // queueFlags
+			1, // queueCount
+			64, // timestampValidBits
+			{ 1, 1, 1 }, // minImageTransferGranularity
+		},
+	};
+}
+
 uint32_t PhysicalDevice::getQueueFamilyPropertyCount() const
 {
-	return 1;
+	return sizeof(queueFamilyProperties) / sizeof(queueFamilyProperties[0]);
 }
 
 void PhysicalDevice::getQueueFamilyProperties(uint32_t pQueueFamilyPropertyCount,
@@ -435,12 +462,16 @@ void PhysicalDevice::getQueueFamilyProperties(uint32_t pQueueFamilyPropertyCount
 {
 	for(uint32_t i = 0; i < pQueueFamilyPropertyCount; i++)
 	{
-		pQueueFamilyProperties[i].minImageTransferGranularity.width = 1;
-		pQueueFamilyProperties[i].minImageTransferGranularity.height = 1;
-		pQueueFamilyProperties[i].minImageTransferGranularity.depth = 1;
-		pQueueFamilyProperties[i].queueCount = 1;
-		pQueueFamilyProperties[i].queueFlags = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT;
-		pQueueFamilyProperties[i].timestampValidBits = 0; // No support for time stamps
+		pQueueFamilyProperties[i] = queueFamilyProperties[i];
+	}
+}
+
+void PhysicalDevice::getQueueFamilyProperties(uint32_t pQueueFamilyPropertyCount,
+                                              VkQueueFamilyProperties2* pQueueFamilyProperties) const
+{
+	for(uint32_t i = 0; i < pQueueFamilyPropertyCount; i++)
+	{
+		pQueueFamilyProperties[i].queueFamilyProperties = queueFamilyProperties[i];
 	}
 }
 
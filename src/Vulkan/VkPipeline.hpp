@@ -0,0 +1,115 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VK_PIPELINE_HPP_
+#define VK_PIPELINE_HPP_
+
+#include "VkObject.hpp"
+
+namespace vk
+{
+
+class ComputeProgram;
+
+class Pipeline
+{
+public:
+	operator VkPipeline()
+	{
+		return reinterpret_cast<VkPipeline>(this);
+	}
+
+	void destroy(const VkAllocationCallbacks* pAllocator)
+	{
+		destroyPipeline(pAllocator);
+	}
+
+	virtual void destroyPipeline(const VkAllocationCallbacks* pAllocator) = 0;
+	virtual VkPipelineBindPoint bindPoint() const = 0;
+
+protected:
+	~Pipeline() {}
+};
+
+// Each pipeline of a vkCreate*Pipelines batch is constructed independently of the
+// others, so that shader compilation can be spread over several threads.
+class GraphicsPipeline : public Pipeline, public ObjectBase<GraphicsPipeline, VkPipeline>
+{
+public:
+	GraphicsPipeline(const VkGraphicsPipelineCreateInfo* pCreateInfo, void* mem) :
+		flags(pCreateInfo->flags), layout(pCreateInfo->layout)
+	{
+	}
+
+	~GraphicsPipeline() = delete;
+
+	void destroyPipeline(const VkAllocationCallbacks* pAllocator) override {}
+
+	VkPipelineBindPoint bindPoint() const override
+	{
+		return VK_PIPELINE_BIND_POINT_GRAPHICS;
+	}
+
+	static size_t ComputeRequiredAllocationSize(const VkGraphicsPipelineCreateInfo* pCreateInfo)
+	{
+		return 0;
+	}
+
+private:
+	VkPipelineCreateFlags flags = 0;
+	VkPipelineLayout      layout = VK_NULL_HANDLE;
+};
+
+class ComputePipeline : public Pipeline, public ObjectBase<ComputePipeline, VkPipeline>
+{
+public:
+	ComputePipeline(const VkComputePipelineCreateInfo* pCreateInfo, void* mem) :
+		flags(pCreateInfo->flags), layout(pCreateInfo->layout)
+	{
+	}
+
+	~ComputePipeline() = delete;
+
+	void destroyPipeline(const VkAllocationCallbacks* pAllocator) override {}
+
+	VkPipelineBindPoint bindPoint() const override
+	{
+		return VK_PIPELINE_BIND_POINT_COMPUTE;
+	}
+
+	static size_t ComputeRequiredAllocationSize(const VkComputePipelineCreateInfo* pCreateInfo)
+	{
+		return 0;
+	}
+
+	// Null until compute shaders get compiled
+	const ComputeProgram* getProgram() const
+	{
+		return program;
+	}
+
+private:
+	VkPipelineCreateFlags flags = 0;
+	VkPipelineLayout      layout = VK_NULL_HANDLE;
+	ComputeProgram*       program = nullptr;
+};
+
+static inline Pipeline* Cast(VkPipeline object)
+{
+	return reinterpret_cast<Pipeline*>(object);
+}
+
+} // namespace vk
+
+#endif // VK_PIPELINE_HPP_
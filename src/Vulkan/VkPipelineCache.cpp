@@ -0,0 +1,249 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "VkPipelineCache.hpp"
+#include "VkConfig.h"
+
+#include <map>
+#include <mutex>
+#include <vector>
+#include <string.h>
+
+namespace vk
+{
+
+// The serialized cache is the version one header the spec requires, followed by
+// the entry count and, for each entry, its key and data sizes, key and data.
+class PipelineCache::Entries
+{
+public:
+	typedef std::vector<uint8_t> Blob;
+
+	std::mutex mutex;
+	std::map<Blob, Blob> map;
+};
+
+namespace
+{
+	// Layout of CacheHeader, which our Vulkan headers predate
+	struct CacheHeader
+	{
+		uint32_t headerSize;
+		VkPipelineCacheHeaderVersion headerVersion;
+		uint32_t vendorID;
+		uint32_t deviceID;
+		uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+	};
+
+	static_assert(sizeof(CacheHeader) == 16 + VK_UUID_SIZE, "Unexpected cache header size");
+
+	void initHeader(CacheHeader* header)
+	{
+		header->headerSize = sizeof(CacheHeader);
+		header->headerVersion = VK_PIPELINE_CACHE_HEADER_VERSION_ONE;
+		header->vendorID = VENDOR_ID;
+		header->deviceID = DEVICE_ID;
+		memset(header->pipelineCacheUUID, 0, VK_UUID_SIZE);
+		memcpy(header->pipelineCacheUUID, SWIFTSHADER_UUID, strlen(SWIFTSHADER_UUID));
+	}
+
+	bool read(const uint8_t*& data, const uint8_t* end, void* value, size_t size)
+	{
+		if(static_cast<size_t>(end - data) < size)
+		{
+			return false;
+		}
+
+		memcpy(value, data, size);
+		data += size;
+
+		return true;
+	}
+
+	void write(uint8_t*& data, const void* value, size_t size)
+	{
+		memcpy(data, value, size);
+		data += size;
+	}
+}
+
+PipelineCache::PipelineCache(const VkPipelineCacheCreateInfo* pCreateInfo, void* mem) :
+	entries(new (mem) Entries())
+{
+	if(pCreateInfo->pInitialData && (pCreateInfo->initialDataSize > 0))
+	{
+		load(reinterpret_cast<const uint8_t*>(pCreateInfo->pInitialData), pCreateInfo->initialDataSize);
+	}
+}
+
+void PipelineCache::destroy(const VkAllocationCallbacks* pAllocator)
+{
+	entries->~Entries();
+	vk::deallocate(entries, pAllocator);
+}
+
+size_t PipelineCache::ComputeRequiredAllocationSize(const VkPipelineCacheCreateInfo* pCreateInfo)
+{
+	return sizeof(Entries);
+}
+
+void PipelineCache::load(const uint8_t* data, size_t size)
+{
+	// Data from another driver, device or version is ignored, as the spec allows
+	CacheHeader expected;
+	initHeader(&expected);
+
+	if((size < sizeof(expected)) || (memcmp(data, &expected, sizeof(expected)) != 0))
+	{
+		return;
+	}
+
+	const uint8_t* end = data + size;
+	data += sizeof(expected);
+
+	uint32_t entryCount = 0;
+	if(!read(data, end, &entryCount, sizeof(entryCount)))
+	{
+		return;
+	}
+
+	for(uint32_t i = 0; i < entryCount; i++)
+	{
+		uint32_t keySize = 0;
+		uint32_t dataSize = 0;
+		if(!read(data, end, &keySize, sizeof(keySize)) ||
+		   !read(data, end, &dataSize, sizeof(dataSize)) ||
+		   (static_cast<size_t>(end - data) < static_cast<size_t>(keySize) + dataSize))
+		{
+			return;   // Truncated, keep the entries read so far
+		}
+
+		Entries::Blob key(data, data + keySize);
+		data += keySize;
+		entries->map[key].assign(data, data + dataSize);
+		data += dataSize;
+	}
+}
+
+VkResult PipelineCache::getData(size_t* pDataSize, void* pData)
+{
+	std::unique_lock<std::mutex> lock(entries->mutex);
+
+	size_t size = sizeof(CacheHeader) + sizeof(uint32_t);
+	for(auto& entry : entries->map)
+	{
+		size += 2 * sizeof(uint32_t) + entry.first.size() + entry.second.size();
+	}
+
+	if(!pData)
+	{
+		*pDataSize = size;
+		return VK_SUCCESS;
+	}
+
+	// Only whole entries are written, so a truncated cache is still a valid one
+	size_t available = *pDataSize;
+	if(available < sizeof(CacheHeader) + sizeof(uint32_t))
+	{
+		*pDataSize = 0;
+		return VK_INCOMPLETE;
+	}
+
+	uint8_t* data = reinterpret_cast<uint8_t*>(pData);
+	CacheHeader header;
+	initHeader(&header);
+	write(data, &header, sizeof(header));
+
+	uint8_t* entryCountData = data;
+	data += sizeof(uint32_t);
+	available -= sizeof(header) + sizeof(uint32_t);
+
+	uint32_t entryCount = 0;
+	for(auto& entry : entries->map)
+	{
+		size_t entrySize = 2 * sizeof(uint32_t) + entry.first.size() + entry.second.size();
+		if(entrySize > available)
+		{
+			break;
+		}
+
+		uint32_t keySize = static_cast<uint32_t>(entry.first.size());
+		uint32_t dataSize = static_cast<uint32_t>(entry.second.size());
+		write(data, &keySize, sizeof(keySize));
+		write(data, &dataSize, sizeof(dataSize));
+		write(data, entry.first.data(), keySize);
+		write(data, entry.second.data(), dataSize);
+
+		available -= entrySize;
+		entryCount++;
+	}
+
+	memcpy(entryCountData, &entryCount, sizeof(entryCount));
+	*pDataSize = data - reinterpret_cast<uint8_t*>(pData);
+
+	return (entryCount == entries->map.size()) ? VK_SUCCESS : VK_INCOMPLETE;
+}
+
+VkResult PipelineCache::merge(uint32_t srcCacheCount, const VkPipelineCache* pSrcCaches)
+{
+	std::unique_lock<std::mutex> lock(entries->mutex);
+
+	for(uint32_t i = 0; i < srcCacheCount; i++)
+	{
+		Entries* src = Cast(pSrcCaches[i])->entries;
+		std::unique_lock<std::mutex> srcLock(src->mutex);
+
+		// Entries already in the destination are kept, both were compiled from the same state
+		entries->map.insert(src->map.begin(), src->map.end());
+	}
+
+	return VK_SUCCESS;
+}
+
+bool PipelineCache::find(const void* key, size_t keySize, void* data, size_t* dataSize)
+{
+	std::unique_lock<std::mutex> lock(entries->mutex);
+
+	const uint8_t* keyBytes = reinterpret_cast<const uint8_t*>(key);
+	auto entry = entries->map.find(Entries::Blob(keyBytes, keyBytes + keySize));
+	if(entry == entries->map.end())
+	{
+		return false;
+	}
+
+	if(data)
+	{
+		if(*dataSize < entry->second.size())
+		{
+			return false;
+		}
+
+		memcpy(data, entry->second.data(), entry->second.size());
+	}
+
+	*dataSize = entry->second.size();
+
+	return true;
+}
+
+void PipelineCache::insert(const void* key, size_t keySize, const void* data, size_t dataSize)
+{
+	std::unique_lock<std::mutex> lock(entries->mutex);
+
+	const uint8_t* keyBytes = reinterpret_cast<const uint8_t*>(key);
+	const uint8_t* dataBytes = reinterpret_cast<const uint8_t*>(data);
+	entries->map[Entries::Blob(keyBytes, keyBytes + keySize)].assign(dataBytes, dataBytes + dataSize);
+}
+
+} // namespace vk
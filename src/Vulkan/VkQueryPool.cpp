@@ -0,0 +1,151 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "VkQueryPool.hpp"
+
+#include <chrono>
+
+namespace vk
+{
+
+QueryPool::QueryPool(const VkQueryPoolCreateInfo* pCreateInfo, void* mem) :
+	queries(reinterpret_cast<Query*>(mem)), type(pCreateInfo->queryType), count(pCreateInfo->queryCount)
+{
+	// Occlusion and pipeline statistics queries are never made available
+	if(type != VK_QUERY_TYPE_TIMESTAMP)
+	{
+		UNIMPLEMENTED();
+	}
+
+	for(uint32_t i = 0; i < count; i++)
+	{
+		queries[i].value = 0;
+		queries[i].available = false;
+	}
+}
+
+void QueryPool::destroy(const VkAllocationCallbacks* pAllocator)
+{
+	vk::deallocate(queries, pAllocator);
+}
+
+size_t QueryPool::ComputeRequiredAllocationSize(const VkQueryPoolCreateInfo* pCreateInfo)
+{
+	return sizeof(Query) * pCreateInfo->queryCount;
+}
+
+VkResult QueryPool::getResults(uint32_t firstQuery, uint32_t queryCount, size_t dataSize,
+                               void* pData, VkDeviceSize stride, VkQueryResultFlags flags) const
+{
+	ASSERT((firstQuery + queryCount) <= count);
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	if(flags & VK_QUERY_RESULT_WAIT_BIT)
+	{
+		availability.wait(lock, [&]()
+		{
+			for(uint32_t i = firstQuery; i < firstQuery + queryCount; i++)
+			{
+				if(!queries[i].available)
+				{
+					return false;
+				}
+			}
+
+			return true;
+		});
+	}
+
+	VkResult result = VK_SUCCESS;
+	uint8_t* data = reinterpret_cast<uint8_t*>(pData);
+
+	for(uint32_t i = firstQuery; i < firstQuery + queryCount; i++, data += stride)
+	{
+		const Query& query = queries[i];
+		if(!query.available)
+		{
+			result = VK_NOT_READY;
+		}
+
+		// Unavailable results are only written when partial results are requested
+		bool writeValue = query.available || (flags & VK_QUERY_RESULT_PARTIAL_BIT);
+		uint64_t available = query.available ? 1 : 0;
+
+		if(flags & VK_QUERY_RESULT_64_BIT)
+		{
+			uint64_t* result64 = reinterpret_cast<uint64_t*>(data);
+			if(writeValue)
+			{
+				result64[0] = query.value;
+			}
+
+			if(flags & VK_QUERY_RESULT_WITH_AVAILABILITY_BIT)
+			{
+				result64[1] = available;
+			}
+		}
+		else
+		{
+			uint32_t* result32 = reinterpret_cast<uint32_t*>(data);
+			if(writeValue)
+			{
+				result32[0] = static_cast<uint32_t>(query.value);
+			}
+
+			if(flags & VK_QUERY_RESULT_WITH_AVAILABILITY_BIT)
+			{
+				result32[1] = static_cast<uint32_t>(available);
+			}
+		}
+	}
+
+	return result;
+}
+
+void QueryPool::reset(uint32_t firstQuery, uint32_t queryCount)
+{
+	ASSERT((firstQuery + queryCount) <= count);
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	for(uint32_t i = firstQuery; i < firstQuery + queryCount; i++)
+	{
+		queries[i].value = 0;
+		queries[i].available = false;
+	}
+}
+
+void QueryPool::writeTimestamp(uint32_t query)
+{
+	ASSERT((query < count) && (type == VK_QUERY_TYPE_TIMESTAMP));
+
+	uint64_t timestamp = GetTimestamp();
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		queries[query].value = timestamp;
+		queries[query].available = true;
+	}
+
+	availability.notify_all();
+}
+
+uint64_t QueryPool::GetTimestamp()
+{
+	// steady_clock is clock_gettime(CLOCK_MONOTONIC) on POSIX and QueryPerformanceCounter on Windows
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace vk
@@ -0,0 +1,67 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VK_QUERY_POOL_HPP_
+#define VK_QUERY_POOL_HPP_
+
+#include "VkObject.hpp"
+
+#include <condition_variable>
+#include <mutex>
+
+namespace vk
+{
+
+class QueryPool : public Object<QueryPool, VkQueryPool>
+{
+public:
+	QueryPool(const VkQueryPoolCreateInfo* pCreateInfo, void* mem);
+	~QueryPool() = delete;
+	void destroy(const VkAllocationCallbacks* pAllocator);
+
+	static size_t ComputeRequiredAllocationSize(const VkQueryPoolCreateInfo* pCreateInfo);
+
+	VkResult getResults(uint32_t firstQuery, uint32_t queryCount, size_t dataSize,
+	                    void* pData, VkDeviceSize stride, VkQueryResultFlags flags) const;
+
+	// Called by the queue thread, when it reaches the commands
+	void reset(uint32_t firstQuery, uint32_t queryCount);
+	void writeTimestamp(uint32_t query);
+
+	// Nanoseconds of a monotonic clock, so timestampPeriod is 1
+	static uint64_t GetTimestamp();
+
+private:
+	struct Query
+	{
+		uint64_t value;
+		bool available;
+	};
+
+	Query*      queries = nullptr;
+	VkQueryType type = VK_QUERY_TYPE_OCCLUSION;
+	uint32_t    count = 0;
+
+	mutable std::mutex mutex;
+	mutable std::condition_variable availability;
+};
+
+static inline QueryPool* Cast(VkQueryPool object)
+{
+	return reinterpret_cast<QueryPool*>(object);
+}
+
+} // namespace vk
+
+#endif // VK_QUERY_POOL_HPP_
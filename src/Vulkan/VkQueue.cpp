@@ -14,11 +14,177 @@
 
 #include "VkQueue.hpp"
 
+#include "VkCommandBuffer.hpp"
+#include "VkFence.hpp"
+#include "VkSemaphore.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
 namespace vk
 {
 
+class Queue::Worker
+{
+public:
+	struct Batch
+	{
+		std::vector<VkSemaphore> waitSemaphores;
+		std::vector<VkPipelineStageFlags> waitDstStageMask;
+		std::vector<VkCommandBuffer> commandBuffers;
+		std::vector<VkSemaphore> signalSemaphores;
+	};
+
+	struct Submission
+	{
+		std::vector<Batch> batches;
+		VkFence fence;
+	};
+
+	Worker() : thread(&Worker::run, this)
+	{
+	}
+
+	~Worker()
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			terminate = true;
+		}
+
+		work.notify_one();
+		thread.join();
+	}
+
+	void submit(Submission &&submission)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			submissions.push_back(std::move(submission));
+		}
+
+		work.notify_one();
+	}
+
+	void waitIdle()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		idle.wait(lock, [this]() { return submissions.empty() && !busy; });
+	}
+
+private:
+	void run()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		while(true)
+		{
+			work.wait(lock, [this]() { return terminate || !submissions.empty(); });
+
+			if(submissions.empty())
+			{
+				break;   // Terminating, with all the work done
+			}
+
+			Submission submission = std::move(submissions.front());
+			submissions.pop_front();
+			busy = true;
+
+			lock.unlock();
+			execute(submission);
+			lock.lock();
+
+			busy = false;
+
+			if(submissions.empty())
+			{
+				idle.notify_all();
+			}
+		}
+	}
+
+	static void execute(const Submission &submission)
+	{
+		for(const Batch &batch : submission.batches)
+		{
+			for(size_t i = 0; i < batch.waitSemaphores.size(); i++)
+			{
+				vk::Cast(batch.waitSemaphores[i])->wait(batch.waitDstStageMask[i]);
+			}
+
+			for(VkCommandBuffer commandBuffer : batch.commandBuffers)
+			{
+				vk::Cast(commandBuffer)->submit();
+			}
+
+			for(VkSemaphore semaphore : batch.signalSemaphores)
+			{
+				vk::Cast(semaphore)->signal();
+			}
+		}
+
+		if(submission.fence != VK_NULL_HANDLE)
+		{
+			vk::Cast(submission.fence)->signal();
+		}
+	}
+
+	std::mutex mutex;
+	std::condition_variable work;
+	std::condition_variable idle;
+	std::deque<Submission> submissions;
+	bool busy = false;
+	bool terminate = false;
+
+	std::thread thread;   // Last, so it starts after everything it uses is constructed
+};
+
 Queue::Queue(uint32_t pFamilyIndex, float pPriority) : familyIndex(pFamilyIndex), priority(pPriority)
 {
+	worker = new Worker();
+}
+
+void Queue::destroy()
+{
+	delete worker;   // Finishes the submitted work first
+	worker = nullptr;
+}
+
+VkResult Queue::submit(uint32_t submitCount, const VkSubmitInfo* pSubmits, VkFence fence)
+{
+	Worker::Submission submission;
+	submission.batches.resize(submitCount);
+	submission.fence = fence;
+
+	// The arrays only have to stay valid for the duration of this call
+	for(uint32_t i = 0; i < submitCount; i++)
+	{
+		const VkSubmitInfo& submitInfo = pSubmits[i];
+		Worker::Batch& batch = submission.batches[i];
+
+		if(submitInfo.pNext)
+		{
+			UNIMPLEMENTED();
+		}
+
+		batch.waitSemaphores.assign(submitInfo.pWaitSemaphores, submitInfo.pWaitSemaphores + submitInfo.waitSemaphoreCount);
+		batch.waitDstStageMask.assign(submitInfo.pWaitDstStageMask, submitInfo.pWaitDstStageMask + submitInfo.waitSemaphoreCount);
+		batch.commandBuffers.assign(submitInfo.pCommandBuffers, submitInfo.pCommandBuffers + submitInfo.commandBufferCount);
+		batch.signalSemaphores.assign(submitInfo.pSignalSemaphores, submitInfo.pSignalSemaphores + submitInfo.signalSemaphoreCount);
+	}
+
+	worker->submit(std::move(submission));
+
+	return VK_SUCCESS;
+}
+
+void Queue::waitIdle()
+{
+	worker->waitIdle();
 }
 
 } // namespace vk
\ No newline at end of file
@@ -34,9 +34,20 @@ public:
 		return reinterpret_cast<VkQueue>(this);
 	}
 
+	void destroy();
+
+	// Returns as soon as the batches are queued, they get executed in order by the queue's thread
+	VkResult submit(uint32_t submitCount, const VkSubmitInfo* pSubmits, VkFence fence);
+	void waitIdle();
+
+	uint32_t getFamilyIndex() const { return familyIndex; }
+
 private:
+	class Worker;
+
 	uint32_t familyIndex = 0;
 	float    priority = 0.0f;
+	Worker*  worker = nullptr;
 };
 
 static inline Queue* Cast(VkQueue object)
@@ -0,0 +1,124 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "VkRenderPass.hpp"
+
+#include <cstring>
+
+namespace vk
+{
+
+namespace
+{
+	bool hasStencil(VkFormat format)
+	{
+		switch(format)
+		{
+		case VK_FORMAT_S8_UINT:
+		case VK_FORMAT_D16_UNORM_S8_UINT:
+		case VK_FORMAT_D24_UNORM_S8_UINT:
+		case VK_FORMAT_D32_SFLOAT_S8_UINT:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	bool hasColorOrDepth(VkFormat format)
+	{
+		return format != VK_FORMAT_S8_UINT;
+	}
+}
+
+RenderPass::RenderPass(const VkRenderPassCreateInfo* pCreateInfo, void* mem) :
+	attachmentCount(pCreateInfo->attachmentCount),
+	attachments(reinterpret_cast<VkAttachmentDescription*>(mem)),
+	usage(reinterpret_cast<Usage*>(attachments + attachmentCount)),
+	subpassCount(pCreateInfo->subpassCount)
+{
+	memcpy(attachments, pCreateInfo->pAttachments, sizeof(VkAttachmentDescription) * attachmentCount);
+
+	for(uint32_t i = 0; i < attachmentCount; i++)
+	{
+		usage[i].firstSubpass = VK_SUBPASS_EXTERNAL;
+		usage[i].lastSubpass = VK_SUBPASS_EXTERNAL;
+	}
+
+	for(uint32_t i = 0; i < subpassCount; i++)
+	{
+		const VkSubpassDescription& subpass = pCreateInfo->pSubpasses[i];
+
+		use(i, subpass.pInputAttachments, subpass.inputAttachmentCount);
+		use(i, subpass.pColorAttachments, subpass.colorAttachmentCount);
+		use(i, subpass.pResolveAttachments, subpass.pResolveAttachments ? subpass.colorAttachmentCount : 0);
+		use(i, subpass.pDepthStencilAttachment, subpass.pDepthStencilAttachment ? 1 : 0);
+	}
+}
+
+void RenderPass::destroy(const VkAllocationCallbacks* pAllocator)
+{
+	vk::deallocate(attachments, pAllocator);
+}
+
+size_t RenderPass::ComputeRequiredAllocationSize(const VkRenderPassCreateInfo* pCreateInfo)
+{
+	return (sizeof(VkAttachmentDescription) + sizeof(Usage)) * pCreateInfo->attachmentCount;
+}
+
+bool RenderPass::clearsContents(uint32_t attachment) const
+{
+	const VkAttachmentDescription& description = attachments[attachment];
+
+	return (hasColorOrDepth(description.format) && (description.loadOp == VK_ATTACHMENT_LOAD_OP_CLEAR)) ||
+	       (hasStencil(description.format) && (description.stencilLoadOp == VK_ATTACHMENT_LOAD_OP_CLEAR));
+}
+
+bool RenderPass::loadsContents(uint32_t attachment) const
+{
+	const VkAttachmentDescription& description = attachments[attachment];
+
+	return (hasColorOrDepth(description.format) && (description.loadOp != VK_ATTACHMENT_LOAD_OP_DONT_CARE)) ||
+	       (hasStencil(description.format) && (description.stencilLoadOp != VK_ATTACHMENT_LOAD_OP_DONT_CARE));
+}
+
+bool RenderPass::storesContents(uint32_t attachment) const
+{
+	const VkAttachmentDescription& description = attachments[attachment];
+
+	return (hasColorOrDepth(description.format) && (description.storeOp == VK_ATTACHMENT_STORE_OP_STORE)) ||
+	       (hasStencil(description.format) && (description.stencilStoreOp == VK_ATTACHMENT_STORE_OP_STORE));
+}
+
+void RenderPass::use(uint32_t subpass, const VkAttachmentReference* references, uint32_t referenceCount)
+{
+	for(uint32_t i = 0; i < referenceCount; i++)
+	{
+		uint32_t attachment = references[i].attachment;
+
+		if(attachment == VK_ATTACHMENT_UNUSED)
+		{
+			continue;
+		}
+
+		if(usage[attachment].firstSubpass == VK_SUBPASS_EXTERNAL)
+		{
+			usage[attachment].firstSubpass = subpass;
+		}
+
+		usage[attachment].lastSubpass = subpass;
+	}
+}
+
+} // namespace vk
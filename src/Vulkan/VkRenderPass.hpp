@@ -0,0 +1,71 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef VK_RENDER_PASS_HPP_
+#define VK_RENDER_PASS_HPP_
+
+#include "VkObject.hpp"
+
+namespace vk
+{
+
+class RenderPass : public Object<RenderPass, VkRenderPass>
+{
+public:
+	RenderPass(const VkRenderPassCreateInfo* pCreateInfo, void* mem);
+	~RenderPass() = delete;
+	void destroy(const VkAllocationCallbacks* pAllocator);
+
+	static size_t ComputeRequiredAllocationSize(const VkRenderPassCreateInfo* pCreateInfo);
+
+	uint32_t getAttachmentCount() const { return attachmentCount; }
+	uint32_t getSubpassCount() const { return subpassCount; }
+
+	// Load operations happen in the first subpass using an attachment, and store
+	// operations after the last one. Unused attachments are never loaded or stored.
+	bool isFirstUse(uint32_t attachment, uint32_t subpass) const { return usage[attachment].firstSubpass == subpass; }
+	bool isLastUse(uint32_t attachment, uint32_t subpass) const { return usage[attachment].lastSubpass == subpass; }
+
+	bool clearsContents(uint32_t attachment) const;
+	bool loadsContents(uint32_t attachment) const;   // False when the previous contents are undefined
+	bool storesContents(uint32_t attachment) const;  // False when the contents are discarded after the pass
+
+	// Contents of transient attachments don't outlive the render pass, so they
+	// never have to be read from or written back to the image's memory
+	bool isTransient(uint32_t attachment) const { return !loadsContents(attachment) && !storesContents(attachment); }
+
+private:
+	struct Usage
+	{
+		uint32_t firstSubpass;
+		uint32_t lastSubpass;
+	};
+
+	void use(uint32_t subpass, const VkAttachmentReference* references, uint32_t referenceCount);
+
+	uint32_t attachmentCount = 0;
+	VkAttachmentDescription* attachments = nullptr;
+	Usage* usage = nullptr;
+	uint32_t subpassCount = 0;
+};
+
+static inline RenderPass* Cast(VkRenderPass object)
+{
+	return reinterpret_cast<RenderPass*>(object);
+}
+
+} // namespace vk
+
+#endif // VK_RENDER_PASS_HPP_
@@ -17,6 +17,9 @@
 
 #include "VkObject.hpp"
 
+#include <condition_variable>
+#include <mutex>
+
 namespace vk
 {
 
@@ -34,22 +37,29 @@ public:
 
 	void wait()
 	{
-		// Semaphores are noop for now
+		std::unique_lock<std::mutex> lock(mutex);
+		condition.wait(lock, [this]() { return signaled; });
+		signaled = false;   // Waiting unsignals a binary semaphore
 	}
 
 	void wait(const VkPipelineStageFlags& flag)
 	{
-		// VkPipelineStageFlags is the pipeline stage at which the semaphore wait will occur
-
-		// Semaphores are noop for now
+		// VkPipelineStageFlags is the pipeline stage at which the semaphore wait will occur.
+		// Batches are executed serially, so everything waits before the first stage.
+		wait();
 	}
 
 	void signal()
 	{
-		// Semaphores are noop for now
+		std::unique_lock<std::mutex> lock(mutex);
+		signaled = true;
+		condition.notify_all();
 	}
 
 private:
+	bool signaled = false;
+	std::mutex mutex;
+	std::condition_variable condition;
 };
 
 static inline Semaphore* Cast(VkSemaphore object)
@@ -0,0 +1,323 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Measures the throughput of sw::Blitter::blit() for pairs of formats, and of
+// the conversions done by sw::Surface when a surface's external contents get
+// copied to its internal buffer. Each run prints one line:
+//
+//   blit <source> <destination> scale=<ratio> filter=<point|linear> gb_per_s=<rate> [slow_path]
+//   update <external> <internal> gb_per_s=<rate> [slow_path]
+//
+// Rates count the bytes read and written. 'slow_path' marks runs which were
+// done texel by texel instead of by a generated routine or a dedicated decoder.
+//
+// Usage: BlitterBenchmarks [--filter <substring>] [--threads <count>] [--seconds <time>]
+
+#include "Renderer/Blitter.hpp"
+#include "Renderer/RoutineStatistics.hpp"
+#include "Renderer/Surface.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace sw;
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	double elapsedSeconds(Clock::time_point start)
+	{
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	struct FormatName
+	{
+		Format format;
+		const char *name;
+	};
+
+	#define FORMAT_NAME(name) {FORMAT_##name, #name}
+
+	const FormatName formatNames[] =
+	{
+		FORMAT_NAME(A8), FORMAT_NAME(R8), FORMAT_NAME(G8R8), FORMAT_NAME(R5G6B5), FORMAT_NAME(R8G8B8), FORMAT_NAME(B8G8R8),
+		FORMAT_NAME(X4R4G4B4), FORMAT_NAME(A4R4G4B4), FORMAT_NAME(R4G4B4A4), FORMAT_NAME(X1R5G5B5), FORMAT_NAME(A1R5G5B5),
+		FORMAT_NAME(R5G5B5A1), FORMAT_NAME(X8R8G8B8), FORMAT_NAME(A8R8G8B8), FORMAT_NAME(X8B8G8R8), FORMAT_NAME(A8B8G8R8),
+		FORMAT_NAME(SRGB8_X8), FORMAT_NAME(SRGB8_A8), FORMAT_NAME(A2R10G10B10), FORMAT_NAME(A2B10G10R10), FORMAT_NAME(A16B16G16R16),
+		FORMAT_NAME(L8), FORMAT_NAME(A8L8), FORMAT_NAME(R16F), FORMAT_NAME(G16R16F), FORMAT_NAME(B16G16R16F),
+		FORMAT_NAME(A16B16G16R16F), FORMAT_NAME(R32F), FORMAT_NAME(G32R32F), FORMAT_NAME(B32G32R32F), FORMAT_NAME(A32B32G32R32F),
+		FORMAT_NAME(X32B32G32R32F), FORMAT_NAME(DXT1), FORMAT_NAME(DXT5), FORMAT_NAME(ETC1), FORMAT_NAME(RGBA8_ETC2_EAC),
+		FORMAT_NAME(RGBA_ASTC_4x4_KHR),
+	};
+
+	#undef FORMAT_NAME
+
+	std::string formatName(Format format)
+	{
+		for(const FormatName &entry : formatNames)
+		{
+			if(entry.format == format)
+			{
+				return entry.name;
+			}
+		}
+
+		return "FORMAT_" + std::to_string((int)format);
+	}
+
+	// Formats which surfaces use internally, so blits between them aren't preceded by conversions
+	const Format blitFormats[] =
+	{
+		FORMAT_R8,
+		FORMAT_G8R8,
+		FORMAT_R5G6B5,
+		FORMAT_X8R8G8B8,
+		FORMAT_A8R8G8B8,
+		FORMAT_A8B8G8R8,
+		FORMAT_SRGB8_A8,
+		FORMAT_A2B10G10R10,
+		FORMAT_A16B16G16R16F,
+		FORMAT_R32F,
+		FORMAT_A32B32G32R32F,
+	};
+
+	// Formats of client data, which get converted or decoded when the surface is first used
+	const Format updateFormats[] =
+	{
+		FORMAT_R8G8B8,
+		FORMAT_B8G8R8,
+		FORMAT_X4R4G4B4,
+		FORMAT_A4R4G4B4,
+		FORMAT_R4G4B4A4,
+		FORMAT_X1R5G5B5,
+		FORMAT_A1R5G5B5,
+		FORMAT_R5G5B5A1,
+		FORMAT_R5G6B5,
+		FORMAT_X8B8G8R8,
+		FORMAT_A8B8G8R8,
+		FORMAT_L8,
+		FORMAT_A8L8,
+		FORMAT_R16F,
+		FORMAT_B16G16R16F,
+		FORMAT_A16B16G16R16F,
+		FORMAT_B32G32R32F,
+		FORMAT_A32B32G32R32F,
+		FORMAT_DXT1,
+		FORMAT_DXT5,
+		FORMAT_ETC1,
+		FORMAT_RGBA8_ETC2_EAC,
+		FORMAT_RGBA_ASTC_4x4_KHR,
+	};
+
+	const int surfaceSize = 1024;
+
+	struct Fallbacks
+	{
+		Fallbacks()
+		{
+			SwiftShaderRoutineStatistics statistics = {};
+			swiftshaderGetRoutineStatistics(&statistics);
+
+			blit = statistics.blitFallbacks;
+			update = statistics.updateFallbacks;
+		}
+
+		uint64_t blit;
+		uint64_t update;
+	};
+
+	// Non-zero contents, so that conversions don't take shortcuts on special values
+	void fill(void *buffer, size_t size)
+	{
+		unsigned char *bytes = static_cast<unsigned char*>(buffer);
+
+		for(size_t i = 0; i < size; i++)
+		{
+			bytes[i] = (unsigned char)(((i * 2654435761u) >> 24) & 0x3B);
+		}
+	}
+
+	Surface *createSurface(int width, int height, Format format)
+	{
+		Surface *surface = Surface::create(nullptr, width, height, 1, 0, 1, format, true, false);
+
+		void *buffer = surface->lockInternal(0, 0, 0, LOCK_DISCARD, PUBLIC);
+
+		if(buffer)
+		{
+			fill(buffer, surface->getInternalSliceB());
+		}
+
+		surface->unlockInternal();
+
+		return surface;
+	}
+
+	template<class Run>
+	double measure(Run run, double seconds)
+	{
+		run();   // Generates the routines
+
+		int iterations = 0;
+		double elapsed = 0.0;
+		Clock::time_point start = Clock::now();
+
+		do
+		{
+			run();
+			iterations++;
+			elapsed = elapsedSeconds(start);
+		}
+		while(elapsed < seconds);
+
+		return elapsed / iterations;
+	}
+
+	void benchmarkBlit(Blitter &blitter, Format sourceFormat, Format destFormat, float scale, bool filter, double seconds, const char *nameFilter)
+	{
+		int sourceSize = (int)(surfaceSize / scale);
+
+		Surface *source = createSurface(sourceSize, sourceSize, sourceFormat);
+		Surface *dest = createSurface(surfaceSize, surfaceSize, destFormat);
+
+		char name[256];
+		snprintf(name, sizeof(name), "blit %s %s scale=%g filter=%s",
+		         formatName(source->getInternalFormat()).c_str(), formatName(dest->getInternalFormat()).c_str(),
+		         scale, filter ? "linear" : "point");
+
+		if(!nameFilter || strstr(name, nameFilter))
+		{
+			SliceRectF sourceRect(0.0f, 0.0f, (float)sourceSize, (float)sourceSize, 0);
+			SliceRect destRect(0, 0, surfaceSize, surfaceSize, 0);
+
+			Fallbacks before;
+			double time = measure([&]() { blitter.blit(source, sourceRect, dest, destRect, {filter, false, false}); }, seconds);
+			Fallbacks after;
+
+			double bytes = (double)source->getInternalSliceB() + (double)dest->getInternalSliceB();
+			bool slow = after.blit != before.blit;
+
+			printf("%s gb_per_s=%.3f%s\n", name, bytes / time / 1e9, slow ? " slow_path" : "");
+			fflush(stdout);
+		}
+
+		delete source;
+		delete dest;
+	}
+
+	void benchmarkUpdate(Format format, double seconds, const char *nameFilter)
+	{
+		Surface *surface = Surface::create(nullptr, surfaceSize, surfaceSize, 1, 0, 1, format, true, false);
+
+		char name[256];
+		snprintf(name, sizeof(name), "update %s %s",
+		         formatName(surface->getExternalFormat()).c_str(), formatName(surface->getInternalFormat()).c_str());
+
+		if(nameFilter && !strstr(name, nameFilter))
+		{
+			delete surface;
+			return;
+		}
+
+		void *external = surface->lockExternal(0, 0, 0, LOCK_DISCARD, PUBLIC);
+
+		if(external)
+		{
+			fill(external, surface->getExternalSliceB());
+		}
+
+		surface->unlockExternal();
+
+		// Rewriting the external contents makes the next internal lock convert them again
+		auto update = [&]()
+		{
+			surface->lockExternal(0, 0, 0, LOCK_WRITEONLY, PUBLIC);
+			surface->unlockExternal();
+			surface->lockInternal(0, 0, 0, LOCK_READONLY, PUBLIC);
+			surface->unlockInternal();
+		};
+
+		Fallbacks before;
+		double time = measure(update, seconds);
+		Fallbacks after;
+
+		double bytes = (double)surface->getExternalSliceB() + (double)surface->getInternalSliceB();
+		bool slow = after.update != before.update;
+
+		printf("%s gb_per_s=%.3f%s\n", name, bytes / time / 1e9, slow ? " slow_path" : "");
+		fflush(stdout);
+
+		delete surface;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	const char *filter = nullptr;
+	int threads = std::max((int)std::thread::hardware_concurrency(), 1);
+	double seconds = 0.1;
+
+	for(int i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+		{
+			filter = argv[++i];
+		}
+		else if(strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+		{
+			threads = std::max(atoi(argv[++i]), 1);
+		}
+		else if(strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+		{
+			seconds = std::max(atof(argv[++i]), 0.0);
+		}
+		else
+		{
+			fprintf(stderr, "Usage: %s [--filter <substring>] [--threads <count>] [--seconds <time>]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	Blitter blitter;
+	blitter.setThreadCount(threads);
+
+	for(Format sourceFormat : blitFormats)
+	{
+		for(Format destFormat : blitFormats)
+		{
+			for(float scale : {1.0f, 0.5f, 2.0f})
+			{
+				for(bool linear : {false, true})
+				{
+					benchmarkBlit(blitter, sourceFormat, destFormat, scale, linear, seconds, filter);
+				}
+			}
+		}
+	}
+
+	for(Format format : updateFormats)
+	{
+		benchmarkUpdate(format, seconds, filter);
+	}
+
+	return 0;
+}
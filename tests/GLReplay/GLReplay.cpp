@@ -0,0 +1,578 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Replays a GL trace written by libGLESv2 when SWIFTSHADER_GL_TRACE_FILE is
+// set, as fast as possible into an offscreen surface. Each frame ends with a
+// glFinish(), and prints one line:
+//
+//   frame <index> cpu_ms=<time> draws=<count> routines=<compiled>
+//
+// followed by a summary of all frames. Traces are assumed to come from a
+// single context, and to be replayed against the SwiftShader build which
+// recorded them, so object names and uniform locations match.
+//
+// Usage: GLReplay <trace> [--quiet]
+
+#include "OpenGL/libGLESv2/TraceFormat.h"
+#include "Renderer/RoutineStatistics.hpp"
+
+#include <EGL/egl.h>
+#include <GLES2/gl2.h>
+#include <GLES3/gl3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace es2;
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	double elapsedMilliseconds(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	// Reads the payload of one record. Client memory is referenced in place.
+	class Record
+	{
+	public:
+		Record(const uint32_t *payload, size_t words) : word(payload), end(payload + words)
+		{
+		}
+
+		bool overrun() const
+		{
+			return word > end;
+		}
+
+		uint32_t next()
+		{
+			return (word < end) ? *word++ : (word++, 0);
+		}
+
+		int64_t next64()
+		{
+			uint32_t bits[2] = {next(), next()};
+			int64_t value;
+			memcpy(&value, bits, sizeof(value));
+			return value;
+		}
+
+		const void *pointer()
+		{
+			switch(next())
+			{
+			case TRACE_POINTER_OFFSET:
+				return reinterpret_cast<const void*>(static_cast<intptr_t>(next64()));
+			case TRACE_POINTER_DATA:
+				{
+					uint32_t size = next();
+					const uint32_t *data = word;
+					word += (size + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+					return overrun() ? nullptr : data;
+				}
+			default:   // Null, or client vertex arrays set up before drawing
+				return nullptr;
+			}
+		}
+
+		// Arguments of type T, stored as described in TraceFormat.h
+		template<class T>
+		T read();
+
+	private:
+		const uint32_t *word;
+		const uint32_t *const end;
+	};
+
+	template<> GLuint Record::read<GLuint>() { return next(); }
+	template<> GLint Record::read<GLint>() { return static_cast<GLint>(next()); }
+	template<> GLboolean Record::read<GLboolean>() { return static_cast<GLboolean>(next()); }
+	template<> GLintptr Record::read<GLintptr>() { return static_cast<GLintptr>(next64()); }   // Also GLsizeiptr
+	template<> const void *Record::read<const void*>() { return pointer(); }
+	template<> const GLchar *Record::read<const GLchar*>() { return static_cast<const GLchar*>(pointer()); }
+	template<> const GLint *Record::read<const GLint*>() { return static_cast<const GLint*>(pointer()); }
+	template<> const GLuint *Record::read<const GLuint*>() { return static_cast<const GLuint*>(pointer()); }
+	template<> const GLfloat *Record::read<const GLfloat*>() { return static_cast<const GLfloat*>(pointer()); }
+
+	template<> GLfloat Record::read<GLfloat>()
+	{
+		uint32_t bits = next();
+		GLfloat value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	// Braced initialization evaluates the arguments, and thus reads the record, from left to right
+	template<class... Args>
+	struct Invocation
+	{
+		Invocation(void (GL_APIENTRY *function)(Args...), Args... args)
+		{
+			function(args...);
+		}
+	};
+
+	template<class... Args>
+	void replay(void (GL_APIENTRY *function)(Args...), Record &record)
+	{
+		Invocation<Args...>{function, record.read<Args>()...};
+	}
+
+	class Replayer
+	{
+	public:
+		Replayer(bool quiet) : quiet(quiet)
+		{
+		}
+
+		~Replayer()
+		{
+			if(display != EGL_NO_DISPLAY)
+			{
+				eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+				eglTerminate(display);
+			}
+		}
+
+		bool run(const std::vector<uint32_t> &trace);
+		void summary() const;
+
+	private:
+		bool makeCurrent(EGLint width, EGLint height);
+		void clientVertexData(Record &record);
+		void readPixels(Record &record);
+		void checkNames(const char *call, GLsizei count, const GLuint *names, const GLuint *recorded);
+		void endFrame();
+
+		const bool quiet;
+
+		EGLDisplay display = EGL_NO_DISPLAY;
+		EGLConfig config = nullptr;
+		EGLContext context = EGL_NO_CONTEXT;
+		EGLSurface surface = EGL_NO_SURFACE;
+		EGLint surfaceWidth = 0;
+		EGLint surfaceHeight = 0;
+
+		Clock::time_point frameStart;
+		uint64_t frameDraws = 0;
+		uint64_t frameRoutines = 0;
+		bool nameMismatch = false;
+
+		std::vector<double> frameTimes;
+		uint64_t totalDraws = 0;
+		uint64_t totalRoutines = 0;
+		std::vector<unsigned char> scratch;
+	};
+
+	uint64_t compiledRoutines()
+	{
+		SwiftShaderRoutineStatistics statistics = {};
+		swiftshaderGetRoutineStatistics(&statistics);
+
+		return statistics.routines;
+	}
+
+	bool Replayer::makeCurrent(EGLint width, EGLint height)
+	{
+		width = std::max(width, 1);
+		height = std::max(height, 1);
+
+		if(display == EGL_NO_DISPLAY)
+		{
+			display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+			const EGLint configAttributes[] =
+			{
+				EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+				EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
+				EGL_RED_SIZE, 8,
+				EGL_GREEN_SIZE, 8,
+				EGL_BLUE_SIZE, 8,
+				EGL_ALPHA_SIZE, 8,
+				EGL_DEPTH_SIZE, 24,
+				EGL_STENCIL_SIZE, 8,
+				EGL_NONE
+			};
+
+			const EGLint contextAttributes[] =
+			{
+				EGL_CONTEXT_CLIENT_VERSION, 3,
+				EGL_NONE
+			};
+
+			EGLint configCount = 0;
+
+			if(!eglInitialize(display, nullptr, nullptr) ||
+			   !eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount < 1 ||
+			   (context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes)) == EGL_NO_CONTEXT)
+			{
+				fprintf(stderr, "GLReplay: EGL initialization failed (0x%04X)\n", eglGetError());
+				return false;
+			}
+		}
+
+		if(surface == EGL_NO_SURFACE || width != surfaceWidth || height != surfaceHeight)
+		{
+			const EGLint surfaceAttributes[] =
+			{
+				EGL_WIDTH, width,
+				EGL_HEIGHT, height,
+				EGL_NONE
+			};
+
+			EGLSurface previous = surface;
+			surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+
+			if(surface == EGL_NO_SURFACE)
+			{
+				fprintf(stderr, "GLReplay: %dx%d surface creation failed (0x%04X)\n", width, height, eglGetError());
+				return false;
+			}
+
+			eglMakeCurrent(display, surface, surface, context);
+			surfaceWidth = width;
+			surfaceHeight = height;
+
+			if(previous != EGL_NO_SURFACE)
+			{
+				eglDestroySurface(display, previous);
+			}
+		}
+
+		return true;
+	}
+
+	void Replayer::clientVertexData(Record &record)
+	{
+		GLuint index = record.read<GLuint>();
+		GLint size = record.read<GLint>();
+		GLenum type = record.read<GLuint>();
+		GLboolean normalized = record.read<GLboolean>();
+		GLboolean pureInteger = record.read<GLboolean>();
+		GLsizei stride = record.read<GLint>();
+		GLint first = record.read<GLint>();
+		const char *data = static_cast<const char*>(record.pointer());
+
+		if(!data)
+		{
+			return;
+		}
+
+		// The recorded data starts at the first vertex read by the draw call
+		const void *pointer = data - static_cast<intptr_t>(first) * stride;
+
+		GLint arrayBuffer = 0;
+		glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &arrayBuffer);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		if(pureInteger)
+		{
+			glVertexAttribIPointer(index, size, type, stride, pointer);
+		}
+		else
+		{
+			glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+		}
+
+		glBindBuffer(GL_ARRAY_BUFFER, arrayBuffer);
+	}
+
+	void Replayer::readPixels(Record &record)
+	{
+		GLint x = record.read<GLint>();
+		GLint y = record.read<GLint>();
+		GLsizei width = record.read<GLint>();
+		GLsizei height = record.read<GLint>();
+		GLenum format = record.read<GLuint>();
+		GLenum type = record.read<GLuint>();
+		const void *offset = record.pointer();
+
+		GLint packBuffer = 0;
+		glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &packBuffer);
+
+		if(packBuffer)
+		{
+			glReadPixels(x, y, width, height, format, type, const_cast<void*>(offset));
+			return;
+		}
+
+		// Large enough for any format and pack state
+		GLint rowLength = 0, skipRows = 0, skipPixels = 0;
+		glGetIntegerv(GL_PACK_ROW_LENGTH, &rowLength);
+		glGetIntegerv(GL_PACK_SKIP_ROWS, &skipRows);
+		glGetIntegerv(GL_PACK_SKIP_PIXELS, &skipPixels);
+
+		size_t rowPixels = std::max(rowLength, width) + skipPixels;
+		scratch.resize(std::max<size_t>(scratch.size(), rowPixels * (height + skipRows) * 16 + 8));
+
+		glReadPixels(x, y, width, height, format, type, scratch.data());
+	}
+
+	void Replayer::checkNames(const char *call, GLsizei count, const GLuint *names, const GLuint *recorded)
+	{
+		if(!nameMismatch && recorded && memcmp(names, recorded, count * sizeof(GLuint)) != 0)
+		{
+			fprintf(stderr, "GLReplay: warning: gl%s returned different names than when recording\n", call);
+			nameMismatch = true;
+		}
+	}
+
+	void Replayer::endFrame()
+	{
+		glFinish();
+
+		double time = elapsedMilliseconds(frameStart);
+		uint64_t routines = compiledRoutines() - frameRoutines;
+
+		if(!quiet)
+		{
+			printf("frame %d cpu_ms=%.3f draws=%llu routines=%llu\n", (int)frameTimes.size(), time,
+			       (unsigned long long)frameDraws, (unsigned long long)routines);
+		}
+
+		frameTimes.push_back(time);
+		totalDraws += frameDraws;
+		totalRoutines += routines;
+
+		frameStart = Clock::now();
+		frameDraws = 0;
+		frameRoutines = compiledRoutines();
+	}
+
+	bool Replayer::run(const std::vector<uint32_t> &trace)
+	{
+		size_t headerWords = sizeof(TraceHeader) / sizeof(uint32_t);
+
+		if(trace.size() < headerWords || trace[0] != TRACE_MAGIC || trace[1] != TRACE_VERSION)
+		{
+			fprintf(stderr, "GLReplay: not a version %d trace\n", TRACE_VERSION);
+			return false;
+		}
+
+		frameStart = Clock::now();
+		frameRoutines = compiledRoutines();
+
+		for(size_t position = headerWords; position + 2 <= trace.size();)
+		{
+			uint32_t call = trace[position];
+			size_t words = trace[position + 1] / sizeof(uint32_t);
+			position += 2;
+
+			if(position + words > trace.size())
+			{
+				fprintf(stderr, "GLReplay: trace is truncated\n");
+				break;
+			}
+
+			Record record(&trace[position], words);
+			position += words;
+
+			if(call != TRACE_MAKE_CURRENT && context == EGL_NO_CONTEXT && !makeCurrent(1, 1))
+			{
+				return false;
+			}
+
+			switch(call)
+			{
+			case TRACE_MAKE_CURRENT:
+				{
+					EGLint width = record.read<GLint>();
+					EGLint height = record.read<GLint>();
+
+					if(!makeCurrent(width, height))
+					{
+						return false;
+					}
+				}
+				break;
+			case TRACE_FRAME_END:
+				endFrame();
+				break;
+			case TRACE_CLIENT_VERTEX_DATA:
+				clientVertexData(record);
+				break;
+			case TRACE_CreateProgram:
+				{
+					GLuint name = glCreateProgram();
+					GLuint recorded = record.read<GLuint>();
+					checkNames("CreateProgram", 1, &name, &recorded);
+				}
+				break;
+			case TRACE_CreateShader:
+				{
+					GLenum type = record.read<GLuint>();
+					GLuint name = glCreateShader(type);
+					GLuint recorded = record.read<GLuint>();
+					checkNames("CreateShader", 1, &name, &recorded);
+				}
+				break;
+			case TRACE_ReadPixels:
+				readPixels(record);
+				break;
+			case TRACE_ShaderSource:
+				{
+					GLuint shader = record.read<GLuint>();
+					const GLchar *source = record.read<const GLchar*>();
+					glShaderSource(shader, source ? 1 : 0, &source, nullptr);
+				}
+				break;
+			#define REPLAY_GEN(name) \
+			case TRACE_##name: \
+				{ \
+					GLsizei count = record.read<GLint>(); \
+					const GLuint *recorded = record.read<const GLuint*>(); \
+					std::vector<GLuint> names(std::max(count, 0)); \
+					gl##name(count, names.data()); \
+					checkNames(#name, (GLsizei)names.size(), names.data(), recorded); \
+				} \
+				break;
+			REPLAY_GEN(GenBuffers)
+			REPLAY_GEN(GenFramebuffers)
+			REPLAY_GEN(GenRenderbuffers)
+			REPLAY_GEN(GenSamplers)
+			REPLAY_GEN(GenTextures)
+			REPLAY_GEN(GenVertexArrays)
+			#undef REPLAY_GEN
+			#define REPLAY_CALL(name) case TRACE_##name: replay(gl##name, record); break;
+			#define REPLAY_SPECIAL(name)
+			GL_TRACE_CALLS(REPLAY_CALL, REPLAY_SPECIAL)
+			#undef REPLAY_CALL
+			#undef REPLAY_SPECIAL
+			default:
+				fprintf(stderr, "GLReplay: unknown call %u\n", call);
+				return false;
+			}
+
+			switch(call)
+			{
+			case TRACE_DrawArrays:
+			case TRACE_DrawArraysInstanced:
+			case TRACE_DrawElements:
+			case TRACE_DrawElementsInstanced:
+			case TRACE_DrawRangeElements:
+				frameDraws++;
+				break;
+			default:
+				break;
+			}
+
+			if(record.overrun())
+			{
+				fprintf(stderr, "GLReplay: record of call %u is too short\n", call);
+				return false;
+			}
+		}
+
+		if(frameDraws > 0)
+		{
+			endFrame();   // Draws after the last swap
+		}
+
+		return true;
+	}
+
+	void Replayer::summary() const
+	{
+		if(frameTimes.empty())
+		{
+			printf("frames=0\n");
+			return;
+		}
+
+		std::vector<double> sorted = frameTimes;
+		std::sort(sorted.begin(), sorted.end());
+
+		double total = 0.0;
+
+		for(double time : frameTimes)
+		{
+			total += time;
+		}
+
+		printf("frames=%d total_ms=%.3f median_ms=%.3f max_ms=%.3f draws=%llu routines=%llu\n",
+		       (int)frameTimes.size(), total, sorted[sorted.size() / 2], sorted.back(),
+		       (unsigned long long)totalDraws, (unsigned long long)totalRoutines);
+	}
+
+	bool readTrace(const char *path, std::vector<uint32_t> &trace)
+	{
+		FILE *file = fopen(path, "rb");
+
+		if(!file)
+		{
+			fprintf(stderr, "GLReplay: cannot open %s\n", path);
+			return false;
+		}
+
+		fseek(file, 0, SEEK_END);
+		long size = ftell(file);
+		fseek(file, 0, SEEK_SET);
+
+		trace.resize(std::max(size, 0L) / sizeof(uint32_t));
+		size_t read = fread(trace.data(), sizeof(uint32_t), trace.size(), file);
+		fclose(file);
+
+		return read == trace.size();
+	}
+}
+
+int main(int argc, char **argv)
+{
+	const char *path = nullptr;
+	bool quiet = false;
+
+	for(int i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "--quiet") == 0)
+		{
+			quiet = true;
+		}
+		else if(!path && argv[i][0] != '-')
+		{
+			path = argv[i];
+		}
+		else
+		{
+			path = nullptr;
+			break;
+		}
+	}
+
+	if(!path)
+	{
+		fprintf(stderr, "Usage: %s <trace> [--quiet]\n", argv[0]);
+		return 1;
+	}
+
+	std::vector<uint32_t> trace;
+
+	if(!readTrace(path, trace))
+	{
+		return 1;
+	}
+
+	Replayer replayer(quiet);
+	bool success = replayer.run(trace);
+	replayer.summary();
+
+	return success ? 0 : 1;
+}
@@ -0,0 +1,632 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Measures the rendering throughput of SwiftShader through OpenGL ES, for
+// thread counts from 1 up to the number of cores. Each benchmark prints one
+// line per thread count:
+//
+//   <benchmark> threads=<count> <unit>=<rate>
+//
+// fill_*      Full screen quads for each blend mode, in megapixels per second
+// triangles_* Triangles with the given area in pixels, in megatriangles per second
+// texels_*    Full screen texturing per format and filter, in megasamples per second
+// draws_tiny  Single triangle draws with a uniform change, in kilodraws per second
+//
+// Usage: RendererBenchmarks [--filter <substring>] [--threads <max>] [--seconds <time>]
+
+#include <EGL/egl.h>
+#include <GLES2/gl2.h>
+#include <GLES3/gl3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	double elapsedSeconds(Clock::time_point start)
+	{
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	const int surfaceWidth = 1024;
+	const int surfaceHeight = 1024;
+
+	const char *const vertexShader =
+		"attribute vec2 position;\n"
+		"attribute vec2 texCoord;\n"
+		"uniform vec2 offset;\n"
+		"varying vec2 uv;\n"
+		"void main()\n"
+		"{\n"
+		"	uv = texCoord;\n"
+		"	gl_Position = vec4(position + offset, 0.0, 1.0);\n"
+		"}\n";
+
+	const char *const colorShader =
+		"precision mediump float;\n"
+		"uniform vec4 color;\n"
+		"void main()\n"
+		"{\n"
+		"	gl_FragColor = color;\n"
+		"}\n";
+
+	const char *const textureShader =
+		"precision mediump float;\n"
+		"uniform sampler2D tex;\n"
+		"varying vec2 uv;\n"
+		"void main()\n"
+		"{\n"
+		"	gl_FragColor = texture2D(tex, uv);\n"
+		"}\n";
+
+	GLuint compileShader(GLenum type, const char *source)
+	{
+		GLuint shader = glCreateShader(type);
+		glShaderSource(shader, 1, &source, nullptr);
+		glCompileShader(shader);
+
+		return shader;
+	}
+
+	GLuint createProgram(const char *fragmentShader)
+	{
+		GLuint program = glCreateProgram();
+		GLuint vs = compileShader(GL_VERTEX_SHADER, vertexShader);
+		GLuint fs = compileShader(GL_FRAGMENT_SHADER, fragmentShader);
+
+		glAttachShader(program, vs);
+		glAttachShader(program, fs);
+		glBindAttribLocation(program, 0, "position");
+		glBindAttribLocation(program, 1, "texCoord");
+		glLinkProgram(program);
+		glDeleteShader(vs);
+		glDeleteShader(fs);
+
+		GLint linked = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+
+		if(!linked)
+		{
+			fprintf(stderr, "RendererBenchmarks: program link failed\n");
+		}
+
+		glUseProgram(program);
+
+		return program;
+	}
+
+	// Interleaved position and texture coordinate of each vertex
+	GLuint createVertexBuffer(const std::vector<float> &vertices)
+	{
+		GLuint buffer = 0;
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+
+		glEnableVertexAttribArray(0);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), nullptr);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (const void*)(2 * sizeof(float)));
+
+		return buffer;
+	}
+
+	std::vector<float> fullScreenQuad(float texCoordScale)
+	{
+		const float s = texCoordScale;
+
+		return
+		{
+			-1.0f, -1.0f, 0.0f, 0.0f,
+			 1.0f, -1.0f, s,    0.0f,
+			-1.0f,  1.0f, 0.0f, s,
+			-1.0f,  1.0f, 0.0f, s,
+			 1.0f, -1.0f, s,    0.0f,
+			 1.0f,  1.0f, s,    s,
+		};
+	}
+
+	class Benchmark
+	{
+	public:
+		Benchmark(const std::string &name, const char *unit, double scale) : name(name), unit(unit), scale(scale)
+		{
+		}
+
+		virtual ~Benchmark() {}
+
+		virtual void setup() = 0;      // Creates the GL objects in the current context
+		virtual double run() = 0;      // Issues one iteration, returns the amount of work in 'unit'
+		virtual void teardown() = 0;   // Deletes the GL objects
+
+		const std::string name;
+		const char *const unit;
+		const double scale;   // Work items per reported unit
+	};
+
+	class FillBenchmark : public Benchmark
+	{
+	public:
+		FillBenchmark(const char *blend, GLenum source, GLenum destination)
+			: Benchmark(std::string("fill_") + blend, "mpixels_per_s", 1e6), source(source), destination(destination)
+		{
+		}
+
+		void setup() override
+		{
+			program = createProgram(colorShader);
+			buffer = createVertexBuffer(fullScreenQuad(1.0f));
+			glUniform4f(glGetUniformLocation(program, "color"), 0.8f, 0.4f, 0.2f, 0.5f);
+
+			if(source != GL_ONE || destination != GL_ZERO)
+			{
+				glEnable(GL_BLEND);
+				glBlendFunc(source, destination);
+			}
+		}
+
+		double run() override
+		{
+			for(int i = 0; i < quads; i++)
+			{
+				glDrawArrays(GL_TRIANGLES, 0, 6);
+			}
+
+			return (double)quads * surfaceWidth * surfaceHeight;
+		}
+
+		void teardown() override
+		{
+			glDisable(GL_BLEND);
+			glDeleteBuffers(1, &buffer);
+			glDeleteProgram(program);
+		}
+
+	private:
+		static const int quads = 8;
+
+		const GLenum source;
+		const GLenum destination;
+		GLuint program = 0;
+		GLuint buffer = 0;
+	};
+
+	class TriangleBenchmark : public Benchmark
+	{
+	public:
+		TriangleBenchmark(int area) : Benchmark("triangles_" + std::to_string(area) + "px", "mtriangles_per_s", 1e6), area(area)
+		{
+		}
+
+		void setup() override
+		{
+			program = createProgram(colorShader);
+			glUniform4f(glGetUniformLocation(program, "color"), 0.2f, 0.4f, 0.8f, 1.0f);
+
+			// Cells of side 'length' pixels, split into two triangles of 'area' pixels each
+			float length = std::sqrt(2.0f * area);
+			int cells = std::max(std::min((int)(surfaceWidth / length), maxCells), 1);
+			float size = 2.0f * length / surfaceWidth;
+
+			std::vector<float> vertices;
+			vertices.reserve(cells * cells * 6 * 4);
+
+			for(int y = 0; y < cells; y++)
+			{
+				for(int x = 0; x < cells; x++)
+				{
+					float x0 = -1.0f + x * size, x1 = x0 + size;
+					float y0 = -1.0f + y * size, y1 = y0 + size;
+					const float cell[] = {x0, y0, x1, y0, x0, y1, x0, y1, x1, y0, x1, y1};
+
+					for(int i = 0; i < 12; i += 2)
+					{
+						vertices.insert(vertices.end(), {cell[i], cell[i + 1], 0.0f, 0.0f});
+					}
+				}
+			}
+
+			triangles = cells * cells * 2;
+			buffer = createVertexBuffer(vertices);
+		}
+
+		double run() override
+		{
+			glDrawArrays(GL_TRIANGLES, 0, triangles * 3);
+
+			return triangles;
+		}
+
+		void teardown() override
+		{
+			glDeleteBuffers(1, &buffer);
+			glDeleteProgram(program);
+		}
+
+	private:
+		static const int maxCells = 256;
+
+		const int area;
+		int triangles = 0;
+		GLuint program = 0;
+		GLuint buffer = 0;
+	};
+
+	class TexelBenchmark : public Benchmark
+	{
+	public:
+		TexelBenchmark(const char *format, GLint internalFormat, GLenum dataFormat, GLenum type, const char *filter, GLenum minFilter, GLenum magFilter)
+			: Benchmark(std::string("texels_") + format + "_" + filter, "msamples_per_s", 1e6),
+			  internalFormat(internalFormat), dataFormat(dataFormat), type(type), minFilter(minFilter), magFilter(magFilter)
+		{
+		}
+
+		void setup() override
+		{
+			program = createProgram(textureShader);
+
+			// Each pixel covers 1.5 texels, so trilinear filtering blends two levels
+			buffer = createVertexBuffer(fullScreenQuad(1.5f * surfaceWidth / textureSize));
+
+			std::vector<unsigned char> data(textureSize * textureSize * 8);
+
+			for(size_t i = 0; i < data.size(); i++)
+			{
+				data[i] = (unsigned char)((i * 2654435761u) >> 24);
+			}
+
+			if(type == GL_HALF_FLOAT)   // Keeps the values finite
+			{
+				for(size_t i = 1; i < data.size(); i += 2)
+				{
+					data[i] &= 0x3B;
+				}
+			}
+
+			glGenTextures(1, &texture);
+			glBindTexture(GL_TEXTURE_2D, texture);
+
+			// Levels are uploaded rather than generated, since not all formats are renderable
+			for(int level = 0; (textureSize >> level) > 0; level++)
+			{
+				int size = textureSize >> level;
+				glTexImage2D(GL_TEXTURE_2D, level, internalFormat, size, size, 0, dataFormat, type, data.data());
+			}
+
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, magFilter);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		}
+
+		double run() override
+		{
+			for(int i = 0; i < quads; i++)
+			{
+				glDrawArrays(GL_TRIANGLES, 0, 6);
+			}
+
+			return (double)quads * surfaceWidth * surfaceHeight;
+		}
+
+		void teardown() override
+		{
+			glDeleteTextures(1, &texture);
+			glDeleteBuffers(1, &buffer);
+			glDeleteProgram(program);
+		}
+
+	private:
+		static const int quads = 4;
+		static const int textureSize = 512;
+
+		const GLint internalFormat;
+		const GLenum dataFormat;
+		const GLenum type;
+		const GLenum minFilter;
+		const GLenum magFilter;
+		GLuint program = 0;
+		GLuint buffer = 0;
+		GLuint texture = 0;
+	};
+
+	// Measures the per-draw overhead of the API and the renderer's draw call queue
+	class DrawBenchmark : public Benchmark
+	{
+	public:
+		DrawBenchmark() : Benchmark("draws_tiny", "kdraws_per_s", 1e3)
+		{
+		}
+
+		void setup() override
+		{
+			program = createProgram(colorShader);
+			glUniform4f(glGetUniformLocation(program, "color"), 0.4f, 0.8f, 0.2f, 1.0f);
+			offset = glGetUniformLocation(program, "offset");
+
+			const float size = 4.0f / surfaceWidth;
+			buffer = createVertexBuffer({-1.0f, -1.0f, 0.0f, 0.0f, -1.0f + size, -1.0f, 0.0f, 0.0f, -1.0f, -1.0f + size, 0.0f, 0.0f});
+		}
+
+		double run() override
+		{
+			for(int i = 0; i < draws; i++)
+			{
+				glUniform2f(offset, (i % 256) * (2.0f / 256), (i / 256) * (2.0f / 256));
+				glDrawArrays(GL_TRIANGLES, 0, 3);
+			}
+
+			return draws;
+		}
+
+		void teardown() override
+		{
+			glDeleteBuffers(1, &buffer);
+			glDeleteProgram(program);
+		}
+
+	private:
+		static const int draws = 1000;
+
+		GLuint program = 0;
+		GLuint buffer = 0;
+		GLint offset = -1;
+	};
+
+	std::vector<std::unique_ptr<Benchmark>> createBenchmarks()
+	{
+		std::vector<std::unique_ptr<Benchmark>> benchmarks;
+
+		benchmarks.emplace_back(new FillBenchmark("opaque", GL_ONE, GL_ZERO));
+		benchmarks.emplace_back(new FillBenchmark("alpha", GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+		benchmarks.emplace_back(new FillBenchmark("premultiplied", GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
+		benchmarks.emplace_back(new FillBenchmark("additive", GL_ONE, GL_ONE));
+		benchmarks.emplace_back(new FillBenchmark("multiply", GL_DST_COLOR, GL_ZERO));
+
+		for(int area : {1, 16, 256, 4096})
+		{
+			benchmarks.emplace_back(new TriangleBenchmark(area));
+		}
+
+		struct Format { const char *name; GLint internalFormat; GLenum format; GLenum type; };
+		struct Filter { const char *name; GLenum minFilter; GLenum magFilter; };
+
+		const Format formats[] =
+		{
+			{"rgba8", GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE},
+			{"rgb565", GL_RGB565, GL_RGB, GL_UNSIGNED_SHORT_5_6_5},
+			{"r8", GL_R8, GL_RED, GL_UNSIGNED_BYTE},
+			{"rgba16f", GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT},
+		};
+
+		const Filter filters[] =
+		{
+			{"nearest", GL_NEAREST, GL_NEAREST},
+			{"bilinear", GL_LINEAR, GL_LINEAR},
+			{"trilinear", GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR},
+		};
+
+		for(const Format &format : formats)
+		{
+			for(const Filter &filter : filters)
+			{
+				benchmarks.emplace_back(new TexelBenchmark(format.name, format.internalFormat, format.format, format.type,
+				                                           filter.name, filter.minFilter, filter.magFilter));
+			}
+		}
+
+		benchmarks.emplace_back(new DrawBenchmark());
+
+		return benchmarks;
+	}
+
+	void setThreadCount(int threads)
+	{
+		std::string count = std::to_string(threads);
+
+		#if defined(_WIN32)
+			_putenv_s("SWIFTSHADER_THREAD_COUNT", count.c_str());
+		#else
+			setenv("SWIFTSHADER_THREAD_COUNT", count.c_str(), 1);
+		#endif
+	}
+
+	// Each context gets its own renderer, which reads the thread count when created
+	class Session
+	{
+	public:
+		Session(int threads)
+		{
+			setThreadCount(threads);
+
+			display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+			const EGLint configAttributes[] =
+			{
+				EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+				EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
+				EGL_RED_SIZE, 8,
+				EGL_GREEN_SIZE, 8,
+				EGL_BLUE_SIZE, 8,
+				EGL_ALPHA_SIZE, 8,
+				EGL_NONE
+			};
+
+			const EGLint surfaceAttributes[] =
+			{
+				EGL_WIDTH, surfaceWidth,
+				EGL_HEIGHT, surfaceHeight,
+				EGL_NONE
+			};
+
+			const EGLint contextAttributes[] =
+			{
+				EGL_CONTEXT_CLIENT_VERSION, 3,
+				EGL_NONE
+			};
+
+			EGLConfig config = nullptr;
+			EGLint configCount = 0;
+
+			if(eglInitialize(display, nullptr, nullptr) &&
+			   eglChooseConfig(display, configAttributes, &config, 1, &configCount) && configCount == 1)
+			{
+				surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+				context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+			}
+
+			valid = surface != EGL_NO_SURFACE && context != EGL_NO_CONTEXT &&
+			        eglMakeCurrent(display, surface, surface, context);
+
+			if(valid)
+			{
+				glViewport(0, 0, surfaceWidth, surfaceHeight);
+			}
+		}
+
+		~Session()
+		{
+			eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+			if(context != EGL_NO_CONTEXT)
+			{
+				eglDestroyContext(display, context);
+			}
+
+			if(surface != EGL_NO_SURFACE)
+			{
+				eglDestroySurface(display, surface);
+			}
+
+			eglTerminate(display);
+		}
+
+		bool valid = false;
+
+	private:
+		EGLDisplay display = EGL_NO_DISPLAY;
+		EGLSurface surface = EGL_NO_SURFACE;
+		EGLContext context = EGL_NO_CONTEXT;
+	};
+
+	bool runBenchmark(Benchmark &benchmark, int threads, double seconds)
+	{
+		benchmark.setup();
+
+		// The first iteration compiles the routines
+		benchmark.run();
+		glFinish();
+
+		double items = 0.0;
+		double elapsed = 0.0;
+		Clock::time_point start = Clock::now();
+
+		do
+		{
+			items += benchmark.run();
+			glFinish();
+			elapsed = elapsedSeconds(start);
+		}
+		while(elapsed < seconds);
+
+		GLenum error = glGetError();
+		benchmark.teardown();
+
+		if(error != GL_NO_ERROR)
+		{
+			fprintf(stderr, "%s threads=%d failed with GL error 0x%04X\n", benchmark.name.c_str(), threads, error);
+			return false;
+		}
+
+		printf("%s threads=%d %s=%.2f\n", benchmark.name.c_str(), threads, benchmark.unit, items / benchmark.scale / elapsed);
+		fflush(stdout);
+
+		return true;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	const char *filter = nullptr;
+	int maxThreads = std::max((int)std::thread::hardware_concurrency(), 1);
+	double seconds = 0.5;
+
+	for(int i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+		{
+			filter = argv[++i];
+		}
+		else if(strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+		{
+			maxThreads = std::max(atoi(argv[++i]), 1);
+		}
+		else if(strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+		{
+			seconds = std::max(atof(argv[++i]), 0.0);
+		}
+		else
+		{
+			fprintf(stderr, "Usage: %s [--filter <substring>] [--threads <max>] [--seconds <time>]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	// Powers of two, and the maximum
+	std::vector<int> threadCounts;
+
+	for(int threads = 1; threads < maxThreads; threads *= 2)
+	{
+		threadCounts.push_back(threads);
+	}
+
+	threadCounts.push_back(maxThreads);
+
+	std::vector<std::unique_ptr<Benchmark>> benchmarks = createBenchmarks();
+	bool success = true;
+
+	for(int threads : threadCounts)
+	{
+		Session session(threads);
+
+		if(!session.valid)
+		{
+			fprintf(stderr, "RendererBenchmarks: EGL initialization failed (0x%04X)\n", eglGetError());
+			return 1;
+		}
+
+		for(const std::unique_ptr<Benchmark> &benchmark : benchmarks)
+		{
+			if(filter && !strstr(benchmark->name.c_str(), filter))
+			{
+				continue;
+			}
+
+			success &= runBenchmark(*benchmark, threads, seconds);
+		}
+	}
+
+	return success ? 0 : 1;
+}
@@ -0,0 +1,248 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Shader/VertexShader.hpp"
+#include "Common/BinaryStream.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace sw;
+
+typedef Shader::Instruction Instruction;
+
+static Instruction *emit(VertexShader &shader, Shader::Opcode opcode, Shader::ParameterType dstType, unsigned int dstIndex)
+{
+	Instruction *instruction = new Instruction(opcode);
+	instruction->dst.type = dstType;
+	instruction->dst.index = dstIndex;
+	shader.append(instruction);
+
+	return instruction;
+}
+
+static void source(Instruction *instruction, int i, Shader::ParameterType type, unsigned int index)
+{
+	instruction->src[i].type = type;
+	instruction->src[i].index = index;
+}
+
+static const Instruction *find(const VertexShader &shader, Shader::Opcode opcode)
+{
+	for(size_t i = 0; i < shader.getLength(); i++)
+	{
+		if(shader.getInstruction(i)->opcode == opcode)
+		{
+			return shader.getInstruction(i);
+		}
+	}
+
+	return nullptr;
+}
+
+// The copy constructor runs the optimization passes
+TEST(ShaderUnitTests, MatrixRows)
+{
+	VertexShader shader;
+
+	source(emit(shader, Shader::OPCODE_MOV, Shader::PARAMETER_TEMP, 0), 0, Shader::PARAMETER_CONST, 8);   // Dead
+
+	for(unsigned int row = 0; row < 4; row++)
+	{
+		source(emit(shader, Shader::OPCODE_MOV, Shader::PARAMETER_TEMP, 5 + row), 0, Shader::PARAMETER_CONST, row);
+	}
+
+	source(emit(shader, Shader::OPCODE_MOV, Shader::PARAMETER_TEMP, 2), 0, Shader::PARAMETER_INPUT, 1);
+
+	Instruction *transform = emit(shader, Shader::OPCODE_M4X4, Shader::PARAMETER_OUTPUT, 0);
+	source(transform, 0, Shader::PARAMETER_TEMP, 2);
+	source(transform, 1, Shader::PARAMETER_TEMP, 5);
+
+	VertexShader optimized(&shader);
+
+	const Instruction *m4x4 = find(optimized, Shader::OPCODE_M4X4);
+	ASSERT_NE(m4x4, nullptr);
+	ASSERT_EQ(m4x4->src[1].type, Shader::PARAMETER_TEMP);
+
+	// Every row is still written, to the consecutive registers the matrix source reads
+	int rows = 0;
+
+	for(size_t i = 0; i < optimized.getLength(); i++)
+	{
+		const Instruction *mov = optimized.getInstruction(i);
+
+		if(mov->opcode == Shader::OPCODE_MOV && mov->src[0].type == Shader::PARAMETER_CONST)
+		{
+			EXPECT_NE(mov->src[0].index, 8u);
+			EXPECT_EQ(mov->dst.index, m4x4->src[1].index + mov->src[0].index);
+			rows++;
+		}
+	}
+
+	EXPECT_EQ(rows, 4);
+}
+
+TEST(ShaderUnitTests, MatrixRowsM3X2)
+{
+	VertexShader shader;
+
+	for(unsigned int row = 0; row < 2; row++)
+	{
+		source(emit(shader, Shader::OPCODE_MOV, Shader::PARAMETER_TEMP, 3 + row), 0, Shader::PARAMETER_CONST, row);
+	}
+
+	source(emit(shader, Shader::OPCODE_MOV, Shader::PARAMETER_TEMP, 5), 0, Shader::PARAMETER_CONST, 2);   // Not a row of the 3x2 matrix
+
+	Instruction *transform = emit(shader, Shader::OPCODE_M3X2, Shader::PARAMETER_OUTPUT, 0);
+	source(transform, 0, Shader::PARAMETER_INPUT, 0);
+	source(transform, 1, Shader::PARAMETER_TEMP, 3);
+
+	VertexShader optimized(&shader);
+
+	const Instruction *m3x2 = find(optimized, Shader::OPCODE_M3X2);
+	ASSERT_NE(m3x2, nullptr);
+	EXPECT_EQ(m3x2->src[1].index, 0u);
+	EXPECT_EQ(optimized.getLength(), 3u);
+}
+
+TEST(ShaderUnitTests, RelativeAddress)
+{
+	VertexShader shader;
+
+	source(emit(shader, Shader::OPCODE_MOV, Shader::PARAMETER_TEMP, 0), 0, Shader::PARAMETER_CONST, 9);   // Dead
+	source(emit(shader, Shader::OPCODE_F2I, Shader::PARAMETER_TEMP, 4), 0, Shader::PARAMETER_INPUT, 0);
+
+	// c[r4.x + 2]
+	Instruction *load = emit(shader, Shader::OPCODE_MOV, Shader::PARAMETER_OUTPUT, 0);
+	source(load, 0, Shader::PARAMETER_CONST, 2);
+	load->src[0].rel.type = Shader::PARAMETER_TEMP;
+	load->src[0].rel.index = 4;
+
+	VertexShader optimized(&shader);
+
+	ASSERT_EQ(optimized.getLength(), 2u);
+	const Instruction *address = find(optimized, Shader::OPCODE_F2I);
+	ASSERT_NE(address, nullptr);
+
+	const Instruction *mov = find(optimized, Shader::OPCODE_MOV);
+	ASSERT_NE(mov, nullptr);
+	EXPECT_EQ(mov->src[0].rel.type, Shader::PARAMETER_TEMP);
+	EXPECT_EQ(mov->src[0].rel.index, address->dst.index);
+}
+
+TEST(ShaderUnitTests, RelativeTemporaries)
+{
+	VertexShader shader;
+
+	source(emit(shader, Shader::OPCODE_MOV, Shader::PARAMETER_TEMP, 0), 0, Shader::PARAMETER_CONST, 0);
+	source(emit(shader, Shader::OPCODE_MOV, Shader::PARAMETER_TEMP, 1), 0, Shader::PARAMETER_CONST, 1);
+	source(emit(shader, Shader::OPCODE_MOV, Shader::PARAMETER_TEMP, 7), 0, Shader::PARAMETER_CONST, 2);
+	source(emit(shader, Shader::OPCODE_F2I, Shader::PARAMETER_TEMP, 6), 0, Shader::PARAMETER_INPUT, 0);
+
+	// r[r6.x], which may read any temporary
+	Instruction *load = emit(shader, Shader::OPCODE_MOV, Shader::PARAMETER_OUTPUT, 0);
+	source(load, 0, Shader::PARAMETER_TEMP, 0);
+	load->src[0].rel.type = Shader::PARAMETER_TEMP;
+	load->src[0].rel.index = 6;
+
+	VertexShader optimized(&shader);
+
+	// Nothing is removed or renumbered
+	ASSERT_EQ(optimized.getLength(), 5u);
+
+	for(size_t i = 0; i < shader.getLength(); i++)
+	{
+		EXPECT_EQ(optimized.getInstruction(i)->opcode, shader.getInstruction(i)->opcode);
+		EXPECT_EQ(optimized.getInstruction(i)->dst.index, shader.getInstruction(i)->dst.index);
+	}
+}
+
+TEST(ShaderUnitTests, Loop)
+{
+	VertexShader shader;
+
+	source(emit(shader, Shader::OPCODE_MOV, Shader::PARAMETER_TEMP, 3), 0, Shader::PARAMETER_CONST, 0);
+
+	Instruction *rep = emit(shader, Shader::OPCODE_REP, Shader::PARAMETER_VOID, 0);
+	source(rep, 0, Shader::PARAMETER_CONSTINT, 0);
+
+	// The accumulator carries its value around the loop, the copy of c0 only holds on entry
+	Instruction *add = emit(shader, Shader::OPCODE_ADD, Shader::PARAMETER_TEMP, 3);
+	source(add, 0, Shader::PARAMETER_TEMP, 3);
+	source(add, 1, Shader::PARAMETER_CONST, 1);
+
+	emit(shader, Shader::OPCODE_ENDREP, Shader::PARAMETER_VOID, 0);
+
+	source(emit(shader, Shader::OPCODE_MOV, Shader::PARAMETER_OUTPUT, 0), 0, Shader::PARAMETER_TEMP, 3);
+
+	VertexShader optimized(&shader);
+
+	ASSERT_EQ(optimized.getLength(), 5u);
+
+	const Instruction *accumulate = find(optimized, Shader::OPCODE_ADD);
+	ASSERT_NE(accumulate, nullptr);
+	EXPECT_EQ(accumulate->src[0].type, Shader::PARAMETER_TEMP);
+	EXPECT_EQ(accumulate->src[0].index, accumulate->dst.index);
+
+	const Instruction *init = optimized.getInstruction(0);
+	EXPECT_EQ(init->opcode, Shader::OPCODE_MOV);
+	EXPECT_EQ(init->dst.index, accumulate->dst.index);
+}
+
+static bool roundTrip(const VertexShader &shader)
+{
+	BinaryWriter writer;
+	shader.serialize(writer);
+
+	BinaryReader reader(writer.data().data(), writer.data().size());
+	VertexShader loaded;
+
+	return loaded.deserialize(reader) && reader.atEnd();
+}
+
+// Program binaries come from the application, so deserialization can't trust any index
+TEST(ShaderUnitTests, DeserializeValidation)
+{
+	VertexShader shader;
+	Instruction *transform = emit(shader, Shader::OPCODE_M4X4, Shader::PARAMETER_OUTPUT, 0);
+	source(transform, 0, Shader::PARAMETER_INPUT, 0);
+	source(transform, 1, Shader::PARAMETER_CONST, VERTEX_UNIFORM_VECTORS - 4);
+
+	EXPECT_TRUE(roundTrip(shader));
+
+	transform->src[1].index = VERTEX_UNIFORM_VECTORS - 3;   // The last row is out of range
+	EXPECT_FALSE(roundTrip(shader));
+
+	transform->src[1].index = 0;
+	transform->dst.index = MAX_VERTEX_OUTPUTS;
+	EXPECT_FALSE(roundTrip(shader));
+
+	transform->dst.index = 0;
+	transform->src[0].rel.type = Shader::PARAMETER_TEMP;
+	transform->src[0].rel.index = NUM_TEMPORARY_REGISTERS;
+	EXPECT_FALSE(roundTrip(shader));
+
+	transform->src[0].rel.type = Shader::PARAMETER_VOID;
+	transform->opcode = (Shader::Opcode)(Shader::OPCODE_BREAKP + 1);
+	EXPECT_FALSE(roundTrip(shader));
+
+	transform->opcode = Shader::OPCODE_M4X4;
+	emit(shader, Shader::OPCODE_CALL, Shader::PARAMETER_LABEL, Shader::MAX_LABELS);
+	EXPECT_FALSE(roundTrip(shader));
+}
+
+int main(int argc, char **argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
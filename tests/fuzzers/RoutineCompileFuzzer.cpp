@@ -0,0 +1,852 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Generates random but valid vertex and pixel routine states, together with
+// GLSL shaders using a random mix of features, and compiles them with the
+// Reactor back-end this harness is linked with. As a libFuzzer target the
+// input bytes drive the generator and any crash is reported. The standalone
+// build records the compile time and code size of every case and reports the
+// outliers, which can be reproduced with --seed and --case.
+//
+// Usage: RoutineCompileFuzzer [--seed <n>] [--cases <count>] [--case <index>] [--outliers <count>]
+
+#include "OpenGL/compiler/InitializeGlobals.h"
+#include "OpenGL/compiler/InitializeParseContext.h"
+#include "OpenGL/compiler/TranslatorASM.h"
+
+// TODO: Debug macros of the GLSL compiler clash with core SwiftShader's.
+// They should not be exposed through the interface headers above.
+#undef ASSERT
+#undef UNIMPLEMENTED
+
+#include "Reactor/Routine.hpp"
+#include "Renderer/PixelProcessor.hpp"
+#include "Renderer/VertexProcessor.hpp"
+#include "Shader/PixelProgram.hpp"
+#include "Shader/VertexProgram.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#if !defined(ROUTINE_COMPILE_BACKEND)
+#define ROUTINE_COMPILE_BACKEND "default"
+#endif
+
+namespace {
+
+// This is a helper class to make sure all the resources used by the compiler are initialized
+class ScopedPoolAllocatorAndTLS
+{
+public:
+	ScopedPoolAllocatorAndTLS()
+	{
+		InitializeParseContextIndex();
+		InitializePoolIndex();
+		SetGlobalPoolAllocator(&allocator);
+	}
+
+	~ScopedPoolAllocatorAndTLS()
+	{
+		SetGlobalPoolAllocator(nullptr);
+		FreePoolIndex();
+		FreeParseContextIndex();
+	}
+
+private:
+	TPoolAllocator allocator;
+};
+
+// Trivial implementation of the glsl::Shader interface that fakes being an API-level
+// shader object. Gives access to the varyings, for linking.
+class FakeShader : public glsl::Shader
+{
+public:
+	FakeShader(sw::VertexShader *vertexShader, sw::PixelShader *pixelShader) : vertexShader(vertexShader), pixelShader(pixelShader)
+	{
+	}
+
+	sw::Shader *getShader() const override
+	{
+		return vertexShader ? static_cast<sw::Shader*>(vertexShader) : static_cast<sw::Shader*>(pixelShader);
+	}
+
+	sw::VertexShader *getVertexShader() const override
+	{
+		return vertexShader;
+	}
+
+	sw::PixelShader *getPixelShader() const override
+	{
+		return pixelShader;
+	}
+
+	const glsl::VaryingList &getVaryings() const
+	{
+		return varyings;
+	}
+
+private:
+	sw::VertexShader *vertexShader;
+	sw::PixelShader *pixelShader;
+};
+
+// Source of the generator's choices. Reads the fuzzer input when there is
+// one, and draws from a seeded random number generator otherwise.
+class Entropy
+{
+public:
+	Entropy(const uint8_t *data, size_t size) : data(data), size(size), random(0)
+	{
+	}
+
+	explicit Entropy(uint64_t seed) : data(nullptr), size(0), random(seed)
+	{
+	}
+
+	// Returns a value in [0, n)
+	unsigned int choose(unsigned int n)
+	{
+		if(n <= 1)
+		{
+			return 0;
+		}
+
+		if(data)
+		{
+			unsigned int value = 0;
+
+			for(unsigned int range = 1; range < n && size > 0; range <<= 8)
+			{
+				value = (value << 8) | *data++;
+				size--;
+			}
+
+			return value % n;
+		}
+
+		return std::uniform_int_distribution<unsigned int>(0, n - 1)(random);
+	}
+
+	bool flip()
+	{
+		return choose(2) != 0;
+	}
+
+	template<typename T, size_t N>
+	T choose(const T (&values)[N])
+	{
+		return values[choose(N)];
+	}
+
+private:
+	const uint8_t *data;
+	size_t size;
+	std::mt19937_64 random;
+};
+
+std::string format(const char *format, ...)
+{
+	char buffer[1024];
+
+	va_list vararg;
+	va_start(vararg, format);
+	vsnprintf(buffer, sizeof(buffer), format, vararg);
+	va_end(vararg);
+
+	return buffer;
+}
+
+// Returns a vec4 expression of the given operands
+std::string expression(Entropy &entropy, const std::string &a, const std::string &b)
+{
+	switch(entropy.choose(16))
+	{
+	case 0:  return format("(%s + %s)", a.c_str(), b.c_str());
+	case 1:  return format("(%s * %s)", a.c_str(), b.c_str());
+	case 2:  return format("(%s - %s * 0.5)", a.c_str(), b.c_str());
+	case 3:  return format("sin(%s)", a.c_str());
+	case 4:  return format("cos(%s + %s)", a.c_str(), b.c_str());
+	case 5:  return format("fract(%s)", a.c_str());
+	case 6:  return format("sqrt(abs(%s))", a.c_str());
+	case 7:  return format("inversesqrt(abs(%s) + 1.0)", a.c_str());
+	case 8:  return format("exp2(clamp(%s, -8.0, 8.0))", a.c_str());
+	case 9:  return format("log2(abs(%s) + 1.0)", a.c_str());
+	case 10: return format("pow(abs(%s), %s)", a.c_str(), b.c_str());
+	case 11: return format("mix(%s, %s, 0.25)", a.c_str(), b.c_str());
+	case 12: return format("max(%s, %s)", a.c_str(), b.c_str());
+	case 13: return format("vec4(dot(%s, %s))", a.c_str(), b.c_str());
+	case 14: return format("normalize(%s + vec4(1.0))", a.c_str());
+	default: return format("clamp(%s, 0.0, 1.0)", a.c_str());
+	}
+}
+
+// Appends statements updating the variable t with operands from the given list
+void statements(Entropy &entropy, std::string &source, const std::vector<std::string> &operands, int depth)
+{
+	int count = 1 + entropy.choose(8);
+
+	for(int i = 0; i < count; i++)
+	{
+		std::string operand = operands[entropy.choose((unsigned int)operands.size())];
+
+		switch(depth < 2 ? entropy.choose(8) : 0)
+		{
+		case 0:
+		case 1:
+		case 2:
+		case 3:
+		case 4:
+			source += "\tt = " + expression(entropy, "t", operand) + ";\n";
+			break;
+		case 5:
+			source += format("\tfor(int i%d = 0; i%d < %d; i%d++)\n\t{\n", depth, depth, 2 + entropy.choose(15), depth);
+			statements(entropy, source, operands, depth + 1);
+			source += "\t}\n";
+			break;
+		default:
+			source += format("\tif(t.%c > %s.%c)\n\t{\n", "xyzw"[entropy.choose(4)], operand.c_str(), "xyzw"[entropy.choose(4)]);
+			statements(entropy, source, operands, depth + 1);
+			source += "\t}\n\telse\n\t{\n";
+			statements(entropy, source, operands, depth + 1);
+			source += "\t}\n";
+			break;
+		}
+	}
+}
+
+struct Program
+{
+	std::string vertexSource;
+	std::string fragmentSource;
+	std::vector<bool> cubeSampler;   // Type of each fragment shader sampler
+
+	int vertexSamplers;
+	bool flatVaryings;
+	int drawBuffers;
+};
+
+Program generateProgram(Entropy &entropy)
+{
+	Program program;
+
+	int attributes = 1 + entropy.choose(sw::MAX_VERTEX_INPUTS);
+	int varyings = entropy.choose(9);
+	int samplers = entropy.choose(9);
+
+	program.vertexSamplers = entropy.choose(sw::VERTEX_TEXTURE_IMAGE_UNITS + 1);
+	program.flatVaryings = false;
+	program.drawBuffers = entropy.flip() ? 1 + entropy.choose(sw::RENDERTARGETS) : 0;
+
+	std::string &vs = program.vertexSource;
+	std::vector<std::string> vertexOperands = {"u[0]", "u[1]", "u[2]", "u[3]"};
+
+	vs += "uniform mat4 mvp;\nuniform vec4 u[8];\n";
+
+	for(int i = 0; i < attributes; i++)
+	{
+		vs += format("attribute vec4 a%d;\n", i);
+		vertexOperands.push_back(format("a%d", i));
+	}
+
+	for(int i = 0; i < varyings; i++)
+	{
+		vs += format("varying vec4 v%d;\n", i);
+	}
+
+	for(int i = 0; i < program.vertexSamplers; i++)
+	{
+		vs += format("uniform sampler2D vs%d;\n", i);
+	}
+
+	vs += "void main()\n{\n\tvec4 t = a0;\n";
+
+	for(int i = 0; i < program.vertexSamplers; i++)
+	{
+		vs += format("\tt += texture2DLod(vs%d, t.xy, 0.0);\n", i);
+	}
+
+	statements(entropy, vs, vertexOperands, 0);
+
+	for(int i = 0; i < varyings; i++)
+	{
+		vs += format("\tv%d = %s;\n", i, expression(entropy, "t", vertexOperands[entropy.choose((unsigned int)vertexOperands.size())]).c_str());
+	}
+
+	vs += "\tgl_Position = mvp * t;\n";
+
+	if(entropy.flip())
+	{
+		vs += "\tgl_PointSize = abs(t.w) + 1.0;\n";
+	}
+
+	vs += "}\n";
+
+	std::string &fs = program.fragmentSource;
+	std::vector<std::string> fragmentOperands = {"gl_FragCoord", "u[0]", "u[1]"};
+
+	if(program.drawBuffers)
+	{
+		fs += "#extension GL_EXT_draw_buffers : require\n";
+	}
+
+	fs += entropy.flip() ? "precision highp float;\n" : "precision mediump float;\n";
+	fs += "uniform vec4 u[4];\n";
+
+	for(int i = 0; i < varyings; i++)
+	{
+		fs += format("varying vec4 v%d;\n", i);
+		fragmentOperands.push_back(format("v%d", i));
+	}
+
+	for(int i = 0; i < samplers; i++)
+	{
+		program.cubeSampler.push_back(entropy.choose(4) == 0);
+		fs += format("uniform %s s%d;\n", program.cubeSampler[i] ? "samplerCube" : "sampler2D", i);
+	}
+
+	fs += "void main()\n{\n\tvec4 t = gl_FragCoord;\n";
+
+	for(int i = 0; i < samplers; i++)
+	{
+		const std::string &coordinates = fragmentOperands[entropy.choose((unsigned int)fragmentOperands.size())];
+
+		if(program.cubeSampler[i])
+		{
+			fs += format("\tt += textureCube(s%d, %s.xyz + t.xyz);\n", i, coordinates.c_str());
+		}
+		else if(entropy.flip())
+		{
+			fs += format("\tt += texture2DProj(s%d, %s);\n", i, coordinates.c_str());
+		}
+		else
+		{
+			fs += format("\tt += texture2D(s%d, %s.xy * t.zw);\n", i, coordinates.c_str());
+		}
+	}
+
+	statements(entropy, fs, fragmentOperands, 0);
+
+	if(entropy.choose(4) == 0)
+	{
+		fs += "\tif(t.w < 0.5) discard;\n";
+	}
+
+	if(program.drawBuffers)
+	{
+		for(int i = 0; i < program.drawBuffers; i++)
+		{
+			fs += format("\tgl_FragData[%d] = t * %d.0;\n", i, i + 1);
+		}
+	}
+	else
+	{
+		fs += "\tgl_FragColor = t;\n";
+	}
+
+	fs += "}\n";
+
+	return program;
+}
+
+ShBuiltInResources builtInResources()
+{
+	ShBuiltInResources resources;
+	resources.MaxVertexAttribs = sw::MAX_VERTEX_INPUTS;
+	resources.MaxVertexUniformVectors = sw::VERTEX_UNIFORM_VECTORS - 3;
+	resources.MaxVaryingVectors = MIN(sw::MAX_VERTEX_OUTPUTS, sw::MAX_VERTEX_INPUTS);
+	resources.MaxVertexTextureImageUnits = sw::VERTEX_TEXTURE_IMAGE_UNITS;
+	resources.MaxCombinedTextureImageUnits = sw::TEXTURE_IMAGE_UNITS + sw::VERTEX_TEXTURE_IMAGE_UNITS;
+	resources.MaxTextureImageUnits = sw::TEXTURE_IMAGE_UNITS;
+	resources.MaxFragmentUniformVectors = sw::FRAGMENT_UNIFORM_VECTORS - 3;
+	resources.MaxDrawBuffers = sw::RENDERTARGETS;
+	resources.MaxVertexOutputVectors = 16;
+	resources.MaxFragmentInputVectors = 15;
+	resources.MinProgramTexelOffset = sw::MIN_PROGRAM_TEXEL_OFFSET;
+	resources.MaxProgramTexelOffset = sw::MAX_PROGRAM_TEXEL_OFFSET;
+	resources.OES_standard_derivatives = 1;
+	resources.OES_fragment_precision_high = 1;
+	resources.OES_EGL_image_external = 1;
+	resources.EXT_draw_buffers = 1;
+	resources.ARB_texture_rectangle = 1;
+	resources.MaxCallStackDepth = 16;
+
+	return resources;
+}
+
+bool compile(FakeShader *shader, GLenum type, const std::string &source)
+{
+	std::unique_ptr<TranslatorASM> compiler(new TranslatorASM(shader, type));
+	compiler->Init(builtInResources());
+
+	const char *string = source.c_str();
+
+	return compiler->compile(&string, 1, SH_OBJECT_CODE);
+}
+
+// Connects the vertex shader outputs to the pixel shader inputs, like es2::Program::linkVaryings()
+void linkVaryings(const FakeShader &vertex, const FakeShader &fragment)
+{
+	for(const glsl::Varying &output : vertex.getVaryings())
+	{
+		for(const glsl::Varying &input : fragment.getVaryings())
+		{
+			if(output.name == input.name && input.registerIndex >= 0 && output.registerIndex >= 0)
+			{
+				int in = input.registerIndex;
+				int out = output.registerIndex;
+				int components = 4;   // The generated varyings are all vec4
+				int registers = output.size();
+
+				for(int i = 0; i < registers; i++)
+				{
+					bool flat = fragment.getPixelShader()->getInput(in + i, 0).flat;
+					vertex.getVertexShader()->setOutput(out + i, components, sw::Shader::Semantic(sw::Shader::USAGE_COLOR, in + i, flat));
+				}
+			}
+		}
+	}
+}
+
+sw::Sampler::State samplerState(Entropy &entropy, sw::TextureType type)
+{
+	static const sw::Format formats[] =
+	{
+		sw::FORMAT_A8R8G8B8, sw::FORMAT_A8B8G8R8, sw::FORMAT_X8B8G8R8, sw::FORMAT_R5G6B5, sw::FORMAT_R8, sw::FORMAT_G8R8,
+		sw::FORMAT_L8, sw::FORMAT_A8L8, sw::FORMAT_SRGB8_A8, sw::FORMAT_A2B10G10R10, sw::FORMAT_A16B16G16R16F,
+		sw::FORMAT_R32F, sw::FORMAT_A32B32G32R32F,
+	};
+
+	static const sw::AddressingMode addressingModes[] =
+	{
+		sw::ADDRESSING_WRAP, sw::ADDRESSING_CLAMP, sw::ADDRESSING_MIRROR, sw::ADDRESSING_MIRRORONCE, sw::ADDRESSING_BORDER,
+	};
+
+	sw::Sampler::State state;
+
+	state.textureType = type;
+	state.textureFormat = entropy.choose(formats);
+	state.textureFilter = (sw::FilterType)entropy.choose(sw::FILTER_LAST + 1);
+	state.mipmapFilter = (sw::MipmapType)entropy.choose(sw::MIPMAP_LAST + 1);
+	state.addressingModeU = (type == sw::TEXTURE_CUBE) ? sw::ADDRESSING_SEAMLESS : entropy.choose(addressingModes);
+	state.addressingModeV = (type == sw::TEXTURE_CUBE) ? sw::ADDRESSING_SEAMLESS : entropy.choose(addressingModes);
+	state.addressingModeW = entropy.choose(addressingModes);
+	state.sRGB = (state.textureFormat == sw::FORMAT_SRGB8_A8);
+	state.swizzleR = (sw::SwizzleType)entropy.choose(sw::SWIZZLE_LAST + 1);
+	state.swizzleG = (sw::SwizzleType)entropy.choose(sw::SWIZZLE_LAST + 1);
+	state.swizzleB = (sw::SwizzleType)entropy.choose(sw::SWIZZLE_LAST + 1);
+	state.swizzleA = (sw::SwizzleType)entropy.choose(sw::SWIZZLE_LAST + 1);
+	state.highPrecisionFiltering = entropy.flip();
+	state.compare = sw::COMPARE_BYPASS;
+	state.tiledLayout = entropy.flip();
+	state.adaptiveAnisotropy = entropy.flip();
+
+	return state;
+}
+
+sw::VertexProcessor::State vertexState(Entropy &entropy, const sw::VertexShader *shader)
+{
+	sw::VertexProcessor::State state;
+
+	state.shaderID = 0;
+	state.textureSampling = shader->containsTextureSampling();
+	state.positionRegister = shader->getPositionRegister();
+	state.pointSizeRegister = shader->getPointSizeRegister();
+
+	state.preTransformed = entropy.flip();
+	state.superSampling = entropy.flip();
+	state.multiSampling = entropy.flip();
+	state.transformFeedbackQueryEnabled = entropy.flip();
+	state.verticesPerPrimitive = 1 + entropy.choose(3);
+
+	for(int i = 0; i < sw::MAX_VERTEX_INPUTS; i++)
+	{
+		if(shader->getInput(i).active())
+		{
+			state.input[i].type = (sw::StreamType)entropy.choose(sw::STREAMTYPE_LAST + 1);
+			state.input[i].count = 1 + entropy.choose(4);
+			state.input[i].normalized = entropy.flip();
+			state.input[i].attribType = shader->getAttribType(i);
+		}
+	}
+
+	for(int i = 0; i < sw::VERTEX_TEXTURE_IMAGE_UNITS; i++)
+	{
+		if(shader->usesSampler(i))
+		{
+			state.sampler[i] = samplerState(entropy, sw::TEXTURE_2D);
+		}
+	}
+
+	for(int i = 0; i < sw::MAX_VERTEX_OUTPUTS; i++)
+	{
+		state.output[i].xWrite = shader->getOutput(i, 0).active();
+		state.output[i].yWrite = shader->getOutput(i, 1).active();
+		state.output[i].zWrite = shader->getOutput(i, 2).active();
+		state.output[i].wWrite = shader->getOutput(i, 3).active();
+	}
+
+	state.hash = state.computeHash();
+
+	return state;
+}
+
+sw::PixelProcessor::State pixelState(Entropy &entropy, const sw::PixelShader *shader, const Program &program)
+{
+	static const sw::Format colorFormats[] =
+	{
+		sw::FORMAT_A8R8G8B8, sw::FORMAT_X8R8G8B8, sw::FORMAT_A8B8G8R8, sw::FORMAT_X8B8G8R8, sw::FORMAT_R5G6B5, sw::FORMAT_R8,
+		sw::FORMAT_G8R8, sw::FORMAT_SRGB8_A8, sw::FORMAT_A2B10G10R10, sw::FORMAT_A16B16G16R16F, sw::FORMAT_R32F,
+		sw::FORMAT_A32B32G32R32F,
+	};
+
+	sw::PixelProcessor::State state;
+
+	state.shaderID = 0;
+	state.depthOverride = shader->depthOverride();
+	state.shaderContainsKill = shader->containsKill();
+	state.fastMath = entropy.flip();
+	state.earlyDepthTest = !state.depthOverride;
+
+	state.depthTestActive = entropy.flip();
+
+	if(state.depthTestActive)
+	{
+		state.depthCompareMode = (sw::DepthCompareMode)entropy.choose(sw::DEPTH_LAST + 1);
+		state.depthWriteEnable = entropy.flip();
+		state.quadLayoutDepthBuffer = entropy.flip();
+		state.depthBuffer16 = entropy.flip();
+		state.coarseDepthActive = entropy.flip();
+		state.coarseDepthTest = state.coarseDepthActive && entropy.flip();
+		state.depthClamp = entropy.flip();
+	}
+
+	state.stencilActive = entropy.flip();
+
+	if(state.stencilActive)
+	{
+		state.stencilCompareMode = (sw::StencilCompareMode)entropy.choose(sw::STENCIL_LAST + 1);
+		state.stencilFailOperation = (sw::StencilOperation)entropy.choose(sw::OPERATION_LAST + 1);
+		state.stencilPassOperation = (sw::StencilOperation)entropy.choose(sw::OPERATION_LAST + 1);
+		state.stencilZFailOperation = (sw::StencilOperation)entropy.choose(sw::OPERATION_LAST + 1);
+		state.noStencilMask = entropy.flip();
+		state.noStencilWriteMask = entropy.flip();
+		state.stencilWriteMasked = !state.noStencilWriteMask && entropy.flip();
+		state.twoSidedStencil = entropy.flip();
+		state.stencilCompareModeCCW = state.twoSidedStencil ? (sw::StencilCompareMode)entropy.choose(sw::STENCIL_LAST + 1) : state.stencilCompareMode;
+		state.stencilFailOperationCCW = state.twoSidedStencil ? (sw::StencilOperation)entropy.choose(sw::OPERATION_LAST + 1) : state.stencilFailOperation;
+		state.stencilPassOperationCCW = state.twoSidedStencil ? (sw::StencilOperation)entropy.choose(sw::OPERATION_LAST + 1) : state.stencilPassOperation;
+		state.stencilZFailOperationCCW = state.twoSidedStencil ? (sw::StencilOperation)entropy.choose(sw::OPERATION_LAST + 1) : state.stencilZFailOperation;
+		state.noStencilMaskCCW = state.twoSidedStencil ? entropy.flip() : state.noStencilMask;
+		state.noStencilWriteMaskCCW = state.twoSidedStencil ? entropy.flip() : state.noStencilWriteMask;
+		state.stencilWriteMaskedCCW = !state.noStencilWriteMaskCCW && entropy.flip();
+	}
+
+	state.occlusionEnabled = entropy.flip();
+	state.perspective = entropy.flip();
+
+	state.alphaBlendActive = entropy.flip();
+
+	if(state.alphaBlendActive)
+	{
+		state.sourceBlendFactor = (sw::BlendFactor)entropy.choose(sw::BLEND_LAST + 1);
+		state.destBlendFactor = (sw::BlendFactor)entropy.choose(sw::BLEND_LAST + 1);
+		state.blendOperation = (sw::BlendOperation)entropy.choose(sw::BLENDOP_LAST + 1);
+		state.sourceBlendFactorAlpha = (sw::BlendFactor)entropy.choose(sw::BLEND_LAST + 1);
+		state.destBlendFactorAlpha = (sw::BlendFactor)entropy.choose(sw::BLEND_LAST + 1);
+		state.blendOperationAlpha = (sw::BlendOperation)entropy.choose(sw::BLENDOP_LAST + 1);
+	}
+
+	int targets = std::max(program.drawBuffers, 1);
+
+	for(int i = 0; i < targets; i++)
+	{
+		state.targetFormat[i] = entropy.choose(colorFormats);
+		state.colorWriteMask |= (entropy.choose(4) == 0 ? entropy.choose(16) : 0xF) << (4 * i);
+	}
+
+	state.writeSRGB = entropy.flip();
+	state.multiSample = entropy.choose(4) == 0 ? 4 : 1;
+	state.multiSampleMask = 0xF;
+	state.centroid = (state.multiSample > 1) && shader->containsCentroid();
+	state.frontFaceCCW = entropy.flip();
+	state.logicalOperation = entropy.choose(4) == 0 ? (sw::LogicalOperation)entropy.choose(sw::LOGICALOP_LAST + 1) : sw::LOGICALOP_COPY;
+
+	for(int i = 0; i < sw::TEXTURE_IMAGE_UNITS; i++)
+	{
+		if(shader->usesSampler(i))
+		{
+			bool cube = i < (int)program.cubeSampler.size() && program.cubeSampler[i];
+			state.sampler[i] = samplerState(entropy, cube ? sw::TEXTURE_CUBE : sw::TEXTURE_2D);
+		}
+	}
+
+	bool point = entropy.choose(4) == 0;
+
+	for(int interpolant = 0; interpolant < sw::MAX_FRAGMENT_INPUTS; interpolant++)
+	{
+		for(int component = 0; component < 4; component++)
+		{
+			const sw::Shader::Semantic &semantic = shader->getInput(interpolant, component);
+
+			if(semantic.active())
+			{
+				state.interpolant[interpolant].component |= 1 << component;
+
+				if(semantic.flat || point)
+				{
+					state.interpolant[interpolant].flat |= 1 << component;
+				}
+			}
+		}
+	}
+
+	state.hash = state.computeHash();
+
+	return state;
+}
+
+struct Measurement
+{
+	uint64_t microseconds;   // Spent in the back-end, per Reactor's compiler statistics
+	uint64_t codeBytes;
+	uint64_t instructions;
+
+	Measurement &operator+=(const Measurement &other)
+	{
+		microseconds += other.microseconds;
+		codeBytes += other.codeBytes;
+		instructions += other.instructions;
+
+		return *this;
+	}
+};
+
+template<class Generator>
+Measurement generate(Generator &generator, const wchar_t *name)
+{
+	rr::CompilerStatistics before = rr::getCompilerStatistics();
+
+	generator.generate();
+	sw::Routine *routine = generator(name);
+
+	rr::CompilerStatistics after = rr::getCompilerStatistics();
+
+	assert(routine);
+	const void *entry = routine->getEntry();
+	assert(entry); (void)entry;
+	delete routine;
+
+	Measurement measurement;
+	measurement.microseconds = after.compileMicroseconds - before.compileMicroseconds;
+	measurement.codeBytes = after.codeBytes - before.codeBytes;
+	measurement.instructions = after.instructions - before.instructions;
+
+	return measurement;
+}
+
+struct Result
+{
+	bool compiled;
+	Measurement vertex;
+	Measurement pixel;
+	std::string description;
+};
+
+Result runCase(Entropy &entropy)
+{
+	Result result = {};
+
+	Program program = generateProgram(entropy);
+
+	std::unique_ptr<sw::VertexShader> vertexShader(new sw::VertexShader);
+	std::unique_ptr<sw::PixelShader> pixelShader(new sw::PixelShader);
+	FakeShader vertex(vertexShader.get(), nullptr);
+	FakeShader fragment(nullptr, pixelShader.get());
+
+	{
+		std::unique_ptr<ScopedPoolAllocatorAndTLS> allocatorAndTLS(new ScopedPoolAllocatorAndTLS);
+
+		if(!compile(&vertex, GL_VERTEX_SHADER, program.vertexSource) ||
+		   !compile(&fragment, GL_FRAGMENT_SHADER, program.fragmentSource))
+		{
+			return result;
+		}
+	}
+
+	linkVaryings(vertex, fragment);
+
+	sw::VertexProcessor::State vertexRoutineState = vertexState(entropy, vertexShader.get());
+	sw::PixelProcessor::State pixelRoutineState = pixelState(entropy, pixelShader.get(), program);
+
+	sw::VertexProgram vertexProgram(vertexRoutineState, vertexShader.get());
+	result.vertex = generate(vertexProgram, L"VertexRoutine");
+
+	sw::PixelProgram pixelProgram(pixelRoutineState, pixelShader.get());
+	result.pixel = generate(pixelProgram, L"PixelRoutine");
+
+	result.compiled = true;
+	result.description = format("vertex shader: %d instructions, pixel shader: %d instructions, depth %d, stencil %d, blend %d, targets %d, samples %d\n",
+	                            (int)vertexShader->getLength(), (int)pixelShader->getLength(),
+	                            (int)pixelRoutineState.depthTestActive, (int)pixelRoutineState.stencilActive,
+	                            (int)pixelRoutineState.alphaBlendActive, std::max(program.drawBuffers, 1),
+	                            (int)pixelRoutineState.multiSample) +
+	                     "--- vertex shader ---\n" + program.vertexSource +
+	                     "--- fragment shader ---\n" + program.fragmentSource;
+
+	return result;
+}
+
+} // anonymous namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	Entropy entropy(data, size);
+	runCase(entropy);
+
+	return 0;
+}
+
+#if defined(FUZZER_STANDALONE_STATISTICS)
+namespace {
+
+uint64_t caseSeed(uint64_t seed, uint64_t index)
+{
+	return seed * 0x9E3779B97F4A7C15ull + index;
+}
+
+void printResult(uint64_t index, const Result &result)
+{
+	printf("case=%llu vertex_us=%llu vertex_bytes=%llu pixel_us=%llu pixel_bytes=%llu\n",
+	       (unsigned long long)index,
+	       (unsigned long long)result.vertex.microseconds, (unsigned long long)result.vertex.codeBytes,
+	       (unsigned long long)result.pixel.microseconds, (unsigned long long)result.pixel.codeBytes);
+}
+
+} // anonymous namespace
+
+int main(int argc, char *argv[])
+{
+	uint64_t seed = 1;
+	uint64_t cases = 200;
+	int64_t single = -1;
+	size_t outliers = 10;
+
+	for(int i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+		{
+			seed = strtoull(argv[++i], nullptr, 0);
+		}
+		else if(strcmp(argv[i], "--cases") == 0 && i + 1 < argc)
+		{
+			cases = strtoull(argv[++i], nullptr, 0);
+		}
+		else if(strcmp(argv[i], "--case") == 0 && i + 1 < argc)
+		{
+			single = strtoll(argv[++i], nullptr, 0);
+		}
+		else if(strcmp(argv[i], "--outliers") == 0 && i + 1 < argc)
+		{
+			outliers = strtoull(argv[++i], nullptr, 0);
+		}
+		else
+		{
+			fprintf(stderr, "Usage: %s [--seed <n>] [--cases <count>] [--case <index>] [--outliers <count>]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	printf("backend=%s seed=%llu\n", ROUTINE_COMPILE_BACKEND, (unsigned long long)seed);
+
+	if(single >= 0)
+	{
+		Entropy entropy(caseSeed(seed, single));
+		Result result = runCase(entropy);
+
+		if(!result.compiled)
+		{
+			fprintf(stderr, "Case %lld did not produce valid shaders\n", (long long)single);
+			return 1;
+		}
+
+		printResult(single, result);
+		printf("%s", result.description.c_str());
+
+		return 0;
+	}
+
+	struct Sample
+	{
+		uint64_t index;
+		uint64_t microseconds;
+		uint64_t codeBytes;
+	};
+
+	std::vector<Sample> samples;
+	Measurement total = {};
+
+	for(uint64_t index = 0; index < cases; index++)
+	{
+		Entropy entropy(caseSeed(seed, index));
+		Result result = runCase(entropy);
+
+		if(result.compiled)
+		{
+			Measurement measurement = result.vertex;
+			measurement += result.pixel;
+			total += measurement;
+
+			samples.push_back({index, measurement.microseconds, measurement.codeBytes});
+		}
+	}
+
+	if(samples.empty())
+	{
+		fprintf(stderr, "No case produced valid shaders\n");
+		return 1;
+	}
+
+	std::sort(samples.begin(), samples.end(), [](const Sample &a, const Sample &b) { return a.microseconds > b.microseconds; });
+
+	const Sample &median = samples[samples.size() / 2];
+
+	printf("cases=%llu compiled=%llu total_us=%llu total_bytes=%llu median_us=%llu median_bytes=%llu\n",
+	       (unsigned long long)cases, (unsigned long long)samples.size(),
+	       (unsigned long long)total.microseconds, (unsigned long long)total.codeBytes,
+	       (unsigned long long)median.microseconds, (unsigned long long)median.codeBytes);
+
+	// The slowest cases, regenerated to show their shaders and states
+	for(size_t i = 0; i < std::min(outliers, samples.size()); i++)
+	{
+		Entropy entropy(caseSeed(seed, samples[i].index));
+		Result result = runCase(entropy);
+
+		printf("\noutlier=%d ratio_to_median=%.1f ", (int)i, (double)samples[i].microseconds / std::max(median.microseconds, (uint64_t)1));
+		printResult(samples[i].index, result);
+		printf("%s", result.description.c_str());
+	}
+
+	return 0;
+}
+#endif
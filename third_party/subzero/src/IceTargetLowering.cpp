@@ -28,6 +28,7 @@
 #include "IceOperand.h"
 #include "IceRegAlloc.h"
 
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -274,12 +275,8 @@ void TargetLowering::staticInit(GlobalContext *Ctx) {
     badTargetFatalError(Target);
 #define SUBZERO_TARGET(X)                                                      \
   case TARGET_LOWERING_CLASS_FOR(X): {                                         \
-    static bool InitGuard##X = false;                                          \
-    if (InitGuard##X) {                                                        \
-      return;                                                                  \
-    }                                                                          \
-    InitGuard##X = true;                                                       \
-    ::X::staticInit(Ctx);                                                      \
+    static std::once_flag InitOnce##X;                                         \
+    std::call_once(InitOnce##X, [Ctx]() { ::X::staticInit(Ctx); });            \
   } break;
 #include "SZTargets.def"
 #undef SUBZERO_TARGET
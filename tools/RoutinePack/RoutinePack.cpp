@@ -0,0 +1,98 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Bundles routine images into a routine pack which SwiftShader loads before
+// generating any code, so shipped applications skip the JIT for the states
+// they commonly use.
+//
+// The images are captured by running representative workloads with the
+// precache setting enabled, which makes each processor store the routines it
+// generates as <name>-<key>.bin files in SWIFTSHADER_ROUTINE_CACHE_DIR. The
+// resulting pack is selected at runtime with the SWIFTSHADER_ROUTINE_PACK
+// environment variable. Images only match the SwiftShader build and CPU
+// features they were captured with, mismatching ones are ignored.
+//
+// Usage: RoutinePack <output> <routine file or @manifest>...
+//
+// A manifest lists one routine file path per line.
+
+#include "Renderer/RoutineCache.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv)
+{
+	if(argc < 3)
+	{
+		fprintf(stderr, "Usage: %s <output> <routine file or @manifest>...\n", argv[0]);
+		return 1;
+	}
+
+	std::vector<std::string> files;
+
+	for(int i = 2; i < argc; i++)
+	{
+		if(argv[i][0] != '@')
+		{
+			files.push_back(argv[i]);
+			continue;
+		}
+
+		std::ifstream manifest(argv[i] + 1);
+
+		if(!manifest)
+		{
+			fprintf(stderr, "Can't open manifest %s\n", argv[i] + 1);
+			return 1;
+		}
+
+		std::string line;
+
+		while(std::getline(manifest, line))
+		{
+			if(!line.empty() && line[line.size() - 1] == '\r')
+			{
+				line.erase(line.size() - 1);
+			}
+
+			if(!line.empty() && line[0] != '#')
+			{
+				files.push_back(line);
+			}
+		}
+	}
+
+	std::vector<const char*> paths;
+
+	for(const std::string &file : files)
+	{
+		paths.push_back(file.c_str());
+	}
+
+	int count = sw::PersistentRoutineCache::writePack(argv[1], paths.data(), (int)paths.size());
+
+	if(count < 0)
+	{
+		fprintf(stderr, "Can't write %s\n", argv[1]);
+		return 1;
+	}
+
+	printf("Packed %d of %d routines into %s\n", count, (int)paths.size(), argv[1]);
+
+	return 0;
+}